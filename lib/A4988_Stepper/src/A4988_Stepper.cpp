@@ -36,6 +36,10 @@ A4988_Stepper::A4988_Stepper( int   m_spr
   motor_ms1_pin = m_ms1_pin;
   motor_ms2_pin = m_ms2_pin;
   motor_ms3_pin = m_ms3_pin;
+  motor_accel   = 0;
+  run_active    = false;
+  run_reported  = true;
+  run_done      = 0;
 
   adjustDelay();
   adjustPins();
@@ -149,6 +153,187 @@ void A4988_Stepper::doTurn(float howManyTimes)
   doMove(lSteps);
 }
 
+/*********************************************************************************************\
+ * Non-blocking moves
+ *
+ * ESP8266 shares timer1 with the core waveform generator (analogWrite, tone, servo) using its
+ * timer1 callback, ESP32 uses a one-shot esp_timer. The step period follows a trapezoidal
+ * profile using the integer approximation by D. Austin, c(n) = c(n-1) - 2 * c(n-1) / (4n + 1),
+ * and ramps down over the same number of steps it ramped up.
+\*********************************************************************************************/
+
+#ifdef ESP8266
+#include <core_esp8266_waveform.h>
+
+#define A4988_IRAM ICACHE_RAM_ATTR
+
+static A4988_Stepper* a4988_active = nullptr;
+static uint32_t a4988_next_cycle;
+
+static inline A4988_IRAM uint32_t a4988CycleCount(void) {
+  uint32_t ccount;
+  __asm__ __volatile__("rsr %0,ccount":"=a"(ccount));
+  return ccount;
+}
+
+static A4988_IRAM uint32_t a4988Timer1(void) {
+  // Called on every timer1 interrupt, returns cycles until the next step edge
+  int32_t wait = a4988_next_cycle - a4988CycleCount();
+  if (wait > 0) { return wait; }
+  unsigned long us = (a4988_active) ? a4988_active->timerEdge() : 0;
+  if (!us) { return microsecondsToClockCycles(10000); }  // Idle until removed by isDone()
+  a4988_next_cycle += microsecondsToClockCycles(us);
+  wait = a4988_next_cycle - a4988CycleCount();
+  return (wait > 0) ? wait : 0;
+}
+
+static void a4988TimerStart(A4988_Stepper* motor) {
+  a4988_active = motor;
+  a4988_next_cycle = a4988CycleCount() + microsecondsToClockCycles(10);
+  setTimer1Callback(a4988Timer1);
+}
+
+static void a4988TimerStop(void) {
+  setTimer1Callback(nullptr);
+  a4988_active = nullptr;
+}
+
+static inline A4988_IRAM void a4988StepPin(short pin, bool level) {
+  if (pin < 16) {
+    if (level) { GPOS = (1 << pin); } else { GPOC = (1 << pin); }
+  } else {
+    GP16O = level;
+  }
+}
+
+#else  // ESP32
+#include <esp_timer.h>
+
+#define A4988_IRAM
+
+static esp_timer_handle_t a4988_timer = nullptr;
+
+static void a4988EspTimer(void* arg) {
+  unsigned long us = ((A4988_Stepper*)arg)->timerEdge();
+  if (us) { esp_timer_start_once(a4988_timer, us); }
+}
+
+static void a4988TimerStart(A4988_Stepper* motor) {
+  if (!a4988_timer) {
+    esp_timer_create_args_t args = { a4988EspTimer, motor, ESP_TIMER_TASK, "a4988" };
+    esp_timer_create(&args, &a4988_timer);
+  }
+  esp_timer_start_once(a4988_timer, 10);
+}
+
+static void a4988TimerStop(void) {
+  esp_timer_stop(a4988_timer);
+}
+
+static inline void a4988StepPin(short pin, bool level) {
+  digitalWrite(pin, level);
+}
+
+#endif  // ESP8266 - ESP32
+
+bool A4988_Stepper::startMove(long howManySteps)
+{
+  if (run_active || !run_reported || !howManySteps) { return false; }
+  digitalWrite(motor_dir_pin, howManySteps>0?LOW:HIGH);
+  enable();
+  run_min_period = (motor_delay * 2) << 8;
+  run_period = run_min_period;
+  if (motor_accel) {
+    // c0 = 0.676 * sqrt(2 / accel) seconds, clamped to one second
+    float c0 = 676000.0 * sqrt(2.0 / motor_accel);
+    if (c0 > 1000000.0) { c0 = 1000000.0; }
+    if ((unsigned long)c0 << 8 > run_min_period) { run_period = (unsigned long)c0 << 8; }
+  }
+  run_togo     = abs(howManySteps);
+  run_done     = 0;
+  run_ramp     = 0;
+  run_high     = false;
+  run_stop     = false;
+  run_reported = false;
+  run_active   = true;
+  a4988TimerStart(this);
+  return true;
+}
+
+bool A4988_Stepper::startRotate(long howManyDegrees)
+{
+  return startMove(motor_SPR*motor_MIS*howManyDegrees/360);
+}
+
+bool A4988_Stepper::startTurn(float howManyTimes)
+{
+  return startMove(howManyTimes*motor_SPR);
+}
+
+A4988_IRAM unsigned long A4988_Stepper::timerEdge(void)
+{
+  if (!run_active) { return 0; }
+  if (!run_high) {
+    a4988StepPin(motor_stp_pin, HIGH);
+    run_high = true;
+    return run_period >> 9;
+  }
+  a4988StepPin(motor_stp_pin, LOW);  // only HIGH moves, if pulled LOW step is completed
+  run_high = false;
+  run_done++;
+  run_togo--;
+  if (run_stop && (run_togo > (long)run_ramp)) { run_togo = run_ramp; }
+  if (run_togo <= 0) {
+    run_active = false;
+    return 0;
+  }
+  if (motor_accel) {
+    if (run_togo <= (long)run_ramp) {
+      run_period += 2 * run_period / (4 * run_ramp - 1);  // ramp down to stop at the last step
+      run_ramp--;
+    } else if (run_period > run_min_period) {
+      run_ramp++;
+      run_period -= 2 * run_period / (4 * run_ramp + 1);
+      if (run_period < run_min_period) { run_period = run_min_period; }
+    }
+  }
+  return run_period >> 9;
+}
+
+void A4988_Stepper::stop(void)
+{
+  run_stop = true;
+}
+
+bool A4988_Stepper::isRunning(void)
+{
+  return run_active;
+}
+
+bool A4988_Stepper::isDone(void)
+{
+  if (run_active || run_reported) { return false; }
+  a4988TimerStop();
+  disable();
+  run_reported = true;
+  return true;
+}
+
+long A4988_Stepper::getSteps(void)
+{
+  return run_done;
+}
+
+void A4988_Stepper::setAccel(unsigned long stepsPerSecondSquared)
+{
+  motor_accel = stepsPerSecondSquared;
+}
+
+unsigned long A4988_Stepper::getAccel(void)
+{
+  return motor_accel;
+}
+
 int A4988_Stepper::version(void)
 {
   return 1;
@@ -44,6 +44,20 @@ class A4988_Stepper {
     void  doRotate(long degrs_to_turn);
     void  doTurn  (float howManyTimes);
 
+    // non-blocking moves, step pulses are generated from a timer
+    bool  startMove  (long steps_to_move);
+    bool  startRotate(long degrs_to_turn);
+    bool  startTurn  (float howManyTimes);
+    void  stop       (void              );  // ramp down and end the running move
+    bool  isRunning  (void              );
+    bool  isDone     (void              );  // true once after a started move ended
+    long  getSteps   (void              );  // steps taken by the last started move
+
+    void  setAccel   (unsigned long stepsPerSecondSquared);  // 0 = constant speed
+    unsigned long getAccel(void         );
+
+    unsigned long timerEdge(void        );  // called from the timer, returns us to next edge or 0
+
     void  enable  (void              );
     void  disable (void              );
 
@@ -68,6 +82,18 @@ class A4988_Stepper {
     short motor_ms3_pin;
 
     unsigned long last_time;  // timestamp of last pincycle of last step
+
+    // non-blocking move state, written by the timer while run_active
+    unsigned long          motor_accel;     // steps per second squared
+    unsigned long          run_min_period;  // step period at motor_RPM, in us << 8
+    volatile unsigned long run_period;      // current step period, in us << 8
+    volatile unsigned long run_ramp;        // number of steps into the current ramp
+    volatile long          run_togo;
+    volatile long          run_done;
+    volatile bool          run_high;
+    volatile bool          run_stop;
+    volatile bool          run_active;
+    bool                   run_reported;
 };
 
 #endif
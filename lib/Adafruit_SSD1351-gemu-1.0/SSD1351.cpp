@@ -208,6 +208,11 @@ void ICACHE_RAM_ATTR SSD1351::fastSPIwrite(uint8_t d,uint8_t dc) {
   WRITE_PERI_REG( PIN_OUT_SET, 1<<_cs);
 }
 
+void SSD1351::writeColors(uint16_t *data, uint32_t len) {
+  while (len--) {
+    write16BitColor(*data++);
+  }
+}
 
 #else
 // ESP32 section
@@ -263,6 +268,40 @@ void SSD1351::fastSPIwrite(uint8_t d,uint8_t dc) {
     digitalWrite( _cs, HIGH);
 }
 
+// send colors as data words of 9 bit packed msb first, 56 words per transfer
+void SSD1351::writeColors(uint16_t *data, uint32_t len) {
+  digitalWrite( _cs, LOW);
+  REG_SET_BIT(SPI_USER_REG(3), SPI_USR_MOSI);
+  len *= 2;
+  while (len) {
+    uint32_t num = (len > 56) ? 56 : len;
+    uint32_t fifo[16];
+    uint8_t *bp = (uint8_t*)fifo;
+    uint32_t acc = 0;
+    uint32_t bits = 0;
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < num; i += 2) {
+      uint16_t color = *data++;
+      acc = (acc << 18) | ((0x100 | (color >> 8)) << 9) | 0x100 | (color & 0xff);
+      bits += 18;
+      while (bits >= 8) {
+        bits -= 8;
+        bp[pos++] = acc >> bits;
+      }
+    }
+    if (bits) bp[pos++] = acc << (8 - bits);
+    REG_WRITE(SPI_MOSI_DLEN_REG(3), num * 9 - 1);
+    uint32_t *dp = (uint32_t*)SPI_W0_REG(3);
+    for (uint32_t i = 0; i < (pos + 3) / 4; i++) {
+      dp[i] = fifo[i];
+    }
+    REG_SET_BIT(SPI_CMD_REG(3), SPI_USR);
+    while (REG_GET_FIELD(SPI_CMD_REG(3), SPI_USR));
+    len -= num;
+  }
+  digitalWrite( _cs, HIGH);
+}
+
 #endif
 
 
@@ -515,10 +554,16 @@ void SSD1351::setAddrWindow(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
 }
 
 void SSD1351::pushColors(uint16_t *data, uint8_t len, boolean first) {
-  for (uint16_t b=0; b<len; b++){
-    write16BitColor(*data++);
-  }
+  writeColors(data, len);
+  stop();
+}
+
+// the area must be on the display
+bool SSD1351::pushColorRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *data) {
+  setAddrWindow_i(x, y, w, h);
+  writeColors(data, w * h);
   stop();
+  return true;
 }
 
 void SSD1351::drawFastVLine(int16_t x,int16_t y,int16_t h,uint16_t color) {
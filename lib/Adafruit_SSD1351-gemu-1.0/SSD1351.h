@@ -100,6 +100,7 @@ class SSD1351 : public Renderer {
   void setAddrWindow_i(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
   void setAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
   void pushColors(uint16_t *data, uint8_t len, boolean first);
+  bool pushColorRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *data);
   void drawPixel(int16_t x, int16_t y, uint16_t color);
   void write16BitColor(uint16_t color);
   void setRotation(uint8_t r);
@@ -120,6 +121,7 @@ class SSD1351 : public Renderer {
  private:
   uint8_t  tabcolor;
   void fastSPIwrite(uint8_t d,uint8_t dc);
+  void writeColors(uint16_t *data, uint32_t len);
   void start(void);
   void stop(void);
   int8_t  _cs, _mosi, _sclk, _hwspi;
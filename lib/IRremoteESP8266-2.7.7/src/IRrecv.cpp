@@ -183,6 +183,7 @@ IRrecv::IRrecv(const uint16_t recvpin, const uint16_t bufsize,
   _unknown_threshold = kUnknownThreshold;
 #endif  // DECODE_HASH
   _tolerance = kTolerance;
+  _decode_filtered = false;
 }
 
 // Class destructor
@@ -298,6 +299,26 @@ void IRrecv::setUnknownThreshold(const uint16_t length) {
 }
 #endif  // DECODE_HASH
 
+// Limit decode() to a set of protocols. Skipped decoders are not attempted at
+// all which makes matching faster.
+//
+// Args:
+//   mask: Bitmap with bit (protocol % 32) of word (protocol / 32) set for each
+//         decode_type_t to try, kLastDecodeType / 32 + 1 words.
+//         NULL to try all compiled in protocols.
+void IRrecv::setDecodeFilter(const uint32_t *mask) {
+  _decode_filtered = (mask != NULL);
+  if (_decode_filtered)
+    memcpy(_decode_filter, mask, sizeof(_decode_filter));
+}
+
+// Is the protocol attempted by decode()?
+bool IRrecv::decodeEnabled(const decode_type_t protocol) {
+  if (!_decode_filtered) return true;
+  if ((protocol < 0) || (protocol > kLastDecodeType)) return false;
+  return (_decode_filter[protocol / 32] >> (protocol % 32)) & 1;
+}
+
 
 // Set the base tolerance percentage for matching incoming IR messages.
 void IRrecv::setTolerance(const uint8_t percent) {
@@ -441,7 +462,8 @@ bool IRrecv::decode(decode_results *results, irparams_t *save,
     // Try decodeAiwaRCT501() before decodeSanyoLC7461() & decodeNEC()
     // because the protocols are similar. This protocol is more specific than
     // those ones, so should go before them.
-    if (decodeAiwaRCT501(results, offset)) return true;
+    if (decodeEnabled(AIWA_RC_T501) &&
+        decodeAiwaRCT501(results, offset)) return true;
 #endif
 #if DECODE_SANYO
     DPRINTLN("Attempting Sanyo LC7461 decode");
@@ -449,7 +471,8 @@ bool IRrecv::decode(decode_results *results, irparams_t *save,
     // similar in timings & structure, but the Sanyo one is much longer than the
     // NEC protocol (42 vs 32 bits) so this one should be tried first to try to
     // reduce false detection as a NEC packet.
-    if (decodeSanyoLC7461(results, offset)) return true;
+    if (decodeEnabled(SANYO_LC7461) &&
+        decodeSanyoLC7461(results, offset)) return true;
 #endif
 #if DECODE_CARRIER_AC
     DPRINTLN("Attempting Carrier AC decode");
@@ -457,7 +480,8 @@ bool IRrecv::decode(decode_results *results, irparams_t *save,
     // similar in timings & structure, but the Carrier one is much longer than
     // the NEC protocol (3x32 bits vs 1x32 bits) so this one should be tried
     // first to try to reduce false detection as a NEC packet.
-    if (decodeCarrierAC(results, offset)) return true;
+    if (decodeEnabled(CARRIER_AC) &&
+        decodeCarrierAC(results, offset)) return true;
 #endif
 #if DECODE_PIONEER
     DPRINTLN("Attempting Pioneer decode");
@@ -465,7 +489,7 @@ bool IRrecv::decode(decode_results *results, irparams_t *save,
     // similar in timings & structure, but the Pioneer one is much longer than
     // the NEC protocol (2x32 bits vs 1x32 bits) so this one should be tried
     // first to try to reduce false detection as a NEC packet.
-    if (decodePioneer(results, offset)) return true;
+    if (decodeEnabled(PIONEER) && decodePioneer(results, offset)) return true;
 #endif
 #if DECODE_EPSON
   DPRINTLN("Attempting Epson decode");
@@ -473,132 +497,146 @@ bool IRrecv::decode(decode_results *results, irparams_t *save,
   // similar in timings & structure, but the Epson one is much longer than the
   // NEC protocol (3x32 identical bits vs 1x32 bits) so this one should be tried
   // first to try to reduce false detection as a NEC packet.
-  if (decodeEpson(results, offset)) return true;
+  if (decodeEnabled(EPSON) && decodeEpson(results, offset)) return true;
 #endif
 #if DECODE_NEC
     DPRINTLN("Attempting NEC decode");
-    if (decodeNEC(results, offset)) return true;
+    if (decodeEnabled(NEC) && decodeNEC(results, offset)) return true;
 #endif
 #if DECODE_SONY
     DPRINTLN("Attempting Sony decode");
-    if (decodeSony(results, offset)) return true;
+    if (decodeEnabled(SONY) && decodeSony(results, offset)) return true;
 #endif
 #if DECODE_MITSUBISHI
     DPRINTLN("Attempting Mitsubishi decode");
-    if (decodeMitsubishi(results, offset)) return true;
+    if (decodeEnabled(MITSUBISHI) &&
+        decodeMitsubishi(results, offset)) return true;
 #endif
 #if DECODE_MITSUBISHI_AC
     DPRINTLN("Attempting Mitsubishi AC decode");
-    if (decodeMitsubishiAC(results, offset)) return true;
+    if (decodeEnabled(MITSUBISHI_AC) &&
+        decodeMitsubishiAC(results, offset)) return true;
 #endif
 #if DECODE_MITSUBISHI2
     DPRINTLN("Attempting Mitsubishi2 decode");
-    if (decodeMitsubishi2(results, offset)) return true;
+    if (decodeEnabled(MITSUBISHI2) &&
+        decodeMitsubishi2(results, offset)) return true;
 #endif
 #if DECODE_RC5
     DPRINTLN("Attempting RC5 decode");
-    if (decodeRC5(results, offset)) return true;
+    if ((decodeEnabled(RC5) || decodeEnabled(RC5X)) &&
+        decodeRC5(results, offset)) return true;
 #endif
 #if DECODE_RC6
     DPRINTLN("Attempting RC6 decode");
-    if (decodeRC6(results, offset)) return true;
+    if (decodeEnabled(RC6) && decodeRC6(results, offset)) return true;
 #endif
 #if DECODE_RCMM
     DPRINTLN("Attempting RC-MM decode");
-    if (decodeRCMM(results, offset)) return true;
+    if (decodeEnabled(RCMM) && decodeRCMM(results, offset)) return true;
 #endif
 #if DECODE_FUJITSU_AC
     // Fujitsu A/C needs to precede Panasonic and Denon as it has a short
     // message which looks exactly the same as a Panasonic/Denon message.
     DPRINTLN("Attempting Fujitsu A/C decode");
-    if (decodeFujitsuAC(results, offset)) return true;
+    if (decodeEnabled(FUJITSU_AC) &&
+        decodeFujitsuAC(results, offset)) return true;
 #endif
 #if DECODE_DENON
     // Denon needs to precede Panasonic as it is a special case of Panasonic.
     DPRINTLN("Attempting Denon decode");
-    if (decodeDenon(results, offset, kDenon48Bits) ||
-        decodeDenon(results, offset, kDenonBits) ||
-        decodeDenon(results, offset, kDenonLegacyBits))
+    if (decodeEnabled(DENON) &&
+        (decodeDenon(results, offset, kDenon48Bits) ||
+         decodeDenon(results, offset, kDenonBits) ||
+         decodeDenon(results, offset, kDenonLegacyBits)))
       return true;
 #endif
 #if DECODE_PANASONIC
     DPRINTLN("Attempting Panasonic decode");
-    if (decodePanasonic(results, offset)) return true;
+    if (decodeEnabled(PANASONIC) &&
+        decodePanasonic(results, offset)) return true;
 #endif
 #if DECODE_LG
     DPRINTLN("Attempting LG (28-bit) decode");
-    if (decodeLG(results, offset, kLgBits, true)) return true;
+    if ((decodeEnabled(LG) || decodeEnabled(LG2)) &&
+        decodeLG(results, offset, kLgBits, true)) return true;
     DPRINTLN("Attempting LG (32-bit) decode");
     // LG32 should be tried before Samsung
-    if (decodeLG(results, offset, kLg32Bits, true)) return true;
+    if ((decodeEnabled(LG) || decodeEnabled(LG2)) &&
+        decodeLG(results, offset, kLg32Bits, true)) return true;
 #endif
 #if DECODE_GICABLE
     // Note: Needs to happen before JVC decode, because it looks similar except
     //       with a required NEC-like repeat code.
     DPRINTLN("Attempting GICable decode");
-    if (decodeGICable(results, offset)) return true;
+    if (decodeEnabled(GICABLE) && decodeGICable(results, offset)) return true;
 #endif
 #if DECODE_JVC
     DPRINTLN("Attempting JVC decode");
-    if (decodeJVC(results, offset)) return true;
+    if (decodeEnabled(JVC) && decodeJVC(results, offset)) return true;
 #endif
 #if DECODE_SAMSUNG
     DPRINTLN("Attempting SAMSUNG decode");
-    if (decodeSAMSUNG(results, offset)) return true;
+    if (decodeEnabled(SAMSUNG) && decodeSAMSUNG(results, offset)) return true;
 #endif
 #if DECODE_SAMSUNG36
     DPRINTLN("Attempting Samsung36 decode");
-    if (decodeSamsung36(results, offset)) return true;
+    if (decodeEnabled(SAMSUNG36) &&
+        decodeSamsung36(results, offset)) return true;
 #endif
 #if DECODE_WHYNTER
     DPRINTLN("Attempting Whynter decode");
-    if (decodeWhynter(results, offset)) return true;
+    if (decodeEnabled(WHYNTER) && decodeWhynter(results, offset)) return true;
 #endif
 #if DECODE_DISH
     DPRINTLN("Attempting DISH decode");
-    if (decodeDISH(results, offset)) return true;
+    if (decodeEnabled(DISH) && decodeDISH(results, offset)) return true;
 #endif
 #if DECODE_SHARP
     DPRINTLN("Attempting Sharp decode");
-    if (decodeSharp(results, offset)) return true;
+    if (decodeEnabled(SHARP) && decodeSharp(results, offset)) return true;
 #endif
 #if DECODE_COOLIX
     DPRINTLN("Attempting Coolix decode");
-    if (decodeCOOLIX(results, offset)) return true;
+    if (decodeEnabled(COOLIX) && decodeCOOLIX(results, offset)) return true;
 #endif
 #if DECODE_NIKAI
     DPRINTLN("Attempting Nikai decode");
-    if (decodeNikai(results, offset)) return true;
+    if (decodeEnabled(NIKAI) && decodeNikai(results, offset)) return true;
 #endif
 #if DECODE_KELVINATOR
     // Kelvinator based-devices use a similar code to Gree ones, to avoid false
     // matches this needs to happen before decodeGree().
     DPRINTLN("Attempting Kelvinator decode");
-    if (decodeKelvinator(results, offset)) return true;
+    if (decodeEnabled(KELVINATOR) &&
+        decodeKelvinator(results, offset)) return true;
 #endif
 #if DECODE_DAIKIN
     DPRINTLN("Attempting Daikin decode");
-    if (decodeDaikin(results, offset)) return true;
+    if (decodeEnabled(DAIKIN) && decodeDaikin(results, offset)) return true;
 #endif
 #if DECODE_DAIKIN2
     DPRINTLN("Attempting Daikin2 decode");
-    if (decodeDaikin2(results, offset)) return true;
+    if (decodeEnabled(DAIKIN2) && decodeDaikin2(results, offset)) return true;
 #endif
 #if DECODE_DAIKIN216
     DPRINTLN("Attempting Daikin216 decode");
-    if (decodeDaikin216(results, offset)) return true;
+    if (decodeEnabled(DAIKIN216) &&
+        decodeDaikin216(results, offset)) return true;
 #endif
 #if DECODE_TOSHIBA_AC
     DPRINTLN("Attempting Toshiba AC decode");
-    if (decodeToshibaAC(results, offset)) return true;
+    if (decodeEnabled(TOSHIBA_AC) &&
+        decodeToshibaAC(results, offset)) return true;
 #endif
 #if DECODE_MIDEA
     DPRINTLN("Attempting Midea decode");
-    if (decodeMidea(results, offset)) return true;
+    if (decodeEnabled(MIDEA) && decodeMidea(results, offset)) return true;
 #endif
 #if DECODE_MAGIQUEST
     DPRINTLN("Attempting Magiquest decode");
-    if (decodeMagiQuest(results, offset)) return true;
+    if (decodeEnabled(MAGIQUEST) &&
+        decodeMagiQuest(results, offset)) return true;
 #endif
   /* NOTE: Disabled due to poor quality.
 #if DECODE_SANYO
@@ -617,197 +655,224 @@ bool IRrecv::decode(decode_results *results, irparams_t *save,
     // other protocols that are NEC-like as well, as turning off strict may
     // cause this to match other valid protocols.
     DPRINTLN("Attempting NEC (non-strict) decode");
-    if (decodeNEC(results, offset, kNECBits, false)) {
+    if (decodeEnabled(NEC_LIKE) &&
+        decodeNEC(results, offset, kNECBits, false)) {
       results->decode_type = NEC_LIKE;
       return true;
     }
 #endif
 #if DECODE_LASERTAG
     DPRINTLN("Attempting Lasertag decode");
-    if (decodeLasertag(results, offset)) return true;
+    if (decodeEnabled(LASERTAG) && decodeLasertag(results, offset)) return true;
 #endif
 #if DECODE_GREE
     // Gree based-devices use a similar code to Kelvinator ones, to avoid false
     // matches this needs to happen after decodeKelvinator().
     DPRINTLN("Attempting Gree decode");
-    if (decodeGree(results, offset)) return true;
+    if (decodeEnabled(GREE) && decodeGree(results, offset)) return true;
 #endif
 #if DECODE_HAIER_AC
     DPRINTLN("Attempting Haier AC decode");
-    if (decodeHaierAC(results, offset)) return true;
+    if (decodeEnabled(HAIER_AC) && decodeHaierAC(results, offset)) return true;
 #endif
 #if DECODE_HAIER_AC_YRW02
     DPRINTLN("Attempting Haier AC YR-W02 decode");
-    if (decodeHaierACYRW02(results, offset)) return true;
+    if (decodeEnabled(HAIER_AC_YRW02) &&
+        decodeHaierACYRW02(results, offset)) return true;
 #endif
 #if DECODE_HITACHI_AC424
     // HitachiAc424 should be checked before HitachiAC, HitachiAC2,
     // & HitachiAC184
     DPRINTLN("Attempting Hitachi AC 424 decode");
-    if (decodeHitachiAc424(results, offset, kHitachiAc424Bits)) return true;
+    if (decodeEnabled(HITACHI_AC424) &&
+        decodeHitachiAc424(results, offset, kHitachiAc424Bits)) return true;
 #endif  // DECODE_HITACHI_AC424
 #if DECODE_MITSUBISHI136
     // Needs to happen before HitachiAc3 decode.
     DPRINTLN("Attempting Mitsubishi136 decode");
-    if (decodeMitsubishi136(results, offset)) return true;
+    if (decodeEnabled(MITSUBISHI136) &&
+        decodeMitsubishi136(results, offset)) return true;
 #endif  // DECODE_MITSUBISHI136
 #if DECODE_HITACHI_AC3
     // HitachiAc3 should be checked before HitachiAC & HitachiAC2
     // Attempt normal before the short version.
     DPRINTLN("Attempting Hitachi AC3 decode");
     // Order these in decreasing bit size, as it is more optimal.
-    if (decodeHitachiAc3(results, offset, kHitachiAc3Bits) ||
-        decodeHitachiAc3(results, offset, kHitachiAc3Bits - 4 * 8) ||
-        decodeHitachiAc3(results, offset, kHitachiAc3Bits - 6 * 8) ||
-        decodeHitachiAc3(results, offset, kHitachiAc3MinBits + 2 * 8) ||
-        decodeHitachiAc3(results, offset, kHitachiAc3MinBits))
+    if (decodeEnabled(HITACHI_AC3) &&
+        (decodeHitachiAc3(results, offset, kHitachiAc3Bits) ||
+         decodeHitachiAc3(results, offset, kHitachiAc3Bits - 4 * 8) ||
+         decodeHitachiAc3(results, offset, kHitachiAc3Bits - 6 * 8) ||
+         decodeHitachiAc3(results, offset, kHitachiAc3MinBits + 2 * 8) ||
+         decodeHitachiAc3(results, offset, kHitachiAc3MinBits)))
       return true;
 #endif  // DECODE_HITACHI_AC3
 #if DECODE_HITACHI_AC2
     // HitachiAC2 should be checked before HitachiAC
     DPRINTLN("Attempting Hitachi AC2 decode");
-    if (decodeHitachiAC(results, offset, kHitachiAc2Bits)) return true;
+    if (decodeEnabled(HITACHI_AC2) &&
+        decodeHitachiAC(results, offset, kHitachiAc2Bits)) return true;
 #endif  // DECODE_HITACHI_AC2
 #if DECODE_HITACHI_AC
     DPRINTLN("Attempting Hitachi AC decode");
-    if (decodeHitachiAC(results, offset, kHitachiAcBits)) return true;
+    if (decodeEnabled(HITACHI_AC) &&
+        decodeHitachiAC(results, offset, kHitachiAcBits)) return true;
 #endif
 #if DECODE_HITACHI_AC1
     DPRINTLN("Attempting Hitachi AC1 decode");
-    if (decodeHitachiAC(results, offset, kHitachiAc1Bits)) return true;
+    if (decodeEnabled(HITACHI_AC1) &&
+        decodeHitachiAC(results, offset, kHitachiAc1Bits)) return true;
 #endif
 #if DECODE_WHIRLPOOL_AC
     DPRINTLN("Attempting Whirlpool AC decode");
-    if (decodeWhirlpoolAC(results, offset)) return true;
+    if (decodeEnabled(WHIRLPOOL_AC) &&
+        decodeWhirlpoolAC(results, offset)) return true;
 #endif
 #if DECODE_SAMSUNG_AC
     DPRINTLN("Attempting Samsung AC (extended) decode");
     // Check the extended size first, as it should fail fast due to longer
     // length.
-    if (decodeSamsungAC(results, offset, kSamsungAcExtendedBits, false))
+    if (decodeEnabled(SAMSUNG_AC) &&
+        decodeSamsungAC(results, offset, kSamsungAcExtendedBits, false))
       return true;
     // Now check for the more common length.
     DPRINTLN("Attempting Samsung AC decode");
-    if (decodeSamsungAC(results, offset, kSamsungAcBits)) return true;
+    if (decodeEnabled(SAMSUNG_AC) &&
+        decodeSamsungAC(results, offset, kSamsungAcBits)) return true;
 #endif
 #if DECODE_ELECTRA_AC
     DPRINTLN("Attempting Electra AC decode");
-    if (decodeElectraAC(results, offset)) return true;
+    if (decodeEnabled(ELECTRA_AC) &&
+        decodeElectraAC(results, offset)) return true;
 #endif
 #if DECODE_PANASONIC_AC
     DPRINTLN("Attempting Panasonic AC decode");
-    if (decodePanasonicAC(results, offset)) return true;
+    if (decodeEnabled(PANASONIC_AC) &&
+        decodePanasonicAC(results, offset)) return true;
     DPRINTLN("Attempting Panasonic AC short decode");
-    if (decodePanasonicAC(results, offset, kPanasonicAcShortBits)) return true;
+    if (decodeEnabled(PANASONIC_AC) &&
+        decodePanasonicAC(results, offset, kPanasonicAcShortBits)) return true;
 #endif
 #if DECODE_LUTRON
     DPRINTLN("Attempting Lutron decode");
-    if (decodeLutron(results, offset)) return true;
+    if (decodeEnabled(LUTRON) && decodeLutron(results, offset)) return true;
 #endif
 #if DECODE_MWM
     DPRINTLN("Attempting MWM decode");
-    if (decodeMWM(results, offset)) return true;
+    if (decodeEnabled(MWM) && decodeMWM(results, offset)) return true;
 #endif
 #if DECODE_VESTEL_AC
     DPRINTLN("Attempting Vestel AC decode");
-    if (decodeVestelAc(results, offset)) return true;
+    if (decodeEnabled(VESTEL_AC) &&
+        decodeVestelAc(results, offset)) return true;
 #endif
 #if DECODE_MITSUBISHI112 || DECODE_TCL112AC
     // Mitsubish112 and Tcl112 share the same decoder.
     DPRINTLN("Attempting Mitsubishi112/TCL112AC decode");
-    if (decodeMitsubishi112(results, offset)) return true;
+    if ((decodeEnabled(MITSUBISHI112) || decodeEnabled(TCL112AC)) &&
+        decodeMitsubishi112(results, offset)) return true;
 #endif  // DECODE_MITSUBISHI112 || DECODE_TCL112AC
 #if DECODE_TECO
     DPRINTLN("Attempting Teco decode");
-    if (decodeTeco(results, offset)) return true;
+    if (decodeEnabled(TECO) && decodeTeco(results, offset)) return true;
 #endif
 #if DECODE_LEGOPF
     DPRINTLN("Attempting LEGOPF decode");
-    if (decodeLegoPf(results, offset)) return true;
+    if (decodeEnabled(LEGOPF) && decodeLegoPf(results, offset)) return true;
 #endif
 #if DECODE_MITSUBISHIHEAVY
     DPRINTLN("Attempting MITSUBISHIHEAVY (152 bit) decode");
-    if (decodeMitsubishiHeavy(results, offset, kMitsubishiHeavy152Bits))
+    if (decodeEnabled(MITSUBISHI_HEAVY_152) &&
+        decodeMitsubishiHeavy(results, offset, kMitsubishiHeavy152Bits))
       return true;
     DPRINTLN("Attempting MITSUBISHIHEAVY (88 bit) decode");
-    if (decodeMitsubishiHeavy(results, offset, kMitsubishiHeavy88Bits))
+    if (decodeEnabled(MITSUBISHI_HEAVY_88) &&
+        decodeMitsubishiHeavy(results, offset, kMitsubishiHeavy88Bits))
       return true;
 #endif
 #if DECODE_ARGO
     DPRINTLN("Attempting Argo decode");
-    if (decodeArgo(results, offset)) return true;
+    if (decodeEnabled(ARGO) && decodeArgo(results, offset)) return true;
 #endif  // DECODE_ARGO
 #if DECODE_SHARP_AC
     DPRINTLN("Attempting SHARP_AC decode");
-    if (decodeSharpAc(results, offset)) return true;
+    if (decodeEnabled(SHARP_AC) && decodeSharpAc(results, offset)) return true;
 #endif
 #if DECODE_GOODWEATHER
     DPRINTLN("Attempting GOODWEATHER decode");
-    if (decodeGoodweather(results, offset)) return true;
+    if (decodeEnabled(GOODWEATHER) &&
+        decodeGoodweather(results, offset)) return true;
 #endif  // DECODE_GOODWEATHER
 #if DECODE_INAX
     DPRINTLN("Attempting Inax decode");
-    if (decodeInax(results, offset)) return true;
+    if (decodeEnabled(INAX) && decodeInax(results, offset)) return true;
 #endif  // DECODE_INAX
 #if DECODE_TROTEC
     DPRINTLN("Attempting Trotec decode");
-    if (decodeTrotec(results, offset)) return true;
+    if (decodeEnabled(TROTEC) && decodeTrotec(results, offset)) return true;
 #endif  // DECODE_TROTEC
 #if DECODE_DAIKIN160
     DPRINTLN("Attempting Daikin160 decode");
-    if (decodeDaikin160(results, offset)) return true;
+    if (decodeEnabled(DAIKIN160) &&
+        decodeDaikin160(results, offset)) return true;
 #endif  // DECODE_DAIKIN160
 #if DECODE_NEOCLIMA
     DPRINTLN("Attempting Neoclima decode");
-    if (decodeNeoclima(results, offset)) return true;
+    if (decodeEnabled(NEOCLIMA) && decodeNeoclima(results, offset)) return true;
 #endif  // DECODE_NEOCLIMA
 #if DECODE_DAIKIN176
     DPRINTLN("Attempting Daikin176 decode");
-    if (decodeDaikin176(results, offset)) return true;
+    if (decodeEnabled(DAIKIN176) &&
+        decodeDaikin176(results, offset)) return true;
 #endif  // DECODE_DAIKIN176
 #if DECODE_DAIKIN128
     DPRINTLN("Attempting Daikin128 decode");
-    if (decodeDaikin128(results, offset)) return true;
+    if (decodeEnabled(DAIKIN128) &&
+        decodeDaikin128(results, offset)) return true;
 #endif  // DECODE_DAIKIN128
 #if DECODE_AMCOR
     DPRINTLN("Attempting Amcor decode");
-    if (decodeAmcor(results, offset)) return true;
+    if (decodeEnabled(AMCOR) && decodeAmcor(results, offset)) return true;
 #endif  // DECODE_AMCOR
 #if DECODE_DAIKIN152
     DPRINTLN("Attempting Daikin152 decode");
-    if (decodeDaikin152(results, offset)) return true;
+    if (decodeEnabled(DAIKIN152) &&
+        decodeDaikin152(results, offset)) return true;
 #endif  // DECODE_DAIKIN152
 #if DECODE_SYMPHONY
     DPRINTLN("Attempting Symphony decode");
-    if (decodeSymphony(results, offset)) return true;
+    if (decodeEnabled(SYMPHONY) && decodeSymphony(results, offset)) return true;
 #endif  // DECODE_SYMPHONY
 #if DECODE_DAIKIN64
     DPRINTLN("Attempting Daikin64 decode");
-    if (decodeDaikin64(results, offset)) return true;
+    if (decodeEnabled(DAIKIN64) && decodeDaikin64(results, offset)) return true;
 #endif  // DECODE_DAIKIN64
 #if DECODE_AIRWELL
     DPRINTLN("Attempting Airwell decode");
-    if (decodeAirwell(results, offset)) return true;
+    if (decodeEnabled(AIRWELL) && decodeAirwell(results, offset)) return true;
 #endif  // DECODE_AIRWELL
 #if DECODE_DELONGHI_AC
     DPRINTLN("Attempting Delonghi AC decode");
-    if (decodeDelonghiAc(results, offset)) return true;
+    if (decodeEnabled(DELONGHI_AC) &&
+        decodeDelonghiAc(results, offset)) return true;
 #endif  // DECODE_DELONGHI_AC
 #if DECODE_DOSHISHA
     DPRINTLN("Attempting Doshisha decode");
-    if (decodeDoshisha(results, offset)) return true;
+    if (decodeEnabled(DOSHISHA) && decodeDoshisha(results, offset)) return true;
 #endif  // DECODE_DOSHISHA
 #if DECODE_MULTIBRACKETS
     DPRINTLN("Attempting Multibrackets decode");
-    if (decodeMultibrackets(results, offset)) return true;
+    if (decodeEnabled(MULTIBRACKETS) &&
+        decodeMultibrackets(results, offset)) return true;
 #endif  // DECODE_MULTIBRACKETS
 #if DECODE_CARRIER_AC40
     DPRINTLN("Attempting Carrier 40bit decode");
-    if (decodeCarrierAC40(results, offset)) return true;
+    if (decodeEnabled(CARRIER_AC40) &&
+        decodeCarrierAC40(results, offset)) return true;
 #endif  // DECODE_CARRIER_AC40
 #if DECODE_CARRIER_AC64
     DPRINTLN("Attempting Carrier 64bit decode");
-    if (decodeCarrierAC64(results, offset)) return true;
+    if (decodeEnabled(CARRIER_AC64) &&
+        decodeCarrierAC64(results, offset)) return true;
 #endif  // DECODE_CARRIER_AC64
   // Typically new protocols are added above this line.
   }
@@ -815,7 +880,7 @@ bool IRrecv::decode(decode_results *results, irparams_t *save,
   // decodeHash returns a hash on any input.
   // Thus, it needs to be last in the list.
   // If you add any decodes, add them before this.
-  if (decodeHash(results)) {
+  if (decodeEnabled(HASH) && decodeHash(results)) {
     return true;
   }
 #endif  // DECODE_HASH
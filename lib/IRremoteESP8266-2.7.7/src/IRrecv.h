@@ -134,6 +134,8 @@ class IRrecv {
 #if DECODE_HASH
   void setUnknownThreshold(const uint16_t length);
 #endif
+  void setDecodeFilter(const uint32_t *mask);
+  bool decodeEnabled(const decode_type_t protocol);
   bool match(const uint32_t measured, const uint32_t desired,
              const uint8_t tolerance = kUseDefTol,
              const uint16_t delta = 0);
@@ -155,6 +157,8 @@ class IRrecv {
 #if DECODE_HASH
   uint16_t _unknown_threshold;
 #endif
+  uint32_t _decode_filter[kLastDecodeType / 32 + 1];  // Bit set per enabled decode_type_t
+  bool _decode_filtered;
   // These are called by decode
   uint8_t _validTolerance(const uint8_t percentage);
   void copyIrParams(volatile irparams_t *src, irparams_t *dst);
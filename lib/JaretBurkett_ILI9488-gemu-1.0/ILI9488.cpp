@@ -284,6 +284,38 @@ void ILI9488::fastSPIwrite(uint8_t d,uint8_t dc) {
     digitalWrite( _cs, HIGH);
 }
 
+// same as above for a block of data bytes, 56 words of 9 bit packed msb first per transfer
+void ILI9488::writedata(uint8_t *data, uint32_t len) {
+  digitalWrite( _cs, LOW);
+  REG_SET_BIT(SPI_USER_REG(3), SPI_USR_MOSI);
+  while (len) {
+    uint32_t num = (len > 56) ? 56 : len;
+    uint32_t fifo[16];
+    uint8_t *bp = (uint8_t*)fifo;
+    uint32_t acc = 0;
+    uint32_t bits = 0;
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < num; i++) {
+      acc = (acc << 9) | 0x100 | *data++;
+      bits += 9;
+      while (bits >= 8) {
+        bits -= 8;
+        bp[pos++] = acc >> bits;
+      }
+    }
+    if (bits) bp[pos++] = acc << (8 - bits);
+    REG_WRITE(SPI_MOSI_DLEN_REG(3), num * 9 - 1);
+    uint32_t *dp = (uint32_t*)SPI_W0_REG(3);
+    for (uint32_t i = 0; i < (pos + 3) / 4; i++) {
+      dp[i] = fifo[i];
+    }
+    REG_SET_BIT(SPI_CMD_REG(3), SPI_USR);
+    while (REG_GET_FIELD(SPI_CMD_REG(3), SPI_USR));
+    len -= num;
+  }
+  digitalWrite( _cs, HIGH);
+}
+
 SPISettings ili9488_spiSettings;
 
 void ILI9488::start(void) {
@@ -576,14 +608,45 @@ void ILI9488::pushColors(uint16_t *data, uint8_t len, boolean first) {
     count++;
   }
 
+#ifdef ESP32
+    writedata(buff, len*3);
+#else
     for(uint16_t b = 0; b < len*3; b++){
       writedata(buff[b]);
     }
+#endif
 
     ILI9488_STOP
 
 }
 
+// the area must be on the display
+bool ILI9488::pushColorRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *data) {
+  setAddrWindow(x, y, x + w - 1, y + h - 1);
+  uint32_t pixels = w * h;
+  while (pixels) {
+    uint8_t num = (pixels > 255) ? 255 : pixels;
+    uint8_t buff[num * 3];
+    uint16_t count = 0;
+    for (uint32_t i = 0; i < num; i++) {
+      uint16_t color = *data++;
+      buff[count++] = (((color & 0xF800) >> 11) * 255) / 31;
+      buff[count++] = (((color & 0x07E0) >> 5) * 255) / 63;
+      buff[count++] = ((color & 0x001F) * 255) / 31;
+    }
+#ifdef ESP32
+    writedata(buff, count);
+#else
+    for (uint32_t b = 0; b < count; b++) {
+      writedata(buff[b]);
+    }
+#endif
+    pixels -= num;
+  }
+  ILI9488_STOP
+  return true;
+}
+
 void ILI9488::write16BitColor(uint16_t color){
   // #if (__STM32F1__)
   //     uint8_t buff[4] = {
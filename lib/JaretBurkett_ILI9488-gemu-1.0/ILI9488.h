@@ -141,6 +141,7 @@ class ILI9488 : public Renderer {
   void scroll(uint16_t pixels);
   void pushColor(uint16_t color);
   void pushColors(uint16_t *data, uint8_t len, boolean first);
+  bool pushColorRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *data);
   //void drawImage(const uint8_t* img, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
   void fillScreen(uint16_t color);
   void drawPixel(int16_t x, int16_t y, uint16_t color);
@@ -162,6 +163,7 @@ class ILI9488 : public Renderer {
  private:
   uint8_t  tabcolor;
   void fastSPIwrite(uint8_t d,uint8_t dc);
+  void writedata(uint8_t *data, uint32_t len);
   void spi_lcd_mode_init(void);
   void start(void);
   void stop(void);
@@ -178,6 +178,14 @@ public:
         _state &= ~NEO_DIRTY;
     };
 
+    // optional 256 entry table applied to every byte while encoding the output stream,
+    // the pixel buffer keeps the values as set (only supported by ESP methods)
+    void SetOutputLut(const uint8_t* lut)
+    {
+        _method.SetOutputLut(lut);
+        Dirty();
+    };
+
     uint8_t* Pixels() 
     {
         return _method.getPixels();
@@ -248,7 +248,14 @@ public:
         return _pixelsSize;
     }
 
+    void SetOutputLut(const uint8_t* lut)
+    {
+        s_outputLut = lut;
+    }
+
 private:
+    static const uint8_t* s_outputLut; // Optional table applied to every byte in _translate, per channel
+
     const uint8_t _pin;            // output pin number
 
     size_t    _pixelsSize;      // Size of '_pixels' buffer 
@@ -280,7 +287,7 @@ private:
 
         for (;;)
         {
-            uint8_t data = *psrc;
+            uint8_t data = (s_outputLut) ? s_outputLut[*psrc] : *psrc;
 
             for (uint8_t bit = 0; bit < 8; bit++)
             {
@@ -315,6 +322,9 @@ private:
     }
 };
 
+template<typename T_SPEED, typename T_CHANNEL>
+const uint8_t* NeoEsp32RmtMethodBase<T_SPEED, T_CHANNEL>::s_outputLut = nullptr;
+
 typedef NeoEsp32RmtMethodBase<NeoEsp32RmtSpeedWs2812x, NeoEsp32RmtChannel0> NeoEsp32Rmt0Ws2812xMethod;
 typedef NeoEsp32RmtMethodBase<NeoEsp32RmtSpeedSk6812, NeoEsp32RmtChannel0> NeoEsp32Rmt0Sk6812Method;
 typedef NeoEsp32RmtMethodBase<NeoEsp32RmtSpeedApa106, NeoEsp32RmtChannel0> NeoEsp32Rmt0Apa106Method;
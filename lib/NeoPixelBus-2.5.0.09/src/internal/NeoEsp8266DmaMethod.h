@@ -132,6 +132,7 @@ public:
 
         _pixels = (uint8_t*)malloc(_pixelsSize);
         memset(_pixels, 0x00, _pixelsSize);
+        _outputLut = nullptr;
 
         _i2sBuffer = (uint8_t*)malloc(_i2sBufferSize);
         memset(_i2sBuffer, 0x00, _i2sBufferSize);
@@ -317,9 +318,16 @@ public:
         return _pixelsSize;
     }
 
+    void SetOutputLut(const uint8_t* lut)
+    {
+        _outputLut = lut;
+    }
+
 private:
     static NeoEsp8266DmaMethodBase* s_this; // for the ISR
 
+    const uint8_t* _outputLut;  // Optional table applied to every byte while filling the DMA buffer
+
     size_t    _pixelsSize;    // Size of '_pixels' buffer 
     uint8_t*  _pixels;        // Holds LED color values
 
@@ -404,8 +412,9 @@ private:
         uint8_t* pPixelsEnd = _pixels + _pixelsSize;
         for (uint8_t* pPixel = _pixels; pPixel < pPixelsEnd; pPixel++)
         {
-            *(pDma++) = bitpatterns[((*pPixel) & 0x0f)];
-            *(pDma++) = bitpatterns[((*pPixel) >> 4) & 0x0f];
+            uint8_t value = (_outputLut) ? _outputLut[*pPixel] : *pPixel;
+            *(pDma++) = bitpatterns[(value & 0x0f)];
+            *(pDma++) = bitpatterns[(value >> 4) & 0x0f];
         }
     }
 
@@ -36,15 +36,15 @@ License along with NeoPixel.  If not, see
 // for esp8266, due to linker overriding the ICACHE_RAM_ATTR for cpp files, these methods are
 // moved into a C file so the attribute will be applied correctly
 // >> this may have been fixed and is no longer a requirement <<
-extern "C" void ICACHE_RAM_ATTR bitbang_send_pixels_800(uint8_t* pixels, uint8_t* end, uint8_t pin);
-extern "C" void ICACHE_RAM_ATTR bitbang_send_pixels_400(uint8_t* pixels, uint8_t* end, uint8_t pin);
+extern "C" void ICACHE_RAM_ATTR bitbang_send_pixels_800(uint8_t* pixels, uint8_t* end, uint8_t pin, const uint8_t* lut);
+extern "C" void ICACHE_RAM_ATTR bitbang_send_pixels_400(uint8_t* pixels, uint8_t* end, uint8_t pin, const uint8_t* lut);
 
 class NeoEspBitBangSpeedWs2812x
 {
 public:
-    static void send_pixels(uint8_t* pixels, uint8_t* end, uint8_t pin)
+    static void send_pixels(uint8_t* pixels, uint8_t* end, uint8_t pin, const uint8_t* lut)
     {
-        bitbang_send_pixels_800(pixels, end, pin);
+        bitbang_send_pixels_800(pixels, end, pin, lut);
     }
     static const uint32_t ResetTimeUs = 300;
 };
@@ -52,9 +52,9 @@ public:
 class NeoEspBitBangSpeedSk6812
 {
 public:
-    static void send_pixels(uint8_t* pixels, uint8_t* end, uint8_t pin)
+    static void send_pixels(uint8_t* pixels, uint8_t* end, uint8_t pin, const uint8_t* lut)
     {
-        bitbang_send_pixels_800(pixels, end, pin);
+        bitbang_send_pixels_800(pixels, end, pin, lut);
     }
     static const uint32_t ResetTimeUs = 80;
 };
@@ -62,9 +62,9 @@ public:
 class NeoEspBitBangSpeed800Kbps
 {
 public:
-    static void send_pixels(uint8_t* pixels, uint8_t* end, uint8_t pin)
+    static void send_pixels(uint8_t* pixels, uint8_t* end, uint8_t pin, const uint8_t* lut)
     {
-        bitbang_send_pixels_800(pixels, end, pin);
+        bitbang_send_pixels_800(pixels, end, pin, lut);
     }
     static const uint32_t ResetTimeUs = 50; 
 };
@@ -72,9 +72,9 @@ public:
 class NeoEspBitBangSpeed400Kbps
 {
 public:
-    static void send_pixels(uint8_t* pixels, uint8_t* end, uint8_t pin)
+    static void send_pixels(uint8_t* pixels, uint8_t* end, uint8_t pin, const uint8_t* lut)
     {
-        bitbang_send_pixels_400(pixels, end, pin);
+        bitbang_send_pixels_400(pixels, end, pin, lut);
     }
     static const uint32_t ResetTimeUs = 50;
 };
@@ -83,6 +83,7 @@ template<typename T_SPEED> class NeoEspBitBangMethodBase
 {
 public:
     NeoEspBitBangMethodBase(uint8_t pin, uint16_t pixelCount, size_t elementSize) :
+        _outputLut(nullptr),
         _pin(pin)
     {
         pinMode(pin, OUTPUT);
@@ -136,7 +137,7 @@ public:
         noInterrupts(); 
 #endif
 
-        T_SPEED::send_pixels(_pixels, _pixels + _sizePixels, _pin);
+        T_SPEED::send_pixels(_pixels, _pixels + _sizePixels, _pin, _outputLut);
 		
 #if defined(ARDUINO_ARCH_ESP32)
         portEXIT_CRITICAL(&updateMux);
@@ -158,10 +159,16 @@ public:
         return _sizePixels;
     };
 
+    void SetOutputLut(const uint8_t* lut)
+    {
+        _outputLut = lut;
+    };
+
 private:
     uint32_t _endTime;       // Latch timing reference
     size_t    _sizePixels;   // Size of '_pixels' buffer below
     uint8_t* _pixels;        // Holds LED color values
+    const uint8_t* _outputLut; // Optional table applied to every byte sent
     uint8_t _pin;            // output pin number
 };
 
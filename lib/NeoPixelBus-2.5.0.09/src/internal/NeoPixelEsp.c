@@ -52,11 +52,11 @@ static inline uint32_t _getCycleCount(void)
 #define CYCLES_400_T1H  (F_CPU /  833333)
 #define CYCLES_400      (F_CPU /  400000) 
 
-void ICACHE_RAM_ATTR bitbang_send_pixels_800(uint8_t* pixels, uint8_t* end, uint8_t pin)
+void ICACHE_RAM_ATTR bitbang_send_pixels_800(uint8_t* pixels, uint8_t* end, uint8_t pin, const uint8_t* lut)
 {
     const uint32_t pinRegister = _BV(pin);
     uint8_t mask = 0x80;
-    uint8_t subpix = *pixels++;
+    uint8_t subpix = (lut) ? lut[*pixels++] : *pixels++;
     uint32_t cyclesStart = 0; // trigger emediately
 	uint32_t cyclesNext = 0;
 
@@ -104,16 +104,16 @@ void ICACHE_RAM_ATTR bitbang_send_pixels_800(uint8_t* pixels, uint8_t* end, uint
 			}
 			// reset mask to first bit and get the next byte
 			mask = 0x80;
-			subpix = *pixels++;
+			subpix = (lut) ? lut[*pixels++] : *pixels++;
 		}
     } 
 }
 
-void ICACHE_RAM_ATTR bitbang_send_pixels_400(uint8_t* pixels, uint8_t* end, uint8_t pin)
+void ICACHE_RAM_ATTR bitbang_send_pixels_400(uint8_t* pixels, uint8_t* end, uint8_t pin, const uint8_t* lut)
 {
 	const uint32_t pinRegister = _BV(pin);
 	uint8_t mask = 0x80;
-	uint8_t subpix = *pixels++;
+	uint8_t subpix = (lut) ? lut[*pixels++] : *pixels++;
 	uint32_t cyclesStart = 0; // trigger emediately
 	uint32_t cyclesNext = 0;
 
@@ -161,7 +161,7 @@ void ICACHE_RAM_ATTR bitbang_send_pixels_400(uint8_t* pixels, uint8_t* end, uint
 			}
 			// reset mask to first bit and get the next byte
 			mask = 0x80;
-			subpix = *pixels++;
+			subpix = (lut) ? lut[*pixels++] : *pixels++;
 		}
 	}
 }
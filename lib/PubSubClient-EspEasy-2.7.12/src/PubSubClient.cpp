@@ -118,6 +118,17 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
 }
 
 boolean PubSubClient::connect(const char *id, const char *user, const char *pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage, boolean cleanSession) {
+    if (!beginConnect(id,user,pass,willTopic,willQos,willRetain,willMessage,cleanSession)) {
+        return false;
+    }
+    while (_state == MQTT_CONNECTING) {
+        delay(0);  // Prevent watchdog crashes
+        connectCheck();
+    }
+    return (_state == MQTT_CONNECTED);
+}
+
+boolean PubSubClient::beginConnect(const char *id, const char *user, const char *pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage, boolean cleanSession) {
     if (!connected()) {
         int result = 0;
 
@@ -194,30 +205,8 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
             write(MQTTCONNECT,buffer,length-MQTT_MAX_HEADER_SIZE);
 
             lastInActivity = lastOutActivity = millis();
-
-            while (!_client->available()) {
-                delay(0);  // Prevent watchdog crashes
-                unsigned long t = millis();
-                if (t-lastInActivity >= ((int32_t) MQTT_SOCKET_TIMEOUT*1000UL)) {
-                    _state = MQTT_CONNECTION_TIMEOUT;
-                    _client->stop();
-                    return false;
-                }
-            }
-            uint8_t llen;
-            uint16_t len = readPacket(&llen);
-
-            if (len == 4) {
-                if (buffer[3] == 0) {
-                    lastInActivity = millis();
-                    pingOutstanding = false;
-                    _state = MQTT_CONNECTED;
-                    return true;
-                } else {
-                    _state = buffer[3];
-                }
-            }
-            _client->stop();
+            _state = MQTT_CONNECTING;
+            return true;
         } else {
             _state = MQTT_CONNECT_FAILED;
         }
@@ -226,6 +215,39 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
     return true;
 }
 
+boolean PubSubClient::connectCheck() {
+    if (_state != MQTT_CONNECTING) {
+        return (_state == MQTT_CONNECTED);
+    }
+    if (!_client->available()) {
+        unsigned long t = millis();
+        if (t-lastInActivity >= ((int32_t) MQTT_SOCKET_TIMEOUT*1000UL)) {
+            _state = MQTT_CONNECTION_TIMEOUT;
+            _client->stop();
+        } else if (!_client->connected()) {
+            _state = MQTT_CONNECTION_LOST;
+        }
+        return false;
+    }
+    uint8_t llen;
+    uint16_t len = readPacket(&llen);
+
+    if (len == 4) {
+        if (buffer[3] == 0) {
+            lastInActivity = millis();
+            pingOutstanding = false;
+            _state = MQTT_CONNECTED;
+            return true;
+        } else {
+            _state = buffer[3];
+        }
+    } else {
+        _state = MQTT_CONNECT_FAILED;
+    }
+    _client->stop();
+    return false;
+}
+
 // reads a byte into result
 boolean PubSubClient::readByte(uint8_t * result) {
    if (_client == nullptr) {
@@ -19,11 +19,18 @@
 
 #include "TasmotaModbus.h"
 
-TasmotaModbus::TasmotaModbus(int receive_pin, int transmit_pin) : TasmotaSerial(receive_pin, transmit_pin, 1)
+TasmotaModbus::TasmotaModbus(int receive_pin, int transmit_pin, int buffer_size) : TasmotaSerial(receive_pin, transmit_pin, 1, 0, buffer_size)
 {
   mb_address = 0;
 }
 
+TasmotaModbus::~TasmotaModbus()
+{
+  if (mb_buffer) {
+    free(mb_buffer);
+  }
+}
+
 uint16_t CalculateCRC(uint8_t *frame, uint8_t num)
 {
   uint16_t crc = 0xFFFF;
@@ -46,6 +53,7 @@ int TasmotaModbus::Begin(long speed, int stop_bits)
 {
   int result = 0;
 
+  mb_baudrate = speed;
   if (begin(speed, stop_bits)) {
     result = 1;
     if (hardwareSerial()) { result = 2; }
@@ -160,3 +168,132 @@ uint8_t TasmotaModbus::Receive32BitRegister(float *value)
 
   return error;
 }
+
+/*********************************************************************************************\
+ * Transaction scheduler
+\*********************************************************************************************/
+
+int TasmotaModbus::AddRegisters(uint8_t device_address, uint8_t function_code, const uint16_t *addresses, uint32_t count, uint32_t width, uint32_t interval)
+{
+  // Returns index of first added block or -1 if out of blocks or memory
+  int first = mb_blocks;
+  uint32_t index = 0;
+  while (index < count) {
+    if (mb_blocks >= TM_MODBUS_MAX_BLOCKS) { return -1; }
+    uint16_t start = addresses[index];
+    uint16_t end = start + width;           // End of registers read
+    index++;
+    while ((index < count) &&
+           (addresses[index] >= end) &&
+           (addresses[index] - end <= TM_MODBUS_MAX_GAP) &&
+           (addresses[index] + width - start <= TM_MODBUS_MAX_REGISTERS)) {
+      end = addresses[index] + width;
+      index++;
+    }
+
+    TasmotaModbusBlock *block = &mb_block_list[mb_blocks];
+    block->last = millis() - interval;
+    block->start_address = start;
+    block->interval = interval;
+    block->device_address = device_address;
+    block->function_code = function_code;
+    block->register_count = end - start;
+    block->disabled = false;
+
+    uint16_t size = (block->register_count * 2) + 5;  // Id Cc Sz Registers Crc
+    if (size > mb_buffer_size) {
+      uint8_t *buffer = (uint8_t*)realloc(mb_buffer, size);
+      if (!buffer) { return -1; }
+      mb_buffer = buffer;
+      mb_buffer_size = size;
+    }
+    mb_blocks++;
+  }
+  return first;
+}
+
+void TasmotaModbus::DisableBlock(uint32_t block)
+{
+  if (block < mb_blocks) {
+    mb_block_list[block].disabled = true;
+  }
+}
+
+int TasmotaModbus::Poll(void)
+{
+  if (!mb_blocks) { return -1; }
+
+  if (mb_block < 0) {
+    // Idle so send next due block in round robin order
+    uint32_t now = millis();
+    for (uint32_t i = 1; i <= mb_blocks; i++) {
+      uint32_t index = (mb_done + i) % mb_blocks;
+      TasmotaModbusBlock *block = &mb_block_list[index];
+      if (block->disabled || (now - block->last < block->interval)) { continue; }
+
+      Send(block->device_address, block->function_code, block->start_address, block->register_count);
+      block->last = now;
+      mb_block = index;
+      mb_rx_len = 0;
+      mb_sent = now;
+      // 8 bytes request and 5 bytes of reply plus registers at 11 bits per byte
+      mb_timeout = TM_MODBUS_TIMEOUT + ((13 + (block->register_count * 2)) * 11000) / mb_baudrate;
+      break;
+    }
+    return -1;
+  }
+
+  while ((available() > 0) && (mb_rx_len < mb_buffer_size)) {
+    uint8_t data = (uint8_t)read();
+    if (!mb_rx_len && (data != mb_address)) { continue; }  // Skip leading data as provided by hardware serial
+    mb_buffer[mb_rx_len++] = data;
+  }
+
+  uint16_t expected = 0;
+  if (mb_rx_len >= 3) {
+    expected = (mb_buffer[1] & 0x80) ? 5 : mb_buffer[2] + 5;
+    if (expected > mb_buffer_size) { expected = mb_buffer_size; }
+  }
+  if (!expected || (mb_rx_len < expected)) {
+    if (millis() - mb_sent < mb_timeout) { return -1; }
+    mb_error = 7;                           // 7 = Not enough data
+  } else {
+    uint16_t crc = (mb_buffer[expected -1] << 8) | mb_buffer[expected -2];
+    if (CalculateCRC(mb_buffer, expected -2) != crc) {
+      mb_error = 9;                         // 9 = crc error
+    } else if (mb_buffer[1] & 0x80) {
+      mb_error = mb_buffer[2];              // Exception code
+    } else {
+      mb_error = 0;
+    }
+  }
+  mb_len = mb_rx_len;
+  mb_done = mb_block;
+  mb_block = -1;
+  return mb_done;
+}
+
+bool TasmotaModbus::Get16BitRegister(uint16_t address, uint16_t *value)
+{
+  if ((mb_done < 0) || mb_error) { return false; }
+  TasmotaModbusBlock *block = &mb_block_list[mb_done];
+  if ((address < block->start_address) || (address +1 > block->start_address + block->register_count)) { return false; }
+
+  uint8_t *data = &mb_buffer[3 + (address - block->start_address) * 2];
+  *value = (data[0] << 8) | data[1];
+  return true;
+}
+
+bool TasmotaModbus::Get32BitRegister(uint16_t address, float *value)
+{
+  if ((mb_done < 0) || mb_error) { return false; }
+  TasmotaModbusBlock *block = &mb_block_list[mb_done];
+  if ((address < block->start_address) || (address +2 > block->start_address + block->register_count)) { return false; }
+
+  uint8_t *data = &mb_buffer[3 + (address - block->start_address) * 2];
+  ((uint8_t*)value)[3] = data[0];
+  ((uint8_t*)value)[2] = data[1];
+  ((uint8_t*)value)[1] = data[2];
+  ((uint8_t*)value)[0] = data[3];
+  return true;
+}
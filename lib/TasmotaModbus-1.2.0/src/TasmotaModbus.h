@@ -24,11 +24,25 @@
 #include <TasmotaSerial.h>
 
 #define TM_MODBUS_BAUDRATE           9600   // Default baudrate
+#define TM_MODBUS_MAX_BLOCKS         8      // Scheduled register blocks per bus
+#define TM_MODBUS_MAX_REGISTERS      64     // Registers per coalesced block
+#define TM_MODBUS_MAX_GAP            8      // Unused registers read to join two blocks
+#define TM_MODBUS_TIMEOUT            100    // Reply timeout in mSeconds on top of transmission time
+
+struct TasmotaModbusBlock {
+  uint32_t last;                            // millis() of last request
+  uint16_t start_address;
+  uint16_t interval;                        // mSeconds between requests or 0 for every scan
+  uint8_t device_address;
+  uint8_t function_code;
+  uint8_t register_count;
+  bool disabled;
+};
 
 class TasmotaModbus : public TasmotaSerial {
   public:
-    TasmotaModbus(int receive_pin, int transmit_pin);
-    virtual ~TasmotaModbus() {}
+    TasmotaModbus(int receive_pin, int transmit_pin, int buffer_size = TM_SERIAL_BUFFER_SIZE);
+    virtual ~TasmotaModbus();
 
     int Begin(long speed = TM_MODBUS_BAUDRATE, int stop_bits = 1);
 
@@ -56,7 +70,34 @@ class TasmotaModbus : public TasmotaSerial {
 
     uint8_t ReceiveCount(void) { return mb_len; }
 
+    /* Transaction scheduler
+     * AddRegisters() coalesces a sorted list of register addresses, each holding width registers,
+     * into blocks read with one request. Poll() is called from the loop, sends the next due block as
+     * soon as the previous reply completed and returns the index of a block whose reply is received
+     * or -1. Values of the received block are read by register address with Get16BitRegister() and
+     * Get32BitRegister() while PollError() reports the return code of the reply.
+     */
+    int AddRegisters(uint8_t device_address, uint8_t function_code, const uint16_t *addresses, uint32_t count, uint32_t width, uint32_t interval = 0);
+    int Poll(void);
+    uint8_t PollError(void) const { return mb_error; }
+    void DisableBlock(uint32_t block);
+    const TasmotaModbusBlock *Block(uint32_t block) const { return (block < mb_blocks) ? &mb_block_list[block] : nullptr; }
+    uint8_t *PollBuffer(void) const { return mb_buffer; }
+    bool Get16BitRegister(uint16_t address, uint16_t *value);
+    bool Get32BitRegister(uint16_t address, float *value);
+
   private:
+    TasmotaModbusBlock mb_block_list[TM_MODBUS_MAX_BLOCKS];
+    uint8_t *mb_buffer = nullptr;
+    uint32_t mb_sent;
+    uint32_t mb_timeout;
+    uint32_t mb_baudrate = TM_MODBUS_BAUDRATE;
+    uint16_t mb_buffer_size = 0;
+    uint16_t mb_rx_len;
+    int8_t mb_block = -1;                 // Block waiting for reply
+    int8_t mb_done = -1;                  // Block of last received reply
+    uint8_t mb_blocks = 0;
+    uint8_t mb_error = 0;
     uint8_t mb_address;
     uint8_t mb_len;
 };
@@ -83,10 +83,27 @@ static void (*ISRList[16])() = {
 
 #else  // ESP32
 
-  static int tasmota_serial_index = 2;  // Allow UART2 and UART1 only
+  static uint32_t tasmota_serial_uarts = 0;  // Bitmask of UART2 and UART1 in use, keep UART0 for debugging
 
 #endif  // ESP8266
 
+static TasmotaSerial *tms_instance_list[TM_SERIAL_MAX_INSTANCES];
+
+TasmotaSerial *TasmotaSerial::getInstance(uint32_t index)
+{
+  return (index < TM_SERIAL_MAX_INSTANCES) ? tms_instance_list[index] : nullptr;
+}
+
+void TasmotaSerial::addInstance(void)
+{
+  for (uint32_t i = 0; i < TM_SERIAL_MAX_INSTANCES; i++) {
+    if (!tms_instance_list[i]) {
+      tms_instance_list[i] = this;
+      break;
+    }
+  }
+}
+
 TasmotaSerial::TasmotaSerial(int receive_pin, int transmit_pin, int hardware_fallback, int nwmode, int buffer_size)
 {
   m_valid = false;
@@ -116,6 +133,7 @@ TasmotaSerial::TasmotaSerial(int receive_pin, int transmit_pin, int hardware_fal
       // Use getCycleCount() loop to get as exact timing as possible
       m_bit_time = ESP.getCpuFreqMHz() * 1000000 / TM_SERIAL_BAUDRATE;
       m_bit_start_time = m_bit_time + m_bit_time/3 - 500; // pre-compute first wait
+      m_rx_mask = 1 << m_rx_pin;
       pinMode(m_rx_pin, INPUT);
       tms_obj_list[m_rx_pin] = this;
 #if defined(ARDUINO_ESP8266_RELEASE_2_3_0) || defined(ARDUINO_ESP8266_RELEASE_2_4_2) || defined(ARDUINO_ESP8266_RELEASE_2_5_2)
@@ -134,10 +152,16 @@ TasmotaSerial::TasmotaSerial(int receive_pin, int transmit_pin, int hardware_fal
   m_hardserial = true;
 #endif  // ESP8266 - ESP32
   m_valid = true;
+  addInstance();
 }
 
 TasmotaSerial::~TasmotaSerial()
 {
+  for (uint32_t i = 0; i < TM_SERIAL_MAX_INSTANCES; i++) {
+    if (tms_instance_list[i] == this) {
+      tms_instance_list[i] = nullptr;
+    }
+  }
 #ifdef ESP8266
   if (!m_hardserial) {
     if (m_rx_pin > -1) {
@@ -148,7 +172,14 @@ TasmotaSerial::~TasmotaSerial()
       }
     }
   }
-#endif  // ESP8266
+#else  // ESP32
+  if (m_uart_queue) {
+    uart_driver_delete((uart_port_t)m_uart);
+  }
+  if (m_uart) {
+    tasmota_serial_uarts &= ~(1 << m_uart);
+  }
+#endif  // ESP8266 - ESP32
 }
 
 bool TasmotaSerial::isValidGPIOpin(int pin)
@@ -161,6 +192,11 @@ bool TasmotaSerial::begin(long speed, int stop_bits) {
   if (m_hardserial) {
 #ifdef ESP8266
     Serial.flush();
+#ifndef ARDUINO_ESP8266_RELEASE_2_3_0
+    if (serial_buffer_size > 256) {
+      Serial.setRxBufferSize(serial_buffer_size);
+    }
+#endif
     if (2 == m_stop_bits) {
       Serial.begin(speed, SERIAL_8N2);
     } else {
@@ -170,19 +206,36 @@ bool TasmotaSerial::begin(long speed, int stop_bits) {
       Serial.swap();
     }
 #else  // ESP32
-    if (tasmota_serial_index > 0) {  // We only support UART1 and UART2 and keep UART0 for debugging
-      m_uart = tasmota_serial_index;
-      tasmota_serial_index--;
-      TSerial = new HardwareSerial(m_uart);
-      if (serial_buffer_size > 256) {
-        TSerial->setRxBufferSize(serial_buffer_size);
-      }
-      if (2 == m_stop_bits) {
-        TSerial->begin(speed, SERIAL_8N2, m_rx_pin, m_tx_pin);
-      } else {
-        TSerial->begin(speed, SERIAL_8N1, m_rx_pin, m_tx_pin);
+    if (!m_uart) {
+      for (uint32_t uart = 2; uart > 0; uart--) {  // We only support UART1 and UART2 and keep UART0 for debugging
+        if (!(tasmota_serial_uarts & (1 << uart))) {
+          tasmota_serial_uarts |= (1 << uart);
+          m_uart = uart;
+          break;
+        }
       }
-    } else {
+    }
+    if (!m_uart) {
+      m_valid = false;
+      return m_valid;
+    }
+    if (m_uart_queue) {              // Restart with new speed
+      uart_driver_delete((uart_port_t)m_uart);
+      m_uart_queue = nullptr;
+      m_peek = -1;
+    }
+    uart_config_t uart_config;
+    memset(&uart_config, 0, sizeof(uart_config));
+    uart_config.baud_rate = speed;
+    uart_config.data_bits = UART_DATA_8_BITS;
+    uart_config.parity = UART_PARITY_DISABLE;
+    uart_config.stop_bits = (2 == m_stop_bits) ? UART_STOP_BITS_2 : UART_STOP_BITS_1;
+    uart_config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    uint32_t ring_size = (serial_buffer_size > TM_SERIAL_UART_BUFFER_SIZE) ? serial_buffer_size : TM_SERIAL_UART_BUFFER_SIZE;
+    if ((uart_param_config((uart_port_t)m_uart, &uart_config) != ESP_OK) ||
+        (uart_set_pin((uart_port_t)m_uart, m_tx_pin, m_rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK) ||
+        (uart_driver_install((uart_port_t)m_uart, ring_size, 0, TM_SERIAL_UART_QUEUE_SIZE, &m_uart_queue, 0) != ESP_OK)) {
+      m_uart_queue = nullptr;
       m_valid = false;
     }
 //    Serial.printf("TSR: Using UART%d\n", m_uart);
@@ -209,12 +262,26 @@ bool TasmotaSerial::hardwareSerial() {
 #endif
 }
 
+#ifdef ESP32
+void TasmotaSerial::uartEvents(void) {
+  // Drain the driver event queue counting lost data, the driver itself recovers from both
+  uart_event_t event;
+  while (xQueueReceive(m_uart_queue, &event, 0)) {
+    if ((UART_FIFO_OVF == event.type) || (UART_BUFFER_FULL == event.type)) {
+      m_overflow++;
+    }
+  }
+}
+#endif  // ESP32
+
 void TasmotaSerial::flush() {
   if (m_hardserial) {
 #ifdef ESP8266
     Serial.flush();
 #else
-    TSerial->flush();
+    if (m_uart_queue) {
+      uart_wait_tx_done((uart_port_t)m_uart, portMAX_DELAY);
+    }
 #endif
   } else {
     m_in_pos = m_out_pos = 0;
@@ -226,7 +293,10 @@ int TasmotaSerial::peek() {
 #ifdef ESP8266
     return Serial.peek();
 #else
-    return TSerial->peek();
+    if (m_peek < 0) {
+      m_peek = read();
+    }
+    return m_peek;
 #endif
   } else {
     if ((-1 == m_rx_pin) || (m_in_pos == m_out_pos)) return -1;
@@ -240,23 +310,69 @@ int TasmotaSerial::read()
 #ifdef ESP8266
     return Serial.read();
 #else
-    return TSerial->read();
+    if (m_peek >= 0) {
+      int ch = m_peek;
+      m_peek = -1;
+      return ch;
+    }
+    uint8_t ch;
+    if (!m_uart_queue || (uart_read_bytes((uart_port_t)m_uart, &ch, 1, 0) != 1)) return -1;
+    return ch;
 #endif
   } else {
     if ((-1 == m_rx_pin) || (m_in_pos == m_out_pos)) return -1;
     uint32_t ch = m_buffer[m_out_pos];
-    m_out_pos = (m_out_pos +1) % serial_buffer_size;
+    uint32_t next = m_out_pos +1;
+    m_out_pos = (next < serial_buffer_size) ? next : 0;
     return ch;
   }
 }
 
+size_t TasmotaSerial::read(uint8_t *buffer, size_t size)
+{
+  if (m_hardserial) {
+#ifdef ESP8266
+    size_t avail = Serial.available();
+    if (size > avail) { size = avail; }
+    return Serial.readBytes(buffer, size);  // No timeout as all bytes are available
+#else
+    size_t count = 0;
+    if (size && (m_peek >= 0)) {
+      buffer[count++] = m_peek;
+      m_peek = -1;
+    }
+    if (!m_uart_queue || (count == size)) return count;
+    int received = uart_read_bytes((uart_port_t)m_uart, buffer + count, size - count, 0);
+    return (received > 0) ? count + received : count;
+#endif
+  } else {
+    if (-1 == m_rx_pin) return 0;
+    size_t count = 0;
+    uint32_t in_pos = m_in_pos;       // Snapshot as the receive interrupt may advance it
+    while ((count < size) && (m_out_pos != in_pos)) {
+      uint32_t end = (in_pos > m_out_pos) ? in_pos : serial_buffer_size;  // Copy up to wrap or write position
+      size_t chunk = end - m_out_pos;
+      if (chunk > size - count) { chunk = size - count; }
+      memcpy(buffer + count, m_buffer + m_out_pos, chunk);
+      count += chunk;
+      uint32_t next = m_out_pos + chunk;
+      m_out_pos = (next < serial_buffer_size) ? next : 0;
+    }
+    return count;
+  }
+}
+
 int TasmotaSerial::available()
 {
   if (m_hardserial) {
 #ifdef ESP8266
     return Serial.available();
 #else
-    return TSerial->available();
+    if (!m_uart_queue) return 0;
+    uartEvents();
+    size_t size = 0;
+    uart_get_buffered_data_len((uart_port_t)m_uart, &size);
+    return size + ((m_peek >= 0) ? 1 : 0);
 #endif
   } else {
     int avail = m_in_pos - m_out_pos;
@@ -265,6 +381,27 @@ int TasmotaSerial::available()
   }
 }
 
+uint32_t TasmotaSerial::getOverflowCount(void)
+{
+#if defined(ESP8266) && !defined(ARDUINO_ESP8266_RELEASE_2_3_0)
+  if (m_hardserial && Serial.hasOverrun()) {
+    m_overflow++;                     // Hardware only reports that bytes were lost since last call
+  }
+#endif
+#ifdef ESP32
+  if (m_uart_queue) {
+    uartEvents();
+  }
+#endif
+  return m_overflow;
+}
+
+#ifdef ESP8266
+#define TM_SERIAL_RX_LEVEL (GPI & m_rx_mask)   // Direct register read avoiding a call per sampled bit
+#else
+#define TM_SERIAL_RX_LEVEL digitalRead(m_rx_pin)
+#endif
+
 #ifdef TM_SERIAL_USE_IRAM
 #define TM_SERIAL_WAIT_SND { while (ESP.getCycleCount() < (wait + start)) if (!m_high_speed) optimistic_yield(1); wait += m_bit_time; } // Watchdog timeouts
 #define TM_SERIAL_WAIT_SND_FAST { while (ESP.getCycleCount() < (wait + start)); wait += m_bit_time; }
@@ -305,7 +442,8 @@ size_t TasmotaSerial::write(uint8_t b)
 #ifdef ESP8266
     return Serial.write(b);
 #else
-    return TSerial->write(b);
+    if (!m_uart_queue) return 0;
+    return (1 == uart_write_bytes((uart_port_t)m_uart, (const char*)&b, 1)) ? 1 : 0;
 #endif
   } else {
     if (-1 == m_tx_pin) return 0;
@@ -355,13 +493,17 @@ void TasmotaSerial::rxRead()
       for (uint32_t i = 0; i < 8; i++) {
         TM_SERIAL_WAIT_RCV;
         rec >>= 1;
-        if (digitalRead(m_rx_pin)) rec |= 0x80;
+        if (TM_SERIAL_RX_LEVEL) rec |= 0x80;
       }
       // Store the received value in the buffer unless we have an overflow
-      uint32_t next = (m_in_pos+1) % serial_buffer_size;
-      if (next != (int)m_out_pos) {
+      m_rx_count++;
+      uint32_t next = m_in_pos +1;
+      if (next >= serial_buffer_size) { next = 0; }  // No division in interrupt
+      if (next != m_out_pos) {
         m_buffer[m_in_pos] = rec;
         m_in_pos = next;
+      } else {
+        m_overflow++;
       }
 
       TM_SERIAL_WAIT_RCV_LOOP;    // wait for stop bit
@@ -377,7 +519,7 @@ void TasmotaSerial::rxRead()
       for (uint32_t i = 0; i < 12; i++) {
         TM_SERIAL_WAIT_RCV_LOOP;    // wait for 1/4 bits
         wait += m_bit_time / 4;
-        if (!digitalRead(m_rx_pin)) {
+        if (!TM_SERIAL_RX_LEVEL) {
           // this is the start bit of the next byte
           wait += m_bit_time;   // we have advanced in the first 1/4 of bit, and already added 1/4 of bit so we're roughly centered. Just skip start bit.
           start_of_next_byte = true;
@@ -390,6 +532,7 @@ void TasmotaSerial::rxRead()
         break;   // exit now if no sign of next byte
       }
     }
+    m_isr_cycles += ESP.getCycleCount() - start;
     // Must clear this bit in the interrupt register,
     // it gets set even when interrupts are disabled
     GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, 1 << m_rx_pin);
@@ -401,7 +544,7 @@ void TasmotaSerial::rxRead()
 
     GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, 1 << m_rx_pin);
 
-    level = digitalRead(m_rx_pin);
+    level = TM_SERIAL_RX_LEVEL;
 
     if (!level && !ss_index) {
       // start condition
@@ -422,10 +565,13 @@ void TasmotaSerial::rxRead()
           ss_byte |= (1 << i);
         }
         //stobyte(0,ssp->ss_byte>>1);
-        uint32_t next = (m_in_pos + 1) % serial_buffer_size;
-        if (next != (uint32_t)m_out_pos) {
+        uint32_t next = m_in_pos +1;
+        if (next >= serial_buffer_size) { next = 0; }
+        if (next != m_out_pos) {
           m_buffer[m_in_pos] = ss_byte >> 1;
           m_in_pos = next;
+        } else {
+          m_overflow++;
         }
 
         ss_bstart = ESP.getCycleCount() - (m_bit_time / 4);
@@ -436,10 +582,13 @@ void TasmotaSerial::rxRead()
       if (diff >= LASTBIT) {
         // bit zero was 0,
         //stobyte(0,ssp->ss_byte>>1);
-        uint32_t next = (m_in_pos + 1) % serial_buffer_size;
-        if (next != (uint32_t)m_out_pos) {
+        uint32_t next = m_in_pos +1;
+        if (next >= serial_buffer_size) { next = 0; }
+        if (next != m_out_pos) {
           m_buffer[m_in_pos] = ss_byte >> 1;
           m_in_pos = next;
+        } else {
+          m_overflow++;
         }
         ss_byte = 0;
         ss_index = 0;
@@ -20,13 +20,24 @@
 #ifndef TasmotaSerial_h
 #define TasmotaSerial_h
 /*********************************************************************************************\
- * TasmotaSerial supports up to 115200 baud with default buffer size of 64 bytes using optional no iram
+ * TasmotaSerial supports up to 115200 baud with default buffer size of 128 bytes using optional no iram
+ *
+ * On ESP32 all instances use the IDF UART driver with an interrupt filled receive ring buffer
  *
  * Based on EspSoftwareSerial v3.4.3 by Peter Lerup (https://github.com/plerup/espsoftwareserial)
 \*********************************************************************************************/
 
 #define TM_SERIAL_BAUDRATE           9600   // Default baudrate
-#define TM_SERIAL_BUFFER_SIZE        64     // Receive buffer size
+#ifndef TM_SERIAL_BUFFER_SIZE
+#define TM_SERIAL_BUFFER_SIZE        128    // Receive buffer size
+#endif
+#define TM_SERIAL_MAX_INSTANCES      8      // Instances reported by getInstance()
+#ifdef ESP32
+#ifndef TM_SERIAL_UART_BUFFER_SIZE
+#define TM_SERIAL_UART_BUFFER_SIZE   256    // Minimal UART driver receive ring size, must be larger than the 128 bytes hardware fifo
+#endif
+#define TM_SERIAL_UART_QUEUE_SIZE    8      // UART driver event queue size
+#endif
 
 #include <core_version.h>                   // Arduino_Esp8266 version information (ARDUINO_ESP8266_RELEASE and ARDUINO_ESP8266_RELEASE_2_3_0)
 #ifndef ARDUINO_ESP8266_RELEASE_2_3_0
@@ -37,7 +48,7 @@
 #include <Stream.h>
 
 #ifdef ESP32
-#include <HardwareSerial.h>
+#include <driver/uart.h>
 #endif
 
 class TasmotaSerial : public Stream {
@@ -52,12 +63,22 @@ class TasmotaSerial : public Stream {
 
     virtual size_t write(uint8_t byte);
     virtual int read();
+    size_t read(uint8_t *buffer, size_t size);  // Read up to size bytes already received without waiting
     virtual int available();
     virtual void flush();
 
     void rxRead();
 
     uint32_t getLoopReadMetric(void) const { return m_bit_follow_metric; }
+    uint32_t getIsrCycles(void) const { return m_isr_cycles; }  // CPU cycles spent in the software serial receive interrupt
+    uint32_t getRxCount(void) const { return m_rx_count; }      // Bytes received by the software serial receive interrupt
+    void resetIsrMetric(void) { m_isr_cycles = 0; m_rx_count = 0; }
+    uint32_t getOverflowCount(void);  // Bytes or hardware overruns lost because the receive buffer was full
+    uint32_t getBufferSize(void) const { return serial_buffer_size; }
+    int getRxPin(void) const { return m_rx_pin; }
+    int getTxPin(void) const { return m_tx_pin; }
+
+    static TasmotaSerial *getInstance(uint32_t index);
 
 #ifdef ESP32
     uint32_t getUart(void) const { return m_uart; }
@@ -68,6 +89,10 @@ class TasmotaSerial : public Stream {
   private:
     bool isValidGPIOpin(int pin);
     size_t txWrite(uint8_t byte);
+    void addInstance(void);
+#ifdef ESP32
+    void uartEvents(void);
+#endif
 
     // Member variables
     int m_rx_pin;
@@ -79,8 +104,12 @@ class TasmotaSerial : public Stream {
     uint32_t m_bit_time;
     uint32_t m_bit_start_time;
     uint32_t m_bit_follow_metric = 0;
+    volatile uint32_t m_overflow = 0;
+    volatile uint32_t m_isr_cycles = 0;
+    volatile uint32_t m_rx_count = 0;
     uint32_t m_in_pos;
     uint32_t m_out_pos;
+    uint32_t m_rx_mask;
     uint32_t serial_buffer_size;
     bool m_valid;
     bool m_nwmode;
@@ -93,8 +122,9 @@ class TasmotaSerial : public Stream {
     void _fast_write(uint8_t b);      // IRAM minimized version
 
 #ifdef ESP32
-    HardwareSerial *TSerial;
+    QueueHandle_t m_uart_queue = nullptr;
     int m_uart = 0;
+    int m_peek = -1;                  // The UART driver can not peek so keep the byte read ahead
 #endif
 
 };
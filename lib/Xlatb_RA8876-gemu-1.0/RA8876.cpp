@@ -947,6 +947,39 @@ void RA8876::pushColors(uint16_t *data, uint8_t len, boolean first) {
   SPI.endTransaction();
 }
 
+// the area must be on the display
+bool RA8876::pushColorRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *data) {
+  SPI.beginTransaction(m_spiSettings);
+
+  writeReg16(RA8876_REG_AWUL_X0, x);
+  writeReg16(RA8876_REG_AWUL_Y0, y);
+  writeReg16(RA8876_REG_AW_WTH0, w);
+  writeReg16(RA8876_REG_AW_HT0, h);
+  writeReg16(RA8876_REG_CURH0, x);
+  writeReg16(RA8876_REG_CURV0, y);
+  writeCmd(RA8876_REG_MRWDP);
+
+  // one data write cycle for all pixels instead of one per byte
+  RA8876_CS_LOW
+  SPI.transfer(RA8876_DATA_WRITE);
+  uint32_t pixels = w * h;
+  while (pixels--) {
+    uint16_t color = *data++;
+    SPI.transfer(color & 0xff);
+    SPI.transfer(color >> 8);
+  }
+  RA8876_CS_HIGH
+
+  // back to the full screen
+  writeReg16(RA8876_REG_AWUL_X0, 0);
+  writeReg16(RA8876_REG_AWUL_Y0, 0);
+  writeReg16(RA8876_REG_AW_WTH0, m_width);
+  writeReg16(RA8876_REG_AW_HT0, m_height);
+
+  SPI.endTransaction();
+  return true;
+}
+
 void RA8876::drawPixel(int16_t x, int16_t y, uint16_t color) {
   //Serial.println("drawPixel");
   //Serial.println(readStatus());
@@ -473,6 +473,7 @@ class RA8876 : public Renderer {
 
   void setAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
   void pushColors(uint16_t *data, uint8_t len, boolean first);
+  bool pushColorRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *data);
 
   // Text
   void selectInternalFont(enum FontSize size, enum FontEncoding enc = RA8876_FONT_ENCODING_8859_1);
@@ -31,14 +31,62 @@ extern uint8_t *buffer;
 
 Epd::Epd(int16_t width, int16_t height) :
 Paint(width,height) {
+  prev_first = 0;
+  prev_last = EPD_HEIGHT - 1;
+  forced_full = 0;
 }
 
 void Epd::DisplayOnff(int8_t on) {
 }
 
 void Epd::Updateframe() {
-  SetFrameMemory(buffer, 0, 0, EPD_WIDTH,EPD_HEIGHT);
+  // Refresh from Loop() so several drawing commands share one refresh
+  update_pending = 1;
+}
+
+void Epd::Loop(void) {
+  if (update_pending && !Busy()) {
+    RefreshFrame();
+  }
+}
+
+/**
+ *  @brief: send the changed rows and refresh the display
+ *          the panel swaps between 2 frame memories on each refresh so the rows
+ *          changed by the previous refresh are sent again with the new ones
+ */
+void Epd::RefreshFrame(void) {
+  update_pending = 0;
+  WaitUntilReady();
+  uint16_t first, last;
+  if (!DirtyRows(EPD_HEIGHT, EPD_WIDTH / 8, &first, &last)) { return; }
+
+  if (forced_full) {
+    SetLut(lut_partial_update);
+    forced_full = 0;
+  }
+  bool full = (this->lut == lut_full_update);
+  if (!full && (partial_count >= EPD_PARTIAL_MAX)) {
+    SetLut(lut_full_update);
+    forced_full = 1;
+    full = true;
+  }
+
+  if (full) {
+    SetFrameMemory(buffer, 0, 0, EPD_WIDTH, EPD_HEIGHT);
+    prev_first = 0;
+    prev_last = EPD_HEIGHT - 1;
+    partial_count = 0;
+  } else {
+    uint16_t y0 = (prev_first < first) ? prev_first : first;
+    uint16_t y1 = (prev_last > last) ? prev_last : last;
+    SetFrameMemory(buffer + y0 * (EPD_WIDTH / 8), 0, y0, EPD_WIDTH, y1 - y0 + 1);
+    prev_first = first;
+    prev_last = last;
+    partial_count++;
+  }
   DisplayFrame();
+  SetBusy((full) ? EPD_FULL_MS : EPD_PARTIAL_MS);
   //Serial.printf("update\n");
 }
 
@@ -50,21 +98,23 @@ void Epd::Updateframe() {
 void Epd::DisplayInit(int8_t p,int8_t size,int8_t rot,int8_t font) {
 // ignore update mode
   if (p==DISPLAY_INIT_PARTIAL) {
+    WaitUntilReady();
     Init(lut_partial_update);
     //ClearFrameMemory(0xFF);   // bit set = white, bit reset = black
     DisplayFrame();
-    delay(500);
+    SetBusy(EPD_PARTIAL_MS);
     return;
     //Serial.printf("partial\n");
   } else if (p==DISPLAY_INIT_FULL) {
+    WaitUntilReady();
     Init(lut_full_update);
     //ClearFrameMemory(0xFF);   // bit set = white, bit reset = black
     DisplayFrame();
-    delay(3500);
+    SetBusy(EPD_FULL_MS);
     //Serial.printf("full\n");
     return;
   } else {
-    Updateframe();
+    RefreshFrame();
   }
   setRotation(rot);
   invertDisplay(false);
@@ -85,6 +135,7 @@ int16_t Epd::Begin(int16_t cs,int16_t mosi,int16_t sclk) {
 
 
 void Epd::Init(int8_t p) {
+  WaitUntilReady();
   if (p==DISPLAY_INIT_PARTIAL) {
     Init(lut_partial_update);
   } else {
@@ -92,11 +143,7 @@ void Epd::Init(int8_t p) {
   }
   ClearFrameMemory(0xFF);
   DisplayFrame();
-  if (p==DISPLAY_INIT_PARTIAL) {
-    delay(350);
-  } else {
-    delay(3500);
-  }
+  SetBusy((p==DISPLAY_INIT_PARTIAL) ? EPD_PARTIAL_MS : EPD_FULL_MS);
 }
 
 
@@ -123,6 +170,11 @@ int Epd::Init(const unsigned char* lut) {
 
     /* EPD hardware init start */
     this->lut = lut;
+    forced_full = 0;
+    partial_count = 0;
+    prev_first = 0;
+    prev_last = EPD_HEIGHT - 1;         // Frame memories may differ after init
+    DirtyReset();
     Reset();
     SendCommand(DRIVER_OUTPUT_CONTROL);
     SendData((EPD_HEIGHT - 1) & 0xFF);
@@ -36,6 +36,9 @@
 //#define EPD_WIDTH       296
 //#define EPD_HEIGHT      128
 
+#define EPD_PARTIAL_MS  350             // Panel busy after a partial refresh
+#define EPD_FULL_MS     3500            // Panel busy after a full refresh
+
 // EPD2IN9 commands
 #define DRIVER_OUTPUT_CONTROL                       0x01
 #define BOOSTER_SOFT_START_CONTROL                  0x0C
@@ -93,8 +96,13 @@ public:
     void DisplayInit(int8_t p,int8_t size,int8_t rot,int8_t font);
     int16_t Begin(int16_t p1,int16_t p2,int16_t p3);
     void Updateframe();
+    void RefreshFrame(void);
+    void Loop(void);
 
 private:
+    uint16_t prev_first;                // Rows written to the other frame memory by the last refresh
+    uint16_t prev_last;
+    uint8_t forced_full;
     unsigned int reset_pin;
     unsigned int dc_pin;
     unsigned int busy_pin;
@@ -46,37 +46,64 @@ void Epd42::DisplayOnff(int8_t on) {
 #define DISPLAY_INIT_FULL 2
 
 void Epd42::Updateframe() {
+  // Refresh from Loop() so several drawing commands share one refresh
+  update_pending = 1;
+}
+
+void Epd42::Loop(void) {
+  if (update_pending && !Busy()) {
+    RefreshFrame();
+  }
+}
+
+/**
+ *  @brief: send the changed rows and refresh the display
+ *          quick refreshes are followed by a full refresh every EPD_PARTIAL_MAX
+ */
+void Epd42::RefreshFrame(void) {
+  update_pending = 0;
+  WaitUntilReady();
+  uint16_t first, last;
+  if (!DirtyRows(EPD_HEIGHT42, EPD_WIDTH42 / 8, &first, &last)) { return; }
+
   //SetFrameMemory(buffer, 0, 0, EPD_WIDTH,EPD_HEIGHT);
-  SetPartialWindow(buffer, 0, 0, width,height,2);
-  if (epd42_mode==DISPLAY_INIT_PARTIAL) {
-    DisplayFrameQuick();
-  } else {
+  SetPartialWindow(buffer + first * (EPD_WIDTH42 / 8), 0, first, EPD_WIDTH42, last - first + 1, 2);
+  bool full = (epd42_mode!=DISPLAY_INIT_PARTIAL) || (partial_count >= EPD_PARTIAL_MAX);
+  if (full) {
     DisplayFrame();
+    partial_count = 0;
+  } else {
+    DisplayFrameQuick();
+    partial_count++;
   }
+  SetBusy((full) ? EPD42_FULL_MS : EPD42_PARTIAL_MS);
   //Serial.printf("update\n");
 }
 
 void Epd42::DisplayInit(int8_t p,int8_t size,int8_t rot,int8_t font) {
 // ignore update mode
   if (p==DISPLAY_INIT_PARTIAL) {
+    WaitUntilReady();
     epd42_mode=p;
+    partial_count = 0;
     //Init(lut_partial_update);
     //ClearFrameMemory(0xFF);   // bit set = white, bit reset = black
     DisplayFrameQuick();
-    delay(500);
+    SetBusy(EPD42_PARTIAL_MS);
     return;
     //Serial.printf("partial\n");
   } else if (p==DISPLAY_INIT_FULL) {
+    WaitUntilReady();
     epd42_mode=p;
     //Init(lut_full_update);
     //ClearFrameMemory(0xFF);   // bit set = white, bit reset = black
     DisplayFrame();
-    delay(4500);
+    SetBusy(EPD42_FULL_MS);
     return;
     //Serial.printf("full\n");
   } else {
     epd42_mode=DISPLAY_INIT_FULL;
-    Updateframe();
+    RefreshFrame();
   }
 
   setRotation(rot);
@@ -97,9 +124,10 @@ int16_t Epd42::Begin(int16_t cs,int16_t mosi,int16_t sclk) {
 }
 
 void Epd42::Init(int8_t p) {
+  WaitUntilReady();
   epd42_mode=p;
   DisplayFrame();
-  delay(4000);
+  SetBusy(EPD42_FULL_MS);
 }
 
 int Epd42::Init(void) {
@@ -320,6 +348,8 @@ void Epd42::DisplayFrame(const unsigned char* frame_buffer) {
  * @brief: clear the frame data from the SRAM, this won't refresh the display
  */
 void Epd42::ClearFrame(void) {
+    WaitUntilReady();
+    DirtyReset();                     // Send all rows on the next refresh
     SendCommand(RESOLUTION_SETTING);
     SendData(width >> 8);
     SendData(width & 0xff);
@@ -33,6 +33,9 @@
 #define EPD_WIDTH42       400
 #define EPD_HEIGHT42      300
 
+#define EPD42_PARTIAL_MS  500           // Panel busy after a quick refresh
+#define EPD42_FULL_MS     4500          // Panel busy after a full refresh
+
 // EPD4IN2 commands
 #define PANEL_SETTING                               0x00
 #define POWER_SETTING                               0x01
@@ -115,6 +118,8 @@ public:
     void DisplayInit(int8_t p,int8_t size,int8_t rot,int8_t font);
     int16_t Begin(int16_t p1,int16_t p2,int16_t p3);
     void Updateframe();
+    void RefreshFrame(void);
+    void Loop(void);
 
 private:
   void fastSPIwrite(uint8_t d,uint8_t dc);
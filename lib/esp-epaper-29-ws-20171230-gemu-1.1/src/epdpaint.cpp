@@ -31,6 +31,62 @@ extern uint8_t *buffer;
 
 Paint::Paint(int16_t width, int16_t height) :
 Renderer(width,height) {
+  row_hash = 0;
+  busy_until = 0;
+  partial_count = 0;
+  update_pending = 0;
+  rows_valid = 0;
+}
+
+/**
+ *  @brief: find the band of panel rows changed since the last call
+ *          from a hash per row so no copy of the frame is needed
+ */
+bool Paint::DirtyRows(uint16_t rows, uint16_t row_bytes, uint16_t *first, uint16_t *last) {
+  if (!row_hash) {
+    row_hash = (uint32_t*)calloc(rows, sizeof(uint32_t));
+    rows_valid = 0;
+  }
+  *first = rows;
+  *last = 0;
+  uint8_t *bp = buffer;
+  for (uint16_t row = 0; row < rows; row++) {
+    uint32_t hash = 2166136261;                  // FNV-1a
+    for (uint16_t i = 0; i < row_bytes; i++) {
+      hash = (hash ^ *bp++) * 16777619;
+    }
+    if (!row_hash || !rows_valid || (row_hash[row] != hash)) {
+      if (row < *first) { *first = row; }
+      *last = row;
+    }
+    if (row_hash) { row_hash[row] = hash; }
+  }
+  rows_valid = (row_hash != 0);
+  return (*first <= *last);
+}
+
+void Paint::DirtyReset(void) {
+  rows_valid = 0;
+}
+
+/**
+ *  @brief: the panel has no busy line connected so a refresh marks it busy for its duration
+ */
+void Paint::SetBusy(uint32_t ms) {
+  busy_until = millis() + ms;
+  if (!busy_until) { busy_until = 1; }
+}
+
+bool Paint::Busy(void) {
+  if (busy_until && ((int32_t)(millis() - busy_until) < 0)) { return true; }
+  busy_until = 0;
+  return false;
+}
+
+void Paint::WaitUntilReady(void) {
+  while (Busy()) {
+    delay(10);
+  }
 }
 
 
@@ -36,6 +36,11 @@
 // Color inverse. 1 or 0 = set or reset a bit if set a colored pixel
 #define IF_INVERT_COLOR     1
 
+// Partial refreshes before a full refresh clears the ghosting
+#ifndef EPD_PARTIAL_MAX
+#define EPD_PARTIAL_MAX     50
+#endif
+
 #include "fonts.h"
 #include "renderer.h"
 
@@ -52,6 +57,18 @@ public:
     int16_t Begin(int16_t p1,int16_t p2,int16_t p3);
     void Updateframe();
 
+    bool DirtyRows(uint16_t rows, uint16_t row_bytes, uint16_t *first, uint16_t *last);
+    void DirtyReset(void);
+    void SetBusy(uint32_t ms);
+    bool Busy(void);
+    void WaitUntilReady(void);
+
+protected:
+    uint32_t *row_hash;
+    uint32_t busy_until;
+    uint16_t partial_count;
+    uint8_t update_pending;
+    uint8_t rows_valid;
 };
 
 #endif
@@ -48,7 +48,9 @@ Adafruit_GFX(x, y) {
 #ifdef USE_EPD_FONTS
   selected_font = &Font12;
 #endif
-
+  text_cache = nullptr;
+  text_cache_next = 0;
+  text_nocache = 0;
 }
 
 uint16_t Renderer::GetColorFromIndex(uint8_t index) {
@@ -68,6 +70,11 @@ void Renderer::setAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
 
 }
 
+// write w * h pixels to the display in one transfer, false if not supported by the driver
+bool Renderer::pushColorRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *data) {
+  return false;
+}
+
 void Renderer::DisplayOnff(int8_t on) {
 
 }
@@ -132,6 +139,7 @@ void Renderer::DrawStringAt(int16_t x, int16_t y, const char* text, uint16_t col
         x=(x-1)*OLED_FONT_WIDTH*textsize_x;
         y=(y-1)*OLED_FONT_HEIGTH*textsize_y;
       }
+      if (DrawCachedString(x, y, text, colored)) return;
       setCursor(x,y);
       setTextColor(colored,textbgcolor);
       print(text);
@@ -149,8 +157,10 @@ void Renderer::DrawStringAt(int16_t x, int16_t y, const char* text, uint16_t col
 
     /* Send the string character by character on EPD */
     if (font==7) {
+      invalidateText(x, y, strlen(p_text) * xfont->Width, xfont->Height);
       return FastString(x,y,colored,p_text);
     }
+    if (DrawCachedString(x, y, text, colored)) return;
     while (*p_text != 0) {
         /* Display one character on EPD */
         DrawCharAt(refcolumn, y, *p_text, colored);
@@ -167,6 +177,195 @@ void Renderer::FastString(uint16_t x,uint16_t y,uint16_t tcolor, const char* str
 
 }
 
+/**
+*  @brief: draws only the characters that differ from the text drawn before at the same position
+*  with the same font and colors. Each run of changed characters is rendered into a ram buffer
+*  and pushed with one address window instead of a pixel by pixel transfer.
+*  Returns false if the text must be drawn the usual way.
+*/
+bool Renderer::DrawCachedString(int16_t x, int16_t y, const char* text, uint16_t colored) {
+  if (gfxFont) {
+    invalidateText();
+    return false;
+  }
+
+  uint8_t size_x = 1;
+  uint8_t size_y = 1;
+  int16_t cw;
+  int16_t ch;
+  bool opaque;
+  if (!font) {
+    size_x = textsize_x;
+    size_y = textsize_y;
+    cw = OLED_FONT_WIDTH * size_x;
+    ch = OLED_FONT_HEIGTH * size_y;
+    opaque = (colored != textbgcolor);
+  } else {
+    cw = selected_font->Width;
+    ch = selected_font->Height;
+    opaque = !drawmode;
+  }
+
+  uint32_t len = strlen(text);
+  if (!len) return false;
+  bool single = (len <= RENDERER_TEXT_LEN) && (x >= 0) && (y >= 0) && (x + len * cw <= width()) && (y + ch <= height());
+  for (uint32_t i = 0; single && (i < len); i++) {
+    if ((text[i] < ' ') || (font && (text[i] > '~'))) single = false;
+  }
+  if (!single) {
+    // may wrap or continue on the following lines
+    invalidateText(0, y, width(), height() - y);
+    return false;
+  }
+  if (!opaque || text_nocache) {
+    invalidateText(x, y, len * cw, ch);
+    return false;
+  }
+
+  if (!text_cache) {
+    text_cache = (struct RTEXT_CACHE*)calloc(RENDERER_TEXT_CACHE, sizeof(struct RTEXT_CACHE));
+    if (!text_cache) return false;
+  }
+
+  struct RTEXT_CACHE *entry = nullptr;
+  for (uint32_t i = 0; i < RENDERER_TEXT_CACHE; i++) {
+    struct RTEXT_CACHE *e = &text_cache[i];
+    if (!e->len) continue;
+    if ((e->x == x) && (e->y == y) && (e->font == font) && (e->size_x == size_x) && (e->size_y == size_y) &&
+        (e->fg == colored) && (e->bg == textbgcolor)) {
+      entry = e;
+    } else if ((x < e->x + e->len * e->cw) && (e->x < x + (int16_t)len * cw) && (y < e->y + e->ch) && (e->y < y + ch)) {
+      e->len = 0;   // overdrawn by this text
+    }
+  }
+  if (!entry) {
+    for (uint32_t i = 0; i < RENDERER_TEXT_CACHE; i++) {
+      if (!text_cache[i].len) {
+        entry = &text_cache[i];
+        break;
+      }
+    }
+    if (!entry) {
+      entry = &text_cache[text_cache_next];
+      text_cache_next = (text_cache_next + 1) % RENDERER_TEXT_CACHE;
+    }
+    entry->x = x;
+    entry->y = y;
+    entry->fg = colored;
+    entry->bg = textbgcolor;
+    entry->font = font;
+    entry->size_x = size_x;
+    entry->size_y = size_y;
+    entry->cw = cw;
+    entry->ch = ch;
+    entry->len = 0;
+  }
+
+  uint32_t i = 0;
+  while (i < len) {
+    if ((i < entry->len) && (entry->text[i] == text[i])) {
+      i++;
+      continue;
+    }
+    uint32_t start = i;
+    while ((i < len) && !((i < entry->len) && (entry->text[i] == text[i]))) i++;
+    if (!DrawCells(x + start * cw, y, &text[start], i - start, entry)) {
+      entry->len = 0;
+      if (text_nocache) {
+        free(text_cache);
+        text_cache = nullptr;
+      }
+      return false;
+    }
+  }
+
+  // a shorter text leaves the end of the previous one on the display as print() does
+  memcpy(entry->text, text, len);
+  if (len > entry->len) entry->len = len;
+  if (!font) {
+    // as left by setTextColor() and print()
+    textcolor = colored;
+    cursor_x = x + len * cw;
+    cursor_y = y;
+  }
+  return true;
+}
+
+bool Renderer::DrawCells(int16_t x, int16_t y, const char* text, uint8_t count, struct RTEXT_CACHE *entry) {
+  uint32_t max = RENDERER_TEXT_BUFFER / (entry->cw * entry->ch * 2);
+  if (!max) max = 1;
+  while (count) {
+    uint8_t num = (count > max) ? max : count;
+    int16_t w = num * entry->cw;
+    bool done;
+    if (!font) {
+      GFXcanvas16 canvas(w, entry->ch);
+      if (!canvas.getBuffer()) return false;
+      canvas.cp437(_cp437);
+      for (uint32_t i = 0; i < num; i++) {
+        canvas.drawChar(i * entry->cw, 0, text[i], entry->fg, entry->bg, entry->size_x, entry->size_y);
+      }
+      done = pushColorRect(x, y, w, entry->ch, canvas.getBuffer());
+    } else {
+      uint16_t *buf = (uint16_t*)malloc(w * entry->ch * 2);
+      if (!buf) return false;
+      for (uint32_t i = 0; i < num; i++) {
+        RenderCharAt(buf + i * entry->cw, w, text[i], entry->fg, entry->bg);
+      }
+      done = pushColorRect(x, y, w, entry->ch, buf);
+      free(buf);
+    }
+    if (!done) {
+      text_nocache = 1;   // display driver has no rectangle transfer
+      return false;
+    }
+    x += w;
+    text += num;
+    count -= num;
+  }
+  return true;
+}
+
+// same as DrawCharAt() into a ram buffer of stride pixels per line
+void Renderer::RenderCharAt(uint16_t *buf, int16_t stride, char ascii_char, uint16_t fg, uint16_t bg) {
+#ifdef USE_EPD_FONTS
+  sFONT *xfont = selected_font;
+  unsigned int char_offset = (ascii_char - ' ') * xfont->Height * (xfont->Width / 8 + (xfont->Width % 8 ? 1 : 0));
+  const unsigned char* ptr = &xfont->table[char_offset];
+
+  for (uint32_t j = 0; j < xfont->Height; j++) {
+    uint16_t *line = buf + j * stride;
+    for (uint32_t i = 0; i < xfont->Width; i++) {
+      line[i] = (pgm_read_byte(ptr) & (0x80 >> (i % 8))) ? fg : bg;
+      if (i % 8 == 7) {
+        ptr++;
+      }
+    }
+    if (xfont->Width % 8 != 0) {
+      ptr++;
+    }
+  }
+#endif
+}
+
+// forget cached text in the area so the next DrawStringAt() draws it completely
+void Renderer::invalidateText(int16_t x, int16_t y, int16_t w, int16_t h) {
+  if (!text_cache) return;
+  for (uint32_t i = 0; i < RENDERER_TEXT_CACHE; i++) {
+    struct RTEXT_CACHE *e = &text_cache[i];
+    if (e->len && (x < e->x + e->len * e->cw) && (e->x < x + w) && (y < e->y + e->ch) && (e->y < y + h)) {
+      e->len = 0;
+    }
+  }
+}
+
+void Renderer::invalidateText(void) {
+  if (!text_cache) return;
+  for (uint32_t i = 0; i < RENDERER_TEXT_CACHE; i++) {
+    text_cache[i].len = 0;
+  }
+}
+
 #include <Fonts/FreeMono12pt7b.h>
 #include <Fonts/FreeMono18pt7b.h>
 #include <Fonts/FreeMono24pt7b.h>
@@ -245,6 +444,7 @@ void Renderer::setTextFont(uint8_t f) {
 
 
 void Renderer::clearDisplay(void) {
+  invalidateText();
   fillScreen(BLACK);
 }
 
@@ -9,6 +9,30 @@
 #define WHITE 1
 #define INVERSE 2
 
+// opaque text strings remembered to redraw only the characters that changed
+#ifndef RENDERER_TEXT_CACHE
+#define RENDERER_TEXT_CACHE 16
+#endif
+#define RENDERER_TEXT_LEN 40
+// max bytes of the ram buffer a run of changed characters is rendered into
+#ifndef RENDERER_TEXT_BUFFER
+#define RENDERER_TEXT_BUFFER 4096
+#endif
+
+struct RTEXT_CACHE {
+  int16_t x;
+  int16_t y;
+  uint16_t fg;
+  uint16_t bg;
+  uint8_t font;
+  uint8_t size_x;
+  uint8_t size_y;
+  uint8_t cw;
+  uint8_t ch;
+  uint8_t len;      // 0 = unused
+  char text[RENDERER_TEXT_LEN];
+};
+
 // depends on GFX driver
 // GFX patched
 // a. in class GFX setCursor,setTextSize => virtual
@@ -35,15 +59,24 @@ public:
   virtual void dim(uint8_t contrast);
   virtual void pushColors(uint16_t *data, uint8_t len, boolean first);
   virtual void setAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+  virtual bool pushColorRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *data);
+  void invalidateText(int16_t x, int16_t y, int16_t w, int16_t h);
+  void invalidateText(void);
   void setDrawMode(uint8_t mode);
   uint8_t drawmode;
   virtual void FastString(uint16_t x,uint16_t y,uint16_t tcolor, const char* str);
 private:
   void DrawCharAt(int16_t x, int16_t y, char ascii_char,int16_t colored);
+  bool DrawCachedString(int16_t x, int16_t y, const char* text, uint16_t colored);
+  bool DrawCells(int16_t x, int16_t y, const char* text, uint8_t count, struct RTEXT_CACHE *entry);
+  void RenderCharAt(uint16_t *buf, int16_t stride, char ascii_char, uint16_t fg, uint16_t bg);
   inline void drawFastVLineInternal(int16_t x, int16_t y, int16_t h, uint16_t color) __attribute__((always_inline));
   inline void drawFastHLineInternal(int16_t x, int16_t y, int16_t w, uint16_t color) __attribute__((always_inline));
   sFONT *selected_font;
   uint8_t font;
+  struct RTEXT_CACHE *text_cache;
+  uint8_t text_cache_next;
+  uint8_t text_nocache;
 };
 
 class VButton : public Adafruit_GFX_Button {
@@ -15,6 +15,54 @@ void ESPKNXIP::send(address_t const &receiver, knx_command_type_t ct, uint8_t da
 	if (receiver.value == 0)
 		return;
 
+	// Queue when the burst is used up or earlier telegrams wait so the order is kept
+	__loop_send();
+	if ((send_queue_count || !send_tokens) && (send_queue_count < SEND_QUEUE_SIZE) && (data_len <= sizeof(send_queue[0].data)))
+	{
+		send_queue_entry_t *entry = &send_queue[(send_queue_head + send_queue_count) % SEND_QUEUE_SIZE];
+		entry->receiver = receiver;
+		entry->ct = ct;
+		entry->data_len = data_len;
+		memcpy(entry->data, data, data_len);
+		send_queue_count++;
+		return;
+	}
+	if (send_tokens)
+		send_tokens--;
+	__send_now(receiver, ct, data_len, data);
+}
+
+void ESPKNXIP::__loop_send()
+{
+	// Refill one telegram of the burst every SEND_PACING milliseconds
+	uint32_t now = millis();
+	if (send_tokens >= SEND_BURST)
+	{
+		send_token_time = now;
+	}
+	else
+	{
+		uint32_t refill = (now - send_token_time) / SEND_PACING;
+		if (refill)
+		{
+			send_tokens = (send_tokens + refill >= SEND_BURST) ? SEND_BURST : send_tokens + refill;
+			send_token_time += refill * SEND_PACING;
+		}
+	}
+
+	while (send_queue_count && send_tokens)
+	{
+		send_queue_entry_t *entry = &send_queue[send_queue_head];
+		send_queue_head = (send_queue_head + 1) % SEND_QUEUE_SIZE;
+		send_queue_count--;
+		send_tokens--;
+		__send_now(entry->receiver, (knx_command_type_t)entry->ct, entry->data_len, entry->data);
+	}
+}
+
+void ESPKNXIP::__send_now(address_t const &receiver, knx_command_type_t ct, uint8_t data_len, uint8_t *data)
+{
+
 #if SEND_CHECKSUM
 	uint32_t len = 6 + 2 + 8 + data_len + 1; // knx_pkt + cemi_msg + cemi_service + data + checksum
 #else
@@ -20,7 +20,11 @@ ESPKNXIP::ESPKNXIP() : server(nullptr),
                       registered_callbacks(0),
                       free_callback_slots(0),
                       registered_configs(0),
-                      registered_feedbacks(0)
+                      registered_feedbacks(0),
+                      send_queue_head(0),
+                      send_queue_count(0),
+                      send_tokens(SEND_BURST),
+                      send_token_time(0)
 {
   DEBUG_PRINTLN();
   DEBUG_PRINTLN("ESPKNXIP starting up");
@@ -28,6 +32,8 @@ ESPKNXIP::ESPKNXIP() : server(nullptr),
   physaddr.bytes.high = (/*area*/1 << 4) | /*line*/1;
   physaddr.bytes.low = /*member*/0;
   memset(callback_assignments, 0, MAX_CALLBACK_ASSIGNMENTS * sizeof(callback_assignment_t));
+  memset(callback_assignment_bucket, 0, sizeof(callback_assignment_bucket));
+  memset(callback_assignment_next, 0, sizeof(callback_assignment_next));
   memset(callbacks, 0, MAX_CALLBACKS * sizeof(callback_fptr_t));
   memset(custom_config_data, 0, MAX_CONFIG_SPACE * sizeof(uint8_t));
   memset(custom_config_default_data, 0, MAX_CONFIG_SPACE * sizeof(uint8_t));
@@ -176,6 +182,7 @@ void ESPKNXIP::restore_from_eeprom()
     EEPROM.get(address, callback_assignments[i].callback_id);
     address += sizeof(callback_id_t);
   }
+  __callback_index_rebuild();
   EEPROM.get(address, physaddr);
   address += sizeof(address_t);
 
@@ -309,6 +316,26 @@ void ESPKNXIP::__callback_delete_assignment(callback_assignment_id_t id)
   }
 }
 
+void ESPKNXIP::__callback_index_rebuild()
+{
+  // Chain the used assignments per address hash. Chains keep assignment order so callbacks run as before
+  memset(callback_assignment_bucket, 0, sizeof(callback_assignment_bucket));
+  memset(callback_assignment_next, 0, sizeof(callback_assignment_next));
+  uint8_t last[CALLBACK_ASSIGNMENT_BUCKETS];
+  for (callback_assignment_id_t i = 0; i < registered_callback_assignments; ++i)
+  {
+    if ((callback_assignments[i].slot_flags & SLOT_FLAGS_USED) == 0)
+      continue;
+
+    uint8_t bucket = __callback_bucket(callback_assignments[i].address);
+    if (callback_assignment_bucket[bucket] == 0)
+      callback_assignment_bucket[bucket] = i + 1;
+    else
+      callback_assignment_next[last[bucket]] = i + 1;
+    last[bucket] = i;
+  }
+}
+
 bool ESPKNXIP::__callback_is_id_valid(callback_id_t id)
 {
   if (id < registered_callbacks)
@@ -418,7 +445,9 @@ callback_assignment_id_t ESPKNXIP::callback_assign(callback_id_t id, address_t v
   if (!__callback_is_id_valid(id))
     return -1;
 
-  return __callback_register_assignment(val, id);
+  callback_assignment_id_t aid = __callback_register_assignment(val, id);
+  __callback_index_rebuild();
+  return aid;
 }
 
 void ESPKNXIP::callback_unassign(callback_assignment_id_t id)
@@ -427,6 +456,7 @@ void ESPKNXIP::callback_unassign(callback_assignment_id_t id)
     return;
 
   __callback_delete_assignment(id);
+  __callback_index_rebuild();
 }
 
 /**
@@ -511,6 +541,7 @@ feedback_id_t ESPKNXIP::feedback_register_action(String name, feedback_action_fp
 void ESPKNXIP::loop()
 {
   __loop_knx();
+  __loop_send();
   if (server != nullptr)
   {
     __loop_webserver();
@@ -620,8 +651,9 @@ void ESPKNXIP::__loop_knx()
   DEBUG_PRINTLN(F("=="));
 
   // Call callbacks
-  for (int i = 0; i < registered_callback_assignments; ++i)
+  for (uint8_t next = callback_assignment_bucket[__callback_bucket(cemi_data->destination)]; next != 0; next = callback_assignment_next[next - 1])
   {
+    uint8_t i = next - 1;
     DEBUG_PRINT(F("Testing: 0x"));
     DEBUG_PRINT(callback_assignments[i].address.bytes.high, 16);
     DEBUG_PRINT(F(" 0x"));
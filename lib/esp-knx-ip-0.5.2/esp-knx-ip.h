@@ -23,6 +23,12 @@
 
 // Callbacks
 #define ALLOW_MULTIPLE_CALLBACKS_PER_ADDRESS  1 // [Default 0] Set to 1 to always test all assigned callbacks. This allows for multiple callbacks being assigned to the same address. If disabled, only the first assigned will be called.
+#define CALLBACK_ASSIGNMENT_BUCKETS  16 // [Default 16] Number of hash buckets used to find the assignments of a received group address. Must be a power of 2
+
+// Sending
+#define SEND_QUEUE_SIZE           8 // [Default 8] Number of telegrams that can wait for sending. A full queue sends at once
+#define SEND_BURST                4 // [Default 4] Maximum number of telegrams sent back-to-back
+#define SEND_PACING               20 // [Default 20] Milliseconds per telegram refilling the burst, 20 is the 50 telegrams per second a KNX/IP router accepts
 
 // Webserver related
 #define USE_BOOTSTRAP             0 // [Default 1] Set to 1 to enable use of bootstrap CSS for nicer webconfig. CSS is loaded from bootstrapcdn.com. Set to 0 to disable
@@ -397,6 +403,14 @@ typedef struct __callback_assignment
   callback_id_t callback_id;
 } callback_assignment_t;
 
+typedef struct __send_queue_entry
+{
+  address_t receiver;
+  uint8_t ct;
+  uint8_t data_len;
+  uint8_t data[15];                         // Largest is 14 byte string plus APCI byte
+} send_queue_entry_t;
+
 // FastPrecisePowf from tasmota/support_float.ino
 extern float FastPrecisePowf(const float x, const float y);
 
@@ -535,6 +549,8 @@ class ESPKNXIP {
     void __start();
 
     void __loop_knx();
+    void __loop_send();
+    void __send_now(address_t const &receiver, knx_command_type_t ct, uint8_t data_len, uint8_t *data);
 
     // Webserver functions
     void __loop_webserver();
@@ -566,6 +582,8 @@ class ESPKNXIP {
 
     callback_assignment_id_t __callback_register_assignment(address_t address, callback_id_t id);
     void __callback_delete_assignment(callback_assignment_id_t id);
+    void __callback_index_rebuild();
+    static inline uint8_t __callback_bucket(address_t const &address) { return (address.bytes.high * 31 + address.bytes.low) & (CALLBACK_ASSIGNMENT_BUCKETS - 1); }
 
     static inline float pow(float a, float b) { return FastPrecisePowf(a, b); }
 
@@ -577,6 +595,14 @@ class ESPKNXIP {
     callback_assignment_id_t registered_callback_assignments;
     callback_assignment_id_t free_callback_assignment_slots;
     callback_assignment_t callback_assignments[MAX_CALLBACK_ASSIGNMENTS];
+    uint8_t callback_assignment_bucket[CALLBACK_ASSIGNMENT_BUCKETS];  // First assignment + 1 with this hash, 0 if none
+    uint8_t callback_assignment_next[MAX_CALLBACK_ASSIGNMENTS];       // Next assignment + 1 with the same hash, 0 if last
+
+    send_queue_entry_t send_queue[SEND_QUEUE_SIZE];
+    uint8_t send_queue_head;
+    uint8_t send_queue_count;
+    uint8_t send_tokens;
+    uint32_t send_token_time;
 
     callback_id_t registered_callbacks;
     callback_id_t free_callback_slots;
@@ -89,10 +89,17 @@ enum {
 };
 
 #if not defined( RCSwitchDisableReceiving )
-volatile unsigned long RCSwitch::nReceivedValue = 0;
-volatile unsigned int RCSwitch::nReceivedBitlength = 0;
-volatile unsigned int RCSwitch::nReceivedDelay = 0;
-volatile unsigned int RCSwitch::nReceivedProtocol = 0;
+RCSwitch::ReceivedCode RCSwitch::rxRing[RCSWITCH_RX_RING];
+volatile uint8_t RCSwitch::nRxHead = 0;
+volatile uint8_t RCSwitch::nRxTail = 0;
+unsigned long RCSwitch::nReceiveProtocolMask = 0xFFFFFFFF;
+unsigned long RCSwitch::nDuplicateWindow = 0;
+unsigned long RCSwitch::nLastValue = 0;
+unsigned long RCSwitch::nLastTime = 0;
+uint8_t RCSwitch::nLastProtocol = 0;
+unsigned int RCSwitch::rawTimings[RCSWITCH_MAX_CHANGES];
+volatile unsigned int RCSwitch::nRawLength = 0;
+bool RCSwitch::bRawCapture = false;
 int RCSwitch::nReceiveTolerance = 60;
 const unsigned int RCSwitch::nSeparationLimit = 4300;
 // separationLimit: minimum microseconds between received codes, closer codes are ignored.
@@ -108,7 +115,7 @@ RCSwitch::RCSwitch() {
   #if not defined( RCSwitchDisableReceiving )
   this->nReceiverInterrupt = -1;
   this->setReceiveTolerance(60);
-  RCSwitch::nReceivedValue = 0;
+  RCSwitch::nRxTail = RCSwitch::nRxHead;
   #endif
 }
 
@@ -544,8 +551,8 @@ void RCSwitch::enableReceive(int interrupt) {
 
 void RCSwitch::enableReceive() {
   if (this->nReceiverInterrupt != -1) {
-    RCSwitch::nReceivedValue = 0;
-    RCSwitch::nReceivedBitlength = 0;
+    RCSwitch::nRxTail = RCSwitch::nRxHead;
+    RCSwitch::nRawLength = 0;
 #if defined(RaspberryPi) // Raspberry Pi
     wiringPiISR(this->nReceiverInterrupt, INT_EDGE_BOTH, &handleInterrupt);
 #else // Arduino
@@ -564,34 +571,78 @@ void RCSwitch::disableReceive() {
   this->nReceiverInterrupt = -1;
 }
 
+/**
+ * Received codes are kept in a ring, the get functions return the oldest one
+ * until resetAvailable() drops it.
+ */
 bool RCSwitch::available() {
-  return RCSwitch::nReceivedValue != 0;
+  return RCSwitch::nRxHead != RCSwitch::nRxTail;
 }
 
 void RCSwitch::resetAvailable() {
-  RCSwitch::nReceivedValue = 0;
+  if (this->available()) {
+    RCSwitch::nRxTail = (RCSwitch::nRxTail + 1) & (RCSWITCH_RX_RING - 1);
+  }
 }
 
 unsigned long RCSwitch::getReceivedValue() {
-  return RCSwitch::nReceivedValue;
+  return (this->available()) ? RCSwitch::rxRing[RCSwitch::nRxTail].value : 0;
 }
 
 unsigned int RCSwitch::getReceivedBitlength() {
-  return RCSwitch::nReceivedBitlength;
+  return RCSwitch::rxRing[RCSwitch::nRxTail].bitlength;
 }
 
 unsigned int RCSwitch::getReceivedDelay() {
-  return RCSwitch::nReceivedDelay;
+  return RCSwitch::rxRing[RCSwitch::nRxTail].delay;
 }
 
 unsigned int RCSwitch::getReceivedProtocol() {
-  return RCSwitch::nReceivedProtocol;
+  return RCSwitch::rxRing[RCSwitch::nRxTail].protocol;
 }
 
 unsigned int* RCSwitch::getReceivedRawdata() {
   return RCSwitch::timings;
 }
 
+/**
+ * Only decode the protocols with bit (protocol - 1) set, 0 decodes all
+ */
+void RCSwitch::setReceiveProtocolMask(unsigned long nMask) {
+  RCSwitch::nReceiveProtocolMask = (nMask) ? nMask : 0xFFFFFFFF;
+}
+
+/**
+ * Ignore a code identical to the last received one within nMilliseconds
+ */
+void RCSwitch::setReceiveDuplicateWindow(unsigned long nMilliseconds) {
+  RCSwitch::nDuplicateWindow = nMilliseconds * 1000;
+}
+
+/**
+ * Keep a copy of a pulse train longer than RCSWITCH_MAX_CHANGES instead of dropping it
+ */
+void RCSwitch::enableRawCapture(bool bEnable) {
+  RCSwitch::bRawCapture = bEnable;
+  RCSwitch::nRawLength = 0;
+}
+
+bool RCSwitch::rawAvailable() {
+  return RCSwitch::nRawLength != 0;
+}
+
+void RCSwitch::resetRawAvailable() {
+  RCSwitch::nRawLength = 0;
+}
+
+unsigned int RCSwitch::getRawLength() {
+  return RCSwitch::nRawLength;
+}
+
+unsigned int* RCSwitch::getRawData() {
+  return RCSwitch::rawTimings;
+}
+
 /* helper function for the receiveProtocol method */
 static inline unsigned int diff(int A, int B) {
   return abs(A - B);
@@ -600,7 +651,7 @@ static inline unsigned int diff(int A, int B) {
 /**
  *
  */
-bool RECEIVE_ATTR RCSwitch::receiveProtocol(const int p, unsigned int changeCount) {
+bool RECEIVE_ATTR RCSwitch::receiveProtocol(const int p, unsigned int changeCount, const long time) {
 #if defined(ESP8266) || defined(ESP32)
     const Protocol &pro = proto[p-1];
 #else
@@ -648,11 +699,23 @@ bool RECEIVE_ATTR RCSwitch::receiveProtocol(const int p, unsigned int changeCoun
         }
     }
 
-    if (changeCount > 7) {    // ignore very short transmissions: no device sends them, so this must be noise
-        RCSwitch::nReceivedValue = code;
-        RCSwitch::nReceivedBitlength = (changeCount - 1) / 2;
-        RCSwitch::nReceivedDelay = delay;
-        RCSwitch::nReceivedProtocol = p;
+    if ((changeCount > 7) && code) {    // ignore very short transmissions: no device sends them, so this must be noise
+        if ((code == RCSwitch::nLastValue) && (p == RCSwitch::nLastProtocol) &&
+            ((unsigned long)(time - RCSwitch::nLastTime) < RCSwitch::nDuplicateWindow)) {
+            return true;      // Repeat of the last code
+        }
+        RCSwitch::nLastValue = code;
+        RCSwitch::nLastProtocol = p;
+        RCSwitch::nLastTime = time;
+        const uint8_t next = (RCSwitch::nRxHead + 1) & (RCSWITCH_RX_RING - 1);
+        if (next != RCSwitch::nRxTail) {    // Drop the code if the ring is full
+            ReceivedCode &received = RCSwitch::rxRing[RCSwitch::nRxHead];
+            received.value = code;
+            received.bitlength = (changeCount - 1) / 2;
+            received.delay = delay;
+            received.protocol = p;
+            RCSwitch::nRxHead = next;
+        }
         return true;
     }
 
@@ -680,7 +743,10 @@ void RECEIVE_ATTR RCSwitch::handleInterrupt() {
       repeatCount++;
       if (repeatCount == 2) {
         for(unsigned int i = 1; i <= numProto; i++) {
-          if (receiveProtocol(i, changeCount)) {
+          if (!(RCSwitch::nReceiveProtocolMask & (1UL << (i - 1)))) {
+            continue;
+          }
+          if (receiveProtocol(i, changeCount, time)) {
             // receive succeeded for protocol i
             break;
           }
@@ -693,6 +759,10 @@ void RECEIVE_ATTR RCSwitch::handleInterrupt() {
  
   // detect overflow
   if (changeCount >= RCSWITCH_MAX_CHANGES) {
+    if (RCSwitch::bRawCapture && !RCSwitch::nRawLength) {
+      memcpy(RCSwitch::rawTimings, RCSwitch::timings, sizeof(RCSwitch::rawTimings));
+      RCSwitch::nRawLength = RCSWITCH_MAX_CHANGES;
+    }
     changeCount = 0;
     repeatCount = 0;
   }
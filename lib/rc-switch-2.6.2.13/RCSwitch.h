@@ -60,6 +60,9 @@
 // We can handle up to (unsigned long) => 32 bit * 2 H/L changes per bit + 2 for sync
 #define RCSWITCH_MAX_CHANGES 67
 
+// Number of received codes kept until read, must be a power of 2
+#define RCSWITCH_RX_RING 8
+
 class RCSwitch {
 
   public:
@@ -92,6 +95,14 @@ class RCSwitch {
     unsigned int getReceivedDelay();
     unsigned int getReceivedProtocol();
     unsigned int* getReceivedRawdata();
+
+    void setReceiveProtocolMask(unsigned long nMask);
+    void setReceiveDuplicateWindow(unsigned long nMilliseconds);
+    void enableRawCapture(bool bEnable);
+    bool rawAvailable();
+    void resetRawAvailable();
+    unsigned int getRawLength();
+    unsigned int* getRawData();
     #endif
   
     void enableTransmit(int nTransmitterPin);
@@ -157,7 +168,7 @@ class RCSwitch {
 
     #if not defined( RCSwitchDisableReceiving )
     static void handleInterrupt();
-    static bool receiveProtocol(const int p, unsigned int changeCount);
+    static bool receiveProtocol(const int p, unsigned int changeCount, const long time);
     int nReceiverInterrupt;
     #endif
     int nTransmitterPin;
@@ -167,15 +178,34 @@ class RCSwitch {
 
     #if not defined( RCSwitchDisableReceiving )
     static int nReceiveTolerance;
-    volatile static unsigned long nReceivedValue;
-    volatile static unsigned int nReceivedBitlength;
-    volatile static unsigned int nReceivedDelay;
-    volatile static unsigned int nReceivedProtocol;
+    struct ReceivedCode {
+        unsigned long value;
+        uint16_t delay;
+        uint8_t bitlength;
+        uint8_t protocol;
+    };
+    /*
+     * Ring of decoded codes written by the interrupt handler, read from the loop
+     */
+    static ReceivedCode rxRing[RCSWITCH_RX_RING];
+    volatile static uint8_t nRxHead;
+    volatile static uint8_t nRxTail;
+    static unsigned long nReceiveProtocolMask;       // Bit n-1 enables protocol n
+    static unsigned long nDuplicateWindow;           // Microseconds an identical code is ignored
+    static unsigned long nLastValue;
+    static unsigned long nLastTime;
+    static uint8_t nLastProtocol;
     const static unsigned int nSeparationLimit;
     /* 
      * timings[0] contains sync timing, followed by a number of bits
      */
     static unsigned int timings[RCSWITCH_MAX_CHANGES];
+    /*
+     * Copy of a pulse train too long for the protocol decoders
+     */
+    static unsigned int rawTimings[RCSWITCH_MAX_CHANGES];
+    volatile static unsigned int nRawLength;         // 0 if no raw capture pending
+    static bool bRawCapture;
     #endif
 
     
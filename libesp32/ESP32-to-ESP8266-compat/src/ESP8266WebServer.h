@@ -3,6 +3,10 @@
 //
 #pragma once
 #include <WebServer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
 
 //#define ESP8266WebServer WebServer
 
@@ -14,6 +18,90 @@ public:
 	:WebServer(port)
 	{
 	}
+
+	// Run handleClient() on its own task so slow clients do not block the caller of dispatch().
+	// Registered handlers still run on the task calling dispatch() while the web task waits for
+	// them, so handlers and the web task never use the server at the same time
+	bool beginTask(uint32_t stack_size = 8192, UBaseType_t priority = 1, BaseType_t core = tskNO_AFFINITY)
+	{
+		if (_task) { return true; }
+		_queue = xQueueCreate(1, sizeof(THandlerFunction*));
+		_done = xSemaphoreCreateBinary();
+		_mutex = xSemaphoreCreateMutex();
+		if (!_queue || !_done || !_mutex) { return false; }
+		return (pdPASS == xTaskCreatePinnedToCore(taskLoop, "web", stack_size, this, priority, &_task, core));
+	}
+
+	// Run a handler requested by the web task, if any
+	void dispatch(void)
+	{
+		THandlerFunction *fn;
+		if (_task && (pdTRUE == xQueueReceive(_queue, &fn, 0))) {
+			_in_dispatch = true;
+			(*fn)();
+			_in_dispatch = false;
+			xSemaphoreGive(_done);
+		}
+	}
+
+	void begin(void) { lock(); WebServer::begin(); unlock(); }
+	void close(void) { lock(); WebServer::close(); unlock(); }
+	void stop(void) { close(); }
+
+	void on(const String &uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+	void on(const String &uri, HTTPMethod method, THandlerFunction fn) { WebServer::on(uri, method, wrap(fn)); }
+	void on(const String &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) { WebServer::on(uri, method, wrap(fn), wrap(ufn)); }
+	void onNotFound(THandlerFunction fn) { WebServer::onNotFound(wrap(fn)); }
+
+private:
+	TaskHandle_t _task = nullptr;
+	QueueHandle_t _queue = nullptr;
+	SemaphoreHandle_t _done = nullptr;
+	SemaphoreHandle_t _mutex = nullptr;
+	volatile bool _in_dispatch = false;
+
+	THandlerFunction wrap(THandlerFunction fn)
+	{
+		return [this, fn]() { run(fn); };
+	}
+
+	void run(THandlerFunction fn)
+	{
+		if (!_task || (xTaskGetCurrentTaskHandle() != _task)) {
+			fn();
+			return;
+		}
+		THandlerFunction *request = &fn;
+		xQueueSend(_queue, &request, portMAX_DELAY);  // Hand over to dispatch() and wait for completion
+		xSemaphoreTake(_done, portMAX_DELAY);
+	}
+
+	void lock(void)
+	{
+		// A handler run from dispatch() already owns the server as the web task waits for it
+		if (!_task || _in_dispatch) { return; }
+		// The web task keeps the mutex while it waits in run() for a handler, so serve that
+		// handler here until the web task finishes handleClient() and releases the mutex
+		while (pdTRUE != xSemaphoreTake(_mutex, pdMS_TO_TICKS(10))) {
+			dispatch();
+		}
+	}
+
+	void unlock(void)
+	{
+		if (_task && !_in_dispatch) { xSemaphoreGive(_mutex); }
+	}
+
+	static void taskLoop(void *arg)
+	{
+		ESP8266WebServer *server = (ESP8266WebServer*)arg;
+		while (true) {
+			xSemaphoreTake(server->_mutex, portMAX_DELAY);
+			server->handleClient();
+			xSemaphoreGive(server->_mutex);
+			vTaskDelay(1);
+		}
+	}
 };
 
 //#define ENC_TYPE_AUTO 0
@@ -193,6 +193,8 @@ void WiFiClientSecure_light::_clear() {
 	_sk_ec_P = nullptr;
 	_ta_P = nullptr;
 	_max_thunkstack_use = 0;
+	_session_valid = false;
+	_session_resumed = false;
 }
 
 // Constructor
@@ -238,6 +240,17 @@ void WiFiClientSecure_light::setTrustAnchor(const br_x509_trust_anchor *ta) {
 	_ta_P = ta;
 }
 
+void WiFiClientSecure_light::setSession(const br_ssl_session_parameters *session) {
+	_session = *session;
+	_session_valid = (_session.session_id_len > 0) && (_session.session_id_len <= sizeof(_session.session_id));
+}
+
+bool WiFiClientSecure_light::getSession(br_ssl_session_parameters *session) {
+	if (!_session_valid) { return false; }
+	*session = _session;
+	return true;
+}
+
 void WiFiClientSecure_light::setBufferSizes(int recv, int xmit) {
   // Following constants taken from bearssl/src/ssl/ssl_engine.c (not exported unfortunately)
   const int MAX_OUT_OVERHEAD = 85;
@@ -864,11 +877,28 @@ bool WiFiClientSecure_light::_connectSSL(const char* hostName) {
 	                              _cert_issuer_key_type, &br_ec_p256_m15, br_ecdsa_sign_asn1_get_default());
 	#endif // USE_MQTT_AWS_IOT
 
+		// ============================================================
+		// Offer the previous session to skip the certificate and key exchange
+		_session_resumed = false;
+		if (_session_valid) {
+			br_ssl_engine_set_session_parameters(_eng, &_session);
+		}
+
 		// ============================================================
 		// Start TLS connection, ALL
-	  if (!br_ssl_client_reset(_sc.get(), hostName, 0)) break;
+	  if (!br_ssl_client_reset(_sc.get(), hostName, _session_valid)) break;
 
 	  auto ret = _wait_for_handshake();
+		if (ret) {
+			// The server accepted the offered session if it returned the same session ID
+			br_ssl_session_parameters session;
+			br_ssl_engine_get_session_parameters(_eng, &session);
+			_session_resumed = _session_valid && (session.session_id_len == _session.session_id_len) &&
+			                   !memcmp(session.session_id, _session.session_id, session.session_id_len);
+			setSession(&session);
+		} else {
+			_session_valid = false;		// next connection uses a full handshake
+		}
 	#ifdef DEBUG_ESP_SSL
 	  if (!ret) {
 	    DEBUG_BSSL("Couldn't connect. Error = %d\n", getLastError());
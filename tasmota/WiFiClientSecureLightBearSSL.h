@@ -77,6 +77,13 @@ class WiFiClientSecure_light : public WiFiClient {
 
     void setTrustAnchor(const br_x509_trust_anchor *ta);
 
+    // TLS session resumption, the session of the last full handshake is offered on the next connect()
+    void setSession(const br_ssl_session_parameters *session);
+    bool getSession(br_ssl_session_parameters *session);
+    inline bool getSessionResumed(void) {
+      return _session_resumed;
+    }
+
     // Sets the requested buffer size for transmit and receive
     void setBufferSizes(int recv, int xmit);
 
@@ -126,6 +133,10 @@ class WiFiClientSecure_light : public WiFiClient {
     unsigned char *_recvapp_buf;
     size_t _recvapp_len;
 
+    br_ssl_session_parameters _session;  // session of last handshake
+    bool _session_valid;             // _session may be resumed
+    bool _session_resumed;           // last handshake resumed _session
+
     bool _clientConnected(); // Is the underlying socket alive?
     bool _connectSSL(const char *hostName); // Do initial SSL handshake
     void _freeSSL();
@@ -48,6 +48,7 @@ extern "C" {
 
 // Internal-only calls, not for applications
 extern void _setPWMFreq(uint32_t freq);
+extern void _setPWMPhaseShift(bool enable);
 extern bool _stopPWM(int pin);
 extern bool _setPWM(int pin, uint32_t val, uint32_t range);
 extern int startWaveformClockCycles(uint8_t pin, uint32_t timeHighCycles, uint32_t timeLowCycles, uint32_t runTimeCycles);
@@ -128,22 +129,32 @@ static ICACHE_RAM_ATTR void forceTimerInterrupt() {
 // On interrupt, if we're at the last element reset to t=0 state
 // Otherwise, clear that pin down and set delay for next element
 // and so forth.
+//
+// In phase shift mode the rising edges of the pins are spread evenly over
+// the period so their current draw does not start at the same instant.
+// The list then holds a rising (PWM_EDGE_RISE) and a falling edge per pin
+// and only pins rising at t=0 are set high at the start of the period.
+// The list is rebuilt on each duty or frequency change, never in the ISR.
 
 constexpr int maxPWMs = 8;
+constexpr uint8_t PWM_EDGE_RISE = 0x80;  // Flag in pin[] for a rising edge
+constexpr uint8_t PWM_EDGE_PIN = 0x7F;
 
 // PWM machine state
 typedef struct PWMState {
   uint32_t mask; // Bitmask of active pins
+  uint32_t startMask; // Bitmask of pins to set high at t=0
   uint32_t cnt;  // How many entries
   uint32_t idx;  // Where the state machine is along the list
-  uint8_t  pin[maxPWMs + 1];
-  uint32_t delta[maxPWMs + 1];
+  uint8_t  pin[2 * maxPWMs + 1];
+  uint32_t delta[2 * maxPWMs + 1];
   uint32_t nextServiceCycle;  // Clock cycle for next step
   struct PWMState *pwmUpdate; // Set by main code, cleared by ISR
 } PWMState;
 
 static PWMState pwmState;
 static uint32_t _pwmPeriod = microsecondsToClockCycles(1000000UL) / 1000;
+static bool _pwmPhaseShift = false;
 
 
 // If there are no more scheduled activities, shut down Timer 1.
@@ -173,6 +184,37 @@ static ICACHE_RAM_ATTR void _notifyPWM(PWMState *p, bool idle) {
 }
 
 static void _addPWMtoList(PWMState &p, int pin, uint32_t val, uint32_t range);
+static void _phaseShiftPWM(PWMState &p);
+
+// Rebuild the edge list of all active pins, used when period or mode changed
+static void _rebuildPWM(void) {
+  if (pwmState.cnt) {
+    PWMState p;  // The working copy since we can't edit the one in use
+    p.cnt = 0;
+    p.mask = 0;
+    for (uint32_t pin = 0; pin <= 16; pin++) {
+      if (pwmState.mask & (1<<pin)) {
+        _addPWMtoList(p, pin, wvfState.waveform[pin].desiredHighCycles, wvfState.waveform[pin].desiredLowCycles);
+      }
+    }
+    if (_pwmPhaseShift) {
+      _phaseShiftPWM(p);
+    }
+    // Update and wait for mailbox to be emptied
+    initTimer();
+    _notifyPWM(&p, true);
+    disableIdleTimer();
+  }
+}
+
+// Called by analogWritePhaseShift() to spread the rising edges over the period
+void _setPWMPhaseShift(bool enable) {
+  if (enable == _pwmPhaseShift) {
+    return; // No change
+  }
+  _pwmPhaseShift = enable;
+  _rebuildPWM();
+}
 
 // Called when analogWriteFreq() changed to update the PWM total period
 void _setPWMFreq(uint32_t freq) {
@@ -192,18 +234,7 @@ void _setPWMFreq(uint32_t freq) {
 
   _pwmPeriod = cc;
 
-  if (pwmState.cnt) {
-    PWMState p;  // The working copy since we can't edit the one in use
-    p.cnt = 0;
-    for (uint32_t i = 0; i < pwmState.cnt; i++) {
-      auto pin = pwmState.pin[i];
-      _addPWMtoList(p, pin, wvfState.waveform[pin].desiredHighCycles, wvfState.waveform[pin].desiredLowCycles);
-    }
-    // Update and wait for mailbox to be emptied
-    initTimer();
-    _notifyPWM(&p, true);
-    disableIdleTimer();
-  }
+  _rebuildPWM();
 }
 
 // Helper routine to remove an entry from the state machine
@@ -212,14 +243,15 @@ static void _cleanAndRemovePWM(PWMState *p, int pin) {
   uint32_t leftover = 0;
   uint32_t in, out;
   for (in = 0, out = 0; in < p->cnt; in++) {
-    if ((p->pin[in] != pin) && (p->mask & (1<<p->pin[in]))) {
+    uint32_t edge_pin = p->pin[in] & PWM_EDGE_PIN;
+    if ((edge_pin != pin) && (p->mask & (1<<edge_pin))) {
         p->pin[out] = p->pin[in];
         p->delta[out] = p->delta[in] + leftover;
         leftover = 0;
         out++;
     } else {
         leftover += p->delta[in];
-        p->mask &= ~(1<<p->pin[in]);
+        p->mask &= ~(1<<edge_pin);
     }
   }
   p->cnt = out;
@@ -298,6 +330,57 @@ static void _addPWMtoList(PWMState &p, int pin, uint32_t val, uint32_t range) {
   }
   p.cnt++;
   p.mask |= 1<<pin;
+  p.startMask = p.mask;
+}
+
+// Replace the edge list by one with the rising edges of the active pins
+// evenly spaced over the PWM period
+static void _phaseShiftPWM(PWMState &p) {
+  uint32_t pins = __builtin_popcount(p.mask);
+  if (!pins) {
+    return;
+  }
+  uint32_t time[2 * maxPWMs];
+  uint8_t edge[2 * maxPWMs];
+  uint32_t cnt = 0;
+  uint32_t k = 0;
+  p.startMask = 0;
+  for (uint32_t pin = 0; pin <= 16; pin++) {
+    if (!(p.mask & (1<<pin))) {
+      continue;
+    }
+    uint32_t cc = (_pwmPeriod * wvfState.waveform[pin].desiredHighCycles) / wvfState.waveform[pin].desiredLowCycles;
+    uint32_t rise = (_pwmPeriod / pins) * k++;
+    uint32_t fall = rise + cc;
+    if (fall >= _pwmPeriod) {
+      fall -= _pwmPeriod;  // Pulse wraps around, pin is still high at t=0
+    }
+    for (uint32_t e = 0; e < 2; e++) {
+      uint32_t t = (e) ? fall : rise;
+      uint8_t v = (e) ? pin : (pin | PWM_EDGE_RISE);
+      if (!e && !rise) {
+        p.startMask |= 1<<pin;
+        continue;
+      }
+      // Insertion sort, at most 16 edges
+      uint32_t i = cnt++;
+      while (i && (time[i - 1] > t)) {
+        time[i] = time[i - 1];
+        edge[i] = edge[i - 1];
+        i--;
+      }
+      time[i] = t;
+      edge[i] = v;
+    }
+  }
+  uint32_t last = 0;
+  for (uint32_t i = 0; i < cnt; i++) {
+    p.pin[i] = edge[i];
+    p.delta[i] = time[i] - last;
+    last = time[i];
+  }
+  p.delta[cnt] = _pwmPeriod - last;
+  p.cnt = cnt;
 }
 
 // Called by analogWrite(1...99%) to set the PWM duty in clock cycles
@@ -308,11 +391,14 @@ bool _setPWM(int pin, uint32_t val, uint32_t range) {
   // Get rid of any entries for this pin
   _cleanAndRemovePWM(&p, pin);
   // And add it to the list, in order
-  if (p.cnt >= maxPWMs) {
+  if (__builtin_popcount(p.mask) >= maxPWMs) {
     return false; // No space left
   }
 
   _addPWMtoList(p, pin, val, range);
+  if (_pwmPhaseShift) {
+    _phaseShiftPWM(p);
+  }
 
   // Set mailbox and wait for ISR to copy it over
   initTimer();
@@ -485,18 +571,27 @@ static ICACHE_RAM_ATTR void timer1Interrupt() {
                 // Do the memory copy from temp to global and clear mailbox
                 pwmState = *(PWMState*)pwmState.pwmUpdate;
               }
-              GPOS = pwmState.mask; // Set all active pins high
-              if (pwmState.mask & (1<<16)) {
+              GPOS = pwmState.mask & pwmState.startMask; // Set all active pins high
+              if (pwmState.mask & pwmState.startMask & (1<<16)) {
                 GP16O = 1;
               }
               pwmState.idx = 0;
             } else {
               do {
-                // Drop the pin at this edge
-                if (pwmState.mask & (1<<pwmState.pin[pwmState.idx])) {
-                  GPOC = 1<<pwmState.pin[pwmState.idx];
-                  if (pwmState.pin[pwmState.idx] == 16) {
-                    GP16O = 0;
+                // Drop the pin at this edge, or raise it in phase shift mode
+                uint32_t edge = pwmState.pin[pwmState.idx];
+                uint32_t edge_pin = edge & PWM_EDGE_PIN;
+                if (pwmState.mask & (1<<edge_pin)) {
+                  if (edge & PWM_EDGE_RISE) {
+                    GPOS = 1<<edge_pin;
+                    if (edge_pin == 16) {
+                      GP16O = 1;
+                    }
+                  } else {
+                    GPOC = 1<<edge_pin;
+                    if (edge_pin == 16) {
+                      GP16O = 0;
+                    }
                   }
                 }
                 pwmState.idx++;
@@ -30,6 +30,7 @@ extern "C" {
 
 // Internal-only calls, not for applications
 extern void _setPWMFreq(uint32_t freq);
+extern void _setPWMPhaseShift(bool enable);
 extern bool _stopPWM(int pin);
 extern bool _setPWM(int pin, uint32_t val, uint32_t range);
 
@@ -52,6 +53,10 @@ extern void __analogWriteFreq(uint32_t freq) {
   _setPWMFreq(freq);
 }
 
+extern void __analogWritePhaseShift(bool enable) {
+  _setPWMPhaseShift(enable);
+}
+
 extern void __analogWrite(uint8_t pin, int val) {
   if (pin > 16) {
     return;
@@ -70,6 +75,7 @@ extern void __analogWrite(uint8_t pin, int val) {
 extern void analogWrite(uint8_t pin, int val) __attribute__((weak, alias("__analogWrite")));
 extern void analogWriteFreq(uint32_t freq) __attribute__((weak, alias("__analogWriteFreq")));
 extern void analogWriteRange(uint32_t range) __attribute__((weak, alias("__analogWriteRange")));
+extern void analogWritePhaseShift(bool enable) __attribute__((weak, alias("__analogWritePhaseShift")));
 
 };
 
@@ -232,6 +232,8 @@
 #define D_CMND_BLINKCOUNT "BlinkCount"
 #define D_CMND_SENSOR "Sensor"
 #define D_CMND_DRIVER "Driver"
+#define D_CMND_PROFILE "Profile"
+#define D_CMND_LOOPSTATS "LoopStats"
 #define D_CMND_SAVEDATA "SaveData"
 #define D_CMND_SETOPTION "SetOption"
 #define D_CMND_SO "SO"
@@ -331,6 +333,7 @@
 #define D_CMND_MQTTHOST "MqttHost"
 #define D_CMND_MQTTPORT "MqttPort"
 #define D_CMND_MQTTRETRY "MqttRetry"
+#define D_CMND_MQTTCOMPRESS "MqttCompress"
 #define D_CMND_STATETEXT "StateText"
 #define D_CMND_MQTTFINGERPRINT "MqttFingerprint"
 #define D_CMND_MQTTCLIENT "MqttClient"
@@ -360,6 +363,7 @@
   #define D_JSON_WITH_IP_ADDRESS "with IP address"
 #define D_CMND_WEBPASSWORD "WebPassword"
 #define D_CMND_WEBLOG "WebLog"
+#define D_CMND_WEBLOGSIZE "WebLogSize"
 #define D_CMND_WEBREFRESH "WebRefresh"
 #define D_CMND_WEBSEND "WebSend"
 #define D_CMND_WEBCOLOR "WebColor"
@@ -368,6 +372,7 @@
 #define D_CMND_EMULATION "Emulation"
 #define D_CMND_SENDMAIL "Sendmail"
 #define D_CMND_CORS "CORS"
+#define D_CMND_WEBSTATS "WebStats"
 
 // Commands xdrv_03_energy.ino
 #define D_CMND_POWERLOW "PowerLow"
@@ -406,6 +411,7 @@
 #define D_CMND_LED "Led"
 #define D_CMND_LEDTABLE "LedTable"
 #define D_CMND_FADE "Fade"
+#define D_CMND_FADECURVE "FadeCurve"
 #define D_CMND_PALETTE "Palette"
 #define D_CMND_PIXELS "Pixels"
 #define D_CMND_RGBWWTABLE "RGBWWTable"
@@ -413,6 +419,7 @@
 #define D_CMND_SCHEME "Scheme"
 #define D_CMND_SEQUENCE_OFFSET "SequenceOffset"
 #define D_CMND_SPEED "Speed"
+#define D_CMND_STREAM "Stream"
 #define D_CMND_WAKEUP "Wakeup"
 #define D_CMND_WAKEUPDURATION "WakeUpDuration"
 #define D_CMND_WHITE "White"
@@ -420,6 +427,7 @@
 
 // Commands xdrv_05_irremote.ino
 #define D_CMND_IRSEND "IRSend"
+#define D_CMND_IRPROTOCOLS "IRProtocols"
   #define D_JSON_INVALID_JSON "Invalid JSON"
   #define D_JSON_INVALID_RAWDATA "Invalid RawData"
   #define D_JSON_NO_BUFFER_SPACE "No buffer space"
@@ -473,6 +481,8 @@
 // Commands xdrv_08_serial_bridge.ino
 #define D_CMND_SSERIALSEND "SSerialSend"
 #define D_CMND_SBAUDRATE "SBaudrate"
+#define D_CMND_SSERIALSTREAM "SSerialStream"
+  #define D_JSON_SSERIALDATA "SSerialData"
   #define D_JSON_SSERIALRECEIVED "SSerialReceived"
 
 // Commands xdrv_09_timers.ino
@@ -549,6 +559,9 @@
 #define D_CMND_ZIGBEE_RESTORE "Restore"
 #define D_CMND_ZIGBEE_CONFIG "Config"
   #define D_JSON_ZIGBEE_CONFIG "Config"
+#define D_CMND_ZIGBEE_COALESCE "Coalesce"
+#define D_CMND_ZIGBEE_STATS "Stats"
+#define D_CMND_ZIGBEE_REPLAY "Replay"
 
 // Commands xdrv_25_A4988_Stepper.ino
 #define D_CMND_MOTOR "MOTOR"
@@ -598,6 +611,18 @@
 // Commands xdrv_38_ping.ino
 #define D_CMND_PING "Ping"
 #define D_JSON_PING "Ping"
+#define D_CMND_PINGHOST "PingHost"
+#define D_CMND_PINGINTERVAL "PingInterval"
+#define D_JSON_PINGMONITOR "PingMonitor"
+
+// Commands xdrv_40_bench.ino
+#define D_CMND_BENCHLOAD "BenchLoad"
+
+// Commands xdrv_41_trace.ino
+#define D_CMND_TRACE "Trace"
+
+// Commands xdrv_42_flash_wear.ino
+#define D_CMND_FLASHWEAR "FlashWear"
 
 // Commands xsns_02_analog.ino
 #define D_CMND_ADCPARAM "AdcParam"
@@ -678,6 +678,10 @@
 #define D_SENSOR_ELECTRIQ_MOODL "MOODL - TX"
 #define D_SENSOR_AS3935        "AS3935"
 #define D_SENSOR_WINDMETER_SPEED "Velocità vento"
+#define D_SENSOR_ADS1115_RDY   "ADS1115 RDY"
+#define D_SENSOR_APDS9960_INT  "APDS9960 INT"
+#define D_SENSOR_NRF24_IRQ     "NRF24 IRQ"
+#define D_SENSOR_MCP230XX_INT  "MCP230xx INT"
 #define D_GPIO_WEBCAM_PWDN     "CAM_PWDN"
 #define D_GPIO_WEBCAM_RESET    "CAM_RESET"
 #define D_GPIO_WEBCAM_XCLK     "CAM_XCLK"
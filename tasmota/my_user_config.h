@@ -77,6 +77,7 @@
 // -- Syslog --------------------------------------
 #define SYS_LOG_HOST           ""                // [LogHost] (Linux) syslog host
 #define SYS_LOG_PORT           514               // [LogPort] default syslog UDP port
+//#define USE_SYSLOG_TCP                           // Send syslog over a persistent TCP connection to LogPort in octet counted batches instead of UDP (+0k5 code, +1k mem)
 #define SYS_LOG_LEVEL          LOG_LEVEL_NONE    // [SysLog] (LOG_LEVEL_NONE, LOG_LEVEL_ERROR, LOG_LEVEL_INFO, LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG_MORE)
 #define SERIAL_LOG_LEVEL       LOG_LEVEL_INFO    // [SerialLog] (LOG_LEVEL_NONE, LOG_LEVEL_ERROR, LOG_LEVEL_INFO, LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG_MORE)
 #define WEB_LOG_LEVEL          LOG_LEVEL_INFO    // [WebLog] (LOG_LEVEL_NONE, LOG_LEVEL_ERROR, LOG_LEVEL_INFO, LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG_MORE)
@@ -284,6 +285,7 @@
 #define LIGHT_SLIDER_POWER     false             // [SetOption77] Do not power off if slider moved to far left
 #define LIGHT_ALEXA_CT_RANGE   false             // [SetOption82] Reduced CT range for Alexa
 #define LIGHT_PWM_CT_MODE      false             // [SetOption92] Set PWM Mode from regular PWM to ColorTemp control (Xiaomi Philips ...) a.k.a. module 48 mode
+#define LIGHT_TRANSACTION_WINDOW 20              // Collect light changes for 20 mSeconds and apply them once to outputs, device group and MQTT (0 = off)
 
 // -- Energy --------------------------------------
 #define ENERGY_VOLTAGE_ALWAYS  false             // [SetOption21] Enable show voltage even if powered off
@@ -356,6 +358,19 @@
 #define USE_HOME_ASSISTANT                       // Enable Home Assistant Discovery Support (+4.1k code, +6 bytes mem)
   #define HOME_ASSISTANT_DISCOVERY_PREFIX "homeassistant"  // Home Assistant discovery prefix
 
+// -- MQTT - Publish queue ------------------------
+//#define USE_MQTT_QUEUE                           // Queue publishes and send them from loop() coalescing non-retained STATE, SENSOR and POWER messages (+0k8 code)
+//  #define MQTT_QUEUE_DEPTH     16                // Max number of queued publishes
+//  #define MQTT_QUEUE_BUDGET    5                 // Max number of mSeconds per loop spent on sending queued publishes
+
+// -- MQTT - Network task -------------------------
+//#define USE_NETWORK_TASK                         // (ESP32 only) Poll MQTT, send publishes and run the broker handshake on a task pinned to NET_TASK_CORE (+1k code, +6k mem)
+//  #define NET_TASK_CORE        0                 // Core of the network task and the web task of USE_WEBSERVER_TASK
+//  #define NET_QUEUE_DEPTH      16                // Max number of messages queued in each direction
+
+// -- MQTT - Payload compression ------------------
+//#define USE_MQTT_COMPRESSION                     // Add command MqttCompress publishing large JSON payloads Unishox compressed to topic <topic>/Z (+3k3 code)
+
 // -- MQTT - TLS - AWS IoT ------------------------
 // Using TLS starting with version v6.5.0.16 compilation will only work using Core 2.4.2 and 2.5.2. No longer supported: 2.3.0
 //#define USE_MQTT_TLS                             // Use TLS for MQTT connection (+34.5k code, +7.0k mem and +4.8k additional during connection handshake)
@@ -377,6 +392,11 @@
   #define WEB_USERNAME         "admin"           // Web server Admin mode user name
 //  #define USE_JAVASCRIPT_ES6                     // Enable ECMAScript6 syntax using less JavaScript code bytes (fails on IE11)
 //  #define USE_WEBSEND_RESPONSE                   // Enable command WebSend response message (+1k code)
+//  #define USE_WEBSEND_ASYNC                      // Queue WebSend and Sendmail, send WebSend without blocking reusing connections and report results to rules (+2k5 code)
+//  #define USE_WEBSERVER_TASK                     // (ESP32 only) Receive web requests on a separate task while handlers still run from loop() (+0k5 code, +8k mem)
+//  #define USE_WEBSOCKET                          // Push console log and root status over a WebSocket instead of polling (+3k code, +0k2 mem, +0k5 mem per open page)
+//    #define WEBSOCKET_PORT     8081              // WebSocket port (81 is used by the ESP32 webcam stream)
+//  #define USE_WEB_STATS                          // Add command WebStats, Server-Timing header and Prometheus histograms of web request time, bytes and chunks per endpoint (+1k5 code, +0k5 mem)
   #define USE_EMULATION_HUE                      // Enable Hue Bridge emulation for Alexa (+14k code, +2k mem common)
   #define USE_EMULATION_WEMO                     // Enable Belkin WeMo emulation for Alexa (+6k code, +2k mem common)
 
@@ -398,8 +418,12 @@
 // Select none or only one of the below defines USE_RULES or USE_SCRIPT
 #define USE_RULES                                // Add support for rules (+8k code)
   #define USE_RULES_COMPRESSION                  // Compresses rules in Flash at about ~50% (+3.3k code)
+//  #define USE_RULES_STATS                        // Add command RuleStats with per trigger evaluation and execution time statistics (+1k code)
+//  #define RULES_CACHE_SIZE 1536                  // Max bytes of RAM keeping processed rule sets between events (default ESP8266 1536, ESP32 8192)
 //#define USE_SCRIPT                               // Add support for script (+17k code)
   //#define USE_SCRIPT_FATFS 4                     // Script: Add FAT FileSystem Support
+  //#define USE_SCRIPT_COMPILE                     // Script: Compile numeric expressions to bytecode on first use (+1k2 RAM)
+  //#define USE_SCRIPT_TASK                        // Script: (ESP32 only) Run sections >t1 and >t2 on tasks started by ct() with tsnd(), trcv() and tcnt() channels
 
 //  #define USE_EXPRESSION                         // Add support for expression evaluation in rules (+3k2 code, +64 bytes mem)
 //    #define SUPPORT_IF_STATEMENT                 // Add support for IF statement in rules (+4k2 code, -332 bytes mem)
@@ -437,6 +461,7 @@
 //  #define USE_WS2812_DMA                         // DMA supports only GPIO03 (= Serial RXD) (+1k mem). When USE_WS2812_DMA is enabled expect Exceptions on Pow
   #define USE_WS2812_HARDWARE  NEO_HW_WS2812     // Hardware type (NEO_HW_WS2812, NEO_HW_WS2812X, NEO_HW_WS2813, NEO_HW_SK6812, NEO_HW_LC8812, NEO_HW_APA106)
   #define USE_WS2812_CTYPE     NEO_GRB           // Color type (NEO_RGB, NEO_GRB, NEO_BRG, NEO_RBG, NEO_RGBW, NEO_GRBW)
+//  #define USE_WS2812_STREAM                      // Add E1.31 (sACN) and Art-Net DMX receiver writing universes into the strip enabled with command Stream (+2k5 code)
 #define USE_MY92X1                               // Add support for MY92X1 RGBCW led controller as used in Sonoff B1, Ailight and Lohas
 #define USE_SM16716                              // Add support for SM16716 RGB LED controller (+0k7 code)
 #define USE_SM2135                               // Add support for SM2135 RGBCW led control as used in Action LSC (+0k6 code)
@@ -444,6 +469,8 @@
 #define USE_ELECTRIQ_MOODL                       // Add support for ElectriQ iQ-wifiMOODL RGBW LED controller (+0k3 code)
 #define USE_LIGHT_PALETTE                        // Add support for color palette (+0k7 code)
 #define USE_DGR_LIGHT_SEQUENCE                   // Add support for device group light sequencing (requires USE_DEVICE_GROUPS) (+0k2 code)
+//#define USE_LIGHT_FADE_TIMER                     // Update PWM fades from a 100Hz timer following command FadeCurve instead of every 50 mSeconds
+//#define USE_LIGHT_XY_FIXED_POINT                 // Use fixed point instead of float and powf for RGB to CIE xy conversion used by Hue, Alexa and Zigbee
 
 // -- Counter input -------------------------------
 #define USE_COUNTER                              // Enable inputs as counter (+0k8 code)
@@ -454,6 +481,7 @@
 // -- One wire sensors ----------------------------
 #define USE_DS18x20                              // Add support for DS18x20 sensors with id sort, single scan and read retry (+2k6 code)
 //  #define W1_PARASITE_POWER                      // Optimize for parasite powered sensors
+//  #define USE_DS18x20_RMT                        // Use ESP32 RMT peripheral for single pin 1-Wire timing
 
 // -- I2C sensors ---------------------------------
 #define USE_I2C                                  // I2C using library wire (+10k code, 0k2 mem, 124 iram)
@@ -490,6 +518,7 @@
 //  #define USE_PCA9685                            // [I2cDriver1] Enable PCA9685 I2C HW PWM Driver - Must define I2C Address in #define USE_PCA9685_ADDR below - range 0x40 - 0x47 (+1k4 code)
 //    #define USE_PCA9685_ADDR 0x40                // Enable PCA9685 I2C Address to use (Must be within range 0x40 through 0x47 - set according to your wired setup)
 //    #define USE_PCA9685_FREQ 50                  // Define default PWM frequency in Hz to be used (must be within 24 to 1526) - If other value is used, it will rever to 50Hz
+//    #define USE_PCA9685_LIGHT 5                  // Use PCA9685 channels 0 to x -1 as light channels (1 to 5) updated in one I2C burst
 //  #define USE_MPR121                             // [I2cDriver23] Enable MPR121 controller (I2C addresses 0x5A, 0x5B, 0x5C and 0x5D) in input mode for touch buttons (+1k3 code)
 //  #define USE_CCS811                             // [I2cDriver24] Enable CCS811 sensor (I2C address 0x5A) (+2k2 code)
 //  #define USE_MPU6050                            // [I2cDriver25] Enable MPU6050 sensor (I2C address 0x68 AD0 low or 0x69 AD0 high) (+3K3 of code and 188 Bytes of RAM)
@@ -583,13 +612,17 @@
 //#define USE_MI_ESP32                             // (ESP32 only) Add support for ESP32 as a BLE-bridge (+9k2 mem, +292k flash)
 //#define USE_HRXL                                 // Add support for MaxBotix HRXL-MaxSonar ultrasonic range finders (+0k7)
 //#define USE_TASMOTA_SLAVE                        // Add support for Arduino Uno/Pro Mini via serial interface including flashing (+2k6 code, 64 mem)
-  #define USE_TASMOTA_SLAVE_FLASH_SPEED 57600      // Usually 57600 for 3.3V variants and 115200 for 5V variants
+  #define USE_TASMOTA_SLAVE_FLASH_SPEED 57600      // Usually 57600 for 3.3V variants and 115200 for 5V variants, tried first followed by 115200 and 57600
   #define USE_TASMOTA_SLAVE_SERIAL_SPEED 57600     // Depends on the sketch that is running on the Uno/Pro Mini
 //#define USE_OPENTHERM                            // Add support for OpenTherm (+15k code)
 
 // -- Power monitoring sensors --------------------
 #define USE_ENERGY_MARGIN_DETECTION              // Add support for Energy Margin detection (+1k6 code)
   #define USE_ENERGY_POWER_LIMIT                 // Add additional support for Energy Power Limit detection (+1k2 code)
+//#define USE_ENERGY_STATISTICS                    // Add per second energy samples with min/mean/max/percentile at teleperiod and command EnergyDump (+2k code, 8 bytes RAM per sample and phase)
+//  #define ENERGY_STATS_SAMPLES 300               // Number of per second samples (default 300)
+//#define USE_ENERGY_JOURNAL                       // Add journal of energy totals and counters in flash to survive power loss between settings saves (+1k5 code, 8k flash)
+//  #define JOURNAL_INTERVAL 60                    // Seconds between journal records of changed values (default 60)
 #define USE_PZEM004T                             // Add support for PZEM004T Energy monitor (+2k code)
 #define USE_PZEM_AC                              // Add support for PZEM014,016 Energy monitor (+1k1 code)
 #define USE_PZEM_DC                              // Add support for PZEM003,017 Energy monitor (+1k1 code)
@@ -611,6 +644,7 @@
 
 // -- Low level interface devices -----------------
 #define USE_DHT                                  // Add support for DHT11, AM2301 (DHT21, DHT22, AM2302, AM2321) and SI7021 Temperature and Humidity sensor (1k6 code)
+//  #define USE_DHT_IRQ                            // Capture DHT pulse train by pin interrupt keeping interrupts enabled (+0k4 code)
 
 //#define USE_MAX31855                             // Add support for MAX31855/MAX6675 K-Type thermocouple sensor using softSPI
 //#define USE_MAX31865                             // Add support for MAX31865 RTD sensors using softSPI
@@ -628,6 +662,8 @@
 //
 // Code impact of IR full protocols is +81k code, 3k mem
 // You can reduce this size by disabling some protocols in "lib/IRremoteESP8266.x.x.x/src/IRremoteESP8266.h"
+// Command IRProtocols limits the protocols tried on receive at runtime
+//#define USE_IR_RECEIVE_TASK                      // ESP32 only - Decode received IR on a task on the other core (+0k8 code, 2k mem)
 
 // -- IR Remote features - subset of IR protocols --------------------------
 #define USE_IR_REMOTE                            // Send IR remote commands using library IRremoteESP8266 and ArduinoJson (+4k3 code, 0k3 mem, 48 iram)
@@ -651,6 +687,12 @@
   #define USE_ZIGBEE_PRECFGKEY_H 0x0D0C0A0806040200L  // note: changing requires to re-pair all devices
 
   #define USE_ZIGBEE_COALESCE_ATTR_TIMER 350     // timer to coalesce attribute values (in ms)
+  #define USE_ZIGBEE_COALESCE_MIN_INTERVAL 1000  // min interval between two coalesced publishes of a device (in ms), see command ZbCoalesce
+//  #define USE_ZIGBEE_REPLAY                      // Add command ZbReplay to feed captured ZNP frames from a file to the Zigbee stack (+2k code)
+//  #define ZIGBEE_ATTR_POOL_BLOCKS 96             // blocks of 32 bytes shared by all devices to coalesce attributes (default 96, ESP32 512)
+//  #define ZIGBEE_AF_INFLIGHT 4                   // max frames to different devices waiting for confirmation by the CC2530
+//  #define ZIGBEE_AF_GROUP_INTERVAL 150           // ms between two frames sent to groups
+//  #define ZIGBEE_SERIAL_BUFFER_SIZE 768          // receive buffer of the serial port to the CC2530
 
 // -- Other sensors/drivers -----------------------
 
@@ -659,6 +701,7 @@
 //#define USE_TM1638                               // Add support for TM1638 switches copying Switch1 .. Switch8 (+1k code)
 //#define USE_HX711                                // Add support for HX711 load cell (+1k5 code)
 //  #define USE_HX711_GUI                          // Add optional web GUI to HX711 as scale (+1k8 code)
+//  #define USE_HX711_IRQ                          // Add optional interrupt driven sampling to HX711 (+0k2 code)
 
 // Select none or only one of the below defines
 //#define USE_TX20_WIND_SENSOR                     // Add support for La Crosse TX20 anemometer (+2k6/0k8 code)
@@ -678,14 +721,13 @@
 // -- Thermostat control ----------------------------
 //#define USE_THERMOSTAT                           // Add support for Thermostat
   #define THERMOSTAT_CONTROLLER_OUTPUTS         1         // Number of outputs to be controlled independently
-  #define THERMOSTAT_SENSOR_NAME                "DS18B20" // Name of the local sensor to be used
   #define THERMOSTAT_RELAY_NUMBER               1         // Default output relay number for the first controller (+i for following ones)
   #define THERMOSTAT_SWITCH_NUMBER              1         // Default input switch number for the first controller (+i for following ones)
   #define THERMOSTAT_TIME_ALLOW_RAMPUP          300       // Default time after last target update to allow ramp-up controller phase in minutes
   #define THERMOSTAT_TIME_RAMPUP_MAX            960       // Default time maximum ramp-up controller duration in minutes
   #define THERMOSTAT_TIME_RAMPUP_CYCLE          30        // Default time ramp-up cycle in minutes
   #define THERMOSTAT_TIME_SENS_LOST             30        // Maximum time w/o sensor update to set it as lost in minutes
-  #define THERMOSTAT_TEMP_SENS_NUMBER           1         // Default temperature sensor number
+  #define THERMOSTAT_TEMP_SENS_NUMBER           1         // Default local DS18x20 sensor number for the first controller (+i for following ones)
   #define THERMOSTAT_TIME_MANUAL_TO_AUTO        60        // Default time without input switch active to change from manual to automatic in minutes
   #define THERMOSTAT_TIME_RESET                 12000     // Default reset time of the PI controller in seconds
   #define THERMOSTAT_TIME_PI_CYCLE              30        // Default cycle time for the thermostat controller in minutes
@@ -718,6 +760,23 @@
 //#define DEBUG_TASMOTA_DRIVER                     // Enable driver debug messages
 //#define DEBUG_TASMOTA_SENSOR                     // Enable sensor debug messages
 //#define USE_DEBUG_DRIVER                         // Use xdrv_99_debug.ino providing commands CpuChk, CfgXor, CfgDump, CfgPeek and CfgPoke
+//#define USE_PROFILER                             // Use support_profile.ino providing command Profile and driver loop time metrics (+2k code)
+//#define USE_LOOP_STATS                           // Use support_loop_stats.ino providing command LoopStats with loop time percentiles, longest driver call and task stack use (+1k code, +1k mem)
+//#define USE_BENCH                                // Use xdrv_40_bench.ino providing command BenchLoad running a standard command, teleperiod, web and rules load (+2k code)
+//#define USE_TRACE                                // Use xdrv_41_trace.ino providing command Trace and web page /trace with Chrome trace JSON of driver, sensor, MQTT, log, WiFi and flash events (+2k code, +4k mem)
+//#define USE_FLASH_WEAR                           // Use xdrv_42_flash_wear.ino counting flash erases and writes per area with wear in Status 4, command FlashWear and a daily budget warning (+1k5 code)
+//#define USE_TIMER_WHEEL                          // Use support_timer_wheel.ino running loop ticks and driver callbacks from a timer wheel (+1k code)
+//#define USE_DEFERRED_LOG                         // Queue MQTT and syslog log lines and send them from loop() (+0k6 code, +2k1 mem)
+//#define USE_HEAP_TAGS                            // Count heap use of Zigbee, rules, webserver and scripter in Status 4 and Prometheus (+0k4 code)
+//#define USE_JSON_ARENA                           // Parse temporary ArduinoJson trees in one shared arena kept from first use (+0k3 code, +1k5 mem)
+//#define USE_STAGED_BOOT                          // Initialize sensors one per loop after power state and wifi are started (+0k1 code)
+//#define USE_OTA_RESUME                           // Use support_ota.ino for command Upgrade resuming dropped downloads and checking SHA-256 (+2k code)
+//#define USE_OTA_DELTA                            // Use OTA delta of the running image if the server provides one. Needs USE_OTA_RESUME (+1k code)
+//#define USE_INPUT_INTERRUPT                      // Use support_input_interrupt.ino for SetOption96 1 acting on switch and button edges from interrupts (+0k8 code)
+//#define USE_ADAPTIVE_SLEEP                       // Add SetOption98 1 shortening the loop sleep after events and sleep accounting in STATE (+0k6 code)
+//#define USE_DNS_CACHE                            // Use support_dns_cache.ino caching host addresses and failed lookups for MQTT, WebSend, syslog and ping with background refresh and Status 5 counters (+1k code)
+//#define USE_FAST_POWER                           // Add SetOption97 1 switching the relay of a local switch or button action before MQTT state, rules and device groups (+0k6 code)
+//#define USE_WEB_LOG_COMPRESSION                  // Store web log entries Unishox compressed holding about twice the lines (+3k5 code, +0k7 mem)
 
 /*********************************************************************************************\
  * Optional firmware configurations
@@ -732,6 +791,7 @@
 //#define FIRMWARE_IR                              // Create tasmota-ir with IR full protocols activated, and many sensors disabled
 //#define FIRMWARE_IR_CUSTOM                       // Create tasmota customizable with special marker to add all IR protocols
 //#define FIRMWARE_MINIMAL                         // Create tasmota-minimal as intermediate firmware for OTA-MAGIC
+//#define FIRMWARE_BENCH                           // Create tasmota-bench with the load benchmark and loop statistics enabled
 
 /*********************************************************************************************\
  * No user configurable items below
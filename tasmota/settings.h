@@ -114,11 +114,11 @@ typedef union {                            // Restricted by MISRA-C Rule 18.4 bu
     uint32_t pwm_ct_mode : 1;              // bit 10 (v8.2.0.4)  - SetOption92 - Set PWM Mode from regular PWM to ColorTemp control (Xiaomi Philips ...)
     uint32_t compress_rules_cpu : 1;       // bit 11 (v8.2.0.6)  - SetOption93 - Keep uncompressed rules in memory to avoid CPU load of uncompressing at each tick
     uint32_t max6675 : 1;                  // bit 12 (v8.3.1.2)  - SetOption94 - Implement simpler MAX6675 protocol instead of MAX31855
-    uint32_t spare13 : 1;
-    uint32_t spare14 : 1;
-    uint32_t spare15 : 1;
-    uint32_t spare16 : 1;
-    uint32_t spare17 : 1;
+    uint32_t pwm_phase_shift : 1;          // bit 13 (v8.3.1.2)  - SetOption95 - Spread PWM channel rising edges over the PWM period
+    uint32_t input_interrupt : 1;          // bit 14 (v8.3.1.2)  - SetOption96 - Interrupt driven switch and button input
+    uint32_t fast_power : 1;               // bit 15 (v8.3.1.2)  - SetOption97 - Switch relays of local switch and button actions before publishing state
+    uint32_t sleep_adaptive : 1;           // bit 16 (v8.3.1.2)  - SetOption98 - Shorten loop sleep after events and up to the next 50 mS tick
+    uint32_t button_optimistic : 1;        // bit 17 (v8.3.1.2)  - SetOption99 - Execute button single press action on the first press and revert it on a multi-press
     uint32_t spare18 : 1;
     uint32_t spare19 : 1;
     uint32_t spare20 : 1;
@@ -230,8 +230,8 @@ typedef union {
 typedef union {
   uint8_t data;
   struct {
-    uint8_t spare0 : 1;
-    uint8_t spare1 : 1;
+    uint8_t hx711_median : 1;              // Sensor34 11,x - Median instead of average of the HX711 sample window
+    uint8_t hx711_80sps : 1;               // Sensor34 12,x - HX711 RATE pin is high for 80 samples per second
     uint8_t bh1750_2_resolution : 2;
     uint8_t bh1750_1_resolution : 2;       // Sensor10 1,2,3
     uint8_t hx711_json_weight_change : 1;  // Sensor34 8,x - Enable JSON message on weight change
@@ -569,7 +569,23 @@ struct {
   uint8_t	      ledpwm_on;                 // F3F
   uint8_t	      ledpwm_off;                // F40
 
-  uint8_t       free_f42[119];             // F41 - Decrement if adding new Setting variables just above and below
+  uint8_t       light_fade_curve;          // F41
+  uint16_t      ws2812_stream_universe;    // F42
+
+  uint8_t       hx711_filter_size;         // F44
+  uint8_t       web_log_kb;                // F45
+  uint16_t      mqtt_compress;             // F46
+  uint16_t      flash_wear_budget;         // F48
+  uint8_t       sbr_stream_timeout;        // F4A
+  uint8_t       free_f4b[1];               // F4B
+  uint32_t      flash_wear_erased[WEAR_AREAS];  // F4C
+  uint32_t      flash_wear_kbytes[WEAR_AREAS];  // F60
+
+  uint16_t      rf_protocol_mask;          // F74
+  uint16_t      rf_duplicate_time;         // F76
+  uint8_t       rf_raw_capture;            // F78
+
+  uint8_t       free_f79[63];              // F79 - Decrement if adding new Setting variables just above and below
 
   // Only 32 bit boundary variables below
   uint16_t      pulse_counter_debounce_low;  // FB8
@@ -611,9 +627,16 @@ typedef struct {
   uint8_t       free_004[4];               // 2CC
   uint32_t      ultradeepsleep;            // 2D0
   uint16_t      deepsleep_slip;            // 2D4
-
-  uint8_t       free_022[22];              // 2D6
-                                           // 2EC - 2FF free locations
+  uint8_t       wifi_bssid[6];             // 2D6 - DeepSleep fast resume
+  uint8_t       wifi_channel;              // 2DC
+  uint8_t       free_2dd[1];               // 2DD
+  uint16_t      settings_location;         // 2DE
+  uint32_t      wifi_ip_address[4];        // 2E0
+  unsigned long settings_save_flag;        // 2F0
+  uint32_t      settings_crc32;            // 2F4
+
+  uint8_t       free_2f8[8];               // 2F8
+                                           // 300 - End of RTC user memory
 } TRtcSettings;
 TRtcSettings RtcSettings;
 #ifdef ESP32
@@ -56,6 +56,10 @@ void RtcSettingsLoad(void)
 #else
   RtcSettings = RtcDataSettings;
 #endif
+#ifdef USE_ENERGY_JOURNAL
+  JournalLoad();
+  JournalRestore(RtcSettings.valid != RTC_MEM_VALID);  // Update Settings with values recorded since last save
+#endif  // USE_ENERGY_JOURNAL
   if (RtcSettings.valid != RTC_MEM_VALID) {
     memset(&RtcSettings, 0, sizeof(RtcSettings));
     RtcSettings.valid = RTC_MEM_VALID;
@@ -328,6 +332,15 @@ uint32_t GetSettingsCrc32(void)
   return GetCfgCrc32((uint8_t*)&Settings, sizeof(Settings) -4);  // Skip crc32
 }
 
+uint32_t GetSettingsChangeCrc32(void)
+{
+#ifdef USE_ENERGY_JOURNAL
+  return JournalSettingsCrc32();  // Skip values kept in journal
+#else
+  return GetSettingsCrc32();
+#endif  // USE_ENERGY_JOURNAL
+}
+
 void SettingsSaveAll(void)
 {
   if (Settings.flag.save_state) {
@@ -366,8 +379,10 @@ void UpdateQuickPowerCycle(bool update)
       pc_register = 0xFFA55AB0 | counter;
 #ifdef ESP8266
       ESP.flashWrite(pc_location * SPI_FLASH_SEC_SIZE, (uint32*)&pc_register, sizeof(pc_register));
+      FLASH_WEAR(WEAR_SETTINGS, 0, sizeof(pc_register));
 #else  // ESP32
       QPCWrite(&pc_register, sizeof(pc_register));
+      FLASH_WEAR_LEVELED(WEAR_SETTINGS, sizeof(pc_register));
 #endif  // ESP8266 - ESP32
       AddLog_P2(LOG_LEVEL_DEBUG, PSTR("QPC: Flag %02X"), counter);
     }
@@ -378,9 +393,11 @@ void UpdateQuickPowerCycle(bool update)
     // Assume flash is default all ones and setting a bit to zero does not need an erase
     if (ESP.flashEraseSector(pc_location)) {
       ESP.flashWrite(pc_location * SPI_FLASH_SEC_SIZE, (uint32*)&pc_register, sizeof(pc_register));
+      FLASH_WEAR(WEAR_SETTINGS, 1, sizeof(pc_register));
     }
 #else  // ESP32
     QPCWrite(&pc_register, sizeof(pc_register));
+    FLASH_WEAR_LEVELED(WEAR_SETTINGS, sizeof(pc_register));
 #endif  // ESP8266 - ESP32
     AddLog_P2(LOG_LEVEL_DEBUG, PSTR("QPC: Reset"));
   }
@@ -391,13 +408,26 @@ void UpdateQuickPowerCycle(bool update)
  * Config Settings.text char array support
 \*********************************************************************************************/
 
-uint32_t GetSettingsTextLen(void)
+struct {
+  uint16_t offset[SET_MAX];                 // Start of each text in Settings.text_pool
+  uint16_t length;                          // Used size of Settings.text_pool including terminators
+} SettingsTextIdx;
+
+void SettingsTextIndex(void)
 {
-  char* position = Settings.text_pool;
-  for (uint32_t size = 0; size < SET_MAX; size++) {
-    while (*position++ != '\0') { }
+  // Rebuild offsets after Settings.text_pool has been changed other than by SettingsUpdateText()
+  uint32_t position = 0;
+  for (uint32_t index = 0; index < SET_MAX; index++) {
+    SettingsTextIdx.offset[index] = position;
+    while ((position < settings_text_size) && (Settings.text_pool[position] != '\0')) { position++; }
+    if (position < settings_text_size) { position++; }
   }
-  return position - Settings.text_pool;
+  SettingsTextIdx.length = position;
+}
+
+uint32_t GetSettingsTextLen(void)
+{
+  return SettingsTextIdx.length;
 }
 
 bool SettingsUpdateText(uint32_t index, const char* replace_me)
@@ -406,25 +436,19 @@ bool SettingsUpdateText(uint32_t index, const char* replace_me)
     return false;  // Setting not supported - internal error
   }
 
+  if ((SET_MQTT_TOPIC == index) || (SET_MQTT_FULLTOPIC == index) ||
+      ((index >= SET_MQTTPREFIX1) && (index < SET_MQTTPREFIX1 + MAX_MQTT_PREFIXES))) {
+    TopicCacheClear();                       // FullTopic, Topic or Prefix changed
+  }
+
   // Make a copy first in case we use source from Settings.text
   uint32_t replace_len = strlen_P(replace_me);
   char replace[replace_len +1];
   memcpy_P(replace, replace_me, sizeof(replace));
 
-  uint32_t start_pos = 0;
-  uint32_t end_pos = 0;
-  char* position = Settings.text_pool;
-  for (uint32_t size = 0; size < SET_MAX; size++) {
-    while (*position++ != '\0') { }
-    if (1 == index) {
-      start_pos = position - Settings.text_pool;
-    }
-    else if (0 == index) {
-      end_pos = position - Settings.text_pool -1;
-    }
-    index--;
-  }
-  uint32_t char_len = position - Settings.text_pool;
+  uint32_t start_pos = SettingsTextIdx.offset[index];
+  uint32_t end_pos = start_pos + strlen(Settings.text_pool + start_pos);
+  uint32_t char_len = SettingsTextIdx.length;
 
   uint32_t current_len = end_pos - start_pos;
   int diff = replace_len - current_len;
@@ -441,6 +465,10 @@ bool SettingsUpdateText(uint32_t index, const char* replace_me)
   if (diff != 0) {
     // Shift Settings.text up or down
     memmove_P(Settings.text_pool + start_pos + replace_len, Settings.text_pool + end_pos, char_len - end_pos);
+    for (uint32_t i = index +1; i < SET_MAX; i++) {
+      SettingsTextIdx.offset[i] += diff;
+    }
+    SettingsTextIdx.length += diff;
   }
   // Replace text
   memmove_P(Settings.text_pool + start_pos, replace, replace_len);
@@ -454,16 +482,10 @@ bool SettingsUpdateText(uint32_t index, const char* replace_me)
 
 char* SettingsText(uint32_t index)
 {
-  char* position = Settings.text_pool;
-
   if (index >= SET_MAX) {
-    position += settings_text_size -1;  // Setting not supported - internal error - return empty string
-  } else {
-    for (;index > 0; index--) {
-      while (*position++ != '\0') { }
-    }
+    return Settings.text_pool + settings_text_size -1;  // Setting not supported - internal error - return empty string
   }
-  return position;
+  return Settings.text_pool + SettingsTextIdx.offset[index];
 }
 
 /*********************************************************************************************\
@@ -493,9 +515,12 @@ void SettingsSave(uint8_t rotate)
  */
 #ifndef FIRMWARE_MINIMAL
   UpdateBackwardCompatibility();
-  if ((GetSettingsCrc32() != settings_crc32) || rotate) {
+  if ((GetSettingsChangeCrc32() != settings_crc32) || rotate) {
     if (1 == rotate) {   // Use eeprom flash slot only and disable flash rotate from now on (upgrade)
       stop_flash_rotate = 1;
+#ifdef USE_ENERGY_JOURNAL
+      JournalStop();     // Journal sectors are part of OTA area
+#endif  // USE_ENERGY_JOURNAL
     }
     if (2 == rotate) {   // Use eeprom flash slot and erase next flash slots if stop_flash_rotate is off (default)
       settings_location = SETTINGS_LOCATION +1;
@@ -509,6 +534,9 @@ void SettingsSave(uint8_t rotate)
       }
     }
 
+#ifdef USE_FLASH_WEAR
+    FlashWearFold();     // Save flash wear counted since the previous save
+#endif  // USE_FLASH_WEAR
     Settings.save_flag++;
     if (UtcTime() > START_VALID_TIME) {
       Settings.cfg_timestamp = UtcTime();
@@ -519,32 +547,73 @@ void SettingsSave(uint8_t rotate)
     Settings.cfg_crc = GetSettingsCrc();  // Keep for backward compatibility in case of fall-back just after upgrade
     Settings.cfg_crc32 = GetSettingsCrc32();
 
+    TRACE_EVENT(TRACE_SETTINGS_SAVE, TRACE_BEGIN, settings_location);
 #ifdef ESP8266
-    if (ESP.flashEraseSector(settings_location)) {
+    TRACE_EVENT(TRACE_FLASH_ERASE, TRACE_BEGIN, settings_location);
+    bool erased = ESP.flashEraseSector(settings_location);
+    TRACE_EVENT(TRACE_FLASH_ERASE, TRACE_END, settings_location);
+    if (erased) {
+      TRACE_EVENT(TRACE_FLASH_WRITE, TRACE_BEGIN, settings_location);
       ESP.flashWrite(settings_location * SPI_FLASH_SEC_SIZE, (uint32*)&Settings, sizeof(Settings));
+      TRACE_EVENT(TRACE_FLASH_WRITE, TRACE_END, settings_location);
+      FLASH_WEAR(WEAR_SETTINGS, 1, sizeof(Settings));
     }
 
     if (!stop_flash_rotate && rotate) {
       for (uint32_t i = 1; i < CFG_ROTATES; i++) {
+        TRACE_EVENT(TRACE_FLASH_ERASE, TRACE_BEGIN, settings_location -i);
         ESP.flashEraseSector(settings_location -i);  // Delete previous configurations by resetting to 0xFF
+        TRACE_EVENT(TRACE_FLASH_ERASE, TRACE_END, settings_location -i);
+        FLASH_WEAR(WEAR_SETTINGS, 1, 0);
         delay(1);
       }
     }
     AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_CONFIG D_SAVED_TO_FLASH_AT " %X, " D_COUNT " %d, " D_BYTES " %d"), settings_location, Settings.save_flag, sizeof(Settings));
 #else  // ESP32
     SettingsWrite(&Settings, sizeof(Settings));
+    FLASH_WEAR_LEVELED(WEAR_SETTINGS, sizeof(Settings));
     AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_CONFIG "Saved, " D_COUNT " %d, " D_BYTES " %d"), Settings.save_flag, sizeof(Settings));
 #endif  // ESP8266
+    TRACE_EVENT(TRACE_SETTINGS_SAVE, TRACE_END, settings_location);
 
-    settings_crc32 = Settings.cfg_crc32;
+    settings_crc32 = GetSettingsChangeCrc32();
+#ifdef USE_ENERGY_JOURNAL
+    JournalSave(true);   // Record values and save_flag matching this save
+#endif  // USE_ENERGY_JOURNAL
+  }
+#ifdef USE_ENERGY_JOURNAL
+  else {
+    JournalSave(true);   // Only journal values like power state and energy changed
   }
+#endif  // USE_ENERGY_JOURNAL
 #endif  // FIRMWARE_MINIMAL
   RtcSettingsSave();
 }
 
+#if defined(ESP8266) && defined(USE_DEEPSLEEP)
+bool SettingsLoadResume(void)
+{
+  // Load settings from the slot recorded before deepsleep instead of checking all slots
+  if (ResetReason() != REASON_DEEP_SLEEP_AWAKE) { return false; }
+  TRtcSettings rtc;
+  ESP.rtcUserMemoryRead(100, (uint32_t*)&rtc, sizeof(rtc));
+  if ((rtc.valid != RTC_MEM_VALID) ||
+      (rtc.settings_location <= (SETTINGS_LOCATION - CFG_ROTATES)) || (rtc.settings_location > SETTINGS_LOCATION)) { return false; }
+
+  ESP.flashRead(rtc.settings_location * SPI_FLASH_SEC_SIZE, (uint32*)&Settings, sizeof(Settings));
+  if ((Settings.save_flag != rtc.settings_save_flag) || (Settings.cfg_crc32 != rtc.settings_crc32)) { return false; }
+  settings_location = rtc.settings_location;
+  AddLog_P2(LOG_LEVEL_NONE, PSTR(D_LOG_CONFIG D_LOADED_FROM_FLASH_AT " %X, " D_COUNT " %lu"), settings_location, Settings.save_flag);
+  return true;
+}
+#endif  // ESP8266 and USE_DEEPSLEEP
+
 void SettingsLoad(void)
 {
 #ifdef ESP8266
+#ifdef USE_DEEPSLEEP
+  if (!SettingsLoadResume()) {
+#endif  // USE_DEEPSLEEP
   // Load configuration from eeprom or one of 7 slots below if first valid load does not stop_flash_rotate
   struct {
     uint16_t cfg_holder;                     // 000
@@ -587,16 +656,20 @@ void SettingsLoad(void)
     ESP.flashRead(settings_location * SPI_FLASH_SEC_SIZE, (uint32*)&Settings, sizeof(Settings));
     AddLog_P2(LOG_LEVEL_NONE, PSTR(D_LOG_CONFIG D_LOADED_FROM_FLASH_AT " %X, " D_COUNT " %lu"), settings_location, Settings.save_flag);
   }
+#ifdef USE_DEEPSLEEP
+  }
+#endif  // USE_DEEPSLEEP
 #else  // ESP32
   SettingsRead(&Settings, sizeof(Settings));
   AddLog_P2(LOG_LEVEL_NONE, PSTR(D_LOG_CONFIG "Loaded, " D_COUNT " %lu"), Settings.save_flag);
 #endif  // ESP8266 - ESP32
+  SettingsTextIndex();
 
 #ifndef FIRMWARE_MINIMAL
   if (!settings_location || (Settings.cfg_holder != (uint16_t)CFG_HOLDER)) {  // Init defaults if cfg_holder differs from user settings in my_user_config.h
     SettingsDefault();
   }
-  settings_crc32 = GetSettingsCrc32();
+  settings_crc32 = GetSettingsChangeCrc32();
 #endif  // FIRMWARE_MINIMAL
 
   RtcSettingsLoad();
@@ -607,7 +680,9 @@ void EspErase(uint32_t start_sector, uint32_t end_sector)
   bool serial_output = (LOG_LEVEL_DEBUG_MORE <= seriallog_level);
   for (uint32_t sector = start_sector; sector < end_sector; sector++) {
 
+    TRACE_EVENT(TRACE_FLASH_ERASE, TRACE_BEGIN, sector);
     bool result = ESP.flashEraseSector(sector);  // Arduino core - erases flash as seen by SDK
+    TRACE_EVENT(TRACE_FLASH_ERASE, TRACE_END, sector);
 //    bool result = !SPIEraseSector(sector);       // SDK - erases flash as seen by SDK
 //    bool result = EsptoolEraseSector(sector);    // Esptool - erases flash completely (slow)
 
@@ -659,6 +734,11 @@ void SettingsErase(uint8_t type)
     _sectorStart = SETTINGS_LOCATION - CFG_ROTATES;                       // Tasmota and SDK parameter area (0x0F3xxx - 0x0FFFFF)
     _sectorEnd = ESP.getFlashChipSize() / SPI_FLASH_SEC_SIZE;             // Flash size as seen by SDK
   }
+#ifdef USE_ENERGY_JOURNAL
+  if ((2 == type) || (3 == type)) {
+    _sectorStart = JournalLocation();                                     // Include energy journal (0x0F1xxx - 0x0F2FFF)
+  }
+#endif  // USE_ENERGY_JOURNAL
   else if (4 == type) {
 //    _sectorStart = (ESP.getFlashChipSize() / SPI_FLASH_SEC_SIZE) - 4;     // SDK phy area and Core calibration sector (0x0FC000)
     _sectorStart = SETTINGS_LOCATION +1;                                  // SDK phy area and Core calibration sector (0x0FC000)
@@ -702,6 +782,7 @@ void SettingsDefault(void)
 void SettingsDefaultSet1(void)
 {
   memset(&Settings, 0x00, sizeof(Settings));
+  SettingsTextIndex();
 
   Settings.cfg_holder = (uint16_t)CFG_HOLDER;
   Settings.cfg_size = sizeof(Settings);
@@ -714,6 +795,7 @@ void SettingsDefaultSet1(void)
 void SettingsDefaultSet2(void)
 {
   memset((char*)&Settings +16, 0x00, sizeof(Settings) -16);
+  SettingsTextIndex();
 
   // this little trick allows GCC to optimize the assignment by grouping values and doing only ORs
   SysBitfield   flag = { 0 };
@@ -1337,6 +1419,7 @@ void SettingsDelta(void)
       char temp13[strlen(Settings.ex_mqtt_grptopic) +1];  strncpy(temp13, Settings.ex_mqtt_grptopic, sizeof(temp13));
 
       memset(Settings.text_pool, 0x00, settings_text_size);
+      SettingsTextIndex();
       SettingsUpdateText(SET_OTAURL, temp);
       SettingsUpdateText(SET_MQTTPREFIX1, temp21);
       SettingsUpdateText(SET_MQTTPREFIX2, temp22);
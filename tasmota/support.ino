@@ -22,6 +22,9 @@ uint32_t syslog_host_hash = 0;   // Syslog host name hash
 
 extern "C" {
 extern struct rst_info resetInfo;
+#ifdef ESP8266
+extern void analogWritePhaseShift(bool enable);
+#endif  // ESP8266
 }
 
 /*********************************************************************************************\
@@ -35,6 +38,8 @@ Ticker tickerOSWatch;
 const uint32_t OSWATCH_RESET_TIME = 120;
 
 static unsigned long oswatch_last_loop_time;
+uint32_t oswatch_loop_last = 0;            // mS of the last loop() period
+uint32_t oswatch_loop_max = 0;             // Max mS of a loop() period since restart
 uint8_t oswatch_blocked_loop = 0;
 
 #ifndef USE_WS2812_DMA  // Collides with Neopixelbus but solves exception
@@ -78,7 +83,12 @@ void OsWatchInit(void)
 
 void OsWatchLoop(void)
 {
-  oswatch_last_loop_time = millis();
+  uint32_t now = millis();
+  oswatch_loop_last = now - oswatch_last_loop_time;
+  if ((oswatch_loop_last > oswatch_loop_max) && (uptime > 4)) {  // Skip setup() and the first loops
+    oswatch_loop_max = oswatch_loop_last;
+  }
+  oswatch_last_loop_time = now;
 //  while(1) delay(1000);  // this will trigger the os watch
 }
 
@@ -257,6 +267,7 @@ char* dtostrfd(double number, unsigned char prec, char *s)
     strcpy(s, "null");
     return s;
   } else {
+    if (FloatToString(s, number, prec)) { return s; }
     return dtostrf(number, 1, prec, s);
   }
 }
@@ -379,11 +390,12 @@ char* UpperCase(char* dest, const char* source)
 char* UpperCase_P(char* dest, const char* source)
 {
   char* write = dest;
-  const char* read = source;
+  PGM_READER read;
+  PgmReadInit(&read, source);
   char ch = '.';
 
   while (ch != '\0') {
-    ch = pgm_read_byte(read++);
+    ch = PgmRead(&read);
     *write++ = toupper(ch);
   }
   return dest;
@@ -607,6 +619,14 @@ float ConvertTemp(float c)
   return result;
 }
 
+void TempSensorReading(uint32_t sensor, float c)
+{
+  // New reading in Celsius of a local temperature sensor for drivers using it without parsing JSON
+#ifdef USE_THERMOSTAT
+  ThermostatSensorReading(sensor, c);
+#endif  // USE_THERMOSTAT
+}
+
 float ConvertTempToCelsius(float c)
 {
   float result = c;
@@ -719,12 +739,47 @@ uint32_t RoundSqrtInt(uint32_t num)
   return s / 2;
 }
 
+/*********************************************************************************************\
+ * PROGMEM string reader
+ *
+ * Every pgm_read_byte() is a 32-bit flash read plus shift on ESP8266. PgmRead() reads each
+ * aligned word once and returns its characters one by one. It never reads beyond the word
+ * holding the last returned character so it is safe for strings in RAM too.
+\*********************************************************************************************/
+
+struct PGM_READER {
+  const uint32_t *next;                     // Next aligned word
+  uint32_t data;                            // Remaining characters of current word
+  uint8_t left;                             // Number of remaining characters
+};
+
+void PgmReadInit(struct PGM_READER *reader, const char* text)
+{
+  uint32_t skip = (uint32_t)text & 3;
+  reader->next = (const uint32_t*)(text - skip);
+  reader->data = pgm_read_dword(reader->next++) >> (skip * 8);
+  reader->left = 4 - skip;
+}
+
+inline char PgmRead(struct PGM_READER *reader)
+{
+  if (!reader->left) {
+    reader->data = pgm_read_dword(reader->next++);
+    reader->left = 4;
+  }
+  char ch = reader->data & 0xFF;
+  reader->data >>= 8;
+  reader->left--;
+  return ch;
+}
+
 char* GetTextIndexed(char* destination, size_t destination_size, uint32_t index, const char* haystack)
 {
   // Returns empty string if not found
   // Returns text of found
   char* write = destination;
-  const char* read = haystack;
+  PGM_READER read;
+  PgmReadInit(&read, haystack);
 
   index++;
   while (index--) {
@@ -732,7 +787,7 @@ char* GetTextIndexed(char* destination, size_t destination_size, uint32_t index,
     write = destination;
     char ch = '.';
     while ((ch != '\0') && (ch != '|')) {
-      ch = pgm_read_byte(read++);
+      ch = PgmRead(&read);
       if (size && (ch != '|'))  {
         *write++ = ch;
         size--;
@@ -754,7 +809,8 @@ int GetCommandCode(char* destination, size_t destination_size, const char* needl
   // Returns -1 of not found
   // Returns index and command if found
   int result = -1;
-  const char* read = haystack;
+  PGM_READER read;
+  PgmReadInit(&read, haystack);
   char* write = destination;
 
   while (true) {
@@ -763,7 +819,7 @@ int GetCommandCode(char* destination, size_t destination_size, const char* needl
     write = destination;
     char ch = '.';
     while ((ch != '\0') && (ch != '|')) {
-      ch = pgm_read_byte(read++);
+      ch = PgmRead(&read);
       if (size && (ch != '|'))  {
         *write++ = ch;
         size--;
@@ -886,6 +942,22 @@ void ClaimSerial(void)
   Settings.baudrate = Serial.baudRate() / 300;
 }
 
+void TasmotaSerialState(void)
+{
+  // Receive buffer size and overflows of active serial drivers
+  bool first = true;
+  for (uint32_t i = 0; i < TM_SERIAL_MAX_INSTANCES; i++) {
+    TasmotaSerial *serial = TasmotaSerial::getInstance(i);
+    if (!serial) { continue; }
+    ResponseAppend_P(PSTR("%s{\"Rx\":%d,\"Tx\":%d,\"Buffer\":%d,\"Overflow\":%u}"),
+      (first) ? ",\"Serial\":[" : ",", serial->getRxPin(), serial->getTxPin(), serial->getBufferSize(), serial->getOverflowCount());
+    first = false;
+  }
+  if (!first) {
+    ResponseAppend_P(PSTR("]"));
+  }
+}
+
 void SerialSendRaw(char *codes)
 {
   char *p;
@@ -1005,13 +1077,285 @@ char* ResponseGetTime(uint32_t format, char* time_str)
   return time_str;
 }
 
+/*********************************************************************************************\
+ * Response formatting
+ *
+ * ext_vsnprintf_P() adds %_f to the standard conversions for a float passed by reference, which
+ * avoids the promotion to double. %3_f prints 3 decimals and %*_f takes the decimals from an int
+ * argument. The default is 2 decimals. Other conversions are passed on to snprintf one at a time.
+\*********************************************************************************************/
+
+int ext_vsnprintf_P(char* buffer, size_t size, const char* format, va_list va)
+{
+  uint32_t pos = 0;
+  char spec[24];
+
+  while (char ch = pgm_read_byte(format++)) {
+    if (ch != '%') {
+      if (pos +1 < size) { buffer[pos] = ch; }
+      pos++;
+      continue;
+    }
+    // Collect the conversion specification in RAM with * replaced by its argument
+    uint32_t slen = 0;
+    spec[slen++] = '%';
+    bool dec_arg = false;
+    int decimals = -1;
+    char length = 0;
+    char conv = 0;
+    while ((ch = pgm_read_byte(format)) && (slen < sizeof(spec) -12)) {
+      format++;
+      if ('*' == ch) {
+        if ('_' == pgm_read_byte(format)) {
+          decimals = va_arg(va, int);
+          dec_arg = true;
+        } else {
+          slen += snprintf_P(spec + slen, sizeof(spec) - slen, PSTR("%d"), va_arg(va, int));
+        }
+        continue;
+      }
+      if ('_' == ch) {
+        if ('f' == pgm_read_byte(format)) {
+          format++;
+          conv = '_';
+          break;
+        }
+        continue;
+      }
+      spec[slen++] = ch;
+      if (strchr_P(PSTR("hlLqjzt"), ch)) {
+        length = (('l' == ch) && ('l' == length)) ? 'q' : ch;
+      }
+      else if (!strchr_P(PSTR("-+ #0123456789."), ch)) {
+        conv = ch;
+        break;
+      }
+    }
+    spec[slen] = '\0';
+    char* out = (pos +1 < size) ? buffer + pos : nullptr;
+    size_t space = (out) ? size - pos : 0;
+    int len = 0;
+
+    switch (conv) {
+      case '_': {
+        float* value = va_arg(va, float*);
+        if (!dec_arg) {
+          decimals = (slen > 1) ? atoi(spec +1) : 2;
+        }
+        char number[FLOATSZ +12];
+        dtostrfd((value) ? *value : NAN, decimals, number);
+        len = strlen(number);
+        if (out) { strlcpy(out, number, space); }
+        break;
+      }
+      case '%':
+        len = 1;
+        if (out) { strlcpy(out, "%", space); }
+        break;
+      case 'd': case 'i': case 'c':
+        if ('q' == length) { len = snprintf(out, space, spec, va_arg(va, long long)); }
+        else if ('l' == length) { len = snprintf(out, space, spec, va_arg(va, long)); }
+        else { len = snprintf(out, space, spec, va_arg(va, int)); }
+        break;
+      case 'u': case 'o': case 'x': case 'X':
+        if ('q' == length) { len = snprintf(out, space, spec, va_arg(va, unsigned long long)); }
+        else if ('l' == length) { len = snprintf(out, space, spec, va_arg(va, unsigned long)); }
+        else { len = snprintf(out, space, spec, va_arg(va, unsigned int)); }
+        break;
+      case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+        len = snprintf(out, space, spec, va_arg(va, double));
+        break;
+      case 's':
+        len = snprintf(out, space, spec, va_arg(va, char*));
+        break;
+      case 'p':
+        len = snprintf(out, space, spec, va_arg(va, void*));
+        break;
+      case 'n':
+        va_arg(va, int*);
+        break;
+      default:                              // Incomplete specification at end of format
+        len = slen;
+        if (out) { strlcpy(out, spec, space); }
+        break;
+    }
+    if (len > 0) { pos += len; }
+  }
+  if (size) { buffer[(pos < size) ? pos : size -1] = '\0'; }
+  return pos;
+}
+
+int ext_snprintf_P(char* buffer, size_t size, const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int len = ext_vsnprintf_P(buffer, size, format, args);
+  va_end(args);
+  return len;
+}
+
+/*********************************************************************************************\
+ * Response buffer
+ *
+ * The Response functions keep the length of the text in mqtt_data so appends do not scan it.
+ * Code clearing mqtt_data uses ResponseClear(). Code writing text into mqtt_data directly calls
+ * ResponseSetLength() after so the next ResponseAppend_P() starts at the end of that text.
+ * An append that does not fit is left out as a whole and logged instead of cutting a JSON value.
+\*********************************************************************************************/
+
+struct {
+  uint32_t length = 0;                      // Length of the text in mqtt_data
+  bool truncated = false;                   // Text was left out since the last Response_P
+} ResponseBuffer;
+
+uint32_t ResponseLength(void)
+{
+  return ResponseBuffer.length;
+}
+
+void ResponseSetLength(uint32_t len)
+{
+  ResponseBuffer.length = (len < sizeof(mqtt_data)) ? len : sizeof(mqtt_data) -1;
+}
+
+void ResponseClear(void)
+{
+  mqtt_data[0] = '\0';
+  ResponseBuffer.length = 0;
+  ResponseBuffer.truncated = false;
+}
+
+bool ResponseTruncated(void)
+{
+  return ResponseBuffer.truncated;
+}
+
+void ResponseFit(uint32_t mlen, int len)
+{
+  // Keep track of the text written by vsnprintf_P at mlen
+  if (len < 0) { len = 0; }
+  uint32_t total = mlen + len;
+  if (total < sizeof(mqtt_data)) {
+    ResponseBuffer.length = mlen + len;
+    return;
+  }
+  if (mlen) {
+    mqtt_data[mlen] = '\0';                 // Leave out the text that does not fit
+  } else {
+    mlen = sizeof(mqtt_data) -1;            // Nothing to keep intact so send what fits
+  }
+  ResponseBuffer.length = mlen;
+  if (!ResponseBuffer.truncated) {
+    ResponseBuffer.truncated = true;
+    AddLog_P2(LOG_LEVEL_INFO, PSTR("APP: Response too large, %d of %d characters sent"), mlen, total);
+  }
+}
+
+/*********************************************************************************************\
+ * Response streaming
+ *
+ * ResponseStreamRun() executes a response generator using Response_P and ResponseAppend_P as
+ * usual. If mqtt_data fills up, pending text is moved to a heap buffer instead of being truncated.
+ * The generator runs only once. A response larger than mqtt_data is kept complete in the buffer
+ * and returned by ResponseStreamPayload() until ResponseStreamFree() is called.
+\*********************************************************************************************/
+
+struct RESPONSE_STREAM {
+  char* data = nullptr;                     // Flushed text and, after the run, the complete response
+  const char* watch = nullptr;              // Optional PROGMEM list of keys searched for by ResponseContains()
+  uint32_t length = 0;                      // Number of flushed bytes
+  uint32_t size = 0;                        // Allocated size of data
+  bool failed = false;                      // Out of memory so flushed text was lost
+  bool active = false;
+} ResponseStream;
+
+void ResponseStreamFlush(void)
+{
+  uint32_t len = ResponseLength();
+  if (!len) { return; }
+
+  if (!ResponseStream.failed && (ResponseStream.length + len >= ResponseStream.size)) {
+    uint32_t size = ResponseStream.size + ((len < sizeof(mqtt_data)) ? sizeof(mqtt_data) : len +1);
+    char* data = (char*)realloc(ResponseStream.data, size);
+    if (data) {
+      ResponseStream.data = data;
+      ResponseStream.size = size;
+    } else {
+      ResponseStream.failed = true;
+    }
+  }
+  if (!ResponseStream.failed) {
+    memcpy(ResponseStream.data + ResponseStream.length, mqtt_data, len +1);
+  }
+  ResponseStream.length += len;
+  mqtt_data[0] = '\0';
+  ResponseBuffer.length = 0;
+}
+
+void ResponseStreamFree(void)
+{
+  free(ResponseStream.data);
+  ResponseStream.data = nullptr;
+  ResponseStream.length = 0;
+  ResponseStream.size = 0;
+  ResponseStream.failed = false;
+}
+
+bool ResponseStreamRun(bool (*generator)(void))
+{
+  // Returns generator result. ResponseStream.length is zero if the complete response fits in mqtt_data
+  ResponseStreamFree();
+  ResponseStream.active = true;
+  ResponseStream.watch = nullptr;
+  ResponseClear();
+  bool result = generator();
+  if (ResponseStream.length) { ResponseStreamFlush(); }
+  ResponseStream.active = false;
+  ResponseStream.watch = nullptr;
+  if (ResponseStream.failed) {
+    AddLog_P2(LOG_LEVEL_INFO, PSTR("APP: Response too large, %d characters lost"), ResponseStream.length);
+    ResponseStreamFree();
+    return false;
+  }
+  return result;
+}
+
+uint32_t ResponseStreamLength(void)
+{
+  // Length of the response generated so far
+  return ((ResponseStream.active) ? ResponseStream.length : 0) + ResponseLength();
+}
+
+char* ResponseStreamPayload(void)
+{
+  // Complete response of the last ResponseStreamRun() or mqtt_data if it fitted
+  return (ResponseStream.data) ? ResponseStream.data : mqtt_data;
+}
+
+void ResponseWatch(const char* keys)
+{
+  // Keys is a PROGMEM list of up to eight "|" separated keys
+  ResponseStream.watch = keys;
+}
+
+bool ResponseContains(uint32_t index)
+{
+  // Search watched key in both flushed and pending response text
+  char key[33];
+  GetTextIndexed(key, sizeof(key), index, ResponseStream.watch);
+  if (ResponseStream.length && !ResponseStream.failed && (strstr(ResponseStream.data, key) != nullptr)) { return true; }
+  return (strstr(mqtt_data, key) != nullptr);
+}
+
 int Response_P(const char* format, ...)        // Content send snprintf_P char data
 {
-  // This uses char strings. Be aware of sending %% if % is needed
+  // This uses char strings. Be aware of sending %% if % is needed. Use %_f for a float pointer
   va_list args;
   va_start(args, format);
-  int len = vsnprintf_P(mqtt_data, sizeof(mqtt_data), format, args);
+  int len = ext_vsnprintf_P(mqtt_data, sizeof(mqtt_data), format, args);
   va_end(args);
+  ResponseBuffer.truncated = false;
+  ResponseFit(0, len);
   return len;
 }
 
@@ -1024,8 +1368,10 @@ int ResponseTime_P(const char* format, ...)    // Content send snprintf_P char d
   ResponseGetTime(Settings.flag2.time_format, mqtt_data);
 
   int mlen = strlen(mqtt_data);
-  int len = vsnprintf_P(mqtt_data + mlen, sizeof(mqtt_data) - mlen, format, args);
+  int len = ext_vsnprintf_P(mqtt_data + mlen, sizeof(mqtt_data) - mlen, format, args);
   va_end(args);
+  ResponseBuffer.truncated = false;
+  ResponseFit(mlen, len);
   return len + mlen;
 }
 
@@ -1034,9 +1380,24 @@ int ResponseAppend_P(const char* format, ...)  // Content send snprintf_P char d
   // This uses char strings. Be aware of sending %% if % is needed
   va_list args;
   va_start(args, format);
-  int mlen = strlen(mqtt_data);
-  int len = vsnprintf_P(mqtt_data + mlen, sizeof(mqtt_data) - mlen, format, args);
+  int mlen = ResponseLength();
+  int len;
+  if (ResponseStream.active) {
+    va_list args_copy;
+    va_copy(args_copy, args);
+    len = ext_vsnprintf_P(mqtt_data + mlen, sizeof(mqtt_data) - mlen, format, args);
+    if (mlen && (mlen + len >= sizeof(mqtt_data))) {  // Does not fit so flush pending text and retry
+      mqtt_data[mlen] = '\0';
+      ResponseStreamFlush();
+      mlen = 0;
+      len = ext_vsnprintf_P(mqtt_data, sizeof(mqtt_data), format, args_copy);
+    }
+    va_end(args_copy);
+  } else {
+    len = ext_vsnprintf_P(mqtt_data + mlen, sizeof(mqtt_data) - mlen, format, args);
+  }
   va_end(args);
+  ResponseFit(mlen, len);
   return len + mlen;
 }
 
@@ -1053,14 +1414,12 @@ int ResponseAppendTime(void)
 
 int ResponseAppendTHD(float f_temperature, float f_humidity)
 {
-  char temperature[FLOATSZ];
-  dtostrfd(f_temperature, Settings.flag2.temperature_resolution, temperature);
-  char humidity[FLOATSZ];
-  dtostrfd(f_humidity, Settings.flag2.humidity_resolution, humidity);
-  char dewpoint[FLOATSZ];
-  dtostrfd(CalcTempHumToDew(f_temperature, f_humidity), Settings.flag2.temperature_resolution, dewpoint);
+  float f_dewpoint = CalcTempHumToDew(f_temperature, f_humidity);
 
-  return ResponseAppend_P(PSTR("\"" D_JSON_TEMPERATURE "\":%s,\"" D_JSON_HUMIDITY "\":%s,\"" D_JSON_DEWPOINT "\":%s"), temperature, humidity, dewpoint);
+  return ResponseAppend_P(PSTR("\"" D_JSON_TEMPERATURE "\":%*_f,\"" D_JSON_HUMIDITY "\":%*_f,\"" D_JSON_DEWPOINT "\":%*_f"),
+    Settings.flag2.temperature_resolution, &f_temperature,
+    Settings.flag2.humidity_resolution, &f_humidity,
+    Settings.flag2.temperature_resolution, &f_dewpoint);
 }
 
 int ResponseJsonEnd(void)
@@ -1073,10 +1432,147 @@ int ResponseJsonEndEnd(void)
   return ResponseAppend_P(PSTR("}}"));
 }
 
+/*********************************************************************************************\
+ * JSON parse arena
+ *
+ * JsonParseBuffer is the DynamicJsonBuffer for temporary parse trees. With USE_JSON_ARENA its
+ * blocks are taken from one arena allocated on first use and kept, in PSRAM when found on ESP32.
+ * A block is returned when its buffer goes out of scope. The arena rewinds past the newest block
+ * and is reset when no block is in use, so nested parsers such as a rule executing a command share
+ * it without heap allocations. Blocks not fitting the arena are taken from the heap.
+\*********************************************************************************************/
+
+#ifdef USE_JSON_ARENA
+#ifndef JSON_ARENA_SIZE
+#ifdef ESP8266
+#define JSON_ARENA_SIZE        1536         // Fits DynamicJsonBuffer blocks of 256 and 512 plus 256 and 256 of a nested parser
+#else
+#define JSON_ARENA_SIZE        8192
+#endif
+#endif
+
+struct {
+  uint8_t *base = nullptr;
+  uint32_t top = 0;                         // Offset of first free byte
+  uint32_t high = 0;                        // High water mark of top
+  uint32_t heap = 0;                        // Number of blocks taken from the heap
+  uint16_t blocks = 0;                      // Number of blocks in use in the arena
+} JsonArena;
+
+void* JsonArenaAlloc(size_t size)
+{
+  if (!JsonArena.base) {
+#ifdef ESP32
+    if (psramFound()) {
+      JsonArena.base = (uint8_t*)heap_caps_malloc(JSON_ARENA_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+#endif  // ESP32
+    if (!JsonArena.base) {
+      JsonArena.base = (uint8_t*)malloc(JSON_ARENA_SIZE);
+    }
+  }
+  uint32_t block_size = (sizeof(uint32_t) + size + 3) & ~3;  // Size header and 32-bit alignment
+  if (JsonArena.base && (JsonArena.top + block_size <= JSON_ARENA_SIZE)) {
+    uint32_t *block = (uint32_t*)(JsonArena.base + JsonArena.top);
+    *block = block_size;
+    JsonArena.top += block_size;
+    if (JsonArena.top > JsonArena.high) { JsonArena.high = JsonArena.top; }
+    JsonArena.blocks++;
+    return block +1;
+  }
+  JsonArena.heap++;
+  return malloc(size);
+}
+
+void JsonArenaFree(void* pointer)
+{
+  uint8_t *data = (uint8_t*)pointer;
+  if (!JsonArena.base || (data < JsonArena.base) || (data >= JsonArena.base + JSON_ARENA_SIZE)) {
+    free(pointer);
+    return;
+  }
+  uint32_t *block = (uint32_t*)data -1;
+  if ((uint8_t*)block + *block == JsonArena.base + JsonArena.top) {
+    JsonArena.top -= *block;                // Newest block
+  }
+  JsonArena.blocks--;
+  if (!JsonArena.blocks) { JsonArena.top = 0; }
+}
+
+void JsonArenaStatus(void)
+{
+  ResponseAppend_P(PSTR(",\"JsonArena\":{\"Size\":%d,\"Used\":%d,\"Max\":%d,\"Heap\":%u}"),
+    (JsonArena.base) ? JSON_ARENA_SIZE : 0, JsonArena.top, JsonArena.high, JsonArena.heap);
+}
+
+class JsonArenaAllocator {
+ public:
+  void* allocate(size_t size) {
+    return JsonArenaAlloc(size);
+  }
+  void deallocate(void* pointer) {
+    JsonArenaFree(pointer);
+  }
+};
+
+typedef ArduinoJson::Internals::DynamicJsonBufferBase<JsonArenaAllocator> JsonParseBuffer;
+
+template <size_t CAPACITY>
+class JsonTempBuffer : public JsonParseBuffer {  // Replaces a StaticJsonBuffer on the stack by one arena block
+ public:
+  JsonTempBuffer() : JsonParseBuffer(CAPACITY) {}
+};
+#else
+typedef DynamicJsonBuffer JsonParseBuffer;
+
+template <size_t CAPACITY>
+using JsonTempBuffer = StaticJsonBuffer<CAPACITY>;
+#endif  // USE_JSON_ARENA
+
 /*********************************************************************************************\
  * GPIO Module and Template management
+ *
+ * GpioMap is rebuilt by SetPin() so Pin() does not scan gpio_pin[]. On ESP8266 every function
+ * index has its own enum and the map holds the pin. On ESP32 the map holds the first entry of a
+ * function in a list of all pins sorted by gpio_pin value so only pins of that function are
+ * compared. Map entries are one higher than the pin or list entry, zero if not used.
 \*********************************************************************************************/
 
+struct {
+  uint8_t first[GPIO_SENSOR_END];           // ESP8266 pin +1, ESP32 list entry +1
+#ifdef ESP32
+  uint16_t gpio[MAX_GPIO_PIN];              // gpio_pin values in ascending order
+  uint8_t pin[MAX_GPIO_PIN];                // Lowest pin first for equal values
+#endif  // ESP32
+} GpioMap;
+
+void GpioMapBuild(void) {
+  memset(GpioMap.first, 0, sizeof(GpioMap.first));
+#ifdef ESP8266
+  for (uint32_t i = ARRAY_SIZE(gpio_pin); i > 0; i--) {   // Lowest pin wins
+    if (gpio_pin[i -1] < GPIO_SENSOR_END) {
+      GpioMap.first[gpio_pin[i -1]] = i;
+    }
+  }
+#else  // ESP32
+  for (uint32_t i = 0; i < ARRAY_SIZE(gpio_pin); i++) {    // Insertion sort keeping pin order
+    uint32_t j = i;
+    for (; (j > 0) && (GpioMap.gpio[j -1] > gpio_pin[i]); j--) {
+      GpioMap.gpio[j] = GpioMap.gpio[j -1];
+      GpioMap.pin[j] = GpioMap.pin[j -1];
+    }
+    GpioMap.gpio[j] = gpio_pin[i];
+    GpioMap.pin[j] = i;
+  }
+  for (uint32_t i = ARRAY_SIZE(gpio_pin); i > 0; i--) {
+    uint32_t function = GpioMap.gpio[i -1] >> 5;
+    if (function < GPIO_SENSOR_END) {
+      GpioMap.first[function] = i;
+    }
+  }
+#endif  // ESP8266 - ESP32
+}
+
 #ifndef ARDUINO_ESP8266_RELEASE_2_3_0  // Fix core 2.5.x ISR not in IRAM Exception
 uint32_t Pin(uint32_t gpio, uint32_t index) ICACHE_RAM_ATTR;
 #endif
@@ -1085,10 +1581,25 @@ uint32_t Pin(uint32_t gpio, uint32_t index = 0);
 uint32_t Pin(uint32_t gpio, uint32_t index) {
 #ifdef ESP8266
   uint16_t real_gpio = gpio + index;
+  if (real_gpio < GPIO_SENSOR_END) {
+    uint32_t pin = GpioMap.first[real_gpio];
+    return (pin) ? pin -1 : 99;
+  }
 #else  // ESP32
   uint16_t real_gpio = (gpio << 5) + index;
+  if (gpio < GPIO_SENSOR_END) {
+    uint32_t entry = GpioMap.first[gpio];
+    if (entry) {
+      for (entry--; (entry < ARRAY_SIZE(gpio_pin)) && ((GpioMap.gpio[entry] >> 5) == gpio); entry++) {
+        if (GpioMap.gpio[entry] == real_gpio) {
+          return GpioMap.pin[entry];
+        }
+      }
+    }
+    return 99;
+  }
 #endif  // ESP8266 - ESP32
-  for (uint32_t i = 0; i < ARRAY_SIZE(gpio_pin); i++) {
+  for (uint32_t i = 0; i < ARRAY_SIZE(gpio_pin); i++) {   // Functions outside the map
     if (gpio_pin[i] == real_gpio) {
       return i;              // Pin number configured for gpio
     }
@@ -1101,8 +1612,18 @@ boolean PinUsed(uint32_t gpio, uint32_t index) {
   return (Pin(gpio, index) < 99);
 }
 
+uint32_t PinUsedMask(uint32_t gpio, uint32_t count) {
+  // Bitmask of the indexes of gpio below count with a pin, for drivers iterating used pins only
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (PinUsed(gpio, i)) { mask |= (1 << i); }
+  }
+  return mask;
+}
+
 void SetPin(uint32_t lpin, uint32_t gpio) {
   gpio_pin[lpin] = gpio;
+  GpioMapBuild();
 }
 
 void DigitalWrite(uint32_t gpio_pin, uint32_t index, uint32_t state)
@@ -1342,9 +1863,9 @@ bool JsonTemplate(const char* dataBuf)
   if (strlen(dataBuf) < 9) { return false; }  // Workaround exception if empty JSON like {} - Needs checks
 
 #ifdef ESP8266
-  StaticJsonBuffer<400> jb;  // 331 from https://arduinojson.org/v5/assistant/
+  JsonTempBuffer<400> jb;  // 331 from https://arduinojson.org/v5/assistant/
 #else
-  StaticJsonBuffer<999> jb;  // 654 from https://arduinojson.org/v5/assistant/
+  JsonTempBuffer<999> jb;  // 654 from https://arduinojson.org/v5/assistant/
 #endif
   JsonObject& obj = jb.parseObject(dataBuf);
   if (!obj.success()) { return false; }
@@ -1435,31 +1956,171 @@ bool TimeReachedUsec(uint32_t timer)
 
 #ifdef USE_I2C
 const uint8_t I2C_RETRY_COUNTER = 3;
+const uint8_t I2C_BUS_AUTO = 0xFF;
 
-uint32_t i2c_active[4] = { 0 };
+uint32_t i2c_active[MAX_I2C][4] = { 0 };
+uint32_t i2c_present[MAX_I2C][4] = { 0 };               // Addresses acknowledged by last bus scan
+bool i2c_scanned[MAX_I2C] = { false };
+uint8_t i2c_buses = 0;                                  // Bit per configured bus
+uint8_t i2c_bus_select = I2C_BUS_AUTO;                  // Bus forced by I2cSelectBus()
 uint32_t i2c_buffer = 0;
 
+/*********************************************************************************************\
+ * I2C buses
+ *
+ * ESP32 supports a second bus on Wire1 using I2C SCL2 and I2C SDA2. Drivers using the I2c
+ * functions below find their device on either bus without change: transactions go to the bus
+ * where the address was claimed by I2cSetActive() or else where it acknowledged the last scan.
+ * A driver supporting the same address on both buses selects the bus of each device with
+ * I2cSelectBus(bus) and restores I2cSelectBus(I2C_BUS_AUTO) when done. Drivers using Wire
+ * directly stay on the first bus.
+ *
+ * I2C detection cache
+ *
+ * Each bus is scanned once on first use. Detection of drivers using I2cSetDevice() or reading
+ * from an address not yet claimed by I2cSetActive() is skipped for addresses that did not
+ * acknowledge. Command I2CScan and HotPlug rescan the bus.
+\*********************************************************************************************/
+
+void I2cBegin(void)
+{
+  i2c_buses = 0;
+  if (PinUsed(GPIO_I2C_SCL) && PinUsed(GPIO_I2C_SDA)) {
+    Wire.begin(Pin(GPIO_I2C_SDA), Pin(GPIO_I2C_SCL));
+    i2c_buses |= 1;
+  }
+#ifdef ESP32
+  if (PinUsed(GPIO_I2C_SCL, 1) && PinUsed(GPIO_I2C_SDA, 1)) {
+    Wire1.begin(Pin(GPIO_I2C_SDA, 1), Pin(GPIO_I2C_SCL, 1));
+    i2c_buses |= 2;
+  }
+#endif  // ESP32
+  i2c_flg = (i2c_buses != 0);
+}
+
+bool I2cBusEnabled(uint32_t bus)
+{
+  return (bus < MAX_I2C) && bitRead(i2c_buses, bus);
+}
+
+TwoWire& I2cWire(uint32_t bus)
+{
+#ifdef ESP32
+  if (1 == bus) { return Wire1; }
+#endif  // ESP32
+  return Wire;
+}
+
+void I2cSelectBus(uint32_t bus)
+{
+  i2c_bus_select = (bus < MAX_I2C) ? bus : I2C_BUS_AUTO;
+}
+
+uint32_t I2cScanBus(uint32_t bus)
+{
+  // Returns 0 or bus error code in bits 8..15 and address in bits 0..7
+  uint32_t error = 0;
+  memset(i2c_present[bus], 0, sizeof(i2c_present[bus]));
+  i2c_scanned[bus] = true;
+  if (!I2cBusEnabled(bus)) { return 0; }
+  TwoWire &wire = I2cWire(bus);
+  for (uint32_t address = 1; address <= 127; address++) {
+    wire.beginTransmission((uint8_t)address);
+    uint8_t result = wire.endTransmission();
+    if (0 == result) {
+      i2c_present[bus][address / 32] |= (1 << (address % 32));
+    }
+    else if (result != 2) {  // Seems to happen anyway using this scan
+      error = result << 8 | address;
+      memset(i2c_present[bus], 0xFF, sizeof(i2c_present[bus]));  // Unreliable bus so let drivers probe themselves
+      break;
+    }
+  }
+  return error;
+}
+
+void I2cRescan(void)
+{
+  memset(i2c_scanned, 0, sizeof(i2c_scanned));  // Rescan on next detection
+}
+
+bool I2cPresentOnBus(uint32_t addr, uint32_t bus)
+{
+  if (!i2c_scanned[bus]) {
+    I2cScanBus(bus);
+  }
+  return (i2c_present[bus][addr / 32] & (1 << (addr % 32)));
+}
+
+bool I2cActiveOnBus(uint32_t addr, uint32_t bus)
+{
+  return (i2c_active[bus][addr / 32] & (1 << (addr % 32)));
+}
+
+uint32_t I2cBus(uint32_t addr)
+{
+  // Bus for transactions with addr
+  if (i2c_bus_select != I2C_BUS_AUTO) { return i2c_bus_select; }
+#ifdef ESP32
+  addr &= 0x7F;         // Max I2C address is 127
+  for (uint32_t bus = 0; bus < MAX_I2C; bus++) {
+    if (I2cActiveOnBus(addr, bus)) { return bus; }
+  }
+  for (uint32_t bus = 0; bus < MAX_I2C; bus++) {
+    if (I2cPresentOnBus(addr, bus)) { return bus; }
+  }
+#endif  // ESP32
+  return 0;
+}
+
+uint32_t I2cClaimBus(uint32_t addr)
+{
+  // Bus where a driver detecting addr finds an unclaimed device
+  if (i2c_bus_select != I2C_BUS_AUTO) { return i2c_bus_select; }
+#ifdef ESP32
+  addr &= 0x7F;         // Max I2C address is 127
+  for (uint32_t bus = 0; bus < MAX_I2C; bus++) {
+    if (!I2cActiveOnBus(addr, bus) && I2cPresentOnBus(addr, bus)) { return bus; }
+  }
+#endif  // ESP32
+  return 0;
+}
+
+bool I2cPresent(uint32_t addr)
+{
+  addr &= 0x7F;         // Max I2C address is 127
+  if (i2c_bus_select != I2C_BUS_AUTO) { return I2cPresentOnBus(addr, i2c_bus_select); }
+  for (uint32_t bus = 0; bus < MAX_I2C; bus++) {
+    if (I2cPresentOnBus(addr, bus)) { return true; }
+  }
+  return false;
+}
+
 bool I2cValidRead(uint8_t addr, uint8_t reg, uint8_t size)
 {
   uint8_t retry = I2C_RETRY_COUNTER;
   bool status = false;
 
   i2c_buffer = 0;
+  if (!I2cActive(addr) && !I2cPresent(addr)) {
+    return false;       // Not claimed by a driver and absent in last bus scan
+  }
+  TwoWire &wire = I2cWire(I2cBus(addr));
   while (!status && retry) {
-    Wire.beginTransmission(addr);                       // start transmission to device
-    Wire.write(reg);                                    // sends register address to read from
-    if (0 == Wire.endTransmission(false)) {             // Try to become I2C Master, send data and collect bytes, keep master status for next request...
-      Wire.requestFrom((int)addr, (int)size);           // send data n-bytes read
-      if (Wire.available() == size) {
+    wire.beginTransmission(addr);                       // start transmission to device
+    wire.write(reg);                                    // sends register address to read from
+    if (0 == wire.endTransmission(false)) {             // Try to become I2C Master, send data and collect bytes, keep master status for next request...
+      wire.requestFrom((int)addr, (int)size);           // send data n-bytes read
+      if (wire.available() == size) {
         for (uint32_t i = 0; i < size; i++) {
-          i2c_buffer = i2c_buffer << 8 | Wire.read();   // receive DATA
+          i2c_buffer = i2c_buffer << 8 | wire.read();   // receive DATA
         }
         status = true;
       }
     }
     retry--;
   }
-  if (!retry) Wire.endTransmission();
+  if (!retry) wire.endTransmission();
   return status;
 }
 
@@ -1547,15 +2208,16 @@ bool I2cWrite(uint8_t addr, uint8_t reg, uint32_t val, uint8_t size)
 {
   uint8_t x = I2C_RETRY_COUNTER;
 
+  TwoWire &wire = I2cWire(I2cBus(addr));
   do {
-    Wire.beginTransmission((uint8_t)addr);              // start transmission to device
-    Wire.write(reg);                                    // sends register address to write to
+    wire.beginTransmission((uint8_t)addr);              // start transmission to device
+    wire.write(reg);                                    // sends register address to write to
     uint8_t bytes = size;
     while (bytes--) {
-      Wire.write((val >> (8 * bytes)) & 0xFF);          // write data
+      wire.write((val >> (8 * bytes)) & 0xFF);          // write data
     }
     x--;
-  } while (Wire.endTransmission(true) != 0 && x != 0);  // end transmission
+  } while (wire.endTransmission(true) != 0 && x != 0);  // end transmission
   return (x);
 }
 
@@ -1571,14 +2233,15 @@ bool I2cWrite16(uint8_t addr, uint8_t reg, uint16_t val)
 
 int8_t I2cReadBuffer(uint8_t addr, uint8_t reg, uint8_t *reg_data, uint16_t len)
 {
-  Wire.beginTransmission((uint8_t)addr);
-  Wire.write((uint8_t)reg);
-  Wire.endTransmission();
-  if (len != Wire.requestFrom((uint8_t)addr, (uint8_t)len)) {
+  TwoWire &wire = I2cWire(I2cBus(addr));
+  wire.beginTransmission((uint8_t)addr);
+  wire.write((uint8_t)reg);
+  wire.endTransmission();
+  if (len != wire.requestFrom((uint8_t)addr, (uint8_t)len)) {
     return 1;
   }
   while (len--) {
-    *reg_data = (uint8_t)Wire.read();
+    *reg_data = (uint8_t)wire.read();
     reg_data++;
   }
   return 0;
@@ -1586,17 +2249,18 @@ int8_t I2cReadBuffer(uint8_t addr, uint8_t reg, uint8_t *reg_data, uint16_t len)
 
 int8_t I2cWriteBuffer(uint8_t addr, uint8_t reg, uint8_t *reg_data, uint16_t len)
 {
-  Wire.beginTransmission((uint8_t)addr);
-  Wire.write((uint8_t)reg);
+  TwoWire &wire = I2cWire(I2cBus(addr));
+  wire.beginTransmission((uint8_t)addr);
+  wire.write((uint8_t)reg);
   while (len--) {
-    Wire.write(*reg_data);
+    wire.write(*reg_data);
     reg_data++;
   }
-  Wire.endTransmission();
+  wire.endTransmission();
   return 0;
 }
 
-void I2cScan(char *devs, unsigned int devs_len)
+void I2cScan(char *devs, unsigned int devs_len, uint32_t bus)
 {
   // Return error codes defined in twi.h and core_esp8266_si2c.c
   // I2C_OK                      0
@@ -1605,22 +2269,19 @@ void I2cScan(char *devs, unsigned int devs_len)
   // I2C_SDA_HELD_LOW            3 = I2C bus error. SDA line held low by slave/another_master after n bits
   // I2C_SDA_HELD_LOW_AFTER_INIT 4 = line busy. SDA again held low by another device. 2nd master?
 
-  uint8_t error = 0;
-  uint8_t address = 0;
+  uint32_t error = I2cScanBus(bus);
   uint8_t any = 0;
 
   snprintf_P(devs, devs_len, PSTR("{\"" D_CMND_I2CSCAN "\":\"" D_JSON_I2CSCAN_DEVICES_FOUND_AT));
-  for (address = 1; address <= 127; address++) {
-    Wire.beginTransmission(address);
-    error = Wire.endTransmission();
-    if (0 == error) {
-      any = 1;
-      snprintf_P(devs, devs_len, PSTR("%s 0x%02x"), devs, address);
-    }
-    else if (error != 2) {  // Seems to happen anyway using this scan
-      any = 2;
-      snprintf_P(devs, devs_len, PSTR("{\"" D_CMND_I2CSCAN "\":\"Error %d at 0x%02x"), error, address);
-      break;
+  if (error) {
+    any = 2;
+    snprintf_P(devs, devs_len, PSTR("{\"" D_CMND_I2CSCAN "\":\"Error %d at 0x%02x"), error >> 8, error & 0xFF);
+  } else {
+    for (uint32_t address = 1; address <= 127; address++) {
+      if (I2cPresentOnBus(address, bus)) {
+        any = 1;
+        snprintf_P(devs, devs_len, PSTR("%s 0x%02x"), devs, address);
+      }
     }
   }
   if (any) {
@@ -1636,10 +2297,14 @@ void I2cResetActive(uint32_t addr, uint32_t count = 1)
   addr &= 0x7F;         // Max I2C address is 127
   count &= 0x7F;        // Max 4 x 32 bits available
   while (count-- && (addr < 128)) {
-    i2c_active[addr / 32] &= ~(1 << (addr % 32));
+    for (uint32_t bus = 0; bus < MAX_I2C; bus++) {
+      if ((i2c_bus_select == I2C_BUS_AUTO) || (i2c_bus_select == bus)) {
+        i2c_active[bus][addr / 32] &= ~(1 << (addr % 32));
+      }
+    }
     addr++;
   }
-//  AddLog_P2(LOG_LEVEL_DEBUG, PSTR("I2C: Active %08X,%08X,%08X,%08X"), i2c_active[0], i2c_active[1], i2c_active[2], i2c_active[3]);
+//  AddLog_P2(LOG_LEVEL_DEBUG, PSTR("I2C: Active %08X,%08X,%08X,%08X"), i2c_active[0][0], i2c_active[0][1], i2c_active[0][2], i2c_active[0][3]);
 }
 
 void I2cSetActive(uint32_t addr, uint32_t count = 1)
@@ -1647,23 +2312,30 @@ void I2cSetActive(uint32_t addr, uint32_t count = 1)
   addr &= 0x7F;         // Max I2C address is 127
   count &= 0x7F;        // Max 4 x 32 bits available
   while (count-- && (addr < 128)) {
-    i2c_active[addr / 32] |= (1 << (addr % 32));
+    uint32_t bus = I2cClaimBus(addr);
+    i2c_active[bus][addr / 32] |= (1 << (addr % 32));
     addr++;
   }
-//  AddLog_P2(LOG_LEVEL_DEBUG, PSTR("I2C: Active %08X,%08X,%08X,%08X"), i2c_active[0], i2c_active[1], i2c_active[2], i2c_active[3]);
+//  AddLog_P2(LOG_LEVEL_DEBUG, PSTR("I2C: Active %08X,%08X,%08X,%08X"), i2c_active[0][0], i2c_active[0][1], i2c_active[0][2], i2c_active[0][3]);
 }
 
 void I2cSetActiveFound(uint32_t addr, const char *types)
 {
+  uint32_t bus = I2cClaimBus(addr);
   I2cSetActive(addr);
-  AddLog_P2(LOG_LEVEL_INFO, S_LOG_I2C_FOUND_AT, types, addr);
+  if (bus) {
+    AddLog_P2(LOG_LEVEL_INFO, PSTR("I2C: %s found at 0x%x on bus %d"), types, addr, bus +1);
+  } else {
+    AddLog_P2(LOG_LEVEL_INFO, S_LOG_I2C_FOUND_AT, types, addr);
+  }
 }
 
 bool I2cActive(uint32_t addr)
 {
   addr &= 0x7F;         // Max I2C address is 127
-  if (i2c_active[addr / 32] & (1 << (addr % 32))) {
-    return true;
+  if (i2c_bus_select != I2C_BUS_AUTO) { return I2cActiveOnBus(addr, i2c_bus_select); }
+  for (uint32_t bus = 0; bus < MAX_I2C; bus++) {
+    if (I2cActiveOnBus(addr, bus)) { return true; }
   }
   return false;
 }
@@ -1671,11 +2343,11 @@ bool I2cActive(uint32_t addr)
 bool I2cSetDevice(uint32_t addr)
 {
   addr &= 0x7F;         // Max I2C address is 127
-  if (I2cActive(addr)) {
+  uint32_t bus = I2cClaimBus(addr);
+  if (I2cActiveOnBus(addr, bus)) {
     return false;       // If already active report as not present;
   }
-  Wire.beginTransmission((uint8_t)addr);
-  return (0 == Wire.endTransmission());
+  return I2cPresentOnBus(addr, bus);
 }
 #endif  // USE_I2C
 
@@ -1701,32 +2373,329 @@ void SetSyslog(uint32_t loglevel)
   syslog_timer = 0;
 }
 
+/*********************************************************************************************\
+ * Unishox text compression
+ *
+ * Shared by rules, scripter, web log and MQTT payload compression. Compressed data never
+ * contains a null character.
+\*********************************************************************************************/
+
+#ifdef USE_UNISHOX_COMPRESSION
+
+#include <unishox.h>
+
+Unishox compressor;
+
+String Decompress(const char * compressed, size_t uncompressed_size) {
+  String content("");
+
+  uncompressed_size += 2;    // take a security margin
+
+  // We use a nasty trick here. To avoid allocating twice the buffer,
+  // we first extend the buffer of the String object to the target size (maybe overshooting by 7 bytes)
+  // then we decompress in this buffer,
+  // and finally assign the raw string to the String, which happens to work: String uses memmove(), so overlapping works
+  content.reserve(uncompressed_size);
+  char * buffer = content.begin();
+
+  int32_t len = compressor.unishox_decompress(compressed, strlen_P(compressed), buffer, uncompressed_size);
+  if (len > 0) {
+    buffer[len] = 0;    // terminate string with NULL
+    content = buffer;         // copy in place
+  }
+  return content;
+}
+
+char* CompressText(const char* text, size_t len, size_t* compressed_len)
+{
+  // Returns allocated compressed text if it is smaller than text or nullptr
+  if (len <= 8) { return nullptr; }         // Compressor needs four bytes headroom
+  char* compressed = (char*)malloc(len);
+  if (!compressed) { return nullptr; }
+  int32_t result = compressor.unishox_compress(text, len, compressed, len);
+  if (result <= 0) {
+    free(compressed);
+    return nullptr;
+  }
+  *compressed_len = result;
+  return compressed;
+}
+
+#endif  // USE_UNISHOX_COMPRESSION
+
 #ifdef USE_WEBSERVER
+/*********************************************************************************************\
+ * Web log circular buffer
+ *
+ * Each entry has this format: [index][log data]['\1'] and is stored contiguous.
+ * An entry not fitting at the end of the buffer is stored at the start of the buffer leaving
+ * a zero index as end marker. The last buffer byte is always zero.
+ *
+ * The buffer is allocated on first use with the size set by command WebLogSize or a default
+ * size which is larger when PSRAM is present.
+ *
+ * With USE_WEB_LOG_COMPRESSION each entry has this format: [index][length low][length high][data]
+ * where data is Unishox compressed unless the length has flag WEB_LOG_RAW. Compressed data may
+ * contain '\1' so entries are skipped by length. GetLog returns the entry expanded in
+ * web_log_line with its terminating '\1'.
+\*********************************************************************************************/
+
+#ifdef USE_WEB_LOG_COMPRESSION
+const uint32_t WEB_LOG_HEADER = 3;       // Index and data length
+const uint16_t WEB_LOG_RAW = 0x8000;     // Data length flag of an uncompressed entry
+
+char web_log_line[LOGSZ + 12];           // Entry to compress or expanded entry
+#endif  // USE_WEB_LOG_COMPRESSION
+
+void WebLogAlloc(void)
+{
+  free(web_log);
+  web_log_count = 0;
+  web_log_head = 0;
+  web_log_tail = 0;
+  uint32_t size = Settings.web_log_kb * 1024;
+  if (!size) {
+    size = WEB_LOG_SIZE;
+#ifdef ESP32
+    if (psramFound()) { size = WEB_LOG_SIZE_PSRAM; }
+#endif  // ESP32
+  }
+  web_log = (char*)PsramMalloc(size);
+  if (!web_log && (size > WEB_LOG_SIZE)) {
+    size = WEB_LOG_SIZE;                 // Fall back to the default size
+    web_log = (char*)PsramMalloc(size);
+  }
+  web_log_size = (web_log) ? size : 0;
+  if (web_log) {
+    web_log[0] = '\0';
+    web_log[size -1] = '\0';
+  }
+}
+
+uint32_t WebLogNext(uint32_t offset)
+{
+  // Returns offset of the entry following the entry at offset
+#ifdef USE_WEB_LOG_COMPRESSION
+  uint32_t length = (uint8_t)web_log[offset +1] | (uint8_t)web_log[offset +2] << 8;
+  offset += WEB_LOG_HEADER + (length & ~WEB_LOG_RAW);
+  if (offset >= web_log_size) { return web_log_size -1; }  // Should not happen
+#else
+  char* end = (char*)memchr(web_log + offset +1, '\1', web_log_size - offset -1);
+  if (!end) { return web_log_size -1; }  // Should not happen
+  offset = end - web_log +1;             // Skip terminating '\1'
+#endif  // USE_WEB_LOG_COMPRESSION
+  return (web_log[offset]) ? offset : 0;  // Continue at start of buffer on end marker
+}
+
+void WebLogRemoveOldest(void)
+{
+  web_log_count--;
+  if (web_log_count) {
+    web_log_head = WebLogNext(web_log_head);
+  } else {
+    web_log_head = 0;
+    web_log_tail = 0;
+  }
+}
+
+void WebLogAdd(const char* mxtime)
+{
+  uint32_t mxtime_len = strlen(mxtime);
+  uint32_t log_data_len = strlen(log_data);
+#ifdef USE_WEB_LOG_COMPRESSION
+  uint32_t len = WEB_LOG_HEADER + mxtime_len + log_data_len;  // Room for uncompressed data
+#else
+  uint32_t len = mxtime_len + log_data_len +2;  // index + mxtime + log data + '\1'
+#endif  // USE_WEB_LOG_COMPRESSION
+
+  if (!web_log) {
+    WebLogAlloc();
+    if (!web_log) { return; }
+  }
+  if (len >= web_log_size) { return; }
+  web_log_index &= 0xFF;
+  if (!web_log_index) web_log_index++;   // Index 0 is not allowed as it is the end marker
+  if (web_log_count && (web_log_index == (uint8_t)web_log[web_log_head])) {
+    WebLogRemoveOldest();                // If log already holds the next index, remove it
+  }
+
+  while (true) {
+    if (!web_log_count || (web_log_head < web_log_tail)) {  // Entries do not wrap
+      if (web_log_tail + len < web_log_size) { break; }     // Room at end of buffer
+      web_log[web_log_tail] = '\0';       // Set end marker and continue at start
+      web_log_tail = 0;
+      if (!web_log_count) { break; }
+    } else {                             // Entries wrap so free space is between tail and head
+      if (web_log_tail + len <= web_log_head) { break; }
+      WebLogRemoveOldest();
+    }
+  }
+
+  char* entry = web_log + web_log_tail;
+  *entry++ = web_log_index++;
+#ifdef USE_WEB_LOG_COMPRESSION
+  uint32_t data_len = mxtime_len + log_data_len;
+  memcpy(web_log_line, mxtime, mxtime_len);
+  memcpy(web_log_line + mxtime_len, log_data, log_data_len);
+  int32_t compressed_len = -1;
+  if (data_len > 8) {                    // Compressor needs four bytes headroom
+    compressed_len = compressor.unishox_compress(web_log_line, data_len, entry +2, data_len);
+  }
+  uint32_t length = data_len | WEB_LOG_RAW;
+  if (compressed_len > 0) {
+    data_len = compressed_len;
+    length = data_len;
+  } else {
+    memcpy(entry +2, web_log_line, data_len);
+  }
+  entry[0] = length;
+  entry[1] = length >> 8;
+  len = WEB_LOG_HEADER + data_len;
+#else
+  memcpy(entry, mxtime, mxtime_len);
+  memcpy(entry + mxtime_len, log_data, log_data_len);
+  entry[mxtime_len + log_data_len] = '\1';
+#endif  // USE_WEB_LOG_COMPRESSION
+  web_log_tail += len;
+  web_log_count++;
+
+  web_log_index &= 0xFF;
+  if (!web_log_index) web_log_index++;   // Index 0 is not allowed as it is the end marker
+}
+
+#ifdef USE_WEB_LOG_COMPRESSION
+uint32_t WebLogExpand(uint32_t offset)
+{
+  // Returns length of the entry at offset expanded in web_log_line including terminating '\1'
+  uint32_t length = (uint8_t)web_log[offset +1] | (uint8_t)web_log[offset +2] << 8;
+  uint32_t len = length & ~WEB_LOG_RAW;
+  const char* data = web_log + offset + WEB_LOG_HEADER;
+  if (length & WEB_LOG_RAW) {
+    if (len > sizeof(web_log_line) -2) { len = sizeof(web_log_line) -2; }
+    memcpy(web_log_line, data, len);
+  } else {
+    int32_t expanded_len = compressor.unishox_decompress(data, len, web_log_line, sizeof(web_log_line) -2);
+    len = (expanded_len > 0) ? expanded_len : 0;
+  }
+  web_log_line[len] = '\1';
+  web_log_line[len +1] = '\0';          // Callers use strlcpy
+  return len +1;
+}
+#endif  // USE_WEB_LOG_COMPRESSION
+
 void GetLog(uint32_t idx, char** entry_pp, size_t* len_p)
 {
   char* entry_p = nullptr;
   size_t len = 0;
 
   if (idx) {
-    char* it = web_log;
-    do {
-      uint32_t cur_idx = *it;
-      it++;
-      size_t tmp = strchrspn(it, '\1');
-      tmp++;                             // Skip terminating '\1'
-      if (cur_idx == idx) {              // Found the requested entry
-        len = tmp;
-        entry_p = it;
+    uint32_t offset = web_log_head;
+    for (uint32_t i = 0; i < web_log_count; i++) {
+      uint32_t next = WebLogNext(offset);
+      if ((uint8_t)web_log[offset] == idx) {  // Found the requested entry
+#ifdef USE_WEB_LOG_COMPRESSION
+        entry_p = web_log_line;
+        len = WebLogExpand(offset);
+#else
+        entry_p = web_log + offset +1;
+        len = strchrspn(entry_p, '\1') +1;  // Including terminating '\1'
+#endif  // USE_WEB_LOG_COMPRESSION
         break;
       }
-      it += tmp;
-    } while (it < web_log + WEB_LOG_SIZE && *it != '\0');
+      offset = next;
+    }
   }
   *entry_pp = entry_p;
   *len_p = len;
 }
 #endif  // USE_WEBSERVER
 
+void SyslogPreamble(void)
+{
+  char syslog_preamble[64];  // Hostname + Id
+  snprintf_P(syslog_preamble, sizeof(syslog_preamble), PSTR("%s ESP-"), my_hostname);
+  memmove(log_data + strlen(syslog_preamble), log_data, sizeof(log_data) - strlen(syslog_preamble));
+  log_data[sizeof(log_data) -1] = '\0';
+  memcpy(log_data, syslog_preamble, strlen(syslog_preamble));
+}
+
+void SyslogFailed(void)
+{
+  syslog_level = 0;
+  syslog_timer = SYSLOG_TIMER;
+  AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_APPLICATION D_SYSLOG_HOST_NOT_FOUND ". " D_RETRY_IN " %d " D_UNIT_SECOND), SYSLOG_TIMER);
+}
+
+#ifdef USE_SYSLOG_TCP
+/*********************************************************************************************\
+ * Syslog over TCP
+ *
+ * Log lines are octet counted (RFC 6587) and collected in a batch written at once when the next
+ * line does not fit or the oldest line waited SYSLOG_TCP_BATCH_TIME mSeconds. The connection to
+ * LogHost:LogPort stays open and is only reopened by the next batch after it dropped.
+\*********************************************************************************************/
+
+#ifndef SYSLOG_TCP_BATCH_SIZE
+#define SYSLOG_TCP_BATCH_SIZE  1024         // Bytes collected before writing
+#endif
+#ifndef SYSLOG_TCP_BATCH_TIME
+#define SYSLOG_TCP_BATCH_TIME  250          // mSeconds a line may wait for more lines
+#endif
+
+WiFiClient SyslogClient;
+
+struct {
+  uint32_t batch_time;                      // millis() of oldest line in batch
+  uint16_t batch_len = 0;
+  char batch[SYSLOG_TCP_BATCH_SIZE];
+} SyslogTcp;
+
+void SyslogTcpFlush(void)
+{
+  if (!SyslogTcp.batch_len) { return; }
+
+  uint32_t len = SyslogTcp.batch_len;
+  SyslogTcp.batch_len = 0;
+  if (!SyslogClient.connected()) {
+    SyslogClient.stop();
+    if (!SyslogClient.connect(syslog_host_addr, Settings.syslog_port)) {
+      SyslogFailed();
+      return;
+    }
+    SyslogClient.setNoDelay(true);          // Batches are complete so do not wait for more data
+  }
+  if (SyslogClient.write((uint8_t*)SyslogTcp.batch, len) != len) {
+    SyslogClient.stop();                    // Peer will see a partial frame so start over
+  }
+}
+
+void SyslogTcpAdd(void)
+{
+  uint32_t text_len = strlen(log_data);
+  char frame_len[8];
+  snprintf_P(frame_len, sizeof(frame_len), PSTR("%d "), text_len);
+  uint32_t len = strlen(frame_len) + text_len;
+  if (len > sizeof(SyslogTcp.batch)) { return; }
+
+  if (SyslogTcp.batch_len + len > sizeof(SyslogTcp.batch)) {
+    SyslogTcpFlush();
+  }
+  if (!SyslogTcp.batch_len) {
+    SyslogTcp.batch_time = millis();
+  }
+  memcpy(SyslogTcp.batch + SyslogTcp.batch_len, frame_len, strlen(frame_len));
+  memcpy(SyslogTcp.batch + SyslogTcp.batch_len + strlen(frame_len), log_data, text_len);
+  SyslogTcp.batch_len += len;
+}
+
+void SyslogTcpLoop(void)
+{
+  if (SyslogTcp.batch_len && !global_state.wifi_down && (TimePassedSince(SyslogTcp.batch_time) >= SYSLOG_TCP_BATCH_TIME)) {
+    SyslogTcpFlush();
+  }
+}
+#endif  // USE_SYSLOG_TCP
+
 void Syslog(void)
 {
   // Destroys log_data
@@ -1734,28 +2703,181 @@ void Syslog(void)
   uint32_t current_hash = GetHash(SettingsText(SET_SYSLOG_HOST), strlen(SettingsText(SET_SYSLOG_HOST)));
   if (syslog_host_hash != current_hash) {
     syslog_host_hash = current_hash;
+#ifdef USE_DNS_CACHE
+    DnsHostByName(SettingsText(SET_SYSLOG_HOST), syslog_host_addr);
+#else
     WiFi.hostByName(SettingsText(SET_SYSLOG_HOST), syslog_host_addr);  // If sleep enabled this might result in exception so try to do it once using hash
+#endif  // USE_DNS_CACHE
+#ifdef USE_SYSLOG_TCP
+    SyslogClient.stop();
+#endif  // USE_SYSLOG_TCP
   }
+#ifdef USE_DNS_CACHE
+  else {
+    uint32_t address;                    // Follow background refreshes without blocking
+    if ((DNS_CACHE_HIT == DnsCacheLookup(SettingsText(SET_SYSLOG_HOST), &address)) && (address != (uint32_t)syslog_host_addr)) {
+      syslog_host_addr = address;
+#ifdef USE_SYSLOG_TCP
+      SyslogClient.stop();
+#endif  // USE_SYSLOG_TCP
+    }
+  }
+#endif  // USE_DNS_CACHE
+#ifdef USE_SYSLOG_TCP
+  SyslogPreamble();
+  SyslogTcpAdd();
+#else
   if (PortUdp.beginPacket(syslog_host_addr, Settings.syslog_port)) {
-    char syslog_preamble[64];  // Hostname + Id
-    snprintf_P(syslog_preamble, sizeof(syslog_preamble), PSTR("%s ESP-"), my_hostname);
-    memmove(log_data + strlen(syslog_preamble), log_data, sizeof(log_data) - strlen(syslog_preamble));
-    log_data[sizeof(log_data) -1] = '\0';
-    memcpy(log_data, syslog_preamble, strlen(syslog_preamble));
+    SyslogPreamble();
     PortUdp_write(log_data, strlen(log_data));
     PortUdp.endPacket();
     delay(1);  // Add time for UDP handling (#5512)
   } else {
-    syslog_level = 0;
-    syslog_timer = SYSLOG_TIMER;
-    AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_APPLICATION D_SYSLOG_HOST_NOT_FOUND ". " D_RETRY_IN " %d " D_UNIT_SECOND), SYSLOG_TIMER);
+    SyslogFailed();
   }
+#endif  // USE_SYSLOG_TCP
 }
 
+#ifdef USE_DEFERRED_LOG
+/*********************************************************************************************\
+ * Deferred log sinks
+ *
+ * AddLog only queues log lines for the slow network sinks MQTT and syslog. The sinks share one
+ * circular buffer but each has its own read position and is drained from loop() within a time
+ * budget. A sink falling behind loses its oldest lines which are counted as dropped.
+ *
+ * Entry layout: [loglevel][mxtime length][text length LSB][text length MSB][mxtime][text]
+\*********************************************************************************************/
+
+const uint8_t LOG_DEFER_HEADER = 4;
+
+enum LogSinks { LOG_SINK_MQTT, LOG_SINK_SYSLOG, LOG_SINK_MAX };
+
+struct LOG_DEFER {
+  uint32_t write = 0;                       // Total number of bytes written
+  uint32_t read[LOG_SINK_MAX] = { 0 };      // Total number of bytes read per sink
+  uint32_t dropped[LOG_SINK_MAX] = { 0 };   // Number of lines dropped per sink
+  char buffer[LOG_DEFER_SIZE];
+} LogDefer;
+
+void LogDeferCopy(uint32_t position, char *data, uint32_t len, bool store)
+{
+  uint32_t offset = position % LOG_DEFER_SIZE;
+  uint32_t first = LOG_DEFER_SIZE - offset;
+  if (first > len) { first = len; }
+  if (store) {
+    memcpy(LogDefer.buffer + offset, data, first);
+    memcpy(LogDefer.buffer, data + first, len - first);
+  } else {
+    memcpy(data, LogDefer.buffer + offset, first);
+    memcpy(data + first, LogDefer.buffer, len - first);
+  }
+}
+
+bool LogDeferWanted(uint32_t sink, uint32_t loglevel)
+{
+  if (LOG_SINK_MQTT == sink) {
+    return (Settings.flag.mqtt_enabled && (loglevel <= Settings.mqttlog_level));  // SetOption3 - Enable MQTT
+  }
+  return (loglevel <= syslog_level);
+}
+
+bool LogDeferReady(uint32_t sink)
+{
+  if (LOG_SINK_MQTT == sink) {
+    return !global_state.mqtt_down;
+  }
+  return !global_state.wifi_down;
+}
+
+uint32_t LogDeferSkip(uint32_t sink)
+{
+  // Advance sink past its oldest entry and return the entry loglevel
+  uint8_t header[LOG_DEFER_HEADER];
+  LogDeferCopy(LogDefer.read[sink], (char*)header, sizeof(header), false);
+  LogDefer.read[sink] += LOG_DEFER_HEADER + header[1] + (header[3] << 8 | header[2]);
+  return header[0];
+}
+
+void LogDeferAdd(uint32_t loglevel, const char *mxtime)
+{
+  bool wanted = false;
+  for (uint32_t sink = 0; sink < LOG_SINK_MAX; sink++) {
+    wanted |= LogDeferWanted(sink, loglevel);
+  }
+  if (!wanted) { return; }
+
+  uint32_t mxtime_len = strlen(mxtime);
+  uint32_t text_len = strlen(log_data);
+  uint32_t len = LOG_DEFER_HEADER + mxtime_len + text_len;
+  if (len > LOG_DEFER_SIZE) { return; }
+
+  for (uint32_t sink = 0; sink < LOG_SINK_MAX; sink++) {
+    while (LogDefer.write + len - LogDefer.read[sink] > LOG_DEFER_SIZE) {
+      if (LogDeferWanted(sink, LogDeferSkip(sink))) { LogDefer.dropped[sink]++; }
+    }
+  }
+
+  uint8_t header[LOG_DEFER_HEADER] = { (uint8_t)loglevel, (uint8_t)mxtime_len, (uint8_t)text_len, (uint8_t)(text_len >> 8) };
+  LogDeferCopy(LogDefer.write, (char*)header, sizeof(header), true);
+  LogDeferCopy(LogDefer.write + LOG_DEFER_HEADER, (char*)mxtime, mxtime_len, true);
+  LogDeferCopy(LogDefer.write + LOG_DEFER_HEADER + mxtime_len, log_data, text_len, true);
+  LogDefer.write += len;
+
+  for (uint32_t sink = 0; sink < LOG_SINK_MAX; sink++) {
+    // Idle sinks not interested in this line skip it right away
+    if ((LogDefer.read[sink] == LogDefer.write - len) && !LogDeferWanted(sink, loglevel)) {
+      LogDefer.read[sink] = LogDefer.write;
+    }
+  }
+}
+
+void LogDeferLoop(void)
+{
+  if (prepped_loglevel) { return; }        // log_data holds a delayed log message
+
+  uint32_t start = millis();
+  for (uint32_t sink = 0; sink < LOG_SINK_MAX; sink++) {
+    while ((LogDefer.read[sink] != LogDefer.write) && LogDeferReady(sink)) {
+      if (TimePassedSince(start) >= LOG_DEFER_BUDGET) { return; }
+
+      uint32_t position = LogDefer.read[sink];
+      uint32_t loglevel = LogDeferSkip(sink);
+      if (!LogDeferWanted(sink, loglevel)) { continue; }
+
+      uint8_t header[LOG_DEFER_HEADER];
+      LogDeferCopy(position, (char*)header, sizeof(header), false);
+      char mxtime[10];
+      uint32_t mxtime_len = header[1];
+      if (mxtime_len > sizeof(mxtime) -1) { mxtime_len = sizeof(mxtime) -1; }
+      LogDeferCopy(position + LOG_DEFER_HEADER, mxtime, mxtime_len, false);
+      mxtime[mxtime_len] = '\0';
+      uint32_t text_len = header[3] << 8 | header[2];
+      if (text_len > sizeof(log_data) -1) { text_len = sizeof(log_data) -1; }
+      LogDeferCopy(position + LOG_DEFER_HEADER + header[1], log_data, text_len, false);
+      log_data[text_len] = '\0';
+
+      if (LOG_SINK_MQTT == sink) {
+        MqttPublishLogging(mxtime);
+      } else {
+        Syslog();                          // Destroys log_data
+      }
+    }
+  }
+}
+
+void LogDeferStatus(void)
+{
+  ResponseAppend_P(PSTR(",\"LogDropped\":[%d,%d]"), LogDefer.dropped[LOG_SINK_MQTT], LogDefer.dropped[LOG_SINK_SYSLOG]);
+}
+#endif  // USE_DEFERRED_LOG
+
 void AddLog(uint32_t loglevel)
 {
   char mxtime[10];  // "13:45:21 "
 
+  TRACE_EVENT(TRACE_LOG, TRACE_INSTANT, loglevel);
+
   snprintf_P(mxtime, sizeof(mxtime), PSTR("%02d" D_HOUR_MINUTE_SEPARATOR "%02d" D_MINUTE_SECOND_SEPARATOR "%02d "), RtcTime.hour, RtcTime.minute, RtcTime.second);
 
   if (loglevel <= seriallog_level) {
@@ -1763,30 +2885,19 @@ void AddLog(uint32_t loglevel)
   }
 #ifdef USE_WEBSERVER
   if (Settings.webserver && (loglevel <= Settings.weblog_level)) {
-    // Delimited, zero-terminated buffer of log lines.
-    // Each entry has this format: [index][log data]['\1']
-    web_log_index &= 0xFF;
-    if (!web_log_index) web_log_index++;   // Index 0 is not allowed as it is the end of char string
-    while (web_log_index == web_log[0] ||  // If log already holds the next index, remove it
-           strlen(web_log) + strlen(log_data) + 13 > WEB_LOG_SIZE)  // 13 = web_log_index + mxtime + '\1' + '\0'
-    {
-      char* it = web_log;
-      it++;                                // Skip web_log_index
-      it += strchrspn(it, '\1');           // Skip log line
-      it++;                                // Skip delimiting "\1"
-      memmove(web_log, it, WEB_LOG_SIZE -(it-web_log));  // Move buffer forward to remove oldest log line
-    }
-    snprintf_P(web_log, sizeof(web_log), PSTR("%s%c%s%s\1"), web_log, web_log_index++, mxtime, log_data);
-    web_log_index &= 0xFF;
-    if (!web_log_index) web_log_index++;   // Index 0 is not allowed as it is the end of char string
+    WebLogAdd(mxtime);
   }
 #endif  // USE_WEBSERVER
+#ifdef USE_DEFERRED_LOG
+  LogDeferAdd(loglevel, mxtime);
+#else
   if (Settings.flag.mqtt_enabled &&        // SetOption3 - Enable MQTT
       !global_state.mqtt_down &&
       (loglevel <= Settings.mqttlog_level)) { MqttPublishLogging(mxtime); }
 
   if (!global_state.wifi_down &&
       (loglevel <= syslog_level)) { Syslog(); }
+#endif  // USE_DEFERRED_LOG
 
   prepped_loglevel = 0;
 }
@@ -1877,35 +2988,3 @@ void AddLogBufferSize(uint32_t loglevel, uint8_t *buffer, uint32_t count, uint32
   }
   AddLog(loglevel);
 }
-
-/*********************************************************************************************\
- * Uncompress static PROGMEM strings
-\*********************************************************************************************/
-
-#if defined(USE_RULES_COMPRESSION) || defined(USE_SCRIPT_COMPRESSION)
-
-#include <unishox.h>
-
-Unishox compressor;
-
-String Decompress(const char * compressed, size_t uncompressed_size) {
-  String content("");
-
-  uncompressed_size += 2;    // take a security margin
-
-  // We use a nasty trick here. To avoid allocating twice the buffer,
-  // we first extend the buffer of the String object to the target size (maybe overshooting by 7 bytes)
-  // then we decompress in this buffer,
-  // and finally assign the raw string to the String, which happens to work: String uses memmove(), so overlapping works
-  content.reserve(uncompressed_size);
-  char * buffer = content.begin();
-
-  int32_t len = compressor.unishox_decompress(compressed, strlen_P(compressed), buffer, uncompressed_size);
-  if (len > 0) {
-    buffer[len] = 0;    // terminate string with NULL
-    content = buffer;         // copy in place
-  }
-  return content;
-}
-
-#endif // defined(USE_RULES_COMPRESSION) || defined(USE_SCRIPT_COMPRESSION)
\ No newline at end of file
@@ -44,10 +44,15 @@ struct BUTTON {
   uint8_t dual_receive_count = 0;            // Sonoff dual input flag
   uint8_t no_pullup_mask = 0;                // key no pullup flag (1 = no pullup)
   uint8_t inverted_mask = 0;                 // Key inverted flag (1 = inverted)
+  uint8_t used_mask = 0;                     // Keys with a pin
+  uint8_t optimistic_mask = 0;               // Keys with the single press action executed on the first press
 #ifdef ESP32
   uint8_t touch_mask = 0;                    // Touch flag (1 = inverted)
   uint8_t touch_hits[MAX_KEYS] = { 0 };      // Hits in a row to filter out noise
 #endif // ESP32
+#ifdef USE_INPUT_INTERRUPT
+  uint8_t irq_mask = 0;                      // Keys using interrupts instead of polling
+#endif  // USE_INPUT_INTERRUPT
   uint8_t present = 0;                       // Number of buttons found flag
   uint8_t adc = 99;                          // ADC0 button number
 } Button;
@@ -80,6 +85,7 @@ void ButtonTouchFlag(uint8 button_bit)
 void ButtonInit(void)
 {
   Button.present = 0;
+  Button.used_mask = PinUsedMask(GPIO_KEY1, MAX_KEYS);
 #ifdef ESP8266
   if ((SONOFF_DUAL == my_module_type) || (CH4 == my_module_type)) {
     Button.present++;
@@ -89,6 +95,15 @@ void ButtonInit(void)
     if (PinUsed(GPIO_KEY1, i)) {
       Button.present++;
       pinMode(Pin(GPIO_KEY1, i), bitRead(Button.no_pullup_mask, i) ? INPUT : ((16 == Pin(GPIO_KEY1, i)) ? INPUT_PULLDOWN_16 : INPUT_PULLUP));
+#ifdef USE_INPUT_INTERRUPT
+      if (Settings.flag4.input_interrupt &&  // SetOption96 - Interrupt driven switch and button input
+#ifdef ESP32
+          !bitRead(Button.touch_mask, i) &&
+#endif  // ESP32
+          InputIrqAttach(MAX_SWITCHES + i, Pin(GPIO_KEY1, i))) {
+        bitSet(Button.irq_mask, i);
+      }
+#endif  // USE_INPUT_INTERRUPT
     }
 #ifndef USE_ADC_VCC
     else if ((99 == Button.adc) && ((ADC0_BUTTON == my_adc0) || (ADC0_BUTTON_INV == my_adc0))) {
@@ -99,6 +114,14 @@ void ButtonInit(void)
   }
 }
 
+uint32_t ButtonRead(uint32_t index)
+{
+#ifdef USE_INPUT_INTERRUPT
+  if (bitRead(Button.irq_mask, index)) { return InputIrqLevel(MAX_SWITCHES + index); }
+#endif  // USE_INPUT_INTERRUPT
+  return digitalRead(Pin(GPIO_KEY1, index));
+}
+
 uint8_t ButtonSerial(uint8_t serial_in_byte)
 {
   if (Button.dual_receive_count) {
@@ -129,8 +152,29 @@ uint8_t ButtonSerial(uint8_t serial_in_byte)
  * SetOption11 (0)     - If set perform single press action on double press and reverse (on two relay devices only)
  * SetOption13 (0)     - If set act on single press only
  * SetOption73 (0)     - Decouple button from relay and send just mqtt topic
+ * SetOption99 (0)     - If set execute single press action on the first press and revert it on a double to hexa press
 \*********************************************************************************************/
 
+bool ButtonOptimistic(uint32_t button_index)
+{
+  if (!Settings.flag4.button_optimistic ||     // SetOption99 (0) - Execute single press action on the first press
+      Settings.flag3.mqtt_buttons ||           // SetOption73 (0) - Decouple button from relay and send just mqtt topic
+      Settings.flag.button_swap) {             // SetOption11 (0) - Single press action is on double press
+    return false;
+  }
+#if defined(USE_LIGHT) && defined(ROTARY_V1)
+  if ((0 == button_index) && PinUsed(GPIO_ROT1A)) { return false; }  // Press may be used to rotate
+#endif
+  return true;
+}
+
+void ButtonSinglePress(uint32_t button_index)
+{
+  if (!SendKey(KEY_BUTTON, button_index +1, POWER_TOGGLE)) {  // Execute Toggle command via MQTT if ButtonTopic is set
+    ExecuteCommandPower(button_index +1, POWER_TOGGLE, SRC_BUTTON);
+  }
+}
+
 void ButtonHandler(void)
 {
   if (uptime < 4) { return; }                                   // Block GPIO for 4 seconds after poweron to workaround Wemos D1 / Obi RTS circuit
@@ -157,13 +201,13 @@ void ButtonHandler(void)
       }
     }
     else {
-      if (PinUsed(GPIO_KEY1, button_index)) {
+      if (bitRead(Button.used_mask, button_index)) {
         button_present = 1;
-        button = (digitalRead(Pin(GPIO_KEY1, button_index)) != bitRead(Button.inverted_mask, button_index));
+        button = (ButtonRead(button_index) != bitRead(Button.inverted_mask, button_index));
       }
     }
 #else
-    if (PinUsed(GPIO_KEY1, button_index)) {
+    if (bitRead(Button.used_mask, button_index)) {
       button_present = 1;
       if (bitRead(Button.touch_mask, button_index)) {          // Touch
         uint32_t _value = touchRead(Pin(GPIO_KEY1, button_index));
@@ -185,7 +229,7 @@ void ButtonHandler(void)
           AddLog_P2(LOG_LEVEL_INFO, PSTR("PLOT: %u, %u, %u,"), button_index+1, _value, Button.touch_hits[button_index]);  // Button number (1..4), value, continuous hits under threshold
         }
       } else {                                                 // Normal button
-        button = (digitalRead(Pin(GPIO_KEY1, button_index)) != bitRead(Button.inverted_mask, button_index));
+        button = (ButtonRead(button_index) != bitRead(Button.inverted_mask, button_index));
       }
     }
 #endif  // ESP8266
@@ -222,9 +266,7 @@ void ButtonHandler(void)
         }
         if (button_pressed) {
           if (!Settings.flag3.mqtt_buttons) {          // SetOption73 (0) - Decouple button from relay and send just mqtt topic
-            if (!SendKey(KEY_BUTTON, button_index +1, POWER_TOGGLE)) {  // Execute Toggle command via MQTT if ButtonTopic is set
-              ExecuteCommandPower(button_index +1, POWER_TOGGLE, SRC_BUTTON);  // Execute Toggle command internally
-            }
+            KeyPower(KEY_BUTTON, button_index +1, POWER_TOGGLE, SRC_BUTTON);  // Execute Toggle command via MQTT if ButtonTopic is set or internally
           } else {
             MqttButtonTopic(button_index +1, 1, 0);    // SetOption73 (0) - Decouple button from relay and send just mqtt topic
           }
@@ -237,9 +279,7 @@ void ButtonHandler(void)
           if (Settings.flag.button_single) {           // SetOption13 (0) - Allow only single button press for immediate action,
             if (!Settings.flag3.mqtt_buttons) {        // SetOption73 (0) - Decouple button from relay and send just mqtt topic
               AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_APPLICATION D_BUTTON "%d " D_IMMEDIATE), button_index +1);
-              if (!SendKey(KEY_BUTTON, button_index +1, POWER_TOGGLE)) {  // Execute Toggle command via MQTT if ButtonTopic is set
-                ExecuteCommandPower(button_index +1, POWER_TOGGLE, SRC_BUTTON);  // Execute Toggle command internally
-              }
+              KeyPower(KEY_BUTTON, button_index +1, POWER_TOGGLE, SRC_BUTTON);  // Execute Toggle command via MQTT if ButtonTopic is set or internally
             } else {
               MqttButtonTopic(button_index +1, 1, 0);  // SetOption73 1 - Decouple button from relay and send just mqtt topic
             }
@@ -247,6 +287,12 @@ void ButtonHandler(void)
             Button.press_counter[button_index] = (Button.window_timer[button_index]) ? Button.press_counter[button_index] +1 : 1;
             AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_APPLICATION D_BUTTON "%d " D_MULTI_PRESS " %d"), button_index +1, Button.press_counter[button_index]);
             Button.window_timer[button_index] = loops_per_second / 2;  // 0.5 second multi press window
+            if (1 == Button.press_counter[button_index]) {
+              bitWrite(Button.optimistic_mask, button_index, ButtonOptimistic(button_index));
+              if (bitRead(Button.optimistic_mask, button_index)) {
+                ButtonSinglePress(button_index);       // SetOption99 (0) - Do not wait for the multi press window
+              }
+            }
           }
           blinks = 201;
         }
@@ -263,6 +309,7 @@ void ButtonHandler(void)
           } else {
             if (Button.hold_timer[button_index] == loops_per_second * Settings.param[P_HOLD_TIME] / 10) {  // SetOption32 (40) - Button hold
               Button.press_counter[button_index] = 0;
+              bitClear(Button.optimistic_mask, button_index);  // Keep the single press action and add hold
               if (Settings.flag3.mqtt_buttons) {       // SetOption73 (0) - Decouple button from relay and send just mqtt topic
                 MqttButtonTopic(button_index +1, 3, 1);
               } else {
@@ -284,7 +331,18 @@ void ButtonHandler(void)
           if (Button.window_timer[button_index]) {
             Button.window_timer[button_index]--;
           } else {
-            if (!restart_flag && !Button.hold_timer[button_index] && (Button.press_counter[button_index] > 0) && (Button.press_counter[button_index] < 7)) {
+            if (bitRead(Button.optimistic_mask, button_index) && !Button.hold_timer[button_index] && (1 == Button.press_counter[button_index])) {
+              bitClear(Button.optimistic_mask, button_index);  // Single press action executed on the first press
+              if (WifiState() > WIFI_RESTART) {        // Wifimanager active
+                restart_flag = 1;
+              }
+              Button.press_counter[button_index] = 0;
+            }
+            else if (!restart_flag && !Button.hold_timer[button_index] && (Button.press_counter[button_index] > 0) && (Button.press_counter[button_index] < 7)) {
+              if (bitRead(Button.optimistic_mask, button_index)) {
+                bitClear(Button.optimistic_mask, button_index);
+                ButtonSinglePress(button_index);       // Revert the single press action executed on the first press
+              }
 
               bool single_press = false;
               if (Button.press_counter[button_index] < 3) {  // Single or Double press
@@ -378,6 +436,16 @@ void MqttButtonTopic(uint8_t button_id, uint8_t action, uint8_t hold)
 void ButtonLoop(void)
 {
   if (Button.present) {
+#ifdef USE_INPUT_INTERRUPT
+    if (Button.irq_mask) {
+      InputIrqLoop();
+      if (InputIrqTake(MAX_SWITCHES, MAX_KEYS)) {
+        SetNextTimeInterval(Button.debounce, Settings.button_debounce);  // ButtonDebounce (50)
+        ButtonHandler();                     // Act on the debounced edge now
+        return;
+      }
+    }
+#endif  // USE_INPUT_INTERRUPT
     if (TimeReached(Button.debounce)) {
       SetNextTimeInterval(Button.debounce, Settings.button_debounce);  // ButtonDebounce (50)
       ButtonHandler();
@@ -39,6 +39,12 @@ const char kTasmotaCommands[] PROGMEM = "|"  // No prefix
   D_CMND_DEVGROUP_SHARE "|" D_CMND_DEVGROUPSTATUS "|"
 #endif  // USE_DEVICE_GROUPS
   D_CMND_SENSOR "|" D_CMND_DRIVER
+#ifdef USE_PROFILER
+  "|" D_CMND_PROFILE
+#endif  // USE_PROFILER
+#ifdef USE_LOOP_STATS
+  "|" D_CMND_LOOPSTATS
+#endif  // USE_LOOP_STATS
 #ifdef ESP32
    "|" D_CMND_TOUCH_CAL "|" D_CMND_TOUCH_THRES "|" D_CMND_TOUCH_NUM
 #endif //ESP32
@@ -66,6 +72,12 @@ void (* const TasmotaCommand[])(void) PROGMEM = {
   &CmndDevGroupShare, &CmndDevGroupStatus,
 #endif  // USE_DEVICE_GROUPS
   &CmndSensor, &CmndDriver
+#ifdef USE_PROFILER
+  ,&CmndProfile
+#endif  // USE_PROFILER
+#ifdef USE_LOOP_STATS
+  ,&CmndLoopStats
+#endif  // USE_LOOP_STATS
 #ifdef ESP32
   ,&CmndTouchCal, &CmndTouchThres, &CmndTouchNum
 #endif //ESP32
@@ -74,6 +86,78 @@ void (* const TasmotaCommand[])(void) PROGMEM = {
 const char kWifiConfig[] PROGMEM =
   D_WCFG_0_RESTART "||" D_WCFG_2_WIFIMANAGER "||" D_WCFG_4_RETRY "|" D_WCFG_5_WAIT "|" D_WCFG_6_SERIAL "|" D_WCFG_7_WIFIMANAGER_RESET_ONLY;
 
+/*********************************************************************************************\
+ * Command resolution cache
+ *
+ * Remembers which command table (core, driver or sensor) accepted a command so the next
+ * call skips the linear scan over all driver and sensor command tables
+\*********************************************************************************************/
+
+enum CommandCacheSources { CMND_CACHE_NONE, CMND_CACHE_CORE, CMND_CACHE_DRIVER, CMND_CACHE_SENSOR };
+
+struct COMMAND_CACHE {
+  uint16_t hash;                         // Hash of upper case command without index
+  uint8_t source;                        // CommandCacheSources
+  uint8_t index;                         // Index in xdrv_func_ptr or xsns_func_ptr
+} CommandCache[COMMAND_CACHE_SIZE];
+
+uint8_t xfunc_command_index = 0;         // Index of driver or sensor accepting last FUNC_COMMAND
+
+uint16_t CommandCacheHash(const char* command)
+{
+  uint32_t hash = 2166136261UL;          // FNV-1a
+  while (*command) {
+    hash ^= (uint8_t)*command++;
+    hash *= 16777619UL;
+  }
+  hash = (hash >> 16) ^ (hash & 0xFFFF);
+  return (hash) ? hash : 1;              // 0 marks an empty slot
+}
+
+bool CommandCacheExecute(uint16_t hash)
+{
+  COMMAND_CACHE *entry = &CommandCache[hash & (COMMAND_CACHE_SIZE -1)];
+  if (entry->hash != hash) { return false; }
+
+  switch (entry->source) {
+    case CMND_CACHE_CORE:
+      return DecodeCommand(kTasmotaCommands, TasmotaCommand);
+    case CMND_CACHE_DRIVER:
+      return XdrvCallIndex(entry->index, FUNC_COMMAND);
+    case CMND_CACHE_SENSOR:
+      return XsnsCallIndex(entry->index, FUNC_COMMAND);
+  }
+  return false;                          // Hash collision or slot invalidated by another command
+}
+
+void CommandCacheStore(uint16_t hash, uint32_t source, uint32_t index)
+{
+  COMMAND_CACHE *entry = &CommandCache[hash & (COMMAND_CACHE_SIZE -1)];
+  entry->hash = hash;
+  entry->source = source;
+  entry->index = index;
+}
+
+bool CommandDecode(void)
+{
+  uint16_t hash = CommandCacheHash(XdrvMailbox.topic);
+  if (CommandCacheExecute(hash)) { return true; }
+
+  uint32_t source = CMND_CACHE_NONE;
+  if (DecodeCommand(kTasmotaCommands, TasmotaCommand)) {
+    source = CMND_CACHE_CORE;
+  } else if (XdrvCall(FUNC_COMMAND)) {
+    source = CMND_CACHE_DRIVER;
+  } else if (XsnsCall(FUNC_COMMAND)) {
+    source = CMND_CACHE_SENSOR;
+  }
+  if (source != CMND_CACHE_NONE) {
+    CommandCacheStore(hash, source, xfunc_command_index);
+    return true;
+  }
+  return false;                          // Unknown commands are not cached as sensors may hotplug
+}
+
 /********************************************************************************************/
 
 void ResponseCmndNumber(int value)
@@ -121,7 +205,7 @@ void ResponseCmndIdxChar(const char* value)
 void ResponseCmndAll(uint32_t text_index, uint32_t count)
 {
   uint32_t real_index = text_index;
-  mqtt_data[0] = '\0';
+  ResponseClear();
   for (uint32_t i = 0; i < count; i++) {
     if ((SET_MQTT_GRP_TOPIC == text_index) && (1 == i)) { real_index = SET_MQTT_GRP_TOPIC2 -1; }
     ResponseAppend_P(PSTR("%c\"%s%d\":\"%s\""), (i) ? ',' : '{', XdrvMailbox.command, i +1, SettingsText(real_index +i));
@@ -140,6 +224,9 @@ void ExecuteCommand(const char *cmnd, uint32_t source)
   ShowFreeMem(PSTR("ExecuteCommand"));
 #endif
   ShowSource(source);
+#ifdef USE_ADAPTIVE_SLEEP
+  SleepEvent();
+#endif  // USE_ADAPTIVE_SLEEP
 
   const char *pos = cmnd;
   while (*pos && isspace(*pos)) {
@@ -166,7 +253,113 @@ void ExecuteCommand(const char *cmnd, uint32_t source)
 
   char svalue[strlen(pos) +1];   // pos point to the start of parameters
   strlcpy(svalue, pos, sizeof(svalue));
+  uint8_t previous_source = command_source;
+  command_source = source;
   CommandHandler(stopic, svalue, strlen(svalue));
+  command_source = previous_source;
+}
+
+/*********************************************************************************************\
+ * Command backlog
+ *
+ * Preallocated ring buffers of [source][length lo][length hi][command] entries. Commands from
+ * buttons, switches and device groups are queued in a priority lane served before the normal
+ * lane so they are not delayed by long backlogs from rules or MQTT.
+\*********************************************************************************************/
+
+uint32_t BacklogLane(uint32_t source)
+{
+  if (SRC_BACKLOG == source) { source = Backlog.source; }  // Keep entries queued by a backlog command in its lane
+  return ((SRC_BUTTON == source) || (SRC_SWITCH == source) || (SRC_REMOTE == source)) ? BACKLOG_PRIORITY : BACKLOG_NORMAL;
+}
+
+void BacklogPut(uint32_t lane, uint32_t offset, const char *data, uint32_t len)
+{
+  BACKLOG_LANE *bl = &Backlog.lane[lane];
+  uint32_t pos = (bl->head + offset) % bl->size;
+  uint32_t part = (len < bl->size - pos) ? len : bl->size - pos;
+  memcpy(bl->buffer + pos, data, part);
+  memcpy(bl->buffer, data + part, len - part);
+}
+
+void BacklogGet(uint32_t lane, uint32_t offset, char *data, uint32_t len)
+{
+  BACKLOG_LANE *bl = &Backlog.lane[lane];
+  uint32_t pos = (bl->head + offset) % bl->size;
+  uint32_t part = (len < bl->size - pos) ? len : bl->size - pos;
+  memcpy(data, bl->buffer + pos, part);
+  memcpy(data + part, bl->buffer, len - part);
+}
+
+bool BacklogFits(uint32_t source, uint32_t count, uint32_t size)
+{
+  // size: Total of command lengths plus three header bytes per command
+  BACKLOG_LANE *bl = &Backlog.lane[BacklogLane(source)];
+  return ((bl->count + count <= MAX_BACKLOG) && (bl->used + size <= bl->size));
+}
+
+bool BacklogAdd(const char *command, uint32_t source, bool front)
+{
+  // front: Insert before queued entries (used by rules IF statement blocks)
+  uint32_t lane = BacklogLane(source);
+  BACKLOG_LANE *bl = &Backlog.lane[lane];
+  uint32_t len = strlen(command);
+  uint32_t size = len +3;
+  if (!BacklogFits(source, 1, size)) {
+    AddLog_P2(LOG_LEVEL_INFO, PSTR("CMD: Backlog full, %s dropped"), command);
+    return false;
+  }
+
+  uint32_t offset = bl->used;
+  if (front) {
+    bl->head = (bl->head + bl->size - size) % bl->size;
+    offset = 0;
+  }
+  char header[3] = { (char)source, (char)len, (char)(len >> 8) };
+  BacklogPut(lane, offset, header, sizeof(header));
+  BacklogPut(lane, offset +3, command, len);
+  bl->used += size;
+  bl->count++;
+  return true;
+}
+
+uint32_t BacklogNext(void)
+{
+  for (uint32_t lane = 0; lane < BACKLOG_LANES; lane++) {
+    if (Backlog.lane[lane].count) { return lane; }
+  }
+  return BACKLOG_LANES;
+}
+
+uint32_t BacklogLength(uint32_t lane)
+{
+  char header[3];
+  BacklogGet(lane, 0, header, sizeof(header));
+  return (uint8_t)header[1] | ((uint8_t)header[2] << 8);
+}
+
+uint32_t BacklogShift(uint32_t lane, char *command)
+{
+  // command: buffer of at least BacklogLength(lane) +1 bytes
+  BACKLOG_LANE *bl = &Backlog.lane[lane];
+  char header[3];
+  BacklogGet(lane, 0, header, sizeof(header));
+  uint32_t len = (uint8_t)header[1] | ((uint8_t)header[2] << 8);
+  BacklogGet(lane, 3, command, len);
+  command[len] = '\0';
+  bl->head = (bl->head + len +3) % bl->size;
+  bl->used -= len +3;
+  bl->count--;
+  return (uint8_t)header[0];
+}
+
+void BacklogClear(void)
+{
+  for (uint32_t lane = 0; lane < BACKLOG_LANES; lane++) {
+    Backlog.lane[lane].head = 0;
+    Backlog.lane[lane].used = 0;
+    Backlog.lane[lane].count = 0;
+  }
 }
 
 /********************************************************************************************/
@@ -182,6 +375,8 @@ void CommandHandler(char* topicBuf, char* dataBuf, uint32_t data_len)
   ShowFreeMem(PSTR("CommandHandler"));
 #endif
 
+  SensorSnapshotInvalidate();            // Command may change sensor state, units or resolution
+
   while (*dataBuf && isspace(*dataBuf)) {
     dataBuf++;                           // Skip leading spaces in data
     data_len--;
@@ -260,21 +455,13 @@ void CommandHandler(char* topicBuf, char* dataBuf, uint32_t data_len)
 #ifdef USE_SCRIPT_SUB_COMMAND
   // allow overwrite tasmota cmds
     if (!Script_SubCmd()) {
-      if (!DecodeCommand(kTasmotaCommands, TasmotaCommand)) {
-        if (!XdrvCall(FUNC_COMMAND)) {
-          if (!XsnsCall(FUNC_COMMAND)) {
-            type = nullptr;  // Unknown command
-          }
-        }
+      if (!CommandDecode()) {
+        type = nullptr;  // Unknown command
       }
     }
 #else //USE_SCRIPT_SUB_COMMAND
-    if (!DecodeCommand(kTasmotaCommands, TasmotaCommand)) {
-      if (!XdrvCall(FUNC_COMMAND)) {
-        if (!XsnsCall(FUNC_COMMAND)) {
-          type = nullptr;  // Unknown command
-        }
-      }
+    if (!CommandDecode()) {
+      type = nullptr;  // Unknown command
     }
 #endif //USE_SCRIPT_SUB_COMMAND
 
@@ -299,17 +486,8 @@ void CommandHandler(char* topicBuf, char* dataBuf, uint32_t data_len)
 void CmndBacklog(void)
 {
   if (XdrvMailbox.data_len) {
-
-#ifdef SUPPORT_IF_STATEMENT
-    char *blcommand = strtok(XdrvMailbox.data, ";");
-    while ((blcommand != nullptr) && (backlog.size() < MAX_BACKLOG))
-#else
-    uint32_t bl_pointer = (!backlog_pointer) ? MAX_BACKLOG -1 : backlog_pointer;
-    bl_pointer--;
     char *blcommand = strtok(XdrvMailbox.data, ";");
-    while ((blcommand != nullptr) && (backlog_index != bl_pointer))
-#endif
-    {
+    while (blcommand != nullptr) {
       while(true) {
         blcommand = Trim(blcommand);
         if (!strncasecmp_P(blcommand, PSTR(D_CMND_BACKLOG), strlen(D_CMND_BACKLOG))) {
@@ -318,28 +496,16 @@ void CmndBacklog(void)
           break;
         }
       }
-      if (*blcommand != '\0') {
-#ifdef SUPPORT_IF_STATEMENT
-        if (backlog.size() < MAX_BACKLOG) {
-          backlog.add(blcommand);
-        }
-#else
-        backlog[backlog_index] = String(blcommand);
-        backlog_index++;
-        if (backlog_index >= MAX_BACKLOG) backlog_index = 0;
-#endif
+      if ((*blcommand != '\0') && !BacklogAdd(blcommand, command_source, false)) {
+        break;                                                                  // Backlog full
       }
       blcommand = strtok(nullptr, ";");
     }
 //    ResponseCmndChar(D_JSON_APPENDED);
-    mqtt_data[0] = '\0';
+    ResponseClear();
   } else {
     bool blflag = BACKLOG_EMPTY;
-#ifdef SUPPORT_IF_STATEMENT
-    backlog.clear();
-#else
-    backlog_pointer = backlog_index;
-#endif
+    BacklogClear();
     ResponseCmndChar(blflag ? D_JSON_EMPTY : D_JSON_ABORTED);
   }
 }
@@ -363,14 +529,14 @@ void CmndPower(void)
     }
 //      Settings.flag.device_index_enable = XdrvMailbox.usridx;  // SetOption26 - Switch between POWER or POWER1
     ExecuteCommandPower(XdrvMailbox.index, XdrvMailbox.payload, SRC_IGNORE);
-    mqtt_data[0] = '\0';
+    ResponseClear();
   }
   else if (0 == XdrvMailbox.index) {
     if ((XdrvMailbox.payload < POWER_OFF) || (XdrvMailbox.payload > POWER_TOGGLE)) {
       XdrvMailbox.payload = POWER_SHOW_STATE;
     }
     SetAllPower(XdrvMailbox.payload, SRC_IGNORE);
-    mqtt_data[0] = '\0';
+    ResponseClear();
   }
 }
 
@@ -427,6 +593,7 @@ void CmndStatus(void)
 #ifdef ESP8266
                           ",\"" D_JSON_SAVEADDRESS "\":\"%X\""
 #endif
+                          ",\"BootTime\":{\"Settings\":%d,\"Power\":%d,\"Setup\":%d,\"Sensors\":%d,\"Wifi\":%d,\"Mqtt\":%d}"
                           "}}"),
                           Settings.baudrate * 300, GetSerialConfig().c_str(), SettingsText(SET_MQTT_GRP_TOPIC), SettingsText(SET_OTAURL),
                           GetResetReason().c_str(), GetUptime().c_str(), GetDateAndTime(DT_RESTART).c_str(), Settings.sleep,
@@ -434,6 +601,7 @@ void CmndStatus(void)
 #ifdef ESP8266
                           , GetSettingsAddress()
 #endif
+                          , BootTime.settings, BootTime.power, BootTime.setup, BootTime.sensors, BootTime.wifi, BootTime.mqtt
                           );
     MqttPublishPrefixTopic_P(option, PSTR(D_CMND_STATUS "1"));
   }
@@ -459,11 +627,15 @@ void CmndStatus(void)
   if ((0 == payload) || (3 == payload)) {
     Response_P(PSTR("{\"" D_CMND_STATUS D_STATUS3_LOGGING "\":{\"" D_CMND_SERIALLOG "\":%d,\"" D_CMND_WEBLOG "\":%d,\"" D_CMND_MQTTLOG "\":%d,\"" D_CMND_SYSLOG "\":%d,\""
                           D_CMND_LOGHOST "\":\"%s\",\"" D_CMND_LOGPORT "\":%d,\"" D_CMND_SSID "\":[\"%s\",\"%s\"],\"" D_CMND_TELEPERIOD "\":%d,\""
-                          D_JSON_RESOLUTION "\":\"%08X\",\"" D_CMND_SETOPTION "\":[\"%08X\",\"%s\",\"%08X\",\"%08X\"]}}"),
+                          D_JSON_RESOLUTION "\":\"%08X\",\"" D_CMND_SETOPTION "\":[\"%08X\",\"%s\",\"%08X\",\"%08X\"]"),
                           Settings.seriallog_level, Settings.weblog_level, Settings.mqttlog_level, Settings.syslog_level,
                           SettingsText(SET_SYSLOG_HOST), Settings.syslog_port, SettingsText(SET_STASSID1), SettingsText(SET_STASSID2), Settings.tele_period,
                           Settings.flag2.data, Settings.flag.data, ToHex_P((unsigned char*)Settings.param, PARAM8_SIZE, stemp2, sizeof(stemp2)),
                           Settings.flag3.data, Settings.flag4.data);
+#ifdef USE_DEFERRED_LOG
+    LogDeferStatus();
+#endif  // USE_DEFERRED_LOG
+    ResponseJsonEndEnd();
     MqttPublishPrefixTopic_P(option, PSTR(D_CMND_STATUS "3"));
   }
 
@@ -491,6 +663,14 @@ void CmndStatus(void)
     XsnsDriverState();
     ResponseAppend_P(PSTR(",\"Sensors\":"));
     XsnsSensorState();
+    TasmotaSerialState();
+    HeapStatus();
+#ifdef USE_FLASH_WEAR
+    FlashWearStatus();
+#endif  // USE_FLASH_WEAR
+#ifdef USE_JSON_ARENA
+    JsonArenaStatus();
+#endif  // USE_JSON_ARENA
     ResponseJsonEndEnd();
     MqttPublishPrefixTopic_P(option, PSTR(D_CMND_STATUS "4"));
   }
@@ -498,18 +678,29 @@ void CmndStatus(void)
   if ((0 == payload) || (5 == payload)) {
     Response_P(PSTR("{\"" D_CMND_STATUS D_STATUS5_NETWORK "\":{\"" D_CMND_HOSTNAME "\":\"%s\",\"" D_CMND_IPADDRESS "\":\"%s\",\"" D_JSON_GATEWAY "\":\"%s\",\""
                           D_JSON_SUBNETMASK "\":\"%s\",\"" D_JSON_DNSSERVER "\":\"%s\",\"" D_JSON_MAC "\":\"%s\",\""
-                          D_CMND_WEBSERVER "\":%d,\"" D_CMND_WIFICONFIG "\":%d,\"" D_CMND_WIFIPOWER "\":%s}}"),
+                          D_CMND_WEBSERVER "\":%d,\"" D_CMND_WIFICONFIG "\":%d,\"" D_CMND_WIFIPOWER "\":%s"),
                           my_hostname, WiFi.localIP().toString().c_str(), IPAddress(Settings.ip_address[1]).toString().c_str(),
                           IPAddress(Settings.ip_address[2]).toString().c_str(), IPAddress(Settings.ip_address[3]).toString().c_str(), WiFi.macAddress().c_str(),
                           Settings.webserver, Settings.sta_config, WifiGetOutputPower().c_str());
+#ifdef USE_DNS_CACHE
+    DnsCacheStatus();
+#endif  // USE_DNS_CACHE
+    ResponseJsonEndEnd();
     MqttPublishPrefixTopic_P(option, PSTR(D_CMND_STATUS "5"));
   }
 
   if (((0 == payload) || (6 == payload)) && Settings.flag.mqtt_enabled) {  // SetOption3 - Enable MQTT
     Response_P(PSTR("{\"" D_CMND_STATUS D_STATUS6_MQTT "\":{\"" D_CMND_MQTTHOST "\":\"%s\",\"" D_CMND_MQTTPORT "\":%d,\"" D_CMND_MQTTCLIENT D_JSON_MASK "\":\"%s\",\""
-                          D_CMND_MQTTCLIENT "\":\"%s\",\"" D_CMND_MQTTUSER "\":\"%s\",\"" D_JSON_MQTT_COUNT "\":%d,\"MAX_PACKET_SIZE\":%d,\"KEEPALIVE\":%d}}"),
+                          D_CMND_MQTTCLIENT "\":\"%s\",\"" D_CMND_MQTTUSER "\":\"%s\",\"" D_JSON_MQTT_COUNT "\":%d,\"MAX_PACKET_SIZE\":%d,\"KEEPALIVE\":%d"),
                           SettingsText(SET_MQTT_HOST), Settings.mqtt_port, SettingsText(SET_MQTT_CLIENT),
                           mqtt_client, SettingsText(SET_MQTT_USER), MqttConnectCount(), MQTT_MAX_PACKET_SIZE, MQTT_KEEPALIVE);
+#ifdef USE_MQTT_QUEUE
+    MqttQueueStatus();
+#endif  // USE_MQTT_QUEUE
+#if defined(ESP32) && defined(USE_NETWORK_TASK)
+    NetStatus();
+#endif  // ESP32 and USE_NETWORK_TASK
+    ResponseJsonEndEnd();
     MqttPublishPrefixTopic_P(option, PSTR(D_CMND_STATUS "6"));
   }
 
@@ -580,12 +771,12 @@ void CmndStatus(void)
     XdrvRulesProcess();  // Allow rule processing on single Status command only
   }
 
-  mqtt_data[0] = '\0';
+  ResponseClear();
 }
 
 void CmndState(void)
 {
-  mqtt_data[0] = '\0';
+  ResponseClear();
   MqttShowState();
   if (Settings.flag3.hass_tele_on_power) {  // SetOption59 - Send tele/%topic%/STATE in addition to stat/%topic%/RESULT
     MqttPublishPrefixTopic_P(TELE, PSTR(D_RSLT_STATE), MQTT_TELE_RETAIN);
@@ -751,7 +942,7 @@ void CmndPulsetime(void)
         SetPulseTimer(XdrvMailbox.index -1, XdrvMailbox.payload);
       }
     }
-    mqtt_data[0] = '\0';
+    ResponseClear();
     for (uint32_t i = 0; i < items; i++) {
       uint32_t index = (1 == items) ? XdrvMailbox.index : i +1;
       ResponseAppend_P(PSTR("%c\"%s%d\":{\"" D_JSON_SET "\":%d,\"" D_JSON_REMAINING "\":%d}"),
@@ -899,6 +1090,7 @@ void CmndSetoption(void)
             switch (pindex) {
               case 3:                      // SetOption85 - Enable Device Groups
               case 6:                      // SetOption88 - PWM Dimmer Buttons control remote devices
+              case 14:                     // SetOption96 - Interrupt driven switch and button input
                 restart_flag = 2;
                 break;
             }
@@ -1053,7 +1245,7 @@ void CmndModules(void)
       lines++;
     }
   }
-  mqtt_data[0] = '\0';
+  ResponseClear();
 }
 
 void CmndGpio(void)
@@ -1162,7 +1354,7 @@ void CmndGpios(void)
       lines++;
     }
   }
-  mqtt_data[0] = '\0';
+  ResponseClear();
 }
 
 void CmndTemplate(void)
@@ -1662,7 +1854,7 @@ void CmndTime(void)
       RtcSetTime(XdrvMailbox.payload);
     }
   }
-  mqtt_data[0] = '\0';
+  ResponseClear();
   ResponseAppendTimeFormat(format);
   ResponseJsonEnd();
 }
@@ -1883,8 +2075,11 @@ void CmndWifiPower(void)
 #ifdef USE_I2C
 void CmndI2cScan(void)
 {
-  if (i2c_flg) {
-    I2cScan(mqtt_data, sizeof(mqtt_data));
+  // I2CScan or I2CScan1 scans the first bus, I2CScan2 the second bus on ESP32
+  uint32_t bus = ((XdrvMailbox.index > 0) && (XdrvMailbox.index <= MAX_I2C)) ? XdrvMailbox.index -1 : 0;
+  if (I2cBusEnabled(bus)) {
+    I2cScan(mqtt_data, sizeof(mqtt_data), bus);
+    ResponseSetLength(strlen(mqtt_data));
   }
 }
 
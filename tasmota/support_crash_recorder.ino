@@ -19,9 +19,28 @@
 
 #ifdef ESP8266
 
-const uint32_t crash_magic = 0x53415400;   // Stack trace magic number (TASx)
+const uint32_t crash_magic = 0x53415500;   // Stack trace and context magic number (UASx)
 const uint32_t crash_rtc_offset = 32;      // Offset in RTC memory skipping OTA used block
-const uint32_t crash_dump_max_len = 31;    // Dump only 31 call addresses to satisfy max JSON length of about 600 characters
+const uint32_t crash_dump_max_len = 31;    // RTC blocks used for call addresses and context, followed by the magic block
+const uint32_t crash_call_max_len = 16;    // Dump only 16 call addresses leaving room for the context
+const uint32_t crash_trace_events = 4;     // Last trace events saved with USE_TRACE
+
+const uint32_t CRASH_CALL_DRIVER = 0x10000;  // crash_call of a driver call, index << 8 | function
+const uint32_t CRASH_CALL_SENSOR = 0x20000;  // crash_call of a sensor call, index << 8 | function
+
+uint32_t crash_call = 0;                   // Driver or sensor call in progress
+
+// Saved in the 14 RTC blocks following the call addresses
+struct CRASH_CONTEXT {
+  uint32_t call;                           // crash_call
+  uint32_t uptime;                         // Seconds
+  uint32_t heap;                           // Free heap in bytes
+  uint32_t since_loop;                     // mS since the last loop() start
+  uint16_t loop_last;                      // mS of the last loop() period
+  uint16_t loop_max;                       // Max mS of a loop() period since restart
+  uint32_t trace_count;
+  uint32_t trace[crash_trace_events * 2];  // Trace entries of micros() and event, phase and argument
+};
 
 /**
  * Save crash information in RTC memory
@@ -38,9 +57,22 @@ extern "C" void custom_crash_callback(struct rst_info * rst_info, uint32_t stack
     if ((value >= 0x40000000) && (value < 0x40300000)) {  // keep only addresses in code area
       ESP.rtcUserMemoryWrite(crash_rtc_offset + addr_written, (uint32_t*)&value, sizeof(value));
       addr_written++;
-      if (addr_written >= crash_dump_max_len) { break; }  // we store only 31 addresses
+      if (addr_written >= crash_call_max_len) { break; }  // we store only 16 addresses
     }
   }
+
+  CRASH_CONTEXT context = { 0 };
+  context.call = crash_call;
+  context.uptime = uptime;
+  context.heap = ESP.getFreeHeap();
+  context.since_loop = millis() - oswatch_last_loop_time;
+  context.loop_last = tmin(oswatch_loop_last, 0xFFFF);
+  context.loop_max = tmin(oswatch_loop_max, 0xFFFF);
+#ifdef USE_TRACE
+  context.trace_count = TraceLast(context.trace, crash_trace_events);
+#endif  // USE_TRACE
+  ESP.rtcUserMemoryWrite(crash_rtc_offset + crash_call_max_len, (uint32_t*)&context, sizeof(context));
+
   value = crash_magic + addr_written;
   ESP.rtcUserMemoryWrite(crash_rtc_offset + crash_dump_max_len, (uint32_t*)&value, sizeof(value));
 }
@@ -78,6 +110,10 @@ void CrashDumpClear(void)
 
 /*********************************************************************************************\
  * CmndCrashDump - dump the crash history - called by `Status 12`
+ *
+ * Context reports uptime, free heap and loop() periods at the crash, the driver or sensor
+ * function being called (also when OsWatchTicker() found a blocked loop) and with USE_TRACE
+ * the last trace events as mS before the last event, name, phase and argument.
 \*********************************************************************************************/
 
 bool CrashFlag(void)
@@ -101,12 +137,39 @@ void CrashDump(void)
   if (crash_magic == (value & 0xFFFFFF00)) {
     ResponseAppend_P(PSTR(",\"CallChain\":["));
     uint32_t count = value & 0x3F;
+    if (count > crash_call_max_len) { count = crash_call_max_len; }
     for (uint32_t i = 0; i < count; i++) {
       ESP.rtcUserMemoryRead(crash_rtc_offset +i, (uint32_t*)&value, sizeof(value));
       if (i > 0) { ResponseAppend_P(PSTR(",")); }
       ResponseAppend_P(PSTR("\"%08x\""), value);
     }
     ResponseAppend_P(PSTR("]"));
+
+    CRASH_CONTEXT context;
+    ESP.rtcUserMemoryRead(crash_rtc_offset + crash_call_max_len, (uint32_t*)&context, sizeof(context));
+    ResponseAppend_P(PSTR(",\"Context\":{\"Uptime\":%u,\"Heap\":%u,\"Loop\":{\"Last\":%u,\"Max\":%u,\"Since\":%u}"),
+      context.uptime, context.heap, context.loop_last, context.loop_max, context.since_loop);
+    if (context.call) {
+      uint32_t index = (context.call >> 8) & 0xFF;
+      bool sensor = (context.call & CRASH_CALL_SENSOR);
+      ResponseAppend_P(PSTR(",\"Call\":{\"%s\":%d,\"Function\":%d}"),
+        (sensor) ? "Xsns" : "Xdrv", (sensor) ? XsnsId(index) : XdrvId(index), context.call & 0xFF);
+    }
+#ifdef USE_TRACE
+    if (context.trace_count && (context.trace_count <= crash_trace_events)) {
+      // [mS before the last event,name,phase,argument]
+      ResponseAppend_P(PSTR(",\"Trace\":["));
+      uint32_t last = context.trace[(context.trace_count -1) * 2];
+      char name[24];
+      for (uint32_t i = 0; i < context.trace_count; i++) {
+        uint32_t entry = context.trace[i * 2 +1];
+        uint32_t arg = TraceName(name, sizeof(name), (entry >> 16) & 0xFF, entry & 0xFFFF);
+        ResponseAppend_P(PSTR("%s[%u,\"%s\",%d,%d]"), (i) ? "," : "", (last - context.trace[i * 2]) / 1000, name, entry >> 24, arg);
+      }
+      ResponseAppend_P(PSTR("]"));
+    }
+#endif  // USE_TRACE
+    ResponseJsonEnd();
   }
 
   ResponseJsonEnd();
@@ -26,6 +26,10 @@
 //#define DEVICE_GROUPS_DEBUG
 #define DGR_MEMBER_TIMEOUT        45000
 #define DGR_ANNOUNCEMENT_INTERVAL 60000
+#define DGR_COALESCE_INTERVAL     100
+#define DGR_ACK_MIN_INTERVAL      100
+#define DGR_ACK_MAX_INTERVAL      5000
+#define DGR_ACKED_INTEGERS        (DGR_ITEM_LAST_8BIT + DGR_ITEM_LAST_16BIT - DGR_ITEM_MAX_8BIT - 1 + DGR_ITEM_LAST_32BIT - DGR_ITEM_MAX_16BIT - 1)
 #define DEVICE_GROUP_MESSAGE      "TASMOTA_DGR"
 
 const char kDeviceGroupMessage[] PROGMEM = DEVICE_GROUP_MESSAGE;
@@ -42,13 +46,24 @@ struct device_group {
   uint32_t next_announcement_time;
   uint32_t next_ack_check_time;
   uint32_t member_timeout_time;
+  uint32_t last_send_time;
+  uint32_t next_send_time;
+  uint32_t acked_items;
+  uint32_t acked_values[DGR_ACKED_INTEGERS];
   uint16_t outgoing_sequence;
   uint16_t last_full_status_sequence;
   uint16_t message_length;
   uint16_t ack_check_interval;
+  uint16_t round_trip_time;
+  uint16_t round_trip_variation;
   uint8_t message_header_length;
   uint8_t initial_status_requests_remaining;
+  uint8_t acked_channels[6];
   bool local;
+  bool send_pending;
+  bool pending_more_to_come;
+  bool message_resent;
+  bool round_trip_measured;
   char group_name[TOPSZ];
   uint8_t message[128];
   struct device_group_member * device_group_members;
@@ -85,6 +100,95 @@ uint8_t * BeginDeviceGroupMessage(struct device_group * device_group, uint16_t f
   return message_ptr;
 }
 
+// Return the index of an item in the acked item values or -1 if the item's value isn't kept.
+int DeviceGroupAckedIndex(uint8_t item)
+{
+  int index = -1;
+  if (item < DGR_ITEM_LAST_8BIT)
+    index = item;
+  else if (item > DGR_ITEM_MAX_8BIT && item < DGR_ITEM_LAST_16BIT)
+    index = DGR_ITEM_LAST_8BIT + item - DGR_ITEM_MAX_8BIT - 1;
+  else if (item > DGR_ITEM_MAX_16BIT && item < DGR_ITEM_LAST_32BIT)
+    index = DGR_ITEM_LAST_8BIT + DGR_ITEM_LAST_16BIT - DGR_ITEM_MAX_8BIT - 1 + item - DGR_ITEM_MAX_16BIT - 1;
+  else if (item == DGR_ITEM_LIGHT_CHANNELS)
+    index = DGR_ACKED_INTEGERS;
+  return (index < 32 ? index : -1);
+}
+
+// Return true if all members acknowledged the specified item with the specified value.
+bool DeviceGroupItemAcked(struct device_group * device_group, uint8_t item, uint32_t value, const uint8_t * value_ptr)
+{
+  int index = DeviceGroupAckedIndex(item);
+  if (index < 0 || !(device_group->acked_items & 1 << index)) return false;
+  if (item == DGR_ITEM_LIGHT_CHANNELS) return !memcmp(value_ptr, device_group->acked_channels, sizeof(device_group->acked_channels));
+  if (item <= DGR_ITEM_MAX_8BIT)
+    value &= 0xff;
+  else if (item <= DGR_ITEM_MAX_16BIT)
+    value &= 0xffff;
+  return value == device_group->acked_values[index];
+}
+
+// Forget the acked value of the specified item.
+void DeviceGroupItemChanged(struct device_group * device_group, uint8_t item)
+{
+  int index = DeviceGroupAckedIndex(item);
+  if (index >= 0) device_group->acked_items &= ~(1 << index);
+}
+
+// Remember the values of the items in the current message once all members acknowledged it.
+void DeviceGroupMessageAcked(struct device_group * device_group)
+{
+  uint8_t * message_ptr = &device_group->message[device_group->message_header_length + 4];
+  uint8_t * message_end_ptr = device_group->message + device_group->message_length;
+  uint8_t item;
+  uint32_t length;
+  uint32_t value;
+  int index;
+  while (message_ptr < message_end_ptr && (item = *message_ptr++)) {
+    index = DeviceGroupAckedIndex(item);
+    if (item <= DGR_ITEM_MAX_32BIT) {
+      length = (item > DGR_ITEM_MAX_16BIT ? 4 : (item > DGR_ITEM_MAX_8BIT ? 2 : 1));
+      if (index >= 0) {
+        value = 0;
+        for (uint32_t i = length; i--;) value = value << 8 | message_ptr[i];
+        device_group->acked_values[index] = value;
+      }
+    }
+    else {
+      length = *message_ptr++;
+      if (item == DGR_ITEM_LIGHT_CHANNELS && index >= 0) memcpy(device_group->acked_channels, message_ptr, sizeof(device_group->acked_channels));
+    }
+    if (index >= 0) device_group->acked_items |= 1 << index;
+    message_ptr += length;
+  }
+}
+
+// Update the smoothed ack round trip time and its variation (RFC 6298).
+void DeviceGroupRoundTrip(struct device_group * device_group, uint32_t round_trip_time)
+{
+  if (round_trip_time > DGR_ACK_MAX_INTERVAL) round_trip_time = DGR_ACK_MAX_INTERVAL;
+  if (!device_group->round_trip_measured) {
+    device_group->round_trip_time = round_trip_time;
+    device_group->round_trip_variation = round_trip_time / 2;
+    device_group->round_trip_measured = true;
+  }
+  else {
+    uint32_t delta = abs((int)device_group->round_trip_time - (int)round_trip_time);
+    device_group->round_trip_variation = (3 * device_group->round_trip_variation + delta) / 4;
+    device_group->round_trip_time = (7 * device_group->round_trip_time + round_trip_time) / 8;
+  }
+}
+
+// Return the time to wait for acks before the first resend.
+uint16_t DeviceGroupAckTimeout(struct device_group * device_group)
+{
+  if (!device_group->round_trip_measured) return 200;
+  uint32_t timeout = device_group->round_trip_time + 4 * device_group->round_trip_variation;
+  if (timeout < DGR_ACK_MIN_INTERVAL) timeout = DGR_ACK_MIN_INTERVAL;
+  if (timeout > DGR_ACK_MAX_INTERVAL) timeout = DGR_ACK_MAX_INTERVAL;
+  return timeout;
+}
+
 // Return true if we're configured to share the specified item.
 bool DeviceGroupItemShared(bool incoming, uint8_t item)
 {
@@ -190,6 +294,8 @@ void DeviceGroupsStart()
     struct device_group * device_group = device_groups;
     for (uint32_t device_group_index = 0; device_group_index < device_group_count; device_group_index++, device_group++) {
       device_group->next_announcement_time = -1;
+      device_group->send_pending = false;
+      device_group->acked_items = 0;
       device_group->message_length = BeginDeviceGroupMessage(device_group, DGR_FLAG_RESET | DGR_FLAG_STATUS_REQUEST) - device_group->message;
       device_group->initial_status_requests_remaining = 10;
       device_group->next_ack_check_time = next_check_time;
@@ -238,6 +344,12 @@ void SendReceiveDeviceGroupMessage(struct device_group * device_group, struct de
   // received from this member.
   if (flags == DGR_FLAG_ACK) {
     if (received && device_group_member && (message_sequence > device_group_member->acked_sequence || device_group_member->acked_sequence - message_sequence < 64536)) {
+
+      // If this is the first ack from this member to our last message and the message was not
+      // resent, use it to measure the round trip time.
+      if (message_sequence == device_group->outgoing_sequence && device_group_member->acked_sequence != message_sequence && !device_group->message_resent && !device_group->send_pending) {
+        DeviceGroupRoundTrip(device_group, millis() - device_group->last_send_time);
+      }
       device_group_member->acked_sequence = message_sequence;
     }
     goto write_log;
@@ -376,6 +488,9 @@ void SendReceiveDeviceGroupMessage(struct device_group * device_group, struct de
     log_ptr += log_length;
     log_remaining -= log_length;
 
+    // If another member changed this item, we no longer know which value all members have.
+    if (received) DeviceGroupItemChanged(device_group, item);
+
     if (received && DeviceGroupItemShared(true, item)) {
       item_processed = true;
       XdrvMailbox.command_code = item;
@@ -482,7 +597,7 @@ bool _SendDeviceGroupMessage(uint8_t device_group_index, DevGroupMessageType mes
     flags = DGR_FLAG_MORE_TO_COME;
   else if (message_type == DGR_MSGTYP_UPDATE_DIRECT)
     flags = DGR_FLAG_DIRECT;
-  uint8_t * message_ptr = BeginDeviceGroupMessage(device_group, flags, building_status_message || message_type == DGR_MSGTYP_PARTIAL_UPDATE);
+  uint8_t * message_ptr = BeginDeviceGroupMessage(device_group, flags, building_status_message || message_type == DGR_MSGTYP_PARTIAL_UPDATE || device_group->send_pending);
 
   // A full status request is a request from a remote device for the status of every item we
   // control. As long as we're building it, we may as well multicast the status update to all
@@ -629,6 +744,9 @@ bool _SendDeviceGroupMessage(uint8_t device_group_index, DevGroupMessageType mes
           value = *previous_message_ptr + 1;
         }
 
+        // The members may not all have the value from the previous update yet.
+        DeviceGroupItemChanged(device_group, item);
+
         // Search for this item in the new update.
         for (item_ptr = item_array; item_ptr->item; item_ptr++) {
           if (item_ptr->item == item) break;
@@ -657,11 +775,18 @@ bool _SendDeviceGroupMessage(uint8_t device_group_index, DevGroupMessageType mes
       shared = true;
       if (!device_group_index && message_type != DGR_MSGTYPE_UPDATE_COMMAND) shared = DeviceGroupItemShared(false, item);
       if (shared) {
+
+        // For the power item, the device count is overlayed onto the highest 8 bits.
+        value = item_ptr->value;
+        if (item == DGR_ITEM_POWER && !(value >> 24)) value |= (device_group_index == 0 ? devices_present : 1) << 24;
+
+        // If all members acknowledged this item with the same value, leave it out of the update.
+        if (!building_status_message && message_type != DGR_MSGTYPE_UPDATE_COMMAND && DeviceGroupItemAcked(device_group, item, value, (const uint8_t *)item_ptr->value_ptr)) continue;
+
         *message_ptr++ = item;
 
         // For integer items, add the value to the message.
         if (item <= DGR_ITEM_MAX_32BIT) {
-          value = item_ptr->value;
           *message_ptr++ = value & 0xff;
           if (item > DGR_ITEM_MAX_8BIT) {
             value >>= 8;
@@ -670,8 +795,6 @@ bool _SendDeviceGroupMessage(uint8_t device_group_index, DevGroupMessageType mes
               value >>= 8;
               *message_ptr++ = value & 0xff;
               value >>= 8;
-              // For the power item, the device count is overlayed onto the highest 8 bits.
-              if (item == DGR_ITEM_POWER && !value) value = (device_group_index == 0 ? devices_present : 1);
               *message_ptr++ = value;
             }
           }
@@ -714,8 +837,20 @@ bool _SendDeviceGroupMessage(uint8_t device_group_index, DevGroupMessageType mes
     return 0;
   }
 
+  // If we multicast an update less than DGR_COALESCE_INTERVAL ms ago, hold this one so updates
+  // that follow within the interval are merged into it. DeviceGroupsLoop multicasts it when the
+  // interval has passed.
+  bool more_to_come = (message_type == DGR_MSGTYP_UPDATE_MORE_TO_COME);
+  if ((message_type == DGR_MSGTYP_UPDATE || more_to_come) && millis() - device_group->last_send_time < DGR_COALESCE_INTERVAL) {
+    device_group->send_pending = true;
+    device_group->pending_more_to_come = more_to_come;
+    device_group->next_send_time = device_group->last_send_time + DGR_COALESCE_INTERVAL;
+    if (device_group->next_send_time < next_check_time) next_check_time = device_group->next_send_time;
+    return 0;
+  }
+
   // Multicast the packet.
-  SendReceiveDeviceGroupMessage(device_group, nullptr, device_group->message, device_group->message_length, false);
+  MulticastDeviceGroupMessage(device_group, more_to_come);
 
 #ifdef USE_DEVICE_GROUPS_SEND
   // If this is the DevGroupSend command, also handle the update locally.
@@ -725,14 +860,25 @@ bool _SendDeviceGroupMessage(uint8_t device_group_index, DevGroupMessageType mes
     XdrvMailbox = save_XdrvMailbox;
   }
 #endif  // USE_DEVICE_GROUPS_SEND
+  return 0;
+}
+
+void MulticastDeviceGroupMessage(struct device_group * device_group, bool more_to_come)
+{
+  SendReceiveDeviceGroupMessage(device_group, nullptr, device_group->message, device_group->message_length, false);
 
   uint32_t now = millis();
-  if (message_type == DGR_MSGTYP_UPDATE_MORE_TO_COME) {
+  device_group->send_pending = false;
+  device_group->message_resent = false;
+  device_group->last_send_time = now;
+  if (more_to_come) {
     device_group->message_length = 0;
     device_group->next_ack_check_time = 0;
   }
   else {
-    device_group->ack_check_interval = 200;
+
+    // Wait for the acks as long as they take on average plus their variation before resending.
+    device_group->ack_check_interval = DeviceGroupAckTimeout(device_group);
     device_group->next_ack_check_time = now + device_group->ack_check_interval;
     if (device_group->next_ack_check_time < next_check_time) next_check_time = device_group->next_ack_check_time;
     device_group->member_timeout_time = now + DGR_MEMBER_TIMEOUT;
@@ -740,7 +886,6 @@ bool _SendDeviceGroupMessage(uint8_t device_group_index, DevGroupMessageType mes
 
   device_group->next_announcement_time = now + DGR_ANNOUNCEMENT_INTERVAL;
   if (device_group->next_announcement_time < next_check_time) next_check_time = device_group->next_announcement_time;
-  return 0;
 }
 
 void ProcessDeviceGroupMessage(uint8_t * message, int message_length)
@@ -769,6 +914,7 @@ void ProcessDeviceGroupMessage(uint8_t * message, int message_length)
       }
       device_group_member->ip_address = remote_ip;
       *flink = device_group_member;
+      device_group->acked_items = 0;  // The new member has not acknowledged anything yet
       AddLog_P2(LOG_LEVEL_DEBUG, PSTR("DGR: Member %s added"), IPAddressToString(remote_ip));
       break;
     }
@@ -792,7 +938,7 @@ void DeviceGroupStatus(uint8_t device_group_index)
       snprintf_P(buffer, sizeof(buffer), PSTR("%s,{\"IPAddress\":\"%s\",\"ResendCount\":%u,\"LastRcvdSeq\":%u,\"LastAckedSeq\":%u}"), buffer, IPAddressToString(device_group_member->ip_address), device_group_member->unicast_count, device_group_member->received_sequence, device_group_member->acked_sequence);
       member_count++;
     }
-    Response_P(PSTR("{\"" D_CMND_DEVGROUPSTATUS "\":{\"Index\":%u,\"GroupName\":\"%s\",\"MessageSeq\":%u,\"MemberCount\":%d,\"Members\":[%s]}"), device_group_index, device_group->group_name, device_group->outgoing_sequence, member_count, &buffer[1]);
+    Response_P(PSTR("{\"" D_CMND_DEVGROUPSTATUS "\":{\"Index\":%u,\"GroupName\":\"%s\",\"MessageSeq\":%u,\"RoundTripTime\":%u,\"AckTimeout\":%u,\"MemberCount\":%d,\"Members\":[%s]}"), device_group_index, device_group->group_name, device_group->outgoing_sequence, device_group->round_trip_time, DeviceGroupAckTimeout(device_group), member_count, &buffer[1]);
   }
 }
 
@@ -823,8 +969,18 @@ AddLog_P2(LOG_LEVEL_DEBUG, PSTR("DGR: Checking next_check_time=%u, now=%u"), nex
     struct device_group * device_group = device_groups;
     for (uint32_t device_group_index = 0; device_group_index < device_group_count; device_group_index++, device_group++) {
 
+      // If we're holding a coalesced update and it's time to send it, multicast it.
+      if (device_group->send_pending) {
+        if ((long)(now - device_group->next_send_time) >= 0) {
+          MulticastDeviceGroupMessage(device_group, device_group->pending_more_to_come);
+        }
+        else if (device_group->next_send_time < next_check_time) {
+          next_check_time = device_group->next_send_time;
+        }
+      }
+
       // If we're still waiting for acks to the last update from this device group, ...
-      if (device_group->next_ack_check_time) {
+      if (device_group->next_ack_check_time && !device_group->send_pending) {
 
         // If it's time to check for acks, ...
         if ((long)(now - device_group->next_ack_check_time) >= 0) {
@@ -873,6 +1029,7 @@ AddLog_P2(LOG_LEVEL_DEBUG, PSTR("DGR: Checking next_check_time=%u, now=%u"), nex
                 // Otherwise, unicast the last message directly to this member.
                 SendReceiveDeviceGroupMessage(device_group, device_group_member, device_group->message, device_group->message_length, false);
                 device_group_member->unicast_count++;
+                device_group->message_resent = true;
                 acked = false;
               }
               flink = &device_group_member->flink;
@@ -881,16 +1038,17 @@ AddLog_P2(LOG_LEVEL_DEBUG, PSTR("DGR: Checking next_check_time=%u, now=%u"), nex
             // If we've received an ack to the last message from all members, clear the ack check
             // time and zero-out the message length.
             if (acked) {
+              DeviceGroupMessageAcked(device_group);
               device_group->next_ack_check_time = 0;
               device_group->message_length = 0; // Let _SendDeviceGroupMessage know we're done with this update
             }
 
             // If there are still members we haven't received an ack from, set the next ack check
-            // time. We start at 200ms and double the interval each pass with a maximum interval of
-            // 5 seconds.
+            // time. We start at the ack timeout from the measured round trip time and double the
+            // interval each pass with a maximum interval of 5 seconds.
             else {
               device_group->ack_check_interval *= 2;
-              if (device_group->ack_check_interval > 5000) device_group->ack_check_interval = 5000;
+              if (device_group->ack_check_interval > DGR_ACK_MAX_INTERVAL) device_group->ack_check_interval = DGR_ACK_MAX_INTERVAL;
               device_group->next_ack_check_time = now + device_group->ack_check_interval;
             }
           }
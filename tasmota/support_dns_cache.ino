@@ -0,0 +1,228 @@
+/*
+  support_dns_cache.ino - DNS resolver cache for Tasmota
+
+  Copyright (C) 2020  Theo Arends
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef USE_DNS_CACHE
+/*********************************************************************************************\
+ * DNS resolver cache
+ *
+ * Keeps the address of DNS_CACHE_SIZE host names for DNS_CACHE_TTL seconds and a failed lookup
+ * for DNS_CACHE_NEGATIVE seconds. lwIP does not report the record TTL so a fixed TTL is used.
+ * A host used since its last lookup is looked up again in the background DNS_CACHE_REFRESH
+ * seconds before it expires, so its users keep getting an address without waiting.
+ *
+ * DnsCacheGetHostByName() replaces dns_gethostbyname() for the non blocking MQTT and WebSend
+ * connects which report the result of their lookup with DnsCacheStore(), ignored if it came from
+ * the cache. DnsHostByName() replaces
+ * WiFi.hostByName() for syslog and ping and only blocks on a cache miss.
+\*********************************************************************************************/
+
+#include "lwip/dns.h"
+
+#ifndef DNS_CACHE_SIZE
+#define DNS_CACHE_SIZE         8         // Max number of cached host names
+#endif
+#ifndef DNS_CACHE_TTL
+#define DNS_CACHE_TTL          300       // Seconds an address is used
+#endif
+#ifndef DNS_CACHE_NEGATIVE
+#define DNS_CACHE_NEGATIVE     30        // Seconds a failed lookup is not repeated
+#endif
+#ifndef DNS_CACHE_REFRESH
+#define DNS_CACHE_REFRESH      30        // Seconds before expiry a used address is looked up again
+#endif
+
+enum DnsCacheResults { DNS_CACHE_MISS, DNS_CACHE_HIT, DNS_CACHE_FAILED };
+enum DnsCacheRefreshStates { DNS_REFRESH_IDLE, DNS_REFRESH_PENDING, DNS_REFRESH_DONE, DNS_REFRESH_FAILED };
+
+struct DNS_CACHE_ENTRY {
+  char *host;                            // nullptr if free
+  uint32_t address;                      // 0 if the lookup failed
+  uint32_t expires;                      // uptime the entry expires
+  volatile uint32_t refresh_address;     // Result of a background lookup
+  volatile uint8_t refresh;              // DnsCacheRefreshStates
+  bool used;                             // Used since the last lookup
+};
+
+struct {
+  DNS_CACHE_ENTRY entry[DNS_CACHE_SIZE] = {};
+  uint32_t hits = 0;
+  uint32_t misses = 0;
+  uint32_t failed = 0;                   // Hits of failed lookups
+  uint32_t refreshes = 0;
+} DnsCache;
+
+DNS_CACHE_ENTRY* DnsCacheFind(const char *host)
+{
+  for (uint32_t i = 0; i < DNS_CACHE_SIZE; i++) {
+    if (DnsCache.entry[i].host && !strcasecmp(DnsCache.entry[i].host, host)) {
+      return &DnsCache.entry[i];
+    }
+  }
+  return nullptr;
+}
+
+void DnsCacheStore(const char *host, uint32_t address)
+{
+  // Store the result of a lookup, address 0 if it failed
+  IPAddress numeric;
+  if (!host || !strlen(host) || numeric.fromString(host)) { return; }  // Numeric hosts need no lookup
+
+  DNS_CACHE_ENTRY *entry = DnsCacheFind(host);
+  if (entry && ((int32_t)(uptime - entry->expires) < 0)) { return; }  // Result came from the cache
+  if (!entry) {
+    // Take a free entry, else the one expiring first without a pending lookup
+    for (uint32_t i = 0; i < DNS_CACHE_SIZE; i++) {
+      DNS_CACHE_ENTRY *candidate = &DnsCache.entry[i];
+      if (DNS_REFRESH_PENDING == candidate->refresh) { continue; }
+      if (!candidate->host) {
+        entry = candidate;
+        break;
+      }
+      if (!entry || ((int32_t)(candidate->expires - entry->expires) < 0)) {
+        entry = candidate;
+      }
+    }
+    if (!entry) { return; }
+    char *copy = (char*)malloc(strlen(host) +1);
+    if (!copy) { return; }
+    strcpy(copy, host);
+    free(entry->host);
+    entry->host = copy;
+    entry->refresh = DNS_REFRESH_IDLE;
+  }
+  entry->address = address;
+  entry->expires = uptime + ((address) ? DNS_CACHE_TTL : DNS_CACHE_NEGATIVE);
+  entry->used = false;
+}
+
+uint32_t DnsCacheLookup(const char *host, uint32_t *address)
+{
+  // Returns DnsCacheResults
+  DNS_CACHE_ENTRY *entry = DnsCacheFind(host);
+  if (!entry || ((int32_t)(uptime - entry->expires) >= 0)) {
+    DnsCache.misses++;
+    return DNS_CACHE_MISS;
+  }
+  if (!entry->address) {
+    DnsCache.failed++;
+    return DNS_CACHE_FAILED;
+  }
+  DnsCache.hits++;
+  entry->used = true;
+  *address = entry->address;
+  return DNS_CACHE_HIT;
+}
+
+err_t DnsCacheGetHostByName(const char *host, ip_addr_t *addr, dns_found_callback found, void *arg)
+{
+  uint32_t address;
+  switch (DnsCacheLookup(host, &address)) {
+    case DNS_CACHE_HIT:
+#if LWIP_VERSION_MAJOR == 1
+      addr->addr = address;
+#else
+      ip_addr_set_ip4_u32(addr, address);
+#endif
+      return ERR_OK;
+    case DNS_CACHE_FAILED:
+      return ERR_ARG;
+  }
+  return dns_gethostbyname(host, addr, found, arg);
+}
+
+bool DnsHostByName(const char *host, IPAddress &ip)
+{
+  if (ip.fromString(host)) { return true; }
+  uint32_t address;
+  switch (DnsCacheLookup(host, &address)) {
+    case DNS_CACHE_HIT:
+      ip = address;
+      return true;
+    case DNS_CACHE_FAILED:
+      return false;
+  }
+  bool found = WiFi.hostByName(host, ip);
+  DnsCacheStore(host, (found) ? (uint32_t)ip : 0);
+  return found;
+}
+
+void DnsCacheFound(const char *name, const ip_addr_t *ipaddr, void *arg)
+{
+  // lwIP callback of a background lookup, also used for a result from the lwIP table
+  DNS_CACHE_ENTRY *entry = &DnsCache.entry[(uint32_t)arg];
+  if (ipaddr) {
+#if LWIP_VERSION_MAJOR == 1
+    entry->refresh_address = ipaddr->addr;
+#else
+    entry->refresh_address = ip_2_ip4(ipaddr)->addr;
+#endif
+    entry->refresh = DNS_REFRESH_DONE;
+  } else {
+    entry->refresh = DNS_REFRESH_FAILED;
+  }
+}
+
+void DnsCacheEverySecond(void)
+{
+  if (global_state.wifi_down) { return; }
+
+  for (uint32_t i = 0; i < DNS_CACHE_SIZE; i++) {
+    DNS_CACHE_ENTRY *entry = &DnsCache.entry[i];
+    if (!entry->host) { continue; }
+    switch (entry->refresh) {
+      case DNS_REFRESH_DONE:
+        entry->address = entry->refresh_address;
+        entry->expires = uptime + DNS_CACHE_TTL;
+        entry->refresh = DNS_REFRESH_IDLE;
+        DnsCache.refreshes++;
+        break;
+      case DNS_REFRESH_FAILED:
+        entry->refresh = DNS_REFRESH_IDLE;  // Keep the address until it expires
+        break;
+      case DNS_REFRESH_IDLE: {
+        int32_t left = entry->expires - uptime;
+        if (entry->used && entry->address && (left > 0) && (left <= DNS_CACHE_REFRESH)) {
+          entry->used = false;              // One background lookup per expiry
+          entry->refresh = DNS_REFRESH_PENDING;
+          ip_addr_t addr;
+          err_t err = dns_gethostbyname(entry->host, &addr, (dns_found_callback)DnsCacheFound, (void*)i);
+          if (ERR_OK == err) {
+            DnsCacheFound(entry->host, &addr, (void*)i);
+          }
+          else if (err != ERR_INPROGRESS) {
+            entry->refresh = DNS_REFRESH_IDLE;
+          }
+        }
+        break;
+      }
+    }
+  }
+}
+
+void DnsCacheStatus(void)
+{
+  uint32_t entries = 0;
+  for (uint32_t i = 0; i < DNS_CACHE_SIZE; i++) {
+    if (DnsCache.entry[i].host) { entries++; }
+  }
+  ResponseAppend_P(PSTR(",\"DnsCache\":{\"Entries\":%d,\"Hits\":%u,\"Misses\":%u,\"Failed\":%u,\"Refreshed\":%u}"),
+    entries, DnsCache.hits, DnsCache.misses, DnsCache.failed, DnsCache.refreshes);
+}
+
+#endif  // USE_DNS_CACHE
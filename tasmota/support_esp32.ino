@@ -47,6 +47,14 @@ uint32_t ESP_getFreeHeap(void) {
   return ESP.getFreeHeap();
 }
 
+uint32_t ESP_getMaxFreeBlock(void) {
+#if defined(ARDUINO_ESP8266_RELEASE_2_3_0) || defined(ARDUINO_ESP8266_RELEASE_2_4_0) || defined(ARDUINO_ESP8266_RELEASE_2_4_1) || defined(ARDUINO_ESP8266_RELEASE_2_4_2)
+  return ESP.getFreeHeap();
+#else
+  return ESP.getMaxFreeBlockSize();
+#endif
+}
+
 void ESP_Restart(void) {
 //  ESP.restart();            // This results in exception 3 on restarts on core 2.3.0
   ESP.reset();
@@ -254,8 +262,160 @@ uint32_t ESP_getFreeHeap(void) {
   return ESP.getMaxAllocHeap();
 }
 
+uint32_t ESP_getMaxFreeBlock(void) {
+  return ESP.getMaxAllocHeap();
+}
+
 void ESP_Restart(void) {
   ESP.restart();
 }
 
+//
+// Pulse counter units counting falling edges in hardware
+//
+
+#include "driver/pcnt.h"
+
+#define PCNT_LIMIT           32767                  // Counter restarts at zero when reaching this value
+
+struct {
+  uint32_t poll_time[PCNT_UNIT_MAX];                // millis() of last PcntDebounced() call
+  uint32_t pulse_time[PCNT_UNIT_MAX];               // millis() of last poll with counted pulses
+  int16_t last[PCNT_UNIT_MAX];
+  uint8_t used = 0;                                 // Bitmask of units in use
+} Pcnt;
+
+int32_t PcntAttach(uint32_t pin, uint32_t filter_ns) {
+  // Returns unit counting falling edges on pin or -1 if none is free
+  for (uint32_t unit = 0; unit < PCNT_UNIT_MAX; unit++) {
+    if (Pcnt.used & (1 << unit)) { continue; }
+
+    pcnt_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.pulse_gpio_num = pin;
+    config.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+    config.lctrl_mode = PCNT_MODE_KEEP;
+    config.hctrl_mode = PCNT_MODE_KEEP;
+    config.pos_mode = PCNT_COUNT_DIS;               // Rising edge
+    config.neg_mode = PCNT_COUNT_INC;               // Falling edge
+    config.counter_h_lim = PCNT_LIMIT;
+    config.counter_l_lim = 0;
+    config.unit = (pcnt_unit_t)unit;
+    config.channel = PCNT_CHANNEL_0;
+    if (pcnt_unit_config(&config) != ESP_OK) { return -1; }
+
+    // Ignore pulses shorter than filter in 12.5 nSec APB clock cycles up to 1023 cycles (12.8 uSec)
+    uint32_t cycles = filter_ns * 2 / 25;
+    if (cycles) {
+      pcnt_set_filter_value((pcnt_unit_t)unit, (cycles > 1023) ? 1023 : cycles);
+      pcnt_filter_enable((pcnt_unit_t)unit);
+    } else {
+      pcnt_filter_disable((pcnt_unit_t)unit);
+    }
+    pcnt_counter_pause((pcnt_unit_t)unit);
+    pcnt_counter_clear((pcnt_unit_t)unit);
+    pcnt_counter_resume((pcnt_unit_t)unit);
+    gpio_pullup_en((gpio_num_t)pin);
+
+    Pcnt.last[unit] = 0;
+    Pcnt.poll_time[unit] = millis();
+    Pcnt.pulse_time[unit] = Pcnt.poll_time[unit];
+    Pcnt.used |= (1 << unit);
+    return unit;
+  }
+  return -1;
+}
+
+void PcntDetach(int32_t unit) {
+  if ((unit < 0) || (unit >= PCNT_UNIT_MAX)) { return; }
+  pcnt_counter_pause((pcnt_unit_t)unit);
+  Pcnt.used &= ~(1 << unit);
+}
+
+uint32_t PcntDelta(int32_t unit) {
+  // Returns pulses since last call which must be within PCNT_LIMIT pulses
+  if ((unit < 0) || (unit >= PCNT_UNIT_MAX)) { return 0; }
+  int16_t count = 0;
+  pcnt_get_counter_value((pcnt_unit_t)unit, &count);
+  int32_t delta = count - Pcnt.last[unit];
+  if (delta < 0) { delta += PCNT_LIMIT; }
+  Pcnt.last[unit] = count;
+  return delta;
+}
+
+int32_t PcntAttachQuadrature(uint32_t pin_a, uint32_t pin_b, uint32_t filter_ns) {
+  // Returns unit counting all edges of quadrature signals on pin_a and pin_b or -1 if none is free
+  int32_t unit = PcntAttach(pin_a, filter_ns);
+  if (unit < 0) { return -1; }
+
+  pcnt_config_t config;
+  memset(&config, 0, sizeof(config));
+  config.counter_h_lim = PCNT_LIMIT;
+  config.counter_l_lim = -PCNT_LIMIT;
+  config.unit = (pcnt_unit_t)unit;
+  // Channel 0 counts edges of A with direction from B, channel 1 edges of B with direction from A
+  config.pulse_gpio_num = pin_a;
+  config.ctrl_gpio_num = pin_b;
+  config.pos_mode = PCNT_COUNT_DEC;
+  config.neg_mode = PCNT_COUNT_INC;
+  config.lctrl_mode = PCNT_MODE_REVERSE;
+  config.hctrl_mode = PCNT_MODE_KEEP;
+  config.channel = PCNT_CHANNEL_0;
+  pcnt_unit_config(&config);
+  config.pulse_gpio_num = pin_b;
+  config.ctrl_gpio_num = pin_a;
+  config.pos_mode = PCNT_COUNT_INC;
+  config.neg_mode = PCNT_COUNT_DEC;
+  config.channel = PCNT_CHANNEL_1;
+  if (pcnt_unit_config(&config) != ESP_OK) {
+    PcntDetach(unit);
+    return -1;
+  }
+  pcnt_counter_pause((pcnt_unit_t)unit);
+  pcnt_counter_clear((pcnt_unit_t)unit);
+  pcnt_counter_resume((pcnt_unit_t)unit);
+  gpio_pullup_en((gpio_num_t)pin_b);
+  return unit;
+}
+
+int32_t PcntQuadratureDelta(int32_t unit) {
+  // Returns signed count since last call which must be within half of PCNT_LIMIT
+  if ((unit < 0) || (unit >= PCNT_UNIT_MAX)) { return 0; }
+  int16_t count = 0;
+  pcnt_get_counter_value((pcnt_unit_t)unit, &count);
+  int32_t delta = count - Pcnt.last[unit];
+  if (delta > PCNT_LIMIT / 2) { delta -= PCNT_LIMIT; }   // Counter restarted at zero on a limit
+  if (delta < -PCNT_LIMIT / 2) { delta += PCNT_LIMIT; }
+  Pcnt.last[unit] = count;
+  return delta;
+}
+
+bool PcntQuadraturePending(int32_t unit) {
+  if ((unit < 0) || (unit >= PCNT_UNIT_MAX)) { return false; }
+  int16_t count = 0;
+  pcnt_get_counter_value((pcnt_unit_t)unit, &count);
+  return (count != Pcnt.last[unit]);
+}
+
+uint32_t PcntDebounced(int32_t unit, uint32_t debounce_ms) {
+  // Returns pulses since last call limited to one pulse per debounce time
+  //  Contact bounce is too long for the hardware filter so pulses within debounce_ms of the
+  //  previous poll with pulses are dropped and the remaining are capped to the poll window
+  if ((unit < 0) || (unit >= PCNT_UNIT_MAX)) { return 0; }
+  uint32_t pulses = PcntDelta(unit);
+  uint32_t now = millis();
+  uint32_t window = now - Pcnt.poll_time[unit];
+  Pcnt.poll_time[unit] = now;
+  if (pulses && debounce_ms) {
+    if (now - Pcnt.pulse_time[unit] <= debounce_ms) {
+      pulses = 0;                                   // Bounce of previous pulse
+    } else {
+      uint32_t max_pulses = window / debounce_ms +1;
+      if (pulses > max_pulses) { pulses = max_pulses; }
+    }
+  }
+  if (pulses) { Pcnt.pulse_time[unit] = now; }
+  return pulses;
+}
+
 #endif  // ESP32
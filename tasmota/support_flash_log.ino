@@ -118,6 +118,9 @@ end = (uint32_t)&_SPIFFS_start - 0x40200000;
 end = (uint32_t)&_FS_start - 0x40200000;
 #endif
 num_sectors = (end - start)/FLASH_SECTOR_SIZE;
+#ifdef USE_FLASH_WEAR
+FlashWearRegion(WEAR_FLOG, num_sectors);
+#endif  // USE_FLASH_WEAR
 DEBUG_SENSOR_LOG(PSTR("FLOG: size: 0x%lx, start: 0x%lx, end: 0x%lx, num_sectors(dec): %lu"), size, start, end, num_sectors );
 _findFirstErasedSector();
 if(first_erased_sector == 0xffff){
@@ -152,6 +155,7 @@ void FLOG::_readSector(uint8_t one_sector){
 void FLOG::_eraseSector(uint8_t one_sector){ // Erase sector of FLOG/OTA
   DEBUG_SENSOR_LOG(PSTR("FLOG: erasing sector number: %u" ), one_sector);
   ESP.flashEraseSector((start/FLASH_SECTOR_SIZE)+one_sector);
+  FLASH_WEAR(WEAR_FLOG, 1, 0);
 }
 /**
  * @brief Write the global buffer to the given sector
@@ -161,6 +165,7 @@ void FLOG::_eraseSector(uint8_t one_sector){ // Erase sector of FLOG/OTA
 void FLOG::_writeSector(uint8_t one_sector){ // Write sector of FLOG/OTA
   DEBUG_SENSOR_LOG(PSTR("FLOG: write buffer to sector number: %u" ), one_sector);
   ESP.flashWrite(start+(one_sector * FLASH_SECTOR_SIZE),(uint32_t *)&sector.dword_buffer, FLASH_SECTOR_SIZE);
+  FLASH_WEAR(WEAR_FLOG, 0, FLASH_SECTOR_SIZE);
 }
 /**
  * @brief Clear the global buffer, but leave the header intact
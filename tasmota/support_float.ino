@@ -445,3 +445,33 @@ float Polynomialf(const float *factors, uint32_t degree, float x) {
   }
   return r;
 }
+
+// Format a number with prec decimals (0..9) using integer arithmetic as in dtostrf(number, 1, prec, s)
+// Returns the number of characters written to s not counting the terminator, 0 if out of range
+uint32_t FloatToString(char *s, double number, uint32_t prec)
+{
+  static const uint32_t pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+  if (prec > 9) { return 0; }
+  bool negative = (number < 0);
+  if (negative) { number = -number; }
+  double scaled = number * pow10[prec] + 0.5;
+  if (!(scaled < 4294967295.0)) { return 0; }    // Also catches nan
+  uint32_t value = (uint32_t)scaled;
+
+  char digits[12];
+  uint32_t count = 0;
+  do {
+    digits[count++] = '0' + (value % 10);
+    value /= 10;
+  } while (value || (count <= prec));          // At least one digit before the decimal point
+
+  char *p = s;
+  if (negative) { *p++ = '-'; }
+  while (count) {
+    if (count == prec) { *p++ = '.'; }
+    *p++ = digits[--count];
+  }
+  *p = '\0';
+  return p - s;
+}
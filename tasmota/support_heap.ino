@@ -0,0 +1,171 @@
+/*
+  support_heap.ino - heap statistics support for Tasmota
+
+  Copyright (C) 2020  Theo Arends
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*********************************************************************************************\
+ * Heap statistics
+ *
+ * Failures on long running devices are caused by fragmentation more than by low free heap as
+ * TLS and OTA need large contiguous blocks. HeapSample() keeps the lowest free heap and largest
+ * free block seen every 250 mSec.
+ *
+ * With USE_HEAP_TAGS the Zigbee, rules, webserver and scripter allocations use HeapMalloc(),
+ * HeapCalloc() and HEAP_NEW(). Each block starts with a header holding its tag and size so
+ * HeapFree() can update the number of blocks and bytes in use per tag.
+\*********************************************************************************************/
+
+struct {
+  uint32_t free_low = 0;                    // Lowest free heap seen
+  uint32_t block_low = 0;                   // Lowest largest free block seen
+#ifdef USE_HEAP_TAGS
+  uint32_t count[HEAP_TAG_MAX] = { 0 };     // Blocks in use
+  uint32_t bytes[HEAP_TAG_MAX] = { 0 };     // Bytes in use
+  uint32_t bytes_max[HEAP_TAG_MAX] = { 0 }; // High water mark of bytes in use
+#endif  // USE_HEAP_TAGS
+} HeapStats;
+
+uint32_t HeapFragmentation(void)
+{
+  // Part of the free heap not in the largest free block in percent
+  uint32_t free_heap = ESP.getFreeHeap();
+  if (!free_heap) { return 0; }
+  uint32_t block = ESP_getMaxFreeBlock();
+  return (block >= free_heap) ? 0 : 100 - (block * 100 / free_heap);
+}
+
+void HeapSample(void)
+{
+  uint32_t free_heap = ESP.getFreeHeap();
+  if (!HeapStats.free_low || (free_heap < HeapStats.free_low)) { HeapStats.free_low = free_heap; }
+  uint32_t block = ESP_getMaxFreeBlock();
+  if (!HeapStats.block_low || (block < HeapStats.block_low)) { HeapStats.block_low = block; }
+}
+
+/*********************************************************************************************\
+ * Buffer placement
+ *
+ * Large latency tolerant buffers like the web log, the scripter memory and display buffers
+ * are taken from PSRAM when present. Small and frequently used structures stay in internal RAM.
+\*********************************************************************************************/
+
+void* PsramMalloc(size_t size)
+{
+#ifdef ESP32
+  if (psramFound()) {
+    void* pointer = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (pointer) { return pointer; }
+  }
+#endif  // ESP32
+  return malloc(size);
+}
+
+void* PsramCalloc(size_t count, size_t size)
+{
+  if (size && (count > SIZE_MAX / size)) { return nullptr; }
+  void* pointer = PsramMalloc(count * size);
+  if (pointer) { memset(pointer, 0, count * size); }
+  return pointer;
+}
+
+#ifdef USE_HEAP_TAGS
+union HEAP_HEADER {
+  struct {
+    uint32_t size : 24;                     // Requested bytes
+    uint32_t tag : 8;
+  };
+  uint64_t align;                           // Keep 8 byte alignment of malloc()
+};
+
+void* HeapAlloc(uint32_t tag, size_t size, bool large)
+{
+  if ((tag >= HEAP_TAG_MAX) || (size >= 0x1000000)) { return nullptr; }
+  HEAP_HEADER *header = (HEAP_HEADER*)((large) ? PsramMalloc(sizeof(HEAP_HEADER) + size) : malloc(sizeof(HEAP_HEADER) + size));
+  if (!header) { return nullptr; }
+  header->size = size;
+  header->tag = tag;
+  HeapStats.count[tag]++;
+  HeapStats.bytes[tag] += size;
+  if (HeapStats.bytes[tag] > HeapStats.bytes_max[tag]) { HeapStats.bytes_max[tag] = HeapStats.bytes[tag]; }
+  HeapSample();                             // Catch short living peaks
+  return header +1;
+}
+
+void* HeapMalloc(uint32_t tag, size_t size)
+{
+  return HeapAlloc(tag, size, false);
+}
+
+void* HeapCalloc(uint32_t tag, size_t count, size_t size)
+{
+  if (size && (count > SIZE_MAX / size)) { return nullptr; }
+  void* pointer = HeapAlloc(tag, count * size, false);
+  if (pointer) { memset(pointer, 0, count * size); }
+  return pointer;
+}
+
+void* HeapCallocLarge(uint32_t tag, size_t count, size_t size)
+{
+  // Same as HeapCalloc() but in PSRAM when present
+  if (size && (count > SIZE_MAX / size)) { return nullptr; }
+  void* pointer = HeapAlloc(tag, count * size, true);
+  if (pointer) { memset(pointer, 0, count * size); }
+  return pointer;
+}
+
+void HeapFree(void* pointer)
+{
+  if (!pointer) { return; }
+  HEAP_HEADER *header = (HEAP_HEADER*)pointer -1;
+  HeapStats.count[header->tag]--;
+  HeapStats.bytes[header->tag] -= header->size;
+  free(header);
+}
+#endif  // USE_HEAP_TAGS
+
+void HeapStatus(void)
+{
+  ResponseAppend_P(PSTR(",\"HeapStats\":{\"MaxBlock\":%d,\"Fragmentation\":%d,\"FreeLow\":%d,\"BlockLow\":%d"),
+    ESP_getMaxFreeBlock(), HeapFragmentation(), HeapStats.free_low, HeapStats.block_low);
+#ifdef USE_HEAP_TAGS
+  char name[12];
+  for (uint32_t i = 0; i < HEAP_TAG_MAX; i++) {
+    ResponseAppend_P(PSTR("%s\"%s\":[%u,%u,%u]"), (i) ? "," : ",\"Tags\":{",
+      GetTextIndexed(name, sizeof(name), i, kHeapTags), HeapStats.count[i], HeapStats.bytes[i], HeapStats.bytes_max[i]);
+  }
+  ResponseJsonEnd();
+#endif  // USE_HEAP_TAGS
+  ResponseJsonEnd();
+}
+
+#if defined(USE_PROMETHEUS) && defined(USE_HEAP_TAGS)
+void HeapTagMetrics(void)
+{
+  const char *metrics[] = { PSTR("heap_tag_blocks"), PSTR("heap_tag_bytes"), PSTR("heap_tag_max_bytes") };
+  const uint32_t *values[] = { HeapStats.count, HeapStats.bytes, HeapStats.bytes_max };
+  char metric_name[20];
+  char name[12];
+  for (uint32_t metric = 0; metric < ARRAY_SIZE(metrics); metric++) {
+    strncpy_P(metric_name, metrics[metric], sizeof(metric_name));
+    metric_name[sizeof(metric_name) -1] = '\0';
+    WSContentSend_P(PSTR("# TYPE %s gauge\n"), metric_name);
+    for (uint32_t i = 0; i < HEAP_TAG_MAX; i++) {
+      WSContentSend_P(PSTR("%s{subsystem=\"%s\"} %u\n"), metric_name, GetTextIndexed(name, sizeof(name), i, kHeapTags), values[metric][i]);
+    }
+  }
+}
+#endif  // USE_PROMETHEUS && USE_HEAP_TAGS
@@ -0,0 +1,152 @@
+/*
+  support_input_interrupt.ino - interrupt driven switch and button input for Tasmota
+
+  Copyright (C) 2020  Theo Arends
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef USE_INPUT_INTERRUPT
+/*********************************************************************************************\
+ * Interrupt driven switch and button input enabled with SetOption96 1
+ *
+ * A single ISR attached to all switch and button pins queues each level change with its
+ * millis() timestamp. The loop accepts the first edge at once if the input was stable for the
+ * debounce time and ignores further edges within the debounce time. When the input is quiet
+ * for the debounce time its level is read again to catch a missed or bouncing last edge.
+ *
+ * Inputs 0 to MAX_SWITCHES -1 are switches debounced by SwitchDebounce, the next MAX_KEYS
+ * inputs are buttons debounced by ButtonDebounce. Switches in AC detect mode (SwitchDebounce x9),
+ * touch buttons and ESP8266 GPIO16 keep being polled.
+\*********************************************************************************************/
+
+const uint8_t INPUT_IRQ_MAX = MAX_SWITCHES + MAX_KEYS;
+const uint8_t INPUT_IRQ_QUEUE = 16;          // Max number of queued edges, power of two
+
+struct INPUT_IRQ_EDGE {
+  uint32_t time;                             // millis() of the edge
+  uint8_t input;
+  uint8_t level;
+};
+
+struct {
+  INPUT_IRQ_EDGE edge[INPUT_IRQ_QUEUE];
+  uint32_t accepted[INPUT_IRQ_MAX];          // millis() of the last accepted level change
+  uint32_t last_edge[INPUT_IRQ_MAX];         // millis() of the last edge
+  uint32_t overflow = 0;                     // Number of edges lost on a full queue
+  volatile uint16_t level = 0;               // Level per input seen by the ISR
+  uint16_t mask = 0;                         // Inputs with an attached interrupt
+  uint16_t state = 0;                        // Debounced level per input
+  uint16_t changed = 0;                      // Inputs with a debounced level change not yet taken
+  uint16_t settle = 0;                       // Inputs with an edge since the last accepted change
+  uint8_t pin[INPUT_IRQ_MAX];
+  volatile uint8_t head = 0;                 // Written by the ISR only
+  volatile uint8_t tail = 0;                 // Written by the loop only
+} InputIrq;
+
+#ifndef ARDUINO_ESP8266_RELEASE_2_3_0  // Fix core 2.5.x ISR not in IRAM Exception
+void InputIrqIsr(void) ICACHE_RAM_ATTR;
+#endif  // ARDUINO_ESP8266_RELEASE_2_3_0
+
+void InputIrqIsr(void)
+{
+  uint32_t time = millis();
+  for (uint32_t i = 0; i < INPUT_IRQ_MAX; i++) {
+    if (!bitRead(InputIrq.mask, i)) { continue; }
+    uint32_t level = digitalRead(InputIrq.pin[i]);
+    if (level == bitRead(InputIrq.level, i)) { continue; }
+    InputIrq.level ^= (1 << i);
+    uint32_t next = (InputIrq.head +1) & (INPUT_IRQ_QUEUE -1);
+    if (next == InputIrq.tail) {
+      InputIrq.overflow++;                   // Last level is read again when the input settles
+      continue;
+    }
+    InputIrq.edge[InputIrq.head].time = time;
+    InputIrq.edge[InputIrq.head].input = i;
+    InputIrq.edge[InputIrq.head].level = level;
+    InputIrq.head = next;
+  }
+}
+
+bool InputIrqAttach(uint32_t input, uint32_t pin)
+{
+  // Returns false if the pin has to be polled
+#ifdef ESP8266
+  if (16 == pin) { return false; }           // GPIO16 does not support interrupts
+#endif  // ESP8266
+  InputIrq.pin[input] = pin;
+  uint32_t level = digitalRead(pin);
+  bitWrite(InputIrq.level, input, level);
+  bitWrite(InputIrq.state, input, level);
+  InputIrq.accepted[input] = millis();
+  bitSet(InputIrq.mask, input);
+  attachInterrupt(pin, InputIrqIsr, CHANGE);
+  return true;
+}
+
+bool InputIrqPending(void)
+{
+  return (InputIrq.head != InputIrq.tail);
+}
+
+uint32_t InputIrqDebounce(uint32_t input)
+{
+  return (input < MAX_SWITCHES) ? Settings.switch_debounce : Settings.button_debounce;
+}
+
+void InputIrqAccept(uint32_t input, uint32_t level, uint32_t time)
+{
+  if (level == bitRead(InputIrq.state, input)) { return; }
+  bitWrite(InputIrq.state, input, level);
+  bitSet(InputIrq.changed, input);
+  InputIrq.accepted[input] = time;
+}
+
+void InputIrqLoop(void)
+{
+  while (InputIrq.tail != InputIrq.head) {
+    INPUT_IRQ_EDGE *edge = &InputIrq.edge[InputIrq.tail];
+    uint32_t input = edge->input;
+    InputIrq.last_edge[input] = edge->time;
+    bitSet(InputIrq.settle, input);
+    if ((edge->time - InputIrq.accepted[input]) >= InputIrqDebounce(input)) {
+      InputIrqAccept(input, edge->level, edge->time);  // Leading edge of a stable input
+    }
+    InputIrq.tail = (InputIrq.tail +1) & (INPUT_IRQ_QUEUE -1);
+  }
+
+  if (!InputIrq.settle) { return; }
+  for (uint32_t i = 0; i < INPUT_IRQ_MAX; i++) {
+    if (bitRead(InputIrq.settle, i) && (TimePassedSince(InputIrq.last_edge[i]) >= (int32_t)InputIrqDebounce(i))) {
+      bitClear(InputIrq.settle, i);
+      InputIrqAccept(i, digitalRead(InputIrq.pin[i]), millis());  // Trailing level after bouncing
+    }
+  }
+}
+
+uint32_t InputIrqTake(uint32_t first, uint32_t count)
+{
+  // Returns and clears the debounced level changes of inputs first to first + count -1
+  uint32_t mask = ((1 << count) -1) << first;
+  uint32_t changed = InputIrq.changed & mask;
+  InputIrq.changed &= ~mask;
+  return changed >> first;
+}
+
+uint32_t InputIrqLevel(uint32_t input)
+{
+  return bitRead(InputIrq.state, input);
+}
+
+#endif  // USE_INPUT_INTERRUPT
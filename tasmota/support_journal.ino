@@ -0,0 +1,267 @@
+/*
+  support_journal.ino - energy and counter journal support for Tasmota
+
+  Copyright (C) 2020  Theo Arends
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef USE_ENERGY_JOURNAL
+/*********************************************************************************************\
+ * Energy and counter journal
+ *
+ * Appends the energy totals and pulse counters kept in RtcSettings as small records every
+ * JOURNAL_INTERVAL seconds when changed, and at once when a value decreased (reset or midnight).
+ * After a power loss the newest record updates Settings before RtcSettings is restored from it.
+ * The values are folded into Settings each time the journal starts a new sector.
+ *
+ * The saved power state and the values above are left out of the settings change detection.
+ * A settings save where only these changed appends a record instead of rewriting the settings
+ * sector and the power state is taken from the newest record on every restart.
+ *
+ * ESP8266 rotates the records through JOURNAL_SECTORS flash sectors just below the Quick Power
+ * Cycle sector. These are part of the OTA area so the journal stops when an upload starts.
+ * ESP32 stores the newest record in NVS which does its own wear leveling.
+\*********************************************************************************************/
+
+#ifndef JOURNAL_INTERVAL
+#define JOURNAL_INTERVAL       60           // Seconds between records of changed values
+#endif
+
+const uint16_t JOURNAL_MAGIC = 0x4A52;      // JR
+const uint8_t JOURNAL_SECTORS = 2;
+
+struct JOURNAL_RECORD {
+  uint16_t magic;
+  uint16_t kWhdoy;
+  uint32_t sequence;
+  unsigned long save_flag;                  // Settings.save_flag the record is based on
+  power_t power;                            // Settings.power
+  unsigned long kWhtoday;
+  unsigned long kWhtotal;
+  unsigned long pulse_counter[MAX_COUNTERS];
+  EnergyUsage usage;
+  uint32_t crc;                             // Crc32 of all previous fields
+};
+
+const uint16_t JOURNAL_RECORDS = SPI_FLASH_SEC_SIZE / sizeof(JOURNAL_RECORD);  // Records per sector
+
+struct {
+  JOURNAL_RECORD last;                      // Newest written or loaded record
+  uint16_t slot;                            // Next record slot to write
+  uint16_t timer = 0;                       // Seconds until changed values are recorded
+  bool found = false;                       // Valid record loaded
+  bool stopped = false;
+} Journal;
+
+uint32_t JournalCrc(struct JOURNAL_RECORD *record)
+{
+  return GetCfgCrc32((uint8_t*)record, sizeof(JOURNAL_RECORD) - sizeof(record->crc));
+}
+
+bool JournalValid(struct JOURNAL_RECORD *record)
+{
+  return (JOURNAL_MAGIC == record->magic) && (JournalCrc(record) == record->crc);
+}
+
+void JournalFill(struct JOURNAL_RECORD *record)
+{
+  memset(record, 0, sizeof(JOURNAL_RECORD));
+  record->magic = JOURNAL_MAGIC;
+  record->kWhdoy = (RtcTime.valid) ? RtcTime.day_of_year : Settings.energy_kWhdoy;
+  record->sequence = Journal.last.sequence;
+  record->save_flag = Settings.save_flag;
+  record->power = Settings.power;
+  record->kWhtoday = RtcSettings.energy_kWhtoday;
+  record->kWhtotal = RtcSettings.energy_kWhtotal;
+  for (uint32_t i = 0; i < MAX_COUNTERS; i++) {
+    record->pulse_counter[i] = RtcSettings.pulse_counter[i];
+  }
+  record->usage = RtcSettings.energy_usage;
+}
+
+bool JournalDecreased(struct JOURNAL_RECORD *record)
+{
+  if (record->power != Journal.last.power) { return true; }  // Only changes on settings save
+  if ((record->kWhtoday < Journal.last.kWhtoday) || (record->kWhtotal < Journal.last.kWhtotal)) { return true; }
+  for (uint32_t i = 0; i < MAX_COUNTERS; i++) {
+    if (record->pulse_counter[i] < Journal.last.pulse_counter[i]) { return true; }
+  }
+  return false;
+}
+
+void JournalFold(struct JOURNAL_RECORD *record)
+{
+  // Same as EnergySaveState() and CounterSaveState() so the next SettingsSave() stores them
+  Settings.power = record->power;
+  Settings.energy_kWhdoy = record->kWhdoy;
+  Settings.energy_kWhtoday = record->kWhtoday;
+  Settings.energy_kWhtotal = record->kWhtotal;
+  Settings.energy_usage = record->usage;
+  for (uint32_t i = 0; i < MAX_COUNTERS; i++) {
+    Settings.pulse_counter[i] = record->pulse_counter[i];
+  }
+}
+
+uint32_t JournalSettingsCrc32(void)
+{
+  // Crc32 of Settings without the journal values
+  if (Journal.stopped) { return GetSettingsCrc32(); }
+
+  JOURNAL_RECORD keep;
+  keep.power = Settings.power;
+  keep.kWhdoy = Settings.energy_kWhdoy;
+  keep.kWhtoday = Settings.energy_kWhtoday;
+  keep.kWhtotal = Settings.energy_kWhtotal;
+  keep.usage = Settings.energy_usage;
+  for (uint32_t i = 0; i < MAX_COUNTERS; i++) {
+    keep.pulse_counter[i] = Settings.pulse_counter[i];
+  }
+  JOURNAL_RECORD none;
+  memset(&none, 0, sizeof(none));
+  JournalFold(&none);
+  uint32_t crc = GetSettingsCrc32();
+  JournalFold(&keep);
+  return crc;
+}
+
+#ifdef ESP8266
+uint32_t JournalLocation(void)
+{
+  return SETTINGS_LOCATION - CFG_ROTATES - JOURNAL_SECTORS;  // First journal sector
+}
+
+uint32_t JournalAddress(uint32_t slot)
+{
+  return (JournalLocation() + slot / JOURNAL_RECORDS) * SPI_FLASH_SEC_SIZE + (slot % JOURNAL_RECORDS) * sizeof(JOURNAL_RECORD);
+}
+
+bool JournalErased(uint32_t slot)
+{
+  uint32_t data[sizeof(JOURNAL_RECORD) / 4];
+  ESP.flashRead(JournalAddress(slot), data, sizeof(data));
+  for (uint32_t i = 0; i < ARRAY_SIZE(data); i++) {
+    if (data[i] != 0xFFFFFFFF) { return false; }
+  }
+  return true;
+}
+#endif  // ESP8266
+
+void JournalLoad(void)
+{
+  // Find newest record and next free slot
+  JOURNAL_RECORD record;
+  Journal.found = false;
+  Journal.slot = 0;
+  memset(&Journal.last, 0, sizeof(Journal.last));
+#ifdef ESP8266
+  const uint32_t slots = JOURNAL_SECTORS * JOURNAL_RECORDS;
+  for (uint32_t slot = 0; slot < slots; slot++) {
+    ESP.flashRead(JournalAddress(slot), (uint32_t*)&record, sizeof(record));
+    if (JournalValid(&record) && (!Journal.found || ((int32_t)(record.sequence - Journal.last.sequence) > 0))) {
+      Journal.last = record;
+      Journal.slot = slot +1;
+      Journal.found = true;
+    }
+  }
+  if (Journal.slot >= slots) { Journal.slot = 0; }
+  if ((Journal.slot % JOURNAL_RECORDS) && !JournalErased(Journal.slot)) {
+    // Overwritten by OTA or interrupted write so continue in next sector which is erased before use
+    Journal.slot = ((Journal.slot / JOURNAL_RECORDS +1) % JOURNAL_SECTORS) * JOURNAL_RECORDS;
+  }
+#else  // ESP32
+  memset(&record, 0, sizeof(record));
+  NvmLoad("main", "Journal", &record, sizeof(record));
+  if (JournalValid(&record)) {
+    Journal.last = record;
+    Journal.found = true;
+  }
+#endif  // ESP8266 - ESP32
+}
+
+void JournalRestore(bool power_on)
+{
+  // Called on restart with power_on set when RtcSettings is invalid
+  if (!Journal.found) { return; }
+  if ((int32_t)(Journal.last.save_flag - Settings.save_flag) < 0) { return; }  // Settings saved later as in OTA restart
+
+  if (!power_on) {
+    Settings.power = Journal.last.power;   // Energy and counters continue from RtcSettings
+    return;
+  }
+  JournalFold(&Journal.last);
+  AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_CONFIG "Journal restored, " D_COUNT " %u"), Journal.last.sequence);
+}
+
+void JournalWrite(struct JOURNAL_RECORD *record)
+{
+  record->sequence = Journal.last.sequence +1;
+  record->crc = JournalCrc(record);
+  bool fold = false;
+#ifdef ESP8266
+  uint32_t sector = JournalLocation() + Journal.slot / JOURNAL_RECORDS;
+  if (0 == (Journal.slot % JOURNAL_RECORDS)) {
+    TRACE_EVENT(TRACE_FLASH_ERASE, TRACE_BEGIN, sector);
+    bool erased = ESP.flashEraseSector(sector);
+    TRACE_EVENT(TRACE_FLASH_ERASE, TRACE_END, sector);
+    if (!erased) { return; }
+    fold = Journal.found;
+  }
+  TRACE_EVENT(TRACE_FLASH_WRITE, TRACE_BEGIN, sector);
+  ESP.flashWrite(JournalAddress(Journal.slot), (uint32_t*)record, sizeof(JOURNAL_RECORD));
+  TRACE_EVENT(TRACE_FLASH_WRITE, TRACE_END, sector);
+  FLASH_WEAR(WEAR_ENERGY, (0 == (Journal.slot % JOURNAL_RECORDS)) ? 1 : 0, sizeof(JOURNAL_RECORD));
+  Journal.slot++;
+  if (Journal.slot >= JOURNAL_SECTORS * JOURNAL_RECORDS) { Journal.slot = 0; }
+#else  // ESP32
+  NvmSave("main", "Journal", record, sizeof(JOURNAL_RECORD));
+  FLASH_WEAR_LEVELED(WEAR_ENERGY, sizeof(JOURNAL_RECORD));
+  fold = (0 == (record->sequence % JOURNAL_RECORDS));
+#endif  // ESP8266 - ESP32
+  Journal.last = *record;
+  Journal.found = true;
+  if (fold) { JournalFold(&Journal.last); }
+}
+
+void JournalSave(bool force)
+{
+  if (Journal.stopped) { return; }
+
+  JOURNAL_RECORD record;
+  JournalFill(&record);
+  if (Journal.found) {
+    if (!force) {
+      record.save_flag = Journal.last.save_flag;  // Only a settings save needs a record with its save_flag
+    }
+    record.crc = Journal.last.crc;
+    if (!memcmp(&record, &Journal.last, sizeof(record))) { return; }  // No change
+    record.save_flag = Settings.save_flag;
+    if (!force && Journal.timer && !JournalDecreased(&record)) { return; }
+  }
+  JournalWrite(&record);
+  Journal.timer = JOURNAL_INTERVAL;
+}
+
+void JournalStop(void)
+{
+  Journal.stopped = true;  // Free flash for OTA update
+}
+
+void JournalEverySecond(void)
+{
+  if (Journal.timer) { Journal.timer--; }
+  JournalSave(false);
+}
+
+#endif  // USE_ENERGY_JOURNAL
@@ -24,21 +24,60 @@
 #include "img_converters.h"
 #include "esp_jpg_decode.h"
 
-void rgb888_to_565(uint8_t *in, uint16_t *out, uint32_t len) {
-uint8_t red, grn, blu;
-uint16_t b , g, r;
-
-  for (uint32_t cnt=0; cnt<len; cnt++) {
-    red = *in++;
-    grn = *in++;
-    blu = *in++;
-    b = (blu >> 3) & 0x1f;
-    g = ((grn >> 2) & 0x3f) << 5;
-    r = ((red >> 3) & 0x1f) << 11;
-    *out++ = (r | g | b);
+/*********************************************************************************************\
+ * RGB565 conversion
+ *
+ * Pixels are converted two at a time into one 32 bit word. A 4 byte aligned input is loaded
+ * as three words holding four pixels so the conversion does no byte loads.
+\*********************************************************************************************/
+
+#define RGB565(r, g, b) ((((r) & 0xF8) << 8) | (((g) & 0xFC) << 3) | (((b) & 0xF8) >> 3))
+
+void rgb888_to_565_swap(const uint8_t *in, uint16_t *out, uint32_t len, bool bgr) {
+  // Output is 2 byte aligned, write a single pixel first if it is not 4 byte aligned
+  uint32_t ri = (bgr) ? 2 : 0;
+  uint32_t bi = 2 - ri;
+  if (len && ((uint32_t)out & 2)) {
+    *out++ = RGB565(in[ri], in[1], in[bi]);
+    in += 3;
+    len--;
+  }
+  uint32_t *out32 = (uint32_t*)out;
+  if (!((uint32_t)in & 3)) {
+    const uint32_t *in32 = (const uint32_t*)in;
+    for (; len >= 4; len -= 4) {
+      // Little endian words, w0 holds r1 b0 g0 r0 as bytes 3 to 0 for RGB input
+      uint32_t w0 = *in32++;
+      uint32_t w1 = *in32++;
+      uint32_t w2 = *in32++;
+      uint32_t p0 = w0 & 0xFFFFFF;
+      uint32_t p1 = (w0 >> 24) | ((w1 & 0xFFFF) << 8);
+      uint32_t p2 = (w1 >> 16) | ((w2 & 0xFF) << 16);
+      uint32_t p3 = w2 >> 8;
+      if (bgr) {
+        *out32++ = RGB565(p0 >> 16, p0 >> 8, p0) | (RGB565(p1 >> 16, p1 >> 8, p1) << 16);
+        *out32++ = RGB565(p2 >> 16, p2 >> 8, p2) | (RGB565(p3 >> 16, p3 >> 8, p3) << 16);
+      } else {
+        *out32++ = RGB565(p0, p0 >> 8, p0 >> 16) | (RGB565(p1, p1 >> 8, p1 >> 16) << 16);
+        *out32++ = RGB565(p2, p2 >> 8, p2 >> 16) | (RGB565(p3, p3 >> 8, p3 >> 16) << 16);
+      }
+    }
+    in = (const uint8_t*)in32;
+  }
+  for (; len >= 2; len -= 2) {
+    *out32++ = RGB565(in[ri], in[1], in[bi]) | (RGB565(in[ri +3], in[4], in[bi +3]) << 16);
+    in += 6;
+  }
+  if (len) {
+    out = (uint16_t*)out32;
+    *out = RGB565(in[ri], in[1], in[bi]);
   }
 }
 
+void rgb888_to_565(uint8_t *in, uint16_t *out, uint32_t len) {
+  rgb888_to_565_swap(in, out, len, false);
+}
+
 typedef struct {
         uint16_t width;
         uint16_t height;
@@ -120,6 +159,64 @@ bool jpg2rgb888(const uint8_t *src, size_t src_len, uint8_t * out, jpg_scale_t s
     return true;
 }
 
+/*********************************************************************************************\
+ * Streaming decode to RGB565
+ *
+ * jpg2rgb565_rows() converts each decoded block of at most 16 x 16 pixels straight into a
+ * buffer of one MCU row of RGB565 pixels and hands every completed row to the row callback.
+ * Peak memory is width x 16 x 2 bytes instead of a RGB888 frame and a RGB565 frame.
+\*********************************************************************************************/
+
+typedef bool (* jpg_rgb565_row_cb)(void *arg, uint16_t y, uint16_t w, uint16_t h, uint16_t *data);
+
+typedef struct {
+  jpg_reader_cb reader;
+  void *reader_arg;
+  jpg_rgb565_row_cb row;
+  void *row_arg;
+  uint16_t *buf;                            // One MCU row
+  uint16_t width;
+} rgb565_jpg_decoder;
+
+static size_t _jpg565_read(void *arg, size_t index, uint8_t *buf, size_t len)
+{
+  rgb565_jpg_decoder *jpeg = (rgb565_jpg_decoder *)arg;
+  return jpeg->reader(jpeg->reader_arg, index, buf, len);
+}
+
+static bool _jpg565_write(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data)
+{
+  rgb565_jpg_decoder *jpeg = (rgb565_jpg_decoder *)arg;
+  if (!data) {
+    if (!x && !y) {                         // Start of decode
+      jpeg->width = w;
+      jpeg->buf = (uint16_t *)malloc(w * 16 * 2);
+      return (jpeg->buf != nullptr);
+    }
+    return true;                            // End of decode
+  }
+  if ((h > 16) || (x + w > jpeg->width)) { return false; }
+
+  uint16_t *out = jpeg->buf + x;
+  for (uint32_t j = 0; j < h; j++) {
+    rgb888_to_565_swap(data, out, w, true);  // Decoder delivers blue, green, red
+    data += w * 3;
+    out += jpeg->width;
+  }
+  if (x + w >= jpeg->width) {               // Last block of the MCU row
+    return jpeg->row(jpeg->row_arg, y, jpeg->width, h, jpeg->buf);
+  }
+  return true;
+}
+
+bool jpg2rgb565_rows(size_t len, jpg_reader_cb reader, void *reader_arg, jpg_rgb565_row_cb row, void *row_arg)
+{
+  rgb565_jpg_decoder jpeg = { reader, reader_arg, row, row_arg, nullptr, 0 };
+  esp_err_t err = esp_jpg_decode(len, JPG_SCALE_NONE, _jpg565_read, _jpg565_write, (void*)&jpeg);
+  free(jpeg.buf);
+  return (ESP_OK == err);
+}
+
 // https://web.archive.org/web/20131016210645/http://www.64lines.com/jpeg-width-height
 //Gets the JPEG size from the array of data passed to the function, file reference: http://www.obrador.com/essentialjpeg/headerinfo.htm
 char get_jpeg_size(unsigned char* data, unsigned int data_size, unsigned short *width, unsigned short *height) {
@@ -0,0 +1,223 @@
+/*
+  support_loop_stats.ino - loop latency and task stack telemetry for Tasmota
+
+  Copyright (C) 2020  Theo Arends
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef USE_LOOP_STATS
+/*********************************************************************************************\
+ * Loop latency and task stack telemetry
+ *
+ * The watchdog only restarts on a loop blocked for minutes. This keeps a histogram of loop()
+ * active time per slice of LOOP_STATS_SLICE seconds. The last LOOP_STATS_SLICES slices provide
+ * the p50, p99 and max loop time over the last minute together with the longest single driver
+ * or sensor call and the function it was called with.
+ *
+ * Buckets have four steps per power of two so a percentile is within 25% of the real value.
+ *
+ * LoopStats        - Show loop time percentiles, longest call and free stack per task
+ *
+ * ESP32 reports the stack high water mark of all FreeRTOS tasks, ESP8266 the free loop stack.
+\*********************************************************************************************/
+
+const uint8_t LOOP_STATS_SLICES = 6;
+const uint8_t LOOP_STATS_SLICE = 10;        // Seconds per slice
+const uint8_t LOOP_STATS_BUCKETS = 80;      // Last bucket holds loops of 1.8 seconds and longer
+const uint8_t LOOP_STATS_TASKS = 16;        // Max number of reported tasks
+
+struct LOOP_STATS_DATA {
+  uint32_t max;                             // Longest loop in microseconds
+  uint32_t block;                           // Longest driver or sensor call in microseconds
+  uint16_t bucket[LOOP_STATS_BUCKETS];      // Number of loops, saturating
+  uint8_t block_id;                         // Driver or sensor id of the longest call
+  uint8_t block_function;
+  bool block_sensor;
+};
+
+struct LOOP_STATS_TASK {
+  const char* name;
+  uint32_t free;                            // Lowest free stack in bytes
+};
+
+struct {
+  LOOP_STATS_DATA slice[LOOP_STATS_SLICES];
+  uint32_t next = 0;                        // millis() of the next slice
+  uint8_t current = 0;
+} LoopStats;
+
+uint32_t LoopStatsBucket(uint32_t duration)
+{
+  if (duration < 4) { return duration; }
+  uint32_t msb = 31 - __builtin_clz(duration);
+  uint32_t bucket = (msb -1) * 4 + ((duration >> (msb -2)) & 3);
+  return (bucket < LOOP_STATS_BUCKETS) ? bucket : LOOP_STATS_BUCKETS -1;
+}
+
+uint32_t LoopStatsBucketLimit(uint32_t bucket)
+{
+  // Returns the highest duration held by bucket
+  if (bucket < 4) { return bucket; }
+  return ((5 + bucket % 4) << (bucket / 4 -1)) -1;
+}
+
+void LoopStatsLoop(uint32_t active)
+{
+  if (!LoopStats.next || TimeReached(LoopStats.next)) {
+    SetNextTimeInterval(LoopStats.next, LOOP_STATS_SLICE * 1000);
+    LoopStats.current = (LoopStats.current +1) % LOOP_STATS_SLICES;
+    memset(&LoopStats.slice[LoopStats.current], 0, sizeof(LOOP_STATS_DATA));
+  }
+  LOOP_STATS_DATA *slice = &LoopStats.slice[LoopStats.current];
+  uint32_t bucket = LoopStatsBucket(active);
+  if (slice->bucket[bucket] < UINT16_MAX) { slice->bucket[bucket]++; }
+  if (active > slice->max) { slice->max = active; }
+}
+
+void LoopStatsReset(void)
+{
+  memset(LoopStats.slice, 0, sizeof(LoopStats.slice));
+}
+
+void LoopStatsFunction(bool sensor, uint32_t index, uint32_t function, uint32_t start)
+{
+  uint32_t duration = micros() - start;
+  LOOP_STATS_DATA *slice = &LoopStats.slice[LoopStats.current];
+  if (duration > slice->block) {
+    slice->block = duration;
+    slice->block_id = (sensor) ? XsnsId(index) : XdrvId(index);
+    slice->block_function = function;
+    slice->block_sensor = sensor;
+  }
+}
+
+uint32_t LoopStatsTasks(struct LOOP_STATS_TASK *tasks)
+{
+  // Returns number of tasks with their lowest free stack
+  uint32_t count = 0;
+#ifdef ESP8266
+#if !defined(ARDUINO_ESP8266_RELEASE_2_3_0) && !defined(ARDUINO_ESP8266_RELEASE_2_4_0) && !defined(ARDUINO_ESP8266_RELEASE_2_4_1) && !defined(ARDUINO_ESP8266_RELEASE_2_4_2)
+  tasks[count].name = "loop";
+  tasks[count++].free = ESP.getFreeContStack();
+#endif
+#else  // ESP32
+#if configUSE_TRACE_FACILITY
+  uint32_t size = uxTaskGetNumberOfTasks() +2;  // Allow for tasks started meanwhile
+  TaskStatus_t *status = (TaskStatus_t*)malloc(size * sizeof(TaskStatus_t));
+  if (status) {
+    size = uxTaskGetSystemState(status, size, nullptr);
+    for (uint32_t i = 0; (i < size) && (count < LOOP_STATS_TASKS); i++) {
+      tasks[count].name = status[i].pcTaskName;   // Stays valid as long as the task exists
+      tasks[count++].free = status[i].usStackHighWaterMark;
+    }
+    free(status);
+  }
+#else
+  tasks[count].name = pcTaskGetTaskName(nullptr);
+  tasks[count++].free = uxTaskGetStackHighWaterMark(nullptr);
+#endif  // configUSE_TRACE_FACILITY
+#endif  // ESP8266 - ESP32
+  return count;
+}
+
+struct LOOP_STATS_SUMMARY {
+  uint32_t loops;
+  uint32_t p50;
+  uint32_t p99;
+  uint32_t max;
+  uint32_t block;
+  uint8_t block_id;
+  uint8_t block_function;
+  bool block_sensor;
+};
+
+void LoopStatsSummary(struct LOOP_STATS_SUMMARY *summary)
+{
+  uint32_t bucket[LOOP_STATS_BUCKETS] = { 0 };
+  memset(summary, 0, sizeof(LOOP_STATS_SUMMARY));
+  for (uint32_t i = 0; i < LOOP_STATS_SLICES; i++) {
+    LOOP_STATS_DATA *slice = &LoopStats.slice[i];
+    for (uint32_t j = 0; j < LOOP_STATS_BUCKETS; j++) {
+      bucket[j] += slice->bucket[j];
+      summary->loops += slice->bucket[j];
+    }
+    if (slice->max > summary->max) { summary->max = slice->max; }
+    if (slice->block > summary->block) {
+      summary->block = slice->block;
+      summary->block_id = slice->block_id;
+      summary->block_function = slice->block_function;
+      summary->block_sensor = slice->block_sensor;
+    }
+  }
+
+  uint32_t p50 = (summary->loops +1) / 2;
+  uint32_t p99 = summary->loops - summary->loops / 100;
+  uint32_t loops = 0;
+  for (uint32_t j = 0; j < LOOP_STATS_BUCKETS; j++) {
+    if (!bucket[j]) { continue; }
+    loops += bucket[j];
+    uint32_t limit = LoopStatsBucketLimit(j);
+    if (limit > summary->max) { limit = summary->max; }
+    if (!summary->p50 && (loops >= p50)) { summary->p50 = limit; }
+    if (loops >= p99) {
+      summary->p99 = limit;
+      break;
+    }
+  }
+}
+
+void CmndLoopStats(void)
+{
+  LOOP_STATS_SUMMARY summary;
+  LoopStatsSummary(&summary);
+  Response_P(PSTR("{\"" D_CMND_LOOPSTATS "\":{\"Loops\":%d,\"P50\":%d,\"P99\":%d,\"Max\":%d"),
+    summary.loops, summary.p50, summary.p99, summary.max);
+  if (summary.block) {
+    ResponseAppend_P(PSTR(",\"Block\":{\"%s\":%d,\"Function\":%d,\"Max\":%d}"),
+      (summary.block_sensor) ? D_CMND_SENSOR : D_CMND_DRIVER, summary.block_id, summary.block_function, summary.block);
+  }
+  LOOP_STATS_TASK tasks[LOOP_STATS_TASKS];
+  uint32_t count = LoopStatsTasks(tasks);
+  ResponseAppend_P(PSTR(",\"Tasks\":{"));
+  for (uint32_t i = 0; i < count; i++) {
+    ResponseAppend_P(PSTR("%s\"%s\":%d"), (i) ? "," : "", tasks[i].name, tasks[i].free);
+  }
+  ResponseAppend_P(PSTR("}}}"));
+}
+
+#ifdef USE_WEBSERVER
+void LoopStatsMetrics(void)
+{
+  LOOP_STATS_SUMMARY summary;
+  LoopStatsSummary(&summary);
+  WSContentSend_P(PSTR("# TYPE loop_latency_microseconds summary\n"
+                       "loop_latency_microseconds{quantile=\"0.5\"} %d\n"
+                       "loop_latency_microseconds{quantile=\"0.99\"} %d\n"
+                       "loop_latency_microseconds{quantile=\"1\"} %d\n"
+                       "loop_latency_microseconds_count %d\n"),
+    summary.p50, summary.p99, summary.max, summary.loops);
+  WSContentSend_P(PSTR("# TYPE loop_block_microseconds gauge\nloop_block_microseconds{%s=\"%d\",function=\"%d\"} %d\n"),
+    (summary.block_sensor) ? "sensor" : "driver", summary.block_id, summary.block_function, summary.block);
+
+  LOOP_STATS_TASK tasks[LOOP_STATS_TASKS];
+  uint32_t count = LoopStatsTasks(tasks);
+  WSContentSend_P(PSTR("# TYPE task_stack_free_bytes gauge\n"));
+  for (uint32_t i = 0; i < count; i++) {
+    WSContentSend_P(PSTR("task_stack_free_bytes{task=\"%s\"} %d\n"), tasks[i].name, tasks[i].free);
+  }
+}
+#endif  // USE_WEBSERVER
+
+#endif  // USE_LOOP_STATS
@@ -0,0 +1,475 @@
+/*
+  support_ota.ino - resumable OTA download support for Tasmota
+
+  Copyright (C) 2020  Theo Arends
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef USE_OTA_RESUME
+/*********************************************************************************************\
+ * Resumable OTA download
+ *
+ * Replaces ESPhttpUpdate for command Upgrade. The image is read from the network one flash sector
+ * at a time while lwIP keeps receiving into its TCP window during the flash write. When the
+ * connection drops or stalls the download continues at the next byte using a HTTP Range request,
+ * or skips the bytes already written if the server does not support ranges.
+ *
+ * A SHA-256 is calculated while streaming. If the server provides <OtaUrl>.sha256 containing the
+ * hex digest the last block is only written and the image only activated when it matches.
+ * Gzip compressed images (.bin.gz) are written as received and unpacked by the ESP8266 boot loader.
+ *
+ * With USE_OTA_DELTA the MD5 of the running image is added to the url as parameter md5. A server
+ * like tools/fw_server/fw-server.py holding that image may then answer with a delta instead:
+ *   "TDLT", old size, old MD5, new size, new MD5 (little endian, 44 bytes)
+ *   followed by 9 byte operations type, a, b with
+ *   1 = copy b bytes from offset a of the running image
+ *   2 = copy the b bytes following this operation
+ * The new image is built in the OTA area while streaming and checked against the new MD5.
+\*********************************************************************************************/
+
+#ifdef ESP8266
+#include <t_bearssl_hash.h>
+#else
+#include "mbedtls/sha256.h"
+#ifdef USE_OTA_DELTA
+#include "esp_ota_ops.h"
+#endif  // USE_OTA_DELTA
+#endif  // ESP8266 - ESP32
+
+#ifndef OTA_RESUME_ATTEMPTS
+#define OTA_RESUME_ATTEMPTS    10           // Number of times to continue a dropped download
+#endif
+
+const uint16_t OTA_BUFFER_SIZE = SPI_FLASH_SEC_SIZE;  // Network read and flash write block size
+const uint16_t OTA_TIMEOUT = 5000;          // mSeconds without data before resuming
+
+enum OtaErrors { OTA_ERR_NONE, OTA_ERR_MEMORY, OTA_ERR_SPACE, OTA_ERR_SIZE, OTA_ERR_HTTP, OTA_ERR_HEADER,
+                 OTA_ERR_FLASH, OTA_ERR_WRITE, OTA_ERR_SHA256, OTA_ERR_LOST };
+
+const char kOtaErrors[] PROGMEM =
+  "|Not enough memory|Not enough space|No file size|HTTP error|Invalid file header|Wrong flash size|Flash write failed|SHA-256 mismatch|Connection lost";
+
+struct {
+  uint8_t *buffer = nullptr;
+  uint32_t size;                            // Image size
+  uint32_t written;                         // Bytes passed to Update
+  uint8_t sha256[32];                       // Expected digest
+  bool verify;                              // Expected digest available
+  bool started;                             // Update.begin() done
+  uint8_t error;                            // OtaErrors
+  int http_code;                            // Last unexpected HTTP response code
+#ifdef USE_OTA_DELTA
+  bool delta;                               // Server sent a delta
+#endif  // USE_OTA_DELTA
+} Ota;
+
+#ifdef USE_OTA_DELTA
+const uint8_t OTA_DELTA_HEADER_SIZE = 44;
+const uint8_t OTA_DELTA_OP_SIZE = 9;
+
+enum OtaDeltaOperations { OTA_DELTA_NONE, OTA_DELTA_COPY, OTA_DELTA_DATA };
+
+struct {
+  uint8_t field[OTA_DELTA_HEADER_SIZE];     // Header or operation being received
+  uint8_t field_len;
+  bool header;                              // Header received
+  uint32_t remaining;                       // Data bytes left of current operation
+} OtaDelta;
+#endif  // USE_OTA_DELTA
+
+#ifdef ESP8266
+typedef br_sha256_context OtaSha256Context;
+#else
+typedef mbedtls_sha256_context OtaSha256Context;
+#endif  // ESP8266 - ESP32
+
+void OtaSha256Init(OtaSha256Context *ctx)
+{
+#ifdef ESP8266
+  br_sha256_init(ctx);
+#else
+  mbedtls_sha256_init(ctx);
+  mbedtls_sha256_starts_ret(ctx, 0);
+#endif  // ESP8266 - ESP32
+}
+
+void OtaSha256Update(OtaSha256Context *ctx, const uint8_t *data, uint32_t len)
+{
+#ifdef ESP8266
+  br_sha256_update(ctx, data, len);
+#else
+  mbedtls_sha256_update_ret(ctx, data, len);
+#endif  // ESP8266 - ESP32
+}
+
+void OtaSha256Final(OtaSha256Context *ctx, uint8_t *digest)
+{
+#ifdef ESP8266
+  br_sha256_out(ctx, digest);
+#else
+  mbedtls_sha256_finish_ret(ctx, digest);
+  mbedtls_sha256_free(ctx);
+#endif  // ESP8266 - ESP32
+}
+
+char* OtaErrorText(char* text, size_t size)
+{
+  if (OTA_ERR_HTTP == Ota.error) {
+    snprintf_P(text, size, PSTR("HTTP error %d"), Ota.http_code);
+  } else {
+    GetTextIndexed(text, size, Ota.error, kOtaErrors);
+  }
+  return text;
+}
+
+void OtaFetchSha256(const char *url)
+{
+  // Optional <url>.sha256 holding the hex digest of the image as first word
+  Ota.verify = false;
+  char sha_url[strlen(url) +8];
+  snprintf_P(sha_url, sizeof(sha_url), PSTR("%s.sha256"), url);
+
+  WiFiClient client;
+  HTTPClient http;
+  if (!http.begin(client, sha_url)) { return; }
+  if (HTTP_CODE_OK == http.GET()) {
+    String digest = http.getString();
+    if (digest.length() >= 64) {
+      Ota.verify = true;
+      for (uint32_t i = 0; i < sizeof(Ota.sha256); i++) {
+        char hex[3] = { digest[i *2], digest[i *2 +1], '\0' };
+        char *end;
+        Ota.sha256[i] = strtol(hex, &end, 16);
+        if (*end != '\0') { Ota.verify = false; }
+      }
+    }
+  }
+  http.end();
+  AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_UPLOAD "SHA-256 %s"), (Ota.verify) ? "found" : "not available");
+}
+
+bool OtaCheckHeader(uint8_t *header)
+{
+#ifdef ESP8266
+  if ((header[0] != 0xE9) && (header[0] != 0x1F)) {  // 0x1F is gzipped 0xE9
+#else
+  if (header[0] != 0xE9) {
+#endif  // ESP8266 - ESP32
+    Ota.error = OTA_ERR_HEADER;
+    return false;
+  }
+#ifdef ESP8266
+  if (0xE9 == header[0]) {
+    uint32_t bin_flash_size = ESP.magicFlashChipSize((header[3] & 0xf0) >> 4);
+    if (bin_flash_size > ESP.getFlashChipRealSize()) {
+      Ota.error = OTA_ERR_FLASH;
+      return false;
+    }
+  }
+#endif  // ESP8266
+  return true;
+}
+
+#ifdef USE_OTA_DELTA
+uint32_t OtaDeltaUint32(uint8_t *data)
+{
+  return data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24);
+}
+
+bool OtaDeltaHeader(uint8_t *header)
+{
+  char md5[33];
+  ToHex_P(header +8, 16, md5, sizeof(md5));
+  if ((OtaDeltaUint32(header +4) != ESP.getSketchSize()) || strcasecmp(md5, ESP.getSketchMD5().c_str())) {
+    Ota.error = OTA_ERR_HEADER;             // Delta is not for the running image
+    return false;
+  }
+  if (!Update.begin(OtaDeltaUint32(header +24))) {
+    Ota.error = OTA_ERR_SPACE;
+    return false;
+  }
+  Ota.started = true;
+  ToHex_P(header +28, 16, md5, sizeof(md5));
+  LowerCase(md5, md5);                      // As reported by Update MD5
+  Update.setMD5(md5);                       // Checked by Update.end()
+  return true;
+}
+
+bool OtaDeltaCopy(uint32_t offset, uint32_t length)
+{
+  if (offset + length > ESP.getSketchSize()) { return false; }
+
+  uint32_t block[64];
+  while (length) {
+    uint32_t aligned = offset & ~3;
+    uint32_t skip = offset - aligned;
+    uint32_t size = sizeof(block) - skip;
+    if (size > length) { size = length; }
+#ifdef ESP8266
+    if (!ESP.flashRead(aligned, block, (skip + size + 3) & ~3)) { return false; }
+#else
+    if (esp_partition_read(esp_ota_get_running_partition(), aligned, block, (skip + size + 3) & ~3) != ESP_OK) { return false; }
+#endif  // ESP8266 - ESP32
+    if (Update.write((uint8_t*)block + skip, size) != size) { return false; }
+    offset += size;
+    length -= size;
+  }
+  return true;
+}
+
+bool OtaDeltaApply(uint8_t *data, uint32_t len)
+{
+  while (len) {
+    if (OtaDelta.remaining) {
+      uint32_t size = (len < OtaDelta.remaining) ? len : OtaDelta.remaining;
+      if (Update.write(data, size) != size) { return false; }
+      OtaDelta.remaining -= size;
+      data += size;
+      len -= size;
+      continue;
+    }
+
+    uint32_t need = (OtaDelta.header) ? OTA_DELTA_OP_SIZE : OTA_DELTA_HEADER_SIZE;
+    uint32_t size = need - OtaDelta.field_len;
+    if (size > len) { size = len; }
+    memcpy(OtaDelta.field + OtaDelta.field_len, data, size);
+    OtaDelta.field_len += size;
+    data += size;
+    len -= size;
+    if (OtaDelta.field_len < need) { break; }  // Wait for next block
+    OtaDelta.field_len = 0;
+
+    if (!OtaDelta.header) {
+      if (!OtaDeltaHeader(OtaDelta.field)) { return false; }
+      OtaDelta.header = true;
+    }
+    else if (OTA_DELTA_COPY == OtaDelta.field[0]) {
+      if (!OtaDeltaCopy(OtaDeltaUint32(OtaDelta.field +1), OtaDeltaUint32(OtaDelta.field +5))) { return false; }
+    }
+    else if (OTA_DELTA_DATA == OtaDelta.field[0]) {
+      OtaDelta.remaining = OtaDeltaUint32(OtaDelta.field +5);
+    }
+    else {
+      return false;
+    }
+  }
+  return true;
+}
+#endif  // USE_OTA_DELTA
+
+bool OtaBegin(uint8_t *data)
+{
+  // Called with first block of file
+#ifdef USE_OTA_DELTA
+  Ota.delta = !memcmp_P(data, PSTR("TDLT"), 4);
+  if (Ota.delta) {
+    Ota.verify = false;                     // Any SHA-256 file is for the full image
+    memset(&OtaDelta, 0, sizeof(OtaDelta));
+    return true;                            // Update.begin() follows delta header
+  }
+#endif  // USE_OTA_DELTA
+  if (!OtaCheckHeader(data)) { return false; }
+  if (!Update.begin(Ota.size)) {
+    Ota.error = OTA_ERR_SPACE;
+    return false;
+  }
+  Ota.started = true;
+  return true;
+}
+
+bool OtaWrite(uint8_t *data, uint32_t len)
+{
+#ifdef USE_OTA_DELTA
+  if (Ota.delta) {
+    if (!OtaDeltaApply(data, len)) {
+      if (OTA_ERR_NONE == Ota.error) { Ota.error = OTA_ERR_WRITE; }
+      return false;
+    }
+    Ota.written += len;
+    return true;
+  }
+#endif  // USE_OTA_DELTA
+  if (Update.write(data, len) != len) {
+    Ota.error = OTA_ERR_WRITE;
+    return false;
+  }
+  Ota.written += len;
+  return true;
+}
+
+int32_t OtaRequest(const char *url, OtaSha256Context *sha)
+{
+  // Returns 1 when complete, 0 when the connection dropped or -1 on fatal error
+  WiFiClient client;
+  HTTPClient http;
+  if (!http.begin(client, url)) {
+    Ota.error = OTA_ERR_LOST;
+    return 0;
+  }
+  const char *headers[] = { "Content-Range" };
+  http.collectHeaders(headers, 1);
+  if (Ota.written) {
+    char range[24];
+    snprintf_P(range, sizeof(range), PSTR("bytes=%u-"), Ota.written);
+    http.addHeader(F("Range"), range);
+  }
+
+  int32_t result = -1;
+  uint32_t skip = 0;                        // Bytes already written when the server sends more
+  int code = http.GET();
+  if (HTTP_CODE_PARTIAL_CONTENT == code) {
+    uint32_t start = Ota.written;
+    uint32_t total = 0;
+    sscanf(http.header("Content-Range").c_str(), "bytes %u-%*u/%u", &start, &total);
+    if ((start > Ota.written) || (total && (total != Ota.size))) {
+      Ota.error = OTA_ERR_HTTP;
+      Ota.http_code = code;
+      http.end();
+      return -1;
+    }
+    skip = Ota.written - start;
+  }
+  else if (HTTP_CODE_OK == code) {
+    skip = Ota.written;
+    if (!Ota.size) {
+      int size = http.getSize();
+      if (size <= 0) {
+        Ota.error = OTA_ERR_SIZE;
+        http.end();
+        return -1;
+      }
+      Ota.size = size;
+    }
+  }
+  else if (code < 0) {
+    Ota.error = OTA_ERR_LOST;               // Connection failed so try again
+    http.end();
+    return 0;
+  }
+  else {
+    Ota.error = OTA_ERR_HTTP;
+    Ota.http_code = code;
+    http.end();
+    return -1;
+  }
+
+  WiFiClient *stream = http.getStreamPtr();
+  uint32_t last_data = millis();
+  while (true) {
+    uint32_t want = (skip) ? skip : Ota.size - Ota.written;
+    if (want > OTA_BUFFER_SIZE) { want = OTA_BUFFER_SIZE; }
+
+    uint32_t len = 0;
+    while (len < want) {
+      size_t available = stream->available();
+      if (available) {
+        len += stream->read(Ota.buffer + len, (available < want - len) ? available : want - len);
+        last_data = millis();
+      }
+      else if (!stream->connected() || (millis() - last_data > OTA_TIMEOUT)) {
+        break;
+      }
+      else {
+        delay(1);                           // Wait for data
+      }
+    }
+    OsWatchLoop();
+
+    if (skip) {
+      skip -= len;
+    } else if (!Ota.written && (len < 4)) {
+      len = 0;                              // Need file header in first block
+    } else if (len) {
+      if (!Ota.written && !OtaBegin(Ota.buffer)) { break; }
+      OtaSha256Update(sha, Ota.buffer, len);
+      if (Ota.written + len == Ota.size) {
+        // Only write last block when image is verified as Update.end() then aborts the unfinished update
+        uint8_t digest[32];
+        OtaSha256Final(sha, digest);
+        char hex[sizeof(digest) *2 +1];
+        AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_UPLOAD "SHA-256 %s"), ToHex_P(digest, sizeof(digest), hex, sizeof(hex)));  // Of delta if a delta was sent
+        if (Ota.verify && memcmp(digest, Ota.sha256, sizeof(digest))) {
+          Ota.error = OTA_ERR_SHA256;
+          break;
+        }
+        if (!OtaWrite(Ota.buffer, len)) { break; }
+        result = 1;
+        break;
+      }
+      if (!OtaWrite(Ota.buffer, len)) { break; }
+    }
+    if (len < want) {
+      Ota.error = OTA_ERR_LOST;
+      result = 0;
+      break;
+    }
+    delay(0);
+  }
+  http.end();
+  return result;
+}
+
+bool OtaDownload(const char *url)
+{
+  Ota.size = 0;
+  Ota.written = 0;
+  Ota.started = false;
+  Ota.error = OTA_ERR_NONE;
+  Ota.buffer = (uint8_t*)malloc(OTA_BUFFER_SIZE);
+  if (!Ota.buffer) {
+    Ota.error = OTA_ERR_MEMORY;
+    return false;
+  }
+  OtaFetchSha256(url);
+#ifdef USE_OTA_DELTA
+  char delta_url[strlen(url) +40];
+  snprintf_P(delta_url, sizeof(delta_url), PSTR("%s%cmd5=%s"), url, (strchr(url, '?')) ? '&' : '?', ESP.getSketchMD5().c_str());
+  url = delta_url;
+#endif  // USE_OTA_DELTA
+
+  OtaSha256Context sha;
+  OtaSha256Init(&sha);
+  uint32_t start_time = millis();
+  uint32_t resumes = 0;
+  int32_t result = 0;
+  while (!result) {
+    result = OtaRequest(url, &sha);
+    if (!result) {
+      if (resumes >= OTA_RESUME_ATTEMPTS) { break; }
+      resumes++;
+      AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_UPLOAD "Resume at %u of %u bytes"), Ota.written, Ota.size);
+      delay(100);
+    }
+  }
+  free(Ota.buffer);
+  Ota.buffer = nullptr;
+
+  if (result > 0) {
+    if (!Update.end()) {
+      Ota.error = OTA_ERR_WRITE;
+      return false;
+    }
+    AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_UPLOAD "%u bytes in %u mS, %u resumes"), Ota.size, millis() - start_time, resumes);
+    return true;
+  }
+  if (Ota.started) {
+    Update.end();                           // Abort unfinished update
+  }
+  char error[40];
+  AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_UPLOAD "%s"), OtaErrorText(error, sizeof(error)));
+  return false;
+}
+
+#endif  // USE_OTA_RESUME
@@ -0,0 +1,240 @@
+/*
+  support_profile.ino - driver and sensor loop profiler for Tasmota
+
+  Copyright (C) 2020  Theo Arends
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef USE_PROFILER
+/*********************************************************************************************\
+ * Runtime profiler
+ *
+ * Keeps call count and min/avg/max execution time in microseconds per driver or sensor for
+ * functions FUNC_LOOP up to FUNC_EVERY_SECOND and the active versus sleep time of loop().
+ *
+ * Profile          - Show loop time and the drivers and sensors using most time
+ * Profile 0        - Stop profiling and release memory
+ * Profile 1        - Start profiling
+ * Profile 2        - Reset collected data
+\*********************************************************************************************/
+
+const uint8_t PROFILE_FUNCTIONS = FUNC_EVERY_SECOND - FUNC_LOOP +1;  // Profiled functions
+const uint8_t PROFILE_TOP = 8;              // Number of entries reported by command Profile
+
+enum ProfileSources { PROFILE_DRIVER, PROFILE_SENSOR };
+
+struct PROFILE_ENTRY {
+  uint64_t total;                           // Total time in microseconds
+  uint32_t count;                           // Number of calls
+  uint32_t min;                             // Minimum time in microseconds
+  uint32_t max;                             // Maximum time in microseconds
+};
+
+struct PROFILER {
+  PROFILE_ENTRY *entry[2] = { nullptr, nullptr };  // [xdrv_present / xsns_present][PROFILE_FUNCTIONS]
+  uint64_t loop_active = 0;                 // Total loop active time in microseconds
+  uint64_t loop_sleep = 0;                  // Total SleepDelay time in microseconds
+  uint32_t loop_count = 0;
+  uint32_t loop_max = 0;                    // Maximum loop active time in microseconds
+  uint32_t start = 0;                       // Uptime at start of profiling
+} Profiler;
+
+uint32_t ProfileEntries(uint32_t source)
+{
+  return (PROFILE_DRIVER == source) ? XdrvPresent() : XsnsPresent();
+}
+
+uint32_t ProfileId(uint32_t source, uint32_t index)
+{
+  return (PROFILE_DRIVER == source) ? XdrvId(index) : XsnsId(index);
+}
+
+void ProfileReset(void)
+{
+  for (uint32_t source = PROFILE_DRIVER; source <= PROFILE_SENSOR; source++) {
+    if (Profiler.entry[source]) {
+      memset(Profiler.entry[source], 0, ProfileEntries(source) * PROFILE_FUNCTIONS * sizeof(PROFILE_ENTRY));
+    }
+  }
+  Profiler.loop_active = 0;
+  Profiler.loop_sleep = 0;
+  Profiler.loop_count = 0;
+  Profiler.loop_max = 0;
+  Profiler.start = uptime;
+}
+
+void ProfileStop(void)
+{
+  for (uint32_t source = PROFILE_DRIVER; source <= PROFILE_SENSOR; source++) {
+    if (Profiler.entry[source]) {
+      free(Profiler.entry[source]);
+      Profiler.entry[source] = nullptr;
+    }
+  }
+}
+
+bool ProfileStart(void)
+{
+  for (uint32_t source = PROFILE_DRIVER; source <= PROFILE_SENSOR; source++) {
+    if (!Profiler.entry[source]) {
+      Profiler.entry[source] = (PROFILE_ENTRY*)calloc(ProfileEntries(source) * PROFILE_FUNCTIONS, sizeof(PROFILE_ENTRY));
+      if (!Profiler.entry[source]) {
+        ProfileStop();
+        return false;
+      }
+    }
+  }
+  ProfileReset();
+  return true;
+}
+
+bool ProfileEnabled(void)
+{
+  return (Profiler.entry[PROFILE_SENSOR] != nullptr);
+}
+
+void ProfileFunction(uint32_t source, uint32_t index, uint32_t function, uint32_t start)
+{
+  if (!Profiler.entry[source]) { return; }
+  if ((function < FUNC_LOOP) || (function > FUNC_EVERY_SECOND)) { return; }
+
+  uint32_t duration = micros() - start;
+  PROFILE_ENTRY *entry = &Profiler.entry[source][index * PROFILE_FUNCTIONS + function - FUNC_LOOP];
+  if (!entry->count || (duration < entry->min)) { entry->min = duration; }
+  if (duration > entry->max) { entry->max = duration; }
+  entry->total += duration;
+  entry->count++;
+}
+
+void ProfileLoop(uint32_t active, uint32_t sleep)
+{
+  if (!ProfileEnabled()) { return; }
+
+  Profiler.loop_active += active;
+  Profiler.loop_sleep += sleep;
+  Profiler.loop_count++;
+  if (active > Profiler.loop_max) { Profiler.loop_max = active; }
+}
+
+uint32_t ProfileAverage(uint64_t total, uint32_t count)
+{
+  return (count) ? (uint32_t)(total / count) : 0;
+}
+
+void ProfileShow(void)
+{
+  Response_P(PSTR("{\"" D_CMND_PROFILE "\":{\"" D_CMND_STATE "\":\"%s\""), GetStateText(ProfileEnabled()));
+  if (!ProfileEnabled()) {
+    ResponseAppend_P(PSTR("}}"));
+    return;
+  }
+
+  ResponseAppend_P(PSTR(",\"Duration\":%d,\"Loops\":%d,\"Active\":%d,\"Sleep\":%d,\"ActiveMax\":%d,\"Top\":["),
+    uptime - Profiler.start, Profiler.loop_count,
+    ProfileAverage(Profiler.loop_active, Profiler.loop_count), ProfileAverage(Profiler.loop_sleep, Profiler.loop_count),
+    Profiler.loop_max);
+
+  // Report entries using most total time first using a selection pass per reported entry
+  uint64_t last_total = UINT64_MAX;
+  uint32_t last_key = UINT32_MAX;
+  for (uint32_t top = 0; top < PROFILE_TOP; top++) {
+    PROFILE_ENTRY *found = nullptr;
+    uint32_t found_key = 0;
+    for (uint32_t source = PROFILE_DRIVER; source <= PROFILE_SENSOR; source++) {
+      uint32_t entries = ProfileEntries(source) * PROFILE_FUNCTIONS;
+      for (uint32_t i = 0; i < entries; i++) {
+        PROFILE_ENTRY *entry = &Profiler.entry[source][i];
+        if (!entry->count) { continue; }
+        uint32_t key = (source << 16) | i;
+        // Next candidate is strictly below the last reported entry in (total, key) order
+        if ((entry->total > last_total) || ((entry->total == last_total) && (key >= last_key))) { continue; }
+        if (!found || (entry->total > found->total) || ((entry->total == found->total) && (key > found_key))) {
+          found = entry;
+          found_key = key;
+        }
+      }
+    }
+    if (!found) { break; }
+
+    uint32_t source = found_key >> 16;
+    uint32_t index = (found_key & 0xFFFF) / PROFILE_FUNCTIONS;
+    uint32_t function = (found_key & 0xFFFF) % PROFILE_FUNCTIONS + FUNC_LOOP;
+    ResponseAppend_P(PSTR("%s{\"%s\":%d,\"Function\":%d,\"Count\":%d,\"Min\":%d,\"Avg\":%d,\"Max\":%d}"),
+      (top) ? "," : "", (PROFILE_DRIVER == source) ? D_CMND_DRIVER : D_CMND_SENSOR, ProfileId(source, index), function,
+      found->count, found->min, ProfileAverage(found->total, found->count), found->max);
+    last_total = found->total;
+    last_key = found_key;
+  }
+  ResponseAppend_P(PSTR("]}}"));
+}
+
+void CmndProfile(void)
+{
+  switch (XdrvMailbox.payload) {
+    case 0:
+      ProfileStop();
+      break;
+    case 1:
+      if (!ProfileStart()) {
+        ResponseCmndChar_P(PSTR(D_JSON_ERROR));
+        return;
+      }
+      break;
+    case 2:
+      ProfileReset();
+      break;
+  }
+  ProfileShow();
+}
+
+#ifdef USE_WEBSERVER
+void ProfileMetrics(void)
+{
+  if (!ProfileEnabled()) { return; }
+
+  WSContentSend_P(PSTR("# TYPE loop_active_microseconds gauge\nloop_active_microseconds %d\n"),
+    ProfileAverage(Profiler.loop_active, Profiler.loop_count));
+  WSContentSend_P(PSTR("# TYPE loop_sleep_microseconds gauge\nloop_sleep_microseconds %d\n"),
+    ProfileAverage(Profiler.loop_sleep, Profiler.loop_count));
+
+  const char *metrics[] = { PSTR("profile_calls counter"), PSTR("profile_min_microseconds gauge"),
+                            PSTR("profile_avg_microseconds gauge"), PSTR("profile_max_microseconds gauge") };
+  for (uint32_t metric = 0; metric < ARRAY_SIZE(metrics); metric++) {
+    char name[40];
+    strncpy_P(name, metrics[metric], sizeof(name));
+    name[sizeof(name) -1] = '\0';
+    WSContentSend_P(PSTR("# TYPE %s\n"), name);
+    char *type = strchr(name, ' ');
+    if (type) { *type = '\0'; }
+    for (uint32_t source = PROFILE_DRIVER; source <= PROFILE_SENSOR; source++) {
+      uint32_t entries = ProfileEntries(source) * PROFILE_FUNCTIONS;
+      for (uint32_t i = 0; i < entries; i++) {
+        PROFILE_ENTRY *entry = &Profiler.entry[source][i];
+        if (!entry->count) { continue; }
+        uint32_t value = entry->count;
+        switch (metric) {
+          case 1: value = entry->min; break;
+          case 2: value = ProfileAverage(entry->total, entry->count); break;
+          case 3: value = entry->max; break;
+        }
+        WSContentSend_P(PSTR("%s{%s=\"%d\",function=\"%d\"} %u\n"), name, (PROFILE_DRIVER == source) ? "driver" : "sensor",
+          ProfileId(source, i / PROFILE_FUNCTIONS), i % PROFILE_FUNCTIONS + FUNC_LOOP, value);
+      }
+    }
+  }
+}
+#endif  // USE_WEBSERVER
+
+#endif  // USE_PROFILER
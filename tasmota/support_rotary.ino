@@ -22,10 +22,30 @@
 #ifdef ROTARY_V1
 /*********************************************************************************************\
  * Rotary support
+ *
+ * ESP32 decodes the quadrature signals with a hardware pulse counter unit, ESP8266 with a
+ * table driven interrupt on both pins. Each handler interval the dimmer or color temperature
+ * step is multiplied by one plus the rotation speed in counts per second / ROTARY_ACCEL_SPEED
+ * up to ROTARY_ACCEL_MAX so a fast spin covers the full range.
 \*********************************************************************************************/
 
+#ifndef ROTARY_ACCEL_SPEED
+#define ROTARY_ACCEL_SPEED     40      // Rotary counts per second adding one to the step multiplier
+#endif
+#ifndef ROTARY_ACCEL_MAX
+#define ROTARY_ACCEL_MAX       8       // Max step multiplier
+#endif
+#define ROTARY_PCNT_FILTER     12800   // ESP32 hardware pulse counter glitch filter in nSec (max 12.8 uSec)
+
+// Position change indexed by previous and current level of pin B and A (B1 A1 B0 A0)
+const int8_t kRotaryIncrement[16] = { 0, 1, -1, 2, -1, 0, -2, 1, 1, -2, 0, -1, 2, -1, 1, 0 };
+
 struct ROTARY {
   unsigned long debounce = 0;          // Rotary debounce timer
+  uint32_t last_time = 0;              // millis() of the last handled position change
+#ifdef ESP32
+  int8_t pcnt = -1;                    // Hardware pulse counter unit or -1 for interrupt decoding
+#endif  // ESP32
   uint8_t present = 0;
   uint8_t state = 0;
   uint8_t position = 128;
@@ -51,18 +71,7 @@ void update_rotary(void)
       uint8_t s = Rotary.state & 3;
       if (digitalRead(Pin(GPIO_ROT1A))) { s |= 4; }
       if (digitalRead(Pin(GPIO_ROT1B))) { s |= 8; }
-      switch (s) {
-        case 0: case 5: case 10: case 15:
-          break;
-        case 1: case 7: case 8: case 14:
-          Rotary.position++; break;
-        case 2: case 4: case 11: case 13:
-          Rotary.position--; break;
-        case 3: case 12:
-          Rotary.position = Rotary.position + 2; break;
-        default:
-          Rotary.position = Rotary.position - 2; break;
-      }
+      Rotary.position += kRotaryIncrement[s];
       Rotary.state = (s >> 2);
     }
   }
@@ -85,6 +94,14 @@ void RotaryInit(void)
     pinMode(Pin(GPIO_ROT1A), INPUT_PULLUP);
     pinMode(Pin(GPIO_ROT1B), INPUT_PULLUP);
 
+#ifdef ESP32
+    Rotary.pcnt = PcntAttachQuadrature(Pin(GPIO_ROT1A), Pin(GPIO_ROT1B), ROTARY_PCNT_FILTER);
+    if (Rotary.pcnt >= 0) {
+      Rotary.interrupts_in_use_count = 2;  // No polling of update_rotary() needed
+      return;
+    }
+#endif  // ESP32
+
     // GPIO6-GPIO11 are typically used to interface with the flash memory IC on
     // most esp8266 modules, so we should avoid adding interrupts to these pins.
 
@@ -103,8 +120,39 @@ void RotaryInit(void)
  * Rotary handler
 \*********************************************************************************************/
 
+int32_t RotaryAccelerate(int32_t delta)
+{
+  // Returns delta multiplied by the step multiplier for the rotation speed
+  uint32_t now = millis();
+  uint32_t elapsed = now - Rotary.last_time;
+  Rotary.last_time = now;
+  if (!elapsed) { elapsed = 1; }
+  uint32_t speed = abs(delta) * 1000 / elapsed;   // Counts per second
+  uint32_t multiplier = 1 + speed / ROTARY_ACCEL_SPEED;
+  if (multiplier > ROTARY_ACCEL_MAX) { multiplier = ROTARY_ACCEL_MAX; }
+  return delta * (int32_t)multiplier;
+}
+
+bool RotaryPending(void)
+{
+  // Returns true if the rotary moved and the handler can act on it at once
+  if (!Rotary.present || !TimeReached(Rotary.debounce)) { return false; }
+#ifdef ESP32
+  if (Rotary.pcnt >= 0) { return PcntQuadraturePending(Rotary.pcnt); }
+#endif  // ESP32
+  return (Rotary.last_position != Rotary.position);
+}
+
 void RotaryHandler(void)
 {
+#ifdef ESP32
+  if (Rotary.pcnt >= 0) {
+    int32_t delta = PcntQuadratureDelta(Rotary.pcnt);
+    if (LightPower()) {
+      Rotary.position = Rotary.last_position + constrain(delta, -127, 127);
+    }
+  }
+#endif  // ESP32
   if (Rotary.interrupts_in_use_count < 2) {
     noInterrupts();
     update_rotary();
@@ -112,30 +160,31 @@ void RotaryHandler(void)
     noInterrupts();
   }
   if (Rotary.last_position != Rotary.position) {
+    int32_t delta = RotaryAccelerate(Rotary.position - Rotary.last_position);
     if (MI_DESK_LAMP == my_module_type) { // Mi Desk lamp
       if (Button.hold_timer[0]) {
         Rotary.changed = 1;
         // button1 is pressed: set color temperature
         int16_t t = LightGetColorTemp();
-        t = t + ((Rotary.position - Rotary.last_position) * 4);
+        t = t + (delta * 4);
         if (t < 153) {
           t = 153;
         }
         if (t > 500) {
           t = 500;
         }
-        DEBUG_CORE_LOG(PSTR("ROT: " D_CMND_COLORTEMPERATURE " %d"), Rotary.position - Rotary.last_position);
+        DEBUG_CORE_LOG(PSTR("ROT: " D_CMND_COLORTEMPERATURE " %d"), delta);
         LightSetColorTemp((uint16_t)t);
       } else {
-        int8_t d = Settings.light_dimmer;
-        d = d + (Rotary.position - Rotary.last_position);
+        int16_t d = Settings.light_dimmer;
+        d = d + delta;
         if (d < 1) {
           d = 1;
         }
         if (d > 100) {
           d = 100;
         }
-        DEBUG_CORE_LOG(PSTR("ROT: " D_CMND_DIMMER " %d"), Rotary.position - Rotary.last_position);
+        DEBUG_CORE_LOG(PSTR("ROT: " D_CMND_DIMMER " %d"), delta);
 
         LightSetDimmer((uint8_t)d);
         Settings.light_dimmer = d;
@@ -0,0 +1,108 @@
+/*
+  support_sleep.ino - adaptive loop sleep and sleep accounting for Tasmota
+
+  Copyright (C) 2020  Theo Arends
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef USE_ADAPTIVE_SLEEP
+/*********************************************************************************************\
+ * Adaptive loop sleep enabled with SetOption98 1 and sleep accounting
+ *
+ * Dynamic sleep waits Sleep minus the loop activity, normal sleep always waits Sleep. Adaptive
+ * sleep waits until the next 50 mS tick at most and, after an event like a command, a serial
+ * byte or an input edge, starts with 1 mS growing to Sleep over SLEEP_RAMP mS of quiet. A high
+ * event rate keeps the sleep at 1 mS. Sleep (or PWM_MAX_SLEEP with lights on) stays the maximum.
+ *
+ * The accounting reports per last minute the mS active, sleeping and sleeping with WiFi modem
+ * or light sleep allowed, and the number of events in the teleperiod STATE message.
+\*********************************************************************************************/
+
+const uint16_t SLEEP_RAMP = 1000;           // mS of quiet to grow from 1 mS to Sleep
+const uint8_t SLEEP_BUSY_RATE = 20;         // Events per second keeping sleep at 1 mS
+
+struct SLEEP_STATS_DATA {
+  uint32_t active;                          // uS
+  uint32_t sleep;                           // uS
+  uint32_t modem;                           // uS of sleep with WiFi modem or light sleep allowed
+  uint32_t events;
+};
+
+struct {
+  SLEEP_STATS_DATA current;
+  SLEEP_STATS_DATA minute;                  // Last full minute
+  uint32_t next_minute = 0;                 // millis() of the next minute
+  uint32_t last_event = 0;                  // millis() of the last event
+  uint32_t rate = 0;                        // Events per second times 16, averaged over about 4 seconds
+  uint32_t second_events = 0;
+  bool modem_sleep = false;                 // WiFi may sleep while the loop sleeps
+} SleepStats;
+
+void SleepEvent(void)
+{
+  SleepStats.last_event = millis();
+  SleepStats.current.events++;
+  SleepStats.second_events++;
+}
+
+uint32_t SleepAdaptive(uint32_t max_sleep)
+{
+  // Returns mS to sleep
+  uint32_t sleep = max_sleep;
+  uint32_t quiet = millis() - SleepStats.last_event;
+  if (quiet < SLEEP_RAMP) {
+    sleep = 1 + (max_sleep * quiet) / SLEEP_RAMP;
+    if (sleep > max_sleep) { sleep = max_sleep; }
+  }
+  if (SleepStats.rate > SLEEP_BUSY_RATE * 16) { sleep = (max_sleep) ? 1 : 0; }
+#ifndef USE_TIMER_WHEEL                     // The timer wheel limits SleepDelay() to its next deadline
+  int32_t deadline = TimeDifference(millis(), state_50msecond);
+  if (deadline < 0) { deadline = 0; }
+  if (sleep > (uint32_t)deadline) { sleep = deadline; }
+#endif  // USE_TIMER_WHEEL
+  return sleep;
+}
+
+void SleepAccount(uint32_t active, uint32_t sleep)
+{
+  SleepStats.current.active += active;
+  SleepStats.current.sleep += sleep;
+  if (SleepStats.modem_sleep) { SleepStats.current.modem += sleep; }
+}
+
+void SleepEverySecond(void)
+{
+  SleepStats.rate = SleepStats.rate - (SleepStats.rate / 4) + (SleepStats.second_events * 16) / 4;
+  SleepStats.second_events = 0;
+#ifdef ESP8266
+  SleepStats.modem_sleep = !global_state.wifi_down && (WiFi.getSleepMode() != WIFI_NONE_SLEEP);
+#else  // ESP32
+  SleepStats.modem_sleep = !global_state.wifi_down && WiFi.getSleep();
+#endif  // ESP8266 - ESP32
+
+  if (!SleepStats.next_minute || TimeReached(SleepStats.next_minute)) {
+    SetNextTimeInterval(SleepStats.next_minute, 60000);
+    SleepStats.minute = SleepStats.current;
+    memset(&SleepStats.current, 0, sizeof(SleepStats.current));
+  }
+}
+
+void SleepShowState(void)
+{
+  ResponseAppend_P(PSTR(",\"SleepStats\":{\"Active\":%u,\"Sleep\":%u,\"ModemSleep\":%u,\"Events\":%u}"),
+    SleepStats.minute.active / 1000, SleepStats.minute.sleep / 1000, SleepStats.minute.modem / 1000, SleepStats.minute.events);
+}
+
+#endif  // USE_ADAPTIVE_SLEEP
@@ -23,6 +23,120 @@ typedef struct SBuffer_impl {
   uint8_t buf[];                     // the actual data
 } SBuffer_impl;
 
+/*********************************************************************************************\
+ * SBuffer pool
+ *
+ * Buffers up to 1024 bytes are taken from size classes of 64, 256 and 1024 bytes. A class keeps
+ * up to SBUFFER_POOL_BLOCKS blocks, allocated when first needed and returned to the class
+ * instead of the heap, so per frame buffers stop fragmenting the heap. Larger buffers and
+ * buffers exceeding a full class use the heap.
+ *
+ * The free and created blocks of a class are bitmaps updated with compare and swap, which is
+ * lock free on ESP32 and has no ABA problem as blocks never leave their slot.
+\*********************************************************************************************/
+
+#ifndef SBUFFER_POOL_BLOCKS
+#define SBUFFER_POOL_BLOCKS    4        // Max blocks per size class (max 32)
+#endif
+
+const uint8_t SBUFFER_POOL_CLASSES = 3;
+const uint16_t kSBufferPoolSize[SBUFFER_POOL_CLASSES] = { 64, 256, 1024 };
+const uint8_t SBUFFER_POOL_HEAP = 0xFF;
+
+typedef struct SBuffer_block {
+  uint8_t pool;                 // size class or SBUFFER_POOL_HEAP
+  uint8_t slot;
+  uint16_t spare;
+  SBuffer_impl impl;            // 32-bit aligned
+} SBuffer_block;
+
+class SBufferPool {
+
+public:
+  static SBuffer_impl* alloc(const size_t size) {
+    SBuffer_block *block = nullptr;
+    uint32_t pool = 0;
+    while ((pool < SBUFFER_POOL_CLASSES) && (size > kSBufferPoolSize[pool])) { pool++; }
+    if (pool < SBUFFER_POOL_CLASSES) {
+      block = take(pool);
+    }
+    if (!block) {
+      block = (SBuffer_block*) new char[sizeof(SBuffer_block) + size];
+      block->pool = SBUFFER_POOL_HEAP;
+    }
+    block->impl.size = size;
+    block->impl.len = 0;
+    return &block->impl;
+  }
+
+  static void release(SBuffer_impl *impl) {
+    if (!impl) { return; }
+    SBuffer_block *block = (SBuffer_block*) ((char*) impl - offsetof(SBuffer_block, impl));
+    if (SBUFFER_POOL_HEAP == block->pool) {
+      delete[] (char*) block;
+      return;
+    }
+    update(&_free[block->pool], 1 << block->slot, true);
+  }
+
+protected:
+  static SBuffer_block* take(uint32_t pool) {
+    uint32_t slot = update(&_free[pool], 0, false);  // Reuse a free block
+    if (slot < SBUFFER_POOL_BLOCKS) { return _block[pool][slot]; }
+
+    uint32_t created;
+    do {                                // Reserve a slot for a new block
+      created = _created[pool];
+      for (slot = 0; (slot < SBUFFER_POOL_BLOCKS) && (created & (1 << slot)); slot++);
+      if (slot >= SBUFFER_POOL_BLOCKS) { return nullptr; }  // Class is full
+    } while (!cas(&_created[pool], created, created | (1 << slot)));
+
+    SBuffer_block *block = (SBuffer_block*) malloc(sizeof(SBuffer_block) + kSBufferPoolSize[pool]);
+    if (!block) {
+      do { created = _created[pool]; } while (!cas(&_created[pool], created, created & ~(1 << slot)));
+      return nullptr;
+    }
+    block->pool = pool;
+    block->slot = slot;
+    _block[pool][slot] = block;
+    return block;
+  }
+
+  // Set bit in mask, or clear the lowest set bit and return its index (SBUFFER_POOL_BLOCKS if none)
+  static uint32_t update(volatile uint32_t *mask, uint32_t bit, bool set) {
+    uint32_t value, result;
+    do {
+      value = *mask;
+      if (set) {
+        result = value | bit;
+      } else {
+        if (!value) { return SBUFFER_POOL_BLOCKS; }
+        bit = value & -value;
+        result = value & ~bit;
+      }
+    } while (!cas(mask, value, result));
+    return __builtin_ctz(bit);
+  }
+
+  static bool cas(volatile uint32_t *mask, uint32_t expected, uint32_t desired) {
+#ifdef ESP32
+    return __atomic_compare_exchange_n(mask, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#else
+    if (*mask != expected) { return false; }  // Only used from the loop on ESP8266
+    *mask = desired;
+    return true;
+#endif
+  }
+
+  static volatile uint32_t _free[SBUFFER_POOL_CLASSES];
+  static volatile uint32_t _created[SBUFFER_POOL_CLASSES];
+  static SBuffer_block *_block[SBUFFER_POOL_CLASSES][SBUFFER_POOL_BLOCKS];
+};
+
+volatile uint32_t SBufferPool::_free[SBUFFER_POOL_CLASSES] = { 0 };
+volatile uint32_t SBufferPool::_created[SBUFFER_POOL_CLASSES] = { 0 };
+SBuffer_block *SBufferPool::_block[SBUFFER_POOL_CLASSES][SBUFFER_POOL_BLOCKS] = { { nullptr } };
+
 
 
 typedef class SBuffer {
@@ -34,10 +148,7 @@ protected:
 
 public:
   SBuffer(const size_t size) {
-    _buf = (SBuffer_impl*) new char[size+4];   // add 4 bytes for size and len
-    _buf->size = size;
-    _buf->len = 0;
-    //*((uint32_t*)_buf) = size;   // writing both size and len=0 in a single 32 bits write
+    _buf = SBufferPool::alloc(size);
   }
 
   inline size_t getSize(void) const { return _buf->size; }
@@ -49,7 +160,7 @@ public:
   inline char    *charptr(size_t i = 0) const { return (char*) &_buf->buf[i]; }
 
   virtual ~SBuffer(void) {
-    delete[] _buf;
+    SBufferPool::release(_buf);
   }
 
   inline void setLen(const size_t len) {
@@ -36,6 +36,10 @@ Ticker TickerSwitch;
 struct SWITCH {
   unsigned long debounce = 0;                // Switch debounce timer
   uint16_t no_pullup_mask = 0;               // Switch pull-up bitmask flags
+  uint16_t used_mask = 0;                    // Switches with a pin
+#ifdef USE_INPUT_INTERRUPT
+  uint16_t irq_mask = 0;                     // Switches using interrupts instead of probing
+#endif  // USE_INPUT_INTERRUPT
   uint8_t state[MAX_SWITCHES] = { 0 };
   uint8_t last_state[MAX_SWITCHES];          // Last wall switch states
   uint8_t hold_timer[MAX_SWITCHES] = { 0 };  // Timer for wallswitch push button hold
@@ -107,7 +111,10 @@ void SwitchProbe(void)
   }
 
   for (uint32_t i = 0; i < MAX_SWITCHES; i++) {
-    if (PinUsed(GPIO_SWT1, i)) {
+#ifdef USE_INPUT_INTERRUPT
+    if (bitRead(Switch.irq_mask, i)) { continue; }
+#endif  // USE_INPUT_INTERRUPT
+    if (bitRead(Switch.used_mask, i)) {
       // Olimex user_switch2.c code to fix 50Hz induced pulses
       if (1 == digitalRead(Pin(GPIO_SWT1, i))) {
 
@@ -190,8 +197,10 @@ void SwitchProbe(void)
 void SwitchInit(void)
 {
   uint8_t ac_detect = Settings.switch_debounce % 10 == 9;
+  uint32_t probed = 0;
 
   Switch.present = 0;
+  Switch.used_mask = PinUsedMask(GPIO_SWT1, MAX_SWITCHES);
   for (uint32_t i = 0; i < MAX_SWITCHES; i++) {
     Switch.last_state[i] = 1;  // Init global to virtual switch state;
     if (PinUsed(GPIO_SWT1, i)) {
@@ -203,10 +212,20 @@ void SwitchInit(void)
       } else {
         Switch.last_state[i] = digitalRead(Pin(GPIO_SWT1, i));  // Set global now so doesn't change the saved power state on first switch check
       }
+#ifdef USE_INPUT_INTERRUPT
+      if (!ac_detect && Settings.flag4.input_interrupt &&  // SetOption96 - Interrupt driven switch and button input
+          InputIrqAttach(i, Pin(GPIO_SWT1, i))) {
+        bitSet(Switch.irq_mask, i);
+      } else {
+        probed++;
+      }
+#else
+      probed++;
+#endif  // USE_INPUT_INTERRUPT
     }
     Switch.virtual_state[i] = Switch.last_state[i];
   }
-  if (Switch.present) {
+  if (probed) {
     if (ac_detect) {
       TickerSwitch.attach_ms(SWITCH_FAST_PROBE_INTERVAL, SwitchProbe);
       Switch.first_change = true;
@@ -227,7 +246,7 @@ void SwitchHandler(uint8_t mode)
   uint16_t loops_per_second = 1000 / Settings.switch_debounce;
 
   for (uint32_t i = 0; i < MAX_SWITCHES; i++) {
-    if (PinUsed(GPIO_SWT1, i) || (mode)) {
+    if (bitRead(Switch.used_mask, i) || (mode)) {
       uint8_t button = Switch.virtual_state[i];
       uint8_t switchflag = POWER_TOGGLE +1;
 
@@ -367,9 +386,7 @@ void SwitchHandler(uint8_t mode)
         Switch.last_state[i] = button;
       }
       if (switchflag <= POWER_TOGGLE) {
-        if (!SendKey(KEY_SWITCH, i +1, switchflag)) {  // Execute command via MQTT
-          ExecuteCommandPower(i +1, switchflag, SRC_SWITCH);  // Execute command internally (if i < devices_present)
-        }
+        KeyPower(KEY_SWITCH, i +1, switchflag, SRC_SWITCH);  // Execute command via MQTT or internally (if i < devices_present)
       }
     }
   }
@@ -378,6 +395,20 @@ void SwitchHandler(uint8_t mode)
 void SwitchLoop(void)
 {
   if (Switch.present) {
+#ifdef USE_INPUT_INTERRUPT
+    if (Switch.irq_mask) {
+      InputIrqLoop();
+      uint32_t changed = InputIrqTake(0, MAX_SWITCHES);
+      if (changed) {
+        for (uint32_t i = 0; i < MAX_SWITCHES; i++) {
+          if (bitRead(changed, i)) { Switch.virtual_state[i] = InputIrqLevel(i); }
+        }
+        SetNextTimeInterval(Switch.debounce, Settings.switch_debounce);
+        SwitchHandler(0);                    // Act on the debounced edge now
+        return;
+      }
+    }
+#endif  // USE_INPUT_INTERRUPT
     if (TimeReached(Switch.debounce)) {
       SetNextTimeInterval(Switch.debounce, Settings.switch_debounce);
       SwitchHandler(0);
@@ -17,7 +17,7 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-const char kSleepMode[] PROGMEM = "Dynamic|Normal";
+const char kSleepMode[] PROGMEM = "Dynamic|Normal|Adaptive";
 const char kPrefixes[] PROGMEM = D_CMND "|" D_STAT "|" D_TELE;
 
 char* Format(char* output, const char* input, int size)
@@ -76,6 +76,33 @@ char* GetOtaUrl(char *otaurl, size_t otaurl_size)
   return otaurl;
 }
 
+/*********************************************************************************************\
+ * Topic cache
+ *
+ * Expanded full topics of the own topic and the fallback topic are kept per prefix so
+ * publishing only appends the subtopic. Changes to FullTopic, Topic and Prefix clear the cache.
+\*********************************************************************************************/
+
+const uint8_t TOPIC_CACHE_SLOTS = 6;        // Cmnd, Stat and Tele of topic and fallback topic
+
+char* TopicCache[TOPIC_CACHE_SLOTS] = { nullptr };
+
+void TopicCacheClear(void)
+{
+  for (uint32_t i = 0; i < TOPIC_CACHE_SLOTS; i++) {
+    free(TopicCache[i]);
+    TopicCache[i] = nullptr;
+  }
+}
+
+int32_t TopicCacheSlot(uint32_t prefix, char *topic)
+{
+  if ((prefix > 3) && (prefix < 7)) { return prefix -1; }  // Fallback topic
+  if (prefix > 2) { return -1; }                            // Group or button topic
+  if (fallback_topic_flag) { return prefix +3; }
+  return (topic && !strcmp(topic, mqtt_topic)) ? prefix : -1;
+}
+
 char* GetTopic_P(char *stopic, uint32_t prefix, char *topic, const char* subtopic)
 {
   /* prefix 0 = Cmnd
@@ -92,6 +119,11 @@ char* GetTopic_P(char *stopic, uint32_t prefix, char *topic, const char* subtopi
   String fulltopic;
 
   snprintf_P(romram, sizeof(romram), subtopic);
+  int32_t slot = TopicCacheSlot(prefix, topic);
+  if ((slot >= 0) && TopicCache[slot]) {
+    snprintf_P(stopic, TOPSZ, PSTR("%s%s"), TopicCache[slot], romram);
+    return stopic;
+  }
   if (fallback_topic_flag || (prefix > 3)) {
     bool fallback = (prefix < 8);
     prefix &= 3;
@@ -129,6 +161,9 @@ char* GetTopic_P(char *stopic, uint32_t prefix, char *topic, const char* subtopi
   if (!fulltopic.endsWith("/")) {
     fulltopic += "/";
   }
+  if (slot >= 0) {
+    TopicCache[slot] = strdup(fulltopic.c_str());  // Without memory the topic is expanded again next time
+  }
   snprintf_P(stopic, TOPSZ, PSTR("%s%s"), fulltopic.c_str(), romram);
   return stopic;
 }
@@ -463,7 +498,7 @@ bool SendKey(uint32_t key, uint32_t device, uint32_t state)
     GetTopic_P(stopic, CMND, key_topic,
                GetPowerDevice(scommand, device, sizeof(scommand), (key + Settings.flag.device_index_enable)));  // cmnd/switchtopic/POWERx - SetOption26 - Switch between POWER or POWER1
     if (CLEAR_RETAIN == state) {
-      mqtt_data[0] = '\0';
+      ResponseClear();
     } else {
       if ((Settings.flag3.button_switch_force_local ||      // SetOption61 - Force local operation when button/switch topic is set
            !strcmp(mqtt_topic, key_topic) ||
@@ -471,7 +506,7 @@ bool SendKey(uint32_t key, uint32_t device, uint32_t state)
           (POWER_TOGGLE == state)) {
         state = ~(power >> (device -1)) &1;                 // POWER_OFF or POWER_ON
       }
-      snprintf_P(mqtt_data, sizeof(mqtt_data), GetStateText(state));
+      Response_P(GetStateText(state));
     }
 #ifdef USE_DOMOTICZ
     if (!(DomoticzSendKey(key, device, state, strlen(mqtt_data)))) {
@@ -617,6 +652,135 @@ void ExecuteCommandPower(uint32_t device, uint32_t state, uint32_t source)
   }
 }
 
+#ifdef USE_FAST_POWER
+/*********************************************************************************************\
+ * Fast relay switching for local switch and button actions enabled with SetOption97 1
+ *
+ * The relay GPIO is switched at once and SendKey() with ExecuteCommandPower() run from the next
+ * loop iteration for MQTT state, rules, device groups and pulse time. Only used when the outcome
+ * is known up front: no rules or script enabled, no button or switch topic taking over, a plain
+ * relay GPIO and no interlocked relay to switch off first. Otherwise the normal path is used.
+\*********************************************************************************************/
+
+const uint8_t FAST_POWER_QUEUE = 4;          // Max number of deferred key actions
+
+struct FAST_POWER_ACTION {
+  uint8_t key;
+  uint8_t device;
+  uint8_t state;
+  uint8_t source;
+};
+
+struct {
+  FAST_POWER_ACTION action[FAST_POWER_QUEUE];
+  power_t power = 0;                         // Relay state written ahead of power
+  uint8_t count = 0;
+} FastPower;
+
+bool FastPowerAllowed(uint32_t key, uint32_t device, uint32_t state)
+{
+  if (!Settings.flag4.fast_power ||          // SetOption97 - Switch relays of local switch and button actions first
+      (state > POWER_TOGGLE) ||
+      Settings.rule_enabled ||               // Rules or script may take over the key
+      (POWER_ALL_ALWAYS_ON == Settings.poweronstate) ||
+      (device < 1) || (device > devices_present) || (device > MAX_RELAYS) ||
+      !PinUsed(GPIO_REL1, device -1)) {
+    return false;
+  }
+#ifdef ESP8266
+  if (EXS_RELAY == my_module_type) { return false; }
+#endif  // ESP8266
+#ifdef USE_SONOFF_IFAN
+  if (IsModuleIfan()) { return false; }
+#endif  // USE_SONOFF_IFAN
+#ifdef USE_PWM_DIMMER
+  if (PWM_DIMMER == my_module_type) { return false; }
+#endif  // USE_PWM_DIMMER
+#ifdef USE_SHUTTER
+  if (Settings.flag3.shutter_mode) { return false; }  // SetOption80 - Enable shutter support
+#endif  // USE_SHUTTER
+#ifdef USE_LIGHT
+  if (LightDevice() && (device >= LightDevice())) { return false; }
+#endif  // USE_LIGHT
+
+  if (!Settings.flag3.button_switch_force_local &&  // SetOption61 - Force local operation when button/switch topic is set
+      Settings.flag.mqtt_enabled && MqttIsConnected()) {  // SetOption3 - Enable MQTT
+    char key_topic[TOPSZ];
+    Format(key_topic, (key) ? SettingsText(SET_MQTT_SWITCH_TOPIC) : SettingsText(SET_MQTT_BUTTON_TOPIC), sizeof(key_topic));
+    if (strlen(key_topic) && strcmp(key_topic, "0")) { return false; }  // Key topic takes over
+  }
+  return true;
+}
+
+bool FastPowerKey(uint32_t key, uint32_t device, uint32_t state, uint32_t source)
+{
+  // Returns true if the relay is switched and the key action is deferred
+  if (FastPower.count >= FAST_POWER_QUEUE) { FastPowerLoop(); }  // Keep order
+  if (!FastPowerAllowed(key, device, state)) {
+    FastPowerLoop();                         // Keep order
+    return false;
+  }
+
+  power_t current = (FastPower.count) ? FastPower.power : power;
+  power_t mask = 1 << (device -1);
+  power_t target = current;
+  switch (state) {
+    case POWER_OFF: target &= ~mask; break;
+    case POWER_ON: target |= mask; break;
+    case POWER_TOGGLE: target ^= mask; break;
+  }
+  if (Settings.flag.interlock && (target & mask)) {  // CMND_INTERLOCK - Enable/disable interlock
+    for (uint32_t i = 0; i < MAX_INTERLOCKS; i++) {
+      if ((Settings.interlock[i] & mask) && (current & Settings.interlock[i] & ~mask)) {
+        FastPowerLoop();                     // Another relay needs to go off first
+        return false;
+      }
+    }
+  }
+
+  uint32_t relay_state = (target & mask) ? 1 : 0;
+  DigitalWrite(GPIO_REL1, device -1, bitRead(rel_inverted, device -1) ? !relay_state : relay_state);
+  FastPower.power = target;
+  FAST_POWER_ACTION *action = &FastPower.action[FastPower.count++];
+  action->key = key;
+  action->device = device;
+  action->state = state;
+  action->source = source;
+  return true;
+}
+
+bool FastPowerPending(void)
+{
+  return (FastPower.count > 0);
+}
+
+void FastPowerLoop(void)
+{
+  // Run the deferred key actions which result in the relay states already written
+  for (uint32_t i = 0; i < FastPower.count; i++) {
+    FAST_POWER_ACTION *action = &FastPower.action[i];
+    if (!SendKey(action->key, action->device, action->state)) {
+      ExecuteCommandPower(action->device, action->state, action->source);
+    } else {
+      uint32_t relay_state = bitRead(power, action->device -1);  // Key topic connected meanwhile took over
+      DigitalWrite(GPIO_REL1, action->device -1, bitRead(rel_inverted, action->device -1) ? !relay_state : relay_state);
+    }
+  }
+  FastPower.count = 0;
+}
+#endif  // USE_FAST_POWER
+
+void KeyPower(uint32_t key, uint32_t device, uint32_t state, uint32_t source)
+{
+  // Send key and execute power internally if not handled by MQTT or rules
+#ifdef USE_FAST_POWER
+  if (FastPowerKey(key, device, state, source)) { return; }
+#endif  // USE_FAST_POWER
+  if (!SendKey(key, device, state)) {
+    ExecuteCommandPower(device, state, source);
+  }
+}
+
 void StopAllPowerBlink(void)
 {
   power_t mask;
@@ -657,8 +821,11 @@ void MqttShowState(void)
 #endif
 
   ResponseAppend_P(PSTR(",\"" D_JSON_HEAPSIZE "\":%d,\"SleepMode\":\"%s\",\"Sleep\":%u,\"LoadAvg\":%u,\"MqttCount\":%u"),
-    ESP_getFreeHeap()/1024, GetTextIndexed(stemp1, sizeof(stemp1), Settings.flag3.sleep_normal, kSleepMode),  // SetOption60 - Enable normal sleep instead of dynamic sleep
+    ESP_getFreeHeap()/1024, GetTextIndexed(stemp1, sizeof(stemp1), (Settings.flag4.sleep_adaptive) ? 2 : Settings.flag3.sleep_normal, kSleepMode),  // SetOption98 and SetOption60
     ssleep, loop_load_avg, MqttConnectCount());
+#ifdef USE_ADAPTIVE_SLEEP
+  SleepShowState();
+#endif  // USE_ADAPTIVE_SLEEP
 
   for (uint32_t i = 1; i <= devices_present; i++) {
 #ifdef USE_LIGHT
@@ -685,14 +852,16 @@ void MqttShowState(void)
   }
 
   int32_t rssi = WiFi.RSSI();
-  ResponseAppend_P(PSTR(",\"" D_JSON_WIFI "\":{\"" D_JSON_AP "\":%d,\"" D_JSON_SSID "\":\"%s\",\"" D_JSON_BSSID "\":\"%s\",\"" D_JSON_CHANNEL "\":%d,\"" D_JSON_RSSI "\":%d,\"" D_JSON_SIGNAL "\":%d,\"" D_JSON_LINK_COUNT "\":%d,\"" D_JSON_DOWNTIME "\":\"%s\"}}"),
+  ResponseAppend_P(PSTR(",\"" D_JSON_WIFI "\":{\"" D_JSON_AP "\":%d,\"" D_JSON_SSID "\":\"%s\",\"" D_JSON_BSSID "\":\"%s\",\"" D_JSON_CHANNEL "\":%d,\"" D_JSON_RSSI "\":%d,\"" D_JSON_SIGNAL "\":%d,\"" D_JSON_LINK_COUNT "\":%d,\"" D_JSON_DOWNTIME "\":\"%s\""),
     Settings.sta_active +1, SettingsText(SET_STASSID1 + Settings.sta_active), WiFi.BSSIDstr().c_str(), WiFi.channel(),
     WifiGetRssiAsQuality(rssi), rssi, WifiLinkCount(), WifiDowntime().c_str());
+  WifiShowConnectTimes();
+  ResponseAppend_P(PSTR("}}"));
 }
 
 void MqttPublishTeleState(void)
 {
-  mqtt_data[0] = '\0';
+  ResponseClear();
   MqttShowState();
   MqttPublishPrefixTopic_P(TELE, PSTR(D_RSLT_STATE), MQTT_TELE_RETAIN);
 #if defined(USE_RULES) || defined(USE_SCRIPT)
@@ -700,6 +869,22 @@ void MqttPublishTeleState(void)
 #endif  // USE_SCRIPT
 }
 
+void MqttPublishTeleperiod(void)
+{
+  MqttPublishTeleState();
+
+  if (MqttPublishPrefixTopicStream_P(TELE, PSTR(D_RSLT_SENSOR), Settings.flag.mqtt_sensor_retain, MqttShowSensor)) {  // CMND_SENSORRETAIN
+#if defined(USE_RULES) || defined(USE_SCRIPT)
+    RulesTeleperiod();  // Allow rule based HA messages
+#endif  // USE_RULES
+  }
+
+  ResponseStreamFree();
+
+  XsnsCall(FUNC_AFTER_TELEPERIOD);
+  XdrvCall(FUNC_AFTER_TELEPERIOD);
+}
+
 void TempHumDewShow(bool json, bool pass_on, const char *types, float f_temperature, float f_humidity)
 {
   if (json) {
@@ -724,11 +909,54 @@ void TempHumDewShow(bool json, bool pass_on, const char *types, float f_temperat
   }
 }
 
+const char kSensorUnitKeys[] PROGMEM = D_JSON_PRESSURE "|" D_JSON_TEMPERATURE "|" D_JSON_SPEED;
+
+/*********************************************************************************************\
+ * Sensor snapshot
+ *
+ * The sensor JSON of MqttShowSensor() and the sensor rows of the web root status are rendered
+ * once after each measurement and reused by status requests, rules and web page refreshes until
+ * sensors take new readings or a command is executed. Teleperiod always renders anew as drivers
+ * send Domoticz and KNX updates while tele_period is zero.
+\*********************************************************************************************/
+
+struct {
+  String json;                              // Output of FUNC_JSON_APPEND
+  String html;                              // Output of FUNC_WEB_SENSOR
+  bool json_valid = false;
+  bool html_valid = false;
+} SensorSnapshot;
+
+void SensorSnapshotInvalidate(void)
+{
+  // Call after sensors updated their readings
+  SensorSnapshot.json_valid = false;
+  SensorSnapshot.html_valid = false;
+}
+
+void SensorSnapshotJson(void)
+{
+  if (SensorSnapshot.json_valid && tele_period) {
+    ResponseAppend_P(PSTR("%s"), SensorSnapshot.json.c_str());
+    return;
+  }
+
+  uint32_t flushed = ResponseStreamLength() - strlen(mqtt_data);
+  uint32_t start = strlen(mqtt_data);
+  XsnsCall(FUNC_JSON_APPEND);
+  XdrvCall(FUNC_JSON_APPEND);
+  if (ResponseStreamLength() - strlen(mqtt_data) == flushed) {  // Only keep output not flushed by streaming
+    SensorSnapshot.json = mqtt_data + start;
+    SensorSnapshot.json_valid = true;
+  }
+}
+
 bool MqttShowSensor(void)
 {
+  ResponseWatch(kSensorUnitKeys);
   ResponseAppendTime();
 
-  int json_data_start = strlen(mqtt_data);
+  uint32_t json_data_start = ResponseStreamLength();
   for (uint32_t i = 0; i < MAX_SWITCHES; i++) {
 #ifdef USE_TM1638
     if (PinUsed(GPIO_SWT1, i) || (PinUsed(GPIO_TM16CLK) && PinUsed(GPIO_TM16DIO) && PinUsed(GPIO_TM16STB))) {
@@ -738,17 +966,16 @@ bool MqttShowSensor(void)
       ResponseAppend_P(PSTR(",\"" D_JSON_SWITCH "%d\":\"%s\""), i +1, GetStateText(SwitchState(i)));
     }
   }
-  XsnsCall(FUNC_JSON_APPEND);
-  XdrvCall(FUNC_JSON_APPEND);
+  SensorSnapshotJson();
 
-  bool json_data_available = (strlen(mqtt_data) - json_data_start);
-  if (strstr_P(mqtt_data, PSTR(D_JSON_PRESSURE)) != nullptr) {
+  bool json_data_available = (ResponseStreamLength() - json_data_start);
+  if (ResponseContains(0)) {    // D_JSON_PRESSURE
     ResponseAppend_P(PSTR(",\"" D_JSON_PRESSURE_UNIT "\":\"%s\""), PressureUnit().c_str());
   }
-  if (strstr_P(mqtt_data, PSTR(D_JSON_TEMPERATURE)) != nullptr) {
+  if (ResponseContains(1)) {    // D_JSON_TEMPERATURE
     ResponseAppend_P(PSTR(",\"" D_JSON_TEMPERATURE_UNIT "\":\"%c\""), TempUnit());
   }
-  if ((strstr_P(mqtt_data, PSTR(D_JSON_SPEED)) != nullptr) && Settings.flag2.speed_conversion) {
+  if (ResponseContains(2) && Settings.flag2.speed_conversion) {  // D_JSON_SPEED
     ResponseAppend_P(PSTR(",\"" D_JSON_SPEED_UNIT "\":\"%s\""), SpeedUnit().c_str());
   }
   ResponseJsonEnd();
@@ -759,7 +986,7 @@ bool MqttShowSensor(void)
 
 void MqttPublishSensor(void)
 {
-  mqtt_data[0] = '\0';
+  ResponseClear();
   if (MqttShowSensor()) {
     MqttPublishTeleSensor();
   }
@@ -776,6 +1003,13 @@ void PerformEverySecond(void)
 {
   uptime++;
 
+#ifdef USE_ADAPTIVE_SLEEP
+  SleepEverySecond();
+#endif  // USE_ADAPTIVE_SLEEP
+#ifdef USE_DNS_CACHE
+  DnsCacheEverySecond();
+#endif  // USE_DNS_CACHE
+
   if (POWER_CYCLE_TIME == uptime) {
     UpdateQuickPowerCycle(false);
   }
@@ -822,6 +1056,10 @@ void PerformEverySecond(void)
 
   ResetGlobalValues();
 
+#ifdef USE_ENERGY_JOURNAL
+  JournalEverySecond();
+#endif  // USE_ENERGY_JOURNAL
+
   if (Settings.tele_period) {
     if (tele_period >= 9999) {
       if (!global_state.wifi_down) {
@@ -831,19 +1069,7 @@ void PerformEverySecond(void)
       tele_period++;
       if (tele_period >= Settings.tele_period) {
         tele_period = 0;
-
-        MqttPublishTeleState();
-
-        mqtt_data[0] = '\0';
-        if (MqttShowSensor()) {
-          MqttPublishPrefixTopic_P(TELE, PSTR(D_RSLT_SENSOR), Settings.flag.mqtt_sensor_retain);  // CMND_SENSORRETAIN
-#if defined(USE_RULES) || defined(USE_SCRIPT)
-          RulesTeleperiod();  // Allow rule based HA messages
-#endif  // USE_RULES
-        }
-
-        XsnsCall(FUNC_AFTER_TELEPERIOD);
-        XdrvCall(FUNC_AFTER_TELEPERIOD);
+        MqttPublishTeleperiod();
       }
     }
   }
@@ -913,6 +1139,8 @@ void Every250mSeconds(void)
 
   uint32_t blinkinterval = 1;
 
+  HeapSample();
+
   state_250mS++;
   state_250mS &= 0x3;
 
@@ -976,7 +1204,7 @@ void Every250mSeconds(void)
         ota_result = 0;
         ota_retry_counter--;
         if (ota_retry_counter) {
-          strlcpy(mqtt_data, GetOtaUrl(log_data, sizeof(log_data)), sizeof(mqtt_data));
+          Response_P(PSTR("%s"), GetOtaUrl(log_data, sizeof(log_data)));
 #ifndef FIRMWARE_MINIMAL
           if (RtcSettings.ota_loader) {
             // OTA File too large so try OTA minimal version
@@ -1018,10 +1246,13 @@ void Every250mSeconds(void)
             if (pch == nullptr) { pch = ech; }                         // No dash so ignore filetype
             *pch = '\0';                                               // mqtt_data = http://domus1:80/api/arduino/tasmota
             snprintf_P(mqtt_data, sizeof(mqtt_data), PSTR("%s-" D_JSON_MINIMAL "%s"), mqtt_data, ota_url_type);  // Minimal filename must be filename-minimal
+            ResponseSetLength(strlen(mqtt_data));
           }
 #endif  // FIRMWARE_MINIMAL
           AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_UPLOAD "%s"), mqtt_data);
-#if defined(ARDUINO_ESP8266_RELEASE_2_3_0) || defined(ARDUINO_ESP8266_RELEASE_2_4_0) || defined(ARDUINO_ESP8266_RELEASE_2_4_1) || defined(ARDUINO_ESP8266_RELEASE_2_4_2)
+#ifdef USE_OTA_RESUME
+          ota_result = OtaDownload(mqtt_data);
+#elif defined(ARDUINO_ESP8266_RELEASE_2_3_0) || defined(ARDUINO_ESP8266_RELEASE_2_4_0) || defined(ARDUINO_ESP8266_RELEASE_2_4_1) || defined(ARDUINO_ESP8266_RELEASE_2_4_2)
           ota_result = (HTTP_UPDATE_FAILED != ESPhttpUpdate.update(mqtt_data));
 #else
           // If using core stage or 2.5.0+ the syntax has changed
@@ -1030,9 +1261,13 @@ void Every250mSeconds(void)
 #endif
           if (!ota_result) {
 #ifndef FIRMWARE_MINIMAL
+#ifdef USE_OTA_RESUME
+            if ((OTA_ERR_SPACE == Ota.error) || (OTA_ERR_FLASH == Ota.error)) {
+#else
             int ota_error = ESPhttpUpdate.getLastError();
             DEBUG_CORE_LOG(PSTR("OTA: Error %d"), ota_error);
             if ((HTTP_UE_TOO_LESS_SPACE == ota_error) || (HTTP_UE_BIN_FOR_WRONG_FLASH == ota_error)) {
+#endif  // USE_OTA_RESUME
               RtcSettings.ota_loader = 1;  // Try minimal image next
             }
 #endif  // FIRMWARE_MINIMAL
@@ -1052,7 +1287,12 @@ void Every250mSeconds(void)
             restart_flag = 2;
           }
         } else {
+#ifdef USE_OTA_RESUME
+          char error[40];
+          ResponseAppend_P(PSTR(D_JSON_FAILED " %s"), OtaErrorText(error, sizeof(error)));
+#else
           ResponseAppend_P(PSTR(D_JSON_FAILED " %s"), ESPhttpUpdate.getLastErrorString().c_str());
+#endif  // USE_OTA_RESUME
         }
         ResponseAppend_P(PSTR("\"}"));
 //        restart_flag = 2;          // Restart anyway to keep memory clean webserver
@@ -1248,6 +1488,21 @@ void ArduinoOtaLoop(void)
 
 /********************************************************************************************/
 
+void BootLoop(void)
+{
+  // Record boot stage timing until mqtt is connected
+  if (!BootTime.sensors) {
+#ifdef USE_STAGED_BOOT
+    if (XsnsInitNext()) { return; }  // Init one sensor per loop
+#endif  // USE_STAGED_BOOT
+    BootTime.sensors = millis();
+  }
+  if (!BootTime.wifi && !global_state.wifi_down) { BootTime.wifi = millis(); }
+  if (!BootTime.mqtt && !global_state.mqtt_down) { BootTime.mqtt = millis(); }
+}
+
+/********************************************************************************************/
+
 void SerialInput(void)
 {
   while (Serial.available()) {
@@ -1511,6 +1766,7 @@ void GpioInit(void)
 
   analogWriteRange(Settings.pwm_range);      // Default is 1023 (Arduino.h)
   analogWriteFreq(Settings.pwm_frequency);   // Default is 1000 (core_esp8266_wiring_pwm.c)
+  analogWritePhaseShift(Settings.flag4.pwm_phase_shift);  // SetOption95 - Spread PWM channel rising edges over the PWM period
 
 #ifdef USE_SPI
   spi_flg = (((PinUsed(GPIO_SPI_CS) && (Pin(GPIO_SPI_CS) > 14)) || (Pin(GPIO_SPI_CS) < 12)) || ((PinUsed(GPIO_SPI_DC) && (Pin(GPIO_SPI_DC) > 14)) || (Pin(GPIO_SPI_DC) < 12)));
@@ -1546,10 +1802,7 @@ void GpioInit(void)
   }
 
 #ifdef USE_I2C
-  i2c_flg = (PinUsed(GPIO_I2C_SCL) && PinUsed(GPIO_I2C_SDA));
-  if (i2c_flg) {
-    Wire.begin(Pin(GPIO_I2C_SDA), Pin(GPIO_I2C_SCL));
-  }
+  I2cBegin();
 #endif  // USE_I2C
 
   devices_present = 0;
@@ -0,0 +1,217 @@
+/*
+  support_timer_wheel.ino - timer wheel support for Tasmota
+
+  Copyright (C) 2020  Theo Arends
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef USE_TIMER_WHEEL
+/*********************************************************************************************\
+ * Timer wheel
+ *
+ * Hierarchical timer wheel running one-shot and periodic callbacks from loop(). Level 0 has
+ * TIMER_WHEEL_SLOTS slots of TIMER_WHEEL_TICK mSeconds, every slot of the next level spans a
+ * full turn of the previous level. Timers move down a level when their slot comes up.
+ *
+ * int32_t timer = TimerSchedule(MyCallback, arg, 500, 0);     // Call MyCallback(arg) once after 500 mSeconds
+ * int32_t timer = TimerSchedule(MyCallback, arg, 100, 100);   // Call MyCallback(arg) every 100 mSeconds
+ * TimerCancel(timer);
+\*********************************************************************************************/
+
+const uint8_t TIMER_WHEEL_TICK = 10;        // mSeconds per level 0 slot
+const uint8_t TIMER_WHEEL_BITS = 6;
+const uint8_t TIMER_WHEEL_SLOTS = 1 << TIMER_WHEEL_BITS;
+const uint8_t TIMER_WHEEL_LEVELS = 3;       // Level spans 0.64 seconds, 41 seconds and 43 minutes
+const uint8_t TIMER_WHEEL_TIMERS = 24;      // Max number of scheduled timers
+
+enum TimerWheelStates { TIMER_FREE, TIMER_LINKED, TIMER_PENDING, TIMER_CANCELLED };
+
+struct TIMER_ENTRY {
+  TimerCallback callback;
+  uint32_t arg;
+  uint32_t expires;                         // Tick to run at
+  uint32_t period;                          // Ticks between runs or 0 for one-shot
+  uint8_t next;                             // Next timer in slot +1 or 0 for end of list
+  uint8_t level;
+  uint8_t slot;
+  uint8_t state;
+  uint8_t generation;                       // Invalidates handles of previous use of entry
+};
+
+struct TIMER_WHEEL {
+  TIMER_ENTRY timer[TIMER_WHEEL_TIMERS];
+  uint8_t slot[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];  // First timer in slot +1 or 0 for empty slot
+  uint32_t tick = 0;                        // Next tick to process
+  uint32_t tick_millis = 0;                 // millis() at which next tick is due
+} TimerWheel;
+
+uint32_t TimerWheelNow(void)
+{
+  // First tick starting at or after now
+  int32_t passed = millis() - TimerWheel.tick_millis;
+  return TimerWheel.tick + ((passed > 0) ? (passed + TIMER_WHEEL_TICK -1) / TIMER_WHEEL_TICK : 0);
+}
+
+uint32_t TimerWheelTicks(uint32_t mseconds)
+{
+  uint32_t ticks = (mseconds + TIMER_WHEEL_TICK -1) / TIMER_WHEEL_TICK;
+  return (ticks) ? ticks : 1;
+}
+
+void TimerWheelLink(uint32_t index)
+{
+  TIMER_ENTRY *timer = &TimerWheel.timer[index];
+  if ((int32_t)(timer->expires - TimerWheel.tick) < 0) {
+    timer->expires = TimerWheel.tick;         // Overdue so run on next processed tick
+  }
+  uint32_t delta = timer->expires - TimerWheel.tick;
+  uint32_t expires = timer->expires;
+  uint32_t level = 0;
+  while ((level < TIMER_WHEEL_LEVELS -1) && (delta >> (TIMER_WHEEL_BITS * (level +1)))) {
+    level++;
+  }
+  if (delta >> (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) {
+    expires = TimerWheel.tick + (1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) -1;  // Beyond top level so park and relink when it comes up
+  }
+  timer->level = level;
+  timer->slot = (expires >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS -1);
+  timer->next = 0;
+  timer->state = TIMER_LINKED;
+
+  // Append to keep timers due on the same tick in scheduling order
+  uint8_t *link = &TimerWheel.slot[level][timer->slot];
+  while (*link) {
+    link = &TimerWheel.timer[*link -1].next;
+  }
+  *link = index +1;
+}
+
+void TimerWheelUnlink(uint32_t index)
+{
+  TIMER_ENTRY *timer = &TimerWheel.timer[index];
+  uint8_t *link = &TimerWheel.slot[timer->level][timer->slot];
+  while (*link) {
+    if (*link == index +1) {
+      *link = timer->next;
+      break;
+    }
+    link = &TimerWheel.timer[*link -1].next;
+  }
+}
+
+int32_t TimerSchedule(TimerCallback callback, uint32_t arg, uint32_t delay_ms, uint32_t period_ms)
+{
+  // Returns handle for TimerCancel() or -1 if all timers are in use
+  for (uint32_t index = 0; index < TIMER_WHEEL_TIMERS; index++) {
+    TIMER_ENTRY *timer = &TimerWheel.timer[index];
+    if (TIMER_FREE == timer->state) {
+      timer->callback = callback;
+      timer->arg = arg;
+      timer->expires = TimerWheelNow() + TimerWheelTicks(delay_ms);
+      timer->period = (period_ms) ? TimerWheelTicks(period_ms) : 0;
+      timer->generation++;
+      TimerWheelLink(index);
+      return (timer->generation << 8) | index;
+    }
+  }
+  AddLog_P2(LOG_LEVEL_DEBUG, PSTR("TMR: No free timer"));
+  return -1;
+}
+
+void TimerCancel(int32_t handle)
+{
+  if (handle < 0) { return; }
+  uint32_t index = handle & 0xFF;
+  if (index >= TIMER_WHEEL_TIMERS) { return; }
+  TIMER_ENTRY *timer = &TimerWheel.timer[index];
+  if (timer->generation != ((handle >> 8) & 0xFF)) { return; }  // Already expired and reused
+
+  if (TIMER_LINKED == timer->state) {
+    TimerWheelUnlink(index);
+    timer->state = TIMER_FREE;
+  }
+  else if (TIMER_PENDING == timer->state) {
+    timer->state = TIMER_CANCELLED;           // Freed by TimerWheelLoop
+  }
+}
+
+void TimerWheelCascade(uint32_t level, uint32_t slot)
+{
+  uint8_t list = TimerWheel.slot[level][slot];
+  TimerWheel.slot[level][slot] = 0;
+  while (list) {
+    uint32_t index = list -1;
+    list = TimerWheel.timer[index].next;
+    TimerWheelLink(index);
+  }
+}
+
+void TimerWheelLoop(void)
+{
+  while ((int32_t)(millis() - TimerWheel.tick_millis) >= 0) {
+    uint32_t tick = TimerWheel.tick;
+    // Move timers of higher levels down when the lower level completed a turn
+    for (uint32_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+      if (tick & ((1 << (TIMER_WHEEL_BITS * level)) -1)) { break; }
+      TimerWheelCascade(level, (tick >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS -1));
+    }
+
+    // Detach the due slot so callbacks scheduling timers link them on later ticks
+    uint32_t slot = tick & (TIMER_WHEEL_SLOTS -1);
+    uint8_t list = TimerWheel.slot[0][slot];
+    TimerWheel.slot[0][slot] = 0;
+    for (uint8_t item = list; item; item = TimerWheel.timer[item -1].next) {
+      TimerWheel.timer[item -1].state = TIMER_PENDING;
+    }
+    TimerWheel.tick++;
+    TimerWheel.tick_millis += TIMER_WHEEL_TICK;
+
+    while (list) {
+      uint32_t index = list -1;
+      TIMER_ENTRY *timer = &TimerWheel.timer[index];
+      list = timer->next;
+      if (TIMER_PENDING == timer->state) {
+        timer->callback(timer->arg);
+      }
+      if ((TIMER_PENDING == timer->state) && timer->period) {
+        timer->expires += timer->period;     // Keep phase
+        uint32_t now = TimerWheelNow();
+        if ((int32_t)(timer->expires - now) < 0) {
+          timer->expires = now + timer->period;  // Skip runs missed while loop was blocked
+        }
+        TimerWheelLink(index);
+      } else {
+        timer->state = TIMER_FREE;
+      }
+    }
+  }
+}
+
+uint32_t TimerWheelSleep(uint32_t mseconds)
+{
+  // Limit sleep to the time left until the next level 0 deadline or cascade
+  uint32_t ticks = (TIMER_WHEEL_SLOTS - (TimerWheel.tick & (TIMER_WHEEL_SLOTS -1))) & (TIMER_WHEEL_SLOTS -1);
+  for (uint32_t i = 0; i < ticks; i++) {
+    if (TimerWheel.slot[0][(TimerWheel.tick + i) & (TIMER_WHEEL_SLOTS -1)]) {
+      ticks = i;
+      break;
+    }
+  }
+  int32_t left = TimerWheel.tick_millis + ticks * TIMER_WHEEL_TICK - millis();
+  if (left <= 0) { return 0; }
+  return (mseconds < (uint32_t)left) ? mseconds : left;
+}
+
+#endif  // USE_TIMER_WHEEL
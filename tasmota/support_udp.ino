@@ -23,6 +23,11 @@
 #define UDP_BUFFER_SIZE         120      // Max UDP buffer size needed for M-SEARCH message
 #endif
 #define UDP_MSEARCH_SEND_DELAY  1500     // Delay in ms before M-Search response is send
+#ifndef UDP_MAX_HANDLERS
+#define UDP_MAX_HANDLERS        4        // Max number of registered UDP packet handlers
+#endif
+
+const uint16_t UDP_SSDP_PORT = 1900;
 
 #include <Ticker.h>
 Ticker TickerMSearch;
@@ -33,6 +38,18 @@ uint16_t udp_remote_port;                // M-Search remote port
 bool udp_connected = false;
 bool udp_response_mutex = false;         // M-Search response mutex to control re-entry
 
+struct UDP_HANDLER {
+  const char *prefix;                    // PROGMEM text the packet starts with
+  UdpHandler handler;
+  uint16_t port;
+  uint8_t prefix_len;
+};
+
+struct {
+  UDP_HANDLER entry[UDP_MAX_HANDLERS];
+  uint8_t count = 0;
+} UdpHandlers;
+
 #ifdef ESP8266
 #ifndef UDP_MAX_PACKETS
 #define UDP_MAX_PACKETS   3             // we support x more packets than the current one
@@ -81,18 +98,19 @@ bool UdpConnect(void)
 {
   if (!udp_connected && !restart_flag) {
     // Simple Service Discovery Protocol (SSDP)
+    UdpRegister(UDP_SSDP_PORT, PSTR("M-SEARCH"), UdpMSearch);
 #ifdef ESP8266
     UdpCtx.reset();
     if (igmp_joingroup(WiFi.localIP(), IPAddress(239,255,255,250)) == ERR_OK) { // addr 239.255.255.250
       ip_addr_t addr = IPADDR4_INIT(INADDR_ANY);
-      if (UdpCtx.listen(&addr, 1900)) {         // port 1900
+      if (UdpCtx.listen(&addr, UDP_SSDP_PORT)) {  // port 1900
         // OK
         AddLog_P(LOG_LEVEL_INFO, PSTR(D_LOG_UPNP D_MULTICAST_REJOINED));
         udp_response_mutex = false;
         udp_connected = true;
       }
 #else // ESP32
-    if (PortUdp.beginMulticast(WiFi.localIP(), IPAddress(239,255,255,250), 1900)) {
+    if (PortUdp.beginMulticast(WiFi.localIP(), IPAddress(239,255,255,250), UDP_SSDP_PORT)) {
       AddLog_P(LOG_LEVEL_INFO, PSTR(D_LOG_UPNP D_MULTICAST_REJOINED));
       udp_response_mutex = false;
       udp_connected = true;
@@ -105,6 +123,96 @@ bool UdpConnect(void)
   return udp_connected;
 }
 
+/*********************************************************************************************\
+ * UDP dispatch
+ *
+ * Drivers register a handler for packets to a port starting with a prefix. PollUdp() hands each
+ * packet to the first matching handler in place in the receive buffer, NUL terminated, with
+ * udp_remote_ip and udp_remote_port set to the sender. A handler returning true ends the poll.
+ * Packets not starting with any registered prefix, like the many SSDP NOTIFY, are dropped after
+ * comparing just their first bytes.
+\*********************************************************************************************/
+
+bool UdpRegister(uint16_t port, const char *prefix, UdpHandler handler)
+{
+  for (uint32_t i = 0; i < UdpHandlers.count; i++) {
+    if ((UdpHandlers.entry[i].port == port) && (UdpHandlers.entry[i].prefix == prefix) && (UdpHandlers.entry[i].handler == handler)) {
+      return true;                       // Already registered
+    }
+  }
+  if (UdpHandlers.count >= UDP_MAX_HANDLERS) {
+    AddLog_P2(LOG_LEVEL_ERROR, PSTR("UDP: No free handler for port %d"), port);
+    return false;
+  }
+  UdpHandlers.entry[UdpHandlers.count].port = port;
+  UdpHandlers.entry[UdpHandlers.count].prefix = prefix;
+  UdpHandlers.entry[UdpHandlers.count].prefix_len = strlen_P(prefix);
+  UdpHandlers.entry[UdpHandlers.count].handler = handler;
+  UdpHandlers.count++;
+  return true;
+}
+
+bool UdpDispatch(uint16_t port, char *packet_buffer, uint32_t len)
+{
+  for (uint32_t i = 0; i < UdpHandlers.count; i++) {
+    UDP_HANDLER *entry = &UdpHandlers.entry[i];
+    if ((entry->port == port) && (len >= entry->prefix_len) && !memcmp_P(packet_buffer, entry->prefix, entry->prefix_len)) {
+      return entry->handler(packet_buffer, len);
+    }
+  }
+  return false;
+}
+
+bool UdpMSearch(char *packet_buffer, uint32_t len)
+{
+  // Simple Service Discovery Protocol (SSDP)
+  if (!Settings.flag2.emulation) { return false; }
+#if defined(USE_SCRIPT_HUE) || defined(USE_ZIGBEE)
+  if (udp_response_mutex) { return false; }
+#else
+  if (!devices_present || udp_response_mutex) { return false; }
+#endif
+  udp_response_mutex = true;
+
+  // AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR("UDP: M-SEARCH Packet from %s:%d\n%s"),
+  //   udp_remote_ip.toString().c_str(), udp_remote_port, packet_buffer);
+
+  uint32_t response_delay = UDP_MSEARCH_SEND_DELAY + ((millis() &0x7) * 100);  // 1500 - 2200 msec
+
+  LowerCase(packet_buffer, packet_buffer);
+  RemoveSpace(packet_buffer);
+
+#ifdef USE_EMULATION_WEMO
+  if (EMUL_WEMO == Settings.flag2.emulation) {
+    if (strstr_P(packet_buffer, URN_BELKIN_DEVICE) != nullptr) {     // type1 echo dot 2g, echo 1g's
+      TickerMSearch.attach_ms(response_delay, WemoRespondToMSearch, 1);
+      return true;
+    }
+    else if ((strstr_P(packet_buffer, UPNP_ROOTDEVICE) != nullptr) ||  // type2 Echo 2g (echo & echo plus)
+            (strstr_P(packet_buffer, SSDPSEARCH_ALL) != nullptr) ||
+            (strstr_P(packet_buffer, SSDP_ALL) != nullptr)) {
+      TickerMSearch.attach_ms(response_delay, WemoRespondToMSearch, 2);
+      return true;
+    }
+  }
+#endif  // USE_EMULATION_WEMO
+
+#ifdef USE_EMULATION_HUE
+  if (EMUL_HUE == Settings.flag2.emulation) {
+    if ((strstr_P(packet_buffer, PSTR(":device:basic:1")) != nullptr) ||
+        (strstr_P(packet_buffer, UPNP_ROOTDEVICE) != nullptr) ||
+        (strstr_P(packet_buffer, SSDPSEARCH_ALL) != nullptr) ||
+        (strstr_P(packet_buffer, SSDP_ALL) != nullptr)) {
+      TickerMSearch.attach_ms(response_delay, HueRespondToMSearch);
+      return true;
+    }
+  }
+#endif  // USE_EMULATION_HUE
+
+  udp_response_mutex = false;
+  return false;
+}
+
 void PollUdp(void)
 {
   if (udp_connected) {
@@ -118,54 +226,26 @@ void PollUdp(void)
       packet->buf[packet->len] = 0;   // add NULL at the end of the packer
       char * packet_buffer = (char*) &packet->buf;
       int32_t len = packet->len;
+      udp_remote_ip = packet->srcaddr;
+      udp_remote_port = packet->srcport;
 #else // ESP32
     while (PortUdp.parsePacket()) {
       char packet_buffer[UDP_BUFFER_SIZE];     // buffer to hold incoming UDP/SSDP packet
 
       int32_t len = PortUdp.read(packet_buffer, UDP_BUFFER_SIZE -1);
       packet_buffer[len] = 0;
+      udp_remote_ip = PortUdp.remoteIP();
+      udp_remote_port = PortUdp.remotePort();
 #endif
       AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR("UDP: Packet (%d)"), len);
       // AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR("\n%s"), packet_buffer);
 
-      // Simple Service Discovery Protocol (SSDP)
-      if (Settings.flag2.emulation) {
-#if defined(USE_SCRIPT_HUE) || defined(USE_ZIGBEE)
-        if (!udp_response_mutex && (strstr_P(packet_buffer, PSTR("M-SEARCH")) != nullptr)) {
-#else
-        if (devices_present && !udp_response_mutex && (strstr_P(packet_buffer, PSTR("M-SEARCH")) != nullptr)) {
-#endif
-          udp_response_mutex = true;
-
-#ifdef ESP8266
-          udp_remote_ip = packet->srcaddr;
-          udp_remote_port = packet->srcport;
-#else
-          udp_remote_ip = PortUdp.remoteIP();
-          udp_remote_port = PortUdp.remotePort();
-#endif
-
-          // AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR("UDP: M-SEARCH Packet from %s:%d\n%s"),
-          //   udp_remote_ip.toString().c_str(), udp_remote_port, packet_buffer);
-
-          uint32_t response_delay = UDP_MSEARCH_SEND_DELAY + ((millis() &0x7) * 100);  // 1500 - 2200 msec
-
-          LowerCase(packet_buffer, packet_buffer);
-          RemoveSpace(packet_buffer);
+      if (UdpDispatch(UDP_SSDP_PORT, packet_buffer, len)) { return; }
+    }
+    optimistic_yield(100);
+  }
+}
 
-#ifdef USE_EMULATION_WEMO
-          if (EMUL_WEMO == Settings.flag2.emulation) {
-            if (strstr_P(packet_buffer, URN_BELKIN_DEVICE) != nullptr) {     // type1 echo dot 2g, echo 1g's
-              TickerMSearch.attach_ms(response_delay, WemoRespondToMSearch, 1);
-              return;
-            }
-            else if ((strstr_P(packet_buffer, UPNP_ROOTDEVICE) != nullptr) ||  // type2 Echo 2g (echo & echo plus)
-                    (strstr_P(packet_buffer, SSDPSEARCH_ALL) != nullptr) ||
-                    (strstr_P(packet_buffer, SSDP_ALL) != nullptr)) {
-              TickerMSearch.attach_ms(response_delay, WemoRespondToMSearch, 2);
-              return;
-            }
-          }
 #endif  // USE_EMULATION_WEMO
 
 #ifdef USE_EMULATION_HUE
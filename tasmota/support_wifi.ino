@@ -42,8 +42,16 @@ const uint8_t WIFI_RETRY_OFFSET_SEC = 12;  // seconds
 #include <AddrList.h>                      // IPv6 DualStack
 #endif  // LWIP_IPV6=1
 
+enum WifiConnectModes { WIFI_CONNECT_SSID, WIFI_CONNECT_DIRECT, WIFI_CONNECT_SCAN };
+const char kWifiConnectModes[] PROGMEM = "Ssid|Direct|Scan";
+
 struct WIFI {
   uint32_t last_event = 0;                 // Last wifi connection event
+  uint32_t connect_start = 0;              // millis() of last scan or connect start
+  uint16_t scan_time = 0;                  // mSeconds used by last network scan
+  uint16_t associate_time = 0;             // mSeconds from connect start to AP association
+  uint16_t ip_time = 0;                    // mSeconds from AP association to IP address
+  uint8_t connect_mode = WIFI_CONNECT_SSID;
   uint32_t downtime = 0;                   // Wifi down duration
   uint16_t link_count = 0;                 // Number of wifi re-connect
   uint8_t counter;
@@ -203,8 +211,18 @@ void WifiBegin(uint8_t flag, uint8_t channel)
   if (Settings.ip_address[0]) {
     WiFi.config(Settings.ip_address[0], Settings.ip_address[1], Settings.ip_address[2], Settings.ip_address[3]);  // Set static IP
   }
+#ifdef USE_DEEPSLEEP
+  else {
+    DeepSleepResumeWifi();
+  }
+#endif  // USE_DEEPSLEEP
   WiFi.hostname(my_hostname);
 
+  Wifi.connect_mode = (channel) ? WIFI_CONNECT_DIRECT : WIFI_CONNECT_SSID;
+  Wifi.associate_time = 0;
+  Wifi.ip_time = 0;
+  Wifi.connect_start = millis();
+
   char stemp[40] = { 0 };
   if (channel) {
     WiFi.begin(SettingsText(SET_STASSID1 + Settings.sta_active), SettingsText(SET_STAPWD1 + Settings.sta_active), channel, Wifi.bssid);
@@ -257,6 +275,7 @@ void WifiBeginAfterScan(void)
     if (WiFi.scanComplete() != WIFI_SCAN_RUNNING) {
       WiFi.scanNetworks(true);                      // Start wifi scan async
       Wifi.scan_state++;
+      Wifi.connect_start = millis();
       AddLog_P(LOG_LEVEL_DEBUG, S_LOG_WIFI, PSTR("Network (re)scan started..."));
       return;
     }
@@ -265,6 +284,7 @@ void WifiBeginAfterScan(void)
   // Check scan done
   if (4 == Wifi.scan_state) {
     if (wifi_scan_result != WIFI_SCAN_RUNNING) {
+      Wifi.scan_time = millis() - Wifi.connect_start;
       Wifi.scan_state++;
     }
   }
@@ -323,6 +343,7 @@ void WifiBeginAfterScan(void)
     for (uint32_t i = 0; i < sizeof(Wifi.bssid); i++) {
       if (last_bssid[i] != Wifi.bssid[i]) {
         WifiBegin(ap, channel);                     // 0 (AP1), 1 (AP2) or 3 (default AP)
+        if (channel) { Wifi.connect_mode = WIFI_CONNECT_SCAN; }
         break;
       }
     }
@@ -342,6 +363,7 @@ String WifiDowntime(void)
 void WifiSetState(uint8_t state)
 {
   if (state == global_state.wifi_down) {
+    TRACE_EVENT(TRACE_WIFI_STATE, TRACE_INSTANT, state);
     if (state) {
       rules_flag.wifi_connected = 1;
       Wifi.link_count++;
@@ -397,6 +419,9 @@ void WifiCheckIp(void)
     Wifi.retry = Wifi.retry_init;
     if (Wifi.status != WL_CONNECTED) {
       AddLog_P(LOG_LEVEL_INFO, S_LOG_WIFI, PSTR(D_CONNECTED));
+      char stemp[8];
+      AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_WIFI "%s connect, scan %d, associate %d, IP %d mSec"),
+        GetTextIndexed(stemp, sizeof(stemp), Wifi.connect_mode, kWifiConnectModes), Wifi.scan_time, Wifi.associate_time, Wifi.ip_time);
 //      AddLog_P(LOG_LEVEL_INFO, PSTR("Wifi: Set IP addresses"));
       Settings.ip_address[1] = (uint32_t)WiFi.gatewayIP();
       Settings.ip_address[2] = (uint32_t)WiFi.subnetMask();
@@ -423,12 +448,18 @@ void WifiCheckIp(void)
     switch (Wifi.status) {
       case WL_CONNECTED:
         AddLog_P(LOG_LEVEL_INFO, S_LOG_WIFI, PSTR(D_CONNECT_FAILED_NO_IP_ADDRESS));
+#ifdef USE_DEEPSLEEP
+        DeepSleepResumeStop();
+#endif  // USE_DEEPSLEEP
         Wifi.status = 0;
         Wifi.retry = Wifi.retry_init;
         break;
       case WL_NO_SSID_AVAIL:
         AddLog_P(LOG_LEVEL_INFO, S_LOG_WIFI, PSTR(D_CONNECT_FAILED_AP_NOT_REACHED));
         Settings.wifi_channel = 0;  // Disable stored AP
+#ifdef USE_DEEPSLEEP
+        DeepSleepResumeStop();
+#endif  // USE_DEEPSLEEP
         if (WIFI_WAIT == Settings.sta_config) {
           Wifi.retry = Wifi.retry_init;
         } else {
@@ -443,6 +474,9 @@ void WifiCheckIp(void)
       case WL_CONNECT_FAILED:
         AddLog_P(LOG_LEVEL_INFO, S_LOG_WIFI, PSTR(D_CONNECT_FAILED_WRONG_PASSWORD));
         Settings.wifi_channel = 0;  // Disable stored AP
+#ifdef USE_DEEPSLEEP
+        DeepSleepResumeStop();
+#endif  // USE_DEEPSLEEP
         if (Wifi.retry > (Wifi.retry_init / 2)) {
           Wifi.retry = Wifi.retry_init / 2;
         }
@@ -454,6 +488,9 @@ void WifiCheckIp(void)
         if (!Wifi.retry || ((Wifi.retry_init / 2) == Wifi.retry)) {
           AddLog_P(LOG_LEVEL_INFO, S_LOG_WIFI, PSTR(D_CONNECT_FAILED_AP_TIMEOUT));
           Settings.wifi_channel = 0;  // Disable stored AP
+#ifdef USE_DEEPSLEEP
+          DeepSleepResumeStop();
+#endif  // USE_DEEPSLEEP
         } else {
           if (!strlen(SettingsText(SET_STASSID1)) && !strlen(SettingsText(SET_STASSID2))) {
             Settings.wifi_channel = 0;  // Disable stored AP
@@ -465,9 +502,24 @@ void WifiCheckIp(void)
         }
     }
     if (Wifi.retry) {
+      if ((WIFI_CONNECT_DIRECT == Wifi.connect_mode) && !Settings.wifi_channel) {
+        Wifi.connect_mode = WIFI_CONNECT_SSID;
+        Wifi.retry = Wifi.retry_init;         // Stored AP failed so start over with scan or SSID
+      }
+#ifdef USE_DEEPSLEEP
+      if (DeepSleepResume()) {
+        if (Wifi.retry_init == Wifi.retry) {
+          WifiBegin(3, RtcSettings.wifi_channel);  // Select AP used before deepsleep
+        }
+      } else
+#endif  // USE_DEEPSLEEP
       if (Settings.flag3.use_wifi_scan) {  // SetOption56 - Scan wifi network at restart for configured AP's
         if (Wifi.retry_init == Wifi.retry) {
-          Wifi.scan_state = 1;    // Select scanned SSID
+          if (Settings.wifi_channel) {
+            WifiBegin(3, Settings.wifi_channel);  // Try AP of last connect before scanning
+          } else {
+            Wifi.scan_state = 1;  // Select scanned SSID
+          }
         }
       } else {
         if (Wifi.retry_init == Wifi.retry) {
@@ -650,6 +702,38 @@ RF_PRE_INIT()
 }
 #endif  // WIFI_RF_PRE_INIT
 
+#ifdef ESP8266
+WiFiEventHandler wifi_connected_handler;
+WiFiEventHandler wifi_got_ip_handler;
+#endif  // ESP8266
+
+void WifiConnectTimes(void)
+{
+  // Record connect phase durations from the SDK events
+#ifdef ESP8266
+  wifi_connected_handler = WiFi.onStationModeConnected([](const WiFiEventStationModeConnected& event) {
+    Wifi.associate_time = millis() - Wifi.connect_start;
+  });
+  wifi_got_ip_handler = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP& event) {
+    Wifi.ip_time = millis() - Wifi.connect_start - Wifi.associate_time;
+  });
+#else  // ESP32
+  WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info) {
+    Wifi.associate_time = millis() - Wifi.connect_start;
+  }, SYSTEM_EVENT_STA_CONNECTED);
+  WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info) {
+    Wifi.ip_time = millis() - Wifi.connect_start - Wifi.associate_time;
+  }, SYSTEM_EVENT_STA_GOT_IP);
+#endif  // ESP8266 - ESP32
+}
+
+void WifiShowConnectTimes(void)
+{
+  char stemp[8];
+  ResponseAppend_P(PSTR(",\"Connect\":{\"Mode\":\"%s\",\"Scan\":%d,\"Associate\":%d,\"IP\":%d}"),
+    GetTextIndexed(stemp, sizeof(stemp), Wifi.connect_mode, kWifiConnectModes), Wifi.scan_time, Wifi.associate_time, Wifi.ip_time);
+}
+
 void WifiConnect(void)
 {
   WifiSetState(0);
@@ -661,6 +745,12 @@ void WifiConnect(void)
   Wifi.counter = 1;
 
   memcpy((void*) &Wifi.bssid, (void*) Settings.wifi_bssid, sizeof(Wifi.bssid));
+  WifiConnectTimes();
+#ifdef USE_DEEPSLEEP
+  if (DeepSleepResume()) {
+    memcpy((void*) &Wifi.bssid, (void*) RtcSettings.wifi_bssid, sizeof(Wifi.bssid));
+  }
+#endif  // USE_DEEPSLEEP
 
 #ifdef WIFI_RF_PRE_INIT
   if (rf_pre_init_flag) {
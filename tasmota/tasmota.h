@@ -42,6 +42,8 @@
 \*********************************************************************************************/
 
 typedef unsigned long power_t;              // Power (Relay) type
+typedef void (*TimerCallback)(uint32_t arg);  // Timer wheel callback
+typedef bool (*UdpHandler)(char *data, uint32_t len);  // UDP packet handler
 const uint32_t POWER_MASK = 0xffffffffUL;   // Power (Relay) full mask
 
 /*********************************************************************************************\
@@ -67,6 +69,13 @@ const uint8_t MAX_XDSP_DRIVERS = 32;        // Max number of allowed display dri
 const uint8_t MAX_XDRV_DRIVERS = 96;        // Max number of allowed driver drivers
 const uint8_t MAX_XSNS_DRIVERS = 96;        // Max number of allowed sensor drivers
 const uint8_t MAX_I2C_DRIVERS = 96;         // Max number of allowed i2c drivers
+#ifdef ESP32
+const uint8_t MAX_I2C = 2;                  // Max number of I2C buses (Wire and Wire1)
+const uint8_t MAX_SR04 = 4;                 // Max number of SR04 ultrasonic sensors
+#else
+const uint8_t MAX_I2C = 1;                  // Max number of I2C buses
+const uint8_t MAX_SR04 = 1;                 // Max number of SR04 ultrasonic sensors
+#endif  // ESP32
 const uint8_t MAX_SHUTTERS = 4;             // Max number of shutters
 const uint8_t MAX_PCF8574 = 4;              // Max number of PCF8574 devices
 const uint8_t MAX_RULE_SETS = 3;            // Max number of rule sets of size 512 characters
@@ -129,11 +138,16 @@ const uint16_t FLOATSZ = 16;                // Max number of characters in float
 const uint16_t CMDSZ = 24;                  // Max number of characters in command
 const uint16_t TOPSZ = 151;                 // Max number of characters in topic string
 const uint16_t LOGSZ = 700;                 // Max number of characters in log
+const uint16_t LOG_DEFER_SIZE = 2048;       // Number of bytes queued for deferred log sinks (power of 2)
+const uint8_t LOG_DEFER_BUDGET = 2;         // Max number of mSeconds per loop spent on deferred log sinks
 const uint16_t MIN_MESSZ = 1040;            // Min number of characters in MQTT message (1200 - TOPSZ - 9 header bytes)
 
 const uint8_t SENSOR_MAX_MISS = 5;          // Max number of missed sensor reads before deciding it's offline
 
 const uint8_t MAX_BACKLOG = 30;             // Max number of commands in backlog
+const uint16_t BACKLOG_SIZE = 2048;         // Number of bytes in backlog ring buffer for normal commands
+const uint16_t BACKLOG_PRIORITY_SIZE = 256; // Number of bytes in backlog ring buffer for button, switch and device group commands
+const uint8_t COMMAND_CACHE_SIZE = 32;      // Number of cached command to driver resolutions (power of 2)
 const uint32_t MIN_BACKLOG_DELAY = 200;     // Minimal backlog delay in mSeconds
 
 const uint32_t SOFT_BAUDRATE = 9600;        // Default software serial baudrate
@@ -267,7 +281,7 @@ enum XsnsFunctions {FUNC_SETTINGS_OVERRIDE, FUNC_PIN_STATE, FUNC_MODULE_INIT, FU
                     FUNC_ENERGY_EVERY_SECOND, FUNC_ENERGY_RESET,
                     FUNC_RULES_PROCESS, FUNC_SERIAL, FUNC_FREE_MEM, FUNC_BUTTON_PRESSED,
                     FUNC_WEB_ADD_BUTTON, FUNC_WEB_ADD_MAIN_BUTTON, FUNC_WEB_ADD_HANDLER, FUNC_SET_CHANNELS, FUNC_SET_SCHEME, FUNC_HOTPLUG_SCAN,
-                    FUNC_DEVICE_GROUP_ITEM };
+                    FUNC_DEVICE_GROUP_ITEM, FUNC_SENSOR_START, FUNC_SENSOR_READ };
 
 enum AddressConfigSteps { ADDR_IDLE, ADDR_RECEIVE, ADDR_SEND };
 
@@ -293,6 +307,7 @@ enum SettingsTextIndex { SET_OTAURL,
                          SET_TEMPLATE_NAME,
                          SET_DEV_GROUP_NAME1, SET_DEV_GROUP_NAME2, SET_DEV_GROUP_NAME3, SET_DEV_GROUP_NAME4,
                          SET_DEVICENAME,
+                         SET_DISPLAY_KEYS,
                          SET_MAX };
 
 enum DevGroupMessageType { DGR_MSGTYP_FULL_STATUS, DGR_MSGTYP_PARTIAL_UPDATE, DGR_MSGTYP_UPDATE, DGR_MSGTYP_UPDATE_MORE_TO_COME, DGR_MSGTYP_UPDATE_DIRECT, DGR_MSGTYPE_UPDATE_COMMAND };
@@ -318,9 +333,29 @@ enum DevGroupItem { DGR_ITEM_EOL, DGR_ITEM_STATUS, DGR_ITEM_FLAGS,
 enum DevGroupShareItem { DGR_SHARE_POWER = 1, DGR_SHARE_LIGHT_BRI = 2, DGR_SHARE_LIGHT_FADE = 4, DGR_SHARE_LIGHT_SCHEME = 8,
                          DGR_SHARE_LIGHT_COLOR = 16, DGR_SHARE_DIMMER_SETTINGS = 32, DGR_SHARE_EVENT = 64 };
 
+enum MetricFlags { METRIC_RESOLUTION = 0x0F,  // Decimals of METRIC_FLOAT value
+                   METRIC_FLOAT = 0x00, METRIC_UINT32 = 0x10, METRIC_INT32 = 0x20, METRIC_UINT16 = 0x30, METRIC_UINT8 = 0x40, METRIC_FORMAT = 0x70,
+                   METRIC_GAUGE = 0x00, METRIC_COUNTER = 0x80 };
+
+enum TraceEvents { TRACE_DRIVER, TRACE_SENSOR, TRACE_MQTT_PUBLISH, TRACE_LOG, TRACE_SETTINGS_SAVE, TRACE_WIFI_STATE, TRACE_MQTT_STATE,
+                   TRACE_FLASH_ERASE, TRACE_FLASH_WRITE, TRACE_EVENTS };
+
+enum TracePhases { TRACE_INSTANT, TRACE_BEGIN, TRACE_END };
+
+enum WebStatEndpoints { WEB_STAT_OTHER, WEB_STAT_ROOT, WEB_STAT_REFRESH, WEB_STAT_CONSOLE, WEB_STAT_CONSOLE_REFRESH, WEB_STAT_COMMAND,
+                        WEB_STAT_METRICS, WEB_STAT_HUE, WEB_STAT_ENDPOINTS, WEB_STAT_NONE = 0xFF };
+
+enum FlashWearAreas { WEAR_SETTINGS, WEAR_ZIGBEE, WEAR_FLOG, WEAR_ENERGY, WEAR_SCRIPT, WEAR_AREAS };
+
 enum CommandSource { SRC_IGNORE, SRC_MQTT, SRC_RESTART, SRC_BUTTON, SRC_SWITCH, SRC_BACKLOG, SRC_SERIAL, SRC_WEBGUI, SRC_WEBCOMMAND, SRC_WEBCONSOLE, SRC_PULSETIMER,
                      SRC_TIMER, SRC_RULE, SRC_MAXPOWER, SRC_MAXENERGY, SRC_OVERTEMP, SRC_LIGHT, SRC_KNX, SRC_DISPLAY, SRC_WEMO, SRC_HUE, SRC_RETRY, SRC_REMOTE, SRC_SHUTTER,
                      SRC_THERMOSTAT, SRC_MAX };
+enum BacklogLanes { BACKLOG_PRIORITY, BACKLOG_NORMAL, BACKLOG_LANES };
+
+enum HeapTags { HEAP_TAG_ZIGBEE, HEAP_TAG_RULES, HEAP_TAG_WEB, HEAP_TAG_SCRIPT, HEAP_TAG_MAX };
+
+const char kHeapTags[] PROGMEM = "Zigbee|Rules|Web|Script";
+
 const char kCommandSource[] PROGMEM = "I|MQTT|Restart|Button|Switch|Backlog|Serial|WebGui|WebCommand|WebConsole|PulseTimer|"
                                       "Timer|Rule|MaxPower|MaxEnergy|Overtemp|Light|Knx|Display|Wemo|Hue|Retry|Remote|Shutter|Thermostat";
 
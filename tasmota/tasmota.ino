@@ -55,6 +55,7 @@
 #include <ESP8266httpUpdate.h>              // Ota
 #include <StreamString.h>                   // Webserver, Updater
 #include <ArduinoJson.h>                    // WemoHue, IRremote, Domoticz
+#include <TasmotaSerial.h>                  // Serial drivers, Status 4 overflow statistics
 #ifdef USE_ARDUINO_OTA
   #include <ArduinoOTA.h>                   // Arduino OTA
   #ifndef USE_DISCOVERY
@@ -118,6 +119,9 @@ uint16_t tele_period = 9999;                // Tele period timer
 uint16_t blink_counter = 0;                 // Number of blink cycles
 uint16_t seriallog_timer = 0;               // Timer to disable Seriallog
 uint16_t syslog_timer = 0;                  // Timer to re-enable syslog_level
+uint16_t web_log_head = 0;                  // Offset of oldest entry in Web log buffer
+uint16_t web_log_tail = 0;                  // Offset of next entry in Web log buffer
+uint16_t web_log_size = 0;                  // Size of Web log buffer
 
 #ifdef ESP32
 uint16_t gpio_pin[MAX_GPIO_PIN] = { 0 };    // GPIO functions indexed by pin number
@@ -153,13 +157,14 @@ uint8_t syslog_level;                       // Current copy of Settings.syslog_l
 uint8_t my_module_type;                     // Current copy of Settings.module or user template type
 uint8_t my_adc0 = 0;                        // Active copy of Module ADC0
 uint8_t last_source = 0;                    // Last command source
+uint8_t command_source = SRC_IGNORE;        // Source of command being executed
 uint8_t shutters_present = 0;               // Number of actual define shutters
 uint8_t prepped_loglevel = 0;               // Delayed log level message
+uint8_t web_log_count = 0;                  // Number of entries in Web log buffer
 //uint8_t mdns_delayed_start = 0;             // mDNS delayed start
 bool serial_local = false;                  // Handle serial locally
 bool serial_buffer_overrun = false;         // Serial buffer overrun
 bool fallback_topic_flag = false;           // Use Topic or FallbackTopic
-bool backlog_mutex = false;                 // Command backlog pending
 bool interlock_mutex = false;               // Interlock power command pending
 bool stop_flash_rotate = false;             // Allow flash configuration rotation
 bool blinkstate = false;                    // LED state
@@ -182,17 +187,33 @@ char mqtt_topic[TOPSZ];                     // Composed MQTT topic
 char serial_in_buffer[INPUT_BUFFER_SIZE];   // Receive buffer
 char mqtt_data[MESSZ];                      // MQTT publish buffer and web page ajax buffer
 char log_data[LOGSZ];                       // Logging
-char web_log[WEB_LOG_SIZE] = {'\0'};        // Web log buffer
-#ifdef SUPPORT_IF_STATEMENT
-  #include <LinkedList.h>
-  LinkedList<String> backlog;               // Command backlog implemented with LinkedList
-  #define BACKLOG_EMPTY (backlog.size() == 0)
-#else
-  uint8_t backlog_index = 0;                // Command backlog index
-  uint8_t backlog_pointer = 0;              // Command backlog pointer
-  String backlog[MAX_BACKLOG];              // Command backlog buffer
-  #define BACKLOG_EMPTY (backlog_pointer == backlog_index)
-#endif
+char *web_log = nullptr;                    // Web log buffer
+char backlog_buffer[BACKLOG_PRIORITY_SIZE + BACKLOG_SIZE];  // Command backlog ring buffers
+
+struct BACKLOG_LANE {
+  char *buffer;                             // Ring buffer of [source][length lo][length hi][command] entries
+  uint16_t size;                            // Ring buffer size
+  uint16_t head;                            // Offset of oldest entry
+  uint16_t used;                            // Number of bytes in use
+  uint8_t count;                            // Number of entries
+};
+
+struct BACKLOG {
+  BACKLOG_LANE lane[BACKLOG_LANES] = {
+    { backlog_buffer, BACKLOG_PRIORITY_SIZE, 0, 0, 0 },
+    { backlog_buffer + BACKLOG_PRIORITY_SIZE, BACKLOG_SIZE, 0, 0, 0 } };
+  uint8_t source = SRC_IGNORE;              // Source of the entry being executed
+} Backlog;
+#define BACKLOG_EMPTY (!Backlog.lane[BACKLOG_PRIORITY].count && !Backlog.lane[BACKLOG_NORMAL].count)
+
+struct BOOT_TIME {                          // mSeconds since restart or 0 if stage not reached
+  uint32_t settings;                        // Settings loaded
+  uint32_t power;                           // Power state restored
+  uint32_t setup;                           // End of setup()
+  uint32_t sensors;                         // All sensors initialized
+  uint32_t wifi;                            // Wifi connected
+  uint32_t mqtt;                            // Mqtt connected
+} BootTime;
 
 /*********************************************************************************************\
  * Main
@@ -227,6 +248,7 @@ void setup(void) {
 
   SettingsLoad();
   SettingsDelta();
+  BootTime.settings = millis();
 
   OsWatchInit();
 
@@ -306,6 +328,7 @@ void setup(void) {
   WifiConnect();
 
   SetPowerOnState();
+  BootTime.power = millis();
 
   AddLog_P2(LOG_LEVEL_INFO, PSTR(D_PROJECT " %s %s " D_VERSION " %s%s-" ARDUINO_CORE_RELEASE), PROJECT, SettingsText(SET_DEVICENAME), my_version, my_image);
 #ifdef FIRMWARE_MINIMAL
@@ -320,35 +343,83 @@ void setup(void) {
   ArduinoOTAInit();
 #endif  // USE_ARDUINO_OTA
 
+#ifdef USE_TIMER_WHEEL
+  TimerSchedule(LoopEvery50mSeconds, 0, 50, 50);
+  TimerSchedule(LoopEvery100mSeconds, 0, 100, 100);
+  TimerSchedule(LoopEvery250mSeconds, 0, 250, 250);
+  TimerSchedule(LoopEverySecond, 0, 1000, 1000);
+#endif  // USE_TIMER_WHEEL
+
   XdrvCall(FUNC_INIT);
+#ifndef USE_STAGED_BOOT
   XsnsCall(FUNC_INIT);
+#endif  // USE_STAGED_BOOT
+  BootTime.setup = millis();
 }
 
 void BacklogLoop(void) {
   if (TimeReached(backlog_delay)) {
-    if (!BACKLOG_EMPTY && !backlog_mutex) {
-#ifdef SUPPORT_IF_STATEMENT
-      backlog_mutex = true;
-      String cmd = backlog.shift();
-      backlog_mutex = false;
-      ExecuteCommand((char*)cmd.c_str(), SRC_BACKLOG);
-#else
-      backlog_mutex = true;
-      ExecuteCommand((char*)backlog[backlog_pointer].c_str(), SRC_BACKLOG);
-      backlog_pointer++;
-      if (backlog_pointer >= MAX_BACKLOG) { backlog_pointer = 0; }
-      backlog_mutex = false;
-#endif
+    uint32_t lane = BacklogNext();
+    if (lane < BACKLOG_LANES) {
+      char command[BacklogLength(lane) +1];
+      uint8_t source = Backlog.source;
+      Backlog.source = BacklogShift(lane, command);
+      ExecuteCommand(command, SRC_BACKLOG);
+      Backlog.source = source;
     }
   }
 }
 
+void LoopEvery50mSeconds(uint32_t arg) {
+  XdrvCall(FUNC_EVERY_50_MSECOND);
+  XsnsCall(FUNC_EVERY_50_MSECOND);
+  XsnsScheduleLoop();
+}
+
+void LoopEvery100mSeconds(uint32_t arg) {
+  Every100mSeconds();
+  XdrvCall(FUNC_EVERY_100_MSECOND);
+  XsnsCall(FUNC_EVERY_100_MSECOND);
+}
+
+void LoopEvery250mSeconds(uint32_t arg) {
+  Every250mSeconds();
+  XdrvCall(FUNC_EVERY_250_MSECOND);
+  XsnsCall(FUNC_EVERY_250_MSECOND);
+}
+
+void LoopEverySecond(uint32_t arg) {
+  PerformEverySecond();
+  XdrvCall(FUNC_EVERY_SECOND);
+  XsnsCall(FUNC_EVERY_SECOND);
+  SensorSnapshotInvalidate();
+}
+
 void SleepDelay(uint32_t mseconds) {
+#ifdef USE_TIMER_WHEEL
+  mseconds = TimerWheelSleep(mseconds);  // Wake up at next timer deadline
+#endif  // USE_TIMER_WHEEL
   if (mseconds) {
-    for (uint32_t wait = 0; wait < mseconds; wait++) {
+    uint32_t wait;
+    for (wait = 0; wait < mseconds; wait++) {
       delay(1);
       if (Serial.available()) { break; }  // We need to service serial buffer ASAP as otherwise we get uart buffer overrun
+#ifdef USE_INPUT_INTERRUPT
+      if (InputIrqPending()) { break; }   // Act on switch and button edges ASAP
+#endif  // USE_INPUT_INTERRUPT
+#ifdef USE_FAST_POWER
+      if (FastPowerPending()) { break; }  // Publish state of relays switched ahead
+#endif  // USE_FAST_POWER
+#if defined(USE_LIGHT) && defined(ROTARY_V1)
+      if (RotaryPending()) { break; }     // Follow the rotary without waiting for the loop sleep
+#endif  // USE_LIGHT && ROTARY_V1
+#ifdef USE_PWM_DIMMER
+      if (PWMDimmerRampPending()) { break; }  // Keep hold to dim at the ramp update rate
+#endif  // USE_PWM_DIMMER
     }
+#ifdef USE_ADAPTIVE_SLEEP
+    if (wait < mseconds) { SleepEvent(); }  // Woken up early so stay responsive for a while
+#endif  // USE_ADAPTIVE_SLEEP
   } else {
     delay(0);
   }
@@ -356,12 +427,18 @@ void SleepDelay(uint32_t mseconds) {
 
 void loop(void) {
   uint32_t my_sleep = millis();
+#if defined(USE_PROFILER) || defined(USE_LOOP_STATS) || defined(USE_ADAPTIVE_SLEEP)
+  uint32_t profile_loop_start = micros();
+#endif  // USE_PROFILER || USE_LOOP_STATS || USE_ADAPTIVE_SLEEP
 
   XdrvCall(FUNC_LOOP);
   XsnsCall(FUNC_LOOP);
 
   OsWatchLoop();
 
+#ifdef USE_FAST_POWER
+  FastPowerLoop();                               // Deferred side effects of relays switched by the last loop
+#endif  // USE_FAST_POWER
   ButtonLoop();
   SwitchLoop();
 #ifdef ROTARY_V1
@@ -371,39 +448,52 @@ void loop(void) {
   DeviceGroupsLoop();
 #endif  // USE_DEVICE_GROUPS
   BacklogLoop();
+  if (!BootTime.mqtt) { BootLoop(); }
 
+#ifdef USE_TIMER_WHEEL
+  TimerWheelLoop();
+#else
   if (TimeReached(state_50msecond)) {
     SetNextTimeInterval(state_50msecond, 50);
-    XdrvCall(FUNC_EVERY_50_MSECOND);
-    XsnsCall(FUNC_EVERY_50_MSECOND);
+    LoopEvery50mSeconds(0);
   }
   if (TimeReached(state_100msecond)) {
     SetNextTimeInterval(state_100msecond, 100);
-    Every100mSeconds();
-    XdrvCall(FUNC_EVERY_100_MSECOND);
-    XsnsCall(FUNC_EVERY_100_MSECOND);
+    LoopEvery100mSeconds(0);
   }
   if (TimeReached(state_250msecond)) {
     SetNextTimeInterval(state_250msecond, 250);
-    Every250mSeconds();
-    XdrvCall(FUNC_EVERY_250_MSECOND);
-    XsnsCall(FUNC_EVERY_250_MSECOND);
+    LoopEvery250mSeconds(0);
   }
   if (TimeReached(state_second)) {
     SetNextTimeInterval(state_second, 1000);
-    PerformEverySecond();
-    XdrvCall(FUNC_EVERY_SECOND);
-    XsnsCall(FUNC_EVERY_SECOND);
+    LoopEverySecond(0);
   }
+#endif  // USE_TIMER_WHEEL
 
   if (!serial_local) { SerialInput(); }
 
+#ifdef USE_DEFERRED_LOG
+  LogDeferLoop();
+#endif  // USE_DEFERRED_LOG
+#ifdef USE_SYSLOG_TCP
+  SyslogTcpLoop();
+#endif  // USE_SYSLOG_TCP
+
 #ifdef USE_ARDUINO_OTA
   ArduinoOtaLoop();
 #endif  // USE_ARDUINO_OTA
 
   uint32_t my_activity = millis() - my_sleep;
 
+#if defined(USE_PROFILER) || defined(USE_LOOP_STATS) || defined(USE_ADAPTIVE_SLEEP)
+  uint32_t profile_sleep_start = micros();
+#endif  // USE_PROFILER || USE_LOOP_STATS || USE_ADAPTIVE_SLEEP
+#ifdef USE_ADAPTIVE_SLEEP
+  if (Settings.flag4.sleep_adaptive) {             // SetOption98 - Enable adaptive sleep
+    SleepDelay(SleepAdaptive(ssleep));
+  } else
+#endif  // USE_ADAPTIVE_SLEEP
   if (Settings.flag3.sleep_normal) {               // SetOption60 - Enable normal sleep instead of dynamic sleep
     //  yield();                                   // yield == delay(0), delay contains yield, auto yield in loop
     SleepDelay(ssleep);                            // https://github.com/esp8266/Arduino/issues/2021
@@ -416,6 +506,15 @@ void loop(void) {
       }
     }
   }
+#ifdef USE_PROFILER
+  ProfileLoop(profile_sleep_start - profile_loop_start, micros() - profile_sleep_start);
+#endif  // USE_PROFILER
+#ifdef USE_LOOP_STATS
+  LoopStatsLoop(profile_sleep_start - profile_loop_start);
+#endif  // USE_LOOP_STATS
+#ifdef USE_ADAPTIVE_SLEEP
+  SleepAccount(profile_sleep_start - profile_loop_start, micros() - profile_sleep_start);
+#endif  // USE_ADAPTIVE_SLEEP
 
   if (!my_activity) { my_activity++; }             // We cannot divide by 0
   uint32_t loop_delay = ssleep;
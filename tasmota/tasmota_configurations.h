@@ -517,6 +517,20 @@
 #undef USE_DEBUG_DRIVER                          // Disable debug code
 #endif  // FIRMWARE_LITE
 
+/*********************************************************************************************\
+ * [tasmota-bench.bin]
+ * Provide the default image with the load benchmark to compare releases on identical hardware
+\*********************************************************************************************/
+
+#ifdef FIRMWARE_BENCH
+
+#undef CODE_IMAGE_STR
+#define CODE_IMAGE_STR "bench"
+
+#define USE_BENCH                                // Enable command BenchLoad running a standard load (+2k code)
+#define USE_LOOP_STATS                           // Enable loop time percentiles reported by BenchLoad (+1k code, +1k mem)
+#endif  // FIRMWARE_BENCH
+
 /*********************************************************************************************\
  * [tasmota-minimal.bin]
  * Provide the smallest image possible while still enabling a webserver for intermediate image load
@@ -533,6 +547,7 @@
 #undef FIRMWARE_DISPLAYS                        // Disable tasmota-display with display drivers enabled
 #undef FIRMWARE_IR                              // Disable tasmota-ir with IR full protocols activated
 #undef FIRMWARE_IR_CUSTOM                       // Disable tasmota customizable with special marker to add all IR protocols
+#undef FIRMWARE_BENCH                           // Disable tasmota-bench with the load benchmark
 
 #undef USE_ARDUINO_OTA                           // Disable support for Arduino OTA
 #undef USE_DOMOTICZ                              // Disable Domoticz
@@ -611,6 +626,7 @@
 #undef USE_OPENTHERM                             // Disable support for OpenTherm (+15k code)
 
 #undef USE_ENERGY_SENSOR                         // Disable energy sensors
+#undef USE_ENERGY_JOURNAL                        // Disable energy and counter journal
 #undef USE_PZEM004T                              // Disable PZEM004T energy sensor
 #undef USE_PZEM_AC                               // Disable PZEM014,016 Energy monitor
 #undef USE_PZEM_DC                               // Disable PZEM003,017 Energy monitor
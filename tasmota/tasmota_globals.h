@@ -58,6 +58,10 @@ extern "C" void resetPins();
 #endif
 #ifdef USE_EMULATION_WEMO
 #define USE_EMULATION
+#endif
+
+#if defined(USE_RULES_COMPRESSION) || defined(USE_SCRIPT_COMPRESSION) || defined(USE_MQTT_COMPRESSION) || defined(USE_WEB_LOG_COMPRESSION)
+#define USE_UNISHOX_COMPRESSION
 #endif
                                                // See https://github.com/esp8266/Arduino/pull/4889
 #undef NO_EXTRA_4K_HEAP                        // Allocate 4k heap for WPS in ESP8166/Arduino core v2.4.2 (was always allocated in previous versions)
@@ -87,6 +91,12 @@ extern "C" void resetPins();
 #else
   const uint16_t WEB_LOG_SIZE = 4000;          // Max number of characters in weblog
 #endif
+const uint16_t WEB_LOG_SIZE_PSRAM = 32000;     // Max number of characters in weblog when PSRAM is present
+#ifdef ESP8266
+const uint8_t WEB_LOG_KB_MAX = 8;              // Max weblog size in kB set by command WebLogSize
+#else
+const uint8_t WEB_LOG_KB_MAX = 63;             // Max weblog size in kB as offsets are 16 bits
+#endif
 
 #if defined(USE_MQTT_TLS) && defined(ARDUINO_ESP8266_RELEASE_2_3_0)
   #error "TLS is no more supported on Core 2.3.0, use 2.4.2 or higher."
@@ -104,6 +114,9 @@ extern "C" void resetPins();
 #ifndef MQTT_CLEAN_SESSION
 #define MQTT_CLEAN_SESSION          1          // 0 = No clean session, 1 = Clean session (default)
 #endif
+#ifndef NET_TASK_CORE
+#define NET_TASK_CORE               0          // ESP32 core of the network task while loop() runs on ARDUINO_RUNNING_CORE
+#endif
 
 #ifndef MESSZ
 //#define MESSZ                       1040     // Max number of characters in JSON message string (Hass discovery and nice MQTT_MAX_PACKET_SIZE = 1200)
@@ -358,6 +371,41 @@ uint8_t device_group_count = 1;
 #else
 #define DEBUG_TRACE_LOG(...)
 #endif
+#ifdef USE_TRACE
+#define TRACE_EVENT(event, phase, arg) TraceAdd(event, phase, arg)
+#else
+#define TRACE_EVENT(event, phase, arg)
+#endif
+#ifdef USE_WEB_STATS
+#define WEB_STAT(endpoint) WebStatsEndpoint(endpoint)
+#else
+#define WEB_STAT(endpoint)
+#endif
+#ifdef USE_FLASH_WEAR
+#define FLASH_WEAR(area, sectors, bytes) FlashWearAdd(area, sectors, bytes)
+#define FLASH_WEAR_LEVELED(area, bytes) FlashWearLeveled(area, bytes)
+#else
+#define FLASH_WEAR(area, sectors, bytes)
+#define FLASH_WEAR_LEVELED(area, bytes)
+#endif
+
+void* PsramMalloc(size_t size);
+void* PsramCalloc(size_t count, size_t size);
+#ifdef USE_HEAP_TAGS
+void* HeapMalloc(uint32_t tag, size_t size);
+void* HeapCalloc(uint32_t tag, size_t count, size_t size);
+void* HeapCallocLarge(uint32_t tag, size_t count, size_t size);
+void HeapFree(void* pointer);
+struct HeapNewTag { uint32_t tag; };
+inline void* operator new(size_t size, HeapNewTag heap) noexcept { return HeapMalloc(heap.tag, size); }
+#define HEAP_NEW(TAG) new (HeapNewTag{TAG})   // Objects that are never deleted
+#else
+#define HeapMalloc(TAG, SIZE) malloc(SIZE)
+#define HeapCalloc(TAG, COUNT, SIZE) calloc(COUNT, SIZE)
+#define HeapCallocLarge(TAG, COUNT, SIZE) PsramCalloc(COUNT, SIZE)
+#define HeapFree(POINTER) free(POINTER)
+#define HEAP_NEW(TAG) new
+#endif  // USE_HEAP_TAGS
 
 /*********************************************************************************************/
 
@@ -233,6 +233,10 @@ enum UserSelectablePins {
   GPIO_BOILER_OT_RX,   // OpenTherm Boiler RX pin
   GPIO_BOILER_OT_TX,   // OpenTherm Boiler TX pin
   GPIO_WINDMETER_SPEED,  // WindMeter speed counter pin
+  GPIO_ADS1115_RDY,    // ADS1115 ALERT/RDY conversion ready
+  GPIO_APDS9960_INT,   // APDS9960 gesture interrupt
+  GPIO_NRF24_IRQ,      // NRF24L01 IRQ packet received
+  GPIO_MCP230XX_INT,   // MCP23008/MCP23017 interrupt output
   GPIO_SENSOR_END };
 
 // Programmer selectable GPIO functionality
@@ -322,7 +326,11 @@ const char kSensorNames[] PROGMEM =
   D_SENSOR_ELECTRIQ_MOODL "|"
   D_SENSOR_AS3935 "|" D_SENSOR_PMS5003_TX "|"
   D_SENSOR_BOILER_OT_RX "|" D_SENSOR_BOILER_OT_TX "|"
-  D_SENSOR_WINDMETER_SPEED
+  D_SENSOR_WINDMETER_SPEED "|"
+  D_SENSOR_ADS1115_RDY "|"
+  D_SENSOR_APDS9960_INT "|"
+  D_SENSOR_NRF24_IRQ "|"
+  D_SENSOR_MCP230XX_INT
   ;
 
 const char kSensorNamesFixed[] PROGMEM =
@@ -517,6 +525,18 @@ const uint8_t kGpioNiceList[] PROGMEM = {
 #if defined(USE_I2C) && defined(USE_ADE7953)
   GPIO_ADE7953_IRQ,    // ADE7953 IRQ
 #endif
+#if defined(USE_I2C) && defined(USE_ADS1115)
+  GPIO_ADS1115_RDY,    // ADS1115 ALERT/RDY conversion ready
+#endif
+#if defined(USE_I2C) && defined(USE_APDS9960)
+  GPIO_APDS9960_INT,   // APDS9960 gesture interrupt
+#endif
+#if defined(USE_SPI) && defined(USE_NRF24) && defined(USE_MIBLE)
+  GPIO_NRF24_IRQ,      // NRF24L01 IRQ packet received
+#endif
+#if defined(USE_I2C) && defined(USE_MCP230xx)
+  GPIO_MCP230XX_INT,   // MCP23008/MCP23017 interrupt output
+#endif
 #ifdef USE_CSE7766
   GPIO_CSE7766_TX,     // CSE7766 Serial interface (S31 and Pow R2)
   GPIO_CSE7766_RX,     // CSE7766 Serial interface (S31 and Pow R2)
@@ -128,6 +128,10 @@ enum UserSelectablePins {
   GPIO_BOILER_OT_RX, GPIO_BOILER_OT_TX,  // OpenTherm Boiler TX pin
   GPIO_WINDMETER_SPEED,                // WindMeter speed counter pin
   GPIO_KEY1_TC,                       // Touch pin as button
+  GPIO_ADS1115_RDY,                    // ADS1115 ALERT/RDY conversion ready
+  GPIO_APDS9960_INT,                   // APDS9960 gesture interrupt
+  GPIO_NRF24_IRQ,                      // NRF24L01 IRQ packet received
+  GPIO_MCP230XX_INT,                   // MCP23008/MCP23017 interrupt output
   GPIO_SENSOR_END };
 
 enum ProgramSelectablePins {
@@ -216,7 +220,11 @@ const char kSensorNames[] PROGMEM =
   D_GPIO_WEBCAM_HSD "|"
   D_GPIO_WEBCAM_PSRCS "|"
   D_SENSOR_BOILER_OT_RX "|" D_SENSOR_BOILER_OT_TX "|"
-  D_SENSOR_WINDMETER_SPEED "|" D_SENSOR_BUTTON "_tc"
+  D_SENSOR_WINDMETER_SPEED "|" D_SENSOR_BUTTON "_tc" "|"
+  D_SENSOR_ADS1115_RDY "|"
+  D_SENSOR_APDS9960_INT "|"
+  D_SENSOR_NRF24_IRQ "|"
+  D_SENSOR_MCP230XX_INT
   ;
 
 const char kSensorNamesFixed[] PROGMEM =
@@ -224,6 +232,7 @@ const char kSensorNamesFixed[] PROGMEM =
 
 #define MAX_WEBCAM_DATA  8
 #define MAX_WEBCAM_HSD   3
+#define MAX_WS2812_STRIPS 4  // WS2812 strips on separate RMT channels
 
 const uint16_t kGpioNiceList[] PROGMEM = {
   GPIO_NONE,                            // Not used
@@ -250,8 +259,8 @@ const uint16_t kGpioNiceList[] PROGMEM = {
   AGPIO(GPIO_LEDLNK),                   // Link led
   AGPIO(GPIO_LEDLNK_INV),               // Inverted link led
 #ifdef USE_I2C
-  AGPIO(GPIO_I2C_SCL),                  // I2C SCL
-  AGPIO(GPIO_I2C_SDA),                  // I2C SDA
+  AGPIO(GPIO_I2C_SCL) + MAX_I2C,        // I2C SCL
+  AGPIO(GPIO_I2C_SDA) + MAX_I2C,        // I2C SDA
 #endif
 #ifdef USE_SPI
   AGPIO(GPIO_SPI_MISO),       // SPI MISO
@@ -287,7 +296,7 @@ const uint16_t kGpioNiceList[] PROGMEM = {
 // Light
 #ifdef USE_LIGHT
 #ifdef USE_WS2812
-  AGPIO(GPIO_WS2812),         // WS2812 Led string
+  AGPIO(GPIO_WS2812) + MAX_WS2812_STRIPS,  // WS2812 Led strings
 #endif
 #ifdef USE_ARILUX_RF
   AGPIO(GPIO_ARIRFRCV),       // AriLux RF Receive input
@@ -333,8 +342,8 @@ const uint16_t kGpioNiceList[] PROGMEM = {
   AGPIO(GPIO_RF_SENSOR),      // Rf receiver with sensor decoding
 #endif
 #ifdef USE_SR04
-  AGPIO(GPIO_SR04_TRIG),      // SR04 Tri/TXgger pin
-  AGPIO(GPIO_SR04_ECHO),      // SR04 Ech/RXo pin
+  AGPIO(GPIO_SR04_TRIG) + MAX_SR04,  // SR04 Tri/TXgger pin
+  AGPIO(GPIO_SR04_ECHO) + MAX_SR04,  // SR04 Ech/RXo pin
 #endif
 #ifdef USE_TM1638
   AGPIO(GPIO_TM16CLK),        // TM1638 Clock
@@ -358,6 +367,18 @@ const uint16_t kGpioNiceList[] PROGMEM = {
 #if defined(USE_I2C) && defined(USE_ADE7953)
   AGPIO(GPIO_ADE7953_IRQ),    // ADE7953 IRQ
 #endif
+#if defined(USE_I2C) && defined(USE_ADS1115)
+  AGPIO(GPIO_ADS1115_RDY),    // ADS1115 ALERT/RDY conversion ready
+#endif
+#if defined(USE_I2C) && defined(USE_APDS9960)
+  AGPIO(GPIO_APDS9960_INT),   // APDS9960 gesture interrupt
+#endif
+#if defined(USE_SPI) && defined(USE_NRF24) && defined(USE_MIBLE)
+  AGPIO(GPIO_NRF24_IRQ),      // NRF24L01 IRQ packet received
+#endif
+#if defined(USE_I2C) && defined(USE_MCP230xx)
+  AGPIO(GPIO_MCP230XX_INT),   // MCP23008/MCP23017 interrupt output
+#endif
 #ifdef USE_CSE7766
   AGPIO(GPIO_CSE7766_TX),     // CSE7766 Serial interface (S31 and Pow R2)
   AGPIO(GPIO_CSE7766_RX),     // CSE7766 Serial interface (S31 and Pow R2)
@@ -31,11 +31,14 @@
 #define WIFI_SOFT_AP_CHANNEL                  1          // Soft Access Point Channel number between 1 and 11 as used by WifiManager web GUI
 #endif
 
-const uint16_t CHUNKED_BUFFER_SIZE = (MESSZ / 2) - 100;  // Chunk buffer size (should be smaller than half mqtt_data size = MESSZ)
+#ifndef WEB_CHUNK_SIZE
+#define WEB_CHUNK_SIZE                        1448       // Chunk buffer size allowing chunk header, data and footer in one TCP segment (MSS 1460)
+#endif
 
 const uint16_t HTTP_REFRESH_TIME = 2345;                 // milliseconds
 const uint16_t HTTP_RESTART_RECONNECT_TIME = 9000;       // milliseconds - Allow time for restart and wifi reconnect
 const uint16_t HTTP_OTA_RESTART_RECONNECT_TIME = 28000;  // milliseconds - Allow time for uploading binary, unzip/write to final destination and wifi reconnect
+const uint16_t HTTP_BULK_SIZE = 4096;                    // Max number of characters in a JSON array of commands
 
 #include <ESP8266WebServer.h>
 #include <DNSServer.h>
@@ -46,26 +49,39 @@ uint8_t *efm8bb1_update = nullptr;
 
 enum UploadTypes { UPL_TASMOTA, UPL_SETTINGS, UPL_EFM8BB1, UPL_TASMOTASLAVE };
 
-static const char * HEADER_KEYS[] = { "User-Agent", };
-
-const char HTTP_HEADER1[] PROGMEM =
-  "<!DOCTYPE html><html lang=\"" D_HTML_LANGUAGE "\" class=\"\">"
-  "<head>"
-  "<meta charset='utf-8'>"
-  "<meta name=\"viewport\" content=\"width=device-width,initial-scale=1,user-scalable=no\"/>"
-  "<title>%s - %s</title>"
-
-  "<script>"
-  "var x=null,lt,to,tp,pc='';"            // x=null allow for abortion
+static const char * HEADER_KEYS[] = { "User-Agent", "If-None-Match", };
 
+// Static script served gzip compressed by /s.js and cached by the browser using the CRC32 of the script as ETag.
+// Regenerate with gzip -9n after changing the script source shown in the comment.
 #ifdef USE_JAVASCRIPT_ES6
 // Following bytes saving ES6 syntax fails on old browsers like IE 11 - https://kangax.github.io/compat-table/es6/
+/*
   "eb=s=>document.getElementById(s);"     // Alias to save code space
   "qs=s=>document.querySelector(s);"      // Alias to save code space
   "sp=i=>eb(i).type=(eb(i).type==='text'?'password':'text');"  // Toggle password visibility
   "wl=f=>window.addEventListener('load',f);" // Execute multiple window.onload
-  ;
+*/
+#define HTTP_SCRIPT_COMMON_ETAG "5e562b80"
+const uint8_t HTTP_SCRIPT_COMMON_GZ[] PROGMEM = {
+  0x1F,0x8B,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0x6D,0x8E,0x41,0x8B,0xC2,0x30,
+  0x10,0x85,0xFF,0x8A,0x7B,0x31,0x09,0x96,0xB2,0x67,0xC3,0x54,0x14,0x3C,0x2C,0xEC,
+  0x6D,0x8F,0xD2,0x43,0xDA,0x4C,0x6D,0x24,0x26,0x35,0x99,0xDA,0x2D,0xD2,0xFF,0xBE,
+  0x69,0xBD,0xB8,0xE0,0x65,0x78,0xCC,0x7B,0xF3,0xBD,0xC1,0x0A,0x22,0x14,0xDA,0xD7,
+  0xFD,0x15,0x1D,0xE5,0x67,0xA4,0xA3,0xC5,0x59,0x1E,0xC6,0x2F,0xCD,0xA3,0x90,0xB7,
+  0xF8,0x2F,0x70,0xEB,0x31,0x8C,0x3F,0x68,0xB1,0x26,0x1F,0x66,0x3F,0x76,0x60,0xA0,
+  0xC0,0x8A,0x1B,0x91,0xD3,0xD8,0x21,0xF0,0x17,0x0D,0xC0,0x08,0x7F,0x89,0xED,0x58,
+  0xA7,0x62,0x1C,0x7C,0xD0,0x6C,0xFB,0xDC,0x08,0x39,0x58,0x68,0xA0,0x18,0x8C,0xD3,
+  0x7E,0xC8,0x95,0xD6,0xC7,0x7B,0xE2,0x7F,0x9B,0x48,0xE8,0x30,0x70,0x66,0xBD,0xD2,
+  0x2C,0x6B,0x84,0x6C,0x7A,0x57,0x93,0xF1,0x6E,0x75,0xD1,0x5C,0x3C,0xEE,0x2A,0xAC,
+  0x08,0x3E,0x33,0x03,0xEF,0x5F,0xDA,0x5B,0xCB,0x99,0x71,0x5D,0x4F,0x59,0xD5,0x13,
+  0x79,0x97,0xCD,0x75,0x2A,0xA0,0xCA,0xE2,0x12,0x99,0x9B,0x5B,0x63,0x91,0x9B,0xDC,
+  0xA2,0x3B,0x53,0x5B,0x00,0x89,0x87,0x69,0xB8,0x39,0x51,0x99,0x44,0x9A,0x27,0xE6,
+  0xD4,0x15,0x59,0x09,0xCB,0x2E,0x6F,0x55,0xDC,0x13,0x05,0x93,0x78,0x98,0xD8,0x9A,
+  0x89,0xF5,0x9A,0x7F,0xBC,0xB1,0x96,0x2B,0x21,0xC4,0xEE,0x09,0x49,0xC9,0x72,0xFB,
+  0xCA,0x93,0x13,0x6D,0x36,0x72,0x9A,0x06,0xCB,0x2F,0x5A,0xC8,0x3F,0x80,0x2B,0x56,
+  0x5E,0x7B,0x01,0x00,0x00 };
 #else
+/*
   "function eb(s){"
     "return document.getElementById(s);"  // Alias to save code space
   "}"
@@ -77,8 +93,51 @@ const char HTTP_HEADER1[] PROGMEM =
   "}"
   "function wl(f){"                       // Execute multiple window.onload
     "window.addEventListener('load',f);"
-  "}";
+  "}"
+*/
+#define HTTP_SCRIPT_COMMON_ETAG "0ff0f429"
+const uint8_t HTTP_SCRIPT_COMMON_GZ[] PROGMEM = {
+  0x1F,0x8B,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0x6D,0x8F,0xC1,0x6A,0xC3,0x30,
+  0x10,0x44,0x7F,0xC5,0xBD,0x44,0x12,0x31,0xA6,0xE7,0x18,0x35,0x24,0x90,0x43,0xA1,
+  0xB7,0x1E,0x83,0x0F,0x4A,0xB4,0x8E,0x37,0x28,0x92,0x23,0xAD,0xE2,0x1A,0xE3,0x7F,
+  0xAF,0xE2,0x50,0x70,0xC1,0x17,0x31,0xEC,0xCE,0xBC,0x59,0xD5,0xD1,0x9E,0x09,0x9D,
+  0xCD,0xE0,0xC4,0x83,0x18,0x3C,0x50,0xF4,0x36,0xD3,0xEE,0x1C,0x6F,0x60,0xA9,0xB8,
+  0x00,0x1D,0x0C,0x3C,0xE5,0xBE,0xFF,0xD4,0xC9,0x51,0x8E,0xF5,0x5F,0xE2,0x1E,0x96,
+  0x12,0xF7,0x08,0xBE,0xFF,0x06,0x03,0x67,0x72,0xFE,0x7F,0x20,0xB4,0x1C,0xC5,0x90,
+  0x8A,0x50,0x14,0xD4,0xB7,0x20,0xF9,0x4C,0x4B,0xC9,0x08,0x7E,0x88,0x6D,0x59,0xAB,
+  0x42,0xE8,0x9C,0xD7,0x6C,0xF3,0x9A,0xCC,0x11,0x9D,0xE1,0xB5,0x18,0x3A,0xB4,0xDA,
+  0x75,0x85,0xD2,0xFA,0xF0,0x48,0x9D,0x5F,0x18,0x08,0x2C,0x78,0xCE,0x8C,0x53,0x9A,
+  0xE5,0xF5,0x3C,0x71,0xD5,0x5C,0x0C,0x0F,0xE5,0x33,0x92,0xEF,0x39,0xCA,0xE5,0x3B,
+  0x77,0xC6,0x70,0x86,0xB6,0x8D,0x94,0x9F,0x22,0x91,0xB3,0xF9,0xB3,0x59,0x79,0x50,
+  0x79,0x98,0x2C,0xE9,0x88,0xAE,0x41,0x03,0x1C,0x0B,0x03,0xF6,0x42,0xCD,0x87,0x24,
+  0x31,0x60,0xCD,0xF1,0x48,0x55,0x12,0xE9,0x3D,0x32,0xAB,0x6E,0xC0,0x2A,0x39,0xCD,
+  0x8A,0x46,0x85,0x1D,0x91,0xC7,0xC4,0x83,0xC4,0xD6,0x4C,0xAC,0x56,0xFC,0x6D,0x61,
+  0x35,0xA5,0x84,0x10,0xDB,0x17,0x24,0x39,0xAB,0xCD,0x9C,0x57,0x8E,0xB4,0x5E,0x97,
+  0xE3,0x98,0xBE,0x7E,0xD5,0xA2,0xFC,0x05,0x29,0xF4,0xF0,0x0F,0xB1,0x01,0x00,0x00 };
 #endif
+/*
+  "function jd(){"                        // Add label name='' based on provided id=''
+    "var t=0,i=document.querySelectorAll('input,button,textarea,select');"
+    "while(i.length>=t){"
+      "if(i[t]){"
+        "i[t]['name']=(i[t].hasAttribute('id')&&(!i[t].hasAttribute('name')))?i[t]['id']:i[t]['name'];"
+      "}"
+      "t++;"
+    "}"
+  "}"
+  "wl(jd);"                               // Add name='' to any id='' in input,button,textarea,select
+*/
+
+const char HTTP_HEADER1[] PROGMEM =
+  "<!DOCTYPE html><html lang=\"" D_HTML_LANGUAGE "\" class=\"\">"
+  "<head>"
+  "<meta charset='utf-8'>"
+  "<meta name=\"viewport\" content=\"width=device-width,initial-scale=1,user-scalable=no\"/>"
+  "<title>%s - %s</title>"
+  "<script src='s.js?e=" HTTP_SCRIPT_COMMON_ETAG "'></script>"
+
+  "<script>"
+  "var x=null,lt,to,tp,pc='';";           // x=null allow for abortion
 
 const char HTTP_SCRIPT_COUNTER[] PROGMEM =
   "var cn=180;"                           // seconds
@@ -111,6 +170,9 @@ const char HTTP_SCRIPT_ROOT[] PROGMEM =
     "if (rfsh) {"
       "x.open('GET','.?m=1'+a,true);"       // ?m related to Webserver->hasArg("m")
       "x.send();"
+#ifdef USE_WEBSOCKET
+      "if(!wo)"                           // No polling while status is pushed
+#endif  // USE_WEBSOCKET
       "lt=setTimeout(la,%d);"               // Settings.web_refresh
     "}"
   "}"
@@ -148,6 +210,9 @@ const char HTTP_SCRIPT_ROOT[] PROGMEM =
     "};"
     "x.open('GET','.?m=1'+a,true);"       // ?m related to Webserver->hasArg("m")
     "x.send();"
+#ifdef USE_WEBSOCKET
+    "if(!wo)"                             // No polling while status is pushed
+#endif  // USE_WEBSOCKET
     "lt=setTimeout(la,%d);"               // Settings.web_refresh
   "}";
 #endif  // USE_SCRIPT_WEB_DISPLAY
@@ -162,12 +227,42 @@ const char HTTP_SCRIPT_ROOT_PART2[] PROGMEM =
     "}"
     "la('&'+v+i+'='+p);"
   "}"
+#ifdef USE_WEBSOCKET
+  "function lw(s){"                       // Pushed status section
+    "eb('l1').innerHTML=s.replace(/{t}/g,\"<table style='width:100%%'>\").replace(/{s}/g,\"<tr><th>\").replace(/{m}/g,\"</th><td>\").replace(/{e}/g,\"</td></tr>\").replace(/{c}/g,\"%%'><div style='text-align:center;font-weight:\");"
+  "}"
+  "wl(function(){ws('/?t=%08x',lw,la);});";  // Fall back to polling if the WebSocket fails
+#else
   "wl(la);";
+#endif  // USE_WEBSOCKET
+
+#ifdef USE_WEBSOCKET
+const char HTTP_SCRIPT_WEBSOCKET[] PROGMEM =
+  "var wo=0;"                             // Open WebSocket
+  "function ws(p,f,r){"                   // p = Path with token, f = Message handler, r = Polling fallback
+    "if(!window.WebSocket){r();return;}"
+    "var w=new WebSocket('ws://'+location.hostname+':%d'+p);"
+    "w.onopen=function(){wo=w;clearTimeout(lt);};"
+    "w.onmessage=function(e){f(e.data);};"
+    "w.onclose=function(){wo=0;r();};"
+  "}";
+#endif  // USE_WEBSOCKET
 
 const char HTTP_SCRIPT_WIFI[] PROGMEM =
   "function c(l){"
     "eb('s1').value=l.innerText||l.textContent;"
     "eb('p1').focus();"
+  "}"
+  "function ws(){"                        // Poll scan results, empty while scanning
+    "var x=new XMLHttpRequest();"
+    "x.onreadystatechange=function(){"
+      "if(x.readyState==4&&x.status==200){"
+        "if(x.responseText.length){eb('ws').innerHTML=x.responseText;}"
+        "else{setTimeout(ws,1000);}"
+      "}"
+    "};"
+    "x.open('GET','wi?ws=',true);"        // ?ws related to Webserver->hasArg("ws")
+    "x.send();"
   "}";
 
 const char HTTP_SCRIPT_RELOAD_TIME[] PROGMEM =
@@ -181,6 +276,15 @@ const char HTTP_SCRIPT_CONSOL[] PROGMEM =
     "t=eb('t1');"
     "if(p==1){"
       "c=eb('c1');"                       // Console command id
+#ifdef USE_WEBSOCKET
+      "if(wo){"                           // Send command over WebSocket
+        "wo.send(c.value);"
+        "c.value='';"
+        "t.scrollTop=99999;"
+        "sn=t.scrollTop;"
+        "return false;"
+      "}"
+#endif  // USE_WEBSOCKET
       "o='&c1='+encodeURIComponent(c.value);"
       "c.value='';"
       "t.scrollTop=99999;"
@@ -204,10 +308,22 @@ const char HTTP_SCRIPT_CONSOL[] PROGMEM =
       "x.open('GET','cs?c2='+id+o,true);"  // Related to Webserver->hasArg("c2") and WebGetArg("c2", stmp, sizeof(stmp))
       "x.send();"
     "}"
+#ifdef USE_WEBSOCKET
+    "if(!wo)"                             // No polling while log is pushed
+#endif  // USE_WEBSOCKET
     "lt=setTimeout(l,%d);"
     "return false;"
   "}"
+#ifdef USE_WEBSOCKET
+  "function lw(d){"                       // Pushed log lines
+    "var t=eb('t1'),b=(t.scrollTop>=sn);"
+    "t.value+=d;"
+    "if(b){t.scrollTop=99999;sn=t.scrollTop;}"  // Only follow if user did not scroll back
+  "}"
+  "wl(function(){ws('/cs?t=%08x',lw,l);});"  // Whole log is pushed on open, fall back to polling if the WebSocket fails
+#else
   "wl(l);"                                // Load initial console text
+#endif  // USE_WEBSOCKET
 
   // Console command history
   "var hc=[],cn=0;"                       // hc = History commands, cn = Number of history being shown
@@ -228,19 +344,21 @@ const char HTTP_MODULE_TEMPLATE_REPLACE[] PROGMEM =
 
 const char HTTP_MODULE_TEMPLATE_REPLACE_INDEX[] PROGMEM =
   "}2%d'>%s (%d)}3";                       // }2 and }3 are used in below os.replace
-const char HTTP_MODULE_TEMPLATE_REPLACE_NO_INDEX[] PROGMEM =
-  "}2%d'>%s}3";                           // }2 and }3 are used in below os.replace
 
+// Served by /gp.js followed by the GPIO and ADC function tables and cached by the browser using a hash of the firmware as ETag
 const char HTTP_SCRIPT_MODULE_TEMPLATE[] PROGMEM =
 #ifdef ESP8266
-  "var os;"
+  "var os,oc,oh;"
   "function sk(s,g){"                     // s = value, g = id and name
-    "var o=os.replace(/}2/g,\"<option value='\").replace(/}3/g,\")</option>\");"
-    "eb('g'+g).innerHTML=o;"
+    "if(os!=oc){oc=os;oh=os.replace(/}2/g,\"<option value='\").replace(/}3/g,\")</option>\");}"  // Convert a list once for all selects
+    "eb('g'+g).innerHTML=oh;"
     "eb('g'+g).value=s;"
-  "}";
+  "}"
+  "function gi(v,n){"                     // v = value, n = name
+    "return '}2'+v+\"'>\"+n+' ('+v+'}3';"  // }2'17'>Button1 (17}3
+  "}"
 #else  // ESP32
-  "var os,hs;"
+  "var os,oc,oh;"
   "function ce(i,q){"                     // Create index select
     "var o=document.createElement('option');"
     "o.textContent=i;"
@@ -258,12 +376,29 @@ const char HTTP_SCRIPT_MODULE_TEMPLATE[] PROGMEM =
     "t.style.visibility=(b>0)?'':'hidden';"
   "}"
   "function sk(s,g){"                     // s = value, g = id and name
-    "var o=os.replace(/}2/g,\"<option value='\").replace(/}3/g,\"</option>\");"
-    "eb('g'+g).innerHTML=o;"
+    "if(os!=oc){oc=os;oh=os.replace(/}2/g,\"<option value='\").replace(/}3/g,\"</option>\");}"  // Convert a list once for all selects
+    "eb('g'+g).innerHTML=oh;"
     "eb('g'+g).value=(g<99)?s&0xffe0:s;"
     "if(g<99){ot(g,s);}"
-  "}";
+  "}"
+  "function gi(v,n){"                     // v = value, n = name
+    "return '}2'+v+\"'>\"+n+'}3';"      // }2'32'>Button}3
+  "}"
 #endif  // ESP8266 - ESP32
+  "function go(l,u,x){"                   // l = value and name list, u = User value added as second option, x = values to skip
+    "var i,o='',v;"
+    "for(i=0;i<l.length;i+=2){"
+      "if(u&&2==i){o+=gi(u,\"" D_SENSOR_USER "\");}"
+      "v=l[i];"
+      "if(!x||x.indexOf(v)<0){o+=gi(v,l[i+1]);}"
+    "}"
+    "return o;"
+  "}";
+
+const char HTTP_SCRIPT_GPIO_LIST[] PROGMEM =
+  "</script>"
+  "<script src='gp.js?e=%08x'></script>"
+  "<script>";
 
 const char HTTP_SCRIPT_TEMPLATE[] PROGMEM =
   "function ld(u,f){"
@@ -285,8 +420,7 @@ const char HTTP_SCRIPT_TEMPLATE[] PROGMEM =
       "eb('s1').value=k;"                 // Set NAME if not yet set
     "}"
     "g=o.shift().split(',');"             // GPIO - Array separator
-    "os=\"";                              // }2'0'>None (0)}3}2'17'>Button1 (17)}3...
-const char HTTP_SCRIPT_TEMPLATE2[] PROGMEM =
+    "os=go(gl,gu);"                       // }2'0'>None (0)}3}2'255'>User (255)}3}2'17'>Button1 (17)}3...
     "j=0;"
     "for(i=0;i<" STR(MAX_USER_PINS) ";i++){"  // Supports 13 GPIOs
       "if(6==i){j=9;}"
@@ -296,7 +430,7 @@ const char HTTP_SCRIPT_TEMPLATE2[] PROGMEM =
     "}"
     "g=o.shift();";                       // FLAG
 const char HTTP_SCRIPT_TEMPLATE3[] PROGMEM =
-    "\";"
+    "os=go(al,au);"
     "sk(g&15," STR(ADC0_PIN) ");"         // Set ADC0
     "g>>=4;";
 const char HTTP_SCRIPT_TEMPLATE4[] PROGMEM =
@@ -333,21 +467,13 @@ const char HTTP_SCRIPT_INFO_END[] PROGMEM =
   "}"
   "wl(i);";
 
-const char HTTP_HEAD_LAST_SCRIPT[] PROGMEM =
-  "function jd(){"                        // Add label name='' based on provided id=''
-    "var t=0,i=document.querySelectorAll('input,button,textarea,select');"
-    "while(i.length>=t){"
-      "if(i[t]){"
-        "i[t]['name']=(i[t].hasAttribute('id')&&(!i[t].hasAttribute('name')))?i[t]['id']:i[t]['name'];"
-      "}"
-      "t++;"
-    "}"
-  "}"
-  "wl(jd);"                               // Add name='' to any id='' in input,button,textarea,select
-  "</script>";
+const char HTTP_HEAD_STYLE[] PROGMEM =
+  "</script>"
+  "<link rel='stylesheet' href='s.css?e=%08x'>"
+  "<style>";
 
+// Served by /s.css and cached by the browser using a hash of the web colors as ETag
 const char HTTP_HEAD_STYLE1[] PROGMEM =
-  "<style>"
   "div,fieldset,input,select{padding:5px;font-size:1em;}"
   "fieldset{background:#%06x;}"  // COLOR_FORM, Also update HTTP_TIMER_STYLE
   "p{margin:0.5em 0;}"
@@ -515,8 +641,8 @@ const char kButtonAction[] PROGMEM =
   "md|wi|lg|co|tp|dl|rs";
 const char kButtonConfirm[] PROGMEM = D_CONFIRM_RESTART "|" D_CONFIRM_RESET_CONFIGURATION;
 
-enum CTypes { CT_HTML, CT_PLAIN, CT_XML, CT_JSON, CT_STREAM };
-const char kContentTypes[] PROGMEM = "text/html|text/plain|text/xml|application/json|application/octet-stream";
+enum CTypes { CT_HTML, CT_PLAIN, CT_XML, CT_JSON, CT_STREAM, CT_CSS, CT_JS };
+const char kContentTypes[] PROGMEM = "text/html|text/plain|text/xml|application/json|application/octet-stream|text/css|application/javascript";
 
 const char kLoggingOptions[] PROGMEM = D_SERIAL_LOG_LEVEL "|" D_WEB_LOG_LEVEL "|" D_MQTT_LOG_LEVEL "|" D_SYS_LOG_LEVEL;
 const char kLoggingLevels[] PROGMEM = D_NONE "|" D_ERROR "|" D_INFO "|" D_DEBUG "|" D_MORE_DEBUG;
@@ -538,7 +664,8 @@ DNSServer *DnsServer;
 ESP8266WebServer *Webserver;
 
 struct WEB {
-  String chunk_buffer = "";                         // Could be max 2 * CHUNKED_BUFFER_SIZE
+  char *chunk_buffer = nullptr;                     // WEB_CHUNK_SIZE buffer coalescing small content
+  uint16_t chunk_len = 0;
   bool reset_web_log_flag = false;                  // Reset web console log
   uint8_t state = HTTP_OFF;
   uint8_t upload_error = 0;
@@ -547,8 +674,78 @@ struct WEB {
   uint8_t config_block_count = 0;
   uint8_t config_xor_on = 0;
   uint8_t config_xor_on_set = CONFIG_FILE_XOR;
+  String *capture = nullptr;                        // Collect content for WebSocket push or snapshot instead of sending
+  uint32_t wifi_scan_time = 0;                      // millis() the cached wifi scan was started
 } Web;
 
+#ifdef USE_WEB_STATS
+/*********************************************************************************************\
+ * HTTP request statistics
+ *
+ * Handlers mark their request with WEB_STAT(). One handleClient() call serves one request which
+ * is timed from parsing until the handler returns and counted with bytes and chunks sent. The
+ * time until the response headers is sent as Server-Timing header "app;dur=<mS>".
+ *
+ * WebStats   - Show count, bytes, chunks, average and max mS and latency histogram per endpoint
+ * WebStats 0 - Reset statistics
+\*********************************************************************************************/
+
+const uint8_t WEB_STAT_BUCKETS = 9;
+const uint16_t kWebStatBounds[WEB_STAT_BUCKETS -1] PROGMEM = { 5, 10, 25, 50, 100, 250, 500, 1000 };  // Bucket upper bounds in mS
+
+const char kWebStatNames[] PROGMEM = "Other|Root|Refresh|Console|ConsoleRefresh|Command|Metrics|Hue";
+
+struct WEB_STAT_DATA {
+  uint32_t count;
+  uint32_t bytes;
+  uint32_t chunks;
+  uint32_t time;                                    // mS total
+  uint32_t max;                                     // mS
+  uint32_t bucket[WEB_STAT_BUCKETS];
+};
+
+struct {
+  WEB_STAT_DATA stat[WEB_STAT_ENDPOINTS];
+  uint32_t start;                                   // micros() at start of handleClient()
+  uint32_t bytes;                                   // Current request
+  uint32_t chunks;
+  uint8_t endpoint = WEB_STAT_NONE;
+  bool responded = false;
+} WebStats;
+#endif  // USE_WEB_STATS
+
+#ifdef USE_WEBSOCKET
+#ifndef WEBSOCKET_PORT
+#define WEBSOCKET_PORT         8081                 // Port for pushing console log and root status
+#endif
+#ifndef WEBSOCKET_MAX_CLIENTS
+#define WEBSOCKET_MAX_CLIENTS  3                    // Max number of open pages
+#endif
+
+enum WebSocketStates { WS_FREE, WS_HANDSHAKE, WS_OPEN };
+enum WebSocketPages { WS_PAGE_ROOT, WS_PAGE_CONSOLE, WS_PAGE_NONE };
+
+struct WEBSOCKET_CLIENT {
+  WiFiClient client;
+  char *rx = nullptr;                               // WEBSOCKET_RX_SIZE buffer for handshake lines and received frames
+  uint32_t start;                                   // millis() of connect
+  uint32_t status_hash;                             // Hash of last pushed root status section
+  uint16_t rx_len;
+  uint8_t state = WS_FREE;
+  uint8_t page;
+  uint8_t log_index;                                // Next web log index to push or 0 for whole log
+  bool skip_line;                                   // Skip rest of handshake line too long for the buffer
+  char key[32];                                     // Sec-WebSocket-Key
+};
+
+struct {
+  WiFiServer *server = nullptr;
+  WEBSOCKET_CLIENT client[WEBSOCKET_MAX_CLIENTS];
+  uint32_t token[WS_PAGE_NONE];                     // Path token per page only known by authenticated pages
+  uint32_t status_time = 0;                         // millis() of next root status build
+} WebSocket;
+#endif  // USE_WEBSOCKET
+
 // Helper function to avoid code duplication (saves 4k Flash)
 static void WebGetArg(const char* arg, char* out, size_t max)
 {
@@ -581,8 +778,11 @@ void StartWebserver(int type, IPAddress ipweb)
   if (!Settings.web_refresh) { Settings.web_refresh = HTTP_REFRESH_TIME; }
   if (!Web.state) {
     if (!Webserver) {
-      Webserver = new ESP8266WebServer((HTTP_MANAGER == type || HTTP_MANAGER_RESET_ONLY == type) ? 80 : WEB_PORT);
+      Webserver = HEAP_NEW(HEAP_TAG_WEB) ESP8266WebServer((HTTP_MANAGER == type || HTTP_MANAGER_RESET_ONLY == type) ? 80 : WEB_PORT);
       Webserver->on("/", HandleRoot);
+      Webserver->on("/s.js", HandleScript);
+      Webserver->on("/s.css", HandleStyleSheet);
+      Webserver->on("/gp.js", HandleGpioScript);
       Webserver->onNotFound(HandleNotFound);
       Webserver->on("/up", HandleUpgradeFirmware);
       Webserver->on("/u1", HandleUpgradeFirmwareStart);  // OTA
@@ -613,6 +813,18 @@ void StartWebserver(int type, IPAddress ipweb)
     Webserver->collectHeaders(HEADER_KEYS, sizeof(HEADER_KEYS)/sizeof(char*));
 
     Webserver->begin(); // Web server start
+#if defined(ESP32) && defined(USE_WEBSERVER_TASK)
+#ifdef USE_NETWORK_TASK
+    if (!Webserver->beginTask(8192, 1, NET_TASK_CORE)) {  // Keep network I/O off the loop() core
+#else
+    if (!Webserver->beginTask()) {
+#endif  // USE_NETWORK_TASK
+      AddLog_P(LOG_LEVEL_ERROR, PSTR(D_LOG_HTTP "Web task not started"));
+    }
+#endif  // ESP32 and USE_WEBSERVER_TASK
+#ifdef USE_WEBSOCKET
+    WebSocketBegin();
+#endif  // USE_WEBSOCKET
   }
   if (Web.state != type) {
 #if LWIP_IPV6
@@ -631,6 +843,9 @@ void StopWebserver(void)
 {
   if (Web.state) {
     Webserver->close();
+#ifdef USE_WEBSOCKET
+    WebSocketStop();
+#endif  // USE_WEBSOCKET
     Web.state = HTTP_OFF;
     AddLog_P(LOG_LEVEL_INFO, PSTR(D_LOG_HTTP D_WEBSERVER_STOPPED));
   }
@@ -651,7 +866,7 @@ void WifiManagerBegin(bool reset_only)
 
   StopWebserver();
 
-  DnsServer = new DNSServer();
+  DnsServer = HEAP_NEW(HEAP_TAG_WEB) DNSServer();
 
   int channel = WIFI_SOFT_AP_CHANNEL;
   if ((channel < 1) || (channel > 13)) { channel = 1; }
@@ -672,10 +887,108 @@ void WifiManagerBegin(bool reset_only)
   StartWebserver((reset_only ? HTTP_MANAGER_RESET_ONLY : HTTP_MANAGER), WiFi.softAPIP());
 }
 
+#ifdef USE_WEB_STATS
+void WebStatsEndpoint(uint32_t endpoint)
+{
+  WebStats.endpoint = endpoint;                     // Last marker wins as root and console dispatch to refresh handlers
+}
+
+void WebStatsSent(uint32_t len, bool chunk)
+{
+  WebStats.responded = true;
+  WebStats.bytes += len;
+  if (chunk && len) { WebStats.chunks++; }
+}
+
+void WebStatsTimingHeader(void)
+{
+  uint32_t elapsed = micros() - WebStats.start;
+  char timing[24];
+  snprintf_P(timing, sizeof(timing), PSTR("app;dur=%d.%03d"), elapsed / 1000, elapsed % 1000);
+  Webserver->sendHeader(F("Server-Timing"), timing);
+}
+
+void WebStatsRequest(void)
+{
+  if ((WEB_STAT_NONE == WebStats.endpoint) && !WebStats.responded) { return; }  // No request served
+
+  WEB_STAT_DATA *stat = &WebStats.stat[(WEB_STAT_NONE == WebStats.endpoint) ? WEB_STAT_OTHER : WebStats.endpoint];
+  uint32_t elapsed = (micros() - WebStats.start) / 1000;
+  stat->count++;
+  stat->bytes += WebStats.bytes;
+  stat->chunks += WebStats.chunks;
+  stat->time += elapsed;
+  if (elapsed > stat->max) { stat->max = elapsed; }
+  uint32_t bucket = 0;
+  while ((bucket < WEB_STAT_BUCKETS -1) && (elapsed >= pgm_read_word(kWebStatBounds + bucket))) { bucket++; }
+  stat->bucket[bucket]++;
+}
+
+void WebStatsShow(void)
+{
+  char name[16];
+  Response_P(PSTR("{\"" D_CMND_WEBSTATS "\":{"));
+  for (uint32_t i = 0; i < WEB_STAT_ENDPOINTS; i++) {
+    WEB_STAT_DATA *stat = &WebStats.stat[i];
+    ResponseAppend_P(PSTR("%s\"%s\":{\"Count\":%u,\"Bytes\":%u,\"Chunks\":%u,\"Avg\":%u,\"Max\":%u,\"Histogram\":["),
+      (i) ? "," : "", GetTextIndexed(name, sizeof(name), i, kWebStatNames),
+      stat->count, stat->bytes, stat->chunks, (stat->count) ? stat->time / stat->count : 0, stat->max);
+    for (uint32_t j = 0; j < WEB_STAT_BUCKETS; j++) {
+      ResponseAppend_P(PSTR("%s%u"), (j) ? "," : "", stat->bucket[j]);
+    }
+    ResponseAppend_P(PSTR("]}"));
+  }
+  ResponseJsonEndEnd();
+}
+
+#ifdef USE_PROMETHEUS
+void WebStatsMetrics(void)
+{
+  char name[16];
+  WSContentSend_P(PSTR("# TYPE web_request_milliseconds histogram\n"));
+  for (uint32_t i = 0; i < WEB_STAT_ENDPOINTS; i++) {
+    WEB_STAT_DATA *stat = &WebStats.stat[i];
+    GetTextIndexed(name, sizeof(name), i, kWebStatNames);
+    uint32_t count = 0;
+    for (uint32_t j = 0; j < WEB_STAT_BUCKETS -1; j++) {
+      count += stat->bucket[j];
+      WSContentSend_P(PSTR("web_request_milliseconds_bucket{endpoint=\"%s\",le=\"%d\"} %u\n"), name, pgm_read_word(kWebStatBounds + j), count);
+    }
+    WSContentSend_P(PSTR("web_request_milliseconds_bucket{endpoint=\"%s\",le=\"+Inf\"} %u\n"
+                         "web_request_milliseconds_sum{endpoint=\"%s\"} %u\n"
+                         "web_request_milliseconds_count{endpoint=\"%s\"} %u\n"),
+      name, stat->count, name, stat->time, name, stat->count);
+  }
+  WSContentSend_P(PSTR("# TYPE web_response_bytes counter\n"));
+  for (uint32_t i = 0; i < WEB_STAT_ENDPOINTS; i++) {
+    WSContentSend_P(PSTR("web_response_bytes{endpoint=\"%s\"} %u\n"), GetTextIndexed(name, sizeof(name), i, kWebStatNames), WebStats.stat[i].bytes);
+  }
+  WSContentSend_P(PSTR("# TYPE web_response_chunks counter\n"));
+  for (uint32_t i = 0; i < WEB_STAT_ENDPOINTS; i++) {
+    WSContentSend_P(PSTR("web_response_chunks{endpoint=\"%s\"} %u\n"), GetTextIndexed(name, sizeof(name), i, kWebStatNames), WebStats.stat[i].chunks);
+  }
+}
+#endif  // USE_PROMETHEUS
+#endif  // USE_WEB_STATS
+
 void PollDnsWebserver(void)
 {
   if (DnsServer) { DnsServer->processNextRequest(); }
+#ifdef USE_WEB_STATS
+  WebStats.start = micros();
+  WebStats.bytes = 0;
+  WebStats.chunks = 0;
+  WebStats.endpoint = WEB_STAT_NONE;
+  WebStats.responded = false;
+#endif  // USE_WEB_STATS
+#if defined(ESP32) && defined(USE_WEBSERVER_TASK)
+  if (Webserver) { Webserver->dispatch(); }  // Run handler requested by the web task
+#else
   if (Webserver) { Webserver->handleClient(); }
+#endif  // ESP32 and USE_WEBSERVER_TASK
+#ifdef USE_WEB_STATS
+  WebStatsRequest();
+#endif  // USE_WEB_STATS
 }
 
 /*********************************************************************************************/
@@ -724,9 +1037,73 @@ void WSHeaderSend(void)
 void WSSend(int code, int ctype, const String& content)
 {
   char ct[25];  // strlen("application/octet-stream") +1 = Longest Content type string
+#ifdef USE_WEB_STATS
+  WebStatsTimingHeader();
+  WebStatsSent(content.length(), false);
+#endif  // USE_WEB_STATS
   Webserver->send(code, GetTextIndexed(ct, sizeof(ct), ctype, kContentTypes), content);
 }
 
+void WSSend_P(int code, int ctype, const char* content)
+{
+  // PROGMEM content sent without a String copy
+  char ct[25];
+#ifdef USE_WEB_STATS
+  WebStatsTimingHeader();
+  WebStatsSent(strlen_P(content), false);
+#endif  // USE_WEB_STATS
+  Webserver->send_P(code, GetTextIndexed(ct, sizeof(ct), ctype, kContentTypes), content);
+}
+
+void WSSendFill_P(int code, int ctype, const char* text, const char* values[], uint32_t count)
+{
+  // Send PROGMEM text replacing placeholders {x1 to {x<count> by values with a known content length
+#ifdef ARDUINO_ESP8266_RELEASE_2_3_0
+  String content = FPSTR(text);                   // Core 2.3.0 sends all content as chunks
+  char placeholder[4] = "{x1";
+  for (uint32_t i = 0; i < count; i++) {
+    placeholder[2] = '1' + i;
+    content.replace(placeholder, values[i]);
+  }
+  WSSend(code, ctype, content);
+#else
+  size_t size = 0;
+  for (uint32_t pass = 0; pass < 2; pass++) {
+    if (pass) {
+      Webserver->client().flush();
+      WSHeaderSend();
+      _WSContentBeginSize(code, ctype, size);
+    }
+    const char* literal = text;
+    const char* p = text;
+    while (char ch = pgm_read_byte(p)) {
+      uint32_t index = ('{' == ch) && ('x' == pgm_read_byte(p +1)) ? pgm_read_byte(p +2) - '1' : count;
+      if (index >= count) {
+        p++;
+        continue;
+      }
+      if (pass) {
+        _WSContentSendRaw_P(literal, p - literal);
+        _WSContentSendRaw(values[index], strlen(values[index]));
+      } else {
+        size += p - literal + strlen(values[index]);
+      }
+      p += 3;
+      literal = p;
+    }
+    if (pass) {
+      _WSContentSendRaw_P(literal, p - literal);
+    } else {
+      size += p - literal;
+    }
+  }
+  WSContentFlush();
+  Webserver->client().stop();
+  free(Web.chunk_buffer);
+  Web.chunk_buffer = nullptr;
+#endif  // ARDUINO_ESP8266_RELEASE_2_3_0
+}
+
 /**********************************************************************************************
 * HTTP Content Chunk handler
 **********************************************************************************************/
@@ -735,13 +1112,48 @@ void WSContentBegin(int code, int ctype)
 {
   Webserver->client().flush();
   WSHeaderSend();
+  _WSContentBegin(code, ctype);
+}
+
+void _WSContentBegin(int code, int ctype)
+{
+  _WSContentBeginSize(code, ctype, CONTENT_LENGTH_UNKNOWN);
+}
+
+void _WSContentBeginSize(int code, int ctype, size_t size)
+{
+#ifdef ARDUINO_ESP8266_RELEASE_2_3_0
+  if (CONTENT_LENGTH_UNKNOWN == size) {
+    Webserver->sendHeader(F("Accept-Ranges"),F("none"));
+    Webserver->sendHeader(F("Transfer-Encoding"),F("chunked"));
+  }
+#endif
+  Webserver->setContentLength(size);
+  WSSend(code, ctype, "");                        // Signal start of chunked or sized content
+  if (!Web.chunk_buffer) {
+    Web.chunk_buffer = (char*)PsramMalloc(WEB_CHUNK_SIZE);  // Without buffer content is sent unbuffered
+  }
+  Web.chunk_len = 0;
+}
+
+void _WSContentSend(const char* content, size_t len)  // Low level sendContent for all core versions
+{
 #ifdef ARDUINO_ESP8266_RELEASE_2_3_0
-  Webserver->sendHeader(F("Accept-Ranges"),F("none"));
-  Webserver->sendHeader(F("Transfer-Encoding"),F("chunked"));
+  String chunk;
+  chunk.reserve(len +1);
+  for (uint32_t i = 0; i < len; i++) { chunk += content[i]; }
+  _WSContentSend(chunk);
+#else
+#ifdef USE_WEB_STATS
+  WebStatsSent(len, true);
+#endif  // USE_WEB_STATS
+  Webserver->sendContent_P(content, len);         // Also handles RAM content
+
+#ifdef USE_DEBUG_DRIVER
+  ShowFreeMem(PSTR("WSContentSend"));
+#endif
+  DEBUG_CORE_LOG(PSTR("WEB: Chunk size %d/%d"), len, WEB_CHUNK_SIZE);
 #endif
-  Webserver->setContentLength(CONTENT_LENGTH_UNKNOWN);
-  WSSend(code, ctype, "");                        // Signal start of chunked content
-  Web.chunk_buffer = "";
 }
 
 void _WSContentSend(const String& content)        // Low level sendContent for all core versions
@@ -756,6 +1168,9 @@ void _WSContentSend(const String& content)        // Low level sendContent for a
 #else
   Webserver->sendContent(content);
 #endif
+#ifdef USE_WEB_STATS
+  WebStatsSent(len, true);
+#endif  // USE_WEB_STATS
 
 #ifdef USE_DEBUG_DRIVER
   ShowFreeMem(PSTR("WSContentSend"));
@@ -765,15 +1180,52 @@ void _WSContentSend(const String& content)        // Low level sendContent for a
 
 void WSContentFlush(void)
 {
-  if (Web.chunk_buffer.length() > 0) {
-    _WSContentSend(Web.chunk_buffer);                  // Flush chunk buffer
-    Web.chunk_buffer = "";
+  if (Web.chunk_len > 0) {
+    _WSContentSend(Web.chunk_buffer, Web.chunk_len);  // Flush chunk buffer
+    Web.chunk_len = 0;
+  }
+}
+
+void _WSContentSendRaw(const char* content, size_t len)
+{
+  if (Web.capture) {
+    *Web.capture += content;
+    return;
+  }
+
+  if (Web.chunk_len + len > WEB_CHUNK_SIZE) {      // Content does not fit in chunk buffer
+    WSContentFlush();                              // Send chunk buffer before content
+  }
+  if (Web.chunk_buffer && (len <= WEB_CHUNK_SIZE)) {
+    memcpy(Web.chunk_buffer + Web.chunk_len, content, len);  // Coalesce content into chunk buffer
+    Web.chunk_len += len;
+  } else {
+    _WSContentSend(content, len);                  // Content is oversize
+  }
+}
+
+void _WSContentSendRaw_P(const char* content, size_t len)
+{
+  // Coalesce PROGMEM content into the chunk buffer
+  while (len) {
+    if (!Web.chunk_buffer || (Web.chunk_len >= WEB_CHUNK_SIZE)) { WSContentFlush(); }
+    if (!Web.chunk_buffer) {
+      _WSContentSend(content, len);               // Also handles PROGMEM content
+      return;
+    }
+    size_t part = WEB_CHUNK_SIZE - Web.chunk_len;
+    if (part > len) { part = len; }
+    memcpy_P(Web.chunk_buffer + Web.chunk_len, content, part);
+    Web.chunk_len += part;
+    content += part;
+    len -= part;
   }
 }
 
 void _WSContentSendBuffer(void)
 {
-  int len = strlen(mqtt_data);
+  uint32_t len = strlen(mqtt_data);
+  ResponseSetLength(len);
 
   if (0 == len) {                                  // No content
     return;
@@ -781,17 +1233,7 @@ void _WSContentSendBuffer(void)
   else if (len == sizeof(mqtt_data)) {
     AddLog_P(LOG_LEVEL_INFO, PSTR("HTP: Content too large"));
   }
-  else if (len < CHUNKED_BUFFER_SIZE) {            // Append chunk buffer with small content
-    Web.chunk_buffer += mqtt_data;
-    len = Web.chunk_buffer.length();
-  }
-
-  if (len >= CHUNKED_BUFFER_SIZE) {                // Either content or chunk buffer is oversize
-    WSContentFlush();                              // Send chunk buffer before possible content oversize
-  }
-  if (strlen(mqtt_data) >= CHUNKED_BUFFER_SIZE) {  // Content is oversize
-    _WSContentSend(mqtt_data);                     // Send content
-  }
+  _WSContentSendRaw(mqtt_data, len);
 }
 
 void WSContentSend_P(const char* formatP, ...)     // Content send snprintf_P char data
@@ -863,13 +1305,7 @@ void WSContentSendStyle_P(const char* formatP, ...)
       WSContentSend_P(HTTP_SCRIPT_COUNTER);
     }
   }
-  WSContentSend_P(HTTP_HEAD_LAST_SCRIPT);
-
-  WSContentSend_P(HTTP_HEAD_STYLE1, WebColor(COL_FORM), WebColor(COL_INPUT), WebColor(COL_INPUT_TEXT), WebColor(COL_INPUT),
-                  WebColor(COL_INPUT_TEXT), WebColor(COL_CONSOLE), WebColor(COL_CONSOLE_TEXT), WebColor(COL_BACKGROUND));
-  WSContentSend_P(HTTP_HEAD_STYLE2, WebColor(COL_BUTTON), WebColor(COL_BUTTON_TEXT), WebColor(COL_BUTTON_HOVER),
-                  WebColor(COL_BUTTON_RESET), WebColor(COL_BUTTON_RESET_HOVER), WebColor(COL_BUTTON_SAVE), WebColor(COL_BUTTON_SAVE_HOVER),
-                  WebColor(COL_BUTTON));
+  WSContentSend_P(HTTP_HEAD_STYLE, WebStyleHash());
   if (formatP != nullptr) {
     // This uses char strings. Be aware of sending %% if % is needed
     va_list arg;
@@ -910,6 +1346,103 @@ void WSContentSendStyle(void)
   WSContentSendStyle_P(nullptr);
 }
 
+uint32_t WebStyleHash(void)
+{
+  return GetHash((const char*)Settings.web_color, sizeof(Settings.web_color)) ^
+         GetHash((const char*)Settings.web_color2, sizeof(Settings.web_color2)) ^ GetHash(my_version, strlen(my_version));
+}
+
+uint32_t WebGpioHash(void)
+{
+  // The function tables only change with the firmware
+  return GetHash(my_version, strlen(my_version)) ^ GetHash(__DATE__ " " __TIME__, sizeof(__DATE__ " " __TIME__) -1);
+}
+
+bool WSCached(const char* etag)
+{
+  // Send cache headers and return true if the browser copy is still valid
+  char quoted_etag[20];
+  snprintf_P(quoted_etag, sizeof(quoted_etag), PSTR("\"%s\""), etag);
+  Webserver->sendHeader(F("ETag"), quoted_etag);
+  if (Webserver->header(F("If-None-Match")) == quoted_etag) {
+    WSSend(304, CT_PLAIN, "");
+    return true;
+  }
+  Webserver->sendHeader(F("Cache-Control"), F("max-age=31536000"));  // URL contains ETag so cache for a year
+  HttpHeaderCors();
+  return false;
+}
+
+void HandleScript(void)
+{
+  if (WSCached(HTTP_SCRIPT_COMMON_ETAG)) { return; }
+
+  Webserver->sendHeader(F("Content-Encoding"), F("gzip"));
+  char ct[25];
+  Webserver->send_P(200, GetTextIndexed(ct, sizeof(ct), CT_JS, kContentTypes), (PGM_P)HTTP_SCRIPT_COMMON_GZ, sizeof(HTTP_SCRIPT_COMMON_GZ));
+}
+
+void HandleGpioScript(void)
+{
+  char etag[9];
+  snprintf_P(etag, sizeof(etag), PSTR("%08x"), WebGpioHash());
+  Webserver->client().flush();
+  if (WSCached(etag)) { return; }
+
+  char stemp[30];  // Sensor name
+  _WSContentBegin(200, CT_JS);
+  WSContentSend_P(HTTP_SCRIPT_MODULE_TEMPLATE);
+  WSContentSend_P(PSTR("var gl=["));
+  for (uint32_t i = 0; i < ARRAY_SIZE(kGpioNiceList); i++) {  // gl=[0,"None",17,"Button1",...];
+#ifdef ESP8266
+    uint32_t midx = pgm_read_byte(kGpioNiceList + i);
+    uint32_t ridx = midx;
+#else  // ESP32
+    uint32_t ridx = pgm_read_word(kGpioNiceList + i) & 0xFFE0;
+    uint32_t midx = ridx >> 5;
+#endif  // ESP8266 - ESP32
+    WSContentSend_P(PSTR("%s%d,\"%s\""), (i>0)?",":"", ridx, GetTextIndexed(stemp, sizeof(stemp), midx, kSensorNames));
+  }
+  WSContentSend_P(PSTR("],gu=%d"), AGPIO(GPIO_USER));
+#ifdef ESP8266
+  WSContentSend_P(PSTR(",al=["));
+  for (uint32_t i = 0; i < ADC0_END; i++) {                // al=[0,"None",1,"Analog",...];
+    WSContentSend_P(PSTR("%s%d,\"%s\""), (i>0)?",":"", i, GetTextIndexed(stemp, sizeof(stemp), i, kAdc0Names));
+  }
+  WSContentSend_P(PSTR("],au=%d"), ADC0_USER);
+#else  // ESP32
+  WSContentSend_P(PSTR(",hs=["));
+  bool first_done = false;
+  for (uint32_t i = 0; i < ARRAY_SIZE(kGpioNiceList); i++) {  // hs=[36,68,100,132,168,200,232,264,292,324,356,388,421,453];
+    uint32_t midx = pgm_read_word(kGpioNiceList + i);
+    if (midx & 0x001F) {
+      if (first_done) { WSContentSend_P(PSTR(",")); }
+      WSContentSend_P(PSTR("%d"), midx);
+      first_done = true;
+    }
+  }
+  WSContentSend_P(PSTR("]"));
+#endif  // ESP8266 - ESP32
+  WSContentSend_P(PSTR(";"));
+  WSContentEnd();
+}
+
+void HandleStyleSheet(void)
+{
+  char etag[9];
+  snprintf_P(etag, sizeof(etag), PSTR("%08x"), WebStyleHash());
+  Webserver->client().flush();
+  if (WSCached(etag)) { return; }
+
+  _WSContentBegin(200, CT_CSS);
+  WSContentSend_P(HTTP_HEAD_STYLE1, WebColor(COL_FORM), WebColor(COL_INPUT), WebColor(COL_INPUT_TEXT), WebColor(COL_INPUT),
+                  WebColor(COL_INPUT_TEXT), WebColor(COL_CONSOLE), WebColor(COL_CONSOLE_TEXT), WebColor(COL_BACKGROUND));
+  WSContentSend_P(HTTP_HEAD_STYLE2, WebColor(COL_BUTTON), WebColor(COL_BUTTON_TEXT), WebColor(COL_BUTTON_HOVER),
+                  WebColor(COL_BUTTON_RESET), WebColor(COL_BUTTON_RESET_HOVER), WebColor(COL_BUTTON_SAVE), WebColor(COL_BUTTON_SAVE_HOVER),
+                  WebColor(COL_BUTTON));
+  WSContentEnd();
+}
+
 void WSContentButton(uint32_t title_index)
 {
   char action[4];
@@ -951,6 +1484,8 @@ void WSContentEnd(void)
   WSContentFlush();                                // Flush chunk buffer
   _WSContentSend("");                              // Signal end of chunked content
   Webserver->client().stop();
+  free(Web.chunk_buffer);
+  Web.chunk_buffer = nullptr;
 }
 
 void WSContentStop(void)
@@ -1030,6 +1565,7 @@ void WebSliderColdWarm(void)
 
 void HandleRoot(void)
 {
+  WEB_STAT(WEB_STAT_ROOT);
   if (CaptivePortal()) { return; }  // If captive portal redirect instead of displaying the page.
 
   if (Webserver->hasArg("rst")) {
@@ -1062,12 +1598,19 @@ void HandleRoot(void)
   char stemp[33];
 
   WSContentStart_P(S_MAIN_MENU);
+#ifdef USE_WEBSOCKET
+  WSContentSend_P(HTTP_SCRIPT_WEBSOCKET, WEBSOCKET_PORT);
+#endif  // USE_WEBSOCKET
 #ifdef USE_SCRIPT_WEB_DISPLAY
   WSContentSend_P(HTTP_SCRIPT_ROOT, Settings.web_refresh, Settings.web_refresh);
 #else
   WSContentSend_P(HTTP_SCRIPT_ROOT, Settings.web_refresh);
 #endif
+#ifdef USE_WEBSOCKET
+  WSContentSend_P(HTTP_SCRIPT_ROOT_PART2, WebSocket.token[WS_PAGE_ROOT]);
+#else
   WSContentSend_P(HTTP_SCRIPT_ROOT_PART2);
+#endif  // USE_WEBSOCKET
 
   WSContentSendStyle();
 
@@ -1239,6 +1782,7 @@ bool HandleRootStatusRefresh(void)
   if (!Webserver->hasArg("m")) {     // Status refresh requested
     return false;
   }
+  WEB_STAT(WEB_STAT_REFRESH);
 
   #ifdef USE_SCRIPT_WEB_DISPLAY
     Script_Check_HTML_Setvars();
@@ -1332,8 +1876,27 @@ bool HandleRootStatusRefresh(void)
   }
 #endif  // USE_SONOFF_RF
   WSContentBegin(200, CT_HTML);
+  WebRootStatus();
+  WSContentEnd();
+
+  return true;
+}
+
+void WebRootStatus(void)
+{
+  // Sensor and power state section of the root page
+  char svalue[32];
+
   WSContentSend_P(PSTR("{t}"));
-  XsnsCall(FUNC_WEB_SENSOR);
+  if (!SensorSnapshot.html_valid) {
+    String *capture = Web.capture;
+    SensorSnapshot.html = "";
+    Web.capture = &SensorSnapshot.html;
+    XsnsCall(FUNC_WEB_SENSOR);
+    Web.capture = capture;
+    SensorSnapshot.html_valid = true;
+  }
+  _WSContentSendRaw(SensorSnapshot.html.c_str(), SensorSnapshot.html.length());
 #ifdef USE_SCRIPT_WEB_DISPLAY
   XdrvCall(FUNC_WEB_SENSOR);
 #endif
@@ -1360,9 +1923,6 @@ bool HandleRootStatusRefresh(void)
 #endif  // USE_SONOFF_IFAN
     WSContentSend_P(PSTR("</tr></table>"));
   }
-  WSContentEnd();
-
-  return true;
 }
 
 #ifdef USE_SHUTTER
@@ -1451,65 +2011,23 @@ void HandleTemplateConfiguration(void)
   AddLog_P(LOG_LEVEL_DEBUG, S_LOG_HTTP, S_CONFIGURE_TEMPLATE);
 
   WSContentStart_P(S_CONFIGURE_TEMPLATE);
-  WSContentSend_P(HTTP_SCRIPT_MODULE_TEMPLATE);
+  WSContentSend_P(HTTP_SCRIPT_GPIO_LIST, WebGpioHash());   // Function tables and sk()
 
   WSContentSend_P(HTTP_SCRIPT_TEMPLATE);
-  for (uint32_t i = 0; i < ARRAY_SIZE(kGpioNiceList); i++) {   // GPIO: }2'0'>None (0)}3}2'17'>Button1 (17)}3...
 #ifdef ESP8266
-    if (1 == i) {
-      WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE, AGPIO(GPIO_USER), D_SENSOR_USER, AGPIO(GPIO_USER));  // }2'255'>User (255)}3
-    }
-    uint32_t midx = pgm_read_byte(kGpioNiceList + i);
-    uint32_t ridx = midx;
-    WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE, ridx, GetTextIndexed(stemp, sizeof(stemp), midx, kSensorNames), ridx);
+  WSContentSend_P(HTTP_SCRIPT_TEMPLATE3);                  // ADC0
+#endif  // ESP8266
+
+  WSContentSend_P(HTTP_SCRIPT_TEMPLATE4);
+  for (uint32_t i = 0; i < sizeof(kModuleNiceList); i++) {  // "}2'%d'>%s (%d)}3" - "}2'0'>Sonoff Basic (1)}3"
+    uint32_t midx = pgm_read_byte(kModuleNiceList + i);
+#ifdef ESP8266
+    WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE, midx, AnyModuleName(midx).c_str(), midx +1);
 #else  // ESP32
-    if (1 == i) {
-      WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE_NO_INDEX, AGPIO(GPIO_USER), D_SENSOR_USER);  // }2'255'>User}3
-    }
-    uint32_t ridx = pgm_read_word(kGpioNiceList + i) & 0xFFE0;
-    uint32_t midx = ridx >> 5;
-    WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE_NO_INDEX, ridx, GetTextIndexed(stemp, sizeof(stemp), midx, kSensorNames));
+    WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE_INDEX, midx, AnyModuleName(midx).c_str(), midx +1);
 #endif  // ESP8266 - ESP32
   }
-  WSContentSend_P(PSTR("\";"));
-
-#ifdef ESP32
-  WSContentSend_P(PSTR("hs=["));
-  bool first_done = false;
-  for (uint32_t i = 0; i < ARRAY_SIZE(kGpioNiceList); i++) {  // hs=[36,68,100,132,168,200,232,264,292,324,356,388,421,453];
-    uint32_t midx = pgm_read_word(kGpioNiceList + i);
-    if (midx & 0x001F) {
-      if (first_done) { WSContentSend_P(PSTR(",")); }
-      WSContentSend_P(PSTR("%d"), midx);
-      first_done = true;
-    }
-  }
-  WSContentSend_P(PSTR("];"));
-#endif  // ESP32
-
-  WSContentSend_P(HTTP_SCRIPT_TEMPLATE2);
-
-#ifdef ESP8266
-  WSContentSend_P(PSTR("os=\""));
-  for (uint32_t i = 0; i < ADC0_END; i++) {                // FLAG: }2'0'>None (0)}3}2'17'>Analog (17)}3...
-    if (1 == i) {
-      WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE, ADC0_USER, D_SENSOR_USER, ADC0_USER);  // }2'15'>User (15)}3
-    }
-    WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE, i, GetTextIndexed(stemp, sizeof(stemp), i, kAdc0Names), i);
-  }
-  WSContentSend_P(HTTP_SCRIPT_TEMPLATE3);
-#endif  // ESP8266
-
-  WSContentSend_P(HTTP_SCRIPT_TEMPLATE4);
-  for (uint32_t i = 0; i < sizeof(kModuleNiceList); i++) {  // "}2'%d'>%s (%d)}3" - "}2'0'>Sonoff Basic (1)}3"
-    uint32_t midx = pgm_read_byte(kModuleNiceList + i);
-#ifdef ESP8266
-    WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE, midx, AnyModuleName(midx).c_str(), midx +1);
-#else  // ESP32
-    WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE_INDEX, midx, AnyModuleName(midx).c_str(), midx +1);
-#endif  // ESP8266 - ESP32
-  }
-  WSContentSend_P(HTTP_SCRIPT_TEMPLATE5);
+  WSContentSend_P(HTTP_SCRIPT_TEMPLATE5);
 
   WSContentSendStyle();
   WSContentSend_P(HTTP_FORM_TEMPLATE);
@@ -1616,9 +2134,9 @@ void HandleModuleConfiguration(void)
   ModuleGpios(&cmodule);
 
   WSContentStart_P(S_CONFIGURE_MODULE);
-  WSContentSend_P(HTTP_SCRIPT_MODULE_TEMPLATE);
+  WSContentSend_P(HTTP_SCRIPT_GPIO_LIST, WebGpioHash());   // Function tables and sk()
 
-  WSContentSend_P(PSTR("function sl(){os=\""));
+  WSContentSend_P(PSTR("function sl(){var i,g;os=\""));
   uint32_t vidx = 0;
   for (uint32_t i = 0; i <= sizeof(kModuleNiceList); i++) {  // "}2'%d'>%s (%d)}3" - "}2'255'>UserTemplate (0)}3" - "}2'0'>Sonoff Basic (1)}3"
     if (0 == i) {
@@ -1634,51 +2152,34 @@ void HandleModuleConfiguration(void)
     WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE_INDEX, midx, AnyModuleName(midx).c_str(), vidx);
 #endif  // ESP8266 - ESP32
   }
-  WSContentSend_P(PSTR("\";sk(%d,99);os=\""), Settings.module);
-  for (uint32_t i = 0; i < ARRAY_SIZE(kGpioNiceList); i++) {
+  WSContentSend_P(PSTR("\";sk(%d,99);os=go(gl,0,["), Settings.module);
+  bool first_done = false;
+  for (uint32_t i = 0; i < ARRAY_SIZE(kGpioNiceList); i++) {  // Skip functions fixed by the module: os=go(gl,0,[224,225]);
 #ifdef ESP8266
     midx = pgm_read_byte(kGpioNiceList + i);
     uint32_t ridx = midx;
-    if (!GetUsedInModule(midx, cmodule.io)) {
-      WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE, ridx, GetTextIndexed(stemp, sizeof(stemp), midx, kSensorNames), ridx);
-    }
 #else  // ESP32
     uint32_t ridx = pgm_read_word(kGpioNiceList + i) & 0xFFE0;
     midx = ridx >> 5;
-    if (!GetUsedInModule(midx, cmodule.io)) {
-      WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE_NO_INDEX, ridx, GetTextIndexed(stemp, sizeof(stemp), midx, kSensorNames));
-    }
 #endif  // ESP8266 - ESP32
-  }
-  WSContentSend_P(PSTR("\";"));
-
-#ifdef ESP32
-  WSContentSend_P(PSTR("hs=["));
-  bool first_done = false;
-  for (uint32_t i = 0; i < ARRAY_SIZE(kGpioNiceList); i++) {  // hs=[36,68,100,132,168,200,232,264,292,324,356,388,421,453];
-    midx = pgm_read_word(kGpioNiceList + i);
-    if (midx & 0x001F) {
-      if (first_done) { WSContentSend_P(PSTR(",")); }
-      WSContentSend_P(PSTR("%d"), midx);
+    if (GetUsedInModule(midx, cmodule.io)) {
+      WSContentSend_P(PSTR("%s%d"), (first_done)?",":"", ridx);
       first_done = true;
     }
   }
-  WSContentSend_P(PSTR("];"));
-#endif  // ESP32
-
-  for (uint32_t i = 0; i < ARRAY_SIZE(cmodule.io); i++) {
+  WSContentSend_P(PSTR("]);g=["));
+  first_done = false;
+  for (uint32_t i = 0; i < ARRAY_SIZE(cmodule.io); i++) {    // Pin and function: g=[0,17,1,0,...];
     if (ValidGPIO(i, cmodule.io[i])) {
-      WSContentSend_P(PSTR("sk(%d,%d);"), my_module.io[i], i);  // g0 - g16
+      WSContentSend_P(PSTR("%s%d,%d"), (first_done)?",":"", i, my_module.io[i]);  // g0 - g16
+      first_done = true;
     }
   }
+  WSContentSend_P(PSTR("];for(i=0;i<g.length;i+=2){sk(g[i+1],g[i]);}"));
 
 #ifdef ESP8266
 #ifndef USE_ADC_VCC
-  WSContentSend_P(PSTR("os=\""));
-  for (uint32_t j = 0; j < ADC0_END; j++) {
-    WSContentSend_P(HTTP_MODULE_TEMPLATE_REPLACE, j, GetTextIndexed(stemp, sizeof(stemp), j, kAdc0Names), j);
-  }
-  WSContentSend_P(PSTR("\";sk(%d," STR(ADC0_PIN) ");"), Settings.my_adc0);
+  WSContentSend_P(PSTR("os=go(al);sk(%d," STR(ADC0_PIN) ");"), Settings.my_adc0);
 #endif  // USE_ADC_VCC
 #endif  // ESP8266 - ESP32
 
@@ -1783,10 +2284,103 @@ String HtmlEscape(const String unescaped) {
 // Indexed by enum wl_enc_type in file wl_definitions.h starting from -1
 const char kEncryptionType[] PROGMEM = "|||" D_WPA_PSK "||" D_WPA2_PSK "|" D_WEP "||" D_NONE "|" D_AUTO;
 
+#ifndef WIFI_SCAN_CACHE
+#define WIFI_SCAN_CACHE        30000                // mS a wifi scan result is shown again instead of scanning
+#endif
+
+void WifiScanStart(void)
+{
+  // Start an async scan unless one is running or a recent result is available
+  int n = WiFi.scanComplete();
+  if (WIFI_SCAN_RUNNING == n) { return; }
+  if ((n >= 0) && (millis() - Web.wifi_scan_time < WIFI_SCAN_CACHE)) { return; }
+  WiFi.scanDelete();
+#ifdef USE_EMULATION
+  UdpDisconnect();
+#endif  // USE_EMULATION
+  WiFi.scanNetworks(true);
+  Web.wifi_scan_time = millis();
+}
+
+void HandleWifiScanResults(void)
+{
+  // Networks found by WifiScanStart() or empty while still scanning
+  int n = WiFi.scanComplete();
+  if (n < 0) {
+    if (n != WIFI_SCAN_RUNNING) { WifiScanStart(); }  // Result was deleted by a network (re)scan
+    WSContentBegin(200, CT_HTML);
+    WSContentEnd();
+    return;
+  }
+  AddLog_P(LOG_LEVEL_DEBUG, PSTR(D_LOG_WIFI D_SCAN_DONE));
+
+  WSContentBegin(200, CT_HTML);
+  if (0 == n) {
+    AddLog_P(LOG_LEVEL_DEBUG, S_LOG_WIFI, S_NO_NETWORKS_FOUND);
+    WSContentSend_P(S_NO_NETWORKS_FOUND);
+    WSContentSend_P(PSTR(". " D_REFRESH_TO_SCAN_AGAIN "."));
+  } else {
+    //sort networks
+    int indices[n];
+    for (uint32_t i = 0; i < n; i++) {
+      indices[i] = i;
+    }
+
+    // RSSI SORT
+    for (uint32_t i = 0; i < n; i++) {
+      for (uint32_t j = i + 1; j < n; j++) {
+        if (WiFi.RSSI(indices[j]) > WiFi.RSSI(indices[i])) {
+          std::swap(indices[i], indices[j]);
+        }
+      }
+    }
+
+    // remove duplicates ( must be RSSI sorted )
+    String cssid;
+    for (uint32_t i = 0; i < n; i++) {
+      if (-1 == indices[i]) { continue; }
+      cssid = WiFi.SSID(indices[i]);
+      uint32_t cschn = WiFi.channel(indices[i]);
+      for (uint32_t j = i + 1; j < n; j++) {
+        if ((cssid == WiFi.SSID(indices[j])) && (cschn == WiFi.channel(indices[j]))) {
+          DEBUG_CORE_LOG(PSTR(D_LOG_WIFI D_DUPLICATE_ACCESSPOINT " %s"), WiFi.SSID(indices[j]).c_str());
+          indices[j] = -1;  // set dup aps to index -1
+        }
+      }
+    }
+
+    //display networks in page
+    for (uint32_t i = 0; i < n; i++) {
+      if (-1 == indices[i]) { continue; }  // skip dups
+      int32_t rssi = WiFi.RSSI(indices[i]);
+      DEBUG_CORE_LOG(PSTR(D_LOG_WIFI D_SSID " %s, " D_BSSID " %s, " D_CHANNEL " %d, " D_RSSI " %d"),
+        WiFi.SSID(indices[i]).c_str(), WiFi.BSSIDstr(indices[i]).c_str(), WiFi.channel(indices[i]), rssi);
+      int quality = WifiGetRssiAsQuality(rssi);
+      int auth = WiFi.encryptionType(indices[i]);
+      char encryption[20];
+      WSContentSend_P(PSTR("<div><a href='#p' onclick='c(this)'>%s</a>&nbsp;(%d)&nbsp<span class='q'>%s %d%% (%d dBm)</span></div>"),
+        HtmlEscape(WiFi.SSID(indices[i])).c_str(),
+        WiFi.channel(indices[i]),
+        GetTextIndexed(encryption, sizeof(encryption), auth +1, kEncryptionType),
+        quality, rssi
+      );
+      delay(0);
+
+    }
+    WSContentSend_P(PSTR("<br>"));
+  }
+  WSContentEnd();
+}
+
 void HandleWifiConfiguration(void)
 {
   if (!HttpCheckPriviledgedAccess(!WifiIsInManagerMode())) { return; }
 
+  if (Webserver->hasArg("ws")) {
+    HandleWifiScanResults();
+    return;
+  }
+
   AddLog_P(LOG_LEVEL_DEBUG, S_LOG_HTTP, S_CONFIGURE_WIFI);
 
   if (Webserver->hasArg("save") && HTTP_MANAGER_RESET_ONLY != Web.state) {
@@ -1801,66 +2395,8 @@ void HandleWifiConfiguration(void)
 
   if (HTTP_MANAGER_RESET_ONLY != Web.state) {
     if (Webserver->hasArg("scan")) {
-#ifdef USE_EMULATION
-      UdpDisconnect();
-#endif  // USE_EMULATION
-      int n = WiFi.scanNetworks();
-      AddLog_P(LOG_LEVEL_DEBUG, PSTR(D_LOG_WIFI D_SCAN_DONE));
-
-      if (0 == n) {
-        AddLog_P(LOG_LEVEL_DEBUG, S_LOG_WIFI, S_NO_NETWORKS_FOUND);
-        WSContentSend_P(S_NO_NETWORKS_FOUND);
-        WSContentSend_P(PSTR(". " D_REFRESH_TO_SCAN_AGAIN "."));
-      } else {
-        //sort networks
-        int indices[n];
-        for (uint32_t i = 0; i < n; i++) {
-          indices[i] = i;
-        }
-
-        // RSSI SORT
-        for (uint32_t i = 0; i < n; i++) {
-          for (uint32_t j = i + 1; j < n; j++) {
-            if (WiFi.RSSI(indices[j]) > WiFi.RSSI(indices[i])) {
-              std::swap(indices[i], indices[j]);
-            }
-          }
-        }
-
-        // remove duplicates ( must be RSSI sorted )
-        String cssid;
-        for (uint32_t i = 0; i < n; i++) {
-          if (-1 == indices[i]) { continue; }
-          cssid = WiFi.SSID(indices[i]);
-          uint32_t cschn = WiFi.channel(indices[i]);
-          for (uint32_t j = i + 1; j < n; j++) {
-            if ((cssid == WiFi.SSID(indices[j])) && (cschn == WiFi.channel(indices[j]))) {
-              DEBUG_CORE_LOG(PSTR(D_LOG_WIFI D_DUPLICATE_ACCESSPOINT " %s"), WiFi.SSID(indices[j]).c_str());
-              indices[j] = -1;  // set dup aps to index -1
-            }
-          }
-        }
-
-        //display networks in page
-        for (uint32_t i = 0; i < n; i++) {
-          if (-1 == indices[i]) { continue; }  // skip dups
-          int32_t rssi = WiFi.RSSI(indices[i]);
-          DEBUG_CORE_LOG(PSTR(D_LOG_WIFI D_SSID " %s, " D_BSSID " %s, " D_CHANNEL " %d, " D_RSSI " %d"),
-            WiFi.SSID(indices[i]).c_str(), WiFi.BSSIDstr(indices[i]).c_str(), WiFi.channel(indices[i]), rssi);
-          int quality = WifiGetRssiAsQuality(rssi);
-          int auth = WiFi.encryptionType(indices[i]);
-          char encryption[20];
-          WSContentSend_P(PSTR("<div><a href='#p' onclick='c(this)'>%s</a>&nbsp;(%d)&nbsp<span class='q'>%s %d%% (%d dBm)</span></div>"),
-            HtmlEscape(WiFi.SSID(indices[i])).c_str(),
-            WiFi.channel(indices[i]),
-            GetTextIndexed(encryption, sizeof(encryption), auth +1, kEncryptionType),
-            quality, rssi
-          );
-          delay(0);
-
-        }
-        WSContentSend_P(PSTR("<br>"));
-      }
+      WifiScanStart();
+      WSContentSend_P(PSTR("<div id='ws'>" D_SCAN_FOR_WIFI_NETWORKS " ...</div><br><script>ws();</script>"));
     } else {
       WSContentSend_P(PSTR("<div><a href='/wi?scan='>" D_SCAN_FOR_WIFI_NETWORKS "</a></div><br>"));
     }
@@ -2514,7 +3050,7 @@ void HandleUploadLoop(void)
     else if (UPL_EFM8BB1 == Web.upload_file_type) {
       if (efm8bb1_update != nullptr) {    // We have carry over data since last write, i. e. a start but not an end
         ssize_t result = rf_glue_remnant_with_new_data_and_write(efm8bb1_update, upload.buf, upload.currentSize);
-        free(efm8bb1_update);
+        HeapFree(efm8bb1_update);
         efm8bb1_update = nullptr;
         if (result != 0) {
           Web.upload_error = abs(result);  // 2 = Not enough space, 8 = File invalid, 12, 13
@@ -2533,7 +3069,7 @@ void HandleUploadLoop(void)
         }
         // A remnant has been detected, allocate data for it plus a null termination byte
         size_t remnant_sz = upload.currentSize - result;
-        efm8bb1_update = (uint8_t *) malloc(remnant_sz + 1);
+        efm8bb1_update = (uint8_t *) HeapMalloc(HEAP_TAG_WEB, remnant_sz + 1);
         if (efm8bb1_update == nullptr) {
           Web.upload_error = 2;  // Not enough space - Unable to allocate memory to store new RF firmware
           return;
@@ -2597,6 +3133,7 @@ void HandleUploadLoop(void)
       if (valid_settings) {
         SettingsDefaultSet2();
         memcpy((char*)&Settings +16, settings_buffer +16, sizeof(Settings) -16);
+        SettingsTextIndex();
         Settings.version = buffer_version;  // Restore version and auto upgrade after restart
         SettingsBufferFree();
       } else {
@@ -2654,6 +3191,7 @@ void HandlePreflightRequest(void)
 
 void HandleHttpCommand(void)
 {
+  WEB_STAT(WEB_STAT_COMMAND);
   if (!HttpCheckPriviledgedAccess(false)) { return; }
 
   AddLog_P(LOG_LEVEL_DEBUG, PSTR(D_LOG_HTTP D_COMMAND));
@@ -2672,48 +3210,89 @@ void HandleHttpCommand(void)
   }
 
   WSContentBegin(200, CT_JSON);
-  uint32_t curridx = web_log_index;
   String svalue = Webserver->arg("cmnd");
   if (svalue.length() && (svalue.length() < MQTT_MAX_PACKET_SIZE)) {
+    uint32_t curridx = web_log_index;
     ExecuteWebCommand((char*)svalue.c_str(), SRC_WEBCOMMAND);
-    if (web_log_index != curridx) {
-      uint32_t counter = curridx;
-      WSContentSend_P(PSTR("{"));
-      bool cflg = false;
-      do {
-        char* tmp;
-        size_t len;
-        GetLog(counter, &tmp, &len);
-        if (len) {
-          // [14:49:36 MQTT: stat/wemos5/RESULT = {"POWER":"OFF"}] > [{"POWER":"OFF"}]
-          char* JSON = (char*)memchr(tmp, '{', len);
-          if (JSON) { // Is it a JSON message (and not only [15:26:08 MQT: stat/wemos5/POWER = O])
-            size_t JSONlen = len - (JSON - tmp);
-            if (JSONlen > sizeof(mqtt_data)) { JSONlen = sizeof(mqtt_data); }
-            char stemp[JSONlen];
-            strlcpy(stemp, JSON +1, JSONlen -2);
-            WSContentSend_P(PSTR("%s%s"), (cflg) ? "," : "", stemp);
-            cflg = true;
-          }
-        }
-        counter++;
-        counter &= 0xFF;
-        if (!counter) counter++;  // Skip 0 as it is not allowed
-      } while (counter != web_log_index);
-      WSContentSend_P(PSTR("}"));
+    HttpCommandResult(curridx);
+  } else {
+    // JSON array of commands in cmnds= or as POST body
+    svalue = Webserver->arg((Webserver->hasArg("cmnds")) ? "cmnds" : "plain");
+    if ((svalue.length() > 1) && ('[' == svalue[0]) && (svalue.length() < HTTP_BULK_SIZE)) {
+      HttpCommandBulk((char*)svalue.c_str());
     } else {
-      WSContentSend_P(PSTR("{\"" D_RSLT_WARNING "\":\"" D_ENABLE_WEBLOG_FOR_RESPONSE "\"}"));
+      WSContentSend_P(PSTR("{\"" D_RSLT_WARNING "\":\"" D_ENTER_COMMAND " cmnd=\"}"));
     }
-  } else {
-    WSContentSend_P(PSTR("{\"" D_RSLT_WARNING "\":\"" D_ENTER_COMMAND " cmnd=\"}"));
   }
   WSContentEnd();
 }
 
+void HttpCommandResult(uint32_t curridx)
+{
+  // Send the JSON results logged since web log index curridx as one object
+  if (web_log_index != curridx) {
+    uint32_t counter = curridx;
+    WSContentSend_P(PSTR("{"));
+    bool cflg = false;
+    do {
+      char* tmp;
+      size_t len;
+      GetLog(counter, &tmp, &len);
+      if (len) {
+        // [14:49:36 MQTT: stat/wemos5/RESULT = {"POWER":"OFF"}] > [{"POWER":"OFF"}]
+        char* JSON = (char*)memchr(tmp, '{', len);
+        if (JSON) { // Is it a JSON message (and not only [15:26:08 MQT: stat/wemos5/POWER = O])
+          size_t JSONlen = len - (JSON - tmp);
+          if (JSONlen > sizeof(mqtt_data)) { JSONlen = sizeof(mqtt_data); }
+          char stemp[JSONlen];
+          strlcpy(stemp, JSON +1, JSONlen -2);
+          WSContentSend_P(PSTR("%s%s"), (cflg) ? "," : "", stemp);
+          cflg = true;
+        }
+      }
+      counter++;
+      counter &= 0xFF;
+      if (!counter) counter++;  // Skip 0 as it is not allowed
+    } while (counter != web_log_index);
+    WSContentSend_P(PSTR("}"));
+  } else {
+    WSContentSend_P(PSTR("{\"" D_RSLT_WARNING "\":\"" D_ENABLE_WEBLOG_FOR_RESPONSE "\"}"));
+  }
+}
+
+void HttpCommandBulk(char* cmnds)
+{
+  // Execute ["Power1 on","Dimmer 50"] in order without backlog delay and stream [{"POWER1":"ON"},{"Dimmer":50}]
+  JsonParseBuffer jb;
+  JsonArray& list = jb.parseArray(cmnds);
+  if (!list.success()) {
+    WSContentSend_P(PSTR("{\"" D_RSLT_WARNING "\":\"" D_ENTER_COMMAND " cmnds=[]\"}"));
+    return;
+  }
+  WSContentSend_P(PSTR("["));
+  for (uint32_t i = 0; i < list.size(); i++) {
+    if (i) { WSContentSend_P(PSTR(",")); }
+    const char* cmnd = list[i];
+    uint32_t len = (cmnd) ? strlen(cmnd) : 0;
+    if (!len || (len >= MQTT_MAX_PACKET_SIZE)) {
+      WSContentSend_P(PSTR("{\"" D_RSLT_WARNING "\":\"" D_ENTER_COMMAND "\"}"));
+      continue;
+    }
+    char command[len +1];
+    strlcpy(command, cmnd, sizeof(command));  // Command execution may change its input
+    uint32_t curridx = web_log_index;
+    ExecuteWebCommand(command, SRC_WEBCOMMAND);
+    HttpCommandResult(curridx);
+    yield();
+  }
+  WSContentSend_P(PSTR("]"));
+}
+
 /*-------------------------------------------------------------------------------------------*/
 
 void HandleConsole(void)
 {
+  WEB_STAT(WEB_STAT_CONSOLE);
   if (!HttpCheckPriviledgedAccess()) { return; }
 
   if (Webserver->hasArg("c2")) {      // Console refresh requested
@@ -2724,7 +3303,12 @@ void HandleConsole(void)
   AddLog_P(LOG_LEVEL_DEBUG, S_LOG_HTTP, S_CONSOLE);
 
   WSContentStart_P(S_CONSOLE);
+#ifdef USE_WEBSOCKET
+  WSContentSend_P(HTTP_SCRIPT_WEBSOCKET, WEBSOCKET_PORT);
+  WSContentSend_P(HTTP_SCRIPT_CONSOL, Settings.web_refresh, WebSocket.token[WS_PAGE_CONSOLE]);
+#else
   WSContentSend_P(HTTP_SCRIPT_CONSOL, Settings.web_refresh);
+#endif  // USE_WEBSOCKET
   WSContentSendStyle();
   WSContentSend_P(HTTP_FORM_CMND);
   WSContentSpaceButton(BUTTON_MAIN);
@@ -2733,6 +3317,7 @@ void HandleConsole(void)
 
 void HandleConsoleRefresh(void)
 {
+  WEB_STAT(WEB_STAT_CONSOLE_REFRESH);
   bool cflg = true;
   uint32_t counter = 0;                // Initial start, should never be 0 again
 
@@ -2854,7 +3439,9 @@ String UrlEncode(const String& text)
 	return encoded;
 }
 
-int WebSend(char *buffer)
+const char kWebSendStatus[] PROGMEM = D_JSON_DONE "|" D_JSON_WRONG_PARAMETERS "|" D_JSON_CONNECT_FAILED "|" D_JSON_HOST_NOT_FOUND "|" D_JSON_MEMORY_ERROR;
+
+bool WebSendUrl(char *buffer, String &url)
 {
   // [tasmota] POWER1 ON                                               --> Sends http://tasmota/cm?cmnd=POWER1 ON
   // [192.168.178.86:80,admin:joker] POWER1 ON                        --> Sends http://hostname:80/cm?user=admin&password=joker&cmnd=POWER1 ON
@@ -2865,7 +3452,6 @@ int WebSend(char *buffer)
   char *user;
   char *password;
   char *command;
-  int status = 1;                             // Wrong parameters
 
                                               // buffer = |  [  192.168.178.86  :  80  ,  admin  :  joker  ]    POWER1 ON   |
   host = strtok_r(buffer, "]", &command);     // host = |  [  192.168.178.86  :  80  ,  admin  :  joker  |, command = |    POWER1 ON   |
@@ -2873,7 +3459,7 @@ int WebSend(char *buffer)
     RemoveSpace(host);                        // host = |[192.168.178.86:80,admin:joker|
     host++;                                   // host = |192.168.178.86:80,admin:joker| - Skip [
     host = strtok_r(host, ",", &user);        // host = |192.168.178.86:80|, user = |admin:joker|
-    String url = F("http://");                // url = |http://|
+    url = F("http://");                       // url = |http://|
     url += host;                              // url = |http://192.168.178.86:80|
 
     command = Trim(command);                  // command = |POWER1 ON| or |/any/link/starting/with/a/slash.php?log=123|
@@ -2892,7 +3478,18 @@ int WebSend(char *buffer)
     url += command;                           // url = |http://192.168.178.86/cm?cmnd=POWER1 ON|
 
     DEBUG_CORE_LOG(PSTR("WEB: Uri |%s|"), url.c_str());
+    return true;
+  }
+  return false;
+}
+
+#ifndef USE_WEBSEND_ASYNC
+int WebSend(char *buffer)
+{
+  int status = 1;                             // Wrong parameters
 
+  String url;
+  if (WebSendUrl(buffer, url)) {
 #if defined(ARDUINO_ESP8266_RELEASE_2_3_0) || defined(ARDUINO_ESP8266_RELEASE_2_4_0) || defined(ARDUINO_ESP8266_RELEASE_2_4_1) || defined(ARDUINO_ESP8266_RELEASE_2_4_2)
     HTTPClient http;
     if (http.begin(UrlEncode(url))) {         // UrlEncode(url) = |http://192.168.178.86/cm?cmnd=POWER1%20ON|
@@ -2917,6 +3514,7 @@ int WebSend(char *buffer)
             }
           }
           mqtt_data[j] = '\0';
+          ResponseSetLength(j);
           MqttPublishPrefixTopic_P(RESULT_OR_STAT, PSTR(D_CMND_WEBSEND));
 #ifdef USE_SCRIPT
 extern uint8_t tasm_cmd_activ;
@@ -2937,6 +3535,441 @@ extern uint8_t tasm_cmd_activ;
   }
   return status;
 }
+#endif  // USE_WEBSEND_ASYNC
+
+#ifdef USE_WEBSEND_ASYNC
+/*********************************************************************************************\
+ * Asynchronous WebSend and Sendmail
+ *
+ * WebSend and Sendmail queue up to WEBSEND_QUEUE requests which WebSendLoop() steps from loop():
+ * - WEBSEND_DNS resolves the host with an asynchronous lwIP lookup
+ * - WEBSEND_PROBE probes the host port with a non blocking TCP connect as MQTT does so the
+ *   client connect only takes place once the host answered
+ * - WEBSEND_HEADERS and WEBSEND_BODY read the HTTP/1.1 response as far as it has arrived
+ * A connection answered with a Content-Length is kept for WEBSEND_KEEP_ALIVE mSeconds and reused
+ * by the next request to the same host and port. A request taking more than WEBSEND_TIMEOUT
+ * mSeconds is abandoned.
+ *
+ * The result is published and passed to rules as {"WebSend":{"Host":"tasmota","Result":"Done","Code":200}}
+ * preceded by the response like before if USE_WEBSEND_RESPONSE is enabled. Sendmail is run from
+ * loop() in queue order, still blocking while sending as the SMTP clients are synchronous, with
+ * its result as {"Sendmail":{"Result":"Done"}}.
+\*********************************************************************************************/
+
+#include "lwip/dns.h"
+#ifdef ESP8266
+#include "lwip/tcp.h"
+#else  // ESP32
+#include "lwip/sockets.h"
+#endif  // ESP8266 - ESP32
+
+#ifndef WEBSEND_QUEUE
+#define WEBSEND_QUEUE          4         // Max number of queued WebSend and Sendmail requests
+#endif
+#ifndef WEBSEND_TIMEOUT
+#define WEBSEND_TIMEOUT        5000      // Max number of mSeconds per request
+#endif
+#ifndef WEBSEND_KEEP_ALIVE
+#define WEBSEND_KEEP_ALIVE     10000     // Max number of mSeconds an idle connection is kept for reuse
+#endif
+
+enum WebSendStates { WEBSEND_IDLE, WEBSEND_DNS, WEBSEND_PROBE, WEBSEND_HEADERS, WEBSEND_BODY };
+enum WebSendKinds { WEBSEND_HTTP, WEBSEND_MAIL };
+enum WebSendAsyncResults { WEBSEND_ASYNC_PENDING, WEBSEND_ASYNC_DONE, WEBSEND_ASYNC_FAILED };
+
+struct WEBSEND_ASYNC {
+  char *request[WEBSEND_QUEUE];          // Queued command parameters
+  uint8_t kind[WEBSEND_QUEUE];           // WebSendKinds
+  WiFiClient client;
+  String host;                           // Host of the active or kept connection
+  String path;                           // Url encoded path of the active request
+  String response;                       // Status line and header line or response
+  uint32_t deadline;                     // millis() the active request times out
+  uint32_t keep_until;                   // millis() the kept connection is closed
+  uint32_t address;                      // Resolved host address
+  uint32_t generation = 0;               // Identifies the DNS lookup of the active request
+  int32_t length;                        // Content-Length or -1 if unknown
+  uint16_t port;
+  int16_t code;                          // HTTP status code
+  volatile uint8_t result;               // WebSendAsyncResults of DNS lookup or TCP probe
+#ifdef ESP8266
+  struct tcp_pcb *pcb = nullptr;         // Pending TCP probe
+#else  // ESP32
+  int fd = -1;                           // Pending TCP probe socket
+#endif  // ESP8266 - ESP32
+  uint8_t count = 0;
+  uint8_t state = WEBSEND_IDLE;
+  bool keep_alive;
+} WebSendAsync;
+
+int WebSendQueue(uint32_t kind, char *buffer)
+{
+  if (WebSendAsync.count >= WEBSEND_QUEUE) { return 4; }  // Memory error
+  char *request = (char*)malloc(strlen(buffer) +1);
+  if (!request) { return 4; }
+  strcpy(request, buffer);
+  WebSendAsync.request[WebSendAsync.count] = request;
+  WebSendAsync.kind[WebSendAsync.count] = kind;
+  WebSendAsync.count++;
+  return 0;                              // Done - Queued
+}
+
+int WebSend(char *buffer)
+{
+  String url;
+  char *check = (char*)malloc(strlen(buffer) +1);
+  if (!check) { return 4; }              // Memory error
+  strcpy(check, buffer);
+  bool valid = WebSendUrl(check, url);   // Checks the parameters now while sending later
+  free(check);
+  if (!valid) { return 1; }              // Wrong parameters
+  return WebSendQueue(WEBSEND_HTTP, buffer);
+}
+
+void WebSendDnsFound(const char *name, const ip_addr_t *ipaddr, void *arg)
+{
+  // lwIP callback also used for cached and numeric hosts
+  if ((uint32_t)arg != WebSendAsync.generation) { return; }  // Lookup of an abandoned request
+  if (ipaddr) {
+#if LWIP_VERSION_MAJOR == 1
+    WebSendAsync.address = ipaddr->addr;
+#else
+    WebSendAsync.address = ip_2_ip4(ipaddr)->addr;
+#endif
+    WebSendAsync.result = WEBSEND_ASYNC_DONE;
+  } else {
+    WebSendAsync.result = WEBSEND_ASYNC_FAILED;
+  }
+}
+
+#ifdef ESP8266
+err_t WebSendProbeConnected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  // Host accepted the connection so close it again
+  WebSendAsync.pcb = nullptr;
+  WebSendAsync.result = WEBSEND_ASYNC_DONE;
+  tcp_err(pcb, nullptr);
+  if (tcp_close(pcb) != ERR_OK) {
+    tcp_abort(pcb);
+    return ERR_ABRT;
+  }
+  return ERR_OK;
+}
+
+void WebSendProbeError(void *arg, err_t err)
+{
+  // Connection refused or SYN retries exhausted, pcb is already freed by lwIP
+  WebSendAsync.pcb = nullptr;
+  WebSendAsync.result = WEBSEND_ASYNC_FAILED;
+}
+#endif  // ESP8266
+
+void WebSendProbeStart(void)
+{
+  WebSendAsync.result = WEBSEND_ASYNC_FAILED;
+#ifdef ESP8266
+  ip_addr_t addr;
+#if LWIP_VERSION_MAJOR == 1
+  addr.addr = WebSendAsync.address;
+#else
+  ip_addr_set_ip4_u32(&addr, WebSendAsync.address);
+#endif
+  WebSendAsync.pcb = tcp_new();
+  if (!WebSendAsync.pcb) { return; }
+  tcp_err(WebSendAsync.pcb, WebSendProbeError);
+  WebSendAsync.result = WEBSEND_ASYNC_PENDING;
+  if (tcp_connect(WebSendAsync.pcb, &addr, WebSendAsync.port, WebSendProbeConnected) != ERR_OK) {
+    tcp_err(WebSendAsync.pcb, nullptr);
+    tcp_abort(WebSendAsync.pcb);
+    WebSendAsync.pcb = nullptr;
+    WebSendAsync.result = WEBSEND_ASYNC_FAILED;
+  }
+#else  // ESP32
+  WebSendAsync.fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (WebSendAsync.fd < 0) { return; }
+  fcntl(WebSendAsync.fd, F_SETFL, fcntl(WebSendAsync.fd, F_GETFL, 0) | O_NONBLOCK);
+  struct sockaddr_in server;
+  memset(&server, 0, sizeof(server));
+  server.sin_family = AF_INET;
+  server.sin_addr.s_addr = WebSendAsync.address;
+  server.sin_port = htons(WebSendAsync.port);
+  if ((lwip_connect_r(WebSendAsync.fd, (struct sockaddr*)&server, sizeof(server)) < 0) && (errno != EINPROGRESS)) {
+    close(WebSendAsync.fd);
+    WebSendAsync.fd = -1;
+    return;
+  }
+  WebSendAsync.result = WEBSEND_ASYNC_PENDING;
+#endif  // ESP8266 - ESP32
+}
+
+#ifdef ESP32
+void WebSendProbeCheck(void)
+{
+  fd_set fdset;
+  FD_ZERO(&fdset);
+  FD_SET(WebSendAsync.fd, &fdset);
+  struct timeval tv = { 0, 0 };
+  int res = select(WebSendAsync.fd +1, nullptr, &fdset, nullptr, &tv);
+  if (0 == res) { return; }               // Still connecting
+  int sockerr = -1;
+  if (res > 0) {
+    socklen_t len = sizeof(sockerr);
+    getsockopt(WebSendAsync.fd, SOL_SOCKET, SO_ERROR, &sockerr, &len);
+  }
+  close(WebSendAsync.fd);
+  WebSendAsync.fd = -1;
+  WebSendAsync.result = (sockerr) ? WEBSEND_ASYNC_FAILED : WEBSEND_ASYNC_DONE;
+}
+#endif  // ESP32
+
+void WebSendProbeStop(void)
+{
+  // Abandon a pending DNS lookup or TCP probe
+  WebSendAsync.generation++;
+#ifdef ESP8266
+  if (WebSendAsync.pcb) {
+    tcp_err(WebSendAsync.pcb, nullptr);
+    tcp_abort(WebSendAsync.pcb);
+    WebSendAsync.pcb = nullptr;
+  }
+#else  // ESP32
+  if (WebSendAsync.fd >= 0) {
+    close(WebSendAsync.fd);
+    WebSendAsync.fd = -1;
+  }
+#endif  // ESP8266 - ESP32
+}
+
+void WebSendResult(uint32_t kind, uint32_t status)
+{
+  char stemp1[20];
+  GetTextIndexed(stemp1, sizeof(stemp1), status, kWebSendStatus);
+  if (WEBSEND_MAIL == kind) {
+    Response_P(PSTR("{\"" D_CMND_SENDMAIL "\":{\"Result\":\"%s\"}}"), stemp1);
+  } else {
+    Response_P(PSTR("{\"" D_CMND_WEBSEND "\":{\"Host\":\"%s\",\"Result\":\"%s\",\"Code\":%d}}"),
+      WebSendAsync.host.c_str(), stemp1, WebSendAsync.code);
+  }
+  MqttPublishPrefixTopic_P(RESULT_OR_STAT, (WEBSEND_MAIL == kind) ? PSTR(D_CMND_SENDMAIL) : PSTR(D_CMND_WEBSEND));
+  XdrvRulesProcess();
+}
+
+void WebSendDone(uint32_t status)
+{
+  WebSendProbeStop();
+  if (WebSendAsync.keep_alive && (WebSendAsync.length >= 0) && !status) {
+    WebSendAsync.keep_until = millis() + WEBSEND_KEEP_ALIVE;
+  } else {
+    WebSendAsync.client.stop();
+  }
+#ifdef USE_WEBSEND_RESPONSE
+  if (!status && ((HTTP_CODE_OK == WebSendAsync.code) || (HTTP_CODE_MOVED_PERMANENTLY == WebSendAsync.code))) {
+    // Return received data to the user
+    const char* read = WebSendAsync.response.c_str();
+    uint32_t j = 0;
+    char text = '.';
+    while (text != '\0') {
+      text = *read++;
+      if (text > 31) {                    // Remove control characters like linefeed
+        mqtt_data[j++] = text;
+        if (j == sizeof(mqtt_data) -2) { break; }
+      }
+    }
+    mqtt_data[j] = '\0';
+    ResponseSetLength(j);
+    MqttPublishPrefixTopic_P(RESULT_OR_STAT, PSTR(D_CMND_WEBSEND));
+    XdrvRulesProcess();
+  }
+#endif  // USE_WEBSEND_RESPONSE
+  WebSendAsync.response = "";
+  WebSendAsync.state = WEBSEND_IDLE;
+  WebSendResult(WEBSEND_HTTP, status);
+}
+
+void WebSendRequest(void)
+{
+  String request = F("GET ");
+  request += WebSendAsync.path;
+  request += F(" HTTP/1.1\r\nHost: ");
+  request += WebSendAsync.host;
+  request += F("\r\nConnection: keep-alive\r\n\r\n");
+  WebSendAsync.client.print(request);
+  WebSendAsync.response = "";
+  WebSendAsync.code = 0;
+  WebSendAsync.length = -1;
+  WebSendAsync.keep_alive = true;
+  WebSendAsync.state = WEBSEND_HEADERS;
+}
+
+void WebSendStart(char *buffer)
+{
+  String url;
+  WebSendUrl(buffer, url);               // url = |http://192.168.178.86:80/cm?cmnd=POWER1 ON|
+  url = UrlEncode(url.substring(7));     // url = |192.168.178.86:80/cm?cmnd=POWER1%20ON|
+  int slash = url.indexOf('/');
+  String host = url.substring(0, slash);
+  WebSendAsync.path = url.substring(slash);
+  uint16_t port = 80;
+  int colon = host.indexOf(':');
+  if (colon >= 0) {
+    port = host.substring(colon +1).toInt();
+    host = host.substring(0, colon);
+  }
+  WebSendAsync.deadline = millis() + WEBSEND_TIMEOUT;
+  WebSendAsync.code = 0;
+
+  if (WebSendAsync.client.connected() && !TimeReached(WebSendAsync.keep_until) &&
+      (port == WebSendAsync.port) && host.equalsIgnoreCase(WebSendAsync.host)) {
+    WebSendRequest();                    // Reuse the kept connection
+    return;
+  }
+  WebSendAsync.client.stop();
+  WebSendAsync.host = host;
+  WebSendAsync.port = port;
+
+  ip_addr_t addr;
+  WebSendAsync.generation++;
+  WebSendAsync.result = WEBSEND_ASYNC_PENDING;
+  WebSendAsync.state = WEBSEND_DNS;
+#ifdef USE_DNS_CACHE
+  err_t err = DnsCacheGetHostByName(WebSendAsync.host.c_str(), &addr, (dns_found_callback)WebSendDnsFound, (void*)WebSendAsync.generation);
+#else
+  err_t err = dns_gethostbyname(WebSendAsync.host.c_str(), &addr, (dns_found_callback)WebSendDnsFound, (void*)WebSendAsync.generation);
+#endif  // USE_DNS_CACHE
+  if (ERR_OK == err) {
+    WebSendDnsFound(WebSendAsync.host.c_str(), &addr, (void*)WebSendAsync.generation);
+  }
+  else if (err != ERR_INPROGRESS) {
+    WebSendAsync.result = WEBSEND_ASYNC_FAILED;
+  }
+}
+
+void WebSendHeader(void)
+{
+  // Response holds a status or header line without CR LF
+  String &line = WebSendAsync.response;
+  if (!WebSendAsync.code) {
+    int space = line.indexOf(' ');       // HTTP/1.1 200 OK
+    WebSendAsync.code = (space > 0) ? line.substring(space +1).toInt() : -1;
+    if (line.startsWith(F("HTTP/1.0"))) { WebSendAsync.keep_alive = false; }
+    return;
+  }
+  int colon = line.indexOf(':');
+  if (colon < 0) { return; }
+  String value = line.substring(colon +1);
+  value.trim();
+  line = line.substring(0, colon);
+  if (line.equalsIgnoreCase(F("Content-Length"))) {
+    WebSendAsync.length = value.toInt();
+  }
+  else if (line.equalsIgnoreCase(F("Connection")) && value.equalsIgnoreCase(F("close"))) {
+    WebSendAsync.keep_alive = false;
+  }
+  else if (line.equalsIgnoreCase(F("Transfer-Encoding"))) {
+    WebSendAsync.keep_alive = false;     // Chunked response is read until the host closes
+  }
+}
+
+void WebSendLoop(void)
+{
+  if (WEBSEND_IDLE == WebSendAsync.state) {
+    if (WebSendAsync.client.connected() && TimeReached(WebSendAsync.keep_until)) {
+      WebSendAsync.client.stop();        // Close the idle kept connection
+    }
+    if (!WebSendAsync.count) { return; }
+
+    char *request = WebSendAsync.request[0];
+    uint32_t kind = WebSendAsync.kind[0];
+    WebSendAsync.count--;
+    memmove(&WebSendAsync.request[0], &WebSendAsync.request[1], WebSendAsync.count * sizeof(char*));
+    memmove(&WebSendAsync.kind[0], &WebSendAsync.kind[1], WebSendAsync.count);
+#ifdef USE_SENDMAIL
+    if (WEBSEND_MAIL == kind) {
+      uint32_t status = SendMail(request);
+      free(request);
+      WebSendResult(WEBSEND_MAIL, status);
+      return;
+    }
+#endif  // USE_SENDMAIL
+    WebSendStart(request);
+    free(request);
+    return;
+  }
+
+  if (TimeReached(WebSendAsync.deadline)) {
+    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("WEB: WebSend %s timeout"), WebSendAsync.host.c_str());
+    WebSendAsync.keep_alive = false;
+    WebSendDone((WEBSEND_DNS == WebSendAsync.state) ? 3 : 2);  // Host not found or connection failed
+    return;
+  }
+
+  switch (WebSendAsync.state) {
+    case WEBSEND_DNS:
+      if (WEBSEND_ASYNC_PENDING == WebSendAsync.result) { return; }
+#ifdef USE_DNS_CACHE
+      DnsCacheStore(WebSendAsync.host.c_str(), (WEBSEND_ASYNC_DONE == WebSendAsync.result) ? WebSendAsync.address : 0);
+#endif  // USE_DNS_CACHE
+      if (WEBSEND_ASYNC_FAILED == WebSendAsync.result) {
+        WebSendDone(3);                  // Host not found
+        return;
+      }
+      WebSendProbeStart();
+      WebSendAsync.state = WEBSEND_PROBE;
+      break;
+    case WEBSEND_PROBE:
+#ifdef ESP32
+      if (WebSendAsync.fd >= 0) { WebSendProbeCheck(); }
+#endif  // ESP32
+      if (WEBSEND_ASYNC_PENDING == WebSendAsync.result) { return; }
+      if ((WEBSEND_ASYNC_FAILED == WebSendAsync.result) || !WebSendAsync.client.connect(IPAddress(WebSendAsync.address), WebSendAsync.port)) {
+        WebSendAsync.keep_alive = false;
+        WebSendDone(2);                  // Connection failed
+        return;
+      }
+      WebSendRequest();
+      break;
+    case WEBSEND_HEADERS:
+      while (WebSendAsync.client.available()) {
+        char c = WebSendAsync.client.read();
+        if ('\r' == c) { continue; }
+        if (c != '\n') {
+          if (WebSendAsync.response.length() < 256) { WebSendAsync.response += c; }
+          continue;
+        }
+        if (!WebSendAsync.response.length() && (WebSendAsync.code > 0)) {  // Empty line ends the headers
+          WebSendAsync.state = WEBSEND_BODY;
+          if (0 == WebSendAsync.length) {
+            WebSendDone(0);
+            return;
+          }
+          break;
+        }
+        WebSendHeader();
+        WebSendAsync.response = "";
+      }
+      if ((WEBSEND_HEADERS == WebSendAsync.state) && !WebSendAsync.client.connected()) {
+        WebSendAsync.keep_alive = false;
+        WebSendDone(2);                  // Connection failed
+      }
+      break;
+    case WEBSEND_BODY:
+      while (WebSendAsync.client.available()) {
+        char c = WebSendAsync.client.read();
+        if (WebSendAsync.response.length() < sizeof(mqtt_data) -2) { WebSendAsync.response += c; }
+        if ((WebSendAsync.length > 0) && (0 == --WebSendAsync.length)) {
+          WebSendDone(0);
+          return;
+        }
+      }
+      if (!WebSendAsync.client.connected()) {
+        WebSendAsync.keep_alive = false;
+        WebSendDone(0);                  // Response without Content-Length ends when the host closes
+      }
+      break;
+  }
+}
+
+#endif  // USE_WEBSEND_ASYNC
 
 bool JsonWebColor(const char* dataBuf)
 {
@@ -2950,7 +3983,7 @@ bool JsonWebColor(const char* dataBuf)
   RemoveSpace(dataBufLc);
   if (strlen(dataBufLc) < 9) { return false; }  // Workaround exception if empty JSON like {} - Needs checks
 
-  StaticJsonBuffer<450> jb;  // 421 from https://arduinojson.org/v5/assistant/
+  JsonTempBuffer<450> jb;  // 421 from https://arduinojson.org/v5/assistant/
   JsonObject& obj = jb.parseObject(dataBufLc);
   if (!obj.success()) { return false; }
 
@@ -2966,8 +3999,6 @@ bool JsonWebColor(const char* dataBuf)
   return true;
 }
 
-const char kWebSendStatus[] PROGMEM = D_JSON_DONE "|" D_JSON_WRONG_PARAMETERS "|" D_JSON_CONNECT_FAILED "|" D_JSON_HOST_NOT_FOUND "|" D_JSON_MEMORY_ERROR;
-
 const char kWebCommands[] PROGMEM = "|"  // No prefix
 #ifdef USE_EMULATION
   D_CMND_EMULATION "|"
@@ -2975,8 +4006,12 @@ const char kWebCommands[] PROGMEM = "|"  // No prefix
 #ifdef USE_SENDMAIL
   D_CMND_SENDMAIL "|"
 #endif
-  D_CMND_WEBSERVER "|" D_CMND_WEBPASSWORD "|" D_CMND_WEBLOG "|" D_CMND_WEBREFRESH "|" D_CMND_WEBSEND "|" D_CMND_WEBCOLOR "|"
-  D_CMND_WEBSENSOR "|" D_CMND_WEBBUTTON "|" D_CMND_CORS;
+  D_CMND_WEBSERVER "|" D_CMND_WEBPASSWORD "|" D_CMND_WEBLOG "|" D_CMND_WEBLOGSIZE "|" D_CMND_WEBREFRESH "|" D_CMND_WEBSEND "|" D_CMND_WEBCOLOR "|"
+  D_CMND_WEBSENSOR "|" D_CMND_WEBBUTTON "|" D_CMND_CORS
+#ifdef USE_WEB_STATS
+  "|" D_CMND_WEBSTATS
+#endif
+  ;
 
 void (* const WebCommand[])(void) PROGMEM = {
 #ifdef USE_EMULATION
@@ -2985,8 +4020,12 @@ void (* const WebCommand[])(void) PROGMEM = {
 #ifdef USE_SENDMAIL
   &CmndSendmail,
 #endif
-  &CmndWebServer, &CmndWebPassword, &CmndWeblog, &CmndWebRefresh, &CmndWebSend, &CmndWebColor,
-  &CmndWebSensor, &CmndWebButton, &CmndCors };
+  &CmndWebServer, &CmndWebPassword, &CmndWeblog, &CmndWebLogSize, &CmndWebRefresh, &CmndWebSend, &CmndWebColor,
+  &CmndWebSensor, &CmndWebButton, &CmndCors
+#ifdef USE_WEB_STATS
+  , &CmndWebStats
+#endif
+  };
 
 /*********************************************************************************************\
  * Commands
@@ -3018,7 +4057,11 @@ void CmndEmulation(void)
 void CmndSendmail(void)
 {
   if (XdrvMailbox.data_len > 0) {
+#ifdef USE_WEBSEND_ASYNC
+    uint8_t result = WebSendQueue(WEBSEND_MAIL, XdrvMailbox.data);
+#else
     uint8_t result = SendMail(XdrvMailbox.data);
+#endif  // USE_WEBSEND_ASYNC
     char stemp1[20];
     ResponseCmndChar(GetTextIndexed(stemp1, sizeof(stemp1), result, kWebSendStatus));
   }
@@ -3057,6 +4100,17 @@ void CmndWeblog(void)
   ResponseCmndNumber(Settings.weblog_level);
 }
 
+void CmndWebLogSize(void)
+{
+  // WebLogSize 0         - Default size of 4000 bytes or 32000 bytes when PSRAM is present
+  // WebLogSize 1..63     - Size in kB, ESP8266 up to 8 kB
+  if ((XdrvMailbox.payload >= 0) && (XdrvMailbox.payload <= WEB_LOG_KB_MAX)) {
+    Settings.web_log_kb = XdrvMailbox.payload;
+    WebLogAlloc();                               // Clears the log
+  }
+  ResponseCmndNumber(web_log_size);
+}
+
 void CmndWebRefresh(void)
 {
   if ((XdrvMailbox.payload > 999) && (XdrvMailbox.payload <= 10000)) {
@@ -3131,6 +4185,324 @@ void CmndCors(void)
   ResponseCmndChar(SettingsText(SET_CORS));
 }
 
+#ifdef USE_WEB_STATS
+void CmndWebStats(void)
+{
+  if (0 == XdrvMailbox.payload) {
+    memset(&WebStats.stat, 0, sizeof(WebStats.stat));
+  }
+  WebStatsShow();
+}
+#endif  // USE_WEB_STATS
+
+#ifdef USE_WEBSOCKET
+/*********************************************************************************************\
+ * WebSocket push
+ *
+ * Root and console pages open a WebSocket to WEBSOCKET_PORT and get the status section and new
+ * log lines pushed when they change instead of polling every WebRefresh mSeconds. The status
+ * section is built once per WebRefresh for all open root pages and only sent to pages missing
+ * that version. Console pages send commands as text messages. The path token is only handed out
+ * by authenticated pages. Pages fall back to polling when the WebSocket can not be opened.
+\*********************************************************************************************/
+
+#ifdef ESP8266
+#include <t_bearssl_hash.h>
+#else
+#include "mbedtls/sha1.h"
+#endif  // ESP8266
+#include <base64.hpp>
+
+const uint16_t WEBSOCKET_RX_SIZE = INPUT_BUFFER_SIZE + 8;  // Masked frame holding a full console command
+const uint16_t WEBSOCKET_HANDSHAKE_TIMEOUT = 2000;         // mSeconds
+
+const char WEBSOCKET_GUID[] PROGMEM = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+enum WebSocketOpcodes { WS_OP_TEXT = 0x01, WS_OP_CLOSE = 0x08, WS_OP_PING = 0x09, WS_OP_PONG = 0x0A };
+
+void WebSocketBegin(void)
+{
+  if (!WebSocket.server) {
+    WebSocket.server = HEAP_NEW(HEAP_TAG_WEB) WiFiServer(WEBSOCKET_PORT);
+    for (uint32_t i = 0; i < WS_PAGE_NONE; i++) {
+      WebSocket.token[i] = random(0x7FFFFFFF) ^ (random(0xFFFF) << 16);
+    }
+  }
+  WebSocket.server->begin();
+}
+
+void WebSocketClose(struct WEBSOCKET_CLIENT *ws)
+{
+  ws->client.stop();
+  HeapFree(ws->rx);
+  ws->rx = nullptr;
+  ws->state = WS_FREE;
+}
+
+void WebSocketStop(void)
+{
+  if (!WebSocket.server) { return; }
+  for (uint32_t i = 0; i < WEBSOCKET_MAX_CLIENTS; i++) {
+    if (WebSocket.client[i].state != WS_FREE) { WebSocketClose(&WebSocket.client[i]); }
+  }
+  WebSocket.server->stop();
+}
+
+void WebSocketSend(struct WEBSOCKET_CLIENT *ws, uint32_t opcode, const char *data, uint32_t len)
+{
+  // Server frames are not masked
+  uint8_t header[4];
+  uint32_t header_len = 2;
+  header[0] = 0x80 | opcode;                // Final fragment
+  if (len < 126) {
+    header[1] = len;
+  } else {
+    if (len > 0xFFFF) { len = 0xFFFF; }
+    header[1] = 126;
+    header[2] = len >> 8;
+    header[3] = len;
+    header_len = 4;
+  }
+  ws->client.write(header, header_len);
+  if (len) { ws->client.write((const uint8_t*)data, len); }
+}
+
+void WebSocketAcceptKey(const char *key, char *accept)
+{
+  // accept is 29 chars: base64 of the SHA-1 of key and GUID
+  char guid[sizeof(WEBSOCKET_GUID)];
+  strcpy_P(guid, WEBSOCKET_GUID);
+  uint8_t digest[20];
+#ifdef ESP8266
+  br_sha1_context ctx;
+  br_sha1_init(&ctx);
+  br_sha1_update(&ctx, key, strlen(key));
+  br_sha1_update(&ctx, guid, strlen(guid));
+  br_sha1_out(&ctx, digest);
+#else
+  mbedtls_sha1_context ctx;
+  mbedtls_sha1_init(&ctx);
+  mbedtls_sha1_starts_ret(&ctx);
+  mbedtls_sha1_update_ret(&ctx, (const uint8_t*)key, strlen(key));
+  mbedtls_sha1_update_ret(&ctx, (const uint8_t*)guid, strlen(guid));
+  mbedtls_sha1_finish_ret(&ctx, digest);
+  mbedtls_sha1_free(&ctx);
+#endif  // ESP8266
+  encode_base64(digest, sizeof(digest), (unsigned char*)accept);
+}
+
+void WebSocketHandshakeLine(struct WEBSOCKET_CLIENT *ws, char *line)
+{
+  if (!strncmp_P(line, PSTR("GET /"), 5)) {
+    // GET /?t=<token> or GET /cs?t=<token>
+    char *path = line +4;
+    uint32_t page = (!strncmp_P(path, PSTR("/?t="), 4)) ? WS_PAGE_ROOT : (!strncmp_P(path, PSTR("/cs?t="), 6)) ? WS_PAGE_CONSOLE : WS_PAGE_NONE;
+    if (page < WS_PAGE_NONE) {
+      char *token = strchr(path, '=') +1;
+      if ((strtoul(token, nullptr, 16) == WebSocket.token[page]) && ((WS_PAGE_ROOT == page) || (HTTP_USER != Web.state))) {
+        ws->page = page;
+      }
+    }
+  }
+  else if (!strncasecmp_P(line, PSTR("Sec-WebSocket-Key:"), 18)) {
+    char *key = line +18;
+    while (' ' == *key) { key++; }
+    strlcpy(ws->key, key, sizeof(ws->key));
+  }
+  else if (!*line) {
+    // End of request headers
+    if ((WS_PAGE_NONE == ws->page) || !ws->key[0]) {
+      ws->client.print(F("HTTP/1.1 403 Forbidden\r\nConnection: close\r\n\r\n"));
+      WebSocketClose(ws);
+      return;
+    }
+    char accept[32];
+    WebSocketAcceptKey(ws->key, accept);
+    char response[160];
+    snprintf_P(response, sizeof(response), PSTR("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n"), accept);
+    ws->client.print(response);
+    ws->client.setNoDelay(true);
+    ws->state = WS_OPEN;
+    ws->rx_len = 0;
+    ws->log_index = 0;
+    ws->status_hash = 0;
+    WebSocket.status_time = millis();       // Push status to the new page at once
+  }
+}
+
+void WebSocketHandshake(struct WEBSOCKET_CLIENT *ws)
+{
+  if (TimePassedSince(ws->start) > WEBSOCKET_HANDSHAKE_TIMEOUT) {
+    WebSocketClose(ws);
+    return;
+  }
+  while ((WS_HANDSHAKE == ws->state) && ws->client.available()) {
+    char c = ws->client.read();
+    if ('\r' == c) { continue; }
+    if ('\n' == c) {
+      ws->rx[ws->rx_len] = '\0';
+      ws->rx_len = 0;
+      if (!ws->skip_line) { WebSocketHandshakeLine(ws, ws->rx); }
+      ws->skip_line = false;
+    }
+    else if (ws->rx_len < WEBSOCKET_RX_SIZE -1) {
+      ws->rx[ws->rx_len++] = c;
+    } else {
+      ws->skip_line = true;                 // Long headers like cookies are not needed
+    }
+  }
+}
+
+void WebSocketReceive(struct WEBSOCKET_CLIENT *ws)
+{
+  int available = ws->client.available();
+  if (available > 0) {
+    uint32_t room = WEBSOCKET_RX_SIZE - ws->rx_len;
+    ws->rx_len += ws->client.read((uint8_t*)ws->rx + ws->rx_len, ((uint32_t)available < room) ? available : room);
+  }
+
+  while (ws->rx_len >= 2) {
+    uint8_t *frame = (uint8_t*)ws->rx;
+    uint32_t opcode = frame[0] & 0x0F;
+    uint32_t len = frame[1] & 0x7F;
+    uint32_t header_len = 6;                // Client frames are always masked
+    if (!(frame[1] & 0x80) || (len > 126)) {
+      WebSocketClose(ws);                   // Unmasked or larger than a console command
+      return;
+    }
+    if (126 == len) {
+      if (ws->rx_len < 4) { return; }
+      len = frame[2] << 8 | frame[3];
+      header_len = 8;
+    }
+    if (header_len + len > WEBSOCKET_RX_SIZE -1) {
+      WebSocketClose(ws);
+      return;
+    }
+    if (ws->rx_len < header_len + len) { return; }  // Wait for rest of frame
+
+    uint8_t *mask = frame + header_len -4;
+    char *payload = ws->rx + header_len;
+    for (uint32_t i = 0; i < len; i++) {
+      payload[i] ^= mask[i & 3];
+    }
+    switch (opcode) {
+      case WS_OP_TEXT:
+        if ((WS_PAGE_CONSOLE == ws->page) && len) {
+          char saved = payload[len];
+          payload[len] = '\0';
+          AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_COMMAND "%s"), payload);
+          ExecuteWebCommand(payload, SRC_WEBCONSOLE);
+          payload[len] = saved;
+        }
+        break;
+      case WS_OP_PING:
+        WebSocketSend(ws, WS_OP_PONG, payload, len);
+        break;
+      case WS_OP_CLOSE:
+        WebSocketSend(ws, WS_OP_CLOSE, payload, (len < 2) ? len : 2);  // Echo status code
+        WebSocketClose(ws);
+        return;
+    }
+    ws->rx_len -= header_len + len;
+    memmove(ws->rx, ws->rx + header_len + len, ws->rx_len);
+  }
+}
+
+void WebSocketPushLog(struct WEBSOCKET_CLIENT *ws)
+{
+  uint32_t counter = ws->log_index;
+  if (counter == web_log_index) { return; }
+
+  String lines;
+  bool cflg = (counter != 0);
+  if (!counter) { counter = web_log_index; }  // Whole log
+  do {
+    char* tmp;
+    size_t len;
+    GetLog(counter, &tmp, &len);
+    if (len) {
+      char stemp[len +1];
+      strlcpy(stemp, tmp, len);
+      if (cflg) { lines += '\n'; }
+      lines += stemp;
+      cflg = true;
+    }
+    counter++;
+    counter &= 0xFF;
+    if (!counter) { counter++; }            // Skip log index 0 as it is not allowed
+  } while (counter != web_log_index);
+  ws->log_index = web_log_index;
+  if (lines.length()) { WebSocketSend(ws, WS_OP_TEXT, lines.c_str(), lines.length()); }
+}
+
+void WebSocketPushStatus(void)
+{
+  // Build status section once for all root pages
+  bool wanted = false;
+  for (uint32_t i = 0; i < WEBSOCKET_MAX_CLIENTS; i++) {
+    wanted |= ((WS_OPEN == WebSocket.client[i].state) && (WS_PAGE_ROOT == WebSocket.client[i].page));
+  }
+  if (!wanted || !TimeReached(WebSocket.status_time)) { return; }
+  SetNextTimeInterval(WebSocket.status_time, Settings.web_refresh);
+
+  String status;
+  Web.capture = &status;
+  WebRootStatus();
+  Web.capture = nullptr;
+  uint32_t hash = GetHash(status.c_str(), status.length());
+
+  for (uint32_t i = 0; i < WEBSOCKET_MAX_CLIENTS; i++) {
+    WEBSOCKET_CLIENT *ws = &WebSocket.client[i];
+    if ((WS_OPEN == ws->state) && (WS_PAGE_ROOT == ws->page) && (ws->status_hash != hash)) {
+      WebSocketSend(ws, WS_OP_TEXT, status.c_str(), status.length());
+      ws->status_hash = hash;
+    }
+  }
+}
+
+void WebSocketLoop(void)
+{
+  if (!WebSocket.server || !Web.state) { return; }
+
+  WiFiClient client = WebSocket.server->available();
+  if (client) {
+    uint32_t i = 0;
+    while ((i < WEBSOCKET_MAX_CLIENTS) && (WebSocket.client[i].state != WS_FREE)) { i++; }
+    char *rx = (i < WEBSOCKET_MAX_CLIENTS) ? (char*)HeapMalloc(HEAP_TAG_WEB, WEBSOCKET_RX_SIZE) : nullptr;
+    if (rx) {
+      WEBSOCKET_CLIENT *ws = &WebSocket.client[i];
+      ws->client = client;
+      ws->rx = rx;
+      ws->rx_len = 0;
+      ws->skip_line = false;
+      ws->key[0] = '\0';
+      ws->page = WS_PAGE_NONE;
+      ws->start = millis();
+      ws->state = WS_HANDSHAKE;
+    } else {
+      client.stop();                        // All in use
+    }
+  }
+
+  for (uint32_t i = 0; i < WEBSOCKET_MAX_CLIENTS; i++) {
+    WEBSOCKET_CLIENT *ws = &WebSocket.client[i];
+    if (WS_FREE == ws->state) { continue; }
+    if (!ws->client.connected()) {
+      WebSocketClose(ws);
+    }
+    else if (WS_HANDSHAKE == ws->state) {
+      WebSocketHandshake(ws);
+    }
+    else {
+      WebSocketReceive(ws);
+      if ((WS_OPEN == ws->state) && (WS_PAGE_CONSOLE == ws->page)) { WebSocketPushLog(ws); }
+    }
+  }
+  WebSocketPushStatus();
+}
+#endif  // USE_WEBSOCKET
+
 /*********************************************************************************************\
  * Interface
 \*********************************************************************************************/
@@ -3140,8 +4512,17 @@ bool Xdrv01(uint8_t function)
   bool result = false;
 
   switch (function) {
+    case FUNC_PRE_INIT:
+      XdrvSubscribe(FUNC_LOOP);
+      break;
     case FUNC_LOOP:
       PollDnsWebserver();
+#ifdef USE_WEBSEND_ASYNC
+      WebSendLoop();
+#endif  // USE_WEBSEND_ASYNC
+#ifdef USE_WEBSOCKET
+      WebSocketLoop();
+#endif  // USE_WEBSOCKET
 #ifdef USE_EMULATION
       if (Settings.flag2.emulation) { PollUdp(); }
 #endif  // USE_EMULATION
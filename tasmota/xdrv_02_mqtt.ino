@@ -38,7 +38,11 @@ const char kMqttCommands[] PROGMEM = "|"  // No prefix
 #endif
   D_CMND_MQTTHOST "|" D_CMND_MQTTPORT "|" D_CMND_MQTTRETRY "|" D_CMND_STATETEXT "|" D_CMND_MQTTCLIENT "|"
   D_CMND_FULLTOPIC "|" D_CMND_PREFIX "|" D_CMND_GROUPTOPIC "|" D_CMND_TOPIC "|" D_CMND_PUBLISH "|" D_CMND_MQTTLOG "|"
-  D_CMND_BUTTONTOPIC "|" D_CMND_SWITCHTOPIC "|" D_CMND_BUTTONRETAIN "|" D_CMND_SWITCHRETAIN "|" D_CMND_POWERRETAIN "|" D_CMND_SENSORRETAIN ;
+  D_CMND_BUTTONTOPIC "|" D_CMND_SWITCHTOPIC "|" D_CMND_BUTTONRETAIN "|" D_CMND_SWITCHRETAIN "|" D_CMND_POWERRETAIN "|" D_CMND_SENSORRETAIN
+#ifdef USE_MQTT_COMPRESSION
+  "|" D_CMND_MQTTCOMPRESS
+#endif
+  ;
 
 void (* const MqttCommand[])(void) PROGMEM = {
 #if defined(USE_MQTT_TLS) && !defined(USE_MQTT_TLS_CA_CERT)
@@ -50,16 +54,80 @@ void (* const MqttCommand[])(void) PROGMEM = {
 #endif
   &CmndMqttHost, &CmndMqttPort, &CmndMqttRetry, &CmndStateText, &CmndMqttClient,
   &CmndFullTopic, &CmndPrefix, &CmndGroupTopic, &CmndTopic, &CmndPublish, &CmndMqttlog,
-  &CmndButtonTopic, &CmndSwitchTopic, &CmndButtonRetain, &CmndSwitchRetain, &CmndPowerRetain, &CmndSensorRetain };
+  &CmndButtonTopic, &CmndSwitchTopic, &CmndButtonRetain, &CmndSwitchRetain, &CmndPowerRetain, &CmndSensorRetain
+#ifdef USE_MQTT_COMPRESSION
+  , &CmndMqttCompress
+#endif
+  };
+
+enum MqttConnectStates { MQTT_CONNECT_IDLE, MQTT_CONNECT_DNS, MQTT_CONNECT_TCP, MQTT_CONNECT_BROKER };
 
 struct MQTT {
+  uint32_t publish_count = 0;            // Number of MqttPublish() calls
   uint16_t connect_count = 0;            // MQTT re-connect count
   uint16_t retry_counter = 1;            // MQTT connection retry counter
+  uint16_t stream_length = 0;            // MQTT streamed publish remaining payload length
   uint8_t initial_connection_state = 2;  // MQTT connection messages state
+  uint8_t connect_state = MQTT_CONNECT_IDLE;  // MqttConnectStates of non blocking connect
   bool connected = false;                // MQTT virtual connection status
   bool allowed = false;                  // MQTT enabled and parameters valid
 } Mqtt;
 
+#ifdef USE_MQTT_COMPRESSION
+#define MQTT_COMPRESS_SUFFIX   "Z"       // Last topic level of compressed payloads
+const uint16_t MQTT_COMPRESS_MIN = 64;   // Smallest payload size set by command MqttCompress
+#endif  // USE_MQTT_COMPRESSION
+
+#ifdef USE_MQTT_QUEUE
+#ifndef MQTT_QUEUE_DEPTH
+#define MQTT_QUEUE_DEPTH       16        // Max number of queued publishes
+#endif
+#ifndef MQTT_QUEUE_BUDGET
+#define MQTT_QUEUE_BUDGET      5         // Max number of mSeconds per loop spent on sending queued publishes
+#endif
+
+struct MQTT_QUEUE {
+  char *entry[MQTT_QUEUE_DEPTH];         // Retained flag, topic and payload
+  uint32_t drops = 0;                    // Number of queued publishes failed or lost by disconnect
+  uint8_t head = 0;
+  uint8_t count = 0;
+  uint8_t max = 0;                       // Max number of queued publishes seen
+} MqttQueue;
+#endif  // USE_MQTT_QUEUE
+
+#ifndef ESP32
+#undef USE_NETWORK_TASK                  // FreeRTOS task on the other core is ESP32 only
+#endif
+
+#ifdef USE_NETWORK_TASK
+#ifndef NET_QUEUE_DEPTH
+#define NET_QUEUE_DEPTH        16        // Max number of messages in each direction
+#endif
+const uint8_t NET_TASK_INTERVAL = 5;     // mSeconds between network task polls
+const uint8_t NET_RECEIVE_BUDGET = 4;    // Max number of received messages handled per loop
+
+struct NET_MESSAGE {
+  uint16_t topic_len;
+  uint16_t payload_len;
+  bool retained;
+  char data[];                           // Topic, '\0' and payload
+};
+
+struct {
+  TaskHandle_t task = nullptr;
+  QueueHandle_t send = nullptr;          // NET_MESSAGE* from loop() to the network task
+  QueueHandle_t receive = nullptr;       // NET_MESSAGE* from the network task to loop()
+  SemaphoreHandle_t mutex = nullptr;     // Owner of MqttClient
+  uint32_t sent = 0;
+  uint32_t received = 0;
+  uint32_t send_drops = 0;               // Publishes lost by a full queue or a failed send
+  uint32_t receive_drops = 0;
+  uint8_t lock_depth = 0;                // Nested MqttLock() calls of loop()
+  volatile bool connecting = false;      // Broker handshake requested from or running on the network task
+  volatile bool connect_failed = false;
+} Net;
+#endif  // USE_NETWORK_TASK
+
 #ifdef USE_MQTT_TLS
 
 #ifdef USE_MQTT_AWS_IOT
@@ -173,10 +241,63 @@ PubSubClient MqttClient;
 PubSubClient MqttClient(EspClient);
 #endif
 
+#ifdef USE_MQTT_TLS
+/*********************************************************************************************\
+ * TLS session cache
+ *
+ * The session of the last full TLS handshake is kept in RTC memory blocks 64 to 87, between
+ * the crash recorder and RtcReboot, so a reconnect after a restart can resume it and skip the
+ * certificate check and key exchange taking seconds on ESP8266.
+\*********************************************************************************************/
+
+const uint32_t MQTT_TLS_SESSION_MAGIC = 0x544C5353;  // TLSS
+const uint32_t MQTT_TLS_SESSION_RTC = 64;            // RTC memory block offset
+
+struct MQTT_TLS_SESSION {
+  uint32_t magic;
+  uint32_t server;                                   // Crc32 of broker and fingerprints the session belongs to
+  br_ssl_session_parameters session;
+};
+
+uint32_t MqttTlsServerCrc(void)
+{
+  uint32_t crc = GetCfgCrc32((uint8_t*)SettingsText(SET_MQTT_HOST), strlen(SettingsText(SET_MQTT_HOST))) ^ Settings.mqtt_port;
+#ifndef USE_MQTT_TLS_CA_CERT
+  crc ^= GetCfgCrc32((uint8_t*)Settings.mqtt_fingerprint, sizeof(Settings.mqtt_fingerprint));
+#endif
+  return crc;
+}
+
+void MqttTlsSessionLoad(void)
+{
+#ifdef ESP8266
+  MQTT_TLS_SESSION rtc;
+  ESP.rtcUserMemoryRead(MQTT_TLS_SESSION_RTC, (uint32_t*)&rtc, sizeof(rtc));
+  if ((MQTT_TLS_SESSION_MAGIC == rtc.magic) && (MqttTlsServerCrc() == rtc.server)) {
+    tlsClient->setSession(&rtc.session);
+  }
+#endif  // ESP8266
+}
+
+void MqttTlsSessionSave(void)
+{
+#ifdef ESP8266
+  MQTT_TLS_SESSION rtc;
+  memset(&rtc, 0, sizeof(rtc));
+  if (tlsClient->getSession(&rtc.session)) {
+    rtc.magic = MQTT_TLS_SESSION_MAGIC;
+    rtc.server = MqttTlsServerCrc();
+  }
+  ESP.rtcUserMemoryWrite(MQTT_TLS_SESSION_RTC, (uint32_t*)&rtc, sizeof(rtc));
+#endif  // ESP8266
+}
+#endif  // USE_MQTT_TLS
+
 void MqttInit(void)
 {
 #ifdef USE_MQTT_TLS
   tlsClient = new BearSSL::WiFiClientSecure_light(1024,1024);
+  MqttTlsSessionLoad();
 
 #ifdef USE_MQTT_AWS_IOT
   loadTlsDir();   // load key and certificate data from Flash
@@ -197,29 +318,188 @@ void MqttInit(void)
 #endif // USE_MQTT_TLS
 }
 
+#ifdef USE_NETWORK_TASK
+/*********************************************************************************************\
+ * Network task
+ *
+ * A task on NET_TASK_CORE polls the MQTT socket and sends publishes so a slow broker or TLS
+ * record never delays buttons, switches and lights in loop(). Messages are exchanged through
+ * FreeRTOS queues of pointers used without waiting by either side. Received messages are handled
+ * by MqttDataHandler() from loop().
+ *
+ * The broker (and TLS) handshake runs on the task while loop() only checks its progress. DNS,
+ * the TCP probe, subscribing and streamed publishes stay in loop() holding the client with
+ * MqttLock() which first sends the queued publishes to keep their order. The task only waits for
+ * the client while loop() holds it. The web task of USE_WEBSERVER_TASK runs on the same core.
+\*********************************************************************************************/
+
+NET_MESSAGE* NetMessage(const char* topic, const uint8_t* payload, uint32_t len, bool retained)
+{
+  uint32_t topic_len = strlen(topic);
+  NET_MESSAGE *message = (NET_MESSAGE*)malloc(sizeof(NET_MESSAGE) + topic_len +1 + len +1);
+  if (!message) { return nullptr; }
+  message->topic_len = topic_len;
+  message->payload_len = len;
+  message->retained = retained;
+  memcpy(message->data, topic, topic_len +1);
+  memcpy(message->data + topic_len +1, payload, len);
+  message->data[topic_len +1 + len] = '\0';
+  return message;
+}
+
+void NetSendMessages(void)
+{
+  // Called by the owner of MqttClient
+  NET_MESSAGE *message;
+  while (pdTRUE == xQueueReceive(Net.send, &message, 0)) {
+    if (MqttClient.publish(message->data, (const uint8_t*)message->data + message->topic_len +1, message->payload_len, message->retained)) {
+      Net.sent++;
+    } else {
+      Net.send_drops++;
+    }
+    free(message);
+  }
+}
+
+void NetReceive(char* topic, uint8_t* payload, unsigned int len)
+{
+  if (xTaskGetCurrentTaskHandle() != Net.task) {
+    MqttDataHandler(topic, payload, len);  // Received while loop() holds the client
+    return;
+  }
+  NET_MESSAGE *message = NetMessage(topic, payload, len, false);
+  if (!message || (pdTRUE != xQueueSend(Net.receive, &message, 0))) {
+    free(message);
+    Net.receive_drops++;
+  }
+}
+
+void NetTask(void *arg)
+{
+  NET_MESSAGE *message;
+  while (true) {
+    xSemaphoreTakeRecursive(Net.mutex, portMAX_DELAY);
+    if (Net.connecting) {
+      Net.connect_failed = !MqttBeginConnect();
+      Net.connecting = false;
+    }
+    if (MqttClient.connected()) {
+      MqttClient.loop();
+      NetSendMessages();
+    } else {
+      while (pdTRUE == xQueueReceive(Net.send, &message, 0)) {  // Not connected so publish fails as without the task
+        free(message);
+        Net.send_drops++;
+      }
+    }
+    xSemaphoreGiveRecursive(Net.mutex);
+    vTaskDelay(pdMS_TO_TICKS(NET_TASK_INTERVAL));
+  }
+}
+
+void NetTaskInit(void)
+{
+  Net.send = xQueueCreate(NET_QUEUE_DEPTH, sizeof(NET_MESSAGE*));
+  Net.receive = xQueueCreate(NET_QUEUE_DEPTH, sizeof(NET_MESSAGE*));
+  Net.mutex = xSemaphoreCreateRecursiveMutex();
+  if (!Net.send || !Net.receive || !Net.mutex ||
+      (pdPASS != xTaskCreatePinnedToCore(NetTask, "net", 6144, nullptr, 1, &Net.task, NET_TASK_CORE))) {
+    Net.task = nullptr;
+    AddLog_P(LOG_LEVEL_ERROR, S_LOG_MQTT, PSTR("Network task not started"));
+  }
+}
+
+void NetLoop(void)
+{
+  NET_MESSAGE *message;
+  for (uint32_t i = 0; i < NET_RECEIVE_BUDGET; i++) {
+    if (pdTRUE != xQueueReceive(Net.receive, &message, 0)) { break; }
+    Net.received++;
+    MqttDataHandler(message->data, (uint8_t*)message->data + message->topic_len +1, message->payload_len);
+    free(message);
+  }
+}
+
+void NetStatus(void)
+{
+  ResponseAppend_P(PSTR(",\"NetTask\":{\"Core\":%d,\"Sent\":%u,\"Received\":%u,\"SendDrops\":%u,\"ReceiveDrops\":%u,\"Pending\":%u}"),
+    NET_TASK_CORE, Net.sent, Net.received, Net.send_drops, Net.receive_drops, (Net.send) ? uxQueueMessagesWaiting(Net.send) : 0);
+}
+#endif  // USE_NETWORK_TASK
+
+void MqttLock(void)
+{
+#ifdef USE_NETWORK_TASK
+  if (!Net.task) { return; }
+  xSemaphoreTakeRecursive(Net.mutex, portMAX_DELAY);
+  if (!Net.lock_depth++ && MqttClient.connected()) {
+    NetSendMessages();                   // Keep publish order
+  }
+#endif  // USE_NETWORK_TASK
+}
+
+void MqttUnlock(void)
+{
+#ifdef USE_NETWORK_TASK
+  if (!Net.task) { return; }
+  Net.lock_depth--;
+  xSemaphoreGiveRecursive(Net.mutex);
+#endif  // USE_NETWORK_TASK
+}
+
 bool MqttIsConnected(void)
 {
-  return MqttClient.connected();
+#ifdef USE_NETWORK_TASK
+  if (Net.connecting) { return false; }  // Do not wait for the handshake
+#endif  // USE_NETWORK_TASK
+  MqttLock();
+  bool connected = MqttClient.connected();
+  MqttUnlock();
+  return connected;
 }
 
 void MqttDisconnect(void)
 {
+  MqttLock();
+  MqttConnectStop();
+#ifdef USE_MQTT_QUEUE
+  MqttQueueFlush();
+#endif  // USE_MQTT_QUEUE
   MqttClient.disconnect();
+  MqttUnlock();
 }
 
 void MqttSubscribeLib(const char *topic)
 {
+  MqttLock();
   MqttClient.subscribe(topic);
   MqttClient.loop();  // Solve LmacRxBlk:1 messages
+  MqttUnlock();
 }
 
 void MqttUnsubscribeLib(const char *topic)
 {
+  MqttLock();
   MqttClient.unsubscribe(topic);
   MqttClient.loop();  // Solve LmacRxBlk:1 messages
+  MqttUnlock();
 }
 
-bool MqttPublishLib(const char* topic, bool retained)
+bool MqttPublishRaw(const char* topic, const uint8_t* payload, uint32_t len, bool retained)
+{
+#ifdef USE_NETWORK_TASK
+  if (Net.task && !Net.lock_depth) {     // Send from the network task
+    NET_MESSAGE *message = NetMessage(topic, payload, len, retained);
+    if (message && (pdTRUE == xQueueSend(Net.send, &message, 0))) { return true; }
+    free(message);
+    Net.send_drops++;
+    return false;
+  }
+#endif  // USE_NETWORK_TASK
+  return MqttClient.publish(topic, payload, len, retained);
+}
+
+bool MqttPublishLib(const char* topic, const char* payload, bool retained)
 {
   // If Prefix1 equals Prefix2 disable next MQTT subscription to prevent loop
   if (!strcmp(SettingsText(SET_MQTTPREFIX1), SettingsText(SET_MQTTPREFIX2))) {
@@ -230,11 +510,136 @@ bool MqttPublishLib(const char* topic, bool retained)
     }
   }
 
-  bool result = MqttClient.publish(topic, mqtt_data, retained);
+#ifdef USE_MQTT_COMPRESSION
+  // Publish JSON payloads of at least MqttCompress bytes compressed to <topic>/Z
+  size_t payload_len = strlen(payload);
+  if (Settings.mqtt_compress && (payload_len >= Settings.mqtt_compress) && ('{' == payload[0])) {
+    size_t compressed_len;
+    char *compressed = CompressText(payload, payload_len, &compressed_len);
+    if (compressed) {
+      char ztopic[TOPSZ + 3];
+      snprintf_P(ztopic, sizeof(ztopic), PSTR("%s/" MQTT_COMPRESS_SUFFIX), topic);
+      bool result = MqttPublishRaw(ztopic, (const uint8_t*)compressed, compressed_len, retained);
+      free(compressed);
+      yield();  // #3313
+      return result;
+    }
+  }
+#endif  // USE_MQTT_COMPRESSION
+
+  bool result = MqttPublishRaw(topic, (const uint8_t*)payload, strlen(payload), retained);
   yield();  // #3313
   return result;
 }
 
+bool MqttPublishLib(const char* topic, bool retained)
+{
+  return MqttPublishLib(topic, mqtt_data, retained);
+}
+
+#ifdef USE_MQTT_QUEUE
+/*********************************************************************************************\
+ * MQTT publish queue
+ *
+ * MqttPublish queues messages while connected. The queue is sent from FUNC_LOOP within
+ * MQTT_QUEUE_BUDGET. A queued non-retained STATE, SENSOR or POWER message is replaced by a newer
+ * message to the same topic. Other messages like RESULT or LOGGING are all sent in order.
+ * A full queue sends its oldest message first.
+\*********************************************************************************************/
+
+bool MqttQueueIsState(const char* topic)
+{
+  // Only state topics may be coalesced as a newer message supersedes the queued one
+  const char *last = strrchr(topic, '/');
+  last = (last) ? last +1 : topic;
+  if (!strcmp_P(last, PSTR(D_RSLT_STATE)) || !strcmp_P(last, PSTR(D_RSLT_SENSOR))) { return true; }
+  if (strncmp_P(last, PSTR(D_RSLT_POWER), strlen(D_RSLT_POWER))) { return false; }
+  for (last += strlen(D_RSLT_POWER); *last; last++) {
+    if (!isdigit(*last)) { return false; }  // POWER or POWER<index> only
+  }
+  return true;
+}
+
+char* MqttQueueEntry(uint32_t index)
+{
+  return MqttQueue.entry[(MqttQueue.head + index) % MQTT_QUEUE_DEPTH];
+}
+
+void MqttQueueSendOldest(void)
+{
+  char *entry = MqttQueue.entry[MqttQueue.head];
+  MqttQueue.entry[MqttQueue.head] = nullptr;
+  MqttQueue.head = (MqttQueue.head +1) % MQTT_QUEUE_DEPTH;
+  MqttQueue.count--;
+
+  char *topic = entry +1;
+  if (!MqttPublishLib(topic, topic + strlen(topic) +1, ('1' == entry[0]))) {
+    MqttQueue.drops++;
+  }
+  free(entry);
+}
+
+bool MqttQueueAdd(const char* topic, bool retained)
+{
+  if (!Mqtt.connected) { return false; }
+
+  uint32_t topic_len = strlen(topic) +1;
+  uint32_t payload_len = strlen(mqtt_data) +1;
+  char *entry = (char*)malloc(1 + topic_len + payload_len);
+  if (!entry) { return false; }           // Publish directly
+  entry[0] = (retained) ? '1' : '0';
+  memcpy(entry +1, topic, topic_len);
+  memcpy(entry +1 + topic_len, mqtt_data, payload_len);
+
+  if (!retained && MqttQueueIsState(topic)) {
+    for (uint32_t i = 0; i < MqttQueue.count; i++) {
+      char *queued = MqttQueueEntry(i);
+      if (('0' == queued[0]) && !strcmp(queued +1, topic)) {
+        free(queued);                     // Latest state wins keeping the queue position
+        MqttQueue.entry[(MqttQueue.head + i) % MQTT_QUEUE_DEPTH] = entry;
+        return true;
+      }
+    }
+  }
+
+  if (MQTT_QUEUE_DEPTH == MqttQueue.count) { MqttQueueSendOldest(); }
+  MqttQueue.entry[(MqttQueue.head + MqttQueue.count) % MQTT_QUEUE_DEPTH] = entry;
+  MqttQueue.count++;
+  if (MqttQueue.count > MqttQueue.max) { MqttQueue.max = MqttQueue.count; }
+  return true;
+}
+
+void MqttQueueLoop(void)
+{
+  uint32_t start = millis();
+  while (MqttQueue.count && MqttIsConnected() && (TimePassedSince(start) < MQTT_QUEUE_BUDGET)) {
+    MqttQueueSendOldest();
+  }
+}
+
+void MqttQueueFlush(void)
+{
+  // Send all queued messages or discard them if disconnected
+  while (MqttQueue.count) {
+    if (MqttIsConnected()) {
+      MqttQueueSendOldest();
+    } else {
+      free(MqttQueue.entry[MqttQueue.head]);
+      MqttQueue.entry[MqttQueue.head] = nullptr;
+      MqttQueue.head = (MqttQueue.head +1) % MQTT_QUEUE_DEPTH;
+      MqttQueue.count--;
+      MqttQueue.drops++;
+    }
+  }
+}
+
+void MqttQueueStatus(void)
+{
+  ResponseAppend_P(PSTR(",\"Queue\":{\"Depth\":%d,\"Count\":%d,\"Max\":%d,\"Drops\":%d}"),
+    MQTT_QUEUE_DEPTH, MqttQueue.count, MqttQueue.max, MqttQueue.drops);
+}
+#endif  // USE_MQTT_QUEUE
+
 void MqttDataHandler(char* mqtt_topic, uint8_t* mqtt_data, unsigned int data_len)
 {
 #ifdef USE_DEBUG_DRIVER
@@ -244,6 +649,10 @@ void MqttDataHandler(char* mqtt_topic, uint8_t* mqtt_data, unsigned int data_len
   // Do not allow more data than would be feasable within stack space
   if (data_len >= MQTT_MAX_PACKET_SIZE) { return; }
 
+#ifdef USE_SERIAL_BRIDGE
+  if (SerialBridgeStreamData(mqtt_topic, mqtt_data, data_len)) { return; }  // Raw serial bridge data written without copy
+#endif  // USE_SERIAL_BRIDGE
+
   // Do not execute multiple times if Prefix1 equals Prefix2
   if (!strcmp(SettingsText(SET_MQTTPREFIX1), SettingsText(SET_MQTTPREFIX2))) {
     char *str = strstr(mqtt_topic, SettingsText(SET_MQTTPREFIX1));
@@ -298,6 +707,7 @@ void MqttPublishLogging(const char *mxtime)
 {
   char saved_mqtt_data[strlen(mqtt_data) +1];
   memcpy(saved_mqtt_data, mqtt_data, sizeof(saved_mqtt_data));
+  auto saved_response = ResponseBuffer;
 
 //    ResponseTime_P(PSTR(",\"Log\":{\"%s\"}}"), log_data);  // Will fail as some messages contain JSON
   Response_P(PSTR("%s%s"), mxtime, log_data);            // No JSON and ugly!!
@@ -306,6 +716,7 @@ void MqttPublishLogging(const char *mxtime)
   MqttPublishLib(stopic, false);
 
   memcpy(mqtt_data, saved_mqtt_data, sizeof(saved_mqtt_data));
+  ResponseBuffer = saved_response;
 }
 
 void MqttPublish(const char* topic, bool retained)
@@ -321,13 +732,20 @@ void MqttPublish(const char* topic, bool retained)
   retained = false;   // AWS IoT does not support retained, it will disconnect if received
 #endif
 
+  Mqtt.publish_count++;
+  TRACE_EVENT(TRACE_MQTT_PUBLISH, TRACE_INSTANT, strlen(mqtt_data));
+
   char sretained[CMDSZ];
   sretained[0] = '\0';
   char slog_type[20];
   snprintf_P(slog_type, sizeof(slog_type), PSTR(D_LOG_RESULT));
 
   if (Settings.flag.mqtt_enabled) {  // SetOption3 - Enable MQTT
+#ifdef USE_MQTT_QUEUE
+    if (MqttQueueAdd(topic, retained) || MqttPublishLib(topic, retained)) {
+#else
     if (MqttPublishLib(topic, retained)) {
+#endif  // USE_MQTT_QUEUE
       snprintf_P(slog_type, sizeof(slog_type), PSTR(D_LOG_MQTT));
       if (retained) {
         snprintf_P(sretained, sizeof(sretained), PSTR(" (" D_RETAINED ")"));
@@ -353,6 +771,19 @@ void MqttPublish(const char* topic)
   MqttPublish(topic, false);
 }
 
+uint32_t MqttPrefixTopic_P(char* stopic, uint32_t prefix, const char* subtopic)
+{
+  char romram[64];
+
+  snprintf_P(romram, sizeof(romram), ((prefix > 3) && !Settings.flag.mqtt_response) ? S_RSLT_RESULT : subtopic);  // SetOption4 - Switch between MQTT RESULT or COMMAND
+  for (uint32_t i = 0; i < strlen(romram); i++) {
+    romram[i] = toupper(romram[i]);
+  }
+  prefix &= 3;
+  GetTopic_P(stopic, prefix, mqtt_topic, romram);
+  return prefix;
+}
+
 void MqttPublishPrefixTopic_P(uint32_t prefix, const char* subtopic, bool retained)
 {
 /* prefix 0 = cmnd using subtopic
@@ -362,15 +793,9 @@ void MqttPublishPrefixTopic_P(uint32_t prefix, const char* subtopic, bool retain
  * prefix 5 = stat using subtopic or RESULT
  * prefix 6 = tele using subtopic or RESULT
  */
-  char romram[64];
   char stopic[TOPSZ];
 
-  snprintf_P(romram, sizeof(romram), ((prefix > 3) && !Settings.flag.mqtt_response) ? S_RSLT_RESULT : subtopic);  // SetOption4 - Switch between MQTT RESULT or COMMAND
-  for (uint32_t i = 0; i < strlen(romram); i++) {
-    romram[i] = toupper(romram[i]);
-  }
-  prefix &= 3;
-  GetTopic_P(stopic, prefix, mqtt_topic, romram);
+  prefix = MqttPrefixTopic_P(stopic, prefix, subtopic);
   MqttPublish(stopic, retained);
 
 #ifdef USE_MQTT_AWS_IOT
@@ -388,16 +813,17 @@ void MqttPublishPrefixTopic_P(uint32_t prefix, const char* subtopic, bool retain
       s++;
     }
     // update topic is "$aws/things/<topic>/shadow/update"
+    char romram[64];
     snprintf_P(romram, sizeof(romram), PSTR("$aws/things/%s/shadow/update"), topic2);
 
     // copy buffer
     char *mqtt_save = (char*) malloc(strlen(mqtt_data)+1);
     if (!mqtt_save) { return; }    // abort
     strcpy(mqtt_save, mqtt_data);
-    snprintf_P(mqtt_data, sizeof(mqtt_data), PSTR("{\"state\":{\"reported\":%s}}"), mqtt_save);
+    Response_P(PSTR("{\"state\":{\"reported\":%s}}"), mqtt_save);
     free(mqtt_save);
 
-    bool result = MqttClient.publish(romram, mqtt_data, false);
+    bool result = MqttPublishRaw(romram, (const uint8_t*)mqtt_data, strlen(mqtt_data), false);
     AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_MQTT "Updated shadow: %s"), romram);
     yield();  // #3313
   }
@@ -409,6 +835,73 @@ void MqttPublishPrefixTopic_P(uint32_t prefix, const char* subtopic)
   MqttPublishPrefixTopic_P(prefix, subtopic, false);
 }
 
+void MqttStreamWrite(const char* data, uint32_t len)
+{
+  if (len > Mqtt.stream_length) { len = Mqtt.stream_length; }  // Writer provided more than announced
+  MqttClient.write((const uint8_t*)data, len);
+  Mqtt.stream_length -= len;
+}
+
+bool MqttPublishPrefixTopicStream_P(uint32_t prefix, const char* subtopic, bool retained, bool (*generator)(void))
+{
+  // Publish generator response exceeding mqtt_data by streaming it from the response stream buffer
+  bool result = ResponseStreamRun(generator);
+  if (!ResponseStream.length) {             // Response fits in mqtt_data
+    if (result) { MqttPublishPrefixTopic_P(prefix, subtopic, retained); }
+    return result;
+  }
+  if (!result) { return result; }
+
+  uint32_t length = ResponseStream.length;
+  char stopic[TOPSZ];
+  MqttPrefixTopic_P(stopic, prefix, subtopic);
+#if defined(USE_MQTT_TLS) && defined(USE_MQTT_AWS_IOT) || defined(MQTT_NO_RETAIN)
+  retained = false;   // AWS IoT does not support retained, it will disconnect if received
+#endif
+  MqttLock();
+#ifdef USE_MQTT_QUEUE
+  MqttQueueFlush();                         // Keep publish order
+#endif  // USE_MQTT_QUEUE
+  if (Settings.flag.mqtt_enabled &&         // SetOption3 - Enable MQTT
+      (length < 0xFFFF - TOPSZ) &&
+      MqttClient.beginPublish(stopic, length, retained)) {
+    MqttClient.write((const uint8_t*)ResponseStream.data, length);
+    MqttClient.endPublish();
+    yield();
+    AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_MQTT "%s = ... (%d bytes)"), stopic, length);
+  }
+  MqttUnlock();
+  return result;                            // Complete response is kept in ResponseStreamPayload()
+}
+
+bool MqttPublishPrefixTopicBinary_P(uint32_t prefix, const char* subtopic, uint32_t length, void (*writer)(void))
+{
+  // Publish binary payload of length bytes written by writer using MqttStreamWrite
+  char stopic[TOPSZ];
+  MqttPrefixTopic_P(stopic, prefix, subtopic);
+  MqttLock();
+#ifdef USE_MQTT_QUEUE
+  MqttQueueFlush();                         // Keep publish order
+#endif  // USE_MQTT_QUEUE
+  if (!Settings.flag.mqtt_enabled ||        // SetOption3 - Enable MQTT
+      (length >= 0xFFFF - TOPSZ) ||
+      !MqttClient.beginPublish(stopic, length, false)) {
+    MqttUnlock();
+    return false;
+  }
+  Mqtt.stream_length = length;
+  writer();
+  while (Mqtt.stream_length) {              // Writer provided less than announced
+    MqttClient.write((uint8_t)0);
+    Mqtt.stream_length--;
+  }
+  MqttClient.endPublish();
+  MqttUnlock();
+  yield();
+  AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_MQTT "%s = ... (%d bytes)"), stopic, length);
+  return true;
+}
+
 void MqttPublishTeleSensor(void)
 {
   MqttPublishPrefixTopic_P(TELE, PSTR(D_RSLT_SENSOR), Settings.flag.mqtt_sensor_retain);  // CMND_SENSORRETAIN
@@ -484,7 +977,11 @@ void MqttDisconnected(int state)
 {
   Mqtt.connected = false;
   Mqtt.retry_counter = Settings.mqtt_retry;
+  TRACE_EVENT(TRACE_MQTT_STATE, TRACE_INSTANT, state);
 
+#ifdef USE_MQTT_QUEUE
+  MqttQueueFlush();
+#endif  // USE_MQTT_QUEUE
   MqttClient.disconnect();
 
   AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_MQTT D_CONNECT_FAILED_TO " %s:%d, rc %d. " D_RETRY_IN " %d " D_UNIT_SECOND), SettingsText(SET_MQTT_HOST), Settings.mqtt_port, state, Mqtt.retry_counter);
@@ -500,6 +997,7 @@ void MqttConnected(void)
     Mqtt.connected = true;
     Mqtt.retry_counter = 0;
     Mqtt.connect_count++;
+    TRACE_EVENT(TRACE_MQTT_STATE, TRACE_INSTANT, 1);
 
     GetTopic_P(stopic, TELE, mqtt_topic, S_LWT);
     Response_P(PSTR(D_ONLINE));
@@ -507,7 +1005,7 @@ void MqttConnected(void)
 
     if (!Settings.flag4.only_json_message) {  // SetOption90 - Disable non-json MQTT response
       // Satisfy iobroker (#299)
-      mqtt_data[0] = '\0';
+      ResponseClear();
       MqttPublishPrefixTopic_P(CMND, S_RSLT_POWER);
     }
 
@@ -572,10 +1070,191 @@ void MqttConnected(void)
   }
 }
 
-void MqttReconnect(void)
+/*********************************************************************************************\
+ * Non blocking connect
+ *
+ * MqttReconnect() starts a connect attempt which MqttConnectLoop() steps every 50 mSeconds:
+ * - MQTT_CONNECT_DNS resolves the broker host with an asynchronous lwIP lookup
+ * - MQTT_CONNECT_TCP probes the broker port with a non blocking TCP connect (lwIP raw on ESP8266,
+ *   a non blocking socket on ESP32) which is closed as soon as the broker accepted it
+ * - MQTT_CONNECT_BROKER sends CONNECT and waits for CONNACK
+ * The TCP connect and optional TLS handshake of the MQTT client itself still block but only take
+ * place once the broker answered the probe, so an unreachable broker no longer stalls the loop.
+\*********************************************************************************************/
+
+#include "lwip/dns.h"
+#ifdef ESP8266
+#include "lwip/tcp.h"
+#else  // ESP32
+#include "lwip/sockets.h"
+#endif  // ESP8266 - ESP32
+
+#ifndef MQTT_CONNECT_TIMEOUT
+#define MQTT_CONNECT_TIMEOUT   5000      // Max number of mSeconds to resolve the host and reach the broker port
+#endif
+
+enum MqttAsyncResults { MQTT_ASYNC_PENDING, MQTT_ASYNC_DONE, MQTT_ASYNC_FAILED };
+
+struct MQTT_ASYNC {
+  uint32_t start;                        // millis() at start of connect attempt or broker connect
+  uint32_t address;                      // Resolved broker address
+  uint32_t generation = 0;               // Identifies the DNS lookup of the current attempt
+  volatile uint8_t result;               // MqttAsyncResults of DNS lookup or TCP probe
+#ifdef ESP8266
+  struct tcp_pcb *pcb = nullptr;         // Pending TCP probe
+#else  // ESP32
+  int fd = -1;                           // Pending TCP probe socket
+#endif  // ESP8266 - ESP32
+  char will_topic[TOPSZ];                // Kept for a broker handshake on the network task
+  char will_message[32];
+} MqttAsync;
+
+void MqttDnsFound(const char *name, const ip_addr_t *ipaddr, void *arg)
 {
-  char stopic[TOPSZ];
+  // lwIP callback also used for cached and numeric hosts
+  if ((uint32_t)arg != MqttAsync.generation) { return; }  // Lookup of an abandoned attempt
+  if (ipaddr) {
+#if LWIP_VERSION_MAJOR == 1
+    MqttAsync.address = ipaddr->addr;
+#else
+    MqttAsync.address = ip_2_ip4(ipaddr)->addr;
+#endif
+    MqttAsync.result = MQTT_ASYNC_DONE;
+  } else {
+    MqttAsync.result = MQTT_ASYNC_FAILED;
+  }
+}
 
+void MqttDnsStart(void)
+{
+  ip_addr_t addr;
+  MqttAsync.generation++;
+  MqttAsync.result = MQTT_ASYNC_PENDING;
+#ifdef USE_DNS_CACHE
+  err_t err = DnsCacheGetHostByName(SettingsText(SET_MQTT_HOST), &addr, (dns_found_callback)MqttDnsFound, (void*)MqttAsync.generation);
+#else
+  err_t err = dns_gethostbyname(SettingsText(SET_MQTT_HOST), &addr, (dns_found_callback)MqttDnsFound, (void*)MqttAsync.generation);
+#endif  // USE_DNS_CACHE
+  if (ERR_OK == err) {
+    MqttDnsFound(SettingsText(SET_MQTT_HOST), &addr, (void*)MqttAsync.generation);
+  }
+  else if (err != ERR_INPROGRESS) {
+    MqttAsync.result = MQTT_ASYNC_FAILED;
+  }
+}
+
+#ifdef ESP8266
+err_t MqttProbeConnected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  // Broker accepted the connection so close it again
+  MqttAsync.pcb = nullptr;
+  MqttAsync.result = MQTT_ASYNC_DONE;
+  tcp_err(pcb, nullptr);
+  if (tcp_close(pcb) != ERR_OK) {
+    tcp_abort(pcb);
+    return ERR_ABRT;
+  }
+  return ERR_OK;
+}
+
+void MqttProbeError(void *arg, err_t err)
+{
+  // Connection refused or SYN retries exhausted, pcb is already freed by lwIP
+  MqttAsync.pcb = nullptr;
+  MqttAsync.result = MQTT_ASYNC_FAILED;
+}
+#endif  // ESP8266
+
+void MqttProbeStart(void)
+{
+  MqttAsync.result = MQTT_ASYNC_FAILED;
+#ifdef ESP8266
+  ip_addr_t addr;
+#if LWIP_VERSION_MAJOR == 1
+  addr.addr = MqttAsync.address;
+#else
+  ip_addr_set_ip4_u32(&addr, MqttAsync.address);
+#endif
+  MqttAsync.pcb = tcp_new();
+  if (!MqttAsync.pcb) { return; }
+  tcp_err(MqttAsync.pcb, MqttProbeError);
+  MqttAsync.result = MQTT_ASYNC_PENDING;
+  if (tcp_connect(MqttAsync.pcb, &addr, Settings.mqtt_port, MqttProbeConnected) != ERR_OK) {
+    tcp_err(MqttAsync.pcb, nullptr);
+    tcp_abort(MqttAsync.pcb);
+    MqttAsync.pcb = nullptr;
+    MqttAsync.result = MQTT_ASYNC_FAILED;
+  }
+#else  // ESP32
+  MqttAsync.fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (MqttAsync.fd < 0) { return; }
+  fcntl(MqttAsync.fd, F_SETFL, fcntl(MqttAsync.fd, F_GETFL, 0) | O_NONBLOCK);
+  struct sockaddr_in server;
+  memset(&server, 0, sizeof(server));
+  server.sin_family = AF_INET;
+  server.sin_addr.s_addr = MqttAsync.address;
+  server.sin_port = htons(Settings.mqtt_port);
+  if ((lwip_connect_r(MqttAsync.fd, (struct sockaddr*)&server, sizeof(server)) < 0) && (errno != EINPROGRESS)) {
+    close(MqttAsync.fd);
+    MqttAsync.fd = -1;
+    return;
+  }
+  MqttAsync.result = MQTT_ASYNC_PENDING;
+#endif  // ESP8266 - ESP32
+}
+
+#ifdef ESP32
+void MqttProbeCheck(void)
+{
+  fd_set fdset;
+  FD_ZERO(&fdset);
+  FD_SET(MqttAsync.fd, &fdset);
+  struct timeval tv = { 0, 0 };
+  int res = select(MqttAsync.fd +1, nullptr, &fdset, nullptr, &tv);
+  if (0 == res) { return; }               // Still connecting
+  int sockerr = -1;
+  if (res > 0) {
+    socklen_t len = sizeof(sockerr);
+    getsockopt(MqttAsync.fd, SOL_SOCKET, SO_ERROR, &sockerr, &len);
+  }
+  close(MqttAsync.fd);
+  MqttAsync.fd = -1;
+  MqttAsync.result = (sockerr) ? MQTT_ASYNC_FAILED : MQTT_ASYNC_DONE;
+}
+#endif  // ESP32
+
+void MqttConnectStop(void)
+{
+  // Abandon a pending DNS lookup or TCP probe
+  MqttAsync.generation++;
+#ifdef ESP8266
+  if (MqttAsync.pcb) {
+    tcp_err(MqttAsync.pcb, nullptr);
+    tcp_abort(MqttAsync.pcb);
+    MqttAsync.pcb = nullptr;
+  }
+#else  // ESP32
+  if (MqttAsync.fd >= 0) {
+    close(MqttAsync.fd);
+    MqttAsync.fd = -1;
+  }
+#endif  // ESP8266 - ESP32
+  Mqtt.connect_state = MQTT_CONNECT_IDLE;
+}
+
+void MqttConnectFailed(int state)
+{
+#ifdef USE_MQTT_TLS
+  if (MQTT_CONNECT_BROKER == Mqtt.connect_state) {
+    AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_MQTT "TLS connection error: %d"), tlsClient->getLastError());
+  }
+#endif
+  MqttConnectStop();
+  MqttDisconnected(state);  // status codes are documented here http://pubsubclient.knolleary.net/api.html#state
+}
+
+void MqttReconnect(void)
+{
   Mqtt.allowed = Settings.flag.mqtt_enabled;  // SetOption3 - Enable MQTT
   if (Mqtt.allowed) {
 #ifdef USE_DISCOVERY
@@ -593,6 +1272,7 @@ void MqttReconnect(void)
     }
 #endif
   }
+  MqttConnectStop();
   if (!Mqtt.allowed) {
     MqttConnected();
     return;
@@ -608,6 +1288,27 @@ void MqttReconnect(void)
   Mqtt.retry_counter = Settings.mqtt_retry;
   global_state.mqtt_down = 1;
 
+  MqttLock();
+  if (MqttClient.connected()) { MqttClient.disconnect(); }
+#ifdef USE_MQTT_TLS
+  tlsClient->stop();
+#else
+  EspClient = WiFiClient();               // Wifi Client reconnect issue 4497 (https://github.com/esp8266/Arduino/issues/4497)
+  MqttClient.setClient(EspClient);
+#endif
+  MqttUnlock();
+
+  if (2 == Mqtt.initial_connection_state) {  // Executed once just after power on and wifi is connected
+    Mqtt.initial_connection_state = 1;
+  }
+
+  MqttAsync.start = millis();
+  Mqtt.connect_state = MQTT_CONNECT_DNS;
+  MqttDnsStart();
+}
+
+bool MqttBeginConnect(void)
+{
   char *mqtt_user = nullptr;
   char *mqtt_pwd = nullptr;
   if (strlen(SettingsText(SET_MQTT_USER))) {
@@ -617,54 +1318,73 @@ void MqttReconnect(void)
     mqtt_pwd = SettingsText(SET_MQTT_PWD);
   }
 
-  GetTopic_P(stopic, TELE, mqtt_topic, S_LWT);
-  Response_P(S_OFFLINE);
-
-  if (MqttClient.connected()) { MqttClient.disconnect(); }
-#ifdef USE_MQTT_TLS
-  tlsClient->stop();
+#if defined(USE_MQTT_TLS) && defined(USE_MQTT_AWS_IOT)
+  return MqttClient.beginConnect(mqtt_client, nullptr, nullptr, MqttAsync.will_topic, 1, false, MqttAsync.will_message, MQTT_CLEAN_SESSION);
 #else
-  EspClient = WiFiClient();               // Wifi Client reconnect issue 4497 (https://github.com/esp8266/Arduino/issues/4497)
-  MqttClient.setClient(EspClient);
+  return MqttClient.beginConnect(mqtt_client, mqtt_user, mqtt_pwd, MqttAsync.will_topic, 1, true, MqttAsync.will_message, MQTT_CLEAN_SESSION);
 #endif
+}
 
-  if (2 == Mqtt.initial_connection_state) {  // Executed once just after power on and wifi is connected
-    Mqtt.initial_connection_state = 1;
-  }
+void MqttConnectBroker(void)
+{
+  GetTopic_P(MqttAsync.will_topic, TELE, mqtt_topic, S_LWT);
+  strlcpy_P(MqttAsync.will_message, S_OFFLINE, sizeof(MqttAsync.will_message));
 
+#ifdef USE_NETWORK_TASK
+  MqttClient.setCallback(NetReceive);
+#else
   MqttClient.setCallback(MqttDataHandler);
-#if defined(USE_MQTT_TLS) && defined(USE_MQTT_AWS_IOT)
+#endif  // USE_NETWORK_TASK
+#ifdef USE_MQTT_TLS
+#ifdef USE_MQTT_AWS_IOT
   // re-assign private keys in case it was updated in between
   tlsClient->setClientECCert(AWS_IoT_Client_Certificate,
                              AWS_IoT_Private_Key,
                              0xFFFF /* all usages, don't care */, 0);
 #endif
-  MqttClient.setServer(SettingsText(SET_MQTT_HOST), Settings.mqtt_port);
+  MqttClient.setServer(SettingsText(SET_MQTT_HOST), Settings.mqtt_port);  // Host name is needed for SNI and is in the DNS cache now
+#else
+  MqttClient.setServer(IPAddress(MqttAsync.address), Settings.mqtt_port);
+#endif
 
-  uint32_t mqtt_connect_time = millis();
+  MqttAsync.start = millis();
 #if defined(USE_MQTT_TLS) && !defined(USE_MQTT_TLS_CA_CERT)
   bool allow_all_fingerprints = false;
-  bool learn_fingerprint1 = is_fingerprint_mono_value(Settings.mqtt_fingerprint[0], 0x00);
-  bool learn_fingerprint2 = is_fingerprint_mono_value(Settings.mqtt_fingerprint[1], 0x00);
   allow_all_fingerprints |= is_fingerprint_mono_value(Settings.mqtt_fingerprint[0], 0xff);
   allow_all_fingerprints |= is_fingerprint_mono_value(Settings.mqtt_fingerprint[1], 0xff);
-  allow_all_fingerprints |= learn_fingerprint1;
-  allow_all_fingerprints |= learn_fingerprint2;
+  allow_all_fingerprints |= is_fingerprint_mono_value(Settings.mqtt_fingerprint[0], 0x00);
+  allow_all_fingerprints |= is_fingerprint_mono_value(Settings.mqtt_fingerprint[1], 0x00);
   tlsClient->setPubKeyFingerprint(Settings.mqtt_fingerprint[0], Settings.mqtt_fingerprint[1], allow_all_fingerprints);
 #endif
+  Mqtt.connect_state = MQTT_CONNECT_BROKER;
 #if defined(USE_MQTT_TLS) && defined(USE_MQTT_AWS_IOT)
   AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_MQTT "AWS IoT endpoint: %s"), SettingsText(SET_MQTT_HOST));
-  if (MqttClient.connect(mqtt_client, nullptr, nullptr, stopic, 1, false, mqtt_data, MQTT_CLEAN_SESSION)) {
-#else
-  if (MqttClient.connect(mqtt_client, mqtt_user, mqtt_pwd, stopic, 1, true, mqtt_data, MQTT_CLEAN_SESSION)) {
 #endif
+#ifdef USE_NETWORK_TASK
+  if (Net.task) {
+    Net.connect_failed = false;
+    Net.connecting = true;                // Handshake on the network task once loop() releases the client
+    return;
+  }
+#endif  // USE_NETWORK_TASK
+  if (!MqttBeginConnect()) {
+    MqttConnectFailed(MqttClient.state());
+  }
+}
+
+void MqttConnectDone(void)
+{
+  Mqtt.connect_state = MQTT_CONNECT_IDLE;
 #ifdef USE_MQTT_TLS
-    AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_MQTT "TLS connected in %d ms, max ThunkStack used %d"),
-      millis() - mqtt_connect_time, tlsClient->getMaxThunkStackUse());
-    if (!tlsClient->getMFLNStatus()) {
-      AddLog_P(LOG_LEVEL_INFO, S_LOG_MQTT, PSTR("MFLN not supported by TLS server"));
-    }
+  AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_MQTT "TLS %s in %d ms, max ThunkStack used %d"),
+    (tlsClient->getSessionResumed()) ? "session resumed" : "connected", millis() - MqttAsync.start, tlsClient->getMaxThunkStackUse());
+  if (!tlsClient->getMFLNStatus()) {
+    AddLog_P(LOG_LEVEL_INFO, S_LOG_MQTT, PSTR("MFLN not supported by TLS server"));
+  }
 #ifndef USE_MQTT_TLS_CA_CERT  // don't bother with fingerprints if using CA validation
+  if (!tlsClient->getSessionResumed()) {  // No server certificate is sent on resumption
+    bool learn_fingerprint1 = is_fingerprint_mono_value(Settings.mqtt_fingerprint[0], 0x00);
+    bool learn_fingerprint2 = is_fingerprint_mono_value(Settings.mqtt_fingerprint[1], 0x00);
     // create a printable version of the fingerprint received
     char buf_fingerprint[64];
     ToHex_P((unsigned char *)tlsClient->getRecvPubKeyFingerprint(), 20, buf_fingerprint, sizeof(buf_fingerprint), ' ');
@@ -693,14 +1413,62 @@ void MqttReconnect(void)
         SettingsSaveAll();  // save settings
       }
     }
+  }
 #endif // !USE_MQTT_TLS_CA_CERT
+  if (!tlsClient->getSessionResumed()) {
+    MqttTlsSessionSave();           // After learning fingerprints as they identify the server
+  }
 #endif // USE_MQTT_TLS
-    MqttConnected();
-  } else {
-#ifdef USE_MQTT_TLS
-    AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_MQTT "TLS connection error: %d"), tlsClient->getLastError());
-#endif
-    MqttDisconnected(MqttClient.state());  // status codes are documented here http://pubsubclient.knolleary.net/api.html#state
+  MqttConnected();
+}
+
+void MqttConnectLoop(void)
+{
+  switch (Mqtt.connect_state) {
+    case MQTT_CONNECT_DNS:
+    case MQTT_CONNECT_TCP:
+#ifdef ESP32
+      if ((MQTT_CONNECT_TCP == Mqtt.connect_state) && (MQTT_ASYNC_PENDING == MqttAsync.result)) {
+        MqttProbeCheck();
+      }
+#endif  // ESP32
+      if (MQTT_ASYNC_PENDING == MqttAsync.result) {
+        if (millis() - MqttAsync.start < MQTT_CONNECT_TIMEOUT) { break; }
+        MqttAsync.result = MQTT_ASYNC_FAILED;
+      }
+#ifdef USE_DNS_CACHE
+      if (MQTT_CONNECT_DNS == Mqtt.connect_state) {
+        DnsCacheStore(SettingsText(SET_MQTT_HOST), (MQTT_ASYNC_DONE == MqttAsync.result) ? MqttAsync.address : 0);
+      }
+#endif  // USE_DNS_CACHE
+      if (MQTT_ASYNC_FAILED == MqttAsync.result) {
+        AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_MQTT "%s %s"), SettingsText(SET_MQTT_HOST),
+          (MQTT_CONNECT_DNS == Mqtt.connect_state) ? "not resolved" : "not reachable");
+        MqttConnectFailed(MQTT_CONNECT_FAILED);
+      }
+      else if (MQTT_CONNECT_DNS == Mqtt.connect_state) {
+        Mqtt.connect_state = MQTT_CONNECT_TCP;
+        MqttProbeStart();
+      }
+      else {
+        MqttConnectBroker();
+      }
+      break;
+    case MQTT_CONNECT_BROKER:
+#ifdef USE_NETWORK_TASK
+      if (Net.connect_failed) {
+        Net.connect_failed = false;
+        MqttConnectFailed(MqttClient.state());
+        break;
+      }
+#endif  // USE_NETWORK_TASK
+      if (MqttClient.connectCheck()) {
+        MqttConnectDone();
+      }
+      else if (MqttClient.state() != MQTT_CONNECTING) {
+        MqttConnectFailed(MqttClient.state());
+      }
+      break;
   }
 }
 
@@ -709,10 +1477,12 @@ void MqttCheck(void)
   if (Settings.flag.mqtt_enabled) {  // SetOption3 - Enable MQTT
     if (!MqttIsConnected()) {
       global_state.mqtt_down = 1;
-      if (!Mqtt.retry_counter) {
-        MqttReconnect();
-      } else {
-        Mqtt.retry_counter--;
+      if (MQTT_CONNECT_IDLE == Mqtt.connect_state) {  // No connect attempt in progress
+        if (!Mqtt.retry_counter) {
+          MqttReconnect();
+        } else {
+          Mqtt.retry_counter--;
+        }
       }
     } else {
       global_state.mqtt_down = 0;
@@ -812,6 +1582,18 @@ void CmndMqttRetry(void)
   ResponseCmndNumber(Settings.mqtt_retry);
 }
 
+#ifdef USE_MQTT_COMPRESSION
+void CmndMqttCompress(void)
+{
+  // MqttCompress 0    - Disable payload compression
+  // MqttCompress 500  - Publish JSON payloads of 500 bytes and up compressed to <topic>/Z
+  if ((0 == XdrvMailbox.payload) || ((XdrvMailbox.payload >= MQTT_COMPRESS_MIN) && (XdrvMailbox.payload <= MESSZ))) {
+    Settings.mqtt_compress = XdrvMailbox.payload;
+  }
+  ResponseCmndNumber(Settings.mqtt_compress);
+}
+#endif  // USE_MQTT_COMPRESSION
+
 void CmndStateText(void)
 {
   if ((XdrvMailbox.index > 0) && (XdrvMailbox.index <= MAX_STATE_TEXT)) {
@@ -881,13 +1663,13 @@ void CmndPublish(void)
       char stemp1[TOPSZ];
       strlcpy(stemp1, mqtt_part, sizeof(stemp1));
       if ((payload_part != nullptr) && strlen(payload_part)) {
-        strlcpy(mqtt_data, payload_part, sizeof(mqtt_data));
+        Response_P(PSTR("%s"), payload_part);
       } else {
-        mqtt_data[0] = '\0';
+        ResponseClear();
       }
       MqttPublish(stemp1, (XdrvMailbox.index == 2));
 //      ResponseCmndDone();
-      mqtt_data[0] = '\0';
+      ResponseClear();
     }
   }
 }
@@ -1023,7 +1805,7 @@ void CmndPowerRetain(void)
       char scommand[CMDSZ];
       for (uint32_t i = 1; i <= devices_present; i++) {  // Clear MQTT retain in broker
         GetTopic_P(stemp1, STAT, mqtt_topic, GetPowerDevice(scommand, i, sizeof(scommand), Settings.flag.device_index_enable));  // SetOption26 - Switch between POWER or POWER1
-        mqtt_data[0] = '\0';
+        ResponseClear();
         MqttPublish(stemp1, Settings.flag.mqtt_power_retain);  // CMND_POWERRETAIN
       }
     }
@@ -1039,7 +1821,7 @@ void CmndSensorRetain(void)
 {
   if ((XdrvMailbox.payload >= 0) && (XdrvMailbox.payload <= 1)) {
     if (!XdrvMailbox.payload) {
-      mqtt_data[0] = '\0';
+      ResponseClear();
       MqttPublishPrefixTopic_P(TELE, PSTR(D_RSLT_SENSOR), Settings.flag.mqtt_sensor_retain);  // CMND_SENSORRETAIN
       MqttPublishPrefixTopic_P(TELE, PSTR(D_RSLT_ENERGY), Settings.flag.mqtt_sensor_retain);  // CMND_SENSORRETAIN
     }
@@ -1328,8 +2110,35 @@ bool Xdrv02(uint8_t function)
     switch (function) {
       case FUNC_PRE_INIT:
         MqttInit();
+        XdrvSubscribe(FUNC_EVERY_50_MSECOND);
+#ifdef USE_NETWORK_TASK
+        NetTaskInit();
+#endif  // USE_NETWORK_TASK
+#if defined(USE_MQTT_QUEUE) || defined(USE_NETWORK_TASK)
+        XdrvSubscribe(FUNC_LOOP);
+#endif  // USE_MQTT_QUEUE || USE_NETWORK_TASK
         break;
+#if defined(USE_MQTT_QUEUE) || defined(USE_NETWORK_TASK)
+      case FUNC_LOOP:
+#ifdef USE_NETWORK_TASK
+        NetLoop();
+#endif  // USE_NETWORK_TASK
+#ifdef USE_MQTT_QUEUE
+        MqttQueueLoop();
+#endif  // USE_MQTT_QUEUE
+        break;
+#endif  // USE_MQTT_QUEUE || USE_NETWORK_TASK
       case FUNC_EVERY_50_MSECOND:  // https://github.com/knolleary/pubsubclient/issues/556
+#ifdef USE_NETWORK_TASK
+        if (Net.connecting) { break; }     // Handshake in progress on the network task
+        if (Net.task) {
+          MqttLock();
+          MqttConnectLoop();
+          MqttUnlock();
+          break;                           // The network task polls the client
+        }
+#endif  // USE_NETWORK_TASK
+        MqttConnectLoop();
         MqttClient.loop();
         break;
 #ifdef USE_WEBSERVER
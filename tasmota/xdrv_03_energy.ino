@@ -38,6 +38,7 @@
 #define D_CMND_CURRENTCAL "CurrentCal"
 #define D_CMND_TARIFF "Tariff"
 #define D_CMND_MODULEADDRESS "ModuleAddress"
+#define D_CMND_ENERGYDUMP "EnergyDump"
 
 enum EnergyCommands {
   CMND_POWERCAL, CMND_VOLTAGECAL, CMND_CURRENTCAL,
@@ -54,7 +55,11 @@ const char kEnergyCommands[] PROGMEM = "|"  // No prefix
   D_CMND_SAFEPOWER "|" D_CMND_SAFEPOWERHOLD "|"  D_CMND_SAFEPOWERWINDOW "|"
 #endif  // USE_ENERGY_POWER_LIMIT
 #endif  // USE_ENERGY_MARGIN_DETECTION
-  D_CMND_ENERGYRESET "|" D_CMND_TARIFF ;
+  D_CMND_ENERGYRESET "|" D_CMND_TARIFF
+#ifdef USE_ENERGY_STATISTICS
+  "|" D_CMND_ENERGYDUMP
+#endif  // USE_ENERGY_STATISTICS
+  ;
 
 void (* const EnergyCommand[])(void) PROGMEM = {
   &CmndPowerCal, &CmndVoltageCal, &CmndCurrentCal,
@@ -67,7 +72,11 @@ void (* const EnergyCommand[])(void) PROGMEM = {
   &CmndSafePower, &CmndSafePowerHold, &CmndSafePowerWindow,
 #endif  // USE_ENERGY_POWER_LIMIT
 #endif  // USE_ENERGY_MARGIN_DETECTION
-  &CmndEnergyReset, &CmndTariff };
+  &CmndEnergyReset, &CmndTariff
+#ifdef USE_ENERGY_STATISTICS
+  , &CmndEnergyDump
+#endif  // USE_ENERGY_STATISTICS
+  };
 
 const char kEnergyPhases[] PROGMEM = "|%s / %s|%s / %s / %s||[%s,%s]|[%s,%s,%s]";
 
@@ -223,6 +232,60 @@ void EnergyUpdateTotal(float value, bool kwh)
   EnergyUpdateToday();
 }
 
+/********************************************************************************************* * Framed serial input shared by energy drivers
+ *
+ * Reads all received bytes in one call, locates frames by their header byte using memchr and
+ * validates the 8-bit sum checksum in the last frame byte in a single pass. A trailing partial
+ * frame is kept in the buffer for the next call.
+\*********************************************************************************************/
+
+struct ENERGY_FRAME {
+  uint8_t *buffer;                           // Holds at least two frames
+  uint16_t size;
+  uint16_t length;                           // Bytes in buffer
+  uint8_t frame_length;
+  uint8_t header;                            // Header byte
+  uint8_t header_pos;                        // Position of header byte in frame
+  uint8_t sum_start;                         // First byte added into checksum
+};
+
+uint32_t EnergyFrameInput(TasmotaSerial *serial, struct ENERGY_FRAME *frame, void (*received)(uint8_t *data))
+{
+  // Returns number of valid frames passed to received()
+  uint32_t frames = 0;
+  uint32_t frame_length = frame->frame_length;
+  do {
+    uint32_t read = serial->read(frame->buffer + frame->length, frame->size - frame->length);
+    frame->length += read;
+
+    uint8_t *data = frame->buffer;
+    uint8_t *end = frame->buffer + frame->length;
+    while (end - data >= frame_length) {
+      // Search header only where a complete frame fits
+      uint8_t *header = (uint8_t*)memchr(data + frame->header_pos, frame->header, end - data - frame_length +1);
+      if (!header) {
+        data = end - frame_length +1;        // Keep possible start of next frame
+        break;
+      }
+      data = header - frame->header_pos;
+      uint8_t checksum = 0;
+      for (uint32_t i = frame->sum_start; i < frame_length -1; i++) { checksum += data[i]; }
+      if (checksum == data[frame_length -1]) {
+        AddLogBuffer(LOG_LEVEL_DEBUG_MORE, data, frame_length);
+        received(data);
+        frames++;
+        data += frame_length;
+      } else {
+        data++;                              // Header byte was part of data or frame is corrupt (issue #1907 and #3425)
+      }
+    }
+    frame->length = end - data;
+    memmove(frame->buffer, data, frame->length);
+    if (!read) { break; }
+  } while (serial->available());
+  return frames;
+}
+
 /*********************************************************************************************/
 
 void Energy200ms(void)
@@ -445,7 +508,7 @@ void EnergyMqttShow(void)
 // {"Time":"2017-12-16T11:48:55","ENERGY":{"Total":0.212,"Yesterday":0.000,"Today":0.014,"Period":2.0,"Power":22.0,"Factor":1.00,"Voltage":213.6,"Current":0.100}}
   int tele_period_save = tele_period;
   tele_period = 2;
-  mqtt_data[0] = '\0';
+  ResponseClear();
   ResponseAppendTime();
   EnergyShow(true);
   tele_period = tele_period_save;
@@ -493,6 +556,9 @@ void EnergyEverySecond(void)
 #ifdef USE_ENERGY_MARGIN_DETECTION
   EnergyMarginCheck();
 #endif  // USE_ENERGY_MARGIN_DETECTION
+#ifdef USE_ENERGY_STATISTICS
+  EnergyStatsSample();
+#endif  // USE_ENERGY_STATISTICS
 }
 
 /*********************************************************************************************\
@@ -857,9 +923,47 @@ void EnergySnsInit(void)
     Energy.period = Energy.kWhtoday_offset;
     EnergyUpdateToday();
     ticker_energy.attach_ms(200, Energy200ms);
+#ifdef USE_PROMETHEUS
+    EnergyMetricsInit();
+#endif  // USE_PROMETHEUS
   }
 }
 
+#ifdef USE_PROMETHEUS
+void EnergyMetricsInit(void)
+{
+  // Phase label only on multi phase devices to keep the single phase series unchanged
+  const char *label = (Energy.phase_count > 1) ? PSTR("phase") : nullptr;
+  for (uint32_t i = 0; i < ((Energy.voltage_common) ? 1 : Energy.phase_count); i++) {
+    if (Energy.voltage_available) {
+      MetricRegister(PSTR("voltage"), METRIC_GAUGE | Settings.flag2.voltage_resolution, &Energy.voltage[i], label, i +1);
+    }
+  }
+  for (uint32_t i = 0; i < Energy.phase_count; i++) {
+    if (Energy.current_available) {
+      MetricRegister(PSTR("current"), METRIC_GAUGE | Settings.flag2.current_resolution, &Energy.current[i], label, i +1);
+    }
+  }
+  for (uint32_t i = 0; i < Energy.phase_count; i++) {
+    MetricRegister(PSTR("active_power"), METRIC_GAUGE | Settings.flag2.wattage_resolution, &Energy.active_power[i], label, i +1);
+  }
+  for (uint32_t i = 0; i < Energy.phase_count; i++) {
+    MetricRegister(PSTR("apparent_power"), METRIC_GAUGE | Settings.flag2.wattage_resolution, &Energy.apparent_power[i], label, i +1);
+  }
+  for (uint32_t i = 0; i < Energy.phase_count; i++) {
+    MetricRegister(PSTR("reactive_power"), METRIC_GAUGE | Settings.flag2.wattage_resolution, &Energy.reactive_power[i], label, i +1);
+  }
+  for (uint32_t i = 0; i < Energy.phase_count; i++) {
+    MetricRegister(PSTR("power_factor"), METRIC_GAUGE | 2, &Energy.power_factor[i], label, i +1);
+  }
+  for (uint32_t i = 0; i < ((Energy.frequency_common) ? 1 : Energy.phase_count); i++) {
+    MetricRegister(PSTR("frequency"), METRIC_GAUGE | Settings.flag2.frequency_resolution, &Energy.frequency[i], label, i +1);
+  }
+  MetricRegister(PSTR("energy_daily"), METRIC_GAUGE | Settings.flag2.energy_resolution, &Energy.daily, nullptr, 0);
+  MetricRegister(PSTR("energy_total"), METRIC_COUNTER | Settings.flag2.energy_resolution, &Energy.total, nullptr, 0);
+}
+#endif  // USE_PROMETHEUS
+
 #ifdef USE_WEBSERVER
 const char HTTP_ENERGY_SNS1[] PROGMEM =
   "{s}" D_POWERUSAGE_APPARENT "{m}%s " D_UNIT_VA "{e}"
@@ -898,6 +1002,178 @@ char* EnergyFormat(char* result, char* input, bool json, bool single = false)
   return EnergyFormatIndex(result, input, json, index, single);
 }
 
+#ifdef USE_ENERGY_STATISTICS
+/*********************************************************************************************\
+ * Statistics
+ *
+ * Keeps per second samples of power, voltage, current and power factor per phase and adds
+ * their min, mean, max and percentile since the last teleperiod to the telemetry.
+ *
+ * EnergyDump       - Publish the samples as binary payload to tele/<topic>/ENERGYDUMP
+ *                    8 bytes header (version, phases, uint16 samples, uint32 UTC time of newest sample)
+ *                    followed by the oldest to newest sample of int16 W, 0.1V, 0.01A, 0.001 per phase
+\*********************************************************************************************/
+
+#ifndef ENERGY_STATS_SAMPLES
+#define ENERGY_STATS_SAMPLES    300     // Per second samples, covers TelePeriod up to 300 seconds
+#endif
+#ifndef ENERGY_STATS_PERCENTILE
+#define ENERGY_STATS_PERCENTILE 95
+#endif
+
+enum EnergyStatValues { ENERGY_STAT_POWER, ENERGY_STAT_VOLTAGE, ENERGY_STAT_CURRENT, ENERGY_STAT_FACTOR, ENERGY_STAT_MAX };
+
+const char kEnergyStatNames[] PROGMEM = D_JSON_POWERUSAGE "|" D_JSON_VOLTAGE "|" D_JSON_CURRENT "|" D_JSON_POWERFACTOR;
+const uint16_t kEnergyStatScale[ENERGY_STAT_MAX] = { 1, 10, 100, 1000 };
+
+struct ENERGY_SAMPLE {
+  int16_t value[ENERGY_STAT_MAX];       // W, 0.1V, 0.01A, 0.001
+};
+
+struct {
+  ENERGY_SAMPLE *sample = nullptr;      // [ENERGY_STATS_SAMPLES][phases]
+  uint32_t time = 0;                    // UTC time of newest sample
+  uint16_t head = 0;                    // Next sample
+  uint16_t count = 0;
+  uint8_t phases = 0;
+} EnergyStats;
+
+int16_t EnergyStatsLimit(float value)
+{
+  if (value > INT16_MAX) { return INT16_MAX; }
+  if (value < INT16_MIN) { return INT16_MIN; }
+  return (int16_t)lroundf(value);
+}
+
+void EnergyStatsSample(void)
+{
+  if (EnergyStats.phases != Energy.phase_count) {
+    if (EnergyStats.sample) { free(EnergyStats.sample); }
+    EnergyStats.sample = (ENERGY_SAMPLE*)calloc(ENERGY_STATS_SAMPLES * Energy.phase_count, sizeof(ENERGY_SAMPLE));
+    EnergyStats.phases = (EnergyStats.sample) ? Energy.phase_count : 0;
+    EnergyStats.head = 0;
+    EnergyStats.count = 0;
+  }
+  if (!EnergyStats.sample) { return; }
+
+  ENERGY_SAMPLE *sample = &EnergyStats.sample[EnergyStats.head * EnergyStats.phases];
+  for (uint32_t i = 0; i < EnergyStats.phases; i++) {
+    float voltage = (Energy.voltage_common) ? Energy.voltage[0] : Energy.voltage[i];
+    float power_factor = Energy.power_factor[i];
+    if (isnan(power_factor)) {
+      float apparent_power = voltage * Energy.current[i];
+      power_factor = (Energy.active_power[i] && apparent_power) ? Energy.active_power[i] / apparent_power : 0;
+      if (power_factor > 1) { power_factor = 1; }
+    }
+    float value[ENERGY_STAT_MAX] = { Energy.active_power[i], voltage, Energy.current[i], power_factor };
+    for (uint32_t j = 0; j < ENERGY_STAT_MAX; j++) {
+      sample[i].value[j] = EnergyStatsLimit(value[j] * kEnergyStatScale[j]);
+    }
+  }
+  EnergyStats.head = (EnergyStats.head +1) % ENERGY_STATS_SAMPLES;
+  if (EnergyStats.count < ENERGY_STATS_SAMPLES) { EnergyStats.count++; }
+  EnergyStats.time = UtcTime();
+}
+
+int16_t EnergyStatsSelect(int16_t *values, int32_t count, int32_t k)
+{
+  // Quickselect k-th smallest value, reorders values
+  int32_t left = 0;
+  int32_t right = count -1;
+  while (left < right) {
+    int16_t pivot = values[(left + right) / 2];
+    int32_t i = left;
+    int32_t j = right;
+    while (i <= j) {
+      while (values[i] < pivot) { i++; }
+      while (values[j] > pivot) { j--; }
+      if (i <= j) {
+        int16_t swap = values[i];
+        values[i++] = values[j];
+        values[j--] = swap;
+      }
+    }
+    if (k <= j) {
+      right = j;
+    } else if (k >= i) {
+      left = i;
+    } else {
+      break;
+    }
+  }
+  return values[k];
+}
+
+void EnergyStatsShow(void)
+{
+  if (!EnergyStats.count || (EnergyStats.phases != Energy.phase_count)) { return; }
+  int16_t *values = (int16_t*)malloc(EnergyStats.count * sizeof(int16_t));
+  if (!values) { return; }
+
+  const uint8_t resolution[ENERGY_STAT_MAX] = { Settings.flag2.wattage_resolution, Settings.flag2.voltage_resolution, Settings.flag2.current_resolution, 2 };
+  char name[16];
+  char stat_chr[4][Energy.phase_count][FLOATSZ];   // Min, Mean, Max and percentile per phase
+  char value_chr[4][FLOATSZ *3];                   // Used by EnergyFormatIndex
+  ResponseAppend_P(PSTR(","Statistics":{"Samples":%d"), EnergyStats.count);
+  for (uint32_t j = 0; j < ENERGY_STAT_MAX; j++) {
+    if (((ENERGY_STAT_VOLTAGE == j) && !Energy.voltage_available) ||
+        ((ENERGY_STAT_CURRENT == j) && !Energy.current_available) ||
+        ((ENERGY_STAT_FACTOR == j) && (Energy.type_dc || !Energy.voltage_available || !Energy.current_available))) {
+      continue;
+    }
+    for (uint32_t i = 0; i < Energy.phase_count; i++) {
+      int32_t min = INT16_MAX;
+      int32_t max = INT16_MIN;
+      int32_t sum = 0;
+      for (uint32_t s = 0; s < EnergyStats.count; s++) {
+        int16_t value = EnergyStats.sample[s * EnergyStats.phases + i].value[j];
+        values[s] = value;
+        if (value < min) { min = value; }
+        if (value > max) { max = value; }
+        sum += value;
+      }
+      int16_t percentile = EnergyStatsSelect(values, EnergyStats.count, ((EnergyStats.count -1) * ENERGY_STATS_PERCENTILE) / 100);
+      float scale = kEnergyStatScale[j];
+      dtostrfd(min / scale, resolution[j], stat_chr[0][i]);
+      dtostrfd((sum / scale) / EnergyStats.count, resolution[j], stat_chr[1][i]);
+      dtostrfd(max / scale, resolution[j], stat_chr[2][i]);
+      dtostrfd(percentile / scale, resolution[j], stat_chr[3][i]);
+    }
+    ResponseAppend_P(PSTR(",\"%s\":{\"Min\":%s,\"Mean\":%s,\"Max\":%s,\"P%d\":%s}"),
+      GetTextIndexed(name, sizeof(name), j, kEnergyStatNames),
+      EnergyFormat(value_chr[0], stat_chr[0][0], true), EnergyFormat(value_chr[1], stat_chr[1][0], true),
+      EnergyFormat(value_chr[2], stat_chr[2][0], true), ENERGY_STATS_PERCENTILE, EnergyFormat(value_chr[3], stat_chr[3][0], true));
+  }
+  ResponseJsonEnd();
+  free(values);
+}
+
+void EnergyStatsDumpWrite(void)
+{
+  uint8_t header[8] = { 1, EnergyStats.phases, (uint8_t)EnergyStats.count, (uint8_t)(EnergyStats.count >> 8) };
+  memcpy(&header[4], &EnergyStats.time, sizeof(EnergyStats.time));
+  MqttStreamWrite((const char*)header, sizeof(header));
+
+  uint32_t sample_size = EnergyStats.phases * sizeof(ENERGY_SAMPLE);
+  uint32_t first = (EnergyStats.head + ENERGY_STATS_SAMPLES - EnergyStats.count) % ENERGY_STATS_SAMPLES;
+  uint32_t part = tmin(EnergyStats.count, ENERGY_STATS_SAMPLES - first);
+  MqttStreamWrite((const char*)&EnergyStats.sample[first * EnergyStats.phases], part * sample_size);
+  if (EnergyStats.count > part) {
+    MqttStreamWrite((const char*)EnergyStats.sample, (EnergyStats.count - part) * sample_size);
+  }
+}
+
+void CmndEnergyDump(void)
+{
+  uint32_t length = 8 + EnergyStats.count * EnergyStats.phases * sizeof(ENERGY_SAMPLE);
+  if (!EnergyStats.count || !MqttPublishPrefixTopicBinary_P(TELE, PSTR("ENERGYDUMP"), length, EnergyStatsDumpWrite)) {
+    ResponseCmndChar_P(PSTR(D_JSON_FAILED));
+    return;
+  }
+  Response_P(PSTR("{\"%s\":{\"Samples\":%d,\"Bytes\":%d}}"), XdrvMailbox.command, EnergyStats.count, length);
+}
+#endif  // USE_ENERGY_STATISTICS
+
 void EnergyShow(bool json)
 {
   for (uint32_t i = 0; i < Energy.phase_count; i++) {
@@ -1048,6 +1324,12 @@ void EnergyShow(bool json)
       ResponseAppend_P(PSTR(",\"" D_JSON_CURRENT "\":%s"),
         EnergyFormat(value_chr, current_chr[0], json));
     }
+#ifdef USE_ENERGY_STATISTICS
+    if (show_energy_period) {
+      EnergyStatsShow();
+      EnergyStats.count = 0;            // Next teleperiod starts with fresh samples
+    }
+#endif  // USE_ENERGY_STATISTICS
     XnrgCall(FUNC_JSON_APPEND);
     ResponseJsonEnd();
 
@@ -1128,6 +1410,10 @@ bool Xdrv03(uint8_t function)
   if (FUNC_PRE_INIT == function) {
     energy_flg = ENERGY_NONE;
     XnrgCall(FUNC_PRE_INIT);  // Find first energy driver
+    if (energy_flg) {
+      XdrvSubscribe(FUNC_LOOP);
+      XdrvSubscribe(FUNC_EVERY_250_MSECOND);
+    }
   }
   else if (energy_flg) {
     switch (function) {
@@ -126,10 +126,22 @@
 
 enum LightSchemes { LS_POWER, LS_WAKEUP, LS_CYCLEUP, LS_CYCLEDN, LS_RANDOM, LS_MAX };
 
+enum LightFadeCurves { LFC_DEFAULT, LFC_LINEAR, LFC_EASE_IN, LFC_EASE_OUT, LFC_EASE_IN_OUT, LFC_MAX };
+
+#ifdef USE_LIGHT_FADE_TIMER
+#ifndef LIGHT_FADE_TIMER_MS
+#define LIGHT_FADE_TIMER_MS  10               // PWM fade update interval in milliseconds (100Hz)
+#endif
+
+#include <Ticker.h>
+
+Ticker TickerLightFade;
+#endif  // USE_LIGHT_FADE_TIMER
+
 const uint8_t LIGHT_COLOR_SIZE = 25;   // Char array scolor size
 
 const char kLightCommands[] PROGMEM = "|"  // No prefix
-  D_CMND_COLOR "|" D_CMND_COLORTEMPERATURE "|" D_CMND_DIMMER "|" D_CMND_DIMMER_RANGE "|" D_CMND_LEDTABLE "|" D_CMND_FADE "|"
+  D_CMND_COLOR "|" D_CMND_COLORTEMPERATURE "|" D_CMND_DIMMER "|" D_CMND_DIMMER_RANGE "|" D_CMND_LEDTABLE "|" D_CMND_FADE "|" D_CMND_FADECURVE "|"
   D_CMND_RGBWWTABLE "|" D_CMND_SCHEME "|" D_CMND_SPEED "|" D_CMND_WAKEUP "|" D_CMND_WAKEUPDURATION "|"
   D_CMND_WHITE "|" D_CMND_CHANNEL "|" D_CMND_HSBCOLOR
 #ifdef USE_LIGHT_PALETTE
@@ -141,7 +153,7 @@ const char kLightCommands[] PROGMEM = "|"  // No prefix
    "|UNDOCA" ;
 
 void (* const LightCommand[])(void) PROGMEM = {
-  &CmndColor, &CmndColorTemperature, &CmndDimmer, &CmndDimmerRange, &CmndLedTable, &CmndFade,
+  &CmndColor, &CmndColorTemperature, &CmndDimmer, &CmndDimmerRange, &CmndLedTable, &CmndFade, &CmndFadeCurve,
   &CmndRgbwwTable, &CmndScheme, &CmndSpeed, &CmndWakeup, &CmndWakeupDuration,
   &CmndWhite, &CmndChannel, &CmndHsbColor,
 #ifdef USE_LIGHT_PALETTE
@@ -259,6 +271,217 @@ const gamma_table_t gamma_table_fast[] = {
 // 458,480,496,518,534,557,579,595,617,635,657,673,695,713,743,
 // 773,793,823,843,873,893,923,943,973,993,1023
 
+// Full 10 bits lookup tables replacing the segment walk of ledGamma_internal() and
+// ledGammaReverse_internal() for inputs 0..1023. Generated from gamma_table and
+// gamma_table_fast above with the same changeUIntScale() rounding so regenerate them
+// when changing those tables. Aligned words in flash on ESP8266, data RAM on ESP32.
+#ifdef ESP32
+#define LIGHT_GAMMA_LUT_ATTR DRAM_ATTR
+#else
+#define LIGHT_GAMMA_LUT_ATTR PROGMEM __attribute__((aligned(4)))
+#endif  // ESP32
+
+const uint16_t kGammaLut[1024] LIGHT_GAMMA_LUT_ATTR = {   // ledGamma_internal(v, gamma_table)
+     0,    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,    2,    2,    2,
+     2,    2,    2,    2,    2,    2,    2,    2,    2,    2,    2,    2,    2,    2,    3,    3,
+     3,    3,    3,    3,    3,    3,    3,    3,    3,    3,    3,    3,    3,    3,    3,    4,
+     4,    4,    4,    4,    4,    4,    4,    4,    4,    4,    4,    4,    4,    4,    4,    4,
+     5,    5,    5,    5,    5,    5,    5,    5,    5,    5,    5,    5,    5,    5,    5,    5,
+     5,    6,    6,    6,    6,    6,    6,    6,    6,    6,    6,    6,    6,    6,    6,    6,
+     6,    6,    7,    7,    7,    7,    7,    7,    7,    7,    7,    7,    7,    7,    7,    7,
+     7,    7,    7,    7,    8,    8,    8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+     8,    8,    8,    8,    8,    9,    9,    9,    9,    9,    9,    9,    9,    9,    9,    9,
+     9,    9,    9,    9,    9,    9,   10,   10,   10,   10,   10,   10,   10,   10,   10,   10,
+    10,   10,   10,   10,   10,   10,   10,   11,   11,   11,   11,   11,   11,   11,   11,   11,
+    11,   11,   11,   11,   11,   11,   11,   11,   12,   12,   12,   12,   12,   12,   12,   12,
+    12,   12,   12,   12,   12,   12,   12,   12,   12,   13,   13,   13,   13,   13,   13,   13,
+    13,   13,   13,   14,   14,   14,   14,   15,   15,   15,   15,   16,   16,   16,   17,   17,
+    17,   17,   18,   18,   18,   18,   19,   19,   19,   20,   20,   20,   20,   21,   21,   21,
+    21,   22,   22,   22,   23,   23,   23,   23,   24,   24,   24,   24,   25,   25,   25,   26,
+    26,   26,   26,   27,   27,   27,   27,   28,   28,   28,   28,   29,   29,   29,   30,   30,
+    30,   30,   31,   31,   31,   31,   32,   32,   32,   33,   33,   33,   33,   34,   34,   34,
+    34,   35,   35,   35,   36,   36,   36,   36,   37,   37,   37,   37,   38,   38,   38,   39,
+    39,   39,   39,   40,   40,   40,   40,   41,   41,   41,   42,   42,   43,   43,   44,   44,
+    45,   45,   45,   46,   46,   47,   47,   48,   48,   49,   49,   50,   50,   50,   51,   51,
+    52,   52,   53,   53,   54,   54,   54,   55,   55,   56,   56,   57,   57,   58,   58,   58,
+    59,   59,   60,   60,   61,   61,   62,   62,   63,   63,   63,   64,   64,   65,   65,   66,
+    66,   67,   67,   67,   68,   68,   69,   69,   70,   70,   71,   71,   71,   72,   72,   73,
+    73,   74,   74,   75,   75,   76,   76,   76,   77,   77,   78,   78,   79,   79,   80,   80,
+    80,   81,   81,   82,   82,   83,   83,   84,   84,   84,   85,   85,   86,   86,   87,   87,
+    88,   88,   89,   89,   89,   90,   90,   91,   91,   92,   92,   93,   93,   93,   94,   94,
+    95,   95,   96,   96,   97,   97,   97,   98,   98,   99,   99,  100,  100,  101,  101,  102,
+   102,  102,  103,  103,  104,  104,  105,  105,  106,  106,  107,  108,  109,  110,  111,  112,
+   112,  113,  114,  115,  116,  117,  118,  119,  120,  121,  122,  123,  123,  124,  125,  126,
+   127,  128,  129,  130,  131,  132,  133,  134,  134,  135,  136,  137,  138,  139,  140,  141,
+   142,  143,  144,  145,  145,  146,  147,  148,  149,  150,  151,  152,  153,  154,  155,  156,
+   156,  157,  158,  159,  160,  161,  162,  163,  164,  165,  166,  167,  167,  168,  169,  170,
+   171,  172,  173,  174,  175,  176,  177,  178,  178,  179,  180,  181,  182,  183,  184,  185,
+   186,  187,  188,  189,  189,  190,  191,  192,  193,  194,  195,  196,  197,  198,  199,  200,
+   200,  201,  202,  203,  204,  205,  206,  207,  208,  209,  210,  211,  211,  212,  213,  214,
+   215,  216,  217,  218,  219,  220,  221,  222,  222,  223,  224,  225,  226,  227,  228,  229,
+   230,  231,  232,  233,  233,  234,  235,  236,  237,  238,  239,  240,  241,  242,  243,  244,
+   244,  245,  246,  247,  248,  249,  250,  251,  252,  253,  254,  255,  255,  256,  257,  258,
+   259,  260,  261,  262,  264,  265,  267,  268,  269,  271,  272,  274,  275,  276,  278,  279,
+   280,  282,  283,  285,  286,  287,  289,  290,  292,  293,  294,  296,  297,  299,  300,  301,
+   303,  304,  305,  307,  308,  310,  311,  312,  314,  315,  317,  318,  319,  321,  322,  324,
+   325,  326,  328,  329,  330,  332,  333,  335,  336,  337,  339,  340,  342,  343,  344,  346,
+   347,  349,  350,  351,  353,  354,  356,  357,  358,  360,  361,  362,  364,  365,  367,  368,
+   369,  371,  372,  374,  375,  376,  378,  379,  381,  382,  383,  385,  386,  387,  389,  390,
+   392,  393,  394,  396,  397,  399,  400,  401,  403,  404,  406,  407,  408,  410,  411,  412,
+   414,  415,  417,  418,  419,  421,  422,  424,  425,  426,  428,  429,  431,  432,  433,  435,
+   436,  437,  439,  440,  442,  443,  444,  446,  447,  449,  450,  452,  454,  456,  458,  460,
+   461,  463,  465,  467,  469,  471,  473,  475,  477,  479,  480,  482,  484,  486,  488,  490,
+   492,  494,  496,  498,  499,  501,  503,  505,  507,  509,  511,  513,  515,  517,  518,  520,
+   522,  524,  526,  528,  530,  532,  534,  536,  538,  539,  541,  543,  545,  547,  549,  551,
+   553,  555,  557,  558,  560,  562,  564,  566,  568,  570,  572,  574,  576,  577,  579,  581,
+   583,  585,  587,  589,  591,  593,  595,  596,  598,  600,  602,  604,  606,  608,  610,  612,
+   614,  615,  617,  619,  621,  623,  625,  627,  629,  631,  633,  635,  636,  638,  640,  642,
+   644,  646,  648,  650,  652,  654,  655,  657,  659,  661,  663,  665,  667,  669,  671,  673,
+   674,  676,  678,  680,  682,  684,  686,  688,  690,  692,  693,  695,  697,  699,  701,  703,
+   706,  708,  711,  713,  716,  718,  721,  723,  726,  728,  731,  733,  736,  738,  741,  743,
+   746,  748,  751,  753,  756,  758,  761,  763,  766,  768,  771,  773,  776,  778,  781,  783,
+   786,  788,  791,  793,  796,  798,  801,  803,  806,  808,  811,  813,  816,  818,  821,  823,
+   826,  828,  831,  833,  836,  838,  841,  843,  846,  848,  851,  853,  856,  858,  861,  863,
+   866,  868,  871,  873,  876,  878,  881,  883,  886,  888,  891,  893,  896,  898,  901,  903,
+   906,  908,  911,  913,  916,  918,  921,  923,  926,  928,  931,  933,  936,  938,  941,  943,
+   946,  948,  951,  953,  956,  958,  961,  963,  966,  968,  971,  973,  976,  978,  981,  983,
+   986,  988,  991,  993,  996,  998, 1001, 1003, 1006, 1008, 1011, 1013, 1016, 1018, 1021, 1023
+};
+
+const uint16_t kGammaFastLut[1024] LIGHT_GAMMA_LUT_ATTR = {   // ledGamma_internal(v, gamma_table_fast)
+     0,    1,    1,    2,    2,    3,    3,    4,    4,    5,    5,    6,    6,    7,    7,    8,
+     8,    9,    9,   10,   10,   11,   11,   12,   12,   13,   13,   14,   14,   15,   15,   16,
+    16,   17,   17,   18,   18,   19,   19,   20,   20,   21,   21,   22,   22,   23,   23,   24,
+    24,   25,   25,   26,   26,   27,   27,   28,   28,   29,   29,   30,   30,   31,   31,   32,
+    32,   33,   33,   34,   34,   35,   35,   36,   36,   37,   37,   38,   38,   39,   39,   40,
+    40,   41,   41,   42,   42,   43,   43,   44,   44,   45,   45,   46,   46,   47,   47,   48,
+    48,   49,   49,   50,   50,   51,   51,   52,   52,   53,   53,   54,   54,   55,   55,   56,
+    56,   57,   57,   58,   58,   59,   59,   60,   60,   61,   61,   62,   62,   63,   63,   64,
+    64,   65,   65,   66,   66,   67,   67,   68,   68,   69,   69,   70,   70,   71,   71,   72,
+    72,   73,   73,   74,   74,   75,   75,   76,   76,   77,   77,   78,   78,   79,   79,   80,
+    80,   81,   81,   82,   82,   83,   83,   84,   84,   85,   85,   86,   86,   87,   87,   88,
+    88,   89,   89,   90,   90,   91,   91,   92,   92,   93,   93,   94,   94,   95,   95,   96,
+    96,   97,   97,   98,   98,   99,   99,  100,  100,  101,  101,  102,  102,  103,  103,  104,
+   104,  105,  105,  106,  106,  107,  107,  108,  108,  109,  109,  110,  110,  111,  111,  112,
+   112,  113,  113,  114,  114,  115,  115,  116,  116,  117,  117,  118,  118,  119,  119,  120,
+   120,  121,  121,  122,  122,  123,  123,  124,  124,  125,  125,  126,  126,  127,  127,  128,
+   128,  129,  129,  130,  130,  131,  131,  132,  132,  133,  133,  134,  134,  135,  135,  136,
+   136,  137,  137,  138,  138,  139,  139,  140,  140,  141,  141,  142,  142,  143,  143,  144,
+   144,  145,  145,  146,  146,  147,  147,  148,  148,  149,  149,  150,  150,  151,  151,  152,
+   152,  153,  153,  154,  154,  155,  155,  156,  156,  157,  157,  158,  158,  159,  159,  160,
+   160,  161,  161,  162,  162,  163,  163,  164,  164,  165,  165,  166,  166,  167,  167,  168,
+   168,  169,  169,  170,  170,  171,  171,  172,  172,  173,  173,  174,  174,  175,  175,  176,
+   176,  177,  177,  178,  178,  179,  179,  180,  180,  181,  181,  182,  182,  183,  183,  184,
+   184,  185,  185,  186,  186,  187,  187,  188,  188,  189,  189,  190,  190,  191,  191,  192,
+   192,  193,  194,  195,  196,  197,  198,  199,  200,  201,  202,  203,  204,  205,  206,  207,
+   208,  209,  210,  211,  212,  213,  214,  215,  216,  217,  218,  219,  220,  221,  222,  223,
+   224,  225,  226,  227,  228,  229,  230,  231,  232,  233,  234,  235,  236,  237,  238,  239,
+   240,  241,  242,  243,  244,  245,  246,  247,  248,  249,  250,  251,  252,  253,  254,  255,
+   256,  257,  258,  259,  260,  261,  262,  263,  264,  265,  266,  267,  268,  269,  270,  271,
+   272,  273,  274,  275,  276,  277,  278,  279,  280,  281,  282,  283,  284,  285,  286,  287,
+   288,  289,  290,  291,  292,  293,  294,  295,  296,  297,  298,  299,  300,  301,  302,  303,
+   304,  305,  306,  307,  308,  309,  310,  311,  312,  313,  314,  315,  316,  317,  318,  319,
+   320,  321,  322,  323,  324,  325,  326,  327,  328,  329,  330,  331,  332,  333,  334,  335,
+   336,  337,  338,  339,  340,  341,  342,  343,  344,  345,  346,  347,  348,  349,  350,  351,
+   352,  353,  354,  355,  356,  357,  358,  359,  360,  361,  362,  363,  364,  365,  366,  367,
+   368,  369,  370,  371,  372,  373,  374,  375,  376,  377,  378,  379,  380,  381,  382,  383,
+   384,  385,  386,  387,  388,  389,  390,  391,  392,  393,  394,  395,  396,  397,  398,  399,
+   400,  401,  402,  403,  404,  405,  406,  407,  408,  409,  410,  411,  412,  413,  414,  415,
+   416,  417,  418,  419,  420,  421,  422,  423,  424,  425,  426,  427,  428,  429,  430,  431,
+   432,  433,  434,  435,  436,  437,  438,  439,  440,  441,  442,  443,  444,  445,  446,  447,
+   448,  449,  450,  451,  452,  453,  454,  455,  456,  457,  458,  459,  460,  461,  462,  463,
+   464,  465,  466,  467,  468,  469,  470,  471,  472,  473,  474,  475,  476,  477,  478,  479,
+   480,  481,  482,  483,  484,  485,  486,  487,  488,  489,  490,  491,  492,  493,  494,  495,
+   496,  497,  498,  499,  500,  501,  502,  503,  504,  505,  506,  507,  508,  509,  510,  511,
+   512,  513,  514,  515,  516,  517,  518,  519,  520,  521,  522,  523,  524,  525,  526,  527,
+   528,  529,  530,  531,  532,  533,  534,  535,  536,  537,  538,  539,  540,  541,  542,  543,
+   544,  545,  546,  547,  548,  549,  550,  551,  552,  553,  554,  555,  556,  557,  558,  559,
+   560,  561,  562,  563,  564,  565,  566,  567,  568,  569,  570,  571,  572,  573,  574,  575,
+   576,  578,  580,  581,  583,  585,  587,  588,  590,  592,  594,  595,  597,  599,  601,  602,
+   604,  606,  608,  609,  611,  613,  615,  616,  618,  620,  622,  623,  625,  627,  629,  630,
+   632,  634,  636,  637,  639,  641,  643,  644,  646,  648,  650,  651,  653,  655,  657,  658,
+   660,  662,  664,  665,  667,  669,  671,  672,  674,  676,  678,  679,  681,  683,  685,  686,
+   688,  690,  692,  693,  695,  697,  699,  700,  702,  704,  706,  707,  709,  711,  713,  714,
+   716,  718,  720,  721,  723,  725,  727,  729,  730,  732,  734,  736,  737,  739,  741,  743,
+   744,  746,  748,  750,  751,  753,  755,  757,  758,  760,  762,  764,  765,  767,  769,  771,
+   772,  774,  776,  778,  779,  781,  783,  785,  786,  788,  790,  792,  793,  795,  797,  799,
+   800,  802,  804,  806,  807,  809,  811,  813,  814,  816,  818,  820,  821,  823,  825,  827,
+   828,  830,  832,  834,  835,  837,  839,  841,  842,  844,  846,  848,  849,  851,  853,  855,
+   856,  858,  860,  862,  863,  865,  867,  869,  870,  872,  874,  876,  878,  879,  881,  883,
+   885,  886,  888,  890,  892,  893,  895,  897,  899,  900,  902,  904,  906,  907,  909,  911,
+   913,  914,  916,  918,  920,  921,  923,  925,  927,  928,  930,  932,  934,  935,  937,  939,
+   941,  942,  944,  946,  948,  949,  951,  953,  955,  956,  958,  960,  962,  963,  965,  967,
+   969,  970,  972,  974,  976,  977,  979,  981,  983,  984,  986,  988,  990,  991,  993,  995,
+   997,  998, 1000, 1002, 1004, 1005, 1007, 1009, 1011, 1012, 1014, 1016, 1018, 1019, 1021, 1023
+};
+
+const uint16_t kGammaFastReverseLut[1024] LIGHT_GAMMA_LUT_ATTR = {   // ledGammaReverse_internal(v, gamma_table_fast)
+     0,    2,    4,    6,    8,   10,   12,   14,   16,   18,   20,   22,   24,   26,   28,   30,
+    32,   34,   36,   38,   40,   42,   44,   46,   48,   50,   52,   54,   56,   58,   60,   62,
+    64,   66,   68,   70,   72,   74,   76,   78,   80,   82,   84,   86,   88,   90,   92,   94,
+    96,   98,  100,  102,  104,  106,  108,  110,  112,  114,  116,  118,  120,  122,  124,  126,
+   128,  130,  132,  134,  136,  138,  140,  142,  144,  146,  148,  150,  152,  154,  156,  158,
+   160,  162,  164,  166,  168,  170,  172,  174,  176,  178,  180,  182,  184,  186,  188,  190,
+   192,  194,  196,  198,  200,  202,  204,  206,  208,  210,  212,  214,  216,  218,  220,  222,
+   224,  226,  228,  230,  232,  234,  236,  238,  240,  242,  244,  246,  248,  250,  252,  254,
+   256,  258,  260,  262,  264,  266,  268,  270,  272,  274,  276,  278,  280,  282,  284,  286,
+   288,  290,  292,  294,  296,  298,  300,  302,  304,  306,  308,  310,  312,  314,  316,  318,
+   320,  322,  324,  326,  328,  330,  332,  334,  336,  338,  340,  342,  344,  346,  348,  350,
+   352,  354,  356,  358,  360,  362,  364,  366,  368,  370,  372,  374,  376,  378,  380,  382,
+   384,  385,  386,  387,  388,  389,  390,  391,  392,  393,  394,  395,  396,  397,  398,  399,
+   400,  401,  402,  403,  404,  405,  406,  407,  408,  409,  410,  411,  412,  413,  414,  415,
+   416,  417,  418,  419,  420,  421,  422,  423,  424,  425,  426,  427,  428,  429,  430,  431,
+   432,  433,  434,  435,  436,  437,  438,  439,  440,  441,  442,  443,  444,  445,  446,  447,
+   448,  449,  450,  451,  452,  453,  454,  455,  456,  457,  458,  459,  460,  461,  462,  463,
+   464,  465,  466,  467,  468,  469,  470,  471,  472,  473,  474,  475,  476,  477,  478,  479,
+   480,  481,  482,  483,  484,  485,  486,  487,  488,  489,  490,  491,  492,  493,  494,  495,
+   496,  497,  498,  499,  500,  501,  502,  503,  504,  505,  506,  507,  508,  509,  510,  511,
+   512,  513,  514,  515,  516,  517,  518,  519,  520,  521,  522,  523,  524,  525,  526,  527,
+   528,  529,  530,  531,  532,  533,  534,  535,  536,  537,  538,  539,  540,  541,  542,  543,
+   544,  545,  546,  547,  548,  549,  550,  551,  552,  553,  554,  555,  556,  557,  558,  559,
+   560,  561,  562,  563,  564,  565,  566,  567,  568,  569,  570,  571,  572,  573,  574,  575,
+   576,  577,  578,  579,  580,  581,  582,  583,  584,  585,  586,  587,  588,  589,  590,  591,
+   592,  593,  594,  595,  596,  597,  598,  599,  600,  601,  602,  603,  604,  605,  606,  607,
+   608,  609,  610,  611,  612,  613,  614,  615,  616,  617,  618,  619,  620,  621,  622,  623,
+   624,  625,  626,  627,  628,  629,  630,  631,  632,  633,  634,  635,  636,  637,  638,  639,
+   640,  641,  642,  643,  644,  645,  646,  647,  648,  649,  650,  651,  652,  653,  654,  655,
+   656,  657,  658,  659,  660,  661,  662,  663,  664,  665,  666,  667,  668,  669,  670,  671,
+   672,  673,  674,  675,  676,  677,  678,  679,  680,  681,  682,  683,  684,  685,  686,  687,
+   688,  689,  690,  691,  692,  693,  694,  695,  696,  697,  698,  699,  700,  701,  702,  703,
+   704,  705,  706,  707,  708,  709,  710,  711,  712,  713,  714,  715,  716,  717,  718,  719,
+   720,  721,  722,  723,  724,  725,  726,  727,  728,  729,  730,  731,  732,  733,  734,  735,
+   736,  737,  738,  739,  740,  741,  742,  743,  744,  745,  746,  747,  748,  749,  750,  751,
+   752,  753,  754,  755,  756,  757,  758,  759,  760,  761,  762,  763,  764,  765,  766,  767,
+   768,  769,  769,  770,  770,  771,  771,  772,  773,  773,  774,  774,  775,  775,  776,  777,
+   777,  778,  778,  779,  779,  780,  781,  781,  782,  782,  783,  783,  784,  785,  785,  786,
+   786,  787,  787,  788,  789,  789,  790,  790,  791,  791,  792,  793,  793,  794,  794,  795,
+   795,  796,  797,  797,  798,  798,  799,  799,  800,  801,  801,  802,  802,  803,  803,  804,
+   805,  805,  806,  806,  807,  807,  808,  809,  809,  810,  810,  811,  811,  812,  812,  813,
+   814,  814,  815,  815,  816,  816,  817,  818,  818,  819,  819,  820,  820,  821,  822,  822,
+   823,  823,  824,  824,  825,  826,  826,  827,  827,  828,  828,  829,  830,  830,  831,  831,
+   832,  832,  833,  834,  834,  835,  835,  836,  836,  837,  838,  838,  839,  839,  840,  840,
+   841,  842,  842,  843,  843,  844,  844,  845,  846,  846,  847,  847,  848,  848,  849,  850,
+   850,  851,  851,  852,  852,  853,  854,  854,  855,  855,  856,  856,  857,  858,  858,  859,
+   859,  860,  860,  861,  862,  862,  863,  863,  864,  864,  865,  866,  866,  867,  867,  868,
+   868,  869,  870,  870,  871,  871,  872,  872,  873,  874,  874,  875,  875,  876,  876,  877,
+   878,  878,  879,  879,  880,  880,  881,  882,  882,  883,  883,  884,  884,  885,  886,  886,
+   887,  887,  888,  888,  889,  890,  890,  891,  891,  892,  892,  893,  894,  894,  895,  895,
+   896,  896,  897,  897,  898,  899,  899,  900,  900,  901,  901,  902,  903,  903,  904,  904,
+   905,  905,  906,  907,  907,  908,  908,  909,  909,  910,  911,  911,  912,  912,  913,  913,
+   914,  915,  915,  916,  916,  917,  917,  918,  919,  919,  920,  920,  921,  921,  922,  923,
+   923,  924,  924,  925,  925,  926,  927,  927,  928,  928,  929,  929,  930,  931,  931,  932,
+   932,  933,  933,  934,  935,  935,  936,  936,  937,  937,  938,  939,  939,  940,  940,  941,
+   941,  942,  943,  943,  944,  944,  945,  945,  946,  947,  947,  948,  948,  949,  949,  950,
+   951,  951,  952,  952,  953,  953,  954,  955,  955,  956,  956,  957,  957,  958,  959,  959,
+   960,  960,  961,  961,  962,  963,  963,  964,  964,  965,  965,  966,  967,  967,  968,  968,
+   969,  969,  970,  971,  971,  972,  972,  973,  973,  974,  975,  975,  976,  976,  977,  977,
+   978,  979,  979,  980,  980,  981,  981,  982,  982,  983,  984,  984,  985,  985,  986,  986,
+   987,  988,  988,  989,  989,  990,  990,  991,  992,  992,  993,  993,  994,  994,  995,  996,
+   996,  997,  997,  998,  998,  999, 1000, 1000, 1001, 1001, 1002, 1002, 1003, 1004, 1004, 1005,
+  1005, 1006, 1006, 1007, 1008, 1008, 1009, 1009, 1010, 1010, 1011, 1012, 1012, 1013, 1013, 1014,
+  1014, 1015, 1016, 1016, 1017, 1017, 1018, 1018, 1019, 1020, 1020, 1021, 1021, 1022, 1022, 1023
+};
+
 struct LIGHT {
   uint32_t strip_timer_counter = 0;  // Bars and Gradient
   power_t power = 0;                      // Power<x> for each channel if SetOption68, or boolean if single light
@@ -283,7 +506,11 @@ struct LIGHT {
   uint8_t max_scheme = LS_MAX -1;
 
   bool update = true;
+  bool stream = false;                    // Outputs are controlled by a stream received by the light driver
   bool pwm_multi_channels = false;        // SetOption68, treat each PWM channel as an independant dimmer
+  bool transaction = false;               // Collecting changes until transaction_end
+  bool transaction_state = false;         // A light state was held back and is published when the transaction ends
+  uint32_t transaction_end = 0;           // millis() at which collected changes are applied
 
   bool     fade_initialized = false;      // dont't fade at startup
   bool     fade_running = false;
@@ -834,6 +1061,122 @@ void LightStateClass::HsToRgb(uint16_t hue, uint8_t sat, uint8_t *r_r, uint8_t *
   if (r_b)  *r_b = b;
 }
 
+#ifdef USE_LIGHT_XY_FIXED_POINT
+//
+// Fixed point conversion between RGB and CIE xy, avoiding soft float and powf on ESP8266
+// sRGB transfer function as 0..65535 linear value per 8 bit channel value
+//
+const uint16_t kSrgbToLinear[256] PROGMEM = {
+      0,    20,    40,    60,    80,    99,   119,   139,   159,   179,   199,   219,   241,   264,   288,   313,
+    340,   367,   396,   427,   458,   491,   526,   562,   599,   637,   677,   718,   761,   805,   851,   898,
+    947,   997,  1048,  1101,  1156,  1212,  1270,  1330,  1391,  1453,  1517,  1583,  1651,  1720,  1790,  1863,
+   1937,  2013,  2090,  2170,  2250,  2333,  2418,  2504,  2592,  2681,  2773,  2866,  2961,  3058,  3157,  3258,
+   3360,  3464,  3570,  3678,  3788,  3900,  4014,  4129,  4247,  4366,  4488,  4611,  4736,  4864,  4993,  5124,
+   5257,  5392,  5530,  5669,  5810,  5953,  6099,  6246,  6395,  6547,  6700,  6856,  7014,  7174,  7335,  7500,
+   7666,  7834,  8004,  8177,  8352,  8528,  8708,  8889,  9072,  9258,  9445,  9635,  9828, 10022, 10219, 10417,
+  10619, 10822, 11028, 11235, 11446, 11658, 11873, 12090, 12309, 12530, 12754, 12980, 13209, 13440, 13673, 13909,
+  14146, 14387, 14629, 14874, 15122, 15371, 15623, 15878, 16135, 16394, 16656, 16920, 17187, 17456, 17727, 18001,
+  18277, 18556, 18837, 19121, 19407, 19696, 19987, 20281, 20577, 20876, 21177, 21481, 21787, 22096, 22407, 22721,
+  23038, 23357, 23678, 24002, 24329, 24658, 24990, 25325, 25662, 26001, 26344, 26688, 27036, 27386, 27739, 28094,
+  28452, 28813, 29176, 29542, 29911, 30282, 30656, 31033, 31412, 31794, 32179, 32567, 32957, 33350, 33745, 34143,
+  34544, 34948, 35355, 35764, 36176, 36591, 37008, 37429, 37852, 38278, 38706, 39138, 39572, 40009, 40449, 40891,
+  41337, 41785, 42236, 42690, 43147, 43606, 44069, 44534, 45002, 45473, 45947, 46423, 46903, 47385, 47871, 48359,
+  48850, 49344, 49841, 50341, 50844, 51349, 51858, 52369, 52884, 53401, 53921, 54445, 54971, 55500, 56032, 56567,
+  57105, 57646, 58190, 58737, 59287, 59840, 60396, 60955, 61517, 62082, 62650, 63221, 63795, 64372, 64952, 65535
+};
+
+// Linear 0..65535 to the closest 8 bit sRGB value by binary search in kSrgbToLinear
+uint8_t LinearToSrgb(uint32_t linear) {
+  uint32_t low = 0;
+  uint32_t high = 255;
+  while (low < high) {
+    uint32_t mid = (low + high + 1) / 2;
+    if (pgm_read_word(&kSrgbToLinear[mid]) <= linear) {
+      low = mid;
+    } else {
+      high = mid -1;
+    }
+  }
+  if ((low < 255) && (pgm_read_word(&kSrgbToLinear[low +1]) - linear < linear - pgm_read_word(&kSrgbToLinear[low]))) {
+    low++;
+  }
+  return low;
+}
+
+void LightStateClass::RgbToXy(uint8_t i_r, uint8_t i_g, uint8_t i_b, float *r_x, float *r_y) {
+  float x = 0.31271f;   // default medium white
+  float y = 0.32902f;
+
+  if (i_r + i_b + i_g > 0) {
+    uint32_t rgb[3] = { pgm_read_word(&kSrgbToLinear[i_r]), pgm_read_word(&kSrgbToLinear[i_g]), pgm_read_word(&kSrgbToLinear[i_b]) };
+
+    // conversion to X, Y, Z, factors in Q14
+    static const uint16_t XYZ_factors[] = { 10648,  1695,  3229,
+                                             3839, 12175,   370,
+                                                0,   870, 16970 };
+    uint32_t XYZ[3];
+    for (uint32_t i = 0; i < 3; i++) {
+      XYZ[i] = XYZ_factors[i*3] * rgb[0] + XYZ_factors[i*3 +1] * rgb[1] + XYZ_factors[i*3 +2] * rgb[2];
+    }
+
+    uint32_t XYZ_sum = XYZ[0] + XYZ[1] + XYZ[2];   // Fits as sum of factors * 65535 < 2^32
+    while (XYZ_sum >= (1 << 18)) {                  // keep 18 bits so the Q14 ratio does not overflow
+      XYZ_sum >>= 1;
+      XYZ[0] >>= 1;
+      XYZ[1] >>= 1;
+    }
+    if (XYZ_sum) {
+      x = (float)((XYZ[0] << 14) / XYZ_sum) * (1.0f / 16384);
+      y = (float)((XYZ[1] << 14) / XYZ_sum) * (1.0f / 16384);
+    }
+  }
+  if (r_x)  *r_x = x;
+  if (r_y)  *r_y = y;
+}
+
+void LightStateClass::XyToRgb(float x, float y, uint8_t *rr, uint8_t *rg, uint8_t *rb)
+{
+  int32_t ix = x * 65536;   // Q16
+  int32_t iy = y * 65536;
+  ix = (ix > 64880 ? 64880 : (ix < 655 ? 655 : ix));   // 0.01 .. 0.99
+  iy = (iy > 64880 ? 64880 : (iy < 655 ? 655 : iy));
+
+  int32_t XYZ[3];           // Q15
+  XYZ[0] = ((uint32_t)ix << 15) / iy;
+  XYZ[1] = 32768;
+  XYZ[2] = ((65536 - ix - iy) * 32768) / iy;
+
+  // factors in Q16
+  static const int32_t rgb_factors[] = {  212376, -100742, -32676,
+                                          -63498,  122932,   2720,
+                                            3650,  -13369,  69272 };
+  int32_t rgb[3];
+  int32_t max = 1;
+  for (uint32_t i = 0; i < 3; i++) {
+    int64_t sum = 0;
+    for (uint32_t j = 0; j < 3; j++) {
+      sum += (int64_t)rgb_factors[i*3 +j] * XYZ[j];
+    }
+    rgb[i] = (sum > 0) ? (sum >> 16) : 0;   // Q15, negative values are out of gamut
+    if (rgb[i] > max) { max = rgb[i]; }
+  }
+  while (max > 0xFFFF) {    // normalize to max == 1.0 without overflow
+    max >>= 1;
+    for (uint32_t i = 0; i < 3; i++) { rgb[i] >>= 1; }
+  }
+
+  uint8_t irgb[3];
+  for (uint32_t i = 0; i < 3; i++) {
+    irgb[i] = LinearToSrgb(((uint32_t)rgb[i] * 65535 + max / 2) / max);   // gamma
+  }
+
+  if (rr) { *rr = irgb[0]; }
+  if (rg) { *rg = irgb[1]; }
+  if (rb) { *rb = irgb[2]; }
+}
+
+#else  // USE_LIGHT_XY_FIXED_POINT
+
 #define POW FastPrecisePowf
 
 //
@@ -911,6 +1254,8 @@ void LightStateClass::XyToRgb(float x, float y, uint8_t *rr, uint8_t *rg, uint8_
   if (rb) { *rb = (irgb[2] > 255 ? 255: (irgb[2] < 0 ? 0 : irgb[2])); }
 }
 
+#endif  // USE_LIGHT_XY_FIXED_POINT
+
 class LightControllerClass {
 private:
   LightStateClass *_state;
@@ -1232,7 +1577,8 @@ uint16_t ledGammaReverse_internal(uint16_t vg, const struct gamma_table_t *gt_pt
 
 // 10 bits in, 10 bits out
 uint16_t ledGamma10_10(uint16_t v) {
-  return ledGamma_internal(v, gamma_table);
+  if (v > 1023) { return ledGamma_internal(v, gamma_table); }
+  return pgm_read_word(&kGammaLut[v]);
 }
 // 10 bits resolution, 8 bits in
 uint16_t ledGamma10(uint8_t v) {
@@ -1623,7 +1969,54 @@ void LightState(uint8_t append)
   }
 }
 
+/*********************************************************************************************\
+ * Light transaction
+ *
+ * Changes following each other within LIGHT_TRANSACTION_WINDOW mSeconds, like the steps of a
+ * dragged web slider, are applied once to the outputs and xlgt drivers, sent once as device
+ * group update and published once as light state. The window starts at the first change and
+ * is not extended so outputs follow a continuous drag at the window rate.
+\*********************************************************************************************/
+
+void LightTransactionBegin(void) {
+  if (!LIGHT_TRANSACTION_WINDOW) { return; }
+  if (!Light.transaction) {
+    Light.transaction = true;
+    Light.transaction_end = millis() + LIGHT_TRANSACTION_WINDOW;
+  }
+}
+
+bool LightTransactionHoldState(void) {
+  // Web slider steps only, command responses to other sources are not delayed
+  if (Light.transaction && (SRC_WEBGUI == command_source)) {
+    Light.transaction_state = true;
+    return true;
+  }
+  return false;
+}
+
+void LightTransactionEnd(void) {
+  Light.transaction = false;
+  LightAnimate();              // Apply final state to the outputs and the device group
+  if (Light.transaction_state) {
+    Light.transaction_state = false;
+    LightState(0);
+    MqttPublishPrefixTopic_P(RESULT_OR_STAT, PSTR(D_RSLT_STATE));
+    XdrvRulesProcess();
+    if (Settings.flag3.hass_tele_on_power) {  // SetOption59 - Send tele/%topic%/STATE in addition to stat/%topic%/RESULT
+      MqttPublishTeleState();
+    }
+  }
+}
+
+void LightTransactionLoop(void) {
+  if (Light.transaction && TimeReached(Light.transaction_end)) {
+    LightTransactionEnd();
+  }
+}
+
 void LightPreparePower(power_t channels = 0xFFFFFFFF) {    // 1 = only RGB, 2 = only CT, 3 = both RGB and CT
+  LightTransactionBegin();
 #ifdef DEBUG_LIGHT
   AddLog_P2(LOG_LEVEL_DEBUG, "LightPreparePower power=%d Light.power=%d", power, Light.power);
 #endif
@@ -1683,7 +2076,8 @@ void LightPreparePower(power_t channels = 0xFFFFFFFF) {    // 1 = only RGB, 2 =
 #endif  // USE_DOMOTICZ
   }
 
-  if (Settings.flag3.hass_tele_on_power) {  // SetOption59 - Send tele/%topic%/STATE in addition to stat/%topic%/RESULT
+  bool hold_state = LightTransactionHoldState();
+  if (Settings.flag3.hass_tele_on_power && !hold_state) {  // SetOption59 - Send tele/%topic%/STATE in addition to stat/%topic%/RESULT
     MqttPublishTeleState();
   }
 
@@ -1691,7 +2085,11 @@ void LightPreparePower(power_t channels = 0xFFFFFFFF) {    // 1 = only RGB, 2 =
   AddLog_P2(LOG_LEVEL_DEBUG, "LightPreparePower End power=%d Light.power=%d", power, Light.power);
 #endif
   Light.power = power >> (Light.device - 1);  // reset next state, works also with unlinked RGB/CT
-  LightState(0);
+  if (hold_state) {
+    ResponseClear();     // Published once by LightTransactionEnd
+  } else {
+    LightState(0);
+  }
 }
 
 #ifdef USE_LIGHT_PALETTE
@@ -1814,7 +2212,9 @@ void LightAnimate(void)
 
   // set sleep parameter: either settings,
   // or set a maximum of PWM_MAX_SLEEP if light is on or Fade is running
-  if (Light.power || Light.fade_running) {
+  if (Light.stream) {
+    ssleep = 1;                    // poll the streamed frames without delay
+  } else if (Light.power || Light.fade_running) {
     if (Settings.sleep > PWM_MAX_SLEEP) {
       ssleep = PWM_MAX_SLEEP;      // set a maxumum value of 50 milliseconds to ensure that animations are smooth
     } else {
@@ -1989,6 +2389,9 @@ void LightAnimate(void)
           // if fade is running, we take the curring value as the start for the next fade
           memcpy(Light.fade_start_10, Light.fade_cur_10, sizeof(Light.fade_start_10));
         }
+#ifdef USE_LIGHT_FADE_TIMER
+        LightFadeTimerStop();       // don't let the timer use the targets while they change
+#endif  // USE_LIGHT_FADE_TIMER
         memcpy(Light.fade_end_10, cur_col_10, sizeof(Light.fade_start_10));
         Light.fade_running = true;
         Light.fade_duration = 0;    // set the value to zero to force a recompute
@@ -2037,19 +2440,83 @@ bool isChannelCT(uint32_t channel) {
 // Calculate the Gamma correction, if any, for fading, using the fast Gamma curve (10 bits in+out)
 uint16_t fadeGamma(uint32_t channel, uint16_t v) {
   if (isChannelGammaCorrected(channel)) {
-    return ledGamma_internal(v, gamma_table_fast);
+    if (v > 1023) { return ledGamma_internal(v, gamma_table_fast); }
+    return pgm_read_word(&kGammaFastLut[v]);
   } else {
     return v;
   }
 }
 uint16_t fadeGammaReverse(uint32_t channel, uint16_t vg) {
   if (isChannelGammaCorrected(channel)) {
-    return ledGammaReverse_internal(vg, gamma_table_fast);
+    if (vg > 1023) { return ledGammaReverse_internal(vg, gamma_table_fast); }
+    return pgm_read_word(&kGammaFastReverseLut[vg]);
   } else {
     return vg;
   }
 }
 
+// Fade progress 0..1023 for the elapsed time according to the selected curve
+uint32_t LightFadeEase(uint32_t elapsed, uint32_t duration) {
+  uint32_t p = changeUIntScale(elapsed, 0, duration, 0, 1023);
+  switch (Settings.light_fade_curve) {
+    case LFC_EASE_IN:
+      return (p * p) / 1023;
+    case LFC_EASE_OUT:
+      return 1023 - ((1023 - p) * (1023 - p)) / 1023;
+    case LFC_EASE_IN_OUT:
+      return (p * p * (3 * 1023 - 2 * p)) / (1023 * 1023);   // smoothstep
+  }
+  return p;
+}
+
+// Compute the faded channel values at elapsed milliseconds since start of fade
+void LightFadeValues(uint32_t elapsed, uint16_t *cur_col_10) {
+  uint32_t progress = LightFadeEase(elapsed, Light.fade_duration);
+  for (uint32_t i = 0; i < Light.subtype; i++) {
+    if (LFC_DEFAULT == Settings.light_fade_curve) {
+      cur_col_10[i] = fadeGamma(i,
+                        changeUIntScale(fadeGammaReverse(i, elapsed),
+                                     0, Light.fade_duration,
+                                     fadeGammaReverse(i, Light.fade_start_10[i]),
+                                     fadeGammaReverse(i, Light.fade_end_10[i])));
+    } else {
+      cur_col_10[i] = fadeGamma(i,
+                        changeUIntScale(progress,
+                                     0, 1023,
+                                     fadeGammaReverse(i, Light.fade_start_10[i]),
+                                     fadeGammaReverse(i, Light.fade_end_10[i])));
+    }
+  }
+}
+
+#ifdef USE_LIGHT_FADE_TIMER
+// Direct PWM fades are updated from a timer so they are smooth and finish on time independent of
+// loop load. LightApplyFade() from the loop still owns the fade state and drives all other outputs.
+void LightFadeTicker(void) {
+  if (!Light.fade_running) {
+    LightFadeTimerStop();     // fade was cancelled
+    return;
+  }
+  if (!Light.fade_duration) { return; }
+  uint32_t elapsed = millis() - Light.fade_start;
+  if (elapsed > Light.fade_duration) { elapsed = Light.fade_duration; }
+  uint16_t cur_col_10[LST_MAX];
+  memcpy(cur_col_10, Light.fade_end_10, sizeof(cur_col_10));
+  LightFadeValues(elapsed, cur_col_10);
+  LightSetPwm(cur_col_10);
+}
+
+void LightFadeTimerStart(void) {
+  if (light_type < LT_PWM6) {   // only for direct PWM lights
+    TickerLightFade.attach_ms(LIGHT_FADE_TIMER_MS, LightFadeTicker);
+  }
+}
+
+void LightFadeTimerStop(void) {
+  TickerLightFade.detach();
+}
+#endif  // USE_LIGHT_FADE_TIMER
+
 bool LightApplyFade(void) {   // did the value chanegd and needs to be applied
   static uint32_t last_millis = 0;
   uint32_t now = millis();
@@ -2082,28 +2549,25 @@ bool LightApplyFade(void) {   // did the value chanegd and needs to be applied
           save_data_counter = delay_seconds;      // pospone
         }
       }
+#ifdef USE_LIGHT_FADE_TIMER
+      LightFadeTimerStart();
+#endif  // USE_LIGHT_FADE_TIMER
     } else {
       // no fade needed, we keep the duration at zero, it will fallback directly to end of fade
       Light.fade_running = false;
     }
   }
 
-  uint16_t fade_current = now - Light.fade_start;   // number of milliseconds since start of fade
+  uint32_t fade_current = now - Light.fade_start;   // number of milliseconds since start of fade
   if (fade_current <= Light.fade_duration) {    // fade not finished
     //Serial.printf("Fade: %d / %d - ", fade_current, Light.fade_duration);
-    for (uint32_t i = 0; i < Light.subtype; i++) {
-      Light.fade_cur_10[i] = fadeGamma(i,
-                                changeUIntScale(fadeGammaReverse(i, fade_current),
-                                             0, Light.fade_duration,
-                                             fadeGammaReverse(i, Light.fade_start_10[i]),
-                                             fadeGammaReverse(i, Light.fade_end_10[i])));
-      // Light.fade_cur_10[i] = changeUIntScale(fade_current,
-      //                                        0, Light.fade_duration,
-      //                                        Light.fade_start_10[i], Light.fade_end_10[i]);
-    }
+    LightFadeValues(fade_current, Light.fade_cur_10);
   } else {
     // stop fade
 //AddLop_P2(LOG_LEVEL_DEBUG, PSTR("Stop fade"));
+#ifdef USE_LIGHT_FADE_TIMER
+    LightFadeTimerStop();
+#endif  // USE_LIGHT_FADE_TIMER
     Light.fade_running = false;
     Light.fade_start = 0;
     Light.fade_duration = 0;
@@ -2148,9 +2612,12 @@ void LightApplyPower(uint8_t new_color[LST_MAX], power_t power) {
   }
 }
 
-void LightSetOutputs(const uint16_t *cur_col_10) {
+void LightSetPwm(const uint16_t *cur_col_10) {
   // now apply the actual PWM values, adjusted and remapped 10-bits range
   if (light_type < LT_PWM6) {   // only for direct PWM lights, not for Tuya, Armtronix...
+#ifdef ESP8266
+    analogWritePhaseShift(Settings.flag4.pwm_phase_shift);  // SetOption95 - Follow changes, no-op when unchanged
+#endif  // ESP8266
     for (uint32_t i = 0; i < (Light.subtype - Light.pwm_offset); i++) {
       if (PinUsed(GPIO_PWM1, i)) {
         //AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_APPLICATION "Cur_Col%d 10 bits %d"), i, cur_col_10[i]);
@@ -2162,6 +2629,10 @@ void LightSetOutputs(const uint16_t *cur_col_10) {
       }
     }
   }
+}
+
+void LightSetOutputs(const uint16_t *cur_col_10) {
+  LightSetPwm(cur_col_10);
 
 //  char msg[24];
 //  AddLog_P2(LOG_LEVEL_DEBUG, PSTR("LGT: Channels %s"), ToHex_P((const unsigned char *)cur_col_10, 10, msg, sizeof(msg)));
@@ -2896,6 +3367,20 @@ void CmndFade(void)
   ResponseCmndStateText(Settings.light_fade);
 }
 
+void CmndFadeCurve(void)
+{
+  // FadeCurve     - Show current fade curve
+  // FadeCurve 0   - Default, time scaled by the fade gamma curve
+  // FadeCurve 1   - Linear
+  // FadeCurve 2   - Ease in
+  // FadeCurve 3   - Ease out
+  // FadeCurve 4   - Ease in and out
+  if ((XdrvMailbox.payload >= 0) && (XdrvMailbox.payload < LFC_MAX)) {
+    Settings.light_fade_curve = XdrvMailbox.payload;
+  }
+  ResponseCmndNumber(Settings.light_fade_curve);
+}
+
 void CmndSpeed(void)
 {
   // Speed 1  - Fast
@@ -3016,7 +3501,7 @@ void CmndUndocA(void)
   scolor[6] = '\0';  // RGB only
   Response_P(PSTR("%s,%d,%d,%d,%d,%d"), scolor, Settings.light_fade, Settings.light_correction, Settings.light_scheme, Settings.light_speed, Settings.light_width);
   MqttPublishPrefixTopic_P(STAT, XdrvMailbox.topic);
-  mqtt_data[0] = '\0';
+  ResponseClear();
 }
 
 /*********************************************************************************************\
@@ -3036,6 +3521,8 @@ bool Xdrv04(uint8_t function)
         result = XlgtCall(FUNC_SERIAL);
         break;
       case FUNC_LOOP:
+        XlgtCall(FUNC_LOOP);
+        LightTransactionLoop();
         if (Light.fade_running) {
           if (LightApplyFade()) {
             LightSetOutputs(Light.fade_cur_10);
@@ -3043,7 +3530,9 @@ bool Xdrv04(uint8_t function)
         }
         break;
       case FUNC_EVERY_50_MSECOND:
-        LightAnimate();
+        if (!Light.transaction) {   // Collected changes are applied by LightTransactionLoop
+          LightAnimate();
+        }
         break;
 #ifdef USE_DEVICE_GROUPS
       case FUNC_DEVICE_GROUP_ITEM:
@@ -3061,6 +3550,8 @@ bool Xdrv04(uint8_t function)
         break;
       case FUNC_PRE_INIT:
         LightInit();
+        XdrvSubscribe(FUNC_LOOP);
+        XdrvSubscribe(FUNC_EVERY_50_MSECOND);
         break;
     }
   }
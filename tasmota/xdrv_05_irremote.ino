@@ -188,7 +188,7 @@ uint32_t IrRemoteCmndIrSendJson(void)
     return IE_INVALID_JSON;
   }
 
-  StaticJsonBuffer<140> jsonBuf;
+  JsonTempBuffer<140> jsonBuf;
   JsonObject &root = jsonBuf.parseObject(dataBufUc);
   if (!root.success()) {
     return IE_INVALID_JSON;
@@ -290,6 +290,7 @@ bool Xdrv05(uint8_t function)
           IrReceiveInit();
         }
 #endif  // USE_IR_RECEIVE
+        XdrvSubscribe(FUNC_EVERY_50_MSECOND);
         break;
       case FUNC_EVERY_50_MSECOND:
 #ifdef USE_IR_RECEIVE
@@ -30,6 +30,10 @@
 #include <IRutils.h>
 #include <IRac.h>
 
+#ifndef ESP32
+#undef USE_IR_RECEIVE_TASK           // FreeRTOS task on the other core is ESP32 only
+#endif
+
 enum IrErrors { IE_RESPONSE_PROVIDED, IE_NO_ERROR, IE_INVALID_RAWDATA, IE_INVALID_JSON, IE_SYNTAX_IRSEND, IE_SYNTAX_IRHVAC,
                 IE_UNSUPPORTED_HVAC, IE_UNSUPPORTED_PROTOCOL };
 
@@ -39,6 +43,12 @@ const char kIrRemoteCommands[] PROGMEM = "|"
 void (* const IrRemoteCommand[])(void) PROGMEM = {
   &CmndIrHvac, &CmndIrSend };
 
+const char kIrReceiveCommands[] PROGMEM = "|"
+  D_CMND_IRPROTOCOLS ; // No prefix
+
+void (* const IrReceiveCommand[])(void) PROGMEM = {
+  &CmndIrProtocols };
+
 /*********************************************************************************************\
  * IR Send
 \*********************************************************************************************/
@@ -93,6 +103,68 @@ const uint8_t IR__FULL_RCV_TIMEOUT = 50;
 IRrecv *irrecv = nullptr;
 
 unsigned long ir_lasttime = 0;
+uint32_t ir_filter[kLastDecodeType / 32 + 1];  // Protocols tried by decode() with ir_filtered
+bool ir_filtered = false;
+
+#ifdef USE_IR_RECEIVE_TASK
+/*********************************************************************************************\
+ * Received IR is decoded on a task on the other core and passed to the loop through a queue
+\*********************************************************************************************/
+
+const uint8_t IR_TASK_QUEUE_SIZE = 4;
+
+struct IR_RECEIVED {
+  decode_results results;              // rawbuf points to raw or is nullptr
+  stdAc::state_t ac_state;
+  bool has_ac;
+  uint16_t raw[];
+};
+
+struct {
+  TaskHandle_t task = nullptr;
+  QueueHandle_t queue = nullptr;
+} IrTask;
+
+void IrReceiveTask(void *arg)
+{
+  decode_results results;
+
+  while (true) {
+    if (irrecv->decode(&results)) {    // With save buffer the receiver is rearmed at once
+      uint32_t raw_size = (Settings.flag3.receive_raw) ? results.rawlen * sizeof(uint16_t) : 0;  // SetOption58 - Add IR Raw data to JSON message
+      IR_RECEIVED *received = (IR_RECEIVED*)malloc(sizeof(IR_RECEIVED) + raw_size);
+      if (received) {
+        received->results = results;
+        received->results.rawbuf = nullptr;
+        if (raw_size) {
+          for (uint32_t i = 0; i < results.rawlen; i++) {
+            received->raw[i] = results.rawbuf[i];
+          }
+          received->results.rawbuf = received->raw;
+        }
+        received->has_ac = IRAcUtils::decodeToState(&received->results, &received->ac_state, nullptr);
+        if (pdTRUE != xQueueSend(IrTask.queue, &received, 0)) {
+          free(received);              // Loop busy, drop
+        }
+      }
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+bool IrReceiveTaskInit(void)
+{
+  IrTask.queue = xQueueCreate(IR_TASK_QUEUE_SIZE, sizeof(IR_RECEIVED*));
+  if (!IrTask.queue) { return false; }
+  // Loop runs on one core, decode on the other
+  if (pdPASS != xTaskCreatePinnedToCore(IrReceiveTask, "ir", 6144, nullptr, 1, &IrTask.task, !xPortGetCoreID())) {
+    vQueueDelete(IrTask.queue);
+    IrTask.queue = nullptr;
+    return false;
+  }
+  return true;
+}
+#endif  // USE_IR_RECEIVE_TASK
 
 void IrReceiveUpdateThreshold(void)
 {
@@ -105,13 +177,21 @@ void IrReceiveUpdateThreshold(void)
 void IrReceiveInit(void)
 {
   // an IR led is at GPIO_IRRECV
+#ifdef USE_IR_RECEIVE_TASK
+  // Save buffer lets the receiver capture the next message while the task decodes
+  irrecv = new IRrecv(Pin(GPIO_IRRECV), IR_FULL_BUFFER_SIZE, IR__FULL_RCV_TIMEOUT, true);
+#else
   irrecv = new IRrecv(Pin(GPIO_IRRECV), IR_FULL_BUFFER_SIZE, IR__FULL_RCV_TIMEOUT, IR_FULL_RCV_SAVE_BUFFER);
+#endif  // USE_IR_RECEIVE_TASK
   irrecv->setUnknownThreshold(Settings.param[P_IR_UNKNOW_THRESHOLD]);
   irrecv->enableIRIn();                  // Start the receiver
+#ifdef USE_IR_RECEIVE_TASK
+  IrReceiveTaskInit();
+#endif  // USE_IR_RECEIVE_TASK
 }
 
 String sendACJsonState(const stdAc::state_t &state) {
-  DynamicJsonBuffer jsonBuffer;
+  JsonParseBuffer jsonBuffer;
   JsonObject& json = jsonBuffer.createObject();
   json[D_JSON_IRHVAC_VENDOR] = typeToString(state.protocol);
   json[D_JSON_IRHVAC_MODEL] = state.model;
@@ -146,7 +226,7 @@ String sendACJsonState(const stdAc::state_t &state) {
   return payload;
 }
 
-String sendIRJsonState(const struct decode_results &results) {
+String sendIRJsonState(const struct decode_results &results, const stdAc::state_t *ac_state) {
   String json("{");
   json += "\"" D_JSON_IR_PROTOCOL "\":\"";
   json += typeToString(results.decode_type);
@@ -188,59 +268,130 @@ String sendIRJsonState(const struct decode_results &results) {
   json += ",\"" D_JSON_IR_REPEAT "\":";
   json += results.repeat;
 
-  stdAc::state_t ac_result;
-  if (IRAcUtils::decodeToState(&results, &ac_result, nullptr)) {
+  if (ac_state) {
     // we have a decoded state
     json += ",\"" D_CMND_IRHVAC "\":";
-    json += sendACJsonState(ac_result);
+    json += sendACJsonState(*ac_state);
   }
 
   return json;
 }
 
-void IrReceiveCheck(void)
+bool IrReceiveAccept(void)
 {
-  decode_results results;
+  uint32_t now = millis();
 
-  if (irrecv->decode(&results)) {
-    uint32_t now = millis();
-
-//    if ((now - ir_lasttime > IR_TIME_AVOID_DUPLICATE) && (UNKNOWN != results.decode_type) && (results.bits > 0)) {
-    if (!irsend_active && (now - ir_lasttime > IR_TIME_AVOID_DUPLICATE)) {
-      ir_lasttime = now;
-      Response_P(PSTR("{\"" D_JSON_IRRECEIVED "\":%s"), sendIRJsonState(results).c_str());
-
-      if (Settings.flag3.receive_raw) {  // SetOption58 - Add IR Raw data to JSON message
-        ResponseAppend_P(PSTR(",\"" D_JSON_IR_RAWDATA "\":["));
-        uint16_t i;
-        for (i = 1; i < results.rawlen; i++) {
-          if (i > 1) { ResponseAppend_P(PSTR(",")); }
-          uint32_t usecs;
-          for (usecs = results.rawbuf[i] * kRawTick; usecs > UINT16_MAX; usecs -= UINT16_MAX) {
-            ResponseAppend_P(PSTR("%d,0,"), UINT16_MAX);
-          }
-          ResponseAppend_P(PSTR("%d"), usecs);
-          if (strlen(mqtt_data) > sizeof(mqtt_data) - 40) { break; }  // Quit if char string becomes too long
-        }
-        uint16_t extended_length = results.rawlen - 1;
-        for (uint32_t j = 0; j < results.rawlen - 1; j++) {
-          uint32_t usecs = results.rawbuf[j] * kRawTick;
-          // Add two extra entries for multiple larger than UINT16_MAX it is.
-          extended_length += (usecs / (UINT16_MAX + 1)) * 2;
-        }
-        ResponseAppend_P(PSTR("],\"" D_JSON_IR_RAWDATA "Info\":[%d,%d,%d]"), extended_length, i -1, results.overflow);
+//  if ((now - ir_lasttime > IR_TIME_AVOID_DUPLICATE) && (UNKNOWN != results.decode_type) && (results.bits > 0)) {
+  if (!irsend_active && (now - ir_lasttime > IR_TIME_AVOID_DUPLICATE)) {
+    ir_lasttime = now;
+    return true;
+  }
+  return false;
+}
+
+void IrReceivePublish(const struct decode_results &results, const stdAc::state_t *ac_state)
+{
+  Response_P(PSTR("{\"" D_JSON_IRRECEIVED "\":%s"), sendIRJsonState(results, ac_state).c_str());
+
+  if (Settings.flag3.receive_raw && results.rawbuf) {  // SetOption58 - Add IR Raw data to JSON message
+    ResponseAppend_P(PSTR(",\"" D_JSON_IR_RAWDATA "\":["));
+    uint16_t i;
+    for (i = 1; i < results.rawlen; i++) {
+      if (i > 1) { ResponseAppend_P(PSTR(",")); }
+      uint32_t usecs;
+      for (usecs = results.rawbuf[i] * kRawTick; usecs > UINT16_MAX; usecs -= UINT16_MAX) {
+        ResponseAppend_P(PSTR("%d,0,"), UINT16_MAX);
       }
+      ResponseAppend_P(PSTR("%d"), usecs);
+      if (strlen(mqtt_data) > sizeof(mqtt_data) - 40) { break; }  // Quit if char string becomes too long
+    }
+    uint16_t extended_length = results.rawlen - 1;
+    for (uint32_t j = 0; j < results.rawlen - 1; j++) {
+      uint32_t usecs = results.rawbuf[j] * kRawTick;
+      // Add two extra entries for multiple larger than UINT16_MAX it is.
+      extended_length += (usecs / (UINT16_MAX + 1)) * 2;
+    }
+    ResponseAppend_P(PSTR("],\"" D_JSON_IR_RAWDATA "Info\":[%d,%d,%d]"), extended_length, i -1, results.overflow);
+  }
 
-      ResponseJsonEndEnd();
-      MqttPublishPrefixTopic_P(RESULT_OR_TELE, PSTR(D_JSON_IRRECEIVED));
+  ResponseJsonEndEnd();
+  MqttPublishPrefixTopic_P(RESULT_OR_TELE, PSTR(D_JSON_IRRECEIVED));
+
+  XdrvRulesProcess();
+}
 
-      XdrvRulesProcess();
+void IrReceiveCheck(void)
+{
+#ifdef USE_IR_RECEIVE_TASK
+  if (IrTask.queue) {
+    IR_RECEIVED *received;
+    while (pdTRUE == xQueueReceive(IrTask.queue, &received, 0)) {
+      if (IrReceiveAccept()) {
+        IrReceivePublish(received->results, (received->has_ac) ? &received->ac_state : nullptr);
+      }
+      free(received);
+    }
+    return;
+  }
+#endif  // USE_IR_RECEIVE_TASK
+
+  decode_results results;
+
+  if (irrecv->decode(&results)) {
+    if (IrReceiveAccept()) {
+      stdAc::state_t ac_state;
+      bool has_ac = IRAcUtils::decodeToState(&results, &ac_state, nullptr);
+      IrReceivePublish(results, (has_ac) ? &ac_state : nullptr);
     }
 
     irrecv->resume();
   }
 }
 
+/*********************************************************************************************\
+ * Commands
+\*********************************************************************************************/
+
+void CmndIrProtocols(void)
+{
+  // IrProtocols         - Show protocols tried on receive
+  // IrProtocols 0       - Try all protocols
+  // IrProtocols NEC,LG  - Only try NEC and LG, faster than all protocols
+  if (XdrvMailbox.data_len) {
+    if (!strcmp(XdrvMailbox.data, "0")) {
+      ir_filtered = false;
+    } else {
+      uint32_t filter[ARRAY_SIZE(ir_filter)];
+      memset(filter, 0, sizeof(filter));
+      char *p;
+      for (char *str = strtok_r(XdrvMailbox.data, ", ", &p); str; str = strtok_r(nullptr, ", ", &p)) {
+        decode_type_t protocol = strToDecodeType(str);
+        if (protocol <= UNUSED) {
+          Response_P(PSTR("{\"" D_CMND_IRPROTOCOLS "\":\"" D_JSON_WRONG " " D_JSON_IRHVAC_PROTOCOL " (%s)\"}"), str);
+          return;
+        }
+        filter[protocol / 32] |= 1 << (protocol % 32);
+      }
+      memcpy(ir_filter, filter, sizeof(ir_filter));
+      ir_filtered = true;
+    }
+    irrecv->setDecodeFilter((ir_filtered) ? ir_filter : nullptr);
+  }
+
+  Response_P(PSTR("{\"" D_CMND_IRPROTOCOLS "\":\""));
+  if (ir_filtered) {
+    bool first = true;
+    for (uint32_t i = UNUSED + 1; i <= kLastDecodeType; i++) {
+      if (irrecv->decodeEnabled((decode_type_t)i)) {
+        ResponseAppend_P(PSTR("%s%s"), (first) ? "" : ",", typeToString((decode_type_t)i).c_str());
+        first = false;
+      }
+    }
+  } else {
+    ResponseAppend_P(PSTR("All"));
+  }
+  ResponseAppend_P(PSTR("\"}"));
+}
 
 /*********************************************************************************************\
  * IR Heating, Ventilation and Air Conditioning
@@ -285,7 +436,7 @@ uint32_t IrRemoteCmndIrHvacJson(void)
   RemoveSpace(dataBufUc);
   if (strlen(dataBufUc) < 8) { return IE_INVALID_JSON; }
 
-  DynamicJsonBuffer jsonBuf;
+  JsonParseBuffer jsonBuf;
   JsonObject &json = jsonBuf.parseObject(dataBufUc);
   if (!json.success()) { return IE_INVALID_JSON; }
 
@@ -398,7 +549,7 @@ uint32_t IrRemoteCmndIrSendJson(void)
   RemoveSpace(dataBufUc);
   if (strlen(dataBufUc) < 8) { return IE_INVALID_JSON; }
 
-  DynamicJsonBuffer jsonBuf;
+  JsonParseBuffer jsonBuf;
   JsonObject &json = jsonBuf.parseObject(dataBufUc);
   if (!json.success()) { return IE_INVALID_JSON; }
 
@@ -644,6 +795,7 @@ bool Xdrv05(uint8_t function)
         if (PinUsed(GPIO_IRRECV)) {
           IrReceiveInit();
         }
+        XdrvSubscribe(FUNC_EVERY_50_MSECOND);
         break;
       case FUNC_EVERY_50_MSECOND:
         if (PinUsed(GPIO_IRRECV)) {
@@ -655,6 +807,9 @@ bool Xdrv05(uint8_t function)
         if (PinUsed(GPIO_IRSEND)) {
           result = DecodeCommand(kIrRemoteCommands, IrRemoteCommand);
         }
+        if (!result && PinUsed(GPIO_IRRECV)) {
+          result = DecodeCommand(kIrReceiveCommands, IrReceiveCommand);
+        }
         break;
     }
   }
@@ -217,6 +217,27 @@ void DomoticzMqttSubscribe(void)
 }
 */
 
+uint32_t DomoticzScanIdx(const char *data)
+{
+  // Extract the idx from {"Battery" : 255, "RSSI" : 12, "dtype" : "Light/Switch", "id" : "00014051", "idx" : 12, ...}
+  const char *value = strstr_P(data, PSTR("\"idx\""));
+  if (!value) { return 0; }
+  value += 5;
+  while ((' ' == *value) || (':' == *value) || ('"' == *value)) { value++; }
+  return strtoul(value, nullptr, 10);
+}
+
+bool DomoticzRelayIdx(uint32_t idx)
+{
+  // Domoticz sends the updates of all its devices to domoticz/out so only parse our own
+  if (!idx) { return false; }
+  uint32_t maxdev = (devices_present > MAX_DOMOTICZ_IDX) ? MAX_DOMOTICZ_IDX : devices_present;
+  for (uint32_t i = 0; i < maxdev; i++) {
+    if (idx == Settings.domoticz_relay_idx[i]) { return true; }
+  }
+  return false;
+}
+
 bool DomoticzMqttData(void)
 {
   domoticz_update_flag = true;
@@ -229,7 +250,10 @@ bool DomoticzMqttData(void)
   if (XdrvMailbox.data_len < 20) {
     return true;  // No valid data
   }
-  StaticJsonBuffer<400> jsonBuf;
+  if (!DomoticzRelayIdx(DomoticzScanIdx(XdrvMailbox.data))) {
+    return true;  // Not one of our devices
+  }
+  JsonTempBuffer<400> jsonBuf;
   JsonObject& domoticz = jsonBuf.parseObject(XdrvMailbox.data);
   if (!domoticz.success()) {
     return true;  // To much or invalid data
@@ -418,6 +442,7 @@ void DomoticzSensor(uint8_t idx, char *data)
     }
     MqttPublish(domoticz_in_topic);
     memcpy(mqtt_data, dmess, sizeof(dmess));
+    ResponseSetLength(strlen(mqtt_data));
   }
 }
 
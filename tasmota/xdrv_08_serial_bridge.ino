@@ -20,17 +20,34 @@
 #ifdef USE_SERIAL_BRIDGE
 /*********************************************************************************************\
  * Serial Bridge using Software Serial library (TasmotaSerial)
+ *
+ * Streaming mode enabled with SSerialStream <mS> forwards received bytes unchanged as binary
+ * payload to tele/<topic>/SSERIALDATA in chunks ended by a gap of <mS> between bytes or a full
+ * buffer of SERIAL_BRIDGE_STREAM_SIZE bytes. Payloads published to cmnd/<topic>/SSerialData are
+ * written to the serial port straight from the MQTT client buffer. For gaps shorter than the
+ * loop period use Sleep 0.
+ *
+ * SSerialStream     - Show streaming state and counters
+ * SSerialStream 0   - Stop streaming and return to SSerialReceived messages
+ * SSerialStream 10  - Stream chunks framed by a 10 mS inter-byte gap (1 to 255)
 \*********************************************************************************************/
 
 #define XDRV_08                    8
 
 const uint8_t SERIAL_BRIDGE_BUFFER_SIZE = 130;
 
+#ifndef SERIAL_BRIDGE_STREAM_SIZE
+#define SERIAL_BRIDGE_STREAM_SIZE  512      // Max number of bytes per streamed chunk
+#endif
+#ifndef SERIAL_BRIDGE_RX_SIZE
+#define SERIAL_BRIDGE_RX_SIZE      256      // Receive buffer size allowing high baud rates between loops
+#endif
+
 const char kSerialBridgeCommands[] PROGMEM = "|"  // No prefix
-  D_CMND_SSERIALSEND "|" D_CMND_SBAUDRATE;
+  D_CMND_SSERIALSEND "|" D_CMND_SBAUDRATE "|" D_CMND_SSERIALSTREAM;
 
 void (* const SerialBridgeCommand[])(void) PROGMEM = {
-  &CmndSSerialSend, &CmndSBaudrate };
+  &CmndSSerialSend, &CmndSBaudrate, &CmndSSerialStream };
 
 #include <TasmotaSerial.h>
 
@@ -42,6 +59,55 @@ int serial_bridge_in_byte_counter = 0;
 bool serial_bridge_active = true;
 bool serial_bridge_raw = false;
 
+struct {
+  uint8_t *buffer = nullptr;                // Streamed chunk
+  uint32_t chunks = 0;
+  uint32_t bytes = 0;
+  uint32_t drops = 0;                       // Chunks not published
+  uint32_t received = 0;                    // Bytes written from MQTT
+  uint16_t count = 0;
+} SerialBridgeStream;
+
+void SerialBridgeStreamWrite(void)
+{
+  MqttStreamWrite((const char*)SerialBridgeStream.buffer, SerialBridgeStream.count);
+}
+
+void SerialBridgeStreamInput(void)
+{
+  if (!SerialBridgeStream.buffer) {
+    SerialBridgeStream.buffer = (uint8_t*)malloc(SERIAL_BRIDGE_STREAM_SIZE);
+    if (!SerialBridgeStream.buffer) { return; }
+  }
+  if (SerialBridgeSerial->available() && (SerialBridgeStream.count < SERIAL_BRIDGE_STREAM_SIZE)) {
+    SerialBridgeStream.count += SerialBridgeSerial->read(SerialBridgeStream.buffer + SerialBridgeStream.count,
+                                                         SERIAL_BRIDGE_STREAM_SIZE - SerialBridgeStream.count);
+    serial_bridge_polling_window = millis();
+  }
+  if (SerialBridgeStream.count &&
+      ((SerialBridgeStream.count >= SERIAL_BRIDGE_STREAM_SIZE) ||
+       (millis() - serial_bridge_polling_window >= Settings.sbr_stream_timeout))) {
+    if (MqttPublishPrefixTopicBinary_P(TELE, PSTR(D_JSON_SSERIALDATA), SerialBridgeStream.count, SerialBridgeStreamWrite)) {
+      SerialBridgeStream.chunks++;
+      SerialBridgeStream.bytes += SerialBridgeStream.count;
+    } else {
+      SerialBridgeStream.drops++;
+    }
+    SerialBridgeStream.count = 0;
+  }
+}
+
+bool SerialBridgeStreamData(const char *topic, const uint8_t *data, uint32_t data_len)
+{
+  if (!serial_bridge_active || !SerialBridgeSerial || !Settings.sbr_stream_timeout) { return false; }
+  char stopic[TOPSZ];
+  GetTopic_P(stopic, CMND, mqtt_topic, PSTR(D_JSON_SSERIALDATA));
+  if (strcasecmp(topic, stopic)) { return false; }
+  SerialBridgeSerial->write(data, data_len);
+  SerialBridgeStream.received += data_len;
+  return true;
+}
+
 void SerialBridgeInput(void)
 {
   while (SerialBridgeSerial->available()) {
@@ -105,7 +171,7 @@ void SerialBridgeInit(void)
 {
   serial_bridge_active = false;
   if (PinUsed(GPIO_SBR_RX) && PinUsed(GPIO_SBR_TX)) {
-    SerialBridgeSerial = new TasmotaSerial(Pin(GPIO_SBR_RX), Pin(GPIO_SBR_TX));
+    SerialBridgeSerial = new TasmotaSerial(Pin(GPIO_SBR_RX), Pin(GPIO_SBR_TX), 0, 0, SERIAL_BRIDGE_RX_SIZE);
     if (SerialBridgeSerial->begin(Settings.sbaudrate * 300)) {  // Baud rate is stored div 300 so it fits into 16 bits
       if (SerialBridgeSerial->hardwareSerial()) {
         ClaimSerial();
@@ -169,6 +235,18 @@ void CmndSBaudrate(void)
   ResponseCmndNumber(Settings.sbaudrate * 300);
 }
 
+void CmndSSerialStream(void)
+{
+  if ((XdrvMailbox.payload >= 0) && (XdrvMailbox.payload <= 255)) {
+    Settings.sbr_stream_timeout = XdrvMailbox.payload;
+    SerialBridgeStream.count = 0;
+    serial_bridge_in_byte_counter = 0;
+  }
+  Response_P(PSTR("{\"" D_CMND_SSERIALSTREAM "\":{\"Timeout\":%d,\"Chunks\":%u,\"Bytes\":%u,\"Dropped\":%u,\"Received\":%u,\"Overflow\":%u}}"),
+    Settings.sbr_stream_timeout, SerialBridgeStream.chunks, SerialBridgeStream.bytes, SerialBridgeStream.drops,
+    SerialBridgeStream.received, SerialBridgeSerial->getOverflowCount());
+}
+
 /*********************************************************************************************\
  * Interface
 \*********************************************************************************************/
@@ -180,10 +258,17 @@ bool Xdrv08(uint8_t function)
   if (serial_bridge_active) {
     switch (function) {
       case FUNC_LOOP:
-        if (SerialBridgeSerial) { SerialBridgeInput(); }
+        if (SerialBridgeSerial) {
+          if (Settings.sbr_stream_timeout) {
+            SerialBridgeStreamInput();
+          } else {
+            SerialBridgeInput();
+          }
+        }
         break;
       case FUNC_PRE_INIT:
         SerialBridgeInit();
+        XdrvSubscribe(FUNC_LOOP);
         break;
       case FUNC_COMMAND:
         result = DecodeCommand(kSerialBridgeCommands, SerialBridgeCommand);
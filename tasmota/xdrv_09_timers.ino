@@ -55,6 +55,19 @@ void (* const TimerCommand[])(void) PROGMEM = {
 uint16_t timer_last_minute = 60;
 int8_t timer_window[MAX_TIMERS] = { 0 };
 
+struct TIMER_FIRE {
+  uint16_t time;                            // Minute of the day
+  uint8_t index;
+};
+
+struct {
+  TIMER_FIRE heap[MAX_TIMERS];              // Timers still to fire today, earliest first
+  int16_t last_time = -1;                   // Last checked minute of the day
+  uint16_t day = 0;                         // Day of the year the heap is built for
+  uint8_t count = 0;
+  bool dirty = true;                        // Rebuild on next check
+} TimerIndex;
+
 #ifdef USE_SUNRISE
 /*********************************************************************************************\
  * Sunrise and sunset (+13k code)
@@ -116,7 +129,7 @@ float TimeFormula(float *DK, uint32_t Tdays) {
   return dRA;
 }
 
-void DuskTillDawn(uint8_t *hour_up,uint8_t *minute_up, uint8_t *hour_down, uint8_t *minute_down)
+void DuskTillDawnCalc(uint8_t *hour_up,uint8_t *minute_up, uint8_t *hour_down, uint8_t *minute_down)
 {
   const uint32_t JD2000 = 2451545;
   uint32_t JD = JulianDate(RtcTime);
@@ -163,6 +176,35 @@ void DuskTillDawn(uint8_t *hour_up,uint8_t *minute_up, uint8_t *hour_down, uint8
   *minute_down = UntergangMinuten;
 }
 
+struct {
+  int32_t latitude;
+  int32_t longitude;
+  int32_t timezone;
+  uint16_t day;
+  uint8_t hour[2];
+  uint8_t minute[2];
+  bool valid = false;
+} TimerSun;
+
+void DuskTillDawn(uint8_t *hour_up,uint8_t *minute_up, uint8_t *hour_down, uint8_t *minute_down)
+{
+  // Sun times only change with the day, the location or the timezone
+  if (!TimerSun.valid || (TimerSun.day != RtcTime.day_of_year) || (TimerSun.timezone != Rtc.time_timezone) ||
+      (TimerSun.latitude != Settings.latitude) || (TimerSun.longitude != Settings.longitude)) {
+    DuskTillDawnCalc(&TimerSun.hour[0], &TimerSun.minute[0], &TimerSun.hour[1], &TimerSun.minute[1]);
+    TimerSun.latitude = Settings.latitude;
+    TimerSun.longitude = Settings.longitude;
+    TimerSun.timezone = Rtc.time_timezone;
+    TimerSun.day = RtcTime.day_of_year;
+    TimerSun.valid = true;
+    TimerIndex.dirty = true;                // Solar timers move
+  }
+  *hour_up = TimerSun.hour[0];
+  *minute_up = TimerSun.minute[0];
+  *hour_down = TimerSun.hour[1];
+  *minute_down = TimerSun.minute[1];
+}
+
 void ApplyTimerOffsets(Timer *duskdawn)
 {
   uint8_t hour[2];
@@ -240,6 +282,77 @@ void TimerSetRandomWindows(void)
   for (uint32_t i = 0; i < MAX_TIMERS; i++) { TimerSetRandomWindow(i); }
 }
 
+/*********************************************************************************************\
+ * Timer index
+ *
+ * Armed timers due today are kept in a min-heap on their execution minute. The heap is built
+ * once a day and after a timer change, a sunrise or sunset change or the clock going back so
+ * the minute check only looks at the first entry.
+\*********************************************************************************************/
+
+void TimerIndexInvalidate(void)
+{
+  TimerIndex.dirty = true;
+}
+
+void TimerIndexPush(uint32_t time, uint32_t index)
+{
+  uint32_t pos = TimerIndex.count++;
+  while (pos) {
+    uint32_t parent = (pos -1) / 2;
+    if (TimerIndex.heap[parent].time <= time) { break; }
+    TimerIndex.heap[pos] = TimerIndex.heap[parent];
+    pos = parent;
+  }
+  TimerIndex.heap[pos].time = time;
+  TimerIndex.heap[pos].index = index;
+}
+
+void TimerIndexPop(void)
+{
+  TIMER_FIRE last = TimerIndex.heap[--TimerIndex.count];
+  uint32_t pos = 0;
+  while (true) {
+    uint32_t child = pos * 2 +1;
+    if (child >= TimerIndex.count) { break; }
+    if ((child +1 < TimerIndex.count) && (TimerIndex.heap[child +1].time < TimerIndex.heap[child].time)) { child++; }
+    if (last.time <= TimerIndex.heap[child].time) { break; }
+    TimerIndex.heap[pos] = TimerIndex.heap[child];
+    pos = child;
+  }
+  TimerIndex.heap[pos] = last;
+}
+
+void TimerIndexBuild(int32_t time, uint8_t days)
+{
+  TimerIndex.count = 0;
+  for (uint32_t i = 0; i < MAX_TIMERS; i++) {
+//    if (Settings.timer[i].device >= devices_present) Settings.timer[i].data = 0;  // Reset timer due to change in devices present
+    Timer xtimer = Settings.timer[i];
+    if (!xtimer.arm) { continue; }
+#ifdef USE_SUNRISE
+    if ((1 == xtimer.mode) || (2 == xtimer.mode)) {        // Sunrise or Sunset
+      ApplyTimerOffsets(&xtimer);
+    }
+#endif
+    if (!(xtimer.days & days)) { continue; }
+    int32_t set_time = xtimer.time + timer_window[i];      // Add random time offset
+    if (set_time < 0) {
+      set_time = abs(timer_window[i]);                     // After midnight and within negative window so stay today but allow positive randomness;
+    }
+    if (set_time > 1439) {
+      set_time = xtimer.time - abs(timer_window[i]);       // Before midnight and within positive window so stay today but allow negative randomness;
+    }
+    if (set_time > 1439) { set_time = 1439; }              // Stay today
+
+    DEBUG_DRIVER_LOG(PSTR("TIM: Timer %d, Time %d, Window %d, SetTime %d"), i +1, xtimer.time, timer_window[i], set_time);
+
+    if (set_time >= time) { TimerIndexPush(set_time, i); }
+  }
+  TimerIndex.day = RtcTime.day_of_year;
+  TimerIndex.dirty = false;
+}
+
 void TimerEverySecond(void)
 {
   if (RtcTime.valid) {
@@ -250,39 +363,25 @@ void TimerEverySecond(void)
       int32_t time = (RtcTime.hour *60) + RtcTime.minute;
       uint8_t days = 1 << (RtcTime.day_of_week -1);
 
-      for (uint32_t i = 0; i < MAX_TIMERS; i++) {
-//        if (Settings.timer[i].device >= devices_present) Settings.timer[i].data = 0;  // Reset timer due to change in devices present
-        Timer xtimer = Settings.timer[i];
-#ifdef USE_SUNRISE
-        if ((1 == xtimer.mode) || (2 == xtimer.mode)) {      // Sunrise or Sunset
-          ApplyTimerOffsets(&xtimer);
-        }
-#endif
-        if (xtimer.arm) {
-          int32_t set_time = xtimer.time + timer_window[i];  // Add random time offset
-          if (set_time < 0) {
-            set_time = abs(timer_window[i]);                 // After midnight and within negative window so stay today but allow positive randomness;
-          }
-          if (set_time > 1439) {
-            set_time = xtimer.time - abs(timer_window[i]);   // Before midnight and within positive window so stay today but allow negative randomness;
-          }
-          if (set_time > 1439) { set_time = 1439; }          // Stay today
-
-          DEBUG_DRIVER_LOG(PSTR("TIM: Timer %d, Time %d, Window %d, SetTime %d"), i +1, xtimer.time, timer_window[i], set_time);
+      if (TimerIndex.dirty || (TimerIndex.day != RtcTime.day_of_year) || (time < TimerIndex.last_time)) {
+        TimerIndexBuild(time, days);
+      }
+      TimerIndex.last_time = time;
 
-          if (time == set_time) {
-            if (xtimer.days & days) {
-              Settings.timer[i].arm = xtimer.repeat;
+      while (TimerIndex.count && (TimerIndex.heap[0].time <= time)) {
+        uint32_t i = TimerIndex.heap[0].index;
+        bool due = (TimerIndex.heap[0].time == time);      // Otherwise skipped by the clock going ahead
+        TimerIndexPop();
+        if (!due) { continue; }
+        Timer xtimer = Settings.timer[i];
+        Settings.timer[i].arm = xtimer.repeat;
 #if defined(USE_RULES) || defined(USE_SCRIPT)
-              if (POWER_BLINK == xtimer.power) {             // Blink becomes Rule disregarding device and allowing use of Backlog commands
-                Response_P(PSTR("{\"Clock\":{\"Timer\":%d}}"), i +1);
-                XdrvRulesProcess();
-              } else
+        if (POWER_BLINK == xtimer.power) {                 // Blink becomes Rule disregarding device and allowing use of Backlog commands
+          Response_P(PSTR("{\"Clock\":{\"Timer\":%d}}"), i +1);
+          XdrvRulesProcess();
+        } else
 #endif  // USE_RULES
-                if (devices_present) { ExecuteCommandPower(xtimer.device +1, xtimer.power, SRC_TIMER); }
-            }
-          }
-        }
+          if (devices_present) { ExecuteCommandPower(xtimer.device +1, xtimer.power, SRC_TIMER); }
       }
     }
   }
@@ -343,7 +442,7 @@ void CmndTimer(void)
 #endif
           char dataBufUc[XdrvMailbox.data_len + 1];
           UpperCase(dataBufUc, XdrvMailbox.data);
-          StaticJsonBuffer<256> jsonBuffer;
+          JsonTempBuffer<256> jsonBuffer;
           JsonObject& root = jsonBuffer.parseObject(dataBufUc);
           if (!root.success()) {
             Response_P(PSTR("{\"" D_CMND_TIMER "%d\":\"" D_JSON_INVALID_JSON "\"}"), index); // JSON decode failed
@@ -428,6 +527,7 @@ void CmndTimer(void)
       }
     }
     if (!error) {
+      if (XdrvMailbox.data_len) { TimerIndexInvalidate(); }
       Response_P(PSTR("{"));
       PrepShowTimer(index);
       ResponseJsonEnd();
@@ -465,7 +565,7 @@ void CmndTimers(void)
       jsflg = 0;
     }
   }
-  mqtt_data[0] = '\0';
+  ResponseClear();
 }
 
 #ifdef USE_SUNRISE
@@ -473,6 +573,7 @@ void CmndLongitude(void)
 {
   if (XdrvMailbox.data_len) {
     Settings.longitude = (int)(CharToFloat(XdrvMailbox.data) *1000000);
+    TimerIndexInvalidate();
   }
   ResponseCmndFloat((float)(Settings.longitude) /1000000, 6);
 }
@@ -481,6 +582,7 @@ void CmndLatitude(void)
 {
   if (XdrvMailbox.data_len) {
     Settings.latitude = (int)(CharToFloat(XdrvMailbox.data) *1000000);
+    TimerIndexInvalidate();
   }
   ResponseCmndFloat((float)(Settings.latitude) /1000000, 6);
 }
@@ -731,6 +833,7 @@ void TimerSaveSettings(void)
     }
     snprintf_P(message, sizeof(message), PSTR("%s,0x%08X"), message, Settings.timer[i].data);
   }
+  TimerIndexInvalidate();
   AddLog_P(LOG_LEVEL_DEBUG, message);
 }
 #endif  // USE_TIMERS_WEB
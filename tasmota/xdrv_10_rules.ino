@@ -71,6 +71,7 @@
 
 #define D_CMND_RULE "Rule"
 #define D_CMND_RULETIMER "RuleTimer"
+#define D_CMND_RULESTATS "RuleStats"
 #define D_CMND_EVENT "Event"
 #define D_CMND_VAR "Var"
 #define D_CMND_MEM "Mem"
@@ -85,6 +86,14 @@
 
 #define D_JSON_INITIATED "Initiated"
 
+#ifndef RULES_CACHE_SIZE
+#ifdef ESP32
+#define RULES_CACHE_SIZE        8192      // Max bytes of RAM used to keep processed rule sets between events
+#else
+#define RULES_CACHE_SIZE        1536
+#endif  // ESP32
+#endif  // RULES_CACHE_SIZE
+
 #define COMPARE_OPERATOR_NONE            -1
 #define COMPARE_OPERATOR_EQUAL            0
 #define COMPARE_OPERATOR_BIGGER           1
@@ -97,6 +106,11 @@
 #define MAXIMUM_COMPARE_OPERATOR          COMPARE_OPERATOR_SMALLER_EQUAL
 const char kCompareOperators[] PROGMEM = "=\0>\0<\0|\0==!=>=<=";
 
+enum RulesSubstitutions { RULES_SUBST_VALUE, RULES_SUBST_TIME, RULES_SUBST_UTCTIME, RULES_SUBST_UPTIME, RULES_SUBST_TIMESTAMP,
+                          RULES_SUBST_TOPIC, RULES_SUBST_SUNRISE, RULES_SUBST_SUNSET,
+                          RULES_SUBST_ZBDEVICE, RULES_SUBST_ZBGROUP, RULES_SUBST_ZBCLUSTER, RULES_SUBST_ZBENDPOINT, RULES_SUBST_MAX };
+const char kRulesSubstitutions[] PROGMEM = "VALUE|TIME|UTCTIME|UPTIME|TIMESTAMP|TOPIC|SUNRISE|SUNSET|ZBDEVICE|ZBGROUP|ZBCLUSTER|ZBENDPOINT";
+
 #ifdef USE_EXPRESSION
   #include <LinkedList.h>                 // Import LinkedList library
 
@@ -130,6 +144,9 @@ const char kRulesCommands[] PROGMEM = "|"  // No prefix
 #endif
 #ifdef SUPPORT_IF_STATEMENT
   "|" D_CMND_IF
+#endif
+#ifdef USE_RULES_STATS
+  "|" D_CMND_RULESTATS
 #endif
   ;
 
@@ -141,6 +158,9 @@ void (* const RulesCommand[])(void) PROGMEM = {
 #endif
 #ifdef SUPPORT_IF_STATEMENT
   , &CmndIf
+#endif
+#ifdef USE_RULES_STATS
+  , &CmndRuleStats
 #endif
   };
 
@@ -152,13 +172,48 @@ void (* const RulesCommand[])(void) PROGMEM = {
     String Key;
   } MQTT_Subscription;
   LinkedList<MQTT_Subscription> subscriptions;
+
+  struct MQTT_TOPIC_NODE {                // Topic trie of the subscription filters
+    const char *level;                    // Topic level, + or #
+    int16_t child;                        // First child node or -1
+    int16_t next;                         // Next sibling node or -1
+    int16_t subscription;                 // First subscription with its filter ending here or -1
+  };
+
+  struct {
+    MQTT_TOPIC_NODE *node = nullptr;      // Node 0 is the root
+    int16_t *next_subscription = nullptr; // Next subscription with the same filter or -1
+    char *levels = nullptr;               // Filter levels the nodes point to
+    uint16_t nodes = 0;
+  } RulesTopics;
 #endif  // SUPPORT_MQTT_EVENT
 
+#ifdef USE_RULES_STATS
+const uint32_t RULES_STATS_SLOW = 100000;  // Log rule executions taking more microseconds
+
+struct RULE_STATS {
+  uint64_t match_time;                    // Total microseconds in RulesRuleMatch()
+  uint64_t exec_time;                     // Total microseconds executing commands including nested rules
+  uint32_t evaluations;                   // Number of RulesRuleMatch() calls
+  uint32_t matches;
+  uint32_t exec_max;                      // Maximum microseconds executing commands
+};
+#endif  // USE_RULES_STATS
+
 struct RULES {
   String event_value;
   unsigned long timer[MAX_RULE_TIMERS] = { 0 };
   uint32_t triggers[MAX_RULE_SETS] = { 0 };
   uint8_t trigger_count[MAX_RULE_SETS] = { 0 };
+  char *trigger_index[MAX_RULE_SETS] = { nullptr };  // Split rule sets as built by RulesIndexBuild()
+  uint8_t index_busy[MAX_RULE_SETS] = { 0 };         // Nesting level of rule set processing
+  uint8_t index_stale = 0;                            // Bitmask of rule sets changed while being processed
+  uint8_t index_transient = 0;                        // Bitmask of rule sets not fitting RULES_CACHE_SIZE
+  uint16_t index_size[MAX_RULE_SETS] = { 0 };
+#ifdef USE_RULES_STATS
+  RULE_STATS *stats[MAX_RULE_SETS] = { nullptr };    // Per trigger index entry
+  uint8_t stats_count[MAX_RULE_SETS] = { 0 };
+#endif  // USE_RULES_STATS
 
   long new_power = -1;
   long old_power = -1;
@@ -174,6 +229,27 @@ struct RULES {
 
 char rules_vars[MAX_RULE_VARS][33] = {{ 0 }};
 
+const uint8_t RULES_EVENT_KEYS = 64;      // Max number of keys and array values in an event
+const uint8_t RULES_EVENT_DEPTH = 10;     // Max nesting level as supported by ArduinoJson
+const uint8_t RULES_EVENT_ROOT = 0xFF;    // Parent of the keys in the root object
+const uint16_t RULES_EVENT_NONE = 0xFFFF; // No key (array value) or no value (object or array)
+const uint8_t RULES_EVENT_KEY_LITERAL = 0x01;    // Unquoted key still to be terminated
+const uint8_t RULES_EVENT_VALUE_LITERAL = 0x02;  // Unquoted value still to be terminated
+
+struct RULES_EVENT_KEY {
+  uint16_t key;                           // Offset of key in event data
+  uint16_t value;                         // Offset of scalar value in event data
+  uint8_t parent;                         // Entry of containing object or array
+  uint8_t index;                          // Array position 1.. or 0 for object keys
+  uint8_t flags;
+};
+
+struct RULES_EVENT {
+  char *data;                             // Event tokenized in place
+  uint32_t count;
+  RULES_EVENT_KEY entry[RULES_EVENT_KEYS];
+};
+
 #if (MAX_RULE_VARS>16)
 #error MAX_RULE_VARS is bigger than 16
 #endif
@@ -319,6 +395,7 @@ int32_t SetRule_compress(uint32_t idx, const char *in, size_t in_len, char *out,
 //   <0 : not enough space
 int32_t SetRule(uint32_t idx, const char *content, bool append = false) {
   if (nullptr == content) { content = ""; }   // if nullptr, use empty string
+  RulesIndexInvalidate(idx);
   size_t len_in = strlen(content);
   bool needsCompress = false;
   size_t offset = 0;
@@ -360,7 +437,7 @@ int32_t SetRule(uint32_t idx, const char *content, bool append = false) {
 #ifdef USE_RULES_COMPRESSION
     int32_t len_compressed;
     // allocate temp buffer so we don't nuke the rule if it's too big to fit
-    char *buf_out = (char*) malloc(MAX_RULE_SIZE + 8);    // take some margin
+    char *buf_out = (char*) HeapMalloc(HEAP_TAG_RULES, MAX_RULE_SIZE + 8);    // take some margin
     if (!buf_out) { return -1; }      // fail if couldn't allocate
 
     // compress
@@ -387,7 +464,7 @@ int32_t SetRule(uint32_t idx, const char *content, bool append = false) {
       // clear rule cache, so it will be reloaded from Settings
       k_rules[idx] = (const char *) nullptr;
     }
-    free(buf_out);
+    HeapFree(buf_out);
     return len_compressed;
 
 #else  // USE_RULES_COMPRESSION
@@ -397,9 +474,183 @@ int32_t SetRule(uint32_t idx, const char *content, bool append = false) {
 
 }
 
+/*******************************************************************************************/
+/*
+ * Event tokenizer
+ *
+ * The uppercased event is tokenized in place once per RulesProcessEvent() into a flat table of
+ * keys shared by all triggers instead of parsing it with ArduinoJson for every trigger. Each
+ * entry refers to its containing object or array so the lookups follow GetCaseInsensitive().
+ */
+/*******************************************************************************************/
+
+char* RulesEventSkip(char *p)
+{
+  while (isspace(*p)) { p++; }
+  return p;
+}
+
+bool RulesEventLiteral(char c)
+{
+  // Characters allowed in unquoted strings by ArduinoJson
+  return (isalnum(c) || ('_' == c) || ('+' == c) || ('-' == c) || ('.' == c));
+}
+
+char RulesEventUnescape(char c)
+{
+  switch (c) {
+    case 'b': return '\b';
+    case 'f': return '\f';
+    case 'n': return '\n';
+    case 'r': return '\r';
+    case 't': return '\t';
+  }
+  return c;                               // Includes quote, backslash and solidus
+}
+
+char* RulesEventString(char *p, char **start, bool *literal)
+{
+  // Parse quoted or unquoted string and return position after it or nullptr if invalid
+  char quote = *p;
+  if (('"' == quote) || ('\'' == quote)) {
+    char *d = ++p;
+    *start = d;
+    while (*p != quote) {
+      if (!*p) { return nullptr; }        // Unterminated string
+      char c = *p++;
+      if ('\\' == c) {
+        if (!*p) { return nullptr; }
+        c = RulesEventUnescape(*p++);
+      }
+      *d++ = c;
+    }
+    p++;                                  // Skip closing quote
+    *d = '\0';                            // Terminate in place as closing quote is passed
+    *literal = false;
+    return p;
+  }
+  *start = p;
+  while (RulesEventLiteral(*p)) { p++; }
+  if (p == *start) { return nullptr; }    // No value
+  *literal = true;                        // Terminated after tokenizing as delimiter is still needed
+  return p;
+}
+
+int32_t RulesEventAdd(struct RULES_EVENT &event, char *key, uint32_t parent, uint32_t index)
+{
+  if (event.count >= RULES_EVENT_KEYS) { return -1; }
+  RULES_EVENT_KEY &entry = event.entry[event.count];
+  entry.key = (key) ? key - event.data : RULES_EVENT_NONE;
+  entry.value = RULES_EVENT_NONE;
+  entry.parent = parent;
+  entry.index = tmin(index, 255);
+  entry.flags = 0;
+  return event.count++;
+}
+
+char* RulesEventParse(struct RULES_EVENT &event, char *p, uint32_t entry, uint32_t depth)
+{
+  bool literal;
+  p = RulesEventSkip(p);
+  if (('{' == *p) || ('[' == *p)) {
+    if (depth >= RULES_EVENT_DEPTH) { return nullptr; }
+    bool object = ('{' == *p);
+    char close = (object) ? '}' : ']';
+    p = RulesEventSkip(p +1);
+    if (close == *p) { return p +1; }     // Empty object or array
+    uint32_t index = 0;
+    while (true) {
+      char *key = nullptr;
+      literal = false;
+      if (object) {
+        p = RulesEventString(p, &key, &literal);
+        if (!p) { return nullptr; }
+        p = RulesEventSkip(p);
+        if (*p != ':') { return nullptr; }
+        p++;
+      }
+      int32_t child = RulesEventAdd(event, key, entry, (object) ? 0 : ++index);
+      if (child < 0) { return nullptr; }  // Too many keys
+      if (literal) { event.entry[child].flags |= RULES_EVENT_KEY_LITERAL; }
+      p = RulesEventParse(event, p, child, depth +1);
+      if (!p) { return nullptr; }
+      p = RulesEventSkip(p);
+      if (',' == *p) {
+        p = RulesEventSkip(p +1);
+      }
+      else if (close == *p) {
+        return p +1;
+      }
+      else {
+        return nullptr;
+      }
+    }
+  }
+  if (RULES_EVENT_ROOT == entry) { return nullptr; }  // Event is no object
+  char *value;
+  p = RulesEventString(p, &value, &literal);
+  if (!p) { return nullptr; }
+  event.entry[entry].value = value - event.data;
+  if (literal) { event.entry[entry].flags |= RULES_EVENT_VALUE_LITERAL; }
+  return p;
+}
+
+bool RulesEventTokenize(struct RULES_EVENT &event, char *data)
+{
+  // data = {"INA219":{"VOLTAGE":4.494,"CURRENT":0.020,"POWER":0.089}}
+  event.data = data;
+  event.count = 0;
+  char *p = RulesEventSkip(data);
+  if (*p != '{') { return false; }
+  if (!RulesEventParse(event, p, RULES_EVENT_ROOT, 0)) { return false; }
+  for (uint32_t i = 0; i < event.count; i++) {
+    RULES_EVENT_KEY &entry = event.entry[i];
+    if (entry.flags & RULES_EVENT_KEY_LITERAL) {
+      for (p = event.data + entry.key; RulesEventLiteral(*p); p++);
+      *p = '\0';
+    }
+    if (entry.flags & RULES_EVENT_VALUE_LITERAL) {
+      for (p = event.data + entry.value; RulesEventLiteral(*p); p++);
+      *p = '\0';
+    }
+  }
+  return true;
+}
+
+int32_t RulesEventFind(struct RULES_EVENT &event, uint32_t parent, const char *key)
+{
+  // Find entry of case insensitive key or first key if "?" within parent like GetCaseInsensitive()
+  if (!*key) { return -1; }
+  bool wildcard = !strcmp(key, "?");
+  for (uint32_t i = (RULES_EVENT_ROOT == parent) ? 0 : parent +1; i < event.count; i++) {
+    RULES_EVENT_KEY &entry = event.entry[i];
+    if ((entry.parent == parent) && (entry.key != RULES_EVENT_NONE) &&
+        (wildcard || !strcasecmp(event.data + entry.key, key))) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+const char* RulesEventValue(struct RULES_EVENT &event, uint32_t found, const char *key, uint32_t index)
+{
+  // Value as returned by ArduinoJson operator[] using exact key and optional array position
+  RULES_EVENT_KEY *entry = &event.entry[found];
+  if (strcmp(event.data + entry->key, key)) { return nullptr; }  // Wildcard leaf has no value
+  if (index) {
+    uint32_t i;
+    for (i = found +1; i < event.count; i++) {
+      if ((event.entry[i].parent == found) && (event.entry[i].index == index)) { break; }
+    }
+    if (i == event.count) { return nullptr; }  // No array or position out of range
+    entry = &event.entry[i];
+  }
+  return (RULES_EVENT_NONE == entry->value) ? nullptr : event.data + entry->value;
+}
+
 /*******************************************************************************************/
 
-bool RulesRuleMatch(uint8_t rule_set, String &event, String &rule)
+bool RulesRuleMatch(uint8_t rule_set, struct RULES_EVENT &event, String &rule)
 {
   // event = {"INA219":{"Voltage":4.494,"Current":0.020,"Power":0.089}}
   // event = {"System":{"Boot":1}}
@@ -495,34 +746,24 @@ bool RulesRuleMatch(uint8_t rule_set, String &event, String &rule)
     rule_name = rule_name.substring(0, pos);           // "SUBTYPE1#CURRENT"
   }
 
-  StaticJsonBuffer<1024> jsonBuf;
-  JsonObject &root = jsonBuf.parseObject(event);
-  if (!root.success()) { return false; }               // No valid JSON data
-  JsonObject *obj = &root;
+  int32_t obj = RULES_EVENT_ROOT;
   String subtype;
   uint32_t i = 0;
   while ((pos = rule_name.indexOf("#")) > 0) {         // "SUBTYPE1#SUBTYPE2#CURRENT"
     subtype = rule_name.substring(0, pos);
-    const JsonVariant & val = GetCaseInsensitive(*obj, subtype.c_str());
-    if (nullptr == &val) { return false; }            // not found
-    obj = &(val.as<JsonObject>());
-    if (!obj->success()) { return false; }            // not a JsonObject
+    obj = RulesEventFind(event, obj, subtype.c_str());
+    if (obj < 0) { return false; }                     // not found or not an object
 
     rule_name = rule_name.substring(pos +1);
     if (i++ > 10) { return false; }                    // Abandon possible loop
   }
 
-  const JsonVariant & val = GetCaseInsensitive(*obj, rule_name.c_str());
-  if (nullptr == &val) { return false; }              // last level not found
-  const char* str_value;
-  if (rule_name_idx) {
-    str_value = (*obj)[rule_name][rule_name_idx -1];   // "CURRENT[1]"
-  } else {
-    str_value = (*obj)[rule_name];                     // "CURRENT"
-  }
+  int32_t val = RulesEventFind(event, obj, rule_name.c_str());
+  if (val < 0) { return false; }                       // last level not found
+  const char* str_value = RulesEventValue(event, val, rule_name.c_str(), rule_name_idx);  // "CURRENT[1]" or "CURRENT"
 
 //AddLog_P2(LOG_LEVEL_DEBUG, PSTR("RUL: Name %s, Value |%s|, TrigCnt %d, TrigSt %d, Source %s, Json %s"),
-//  rule_name.c_str(), rule_svalue, Rules.trigger_count[rule_set], bitRead(Rules.triggers[rule_set], Rules.trigger_count[rule_set]), event.c_str(), (str_value) ? str_value : "none");
+//  rule_name.c_str(), rule_svalue, Rules.trigger_count[rule_set], bitRead(Rules.triggers[rule_set], Rules.trigger_count[rule_set]), event.data, (str_value) ? str_value : "none");
 
   Rules.event_value = str_value;                       // Prepare %value%
 
@@ -617,75 +858,274 @@ int8_t parseCompareExpression(String &expr, String &leftExpr, String &rightExpr)
   return compare;
 }
 
-void RulesVarReplace(String &commands, const String &sfind, const String &replace)
+const char* RulesSubstitution(const char* name, String *cache)
 {
-//  String ufind = sfind;
-//  ufind.toUpperCase();
-//  char *find = (char*)ufind.c_str();
-  char *find = (char*)sfind.c_str();
-  uint32_t flen = strlen(find);
-
-  String ucommand = commands;
-  ucommand.toUpperCase();
-  char *read_from = (char*)ucommand.c_str();
-  char *write_to = (char*)commands.c_str();
-  char *found_at;
-  while ((found_at = strstr(read_from, find)) != nullptr) {
-    write_to += (found_at - read_from);
-    memmove_P(write_to, find, flen);                      // Make variable Uppercase
-    write_to += flen;
-    read_from = found_at + flen;
+  // Return value of %NAME% or nullptr if unknown. Values are computed once per command in cache
+  char stemp[12];
+  for (uint32_t mem = 0; mem < 2; mem++) {
+    const char *prefix = (mem) ? PSTR("MEM") : PSTR("VAR");
+    if (!strncasecmp_P(name, prefix, 3) && name[3]) {
+      char *end;
+      uint32_t index = strtoul(name +3, &end, 10);
+      if (*end) { return nullptr; }                       // "VAR1X"
+      if (mem && (index > 0) && (index <= MAX_RULE_MEMS)) { return SettingsText(SET_MEM1 + index -1); }
+      if (!mem && (index > 0) && (index <= MAX_RULE_VARS)) { return rules_vars[index -1]; }
+      return nullptr;
+    }
+  }
+
+  int subst = GetCommandCode(stemp, sizeof(stemp), name, kRulesSubstitutions);
+  if (subst < 0) { return nullptr; }
+  if (RULES_SUBST_VALUE == subst) { return Rules.event_value.c_str(); }
+  if (RULES_SUBST_TOPIC == subst) { return SettingsText(SET_MQTT_TOPIC); }
+  if (!cache[subst].length()) {
+    switch (subst) {
+      case RULES_SUBST_TIME:      cache[subst] = String(MinutesPastMidnight()); break;
+      case RULES_SUBST_UTCTIME:   cache[subst] = String(UtcTime()); break;
+      case RULES_SUBST_UPTIME:    cache[subst] = String(MinutesUptime()); break;
+      case RULES_SUBST_TIMESTAMP: cache[subst] = GetDateAndTime(DT_LOCAL); break;
+#if defined(USE_TIMERS) && defined(USE_SUNRISE)
+      case RULES_SUBST_SUNRISE:   cache[subst] = String(SunMinutes(0)); break;
+      case RULES_SUBST_SUNSET:    cache[subst] = String(SunMinutes(1)); break;
+#endif  // USE_TIMERS and USE_SUNRISE
+#ifdef USE_ZIGBEE
+      case RULES_SUBST_ZBDEVICE:
+        snprintf_P(stemp, sizeof(stemp), PSTR("0x%04X"), Z_GetLastDevice());
+        cache[subst] = stemp;
+        break;
+      case RULES_SUBST_ZBGROUP:    cache[subst] = String(Z_GetLastGroup()); break;
+      case RULES_SUBST_ZBCLUSTER:  cache[subst] = String(Z_GetLastCluster()); break;
+      case RULES_SUBST_ZBENDPOINT: cache[subst] = String(Z_GetLastEndpoint()); break;
+#endif
+      default:
+        return nullptr;                                   // Not supported in this build
+    }
   }
+  return cache[subst].c_str();
+}
 
-  commands.replace(find, replace);
+uint32_t RulesSubstitute(const char* commands, char* command, String *cache)
+{
+  // Replace %VALUE%, %VAR1%, %MEM1%, %TIME% etc. case insensitive in a single pass
+  // Returns needed size if command is nullptr or copies to command
+  uint32_t size = 1;
+  const char *read = commands;
+  while (*read) {
+    const char *value = nullptr;
+    const char *end = nullptr;
+    if ('%' == *read) {
+      end = strchr(read +1, '%');
+      char name[12];
+      if (end && (end - read -1 < sizeof(name))) {
+        strlcpy(name, read +1, end - read);
+        value = RulesSubstitution(name, cache);
+      }
+    }
+    if (value) {
+      uint32_t len = strlen(value);
+      if (command) { memcpy(command + size -1, value, len); }
+      size += len;
+      read = end +1;
+    } else {
+      if (command) { command[size -1] = *read; }
+      size++;
+      read++;
+    }
+  }
+  if (command) { command[size -1] = '\0'; }
+  return size;
 }
 
 /*******************************************************************************************/
+/*
+ * Rule trigger index
+ *
+ * A rule set is split into its ON ... DO ... ENDON or BREAK parts once after it changed. Per part
+ * the uppercased trigger, the commands and the first JSON key of the trigger are kept so an
+ * event only evaluates the triggers whose first key is present in the tokenized event.
+ *
+ * Entry layout: [flags][KEY]\0[TELEKEY]\0[TRIGGER]\0[Commands]\0 terminated by a 0 flags byte
+ */
+/*******************************************************************************************/
+
+const uint8_t RULE_INDEX_ENTRY = 0x80;                    // Always set to make flags non-zero
+const uint8_t RULE_INDEX_BREAK = 0x01;                    // Part ends with BREAK
+const uint8_t RULE_INDEX_TELE = 0x02;                     // Trigger contains TELE-
+const uint8_t RULE_INDEX_SUBST = 0x04;                    // Commands contain % substitutions
 
-bool RuleSetProcess(uint8_t rule_set, String &event_saved)
+void RulesIndexRelease(uint32_t rule_set)
 {
-  bool serviced = false;
-  char stemp[10];
+  HeapFree(Rules.trigger_index[rule_set]);
+  Rules.trigger_index[rule_set] = nullptr;
+  Rules.index_size[rule_set] = 0;
+}
 
-  delay(0);                                               // Prohibit possible loop software watchdog
+void RulesIndexInvalidate(uint32_t rule_set)
+{
+  if (Rules.index_busy[rule_set]) {
+    bitSet(Rules.index_stale, rule_set);                  // Free when processing is done
+    return;
+  }
+  RulesIndexRelease(rule_set);
+#ifdef USE_RULES_STATS
+  HeapFree(Rules.stats[rule_set]);
+  Rules.stats[rule_set] = nullptr;
+  Rules.stats_count[rule_set] = 0;
+#endif  // USE_RULES_STATS
+}
 
-//AddLog_P2(LOG_LEVEL_DEBUG, PSTR("RUL: Event = %s, Rule = %s"), event_saved.c_str(), Settings.rules[rule_set]);
+String RulesIndexKey(const String &rule_expr)
+{
+  // Return first JSON key as searched for by RulesRuleMatch() - "INA219#CURRENT[1]>0.100" -> "INA219"
+  String expr = rule_expr;
+  String rule_name, rule_param;
+  parseCompareExpression(expr, rule_name, rule_param);
+  int pos;
+  if ((pos = rule_name.indexOf("[")) > 0) {
+    rule_name = rule_name.substring(0, pos);
+  }
+  if ((pos = rule_name.indexOf("#")) > 0) {
+    rule_name = rule_name.substring(0, pos);
+  }
+  return rule_name;                                       // "INA219" or "?" as wildcard
+}
 
+void RulesIndexBuild(uint32_t rule_set)
+{
+  String index;
   String rules = GetRule(rule_set);
+  uint32_t count = 0;
 
-  Rules.trigger_count[rule_set] = 0;
   int plen = 0;
   int plen2 = 0;
-  bool stop_all_rules = false;
   while (true) {
     rules = rules.substring(plen);                        // Select relative to last rule
     rules.trim();
-    if (!rules.length()) { return serviced; }             // No more rules
+    if (!rules.length()) { break; }                       // No more rules
 
     String rule = rules;
     rule.toUpperCase();                                   // "ON INA219#CURRENT>0.100 DO BACKLOG DIMMER 10;COLOR 100000 ENDON"
-    if (!rule.startsWith("ON ")) { return serviced; }     // Bad syntax - Nothing to start on
+    if (!rule.startsWith("ON ")) { break; }               // Bad syntax - Nothing to start on
 
     int pevt = rule.indexOf(" DO ");
-    if (pevt == -1) { return serviced; }                  // Bad syntax - Nothing to do
+    if (pevt == -1) { break; }                            // Bad syntax - Nothing to do
     String event_trigger = rule.substring(3, pevt);       // "INA219#CURRENT>0.100"
 
     plen = rule.indexOf(" ENDON");
     plen2 = rule.indexOf(" BREAK");
-    if ((plen == -1) && (plen2 == -1)) { return serviced; } // Bad syntax - No ENDON neither BREAK
+    if ((plen == -1) && (plen2 == -1)) { break; }         // Bad syntax - No ENDON neither BREAK
 
     if (plen == -1) { plen = 9999; }
     if (plen2 == -1) { plen2 = 9999; }
     plen = tmin(plen, plen2);
 
+    uint8_t flags = RULE_INDEX_ENTRY;
+    if (plen == plen2) { flags |= RULE_INDEX_BREAK; }
     String commands = rules.substring(pevt +4, plen);     // "Backlog Dimmer 10;Color 100000"
-    Rules.event_value = "";
-    String event = event_saved;
+    if (commands.indexOf('%') != -1) { flags |= RULE_INDEX_SUBST; }
+    String tele_key;
+    if (event_trigger.indexOf("TELE-") != -1) {
+      flags |= RULE_INDEX_TELE;
+      tele_key = RulesIndexKey(event_trigger.substring(5));
+    }
+    index += (char)flags;
+    index += RulesIndexKey(event_trigger);
+    index += '\1';                                        // Separators are replaced by NUL after building
+    index += tele_key;
+    index += '\1';
+    index += event_trigger;
+    index += '\1';
+    index += commands;
+    index += '\1';
+    count++;
+
+    plen += 6;
+  }
 
-//AddLog_P2(LOG_LEVEL_DEBUG, PSTR("RUL: Event |%s|, Rule |%s|, Command(s) |%s|"), event.c_str(), event_trigger.c_str(), commands.c_str());
+  RulesIndexRelease(rule_set);
+  Rules.trigger_index[rule_set] = (char*)HeapMalloc(HEAP_TAG_RULES, index.length() +1);
+  if (Rules.trigger_index[rule_set]) {
+    char *entry = Rules.trigger_index[rule_set];
+    strcpy(entry, index.c_str());                         // Ends with 0 flags byte
+    for (uint32_t i = 0; i < index.length(); i++) {
+      if ('\1' == entry[i]) { entry[i] = '\0'; }
+    }
+    Rules.index_size[rule_set] = index.length() +1;
 
-    if (RulesRuleMatch(rule_set, event, event_trigger)) {
-      if (plen == plen2) { stop_all_rules = true; }         // If BREAK was used on a triggered rule, Stop execution of this rule set
+    // Keep the index until the rule set changes if it fits RULES_CACHE_SIZE with the already kept indexes
+    uint32_t cached = 0;
+    for (uint32_t i = 0; i < MAX_RULE_SETS; i++) {
+      if ((i != rule_set) && !bitRead(Rules.index_transient, i)) { cached += Rules.index_size[i]; }
+    }
+    bitWrite(Rules.index_transient, rule_set, (cached + Rules.index_size[rule_set] > RULES_CACHE_SIZE));
+#ifdef USE_RULES_COMPRESSION
+    if (!bitRead(Rules.index_transient, rule_set)) {
+      k_rules[rule_set] = (const char*) nullptr;          // Kept index replaces the decompressed rule copy
+    }
+#endif  // USE_RULES_COMPRESSION
+#ifdef USE_RULES_STATS
+    if (!Rules.stats[rule_set]) {                         // Survives rebuilds of a transient index
+      Rules.stats[rule_set] = (RULE_STATS*)HeapCalloc(HEAP_TAG_RULES, count, sizeof(RULE_STATS));
+      if (Rules.stats[rule_set]) { Rules.stats_count[rule_set] = count; }
+    }
+#endif  // USE_RULES_STATS
+  }
+}
+
+char* RulesIndexNext(char* &entry)
+{
+  char *field = entry;
+  entry += strlen(entry) +1;
+  return field;
+}
+
+bool RuleSetProcess(uint8_t rule_set, struct RULES_EVENT &event)
+{
+  bool serviced = false;
+
+  delay(0);                                               // Prohibit possible loop software watchdog
+
+//AddLog_P2(LOG_LEVEL_DEBUG, PSTR("RUL: Event = %s, Rule = %s"), event.data, Settings.rules[rule_set]);
+
+  if (!Rules.trigger_index[rule_set]) {
+    RulesIndexBuild(rule_set);
+    if (!Rules.trigger_index[rule_set]) { return serviced; }
+  }
+  char *entry = Rules.trigger_index[rule_set];
+  Rules.index_busy[rule_set]++;
+
+  Rules.trigger_count[rule_set] = 0;
+  for (uint32_t rule = 0; *entry; rule++) {
+    uint8_t flags = *entry++;
+    char *key = RulesIndexNext(entry);                    // "INA219"
+    char *tele_key = RulesIndexNext(entry);
+    char *trigger = RulesIndexNext(entry);                // "INA219#CURRENT>0.100"
+    char *rule_commands = RulesIndexNext(entry);          // "Backlog Dimmer 10;Color 100000"
+
+    if (Rules.teleperiod) {
+      key = (flags & RULE_INDEX_TELE) ? tele_key : nullptr;  // Only TELE- triggers match teleperiod events
+    }
+    if (!key || (RulesEventFind(event, RULES_EVENT_ROOT, key) < 0)) {
+      Rules.trigger_count[rule_set]++;
+      continue;                                           // Trigger key not in event
+    }
+
+    String event_trigger = trigger;
+    String commands = rule_commands;
+    Rules.event_value = "";
+
+//AddLog_P2(LOG_LEVEL_DEBUG, PSTR("RUL: Event |%s|, Rule |%s|, Command(s) |%s|"), event.data, event_trigger.c_str(), commands.c_str());
+
+#ifdef USE_RULES_STATS
+    uint32_t match_start = micros();
+#endif  // USE_RULES_STATS
+    bool match = RulesRuleMatch(rule_set, event, event_trigger);
+#ifdef USE_RULES_STATS
+    RulesStatsMatch(rule_set, rule, micros() - match_start, match);
+    uint32_t exec_start = micros();
+#endif  // USE_RULES_STATS
+    if (match) {
+      bool stop_all_rules = (flags & RULE_INDEX_BREAK);   // If BREAK was used on a triggered rule, Stop execution of this rule set
       commands.trim();
       String ucommand = commands;
       ucommand.toUpperCase();
@@ -698,34 +1138,14 @@ bool RuleSetProcess(uint8_t rule_set, String &event_saved)
         commands = "backlog " + commands;
       }
 
-      RulesVarReplace(commands, F("%VALUE%"), Rules.event_value);
-      for (uint32_t i = 0; i < MAX_RULE_VARS; i++) {
-        snprintf_P(stemp, sizeof(stemp), PSTR("%%VAR%d%%"), i +1);
-        RulesVarReplace(commands, stemp, rules_vars[i]);
-      }
-      for (uint32_t i = 0; i < MAX_RULE_MEMS; i++) {
-        snprintf_P(stemp, sizeof(stemp), PSTR("%%MEM%d%%"), i +1);
-        RulesVarReplace(commands, stemp, SettingsText(SET_MEM1 +i));
+      String cache[RULES_SUBST_MAX];
+      uint32_t size = (flags & RULE_INDEX_SUBST) ? RulesSubstitute(commands.c_str(), nullptr, cache) : commands.length() +1;
+      char command[size];
+      if (flags & RULE_INDEX_SUBST) {
+        RulesSubstitute(commands.c_str(), command, cache);
+      } else {
+        strlcpy(command, commands.c_str(), sizeof(command));
       }
-      RulesVarReplace(commands, F("%TIME%"), String(MinutesPastMidnight()));
-      RulesVarReplace(commands, F("%UTCTIME%"), String(UtcTime()));
-      RulesVarReplace(commands, F("%UPTIME%"), String(MinutesUptime()));
-      RulesVarReplace(commands, F("%TIMESTAMP%"), GetDateAndTime(DT_LOCAL));
-      RulesVarReplace(commands, F("%TOPIC%"), SettingsText(SET_MQTT_TOPIC));
-#if defined(USE_TIMERS) && defined(USE_SUNRISE)
-      RulesVarReplace(commands, F("%SUNRISE%"), String(SunMinutes(0)));
-      RulesVarReplace(commands, F("%SUNSET%"), String(SunMinutes(1)));
-#endif  // USE_TIMERS and USE_SUNRISE
-#ifdef USE_ZIGBEE
-      snprintf_P(stemp, sizeof(stemp), PSTR("0x%04X"), Z_GetLastDevice());
-      RulesVarReplace(commands, F("%ZBDEVICE%"), String(stemp));
-      RulesVarReplace(commands, F("%ZBGROUP%"), String(Z_GetLastGroup()));
-      RulesVarReplace(commands, F("%ZBCLUSTER%"), String(Z_GetLastCluster()));
-      RulesVarReplace(commands, F("%ZBENDPOINT%"), String(Z_GetLastEndpoint()));
-#endif
-
-      char command[commands.length() +1];
-      strlcpy(command, commands.c_str(), sizeof(command));
 
       AddLog_P2(LOG_LEVEL_INFO, PSTR("RUL: %s performs \"%s\""), event_trigger.c_str(), command);
 
@@ -736,15 +1156,85 @@ bool RuleSetProcess(uint8_t rule_set, String &event_saved)
       RulesPreprocessCommand(pCmd);                       // Do pre-process for IF statement
 #endif
       ExecuteCommand(command, SRC_RULE);
+#ifdef USE_RULES_STATS
+      RulesStatsExecute(rule_set, rule, micros() - exec_start);
+#endif  // USE_RULES_STATS
       serviced = true;
-      if (stop_all_rules) { return serviced; }            // If BREAK was used, Stop execution of this rule set
+      if (stop_all_rules) { break; }                      // If BREAK was used, Stop execution of this rule set
     }
-    plen += 6;
     Rules.trigger_count[rule_set]++;
   }
+
+  Rules.index_busy[rule_set]--;
+  if (!Rules.index_busy[rule_set]) {
+    if (bitRead(Rules.index_stale, rule_set)) {
+      bitClear(Rules.index_stale, rule_set);
+      RulesIndexInvalidate(rule_set);                     // Rule set changed by one of its commands
+    }
+    else if (bitRead(Rules.index_transient, rule_set)) {
+      RulesIndexRelease(rule_set);                        // Not kept as it exceeds RULES_CACHE_SIZE
+    }
+  }
   return serviced;
 }
 
+#ifdef USE_RULES_STATS
+RULE_STATS* RulesStats(uint32_t rule_set, uint32_t rule)
+{
+  return (Rules.stats[rule_set] && (rule < Rules.stats_count[rule_set])) ? &Rules.stats[rule_set][rule] : nullptr;
+}
+
+void RulesStatsMatch(uint32_t rule_set, uint32_t rule, uint32_t duration, bool match)
+{
+  RULE_STATS *stats = RulesStats(rule_set, rule);
+  if (!stats) { return; }
+  stats->evaluations++;
+  stats->match_time += duration;
+  if (match) { stats->matches++; }
+}
+
+void RulesStatsExecute(uint32_t rule_set, uint32_t rule, uint32_t duration)
+{
+  if (duration > RULES_STATS_SLOW) {
+    AddLog_P2(LOG_LEVEL_INFO, PSTR("RUL: Rule%d trigger %d took %d ms"), rule_set +1, rule +1, duration / 1000);
+  }
+  RULE_STATS *stats = RulesStats(rule_set, rule);
+  if (!stats) { return; }
+  stats->exec_time += duration;
+  if (duration > stats->exec_max) { stats->exec_max = duration; }
+}
+
+#ifdef USE_WEBSERVER
+void RulesStatsMetrics(void)
+{
+  const char *metrics[] = { PSTR("rule_evaluations counter"), PSTR("rule_matches counter"),
+                            PSTR("rule_match_milliseconds counter"), PSTR("rule_exec_milliseconds counter"),
+                            PSTR("rule_exec_max_microseconds gauge") };
+  for (uint32_t metric = 0; metric < ARRAY_SIZE(metrics); metric++) {
+    char name[40];
+    strncpy_P(name, metrics[metric], sizeof(name));
+    name[sizeof(name) -1] = '\0';
+    WSContentSend_P(PSTR("# TYPE %s\n"), name);
+    char *type = strchr(name, ' ');
+    if (type) { *type = '\0'; }
+    for (uint32_t rule_set = 0; rule_set < MAX_RULE_SETS; rule_set++) {
+      for (uint32_t rule = 0; rule < Rules.stats_count[rule_set]; rule++) {
+        RULE_STATS *stats = &Rules.stats[rule_set][rule];
+        uint32_t value = stats->evaluations;
+        switch (metric) {
+          case 1: value = stats->matches; break;
+          case 2: value = stats->match_time / 1000; break;
+          case 3: value = stats->exec_time / 1000; break;
+          case 4: value = stats->exec_max; break;
+        }
+        WSContentSend_P(PSTR("%s{rule=\"%d\",trigger=\"%d\"} %u\n"), name, rule_set +1, rule +1, value);
+      }
+    }
+  }
+}
+#endif  // USE_WEBSERVER
+#endif  // USE_RULES_STATS
+
 /*******************************************************************************************/
 
 bool RulesProcessEvent(char *json_event)
@@ -769,9 +1259,12 @@ bool RulesProcessEvent(char *json_event)
 
 //AddLog_P2(LOG_LEVEL_DEBUG, PSTR("RUL: Event %s"), event_saved.c_str());
 
+  struct RULES_EVENT event;
+  if (!RulesEventTokenize(event, (char*)event_saved.c_str())) { return serviced; }  // No valid JSON data
+
   for (uint32_t i = 0; i < MAX_RULE_SETS; i++) {
     if (GetRuleLen(i) && bitRead(Settings.rule_enabled, i)) {
-      if (RuleSetProcess(i, event_saved)) { serviced = true; }
+      if (RuleSetProcess(i, event)) { serviced = true; }
     }
   }
   return serviced;
@@ -916,7 +1409,7 @@ uint8_t rules_xsns_index = 0;
 void RulesEvery100ms(void)
 {
   if (Settings.rule_enabled && (uptime > 4)) {  // Any rule enabled and allow 4 seconds start-up time for sensors (#3811)
-    mqtt_data[0] = '\0';
+    ResponseClear();
     int tele_period_save = tele_period;
     tele_period = 2;                                   // Do not allow HA updates during next function call
     XsnsNextCall(FUNC_JSON_APPEND, rules_xsns_index);  // ,"INA219":{"Voltage":4.494,"Current":0.020,"Power":0.089}
@@ -971,7 +1464,7 @@ void RulesSetPower(void)
 void RulesTeleperiod(void)
 {
   Rules.teleperiod = true;
-  RulesProcess();
+  RulesProcessEvent(ResponseStreamPayload());  // Complete tele/SENSOR even if larger than mqtt_data
   Rules.teleperiod = false;
 }
 
@@ -980,6 +1473,8 @@ void RulesTeleperiod(void)
 /*
  * Rules: Process received MQTT message.
  *        If the message is in our subscription list, trigger an event with the value parsed from MQTT data
+ *        Subscriptions are found with a topic trie honoring + and # wildcards and the payload is parsed
+ *        at most once for all matching subscriptions with a key
  * Input:
  *      void      - We are going to access XdrvMailbox data directly.
  * Return:
@@ -988,48 +1483,160 @@ void RulesTeleperiod(void)
  */
 bool RulesMqttData(void)
 {
-  if (XdrvMailbox.data_len < 1 || XdrvMailbox.data_len > 256) {
+  if ((XdrvMailbox.data_len < 1) || !RulesTopics.nodes) {
+    return false;
+  }
+  int16_t matched[subscriptions.size()];
+  uint32_t count = RulesTopicsMatch(XdrvMailbox.topic, matched);
+  if (!count) {
     return false;
   }
-  bool serviced = false;
-  String sTopic = XdrvMailbox.topic;
-  String sData = XdrvMailbox.data;
   //AddLog_P2(LOG_LEVEL_DEBUG, PSTR("RUL: MQTT Topic %s, Event %s"), XdrvMailbox.topic, XdrvMailbox.data);
-  MQTT_Subscription event_item;
-  //Looking for matched topic
-  for (uint32_t index = 0; index < subscriptions.size(); index++) {
-    event_item = subscriptions.get(index);
-
-    //AddLog_P2(LOG_LEVEL_DEBUG, PSTR("RUL: Match MQTT message Topic %s with subscription topic %s"), sTopic.c_str(), event_item.Topic.c_str());
-    if (sTopic.startsWith(event_item.Topic)) {
-      //This topic is subscribed by us, so serve it
-      serviced = true;
-      String value;
-      if (event_item.Key.length() == 0) {   //If did not specify Key
-        value = sData;
-      } else {      //If specified Key, need to parse Key/Value from JSON data
-        StaticJsonBuffer<500> jsonBuf;
-        JsonObject& jsonData = jsonBuf.parseObject(sData);
-        String key1 = event_item.Key;
-        String key2;
-        if (!jsonData.success()) break;       //Failed to parse JSON data, ignore this message.
-        int dot;
-        if ((dot = key1.indexOf('.')) > 0) {
-          key2 = key1.substring(dot+1);
-          key1 = key1.substring(0, dot);
-          if (!jsonData[key1][key2].success()) break;   //Failed to get the key/value, ignore this message.
-          value = (const char *)jsonData[key1][key2];
-        } else {
-          if (!jsonData[key1].success()) break;
-          value = (const char *)jsonData[key1];
-        }
+
+  // One copy for values and one for a JSON parse which modifies it, parsed once for all keys
+  char *data = (char*)malloc(2 * (XdrvMailbox.data_len +1));
+  if (!data) {
+    return true;                          // Subscribed but no memory to serve it
+  }
+  char *json_data = data + XdrvMailbox.data_len +1;
+  memcpy(data, XdrvMailbox.data, XdrvMailbox.data_len);
+  data[XdrvMailbox.data_len] = '\0';
+  memcpy(json_data, data, XdrvMailbox.data_len +1);
+  JsonParseBuffer jsonBuf(500);          // Grows for large payloads
+  JsonObject *jsonData = nullptr;
+
+  for (uint32_t i = 0; i < count; i++) {
+    MQTT_Subscription event_item = subscriptions.get(matched[i]);
+    char *value = data;
+    if (event_item.Key.length() > 0) {    //If specified Key, need to parse Key/Value from JSON data
+      if (!jsonData) {
+        jsonData = &jsonBuf.parseObject(json_data);
       }
-      value.trim();
-      //Create an new event. Cannot directly call RulesProcessEvent().
-      snprintf_P(Rules.event_data, sizeof(Rules.event_data), PSTR("%s=%s"), event_item.Event.c_str(), value.c_str());
+      if (!jsonData->success()) continue;  //Failed to parse JSON data, ignore this subscription.
+      const char *key1 = event_item.Key.c_str();
+      const char *key2 = strchr(key1, '.');
+      if (key2 > key1) {
+        char key[key2 - key1 +1];
+        strlcpy(key, key1, sizeof(key));
+        key2++;
+        if (!(*jsonData)[key][key2].success()) continue;   //Failed to get the key/value, ignore this subscription.
+        value = (char *)(*jsonData)[key][key2].as<const char*>();
+      } else {
+        if (!(*jsonData)[key1].success()) continue;
+        value = (char *)(*jsonData)[key1].as<const char*>();
+      }
+      if (!value) { value = data + XdrvMailbox.data_len; }  // Empty string
     }
+    value = Trim(value);
+    //Create an new event. Cannot directly call RulesProcessEvent().
+    snprintf_P(Rules.event_data, sizeof(Rules.event_data), PSTR("%s=%s"), event_item.Event.c_str(), value);
   }
-  return serviced;
+  free(data);
+  return true;
+}
+
+/*
+ * Rules: Build the topic trie from the subscription filters <topic>/# after a (un)subscribe
+ */
+void RulesTopicsBuild(void)
+{
+  free(RulesTopics.node);
+  free(RulesTopics.next_subscription);
+  free(RulesTopics.levels);
+  RulesTopics.node = nullptr;
+  RulesTopics.next_subscription = nullptr;
+  RulesTopics.levels = nullptr;
+  RulesTopics.nodes = 0;
+
+  uint32_t subs = subscriptions.size();
+  if (!subs) { return; }
+  uint32_t size = 0;
+  uint32_t max_nodes = 1;
+  for (uint32_t index = 0; index < subs; index++) {
+    String topic = subscriptions.get(index).Topic;
+    size += topic.length() +3;            // Topic, /# and \0
+    max_nodes += 2;
+    for (uint32_t i = 0; i < topic.length(); i++) {
+      if ('/' == topic[i]) { max_nodes++; }
+    }
+  }
+  RulesTopics.node = (MQTT_TOPIC_NODE*)malloc(max_nodes * sizeof(MQTT_TOPIC_NODE));
+  RulesTopics.next_subscription = (int16_t*)malloc(subs * sizeof(int16_t));
+  RulesTopics.levels = (char*)malloc(size);
+  if (!RulesTopics.node || !RulesTopics.next_subscription || !RulesTopics.levels) {
+    AddLog_P(LOG_LEVEL_ERROR, PSTR("RUL: No memory for subscriptions"));
+    return;
+  }
+
+  RulesTopics.node[0] = { "", -1, -1, -1 };
+  RulesTopics.nodes = 1;
+  char *levels = RulesTopics.levels;
+  for (uint32_t index = 0; index < subs; index++) {
+    String filter = subscriptions.get(index).Topic + "/#";
+    strcpy(levels, filter.c_str());
+    char *next_level = levels;
+    levels += filter.length() +1;
+
+    int32_t node = 0;
+    char *level;
+    while ((level = strsep(&next_level, "/")) != nullptr) {
+      int32_t child = RulesTopics.node[node].child;
+      while ((child >= 0) && strcmp(RulesTopics.node[child].level, level)) {
+        child = RulesTopics.node[child].next;
+      }
+      if (child < 0) {
+        child = RulesTopics.nodes++;
+        RulesTopics.node[child] = { level, -1, RulesTopics.node[node].child, -1 };
+        RulesTopics.node[node].child = child;
+      }
+      node = child;
+    }
+    RulesTopics.next_subscription[index] = RulesTopics.node[node].subscription;
+    RulesTopics.node[node].subscription = index;
+  }
+}
+
+void RulesTopicsMatchNode(int32_t node, char **levels, uint32_t count, uint32_t depth, int16_t *matched, uint32_t *found)
+{
+  for (int32_t child = RulesTopics.node[node].child; child >= 0; child = RulesTopics.node[child].next) {
+    const char *level = RulesTopics.node[child].level;
+    bool wildcard = (('#' == level[0]) || ('+' == level[0])) && !level[1];
+    if (wildcard && (0 == depth) && (count > 0) && ('$' == levels[0][0])) { continue; }  // No wildcard match of $SYS topics
+    bool match = false;
+    if (('#' == level[0]) && !level[1]) {
+      match = true;                       // Matches this level, all below and the parent level
+    }
+    else if (depth < count) {
+      if ((('+' == level[0]) && !level[1]) || !strcmp(level, levels[depth])) {
+        if (depth +1 == count) { match = true; }
+        RulesTopicsMatchNode(child, levels, count, depth +1, matched, found);
+      }
+    }
+    if (match) {
+      for (int32_t index = RulesTopics.node[child].subscription; index >= 0; index = RulesTopics.next_subscription[index]) {
+        matched[(*found)++] = index;
+      }
+    }
+  }
+}
+
+uint32_t RulesTopicsMatch(const char *topic, int16_t *matched)
+{
+  // Returns the number of subscriptions matching topic stored in matched
+  char topic_levels[strlen(topic) +1];
+  strcpy(topic_levels, topic);
+  uint32_t count = 1;
+  for (uint32_t i = 0; topic_levels[i]; i++) {
+    if ('/' == topic_levels[i]) { count++; }
+  }
+  char *levels[count];
+  char *next_level = topic_levels;
+  for (uint32_t i = 0; i < count; i++) {
+    levels[i] = strsep(&next_level, "/");
+  }
+  uint32_t found = 0;
+  RulesTopicsMatchNode(0, levels, count, 0, matched, &found);
+  return found;
 }
 
 /********************************************************************************************/
@@ -1097,6 +1704,7 @@ void CmndSubscribe(void)
       subscription_item.Topic = topic.substring(0, topic.length() - 2);   //Remove "/#" so easy to match
       subscription_item.Key = key;
       subscriptions.add(subscription_item);
+      RulesTopicsBuild();
 
       MqttSubscribe(topic.c_str());
       events.concat(event_name + "," + topic
@@ -1140,6 +1748,7 @@ void CmndUnsubscribe(void)
         MqttUnsubscribe(stopic.c_str());
         events = subscription_item.Event;
         subscriptions.remove(index);
+        RulesTopicsBuild();
         break;
       }
     }
@@ -1152,6 +1761,7 @@ void CmndUnsubscribe(void)
       MqttUnsubscribe(stopic.c_str());
       subscriptions.remove(0);
     }
+    RulesTopicsBuild();
   }
   ResponseCmndChar(events.c_str());
 }
@@ -1802,11 +2412,12 @@ void ExecuteCommandBlock(const char * commands, int len)
   cmdbuff[len] = '\0';
 
   //AddLog_P2(LOG_LEVEL_DEBUG, PSTR("ExecCmd: |%s|"), cmdbuff);
-  char oneCommand[len + 1];     //To put one command
-  int insertPosition = 0;       //When insert into backlog, we should do it by 0, 1, 2 ...
+  uint16_t cmdstart[MAX_BACKLOG];   //Offset of each command in cmdbuff
+  uint16_t cmdlen[MAX_BACKLOG];     //Length of each command
+  uint32_t count = 0;
   char * pos = cmdbuff;
   int lenEndBlock = 0;
-  while (*pos) {
+  while (*pos && (count < MAX_BACKLOG)) {
     if (isspace(*pos) || '\x1e' == *pos || ';' == *pos) {
       pos++;
       continue;
@@ -1816,6 +2427,7 @@ void ExecuteCommandBlock(const char * commands, int len)
       pos += 8;
       continue;
     }
+    char *pStart = pos;
     if (strncasecmp_P(pos, PSTR("IF "), 3) == 0) {
       //Has a nested IF statement
       //Find the matched ENDIF
@@ -1824,9 +2436,7 @@ void ExecuteCommandBlock(const char * commands, int len)
         //Cannot find matched endif, stop execution.
         break;
       }
-      //We has the whole IF statement, copy to oneCommand
-      memcpy(oneCommand, pos, pEndif - pos);
-      oneCommand[pEndif - pos] = '\0';
+      //We has the whole IF statement
       pos = pEndif;
     } else {    //Normal command
       //Looking for the command end single - '\x1e'
@@ -1834,24 +2444,34 @@ void ExecuteCommandBlock(const char * commands, int len)
       if (NULL == pEndOfCommand) {
         pEndOfCommand = pos + strlen(pos);
       }
-      memcpy(oneCommand, pos, pEndOfCommand - pos);
-      oneCommand[pEndOfCommand - pos] = '\0';
       pos = pEndOfCommand;
     }
-    //Start to process current command we found
-    //Going to insert the command into backlog
-    String sCurrentCommand = oneCommand;
-    sCurrentCommand.trim();
-    if (sCurrentCommand.length() > 0
-      && backlog.size() < MAX_BACKLOG && !backlog_mutex)
-    {
-      //Insert into backlog
-      backlog_mutex = true;
-      backlog.add(insertPosition, sCurrentCommand);
-      backlog_mutex = false;
-      insertPosition++;
+    //Trim the command we found and remember it
+    char *pEnd = pos;
+    while ((pEnd > pStart) && isspace(*(pEnd - 1))) {
+      pEnd--;
+    }
+    if (pEnd > pStart) {
+      cmdstart[count] = pStart - cmdbuff;
+      cmdlen[count] = pEnd - pStart;
+      count++;
     }
   }
+  //Queue the whole block or nothing as running only part of an IF block is not what the rule says
+  uint32_t size = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    size += cmdlen[i] + 3;
+  }
+  if (!BacklogFits(command_source, count, size)) {
+    AddLog_P2(LOG_LEVEL_INFO, PSTR("RUL: Backlog full, block of %d commands not executed"), count);
+    return;
+  }
+  //Insert the commands in front of the backlog, last one first, so they execute in order
+  while (count) {
+    count--;
+    cmdbuff[cmdstart[count] + cmdlen[count]] = '\0';
+    BacklogAdd(&cmdbuff[cmdstart[count]], command_source, true);
+  }
   return;
 }
 
@@ -1991,7 +2611,7 @@ void CmndRule(void)
       CmndRule();
       MqttPublishPrefixTopic_P(RESULT_OR_STAT, XdrvMailbox.command);
     }
-    mqtt_data[0] = '\0';             // Disable further processing
+    ResponseClear();             // Disable further processing
     return;
   }
   uint8_t index = XdrvMailbox.index;
@@ -2063,7 +2683,7 @@ void CmndRule(void)
     // snprintf_P (mqtt_data, sizeof(mqtt_data), PSTR("{\"%s%d\":\"%s\",\"Once\":\"%s\",\"StopOnError\":\"%s\",\"Free\":%d,\"Rules\":\"%s\"}"),
     //   XdrvMailbox.command, index, GetStateText(bitRead(Settings.rule_enabled, index -1)), GetStateText(bitRead(Settings.rule_once, index -1)),
     //   GetStateText(bitRead(Settings.rule_stop, index -1)), sizeof(Settings.rules[index -1]) - strlen(Settings.rules[index -1]) -1, Settings.rules[index -1]);
-    snprintf_P (mqtt_data, sizeof(mqtt_data), PSTR("{\"%s%d\":\"%s\",\"Once\":\"%s\",\"StopOnError\":\"%s\",\"Length\":%d,\"Free\":%d,\"Rules\":\"%s\"}"),
+    Response_P(PSTR("{\"%s%d\":\"%s\",\"Once\":\"%s\",\"StopOnError\":\"%s\",\"Length\":%d,\"Free\":%d,\"Rules\":\"%s\"}"),
       XdrvMailbox.command, index, GetStateText(bitRead(Settings.rule_enabled, index -1)), GetStateText(bitRead(Settings.rule_once, index -1)),
       GetStateText(bitRead(Settings.rule_stop, index -1)),
       rule_len, MAX_RULE_SIZE - GetRuleLenStorage(index - 1),
@@ -2071,6 +2691,40 @@ void CmndRule(void)
   }
 }
 
+#ifdef USE_RULES_STATS
+void CmndRuleStats(void)
+{
+  // RuleStats<x>   - Show trigger statistics of rule set x
+  // RuleStats<x> 0 - Reset trigger statistics of rule set x
+  uint32_t rule_set = XdrvMailbox.index -1;
+  if (rule_set >= MAX_RULE_SETS) { return; }
+  if (!Rules.trigger_index[rule_set] && GetRuleLen(rule_set)) {
+    RulesIndexBuild(rule_set);
+  }
+  if ((0 == XdrvMailbox.payload) && Rules.stats[rule_set]) {
+    memset(Rules.stats[rule_set], 0, Rules.stats_count[rule_set] * sizeof(RULE_STATS));
+  }
+
+  Response_P(PSTR("{\"%s%d\":["), XdrvMailbox.command, XdrvMailbox.index);
+  char *entry = Rules.trigger_index[rule_set];
+  for (uint32_t rule = 0; entry && *entry && (rule < Rules.stats_count[rule_set]); rule++) {
+    entry++;                              // Skip flags
+    RulesIndexNext(entry);                // Skip key
+    RulesIndexNext(entry);                // Skip tele key
+    char *trigger = RulesIndexNext(entry);
+    RulesIndexNext(entry);                // Skip commands
+    RULE_STATS *stats = &Rules.stats[rule_set][rule];
+    // Totals in milliseconds, averages and maximum in microseconds
+    ResponseAppend_P(PSTR("%s{\"Trigger\":\"%s\",\"Evaluations\":%u,\"Matches\":%u,\"MatchTime\":%u,\"MatchAvg\":%u,\"ExecTime\":%u,\"ExecAvg\":%u,\"ExecMax\":%u}"),
+      (rule) ? "," : "", EscapeJSONString(trigger).c_str(), stats->evaluations, stats->matches,
+      (uint32_t)(stats->match_time / 1000), (stats->evaluations) ? (uint32_t)(stats->match_time / stats->evaluations) : 0,
+      (uint32_t)(stats->exec_time / 1000), (stats->matches) ? (uint32_t)(stats->exec_time / stats->matches) : 0,
+      stats->exec_max);
+  }
+  ResponseAppend_P(PSTR("]}"));
+}
+#endif  // USE_RULES_STATS
+
 void CmndRuleTimer(void)
 {
   if ((XdrvMailbox.index > 0) && (XdrvMailbox.index <= MAX_RULE_TIMERS)) {
@@ -2082,7 +2736,7 @@ void CmndRuleTimer(void)
       Rules.timer[XdrvMailbox.index -1] = (XdrvMailbox.payload > 0) ? millis() + (1000 * XdrvMailbox.payload) : 0;
 #endif  // USE_EXPRESSION
     }
-    mqtt_data[0] = '\0';
+    ResponseClear();
     for (uint32_t i = 0; i < MAX_RULE_TIMERS; i++) {
       ResponseAppend_P(PSTR("%c\"T%d\":%d"), (i) ? ',' : '{', i +1, (Rules.timer[i]) ? (Rules.timer[i] - millis()) / 1000 : 0);
     }
@@ -2105,7 +2759,7 @@ void CmndVariable(void)
 {
   if ((XdrvMailbox.index > 0) && (XdrvMailbox.index <= MAX_RULE_VARS)) {
     if (!XdrvMailbox.usridx) {
-      mqtt_data[0] = '\0';
+      ResponseClear();
       for (uint32_t i = 0; i < MAX_RULE_VARS; i++) {
         ResponseAppend_P(PSTR("%c\"Var%d\":\"%s\""), (i) ? ',' : '{', i +1, rules_vars[i]);
       }
@@ -2258,6 +2912,8 @@ bool Xdrv10(uint8_t function)
 #endif  // SUPPORT_MQTT_EVENT
     case FUNC_PRE_INIT:
       RulesInit();
+      XdrvSubscribe(FUNC_EVERY_50_MSECOND);
+      XdrvSubscribe(FUNC_EVERY_100_MSECOND);
       break;
   }
   return result;
@@ -78,6 +78,13 @@ uint32_t DecodeLightId(uint32_t hue_id);
 #endif
 #endif // USE_SCRIPT_COMPRESSION
 
+#if (defined(LITTLEFS_SCRIPT_SIZE) && !defined(USE_24C256) && !defined(USE_SCRIPT_FATFS)) || (USE_SCRIPT_FATFS==-1)
+// files are on the flash file system
+#define SCRIPT_FLASH_WEAR(len) FLASH_WEAR_LEVELED(WEAR_SCRIPT, len)
+#else
+#define SCRIPT_FLASH_WEAR(len)
+#endif
+
 #if (defined(LITTLEFS_SCRIPT_SIZE) && !defined(USE_24C256) && !defined(USE_SCRIPT_FATFS)) || (USE_SCRIPT_FATFS==-1)
 
 #ifdef ESP32
@@ -94,7 +101,19 @@ void SaveFile(const char *name,const uint8_t *buf,uint32_t len) {
   if (!file) return;
   file.write(buf, len);
   file.close();
+  SCRIPT_FLASH_WEAR(len);
+}
+
+#ifdef USE_FLASH_WEAR
+void ScriptFlashWearRegion(void) {
+#ifdef ESP32
+  FlashWearRegion(WEAR_SCRIPT, SPIFFS.totalBytes() / SPI_FLASH_SEC_SIZE);
+#else
+  FSInfo info;
+  if (fsp->info(info)) FlashWearRegion(WEAR_SCRIPT, info.totalBytes / SPI_FLASH_SEC_SIZE);
+#endif
 }
+#endif  // USE_FLASH_WEAR
 
 #define FORMAT_SPIFFS_IF_FAILED true
 uint8_t fs_mounted=0;
@@ -234,6 +253,26 @@ typedef union {
 } FILE_FLAGS;
 
 #define SFS_MAX 4
+#define SFS_LOGGER SFS_MAX          // Handle of the file kept open by fap()
+#ifndef SFS_BUFSIZE
+#ifdef ESP32
+#define SFS_BUFSIZE 1024            // Write buffer per open file
+#else
+#define SFS_BUFSIZE 256
+#endif
+#endif
+#ifndef SFS_FLUSH_TIME
+#define SFS_FLUSH_TIME 10           // Seconds until buffered data is written to the file
+#endif
+
+struct SFS_WBUF {
+  uint8_t *buf[2];                  // ESP32 fills one buffer while the flush task writes the other
+  uint32_t time;                    // Millis of the oldest unwritten data
+  uint16_t len;
+  uint16_t qlen;                    // Length of the buffer queued for the flush task
+  uint8_t active;
+  volatile uint8_t busy;            // Flush task still writes buf[active^1]
+};
 // global memory
 struct SCRIPT_MEM {
     float *fvars; // number var pointer
@@ -242,6 +281,8 @@ struct SCRIPT_MEM {
     struct M_FILT *mfilt;
     char *glob_vnp; // var name pointer
     uint8_t *vnp_offset;
+    uint8_t *var_hash; // var index+1 per hash bucket, 0 is empty
+    uint16_t var_hash_size; // number of buckets, power of 2
     char *glob_snp; // string vars pointer
     char *scriptptr;
     char *section_ptr;
@@ -260,13 +301,54 @@ struct SCRIPT_MEM {
     uint8_t script_loglevel;
     uint8_t flags;
 #ifdef USE_SCRIPT_FATFS
-    File files[SFS_MAX];
-    FILE_FLAGS file_flags[SFS_MAX];
+    File files[SFS_MAX+1];
+    FILE_FLAGS file_flags[SFS_MAX+1];
+    struct SFS_WBUF wbuf[SFS_MAX+1];
+    char logname[SCRIPT_MAXSSIZE];
     uint8_t script_sd_found;
     char flink[2][14];
 #endif
 } glob_script_mem;
 
+#if defined(ESP32) && defined(USE_SCRIPT_TASK)
+#ifndef STASK_QUEUE
+#define STASK_QUEUE 8               // Numbers per channel and commands queued by task sections
+#endif
+#define STASK_CHANNELS 3            // Main script, task 1 and task 2
+
+struct {
+  SemaphoreHandle_t mutex = nullptr;          // Held by the main loop or a task while it runs the interpreter
+  QueueHandle_t chan[STASK_CHANNELS] = {};    // Numbers sent by tsnd() and read by trcv()
+  QueueHandle_t cmds = nullptr;               // Commands of task sections executed by the main loop
+  uint16_t drops;                             // Numbers and commands lost on a full queue
+} script_tasks;
+#endif  // ESP32 && USE_SCRIPT_TASK
+
+
+#ifdef USE_SCRIPT_COMPILE
+#ifndef SCRIPT_CODE_SLOTS
+#define SCRIPT_CODE_SLOTS 64        // Number of cached numeric expressions
+#endif
+#ifndef SCRIPT_CODE_SIZE
+#define SCRIPT_CODE_SIZE 1024       // Bytecode pool size
+#endif
+#define SCRIPT_CODE_STACK 8
+#define SCRIPT_CODE_NONE 0xFFFF     // Expression can not be compiled
+
+enum {SC_END, SC_NUM, SC_VAR, SC_NVAR, SC_OPER};
+
+struct SCRIPT_CODE_SLOT {
+  uint16_t expr;                    // Offset of expression in script_ram plus one, 0 if free
+  uint16_t end;                     // Offset of first character after expression
+  uint16_t code;                    // Offset in bytecode pool or SCRIPT_CODE_NONE
+};
+
+struct SCRIPT_CODE {
+  struct SCRIPT_CODE_SLOT *slot;
+  uint8_t *pool;
+  uint16_t pool_used;
+} script_code;
+#endif  // USE_SCRIPT_COMPILE
 
 int16_t last_findex;
 uint8_t tasm_cmd_activ=0;
@@ -284,7 +366,161 @@ char *ForceStringVar(char *lp,char *dstr);
 void send_download(void);
 uint8_t reject(char *name);
 
+#ifdef USE_SCRIPT_FATFS
+/*********************************************************************************************\
+ * Writes to open files are collected in a buffer per file and written when the buffer is full,
+ * after SFS_FLUSH_TIME seconds and on ff(), fc() or restart. ESP32 hands full buffers to a task.
+\*********************************************************************************************/
+
+#ifdef ESP32
+struct {
+  TaskHandle_t task = nullptr;
+  QueueHandle_t queue = nullptr;
+} sfs_flush;
+
+void ScriptFileTask(void *arg) {
+  uint8_t ind;
+  while (true) {
+    if (pdTRUE == xQueueReceive(sfs_flush.queue, &ind, portMAX_DELAY)) {
+      struct SFS_WBUF *wb=&glob_script_mem.wbuf[ind];
+      glob_script_mem.files[ind].write(wb->buf[wb->active^1],wb->qlen);
+      glob_script_mem.files[ind].flush();
+      wb->busy=0;
+    }
+  }
+}
+
+bool ScriptFileTaskInit(void) {
+  if (sfs_flush.queue) return true;
+  // Each file has at most one buffer queued
+  sfs_flush.queue=xQueueCreate(SFS_MAX+1,sizeof(uint8_t));
+  if (!sfs_flush.queue) return false;
+  if (pdPASS != xTaskCreatePinnedToCore(ScriptFileTask, "sfs", 4096, nullptr, 1, &sfs_flush.task, !xPortGetCoreID())) {
+    vQueueDelete(sfs_flush.queue);
+    sfs_flush.queue=nullptr;
+    return false;
+  }
+  return true;
+}
+#endif  // ESP32
+
+void ScriptFileWait(uint8_t ind) {
+#ifdef ESP32
+  while (glob_script_mem.wbuf[ind].busy) {
+    delay(1);
+  }
+#endif
+}
+
+void ScriptFileFlush(uint8_t ind) {
+  struct SFS_WBUF *wb=&glob_script_mem.wbuf[ind];
+  ScriptFileWait(ind);
+  if (wb->len) {
+    glob_script_mem.files[ind].write(wb->buf[wb->active],wb->len);
+    SCRIPT_FLASH_WEAR(wb->len);
+    wb->len=0;
+  }
+}
+
+void ScriptFileQueue(uint8_t ind) {
+  // Write the buffer in the background if possible
+  struct SFS_WBUF *wb=&glob_script_mem.wbuf[ind];
+#ifdef ESP32
+  if (wb->buf[1]) {
+    ScriptFileWait(ind);
+    wb->qlen=wb->len;
+    wb->busy=1;
+    wb->active^=1;
+    wb->len=0;
+    if (pdTRUE == xQueueSend(sfs_flush.queue,&ind,0)) {
+      SCRIPT_FLASH_WEAR(wb->qlen);
+      return;
+    }
+    wb->active^=1;
+    wb->len=wb->qlen;
+    wb->busy=0;
+  }
+#endif
+  ScriptFileFlush(ind);
+  glob_script_mem.files[ind].flush();
+}
+
+uint32_t ScriptFileWrite(uint8_t ind,const uint8_t *data,uint32_t len) {
+  struct SFS_WBUF *wb=&glob_script_mem.wbuf[ind];
+  if (!wb->buf[0]) {
+    wb->buf[0]=(uint8_t*)HeapMalloc(HEAP_TAG_SCRIPT,SFS_BUFSIZE);
+#ifdef ESP32
+    if (wb->buf[0] && ScriptFileTaskInit()) wb->buf[1]=(uint8_t*)HeapMalloc(HEAP_TAG_SCRIPT,SFS_BUFSIZE);
+#endif
+    wb->len=0;
+    wb->active=0;
+  }
+  if (!wb->buf[0] || (len>=SFS_BUFSIZE)) {
+    ScriptFileFlush(ind);
+    SCRIPT_FLASH_WEAR(len);
+    return glob_script_mem.files[ind].write(data,len);
+  }
+  if (wb->len+len>SFS_BUFSIZE) {
+    ScriptFileQueue(ind);
+  }
+  if (!wb->len) wb->time=millis();
+  memcpy(wb->buf[wb->active]+wb->len,data,len);
+  wb->len+=len;
+  return len;
+}
+
+void ScriptFileClose(uint8_t ind) {
+  struct SFS_WBUF *wb=&glob_script_mem.wbuf[ind];
+  ScriptFileFlush(ind);
+  for (uint8_t cnt=0;cnt<2;cnt++) {
+    if (wb->buf[cnt]) HeapFree(wb->buf[cnt]);
+    wb->buf[cnt]=0;
+  }
+  glob_script_mem.files[ind].close();
+  glob_script_mem.file_flags[ind].is_open=0;
+}
+
+uint32_t ScriptFileLog(const char *name,const char *line) {
+  // Append a line to a file kept open between calls
+  uint8_t ind=SFS_LOGGER;
+  if (glob_script_mem.file_flags[ind].is_open && strcmp(glob_script_mem.logname,name)) {
+    ScriptFileClose(ind);
+  }
+  if (!glob_script_mem.file_flags[ind].is_open) {
+    glob_script_mem.files[ind]=fsp->open(name,FILE_APPEND);
+    if (!glob_script_mem.files[ind]) return 0;
+    glob_script_mem.file_flags[ind].is_open=1;
+    glob_script_mem.file_flags[ind].is_dir=0;
+    strlcpy(glob_script_mem.logname,name,sizeof(glob_script_mem.logname));
+  }
+  uint32_t len=ScriptFileWrite(ind,(const uint8_t*)line,strlen(line));
+  len+=ScriptFileWrite(ind,(const uint8_t*)"\n",1);
+  return len;
+}
+
+void ScriptFileEverySecond(void) {
+  for (uint8_t cnt=0;cnt<=SFS_MAX;cnt++) {
+    struct SFS_WBUF *wb=&glob_script_mem.wbuf[cnt];
+    if (glob_script_mem.file_flags[cnt].is_open && wb->len && (TimePassedSince(wb->time)>=SFS_FLUSH_TIME*1000)) {
+      ScriptFileQueue(cnt);
+    }
+  }
+}
+
+void ScriptFileFlushAll(void) {
+  for (uint8_t cnt=0;cnt<=SFS_MAX;cnt++) {
+    if (glob_script_mem.file_flags[cnt].is_open) {
+      ScriptFileFlush(cnt);
+      glob_script_mem.files[cnt].flush();
+    }
+  }
+}
+#endif  // USE_SCRIPT_FATFS
+
 void ScriptEverySecond(void) {
+#ifdef USE_SCRIPT_FATFS
+  ScriptFileEverySecond();
+#endif
 
   if (bitRead(Settings.rule_enabled, 0)) {
     struct T_INDEX *vtp=glob_script_mem.type;
@@ -313,7 +549,8 @@ void ScriptEverySecond(void) {
 }
 
 void RulesTeleperiod(void) {
-  if (bitRead(Settings.rule_enabled, 0) && mqtt_data[0]) Run_Scripter(">T",2, mqtt_data);
+  char *payload = ResponseStreamPayload();
+  if (bitRead(Settings.rule_enabled, 0) && payload[0]) Run_Scripter(">T",2, payload);
 }
 
 // EEPROM MACROS
@@ -501,7 +738,7 @@ char *script;
 
     uint16_t fsize=0;
     for (count=0; count<numflt; count++) {
-      fsize+=sizeof(struct M_FILT)+((mfilt[count].numvals&0x7f)-1)*sizeof(float);
+      fsize+=Script_FilterSize(mfilt[count].numvals);
     }
 
     // now copy vars to memory
@@ -521,7 +758,7 @@ char *script;
 
     script_mem_size+=16;
     uint8_t *script_mem;
-    script_mem=(uint8_t*)calloc(script_mem_size,1);
+    script_mem=(uint8_t*)HeapCallocLarge(HEAP_TAG_SCRIPT,script_mem_size,1);
     if (!script_mem) {
       return -4;
     }
@@ -578,7 +815,7 @@ char *script;
         namep++;
         index++;
         if (index>255) {
-          free(glob_script_mem.script_mem);
+          HeapFree(glob_script_mem.script_mem);
           return -5;
         }
     }
@@ -599,7 +836,7 @@ char *script;
     for (count=0; count<numflt; count++) {
       struct M_FILT *mflp=(struct M_FILT*)mp;
       mflp->numvals=mfilt[count].numvals;
-      mp+=sizeof(struct M_FILT)+((mfilt[count].numvals&0x7f)-1)*sizeof(float);
+      mp+=Script_FilterSize(mfilt[count].numvals);
     }
 
     glob_script_mem.numvars=vars;
@@ -666,8 +903,8 @@ char *script;
         glob_script_mem.script_sd_found=0;
       }
     }
-    for (uint8_t cnt=0;cnt<SFS_MAX;cnt++) {
-      glob_script_mem.file_flags[cnt].is_open=0;
+    for (uint8_t cnt=0;cnt<=SFS_MAX;cnt++) {
+      if (glob_script_mem.file_flags[cnt].is_open) ScriptFileClose(cnt);
     }
 #endif
 
@@ -679,6 +916,12 @@ char *script;
     // store start of actual program here
     glob_script_mem.scriptptr=lp-1;
     glob_script_mem.scriptptr_bu=glob_script_mem.scriptptr;
+
+    ScriptVarHashInit();
+    ScriptSectionsInit();
+#ifdef USE_SCRIPT_COMPILE
+    ScriptCodeInit();
+#endif
     return 0;
 
 }
@@ -710,125 +953,237 @@ void ws2812_set_array(float *array ,uint32_t len, uint32_t offset) {
 #define FLT_MAX 99999999
 #endif
 
-float median_array(float *array,uint8_t len) {
-    uint8_t ind[len];
-    uint8_t mind=0,index=0,flg;
-    float min=FLT_MAX;
-
-    for (uint8_t hcnt=0; hcnt<len/2+1; hcnt++) {
-        for (uint8_t mcnt=0; mcnt<len; mcnt++) {
-            flg=0;
-            for (uint8_t icnt=0; icnt<index; icnt++) {
-                if (ind[icnt]==mcnt) {
-                    flg=1;
-                }
-            }
-            if (!flg) {
-                if (array[mcnt]<min) {
-                    min=array[mcnt];
-                    mind=mcnt;
-                }
-            }
-        }
-        ind[index]=mind;
-        index++;
-        min=FLT_MAX;
+float select_array(float *array,uint8_t len,uint8_t pos) {
+  // returns the pos-th smallest value (0 based) using quickselect on a copy
+  float tmp[len];
+  memcpy(tmp,array,len*sizeof(float));
+  uint8_t left=0,right=len-1;
+  while (left<right) {
+    float pivot=tmp[(left+right)/2];
+    int16_t i=left,j=right;
+    while (i<=j) {
+      while (tmp[i]<pivot) i++;
+      while (tmp[j]>pivot) j--;
+      if (i<=j) {
+        float swap=tmp[i];
+        tmp[i]=tmp[j];
+        tmp[j]=swap;
+        i++;
+        j--;
+      }
+    }
+    if (pos<=j) {
+      right=j;
+    } else if (pos>=i) {
+      left=i;
+    } else {
+      break;
     }
-    return array[ind[len/2]];
+  }
+  return tmp[pos];
 }
 
+float median_array(float *array,uint8_t len) {
+  return select_array(array,len,len/2);
+}
 
-float *Get_MFAddr(uint8_t index,uint8_t *len) {
-  *len=0;
+/*********************************************************************************************\
+ * Array and filter variables
+ *
+ * Median filters keep a sorted copy of their values behind the ring buffer which is updated
+ * per new value so the median and percentiles are read without sorting.
+\*********************************************************************************************/
+
+uint32_t Script_FilterSize(uint8_t numvals) {
+  uint8_t len=numvals&0x7f;
+  uint32_t size=sizeof(struct M_FILT)+(len-1)*sizeof(float);
+  if (!(numvals&0x80)) size+=len*sizeof(float);   // sorted copy of median filter
+  return size;
+}
+
+struct M_FILT *Script_GetFilter(uint8_t index) {
   uint8_t *mp=(uint8_t*)glob_script_mem.mfilt;
   for (uint8_t count=0; count<MAXFILT; count++) {
     struct M_FILT *mflp=(struct M_FILT*)mp;
-    if (count==index) {
-        *len=mflp->numvals&0x7f;
-        return mflp->rbuff;
-    }
-    mp+=sizeof(struct M_FILT)+((mflp->numvals&0x7f)-1)*sizeof(float);
+    if (count==index) return mflp;
+    mp+=Script_FilterSize(mflp->numvals);
   }
   return 0;
 }
 
+float *Script_FilterSorted(struct M_FILT *mflp) {
+  if (mflp->numvals&0x80) return 0;
+  return &mflp->rbuff[mflp->numvals];
+}
 
-float Get_MFVal(uint8_t index,uint8_t bind) {
-  uint8_t *mp=(uint8_t*)glob_script_mem.mfilt;
-  for (uint8_t count=0; count<MAXFILT; count++) {
-    struct M_FILT *mflp=(struct M_FILT*)mp;
-    if (count==index) {
-        uint8_t maxind=mflp->numvals&0x7f;
-        if (!bind) {
-          return mflp->index;
-        }
-        if (bind<1 || bind>maxind) bind=maxind;
-        return mflp->rbuff[bind-1];
+void Script_FilterSort(struct M_FILT *mflp) {
+  // rebuild sorted copy after bulk changes by insertion sort
+  float *sorted=Script_FilterSorted(mflp);
+  if (!sorted) return;
+  uint8_t len=mflp->numvals;
+  for (uint8_t count=0; count<len; count++) {
+    float val=mflp->rbuff[count];
+    int16_t pos=count;
+    while (pos>0 && sorted[pos-1]>val) {
+      sorted[pos]=sorted[pos-1];
+      pos--;
     }
-    mp+=sizeof(struct M_FILT)+((mflp->numvals&0x7f)-1)*sizeof(float);
+    sorted[pos]=val;
   }
-  return 0;
 }
 
-void Set_MFVal(uint8_t index,uint8_t bind,float val) {
-  uint8_t *mp=(uint8_t*)glob_script_mem.mfilt;
-  for (uint8_t count=0; count<MAXFILT; count++) {
-    struct M_FILT *mflp=(struct M_FILT*)mp;
-    if (count==index) {
-        uint8_t maxind=mflp->numvals&0x7f;
-        if (!bind) {
-          mflp->index=val;
-        } else {
-          if (bind<1 || bind>maxind) bind=maxind;
-          mflp->rbuff[bind-1]=val;
-        }
-        return;
+void Script_FilterReplace(struct M_FILT *mflp,uint8_t bind,float val) {
+  // replace ring buffer value and move it to its place in the sorted copy
+  float *sorted=Script_FilterSorted(mflp);
+  float old=mflp->rbuff[bind];
+  mflp->rbuff[bind]=val;
+  if (!sorted) return;
+  uint8_t len=mflp->numvals;
+  int16_t left=0,right=len-1;
+  while (left<right) {
+    int16_t mid=(left+right)/2;
+    if (sorted[mid]<old) {
+      left=mid+1;
+    } else {
+      right=mid;
     }
-    mp+=sizeof(struct M_FILT)+((mflp->numvals&0x7f)-1)*sizeof(float);
   }
+  if (sorted[left]!=old) {
+    // NaN or inconsistent copy
+    Script_FilterSort(mflp);
+    return;
+  }
+  int16_t pos=left;
+  while (pos>0 && sorted[pos-1]>val) {
+    sorted[pos]=sorted[pos-1];
+    pos--;
+  }
+  while (pos<len-1 && sorted[pos+1]<val) {
+    sorted[pos]=sorted[pos+1];
+    pos++;
+  }
+  sorted[pos]=val;
+}
+
+float *Get_MFAddr(uint8_t index,uint8_t *len) {
+  *len=0;
+  struct M_FILT *mflp=Script_GetFilter(index);
+  if (!mflp) return 0;
+  *len=mflp->numvals&0x7f;
+  return mflp->rbuff;
+}
+
+float Get_MFVal(uint8_t index,uint8_t bind) {
+  struct M_FILT *mflp=Script_GetFilter(index);
+  if (!mflp) return 0;
+  uint8_t maxind=mflp->numvals&0x7f;
+  if (!bind) {
+    return mflp->index;
+  }
+  if (bind<1 || bind>maxind) bind=maxind;
+  return mflp->rbuff[bind-1];
 }
 
+void Set_MFVal(uint8_t index,uint8_t bind,float val) {
+  struct M_FILT *mflp=Script_GetFilter(index);
+  if (!mflp) return;
+  uint8_t maxind=mflp->numvals&0x7f;
+  if (!bind) {
+    mflp->index=val;
+  } else {
+    if (bind<1 || bind>maxind) bind=maxind;
+    Script_FilterReplace(mflp,bind-1,val);
+  }
+}
 
 float Get_MFilter(uint8_t index) {
-  uint8_t *mp=(uint8_t*)glob_script_mem.mfilt;
-  for (uint8_t count=0; count<MAXFILT; count++) {
-    struct M_FILT *mflp=(struct M_FILT*)mp;
-    if (count==index) {
-      if (mflp->numvals&0x80) {
-        // moving average
-        return mflp->maccu/(mflp->numvals&0x7f);
-      } else {
-        // median, sort array indices
-        return median_array(mflp->rbuff,mflp->numvals);
-      }
-    }
-    mp+=sizeof(struct M_FILT)+((mflp->numvals&0x7f)-1)*sizeof(float);
+  struct M_FILT *mflp=Script_GetFilter(index);
+  if (!mflp) return 0;
+  if (mflp->numvals&0x80) {
+    // moving average
+    return mflp->maccu/(mflp->numvals&0x7f);
+  } else {
+    // median from sorted copy
+    return Script_FilterSorted(mflp)[mflp->numvals/2];
   }
-  return 0;
 }
 
 void Set_MFilter(uint8_t index, float invar) {
-  uint8_t *mp=(uint8_t*)glob_script_mem.mfilt;
-  for (uint8_t count=0; count<MAXFILT; count++) {
-    struct M_FILT *mflp=(struct M_FILT*)mp;
-    if (count==index) {
-      if (mflp->numvals&0x80) {
-        // moving average
-        mflp->maccu-=mflp->rbuff[mflp->index];
-        mflp->maccu+=invar;
-        mflp->rbuff[mflp->index]=invar;
-        mflp->index++;
-        if (mflp->index>=(mflp->numvals&0x7f)) mflp->index=0;
-      } else {
-        // median
-        mflp->rbuff[mflp->index]=invar;
-        mflp->index++;
-        if (mflp->index>=mflp->numvals) mflp->index=0;
+  struct M_FILT *mflp=Script_GetFilter(index);
+  if (!mflp) return;
+  if (mflp->numvals&0x80) {
+    // moving average
+    mflp->maccu-=mflp->rbuff[mflp->index];
+    mflp->maccu+=invar;
+    mflp->rbuff[mflp->index]=invar;
+    mflp->index++;
+    if (mflp->index>=(mflp->numvals&0x7f)) mflp->index=0;
+  } else {
+    // median
+    Script_FilterReplace(mflp,mflp->index,invar);
+    mflp->index++;
+    if (mflp->index>=mflp->numvals) mflp->index=0;
+  }
+}
+
+void Script_FilterChanged(struct M_FILT *mflp) {
+  // resync after array operations wrote the ring buffer directly
+  if (mflp->numvals&0x80) {
+    uint8_t len=mflp->numvals&0x7f;
+    mflp->maccu=0;
+    for (uint8_t count=0; count<len; count++) mflp->maccu+=mflp->rbuff[count];
+  } else {
+    Script_FilterSort(mflp);
+  }
+}
+
+char *Script_GetArray(char *lp,struct M_FILT **mflp) {
+  // parse array variable name, *mflp is 0 if not an array
+  SCRIPT_SKIP_SPACES
+  *mflp=0;
+  uint8_t len=0;
+  while (lp[len] && lp[len]!=' ' && lp[len]!=')' && lp[len]!=SCRIPT_EOL) len++;
+  int16_t vindex=ScriptFindVar(lp,len);
+  if (vindex>=0 && glob_script_mem.type[vindex].bits.is_filter) {
+    *mflp=Script_GetFilter(glob_script_mem.type[vindex].index);
+  }
+  return lp+len;
+}
+
+float Script_ArrayFunc(struct M_FILT *mflp,uint8_t func,float arg) {
+  // whole array functions asum, amin, amax, amean and aperc
+  if (!mflp) return 0;
+  uint8_t len=mflp->numvals&0x7f;
+  if (!len) return 0;
+  float *array=mflp->rbuff;
+  float *sorted=Script_FilterSorted(mflp);
+  float fvar=array[0];
+  switch (func) {
+    case 0:
+    case 3:
+      fvar=0;
+      for (uint8_t count=0; count<len; count++) fvar+=array[count];
+      if (func==3) fvar/=len;
+      break;
+    case 1:
+      if (sorted) return sorted[0];
+      for (uint8_t count=1; count<len; count++) if (array[count]<fvar) fvar=array[count];
+      break;
+    case 2:
+      if (sorted) return sorted[len-1];
+      for (uint8_t count=1; count<len; count++) if (array[count]>fvar) fvar=array[count];
+      break;
+    case 4:
+      {
+        if (arg<0) arg=0;
+        if (arg>100) arg=100;
+        uint8_t pos=(arg*(len-1))/100+0.5;
+        if (sorted) return sorted[pos];
+        fvar=select_array(array,len,pos);
       }
       break;
-    }
-    mp+=sizeof(struct M_FILT)+((mflp->numvals&0x7f)-1)*sizeof(float);
   }
+  return fvar;
 }
 
 #define MEDIAN_SIZE 5
@@ -938,6 +1293,118 @@ if (hsv.S == 0) {
 
 // vtype => ff=nothing found, fe=constant number,fd = constant string else bit 7 => 80 = string, 0 = number
 // no flash strings here for performance reasons!!!
+/*********************************************************************************************\
+ * Variable name hash index
+ *
+ * Built by Init_Scripter() with linear probing on the FNV-1a hash of the variable names
+\*********************************************************************************************/
+
+uint32_t ScriptHashAdd(uint32_t hash,const void *data,uint32_t len) {
+  const uint8_t *bp=(const uint8_t*)data;
+  while (len--) {
+    hash^=*bp++;
+    hash*=16777619;
+  }
+  return hash;
+}
+
+uint32_t ScriptVarHash(const char *name,uint32_t len) {
+  return ScriptHashAdd(2166136261,name,len);
+}
+
+void ScriptVarHashFree(void) {
+  if (glob_script_mem.var_hash) {
+    free(glob_script_mem.var_hash);
+    glob_script_mem.var_hash=0;
+  }
+}
+
+void ScriptVarHashInit(void) {
+  ScriptVarHashFree();
+  uint32_t size=16;
+  while (size<(glob_script_mem.numvars*2)) size<<=1;
+  glob_script_mem.var_hash=(uint8_t*)PsramCalloc(size,1);
+  if (!glob_script_mem.var_hash) return;      // fall back to linear search
+  glob_script_mem.var_hash_size=size;
+  for (uint32_t count=0; count<glob_script_mem.numvars; count++) {
+    char *cp=glob_script_mem.glob_vnp+glob_script_mem.vnp_offset[count];
+    uint32_t len=strlen(cp);
+    if (ScriptFindVar(cp,len)>=0) continue;   // first definition wins as with linear search
+    uint32_t bucket=ScriptVarHash(cp,len)&(size-1);
+    while (glob_script_mem.var_hash[bucket]) bucket=(bucket+1)&(size-1);
+    glob_script_mem.var_hash[bucket]=count+1;
+  }
+}
+
+int16_t ScriptFindVar(const char *name,uint32_t len) {
+  // returns index in glob_script_mem.type or -1 if not a variable
+  if (!glob_script_mem.var_hash) {
+    for (uint32_t count=0; count<glob_script_mem.numvars; count++) {
+      char *cp=glob_script_mem.glob_vnp+glob_script_mem.vnp_offset[count];
+      if (!strncmp(cp,name,len) && !cp[len]) return count;
+    }
+    return -1;
+  }
+  uint32_t mask=glob_script_mem.var_hash_size-1;
+  uint32_t bucket=ScriptVarHash(name,len)&mask;
+  while (glob_script_mem.var_hash[bucket]) {
+    uint32_t count=glob_script_mem.var_hash[bucket]-1;
+    char *cp=glob_script_mem.glob_vnp+glob_script_mem.vnp_offset[count];
+    if (!strncmp(cp,name,len) && !cp[len]) return count;
+    bucket=(bucket+1)&mask;
+  }
+  return -1;
+}
+
+/*********************************************************************************************\
+ * Section index
+ *
+ * Offsets of the lines starting with > or # so Run_Scripter() starts at the first matching label
+\*********************************************************************************************/
+
+#ifndef SCRIPT_MAXSECTIONS
+#define SCRIPT_MAXSECTIONS 32
+#endif
+
+struct {
+  uint16_t offset[SCRIPT_MAXSECTIONS];      // Offset of label from glob_script_mem.scriptptr_bu
+  uint8_t count;
+  uint8_t complete;                         // All labels are in the index
+} script_sections;
+
+void ScriptSectionsInit(void) {
+  script_sections.count=0;
+  script_sections.complete=1;
+  char *lp=glob_script_mem.scriptptr_bu;
+  if (!lp) return;
+  while (*lp) {
+    // same line start as in Run_Scripter()
+    SCRIPT_SKIP_SPACES
+    if (*lp=='>' || *lp=='#') {
+      if (script_sections.count>=SCRIPT_MAXSECTIONS) {
+        script_sections.complete=0;
+        break;
+      }
+      script_sections.offset[script_sections.count++]=lp-glob_script_mem.scriptptr_bu;
+    }
+    lp=strchr(lp,SCRIPT_EOL);
+    if (!lp) break;
+    lp++;
+  }
+}
+
+int8_t ScriptSectionFind(const char *type,uint8_t tlen,char **lpp) {
+  // returns 1 with label position, 0 if not in script or -1 if a full scan is needed
+  for (uint32_t count=0; count<script_sections.count; count++) {
+    char *lp=glob_script_mem.scriptptr_bu+script_sections.offset[count];
+    if (!strncmp(lp,type,tlen)) {
+      *lpp=lp;
+      return 1;
+    }
+  }
+  return (script_sections.complete) ? 0 : -1;
+}
+
 char *isvar(char *lp, uint8_t *vtype,struct T_INDEX *tind,float *fp,char *sp,JsonObject *jo) {
     uint16_t count,len=0;
     uint8_t nres=0;
@@ -1033,38 +1500,34 @@ char *isvar(char *lp, uint8_t *vtype,struct T_INDEX *tind,float *fp,char *sp,Jso
       ja++;
       olen=strlen(dvnam);
     }
-    for (count=0; count<glob_script_mem.numvars; count++) {
-        char *cp=glob_script_mem.glob_vnp+glob_script_mem.vnp_offset[count];
-        uint8_t slen=strlen(cp);
-        if (slen==olen && *cp==dvnam[0]) {
-            if (!strncmp(cp,dvnam,olen)) {
-                uint8_t index=vtp[count].index;
-                *tind=vtp[count];
-                tind->index=count; // overwrite with global var index
-                if (vtp[count].bits.is_string==0) {
-                    *vtype=NTYPE|index;
-                    if (vtp[count].bits.is_filter) {
-                      if (ja) {
-                        lp+=olen+1;
-                        lp=GetNumericResult(lp,OPER_EQU,&fvar,0);
-                        last_findex=fvar;
-                        fvar=Get_MFVal(index,fvar);
-                        len=1;
-                      } else {
-                        fvar=Get_MFilter(index);
-                      }
-                    } else {
-                      fvar=glob_script_mem.fvars[index];
-                    }
-                    if (nres) fvar=-fvar;
-                    if (fp) *fp=fvar;
-                } else {
-                    *vtype=STYPE|index;
-                    if (sp) strlcpy(sp,glob_script_mem.glob_snp+(index*glob_script_mem.max_ssize),SCRIPT_MAXSSIZE);
-                }
-                return lp+len;
+    int16_t vindex=ScriptFindVar(dvnam,olen);
+    if (vindex>=0) {
+        count=vindex;
+        uint8_t index=vtp[count].index;
+        *tind=vtp[count];
+        tind->index=count; // overwrite with global var index
+        if (vtp[count].bits.is_string==0) {
+            *vtype=NTYPE|index;
+            if (vtp[count].bits.is_filter) {
+              if (ja) {
+                lp+=olen+1;
+                lp=GetNumericResult(lp,OPER_EQU,&fvar,0);
+                last_findex=fvar;
+                fvar=Get_MFVal(index,fvar);
+                len=1;
+              } else {
+                fvar=Get_MFilter(index);
+              }
+            } else {
+              fvar=glob_script_mem.fvars[index];
             }
+            if (nres) fvar=-fvar;
+            if (fp) *fp=fvar;
+        } else {
+            *vtype=STYPE|index;
+            if (sp) strlcpy(sp,glob_script_mem.glob_snp+(index*glob_script_mem.max_ssize),SCRIPT_MAXSSIZE);
         }
+        return lp+len;
     }
 
     if (jo) {
@@ -1172,6 +1635,26 @@ char *isvar(char *lp, uint8_t *vtype,struct T_INDEX *tind,float *fp,char *sp,Jso
 chknext:
     switch (vname[0]) {
       case 'a':
+        if (vname[1]=='s' || vname[1]=='m' || vname[1]=='p') {
+          // whole array functions asum(a), amin(a), amax(a), amean(a), aperc(a p)
+          const char *afuncs[]={"asum(","amin(","amax(","amean(","aperc("};
+          for (uint8_t func=0; func<sizeof(afuncs)/sizeof(afuncs[0]); func++) {
+            uint8_t flen=strlen(afuncs[func]);
+            if (!strncmp(vname,afuncs[func],flen)) {
+              struct M_FILT *mflp;
+              lp=Script_GetArray(lp+flen,&mflp);
+              float arg=0;
+              if (func==4) {
+                SCRIPT_SKIP_SPACES
+                lp=GetNumericResult(lp,OPER_EQU,&arg,0);
+              }
+              fvar=Script_ArrayFunc(mflp,func,arg);
+              lp++;
+              len=0;
+              goto exit;
+            }
+          }
+        }
 #ifdef USE_ANGLE_FUNC
         if (!strncmp(vname,"acos(",5)) {
             lp+=5;
@@ -1242,7 +1725,8 @@ chknext:
           float fvar2;
           lp=GetNumericResult(lp,OPER_EQU,&fvar2,0);
           lp++;
-          fvar=scripter_create_task(fvar,fvar1,fvar2);
+          // A task can not replace itself while it holds the interpreter
+          fvar=(ScriptInTask()) ? 0 : scripter_create_task(fvar,fvar1,fvar2);
           len=0;
           goto exit;
         }
@@ -1383,8 +1867,7 @@ chknext:
 #ifdef DEBUG_FS
             AddLog_P2(LOG_LEVEL_INFO,PSTR("closing file %d"),ind);
 #endif
-            glob_script_mem.files[ind].close();
-            glob_script_mem.file_flags[ind].is_open=0;
+            if (glob_script_mem.file_flags[ind].is_open) ScriptFileClose(ind);
           }
           fvar=0;
           lp++;
@@ -1396,7 +1879,10 @@ chknext:
           lp=GetNumericResult(lp,OPER_EQU,&fvar,0);
           uint8_t ind=fvar;
           if (ind>=SFS_MAX) ind=SFS_MAX-1;
-          glob_script_mem.files[ind].flush();
+          if (glob_script_mem.file_flags[ind].is_open) {
+            ScriptFileFlush(ind);
+            glob_script_mem.files[ind].flush();
+          }
           fvar=0;
           lp++;
           len=0;
@@ -1411,7 +1897,7 @@ chknext:
           uint8_t ind=fvar;
           if (ind>=SFS_MAX) ind=SFS_MAX-1;
           if (glob_script_mem.file_flags[ind].is_open) {
-            fvar=glob_script_mem.files[ind].print(str);
+            fvar=ScriptFileWrite(ind,(uint8_t*)str,strlen(str));
           } else {
             fvar=0;
           }
@@ -1471,6 +1957,7 @@ chknext:
               }
               index=strlen(str);
             } else {
+              ScriptFileFlush(find);
               while (glob_script_mem.files[find].available()) {
                 uint8_t buf[1];
                 glob_script_mem.files[find].read(buf,1);
@@ -1493,10 +1980,25 @@ chknext:
           len=0;
           goto exit;
         }
+        if (!strncmp(vname,"fap(",4)) {
+          lp+=4;
+          char name[SCRIPT_MAXSSIZE];
+          lp=GetStringResult(lp,OPER_EQU,name,0);
+          SCRIPT_SKIP_SPACES
+          char str[SCRIPT_MAXSSIZE];
+          lp=ForceStringVar(lp,str);
+          fvar=ScriptFileLog(name,str);
+          lp++;
+          len=0;
+          goto exit;
+        }
         if (!strncmp(vname,"fd(",3)) {
           lp+=3;
           char str[glob_script_mem.max_ssize+1];
           lp=GetStringResult(lp,OPER_EQU,str,0);
+          if (glob_script_mem.file_flags[SFS_LOGGER].is_open && !strcmp(glob_script_mem.logname,str)) {
+            ScriptFileClose(SFS_LOGGER);
+          }
           fsp->remove(str);
           lp++;
           len=0;
@@ -1517,8 +2019,10 @@ chknext:
             if (fvar<1 || fvar>maxps) fvar=1;
             uint32_t len=WcGetPicstore(fvar-1, &buff);
             if (len) {
+              ScriptFileFlush(ind);
               //glob_script_mem.files[ind].seek(0,SeekEnd);
               fvar=glob_script_mem.files[ind].write(buff,len);
+              SCRIPT_FLASH_WEAR(len);
             } else {
               fvar=0;
             }
@@ -1541,11 +2045,11 @@ chknext:
           if (ef) {
             uint16_t fsiz=ef.size();
             if (fsiz<2048) {
-              char *script=(char*)calloc(fsiz+16,1);
+              char *script=(char*)HeapCalloc(HEAP_TAG_SCRIPT,fsiz+16,1);
               if (script) {
                 ef.read((uint8_t*)script,fsiz);
                 execute_script(script);
-                free(script);
+                HeapFree(script);
                 fvar=1;
               }
             }
@@ -2112,6 +2616,37 @@ chknext:
           if (sp) strlcpy(sp,SettingsText(SET_MQTT_TOPIC),glob_script_mem.max_ssize);
           goto strexit;
         }
+#if defined(ESP32) && defined(USE_SCRIPT_TASK)
+        if (!strncmp(vname,"tsnd(",5)) {
+          // send number to channel 0 main, 1 task 1 or 2 task 2, 1 if queued
+          lp+=5;
+          lp=GetNumericResult(lp,OPER_EQU,&fvar,0);
+          SCRIPT_SKIP_SPACES
+          float fvar1;
+          lp=GetNumericResult(lp,OPER_EQU,&fvar1,0);
+          lp++;
+          fvar=ScriptTaskSend(fvar,fvar1);
+          len=0;
+          goto exit;
+        }
+        if (!strncmp(vname,"trcv(",5)) {
+          // oldest number of channel or 0 if none
+          lp=GetNumericResult(lp+5,OPER_EQU,&fvar,0);
+          lp++;
+          fvar=ScriptTaskReceive(fvar);
+          len=0;
+          goto exit;
+        }
+        if (!strncmp(vname,"tcnt(",5)) {
+          // numbers waiting in channel
+          lp=GetNumericResult(lp+5,OPER_EQU,&fvar,0);
+          lp++;
+          uint8_t chan=fvar;
+          fvar=(chan<STASK_CHANNELS && script_tasks.chan[chan]) ? uxQueueMessagesWaiting(script_tasks.chan[chan]) : 0;
+          len=0;
+          goto exit;
+        }
+#endif  // ESP32 && USE_SCRIPT_TASK
 #ifdef USE_DISPLAY
 #ifdef USE_TOUCH_BUTTONS
         if (!strncmp(vname,"tbut[",5)) {
@@ -2215,6 +2750,12 @@ chknext:
               }
               break;
 #endif
+            case 8:
+              { float fvar2;
+                lp=GetNumericResult(lp,OPER_EQU,&fvar2,0);
+                fvar=WcSetMotionSensitivity(fvar2);
+              }
+              break;
             default:
               fvar=0;
           }
@@ -2468,12 +3009,219 @@ char *GetStringResult(char *lp,uint8_t lastop,char *cp,JsonObject *jo) {
   }
 }
 
+float ScriptOperate(float fvar,float fvar1,uint8_t lastop) {
+    switch (lastop) {
+        case OPER_EQU:
+            fvar=fvar1;
+            break;
+        case OPER_PLS:
+            fvar+=fvar1;
+            break;
+        case OPER_MIN:
+            fvar-=fvar1;
+            break;
+        case OPER_MUL:
+            fvar*=fvar1;
+            break;
+        case OPER_DIV:
+            fvar/=fvar1;
+            break;
+        case OPER_PERC:
+            fvar=fmodf(fvar,fvar1);
+            break;
+        case OPER_XOR:
+            fvar=(uint32_t)fvar^(uint32_t)fvar1;
+            break;
+        case OPER_AND:
+            fvar=(uint32_t)fvar&(uint32_t)fvar1;
+            break;
+        case OPER_OR:
+            fvar=(uint32_t)fvar|(uint32_t)fvar1;
+            break;
+        default:
+            break;
+    }
+    return fvar;
+}
+
+#ifdef USE_SCRIPT_COMPILE
+/*********************************************************************************************\
+ * Numeric expression compiler
+ *
+ * Numeric expressions in the script text consisting of constants, numeric variables, operators
+ * and brackets are compiled on first execution into bytecode with resolved variable slots and
+ * run by a small stack machine. Expressions using strings, functions, arrays, filters or json
+ * values are marked as not compilable and stay with the text interpreter.
+\*********************************************************************************************/
+
+void ScriptCodeFree(void) {
+  if (script_code.slot) {
+    HeapFree(script_code.slot);
+    script_code.slot=0;
+  }
+}
+
+void ScriptCodeInit(void) {
+  ScriptCodeFree();
+  if (glob_script_mem.script_size>=SCRIPT_CODE_NONE) return;
+  script_code.slot=(struct SCRIPT_CODE_SLOT*)HeapCalloc(HEAP_TAG_SCRIPT,1,SCRIPT_CODE_SLOTS*sizeof(struct SCRIPT_CODE_SLOT)+SCRIPT_CODE_SIZE);
+  if (!script_code.slot) return;
+  script_code.pool=(uint8_t*)&script_code.slot[SCRIPT_CODE_SLOTS];
+  script_code.pool_used=0;
+}
+
+bool ScriptCodeEmit(const void *data,uint32_t len) {
+  if (script_code.pool_used+len>SCRIPT_CODE_SIZE) return false;
+  memcpy(&script_code.pool[script_code.pool_used],data,len);
+  script_code.pool_used+=len;
+  return true;
+}
+
+char *ScriptCodeOperand(char *lp) {
+  // same scan as isvar() for numbers and plain numeric variables only
+  uint8_t code[2];
+  if (isdigit(*lp) || (*lp=='-' && isdigit(*(lp+1))) || *lp=='.') {
+    if (*lp=='0' && *(lp+1)=='x') return 0;
+    float fvar=CharToFloat(lp);
+    code[0]=SC_NUM;
+    if (!ScriptCodeEmit(code,1) || !ScriptCodeEmit(&fvar,sizeof(fvar))) return 0;
+    if (*lp=='-') lp++;
+    while (isdigit(*lp) || *lp=='.') lp++;
+    return lp;
+  }
+  code[0]=SC_VAR;
+  if (*lp=='-') {
+    code[0]=SC_NVAR;
+    lp++;
+  }
+  const char *term="\n\r ])=+-/*%><!^&|}";
+  uint8_t len=0;
+  while (lp[len] && !strchr(term,lp[len])) {
+    if (lp[len]=='[' || len>=31) return 0;
+    len++;
+  }
+  if (!len) return 0;
+  int16_t vindex=ScriptFindVar(lp,len);
+  if (vindex<0) return 0;
+  struct T_INDEX *vtp=&glob_script_mem.type[vindex];
+  if (vtp->bits.is_string || vtp->bits.is_filter) return 0;
+  code[1]=vtp->index;
+  if (!ScriptCodeEmit(code,2)) return 0;
+  return lp+len;
+}
+
+char *ScriptCodeCompile(char *lp,uint32_t depth) {
+  // same walk as GetNumericResult(), returns end of expression or 0 if not compilable
+  uint8_t operand=0;
+  uint8_t lastop=0;
+  uint8_t code[2];
+  char *slp;
+  if (depth>=SCRIPT_CODE_STACK/2) return 0;
+  while (1) {
+    if (*lp=='(') {
+      lp++;
+      lp=ScriptCodeCompile(lp,depth+1);
+      if (!lp) return 0;
+      lp++;
+    } else {
+      lp=ScriptCodeOperand(lp);
+      if (!lp) return 0;
+    }
+    if (lastop) {
+      // first operand is pushed as is
+      code[0]=SC_OPER;
+      code[1]=lastop;
+      if (!ScriptCodeEmit(code,2)) return 0;
+    }
+    slp=lp;
+    lp=getop(lp,&operand);
+    switch (operand) {
+      case OPER_EQUEQU:
+      case OPER_NOTEQU:
+      case OPER_LOW:
+      case OPER_LOWEQU:
+      case OPER_GRT:
+      case OPER_GRTEQU:
+        return slp;
+      default:
+        break;
+    }
+    lastop=operand;
+    if (!operand) return lp;
+  }
+}
+
+float ScriptCodeExecute(uint8_t *code) {
+  float stack[SCRIPT_CODE_STACK];
+  uint32_t sp=0;
+  while (1) {
+    switch (*code++) {
+      case SC_NUM:
+        memcpy(&stack[sp++],code,sizeof(float));
+        code+=sizeof(float);
+        break;
+      case SC_VAR:
+        stack[sp++]=glob_script_mem.fvars[*code++];
+        break;
+      case SC_NVAR:
+        stack[sp++]=-glob_script_mem.fvars[*code++];
+        break;
+      case SC_OPER:
+        sp--;
+        stack[sp-1]=ScriptOperate(stack[sp-1],stack[sp],*code++);
+        break;
+      default:
+        return stack[0];
+    }
+  }
+}
+
+char *ScriptCodeRun(char *lp,float *fp) {
+  // returns end of expression if executed from bytecode, 0 to use text interpreter
+  if (!script_code.slot) return 0;
+  if ((lp<glob_script_mem.script_ram) || (lp>=glob_script_mem.script_ram+glob_script_mem.script_size)) return 0;
+  uint16_t expr=lp-glob_script_mem.script_ram+1;
+  struct SCRIPT_CODE_SLOT *slot=0;
+  uint32_t index=expr%SCRIPT_CODE_SLOTS;
+  for (uint32_t count=0; count<SCRIPT_CODE_SLOTS; count++) {
+    slot=&script_code.slot[index];
+    if (!slot->expr || slot->expr==expr) break;
+    index=(index+1)%SCRIPT_CODE_SLOTS;
+    slot=0;
+  }
+  if (!slot) return 0;
+  if (!slot->expr) {
+    // compile on first use
+    uint16_t start=script_code.pool_used;
+    char *end=ScriptCodeCompile(lp,0);
+    uint8_t code=SC_END;
+    if (end && ScriptCodeEmit(&code,1)) {
+      slot->code=start;
+      slot->end=end-glob_script_mem.script_ram;
+    } else {
+      script_code.pool_used=start;
+      slot->code=SCRIPT_CODE_NONE;
+    }
+    slot->expr=expr;
+  }
+  if (slot->code==SCRIPT_CODE_NONE) return 0;
+  *fp=ScriptCodeExecute(&script_code.pool[slot->code]);
+  return glob_script_mem.script_ram+slot->end;
+}
+#endif  // USE_SCRIPT_COMPILE
+
 char *GetNumericResult(char *lp,uint8_t lastop,float *fp,JsonObject *jo) {
 uint8_t operand=0;
-float fvar1,fvar;
+float fvar1,fvar=0;
 char *slp;
 uint8_t vtype;
 struct T_INDEX ind;
+#ifdef USE_SCRIPT_COMPILE
+    if (lastop==OPER_EQU) {
+      slp=ScriptCodeRun(lp,fp);
+      if (slp) return slp;
+    }
+#endif
     while (1) {
         // get 1. value
         if (*lp=='(') {
@@ -2488,38 +3236,7 @@ struct T_INDEX ind;
               glob_script_mem.glob_error=1;
             }
         }
-        switch (lastop) {
-            case OPER_EQU:
-                fvar=fvar1;
-                break;
-            case OPER_PLS:
-                fvar+=fvar1;
-                break;
-            case OPER_MIN:
-                fvar-=fvar1;
-                break;
-            case OPER_MUL:
-                fvar*=fvar1;
-                break;
-            case OPER_DIV:
-                fvar/=fvar1;
-                break;
-            case OPER_PERC:
-                fvar=fmodf(fvar,fvar1);
-                break;
-            case OPER_XOR:
-                fvar=(uint32_t)fvar^(uint32_t)fvar1;
-                break;
-            case OPER_AND:
-                fvar=(uint32_t)fvar&(uint32_t)fvar1;
-                break;
-            case OPER_OR:
-                fvar=(uint32_t)fvar|(uint32_t)fvar1;
-                break;
-            default:
-                break;
-
-        }
+        fvar=ScriptOperate(fvar,fvar1,lastop);
         slp=lp;
         lp=getop(lp,&operand);
         switch (operand) {
@@ -2829,7 +3546,40 @@ void esp32_beep(int32_t freq ,uint32_t len) {
 
 #define IF_NEST 8
 // execute section of scripter
+void ScriptExecuteCommand(char *cmd, uint8_t sflag) {
+  uint8_t svmqtt,swll;
+  if (!sflag) {
+    tasm_cmd_activ=1;
+    AddLog_P2(glob_script_mem.script_loglevel&0x7f, PSTR("Script: performs \"%s\""), cmd);
+  } else if (sflag==2) {
+    // allow recursive call
+  } else {
+    tasm_cmd_activ=1;
+    svmqtt=Settings.flag.mqtt_enabled;  // SetOption3 - Enable MQTT
+    swll=Settings.weblog_level;
+    Settings.flag.mqtt_enabled=0;       // SetOption3 - Enable MQTT
+    Settings.weblog_level=0;
+  }
+  ExecuteCommand(cmd, SRC_RULE);
+  tasm_cmd_activ=0;
+  if (sflag==1) {
+    Settings.flag.mqtt_enabled=svmqtt;  // SetOption3  - Enable MQTT
+    Settings.weblog_level=swll;
+  }
+}
+
 int16_t Run_Scripter(const char *type, int8_t tlen, char *js) {
+#if defined(ESP32) && defined(USE_SCRIPT_TASK)
+  ScriptTaskLock();
+  int16_t result=Run_Scripter_Unlocked(type,tlen,js);
+  ScriptTaskUnlock();
+  return result;
+#else
+  return Run_Scripter_Unlocked(type,tlen,js);
+#endif
+}
+
+int16_t Run_Scripter_Unlocked(const char *type, int8_t tlen, char *js) {
 
     if (tasm_cmd_activ && tlen>0) return 0;
 
@@ -2858,7 +3608,7 @@ int16_t Run_Scripter(const char *type, int8_t tlen, char *js) {
     }
 
     JsonObject  *jo=0;
-    DynamicJsonBuffer jsonBuffer; // on heap
+    JsonParseBuffer jsonBuffer; // on heap
     JsonObject &jobj=jsonBuffer.parseObject(js);
     if (js) {
       jo=&jobj;
@@ -2867,6 +3617,11 @@ int16_t Run_Scripter(const char *type, int8_t tlen, char *js) {
     }
 
     char *lp=glob_script_mem.scriptptr;
+    if ((tlen>1) && (lp==glob_script_mem.scriptptr_bu)) {
+      // main script, skip to the first line with this label
+      int8_t found=ScriptSectionFind(type,tlen,&lp);
+      if (!found) return -1;
+    }
 
     while (1) {
         // check line
@@ -3140,6 +3895,61 @@ int16_t Run_Scripter(const char *type, int8_t tlen, char *js) {
               // save vars
               Scripter_save_pvars();
               goto next_line;
+            } else if (!strncmp(lp,"ascale(",7)) {
+              // ascale(a mul add) scale and offset all array values
+              struct M_FILT *mflp;
+              lp=Script_GetArray(lp+7,&mflp);
+              SCRIPT_SKIP_SPACES
+              lp=GetNumericResult(lp,OPER_EQU,&fvar,0);
+              SCRIPT_SKIP_SPACES
+              float fvar1;
+              lp=GetNumericResult(lp,OPER_EQU,&fvar1,0);
+              if (mflp) {
+                uint8_t len=mflp->numvals&0x7f;
+                for (uint8_t count=0; count<len; count++) mflp->rbuff[count]=mflp->rbuff[count]*fvar+fvar1;
+                Script_FilterChanged(mflp);
+              }
+              goto next_line;
+            } else if (!strncmp(lp,"acopy(",6)) {
+              // acopy(dst src pos) copy src from position pos on into dst
+              struct M_FILT *dst,*src;
+              lp=Script_GetArray(lp+6,&dst);
+              lp=Script_GetArray(lp,&src);
+              SCRIPT_SKIP_SPACES
+              fvar=1;
+              if (*lp!=')') lp=GetNumericResult(lp,OPER_EQU,&fvar,0);
+              if (dst && src) {
+                uint8_t slen=src->numvals&0x7f;
+                uint8_t pos=(fvar<1) ? 0 : fvar-1;
+                uint8_t num=(pos<slen) ? slen-pos : 0;
+                if (num>(dst->numvals&0x7f)) num=dst->numvals&0x7f;
+                memmove(dst->rbuff,&src->rbuff[pos],num*sizeof(float));
+                Script_FilterChanged(dst);
+              }
+              goto next_line;
+            } else if (!strncmp(lp,"amavg(",6)) {
+              // amavg(dst src n) moving average of src over n values into dst
+              struct M_FILT *dst,*src;
+              lp=Script_GetArray(lp+6,&dst);
+              lp=Script_GetArray(lp,&src);
+              SCRIPT_SKIP_SPACES
+              lp=GetNumericResult(lp,OPER_EQU,&fvar,0);
+              if (dst && src) {
+                uint8_t slen=src->numvals&0x7f;
+                uint8_t num=dst->numvals&0x7f;
+                if (num>slen) num=slen;
+                uint8_t window=(fvar<1) ? 1 : ((fvar>slen) ? slen : fvar);
+                float in[slen];
+                memcpy(in,src->rbuff,slen*sizeof(float));
+                float accu=0;
+                for (uint8_t count=0; count<num; count++) {
+                  accu+=in[count];
+                  if (count>=window) accu-=in[count-window];
+                  dst->rbuff[count]=accu/((count<window) ? count+1 : window);
+                }
+                Script_FilterChanged(dst);
+              }
+              goto next_line;
             }
 #ifdef USE_LIGHT
 #ifdef USE_WS2812
@@ -3184,7 +3994,7 @@ int16_t Run_Scripter(const char *type, int8_t tlen, char *js) {
 
             else if (!strncmp(lp,"=>",2) || !strncmp(lp,"->",2) || !strncmp(lp,"+>",2) || !strncmp(lp,"print",5)) {
                 // execute cmd
-                uint8_t sflag=0,pflg=0,svmqtt,swll;
+                uint8_t sflag=0,pflg=0;
                 if (*lp=='p') {
                  pflg=1;
                  lp+=5;
@@ -3197,7 +4007,7 @@ int16_t Run_Scripter(const char *type, int8_t tlen, char *js) {
                 char *slp=lp;
                 SCRIPT_SKIP_SPACES
                 #define SCRIPT_CMDMEM 512
-                char *cmdmem=(char*)malloc(SCRIPT_CMDMEM);
+                char *cmdmem=(char*)HeapMalloc(HEAP_TAG_SCRIPT,SCRIPT_CMDMEM);
                 if (cmdmem) {
                   char *cmd=cmdmem;
                   uint16_t count;
@@ -3219,26 +4029,14 @@ int16_t Run_Scripter(const char *type, int8_t tlen, char *js) {
                     if (pflg) toLog(tmp);
                     else toLog(&tmp[5]);
                   } else {
-                    if (!sflag) {
-                      tasm_cmd_activ=1;
-                      AddLog_P2(glob_script_mem.script_loglevel&0x7f, PSTR("Script: performs \"%s\""), tmp);
-                    } else if (sflag==2) {
-                      // allow recursive call
-                    } else {
-                      tasm_cmd_activ=1;
-                      svmqtt=Settings.flag.mqtt_enabled;  // SetOption3 - Enable MQTT
-                      swll=Settings.weblog_level;
-                      Settings.flag.mqtt_enabled=0;       // SetOption3 - Enable MQTT
-                      Settings.weblog_level=0;
-                    }
-                    ExecuteCommand((char*)tmp, SRC_RULE);
-                    tasm_cmd_activ=0;
-                    if (sflag==1) {
-                      Settings.flag.mqtt_enabled=svmqtt;  // SetOption3  - Enable MQTT
-                      Settings.weblog_level=swll;
-                    }
+#if defined(ESP32) && defined(USE_SCRIPT_TASK)
+                    if (ScriptInTask()) {
+                      ScriptTaskCommand(tmp,sflag);
+                    } else
+#endif
+                    ScriptExecuteCommand(tmp,sflag);
                   }
-                  if (cmdmem) free(cmdmem);
+                  if (cmdmem) HeapFree(cmdmem);
                 }
                 lp=slp;
                 goto next_line;
@@ -3508,14 +4306,14 @@ uint8_t script_xsns_index = 0;
 void ScripterEvery100ms(void) {
 
   if (Settings.rule_enabled && (uptime > 4)) {
-    mqtt_data[0] = '\0';
+    ResponseClear();
     uint16_t script_tele_period_save = tele_period;
     tele_period = 2;
     XsnsNextCall(FUNC_JSON_APPEND, script_xsns_index);
     tele_period = script_tele_period_save;
     if (strlen(mqtt_data)) {
       mqtt_data[0] = '{';
-      snprintf_P(mqtt_data, sizeof(mqtt_data), PSTR("%s}"), mqtt_data);
+      ResponseJsonEnd();
       Run_Scripter(">T",2, mqtt_data);
     }
   }
@@ -3872,7 +4670,10 @@ void script_upload(void) {
     upload_file=fsp->open(npath,FILE_WRITE);
     if (!upload_file) Web.upload_error=1;
   } else if(upload.status == UPLOAD_FILE_WRITE) {
-    if (upload_file) upload_file.write(upload.buf,upload.currentSize);
+    if (upload_file) {
+      upload_file.write(upload.buf,upload.currentSize);
+      SCRIPT_FLASH_WEAR(upload.currentSize);
+    }
   } else if(upload.status == UPLOAD_FILE_END) {
     if (upload_file) upload_file.close();
     if (Web.upload_error) {
@@ -3991,6 +4792,7 @@ void HandleScriptConfiguration(void) {
 
     // script is to larg for WSContentSend_P
     if (glob_script_mem.script_ram[0]) {
+      WSContentFlush();
       _WSContentSend(glob_script_mem.script_ram);
     }
     WSContentSend_P(HTTP_FORM_SCRIPT1b);
@@ -4077,6 +4879,7 @@ void ScriptSaveSettings(void) {
       File file=fsp->open(FAT_SCRIPT_NAME,FILE_WRITE);
       file.write((const uint8_t*)glob_script_mem.script_ram,FAT_SCRIPT_SIZE);
       file.close();
+      SCRIPT_FLASH_WEAR(FAT_SCRIPT_SIZE);
     }
 #endif
 
@@ -4089,10 +4892,14 @@ void ScriptSaveSettings(void) {
 
   if (glob_script_mem.script_mem) {
     Scripter_save_pvars();
-    free(glob_script_mem.script_mem);
+    HeapFree(glob_script_mem.script_mem);
     glob_script_mem.script_mem=0;
     glob_script_mem.script_mem_size=0;
   }
+  ScriptVarHashFree();
+#ifdef USE_SCRIPT_COMPILE
+  ScriptCodeFree();
+#endif
 
 #ifdef USE_SCRIPT_COMPRESSION
 #ifndef USE_24C256
@@ -4114,7 +4921,13 @@ void ScriptSaveSettings(void) {
 #endif // USE_SCRIPT_COMPRESSION
 
   if (bitRead(Settings.rule_enabled, 0)) {
+#if defined(ESP32) && defined(USE_SCRIPT_TASK)
+    ScriptTaskLock();               // Tasks must not run while variables are reallocated
     int16_t res=Init_Scripter();
+    ScriptTaskUnlock();
+#else
+    int16_t res=Init_Scripter();
+#endif
     if (res) {
       AddLog_P2(LOG_LEVEL_INFO, PSTR("script init error: %d"), res);
       return;
@@ -4489,7 +5302,7 @@ void Script_Handle_Hue(String *path) {
   if (Webserver->args()) {
     response = "[";
 
-    StaticJsonBuffer<400> jsonBuffer;
+    JsonTempBuffer<400> jsonBuffer;
     JsonObject &hue_json = jsonBuffer.parseObject(Webserver->arg((Webserver->args())-1));
     if (hue_json.containsKey("on")) {
 
@@ -4685,7 +5498,7 @@ bool ScriptCommand(void) {
     } else {
       if ('>' == XdrvMailbox.data[0]) {
         // execute script
-        snprintf_P (mqtt_data, sizeof(mqtt_data), PSTR("{\"%s\":\"%s\"}"),command,XdrvMailbox.data);
+        Response_P(PSTR("{\"%s\":\"%s\"}"),command,XdrvMailbox.data);
         if (bitRead(Settings.rule_enabled, 0)) {
           for (uint8_t count=0; count<XdrvMailbox.data_len; count++) {
             if (XdrvMailbox.data[count]==';') XdrvMailbox.data[count]='\n';
@@ -4695,7 +5508,7 @@ bool ScriptCommand(void) {
       }
       return serviced;
     }
-    snprintf_P (mqtt_data, sizeof(mqtt_data), PSTR("{\"%s\":\"%s\",\"Free\":%d}"),command, GetStateText(bitRead(Settings.rule_enabled,0)),glob_script_mem.script_size-strlen(glob_script_mem.script_ram));
+    Response_P(PSTR("{\"%s\":\"%s\",\"Free\":%d}"),command, GetStateText(bitRead(Settings.rule_enabled,0)),glob_script_mem.script_size-strlen(glob_script_mem.script_ram));
 #ifdef SUPPORT_MQTT_EVENT
   } else if (CMND_SUBSCRIBE == command_code) {			//MQTT Subscribe command. Subscribe <Event>, <Topic> [, <Key>]
       String result = ScriptSubscribe(XdrvMailbox.data, XdrvMailbox.data_len);
@@ -4756,49 +5569,51 @@ bool ScriptMqttData(void)
   if (XdrvMailbox.data_len < 1 || XdrvMailbox.data_len > MQTT_EVENT_MSIZE) {
     return false;
   }
-  String sTopic = XdrvMailbox.topic;
-  String sData = XdrvMailbox.data;
+  if (!subscriptions.size()) {
+    return false;
+  }
   //AddLog_P2(LOG_LEVEL_DEBUG, PSTR("Script: MQTT Topic %s, Event %s"), XdrvMailbox.topic, XdrvMailbox.data);
   MQTT_Subscription event_item;
   //Looking for matched topic
   for (uint32_t index = 0; index < subscriptions.size(); index++) {
     event_item = subscriptions.get(index);
 
-    //AddLog_P2(LOG_LEVEL_DEBUG, PSTR("Script: Match MQTT message Topic %s with subscription topic %s"), sTopic.c_str(), event_item.Topic.c_str());
-    if (sTopic.startsWith(event_item.Topic)) {
+    //AddLog_P2(LOG_LEVEL_DEBUG, PSTR("Script: Match MQTT message Topic %s with subscription topic %s"), XdrvMailbox.topic, event_item.Topic.c_str());
+    if (!strncmp(XdrvMailbox.topic, event_item.Topic.c_str(), event_item.Topic.length())) {
       //This topic is subscribed by us, so serve it
       serviced = true;
-      String value;
-      String lkey;
-      if (event_item.Key.length() == 0) {   //If did not specify Key
-        value = sData;
-      } else {      //If specified Key, need to parse Key/Value from JSON data
-        StaticJsonBuffer<MQTT_EVENT_JSIZE> jsonBuf;
-        JsonObject& jsonData = jsonBuf.parseObject(sData);
-        String key1 = event_item.Key;
-        String key2;
+      char data[XdrvMailbox.data_len +1];   // Only matched messages are copied as JsonObject and Trim modify data
+      memcpy(data, XdrvMailbox.data, sizeof(data));
+      char *value = data;
+      const char *lkey = "";
+      if (event_item.Key.length() > 0) {    //If specified Key, need to parse Key/Value from JSON data
+        JsonTempBuffer<MQTT_EVENT_JSIZE> jsonBuf;
+        JsonObject& jsonData = jsonBuf.parseObject(data);
         if (!jsonData.success()) break;       //Failed to parse JSON data, ignore this message.
-        int dot;
-        if ((dot = key1.indexOf('.')) > 0) {
-          key2 = key1.substring(dot+1);
-          key1 = key1.substring(0, dot);
-          lkey=key2;
-          if (!jsonData[key1][key2].success()) break;   //Failed to get the key/value, ignore this message.
-          value = (const char *)jsonData[key1][key2];
+        const char *key1 = event_item.Key.c_str();
+        const char *key2 = strchr(key1, '.');
+        if (key2 > key1) {
+          char key[key2 - key1 +1];
+          strlcpy(key, key1, sizeof(key));
+          key2++;
+          lkey = key2;
+          if (!jsonData[key][key2].success()) break;   //Failed to get the key/value, ignore this message.
+          value = (char *)jsonData[key][key2].as<const char*>();
         } else {
           if (!jsonData[key1].success()) break;
-          value = (const char *)jsonData[key1];
-          lkey=key1;
+          value = (char *)jsonData[key1].as<const char*>();
+          lkey = key1;
         }
+        if (!value) { value = data + XdrvMailbox.data_len; }  // Empty string
       }
-      value.trim();
+      value = Trim(value);
       char sbuffer[128];
 
-      if (!strncmp(lkey.c_str(),"Epoch",5)) {
-        uint32_t ep=atoi(value.c_str())-(uint32_t)EPOCH_OFFSET;
+      if (!strncmp(lkey,"Epoch",5)) {
+        uint32_t ep=atoi(value)-(uint32_t)EPOCH_OFFSET;
         snprintf_P(sbuffer, sizeof(sbuffer), PSTR(">%s=%d\n"), event_item.Event.c_str(),ep);
       } else {
-        snprintf_P(sbuffer, sizeof(sbuffer), PSTR(">%s=\"%s\"\n"), event_item.Event.c_str(), value.c_str());
+        snprintf_P(sbuffer, sizeof(sbuffer), PSTR(">%s=\"%s\"\n"), event_item.Event.c_str(), value);
       }
       //toLog(sbuffer);
       execute_script(sbuffer);
@@ -4957,6 +5772,9 @@ void Script_Check_HTML_Setvars(void) {
 
     struct T_INDEX ind;
     uint8_t vtype;
+#if defined(ESP32) && defined(USE_SCRIPT_TASK)
+    ScriptTaskLock();
+#endif
     isvar(vname,&vtype,&ind,0,0,0);
     if (vtype!=NUM_RES && vtype&STYPE) {
       // string type must insert quotes
@@ -4969,6 +5787,9 @@ void Script_Check_HTML_Setvars(void) {
     //toLog(cmdbuf);
     execute_script(cmdbuf);
     Run_Scripter(">E",2,0);
+#if defined(ESP32) && defined(USE_SCRIPT_TASK)
+    ScriptTaskUnlock();
+#endif
   }
 }
 
@@ -5114,6 +5935,74 @@ uint8 entries=0;
   return lp;
 }
 
+/*********************************************************************************************\
+ * The data rows of a chart only depend on the label string and the array values so the rows
+ * formatted for the previous page are sent again as long as the hash of these is unchanged
+\*********************************************************************************************/
+
+#ifndef SCRIPT_GC_CACHE
+#define SCRIPT_GC_CACHE 4           // Charts per page with cached data rows
+#endif
+
+struct {
+  String rows[SCRIPT_GC_CACHE];
+  uint32_t hash[SCRIPT_GC_CACHE];
+} gc_cache;
+
+void gc_format_rows(String &rows, const char *label, float **arrays, uint8_t anum, uint8_t entries) {
+  int8_t todflg=-1;
+  if (!strncmp(label,"cnt",3)) {
+    todflg=atoi(&label[3]);
+  }
+  rows.reserve(entries*(anum*8+8));
+  for (uint32_t cnt=0; cnt<entries; cnt++) {
+    char lbl[16];
+    if (todflg>=0) {
+      sprintf(lbl,"%d",todflg);
+      todflg++;
+    } else {
+      GetTextIndexed(lbl, sizeof(lbl), cnt, label);
+    }
+    rows+="['";
+    rows+=lbl;
+    rows+="',";
+    for (uint32_t ind=0; ind<anum; ind++) {
+      char acbuff[32];
+      float *fp=arrays[ind];
+      dtostrfd(fp[cnt],glob_script_mem.script_dprec,acbuff);
+      rows+=acbuff;
+      if (ind<anum-1) { rows+=","; }
+    }
+    rows+="]";
+    if (cnt<entries-1) { rows+=","; }
+  }
+  if (D_DECIMAL_SEPARATOR[0] != '.') {
+    rows.replace('.', D_DECIMAL_SEPARATOR[0]);
+  }
+}
+
+void gc_send_rows(uint8_t chart, const char *label, float **arrays, uint8_t anum, uint8_t entries) {
+  uint32_t hash=ScriptVarHash(label,strlen(label));
+  hash=ScriptHashAdd(hash,&glob_script_mem.script_dprec,1);
+  hash=ScriptHashAdd(hash,&anum,1);
+  hash=ScriptHashAdd(hash,&entries,1);
+  for (uint32_t ind=0; ind<anum; ind++) {
+    hash=ScriptHashAdd(hash,arrays[ind],entries*sizeof(float));
+  }
+  if (chart>=SCRIPT_GC_CACHE) {
+    String rows;
+    gc_format_rows(rows,label,arrays,anum,entries);
+    _WSContentSendRaw(rows.c_str(),rows.length());
+    return;
+  }
+  if (!gc_cache.rows[chart].length() || (gc_cache.hash[chart]!=hash)) {
+    gc_cache.rows[chart]="";
+    gc_format_rows(gc_cache.rows[chart],label,arrays,anum,entries);
+    gc_cache.hash[chart]=hash;
+  }
+  _WSContentSendRaw(gc_cache.rows[chart].c_str(),gc_cache.rows[chart].length());
+}
+
 char *gc_send_labels(char *lp,uint32_t anum) {
   WSContentSend_PD("[");
   for (uint32_t cnt=0; cnt<anum+1; cnt++) {
@@ -5453,32 +6342,7 @@ void ScriptWebShow(char mc) {
                 lp=GetStringResult(lp,OPER_EQU,label,0);
                 SCRIPT_SKIP_SPACES
 
-                int8_t todflg=-1;
-                if (!strncmp(label,"cnt",3)) {
-                  todflg=atoi(&label[3]);
-                }
-
-                for (uint32_t cnt=0; cnt<entries; cnt++) {
-                  WSContentSend_PD("['");
-                  char lbl[16];
-                  if (todflg>=0) {
-                    sprintf(lbl,"%d",todflg);
-                    todflg++;
-                  } else {
-                    GetTextIndexed(lbl, sizeof(lbl), cnt, label);
-                  }
-                  WSContentSend_PD(lbl);
-                  WSContentSend_PD("',");
-                  for (uint32_t ind=0; ind<anum; ind++) {
-                    char acbuff[32];
-                    float *fp=arrays[ind];
-                    dtostrfd(fp[cnt],glob_script_mem.script_dprec,acbuff);
-                    WSContentSend_PD("%s",acbuff);
-                    if (ind<anum-1) { WSContentSend_PD(","); }
-                  }
-                  WSContentSend_PD("]");
-                  if (cnt<entries-1) { WSContentSend_PD(","); }
-                }
+                gc_send_rows(chartindex-1,label,arrays,anum,entries);
 
                 // get header
                 char header[SCRIPT_MAXSSIZE];
@@ -5629,6 +6493,82 @@ bool RulesProcessEvent(char *json_event) {
 #define STASK_PRIO 1
 #endif
 
+/*********************************************************************************************\
+ * Sections >t1 and >t2 run on tasks started by ct(num time core) while the main loop keeps
+ * running. The interpreter keeps its parse state in globals so one section runs at a time:
+ * the main loop and the tasks hold a recursive mutex while running the interpreter. Numeric
+ * and string variables, arrays and filters are therefore never seen half updated.
+ * Commands of task sections are queued and executed by the main loop.
+ *
+ * tsnd(chan val) - queue number to channel 0 (main script), 1 (task 1) or 2 (task 2), 1 if queued
+ * trcv(chan)     - oldest number of channel or 0 if none
+ * tcnt(chan)     - numbers waiting in channel
+\*********************************************************************************************/
+
+void ScriptTaskLock(void) {
+  if (!script_tasks.mutex) {
+    script_tasks.mutex=xSemaphoreCreateRecursiveMutex();
+  }
+  xSemaphoreTakeRecursive(script_tasks.mutex, portMAX_DELAY);
+}
+
+void ScriptTaskUnlock(void) {
+  xSemaphoreGiveRecursive(script_tasks.mutex);
+}
+
+bool ScriptTaskInit(void) {
+  if (script_tasks.cmds) return true;
+  for (uint32_t i=0; i<STASK_CHANNELS; i++) {
+    script_tasks.chan[i]=xQueueCreate(STASK_QUEUE,sizeof(float));
+    if (!script_tasks.chan[i]) return false;
+  }
+  script_tasks.cmds=xQueueCreate(STASK_QUEUE,sizeof(char*));
+  return (script_tasks.cmds!=nullptr);
+}
+
+uint32_t ScriptTaskSend(uint32_t chan, float val) {
+  if (chan>=STASK_CHANNELS || !script_tasks.chan[chan]) return 0;
+  if (pdTRUE!=xQueueSend(script_tasks.chan[chan],&val,0)) {
+    script_tasks.drops++;
+    return 0;
+  }
+  return 1;
+}
+
+float ScriptTaskReceive(uint32_t chan) {
+  float val=0;
+  if (chan<STASK_CHANNELS && script_tasks.chan[chan]) {
+    xQueueReceive(script_tasks.chan[chan],&val,0);
+  }
+  return val;
+}
+
+void ScriptTaskCommand(const char *cmd, uint8_t sflag) {
+  // First byte holds sflag of =>, -> or +>
+  uint32_t len=strlen(cmd);
+  char *entry=(char*)malloc(len+2);
+  if (entry) {
+    entry[0]=sflag;
+    memcpy(entry+1,cmd,len+1);
+    if (pdTRUE==xQueueSend(script_tasks.cmds,&entry,0)) return;
+    free(entry);
+  }
+  script_tasks.drops++;
+}
+
+void ScriptTaskLoop(void) {
+  char *entry;
+  if (!script_tasks.cmds) return;
+  while (pdTRUE==xQueueReceive(script_tasks.cmds,&entry,0)) {
+    ScriptExecuteCommand(entry+1,entry[0]);
+    free(entry);
+  }
+  if (script_tasks.drops) {
+    AddLog_P2(LOG_LEVEL_INFO, PSTR("Script: %d task messages lost"), script_tasks.drops);
+    script_tasks.drops=0;
+  }
+}
+
 #if 1
 
 struct ESP32_Task {
@@ -5636,6 +6576,10 @@ struct ESP32_Task {
   TaskHandle_t task_t;
 } esp32_tasks[2];
 
+bool ScriptInTask(void) {
+  TaskHandle_t task=xTaskGetCurrentTaskHandle();
+  return (task==esp32_tasks[0].task_t || task==esp32_tasks[1].task_t);
+}
 
 void script_task1(void *arg) {
   //uint32_t lastms=millis();
@@ -5647,7 +6591,7 @@ void script_task1(void *arg) {
     //if (time<esp32_tasks[1].task_timer) {delay(time); }
     //if (time<=esp32_tasks[0].task_timer) {vTaskDelay( pdMS_TO_TICKS( time ) ); }
     delay(esp32_tasks[0].task_timer);
-    Run_Scripter(">t1",3,0);
+    Run_Scripter(">t1",3,0);        // Locks the interpreter
   }
 }
 
@@ -5668,6 +6612,8 @@ uint32_t scripter_create_task(uint32_t num, uint32_t time, uint32_t core) {
   //return 0;
   BaseType_t res = 0;
   if (core > 1) { core = 1; }
+  if (!ScriptTaskInit()) { return 0; }
+  // Called holding the interpreter so the deleted task is waiting for it or in delay()
   if (num == 1) {
     if (esp32_tasks[0].task_t) { vTaskDelete(esp32_tasks[0].task_t); }
     res = xTaskCreatePinnedToCore(script_task1, "T1", STASK_STACK, NULL, STASK_PRIO, &esp32_tasks[0].task_t, core);
@@ -5686,6 +6632,11 @@ uint16_t task_timer2;
 TaskHandle_t task_t1;
 TaskHandle_t task_t2;
 
+bool ScriptInTask(void) {
+  TaskHandle_t task=xTaskGetCurrentTaskHandle();
+  return (task==task_t1 || task==task_t2);
+}
+
 void script_task1(void *arg) {
   while (1) {
     delay(task_timer1);
@@ -5704,6 +6655,7 @@ uint32_t scripter_create_task(uint32_t num, uint32_t time, uint32_t core) {
   //return 0;
   BaseType_t res = 0;
   if (core > 1) { core = 1; }
+  if (!ScriptTaskInit()) { return 0; }
   if (num == 1) {
     if (task_t1) { vTaskDelete(task_t1); }
     res = xTaskCreatePinnedToCore(script_task1, "T1", STASK_STACK, NULL, STASK_PRIO, &task_t1, core);
@@ -5733,6 +6685,10 @@ bool Xdrv10(uint8_t function)
     case FUNC_PRE_INIT:
       // set defaults to rules memory
       //bitWrite(Settings.rule_enabled,0,0);
+      XdrvSubscribe(FUNC_EVERY_100_MSECOND);
+#if defined(ESP32) && defined(USE_SCRIPT_TASK)
+      XdrvSubscribe(FUNC_LOOP);
+#endif  // ESP32 && USE_SCRIPT_TASK
       glob_script_mem.script_ram=Settings.rules[0];
       glob_script_mem.script_size=MAX_SCRIPT_SIZE;
       glob_script_mem.flags=0;
@@ -5809,6 +6765,9 @@ bool Xdrv10(uint8_t function)
 #else
         fsp = &LittleFS;
         if (fsp->begin()) {
+#if defined(USE_FLASH_WEAR) && defined(ESP8266)
+          ScriptFlashWearRegion();
+#endif
 #endif
 
         //fsp->dateTimeCallback(dateTime);
@@ -5848,6 +6807,9 @@ bool Xdrv10(uint8_t function)
     script=(char*)calloc(LITTLEFS_SCRIPT_SIZE+4,1);
     if (!script) break;
     LoadFile("/script.txt",(uint8_t*)script,LITTLEFS_SCRIPT_SIZE);
+#ifdef USE_FLASH_WEAR
+    ScriptFlashWearRegion();
+#endif
 
     glob_script_mem.script_ram=script;
     glob_script_mem.script_size=LITTLEFS_SCRIPT_SIZE;
@@ -5888,6 +6850,11 @@ bool Xdrv10(uint8_t function)
     case FUNC_EVERY_100_MSECOND:
       ScripterEvery100ms();
       break;
+#if defined(ESP32) && defined(USE_SCRIPT_TASK)
+    case FUNC_LOOP:
+      ScriptTaskLoop();
+      break;
+#endif  // ESP32 && USE_SCRIPT_TASK
     case FUNC_EVERY_SECOND:
       ScriptEverySecond();
       break;
@@ -5931,6 +6898,9 @@ bool Xdrv10(uint8_t function)
         Run_Scripter(">R",2,0);
         Scripter_save_pvars();
       }
+#ifdef USE_SCRIPT_FATFS
+      ScriptFileFlushAll();
+#endif
       break;
 #ifdef SUPPORT_MQTT_EVENT
     case FUNC_MQTT_DATA:
@@ -1233,6 +1233,8 @@ bool Xdrv11(uint8_t function)
         break;
       case FUNC_PRE_INIT:
         KNX_INIT();
+        XdrvSubscribe(FUNC_LOOP);
+        XdrvSubscribe(FUNC_EVERY_50_MSECOND);
         break;
 //      case FUNC_SET_POWER:
 //        break;
@@ -156,6 +156,61 @@ uint8_t hass_init_step = 0;
 uint8_t hass_mode = 0;
 int hass_tele_period = 0;
 
+/*********************************************************************************************\
+ * Discovery scheduler
+ *
+ * Discovery runs one step per 250 mS, one sensor driver per step, instead of in one burst on
+ * MQTT connect. A retained discovery message is only published when the hash of its topic and
+ * payload was not published since restart as the broker still holds the retained copy. A
+ * forced discovery (SetOption19 change) clears the hashes and publishes everything again.
+\*********************************************************************************************/
+
+#ifndef HASS_DISCOVERY_HASHES
+#define HASS_DISCOVERY_HASHES  64        // Max number of published discovery messages remembered
+#endif
+
+enum HAssDiscoverySteps { HASS_STEP_IDLE, HASS_STEP_BUTTONS, HASS_STEP_SWITCHES, HASS_STEP_SENSORS, HASS_STEP_RELAYS, HASS_STEP_STATUS };
+
+struct {
+  uint32_t hash[HASS_DISCOVERY_HASHES];  // Hashes of published topic and payload
+  uint16_t published = 0;                // Messages published by the current discovery
+  uint16_t unchanged = 0;                // Messages skipped by the current discovery
+  uint8_t hashes = 0;
+  uint8_t step = HASS_STEP_IDLE;
+  uint8_t xsns_index = 0;                // Next sensor driver to announce
+} HAssScheduler;
+
+uint32_t HAssHash(const char *topic, const char *payload)
+{
+  // FNV-1a over topic and payload
+  uint32_t hash = 2166136261;
+  for (const char *text = topic; *text; text++) {
+    hash = (hash ^ (uint8_t)*text) * 16777619;
+  }
+  hash = (hash ^ '\n') * 16777619;
+  for (const char *text = payload; *text; text++) {
+    hash = (hash ^ (uint8_t)*text) * 16777619;
+  }
+  return hash;
+}
+
+void HAssPublish(const char *stopic)
+{
+  // Publish mqtt_data retained on stopic unless already published since restart
+  uint32_t hash = HAssHash(stopic, mqtt_data);
+  for (uint32_t i = 0; i < HAssScheduler.hashes; i++) {
+    if (HAssScheduler.hash[i] == hash) {
+      HAssScheduler.unchanged++;
+      return;
+    }
+  }
+  // A changed message leaves the hash of its previous payload behind so start over when full
+  if (HAssScheduler.hashes >= HASS_DISCOVERY_HASHES) { HAssScheduler.hashes = 0; }
+  HAssScheduler.hash[HAssScheduler.hashes++] = hash;
+  HAssScheduler.published++;
+  HAssPublish(stopic);
+}
+
 void TryResponseAppend_P(const char *format, ...)
 {
   va_list args;
@@ -163,7 +218,7 @@ void TryResponseAppend_P(const char *format, ...)
   char dummy[2];
   int dlen = vsnprintf_P(dummy, 1, format, args);
 
-  int mlen = strlen(mqtt_data);
+  int mlen = ResponseLength();
   int slen = sizeof(mqtt_data) - 1 - mlen;
   if (dlen >= slen)
   {
@@ -176,6 +231,7 @@ void TryResponseAppend_P(const char *format, ...)
   {
     va_start(args, format);
     vsnprintf_P(mqtt_data + mlen, slen, format, args);
+    ResponseSetLength(mlen + dlen);
   }
   va_end(args);
 }
@@ -220,13 +276,13 @@ void HAssAnnounceRelayLight(void)
     bool RelayX = PinUsed(GPIO_REL1 +i-1);
     is_topic_light = Settings.flag.hass_light && RelayX || light_type && !RelayX || PwmMod; // SetOption30 - Enforce HAss autodiscovery as light
 
-    mqtt_data[0] = '\0'; // Clear retained message
+    ResponseClear(); // Clear retained message
 
     // Clear "other" topic first in case the device has been reconfigured from light to switch or vice versa
     snprintf_P(unique_id, sizeof(unique_id), PSTR("%06X_%s_%d"), ESP_getChipId(), (is_topic_light) ? "RL" : "LI", i);
     snprintf_P(stopic, sizeof(stopic), PSTR(HOME_ASSISTANT_DISCOVERY_PREFIX "/%s/%s/config"),
                (is_topic_light) ? "switch" : "light", unique_id);
-    MqttPublish(stopic, true);
+    HAssPublish(stopic);
     // Clear or Set topic
     snprintf_P(unique_id, sizeof(unique_id), PSTR("%06X_%s_%d"), ESP_getChipId(), (is_topic_light) ? "LI" : "RL", i);
     snprintf_P(stopic, sizeof(stopic), PSTR(HOME_ASSISTANT_DISCOVERY_PREFIX "/%s/%s/config"),
@@ -317,7 +373,7 @@ void HAssAnnounceRelayLight(void)
         TryResponseAppend_P(PSTR("}"));
       }
     }
-    MqttPublish(stopic, true);
+    HAssPublish(stopic);
   }
 }
 
@@ -331,7 +387,7 @@ void HAssAnnouncerTriggers(uint8_t device, uint8_t present, uint8_t key, uint8_t
   char unique_id[30];
   char trigger2[8];
 
-  mqtt_data[0] = '\0'; // Clear retained message
+  ResponseClear(); // Clear retained message
 
   for (uint8_t i = trg_start; i <= trg_end; i++) {
     GetTextIndexed(trigger2, sizeof(trigger2), i, kHAssTriggerStringButtons);
@@ -360,19 +416,19 @@ void HAssAnnouncerTriggers(uint8_t device, uint8_t present, uint8_t key, uint8_t
           GetTextIndexed(param, sizeof(param), pload, kHAssTriggerType);
           snprintf_P(subtype, sizeof(subtype), PSTR("switch_%d"), device + 1);
           Response_P(HASS_TRIGGER_TYPE, state_topic, GetStateText(i), param, subtype, ESP_getChipId());
-        } else { mqtt_data[0] = '\0'; } // Need to be cleaned again to avoid duplicate
+        } else { ResponseClear(); } // Need to be cleaned again to avoid duplicate
       } else {
         char trigger1[24];
         GetTextIndexed(trigger1, sizeof(trigger1), i, kHAssTriggerTypeButtons);
         snprintf_P(subtype, sizeof(subtype), PSTR("button_%d"), device + 1);
         if (i > 1 && single) {
-          mqtt_data[0] = '\0';  // Need to be cleaned again to avoid duplicate
+          ResponseClear();  // Need to be cleaned again to avoid duplicate
         } else {
           Response_P(HASS_TRIGGER_TYPE, state_topic, trigger2, trigger1, subtype, ESP_getChipId());
         }
       }
     }
-    MqttPublish(stopic, true);
+    HAssPublish(stopic);
   }
 }
 
@@ -383,7 +439,7 @@ void HAssAnnouncerBinSensors(uint8_t device, uint8_t present, uint8_t dual, uint
   char stemp2[TOPSZ];
   char unique_id[30];
 
-  mqtt_data[0] = '\0'; // Clear retained message
+  ResponseClear(); // Clear retained message
 
   snprintf_P(unique_id, sizeof(unique_id), PSTR("%06X_SW_%d"), ESP_getChipId(), device + 1);
   snprintf_P(stopic, sizeof(stopic), PSTR(HOME_ASSISTANT_DISCOVERY_PREFIX "/binary_sensor/%s/config"), unique_id);
@@ -414,7 +470,7 @@ void HAssAnnouncerBinSensors(uint8_t device, uint8_t present, uint8_t dual, uint
       TryResponseAppend_P(PSTR("}"));
     }
   }
-  MqttPublish(stopic, true);
+  HAssPublish(stopic);
 }
 
 void HAssAnnounceSwitches(void)
@@ -544,7 +600,7 @@ void HAssAnnounceSensor(const char *sensorname, const char *subsensortype, const
   char unique_id[30];
   char subname[20];
 
-  mqtt_data[0] = '\0'; // Clear retained message
+  ResponseClear(); // Clear retained message
 
   // Clear or Set topic
   NoAlNumToUnderscore(subname, MultiSubName); //Replace all non alphaumeric characters to '_' to avoid topic name issues
@@ -607,75 +663,72 @@ void HAssAnnounceSensor(const char *sensorname, const char *subsensortype, const
     }
     TryResponseAppend_P(PSTR("}}\"}"));
   }
-  MqttPublish(stopic, true);
+  HAssPublish(stopic);
 }
 
-void HAssAnnounceSensors(void)
+bool HAssAnnounceSensors(void)
 {
-  uint8_t hass_xsns_index = 0;
-  do
-  {
-    mqtt_data[0] = '\0';
-    int tele_period_save = tele_period;
-    tele_period = 2;                                 // Do not allow HA updates during next function call
-    XsnsNextCall(FUNC_JSON_APPEND, hass_xsns_index); // ,"INA219":{"Voltage":4.494,"Current":0.020,"Power":0.089}
-    tele_period = tele_period_save;
+  // Announce the sensors of the next driver, returns true when all drivers are announced
+  ResponseClear();
+  int tele_period_save = tele_period;
+  tele_period = 2;                                 // Do not allow HA updates during next function call
+  XsnsNextCall(FUNC_JSON_APPEND, HAssScheduler.xsns_index); // ,"INA219":{"Voltage":4.494,"Current":0.020,"Power":0.089}
+  tele_period = tele_period_save;
 
-    char sensordata[512]; // Copy because we need to write to mqtt_data
-    strlcpy(sensordata, mqtt_data, sizeof(sensordata));
+  char sensordata[512]; // Copy because we need to write to mqtt_data
+  strlcpy(sensordata, mqtt_data, sizeof(sensordata));
 
-    if (strlen(sensordata))
-    {
-      sensordata[0] = '{';
-      snprintf_P(sensordata, sizeof(sensordata), PSTR("%s}"), sensordata); // {"INA219":{"Voltage":4.494,"Current":0.020,"Power":0.089}}
-      // USE THE FOLLOWING LINE TO TEST JSON
-      //snprintf_P(sensordata, sizeof(sensordata), PSTR("{\"HX711\":{\"Weight\":[22,34,1023.4]}}"));
+  if (strlen(sensordata))
+  {
+    sensordata[0] = '{';
+    snprintf_P(sensordata, sizeof(sensordata), PSTR("%s}"), sensordata); // {"INA219":{"Voltage":4.494,"Current":0.020,"Power":0.089}}
+    // USE THE FOLLOWING LINE TO TEST JSON
+    //snprintf_P(sensordata, sizeof(sensordata), PSTR("{\"HX711\":{\"Weight\":[22,34,1023.4]}}"));
 
 
-      StaticJsonBuffer<500> jsonBuffer;
-      JsonObject &root = jsonBuffer.parseObject(sensordata);
-      if (!root.success())
+    JsonTempBuffer<500> jsonBuffer;
+    JsonObject &root = jsonBuffer.parseObject(sensordata);
+    if (!root.success())
+    {
+      AddLog_P2(LOG_LEVEL_ERROR, PSTR("%s '%s'"), kHAssError3, sensordata);
+      return (0 == HAssScheduler.xsns_index);
+    }
+    for (auto sensor : root)
+    {
+      const char *sensorname = sensor.key;
+      JsonObject &sensors = sensor.value.as<JsonObject>();
+      if (!sensors.success())
       {
         AddLog_P2(LOG_LEVEL_ERROR, PSTR("%s '%s'"), kHAssError3, sensordata);
         continue;
       }
-      for (auto sensor : root)
-      {
-        const char *sensorname = sensor.key;
-        JsonObject &sensors = sensor.value.as<JsonObject>();
-        if (!sensors.success())
-        {
-          AddLog_P2(LOG_LEVEL_ERROR, PSTR("%s '%s'"), kHAssError3, sensordata);
-          continue;
-        }
 
-        for (auto subsensor : sensors)
-        {
-          if (subsensor.value.is<JsonObject&>()) {
-            // If there is a nested json on sensor data, second level entitites will be created
-            char NestedName[20];
-            char NewSensorName[20];
-            snprintf_P(NestedName, sizeof(NestedName), PSTR("%s"), subsensor.key);
-            JsonObject& subsensors = subsensor.value.as<JsonObject>();
-            for (auto subsensor : subsensors) {
-              snprintf_P(NewSensorName, sizeof(NewSensorName), PSTR("%s %s"), NestedName, subsensor.key);
-              HAssAnnounceSensor(sensorname, NestedName, NewSensorName, 0, 0, 1, subsensor.key);
-            }
-          } else if (subsensor.value.is<JsonArray&>()) {
-            // If there is more than a value on sensor data, 'n' entitites will be created
-            JsonArray& subsensors = subsensor.value.as<JsonArray&>();
-            uint8_t subqty = subsensors.size();
-            char MultiSubName[20];
-            for (int i = 1; i <= subqty; i++) {
-              snprintf_P(MultiSubName, sizeof(MultiSubName), PSTR("%s %d"), subsensor.key, i);
-              HAssAnnounceSensor(sensorname, subsensor.key, MultiSubName, i, 1, 0, subsensor.key);
-            }
-          } else { HAssAnnounceSensor(sensorname, subsensor.key, subsensor.key, 0, 0, 0, subsensor.key);}
-        }
+      for (auto subsensor : sensors)
+      {
+        if (subsensor.value.is<JsonObject&>()) {
+          // If there is a nested json on sensor data, second level entitites will be created
+          char NestedName[20];
+          char NewSensorName[20];
+          snprintf_P(NestedName, sizeof(NestedName), PSTR("%s"), subsensor.key);
+          JsonObject& subsensors = subsensor.value.as<JsonObject>();
+          for (auto subsensor : subsensors) {
+            snprintf_P(NewSensorName, sizeof(NewSensorName), PSTR("%s %s"), NestedName, subsensor.key);
+            HAssAnnounceSensor(sensorname, NestedName, NewSensorName, 0, 0, 1, subsensor.key);
+          }
+        } else if (subsensor.value.is<JsonArray&>()) {
+          // If there is more than a value on sensor data, 'n' entitites will be created
+          JsonArray& subsensors = subsensor.value.as<JsonArray&>();
+          uint8_t subqty = subsensors.size();
+          char MultiSubName[20];
+          for (int i = 1; i <= subqty; i++) {
+            snprintf_P(MultiSubName, sizeof(MultiSubName), PSTR("%s %d"), subsensor.key, i);
+            HAssAnnounceSensor(sensorname, subsensor.key, MultiSubName, i, 1, 0, subsensor.key);
+          }
+        } else { HAssAnnounceSensor(sensorname, subsensor.key, subsensor.key, 0, 0, 0, subsensor.key);}
       }
     }
-    yield();
-  } while (hass_xsns_index != 0);
+  }
+  return (0 == HAssScheduler.xsns_index);
 }
 
 void HAssAnnounceDeviceInfoAndStatusSensor(void)
@@ -686,7 +739,7 @@ void HAssAnnounceDeviceInfoAndStatusSensor(void)
   char unique_id[30];
 
   // Announce sensor
-  mqtt_data[0] = '\0'; // Clear retained message
+  ResponseClear(); // Clear retained message
 
   // Clear or Set topic
   snprintf_P(unique_id, sizeof(unique_id), PSTR("%06X_status"), ESP_getChipId());
@@ -709,7 +762,7 @@ void HAssAnnounceDeviceInfoAndStatusSensor(void)
                         ModuleName().c_str(), my_version, my_image);
     TryResponseAppend_P(PSTR("}"));
   }
-  MqttPublish(stopic, true);
+  HAssPublish(stopic);
 }
 
 void HAssPublishStatus(void)
@@ -739,22 +792,43 @@ void HAssDiscovery(void)
 
   if (Settings.flag.hass_discovery || (1 == hass_mode))
   { // SetOption19 - Control Home Assistantautomatic discovery (See SetOption59)
+    if (1 == hass_mode) { HAssScheduler.hashes = 0; }  // Forced discovery publishes everything
+    HAssScheduler.published = 0;
+    HAssScheduler.unchanged = 0;
+    HAssScheduler.xsns_index = 0;
+    HAssScheduler.step = HASS_STEP_BUTTONS;
+  }
+}
 
-    // Send info about buttons
-    HAssAnnounceButtons();
-
-    // Send info about switches
-    HAssAnnounceSwitches();
-
-    // Send info about sensors
-    HAssAnnounceSensors();
-
-    // Send info about relays and lights
-    HAssAnnounceRelayLight();
-
-    // Send info about status sensor
-    HAssAnnounceDeviceInfoAndStatusSensor();
+void HAssDiscoveryStep(void)
+{
+  switch (HAssScheduler.step) {
+    case HASS_STEP_IDLE:
+      return;
+    case HASS_STEP_BUTTONS:
+      // Send info about buttons
+      HAssAnnounceButtons();
+      break;
+    case HASS_STEP_SWITCHES:
+      // Send info about switches
+      HAssAnnounceSwitches();
+      break;
+    case HASS_STEP_SENSORS:
+      // Send info about sensors
+      if (!HAssAnnounceSensors()) { return; }  // Next driver on the next step
+      break;
+    case HASS_STEP_RELAYS:
+      // Send info about relays and lights
+      HAssAnnounceRelayLight();
+      break;
+    case HASS_STEP_STATUS:
+      // Send info about status sensor
+      HAssAnnounceDeviceInfoAndStatusSensor();
+      AddLog_P2(LOG_LEVEL_DEBUG, PSTR("HASS: Discovery published %d, unchanged %d"), HAssScheduler.published, HAssScheduler.unchanged);
+      HAssScheduler.step = HASS_STEP_IDLE;
+      return;
   }
+  HAssScheduler.step++;
 }
 
 void HAssDiscover(void)
@@ -817,6 +891,14 @@ bool Xdrv12(uint8_t function)
   { // SetOption3 - Enable MQTT
     switch (function)
     {
+    case FUNC_PRE_INIT:
+      XdrvSubscribe(FUNC_EVERY_250_MSECOND);
+      break;
+    case FUNC_EVERY_250_MSECOND:
+      if (!global_state.mqtt_down) {
+        HAssDiscoveryStep();
+      }
+      break;
     case FUNC_EVERY_SECOND:
       if (hass_init_step)
       {
@@ -833,7 +915,7 @@ bool Xdrv12(uint8_t function)
         {
           hass_tele_period = 0;
 
-          mqtt_data[0] = '\0';
+          ResponseClear();
           HAssPublishStatus();
         }
       }
@@ -844,6 +926,7 @@ bool Xdrv12(uint8_t function)
     case FUNC_MQTT_INIT:
       hass_mode = 0;      // Discovery only if Settings.flag.hass_discovery is set
       hass_init_step = 2; // Delayed discovery
+      HAssScheduler.step = HASS_STEP_IDLE;
       break;
     }
   }
@@ -64,6 +64,7 @@ const uint8_t DISPLAY_LOG_ROWS = 32;           // Number of lines in display log
 #define D_CMND_DISP_TEXT "Text"
 #define D_CMND_DISP_WIDTH "Width"
 #define D_CMND_DISP_HEIGHT "Height"
+#define D_CMND_DISP_KEYS "Keys"
 
 enum XdspFunctions { FUNC_DISPLAY_INIT_DRIVER, FUNC_DISPLAY_INIT, FUNC_DISPLAY_EVERY_50_MSECOND, FUNC_DISPLAY_EVERY_SECOND,
                      FUNC_DISPLAY_MODEL, FUNC_DISPLAY_MODE, FUNC_DISPLAY_POWER,
@@ -78,12 +79,20 @@ enum DisplayInitModes { DISPLAY_INIT_MODE, DISPLAY_INIT_PARTIAL, DISPLAY_INIT_FU
 const char kDisplayCommands[] PROGMEM = D_PRFX_DISPLAY "|"  // Prefix
   "|" D_CMND_DISP_MODEL "|" D_CMND_DISP_WIDTH "|" D_CMND_DISP_HEIGHT "|" D_CMND_DISP_MODE "|" D_CMND_DISP_REFRESH "|"
   D_CMND_DISP_DIMMER "|" D_CMND_DISP_COLS "|" D_CMND_DISP_ROWS "|" D_CMND_DISP_SIZE "|" D_CMND_DISP_FONT "|"
-  D_CMND_DISP_ROTATE "|" D_CMND_DISP_TEXT "|" D_CMND_DISP_ADDRESS ;
+  D_CMND_DISP_ROTATE "|" D_CMND_DISP_TEXT "|" D_CMND_DISP_ADDRESS
+#ifdef USE_DISPLAY_MODES1TO5
+  "|" D_CMND_DISP_KEYS
+#endif  // USE_DISPLAY_MODES1TO5
+  ;
 
 void (* const DisplayCommand[])(void) PROGMEM = {
   &CmndDisplay, &CmndDisplayModel, &CmndDisplayWidth, &CmndDisplayHeight, &CmndDisplayMode, &CmndDisplayRefresh,
   &CmndDisplayDimmer, &CmndDisplayColumns, &CmndDisplayRows, &CmndDisplaySize, &CmndDisplayFont,
-  &CmndDisplayRotate, &CmndDisplayText, &CmndDisplayAddress };
+  &CmndDisplayRotate, &CmndDisplayText, &CmndDisplayAddress
+#ifdef USE_DISPLAY_MODES1TO5
+  , &CmndDisplayKeys
+#endif  // USE_DISPLAY_MODES1TO5
+  };
 
 char *dsp_str;
 
@@ -127,6 +136,7 @@ bool disp_subscribed = false;
 void DisplayInit(uint8_t mode)
 {
   if (renderer)  {
+    renderer->invalidateText();
     renderer->DisplayInit(mode, Settings.display_size, Settings.display_rotate, Settings.display_font);
   }
   else {
@@ -135,6 +145,21 @@ void DisplayInit(uint8_t mode)
   }
 }
 
+void DisplayInvalidateText(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  // Graphics drawn over text make the renderer draw that text completely next time
+  if (!renderer) { return; }
+  if (w < 0) {
+    x += w;
+    w = -w;
+  }
+  if (h < 0) {
+    y += h;
+    h = -h;
+  }
+  renderer->invalidateText(x, y, w +1, h +1);
+}
+
 void DisplayClear(void)
 {
   XdspCall(FUNC_DISPLAY_CLEAR);
@@ -420,7 +445,10 @@ void DisplayText(void)
           case 'z':
             // clear display
             if (!renderer) DisplayClear();
-            else renderer->fillScreen(bg_color);
+            else {
+              renderer->invalidateText();
+              renderer->fillScreen(bg_color);
+            }
             disp_xpos = 0;
             disp_ypos = 0;
             col = 0;
@@ -521,6 +549,7 @@ void DisplayText(void)
             // hor line to
             var = atoiv(cp, &temp);
             cp += var;
+            DisplayInvalidateText(disp_xpos, disp_ypos, temp, 0);
             if (temp < 0) {
               if (renderer) renderer->writeFastHLine(disp_xpos + temp, disp_ypos, -temp, fg_color);
               else DisplayDrawHLine(disp_xpos + temp, disp_ypos, -temp, fg_color);
@@ -534,6 +563,7 @@ void DisplayText(void)
             // vert line to
             var = atoiv(cp, &temp);
             cp += var;
+            DisplayInvalidateText(disp_xpos, disp_ypos, 0, temp);
             if (temp < 0) {
               if (renderer) renderer->writeFastVLine(disp_xpos, disp_ypos + temp, -temp, fg_color);
               else DisplayDrawVLine(disp_xpos, disp_ypos + temp, -temp, fg_color);
@@ -550,6 +580,7 @@ void DisplayText(void)
             cp++;
             var = atoiv(cp, &temp1);
             cp += var;
+            DisplayInvalidateText(disp_xpos, disp_ypos, temp - disp_xpos, temp1 - disp_ypos);
             if (renderer) renderer->writeLine(disp_xpos, disp_ypos, temp, temp1, fg_color);
             else DisplayDrawLine(disp_xpos, disp_ypos, temp, temp1, fg_color);
             disp_xpos += temp;
@@ -559,6 +590,7 @@ void DisplayText(void)
             // circle
             var = atoiv(cp, &temp);
             cp += var;
+            DisplayInvalidateText(disp_xpos - temp, disp_ypos - temp, temp *2, temp *2);
             if (renderer) renderer->drawCircle(disp_xpos, disp_ypos, temp, fg_color);
             else DisplayDrawCircle(disp_xpos, disp_ypos, temp, fg_color);
             break;
@@ -566,6 +598,7 @@ void DisplayText(void)
             // filled circle
             var = atoiv(cp, &temp);
             cp += var;
+            DisplayInvalidateText(disp_xpos - temp, disp_ypos - temp, temp *2, temp *2);
             if (renderer) renderer->fillCircle(disp_xpos, disp_ypos, temp, fg_color);
             else DisplayDrawFilledCircle(disp_xpos, disp_ypos, temp, fg_color);
             break;
@@ -576,6 +609,7 @@ void DisplayText(void)
             cp++;
             var = atoiv(cp, &temp1);
             cp += var;
+            DisplayInvalidateText(disp_xpos, disp_ypos, temp, temp1);
             if (renderer) renderer->drawRect(disp_xpos, disp_ypos, temp, temp1, fg_color);
             else DisplayDrawRectangle(disp_xpos, disp_ypos, temp, temp1, fg_color);
             break;
@@ -586,6 +620,7 @@ void DisplayText(void)
             cp++;
             var = atoiv(cp, &temp1);
             cp += var;
+            DisplayInvalidateText(disp_xpos, disp_ypos, temp, temp1);
             if (renderer) renderer->fillRect(disp_xpos, disp_ypos, temp, temp1, fg_color);
             else DisplayDrawFilledRectangle(disp_xpos, disp_ypos, temp, temp1, fg_color);
             break;
@@ -600,6 +635,7 @@ void DisplayText(void)
             cp++;
             var = atoiv(cp, &rad);
             cp += var;
+            DisplayInvalidateText(disp_xpos, disp_ypos, temp, temp1);
             if (renderer) renderer->drawRoundRect(disp_xpos, disp_ypos, temp, temp1, rad, fg_color);
               //else DisplayDrawFilledRectangle(disp_xpos, disp_ypos, temp, temp1, fg_color);
             }
@@ -615,6 +651,7 @@ void DisplayText(void)
             cp++;
             var = atoiv(cp, &rad);
             cp += var;
+            DisplayInvalidateText(disp_xpos, disp_ypos, temp, temp1);
             if (renderer) renderer->fillRoundRect(disp_xpos, disp_ypos, temp, temp1, rad, fg_color);
                   //else DisplayDrawFilledRectangle(disp_xpos, disp_ypos, temp, temp1, fg_color);
             }
@@ -665,7 +702,10 @@ void DisplayText(void)
             break;
           case 'a':
             // rotation angle
-            if (renderer) renderer->setRotation(*cp&3);
+            if (renderer) {
+              renderer->invalidateText();
+              renderer->setRotation(*cp&3);
+            }
             else DisplaySetRotation(*cp&3);
             cp+=1;
             break;
@@ -804,6 +844,7 @@ void DisplayText(void)
               delete buttons[num];
             }
             if (renderer) {
+              DisplayInvalidateText(gxp, gyp, gxs, gys);
               buttons[num]= new VButton();
               if (buttons[num]) {
                 buttons[num]->vpower=bflags;
@@ -890,10 +931,10 @@ void DisplayAllocScreenBuffer(void)
 {
   if (!disp_screen_buffer_cols) {
     disp_screen_buffer_rows = Settings.display_rows;
-    disp_screen_buffer = (char**)malloc(sizeof(*disp_screen_buffer) * disp_screen_buffer_rows);
+    disp_screen_buffer = (char**)PsramMalloc(sizeof(*disp_screen_buffer) * disp_screen_buffer_rows);
     if (disp_screen_buffer != nullptr) {
       for (uint32_t i = 0; i < disp_screen_buffer_rows; i++) {
-        disp_screen_buffer[i] = (char*)malloc(sizeof(*disp_screen_buffer[i]) * (Settings.display_cols[0] +1));
+        disp_screen_buffer[i] = (char*)PsramMalloc(sizeof(*disp_screen_buffer[i]) * (Settings.display_cols[0] +1));
         if (disp_screen_buffer[i] == nullptr) {
           DisplayFreeScreenBuffer();
           break;
@@ -947,10 +988,10 @@ void DisplayFreeLogBuffer(void)
 void DisplayAllocLogBuffer(void)
 {
   if (!disp_log_buffer_cols) {
-    disp_log_buffer = (char**)malloc(sizeof(*disp_log_buffer) * DISPLAY_LOG_ROWS);
+    disp_log_buffer = (char**)PsramMalloc(sizeof(*disp_log_buffer) * DISPLAY_LOG_ROWS);
     if (disp_log_buffer != nullptr) {
       for (uint32_t i = 0; i < DISPLAY_LOG_ROWS; i++) {
-        disp_log_buffer[i] = (char*)malloc(sizeof(*disp_log_buffer[i]) * (Settings.display_cols[0] +1));
+        disp_log_buffer[i] = (char*)PsramMalloc(sizeof(*disp_log_buffer[i]) * (Settings.display_cols[0] +1));
         if (disp_log_buffer[i] == nullptr) {
           DisplayFreeLogBuffer();
           break;
@@ -1144,7 +1185,7 @@ void DisplayAnalyzeJson(char *topic, char *json)
 //  strlcpy(jsonStr, json, sizeof(jsonStr));  // Save original before destruction by JsonObject
   String jsonStr = json;  // Move from stack to heap to fix watchdogs (20180626)
 
-  StaticJsonBuffer<1024> jsonBuf;
+  JsonTempBuffer<1024> jsonBuf;
   JsonObject &root = jsonBuf.parseObject(jsonStr);
   if (root.success()) {
 
@@ -1189,6 +1230,99 @@ void DisplayAnalyzeJson(char *topic, char *json)
   }
 }
 
+/*********************************************************************************************\
+ * Key projection
+ *
+ * DisplayKeys lists the keys shown from subscribed messages as Key for any topic or topic/Key,
+ * separated by spaces or commas like "pow1/Power pow1/Voltage Temperature". With a list a
+ * message is scanned for these keys only without copying or parsing it into a JSON tree and
+ * messages of other topics show nothing. Values in arrays are not shown.
+\*********************************************************************************************/
+
+bool DisplayKeyWanted(const char* topic, const char* key)
+{
+  const char *keys = SettingsText(SET_DISPLAY_KEYS);
+  uint32_t topic_len = strlen(topic);
+  uint32_t key_len = strlen(key);
+  while (*keys) {
+    while ((' ' == *keys) || (',' == *keys)) { keys++; }
+    const char *end = keys;
+    while (*end && (*end != ' ') && (*end != ',')) { end++; }
+    const char *name = keys;
+    const char *slash = (const char*)memchr(keys, '/', end - keys);
+    if (slash) {
+      name = slash +1;
+      if (((uint32_t)(slash - keys) != topic_len) || strncasecmp(keys, topic, topic_len)) { name = nullptr; }
+    }
+    if (name && ((uint32_t)(end - name) == key_len) && !strncasecmp(name, key, key_len)) { return true; }
+    keys = end;
+  }
+  return false;
+}
+
+const char* DisplayScanString(const char* json)
+{
+  // Returns position of the closing quote or the end of json
+  while (*json && (*json != '"')) {
+    if (('\\' == *json) && json[1]) { json++; }
+    json++;
+  }
+  return json;
+}
+
+void DisplayProjectJson(const char* topic, const char* json)
+{
+  char key[33];
+  char value[33];
+  uint32_t array = 0;                                        // Depth of arrays
+  const char *p = json;
+
+  while (*p) {
+    if ('[' == *p) { array++; }
+    else if ((']' == *p) && array) { array--; }
+    if (*p != '"') {
+      p++;
+      continue;
+    }
+    const char *start = p +1;
+    p = DisplayScanString(start);
+    if (!*p) { break; }
+    uint32_t len = p - start;
+    p++;                                                     // Skip closing quote
+    while (' ' == *p) { p++; }
+    if (*p != ':') { continue; }                             // A string value in an array
+    p++;
+    while (' ' == *p) { p++; }
+    if (('{' == *p) || ('[' == *p)) { continue; }            // Scan into objects, skip arrays
+
+    const char *vstart = p;
+    uint32_t vlen;
+    if ('"' == *p) {
+      vstart++;
+      p = DisplayScanString(vstart);
+      vlen = p - vstart;
+      if (*p) { p++; }
+    } else {
+      while (*p && (*p != ',') && (*p != '}') && (*p != ']') && (*p != ' ')) { p++; }
+      vlen = p - vstart;
+      if ((4 == vlen) && !strncmp_P(vstart, PSTR("null"), 4)) { continue; }  // "DHT11":{"Temperature":null}
+    }
+    if (array || (len >= sizeof(key))) { continue; }
+    strlcpy(key, start, len +1);
+    strlcpy(value, vstart, tmin(vlen +1, sizeof(value)));
+
+    if (!strcmp_P(key, PSTR(D_JSON_TEMPERATURE_UNIT))) {
+      snprintf_P(disp_temp, sizeof(disp_temp), PSTR("%s"), value);  // C or F
+    }
+    else if (!strcmp_P(key, PSTR(D_JSON_PRESSURE_UNIT))) {
+      snprintf_P(disp_pres, sizeof(disp_pres), PSTR("%s"), value);  // hPa or mmHg
+    }
+    else if (DisplayKeyWanted(topic, key)) {
+      DisplayJsonValue(topic, "", key, value);
+    }
+  }
+}
+
 void DisplayMqttSubscribe(void)
 {
 /* Subscribe to tele messages only
@@ -1232,7 +1366,11 @@ bool DisplayMqttData(void)
       if (Settings.display_mode &0x04) {
         tp = tp + strlen(stopic);                              // tasmota/SENSOR
         char *topic = strtok(tp, "/");                         // tasmota
-        DisplayAnalyzeJson(topic, XdrvMailbox.data);
+        if (strlen(SettingsText(SET_DISPLAY_KEYS))) {
+          DisplayProjectJson(topic, XdrvMailbox.data);
+        } else {
+          DisplayAnalyzeJson(topic, XdrvMailbox.data);
+        }
       }
       return true;
     }
@@ -1363,7 +1501,10 @@ void CmndDisplayMode(void)
     } else {
       if (last_display_mode && !Settings.display_mode) {  // Switch to mode 0
         DisplayInit(DISPLAY_INIT_MODE);
-        if (renderer) renderer->fillScreen(bg_color);
+        if (renderer) {
+          renderer->invalidateText();
+          renderer->fillScreen(bg_color);
+        }
         else DisplayClear();
       } else {
         DisplayLogBufferInit();
@@ -1485,6 +1626,16 @@ void CmndDisplayColumns(void)
   }
 }
 
+#ifdef USE_DISPLAY_MODES1TO5
+void CmndDisplayKeys(void)
+{
+  if (XdrvMailbox.data_len > 0) {
+    SettingsUpdateText(SET_DISPLAY_KEYS, (SC_CLEAR == Shortcut()) ? "" : XdrvMailbox.data);
+  }
+  ResponseCmndChar(SettingsText(SET_DISPLAY_KEYS));
+}
+#endif  // USE_DISPLAY_MODES1TO5
+
 void CmndDisplayRows(void)
 {
   if ((XdrvMailbox.payload > 0) && (XdrvMailbox.payload <= DISPLAY_MAX_ROWS)) {
@@ -1507,6 +1658,7 @@ void CmndDisplayRows(void)
 bool jpg2rgb888(const uint8_t *src, size_t src_len, uint8_t * out, jpg_scale_t scale);
 char get_jpeg_size(unsigned char* data, unsigned int data_size, unsigned short *width, unsigned short *height);
 void rgb888_to_565(uint8_t *in, uint16_t *out, uint32_t len);
+bool jpg2rgb565_rows(size_t len, jpg_reader_cb reader, void *reader_arg, jpg_rgb565_row_cb row, void *row_arg);
 #endif
 #endif
 
@@ -1517,7 +1669,68 @@ extern FS *fsp;
 #else
 extern SDClass *fsp;
 #endif
-#define XBUFF_LEN 128
+#ifdef ESP32
+#define DISP_READ_BLOCK 4096                // Bytes read from a picture file at once
+#else
+#define DISP_READ_BLOCK 1024
+#endif
+
+void DisplayPushColors(uint16_t *data, uint32_t len) {
+  while (len) {
+    uint32_t num = (len > 255) ? 255 : len;  // pushColors() takes up to 255 pixels
+    renderer->pushColors(data, num, true);
+    data += num;
+    len -= num;
+  }
+}
+
+void DisplayPushRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *data) {
+  // One transfer if the display supports it, else address window and pixel stream
+  if (renderer->pushColorRect(x, y, w, h, data)) { return; }
+  renderer->setAddrWindow(x, y, x + w, y + h);
+  DisplayPushColors(data, w * h);
+  renderer->setAddrWindow(0, 0, 0, 0);
+}
+
+#ifdef ESP32
+#ifdef JPEG_PICTS
+struct DISP_JPG {
+  File *fp;
+  int16_t xp;
+  int16_t yp;
+};
+
+size_t DisplayJpgRead(void *arg, size_t index, uint8_t *buf, size_t len) {
+  File *fp = ((DISP_JPG*)arg)->fp;
+  if (!buf) { return len; }                 // Skip, next read seeks
+  if (fp->position() != index) { fp->seek(index); }
+  return fp->read(buf, len);
+}
+
+bool DisplayJpgRow(void *arg, uint16_t y, uint16_t w, uint16_t h, uint16_t *data) {
+  // Push each decoded MCU row of RGB565 pixels, a clipped row line by line
+  DISP_JPG *jpg = (DISP_JPG*)arg;
+  int16_t by = jpg->yp + y;
+  int16_t left = (jpg->xp < 0) ? -jpg->xp : 0;
+  int16_t top = (by < 0) ? -by : 0;
+  int16_t vw = tmin((int16_t)w, (int16_t)(renderer->width() - jpg->xp)) - left;
+  int16_t vh = tmin((int16_t)h, (int16_t)(renderer->height() - by)) - top;
+  if (by >= renderer->height()) { return false; }  // Stop decoding below the display
+  if ((vw <= 0) || (vh <= 0)) { return true; }
+
+  if (vw == w) {
+    DisplayPushRect(jpg->xp, by + top, vw, vh, data + top * w);
+  } else {
+    for (uint32_t j = top; j < top + vh; j++) {
+      DisplayPushRect(jpg->xp + left, by + j, vw, 1, data + j * w + left);
+    }
+  }
+  OsWatchLoop();
+  return true;
+}
+#endif  // JPEG_PICTS
+#endif  // ESP32
+
 void Draw_RGB_Bitmap(char *file,uint16_t xp, uint16_t yp) {
   if (!renderer) return;
   File fp;
@@ -1538,73 +1751,33 @@ void Draw_RGB_Bitmap(char *file,uint16_t xp, uint16_t yp) {
     fp.read((uint8_t*)&xsize,2);
     uint16_t ysize;
     fp.read((uint8_t*)&ysize,2);
-#if 1
-    uint16_t xdiv=xsize/XBUFF_LEN;
-    renderer->setAddrWindow(xp,yp,xp+xsize,yp+ysize);
-    for(int16_t j=0; j<ysize; j++) {
-      for(int16_t i=0; i<xsize; i+=XBUFF_LEN) {
-        uint16_t rgb[XBUFF_LEN];
-        uint16_t len=fp.read((uint8_t*)rgb,XBUFF_LEN*2);
-        if (len>=2) renderer->pushColors(rgb,len/2,true);
-      }
-      OsWatchLoop();
-    }
-    renderer->setAddrWindow(0,0,0,0);
-#else
-    for(int16_t j=0; j<ysize; j++) {
-      for(int16_t i=0; i<xsize; i++ ) {
-        uint16_t rgb;
-        uint8_t res=fp.read((uint8_t*)&rgb,2);
-        if (!res) break;
-        renderer->writePixel(xp+i,yp,rgb);
+    renderer->invalidateText(xp, yp, xsize, ysize);
+    uint16_t *rgb = (uint16_t*)malloc(DISP_READ_BLOCK);
+    if (rgb) {
+      // Stream the pixels in large blocks into one address window
+      uint32_t pixels = xsize * ysize;
+      renderer->setAddrWindow(xp,yp,xp+xsize,yp+ysize);
+      while (pixels) {
+        uint32_t len = fp.read((uint8_t*)rgb, tmin(pixels * 2, (uint32_t)DISP_READ_BLOCK)) / 2;
+        if (!len) { break; }
+        DisplayPushColors(rgb, len);
+        pixels -= len;
+        OsWatchLoop();
       }
-      delay(0);
-      OsWatchLoop();
-      yp++;
+      renderer->setAddrWindow(0,0,0,0);
+      free(rgb);
     }
-#endif
     fp.close();
   } else if (!strcmp(estr,"jpg")) {
-    // jpeg files on ESP32 with more memory
+    // jpeg files on ESP32 decoded and pushed MCU row by MCU row
 #ifdef ESP32
 #ifdef JPEG_PICTS
-    if (psramFound()) {
-      fp=fsp->open(file,FILE_READ);
-      if (!fp) return;
-      uint32_t size = fp.size();
-      uint8_t *mem = (uint8_t *)heap_caps_malloc(size+4, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-      if (mem) {
-        uint8_t res=fp.read(mem, size);
-        if (res) {
-          uint16_t xsize;
-          uint16_t ysize;
-          if (mem[0]==0xff && mem[1]==0xd8) {
-            get_jpeg_size(mem, size, &xsize, &ysize);
-            //Serial.printf(" x,y %d - %d\n",xsize, ysize );
-            if (xsize && ysize) {
-              uint8_t *out_buf = (uint8_t *)heap_caps_malloc((xsize*ysize*3)+4, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-              if (out_buf) {
-                uint8_t *ob=out_buf;
-                jpg2rgb888(mem, size, out_buf, (jpg_scale_t)JPG_SCALE_NONE);
-                uint16_t pixels=xsize*ysize/XBUFF_LEN;
-                renderer->setAddrWindow(xp,yp,xp+xsize,yp+ysize);
-                for(int32_t j=0; j<pixels; j++) {
-                  uint16_t rbuff[XBUFF_LEN*2];
-                  rgb888_to_565(ob, rbuff, XBUFF_LEN);
-                  ob+=XBUFF_LEN*3;
-                  renderer->pushColors(rbuff,XBUFF_LEN,true);
-                  OsWatchLoop();
-                }
-                renderer->setAddrWindow(0,0,0,0);
-                free(out_buf);
-              }
-            }
-          }
-        }
-        free(mem);
-      }
-      fp.close();
-    }
+    fp=fsp->open(file,FILE_READ);
+    if (!fp) return;
+    renderer->invalidateText();             // Picture size only known while decoding
+    DISP_JPG jpg = { &fp, (int16_t)xp, (int16_t)yp };
+    jpg2rgb565_rows(fp.size(), DisplayJpgRead, &jpg, DisplayJpgRow, &jpg);
+    fp.close();
 #endif // JPEG_PICTS
 #endif // ESP32
   }
@@ -1621,6 +1794,7 @@ void Draw_RGB_Bitmap(char *file,uint16_t xp, uint16_t yp) {
 // draw analog watch, just for fun
 void DrawAClock(uint16_t rad) {
     if (!renderer) return;
+    DisplayInvalidateText(disp_xpos - rad, disp_ypos - rad, rad *2, rad *2);
     float frad=rad;
     uint16_t hred=frad/3.0;
     renderer->fillCircle(disp_xpos, disp_ypos, rad, bg_color);
@@ -1656,7 +1830,7 @@ typedef union {
   struct {
       uint8_t overlay : 1;
       uint8_t draw : 1;
-      uint8_t nu3 : 1;
+      uint8_t overlaid : 1;   // another graph is drawn on top of this one
       uint8_t nu4 : 1;
       uint8_t nu5 : 1;
       uint8_t nu6 : 1;
@@ -1679,31 +1853,47 @@ struct GRAPH {
   int16_t decimation; // decimation or graph duration in minutes
   uint16_t dcnt;
   uint32_t summ;
-  uint16_t xcnt;
-  uint8_t *values;
+  uint16_t xcnt;         // columns in ring
+  uint16_t head;         // ring index of the oldest column
+  uint8_t *vmin;         // ring of xs columns with lowest value of the samples in the column
+  uint8_t *vmax;         // ring of xs columns with highest value
+  uint8_t *dlo;          // span of each display column as drawn, dlo > dhi if none
+  uint8_t *dhi;
   uint8_t xticks;
   uint8_t yticks;
   uint8_t last_val;
+  uint8_t smin;          // lowest and highest sample summed for the next column
+  uint8_t smax;
   uint8_t color_index;
   GFLAGS flags;
 };
 
+const uint16_t GRAPH_MAGIC = 0x4752;   // GR
+
+struct GRAPH_FILE {
+  uint16_t magic;
+  uint16_t xs;
+  uint16_t ys;
+  uint16_t xcnt;
+  float ymin;
+  float ymax;
+};                       // followed by xcnt lowest and xcnt highest values, oldest first
 
 struct GRAPH *graph[NUM_GRAPHS];
 
 #define TICKLEN 4
-void ClrGraph(uint16_t num) {
-  struct GRAPH *gp=graph[num];
 
+void GraphReset(struct GRAPH *gp) {
+  // nothing of the graph on the display
+  memset(gp->dlo, 0xff, gp->xs);
+  memset(gp->dhi, 0, gp->xs);
+}
+
+void GraphTicks(struct GRAPH *gp) {
   uint16_t xticks=gp->xticks;
   uint16_t yticks=gp->yticks;
   uint16_t count;
 
-  // clr inside, but only 1.graph if overlapped
-  if (gp->flags.overlay) return;
-
-  renderer->fillRect(gp->xp+1,gp->yp+1,gp->xs-2,gp->ys-2,bg_color);
-
   if (xticks) {
     float cxp=gp->xp,xd=(float)gp->xs/(float)xticks;
     for (count=0; count<xticks; count++) {
@@ -1744,6 +1934,91 @@ void ClrGraph(uint16_t num) {
   }
 }
 
+void ClrGraph(uint16_t num) {
+  struct GRAPH *gp=graph[num];
+
+  // clr inside, but only 1.graph if overlapped
+  if (gp->flags.overlay) return;
+
+  renderer->invalidateText(gp->xp, gp->yp, gp->xs, gp->ys);
+  renderer->fillRect(gp->xp+1,gp->yp+1,gp->xs-2,gp->ys-2,bg_color);
+  for (uint32_t count=0; count<NUM_GRAPHS; count++) {
+    struct GRAPH *gp1=graph[count];
+    if (gp1 && (gp->xp==gp1->xp) && (gp->yp==gp1->yp)) {
+      GraphReset(gp1);
+    }
+  }
+
+  GraphTicks(gp);
+}
+
+void GraphVLine(struct GRAPH *gp, uint16_t col, uint8_t lo, uint8_t hi, uint16_t color) {
+  // values lo to hi in display column col
+  renderer->writeFastVLine(gp->xp+col, gp->yp+gp->ys-hi-1, hi-lo+1, color);
+}
+
+void GraphDrawColumns(struct GRAPH *gp) {
+  // Only draw what differs from the display, a column spans the lowest to the highest value
+  // of its samples and reaches the middle of the previous column to connect the line
+  uint16_t linecol=fg_color;
+  if (color_type==COLOR_COLOR) {
+    linecol=renderer->GetColorFromIndex(gp->color_index);
+  }
+
+  bool erased=false;
+  uint8_t prev_mid=0;
+  for (uint32_t col=0; col<gp->xs; col++) {
+    uint8_t lo=0xff;
+    uint8_t hi=0;
+    if (col<gp->xcnt) {
+      uint32_t index=(gp->head+col)%gp->xs;
+      lo=gp->vmin[index];
+      hi=gp->vmax[index];
+      uint8_t mid=(lo+hi)/2;
+      if (col) {
+        if (prev_mid<lo) lo=prev_mid;
+        if (prev_mid>hi) hi=prev_mid;
+      }
+      prev_mid=mid;
+    }
+    uint8_t dlo=gp->dlo[col];
+    uint8_t dhi=gp->dhi[col];
+    if ((lo==dlo) && (hi==dhi)) continue;
+
+    if (dlo<=dhi) {
+      // erase the part of the old span outside the new one
+      if (lo>hi) {
+        GraphVLine(gp, col, dlo, dhi, bg_color);
+      } else {
+        if (dlo<lo) GraphVLine(gp, col, dlo, tmin(dhi, lo-1), bg_color);
+        if (dhi>hi) GraphVLine(gp, col, tmax(dlo, hi+1), dhi, bg_color);
+      }
+      erased=true;
+    }
+    if (lo<=hi) {
+      if (dlo>dhi) {
+        GraphVLine(gp, col, lo, hi, linecol);
+      } else {
+        // draw the part of the new span outside the old one
+        if (lo<dlo) GraphVLine(gp, col, lo, tmin(hi, dlo-1), linecol);
+        if (hi>dhi) GraphVLine(gp, col, tmax(lo, dhi+1), hi, linecol);
+      }
+    }
+    gp->dlo[col]=lo;
+    gp->dhi[col]=hi;
+  }
+  // Erasing may have hit the frame or the ticks
+  if (erased) {
+    renderer->drawRect(gp->xp,gp->yp,gp->xs,gp->ys,fg_color);
+    GraphTicks(gp);
+  }
+}
+
+void GraphFree(struct GRAPH *gp) {
+  if (gp->vmin) free(gp->vmin);
+  gp->vmin=nullptr;
+}
+
 // define a graph
 void DefineGraph(uint16_t num,uint16_t xp,uint16_t yp,int16_t xs,uint16_t ys,int16_t dec,float ymin, float ymax,uint8_t icol) {
   if (!renderer) return;
@@ -1785,23 +2060,28 @@ void DefineGraph(uint16_t num,uint16_t xp,uint16_t yp,int16_t xs,uint16_t ys,int
   gp->ymax=ymax;
   gp->range=(ymax-ymin)/ys;
   gp->xcnt=0;
+  gp->head=0;
   gp->dcnt=0;
   gp->summ=0;
-  if (gp->values) free(gp->values);
-  gp->values=(uint8_t*) calloc(1,xs+2);
-  if (!gp->values) {
+  GraphFree(gp);
+  // one block for the value rings and the drawn spans
+  gp->vmin=(uint8_t*) calloc(4,xs);
+  if (!gp->vmin) {
     free(gp);
     graph[index]=0;
     return;
   }
-  // start from zero
-  gp->values[0]=0;
+  gp->vmax=gp->vmin+xs;
+  gp->dlo=gp->vmax+xs;
+  gp->dhi=gp->dlo+xs;
+  GraphReset(gp);
 
   gp->last_ms_redrawn=millis();
 
   if (!icol) icol=1;
   gp->color_index=icol;
   gp->flags.overlay=0;
+  gp->flags.overlaid=0;
   gp->flags.draw=1;
 
   // check if previous graph has same coordinates
@@ -1813,6 +2093,7 @@ void DefineGraph(uint16_t num,uint16_t xp,uint16_t yp,int16_t xs,uint16_t ys,int
         struct GRAPH *gp1=graph[count];
         if ((gp->xp==gp1->xp) && (gp->yp==gp1->yp)) {
           gp->flags.overlay=1;
+          gp1->flags.overlaid=1;
           break;
         }
       }
@@ -1843,10 +2124,11 @@ void DisplayCheckGraph() {
             gp->dcnt=0;
             gp->summ=0;
             gp->last_val=val;
+            AddGraph(count,gp->smin,gp->smax);
           } else {
             val=gp->last_val;
+            AddGraph(count,val,val);
           }
-          AddGraph(count,val);
         }
       }
     }
@@ -1868,23 +2150,19 @@ void Save_graph(uint8_t num, char *path) {
   fsp->remove(path);
   fp=fsp->open(path,FILE_WRITE);
   if (!fp) return;
-  char str[32];
-  sprintf_P(str,PSTR("%d\t%d\t%d\t"),gp->xcnt,gp->xs,gp->ys);
-  fp.print(str);
-  dtostrfd(gp->ymin,2,str);
-  fp.print(str);
-  fp.print("\t");
-  dtostrfd(gp->ymax,2,str);
-  fp.print(str);
-  fp.print("\t");
-  for (uint32_t count=0;count<gp->xs;count++) {
-    dtostrfd(gp->values[count],0,str);
-    fp.print(str);
-    fp.print("\t");
-  }
-  fp.print("\n");
+  GRAPH_FILE header = { GRAPH_MAGIC, gp->xs, gp->ys, gp->xcnt, gp->ymin, gp->ymax };
+  fp.write((uint8_t*)&header,sizeof(header));
+  // ring unrolled to oldest first, lowest values then highest values
+  uint8_t *ring=gp->vmin;
+  for (uint32_t part=0; part<2; part++) {
+    uint16_t first=tmin(gp->xcnt, gp->xs-gp->head);
+    fp.write(ring+gp->head,first);
+    fp.write(ring,gp->xcnt-first);
+    ring=gp->vmax;
+  }
   fp.close();
 }
+
 void Restore_graph(uint8_t num, char *path) {
   if (!renderer) return;
   uint16_t index=num%NUM_GRAPHS;
@@ -1893,29 +2171,45 @@ void Restore_graph(uint8_t num, char *path) {
   File fp;
   fp=fsp->open(path,FILE_READ);
   if (!fp) return;
-  char vbuff[32];
-  char *cp=vbuff;
-  uint8_t buf[2];
-  uint8_t findex=0;
-
-  for (uint32_t count=0;count<=gp->xs+4;count++) {
-    cp=vbuff;
-    findex=0;
-    while (fp.available()) {
-      fp.read(buf,1);
-      if (buf[0]=='\t' || buf[0]==',' || buf[0]=='\n' || buf[0]=='\r') {
-        break;
-      } else {
-        *cp++=buf[0];
-        findex++;
-        if (findex>=sizeof(vbuff)-1) break;
+  GRAPH_FILE header;
+  if ((sizeof(header) == fp.read((uint8_t*)&header,sizeof(header))) && (GRAPH_MAGIC == header.magic)) {
+    uint16_t xcnt=tmin(header.xcnt, gp->xs);
+    uint16_t skip=header.xcnt-xcnt;     // keep the newest if the graph got smaller
+    gp->head=0;
+    gp->xcnt=xcnt;
+    fp.seek(sizeof(header)+skip);
+    fp.read(gp->vmin,xcnt);
+    fp.seek(sizeof(header)+header.xcnt+skip);
+    fp.read(gp->vmax,xcnt);
+  } else {
+    // text file of previous versions
+    fp.seek(0);
+    char vbuff[32];
+    char *cp=vbuff;
+    uint8_t buf[2];
+    uint8_t findex=0;
+
+    gp->head=0;
+    for (uint32_t count=0;count<=gp->xs+4;count++) {
+      cp=vbuff;
+      findex=0;
+      while (fp.available()) {
+        fp.read(buf,1);
+        if (buf[0]=='\t' || buf[0]==',' || buf[0]=='\n' || buf[0]=='\r') {
+          break;
+        } else {
+          *cp++=buf[0];
+          findex++;
+          if (findex>=sizeof(vbuff)-1) break;
+        }
+      }
+      *cp=0;
+      if (count<=4) {
+        if (count==0) gp->xcnt=tmin(atoi(vbuff), gp->xs);
+      } else if (count-5<gp->xs) {
+        gp->vmin[count-5]=atoi(vbuff);
+        gp->vmax[count-5]=gp->vmin[count-5];
       }
-    }
-    *cp=0;
-    if (count<=4) {
-      if (count==0) gp->xcnt=atoi(vbuff);
-    } else {
-      gp->values[count-5]=atoi(vbuff);
     }
   }
   fp.close();
@@ -1934,66 +2228,56 @@ void RedrawGraph(uint8_t num, uint8_t flags) {
   if (!renderer) return;
 
   gp->flags.draw=1;
-  uint16_t linecol=fg_color;
-
-  if (color_type==COLOR_COLOR) {
-    linecol=renderer->GetColorFromIndex(gp->color_index);
-  }
+  renderer->invalidateText(gp->xp, gp->yp, gp->xs, gp->ys);
 
   if (!gp->flags.overlay) {
     // draw rectangle
     renderer->drawRect(gp->xp,gp->yp,gp->xs,gp->ys,fg_color);
     // clr inside
     ClrGraph(index);
+  } else {
+    GraphReset(gp);
   }
-
-  for (uint16_t count=0;count<gp->xs-1;count++) {
-    renderer->writeLine(gp->xp+count,gp->yp+gp->ys-gp->values[count]-1,gp->xp+count+1,gp->yp+gp->ys-gp->values[count+1]-1,linecol);
-  }
+  GraphDrawColumns(gp);
 }
 
-// add next value to graph
-void AddGraph(uint8_t num,uint8_t val) {
+// add next column to graph
+void AddGraph(uint8_t num, uint8_t vmin, uint8_t vmax) {
   struct GRAPH *gp=graph[num];
   if (!renderer) return;
 
-  uint16_t linecol=fg_color;
-  if (color_type==COLOR_COLOR) {
-    linecol=renderer->GetColorFromIndex(gp->color_index);
+  uint16_t index;
+  if (gp->xcnt<gp->xs) {
+    index=(gp->head+gp->xcnt)%gp->xs;
+    gp->xcnt++;
+  } else {
+    // full, overwrite the oldest column
+    index=gp->head;
+    gp->head=(gp->head+1)%gp->xs;
   }
-  gp->xcnt++;
-  if (gp->xcnt>gp->xs) {
-    gp->xcnt=gp->xs;
-    int16_t count;
-    // shift values
-    for (count=0;count<gp->xs-1;count++) {
-      gp->values[count]=gp->values[count+1];
-    }
-    gp->values[gp->xcnt-1]=val;
-
-    if (!gp->flags.draw) return;
-
-    // only redraw every second or longer
-    if (millis()-gp->last_ms_redrawn>1000) {
-      gp->last_ms_redrawn=millis();
-      // clr area and redraw graph
-      if (!gp->flags.overlay) {
-        // draw rectangle
-        renderer->drawRect(gp->xp,gp->yp,gp->xs,gp->ys,fg_color);
-        // clr inner and draw ticks
-        ClrGraph(num);
-      }
+  gp->vmin[index]=vmin;
+  gp->vmax[index]=vmax;
 
-      for (count=0;count<gp->xs-1;count++) {
-        renderer->writeLine(gp->xp+count,gp->yp+gp->ys-gp->values[count]-1,gp->xp+count+1,gp->yp+gp->ys-gp->values[count+1]-1,linecol);
-      }
+  if (!gp->flags.draw) return;
+
+  bool scrolled=(gp->xcnt>=gp->xs);
+  // only redraw a scrolled graph every second or longer
+  if (scrolled && (millis()-gp->last_ms_redrawn<=1000)) return;
+  gp->last_ms_redrawn=millis();
+  renderer->invalidateText(gp->xp, gp->yp, gp->xs, gp->ys);
+
+  if (scrolled && (gp->flags.overlay || gp->flags.overlaid)) {
+    // overlapping graphs can not erase their own old columns only
+    if (!gp->flags.overlay) {
+      // draw rectangle
+      renderer->drawRect(gp->xp,gp->yp,gp->xs,gp->ys,fg_color);
+      // clr inner and draw ticks
+      ClrGraph(num);
+    } else {
+      GraphReset(gp);
     }
-  } else {
-    // add value and draw a single line
-    gp->values[gp->xcnt]=val;
-    if (!gp->flags.draw) return;
-    renderer->writeLine(gp->xp+gp->xcnt-1,gp->yp+gp->ys-gp->values[gp->xcnt-1]-1,gp->xp+gp->xcnt,gp->yp+gp->ys-gp->values[gp->xcnt]-1,linecol);
   }
+  GraphDrawColumns(gp);
 }
 
 
@@ -2013,7 +2297,13 @@ void AddValue(uint8_t num,float fval) {
   if (val>gp->ys-1) val=gp->ys-1;
   if (val<0) val=0;
 
-  // summ values
+  // summ values and keep the extremes of the column
+  if (!gp->dcnt) {
+    gp->smin=val;
+    gp->smax=val;
+  }
+  if (val<gp->smin) gp->smin=val;
+  if (val>gp->smax) gp->smax=val;
   gp->summ+=val;
   gp->dcnt++;
 
@@ -2021,11 +2311,9 @@ void AddValue(uint8_t num,float fval) {
   if (gp->decimation<0) {
     if (gp->dcnt>=-gp->decimation) {
       gp->dcnt=0;
-      // calc average
-      val=gp->summ/-gp->decimation;
       gp->summ=0;
       // add to graph
-      AddGraph(num,val);
+      AddGraph(num,gp->smin,gp->smax);
     }
   }
 }
@@ -2043,6 +2331,7 @@ bool Xdrv13(uint8_t function)
     switch (function) {
       case FUNC_PRE_INIT:
         DisplayInitDriver();
+        XdrvSubscribe(FUNC_EVERY_50_MSECOND);
 #ifdef USE_GRAPH
         for (uint8_t count=0;count<NUM_GRAPHS;count++) {
           graph[count]=0;
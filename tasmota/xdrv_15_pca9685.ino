@@ -23,6 +23,13 @@
  * PCA9685 - 16-channel 12-bit pwm driver
  *
  * I2C Address: 0x40 .. 0x47
+ *
+ * Channel registers are written with auto increment. Changes are buffered by
+ * PCA9685_SetPWMBuffered() and PCA9685_Flush() writes the changed range in one I2C burst.
+ * driver15 pwm,<pin>,<pwm>[,<pwm>..] updates consecutive channels in one burst.
+ *
+ * With USE_PCA9685_LIGHT the first 1 to 5 channels are light channels, set by the light
+ * driver in one burst so all channels of a color change at the same time.
 \*********************************************************************************************/
 
 #define XDRV_15                     15
@@ -39,9 +46,18 @@
   #define USE_PCA9685_FREQ          50
 #endif
 
+#ifdef BUFFER_LENGTH
+const uint8_t PCA9685_BURST_CHANNELS = (BUFFER_LENGTH -1) / 4;      // Wire buffer holds register and 4 bytes per channel
+#elif defined(I2C_BUFFER_LENGTH)
+const uint8_t PCA9685_BURST_CHANNELS = (I2C_BUFFER_LENGTH -1) / 4;
+#else
+const uint8_t PCA9685_BURST_CHANNELS = 7;
+#endif
+
 bool pca9685_detected = false;
 uint16_t pca9685_freq = USE_PCA9685_FREQ;
 uint16_t pca9685_pin_pwm_value[16];
+uint16_t pca9685_pin_dirty = 0;             // Channels changed since the last PCA9685_Flush()
 
 void PCA9685_Detect(void)
 {
@@ -65,9 +81,10 @@ void PCA9685_Reset(void)
   I2cWrite8(USE_PCA9685_ADDR, PCA9685_REG_MODE1, 0x80);
   PCA9685_SetPWMfreq(USE_PCA9685_FREQ);
   for (uint32_t pin=0;pin<16;pin++) {
-    PCA9685_SetPWM(pin,0,false);
-    pca9685_pin_pwm_value[pin] = 0;
+    PCA9685_SetPWMBuffered(pin,0);
   }
+  pca9685_pin_dirty = 0xFFFF;               // Power up state is unknown after a reset
+  PCA9685_Flush();
   Response_P(PSTR("{\"PCA9685\":{\"RESET\":\"OK\"}}"));
 }
 
@@ -90,24 +107,76 @@ void PCA9685_SetPWMfreq(double freq) {
   I2cWrite8(USE_PCA9685_ADDR, PCA9685_REG_MODE1, current_mode1 | 0xA0); // Reset MODE1 register to original state and enable auto increment
 }
 
+void PCA9685_RegData(uint8_t *data, uint16_t on, uint16_t off) {
+  data[0] = on;
+  data[1] = on >> 8;
+  data[2] = off;
+  data[3] = off >> 8;
+}
+
 void PCA9685_SetPWM_Reg(uint8_t pin, uint16_t on, uint16_t off) {
-  uint8_t led_reg = PCA9685_REG_LED0_ON_L + 4 * pin;
-  uint32_t led_data = 0;
-  I2cWrite8(USE_PCA9685_ADDR, led_reg, on);
-  I2cWrite8(USE_PCA9685_ADDR, led_reg+1, (on >> 8));
-  I2cWrite8(USE_PCA9685_ADDR, led_reg+2, off);
-  I2cWrite8(USE_PCA9685_ADDR, led_reg+3, (off >> 8));
+  uint8_t led_data[4];
+  PCA9685_RegData(led_data, on, off);
+  I2cWriteBuffer(USE_PCA9685_ADDR, PCA9685_REG_LED0_ON_L + 4 * pin, led_data, sizeof(led_data));
+}
+
+void PCA9685_SetPWMBuffered(uint8_t pin, uint16_t pwm) {
+  if (pin > 15) { return; }
+  if (pca9685_pin_pwm_value[pin] != pwm) {
+    pca9685_pin_pwm_value[pin] = pwm;
+    pca9685_pin_dirty |= (1 << pin);
+  }
+}
+
+void PCA9685_Flush(void) {
+  // Write channels from the first to the last changed one in bursts of up to PCA9685_BURST_CHANNELS
+  while (pca9685_pin_dirty) {
+    uint32_t first = __builtin_ctz(pca9685_pin_dirty);
+    uint32_t last = 31 - __builtin_clz(pca9685_pin_dirty);
+    if (last - first >= PCA9685_BURST_CHANNELS) { last = first + PCA9685_BURST_CHANNELS -1; }
+    uint8_t led_data[4 * PCA9685_BURST_CHANNELS];
+    for (uint32_t pin = first; pin <= last; pin++) {
+      uint16_t pwm = pca9685_pin_pwm_value[pin];
+      // Special use additional bit causes channel to turn on completely without PWM
+      PCA9685_RegData(&led_data[4 * (pin - first)], (4096 == pwm) ? 4096 : 0, (4096 == pwm) ? 0 : pwm);
+      pca9685_pin_dirty &= ~(1 << pin);
+    }
+    I2cWriteBuffer(USE_PCA9685_ADDR, PCA9685_REG_LED0_ON_L + 4 * first, led_data, 4 * (last - first +1));
+  }
 }
 
 void PCA9685_SetPWM(uint8_t pin, uint16_t pwm, bool inverted) {
-  if (4096 == pwm) {
-    PCA9685_SetPWM_Reg(pin, 4096, 0); // Special use additional bit causes channel to turn on completely without PWM
-  } else {
-    PCA9685_SetPWM_Reg(pin, 0, pwm);
+  PCA9685_SetPWMBuffered(pin, pwm);
+  PCA9685_Flush();
+}
+
+#ifdef USE_LIGHT
+#ifdef USE_PCA9685_LIGHT
+bool PCA9685_ModuleSelected(void) {
+  if (!I2cEnabled(XI2C_01)) { return false; }
+  PCA9685_Detect();                       // Wire is started before FUNC_MODULE_INIT
+  if (!pca9685_detected) { return false; }
+  const uint8_t light_types[] = { LT_SERIAL1, LT_SERIAL2, LT_RGB, LT_RGBW, LT_RGBWC };
+  uint32_t channels = (USE_PCA9685_LIGHT < 1) ? 1 : (USE_PCA9685_LIGHT > LST_MAX) ? LST_MAX : USE_PCA9685_LIGHT;
+  devices_present++;
+  if (Settings.flag3.pwm_multi_channels) {  // SetOption68 - Enable multi-channels PWM instead of Color PWM
+    devices_present += channels -1;         // Each channel is a dimmer as done by LightModuleInit()
   }
-  pca9685_pin_pwm_value[pin] = pwm;
+  light_type = light_types[channels -1];
+  return true;
 }
 
+bool PCA9685_SetChannels(void) {
+  uint8_t *cur_col = (uint8_t*)XdrvMailbox.data;
+  for (uint32_t i = 0; i < (light_type & 7); i++) {
+    PCA9685_SetPWMBuffered(i, changeUIntScale(cur_col[i], 0, 255, 0, 4095));
+  }
+  PCA9685_Flush();
+  return true;
+}
+#endif  // USE_PCA9685_LIGHT
+#endif  // USE_LIGHT
+
 bool PCA9685_Command(void)
 {
   bool serviced = true;
@@ -161,7 +230,12 @@ bool PCA9685_Command(void)
         }
         uint16_t pwm = atoi(subStr(sub_string, XdrvMailbox.data, ",", 3));
         if ((pin >= 0 && pin <= 15) && (pwm >= 0 && pwm <= 4096)) {
-          PCA9685_SetPWM(pin, pwm, false);
+          // Further values set the next channels, all written in one burst
+          for (uint32_t param = 3; (param <= paramcount) && (pin + param -3 <= 15); param++) {
+            uint16_t value = atoi(subStr(sub_string, XdrvMailbox.data, ",", param));
+            PCA9685_SetPWMBuffered(pin + param -3, (value > 4096) ? 4096 : value);
+          }
+          PCA9685_Flush();
           Response_P(PSTR("{\"PCA9685\":{\"PIN\":%i,\"PWM\":%i}}"),pin,pwm);
           serviced = true;
           return serviced;
@@ -193,8 +267,18 @@ bool Xdrv15(uint8_t function)
   if (FUNC_INIT == function) {
     PCA9685_Detect();
   }
+#if defined(USE_LIGHT) && defined(USE_PCA9685_LIGHT)
+  else if (FUNC_MODULE_INIT == function) {
+    result = PCA9685_ModuleSelected();
+  }
+#endif  // USE_LIGHT && USE_PCA9685_LIGHT
   else if (pca9685_detected) {
     switch (function) {
+#if defined(USE_LIGHT) && defined(USE_PCA9685_LIGHT)
+      case FUNC_SET_CHANNELS:
+        result = PCA9685_SetChannels();
+        break;
+#endif  // USE_LIGHT && USE_PCA9685_LIGHT
       case FUNC_EVERY_SECOND:
         if (tele_period == 0) {
           PCA9685_OutputTelemetry(true);
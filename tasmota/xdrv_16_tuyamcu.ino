@@ -49,24 +49,36 @@
 #define TUYA_TYPE_ENUM         0x04
 
 #define TUYA_BUFFER_SIZE       256
+#define TUYA_DP_CACHE_SIZE     16        // Last received value of DP ids
+#define TUYA_SEND_QUEUE_SIZE   8         // Pending DP updates to MCU
+#define TUYA_SEND_PACING       50        // mSec between DP updates to MCU
 
 #include <TasmotaSerial.h>
 
 TasmotaSerial *TuyaSerial = nullptr;
 
+struct TUYA_DP {
+  uint8_t id;                            // DP id, 0 is unused
+  uint8_t type;
+  uint32_t value;                        // Bool, enum or value data, hash of other data
+};
+
 struct TUYA {
   uint16_t new_dim = 0;                   // Tuya dimmer value temp
   bool ignore_dim = false;               // Flag to skip serial send to prevent looping when processing inbound states from the faceplate interaction
-  uint8_t cmd_status = 0;                // Current status of serial-read
-  uint8_t cmd_checksum = 0;              // Checksum of tuya command
-  uint8_t data_len = 0;                  // Data lenght of command
   uint8_t wifi_state = -2;                // Keep MCU wifi-status in sync with WifiState()
   uint8_t heartbeat_timer = 0;           // 10 second heartbeat timer for tuya module
 #ifdef USE_ENERGY_SENSOR
   uint32_t lastPowerCheckTime = 0;       // Time when last power was checked
 #endif // USE_ENERGY_SENSOR
   char *buffer = nullptr;                // Serial receive buffer
-  int byte_counter = 0;                  // Index in serial receive buffer
+  int rx_count = 0;                      // Bytes in serial receive buffer
+  int byte_counter = 0;                  // Length of frame at the start of serial receive buffer
+  TUYA_DP dp_cache[TUYA_DP_CACHE_SIZE];  // Last state received from or sent to MCU
+  uint32_t dp_changed = 0;               // Bit per DP of received state frame set when changed
+  TUYA_DP send_queue[TUYA_SEND_QUEUE_SIZE];
+  uint8_t send_count = 0;
+  uint32_t send_time = 0;                // Time next queued DP update may be sent
   bool low_power_mode = false;           // Normal or Low power mode protocol
   bool send_success_next_second = false; // Second command success in low power mode
   uint32_t ignore_dimmer_cmd_timeout = 0;// Time until which received dimmer commands should be ignored
@@ -295,35 +307,142 @@ void TuyaSendCmd(uint8_t cmd, uint8_t payload[] = nullptr, uint16_t payload_len
   AddLog(LOG_LEVEL_DEBUG);
 }
 
-void TuyaSendState(uint8_t id, uint8_t type, uint8_t* value)
+/*********************************************************************************************\
+ * DP state cache
+ *
+ * The MCU repeats unchanged state, often many times per second while a slider moves. Only DP
+ * values differing from the last value received from or sent to the MCU are acted upon.
+\*********************************************************************************************/
+
+uint32_t TuyaDpValue(uint8_t type, const uint8_t *data, uint16_t len)
+{
+  if (((TUYA_TYPE_BOOL == type) || (TUYA_TYPE_ENUM == type)) && (1 == len)) {
+    return data[0];
+  }
+  if ((TUYA_TYPE_VALUE == type) && (4 == len)) {
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | (uint32_t)data[3];
+  }
+  return GetHash((const char*)data, len);
+}
+
+bool TuyaDpCacheUpdate(uint8_t id, uint8_t type, uint32_t value)
+{
+  // Returns true if the DP value changed
+  uint32_t free_slot = TUYA_DP_CACHE_SIZE;
+  for (uint32_t i = 0; i < TUYA_DP_CACHE_SIZE; i++) {
+    if (id == Tuya.dp_cache[i].id) {
+      if ((type == Tuya.dp_cache[i].type) && (value == Tuya.dp_cache[i].value)) { return false; }
+      Tuya.dp_cache[i].type = type;
+      Tuya.dp_cache[i].value = value;
+      return true;
+    }
+    if (!Tuya.dp_cache[i].id && (TUYA_DP_CACHE_SIZE == free_slot)) { free_slot = i; }
+  }
+  if (free_slot < TUYA_DP_CACHE_SIZE) {  // No room means always changed
+    Tuya.dp_cache[free_slot].id = id;
+    Tuya.dp_cache[free_slot].type = type;
+    Tuya.dp_cache[free_slot].value = value;
+  }
+  return true;
+}
+
+void TuyaDpCacheClear(void)
+{
+  // Act on the next state of all DPs as after MCU restart or state request
+  memset(Tuya.dp_cache, 0, sizeof(Tuya.dp_cache));
+}
+
+uint32_t TuyaDpCheck(void)
+{
+  // Returns bit per DP of received state frame set when changed
+  uint32_t changed = 0;
+  uint32_t dp_index = 0;
+  uint8_t dpidStart = 6;
+  while (dpidStart + 4 < Tuya.byte_counter) {
+    uint16_t dpDataLen = Tuya.buffer[dpidStart + 2] << 8 | Tuya.buffer[dpidStart + 3];
+    uint8_t dpDataType = Tuya.buffer[dpidStart + 1];
+    uint32_t value = TuyaDpValue(dpDataType, (uint8_t*)&Tuya.buffer[dpidStart + 4], dpDataLen);
+    if (TuyaDpCacheUpdate(Tuya.buffer[dpidStart], dpDataType, value) && (dp_index < 32)) {
+      changed |= (1 << dp_index);
+    }
+    dp_index++;
+    dpidStart += dpDataLen + 4;
+  }
+  if (dp_index > 32) { changed = 0xFFFFFFFF; }  // Too many to track
+  return changed;
+}
+
+/*********************************************************************************************\
+ * DP update queue
+ *
+ * DP updates are paced to the MCU. A queued update of a DP id is replaced by a newer one, so
+ * only the last dimmer value of a fast moving slider is sent.
+\*********************************************************************************************/
+
+void TuyaSendDp(struct TUYA_DP *dp)
 {
   uint16_t payload_len = 4;
   uint8_t payload_buffer[8];
-  payload_buffer[0] = id;
-  payload_buffer[1] = type;
-  switch (type) {
+  payload_buffer[0] = dp->id;
+  payload_buffer[1] = dp->type;
+  switch (dp->type) {
     case TUYA_TYPE_BOOL:
     case TUYA_TYPE_ENUM:
       payload_len += 1;
       payload_buffer[2] = 0x00;
       payload_buffer[3] = 0x01;
-      payload_buffer[4] = value[0];
+      payload_buffer[4] = dp->value;
       break;
     case TUYA_TYPE_VALUE:
       payload_len += 4;
       payload_buffer[2] = 0x00;
       payload_buffer[3] = 0x04;
-      payload_buffer[4] = value[3];
-      payload_buffer[5] = value[2];
-      payload_buffer[6] = value[1];
-      payload_buffer[7] = value[0];
+      payload_buffer[4] = dp->value >> 24;
+      payload_buffer[5] = dp->value >> 16;
+      payload_buffer[6] = dp->value >> 8;
+      payload_buffer[7] = dp->value;
       break;
 
   }
 
+  TuyaDpCacheUpdate(dp->id, dp->type, dp->value);
   TuyaSendCmd(TUYA_CMD_SET_DP, payload_buffer, payload_len);
 }
 
+void TuyaSendQueued(void)
+{
+  if (!Tuya.send_count || !TimeReached(Tuya.send_time)) { return; }
+
+  TuyaSendDp(&Tuya.send_queue[0]);
+  Tuya.send_count--;
+  memmove(&Tuya.send_queue[0], &Tuya.send_queue[1], Tuya.send_count * sizeof(TUYA_DP));
+  Tuya.send_time = millis() + TUYA_SEND_PACING;
+}
+
+void TuyaSendState(uint8_t id, uint8_t type, uint8_t* value)
+{
+  uint32_t dp_value = (TUYA_TYPE_VALUE == type) ? *(uint32_t*)value : value[0];
+
+  uint32_t i;
+  for (i = 0; i < Tuya.send_count; i++) {
+    if (id == Tuya.send_queue[i].id) {
+      AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR("TYA: Replace queued dpId=%d value=%d"), id, Tuya.send_queue[i].value);
+      break;
+    }
+  }
+  if (i == TUYA_SEND_QUEUE_SIZE) {
+    Tuya.send_time = millis();       // Queue full so send oldest now
+    TuyaSendQueued();
+    i = Tuya.send_count;
+  }
+  if (i == Tuya.send_count) { Tuya.send_count++; }
+  Tuya.send_queue[i].id = id;
+  Tuya.send_queue[i].type = type;
+  Tuya.send_queue[i].value = dp_value;
+
+  TuyaSendQueued();
+}
+
 void TuyaSendBool(uint8_t id, bool value)
 {
   TuyaSendState(id, TUYA_TYPE_BOOL, (uint8_t*)&value);
@@ -367,8 +486,7 @@ bool TuyaSetPower(void)
   if (dpid == 0) dpid = TuyaGetDpId(TUYA_MCU_FUNC_REL1_INV + active_device - 1);
 
   if (source != SRC_SWITCH && TuyaSerial) {  // ignore to prevent loop from pushing state from faceplate interaction
-    TuyaSendBool(dpid, bitRead(rpower, active_device-1) ^ bitRead(rel_inverted, active_device-1));
-    delay(20); // Hack when power is off and dimmer is set then both commands go too soon to Serial out.
+    TuyaSendBool(dpid, bitRead(rpower, active_device-1) ^ bitRead(rel_inverted, active_device-1));  // Paced with a following dimmer command
     status = true;
   }
   return status;
@@ -407,6 +525,7 @@ void TuyaRequestState(void)
     // Get current status of MCU
     AddLog_P(LOG_LEVEL_DEBUG, PSTR("TYA: Read MCU state"));
 
+    TuyaDpCacheClear();
     TuyaSendCmd(TUYA_CMD_QUERY_STATE);
   }
 }
@@ -425,11 +544,20 @@ void TuyaProcessStatePacket(void) {
   uint8_t dpidStart = 6;
   uint8_t fnId;
   uint16_t dpDataLen;
+  uint32_t dp_index = 0;
 
   while (dpidStart + 4 < Tuya.byte_counter) {
     dpDataLen = Tuya.buffer[dpidStart + 2] << 8 | Tuya.buffer[dpidStart + 3];
     fnId = TuyaGetFuncId(Tuya.buffer[dpidStart]);
 
+    bool energy = (fnId >= TUYA_MCU_FUNC_POWER) && (fnId <= TUYA_MCU_FUNC_VOLTAGE);  // Every update counts for energy today
+    if (!energy && (dp_index < 32) && !bitRead(Tuya.dp_changed, dp_index)) {
+      dp_index++;
+      dpidStart += dpDataLen + 4;
+      continue;                          // Unchanged state
+    }
+    dp_index++;
+
     AddLog_P2(LOG_LEVEL_DEBUG, PSTR("TYA: fnId=%d is set for dpId=%d"), fnId, Tuya.buffer[dpidStart]);
     // if (TuyaFuncIdValid(fnId)) {
       if (Tuya.buffer[dpidStart + 1] == 1) {  // Data Type 1
@@ -540,6 +668,7 @@ void TuyaNormalPowerModePacketProcess(void)
       if (Tuya.buffer[6] == 0) {
         AddLog_P(LOG_LEVEL_DEBUG, PSTR("TYA: Detected MCU restart"));
         Tuya.wifi_state = -2;
+        TuyaDpCacheClear();
         #ifdef USE_TUYA_TIME
         TuyaSetTime();
         #endif
@@ -655,107 +784,118 @@ void TuyaInit(void)
   Tuya.heartbeat_timer = 0; // init heartbeat timer when dimmer init is done
 }
 
-void TuyaSerialInput(void)
+void TuyaPublishFrame(void)
 {
-  while (TuyaSerial->available()) {
-    yield();
-    uint8_t serial_in_byte = TuyaSerial->read();
-
-    if (serial_in_byte == 0x55) {            // Start TUYA Packet
-      Tuya.cmd_status = 1;
-      Tuya.buffer[Tuya.byte_counter++] = serial_in_byte;
-      Tuya.cmd_checksum += serial_in_byte;
-    }
-    else if (Tuya.cmd_status == 1 && serial_in_byte == 0xAA) { // Only packtes with header 0x55AA are valid
-      Tuya.cmd_status = 2;
+  char hex_char[(Tuya.byte_counter * 2) + 2];
+  uint16_t len = Tuya.buffer[4] << 8 | Tuya.buffer[5];
+  Response_P(PSTR("{\"" D_JSON_TUYA_MCU_RECEIVED "\":{\"Data\":\"%s\",\"Cmnd\":%d"), ToHex_P((unsigned char*)Tuya.buffer, Tuya.byte_counter, hex_char, sizeof(hex_char)), Tuya.buffer[3]);
+
+  if (len > 0) {
+    ResponseAppend_P(PSTR(",\"CmndData\":\"%s\""), ToHex_P((unsigned char*)&Tuya.buffer[6], len, hex_char, sizeof(hex_char)));
+    if (TUYA_CMD_STATE == Tuya.buffer[3]) {
+      //55 AA 03 07 00 0D 01 04 00 01 02 02 02 00 04 00 00 00 1A 40
+      // 0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15 16 17 18 19
+      uint8_t dpidStart = 6;
+      while (dpidStart + 4 < Tuya.byte_counter) {
+        uint8_t dpId = Tuya.buffer[dpidStart];
+        uint8_t dpDataType = Tuya.buffer[dpidStart + 1];
+        uint16_t dpDataLen = Tuya.buffer[dpidStart + 2] << 8 | Tuya.buffer[dpidStart + 3];
+        const unsigned char *dpData = (unsigned char*)&Tuya.buffer[dpidStart + 4];
+        const char *dpHexData = ToHex_P(dpData, dpDataLen, hex_char, sizeof(hex_char));
 
-      Tuya.byte_counter = 0;
-      Tuya.buffer[Tuya.byte_counter++] = 0x55;
-      Tuya.buffer[Tuya.byte_counter++] = 0xAA;
-      Tuya.cmd_checksum = 0xFF;
-    }
-    else if (Tuya.cmd_status == 2) {
-      if (Tuya.byte_counter == 5) { // Get length of data
-        Tuya.cmd_status = 3;
-        Tuya.data_len = serial_in_byte;
+        if (TUYA_CMD_STATE == Tuya.buffer[3]) {
+          ResponseAppend_P(PSTR(",\"DpType%uId%u\":"), dpDataType, dpId);
+          if (TUYA_TYPE_BOOL == dpDataType && dpDataLen == 1) {
+            ResponseAppend_P(PSTR("%u"), dpData[0]);
+          } else if (TUYA_TYPE_VALUE == dpDataType && dpDataLen == 4) {
+            uint32_t dpValue = (uint32_t)dpData[0] << 24 | (uint32_t)dpData[1] << 16 | (uint32_t)dpData[2] << 8 | (uint32_t)dpData[3] << 0;
+            ResponseAppend_P(PSTR("%u"), dpValue);
+          } else if (TUYA_TYPE_STRING == dpDataType) {
+            ResponseAppend_P(PSTR("\"%.*s\""), dpDataLen, dpData);
+          } else if (TUYA_TYPE_ENUM == dpDataType && dpDataLen == 1) {
+            ResponseAppend_P(PSTR("%u"), dpData[0]);
+          } else {
+            ResponseAppend_P(PSTR("\"0x%s\""), dpHexData);
+          }
+        }
+
+        ResponseAppend_P(PSTR(",\"%d\":{\"DpId\":%d,\"DpIdType\":%d,\"DpIdData\":\"%s\""), dpId, dpId, dpDataType, dpHexData);
+        if (TUYA_TYPE_STRING == dpDataType) {
+          ResponseAppend_P(PSTR(",\"Type3Data\":\"%.*s\""), dpDataLen, dpData);
+        }
+        ResponseAppend_P(PSTR("}"));
+        dpidStart += dpDataLen + 4;
       }
-      Tuya.cmd_checksum += serial_in_byte;
-      Tuya.buffer[Tuya.byte_counter++] = serial_in_byte;
     }
-    else if ((Tuya.cmd_status == 3) && (Tuya.byte_counter == (6 + Tuya.data_len)) && (Tuya.cmd_checksum == serial_in_byte)) { // Compare checksum and process packet
-      Tuya.buffer[Tuya.byte_counter++] = serial_in_byte;
+  }
 
-      char hex_char[(Tuya.byte_counter * 2) + 2];
-      uint16_t len = Tuya.buffer[4] << 8 | Tuya.buffer[5];
-      Response_P(PSTR("{\"" D_JSON_TUYA_MCU_RECEIVED "\":{\"Data\":\"%s\",\"Cmnd\":%d"), ToHex_P((unsigned char*)Tuya.buffer, Tuya.byte_counter, hex_char, sizeof(hex_char)), Tuya.buffer[3]);
+  ResponseAppend_P(PSTR("}}"));
 
-      if (len > 0) {
-        ResponseAppend_P(PSTR(",\"CmndData\":\"%s\""), ToHex_P((unsigned char*)&Tuya.buffer[6], len, hex_char, sizeof(hex_char)));
-        if (TUYA_CMD_STATE == Tuya.buffer[3]) {
-          //55 AA 03 07 00 0D 01 04 00 01 02 02 02 00 04 00 00 00 1A 40
-          // 0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15 16 17 18 19
-          uint8_t dpidStart = 6;
-          while (dpidStart + 4 < Tuya.byte_counter) {
-            uint8_t dpId = Tuya.buffer[dpidStart];
-            uint8_t dpDataType = Tuya.buffer[dpidStart + 1];
-            uint16_t dpDataLen = Tuya.buffer[dpidStart + 2] << 8 | Tuya.buffer[dpidStart + 3];
-            const unsigned char *dpData = (unsigned char*)&Tuya.buffer[dpidStart + 4];
-            const char *dpHexData = ToHex_P(dpData, dpDataLen, hex_char, sizeof(hex_char));
-
-            if (TUYA_CMD_STATE == Tuya.buffer[3]) {
-              ResponseAppend_P(PSTR(",\"DpType%uId%u\":"), dpDataType, dpId);
-              if (TUYA_TYPE_BOOL == dpDataType && dpDataLen == 1) {
-                ResponseAppend_P(PSTR("%u"), dpData[0]);
-              } else if (TUYA_TYPE_VALUE == dpDataType && dpDataLen == 4) {
-                uint32_t dpValue = (uint32_t)dpData[0] << 24 | (uint32_t)dpData[1] << 16 | (uint32_t)dpData[2] << 8 | (uint32_t)dpData[3] << 0;
-                ResponseAppend_P(PSTR("%u"), dpValue);
-              } else if (TUYA_TYPE_STRING == dpDataType) {
-                ResponseAppend_P(PSTR("\"%.*s\""), dpDataLen, dpData);
-              } else if (TUYA_TYPE_ENUM == dpDataType && dpDataLen == 1) {
-                ResponseAppend_P(PSTR("%u"), dpData[0]);
-              } else {
-                ResponseAppend_P(PSTR("\"0x%s\""), dpHexData);
-              }
-            }
+  if (Settings.flag3.tuya_serial_mqtt_publish) {  // SetOption66 - Enable TuyaMcuReceived messages over Mqtt
+    MqttPublishPrefixTopic_P(RESULT_OR_TELE, PSTR(D_JSON_TUYA_MCU_RECEIVED));
+  } else {
+    AddLog_P(LOG_LEVEL_DEBUG, mqtt_data);
+  }
+  XdrvRulesProcess();
+}
 
-            ResponseAppend_P(PSTR(",\"%d\":{\"DpId\":%d,\"DpIdType\":%d,\"DpIdData\":\"%s\""), dpId, dpId, dpDataType, dpHexData);
-            if (TUYA_TYPE_STRING == dpDataType) {
-              ResponseAppend_P(PSTR(",\"Type3Data\":\"%.*s\""), dpDataLen, dpData);
-            }
-            ResponseAppend_P(PSTR("}"));
-            dpidStart += dpDataLen + 4;
-          }
-        }
-      }
+void TuyaProcessFrame(void)
+{
+  // Frame of Tuya.byte_counter bytes at the start of Tuya.buffer
+  bool state = (Tuya.low_power_mode) ? (TUYA_LOW_POWER_CMD_STATE == Tuya.buffer[3]) : (TUYA_CMD_STATE == Tuya.buffer[3]);
+  Tuya.dp_changed = (state) ? TuyaDpCheck() : 0;
 
-      ResponseAppend_P(PSTR("}}"));
+  if (!state || Tuya.dp_changed) {     // Skip repeated unchanged state
+    TuyaPublishFrame();
+  }
 
-      if (Settings.flag3.tuya_serial_mqtt_publish) {  // SetOption66 - Enable TuyaMcuReceived messages over Mqtt
-        MqttPublishPrefixTopic_P(RESULT_OR_TELE, PSTR(D_JSON_TUYA_MCU_RECEIVED));
-      } else {
-        AddLog_P(LOG_LEVEL_DEBUG, mqtt_data);
-      }
-      XdrvRulesProcess();
+  if (!Tuya.low_power_mode) {
+    TuyaNormalPowerModePacketProcess();
+  } else {
+    TuyaLowPowerModePacketProcess();
+  }
+}
 
-      if (!Tuya.low_power_mode) {
-        TuyaNormalPowerModePacketProcess();
-      } else {
-        TuyaLowPowerModePacketProcess();
-      }
+void TuyaConsume(uint32_t count)
+{
+  Tuya.rx_count -= count;
+  memmove(Tuya.buffer, Tuya.buffer + count, Tuya.rx_count);
+}
 
-      Tuya.byte_counter = 0;
-      Tuya.cmd_status = 0;
-      Tuya.cmd_checksum = 0;
-      Tuya.data_len = 0;
-    }                               // read additional packets from TUYA
-    else if (Tuya.byte_counter < TUYA_BUFFER_SIZE -1) {  // add char to string if it still fits
-      Tuya.buffer[Tuya.byte_counter++] = serial_in_byte;
-      Tuya.cmd_checksum += serial_in_byte;
+void TuyaSerialInput(void)
+{
+  // Append all received bytes and process every complete frame
+  // 55 AA <version> <cmd> <length hi> <length lo> <data ...> <checksum>
+  if (Tuya.rx_count < TUYA_BUFFER_SIZE) {
+    Tuya.rx_count += TuyaSerial->read((uint8_t*)Tuya.buffer + Tuya.rx_count, TUYA_BUFFER_SIZE - Tuya.rx_count);
+  }
+
+  while (Tuya.rx_count) {
+    uint32_t start = 0;
+    while ((start < Tuya.rx_count) && ((Tuya.buffer[start] != 0x55) ||
+           ((start +1 < Tuya.rx_count) && (Tuya.buffer[start +1] != 0xAA)))) {
+      start++;                           // Skip until header 0x55AA
+    }
+    if (start) { TuyaConsume(start); }
+    if (Tuya.rx_count < 7) { return; }  // Wait for header
+
+    uint32_t frame_len = 7 + ((uint8_t)Tuya.buffer[4] << 8 | (uint8_t)Tuya.buffer[5]);
+    if (frame_len > TUYA_BUFFER_SIZE) {
+      TuyaConsume(1);                    // Can not be a frame so rescan
+      continue;
+    }
+    if (Tuya.rx_count < frame_len) { return; }  // Wait for rest of frame
+
+    uint8_t checksum = 0;
+    for (uint32_t i = 0; i < frame_len -1; i++) {
+      checksum += Tuya.buffer[i];        // 0x55 + 0xAA = 0xFF as checksum start value
+    }
+    if (checksum == (uint8_t)Tuya.buffer[frame_len -1]) {
+      Tuya.byte_counter = frame_len;
+      TuyaProcessFrame();
+      TuyaConsume(frame_len);
     } else {
-      Tuya.byte_counter = 0;
-      Tuya.cmd_status = 0;
-      Tuya.cmd_checksum = 0;
-      Tuya.data_len = 0;
+      TuyaConsume(1);                    // Not a frame or corrupted so rescan
     }
   }
 }
@@ -856,13 +996,17 @@ bool Xdrv16(uint8_t function)
   if (TUYA_DIMMER == my_module_type) {
     switch (function) {
       case FUNC_LOOP:
-        if (TuyaSerial) { TuyaSerialInput(); }
+        if (TuyaSerial) {
+          TuyaSerialInput();
+          TuyaSendQueued();
+        }
         break;
       case FUNC_MODULE_INIT:
         result = TuyaModuleSelected();
         break;
       case FUNC_PRE_INIT:
         TuyaInit();
+        XdrvSubscribe(FUNC_LOOP);
         break;
       case FUNC_SET_DEVICE_POWER:
         result = TuyaSetPower();
@@ -20,6 +20,15 @@
 #ifdef USE_RC_SWITCH
 /*********************************************************************************************\
  * RF send and receive using RCSwitch library https://github.com/sui77/rc-switch/
+ *
+ * The receive interrupt only decodes the protocols enabled by RfProtocol and drops a code
+ * identical to the last one within RfTimeOut mS so a remote repeating a code per press results
+ * in one message. Decoded codes are kept in a ring drained every 50 mS. With RfCapture 1 a pulse
+ * train too long to decode is published as RfRaw timings.
+ *
+ * RfProtocol 0x1FF - Bit mask of protocols to decode, 0 decodes all
+ * RfTimeOut 1000   - mS an identical code is ignored, 0 restores RF_TIME_AVOID_DUPLICATE
+ * RfCapture 1      - Publish pulse trains too long to decode
 \*********************************************************************************************/
 
 #define XDRV_17             17
@@ -32,53 +41,80 @@
 #define D_JSON_RF_PULSE "Pulse"
 #define D_JSON_RF_REPEAT "Repeat"
 
+#define D_CMND_RFPROTOCOL "RfProtocol"
+#define D_CMND_RFTIMEOUT "RfTimeOut"
+#define D_CMND_RFCAPTURE "RfCapture"
+#define D_JSON_RF_PULSES "Pulses"
+
 const char kRfSendCommands[] PROGMEM = "|"  // No prefix
   D_CMND_RFSEND;
 
 void (* const RfSendCommand[])(void) PROGMEM = {
   &CmndRfSend };
 
+const char kRfReceiveCommands[] PROGMEM = "|"  // No prefix
+  D_CMND_RFPROTOCOL "|" D_CMND_RFTIMEOUT "|" D_CMND_RFCAPTURE;
+
+void (* const RfReceiveCommand[])(void) PROGMEM = {
+  &CmndRfProtocol, &CmndRfTimeOut, &CmndRfCapture };
+
 #include <RCSwitch.h>
 
 RCSwitch mySwitch = RCSwitch();
 
 #define RF_TIME_AVOID_DUPLICATE 1000  // Milliseconds
 
-uint32_t rf_lasttime = 0;
+void RfReceiveRaw(void)
+{
+  unsigned int *timings = mySwitch.getRawData();
+  uint32_t length = mySwitch.getRawLength();
+  ResponseTime_P(PSTR(",\"" D_CMND_RFRAW "\":{\"" D_JSON_RF_PULSES "\":%d,\"" D_JSON_RF_DATA "\":\""), length);
+  for (uint32_t i = 0; i < length; i++) {
+    ResponseAppend_P(PSTR("%s%u"), (i) ? "," : "", timings[i]);
+  }
+  ResponseAppend_P(PSTR("\"}}"));
+  mySwitch.resetRawAvailable();
+  MqttPublishPrefixTopic_P(RESULT_OR_TELE, PSTR(D_CMND_RFRAW));
+}
 
 void RfReceiveCheck(void)
 {
-  if (mySwitch.available()) {
+  if (mySwitch.rawAvailable()) {
+    RfReceiveRaw();
+  }
+  while (mySwitch.available()) {  // Drain the codes received since the last check
 
     unsigned long data = mySwitch.getReceivedValue();
     unsigned int bits = mySwitch.getReceivedBitlength();
     int protocol = mySwitch.getReceivedProtocol();
     int delay = mySwitch.getReceivedDelay();
+    mySwitch.resetAvailable();
 
     AddLog_P2(LOG_LEVEL_DEBUG, PSTR("RFR: Data 0x%lX (%u), Bits %d, Protocol %d, Delay %d"), data, data, bits, protocol, delay);
 
-    uint32_t now = millis();
-    if ((now - rf_lasttime > RF_TIME_AVOID_DUPLICATE) && (data > 0)) {
-      rf_lasttime = now;
-
-      char stemp[16];
-      if (Settings.flag.rf_receive_decimal) {      // SetOption28 - RF receive data format (0 = hexadecimal, 1 = decimal)
-        snprintf_P(stemp, sizeof(stemp), PSTR("%u"), (uint32_t)data);
-      } else {
-        snprintf_P(stemp, sizeof(stemp), PSTR("\"0x%lX\""), (uint32_t)data);
-      }
-      ResponseTime_P(PSTR(",\"" D_JSON_RFRECEIVED "\":{\"" D_JSON_RF_DATA "\":%s,\"" D_JSON_RF_BITS "\":%d,\"" D_JSON_RF_PROTOCOL "\":%d,\"" D_JSON_RF_PULSE "\":%d}}"),
-        stemp, bits, protocol, delay);
-      MqttPublishPrefixTopic_P(RESULT_OR_TELE, PSTR(D_JSON_RFRECEIVED));
-      XdrvRulesProcess();
+    char stemp[16];
+    if (Settings.flag.rf_receive_decimal) {      // SetOption28 - RF receive data format (0 = hexadecimal, 1 = decimal)
+      snprintf_P(stemp, sizeof(stemp), PSTR("%u"), (uint32_t)data);
+    } else {
+      snprintf_P(stemp, sizeof(stemp), PSTR("\"0x%lX\""), (uint32_t)data);
+    }
+    ResponseTime_P(PSTR(",\"" D_JSON_RFRECEIVED "\":{\"" D_JSON_RF_DATA "\":%s,\"" D_JSON_RF_BITS "\":%d,\"" D_JSON_RF_PROTOCOL "\":%d,\"" D_JSON_RF_PULSE "\":%d}}"),
+      stemp, bits, protocol, delay);
+    MqttPublishPrefixTopic_P(RESULT_OR_TELE, PSTR(D_JSON_RFRECEIVED));
+    XdrvRulesProcess();
 #ifdef USE_DOMOTICZ
-      DomoticzSensor(DZ_COUNT, data);  // Send data as Domoticz Counter value
+    DomoticzSensor(DZ_COUNT, data);  // Send data as Domoticz Counter value
 #endif  // USE_DOMOTICZ
-    }
-    mySwitch.resetAvailable();
   }
 }
 
+void RfReceiveConfig(void)
+{
+  mySwitch.setReceiveProtocolMask(Settings.rf_protocol_mask);
+  mySwitch.setReceiveDuplicateWindow((Settings.rf_duplicate_time) ? Settings.rf_duplicate_time : RF_TIME_AVOID_DUPLICATE);
+  mySwitch.enableRawCapture(Settings.rf_raw_capture);
+}
+
 void RfInit(void)
 {
   if (PinUsed(GPIO_RFSEND)) {
@@ -86,6 +122,7 @@ void RfInit(void)
   }
   if (PinUsed(GPIO_RFRECV)) {
     pinMode( Pin(GPIO_RFRECV), INPUT);
+    RfReceiveConfig();
     mySwitch.enableReceive(Pin(GPIO_RFRECV));
   }
 }
@@ -107,7 +144,7 @@ void CmndRfSend(void)
 
     char dataBufUc[XdrvMailbox.data_len + 1];
     UpperCase(dataBufUc, XdrvMailbox.data);
-    StaticJsonBuffer<150> jsonBuf;  // ArduinoJSON entry used to calculate jsonBuf: JSON_OBJECT_SIZE(5) + 40 = 134
+    JsonTempBuffer<150> jsonBuf;  // ArduinoJSON entry used to calculate jsonBuf: JSON_OBJECT_SIZE(5) + 40 = 134
     JsonObject &root = jsonBuf.parseObject(dataBufUc);
     if (root.success()) {
       // RFsend {"data":0x501014,"bits":24,"protocol":1,"repeat":10,"pulse":350}
@@ -162,6 +199,33 @@ void CmndRfSend(void)
   }
 }
 
+void CmndRfProtocol(void)
+{
+  if (XdrvMailbox.data_len) {
+    Settings.rf_protocol_mask = strtoul(XdrvMailbox.data, nullptr, 0);  // Allow decimal and hexadecimal (0x1FF) input
+    RfReceiveConfig();
+  }
+  Response_P(PSTR("{\"%s\":\"0x%03X\"}"), XdrvMailbox.command, Settings.rf_protocol_mask);
+}
+
+void CmndRfTimeOut(void)
+{
+  if ((XdrvMailbox.payload >= 0) && (XdrvMailbox.payload <= 0xFFFF)) {
+    Settings.rf_duplicate_time = XdrvMailbox.payload;
+    RfReceiveConfig();
+  }
+  ResponseCmndNumber((Settings.rf_duplicate_time) ? Settings.rf_duplicate_time : RF_TIME_AVOID_DUPLICATE);
+}
+
+void CmndRfCapture(void)
+{
+  if ((XdrvMailbox.payload >= 0) && (XdrvMailbox.payload <= 1)) {
+    Settings.rf_raw_capture = XdrvMailbox.payload;
+    RfReceiveConfig();
+  }
+  ResponseCmndStateText(Settings.rf_raw_capture);
+}
+
 /*********************************************************************************************\
  * Interface
 \*********************************************************************************************/
@@ -181,9 +245,13 @@ bool Xdrv17(uint8_t function)
         if (PinUsed(GPIO_RFSEND)) {
           result = DecodeCommand(kRfSendCommands, RfSendCommand);
         }
+        if (!result && PinUsed(GPIO_RFRECV)) {
+          result = DecodeCommand(kRfReceiveCommands, RfReceiveCommand);
+        }
         break;
       case FUNC_INIT:
         RfInit();
+        XdrvSubscribe(FUNC_EVERY_50_MSECOND);
         break;
     }
   }
@@ -178,6 +178,7 @@ bool Xdrv18(uint8_t function)
         break;
       case FUNC_INIT:
         ArmtronixInit();
+        XdrvSubscribe(FUNC_LOOP);
         break;
       case FUNC_EVERY_SECOND:
         if (ArmtronixSerial) {
@@ -221,6 +221,7 @@ bool Xdrv19(uint8_t function)
         break;
       case FUNC_INIT:
         PS16DZInit();
+        XdrvSubscribe(FUNC_LOOP);
         break;
       case FUNC_MODULE_INIT:
         result = PS16DZModuleSelected();
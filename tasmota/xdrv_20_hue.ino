@@ -161,13 +161,9 @@ const char HUE_DESCRIPTION_XML[] PROGMEM =
   "</root>\r\n"
   "\r\n";
 
-//%s"alert":"none","effect":"none","reachable":true}
-//Successfully compressed from 50 to 34 bytes (-32%)
-// const size_t HUE_LIGHTS_STATUS_JSON1_SUFFIX_size = 50;
-// const char HUE_LIGHTS_STATUS_JSON1_SUFFIX[] PROGMEM = "\x3E\xBC\x7B\x2C\x27\xFA\x3D\x87\x99\xEC\xEC\xE6\x7B\x0E\xA3\xD8\xCC\x18\x61\x82"
-//                              "\x34\xCF\xBB\x0C\x55\x8E\x09\x9E\xC3\xCE\xBE\x2D\x9E\xE3";
+//"alert":"none","effect":"none","reachable":true}
 const char HUE_LIGHTS_STATUS_JSON1_SUFFIX[] PROGMEM =
-  "%s\"alert\":\"none\","
+  "\"alert\":\"none\","
   "\"effect\":\"none\","
   "\"reachable\":true}";
 
@@ -185,16 +181,17 @@ const char HUE_LIGHTS_STATUS_JSON2[] PROGMEM =
   "\"manufacturername\":\"%s\","
   "\"uniqueid\":\"%s\"}";
 
-//{"name":"Group 0","lights":[{l1],"type":"LightGroup","action":
-//Successfully compressed from 62 to 61 bytes (-1.6%)
-const char HUE_GROUP0_STATUS_JSON[] PROGMEM =
+//{"name":"Group 0","lights":["1"
+const char HUE_GROUP0_STATUS_JSON1[] PROGMEM =
   "{\"name\":\"Group 0\","
-   "\"lights\":[{l1],"
-   "\"type\":\"LightGroup\","
+   "\"lights\":[\"1\"";
+//],"type":"LightGroup","action":
+const char HUE_GROUP0_STATUS_JSON2[] PROGMEM =
+   "],\"type\":\"LightGroup\","
    "\"action\":";
 //     "\"scene\":\"none\",";
 
-//{"name":"Philips hue","mac":"{ma","dhcp":true,"ipaddress":"{ip","netmask":"{ms","gateway":"{gw","proxyaddress":"none","proxyport":0,"bridgeid":"{br","UTC":"{dt","whitelist":{"{id":{"last use date":"{dt","create date":"{dt","name":"Remote"}},"swversion":"01041302","apiversion":"1.17.0","swupdate":{"updatestate":0,"url":"","text":"","notify": false},"linkbutton":false,"portalservices":false}
+//{"name":"Philips hue","mac":"%s","dhcp":true,"ipaddress":"%s","netmask":"%s","gateway":"%s","proxyaddress":"none","proxyport":0,"bridgeid":"%s","UTC":"%s","whitelist":{"%s":{"last use date":"%s","create date":"%s","name":"Remote"}},"swversion":"01041302","apiversion":"1.17.0","swupdate":{"updatestate":0,"url":"","text":"","notify": false},"linkbutton":false,"portalservices":false}
 //Successfully compressed from 392 to 302 bytes (-23%)
 // const size_t HueConfigResponse_JSON_size = 392;
 // const char HueConfigResponse_JSON[] PROGMEM = "\x3D\xA7\xB3\xAC\x6B\x3D\x87\x99\xEC\x21\x82\xB4\x2D\x19\xE4\x28\x5B\x3D\x87\x51"
@@ -215,18 +212,18 @@ const char HUE_GROUP0_STATUS_JSON[] PROGMEM =
 //                              "\x67\xB8";
 const char HueConfigResponse_JSON[] PROGMEM =
   "{\"name\":\"Philips hue\","
-   "\"mac\":\"{ma\","
+   "\"mac\":\"%s\","
    "\"dhcp\":true,"
-   "\"ipaddress\":\"{ip\","
-   "\"netmask\":\"{ms\","
-   "\"gateway\":\"{gw\","
+   "\"ipaddress\":\"%s\","
+   "\"netmask\":\"%s\","
+   "\"gateway\":\"%s\","
    "\"proxyaddress\":\"none\","
    "\"proxyport\":0,"
-   "\"bridgeid\":\"{br\","
-   "\"UTC\":\"{dt\","
-   "\"whitelist\":{\"{id\":{"
-     "\"last use date\":\"{dt\","
-     "\"create date\":\"{dt\","
+   "\"bridgeid\":\"%s\","
+   "\"UTC\":\"%s\","
+   "\"whitelist\":{\"%s\":{"
+     "\"last use date\":\"%s\","
+     "\"create date\":\"%s\","
      "\"name\":\"Remote\"}},"
    "\"swversion\":\"01041302\","
    "\"apiversion\":\"1.17.0\","
@@ -259,11 +256,12 @@ String GetHueUserId(void)
 void HandleUpnpSetupHue(void)
 {
   AddLog_P(LOG_LEVEL_DEBUG, S_LOG_HTTP, PSTR(D_HUE_BRIDGE_SETUP));
-  String description_xml = FPSTR(HUE_DESCRIPTION_XML);
-  description_xml.replace("{x1", WiFi.localIP().toString());
-  description_xml.replace("{x2", HueUuid());
-  description_xml.replace("{x3", HueSerialnumber());
-  WSSend(200, CT_XML, description_xml);
+  char ip[16];
+  strlcpy(ip, WiFi.localIP().toString().c_str(), sizeof(ip));
+  String uuid = HueUuid();
+  String serial = HueSerialnumber();
+  const char* values[] = { ip, uuid.c_str(), serial.c_str() };
+  WSSendFill_P(200, CT_XML, HUE_DESCRIPTION_XML, values, ARRAY_SIZE(values));
 }
 
 void HueNotImplemented(String *path)
@@ -273,23 +271,25 @@ void HueNotImplemented(String *path)
   WSSend(200, CT_JSON, "{}");
 }
 
-void HueConfigResponse(String *response)
+void HueConfigResponse(void)
 {
-  *response += FPSTR(HueConfigResponse_JSON);
-  response->replace("{ma", WiFi.macAddress());
-  response->replace("{ip", WiFi.localIP().toString());
-  response->replace("{ms", WiFi.subnetMask().toString());
-  response->replace("{gw", WiFi.gatewayIP().toString());
-  response->replace("{br", HueBridgeId());
-  response->replace("{dt", GetDateAndTime(DT_UTC));
-  response->replace("{id", GetHueUserId());
+  char ip[16];
+  char netmask[16];
+  char gateway[16];
+  char date[24];
+  strlcpy(ip, WiFi.localIP().toString().c_str(), sizeof(ip));
+  strlcpy(netmask, WiFi.subnetMask().toString().c_str(), sizeof(netmask));
+  strlcpy(gateway, WiFi.gatewayIP().toString().c_str(), sizeof(gateway));
+  strlcpy(date, GetDateAndTime(DT_UTC).c_str(), sizeof(date));
+  WSContentSend_P(HueConfigResponse_JSON, WiFi.macAddress().c_str(), ip, netmask, gateway,
+    HueBridgeId().c_str(), date, GetHueUserId().c_str(), date, date);
 }
 
 void HueConfig(String *path)
 {
-  String response = "";
-  HueConfigResponse(&response);
-  WSSend(200, CT_JSON, response);
+  WSContentBegin(200, CT_JSON);
+  HueConfigResponse();
+  WSContentEnd();
 }
 
 // device is forced to CT mode instead of HSB
@@ -322,11 +322,10 @@ uint8_t getLocalLightSubtype(uint8_t device) {
   }
 }
 
-void HueLightStatus1(uint8_t device, String *response)
+void HueLightStatus1(uint8_t device)
 {
   uint16_t ct = 0;
   uint8_t  color_mode;
-  String light_status = "";
   uint16_t hue = 0;
   uint8_t  sat = 0;
   uint8_t  bri = 254;
@@ -379,34 +378,30 @@ void HueLightStatus1(uint8_t device, String *response)
     //  hue, sat, bri, prev_hue, prev_sat, prev_bri);
   }
 
-  const size_t buf_size = 256;
-  char * buf = (char*) malloc(buf_size);     // temp buffer for strings, avoid stack
-
-  snprintf_P(buf, buf_size, PSTR("{\"on\":%s,"), (power & (1 << (device-1))) ? "true" : "false");
+  WSContentSend_P(PSTR("{\"on\":%s,"), (power & (1 << (device-1))) ? "true" : "false");
   // Brightness for all devices with PWM
   if ((1 == echo_gen) || (LST_SINGLE <= local_light_subtype)) { // force dimmer for 1st gen Echo
-    snprintf_P(buf, buf_size, PSTR("%s\"bri\":%d,"), buf, bri);
+    WSContentSend_P(PSTR("\"bri\":%d,"), bri);
   }
   if (LST_COLDWARM <= local_light_subtype) {
-    snprintf_P(buf, buf_size, PSTR("%s\"colormode\":\"%s\","), buf, g_gotct ? "ct" : "hs");
+    WSContentSend_P(PSTR("\"colormode\":\"%s\","), g_gotct ? "ct" : "hs");
   }
   if (LST_RGB <= local_light_subtype) {  // colors
     if (prev_x_str[0] && prev_y_str[0]) {
-      snprintf_P(buf, buf_size, PSTR("%s\"xy\":[%s,%s],"), buf, prev_x_str, prev_y_str);
+      WSContentSend_P(PSTR("\"xy\":[%s,%s],"), prev_x_str, prev_y_str);
     } else {
       float x, y;
       light_state.getXY(&x, &y);
-      snprintf_P(buf, buf_size, PSTR("%s\"xy\":[%s,%s],"), buf, String(x, 5).c_str(), String(y, 5).c_str());
+      char x_str[FLOATSZ];
+      char y_str[FLOATSZ];
+      WSContentSend_P(PSTR("\"xy\":[%s,%s],"), dtostrfd(x, 5, x_str), dtostrfd(y, 5, y_str));
     }
-    snprintf_P(buf, buf_size, PSTR("%s\"hue\":%d,\"sat\":%d,"), buf, hue, sat);
+    WSContentSend_P(PSTR("\"hue\":%d,\"sat\":%d,"), hue, sat);
   }
   if (LST_COLDWARM == local_light_subtype || LST_RGBW <= local_light_subtype) {  // white temp
-    snprintf_P(buf, buf_size, PSTR("%s\"ct\":%d,"), buf, ct > 0 ? ct : 284);
+    WSContentSend_P(PSTR("\"ct\":%d,"), ct > 0 ? ct : 284);
   }
-  snprintf_P(buf, buf_size, HUE_LIGHTS_STATUS_JSON1_SUFFIX, buf);
-
-  *response += buf;
-  free(buf);
+  WSContentSend_P(HUE_LIGHTS_STATUS_JSON1_SUFFIX);
 }
 
 // Check whether this device should be reported to Alexa or considered hidden.
@@ -416,10 +411,8 @@ bool HueActive(uint8_t device) {
   return '$' != *SettingsText(SET_FRIENDLYNAME1 +device -1);
 }
 
-void HueLightStatus2(uint8_t device, String *response)
+void HueLightStatus2(uint8_t device)
 {
-  const size_t buf_size = 300;
-  char * buf = (char*) malloc(buf_size);
   const size_t max_name_len = 32;
   char fname[max_name_len + 1];
 
@@ -436,13 +429,11 @@ void HueLightStatus2(uint8_t device, String *response)
     }
     fname[fname_len] = 0x00;
   }
-  snprintf_P(buf, buf_size, HUE_LIGHTS_STATUS_JSON2,
+  WSContentSend_P(HUE_LIGHTS_STATUS_JSON2,
             EscapeJSONString(fname).c_str(),
             EscapeJSONString(Settings.user_template_name).c_str(),
             PSTR("Tasmota"),
             GetHueDeviceId(device).c_str());
-  *response += buf;
-  free(buf);
 }
 
 // generate a unique lightId mixing local IP address and device number
@@ -509,9 +500,12 @@ static const char * FIRST_GEN_UA[] = {  // list of User-Agents signature
   "AEOBC",                              // Echo Dot 2ng Generation
 };
 
+uint8_t hue_echo_gen = 0;               // Echo generation of the current request, 0 if not known yet
+
 // Check if the Echo device is of 1st generation, which triggers different results
 uint32_t findEchoGeneration(void) {
   // result is 1 for 1st gen, 2 for 2nd gen and further
+  if (hue_echo_gen) { return hue_echo_gen; }    // same for all the lights of a request
   String user_agent = Webserver->header("User-Agent");
   uint32_t gen = 2;
 
@@ -527,23 +521,23 @@ uint32_t findEchoGeneration(void) {
 
   AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR(D_LOG_HTTP D_HUE " User-Agent: %s, gen=%d"), user_agent.c_str(), gen);  // Header collection is set in xdrv_01_webserver.ino, in StartWebserver()
 
+  hue_echo_gen = gen;
   return gen;
 }
 
 void HueGlobalConfig(String *path) {
-  String response;
-
   path->remove(0,1);                                 // cut leading / to get <id>
-  response = F("{\"lights\":{");
+  WSContentBegin(200, CT_JSON);                      // stream the lights as they are rendered
+  WSContentSend_P(PSTR("{\"lights\":{"));
   bool appending = false;                             // do we need to add a comma to append
-  CheckHue(&response, appending);
+  CheckHue(appending);
 #ifdef USE_ZIGBEE
-  ZigbeeCheckHue(&response, appending);
+  ZigbeeCheckHue(appending);
 #endif // USE_ZIGBEE
-  response += F("},\"groups\":{},\"schedules\":{},\"config\":");
-  HueConfigResponse(&response);
-  response += "}";
-  WSSend(200, CT_JSON, response);
+  WSContentSend_P(PSTR("},\"groups\":{},\"schedules\":{},\"config\":"));
+  HueConfigResponse();
+  WSContentSend_P(PSTR("}"));
+  WSContentEnd();
 }
 
 void HueAuthentication(String *path)
@@ -555,54 +549,66 @@ void HueAuthentication(String *path)
   AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR(D_LOG_HTTP D_HUE " Authentication Result (%s)"), response);
 }
 
+// Send content of any size in the chunked response
+void HueContentSend(const String &content) {
+  if (content.length() < sizeof(mqtt_data)) {
+    WSContentSend_P(PSTR("%s"), content.c_str());   // coalesced in the chunk buffer
+  } else {
+    WSContentFlush();
+    _WSContentSend(content);
+  }
+}
+
+// Send the "<id>":<light> entry of the lights list
+void HueContentSendLight(bool &appending, uint32_t light_id, const char * light) {
+  WSContentSend_P(PSTR("%s\"%u\":"), appending ? "," : "", light_id);
+  if (strlen(light) < sizeof(mqtt_data)) {
+    WSContentSend_P(PSTR("%s"), light);
+  } else {
+    WSContentFlush();
+    _WSContentSend(light, strlen(light));
+  }
+  appending = true;
+}
+
 // refactored to remove code duplicates
-void CheckHue(String * response, bool &appending) {
+void CheckHue(bool &appending) {
   uint8_t maxhue = (devices_present > MAX_HUE_DEVICES) ? MAX_HUE_DEVICES : devices_present;
   for (uint32_t i = 1; i <= maxhue; i++) {
     if (HueActive(i)) {
-      if (appending) { *response += ","; }
-      *response += "\"";
-      *response += EncodeLightId(i);
-      *response += F("\":{\"state\":");
-      HueLightStatus1(i, response);
-      HueLightStatus2(i, response);
+      WSContentSend_P(PSTR("%s\"%u\":{\"state\":"), appending ? "," : "", EncodeLightId(i));
+      HueLightStatus1(i);
+      HueLightStatus2(i);
       appending = true;
     }
   }
 }
 
-void HueLightsCommand(uint8_t device, uint32_t device_id, String &response) {
+void HueLightsCommand(uint8_t device, uint32_t device_id) {
   uint16_t tmp = 0;
   uint16_t hue = 0;
   uint8_t  sat = 0;
   uint8_t  bri = 254;
   uint16_t ct = 0;
   bool on = false;
-  bool resp = false;  // is the response non null (add comma between parameters)
+  bool resp = false;  // is the response non null (add comma between parameters, "[" before the first)
   bool change = false;  // need to change a parameter to the light
   uint8_t local_light_subtype = getLocalLightSubtype(device); // get the subtype for this device
 
-  const size_t buf_size = 100;
-  char * buf = (char*) malloc(buf_size);
-
   if (Webserver->args()) {
-    response = "[";
-
-    StaticJsonBuffer<300> jsonBuffer;
+    JsonTempBuffer<300> jsonBuffer;
     JsonObject &hue_json = jsonBuffer.parseObject(Webserver->arg((Webserver->args())-1));
     if (hue_json.containsKey("on")) {
       on = hue_json["on"];
-      snprintf_P(buf, buf_size,
-                 PSTR("{\"success\":{\"/lights/%d/state/on\":%s}}"),
-                 device_id, on ? "true" : "false");
 
 #ifdef USE_SHUTTER
       if (ShutterState(device)) {
         if (!change) {
           bri = on ? 1.0f : 0.0f; // when bri is not part of this request then calculate it
           change = true;
+          WSContentSend_P(PSTR("%s{\"success\":{\"/lights/%d/state/on\":%s}}"),
+                          (resp) ? "," : "[", device_id, on ? "true" : "false");  // actually publish the state
           resp = true;
-          response += buf;        // actually publish the state
         }
       } else {
 #endif
@@ -616,7 +622,8 @@ void HueLightsCommand(uint8_t device, uint32_t device_id, String &response) {
         }
 */
         ExecuteCommandPower(device, (on) ? POWER_ON : POWER_OFF, SRC_HUE);
-        response += buf;
+        WSContentSend_P(PSTR("%s{\"success\":{\"/lights/%d/state/on\":%s}}"),
+                        (resp) ? "," : "[", device_id, on ? "true" : "false");
         resp = true;
 #ifdef USE_SHUTTER
       }
@@ -641,11 +648,8 @@ void HueLightsCommand(uint8_t device, uint32_t device_id, String &response) {
     if (hue_json.containsKey("bri")) {             // Brightness is a scale from 1 (the minimum the light is capable of) to 254 (the maximum). Note: a brightness of 1 is not off.
       bri = hue_json["bri"];
       prev_bri = bri;   // store command value
-      if (resp) { response += ","; }
-      snprintf_P(buf, buf_size,
-                 PSTR("{\"success\":{\"/lights/%d/state/%s\":%d}}"),
-                 device_id, "bri", bri);
-      response += buf;
+      WSContentSend_P(PSTR("%s{\"success\":{\"/lights/%d/state/%s\":%d}}"),
+                      (resp) ? "," : "[", device_id, "bri", bri);
       if (LST_SINGLE <= Light.subtype) {
         // extend bri value if set to max
         if (254 <= bri) { bri = 255; }
@@ -668,11 +672,8 @@ void HueLightsCommand(uint8_t device, uint32_t device_id, String &response) {
       prev_hue = changeUIntScale(hue, 0, 360, 0, 65535);  // calculate back prev_hue
       prev_sat = (sat > 254 ? 254 : sat);
       //AddLog_P2(LOG_LEVEL_DEBUG_MORE, "XY RGB (%d %d %d) HS (%d %d)", rr,gg,bb,hue,sat);
-      if (resp) { response += ","; }
-      snprintf_P(buf, buf_size,
-                 PSTR("{\"success\":{\"/lights/%d/state/xy\":[%s,%s]}}"),
-                 device_id, prev_x_str, prev_y_str);
-      response += buf;
+      WSContentSend_P(PSTR("%s{\"success\":{\"/lights/%d/state/xy\":[%s,%s]}}"),
+                      (resp) ? "," : "[", device_id, prev_x_str, prev_y_str);
       g_gotct = false;
       resp = true;
       change = true;
@@ -680,11 +681,8 @@ void HueLightsCommand(uint8_t device, uint32_t device_id, String &response) {
     if (hue_json.containsKey("hue")) {             // The hue value is a wrapping value between 0 and 65535. Both 0 and 65535 are red, 25500 is green and 46920 is blue.
       hue = hue_json["hue"];
       prev_hue = hue;
-      if (resp) { response += ","; }
-      snprintf_P(buf, buf_size,
-                 PSTR("{\"success\":{\"/lights/%d/state/%s\":%d}}"),
-                 device_id, "hue", hue);
-      response += buf;
+      WSContentSend_P(PSTR("%s{\"success\":{\"/lights/%d/state/%s\":%d}}"),
+                      (resp) ? "," : "[", device_id, "hue", hue);
       if (LST_RGB <= Light.subtype) {
         // change range from 0..65535 to 0..360
         hue = changeUIntScale(hue, 0, 65535, 0, 360);
@@ -696,11 +694,8 @@ void HueLightsCommand(uint8_t device, uint32_t device_id, String &response) {
     if (hue_json.containsKey("sat")) {             // Saturation of the light. 254 is the most saturated (colored) and 0 is the least saturated (white).
       sat = hue_json["sat"];
       prev_sat = sat;   // store command value
-      if (resp) { response += ","; }
-      snprintf_P(buf, buf_size,
-                 PSTR("{\"success\":{\"/lights/%d/state/%s\":%d}}"),
-                 device_id, "sat", sat);
-      response += buf;
+      WSContentSend_P(PSTR("%s{\"success\":{\"/lights/%d/state/%s\":%d}}"),
+                      (resp) ? "," : "[", device_id, "sat", sat);
       if (LST_RGB <= Light.subtype) {
         // extend sat value if set to max
         if (254 <= sat) { sat = 255; }
@@ -712,11 +707,8 @@ void HueLightsCommand(uint8_t device, uint32_t device_id, String &response) {
     if (hue_json.containsKey("ct")) {  // Color temperature 153 (Cold) to 500 (Warm)
       ct = hue_json["ct"];
       prev_ct = ct;   // store commande value
-      if (resp) { response += ","; }
-      snprintf_P(buf, buf_size,
-                 PSTR("{\"success\":{\"/lights/%d/state/%s\":%d}}"),
-                 device_id, "ct", ct);
-      response += buf;
+      WSContentSend_P(PSTR("%s{\"success\":{\"/lights/%d/state/%s\":%d}}"),
+                      (resp) ? "," : "[", device_id, "ct", ct);
       if ((LST_COLDWARM == Light.subtype) || (LST_RGBW <= Light.subtype)) {
         g_gotct = true;
         change = true;
@@ -750,15 +742,12 @@ void HueLightsCommand(uint8_t device, uint32_t device_id, String &response) {
       }
       change = false;
     }
-    response += "]";
-    if (2 == response.length()) {
-      response = FPSTR(HUE_ERROR_JSON);
-    }
   }
-  else {
-    response = FPSTR(HUE_ERROR_JSON);
+  if (resp) {
+    WSContentSend_P(PSTR("]"));
+  } else {
+    WSContentSend_P(HUE_ERROR_JSON);
   }
-  free(buf);
 }
 
 void HueLights(String *path)
@@ -774,16 +763,21 @@ void HueLights(String *path)
 
   path->remove(0,path->indexOf(F("/lights")));          // Remove until /lights
   if (path->endsWith(F("/lights"))) {                   // Got /lights
-    response = "{";
+    WSContentBegin(200, CT_JSON);                       // stream the lights as they are rendered
+    WSContentSend_P(PSTR("{"));
     bool appending = false;
-    CheckHue(&response, appending);
+    CheckHue(appending);
 #ifdef USE_ZIGBEE
-    ZigbeeCheckHue(&response, appending);
+    ZigbeeCheckHue(appending);
 #endif // USE_ZIGBEE
 #ifdef USE_SCRIPT_HUE
     Script_Check_Hue(&response);
+    HueContentSend(response);
 #endif
-    response += "}";
+    WSContentSend_P(PSTR("}"));
+    WSContentEnd();
+    AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR(D_LOG_HTTP D_HUE " Result streamed"));
+    return;
   }
   else if (path->endsWith(F("/state"))) {               // Got ID/state
     path->remove(0,8);                               // Remove /lights/
@@ -803,10 +797,13 @@ void HueLights(String *path)
       return Script_Handle_Hue(path);
     }
 #endif
+    WSContentBegin(200, CT_JSON);
     if ((device >= 1) || (device <= maxhue)) {
-      HueLightsCommand(device, device_id, response);
+      HueLightsCommand(device, device_id);
     }
-
+    WSContentEnd();
+    AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR(D_LOG_HTTP D_HUE " Result streamed"));
+    return;
   }
   else if(path->indexOf(F("/lights/")) >= 0) {          // Got /lights/ID
     AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR("/lights path=%s"), path->c_str());
@@ -832,9 +829,13 @@ void HueLights(String *path)
     if ((device < 1) || (device > maxhue)) {
       device = 1;
     }
-    response += F("{\"state\":");
-    HueLightStatus1(device, &response);
-    HueLightStatus2(device, &response);
+    WSContentBegin(200, CT_JSON);
+    WSContentSend_P(PSTR("{\"state\":"));
+    HueLightStatus1(device);
+    HueLightStatus2(device);
+    WSContentEnd();
+    AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR(D_LOG_HTTP D_HUE " Result streamed"));
+    return;
   }
   else {
     response = "{}";
@@ -850,29 +851,27 @@ void HueGroups(String *path)
 /*
  * http://tasmota/api/username/groups?1={"name":"Woonkamer","lights":[],"type":"Room","class":"Living room"})
  */
-  String response = "{}";
   uint8_t maxhue = (devices_present > MAX_HUE_DEVICES) ? MAX_HUE_DEVICES : devices_present;
   //AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR(D_LOG_HTTP D_HUE " HueGroups (%s)"), path->c_str());
 
+  WSContentBegin(200, CT_JSON);
   if (path->endsWith("/0")) {
-    response = FPSTR(HUE_GROUP0_STATUS_JSON);
-    String lights = F("\"1\"");
+    WSContentSend_P(HUE_GROUP0_STATUS_JSON1);
     for (uint32_t i = 2; i <= maxhue; i++) {
-      lights += ",\"";
-      lights += EncodeLightId(i);
-      lights += "\"";
+      WSContentSend_P(PSTR(",\"%u\""), EncodeLightId(i));
     }
-
 #ifdef USE_ZIGBEE
-    ZigbeeHueGroups(&response);
+    ZigbeeHueGroups();
 #endif // USE_ZIGBEE
-    response.replace("{l1", lights);
-    HueLightStatus1(1, &response);
-    response += F("}");
+    WSContentSend_P(HUE_GROUP0_STATUS_JSON2);
+    HueLightStatus1(1);
+    WSContentSend_P(PSTR("}"));
+  } else {
+    WSContentSend_P(PSTR("{}"));
   }
+  WSContentEnd();
 
   AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR(D_LOG_HTTP D_HUE " HueGroups Result (%s)"), path->c_str());
-  WSSend(200, CT_JSON, response);
 }
 
 void HandleHueApi(String *path)
@@ -889,8 +888,10 @@ void HandleHueApi(String *path)
    * http://tasmota/api/username/lights/1/state with arg plain={"on":true,"hue":56100,"sat":254,"bri":254,"alert":"none","transitiontime":40}
    */
 
+  WEB_STAT(WEB_STAT_HUE);
   uint8_t args = 0;
 
+  hue_echo_gen = 0;                                  // new request, find the Echo generation again
   path->remove(0, 4);                                // remove /api
   uint16_t apilen = path->length();
   AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR(D_LOG_HTTP D_HUE_API " (%s)"), path->c_str());         // HTP: Hue API (//lights/1/state
@@ -308,7 +308,7 @@ void HandleUpnpService(void)
 #if defined(USE_RULES_COMPRESSION) || defined(USE_SCRIPT_COMPRESSION)
   WSSend(200, CT_PLAIN, Decompress(WEMO_EVENTSERVICE_XML, WEMO_EVENTSERVICE_XML_SIZE));
 #else
-  WSSend(200, CT_PLAIN, FPSTR(WEMO_EVENTSERVICE_XML));
+  WSSend_P(200, CT_PLAIN, WEMO_EVENTSERVICE_XML);
 #endif
 }
 
@@ -319,7 +319,7 @@ void HandleUpnpMetaService(void)
 #if defined(USE_RULES_COMPRESSION) || defined(USE_SCRIPT_COMPRESSION)
   WSSend(200, CT_PLAIN, Decompress(WEMO_METASERVICE_XML, WEMO_METASERVICE_XML_SIZE));
 #else
-  WSSend(200, CT_PLAIN, FPSTR(WEMO_METASERVICE_XML));
+  WSSend_P(200, CT_PLAIN, WEMO_METASERVICE_XML);
 #endif
 }
 
@@ -327,15 +327,15 @@ void HandleUpnpSetupWemo(void)
 {
   AddLog_P(LOG_LEVEL_DEBUG, S_LOG_HTTP, PSTR(D_WEMO_SETUP));
 
+  String uuid = WemoUuid();
+  String serial = WemoSerialnumber();
+  const char* values[] = { SettingsText(SET_FRIENDLYNAME1), uuid.c_str(), serial.c_str() };
 #if defined(USE_RULES_COMPRESSION) || defined(USE_SCRIPT_COMPRESSION)
   String setup_xml = Decompress(WEMO_SETUP_XML, WEMO_SETUP_XML_SIZE);
+  WSSendFill_P(200, CT_XML, setup_xml.c_str(), values, ARRAY_SIZE(values));
 #else
-  String setup_xml = FPSTR(WEMO_SETUP_XML);
+  WSSendFill_P(200, CT_XML, WEMO_SETUP_XML, values, ARRAY_SIZE(values));
 #endif
-  setup_xml.replace("{x1", SettingsText(SET_FRIENDLYNAME1));
-  setup_xml.replace("{x2", WemoUuid());
-  setup_xml.replace("{x3", WemoSerialnumber());
-  WSSend(200, CT_XML, setup_xml);
 }
 
 /*********************************************************************************************\
@@ -262,6 +262,9 @@ bool Xdrv22(uint8_t function)
       case FUNC_MODULE_INIT:
         result = SonoffIfanInit();
         break;
+      case FUNC_PRE_INIT:
+        XdrvSubscribe(FUNC_EVERY_250_MSECOND);
+        break;
     }
   }
   return result;
@@ -49,6 +49,32 @@ uint8_t  Z_GetLastEndpoint(void) { return gZbLastMessage.endpoint; }
 \*********************************************************************************************/
 
 const size_t endpoints_max = 8;         // we limit to 8 endpoints
+#ifndef ZIGBEE_HUE_CACHE_SIZE
+#ifdef ESP32
+#define ZIGBEE_HUE_CACHE_SIZE     16384 // max bytes of rendered Hue lights kept for Alexa discovery
+#else
+#define ZIGBEE_HUE_CACHE_SIZE     4096
+#endif
+#endif
+const size_t Z_LQI_HISTORY = 8;         // number of LinkQuality values kept per device
+const uint32_t Z_STATS_RESPONSE_TIMEOUT = 10000;    // ms, stop waiting for the response to a command
+
+// Link and traffic statistics, not stored in Flash
+typedef struct Z_DeviceStats {
+  uint8_t               lqi[Z_LQI_HISTORY];   // last LinkQuality values, oldest first once lqi_count reached Z_LQI_HISTORY
+  uint8_t               lqi_count;      // number of values in lqi, up to Z_LQI_HISTORY
+  uint8_t               lqi_next;       // index of the next value in lqi
+  uint8_t               pending_seq;    // transaction number of the command waiting for a response
+  uint32_t              pending_sent;   // millis() when the command was sent, 0 if none
+  uint32_t              last_seen;      // uptime in seconds of the last frame received
+  uint32_t              received;       // frames received from the device
+  uint32_t              sent;           // frames sent to the device
+  uint32_t              confirm_fail;   // AF_DATA_CONFIRM failures or missing confirms
+  uint32_t              latency_total;  // sum of round-trip latencies in ms
+  uint32_t              latency_count;  // number of round-trip latencies measured
+  uint16_t              latency_last;   // last round-trip latency in ms
+  uint16_t              latency_max;    // max round-trip latency in ms
+} Z_DeviceStats;
 
 typedef struct Z_Device {
   uint64_t              longaddr;       // 0x00 means unspecified
@@ -56,9 +82,10 @@ typedef struct Z_Device {
   char *                modelId;
   char *                friendlyName;
   uint8_t               endpoints[endpoints_max];   // static array to limit memory consumption, list of endpoints until 0x00 or end of array
-  // json buffer used for attribute reporting
-  DynamicJsonBuffer    *json_buffer;
-  JsonObject           *json;
+  // attributes waiting to be published, stored in zigbee_attr_pool
+  uint16_t              attr_head;      // first block + 1, or 0 if no attribute
+  uint16_t              attr_tail;      // last block + 1
+  uint16_t              attr_len;       // number of bytes used in the chain of blocks
   // sequence number for Zigbee frames
   uint16_t              shortaddr;      // unique key if not null, or unspecified if null
   uint8_t               seqNumber;
@@ -71,6 +98,11 @@ typedef struct Z_Device {
   uint16_t              ct;             // last CT: 153-500
   uint16_t              hue;            // last Hue: 0..359
   uint16_t              x, y;           // last color [x,y]
+  uint32_t              last_publish;   // millis() of last attributes publish, 0 if none
+  char *                hue_cache;      // Hue emulation light rendered in JSON, nullptr if not rendered
+  // persistence
+  uint32_t              flash_hash;     // hash of the last record stored in Flash, 0 if not stored
+  Z_DeviceStats         stats;
 } Z_Device;
 
 /*********************************************************************************************\
@@ -105,6 +137,133 @@ typedef struct Z_Deferred {
   Z_DeviceTimer         func;           // function to call when timer occurs
 } Z_Deferred;
 
+/*********************************************************************************************\
+ * Shared pool for coalesced attributes
+ *
+ * Attributes waiting to be published are stored per device in a chain of fixed size blocks taken
+ * from a single pool, instead of a DynamicJsonBuffer per device. Each attribute is a record
+ * [type][key length][key][value length lo][value length hi][value as rendered JSON]
+\*********************************************************************************************/
+
+#ifndef ZIGBEE_ATTR_POOL_BLOCKS
+#ifdef ESP32
+#define ZIGBEE_ATTR_POOL_BLOCKS  512           // 16 KB
+#else
+#define ZIGBEE_ATTR_POOL_BLOCKS  96            // 3 KB
+#endif  // ESP32
+#endif  // ZIGBEE_ATTR_POOL_BLOCKS
+
+const size_t Z_ATTR_BLOCK_DATA = 30;           // data bytes per block, 32 bytes with link
+
+// Attribute record types
+enum Z_AttrType {
+  Z_ATTR_DELETED = 0,         // record replaced by a later one
+  Z_ATTR_VALUE,               // number, boolean or null
+  Z_ATTR_TEXT,                // string, stored with quotes and escapes
+  Z_ATTR_JSON,                // array or object
+};
+
+typedef struct Z_AttrBlock {
+  uint16_t              next;           // next block + 1, or 0 for end of chain
+  uint8_t               data[Z_ATTR_BLOCK_DATA];
+} Z_AttrBlock;
+
+class Z_AttrPool {
+public:
+  Z_AttrPool() {};
+
+  // Returns block + 1, or 0 if pool is exhausted
+  uint16_t alloc(void) {
+    if (!init()) { return 0; }
+    uint16_t block = _free;
+    if (block) {
+      _free = at(block).next;
+      at(block).next = 0;
+      _free_count--;
+    }
+    return block;
+  }
+
+  // Return a chain of blocks to the pool
+  void release(uint16_t block) {
+    while (block) {
+      uint16_t next = at(block).next;
+      at(block).next = _free;
+      _free = block;
+      _free_count++;
+      block = next;
+    }
+  }
+
+  // Number of data bytes left in the pool
+  size_t available(void) {
+    if (!init()) { return 0; }
+    return _free_count * Z_ATTR_BLOCK_DATA;
+  }
+
+  Z_AttrBlock & at(uint16_t block) const {
+    return _blocks[block - 1];
+  }
+
+private:
+  // Pool is allocated when the first attribute is received
+  bool init(void) {
+    if (!_blocks) {
+      _blocks = (Z_AttrBlock*) HeapCalloc(HEAP_TAG_ZIGBEE, ZIGBEE_ATTR_POOL_BLOCKS, sizeof(Z_AttrBlock));
+      if (!_blocks) { return false; }
+      for (uint32_t i = 0; i < ZIGBEE_ATTR_POOL_BLOCKS; i++) {
+        _blocks[i].next = (i + 1 < ZIGBEE_ATTR_POOL_BLOCKS) ? i + 2 : 0;
+      }
+      _free = 1;
+      _free_count = ZIGBEE_ATTR_POOL_BLOCKS;
+    }
+    return true;
+  }
+
+  Z_AttrBlock          *_blocks = nullptr;
+  uint16_t              _free = 0;
+  uint16_t              _free_count = 0;
+};
+
+Z_AttrPool zigbee_attr_pool = Z_AttrPool();
+
+// Sequential reader of the attribute records of a device
+class Z_AttrCursor {
+public:
+  Z_AttrCursor(uint16_t block, size_t len) : _block(block), _pos(0), _left(len) {}
+
+  bool atEnd(void) const { return 0 == _left; }
+
+  uint8_t * ptr8(void) const {                 // current byte, to change it in place
+    return &zigbee_attr_pool.at(_block).data[_pos];
+  }
+
+  uint8_t get8(void) {
+    uint8_t data = *ptr8();
+    skip(1);
+    return data;
+  }
+
+  void get(char * dst, size_t len) {
+    while (len--) { *dst++ = get8(); }
+  }
+
+  void skip(size_t len) {
+    if (len > _left) { len = _left; }
+    _left -= len;
+    _pos += len;
+    while ((_pos >= Z_ATTR_BLOCK_DATA) && _block) {
+      _pos -= Z_ATTR_BLOCK_DATA;
+      _block = zigbee_attr_pool.at(_block).next;
+    }
+  }
+
+private:
+  uint16_t              _block;
+  size_t                _pos;
+  size_t                _left;
+};
+
 /*********************************************************************************************\
  * Singleton for device configuration
 \*********************************************************************************************/
@@ -172,19 +331,34 @@ public:
                         uint16_t *x, uint16_t *y,
                         bool *reachable) const ;
 
+  // Hue emulation, cache of the light rendered in JSON, cleared when the light changes
+  const char * getHueCache(uint16_t shortaddr) const;
+  void setHueCache(uint16_t shortaddr, const String &light);
+  void hueCacheCheck(uint32_t key);       // clear all rendered lights if the rendering context changed
+
   // Timers
   void resetTimersForDevice(uint16_t shortaddr, uint16_t groupaddr, uint8_t category);
   void setTimer(uint16_t shortaddr, uint16_t groupaddr, uint32_t wait_ms, uint16_t cluster, uint8_t endpoint, uint8_t category, uint32_t value, Z_DeviceTimer func);
+  void setTimerBudget(uint16_t shortaddr, uint16_t groupaddr, uint32_t wait_ms, uint16_t cluster, uint8_t endpoint, uint8_t category, uint32_t value, Z_DeviceTimer func);
   void runTimer(void);
 
-  // Append or clear attributes Json structure
+  // Append or clear coalesced attributes
   void jsonClear(uint16_t shortaddr);
   void jsonAppend(uint16_t shortaddr, const JsonObject &values);
-  const JsonObject *jsonGet(uint16_t shortaddr);
+  bool jsonHasAttributes(uint16_t shortaddr) const;
   void jsonPublishFlush(uint16_t shortaddr);    // publish the json message and clear buffer
   bool jsonIsConflict(uint16_t shortaddr, const JsonObject &values);
+  bool jsonIsSameSource(uint16_t shortaddr, const JsonObject &values);
+  uint32_t getLastPublish(uint16_t shortaddr) const;
   void jsonPublishNow(uint16_t shortaddr, JsonObject &values);
 
+  // Statistics
+  void statsReceived(uint16_t shortaddr, uint8_t linkquality, uint8_t transact_seq);
+  void statsSent(uint16_t shortaddr, uint8_t transact_seq, bool needResponse);
+  void statsConfirmFailed(uint16_t shortaddr);
+  void statsReset(void);
+  String dumpStats(uint16_t shortaddr) const;
+
   // Iterator
   size_t devicesSize(void) const {
     return _devices.size();
@@ -196,6 +370,18 @@ public:
   // Remove device from list
   bool removeDevice(uint16_t shortaddr);
 
+  // Persistence, a device record is appended to Flash when its hash changes
+  void setFlashHash(size_t i, uint32_t hash) {
+    _devices.at(i)->flash_hash = hash;
+  }
+  // devices removed since last save that had a record in Flash
+  const std::vector<uint16_t> &removedDevices(void) const {
+    return _removed;
+  }
+  void clearRemovedDevices(void) {
+    _removed.clear();
+  }
+
   // Mark data as 'dirty' and requiring to save in Flash
   void dirty(void);
   void clean(void);   // avoid writing to flash the last changes
@@ -207,6 +393,12 @@ public:
 private:
   std::vector<Z_Device*>    _devices = {};
   std::vector<Z_Deferred>   _deferred = {};   // list of deferred calls
+  // Open addressing hash tables of (index in _devices + 1) by shortaddr and longaddr, 0 for empty slot
+  std::vector<uint16_t>     _short_index = {};
+  std::vector<uint16_t>     _long_index = {};
+  std::vector<uint16_t>     _removed = {};    // shortaddr of devices to remove from Flash
+  size_t                    _hue_cache_len = 0;   // bytes used by all hue_cache
+  uint32_t                  _hue_cache_key = 0;   // rendering context of hue_cache
   uint32_t                  _saveTimer = 0;   
   uint8_t                   _seqNumber = 0;     // global seqNumber if device is unknown
 
@@ -224,11 +416,29 @@ private:
   int32_t findLongAddr(uint64_t longaddr) const;
   int32_t findFriendlyName(const char * name) const;
 
+  // Maintain the address hash tables, must be called after any change of _devices or of an address
+  static uint32_t indexSlot(uint32_t key, size_t size);
+  void indexDevice(size_t index);
+  void rebuildIndex(void);
+
   // Create a new entry in the devices list - must be called if it is sure it does not already exist
   Z_Device & createDeviceEntry(uint16_t shortaddr, uint64_t longaddr = 0);
   void freeDeviceEntry(Z_Device *device);
 
   void setStringAttribute(char*& attr, const char * str);
+  void hueCacheClear(Z_Device &device);
+
+  // Attribute records in zigbee_attr_pool
+  static size_t attrSize(const char * key, size_t value_len);
+  static bool attrFits(const Z_Device &device, size_t len);
+  static void attrWrite(Z_Device &device, const uint8_t * data, size_t len);
+  static void attrAppend(Z_Device &device, uint8_t type, const char * key, const String &value);
+  static bool attrFind(const Z_Device &device, const char * key, uint8_t ** type, String * value);
+  static void attrSet(Z_Device &device, uint8_t type, const char * key, const String &value, bool keep_position);
+  static uint32_t attrGetUInt(const Z_Device &device, const char * key);
+  static void attrClear(Z_Device &device);
+  static String attrRender(const Z_Device &device);
+  void jsonPublishMsg(uint16_t shortaddr, const String &msg);
 };
 
 /*********************************************************************************************\
@@ -276,13 +486,13 @@ int32_t Z_Devices::findEndpointInVector(const std::vector<T>  & vecOfElements, u
 Z_Device & Z_Devices::createDeviceEntry(uint16_t shortaddr, uint64_t longaddr) {
   if ((BAD_SHORTADDR == shortaddr) && !longaddr) { return *(Z_Device*) nullptr; }      // it is not legal to create this entry
   //Z_Device* device_alloc = (Z_Device*) malloc(sizeof(Z_Device));
-  Z_Device* device_alloc = new Z_Device{
+  Z_Device* device_alloc = HEAP_NEW(HEAP_TAG_ZIGBEE) Z_Device{
                       longaddr,
                       nullptr,    // ManufId
                       nullptr,   // DeviceId
                       nullptr,   // FriendlyName
                       { 0, 0, 0, 0, 0, 0, 0, 0 },     // endpoints
-                      nullptr, nullptr,
+                      0, 0, 0,    // attributes
                       shortaddr,
                       0,          // seqNumber
                       // Hue support
@@ -294,23 +504,72 @@ Z_Device & Z_Devices::createDeviceEntry(uint16_t shortaddr, uint64_t longaddr) {
                       200,        // ct
                       0,          // hue
                       0, 0,       // x, y
+                      0,          // last_publish
+                      nullptr,    // hue_cache
+                      0,          // not stored in Flash
+                      {},         // stats
                     };
 
-  device_alloc->json_buffer = new DynamicJsonBuffer(16);
   _devices.push_back(device_alloc);
+  if (_devices.size() * 2 > _short_index.size()) {
+    rebuildIndex();                   // keep the hash tables at most half full
+  } else {
+    indexDevice(_devices.size() - 1);
+  }
   dirty();
   return *(_devices.back());
 }
 
 void Z_Devices::freeDeviceEntry(Z_Device *device) {
-  if (device->manufacturerId) { free(device->manufacturerId); }
-  if (device->modelId) { free(device->modelId); }
-  if (device->friendlyName) { free(device->friendlyName); }
-  free(device);
+  if (device->manufacturerId) { HeapFree(device->manufacturerId); }
+  if (device->modelId) { HeapFree(device->modelId); }
+  if (device->friendlyName) { HeapFree(device->friendlyName); }
+  attrClear(*device);
+  hueCacheClear(*device);
+  HeapFree(device);
 }
 
 //
-// Scan all devices to find a corresponding shortaddr
+// Slot in a hash table of size (power of 2) for a key, using Fibonacci hashing
+//
+uint32_t Z_Devices::indexSlot(uint32_t key, size_t size) {
+  return (key * 2654435761U) & (size - 1);
+}
+
+//
+// Add the device at index in _devices to the hash tables
+// Devices are added by increasing index so that the first match is the lowest index, as a linear scan would return
+//
+void Z_Devices::indexDevice(size_t index) {
+  const Z_Device &device = *(_devices[index]);
+  size_t size = _short_index.size();
+  if (BAD_SHORTADDR != device.shortaddr) {
+    uint32_t slot = indexSlot(device.shortaddr, size);
+    while (_short_index[slot]) { slot = (slot + 1) & (size - 1); }
+    _short_index[slot] = index + 1;
+  }
+  if (device.longaddr) {
+    uint32_t slot = indexSlot((uint32_t)device.longaddr ^ (uint32_t)(device.longaddr >> 32), size);
+    while (_long_index[slot]) { slot = (slot + 1) & (size - 1); }
+    _long_index[slot] = index + 1;
+  }
+}
+
+//
+// Recreate the hash tables, used when devices are removed or their address changes
+//
+void Z_Devices::rebuildIndex(void) {
+  size_t size = 16;
+  while (size < _devices.size() * 2) { size <<= 1; }
+  _short_index.assign(size, 0);
+  _long_index.assign(size, 0);
+  for (uint32_t i = 0; i < _devices.size(); i++) {
+    indexDevice(i);
+  }
+}
+
+//
+// Find the device with a corresponding shortaddr
 // Looks info device.shortaddr entry
 // In:
 //    shortaddr (not BAD_SHORTADDR)
@@ -319,15 +578,16 @@ void Z_Devices::freeDeviceEntry(Z_Device *device) {
 //
 int32_t Z_Devices::findShortAddr(uint16_t shortaddr) const {
   if (BAD_SHORTADDR == shortaddr) { return -1; }              // does not make sense to look for BAD_SHORTADDR shortaddr (broadcast)
-  int32_t found = 0;
-  for (auto &elem : _devices) {
-    if (elem->shortaddr == shortaddr) { return found; }
-    found++;
+  size_t size = _short_index.size();
+  if (!size) { return -1; }
+  for (uint32_t slot = indexSlot(shortaddr, size); _short_index[slot]; slot = (slot + 1) & (size - 1)) {
+    int32_t found = _short_index[slot] - 1;
+    if (_devices[found]->shortaddr == shortaddr) { return found; }
   }
   return -1;
 }
 //
-// Scan all devices to find a corresponding longaddr
+// Find the device with a corresponding longaddr
 // Looks info device.longaddr entry
 // In:
 //    longaddr (non null)
@@ -336,10 +596,11 @@ int32_t Z_Devices::findShortAddr(uint16_t shortaddr) const {
 //
 int32_t Z_Devices::findLongAddr(uint64_t longaddr) const {
   if (!longaddr) { return -1; }
-  int32_t found = 0;
-  for (auto &elem : _devices) {
-    if (elem->longaddr == longaddr) { return found; }
-    found++;
+  size_t size = _long_index.size();
+  if (!size) { return -1; }
+  for (uint32_t slot = indexSlot((uint32_t)longaddr ^ (uint32_t)(longaddr >> 32), size); _long_index[slot]; slot = (slot + 1) & (size - 1)) {
+    int32_t found = _long_index[slot] - 1;
+    if (_devices[found]->longaddr == longaddr) { return found; }
   }
   return -1;
 }
@@ -447,8 +708,12 @@ Z_Device & Z_Devices::getLongAddr(uint64_t longaddr) {
 bool Z_Devices::removeDevice(uint16_t shortaddr) {
   int32_t found = findShortAddr(shortaddr);
   if (found >= 0) {
+    if (_devices[found]->flash_hash) {
+      _removed.push_back(shortaddr);    // record the removal in Flash
+    }
     freeDeviceEntry(_devices.at(found));
     _devices.erase(_devices.begin() + found);
+    rebuildIndex();
     dirty();
     return true;
   }
@@ -472,16 +737,19 @@ void Z_Devices::updateDevice(uint16_t shortaddr, uint64_t longaddr) {
       // erase the previous shortaddr
       freeDeviceEntry(_devices.at(s_found));
       _devices.erase(_devices.begin() + s_found);
+      rebuildIndex();
       dirty();
     }
   } else if (s_found >= 0) {
     // shortaddr already exists but longaddr not
     // add the longaddr to the entry
     _devices[s_found]->longaddr = longaddr;
+    rebuildIndex();
     dirty();
   } else if (l_found >= 0) {
     // longaddr entry exists, update shortaddr
     _devices[l_found]->shortaddr = shortaddr;
+    rebuildIndex();
     dirty();
   } else {
     // neither short/lonf addr are found.
@@ -543,14 +811,14 @@ void Z_Devices::setStringAttribute(char*& attr, const char * str) {
     // we already have a value
     if (strcmp(attr, str) != 0) {
       // new value
-      free(attr);      // free previous value
+      HeapFree(attr);      // free previous value
       attr = nullptr;
     } else {
       return;        // same value, don't change anything
     }
   }
   if (str_len) {
-    attr = (char*) malloc(str_len + 1);
+    attr = (char*) HeapMalloc(HEAP_TAG_ZIGBEE, str_len + 1);
     strlcpy(attr, str, str_len + 1);
   }
   dirty();
@@ -570,6 +838,7 @@ void Z_Devices::setManufId(uint16_t shortaddr, const char * str) {
   if (&device == nullptr) { return; }                 // don't crash if not found
 
   setStringAttribute(device.manufacturerId, str);
+  hueCacheClear(device);
 }
 
 void Z_Devices::setModelId(uint16_t shortaddr, const char * str) {
@@ -577,6 +846,7 @@ void Z_Devices::setModelId(uint16_t shortaddr, const char * str) {
   if (&device == nullptr) { return; }                 // don't crash if not found
 
   setStringAttribute(device.modelId, str);
+  hueCacheClear(device);
 }
 
 void Z_Devices::setFriendlyName(uint16_t shortaddr, const char * str) {
@@ -584,6 +854,7 @@ void Z_Devices::setFriendlyName(uint16_t shortaddr, const char * str) {
   if (&device == nullptr) { return; }                 // don't crash if not found
 
   setStringAttribute(device.friendlyName, str);
+  hueCacheClear(device);
 }
 
 const char * Z_Devices::getFriendlyName(uint16_t shortaddr) const {
@@ -616,7 +887,10 @@ const char * Z_Devices::getManufacturerId(uint16_t shortaddr) const {
 void Z_Devices::setReachable(uint16_t shortaddr, bool reachable) {
   Z_Device & device = getShortAddr(shortaddr);
   if (&device == nullptr) { return; }                 // don't crash if not found
-  bitWrite(device.power, 7, reachable);
+  if (bitRead(device.power, 7) != reachable) {
+    bitWrite(device.power, 7, reachable);
+    hueCacheClear(device);
+  }
 }
 
 // get the next sequance number for the device, or use the global seq number if device is unknown
@@ -638,6 +912,7 @@ void Z_Devices::setHueBulbtype(uint16_t shortaddr, int8_t bulbtype) {
   Z_Device &device = getShortAddr(shortaddr);
   if (bulbtype != device.bulbtype) {
     device.bulbtype = bulbtype;
+    hueCacheClear(device);
     dirty();
   }
 }
@@ -667,6 +942,49 @@ void Z_Devices::updateHueState(uint16_t shortaddr,
   if (x)        { device.x = *x; }
   if (y)        { device.y = *y; }
   if (reachable){ bitWrite(device.power, 7, *reachable); }
+  hueCacheClear(device);
+}
+
+void Z_Devices::hueCacheClear(Z_Device &device) {
+  if (device.hue_cache) {
+    _hue_cache_len -= strlen(device.hue_cache) + 1;
+    HeapFree(device.hue_cache);
+    device.hue_cache = nullptr;
+  }
+}
+
+const char * Z_Devices::getHueCache(uint16_t shortaddr) const {
+  int32_t found = findShortAddr(shortaddr);
+  if (found >= 0) {
+    return _devices[found]->hue_cache;
+  }
+  return nullptr;
+}
+
+// Keep the rendered light if it fits in ZIGBEE_HUE_CACHE_SIZE, otherwise it is rendered again next time
+void Z_Devices::setHueCache(uint16_t shortaddr, const String &light) {
+  int32_t found = findShortAddr(shortaddr);
+  if (found < 0) { return; }
+  Z_Device &device = *_devices[found];
+  hueCacheClear(device);
+
+  size_t light_len = light.length() + 1;
+  if (_hue_cache_len + light_len > ZIGBEE_HUE_CACHE_SIZE) { return; }
+  device.hue_cache = (char*) HeapMalloc(HEAP_TAG_ZIGBEE, light_len);
+  if (device.hue_cache) {
+    strlcpy(device.hue_cache, light.c_str(), light_len);
+    _hue_cache_len += light_len;
+  }
+}
+
+// The rendering depends on the Echo generation and last xy set by Alexa, summarized in key
+void Z_Devices::hueCacheCheck(uint32_t key) {
+  if (key != _hue_cache_key) {
+    for (auto device : _devices) {
+      hueCacheClear(*device);
+    }
+    _hue_cache_key = key;
+  }
 }
 
 // return true if ok
@@ -729,6 +1047,18 @@ void Z_Devices::setTimer(uint16_t shortaddr, uint16_t groupaddr, uint32_t wait_m
   _deferred.push_back(deferred);
 }
 
+// Set timer unless a timer of the same category fires earlier, this bounds the delay from the first event
+void Z_Devices::setTimerBudget(uint16_t shortaddr, uint16_t groupaddr, uint32_t wait_ms, uint16_t cluster, uint8_t endpoint, uint8_t category, uint32_t value, Z_DeviceTimer func) {
+  uint32_t timer = wait_ms + millis();
+  for (auto &defer : _deferred) {
+    if ((defer.shortaddr == shortaddr) && (defer.groupaddr == groupaddr) && (defer.category == category) &&
+        ((int32_t)(defer.timer - timer) <= 0)) {
+      return;           // keep the earlier timer
+    }
+  }
+  setTimer(shortaddr, groupaddr, wait_ms, cluster, endpoint, category, value, func);
+}
+
 // Run timer at each tick
 // WARNING: don't set a new timer within a running timer, this causes memory corruption
 void Z_Devices::runTimer(void) {
@@ -750,56 +1080,149 @@ void Z_Devices::runTimer(void) {
   }
 }
 
-// Clear the JSON buffer for coalesced and deferred attributes
-void Z_Devices::jsonClear(uint16_t shortaddr) {
-  Z_Device & device = getShortAddr(shortaddr);
-  if (&device == nullptr) { return; }                 // don't crash if not found
-
-  device.json = nullptr;
-  device.json_buffer->clear();
+// Size of an attribute record
+size_t Z_Devices::attrSize(const char * key, size_t value_len) {
+  return 4 + strlen(key) + value_len;
 }
 
-// Copy JSON from one object to another, this helps preserving the order of attributes
-void CopyJsonVariant(JsonObject &to, const String &key, const JsonVariant &val) {
-  // first remove the potentially existing key in the target JSON, so new adds will be at the end of the list
-  to.remove(key);    // force remove to have metadata like LinkQuality at the end
+// Can `len` more bytes be stored for this device
+bool Z_Devices::attrFits(const Z_Device &device, size_t len) {
+  if (device.attr_len + len > 0xFFFF) { return false; }
+  size_t tail_free = (device.attr_len % Z_ATTR_BLOCK_DATA) ? Z_ATTR_BLOCK_DATA - (device.attr_len % Z_ATTR_BLOCK_DATA) : 0;
+  return (len <= tail_free + zigbee_attr_pool.available());
+}
 
-  if (val.is<char*>()) {
-    String sval = val.as<String>();       // force a copy of the String value, avoiding crash
-    to.set(key, sval);
-  } else if (val.is<JsonArray>()) {
-    JsonArray &nested_arr = to.createNestedArray(key);
-    CopyJsonArray(nested_arr, val.as<JsonArray>());   // deep copy
-  } else if (val.is<JsonObject>()) {
-    JsonObject &nested_obj = to.createNestedObject(key);
-    CopyJsonObject(nested_obj, val.as<JsonObject>()); // deep copy
-  } else {
-    to.set(key, val);                     // general case for non array, object or string
+// Append raw bytes at the end of the chain of blocks, space must have been checked with attrFits()
+void Z_Devices::attrWrite(Z_Device &device, const uint8_t * data, size_t len) {
+  while (len--) {
+    uint32_t pos = device.attr_len % Z_ATTR_BLOCK_DATA;
+    if (0 == pos) {
+      uint16_t block = zigbee_attr_pool.alloc();
+      if (!block) { return; }
+      if (device.attr_tail) {
+        zigbee_attr_pool.at(device.attr_tail).next = block;
+      } else {
+        device.attr_head = block;
+      }
+      device.attr_tail = block;
+    }
+    zigbee_attr_pool.at(device.attr_tail).data[pos] = *data++;
+    device.attr_len++;
   }
 }
 
-// Shallow copy of array, we skip any sub-array or sub-object. It may be added in the future
-void CopyJsonArray(JsonArray &to, const JsonArray &arr) {
-  for (auto v : arr) {
-    if (v.is<char*>()) {
-      String sval = v.as<String>();       // force a copy of the String value
-      to.add(sval);
-    } else if (v.is<JsonArray>()) {
-    } else if (v.is<JsonObject>()) {
+void Z_Devices::attrAppend(Z_Device &device, uint8_t type, const char * key, const String &value) {
+  size_t key_len = strlen(key);
+  size_t value_len = value.length();
+  if ((key_len > 255) || !attrFits(device, attrSize(key, value_len))) { return; }
+  uint8_t header[2] = { type, (uint8_t) key_len };
+  attrWrite(device, header, sizeof(header));
+  attrWrite(device, (const uint8_t*) key, key_len);
+  uint8_t value_header[2] = { (uint8_t) value_len, (uint8_t) (value_len >> 8) };
+  attrWrite(device, value_header, sizeof(value_header));
+  attrWrite(device, (const uint8_t*) value.c_str(), value_len);
+}
+
+// Find the live record of `key` (case-sensitive like ArduinoJson), optionally returns its type byte and value
+bool Z_Devices::attrFind(const Z_Device &device, const char * key, uint8_t ** type, String * value) {
+  size_t key_len = strlen(key);
+  Z_AttrCursor cursor(device.attr_head, device.attr_len);
+  while (!cursor.atEnd()) {
+    uint8_t * type_ptr = cursor.ptr8();
+    uint8_t rec_type = cursor.get8();
+    size_t rec_key_len = cursor.get8();
+    bool match = (Z_ATTR_DELETED != rec_type) && (rec_key_len == key_len);
+    if (match) {
+      for (uint32_t i = 0; i < rec_key_len; i++) {
+        if (cursor.get8() != (uint8_t) key[i]) {
+          match = false;
+          cursor.skip(rec_key_len - i - 1);
+          break;
+        }
+      }
     } else {
-      to.add(v);
+      cursor.skip(rec_key_len);
     }
+    size_t value_len = cursor.get8();
+    value_len |= cursor.get8() << 8;
+    if (match) {
+      if (type) { *type = type_ptr; }
+      if (value) {
+        *value = "";
+        value->reserve(value_len);
+        while (value_len--) { *value += (char) cursor.get8(); }
+      }
+      return true;
+    }
+    cursor.skip(value_len);
+  }
+  return false;
+}
+
+// Replace the value of `key`. The new record goes at the end, like ArduinoJson remove() then set(),
+// unless `keep_position` is set and the value did not change
+void Z_Devices::attrSet(Z_Device &device, uint8_t type, const char * key, const String &value, bool keep_position) {
+  uint8_t * type_ptr;
+  String previous;
+  if (attrFind(device, key, &type_ptr, keep_position ? &previous : nullptr)) {
+    if (keep_position && previous.equals(value)) { return; }
+    *type_ptr = Z_ATTR_DELETED;
   }
+  attrAppend(device, type, key, value);
 }
 
-// Deep copy of object
-void CopyJsonObject(JsonObject &to, const JsonObject &from) {
-  for (auto kv : from) {
-    String key_string = kv.key;
-    JsonVariant &val = kv.value;
+// Numerical value of `key`, or 0 if not found
+uint32_t Z_Devices::attrGetUInt(const Z_Device &device, const char * key) {
+  String value;
+  if (!attrFind(device, key, nullptr, &value)) { return 0; }
+  const char * p = value.c_str();
+  if ('"' == *p) { p++; }
+  return strtoul(p, nullptr, 10);
+}
 
-    CopyJsonVariant(to, key_string, val);
+void Z_Devices::attrClear(Z_Device &device) {
+  zigbee_attr_pool.release(device.attr_head);
+  device.attr_head = 0;
+  device.attr_tail = 0;
+  device.attr_len = 0;
+}
+
+// Render the live records as a JSON object, values are already rendered
+String Z_Devices::attrRender(const Z_Device &device) {
+  String msg;
+  msg.reserve(device.attr_len + 2);
+  msg += '{';
+  bool first = true;
+  Z_AttrCursor cursor(device.attr_head, device.attr_len);
+  while (!cursor.atEnd()) {
+    uint8_t type = cursor.get8();
+    size_t key_len = cursor.get8();
+    char key[key_len + 1];
+    cursor.get(key, key_len);
+    key[key_len] = 0;
+    size_t value_len = cursor.get8();
+    value_len |= cursor.get8() << 8;
+    if (Z_ATTR_DELETED == type) {
+      cursor.skip(value_len);
+      continue;
+    }
+    if (!first) { msg += ','; }
+    first = false;
+    msg += '"';
+    msg += EscapeJSONString(key);
+    msg += F("\":");
+    while (value_len--) { msg += (char) cursor.get8(); }
   }
+  msg += '}';
+  return msg;
+}
+
+// Clear the coalesced and deferred attributes
+void Z_Devices::jsonClear(uint16_t shortaddr) {
+  Z_Device & device = getShortAddr(shortaddr);
+  if (&device == nullptr) { return; }                 // don't crash if not found
+
+  attrClear(device);
 }
 
 // does the new payload conflicts with the existing payload, i.e. values would be overwritten
@@ -810,7 +1233,7 @@ bool Z_Devices::jsonIsConflict(uint16_t shortaddr, const JsonObject &values) {
   if (&device == nullptr) { return false; }                 // don't crash if not found
   if (&values == nullptr) { return false; }
 
-  if (nullptr == device.json) {
+  if (0 == device.attr_head) {
     return false;                                           // if no previous value, no conflict
   }
 
@@ -820,8 +1243,8 @@ bool Z_Devices::jsonIsConflict(uint16_t shortaddr, const JsonObject &values) {
   // Eg: if the first packet has no group attribute, and the second does, conflict would not be detected
   // Here we explicitly compute the group address of both messages, and compare them. No group means group=0x0000
   // (we use the property of an missing attribute returning 0)
-  // (note: we use .get() here which is case-sensitive. We know however that the attribute was set with the exact syntax D_CMND_ZIGBEE_GROUP, so we don't need a case-insensitive get())
-  uint16_t group1 = device.json->get<unsigned int>(D_CMND_ZIGBEE_GROUP);
+  // (note: the lookup is case-sensitive. We know however that the attribute was set with the exact syntax D_CMND_ZIGBEE_GROUP, so we don't need a case-insensitive get())
+  uint16_t group1 = attrGetUInt(device, D_CMND_ZIGBEE_GROUP);
   uint16_t group2 = values.get<unsigned int>(D_CMND_ZIGBEE_GROUP);
   if (group1 != group2) {
     return true;      // if group addresses differ, then conflict
@@ -829,19 +1252,17 @@ bool Z_Devices::jsonIsConflict(uint16_t shortaddr, const JsonObject &values) {
 
   // parse all other parameters
   for (auto kv : values) {
-    String key_string = kv.key;
-
     if (0 == strcasecmp_P(kv.key, PSTR(D_CMND_ZIGBEE_GROUP))) {
       // ignore group, it was handled already
     } else if (0 == strcasecmp_P(kv.key, PSTR(D_CMND_ZIGBEE_ENDPOINT))) {
       // attribute "Endpoint" or "Group"
-      if (device.json->containsKey(kv.key)) {
-        if (kv.value.as<unsigned int>() != device.json->get<unsigned int>(kv.key)) {
+      if (attrFind(device, kv.key, nullptr, nullptr)) {
+        if (kv.value.as<unsigned int>() != attrGetUInt(device, kv.key)) {
           return true;
         }
       }
     } else if (strcasecmp_P(kv.key, PSTR(D_CMND_ZIGBEE_LINKQUALITY))) {  // exception = ignore duplicates for LinkQuality
-      if (device.json->containsKey(kv.key)) {
+      if (attrFind(device, kv.key, nullptr, nullptr)) {
         return true;          // conflict!
       }
     }
@@ -849,53 +1270,177 @@ bool Z_Devices::jsonIsConflict(uint16_t shortaddr, const JsonObject &values) {
   return false;
 }
 
+// does the new payload come from the same endpoint and group as the pending attributes
+// i.e. newer values can replace the pending ones
+bool Z_Devices::jsonIsSameSource(uint16_t shortaddr, const JsonObject &values) {
+  Z_Device & device = getShortAddr(shortaddr);
+  if (&device == nullptr) { return false; }                 // don't crash if not found
+  if (&values == nullptr) { return false; }
+
+  return (attrGetUInt(device, D_CMND_ZIGBEE_GROUP) == values.get<unsigned int>(D_CMND_ZIGBEE_GROUP)) &&
+         (attrGetUInt(device, D_CMND_ZIGBEE_ENDPOINT) == values.get<unsigned int>(D_CMND_ZIGBEE_ENDPOINT));
+}
+
+uint32_t Z_Devices::getLastPublish(uint16_t shortaddr) const {
+  int32_t found = findShortAddr(shortaddr);
+  if (found >= 0) {
+    return _devices[found]->last_publish;
+  }
+  return 0;
+}
+
+//
+// Statistics, don't create a device for frames from unknown devices
+//
+void Z_Devices::statsReceived(uint16_t shortaddr, uint8_t linkquality, uint8_t transact_seq) {
+  int32_t found = findShortAddr(shortaddr);
+  if (found < 0) { return; }
+  Z_DeviceStats &stats = _devices[found]->stats;
+
+  stats.received++;
+  stats.last_seen = uptime;
+  stats.lqi[stats.lqi_next] = linkquality;
+  stats.lqi_next = (stats.lqi_next + 1) % Z_LQI_HISTORY;
+  if (stats.lqi_count < Z_LQI_HISTORY) { stats.lqi_count++; }
+
+  if (stats.pending_sent) {
+    uint32_t latency = TimePassedSince(stats.pending_sent);
+    if (latency > Z_STATS_RESPONSE_TIMEOUT) {
+      stats.pending_sent = 0;               // response lost, don't count it
+    } else if (stats.pending_seq == transact_seq) {
+      stats.pending_sent = 0;
+      stats.latency_last = latency;
+      if (latency > stats.latency_max) { stats.latency_max = latency; }
+      stats.latency_total += latency;
+      stats.latency_count++;
+    }
+  }
+}
+
+void Z_Devices::statsSent(uint16_t shortaddr, uint8_t transact_seq, bool needResponse) {
+  int32_t found = findShortAddr(shortaddr);
+  if (found < 0) { return; }
+  Z_DeviceStats &stats = _devices[found]->stats;
+
+  stats.sent++;
+  if (needResponse) {                       // measure only one command at a time, the last one
+    stats.pending_seq = transact_seq;
+    stats.pending_sent = millis() | 1;
+  }
+}
+
+void Z_Devices::statsConfirmFailed(uint16_t shortaddr) {
+  int32_t found = findShortAddr(shortaddr);
+  if (found < 0) { return; }
+  _devices[found]->stats.confirm_fail++;
+}
+
+void Z_Devices::statsReset(void) {
+  for (auto device : _devices) {
+    device->stats = {};
+  }
+}
+
 void Z_Devices::jsonAppend(uint16_t shortaddr, const JsonObject &values) {
   Z_Device & device = getShortAddr(shortaddr);
   if (&device == nullptr) { return; }                 // don't crash if not found
   if (&values == nullptr) { return; }
 
-  if (nullptr == device.json) {
-    device.json = &(device.json_buffer->createObject());
-  }
   // Prepend Device, will be removed later if redundant
-  char sa[8];
-  snprintf_P(sa, sizeof(sa), PSTR("0x%04X"), shortaddr);
-  device.json->set(F(D_JSON_ZIGBEE_DEVICE), sa);
+  char sa[10];
+  snprintf_P(sa, sizeof(sa), PSTR("\"0x%04X\""), shortaddr);
+  String device_value(sa);
   // Prepend Friendly Name if it has one
   const char * fname = zigbee_devices.getFriendlyName(shortaddr);
+  String name_value;
   if (fname) {
-    device.json->set(F(D_JSON_ZIGBEE_NAME), (char*) fname);   // (char*) forces ArduinoJson to make a copy of the cstring
+    name_value = '"';
+    name_value += EscapeJSONString(fname);
+    name_value += '"';
+  }
+
+  size_t needed = attrSize(D_JSON_ZIGBEE_DEVICE, device_value.length());
+  if (fname) { needed += attrSize(D_JSON_ZIGBEE_NAME, name_value.length()); }
+  for (auto kv : values) {
+    needed += attrSize(kv.key, kv.value.measureLength());
+  }
+  if (!attrFits(device, needed)) {
+    jsonPublishFlush(shortaddr);                      // pool is full, publish what we have to make room
+  }
+  if (!attrFits(device, needed)) {
+    // larger than the pool, don't coalesce and publish as is
+    gZbLastMessage.device = shortaddr;
+    gZbLastMessage.groupaddr = values.get<unsigned int>(D_CMND_ZIGBEE_GROUP);
+    gZbLastMessage.cluster = values.get<unsigned int>(D_CMND_ZIGBEE_CLUSTER);
+    gZbLastMessage.endpoint = values.get<unsigned int>(D_CMND_ZIGBEE_ENDPOINT);
+    String msg = F("{\"" D_JSON_ZIGBEE_DEVICE "\":");
+    msg += device_value;
+    if (fname) {
+      msg += F(",\"" D_JSON_ZIGBEE_NAME "\":");
+      msg += name_value;
+    }
+    String attributes;
+    values.printTo(attributes);
+    if (attributes.length() > 2) {
+      msg += ',';
+      msg += attributes.substring(1);
+    } else {
+      msg += '}';
+    }
+    jsonPublishMsg(shortaddr, msg);
+    return;
   }
 
-  // copy all values from 'values' to 'json'
-  CopyJsonObject(*device.json, values);
+  attrSet(device, Z_ATTR_TEXT, D_JSON_ZIGBEE_DEVICE, device_value, true);
+  if (fname) {
+    attrSet(device, Z_ATTR_TEXT, D_JSON_ZIGBEE_NAME, name_value, true);
+  }
+
+  // copy all values, previous values of the same keys are removed so new adds will be at the end of the list
+  for (auto kv : values) {
+    String value;
+    kv.value.printTo(value);
+    uint8_t type = Z_ATTR_VALUE;
+    if (kv.value.is<char*>()) {
+      type = Z_ATTR_TEXT;
+    } else if (kv.value.is<JsonArray>() || kv.value.is<JsonObject>()) {
+      type = Z_ATTR_JSON;
+    }
+    attrSet(device, type, kv.key, value, false);   // force remove to have metadata like LinkQuality at the end
+  }
 }
 
-const JsonObject *Z_Devices::jsonGet(uint16_t shortaddr) {
-  Z_Device & device = getShortAddr(shortaddr);
-  if (&device == nullptr) { return nullptr; }                 // don't crash if not found
-  return device.json;
+bool Z_Devices::jsonHasAttributes(uint16_t shortaddr) const {
+  const Z_Device & device = getShortAddrConst(shortaddr);
+  if (&device == nullptr) { return false; }                 // don't crash if not found
+  return (device.attr_head != 0);
 }
 
 void Z_Devices::jsonPublishFlush(uint16_t shortaddr) {
   Z_Device & device = getShortAddr(shortaddr);
   if (&device == nullptr) { return; }                 // don't crash if not found
-  JsonObject & json = *device.json;
-  if (&json == nullptr) { return; }                    // abort if nothing in buffer
-
-  const char * fname = zigbee_devices.getFriendlyName(shortaddr);
-  bool use_fname = (Settings.flag4.zigbee_use_names) && (fname);    // should we replace shortaddr with friendlyname?
+  if (0 == device.attr_head) { return; }              // abort if nothing in buffer
 
   // save parameters is global variables to be used by Rules
   gZbLastMessage.device = shortaddr;                // %zbdevice%
-  gZbLastMessage.groupaddr = json[F(D_CMND_ZIGBEE_GROUP)];      // %zbgroup%
-  gZbLastMessage.cluster = json[F(D_CMND_ZIGBEE_CLUSTER)];      // %zbcluster%
-  gZbLastMessage.endpoint = json[F(D_CMND_ZIGBEE_ENDPOINT)];    // %zbendpoint%
+  gZbLastMessage.groupaddr = attrGetUInt(device, D_CMND_ZIGBEE_GROUP);      // %zbgroup%
+  gZbLastMessage.cluster = attrGetUInt(device, D_CMND_ZIGBEE_CLUSTER);      // %zbcluster%
+  gZbLastMessage.endpoint = attrGetUInt(device, D_CMND_ZIGBEE_ENDPOINT);    // %zbendpoint%
+
+  // dump attributes in string
+  String msg = attrRender(device);
+  attrClear(device);
+  jsonPublishMsg(shortaddr, msg);
+}
 
-  // dump json in string
-  String msg = "";
-  json.printTo(msg);
-  zigbee_devices.jsonClear(shortaddr);
+void Z_Devices::jsonPublishMsg(uint16_t shortaddr, const String &msg) {
+  Z_Device & device = getShortAddr(shortaddr);
+  if (&device != nullptr) {
+    device.last_publish = millis() | 1;             // 0 means never published
+  }
+
+  const char * fname = zigbee_devices.getFriendlyName(shortaddr);
+  bool use_fname = (Settings.flag4.zigbee_use_names) && (fname);    // should we replace shortaddr with friendlyname?
 
   if (use_fname) {
     Response_P(PSTR("{\"" D_JSON_ZIGBEE_RECEIVED "\":{\"%s\":%s}}"), fname, msg.c_str());
@@ -967,7 +1512,7 @@ uint16_t Z_Devices::parseDeviceParam(const char * param, bool short_must_be_know
 
 // Display the tracked status for a light
 String Z_Devices::dumpLightState(uint16_t shortaddr) const {
-  DynamicJsonBuffer jsonBuffer;
+  JsonParseBuffer jsonBuffer;
   JsonObject& json = jsonBuffer.createObject();
   char hex[8];
 
@@ -1018,12 +1563,54 @@ String Z_Devices::dumpLightState(uint16_t shortaddr) const {
   return payload;
 }
 
+// Dump the statistics of all devices, or of a single device
+String Z_Devices::dumpStats(uint16_t status_shortaddr) const {
+  JsonParseBuffer jsonBuffer;
+  JsonArray& json = jsonBuffer.createArray();
+  char hex[8];
+
+  for (auto device_ptr : _devices) {
+    const Z_Device &device = *device_ptr;
+    const Z_DeviceStats &stats = device.stats;
+    if ((BAD_SHORTADDR != status_shortaddr) && (status_shortaddr != device.shortaddr)) { continue; }
+
+    JsonObject& dev = json.createNestedObject();
+    snprintf_P(hex, sizeof(hex), PSTR("0x%04X"), device.shortaddr);
+    dev[F(D_JSON_ZIGBEE_DEVICE)] = hex;
+    if (device.friendlyName) {
+      dev[F(D_JSON_ZIGBEE_NAME)] = (char*) device.friendlyName;
+    }
+    if (stats.received) {
+      dev[F("LastSeen")] = uptime - stats.last_seen;    // seconds ago
+    }
+    JsonArray& lqi = dev.createNestedArray(F(D_CMND_ZIGBEE_LINKQUALITY));
+    for (uint32_t i = 0; i < stats.lqi_count; i++) {    // oldest first
+      lqi.add(stats.lqi[(stats.lqi_next + Z_LQI_HISTORY - stats.lqi_count + i) % Z_LQI_HISTORY]);
+    }
+    dev[F("Received")] = stats.received;
+    dev[F("Sent")] = stats.sent;
+    dev[F("ConfirmFail")] = stats.confirm_fail;
+    if (stats.latency_count) {
+      JsonObject& latency = dev.createNestedObject(F("Latency"));
+      latency[F("Last")] = stats.latency_last;
+      latency[F("Avg")] = stats.latency_total / stats.latency_count;
+      latency[F("Max")] = stats.latency_max;
+      latency[F("Count")] = stats.latency_count;
+    }
+  }
+
+  String payload = "";
+  payload.reserve(200);
+  json.printTo(payload);
+  return payload;
+}
+
 // Dump the internal memory of Zigbee devices
 // Mode = 1: simple dump of devices addresses
 // Mode = 2: simple dump of devices addresses and names
 // Mode = 3: Mode 2 + also dump the endpoints, profiles and clusters
 String Z_Devices::dump(uint32_t dump_mode, uint16_t status_shortaddr) const {
-  DynamicJsonBuffer jsonBuffer;
+  JsonParseBuffer jsonBuffer;
   JsonArray& json = jsonBuffer.createArray();
   JsonArray& devices = json;
 
@@ -1147,4 +1734,144 @@ int32_t Z_Devices::deviceRestore(const JsonObject &json) {
   return 0;
 }
 
+/*********************************************************************************************\
+ * Outbound frame scheduler
+ *
+ * AF_DATA_REQUEST frames are queued and sent to the CC2530 as soon as the previous frame to the
+ * same device was confirmed by AF_DATA_CONFIRM. Up to ZIGBEE_AF_INFLIGHT frames to different
+ * devices are in flight at once. Group frames are broadcasts and are spaced by ZIGBEE_AF_GROUP_INTERVAL.
+\*********************************************************************************************/
+
+#ifndef ZIGBEE_AF_INFLIGHT
+#define ZIGBEE_AF_INFLIGHT        4             // max frames waiting for AF_DATA_CONFIRM in the CC2530
+#endif
+#ifndef ZIGBEE_AF_GROUP_INTERVAL
+#define ZIGBEE_AF_GROUP_INTERVAL  150           // ms between two group frames
+#endif
+const size_t   Z_AF_QUEUE_SIZE = 48;            // max frames waiting to be sent
+const uint32_t Z_AF_CONFIRM_TIMEOUT = 8000;     // ms, abandon waiting for AF_DATA_CONFIRM (end devices may poll slowly)
+
+typedef struct Z_AFFrame {
+  uint8_t              *msg;            // ZNP frame without SOF, LEN and FCS
+  uint16_t              len;
+  uint16_t              addr;           // shortaddr, or groupaddr if group is set
+  bool                  group;
+  bool                  srsp;           // the CC2530 accepted the frame
+  uint8_t               transacId;
+  uint32_t              sent;           // millis() when sent to the CC2530
+} Z_AFFrame;
+
+class Z_AFScheduler {
+public:
+  Z_AFScheduler() {};
+
+  // Queue a frame and send it if nothing prevents it
+  void send(uint16_t shortaddr, uint16_t groupaddr, uint8_t transacId, const uint8_t *msg, size_t len) {
+    if (_queue.size() >= Z_AF_QUEUE_SIZE) {
+      AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_ZIGBEE "Send queue full, frame dropped"));
+      return;
+    }
+    Z_AFFrame frame;
+    frame.msg = (uint8_t*) HeapMalloc(HEAP_TAG_ZIGBEE, len);
+    if (!frame.msg) { return; }
+    memcpy(frame.msg, msg, len);
+    frame.len = len;
+    frame.group = (BAD_SHORTADDR == shortaddr);
+    frame.addr = frame.group ? groupaddr : shortaddr;
+    frame.srsp = false;
+    frame.transacId = transacId;
+    frame.sent = 0;
+    _queue.push_back(frame);
+    run();
+  }
+
+  // Send all queued frames allowed by the window and per destination limits
+  void run(void) {
+    // abandon frames never confirmed
+    for (uint32_t i = 0; i < _inflight.size(); ) {
+      Z_AFFrame &frame = _inflight[i];
+      if (TimePassedSince(frame.sent) > (int32_t) Z_AF_CONFIRM_TIMEOUT) {
+        AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_ZIGBEE "No confirm for 0x%04X transaction %d"), frame.addr, frame.transacId);
+        if (!frame.group) { zigbee_devices.statsConfirmFailed(frame.addr); }
+        HeapFree(frame.msg);
+        _inflight.erase(_inflight.begin() + i);
+      } else {
+        i++;
+      }
+    }
+    // frames are visited in order, a frame blocked for its destination blocks the later ones to the same destination
+    for (uint32_t i = 0; (i < _queue.size()) && (_inflight.size() < _window); ) {
+      if (isBusy(_queue[i])) {
+        i++;
+        continue;
+      }
+      Z_AFFrame frame = _queue[i];
+      _queue.erase(_queue.begin() + i);
+      frame.sent = millis();
+      if (!frame.sent) { frame.sent = 1; }
+      if (frame.group) { _group_sent = frame.sent; }
+      _inflight.push_back(frame);
+      ZigbeeZNPSend(frame.msg, frame.len);
+    }
+  }
+
+  // SRSP to AF_DATA_REQUEST, they come in the order frames were sent
+  void response(uint8_t status) {
+    for (auto it = _inflight.begin(); it != _inflight.end(); it++) {
+      if (it->srsp) { continue; }
+      if (Z_SUCCESS == status) {
+        it->srsp = true;
+        if (_window < ZIGBEE_AF_INFLIGHT) { _window++; }
+      } else {
+        // CC2530 ran out of buffers, shrink the window and send the frame again
+        Z_AFFrame frame = *it;
+        _inflight.erase(it);
+        if ((Z_MEMERROR == status) || (Z_BUFFERFULL == status)) {
+          frame.srsp = false;
+          frame.sent = 0;
+          _queue.insert(_queue.begin(), frame);
+          if (_window > 1) { _window--; }
+        } else {
+          HeapFree(frame.msg);
+        }
+      }
+      break;
+    }
+    run();
+  }
+
+  // AF_DATA_CONFIRM, the frame was delivered or failed, the destination can receive the next frame
+  void confirm(uint8_t transacId, uint8_t status) {
+    for (auto it = _inflight.begin(); it != _inflight.end(); it++) {
+      if (it->transacId == transacId) {
+        if (status && !it->group) { zigbee_devices.statsConfirmFailed(it->addr); }
+        HeapFree(it->msg);
+        _inflight.erase(it);
+        break;
+      }
+    }
+    run();
+  }
+
+  bool idle(void) const {
+    return _queue.empty() && _inflight.empty();
+  }
+
+private:
+  bool isBusy(const Z_AFFrame &frame) const {
+    for (auto &inflight : _inflight) {
+      if ((inflight.group == frame.group) && (inflight.addr == frame.addr)) { return true; }
+    }
+    if (frame.group && _group_sent && (TimePassedSince(_group_sent) < ZIGBEE_AF_GROUP_INTERVAL)) { return true; }
+    return false;
+  }
+
+  std::vector<Z_AFFrame> _queue;
+  std::vector<Z_AFFrame> _inflight;
+  uint32_t              _group_sent = 0;
+  uint8_t               _window = ZIGBEE_AF_INFLIGHT;   // shrinks when the CC2530 runs out of buffers
+};
+
+Z_AFScheduler zigbee_af = Z_AFScheduler();
+
 #endif // USE_ZIGBEE
@@ -94,13 +94,39 @@ void HueLightStatus2Zigbee(uint16_t shortaddr, String *response)
   free(buf);
 }
 
+// Rendered lights are cached, they also depend on the Echo generation and the last xy set by Alexa
+void ZigbeeHueCacheCheck(void) {
+  uint32_t key = 0x811C9DC5 ^ findEchoGeneration();           // FNV-1a
+  const char * prev[] = { prev_x_str, prev_y_str };
+  for (uint32_t i = 0; i < ARRAY_SIZE(prev); i++) {
+    for (const char * p = prev[i]; *p; p++) {
+      key = (key ^ (uint8_t)*p) * 0x01000193;
+    }
+    key = (key ^ ',') * 0x01000193;
+  }
+  zigbee_devices.hueCacheCheck(key);
+}
+
+// Get the light rendered in JSON, from the cache or rendered in light
+const char * ZigbeeHueLight(uint16_t shortaddr, String &light) {
+  const char * cached = zigbee_devices.getHueCache(shortaddr);
+  if (cached) { return cached; }
+
+  light = F("{\"state\":");
+  HueLightStatus1Zigbee(shortaddr, zigbee_devices.getHueBulbtype(shortaddr), &light);
+  HueLightStatus2Zigbee(shortaddr, &light);
+  zigbee_devices.setHueCache(shortaddr, light);
+  return light.c_str();
+}
+
 void ZigbeeHueStatus(String * response, uint16_t shortaddr) {
-  *response += F("{\"state\":");
-  HueLightStatus1Zigbee(shortaddr, zigbee_devices.getHueBulbtype(shortaddr), response);
-  HueLightStatus2Zigbee(shortaddr, response);
+  ZigbeeHueCacheCheck();
+  String light;
+  *response += ZigbeeHueLight(shortaddr, light);
 }
 
-void ZigbeeCheckHue(String * response, bool &appending) {
+void ZigbeeCheckHue(bool &appending) {
+  ZigbeeHueCacheCheck();
   uint32_t zigbee_num = zigbee_devices.devicesSize();
   for (uint32_t i = 0; i < zigbee_num; i++) {
     int8_t bulbtype = zigbee_devices.devicesAt(i).bulbtype;
@@ -108,26 +134,19 @@ void ZigbeeCheckHue(String * response, bool &appending) {
     if (bulbtype >= 0) {
       uint16_t shortaddr = zigbee_devices.devicesAt(i).shortaddr;
       // this bulb is advertized
-      if (appending) { *response += ","; }
-      *response += "\"";
-      *response += EncodeLightId(0, shortaddr);
-      *response += F("\":{\"state\":");
-      HueLightStatus1Zigbee(shortaddr, bulbtype, response);    // TODO
-      HueLightStatus2Zigbee(shortaddr, response);
-      appending = true;
+      String light;
+      HueContentSendLight(appending, EncodeLightId(0, shortaddr), ZigbeeHueLight(shortaddr, light));
     }
   }
 }
 
-void ZigbeeHueGroups(String * lights) {
+void ZigbeeHueGroups(void) {
   uint32_t zigbee_num = zigbee_devices.devicesSize();
   for (uint32_t i = 0; i < zigbee_num; i++) {
     int8_t bulbtype = zigbee_devices.devicesAt(i).bulbtype;
 
     if (bulbtype >= 0) {
-      *lights += ",\"";
-      *lights += EncodeLightId(i);
-      *lights += "\"";
+      WSContentSend_P(PSTR(",\"%u\""), EncodeLightId(i));
     }
   }
 }
@@ -198,7 +217,7 @@ void ZigbeeHandleHue(uint16_t shortaddr, uint32_t device_id, String &response) {
   if (Webserver->args()) {
     response = "[";
 
-    StaticJsonBuffer<300> jsonBuffer;
+    JsonTempBuffer<300> jsonBuffer;
     JsonObject &hue_json = jsonBuffer.parseObject(Webserver->arg((Webserver->args())-1));
     if (hue_json.containsKey("on")) {
       on = hue_json["on"];
@@ -47,6 +47,17 @@
 // reserved for extensions
 //  -- V2 --
 // int8_t - bulbtype
+//
+// -- Log structure ('zig2') --
+// Device records are appended to the block, each change writes only the records of changed devices.
+// When the block is full it is erased and rewritten with one record per device (compaction).
+//
+// [Array of records, 4 bytes aligned]
+// uint8  - record type, 0x01=device, 0x02=removed device, 0xFF=free space
+// uint8  - length of payload
+// uint8  - reserved 0xFF
+// uint8  - commit marker, 0x00 once the payload is completely written, otherwise the record is ignored
+// payload: device record as above, or uint16 short address for removed device, padded with 0xFF
 
 // Memory footprint
 const static uint16_t z_spi_start_sector = 0xFF;  // Force last bank of first MB
@@ -64,8 +75,18 @@ public:
 };
 
 const static uint32_t ZIGB_NAME = 0x3167697A; // 'zig1' little endian
+const static uint32_t ZIGB_LOG_NAME = 0x3267697A; // 'zig2' little endian
 const static size_t   Z_MAX_FLASH = z_block_len - sizeof(z_flashdata_t);  // 2040
 
+enum Z_FlashRecord {
+  Z_FLASH_DEVICE = 0x01,
+  Z_FLASH_REMOVED = 0x02,
+  Z_FLASH_FREE = 0xFF,
+};
+const static uint8_t  Z_FLASH_COMMITTED = 0x00;
+
+size_t z_flash_end = 0;   // offset in block of the first free record, 0 if block is not in log format
+
 
 class SBuffer hibernateDevice(const struct Z_Device &device) {
   SBuffer buf(128);
@@ -128,134 +149,170 @@ class SBuffer hibernateDevice(const struct Z_Device &device) {
   return buf;
 }
 
-class SBuffer hibernateDevices(void) {
-  SBuffer buf(2048);
+// FNV-1a of a device record, never 0 so that 0 means 'not in Flash'
+uint32_t hashDeviceRecord(const class SBuffer &buf) {
+  uint32_t hash = 0x811C9DC5;
+  for (uint32_t i = 0; i < buf.len(); i++) {
+    hash = (hash ^ buf.get8(i)) * 0x01000193;
+  }
+  return hash ? hash : 1;
+}
 
-  size_t devices_size = zigbee_devices.devicesSize();
-  if (devices_size > 32) { devices_size = 32; }         // arbitrarily limit to 32 devices, for now
-  buf.add8(devices_size);    // number of devices
+// Add a log record to buf, returns false if it does not fit
+bool addFlashRecord(class SBuffer &buf, uint8_t type, const uint8_t *payload, size_t len) {
+  size_t padded = (len + 3) & ~3;
+  if (buf.len() + 4 + padded > buf.size()) { return false; }
+  buf.add8(type);
+  buf.add8(len);
+  buf.add8(0xFF);
+  buf.add8(0xFF);         // not committed yet
+  buf.addBuffer(payload, len);
+  while (len++ < padded) { buf.add8(0xFF); }
+  return true;
+}
 
-  for (uint32_t i = 0; i < devices_size; i++) {
-    const Z_Device & device = zigbee_devices.devicesAt(i);
-    const SBuffer buf_device = hibernateDevice(device);
-    buf.addBuffer(buf_device);
+void hydrateDevice(const class SBuffer &buf_d) {
+  uint32_t dev_record_len = buf_d.len();
+  uint32_t d = 1;   // index in device buffer
+  uint16_t shortaddr = buf_d.get16(d);  d += 2;
+  uint64_t longaddr  = buf_d.get64(d);  d += 8;
+  zigbee_devices.updateDevice(shortaddr, longaddr);   // update device's addresses
+
+  uint32_t endpoints = buf_d.get8(d++);
+  zigbee_devices.clearEndpoints(shortaddr);           // a newer record replaces endpoints
+  for (uint32_t j = 0; j < endpoints; j++) {
+    uint8_t ep = buf_d.get8(d++);
+    uint16_t ep_profile = buf_d.get16(d);  d += 2;
+    zigbee_devices.addEndpoint(shortaddr, ep);
+
+    // in clusters
+    while (d < dev_record_len) {      // safe guard against overflow
+      uint8_t ep_cluster = buf_d.get8(d++);
+      if (0xFF == ep_cluster) { break; }   // end of block
+      // ignore
+    }
+    // out clusters
+    while (d < dev_record_len) {      // safe guard against overflow
+      uint8_t ep_cluster = buf_d.get8(d++);
+      if (0xFF == ep_cluster) { break; }   // end of block
+      // ignore
+    }
   }
 
-  size_t buf_len = buf.len();
-  if (buf_len > 2040) {
-    AddLog_P2(LOG_LEVEL_ERROR, PSTR(D_LOG_ZIGBEE "Devices list too big to fit in Flash (%d)"), buf_len);
-  }
+  // parse 3 strings
+  char empty[] = "";
 
-  // Log
-  char *hex_char = (char*) malloc((buf_len * 2) + 2);
-  if (hex_char) {
-    AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_ZIGBEE "ZbFlashStore %s"),
-                                    ToHex_P(buf.getBuffer(), buf_len, hex_char, (buf_len * 2) + 2));
-    free(hex_char);
-  }
+  // ManufID
+  uint32_t s_len = buf_d.strlen_s(d);
+  char *ptr = s_len ? buf_d.charptr(d) : empty;
+  zigbee_devices.setModelId(shortaddr, ptr);
+  d += s_len + 1;
 
-  return buf;
+  // ManufID
+  s_len = buf_d.strlen_s(d);
+  ptr = s_len ? buf_d.charptr(d) : empty;
+  zigbee_devices.setManufId(shortaddr, ptr);
+  d += s_len + 1;
+
+  // FriendlyName
+  s_len = buf_d.strlen_s(d);
+  ptr = s_len ? buf_d.charptr(d) : empty;
+  zigbee_devices.setFriendlyName(shortaddr, ptr);
+  d += s_len + 1;
+
+  // Hue bulbtype - if present
+  if (d < dev_record_len) {
+    zigbee_devices.setHueBulbtype(shortaddr, buf_d.get8(d));
+    d++;
+  }
 }
 
+// Legacy 'zig1' format, array of device records
 void hydrateDevices(const SBuffer &buf) {
   uint32_t buf_len = buf.len();
   if (buf_len <= 10) { return; }
 
   uint32_t k = 0;
   uint32_t num_devices = buf.get8(k++);
-//size_t before = 0;
   for (uint32_t i = 0; (i < num_devices) && (k < buf_len); i++) {
     uint32_t dev_record_len = buf.get8(k);
+    if (0 == dev_record_len) { break; }
+    hydrateDevice(buf.subBuffer(k, dev_record_len));
+    k += dev_record_len;
+  }
+}
 
-    SBuffer buf_d = buf.subBuffer(k, dev_record_len);
-
-    uint32_t d = 1;   // index in device buffer
-    uint16_t shortaddr = buf_d.get16(d);  d += 2;
-    uint64_t longaddr  = buf_d.get64(d);  d += 8;
-    zigbee_devices.updateDevice(shortaddr, longaddr);   // update device's addresses
-
-    uint32_t endpoints = buf_d.get8(d++);
-    for (uint32_t j = 0; j < endpoints; j++) {
-      uint8_t ep = buf_d.get8(d++);
-      uint16_t ep_profile = buf_d.get16(d);  d += 2;
-      zigbee_devices.addEndpoint(shortaddr, ep);
-
-      // in clusters
-      while (d < dev_record_len) {      // safe guard against overflow
-        uint8_t ep_cluster = buf_d.get8(d++);
-        if (0xFF == ep_cluster) { break; }   // end of block
-        // ignore
-      }
-      // out clusters
-      while (d < dev_record_len) {      // safe guard against overflow
-        uint8_t ep_cluster = buf_d.get8(d++);
-        if (0xFF == ep_cluster) { break; }   // end of block
-        // ignore
+// Replay the log of 'zig2' records, returns the offset of free space in block
+size_t hydrateDevicesLog(const SBuffer &buf) {
+  size_t k = sizeof(z_flashdata_t);
+  while (k + 4 <= buf.len()) {
+    uint8_t type = buf.get8(k);
+    if (Z_FLASH_FREE == type) { break; }
+    size_t len = buf.get8(k + 1);
+    size_t padded = (len + 3) & ~3;
+    if (k + 4 + padded > buf.len()) { break; }
+    if (Z_FLASH_COMMITTED == buf.get8(k + 3)) {      // ignore records interrupted by a reset
+      if ((Z_FLASH_DEVICE == type) && (len > 11)) {
+        hydrateDevice(buf.subBuffer(k + 4, len));
+      } else if ((Z_FLASH_REMOVED == type) && (len >= 2)) {
+        zigbee_devices.removeDevice(buf.get16(k + 4));
       }
     }
-//AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_ZIGBEE "Device 0x%04X Memory3.shrink = %d"), shortaddr, ESP_getFreeHeap());
-
-    // parse 3 strings
-    char empty[] = "";
-
-    // ManufID
-    uint32_t s_len = buf_d.strlen_s(d);
-    char *ptr = s_len ? buf_d.charptr(d) : empty;
-    zigbee_devices.setModelId(shortaddr, ptr);
-    d += s_len + 1;
-
-    // ManufID
-    s_len = buf_d.strlen_s(d);
-    ptr = s_len ? buf_d.charptr(d) : empty;
-    zigbee_devices.setManufId(shortaddr, ptr);
-    d += s_len + 1;
-
-    // FriendlyName
-    s_len = buf_d.strlen_s(d);
-    ptr = s_len ? buf_d.charptr(d) : empty;
-    zigbee_devices.setFriendlyName(shortaddr, ptr);
-    d += s_len + 1;
-
-    // Hue bulbtype - if present
-    if (d < dev_record_len) {
-      zigbee_devices.setHueBulbtype(shortaddr, buf_d.get8(d));
-      d++;
-    }
+    k += 4 + padded;
+  }
+  return k;
+}
 
-    // next iteration
-    k += dev_record_len;
-//AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_ZIGBEE "Device %d After  Memory = %d"), i, ESP_getFreeHeap());
+// Remember what is in Flash so that only changed devices are written
+void hashZigbeeDevices(void) {
+  for (uint32_t i = 0; i < zigbee_devices.devicesSize(); i++) {
+    const SBuffer buf_device = hibernateDevice(zigbee_devices.devicesAt(i));
+    zigbee_devices.setFlashHash(i, hashDeviceRecord(buf_device));
   }
+  zigbee_devices.clearRemovedDevices();
 }
 
 void loadZigbeeDevices(void) {
+  z_flash_end = 0;
+  SBuffer buf(z_block_len);
+  buf.setLen(z_block_len);
+  ESP.flashRead(z_spi_start_sector * SPI_FLASH_SEC_SIZE + z_block_offset, (uint32_t*) buf.getBuffer(), z_block_len);
   z_flashdata_t flashdata;
-  memcpy_P(&flashdata, z_dev_start, sizeof(z_flashdata_t));
+  memcpy(&flashdata, buf.getBuffer(), sizeof(z_flashdata_t));
 //  AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_ZIGBEE "Memory %d"), ESP_getFreeHeap());
   AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_ZIGBEE "Zigbee signature in Flash: %08X - %d"), flashdata.name, flashdata.len);
 
   // Check the signature
-  if ((flashdata.name == ZIGB_NAME) && (flashdata.len > 0)) {
+  if ((flashdata.name == ZIGB_NAME) && (flashdata.len > 0) && (flashdata.len <= Z_MAX_FLASH)) {
     uint16_t buf_len = flashdata.len;
-    // parse what seems to be a valid entry
-    SBuffer buf(buf_len);
-    buf.addBuffer(z_dev_start + sizeof(z_flashdata_t), buf_len);
+    // parse what seems to be a valid entry, it is converted to the log format at next save
     AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_ZIGBEE "Zigbee devices data in Flash (%d bytes)"), buf_len);
-    hydrateDevices(buf);
-    zigbee_devices.clean();   // don't write back to Flash what we just loaded
+    hydrateDevices(buf.subBuffer(sizeof(z_flashdata_t), buf_len));
+  } else if (flashdata.name == ZIGB_LOG_NAME) {
+    z_flash_end = hydrateDevicesLog(buf);
+    AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_ZIGBEE "Zigbee devices data in Flash (%d bytes)"), z_flash_end);
   } else {
     AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_ZIGBEE "No zigbee devices data in Flash"));
   }
+  hashZigbeeDevices();
+  zigbee_devices.clean();   // don't write back to Flash what we just loaded
 //  AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_ZIGBEE "Memory %d"), ESP_getFreeHeap());
 }
 
-void saveZigbeeDevices(void) {
-  SBuffer buf = hibernateDevices();
-  size_t buf_len = buf.len();
-  if (buf_len > Z_MAX_FLASH) {
-    AddLog_P2(LOG_LEVEL_ERROR, PSTR(D_LOG_ZIGBEE "Buffer too big to fit in Flash (%d bytes)"), buf_len);
-    return;
+// Rewrite the whole block with one record per device
+void compactZigbeeDevices(void) {
+  SBuffer buf(z_block_len);
+  z_flashdata_t header = { ZIGB_LOG_NAME, 0xFFFF, 0xFFFF };
+  buf.addBuffer((uint8_t*) &header, sizeof(header));
+  for (uint32_t i = 0; i < zigbee_devices.devicesSize(); i++) {
+    const SBuffer buf_device = hibernateDevice(zigbee_devices.devicesAt(i));
+    if (!addFlashRecord(buf, Z_FLASH_DEVICE, buf_device.getBuffer(), buf_device.len())) {
+      AddLog_P2(LOG_LEVEL_ERROR, PSTR(D_LOG_ZIGBEE "Devices list too big to fit in Flash (%d devices)"), zigbee_devices.devicesSize());
+      return;
+    }
+    buf.set8(buf.len() - ((buf_device.len() + 3) & ~3) - 1, Z_FLASH_COMMITTED);
   }
+  size_t buf_len = buf.len();
 
   // first copy SPI buffer into ram
   uint8_t *spi_buffer = (uint8_t*) malloc(z_spi_len);
@@ -266,25 +323,64 @@ void saveZigbeeDevices(void) {
   // copy the flash into RAM to make local change, and write back the whole buffer
   ESP.flashRead(z_spi_start_sector * SPI_FLASH_SEC_SIZE, (uint32_t*) spi_buffer, SPI_FLASH_SEC_SIZE);
 
-  z_flashdata_t *flashdata = (z_flashdata_t*)(spi_buffer + z_block_offset);
-  flashdata->name = ZIGB_NAME;
-  flashdata->len = buf_len;
-  flashdata->reserved = 0;
-
-  memcpy(spi_buffer + z_block_offset + sizeof(z_flashdata_t), buf.getBuffer(), buf_len);
+  memset(spi_buffer + z_block_offset, 0xFF, z_block_len);
+  memcpy(spi_buffer + z_block_offset, buf.getBuffer(), buf_len);
 
   // buffer is now ready, write it back
   if (ESP.flashEraseSector(z_spi_start_sector)) {
     ESP.flashWrite(z_spi_start_sector * SPI_FLASH_SEC_SIZE, (uint32_t*) spi_buffer, SPI_FLASH_SEC_SIZE);
+    FLASH_WEAR(WEAR_ZIGBEE, 1, SPI_FLASH_SEC_SIZE);
+    z_flash_end = buf_len;
+    hashZigbeeDevices();
   }
 
   free(spi_buffer);
   AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_ZIGBEE "Zigbee Devices Data store in Flash (0x%08X - %d bytes)"), z_dev_start, buf_len);
 }
 
+void saveZigbeeDevices(void) {
+  // collect the records of removed and changed devices
+  SBuffer buf(Z_MAX_FLASH);
+  bool fits = true;
+  for (uint16_t shortaddr : zigbee_devices.removedDevices()) {
+    uint8_t payload[2] = { (uint8_t) shortaddr, (uint8_t) (shortaddr >> 8) };
+    fits = fits && addFlashRecord(buf, Z_FLASH_REMOVED, payload, sizeof(payload));
+  }
+  uint32_t changed = 0;
+  for (uint32_t i = 0; i < zigbee_devices.devicesSize(); i++) {
+    const Z_Device & device = zigbee_devices.devicesAt(i);
+    const SBuffer buf_device = hibernateDevice(device);
+    if (hashDeviceRecord(buf_device) != device.flash_hash) {
+      fits = fits && addFlashRecord(buf, Z_FLASH_DEVICE, buf_device.getBuffer(), buf_device.len());
+      changed++;
+    }
+  }
+  if (0 == buf.len()) { return; }       // nothing changed
+
+  if (!fits || !z_flash_end || (z_flash_end + buf.len() > z_block_len)) {
+    compactZigbeeDevices();
+    return;
+  }
+
+  // append records, then mark them as committed
+  uint32_t address = z_spi_start_sector * SPI_FLASH_SEC_SIZE + z_block_offset + z_flash_end;
+  ESP.flashWrite(address, (uint32_t*) buf.getBuffer(), buf.len());
+  uint32_t word;
+  for (uint32_t k = 0; k < buf.len(); k += 4 + ((buf.get8(k + 1) + 3) & ~3)) {
+    buf.set8(k + 3, Z_FLASH_COMMITTED);
+    memcpy(&word, buf.buf(k), 4);
+    ESP.flashWrite(address + k, &word, 4);
+  }
+  FLASH_WEAR(WEAR_ZIGBEE, 0, buf.len());
+  z_flash_end += buf.len();
+  hashZigbeeDevices();
+  AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_ZIGBEE "Zigbee Devices Data store in Flash (%d changed, %d of %d bytes used)"), changed, z_flash_end, z_block_len);
+}
+
 // Erase the flash area containing the ZigbeeData
 void eraseZigbeeDevices(void) {
   zigbee_devices.clean();     // avoid writing data to flash after erase
+  z_flash_end = 0;
   // first copy SPI buffer into ram
   uint8_t *spi_buffer = (uint8_t*) malloc(z_spi_len);
   if (!spi_buffer) {
@@ -300,6 +396,7 @@ void eraseZigbeeDevices(void) {
   // buffer is now ready, write it back
   if (ESP.flashEraseSector(z_spi_start_sector)) {
     ESP.flashWrite(z_spi_start_sector * SPI_FLASH_SEC_SIZE, (uint32_t*) spi_buffer, SPI_FLASH_SEC_SIZE);
+    FLASH_WEAR(WEAR_ZIGBEE, 1, SPI_FLASH_SEC_SIZE);
   }
 
   free(spi_buffer);
@@ -79,6 +79,34 @@ uint8_t Z_getDatatypeLen(uint8_t t) {
   }
 }
 
+// Kind of value decoded from a ZCL attribute
+enum Z_ValTypes {
+  Z_VAL_NULL,           // invalid or not decoded, published as null
+  Z_VAL_UINT,
+  Z_VAL_INT,
+  Z_VAL_FLOAT,
+  Z_VAL_DOUBLE,
+  Z_VAL_STR,            // character string in data/len
+  Z_VAL_HEX,            // raw bytes in data/len, published as hex string
+};
+
+// ZCL attribute decoded in place from the received payload, no allocation.
+// Strings and raw bytes are not copied, data points to the payload.
+typedef struct Z_AttrValue {
+  uint16_t              cluster;
+  uint16_t              attr_id;
+  uint8_t               attr_type;      // ZCL data type
+  uint8_t               val_type;       // Z_ValTypes
+  uint16_t              len;            // length of data for Z_VAL_STR and Z_VAL_HEX
+  const uint8_t *       data;
+  union {
+    uint32_t            u32;
+    int32_t             i32;
+    float               f32;
+    double              f64;
+  } val;
+} Z_AttrValue;
+
 
 // return value:
 // 0 = keep initial value
@@ -120,6 +148,23 @@ uint16_t CxToCluster(uint8_t cx) {
   return 0xFFFF;
 }
 
+// Reverse of CxToCluster() using binary search, Cx_cluster is sorted. Returns 0xFF if unknown
+uint8_t ClusterToCx(uint16_t cluster) {
+  uint32_t low = 0;
+  uint32_t high = ARRAY_SIZE(Cx_cluster);
+  while (low < high) {
+    uint32_t mid = (low + high) / 2;
+    uint16_t mid_cluster = pgm_read_word(&Cx_cluster[mid]);
+    if (mid_cluster == cluster) { return mid; }
+    if (mid_cluster < cluster) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return 0xFF;
+}
+
 enum Z_ConvOperators {
   Z_Nop,                // copy value
   Z_AddPressureUnit,    // add pressure unit attribute (non numerical)
@@ -587,29 +632,30 @@ typedef union ZCLHeaderFrameControl_t {
 } ZCLHeaderFrameControl_t;
 
 
+// The ZCL frame does not copy the payload, it reads it from the received buffer
+// which must outlive the frame object
 class ZCLFrame {
 public:
 
   ZCLFrame(uint8_t frame_control, uint16_t manuf_code, uint8_t transact_seq, uint8_t cmd_id,
-    const char *buf, size_t buf_len, uint16_t clusterid, uint16_t groupaddr,
+    const SBuffer &buf, size_t offset, size_t buf_len, uint16_t clusterid, uint16_t groupaddr,
     uint16_t srcaddr, uint8_t srcendpoint, uint8_t dstendpoint, uint8_t wasbroadcast,
     uint8_t linkquality, uint8_t securityuse, uint8_t seqnumber,
     uint32_t timestamp):
     _manuf_code(manuf_code), _transact_seq(transact_seq), _cmd_id(cmd_id),
-    _payload(buf_len ? buf_len : 250),      // allocate the data frame from source or preallocate big enough
+    _payload(buf.buf(offset)), _payload_len((offset + buf_len <= buf.len()) ? buf_len : ((offset < buf.len()) ? buf.len() - offset : 0)),
     _cluster_id(clusterid), _groupaddr(groupaddr),
     _srcaddr(srcaddr), _srcendpoint(srcendpoint), _dstendpoint(dstendpoint), _wasbroadcast(wasbroadcast),
     _linkquality(linkquality), _securityuse(securityuse), _seqnumber(seqnumber),
     _timestamp(timestamp)
     {
       _frame_control.d8 = frame_control;
-      _payload.addBuffer(buf, buf_len);
     };
 
 
   void log(void) {
-    char hex_char[_payload.len()*2+2];
-		ToHex_P((unsigned char*)_payload.getBuffer(), _payload.len(), hex_char, sizeof(hex_char));
+    char hex_char[_payload_len*2+2];
+		ToHex_P(_payload, _payload_len, hex_char, sizeof(hex_char));
     Response_P(PSTR("{\"" D_JSON_ZIGBEEZCL_RECEIVED "\":{"
                     "\"groupid\":%d," "\"clusterid\":%d," "\"srcaddr\":\"0x%04X\","
                     "\"srcendpoint\":%d," "\"dstendpoint\":%d," "\"wasbroadcast\":%d,"
@@ -649,7 +695,7 @@ public:
     transact_seq = buf.get8(i++);
     cmd_id = buf.get8(i++);
     ZCLFrame zcl_frame(frame_control.d8, manuf_code, transact_seq, cmd_id,
-                       (const char *)(buf.buf() + i), len + offset - i,
+                       buf, i, (len + offset > i) ? len + offset - i : 0,
                        clusterid, groupid,
                        srcaddr, srcendpoint, dstendpoint, wasbroadcast,
                        linkquality, securityuse, seqnumber,
@@ -661,7 +707,9 @@ public:
     return _frame_control.b.frame_type & 1;
   }
 
-  static void generateAttributeName(const JsonObject& json, uint16_t cluster, uint16_t attr, char *key, size_t key_len);
+  static void generateAttributeName(char *key, size_t key_len, uint16_t cluster, uint16_t attr, uint32_t suffix);
+  void addAttribute(JsonObject& json, const Z_AttrValue &value, uint32_t suffix);
+  void updateHueState(const Z_AttrValue &value);
   void parseReportAttributes(JsonObject& json, uint8_t offset = 0);
   void parseReadAttributes(JsonObject& json, uint8_t offset = 0);
   void parseReadAttributesResponse(JsonObject& json, uint8_t offset = 0);
@@ -689,20 +737,21 @@ public:
     return _srcendpoint;
   }
 
-  const SBuffer &getPayload(void) const {
-    return _payload;
-  }
-
   uint16_t getManufCode(void) const {
     return _manuf_code;
   }
 
+  inline uint8_t getTransactSeq(void) const {
+    return _transact_seq;
+  }
+
 private:
   ZCLHeaderFrameControl_t _frame_control = { .d8 = 0 };
   uint16_t                _manuf_code = 0;      // optional
   uint8_t                 _transact_seq = 0;    // transaction sequence number
   uint8_t                 _cmd_id = 0;
-  SBuffer                 _payload;
+  const uint8_t *         _payload;             // in the received buffer
+  uint16_t                _payload_len;
   uint16_t                _cluster_id = 0;
   uint16_t                _groupaddr = 0;
   // information from decoded ZCL frame
@@ -836,266 +885,402 @@ int32_t encodeSingleAttribute(class SBuffer &buf, const JsonVariant &val, float
   return len + (status ? 4 : 3);
 }
 
-uint32_t parseSingleAttribute(JsonObject& json, char *attrid_str, class SBuffer &buf,
-                              uint32_t offset, uint32_t buflen) {
-
+//
+// Decode the attribute at buf[offset], starting with its type, into value. The cluster and
+// attribute id are left untouched. Returns the number of bytes of type and value.
+//
+uint32_t Z_DecodeAttribute(const uint8_t *buf, uint32_t buflen, uint32_t offset, struct Z_AttrValue &value) {
   uint32_t i = offset;
-  uint32_t attrtype = buf.get8(i++);
+  uint32_t attrtype = (i < buflen) ? buf[i] : Znodata;
+  i++;
+  uint32_t len = Z_getDatatypeLen(attrtype);    // pre-compute lenght, overloaded for variable length attributes
 
-  // fallback - enter a null value
-  json[attrid_str] = (char*) nullptr;
+  value.attr_type = attrtype;
+  value.val_type = Z_VAL_NULL;    // fallback to a null value
+  value.len = 0;
+  value.data = nullptr;
+  value.val.u32 = 0;
 
-  uint32_t len = Z_getDatatypeLen(attrtype);    // pre-compute lenght, overloaded for variable length attributes
+  if (i + len > buflen) {         // truncated value
+    return i - offset + len;
+  }
+  const uint8_t *p = buf + i;
+  uint32_t u32 = 0;
+  for (uint32_t b = 0; (b < len) && (b < 4); b++) {     // little endian value up to 4 bytes
+    u32 |= p[b] << (8 * b);
+  }
 
   // now parse accordingly to attr type
   switch (attrtype) {
-    // case Znodata:      // nodata
-    // case Zunk:      // unk
-    //   break;
-    case Zbool:      // bool
+    case Zbool:       // bool
     case Zuint8:      // uint8
     case Zenum8:      // enum8
-      {
-        uint8_t uint8_val = buf.get8(i);
-        // i += 1;
-        if (0xFF != uint8_val) {
-          json[attrid_str] = uint8_val;
-        }
-      }
+      if (0xFF != u32) { value.val_type = Z_VAL_UINT; value.val.u32 = u32; }
       break;
-    case Zuint16:      // uint16
-    case Zenum16:      // enum16
-      {
-        uint16_t uint16_val = buf.get16(i);
-        // i += 2;
-        if (0xFFFF != uint16_val) {
-          json[attrid_str] = uint16_val;
-        }
-      }
+    case Zuint16:     // uint16
+    case Zenum16:     // enum16
+      if (0xFFFF != u32) { value.val_type = Z_VAL_UINT; value.val.u32 = u32; }
       break;
-    case Zuint32:      // uint32
-    case ZUTC:      // UTC
-      {
-        uint32_t uint32_val = buf.get32(i);
-        // i += 4;
-        if (0xFFFFFFFF != uint32_val) {
-          json[attrid_str] = uint32_val;
-        }
-      }
+    case Zuint32:     // uint32
+    case ZUTC:        // UTC
+      if (0xFFFFFFFF != u32) { value.val_type = Z_VAL_UINT; value.val.u32 = u32; }
       break;
     // Note: uint40, uint48, uint56, uint64 are displayed as Hex
     // Note: int40, int48, int56, int64 are displayed as Hex
-    case Zuint40:    // uint40
-    case Zuint48:    // uint48
-    case Zuint56:    // uint56
-    case Zuint64:    // uint64
-    case Zint40:    // int40
-    case Zint48:    // int48
-    case Zint56:    // int56
-    case Zint64:    // int64
-      {
-        // uint8_t len = attrtype - 0x27;   // 5 - 8
-        // print as HEX
-        char hex[2*len+1];
-        ToHex_P(buf.buf(i), len, hex, sizeof(hex));
-        json[attrid_str] = hex;
-        // i += len;
-      }
+    case Zuint40:     // uint40
+    case Zuint48:     // uint48
+    case Zuint56:     // uint56
+    case Zuint64:     // uint64
+    case Zint40:      // int40
+    case Zint48:      // int48
+    case Zint56:      // int56
+    case Zint64:      // int64
+      value.val_type = Z_VAL_HEX;
+      value.data = p;
+      value.len = len;
       break;
-    case Zint8:      // int8
-      {
-        int8_t int8_val = buf.get8(i);
-        // i += 1;
-        if (0x80 != int8_val) {
-          json[attrid_str] = int8_val;
-        }
-      }
+    case Zint8:       // int8
+      if (0x80 != u32) { value.val_type = Z_VAL_INT; value.val.i32 = (int8_t) u32; }
       break;
     case Zint16:      // int16
-      {
-        int16_t int16_val = buf.get16(i);
-        // i += 2;
-        if (0x8000 != int16_val) {
-          json[attrid_str] = int16_val;
-        }
-      }
+      if (0x8000 != u32) { value.val_type = Z_VAL_INT; value.val.i32 = (int16_t) u32; }
       break;
     case Zint32:      // int32
-      {
-        int32_t int32_val = buf.get32(i);
-        // i += 4;
-        if (0x80000000 != int32_val) {
-          json[attrid_str] = int32_val;
-        }
-      }
+      if (0x80000000 != u32) { value.val_type = Z_VAL_INT; value.val.i32 = (int32_t) u32; }
       break;
 
-    case Zoctstr:      // octet string, 1 byte len
-    case Zstring:      // char string, 1 byte len
-    case Zoctstr16:      // octet string, 2 bytes len
-    case Zstring16:      // char string, 2 bytes len
-      // For strings, default is to try to do a real string, but reverts to octet stream if null char is present or on some exceptions
+    case Zoctstr:     // octet string, 1 byte len
+    case Zstring:     // char string, 1 byte len
+    case Zoctstr16:   // octet string, 2 bytes len
+    case Zstring16:   // char string, 2 bytes len
       {
-        bool parse_as_string = true;
-        len = (attrtype <= 0x42) ? buf.get8(i) : buf.get16(i);    // len is 8 or 16 bits
-        i += (attrtype <= 0x42) ? 1 : 2;                                   // increment pointer
-        if (i + len > buf.len()) {        // make sure we don't get past the buffer
-          len = buf.len() - i;
+        uint32_t len_size = (attrtype <= 0x42) ? 1 : 2;   // len is 8 or 16 bits
+        if (i + len_size > buflen) {
+          len = buflen - i;
+          break;
         }
-
-        // check if we can safely use a string
-        if ((0x41 == attrtype) || (0x43 == attrtype)) { parse_as_string = false; }
-
-        if (parse_as_string) {
-          char str[len+1];
-          strncpy(str, buf.charptr(i), len);
-          str[len] = 0x00;
-          json[attrid_str] = str;
-        } else {
-          // print as HEX
-          char hex[2*len+1];
-          ToHex_P(buf.buf(i), len, hex, sizeof(hex));
-          json[attrid_str] = hex;
+        len = (1 == len_size) ? buf[i] : buf[i] | (buf[i+1] << 8);
+        i += len_size;
+        if (i + len > buflen) {       // make sure we don't get past the buffer
+          len = buflen - i;
         }
-
-        // i += len;
-        // break;
+        // octet strings are displayed as Hex
+        value.val_type = ((Zoctstr == attrtype) || (Zoctstr16 == attrtype)) ? Z_VAL_HEX : Z_VAL_STR;
+        value.data = buf + i;
+        value.len = len;
       }
-      // i += buf.get8(i) + 1;
       break;
 
     case Zdata8:      // data8
-    case Zmap8:      // map8
-      {
-        uint8_t uint8_val = buf.get8(i);
-        // i += 1;
-        json[attrid_str] = uint8_val;
-      }
-      break;
-    case Zdata16:      // data16
+    case Zmap8:       // map8
+    case Zdata16:     // data16
     case Zmap16:      // map16
-      {
-        uint16_t uint16_val = buf.get16(i);
-        // i += 2;
-        json[attrid_str] = uint16_val;
-      }
-      break;
-    case Zdata32:      // data32
+    case Zdata32:     // data32
     case Zmap32:      // map32
-      {
-        uint32_t uint32_val = buf.get32(i);
-        // i += 4;
-        json[attrid_str] = uint32_val;
-      }
+      value.val_type = Z_VAL_UINT;
+      value.val.u32 = u32;
       break;
 
-    case Zsingle:      // float
-      {
-        uint32_t uint32_val = buf.get32(i);
-        float  * float_val = (float*) &uint32_val;
-        // i += 4;
-        json[attrid_str] = *float_val;
-      }
+    case Zsingle:     // float
+      value.val_type = Z_VAL_FLOAT;
+      memcpy(&value.val.f32, &u32, sizeof(value.val.f32));
+      break;
+    case Zdouble:     // double precision
+      value.val_type = Z_VAL_DOUBLE;
+      memcpy(&value.val.f64, p, sizeof(value.val.f64));
       break;
 
-    // TODO
-    case ZToD:      // ToD
-    case Zdate:      // date
-    case ZclusterId:      // clusterId
-    case ZattribId:      // attribId
-    case ZbacOID:      // bacOID
-    case ZEUI64:      // EUI64
-    case Zkey128:      // key128
-    case Zsemi:      // semi (float on 2 bytes)
+    // TODO: ToD, date, clusterId, attribId, bacOID, EUI64, key128, semi, data24-64 and map24-64 are left null
+    default:
       break;
+  }
+  i += len;
+  return i - offset;    // how much have we increased the index
+}
+
+float Z_AttrValueFloat(const struct Z_AttrValue &value) {
+  switch (value.val_type) {
+    case Z_VAL_UINT:    return value.val.u32;
+    case Z_VAL_INT:     return value.val.i32;
+    case Z_VAL_FLOAT:   return value.val.f32;
+    case Z_VAL_DOUBLE:  return value.val.f64;
+  }
+  return 0.0f;
+}
+
+// Publish the value in json, applying the multiplier of the converter
+// key must not be const, so that ArduinoJson makes a copy of it
+void Z_AttrValueToJson(JsonObject& json, char *key, const struct Z_AttrValue &value, int16_t multiplier = 1) {
+  if (0 == multiplier) { return; }
+  bool numerical = (Z_VAL_UINT == value.val_type) || (Z_VAL_INT == value.val_type) ||
+                   (Z_VAL_FLOAT == value.val_type) || (Z_VAL_DOUBLE == value.val_type);
+  if ((1 != multiplier) && numerical) {     // non numerical values are copied unchanged
+    float val_f = Z_AttrValueFloat(value);
+    json[key] = (multiplier > 0) ? val_f * multiplier : val_f / (-multiplier);
+    return;
+  }
 
-    // Other un-implemented data types
-    case Zdata24:      // data24
-    case Zdata40:      // data40
-    case Zdata48:      // data48
-    case Zdata56:      // data56
-    case Zdata64:      // data64
+  switch (value.val_type) {
+    case Z_VAL_UINT:
+      json[key] = value.val.u32;
+      break;
+    case Z_VAL_INT:
+      json[key] = value.val.i32;
       break;
-    // map<x>
-    case Zmap24:      // map24
-    case Zmap40:      // map40
-    case Zmap48:      // map48
-    case Zmap56:      // map56
-    case Zmap64:      // map64
+    case Z_VAL_FLOAT:
+      json[key] = value.val.f32;
       break;
-    case Zdouble:      // double precision
+    case Z_VAL_DOUBLE:
+      json[key] = value.val.f64;
+      break;
+    case Z_VAL_STR:
+      {
+        char str[value.len + 1];
+        strncpy(str, (const char*) value.data, value.len);
+        str[value.len] = 0x00;
+        json[key] = str;
+      }
+      break;
+    case Z_VAL_HEX:
       {
-        uint64_t uint64_val = buf.get64(i);
-        double  * double_val = (double*) &uint64_val;
-        // i += 8;
-        json[attrid_str] = *double_val;
+        char hex[2*value.len + 1];
+        ToHex_P(value.data, value.len, hex, sizeof(hex));
+        json[key] = hex;
       }
       break;
+    default:
+      json[key] = (char*) nullptr;
+      break;
   }
-  i += len;
-
-  // String pp;    // pretty print
-  // json[attrid_str].prettyPrintTo(pp);
-  // // now store the attribute
-  // AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_ZIGBEE "ZCL attribute decoded, id %s, type 0x%02X, val=%s"),
-  //                                attrid_str, attrtype, pp.c_str());
-  return i - offset;    // how much have we increased the index
 }
 
 // Generate an attribute name based on cluster number, attribute, and suffix if duplicates
-void ZCLFrame::generateAttributeName(const JsonObject& json, uint16_t cluster, uint16_t attr, char *key, size_t key_len) {
-  uint32_t suffix = 1;
-
-  snprintf_P(key, key_len, PSTR("%04X/%04X"), cluster, attr);
-  while (json.containsKey(key)) {
-    suffix++;
+void ZCLFrame::generateAttributeName(char *key, size_t key_len, uint16_t cluster, uint16_t attr, uint32_t suffix) {
+  if (suffix > 1) {
     snprintf_P(key, key_len, PSTR("%04X/%04X+%d"), cluster, attr, suffix);    // add "0008/0001+2" suffix if duplicate
+  } else {
+    snprintf_P(key, key_len, PSTR("%04X/%04X"), cluster, attr);
+  }
+}
+
+// Update the Hue bulb status from the numerical value
+void ZCLFrame::updateHueState(const Z_AttrValue &value) {
+  if ((Z_VAL_UINT != value.val_type) && (Z_VAL_INT != value.val_type)) { return; }
+  uint16_t cluster = value.cluster;
+  uint16_t attribute = value.attr_id;
+  uint32_t val = value.val.u32;
+
+  if ((cluster == 0x0006) && ((attribute == 0x0000) || (attribute == 0x8000))) {
+    bool power = val;
+    zigbee_devices.updateHueState(_srcaddr, &power, nullptr, nullptr, nullptr,
+                                    nullptr, nullptr, nullptr, nullptr, nullptr);
+  } else if ((cluster == 0x0008) && (attribute == 0x0000)) {
+    uint8_t dimmer = val;
+    zigbee_devices.updateHueState(_srcaddr, nullptr, nullptr, &dimmer, nullptr,
+                                    nullptr, nullptr, nullptr, nullptr, nullptr);
+  } else if ((cluster == 0x0300) && (attribute == 0x0000)) {
+    uint16_t hue = changeUIntScale(val, 0, 254, 0, 360);     // change range from 0..254 to 0..360
+    zigbee_devices.updateHueState(_srcaddr, nullptr, nullptr, nullptr, nullptr,
+                                    nullptr, &hue, nullptr, nullptr, nullptr);
+  } else if ((cluster == 0x0300) && (attribute == 0x0001)) {
+    uint8_t sat = val;
+    zigbee_devices.updateHueState(_srcaddr, nullptr, nullptr, nullptr, &sat,
+                                    nullptr, nullptr, nullptr, nullptr, nullptr);
+  } else if ((cluster == 0x0300) && (attribute == 0x0003)) {
+    uint16_t x = val;
+    zigbee_devices.updateHueState(_srcaddr, nullptr, nullptr, nullptr, nullptr,
+                                    nullptr, nullptr, &x, nullptr, nullptr);
+  } else if ((cluster == 0x0300) && (attribute == 0x0004)) {
+    uint16_t y = val;
+    zigbee_devices.updateHueState(_srcaddr, nullptr, nullptr, nullptr, nullptr,
+                                    nullptr, nullptr, nullptr, &y, nullptr);
+  } else if ((cluster == 0x0300) && (attribute == 0x0007)) {
+    uint16_t ct = val;
+    zigbee_devices.updateHueState(_srcaddr, nullptr, nullptr, nullptr, nullptr,
+                                    &ct, nullptr, nullptr, nullptr, nullptr);
+  } else if ((cluster == 0x0300) && (attribute == 0x0008)) {
+    uint8_t colormode = val;
+    zigbee_devices.updateHueState(_srcaddr, nullptr, &colormode, nullptr, nullptr,
+                                    nullptr, nullptr, nullptr, nullptr, nullptr);
+  }
+}
+
+// Publish a decoded attribute under its final name
+// Attributes with a converter callback are published with their "CCCC/AAAA" name
+// and converted later by postProcessAttributes()
+void ZCLFrame::addAttribute(JsonObject& json, const Z_AttrValue &value, uint32_t suffix) {
+  char key[40];
+  updateHueState(value);
+
+  uint32_t conv_start, conv_end;
+  Z_PostProcessRange(value.cluster, &conv_start, &conv_end);
+  bool converted = false;
+  for (uint32_t i = conv_start; i < conv_end; i++) {
+    uint16_t conv_attribute = pgm_read_word(&Z_PostProcess[i].attribute);
+    if ((conv_attribute == value.attr_id) || (conv_attribute == 0xFFFF)) {
+      if (Z_Nop != pgm_read_byte(&Z_PostProcess[i].cb)) {
+        converted = false;        // the callback needs the original value
+        break;
+      }
+      converted = true;
+    }
+  }
+
+  if (!converted) {
+    generateAttributeName(key, sizeof(key), value.cluster, value.attr_id, suffix);
+    Z_AttrValueToJson(json, key, value);
+    return;
+  }
+
+  for (uint32_t i = conv_start; i < conv_end; i++) {
+    const Z_AttributeConverter *converter = &Z_PostProcess[i];
+    uint16_t conv_attribute = pgm_read_word(&converter->attribute);
+    if ((conv_attribute == value.attr_id) || (conv_attribute == 0xFFFF)) {
+      int16_t conv_multiplier = pgm_read_word(&converter->multiplier);
+      if (0 == conv_multiplier) { continue; }       // drop value
+      strncpy_P(key, converter->name, sizeof(key));
+      key[sizeof(key) - 1] = 0;
+      if (suffix > 1) {
+        snprintf_P(key + strlen(key), sizeof(key) - strlen(key), PSTR("%d"), suffix);   // append suffix number
+      }
+      Z_AttrValueToJson(json, key, value, conv_multiplier);
+    }
+  }
+}
+
+// Count the previous occurences of the same attribute in the frame
+uint32_t Z_AttrSuffix(uint16_t *seen, uint32_t *seen_count, size_t seen_max, uint16_t attrid) {
+  uint32_t suffix = 1;
+  for (uint32_t i = 0; i < *seen_count; i++) {
+    if (seen[i] == attrid) { suffix++; }
   }
+  if (*seen_count < seen_max) { seen[(*seen_count)++] = attrid; }
+  return suffix;
 }
 
-// First pass, parse all attributes in their native format
+// Parse all attributes in place and publish them under their final name
 void ZCLFrame::parseReportAttributes(JsonObject& json, uint8_t offset) {
   uint32_t i = offset;
-  uint32_t len = _payload.len();
+  uint32_t len = _payload_len;
+  uint16_t seen[32];
+  uint32_t seen_count = 0;
+  Z_AttrValue value;
+  value.cluster = _cluster_id;
 
   while (len >= i + 3) {
-    uint16_t attrid = _payload.get16(i);
+    value.attr_id = _payload[i] | (_payload[i+1] << 8);
     i += 2;
 
-    char key[16];
-    generateAttributeName(json, _cluster_id, attrid, key, sizeof(key));
-
+    i += Z_DecodeAttribute(_payload, len, i, value);
     // exception for Xiaomi lumi.weather - specific field to be treated as octet and not char
-    if ((0x0000 == _cluster_id) && (0xFF01 == attrid)) {
-      if (0x42 == _payload.get8(i)) {
-        _payload.set8(i, 0x41);   // change type from 0x42 to 0x41
+    if ((0x0000 == _cluster_id) && (0xFF01 == value.attr_id) && (Z_VAL_STR == value.val_type)) {
+      value.val_type = Z_VAL_HEX;
+    }
+    addAttribute(json, value, Z_AttrSuffix(seen, &seen_count, ARRAY_SIZE(seen), value.attr_id));
+  }
+}
+
+// Entries of Z_PostProcess are grouped by cluster, keep the range [start, end) of entries for each cluster
+// so that attributes are matched against their cluster entries only
+uint16_t Z_PostProcessStart[ARRAY_SIZE(Cx_cluster)];
+uint16_t Z_PostProcessEnd[ARRAY_SIZE(Cx_cluster)];
+bool     Z_PostProcessIndexed = false;
+
+// Get the range of Z_PostProcess entries for a cluster, empty range if there are none
+void Z_PostProcessRange(uint16_t cluster, uint32_t *start, uint32_t *end) {
+  if (!Z_PostProcessIndexed) {
+    for (uint32_t i = ARRAY_SIZE(Z_PostProcess); i > 0; i--) {   // backwards so that start ends up on the first entry
+      uint8_t cx = pgm_read_byte(&Z_PostProcess[i - 1].cluster_short);
+      if (cx >= ARRAY_SIZE(Cx_cluster)) { continue; }
+      if (!Z_PostProcessEnd[cx]) { Z_PostProcessEnd[cx] = i; }
+      Z_PostProcessStart[cx] = i - 1;
+    }
+    Z_PostProcessIndexed = true;
+  }
+  *start = 0;
+  *end = 0;
+  uint8_t cx = ClusterToCx(cluster);
+  if (cx < ARRAY_SIZE(Cx_cluster)) {
+    *start = Z_PostProcessStart[cx];
+    *end = Z_PostProcessEnd[cx];
+  }
+}
+
+// Index of Z_PostProcess entries by attribute name so that ZbSend and ZbRead do not compare all names,
+// open addressing with linear probing where each slot holds the entry index +1 or 0 if empty.
+// Entries are inserted in table order so the first entry of a name shared by clusters is found first
+uint16_t *Z_PostProcessNames = nullptr;
+uint32_t  Z_PostProcessNamesMask = 0;
+
+// FNV-1a hash of the lower case name
+uint32_t Z_NameHash(const char *name, bool progmem) {
+  uint32_t hash = 2166136261;
+  while (true) {
+    char c = (progmem) ? pgm_read_byte(name) : *name;
+    if (!c) { break; }
+    hash = (hash ^ (uint8_t)tolower(c)) * 16777619;
+    name++;
+  }
+  return hash;
+}
+
+// Find the first Z_PostProcess entry with the name, case insensitive. Returns the entry index +1 or 0 if unknown
+uint32_t Z_PostProcessFind(const char *name) {
+  if (!Z_PostProcessNames) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < ARRAY_SIZE(Z_PostProcess); i++) {
+      if (Z_PostProcess[i].name) { count++; }
+    }
+    uint32_t size = 16;
+    while (size < count + count / 2) { size <<= 1; }   // Keep the table at most 2/3 full
+    Z_PostProcessNames = new uint16_t[size]();
+    if (Z_PostProcessNames) {
+      Z_PostProcessNamesMask = size - 1;
+      for (uint32_t i = 0; i < ARRAY_SIZE(Z_PostProcess); i++) {
+        if (!Z_PostProcess[i].name) { continue; }
+        uint32_t slot = Z_NameHash(Z_PostProcess[i].name, true) & Z_PostProcessNamesMask;
+        while (Z_PostProcessNames[slot]) { slot = (slot + 1) & Z_PostProcessNamesMask; }
+        Z_PostProcessNames[slot] = i + 1;
       }
     }
-    i += parseSingleAttribute(json, key, _payload, i, len);
   }
+
+  if (!Z_PostProcessNames) {           // No memory for the index, scan the table
+    for (uint32_t i = 0; i < ARRAY_SIZE(Z_PostProcess); i++) {
+      if ((Z_PostProcess[i].name) && (0 == strcasecmp_P(name, Z_PostProcess[i].name))) { return i + 1; }
+    }
+    return 0;
+  }
+  uint32_t slot = Z_NameHash(name, false) & Z_PostProcessNamesMask;
+  while (uint32_t entry = Z_PostProcessNames[slot]) {
+    if (0 == strcasecmp_P(name, Z_PostProcess[entry - 1].name)) { return entry; }
+    slot = (slot + 1) & Z_PostProcessNamesMask;
+  }
+  return 0;
 }
 
 // ZCL_READ_ATTRIBUTES
 // TODO
 void ZCLFrame::parseReadAttributes(JsonObject& json, uint8_t offset) {
   uint32_t i = offset;
-  uint32_t len = _payload.len();
+  uint32_t len = _payload_len;
 
   json[F(D_CMND_ZIGBEE_CLUSTER)] = _cluster_id;
 
   JsonArray &attr_list = json.createNestedArray(F("Read"));
   JsonObject &attr_names = json.createNestedObject(F("ReadNames"));
+  uint32_t conv_start, conv_end;
+  Z_PostProcessRange(_cluster_id, &conv_start, &conv_end);
   while (len - i >= 2) {
-    uint16_t attrid = _payload.get16(i);
+    uint16_t attrid = _payload[i] | (_payload[i+1] << 8);
     attr_list.add(attrid);
 
     // find the attribute name
-    for (uint32_t i = 0; i < ARRAY_SIZE(Z_PostProcess); i++) {
+    for (uint32_t i = conv_start; i < conv_end; i++) {
       const Z_AttributeConverter *converter = &Z_PostProcess[i];
-      uint16_t conv_cluster = CxToCluster(pgm_read_byte(&converter->cluster_short));
       uint16_t conv_attribute = pgm_read_word(&converter->attribute);
 
-      if ((conv_cluster == _cluster_id) && (conv_attribute == attrid)) {
+      if (conv_attribute == attrid) {
         attr_names[(const __FlashStringHelper*) converter->name] = true;
         break;
       }
@@ -1107,29 +1292,31 @@ void ZCLFrame::parseReadAttributes(JsonObject& json, uint8_t offset) {
 // ZCL_READ_ATTRIBUTES_RESPONSE
 void ZCLFrame::parseReadAttributesResponse(JsonObject& json, uint8_t offset) {
   uint32_t i = offset;
-  uint32_t len = _payload.len();
+  uint32_t len = _payload_len;
+  uint16_t seen[32];
+  uint32_t seen_count = 0;
+  Z_AttrValue value;
+  value.cluster = _cluster_id;
 
   while (len >= i + 4) {
-    uint16_t attrid = _payload.get16(i);
+    value.attr_id = _payload[i] | (_payload[i+1] << 8);
     i += 2;
-    uint8_t status = _payload.get8(i++);
+    uint8_t status = _payload[i++];
 
     if (0 == status) {
-      char key[16];
-      generateAttributeName(json, _cluster_id, attrid, key, sizeof(key));
-
-      i += parseSingleAttribute(json, key, _payload, i, len);
+      i += Z_DecodeAttribute(_payload, len, i, value);
+      addAttribute(json, value, Z_AttrSuffix(seen, &seen_count, ARRAY_SIZE(seen), value.attr_id));
     }
   }
 }
 
 // ZCL_DEFAULT_RESPONSE
 void ZCLFrame::parseResponse(void) {
-  if (_payload.len() < 2) { return; }   // wrong format
-  uint8_t cmd = _payload.get8(0);
-  uint8_t status = _payload.get8(1);
+  if (_payload_len < 2) { return; }   // wrong format
+  uint8_t cmd = _payload[0];
+  uint8_t status = _payload[1];
 
-  DynamicJsonBuffer jsonBuffer;
+  JsonParseBuffer jsonBuffer;
   JsonObject& json = jsonBuffer.createObject();
 
   // "Device"
@@ -1168,7 +1355,9 @@ void ZCLFrame::parseResponse(void) {
 
 // Parse non-normalized attributes
 void ZCLFrame::parseClusterSpecificCommand(JsonObject& json, uint8_t offset) {
-  convertClusterSpecific(json, _cluster_id, _cmd_id, _frame_control.b.direction, _payload);
+  SBuffer payload(_payload_len);      // commands are parsed from their hex representation, they are not frequent
+  payload.addBuffer(_payload, _payload_len);
+  convertClusterSpecific(json, _cluster_id, _cmd_id, _frame_control.b.direction, payload);
   sendHueUpdate(_srcaddr, _groupaddr, _cluster_id, _cmd_id, _frame_control.b.direction);
 }
 
@@ -1210,7 +1399,7 @@ int32_t Z_FloatDiv2Func(const class ZCLFrame *zcl, uint16_t shortaddr, JsonObjec
 
 // Publish a message for `"Occupancy":0` when the timer expired
 int32_t Z_OccupancyCallback(uint16_t shortaddr, uint16_t groupaddr, uint16_t cluster, uint8_t endpoint, uint32_t value) {
-  DynamicJsonBuffer jsonBuffer;
+  JsonParseBuffer jsonBuffer;
   JsonObject& json = jsonBuffer.createObject();
   json[F(OCCUPANCY)] = 0;
   zigbee_devices.jsonPublishNow(shortaddr, json);
@@ -1332,18 +1521,16 @@ int32_t Z_AqaraSensorFunc(const class ZCLFrame *zcl, uint16_t shortaddr, JsonObj
   SBuffer buf2 = SBuffer::SBufferFromHex(hex.c_str(), hex.length());
   uint32_t i = 0;
   uint32_t len = buf2.len();
-  char tmp[] = "tmp";   // for obscure reasons, it must be converted from const char* to char*, otherwise ArduinoJson gets confused
+  Z_AttrValue sub_value;
 
-  JsonVariant sub_value;
   const char * modelId_c = zigbee_devices.getModelId(shortaddr);  // null if unknown
   String modelId((char*) modelId_c);
 
   while (len - i >= 2) {
     uint8_t attrid = buf2.get8(i++);
 
-    i += parseSingleAttribute(json, tmp, buf2, i, len);
-    float val = json[tmp];
-    json.remove(tmp);
+    i += Z_DecodeAttribute(buf2.getBuffer(), len, i, sub_value);
+    float val = Z_AttrValueFloat(sub_value);
     bool translated = false;    // were we able to translate to a known format?
     if (0x01 == attrid) {
       json[F(D_JSON_VOLTAGE)] = val / 1000.0f;
@@ -1397,7 +1584,7 @@ int32_t Z_ApplyConverter(const class ZCLFrame *zcl, uint16_t shortaddr, JsonObje
       if (multiplier > 0) {
         json[new_name] = ((float)value) * multiplier;
       } else {
-        json[new_name] = ((float)value) / multiplier;
+        json[new_name] = ((float)value) / (-multiplier);
       }
   }
 
@@ -1431,6 +1618,7 @@ int32_t Z_ApplyConverter(const class ZCLFrame *zcl, uint16_t shortaddr, JsonObje
   }
 }
 
+// Apply the converter callbacks to the attributes left with their "CCCC/AAAA" name by addAttribute()
 void ZCLFrame::postProcessAttributes(uint16_t shortaddr, JsonObject& json) {
   // iterate on json elements
   for (auto kv : json) {
@@ -1451,52 +1639,17 @@ void ZCLFrame::postProcessAttributes(uint16_t shortaddr, JsonObject& json) {
         suffix = strtoul(delimiter2+1, nullptr, 10);
       }
 
-      // see if we need to update the Hue bulb status
-      if ((cluster == 0x0006) && ((attribute == 0x0000) || (attribute == 0x8000))) {
-        bool power = value;
-        zigbee_devices.updateHueState(shortaddr, &power, nullptr, nullptr, nullptr,
-                                        nullptr, nullptr, nullptr, nullptr, nullptr);
-      } else if ((cluster == 0x0008) && (attribute == 0x0000)) {
-        uint8_t dimmer = value;
-        zigbee_devices.updateHueState(shortaddr, nullptr, nullptr, &dimmer, nullptr,
-                                        nullptr, nullptr, nullptr, nullptr, nullptr);
-      } else if ((cluster == 0x0300) && (attribute == 0x0000)) {
-        uint16_t hue8 = value;
-        uint16_t hue = changeUIntScale(hue8, 0, 254, 0, 360);     // change range from 0..254 to 0..360
-        zigbee_devices.updateHueState(shortaddr, nullptr, nullptr, nullptr, nullptr,
-                                        nullptr, &hue, nullptr, nullptr, nullptr);
-      } else if ((cluster == 0x0300) && (attribute == 0x0001)) {
-        uint8_t sat = value;
-        zigbee_devices.updateHueState(shortaddr, nullptr, nullptr, nullptr, &sat,
-                                        nullptr, nullptr, nullptr, nullptr, nullptr);
-      } else if ((cluster == 0x0300) && (attribute == 0x0003)) {
-        uint16_t x = value;
-        zigbee_devices.updateHueState(shortaddr, nullptr, nullptr, nullptr, nullptr,
-                                        nullptr, nullptr, &x, nullptr, nullptr);
-      } else if ((cluster == 0x0300) && (attribute == 0x0004)) {
-        uint16_t y = value;
-        zigbee_devices.updateHueState(shortaddr, nullptr, nullptr, nullptr, nullptr,
-                                        nullptr, nullptr, nullptr, &y, nullptr), nullptr;
-      } else if ((cluster == 0x0300) && (attribute == 0x0007)) {
-        uint16_t ct = value;
-        zigbee_devices.updateHueState(shortaddr, nullptr, nullptr, nullptr, nullptr,
-                                        &ct, nullptr, nullptr, nullptr, nullptr);
-      } else if ((cluster == 0x0300) && (attribute == 0x0008)) {
-        uint8_t colormode = value;
-        zigbee_devices.updateHueState(shortaddr, nullptr, &colormode, nullptr, nullptr,
-                                        nullptr, nullptr, nullptr, nullptr, nullptr);
-      }
-
-      // Iterate on filter
-      for (uint32_t i = 0; i < sizeof(Z_PostProcess) / sizeof(Z_PostProcess[0]); i++) {
+      // Iterate on filter entries of the cluster
+      uint32_t conv_start, conv_end;
+      Z_PostProcessRange(cluster, &conv_start, &conv_end);
+      for (uint32_t i = conv_start; i < conv_end; i++) {
         const Z_AttributeConverter *converter = &Z_PostProcess[i];
-        uint16_t conv_cluster = CxToCluster(pgm_read_byte(&converter->cluster_short));
+        uint16_t conv_cluster = cluster;
         uint16_t conv_attribute = pgm_read_word(&converter->attribute);
-        int16_t  conv_multiplier = pgm_read_word(&converter->multiplier);
-        uint16_t conv_cb = pgm_read_word(&converter->cb);                   // callback id
 
-        if ((conv_cluster == cluster) &&
-            ((conv_attribute == attribute) || (conv_attribute == 0xFFFF)) ) {
+        if ((conv_attribute == attribute) || (conv_attribute == 0xFFFF)) {
+          int16_t  conv_multiplier = pgm_read_word(&converter->multiplier);
+          uint16_t conv_cb = pgm_read_word(&converter->cb);                   // callback id
           String new_name_str = (const __FlashStringHelper*) converter->name;
           if (suffix > 1) { new_name_str += suffix; }   // append suffix number
           // apply the transformation
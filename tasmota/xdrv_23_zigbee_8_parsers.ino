@@ -310,7 +310,9 @@ int32_t Z_ReceiveIEEEAddr(int32_t res, const class SBuffer &buf) {
 int32_t Z_DataConfirm(int32_t res, const class SBuffer &buf) {
   uint8_t           status = buf.get8(2);
   uint8_t           endpoint = buf.get8(3);
-  //uint8_t           transId = buf.get8(4);    // unused
+  uint8_t           transId = buf.get8(4);
+
+  zigbee_af.confirm(transId, status);     // the device can receive the next frame
 
   if (status) {   // only report errors
     Response_P(PSTR("{\"" D_JSON_ZIGBEE_CONFIRM "\":{\"" D_CMND_ZIGBEE_ENDPOINT "\":%d"
@@ -324,6 +326,16 @@ int32_t Z_DataConfirm(int32_t res, const class SBuffer &buf) {
   return -1;
 }
 
+//
+// Handle the SRSP to AF_DATA_REQUEST_EXT, the CC2530 accepted or rejected the frame
+//
+int32_t Z_DataRequestRsp(int32_t res, const class SBuffer &buf) {
+  uint8_t           status = buf.get8(2);
+
+  zigbee_af.response(status);
+  return -1;
+}
+
 //
 // Handle State Change Indication incoming message
 //
@@ -613,10 +625,61 @@ void Z_AqaraOccupancy(uint16_t shortaddr, uint16_t cluster, uint8_t endpoint, co
 }
 
 
+/*********************************************************************************************\
+ * Coalescing of attribute reports
+ *
+ * Attributes are held for the coalescing window of their cluster, 0 publishes them immediately.
+ * Devices publish their coalesced attributes at most every zigbee_coalesce_interval ms, newer
+ * values from the same endpoint replace pending ones in between.
+\*********************************************************************************************/
+
+#ifndef USE_ZIGBEE_COALESCE_MIN_INTERVAL
+#define USE_ZIGBEE_COALESCE_MIN_INTERVAL 1000
+#endif
+
+typedef struct Z_CoalesceWindow {
+  uint16_t cluster;
+  uint16_t window_ms;
+} Z_CoalesceWindow;
+
+// Clusters not listed use USE_ZIGBEE_COALESCE_ATTR_TIMER
+const Z_CoalesceWindow Z_CoalesceDefaults[] PROGMEM = {
+  { 0x0006, 0 },                  // On/Off, latency critical
+  { 0x0406, 0 },                  // Occupancy Sensing
+  { 0x0500, 0 },                  // IAS Zone
+  { 0x0702, 2000 },               // Metering, high rate
+  { 0x0B04, 2000 },               // Electrical Measurement, high rate
+};
+
+std::vector<Z_CoalesceWindow> zigbee_coalesce = {};    // windows changed with command ZbCoalesce
+uint32_t zigbee_coalesce_interval = USE_ZIGBEE_COALESCE_MIN_INTERVAL;
+
+uint32_t Z_GetCoalesceWindow(uint16_t cluster) {
+  for (auto &coalesce : zigbee_coalesce) {
+    if (coalesce.cluster == cluster) { return coalesce.window_ms; }
+  }
+  for (uint32_t i = 0; i < ARRAY_SIZE(Z_CoalesceDefaults); i++) {
+    if (pgm_read_word(&Z_CoalesceDefaults[i].cluster) == cluster) {
+      return pgm_read_word(&Z_CoalesceDefaults[i].window_ms);
+    }
+  }
+  return USE_ZIGBEE_COALESCE_ATTR_TIMER;
+}
+
+void Z_SetCoalesceWindow(uint16_t cluster, uint16_t window_ms) {
+  for (auto &coalesce : zigbee_coalesce) {
+    if (coalesce.cluster == cluster) {
+      coalesce.window_ms = window_ms;
+      return;
+    }
+  }
+  Z_CoalesceWindow coalesce = { cluster, window_ms };
+  zigbee_coalesce.push_back(coalesce);
+}
+
 // Publish the received values once they have been coalesced
 int32_t Z_PublishAttributes(uint16_t shortaddr, uint16_t groupaddr, uint16_t cluster, uint8_t endpoint, uint32_t value) {
-  const JsonObject *json = zigbee_devices.jsonGet(shortaddr);
-  if (json == nullptr) { return 0; }                 // don't crash if not found
+  if (!zigbee_devices.jsonHasAttributes(shortaddr)) { return 0; }   // nothing to publish
 
   zigbee_devices.jsonPublishFlush(shortaddr);
   return 1;
@@ -646,10 +709,11 @@ int32_t Z_ReceiveAfIncomingMessage(int32_t res, const class SBuffer &buf) {
                               linkquality, securityuse, seqnumber,
                               timestamp);
   zcl_received.log();
+  zigbee_devices.statsReceived(srcaddr, linkquality, zcl_received.getTransactSeq());
   char shortaddr[8];
   snprintf_P(shortaddr, sizeof(shortaddr), PSTR("0x%04X"), srcaddr);
 
-  DynamicJsonBuffer jsonBuffer;
+  JsonParseBuffer jsonBuffer;
   JsonObject& json = jsonBuffer.createObject();
   
   if ( (!zcl_received.isClusterSpecificCommand()) && (ZCL_DEFAULT_RESPONSE == zcl_received.getCmdId())) {
@@ -693,16 +757,26 @@ int32_t Z_ReceiveAfIncomingMessage(int32_t res, const class SBuffer &buf) {
     // Post-provess for Aqara Presence Senson
     Z_AqaraOccupancy(srcaddr, clusterid, srcendpoint, json);
 
-    if (defer_attributes) {
-      // Prepare for publish
+    uint32_t coalesce_ms = defer_attributes ? Z_GetCoalesceWindow(clusterid) : 0;
+    if (coalesce_ms) {
+      // Prepare for publish, not before the device publish interval has elapsed
+      uint32_t last_publish = zigbee_devices.getLastPublish(srcaddr);
+      int32_t since_publish = TimePassedSince(last_publish);
+      bool rate_limited = last_publish && (since_publish < (int32_t) zigbee_coalesce_interval);
+      if (rate_limited && (zigbee_coalesce_interval - since_publish > coalesce_ms)) {
+        coalesce_ms = zigbee_coalesce_interval - since_publish;
+      }
       if (zigbee_devices.jsonIsConflict(srcaddr, json)) {
-        // there is conflicting values, force a publish of the previous message now and don't coalesce
-        zigbee_devices.jsonPublishFlush(srcaddr);
+        if (!rate_limited || !zigbee_devices.jsonIsSameSource(srcaddr, json)) {
+          // there is conflicting values, force a publish of the previous message now and don't coalesce
+          zigbee_devices.jsonPublishFlush(srcaddr);
+        }
+        // otherwise newer values replace the pending ones
       }
       zigbee_devices.jsonAppend(srcaddr, json);
-      zigbee_devices.setTimer(srcaddr, 0 /* groupaddr */, USE_ZIGBEE_COALESCE_ATTR_TIMER, clusterid, srcendpoint, Z_CAT_READ_ATTR, 0, &Z_PublishAttributes);
+      zigbee_devices.setTimerBudget(srcaddr, 0 /* groupaddr */, coalesce_ms, clusterid, srcendpoint, Z_CAT_READ_ATTR, 0, &Z_PublishAttributes);
     } else {
-      // Publish immediately
+      // Publish immediately, latency critical clusters together with any pending attributes
       zigbee_devices.jsonPublishNow(srcaddr, json);
 
       // Add auto-responder here
@@ -720,6 +794,7 @@ typedef struct Z_Dispatcher {
 
 // Ffilters based on ZNP frames
 ZBM(AREQ_AF_DATA_CONFIRM, Z_AREQ | Z_AF, AF_DATA_CONFIRM)                   // 4480
+ZBM(SRSP_AF_DATA_REQUEST_EXT, Z_SRSP | Z_AF, AF_DATA_REQUEST_EXT)           // 6402
 ZBM(AREQ_AF_INCOMING_MESSAGE, Z_AREQ | Z_AF, AF_INCOMING_MSG)               // 4481
 // ZBM(AREQ_STATE_CHANGE_IND, Z_AREQ | Z_ZDO, ZDO_STATE_CHANGE_IND)            // 45C0
 ZBM(AREQ_END_DEVICE_ANNCE_IND, Z_AREQ | Z_ZDO, ZDO_END_DEVICE_ANNCE_IND)    // 45C1
@@ -735,6 +810,7 @@ ZBM(AREQ_ZDO_MGMT_BIND_RSP, Z_AREQ | Z_ZDO, ZDO_MGMT_BIND_RSP)              // 4
 // Dispatcher callbacks table
 const Z_Dispatcher Z_DispatchTable[] PROGMEM = {
   { AREQ_AF_DATA_CONFIRM,         &Z_DataConfirm },
+  { SRSP_AF_DATA_REQUEST_EXT,     &Z_DataRequestRsp },
   { AREQ_AF_INCOMING_MESSAGE,     &Z_ReceiveAfIncomingMessage },
   // { AREQ_STATE_CHANGE_IND,        &Z_ReceiveStateChange },
   { AREQ_END_DEVICE_ANNCE_IND,    &Z_ReceiveEndDeviceAnnonce },
@@ -784,20 +860,18 @@ int32_t Z_Load_Devices(uint8_t value) {
 // Query the state of a bulb (light) if its type allows it
 //
 void Z_Query_Bulb(uint16_t shortaddr, uint32_t &wait_ms) {
-  const uint32_t inter_message_ms = 100;    // wait 100ms between messages
+  // the outbound scheduler sends the next message once the previous one to the same device is confirmed
+  const uint32_t inter_device_ms = 100;     // spread devices to keep the send queue short
 
   if (0 <= zigbee_devices.getHueBulbtype(shortaddr)) {
     uint8_t endpoint = zigbee_devices.findFirstEndpoint(shortaddr);
 
     if (endpoint) {   // send only if we know the endpoint
       zigbee_devices.setTimer(shortaddr, 0 /* groupaddr */, wait_ms, 0x0006, endpoint, Z_CAT_NONE, 0 /* value */, &Z_ReadAttrCallback);
-      wait_ms += inter_message_ms;
       zigbee_devices.setTimer(shortaddr, 0 /* groupaddr */, wait_ms, 0x0008, endpoint, Z_CAT_NONE, 0 /* value */, &Z_ReadAttrCallback);
-      wait_ms += inter_message_ms;
       zigbee_devices.setTimer(shortaddr, 0 /* groupaddr */, wait_ms, 0x0300, endpoint, Z_CAT_NONE, 0 /* value */, &Z_ReadAttrCallback);
-      wait_ms += inter_message_ms;
       zigbee_devices.setTimer(shortaddr, 0, wait_ms + Z_CAT_REACHABILITY_TIMEOUT, 0, endpoint, Z_CAT_REACHABILITY, 0 /* value */, &Z_Unreachable);
-      wait_ms += 1000;              // wait 1 second between devices
+      wait_ms += inter_device_ms;
     }
   }
 }
@@ -829,7 +903,7 @@ int32_t Z_State_Ready(uint8_t value) {
 // Mostly used for routers/end-devices
 // json: holds the attributes in JSON format
 void Z_AutoResponder(uint16_t srcaddr, uint16_t cluster, uint8_t endpoint, const JsonObject &json) {
-  DynamicJsonBuffer jsonBuffer;
+  JsonParseBuffer jsonBuffer;
   JsonObject& json_out = jsonBuffer.createObject();
 
   // responder
@@ -36,7 +36,10 @@ const char kZbCommands[] PROGMEM = D_PRFX_ZB "|"    // prefix
   D_CMND_ZIGBEE_FORGET "|" D_CMND_ZIGBEE_SAVE "|" D_CMND_ZIGBEE_NAME "|"
   D_CMND_ZIGBEE_BIND "|" D_CMND_ZIGBEE_UNBIND "|" D_CMND_ZIGBEE_PING "|" D_CMND_ZIGBEE_MODELID "|"
   D_CMND_ZIGBEE_LIGHT "|" D_CMND_ZIGBEE_RESTORE "|" D_CMND_ZIGBEE_BIND_STATE "|"
-  D_CMND_ZIGBEE_CONFIG
+  D_CMND_ZIGBEE_CONFIG "|" D_CMND_ZIGBEE_COALESCE "|" D_CMND_ZIGBEE_STATS
+#ifdef USE_ZIGBEE_REPLAY
+  "|" D_CMND_ZIGBEE_REPLAY
+#endif  // USE_ZIGBEE_REPLAY
   ;
 
 void (* const ZigbeeCommand[])(void) PROGMEM = {
@@ -46,16 +49,182 @@ void (* const ZigbeeCommand[])(void) PROGMEM = {
   &CmndZbForget, &CmndZbSave, &CmndZbName,
   &CmndZbBind, &CmndZbUnbind, &CmndZbPing, &CmndZbModelId,
   &CmndZbLight, &CmndZbRestore, &CmndZbBindState,
-  &CmndZbConfig,
+  &CmndZbConfig, &CmndZbCoalesce, &CmndZbStats,
+#ifdef USE_ZIGBEE_REPLAY
+  &CmndZbReplay,
+#endif  // USE_ZIGBEE_REPLAY
   };
 
+#ifndef ZIGBEE_SERIAL_BUFFER_SIZE
+#define ZIGBEE_SERIAL_BUFFER_SIZE  768      // receive buffer of the serial port, holds 3 full size frames while the loop is busy
+#endif
+
+#ifdef ESP32
+/*********************************************************************************************\
+ * On ESP32 a task assembles complete ZNP frames from the UART, independently from the loop.
+ * Frames are passed to ZigbeeInputLoop() through a single producer single consumer ring.
+\*********************************************************************************************/
+
+const uint32_t ZIGBEE_RX_FRAMES = 8;      // frames waiting to be processed by the loop
+
+typedef struct ZB_RX_FRAME {
+  uint16_t len;
+  uint8_t  data[ZIGBEE_BUFFER_SIZE];
+} ZB_RX_FRAME;
+
+struct ZB_RX {
+  ZB_RX_FRAME *frame = nullptr;           // [ZIGBEE_RX_FRAMES]
+  volatile uint32_t head = 0;             // next frame to write, only changed by the task
+  volatile uint32_t tail = 0;             // next frame to read, only changed by the loop
+  volatile uint32_t lost = 0;             // frames dropped because the ring was full
+  volatile uint32_t discarded = 0;        // bytes received outside of a frame
+  TaskHandle_t task = nullptr;
+} ZigbeeRx;
+
+void ZigbeeRxPush(struct ZB_RX_FRAME &frame) {
+  uint32_t head = ZigbeeRx.head;
+  if (head - ZigbeeRx.tail >= ZIGBEE_RX_FRAMES) {
+    ZigbeeRx.lost++;
+  } else {
+    memcpy(&ZigbeeRx.frame[head % ZIGBEE_RX_FRAMES], &frame, sizeof(frame.len) + frame.len);
+    __sync_synchronize();                 // frame content must be visible before the new head
+    ZigbeeRx.head = head + 1;
+  }
+  frame.len = 0;
+}
+
+void ZigbeeRxTask(void *arg) {
+  ZB_RX_FRAME frame;
+  frame.len = 0;
+  uint32_t frame_len = 5;
+  uint32_t last_byte = 0;
+
+  for (;;) {
+    while (ZigbeeSerial->available()) {
+      uint8_t zigbee_in_byte = ZigbeeSerial->read();
+      last_byte = millis();
+      if (0 == frame.len) {
+        frame_len = 5;
+        if (ZIGBEE_SOF_ALT == zigbee_in_byte) { zigbee_in_byte = ZIGBEE_SOF; }   // see ZigbeeInputLoop()
+        if (ZIGBEE_SOF != zigbee_in_byte) {
+          ZigbeeRx.discarded++;
+          continue;
+        }
+      }
+      frame.data[frame.len++] = zigbee_in_byte;
+      if (2 == frame.len) {
+        uint8_t len_byte = frame.data[1];
+        if (len_byte > 250) { len_byte = 250; }   // ZNP spec says len is 250 max
+        frame_len = len_byte + 5;         // SOF + LEN + CMD1 + CMD2 + FCS = 5 bytes overhead
+      }
+      if (frame.len >= frame_len) {
+        ZigbeeRxPush(frame);
+      }
+    }
+    if (frame.len && (millis() - last_byte > ZIGBEE_POLLING)) {
+      ZigbeeRxPush(frame);                // incomplete frame, rejected by ZigbeeProcessFrame()
+    }
+    vTaskDelay(1);
+  }
+}
+
+void ZigbeeRxStart(void) {
+  ZigbeeRx.frame = (ZB_RX_FRAME*) HeapMalloc(HEAP_TAG_ZIGBEE, ZIGBEE_RX_FRAMES * sizeof(ZB_RX_FRAME));
+  if (!ZigbeeRx.frame) { return; }
+  // same core as the loop, with higher priority so it runs when the loop is busy
+  if (pdPASS != xTaskCreatePinnedToCore(ZigbeeRxTask, "ZbRx", 2048, nullptr, 2, &ZigbeeRx.task, xPortGetCoreID())) {
+    HeapFree(ZigbeeRx.frame);
+    ZigbeeRx.frame = nullptr;
+    ZigbeeRx.task = nullptr;
+  }
+}
+#endif  // ESP32
+
+//
+// Check and process the frame received in zigbee_buffer
+//
+void ZigbeeProcessFrame(void) {
+  uint32_t zigbee_frame_len = 5;
+  if (zigbee_buffer->len() >= 2) {
+    uint8_t len_byte = zigbee_buffer->get8(1);
+    if (len_byte > 250)  len_byte = 250;    // ZNP spec says len is 250 max
+    zigbee_frame_len = len_byte + 5;        // SOF + LEN + CMD1 + CMD2 + FCS = 5 bytes overhead
+  }
+  uint8_t fcs = 0;                          // XOR of all bytes after SOF, including FCS, must be 0
+  for (uint32_t i = 1; i < zigbee_buffer->len(); i++) {
+    fcs ^= zigbee_buffer->get8(i);
+  }
+
+  char hex_char[(zigbee_buffer->len() * 2) + 2];
+  ToHex_P((unsigned char*)zigbee_buffer->getBuffer(), zigbee_buffer->len(), hex_char, sizeof(hex_char));
+
+  AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR(D_LOG_ZIGBEE "Bytes follow_read_metric = %0d"), ZigbeeSerial->getLoopReadMetric());
+  // buffer received, now check integrity
+  if (zigbee_buffer->len() != zigbee_frame_len) {
+    // Len is not correct, log and reject frame
+    AddLog_P2(LOG_LEVEL_INFO, PSTR(D_JSON_ZIGBEEZNPRECEIVED ": received frame of wrong size %s, len %d, expected %d"), hex_char, zigbee_buffer->len(), zigbee_frame_len);
+  } else if (0x00 != fcs) {
+    // FCS is wrong, packet is corrupt, log and reject frame
+    AddLog_P2(LOG_LEVEL_INFO, PSTR(D_JSON_ZIGBEEZNPRECEIVED ": received bad FCS frame %s, %d"), hex_char, fcs);
+  } else {
+    // frame is correct
+    //AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR(D_JSON_ZIGBEEZNPRECEIVED ": received correct frame %s"), hex_char);
+
+    SBuffer znp_buffer = zigbee_buffer->subBuffer(2, zigbee_frame_len - 3);	// remove SOF, LEN and FCS
+
+    ToHex_P((unsigned char*)znp_buffer.getBuffer(), znp_buffer.len(), hex_char, sizeof(hex_char));
+    Response_P(PSTR("{\"" D_JSON_ZIGBEEZNPRECEIVED "\":\"%s\"}"), hex_char);
+    if (Settings.flag3.tuya_serial_mqtt_publish) {
+      MqttPublishPrefixTopic_P(TELE, PSTR(D_RSLT_SENSOR));
+      XdrvRulesProcess();
+    } else {
+      AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_ZIGBEE "%s"), mqtt_data);
+    }
+    // now process the message
+    ZigbeeProcessInput(znp_buffer);
+  }
+  zigbee_buffer->setLen(0);		// empty buffer
+}
+
+//
+// Report bytes or frames lost since last call
+//
+void ZigbeeInputOverflow(void) {
+  static uint32_t zigbee_lost = 0;
+#ifdef ESP32
+  uint32_t lost = ZigbeeRx.lost + ZigbeeSerial->getOverflowCount();
+#else
+  uint32_t lost = ZigbeeSerial->getOverflowCount();
+#endif
+  if (lost != zigbee_lost) {
+    AddLog_P2(LOG_LEVEL_INFO, PSTR(D_LOG_ZIGBEE "Receive overflow, %d lost in total"), lost);
+    zigbee_lost = lost;
+  }
+}
+
 //
 // Called at event loop, checks for incoming data from the CC2530
 //
 void ZigbeeInputLoop(void)
 {
+#ifdef ESP32
+  if (ZigbeeRx.task) {
+    // frames were assembled by ZigbeeRxTask()
+    while (ZigbeeRx.tail != ZigbeeRx.head) {
+      __sync_synchronize();               // read frame content after the head
+      ZB_RX_FRAME &frame = ZigbeeRx.frame[ZigbeeRx.tail % ZIGBEE_RX_FRAMES];
+      zigbee_buffer->setLen(0);
+      zigbee_buffer->addBuffer(frame.data, frame.len);
+      __sync_synchronize();
+      ZigbeeRx.tail = ZigbeeRx.tail + 1;  // release the slot before processing, the frame was copied
+      ZigbeeProcessFrame();
+    }
+    ZigbeeInputOverflow();
+    return;
+  }
+#endif  // ESP32
+
 	static uint32_t zigbee_polling_window = 0;
-	static uint8_t fcs = ZIGBEE_SOF;
 	static uint32_t zigbee_frame_len = 5;		// minimal zigbee frame lenght, will be updated when buf[1] is read
   // Receive only valid ZNP frames:
   // 00 - SOF = 0xFE
@@ -72,7 +241,6 @@ void ZigbeeInputLoop(void)
 
 		if (0 == zigbee_buffer->len()) {  // make sure all variables are correctly initialized
 			zigbee_frame_len = 5;
-			fcs = ZIGBEE_SOF;
       // there is a rare race condition when an interrupt occurs when receiving the first byte
       // in this case the first bit (lsb) is missed and Tasmota receives 0xFF instead of 0xFE
       // We forgive this mistake, and next bytes are automatically resynchronized
@@ -91,7 +259,6 @@ void ZigbeeInputLoop(void)
     if (zigbee_buffer->len() < zigbee_frame_len) {
 			zigbee_buffer->add8(zigbee_in_byte);
       zigbee_polling_window = millis();                               // Wait for more data
-			fcs ^= zigbee_in_byte;
     }
 
 		if (zigbee_buffer->len() >= zigbee_frame_len) {
@@ -110,36 +277,9 @@ void ZigbeeInputLoop(void)
   }
 
   if (zigbee_buffer->len() && (millis() > (zigbee_polling_window + ZIGBEE_POLLING))) {
-    char hex_char[(zigbee_buffer->len() * 2) + 2];
-		ToHex_P((unsigned char*)zigbee_buffer->getBuffer(), zigbee_buffer->len(), hex_char, sizeof(hex_char));
-
-    AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR(D_LOG_ZIGBEE "Bytes follow_read_metric = %0d"), ZigbeeSerial->getLoopReadMetric());
-		// buffer received, now check integrity
-		if (zigbee_buffer->len() != zigbee_frame_len) {
-			// Len is not correct, log and reject frame
-      AddLog_P2(LOG_LEVEL_INFO, PSTR(D_JSON_ZIGBEEZNPRECEIVED ": received frame of wrong size %s, len %d, expected %d"), hex_char, zigbee_buffer->len(), zigbee_frame_len);
-		} else if (0x00 != fcs) {
-			// FCS is wrong, packet is corrupt, log and reject frame
-      AddLog_P2(LOG_LEVEL_INFO, PSTR(D_JSON_ZIGBEEZNPRECEIVED ": received bad FCS frame %s, %d"), hex_char, fcs);
-		} else {
-			// frame is correct
-			//AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR(D_JSON_ZIGBEEZNPRECEIVED ": received correct frame %s"), hex_char);
-
-			SBuffer znp_buffer = zigbee_buffer->subBuffer(2, zigbee_frame_len - 3);	// remove SOF, LEN and FCS
-
-			ToHex_P((unsigned char*)znp_buffer.getBuffer(), znp_buffer.len(), hex_char, sizeof(hex_char));
-      Response_P(PSTR("{\"" D_JSON_ZIGBEEZNPRECEIVED "\":\"%s\"}"), hex_char);
-      if (Settings.flag3.tuya_serial_mqtt_publish) {
-        MqttPublishPrefixTopic_P(TELE, PSTR(D_RSLT_SENSOR));
-        XdrvRulesProcess();
-      } else {
-        AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_ZIGBEE "%s"), mqtt_data);
-      }
-			// now process the message
-      ZigbeeProcessInput(znp_buffer);
-		}
-		zigbee_buffer->setLen(0);		// empty buffer
+    ZigbeeProcessFrame();
   }
+  ZigbeeInputOverflow();
 }
 
 /********************************************************************************************/
@@ -165,21 +305,24 @@ void ZigbeeInit(void)
   if (PinUsed(GPIO_ZIGBEE_RX) && PinUsed(GPIO_ZIGBEE_TX)) {
 		AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR(D_LOG_ZIGBEE "GPIOs Rx:%d Tx:%d"), Pin(GPIO_ZIGBEE_RX), Pin(GPIO_ZIGBEE_TX));
     // if seriallog_level is 0, we allow GPIO 13/15 to switch to Hardware Serial
-    ZigbeeSerial = new TasmotaSerial(Pin(GPIO_ZIGBEE_RX), Pin(GPIO_ZIGBEE_TX), seriallog_level ? 1 : 2, 0, 256);   // set a receive buffer of 256 bytes
+    ZigbeeSerial = HEAP_NEW(HEAP_TAG_ZIGBEE) TasmotaSerial(Pin(GPIO_ZIGBEE_RX), Pin(GPIO_ZIGBEE_TX), seriallog_level ? 1 : 2, 0, ZIGBEE_SERIAL_BUFFER_SIZE);
     ZigbeeSerial->begin(115200);
     if (ZigbeeSerial->hardwareSerial()) {
       ClaimSerial();
       uint32_t aligned_buffer = ((uint32_t)serial_in_buffer + 3) & ~3;
-			zigbee_buffer = new PreAllocatedSBuffer(sizeof(serial_in_buffer) - 3, (char*) aligned_buffer);
+			zigbee_buffer = HEAP_NEW(HEAP_TAG_ZIGBEE) PreAllocatedSBuffer(sizeof(serial_in_buffer) - 3, (char*) aligned_buffer);
 		} else {
 // AddLog_P2(LOG_LEVEL_INFO, PSTR("ZigbeeInit Mem2 = %d"), ESP_getFreeHeap());
-			zigbee_buffer = new SBuffer(ZIGBEE_BUFFER_SIZE);
+			zigbee_buffer = HEAP_NEW(HEAP_TAG_ZIGBEE) SBuffer(ZIGBEE_BUFFER_SIZE);
 // AddLog_P2(LOG_LEVEL_INFO, PSTR("ZigbeeInit Mem3 = %d"), ESP_getFreeHeap());
 		}
     zigbee.active = true;
 		zigbee.init_phase = true;			// start the state machine
     zigbee.state_machine = true;      // start the state machine
     ZigbeeSerial->flush();
+#ifdef ESP32
+    ZigbeeRxStart();
+#endif  // ESP32
   }
 // AddLog_P2(LOG_LEVEL_INFO, PSTR("ZigbeeInit Mem9 = %d"), ESP_getFreeHeap());
 }
@@ -341,7 +484,10 @@ void ZigbeeZCLSend_Raw(uint16_t shortaddr, uint16_t groupaddr, uint16_t clusterI
     buf.addBuffer(msg, len);        // add the payload
   }
 
-  ZigbeeZNPSend(buf.getBuffer(), buf.len());
+  if (BAD_SHORTADDR != shortaddr) {
+    zigbee_devices.statsSent(shortaddr, transacId, needResponse);
+  }
+  zigbee_af.send(shortaddr, groupaddr, transacId, buf.getBuffer(), buf.len());   // sent when the device is ready
 }
 
 /********************************************************************************************/
@@ -430,32 +576,27 @@ void ZbSendReportWrite(const JsonObject &val_pubwrite, uint16_t device, uint16_t
 
     // do we already know the type, i.e. attribute and cluster are also known
     if (Znodata == type_id) {
-      // scan attributes to find by name, and retrieve type
-      for (uint32_t i = 0; i < ARRAY_SIZE(Z_PostProcess); i++) {
-        const Z_AttributeConverter *converter = &Z_PostProcess[i];
-        bool match = false;
-        uint16_t local_attr_id = pgm_read_word(&converter->attribute);
-        uint16_t local_cluster_id = CxToCluster(pgm_read_byte(&converter->cluster_short));
-        uint8_t  local_type_id = pgm_read_byte(&converter->type);
-        int16_t  local_multiplier = pgm_read_word(&converter->multiplier);
-        // AddLog_P2(LOG_LEVEL_DEBUG, PSTR("Try cluster = 0x%04X, attr = 0x%04X, type_id = 0x%02X"), local_cluster_id, local_attr_id, local_type_id);
-
-        if (delimiter) {
-          if ((cluster_id == local_cluster_id) && (attr_id == local_attr_id)) {
-            type_id = local_type_id;
-            break;
-          }
-        } else if (converter->name) {
-          // AddLog_P2(LOG_LEVEL_DEBUG, PSTR("Comparing '%s' with '%s'"), attr_name, converter->name);
-          if (0 == strcasecmp_P(key, converter->name)) {
-            // match
-            cluster_id = local_cluster_id;
-            attr_id = local_attr_id;
-            type_id = local_type_id;
-            multiplier = local_multiplier;
+      if (delimiter) {
+        // scan attributes of the cluster to retrieve type
+        uint32_t conv_start, conv_end;
+        Z_PostProcessRange(cluster_id, &conv_start, &conv_end);
+        for (uint32_t i = conv_start; i < conv_end; i++) {
+          const Z_AttributeConverter *converter = &Z_PostProcess[i];
+          if (attr_id == pgm_read_word(&converter->attribute)) {
+            type_id = pgm_read_byte(&converter->type);
             break;
           }
         }
+      } else {
+        // find attribute by name, and retrieve type
+        uint32_t entry = Z_PostProcessFind(key);
+        if (entry) {
+          const Z_AttributeConverter *converter = &Z_PostProcess[entry - 1];
+          cluster_id = CxToCluster(pgm_read_byte(&converter->cluster_short));
+          attr_id = pgm_read_word(&converter->attribute);
+          type_id = pgm_read_byte(&converter->type);
+          multiplier = pgm_read_word(&converter->multiplier);
+        }
       }
     }
 
@@ -670,34 +811,23 @@ void ZbSendRead(const JsonVariant &val_attr, uint16_t device, uint16_t groupaddr
       const char *key = it->key;
       // const JsonVariant &value = it->value;      // we don't need the value here, only keys are relevant
 
-      bool found = false;
-      // scan attributes to find by name, and retrieve type
-      for (uint32_t i = 0; i < ARRAY_SIZE(Z_PostProcess); i++) {
-        const Z_AttributeConverter *converter = &Z_PostProcess[i];
-        bool match = false;
+      // find attribute by name
+      uint32_t entry = Z_PostProcessFind(key);
+      if (entry) {
+        const Z_AttributeConverter *converter = &Z_PostProcess[entry - 1];
         uint16_t local_attr_id = pgm_read_word(&converter->attribute);
         uint16_t local_cluster_id = CxToCluster(pgm_read_byte(&converter->cluster_short));
-        // uint8_t  local_type_id = pgm_read_byte(&converter->type);
-
-        if ((converter->name) && (0 == strcasecmp_P(key, converter->name))) {
-          // match name
-          // check if there is a conflict with cluster
-          // TODO
-          attrs[actual_attr_len++] = local_attr_id & 0xFF;
-          attrs[actual_attr_len++] = local_attr_id >> 8;
-          found = true;
-          // check cluster
-          if (0xFFFF == cluster) {
-            cluster = local_cluster_id;
-          } else if (cluster != local_cluster_id) {
-            ResponseCmndChar_P(PSTR("No more than one cluster id per command"));
-            if (attrs) { delete[] attrs; }
-            return;
-          }
-          break;    // found, exit loop
+        attrs[actual_attr_len++] = local_attr_id & 0xFF;
+        attrs[actual_attr_len++] = local_attr_id >> 8;
+        // check cluster
+        if (0xFFFF == cluster) {
+          cluster = local_cluster_id;
+        } else if (cluster != local_cluster_id) {
+          ResponseCmndChar_P(PSTR("No more than one cluster id per command"));
+          if (attrs) { delete[] attrs; }
+          return;
         }
-      }
-      if (!found) {
+      } else {
         AddLog_P2(LOG_LEVEL_INFO, PSTR("ZIG: Unknown attribute name (ignored): %s"), key);
       }
     }
@@ -745,7 +875,7 @@ void CmndZbSend(void) {
   // ZbSend { "device":"0x1234", "endpoint":"0x03", "send":{"Color":"1,2"} }
   // ZbSend { "device":"0x1234", "endpoint":"0x03", "send":{"Color":"0x1122,0xFFEE"} }
   if (zigbee.init_phase) { ResponseCmndChar_P(PSTR(D_ZIGBEE_NOT_STARTED)); return; }
-  DynamicJsonBuffer jsonBuf;
+  JsonParseBuffer jsonBuf;
   const JsonObject &json = jsonBuf.parseObject((const char*) XdrvMailbox.data);
   if (!json.success()) { ResponseCmndChar_P(PSTR(D_JSON_INVALID_JSON)); return; }
 
@@ -856,7 +986,7 @@ void ZbBindUnbind(bool unbind) {    // false = bind, true = unbind
 
   // local endpoint is always 1, IEEE addresses are calculated
   if (zigbee.init_phase) { ResponseCmndChar_P(PSTR(D_ZIGBEE_NOT_STARTED)); return; }
-  DynamicJsonBuffer jsonBuf;
+  JsonParseBuffer jsonBuf;
   const JsonObject &json = jsonBuf.parseObject((const char*) XdrvMailbox.data);
   if (!json.success()) { ResponseCmndChar_P(PSTR(D_JSON_INVALID_JSON)); return; }
 
@@ -1131,7 +1261,7 @@ void CmndZbSave(void) {
 //   ZbRestore {"Device":"0x5ADF","Name":"Petite_Lampe","IEEEAddr":"0x90FD9FFFFE03B051","ModelId":"TRADFRI bulb E27 WS opal 980lm","Manufacturer":"IKEA of Sweden","Endpoints":["0x01","0xF2"]}
 void CmndZbRestore(void) {
   if (zigbee.init_phase) { ResponseCmndChar_P(PSTR(D_ZIGBEE_NOT_STARTED)); return; }
-  DynamicJsonBuffer jsonBuf;
+  JsonParseBuffer jsonBuf;
   const JsonVariant json_parsed = jsonBuf.parse((const char*) XdrvMailbox.data);   // const to force a copy of parameter
   const JsonVariant * json = &json_parsed;    // root of restore, to be changed if needed
   bool success = false;
@@ -1220,6 +1350,62 @@ void CmndZbStatus(void) {
   }
 }
 
+//
+// Command `ZbStats`
+// ZbStats            - statistics of all devices
+// ZbStats <device>   - statistics of a single device
+// ZbStats0           - reset statistics of all devices
+//
+void CmndZbStats(void) {
+  if (zigbee.init_phase) { ResponseCmndChar_P(PSTR(D_ZIGBEE_NOT_STARTED)); return; }
+  if (0 == XdrvMailbox.index) {
+    zigbee_devices.statsReset();
+  }
+  uint16_t shortaddr = BAD_SHORTADDR;
+  if (XdrvMailbox.data_len > 0) {
+    shortaddr = zigbee_devices.parseDeviceParam(XdrvMailbox.data, true);
+    if ((BAD_SHORTADDR == shortaddr) || (0x0000 == shortaddr)) { ResponseCmndChar_P(PSTR("Unknown device")); return; }
+  }
+
+  String dump = zigbee_devices.dumpStats(shortaddr);
+  Response_P(PSTR("{\"" D_PRFX_ZB D_CMND_ZIGBEE_STATS "\":%s}"), dump.c_str());
+}
+
+#ifdef USE_WEBSERVER
+void ZigbeeStatsMetrics(void)
+{
+  if (!zigbee_devices.devicesSize()) { return; }
+
+  const char *metrics[] = { PSTR("zigbee_linkquality gauge"), PSTR("zigbee_last_seen_seconds gauge"),
+                            PSTR("zigbee_frames_received counter"), PSTR("zigbee_frames_sent counter"),
+                            PSTR("zigbee_confirm_failures counter"), PSTR("zigbee_latency_avg_milliseconds gauge"),
+                            PSTR("zigbee_latency_max_milliseconds gauge") };
+  for (uint32_t metric = 0; metric < ARRAY_SIZE(metrics); metric++) {
+    char name[40];
+    strncpy_P(name, metrics[metric], sizeof(name));
+    name[sizeof(name) -1] = '\0';
+    WSContentSend_P(PSTR("# TYPE %s\n"), name);
+    char *type = strchr(name, ' ');
+    if (type) { *type = '\0'; }
+    for (uint32_t i = 0; i < zigbee_devices.devicesSize(); i++) {
+      const Z_Device &device = zigbee_devices.devicesAt(i);
+      const Z_DeviceStats &stats = device.stats;
+      if (!stats.received) { continue; }    // never heard of, no link information
+      uint32_t value = stats.lqi[(stats.lqi_next + Z_LQI_HISTORY -1) % Z_LQI_HISTORY];
+      switch (metric) {
+        case 1: value = uptime - stats.last_seen; break;
+        case 2: value = stats.received; break;
+        case 3: value = stats.sent; break;
+        case 4: value = stats.confirm_fail; break;
+        case 5: value = (stats.latency_count) ? stats.latency_total / stats.latency_count : 0; break;
+        case 6: value = stats.latency_max; break;
+      }
+      WSContentSend_P(PSTR("%s{device=\"0x%04X\"} %u\n"), name, device.shortaddr, value);
+    }
+  }
+}
+#endif  // USE_WEBSERVER
+
 //
 // Command `ZbConfig`
 //
@@ -1235,7 +1421,7 @@ void CmndZbConfig(void) {
   // if (zigbee.init_phase) { ResponseCmndChar_P(PSTR(D_ZIGBEE_NOT_STARTED)); return; }
   RemoveAllSpaces(XdrvMailbox.data);
   if (strlen(XdrvMailbox.data) > 0) {
-    DynamicJsonBuffer jsonBuf;
+    JsonParseBuffer jsonBuf;
     const JsonObject &json = jsonBuf.parseObject((const char*) XdrvMailbox.data);
     if (!json.success()) { ResponseCmndChar_P(PSTR(D_JSON_INVALID_JSON)); return; }
 
@@ -1293,6 +1479,246 @@ void CmndZbConfig(void) {
                   hex_precfgkey_l, hex_precfgkey_h);
 }
 
+//
+// Command `ZbCoalesce`
+//
+void CmndZbCoalesce(void) {
+  // ZbCoalesce
+  // ZbCoalesce {"0x0B04":5000,"0x0006":0,"Interval":1000}
+  RemoveAllSpaces(XdrvMailbox.data);
+  if (strlen(XdrvMailbox.data) > 0) {
+    JsonParseBuffer jsonBuf;
+    const JsonObject &json = jsonBuf.parseObject((const char*) XdrvMailbox.data);
+    if (!json.success()) { ResponseCmndChar_P(PSTR(D_JSON_INVALID_JSON)); return; }
+
+    for (auto kv : json) {
+      uint32_t value = strToUInt(kv.value);
+      if (0 == strcasecmp_P(kv.key, PSTR("Interval"))) {
+        zigbee_coalesce_interval = value;
+      } else {
+        uint16_t cluster = strtoul(kv.key, nullptr, 0);
+        Z_SetCoalesceWindow(cluster, (value > 0xFFFF) ? 0xFFFF : value);
+      }
+    }
+  }
+
+  // display the windows different from USE_ZIGBEE_COALESCE_ATTR_TIMER
+  Response_P(PSTR("{\"" D_PRFX_ZB D_CMND_ZIGBEE_COALESCE "\":{\"Default\":%d,\"Interval\":%d"),
+                  USE_ZIGBEE_COALESCE_ATTR_TIMER, zigbee_coalesce_interval);
+  for (uint32_t i = 0; i < ARRAY_SIZE(Z_CoalesceDefaults); i++) {
+    uint16_t cluster = pgm_read_word(&Z_CoalesceDefaults[i].cluster);
+    ResponseAppend_P(PSTR(",\"0x%04X\":%d"), cluster, Z_GetCoalesceWindow(cluster));
+  }
+  for (auto &coalesce : zigbee_coalesce) {
+    bool listed = false;
+    for (uint32_t i = 0; i < ARRAY_SIZE(Z_CoalesceDefaults); i++) {
+      if (pgm_read_word(&Z_CoalesceDefaults[i].cluster) == coalesce.cluster) { listed = true; }
+    }
+    if (!listed) {
+      ResponseAppend_P(PSTR(",\"0x%04X\":%d"), coalesce.cluster, coalesce.window_ms);
+    }
+  }
+  ResponseAppend_P(PSTR("}}"));
+}
+
+#ifdef USE_ZIGBEE_REPLAY
+/*********************************************************************************************\
+ * Replay of captured ZNP traffic
+ *
+ * ZbReplay <file>[,<speed>] feeds the frames of a file in the filesystem to ZigbeeProcessInput()
+ * as if received from the CC2530, one frame per loop. Each line holds one frame as logged or
+ * published on receive, optionally preceded by the log time:
+ *   12:34:56.789 ZIG: {"ZbZNPReceived":"4481000000..."}
+ *   4481000000...
+ * Speed 1 keeps the timing of the log time, speed n replays n times faster and speed 0 or lines
+ * without log time replay as fast as possible.
+ *
+ * ZbReplay           - Show progress or the report of the last replay
+ * ZbReplay 0         - Stop the replay
+ *
+ * The report holds the number of frames, dropped lines, average and max processing time per
+ * frame in microseconds, lowest free heap and MQTT publishes done until the coalesce timer of
+ * the last frame expired.
+\*********************************************************************************************/
+
+#ifdef ESP32
+#include "SPIFFS.h"
+#define ZIGBEE_REPLAY_FS  SPIFFS
+#else
+#include <LittleFS.h>
+#define ZIGBEE_REPLAY_FS  LittleFS
+#endif
+
+const uint32_t ZIGBEE_REPLAY_LINE = 2 * ZIGBEE_BUFFER_SIZE + 64;   // hex frame, log time and JSON
+
+struct ZB_REPLAY {
+  File file;
+  uint32_t speed = 0;
+  uint32_t start = 0;                     // millis() of the replay start
+  uint32_t end = 0;                       // millis() at which the last frame is completely handled
+  uint32_t first_time = 0;                // log time of the first frame in ms of the day
+  uint32_t last_time = 0;                 // log time of the latest frame in ms of the day
+  uint32_t day_offset = 0;                // ms added to log times after passing midnight
+  uint32_t due = 0;                       // millis() of the next frame
+  uint32_t frames = 0;
+  uint32_t dropped = 0;                   // lines not holding a valid frame
+  uint32_t time_total = 0;                // processing time in µs
+  uint32_t time_max = 0;
+  uint32_t heap_low = 0;
+  uint32_t publish_start = 0;             // Mqtt.publish_count at start
+  uint32_t publishes = 0;
+  SBuffer *frame = nullptr;
+  bool pending = false;                   // frame waiting for its due time
+  bool active = false;
+  bool timed = false;                     // due holds the time of the waiting frame
+} ZigbeeReplay;
+
+bool ZigbeeReplayTime(const char *line, uint32_t *time) {
+  // Parse a leading log time HH:MM:SS or HH:MM:SS.mmm into ms of the day
+  unsigned int hh, mm, ss, ms = 0;
+  int n = 0;
+  if (sscanf(line, "%2u:%2u:%2u%n", &hh, &mm, &ss, &n) < 3) { return false; }
+  if ('.' == line[n]) { sscanf(line + n + 1, "%3u", &ms); }
+  *time = ((hh * 60 + mm) * 60 + ss) * 1000 + ms;
+  return true;
+}
+
+bool ZigbeeReplayParse(char *line, uint32_t *time, bool *timed) {
+  // Returns true if the line holds a frame, now in ZigbeeReplay.frame
+  *timed = ZigbeeReplayTime(line, time);
+  char *hex = strstr_P(line, PSTR(D_JSON_ZIGBEEZNPRECEIVED "\":\""));
+  if (hex) {
+    hex += strlen(D_JSON_ZIGBEEZNPRECEIVED "\":\"");
+  } else {
+    hex = strrchr(line, ' ');
+    hex = (hex) ? hex + 1 : line;
+  }
+  uint32_t len = 0;
+  while (isxdigit(hex[len])) { len++; }
+  if ((len < 4) || (len & 1) || (len > 2 * ZIGBEE_BUFFER_SIZE)) { return false; }
+  ZigbeeReplay.frame->setLen(0);
+  char stemp[3] = { 0 };
+  for (uint32_t i = 0; i < len; i += 2) {
+    stemp[0] = hex[i];
+    stemp[1] = hex[i + 1];
+    ZigbeeReplay.frame->add8(strtol(stemp, nullptr, 16));
+  }
+  return true;
+}
+
+void ZigbeeReplayRead(void) {
+  // Read lines until a frame is waiting or the file ends
+  char line[ZIGBEE_REPLAY_LINE];
+  while (!ZigbeeReplay.pending && ZigbeeReplay.file.available()) {
+    size_t len = ZigbeeReplay.file.readBytesUntil('\n', line, sizeof(line) - 1);
+    line[len] = '\0';
+    if ((len > 0) && ('\r' == line[len - 1])) { line[--len] = '\0'; }
+    if (!len) { continue; }
+    uint32_t time;
+    bool timed;
+    ZigbeeReplay.pending = ZigbeeReplayParse(line, &time, &timed);
+    if (!ZigbeeReplay.pending) {
+      ZigbeeReplay.dropped++;
+      continue;
+    }
+    ZigbeeReplay.timed = timed && ZigbeeReplay.speed;
+    if (ZigbeeReplay.timed) {
+      if (!ZigbeeReplay.frames) {
+        ZigbeeReplay.first_time = time;
+      } else if (time + ZigbeeReplay.day_offset < ZigbeeReplay.last_time) {
+        ZigbeeReplay.day_offset += 86400000;      // log passed midnight
+      }
+      ZigbeeReplay.last_time = time + ZigbeeReplay.day_offset;
+      ZigbeeReplay.due = ZigbeeReplay.start + (ZigbeeReplay.last_time - ZigbeeReplay.first_time) / ZigbeeReplay.speed;
+    }
+  }
+}
+
+void ZigbeeReplayStop(void) {
+  ZigbeeReplay.file.close();
+  ZigbeeReplay.pending = false;
+  ZigbeeReplay.publishes = Mqtt.publish_count - ZigbeeReplay.publish_start;
+  ZigbeeReplay.active = false;
+}
+
+void ZigbeeReplayResponse(void) {
+  Response_P(PSTR("{\"" D_PRFX_ZB D_CMND_ZIGBEE_REPLAY "\":{\"State\":\"%s\",\"Frames\":%u,\"Dropped\":%u,\"Avg\":%u,\"Max\":%u,\"HeapLow\":%u,\"Publishes\":%u,\"Time\":%u}}"),
+    (ZigbeeReplay.active) ? "Running" : "Done",
+    ZigbeeReplay.frames, ZigbeeReplay.dropped,
+    (ZigbeeReplay.frames) ? ZigbeeReplay.time_total / ZigbeeReplay.frames : 0, ZigbeeReplay.time_max,
+    ZigbeeReplay.heap_low,
+    (ZigbeeReplay.active) ? Mqtt.publish_count - ZigbeeReplay.publish_start : ZigbeeReplay.publishes,
+    ((ZigbeeReplay.active) ? millis() : ZigbeeReplay.end) - ZigbeeReplay.start);
+}
+
+void ZigbeeReplayLoop(void) {
+  if (!ZigbeeReplay.active) { return; }
+  if (ZigbeeReplay.end) {
+    // File done, wait for coalesced attribute publishes of the last frames
+    if (TimeReached(ZigbeeReplay.end)) {
+      ZigbeeReplayStop();
+      ZigbeeReplayResponse();
+      MqttPublishPrefixTopic_P(RESULT_OR_TELE, PSTR(D_PRFX_ZB D_CMND_ZIGBEE_REPLAY));
+    }
+    return;
+  }
+  ZigbeeReplayRead();
+  if (!ZigbeeReplay.pending) {
+    ZigbeeReplay.end = millis() + USE_ZIGBEE_COALESCE_ATTR_TIMER + 100;
+    return;
+  }
+  if (ZigbeeReplay.timed && !TimeReached(ZigbeeReplay.due)) { return; }
+
+  uint32_t start = micros();
+  ZigbeeProcessInput(*ZigbeeReplay.frame);
+  uint32_t duration = micros() - start;
+  ZigbeeReplay.pending = false;
+
+  ZigbeeReplay.frames++;
+  ZigbeeReplay.time_total += duration;
+  if (duration > ZigbeeReplay.time_max) { ZigbeeReplay.time_max = duration; }
+  uint32_t free_heap = ESP.getFreeHeap();
+  if (!ZigbeeReplay.heap_low || (free_heap < ZigbeeReplay.heap_low)) { ZigbeeReplay.heap_low = free_heap; }
+}
+
+void CmndZbReplay(void) {
+  if (XdrvMailbox.data_len > 0) {
+    if (ZigbeeReplay.active) { ZigbeeReplayStop(); }
+    if ((1 == XdrvMailbox.data_len) && ('0' == XdrvMailbox.data[0])) {
+      ResponseCmndDone();
+      return;
+    }
+    char *speed = strchr(XdrvMailbox.data, ',');
+    if (speed) { *speed++ = '\0'; }
+    char name[48];
+    snprintf_P(name, sizeof(name), PSTR("%s%s"), ('/' == XdrvMailbox.data[0]) ? "" : "/", Trim(XdrvMailbox.data));
+#ifdef ESP32
+    bool mounted = ZIGBEE_REPLAY_FS.begin(false);
+#else
+    bool mounted = ZIGBEE_REPLAY_FS.begin();
+#endif
+    if (!ZigbeeReplay.frame) { ZigbeeReplay.frame = new SBuffer(ZIGBEE_BUFFER_SIZE); }
+    if (mounted) { ZigbeeReplay.file = ZIGBEE_REPLAY_FS.open(name, "r"); }
+    if (!mounted || !ZigbeeReplay.file) {
+      ResponseCmndChar_P(PSTR("File not found"));
+      return;
+    }
+    ZigbeeReplay.speed = (speed) ? strtoul(speed, nullptr, 10) : 1;
+    ZigbeeReplay.start = millis();
+    ZigbeeReplay.end = 0;
+    ZigbeeReplay.day_offset = 0;
+    ZigbeeReplay.frames = 0;
+    ZigbeeReplay.dropped = 0;
+    ZigbeeReplay.time_total = 0;
+    ZigbeeReplay.time_max = 0;
+    ZigbeeReplay.heap_low = 0;
+    ZigbeeReplay.publish_start = Mqtt.publish_count;
+    ZigbeeReplay.active = true;
+  }
+  ZigbeeReplayResponse();
+}
+#endif  // USE_ZIGBEE_REPLAY
+
 /*********************************************************************************************\
  * Interface
 \*********************************************************************************************/
@@ -1306,16 +1732,22 @@ bool Xdrv23(uint8_t function)
       case FUNC_EVERY_50_MSECOND:
         if (!zigbee.init_phase) {
           zigbee_devices.runTimer();
+          if (!zigbee_af.idle()) { zigbee_af.run(); }
         }
         break;
       case FUNC_LOOP:
         if (ZigbeeSerial) { ZigbeeInputLoop(); }
+#ifdef USE_ZIGBEE_REPLAY
+        ZigbeeReplayLoop();
+#endif  // USE_ZIGBEE_REPLAY
 				if (zigbee.state_machine) {
           ZigbeeStateMachine_Run();
 				}
         break;
       case FUNC_PRE_INIT:
         ZigbeeInit();
+        XdrvSubscribe(FUNC_LOOP);
+        XdrvSubscribe(FUNC_EVERY_50_MSECOND);
         break;
       case FUNC_COMMAND:
         result = DecodeCommand(kZbCommands, ZigbeeCommand);
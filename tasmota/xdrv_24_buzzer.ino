@@ -211,6 +211,7 @@ bool Xdrv24(uint8_t function)
         break;
       case FUNC_PRE_INIT:
         BuzzerInit();
+        XdrvSubscribe(FUNC_EVERY_100_MSECOND);
         break;
       case FUNC_PIN_STATE:
         result = BuzzerPinState();
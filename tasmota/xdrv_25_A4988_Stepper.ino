@@ -21,6 +21,10 @@
 #ifdef USE_A4988_STEPPER
 /*********************************************************************************************\
  * A4988 Stepper motor driver circuit
+ *
+ * MotorMove, MotorRotate and MotorTurn return at once while a timer generates the step pulses.
+ * MotorAccel sets a trapezoidal ramp in steps per second squared (0 = constant speed). The end
+ * of a move is published as {"Motor":{"Done":<steps>}} for use in rules as Motor#Done.
 \*********************************************************************************************/
 
 #define XDRV_25                    25
@@ -63,32 +67,57 @@ void A4988Init(void)
 }
 
 const char kA4988Commands[] PROGMEM = "Motor|" // prefix
-  "Move|Rotate|Turn|MIS|SPR|RPM";
+  "Move|Rotate|Turn|MIS|SPR|RPM|Accel|Stop";
 
 void (* const A4988Command[])(void) PROGMEM = {
-  &CmndDoMove,&CmndDoRotate,&CmndDoTurn,&CmndSetMIS,&CmndSetSPR,&CmndSetRPM};
+  &CmndDoMove,&CmndDoRotate,&CmndDoTurn,&CmndSetMIS,&CmndSetSPR,&CmndSetRPM,&CmndSetAccel,&CmndDoStop};
+
+void A4988Started(bool started) {
+  if (started) {
+    ResponseCmndDone();
+  } else {
+    ResponseCmndChar_P(PSTR("Busy"));
+  }
+}
 
 void CmndDoMove(void) {
   if (XdrvMailbox.data_len > 0) {
     long stepsPlease = strtoul(XdrvMailbox.data,nullptr,10);
-    myA4988->doMove(stepsPlease);
-    ResponseCmndDone();
+    A4988Started(myA4988->startMove(stepsPlease));
   }
 }
 
 void CmndDoRotate(void) {
   if (XdrvMailbox.data_len > 0) {
     long degrsPlease = strtoul(XdrvMailbox.data,nullptr,10);
-    myA4988->doRotate(degrsPlease);
-    ResponseCmndDone();
+    A4988Started(myA4988->startRotate(degrsPlease));
   }
 }
 
 void CmndDoTurn(void) {
   if (XdrvMailbox.data_len > 0) {
     float turnsPlease = strtod(XdrvMailbox.data,nullptr);
-    myA4988->doTurn(turnsPlease);
-    ResponseCmndDone();
+    A4988Started(myA4988->startTurn(turnsPlease));
+  }
+}
+
+void CmndDoStop(void) {
+  myA4988->stop();
+  ResponseCmndDone();
+}
+
+void CmndSetAccel(void) {
+  if (XdrvMailbox.data_len > 0) {
+    myA4988->setAccel(strtoul(XdrvMailbox.data,nullptr,10));
+  }
+  ResponseCmndNumber(myA4988->getAccel());
+}
+
+void A4988Every50ms(void) {
+  if (myA4988->isDone()) {
+    Response_P(PSTR("{\"Motor\":{\"Done\":%d}}"), myA4988->getSteps());
+    MqttPublishPrefixTopic_P(RESULT_OR_STAT, PSTR("Motor"));
+    XdrvRulesProcess();
   }
 }
 
@@ -126,6 +155,10 @@ bool Xdrv25(uint8_t function)
     switch (function) {
       case FUNC_INIT:
         A4988Init();
+        XdrvSubscribe(FUNC_EVERY_50_MSECOND);
+        break;
+      case FUNC_EVERY_50_MSECOND:
+        A4988Every50ms();
         break;
       case FUNC_COMMAND:
         result = DecodeCommand(kA4988Commands, A4988Command);
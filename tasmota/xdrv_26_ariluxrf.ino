@@ -177,6 +177,9 @@ bool Xdrv26(uint8_t function)
   bool result = false;
 
   switch (function) {
+    case FUNC_PRE_INIT:
+      if (PinUsed(GPIO_ARIRFRCV)) { XdrvSubscribe(FUNC_EVERY_50_MSECOND); }
+      break;
     case FUNC_EVERY_50_MSECOND:
       if (PinUsed(GPIO_ARIRFRCV)) { AriluxRfHandler(); }
       break;
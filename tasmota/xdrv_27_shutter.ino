@@ -28,6 +28,8 @@
 
 const uint16_t MOTOR_STOP_TIME = 500;   // in mS
 const uint8_t steps_per_second = 20;    // FUNC_EVERY_50_MSECOND
+const uint32_t SHUTTER_STEP_US = 1000000 / steps_per_second;
+const uint32_t SHUTTER_STOP_WINDOW_US = 2 * SHUTTER_STEP_US;  // Arm the stop timer when the target is this close
 
 uint8_t calibrate_pos[6] = {0,30,50,70,90,100};
 uint16_t messwerte[5] = {30,50,70,90,100};
@@ -56,6 +58,7 @@ void (* const ShutterCommand[])(void) PROGMEM = {
 #include <Ticker.h>
 
 Ticker TickerShutter;
+Ticker TickerShutterStop[MAX_SHUTTERS];
 
 struct SHUTTER {
   power_t mask = 0;                       // bit mask with 11 at the position of relays that belong to at least ONE shutter
@@ -78,6 +81,10 @@ struct SHUTTER {
   uint8_t skip_relay_change;                 // avoid overrun at endstops
   int32_t accelerator[MAX_SHUTTERS];         // speed of ramp-up, ramp down of shutter
   uint8_t start_reported = 0;
+  uint32_t start_us[MAX_SHUTTERS];        // micros() at start of movement
+  uint32_t stop_us[MAX_SHUTTERS];         // micros() at the timed stop
+  volatile uint8_t stop_due = 0;          // bitmask of shutters stopped by their stop timer
+  uint8_t stop_armed = 0;                 // bitmask of shutters with an armed stop timer
 } Shutter;
 
 void ShutterLogPos(uint32_t i)
@@ -102,6 +109,58 @@ void ShutterRtc50mS(void)
   }
 }
 
+/*********************************************************************************************\
+ * Timed stop
+ *
+ * Time based shutters interpolate their position on the micros() elapsed since the start of the
+ * movement. When the target is less than SHUTTER_STOP_WINDOW_US of travel away a one-shot timer
+ * is armed for the remaining time. It switches the motor relay off at that moment and leaves
+ * the bookkeeping to the next loop so the stop does not depend on the 50 mS position update.
+ * Pulse mode shutters need a pulse timer and are stopped from the loop.
+\*********************************************************************************************/
+
+int32_t ShutterVelocity(uint32_t i)
+{
+  // Position units per SHUTTER_STEP_US
+  return (Shutter.direction[i] > 0) ? 100 : Shutter.close_velocity[i];
+}
+
+int32_t ShutterTimeBasedPosition(uint32_t i)
+{
+  uint32_t now = bitRead(Shutter.stop_due, i) ? Shutter.stop_us[i] : micros();
+  int64_t run_us = (int64_t)(now - Shutter.start_us[i]) - (int64_t)Shutter.motordelay[i] * SHUTTER_STEP_US;
+  return Shutter.start_position[i] + (int32_t)(run_us * ShutterVelocity(i) / SHUTTER_STEP_US) * Shutter.direction[i];
+}
+
+void ShutterStopTimer(uint32_t i)
+{
+  if (!Shutter.direction[i]) { return; }
+  Shutter.stop_us[i] = micros();
+  if (SHT_PULSE_OPEN__PULSE_CLOSE != Shutter.mode) {
+    uint32_t relay = (SHT_OFF_OPEN__OFF_CLOSE == Shutter.mode) ? Settings.shutter_startrelay[i] + ((Shutter.direction[i] == 1) ? 0 : 1) : Settings.shutter_startrelay[i];
+    uint32_t device = relay -1;
+    DigitalWrite(GPIO_REL1, device, bitRead(rel_inverted, device) ? 1 : 0);  // Motor off, power is updated from the loop
+  }
+  Shutter.stop_due |= (1 << i);
+}
+
+void ShutterStopArm(uint32_t i, int32_t remaining)
+{
+  // remaining = position units left to the stop position
+  if (bitRead(Shutter.stop_armed, i)) { return; }
+  uint32_t remaining_us = (remaining > 0) ? (int64_t)remaining * SHUTTER_STEP_US / ShutterVelocity(i) : 0;
+  if (remaining_us >= SHUTTER_STOP_WINDOW_US) { return; }
+  Shutter.stop_armed |= (1 << i);
+  TickerShutterStop[i].once_ms(tmax(remaining_us / 1000, (uint32_t)1), ShutterStopTimer, i);
+}
+
+void ShutterStopDisarm(uint32_t i)
+{
+  TickerShutterStop[i].detach();
+  Shutter.stop_armed &= ~(1 << i);
+  Shutter.stop_due &= ~(1 << i);
+}
+
 #define SHT_DIV_ROUND(__A, __B) (((__A) + (__B)/2) / (__B))
 
 int32_t ShutterPercentToRealPosition(uint32_t percent, uint32_t index)
@@ -334,9 +393,10 @@ void ShutterUpdatePosition(void)
           Shutter.accelerator[i] = 0;
         }
       } else {
-        Shutter.real_position[i] = Shutter.start_position[i] + ( (Shutter.time[i] - Shutter.motordelay[i]) * (Shutter.direction[i] > 0 ? 100 : -Shutter.close_velocity[i]));
+        Shutter.real_position[i] = ShutterTimeBasedPosition(i);
+        ShutterStopArm(i, (Shutter.target_position[i] - Shutter.real_position[i]) * Shutter.direction[i] - stop_position_delta);
       }
-      if ( Shutter.real_position[i] * Shutter.direction[i] + stop_position_delta >= Shutter.target_position[i] * Shutter.direction[i]  ) {
+      if (bitRead(Shutter.stop_due, i) || (Shutter.real_position[i] * Shutter.direction[i] + stop_position_delta >= Shutter.target_position[i] * Shutter.direction[i])) {
         // calculate relay number responsible for current movement.
         //AddLog_P2(LOG_LEVEL_DEBUG, PSTR("SHT: Stop Condition detected: real: %d, Target: %d, direction: %d"),Shutter.real_position[i], Shutter.target_position[i],Shutter.direction[i]);
         uint8_t cur_relay = Settings.shutter_startrelay[i] + (Shutter.direction[i] == 1 ? 0 : 1) ;
@@ -387,6 +447,7 @@ void ShutterUpdatePosition(void)
             }
           break;
         }
+        ShutterStopDisarm(i);
         ShutterLimitRealAndTargetPositions(i);
         Settings.shutter_position[i] = ShutterRealToPercentPosition(Shutter.real_position[i], i);
 
@@ -435,6 +496,8 @@ void ShutterStartInit(uint32_t i, int32_t direction, int32_t target_pos)
     Shutter.target_position[i] = target_pos;
     Shutter.start_position[i] = Shutter.real_position[i];
     Shutter.time[i] = 0;
+    ShutterStopDisarm(i);
+    Shutter.start_us[i] = micros();
     Shutter.skip_relay_change = 0;
     Shutter.direction[i] = direction;
     rules_flag.shutter_moving = 1;
@@ -1267,11 +1330,20 @@ bool Xdrv27(uint8_t function)
 {
   bool result = false;
 
+  if (FUNC_PRE_INIT == function) {
+    XdrvSubscribe(FUNC_EVERY_50_MSECOND);  // SetOption80 may be enabled later on
+    XdrvSubscribe(FUNC_LOOP);
+  }
   if (Settings.flag3.shutter_mode) {  // SetOption80 - Enable shutter support
     switch (function) {
       case FUNC_PRE_INIT:
         ShutterInit();
         break;
+      case FUNC_LOOP:
+        if (Shutter.stop_due) {
+          ShutterUpdatePosition();
+        }
+        break;
       case FUNC_EVERY_50_MSECOND:
         ShutterUpdatePosition();
         break;
@@ -36,7 +36,8 @@ struct PCF8574 {
   int error;
   uint8_t pin[64];
   uint8_t address[MAX_PCF8574];
-  uint8_t pin_mask[MAX_PCF8574] = { 0 };
+  uint8_t pin_mask[MAX_PCF8574] = { 0 };  // Output latch of each device as last written
+  uint8_t written = 0;                    // Devices written at least once since init
   uint8_t max_connected_ports = 0;        // Max numbers of devices comming from PCF8574 modules
   uint8_t max_devices = 0;                // Max numbers of PCF8574 modules
   char stype[9];
@@ -45,6 +46,11 @@ struct PCF8574 {
 
 void Pcf8574SwitchRelay(void)
 {
+  // Update the latches of all devices first so each changed device gets a single write
+  uint8_t pin_mask[MAX_PCF8574];
+  memcpy(pin_mask, Pcf8574.pin_mask, sizeof(pin_mask));
+  uint8_t used = 0;                       // Devices with relays
+
   for (uint32_t i = 0; i < devices_present; i++) {
     uint8_t relay_state = bitRead(XdrvMailbox.index, i);
 
@@ -52,22 +58,23 @@ void Pcf8574SwitchRelay(void)
 
     if (Pcf8574.max_devices > 0 && Pcf8574.pin[i] < 99) {
       uint8_t board = Pcf8574.pin[i]>>3;
-      uint8_t oldpinmask = Pcf8574.pin_mask[board];
       uint8_t _val = bitRead(rel_inverted, i) ? !relay_state : relay_state;
 
       //AddLog_P2(LOG_LEVEL_DEBUG, PSTR("PCF: Pcf8574SwitchRelay %d on pin %d"), i,state);
 
-      if (_val) {
-        Pcf8574.pin_mask[board] |= _val << (Pcf8574.pin[i]&0x7);
-      } else {
-        Pcf8574.pin_mask[board] &= ~(1 << (Pcf8574.pin[i]&0x7));
-      }
-      if (oldpinmask != Pcf8574.pin_mask[board]) {
-        Wire.beginTransmission(Pcf8574.address[board]);
-        Wire.write(Pcf8574.pin_mask[board]);
-        Pcf8574.error = Wire.endTransmission();
-      }
-      //pcf8574.write(Pcf8574.pin[i]&0x7, rel_inverted[i] ? !state : state);
+      bitWrite(pin_mask[board], Pcf8574.pin[i]&0x7, _val);
+      bitSet(used, board);
+    }
+  }
+
+  for (uint32_t board = 0; board < Pcf8574.max_devices; board++) {
+    if (!bitRead(used, board)) { continue; }
+    if ((pin_mask[board] != Pcf8574.pin_mask[board]) || !bitRead(Pcf8574.written, board)) {  // First write sets the power on state
+      Wire.beginTransmission(Pcf8574.address[board]);
+      Wire.write(pin_mask[board]);
+      Pcf8574.error = Wire.endTransmission();
+      Pcf8574.pin_mask[board] = pin_mask[board];
+      bitSet(Pcf8574.written, board);
     }
   }
 }
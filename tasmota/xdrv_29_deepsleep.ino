@@ -24,6 +24,7 @@
  * - For wakeup from DeepSleep needs GPIO16 to be connected to RST
  * - GPIO_DEEPSLEEP may be used to stop DeepSleep when connected to Gnd
  * - GPIO16 may be configured as GPIO_DEEPSLEEP
+ * - Wifi AP, DHCP lease and settings location are kept in RTC memory to resume quickly on wakeup
  *
  * See wiki https://github.com/arendst/Tasmota/wiki/DeepSleep
 \*********************************************************************************************/
@@ -46,6 +47,7 @@ void (* const DeepsleepCommand[])(void) PROGMEM = {
 
 uint32_t deepsleep_sleeptime = 0;
 uint8_t deepsleep_flag = 0;
+bool deepsleep_resume_ip = false;        // DHCP lease from before deepsleep in use
 
 bool DeepSleepEnabled(void)
 {
@@ -80,6 +82,61 @@ void DeepSleepReInit(void)
   RtcSettings.ultradeepsleep = 0;
 }
 
+/*********************************************************************************************\
+ * Fast resume
+\*********************************************************************************************/
+
+bool DeepSleepResume(void)
+{
+  // Wifi AP and DHCP lease recorded before deepsleep may be used
+  return (ResetReason() == REASON_DEEP_SLEEP_AWAKE) && RtcSettings.wifi_channel;
+}
+
+void DeepSleepResumeWifi(void)
+{
+  // Called by WifiBegin() when no static IP address is configured
+  if (DeepSleepResume() && RtcSettings.wifi_ip_address[0]) {
+    WiFi.config(RtcSettings.wifi_ip_address[0], RtcSettings.wifi_ip_address[1], RtcSettings.wifi_ip_address[2], RtcSettings.wifi_ip_address[3]);  // Skip DHCP
+    deepsleep_resume_ip = true;
+  }
+}
+
+void DeepSleepResumeStop(void)
+{
+  // Connect failed so scan and use DHCP from now on
+  RtcSettings.wifi_channel = 0;
+  RtcSettings.wifi_ip_address[0] = 0;
+  if (deepsleep_resume_ip) {
+    WiFi.config(0u, 0u, 0u);           // Enable DHCP
+    deepsleep_resume_ip = false;
+  }
+}
+
+void DeepSleepResumeSave(void)
+{
+  RtcSettings.wifi_channel = 0;
+  RtcSettings.wifi_ip_address[0] = 0;
+  if ((WL_CONNECTED == WiFi.status()) && (static_cast<uint32_t>(WiFi.localIP()) != 0)) {
+    RtcSettings.wifi_channel = WiFi.channel();
+    memcpy((void*) &RtcSettings.wifi_bssid, (void*) WiFi.BSSID(), sizeof(RtcSettings.wifi_bssid));
+    if (!Settings.ip_address[0]) {
+      RtcSettings.wifi_ip_address[0] = (uint32_t)WiFi.localIP();
+      RtcSettings.wifi_ip_address[1] = (uint32_t)WiFi.gatewayIP();
+      RtcSettings.wifi_ip_address[2] = (uint32_t)WiFi.subnetMask();
+      RtcSettings.wifi_ip_address[3] = (uint32_t)WiFi.dnsIP();
+    }
+  }
+#ifdef ESP8266
+  RtcSettings.settings_location = settings_location;
+  RtcSettings.settings_save_flag = Settings.save_flag;
+  RtcSettings.settings_crc32 = Settings.cfg_crc32;
+#endif  // ESP8266
+}
+
+/*********************************************************************************************\
+ * DeepSleep
+\*********************************************************************************************/
+
 void DeepSleepPrepare(void)
 {
   // Deepsleep_slip is ideally 10.000 == 100%
@@ -133,6 +190,7 @@ void DeepSleepStart(void)
 {
   AddLog_P(LOG_LEVEL_INFO, PSTR(D_LOG_APPLICATION "Sleeping"));  // Won't show in GUI
 
+  DeepSleepResumeSave();
   WifiShutdown();
   RtcSettings.ultradeepsleep = RtcSettings.nextwakeup - UtcTime();
   RtcSettingsSave();
@@ -616,6 +616,7 @@ bool Xdrv30(uint8_t function)
       break;
     case FUNC_INIT:
       ExsInit();
+      XdrvSubscribe(FUNC_LOOP);
       break;
     case FUNC_SET_DEVICE_POWER:
       result = ExsSetPower();
@@ -20,11 +20,18 @@
 #ifdef USE_TASMOTA_SLAVE
 /*********************************************************************************************\
  * Tasmota slave
+ *
+ * Flashing uses the STK500v1 protocol of the Arduino (Optiboot) bootloader. The bootloader baud
+ * rate is fixed when it is built so USE_TASMOTA_SLAVE_FLASH_SPEED is tried first followed by the
+ * other common rates. Optiboot replies in sync before writing a page and ok once written, so the
+ * next page is decoded from the HEX file while the current page is written.
 \*********************************************************************************************/
 
 #define XDRV_31                    31
 
 #define CONST_STK_CRC_EOP          0x20
+#define CONST_STK_INSYNC           0x14
+#define CONST_STK_OK               0x10
 
 #define CMND_STK_GET_SYNC          0x30
 #define CMND_STK_SET_DEVICE        0x42
@@ -52,6 +59,11 @@
 #define PARAM_DATA_START               0xFE
 #define PARAM_DATA_END                 0xFF
 
+#define TSLAVE_FLASH_PAGE_SIZE     128       // ATmega328P flash page size in bytes
+#define TSLAVE_SYNC_TIME           500       // Max mS trying to sync per baud rate, Optiboot waits about 1 second after reset
+
+const uint32_t kTasmotaSlaveFlashSpeeds[] PROGMEM = { USE_TASMOTA_SLAVE_FLASH_SPEED, 115200, 57600 };
+
 #include <TasmotaSerial.h>
 
 /*
@@ -124,10 +136,12 @@ uint8_t SimpleHexParse::parseLine(char *hexline)
 
 uint8_t SimpleHexParse::getByte(char* hexline, uint8_t idx)
 {
- char buff[3];
- buff[3] = '\0';
- memcpy(&buff, &hexline[(idx*2)-1], 2);
- return strtol(buff, 0, 16);
+  uint8_t value = 0;
+  for (uint32_t i = (idx*2)-1; i < (idx*2)+1; i++) {
+    char c = hexline[i] | 0x20;                 // Lower case
+    value = (value << 4) | ((c > '9') ? c - 'a' + 10 : c - '0');
+  }
+  return value;
 }
 
 /*
@@ -230,29 +244,34 @@ void TasmotaSlave_Reset(void)
 
 uint8_t TasmotaSlave_waitForSerialData(int dataCount, int timeout)
 {
-  int timer = 0;
-  while (timer < timeout) {
+  uint32_t timer = millis() + timeout;        // Poll without the 1 mS steps of delay(1)
+  while (!TimeReached(timer)) {
     if (TasmotaSlave_Serial->available() >= dataCount) {
       return 1;
     }
-    delay(1);
-    timer++;
+    yield();
   }
-  return 0;
+  return (TasmotaSlave_Serial->available() >= dataCount);
 }
 
-uint8_t TasmotaSlave_sendBytes(uint8_t* bytes, int count)
+uint8_t TasmotaSlave_readResponse(int timeout)
 {
-  TasmotaSlave_Serial->write(bytes, count);
-  TasmotaSlave_waitForSerialData(2, 250);
+  // Returns 1 if the bootloader replied in sync and ok
+  TasmotaSlave_waitForSerialData(2, timeout);
   uint8_t sync = TasmotaSlave_Serial->read();
   uint8_t ok = TasmotaSlave_Serial->read();
-  if ((sync == 0x14) && (ok == 0x10)) {
+  if ((sync == CONST_STK_INSYNC) && (ok == CONST_STK_OK)) {
     return 1;
   }
   return 0;
 }
 
+uint8_t TasmotaSlave_sendBytes(uint8_t* bytes, int count)
+{
+  TasmotaSlave_Serial->write(bytes, count);
+  return TasmotaSlave_readResponse(250);
+}
+
 uint8_t TasmotaSlave_execCmd(uint8_t cmd)
 {
   uint8_t bytes[] = { cmd, CONST_STK_CRC_EOP };
@@ -281,25 +300,30 @@ uint8_t TasmotaSlave_SetupFlash(void)
 {
   uint8_t ProgParams[] = {0x86, 0x00, 0x00, 0x01, 0x01, 0x01, 0x01, 0x03, 0xff, 0xff, 0xff, 0xff, 0x00, 0x80, 0x04, 0x00, 0x00, 0x00, 0x80, 0x00};
   uint8_t ExtProgParams[] = {0x05, 0x04, 0xd7, 0xc2, 0x00};
-  TasmotaSlave_Serial->begin(USE_TASMOTA_SLAVE_FLASH_SPEED);
-  if (TasmotaSlave_Serial->hardwareSerial()) {
-    ClaimSerial();
-  }
+  uint8_t sync[] = { CMND_STK_GET_SYNC, CONST_STK_CRC_EOP };
+  uint32_t speed = 0;
+  uint8_t no_error = 0;
+  for (uint32_t i = 0; (i < ARRAY_SIZE(kTasmotaSlaveFlashSpeeds)) && !no_error; i++) {
+    speed = pgm_read_dword(kTasmotaSlaveFlashSpeeds + i);
+    if ((i > 0) && (USE_TASMOTA_SLAVE_FLASH_SPEED == speed)) { continue; }  // Already tried
+    TasmotaSlave_Serial->begin(speed);
+    if (TasmotaSlave_Serial->hardwareSerial()) {
+      ClaimSerial();
+    }
 
-  TasmotaSlave_Reset();
+    TasmotaSlave_Reset();
 
-  uint8_t timeout = 0;
-  uint8_t no_error = 0;
-  while (50 > timeout) {
-    if (TasmotaSlave_execCmd(CMND_STK_GET_SYNC)) {
-      timeout = 200;
-      no_error = 1;
+    uint32_t timeout = millis() + TSLAVE_SYNC_TIME;
+    while (!no_error && !TimeReached(timeout)) {
+      while (TasmotaSlave_Serial->available()) {
+        TasmotaSlave_Serial->read();             // Skip any reply received at a wrong baud rate
+      }
+      TasmotaSlave_Serial->write(sync, sizeof(sync));
+      no_error = TasmotaSlave_readResponse(25);
     }
-    timeout++;
-    delay(1);
   }
   if (no_error) {
-    AddLog_P2(LOG_LEVEL_INFO, PSTR("TasmotaSlave: Found bootloader"));
+    AddLog_P2(LOG_LEVEL_INFO, PSTR("TasmotaSlave: Found bootloader at %d baud"), speed);
   } else {
     no_error = 0;
     AddLog_P2(LOG_LEVEL_INFO, PSTR("TasmotaSlave: Bootloader could not be found"));
@@ -334,29 +358,62 @@ uint8_t TasmotaSlave_loadAddress(uint8_t adrHi, uint8_t adrLo)
   return TasmotaSlave_execParam(CMND_STK_LOAD_ADDRESS, params, sizeof(params));
 }
 
-void TasmotaSlave_FlashPage(uint8_t addr_h, uint8_t addr_l, uint8_t* data)
+uint8_t TasmotaSlave_sendPage(uint8_t addr_h, uint8_t addr_l, uint8_t* data)
 {
-  uint8_t Header[] = {CMND_STK_PROG_PAGE, 0x00, 0x80, 0x46};
-  TasmotaSlave_loadAddress(addr_h, addr_l);
-  TasmotaSlave_Serial->write(Header, 4);
-  for (int i = 0; i < 128; i++) {
-    TasmotaSlave_Serial->write(data[i]);
+  // Returns 1 if the page is accepted, its write is confirmed by TasmotaSlave_readResponse()
+  uint8_t Header[] = {CMND_STK_PROG_PAGE, 0x00, TSLAVE_FLASH_PAGE_SIZE, 0x46};
+  if (!TasmotaSlave_loadAddress(addr_h, addr_l)) {
+    return 0;
   }
+  TasmotaSlave_Serial->write(Header, sizeof(Header));
+  TasmotaSlave_Serial->write(data, TSLAVE_FLASH_PAGE_SIZE);
   TasmotaSlave_Serial->write(CONST_STK_CRC_EOP);
-  TasmotaSlave_waitForSerialData(2, 250);
-  TasmotaSlave_Serial->read();
-  TasmotaSlave_Serial->read();
+  return 1;
 }
 
-void TasmotaSlave_Flash(void)
+struct TSLAVE_HEX_READER {
+  char* buffer;                               // One flash sector of the stored HEX file
+  uint32_t start;
+  uint32_t read;                              // Bytes read into buffer
+  uint32_t processed;                         // Bytes of buffer parsed
+  char line[50];
+  uint8_t position;
+};
+
+bool TasmotaSlave_readPage(SimpleHexParse &hexParse, TSLAVE_HEX_READER &reader)
 {
-  bool reading = true;
-  uint32_t read = 0;
-  uint32_t processed = 0;
-  char thishexline[50];
-  uint8_t position = 0;
-  char* flash_buffer;
+  // Parse the stored HEX file up to the next complete page, returns false at the end of the file
+  while (!hexParse.EndOfFile && (reader.processed < TSlave.spi_hex_size)) {
+    uint32_t ca = reader.processed % SPI_FLASH_SEC_SIZE;
+    if (0 == ca) {
+      ESP.flashRead(reader.start + reader.read, (uint32_t*)reader.buffer, SPI_FLASH_SEC_SIZE);
+      reader.read += SPI_FLASH_SEC_SIZE;
+    }
+    reader.processed++;
+    char c = reader.buffer[ca];
+    if (':' == c) {
+      reader.position = 0;
+    }
+    if (0x0D == c) {
+      reader.line[reader.position] = 0;
+      hexParse.parseLine(reader.line);
+      if (hexParse.PageIsReady) {
+        hexParse.PageIsReady = false;
+        hexParse.FlashPageIdx = 0;
+        return true;
+      }
+    } else {
+      if ((0x0A != c) && (reader.position < sizeof(reader.line) -1)) {
+        reader.line[reader.position] = c;
+        reader.position++;
+      }
+    }
+  }
+  return false;
+}
 
+void TasmotaSlave_Flash(void)
+{
   SimpleHexParse hexParse = SimpleHexParse();
 
   if (!TasmotaSlave_SetupFlash()) {
@@ -366,39 +423,31 @@ void TasmotaSlave_Flash(void)
     return;
   }
 
-  flash_buffer = new char[SPI_FLASH_SEC_SIZE];
-  uint32_t flash_start = TasmotaSlave_FlashStart() * SPI_FLASH_SEC_SIZE;
-  while (reading) {
-    ESP.flashRead(flash_start + read, (uint32_t*)flash_buffer, SPI_FLASH_SEC_SIZE);
-    read = read + SPI_FLASH_SEC_SIZE;
-    if (read >= TSlave.spi_hex_size) {
-      reading = false;
-    }
-    for (uint32_t ca = 0; ca < SPI_FLASH_SEC_SIZE; ca++) {
-      processed++;
-      if ((processed <= TSlave.spi_hex_size) && (!hexParse.EndOfFile)) {
-        if (':' == flash_buffer[ca]) {
-          position = 0;
-        }
-        if (0x0D == flash_buffer[ca]) {
-          thishexline[position] = 0;
-          hexParse.parseLine(thishexline);
-          if (hexParse.PageIsReady) {
-            TasmotaSlave_FlashPage(hexParse.ptr_h, hexParse.ptr_l, hexParse.FlashPage);
-            hexParse.PageIsReady = false;
-            hexParse.FlashPageIdx = 0;
-          }
-        } else {
-          if (0x0A != flash_buffer[ca]) {
-            thishexline[position] = flash_buffer[ca];
-            position++;
-          }
-        }
-      }
+  TSLAVE_HEX_READER reader = { 0 };
+  reader.buffer = new char[SPI_FLASH_SEC_SIZE];
+  reader.start = TasmotaSlave_FlashStart() * SPI_FLASH_SEC_SIZE;
+
+  uint8_t page[TSLAVE_FLASH_PAGE_SIZE];
+  uint32_t pages = 0;
+  uint8_t no_error = 1;
+  bool page_ready = TasmotaSlave_readPage(hexParse, reader);
+  while (page_ready && no_error) {
+    memcpy(page, hexParse.FlashPage, sizeof(page));  // FlashPage receives the next page while this one is written
+    no_error = TasmotaSlave_sendPage(hexParse.ptr_h, hexParse.ptr_l, page);
+    page_ready = TasmotaSlave_readPage(hexParse, reader);  // Decode the next page while the slave writes this one
+    if (no_error) {
+      no_error = TasmotaSlave_readResponse(250);
+      pages++;
     }
   }
+  delete[] reader.buffer;
+
   TasmotaSlave_exitProgMode();
-  AddLog_P2(LOG_LEVEL_INFO, PSTR("TasmotaSlave: Flash done!"));
+  if (no_error) {
+    AddLog_P2(LOG_LEVEL_INFO, PSTR("TasmotaSlave: Flash done! %d pages written"), pages);
+  } else {
+    AddLog_P2(LOG_LEVEL_INFO, PSTR("TasmotaSlave: Flashing failed at page %d"), pages +1);
+  }
   TSlave.flashing  = false;
   restart_flag = 2;
 }
@@ -584,6 +633,9 @@ bool Xdrv31(uint8_t function)
   bool result = false;
 
   switch (function) {
+    case FUNC_PRE_INIT:
+      XdrvSubscribe(FUNC_EVERY_100_MSECOND);
+      break;
     case FUNC_EVERY_100_MSECOND:
       if (TSlave.type) {
         if (TasmotaSlave_Serial->available()) {
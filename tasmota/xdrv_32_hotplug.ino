@@ -22,6 +22,7 @@
  * HotPlug Support
  *
  * - Rescan bus every N seconds. It send FUNC_HOTPLUG_SCAN event to every sensors.
+ * - The I2C detection cache is refreshed before each scan.
  * - If HotPlug is 0 or 0xFF -- HotPlug is off
 \*********************************************************************************************/
 
@@ -56,6 +57,9 @@ void HotPlugEverySecond(void)
 {
   if (Hotplug.enabled) {
     if (Hotplug.timeout == 0) {
+#ifdef USE_I2C
+      I2cRescan();
+#endif  // USE_I2C
       XsnsCall(FUNC_HOTPLUG_SCAN);
       Hotplug.timeout = Settings.hotplug_scan;
     }
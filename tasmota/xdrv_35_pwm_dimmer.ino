@@ -32,6 +32,12 @@
 
 #define XDRV_35             35
 
+#define PWM_DIMMER_RAMP_INTERVAL   20    // mS between brightness updates while a button is held (50 Hz)
+#define PWM_DIMMER_RAMP_STEP_TIME  50    // mS per brightness step of the hold speed
+#define PWM_DIMMER_RAMP_SEGMENT    250   // mS between device group updates while a button is held
+
+enum PWMDimmerRampStates { PWM_DIMMER_RAMP_IDLE, PWM_DIMMER_RAMP_RUNNING };
+
 const char kPWMDimmerCommands[] PROGMEM = "|"  // No prefix
   D_CMND_BRI_PRESET;
 
@@ -72,6 +78,16 @@ uint8_t remote_pwm_dimmer_count;
 bool active_device_is_local;
 #endif  // USE_PWM_DIMMER_REMOTE
 
+struct {
+  uint32_t last_time;                    // millis() of the last brightness update
+  uint32_t segment_time;                 // millis() of the last device group update
+  int32_t fraction;                      // Brightness change not applied yet in 1/256 steps
+  int8_t direction;
+  uint8_t state = PWM_DIMMER_RAMP_IDLE;
+  uint8_t button;                        // Index of the held button
+  uint8_t segment_bri;                   // Brightness of the last device group update
+} PWMDimmerRamp;
+
 void PWMModulePreInit(void)
 {
   Settings.seriallog_level = 0;
@@ -233,6 +249,107 @@ void PWMDimmerHandleDevGroupItem(void)
 }
 #endif  // USE_DEVICE_GROUPS
 
+/*********************************************************************************************\
+ * Brightness ramp
+ *
+ * Holding a button starts a ramp which is updated from the loop every PWM_DIMMER_RAMP_INTERVAL.
+ * The step of each update follows the time elapsed since the previous one, so the dimming speed
+ * does not depend on loop, button or network delays. Device groups get a more-to-come update
+ * per PWM_DIMMER_RAMP_SEGMENT instead of one per step and the final brightness when it ends.
+\*********************************************************************************************/
+
+uint32_t PWMDimmerGetBri(void)
+{
+#ifdef USE_PWM_DIMMER_REMOTE
+  if (!active_device_is_local) return active_remote_pwm_dimmer->bri;
+#endif  // USE_PWM_DIMMER_REMOTE
+  return light_state.getBri();
+}
+
+void PWMDimmerSetBri(uint32_t new_bri)
+{
+  // Set the brightness of the active device without sending device group updates
+#ifdef USE_PWM_DIMMER_REMOTE
+  if (!active_device_is_local) {
+    active_remote_pwm_dimmer->bri_power_on = active_remote_pwm_dimmer->bri = new_bri;
+    return;
+  }
+#endif  // USE_PWM_DIMMER_REMOTE
+  skip_light_fade = true;
+#ifdef USE_DEVICE_GROUPS
+  ignore_dgr_sends = true;
+#endif  // USE_DEVICE_GROUPS
+  light_state.setBri(new_bri);
+  LightAnimate();
+  skip_light_fade = false;
+#ifdef USE_DEVICE_GROUPS
+  ignore_dgr_sends = false;
+#endif  // USE_DEVICE_GROUPS
+  Settings.bri_power_on = new_bri;
+}
+
+bool PWMDimmerRampPending(void)
+{
+  return (PWM_DIMMER_RAMP_RUNNING == PWMDimmerRamp.state) && (millis() - PWMDimmerRamp.last_time >= PWM_DIMMER_RAMP_INTERVAL);
+}
+
+void PWMDimmerRampLoop(void)
+{
+  if (!PWMDimmerRampPending()) return;
+  uint32_t now = millis();
+  uint32_t elapsed = now - PWMDimmerRamp.last_time;
+  if (elapsed > 500) elapsed = 500;
+  PWMDimmerRamp.last_time = now;
+
+  int32_t bri = PWMDimmerGetBri();
+  int32_t step = (Settings.light_correction ? 4 : bri / 16 + 1);
+  PWMDimmerRamp.fraction += step * elapsed * 256 / PWM_DIMMER_RAMP_STEP_TIME;
+  int32_t new_bri = bri + PWMDimmerRamp.direction * (PWMDimmerRamp.fraction >> 8);
+  PWMDimmerRamp.fraction &= 0xFF;
+  if (new_bri > 255) new_bri = 255;
+  if (new_bri < 1) new_bri = 1;
+  if (new_bri != bri) {
+    PWMDimmerSetBri(new_bri);
+  }
+  else {
+    PWMDimmerSetBrightnessLeds(0);
+  }
+
+#ifdef USE_DEVICE_GROUPS
+  if (new_bri != PWMDimmerRamp.segment_bri && now - PWMDimmerRamp.segment_time >= PWM_DIMMER_RAMP_SEGMENT) {
+    PWMDimmerRamp.segment_time = now;
+    PWMDimmerRamp.segment_bri = new_bri;
+    SendDeviceGroupMessage(power_button_index, DGR_MSGTYP_UPDATE_MORE_TO_COME, DGR_ITEM_LIGHT_BRI, new_bri);
+  }
+#endif  // USE_DEVICE_GROUPS
+}
+
+void PWMDimmerRampStart(uint32_t button_index, int32_t direction)
+{
+  if (PWM_DIMMER_RAMP_RUNNING == PWMDimmerRamp.state && direction == PWMDimmerRamp.direction) return;
+  uint32_t now = millis();
+  PWMDimmerRamp.state = PWM_DIMMER_RAMP_RUNNING;
+  PWMDimmerRamp.button = button_index;
+  PWMDimmerRamp.direction = direction;
+  PWMDimmerRamp.fraction = 0;
+  PWMDimmerRamp.last_time = now - PWM_DIMMER_RAMP_STEP_TIME;  // Take the first step at once
+  PWMDimmerRamp.segment_time = now - PWM_DIMMER_RAMP_SEGMENT;
+  PWMDimmerRamp.segment_bri = PWMDimmerGetBri();
+  PWMDimmerRampLoop();
+}
+
+void PWMDimmerRampStop(void)
+{
+  if (PWM_DIMMER_RAMP_RUNNING != PWMDimmerRamp.state) return;
+  PWMDimmerRamp.state = PWM_DIMMER_RAMP_IDLE;
+#ifdef USE_DEVICE_GROUPS
+  uint32_t bri = PWMDimmerGetBri();
+  if (bri != PWMDimmerRamp.segment_bri) {
+    SendDeviceGroupMessage(power_button_index, DGR_MSGTYP_UPDATE_MORE_TO_COME, DGR_ITEM_LIGHT_BRI, bri);
+  }
+#endif  // USE_DEVICE_GROUPS
+}
+
 void PWMDimmerHandleButton(void)
 {
   /*
@@ -277,6 +394,7 @@ void PWMDimmerHandleButton(void)
 
   bool state_updated = false;
   int32_t bri_offset = 0;
+  int32_t ramp_direction = 0;
   uint8_t power_on_bri = 0;
   uint8_t dgr_item = 0;
   uint8_t dgr_value;
@@ -348,14 +466,14 @@ void PWMDimmerHandleButton(void)
           // the power button before this, ...
           if (buttons_pressed == 1 && !tap_count) {
 
-            // If the power is on, adjust the brightness. Set the direction based on the current
+            // If the power is on, ramp the brightness. Set the direction based on the current
             // direction for the device and then invert the direction when the power button is
-            // released. The new brightness will be calculated below.
+            // released. The ramp is started below.
             if (power_is_on) {
 #ifdef USE_PWM_DIMMER_REMOTE
-              bri_offset = (!active_device_is_local ? (active_remote_pwm_dimmer->power_button_increases_bri ? 1 : -1) : (power_button_increases_bri ? 1 : -1));
+              ramp_direction = (!active_device_is_local ? (active_remote_pwm_dimmer->power_button_increases_bri ? 1 : -1) : (power_button_increases_bri ? 1 : -1));
 #else // USE_PWM_DIMMER_REMOTE
-              bri_offset = (power_button_increases_bri ? 1 : -1);
+              ramp_direction = (power_button_increases_bri ? 1 : -1);
 #endif  // USE_PWM_DIMMER_REMOTE
               invert_power_button_bri_direction = true;
             }
@@ -378,10 +496,10 @@ void PWMDimmerHandleButton(void)
         else {
 
           // If the power is on and the up or down button was not tapped while holding the power
-          // button before this, adjust the brightness. Set the direction based on which button is
-          // pressed. The new brightness will be calculated below.
+          // button before this, ramp the brightness. Set the direction based on which button is
+          // pressed. The ramp is started below.
           if (power_is_on && !tap_count) {
-            bri_offset = (is_down_button ? -1 : 1);
+            ramp_direction = (is_down_button ? -1 : 1);
           }
 
           else {
@@ -432,7 +550,7 @@ void PWMDimmerHandleButton(void)
             // If we need to publish an MQTT trigger, do it.
             if (mqtt_trigger) {
               char topic[TOPSZ];
-              sprintf_P(mqtt_data, PSTR("Trigger%u"), mqtt_trigger);
+              Response_P(PSTR("Trigger%u"), mqtt_trigger);
 #ifdef USE_PWM_DIMMER_REMOTE
               if (!active_device_is_local) {
                 snprintf_P(topic, sizeof(topic), PSTR("cmnd/%s/Event"), device_groups[power_button_index].group_name);
@@ -454,6 +572,9 @@ void PWMDimmerHandleButton(void)
   else {
     bool button_was_held = button_hold_sent[button_index];
 
+    // Stop ramping the brightness and send the brightness reached.
+    PWMDimmerRampStop();
+
     // If the button was not held, send a button toggle. If the button was held but not processes by
     // support_button or support_buttondoesn't process the toggle (is not handled by a rule), ...
     if (!(button_hold_sent[button_index] ? button_hold_processed[button_index] : SendKey(KEY_BUTTON, button_index + 1, POWER_TOGGLE))) {
@@ -583,16 +704,19 @@ void PWMDimmerHandleButton(void)
     buttons_pressed--;
   }
 
-  // If we need to adjust the brightness, do it.
+  // If a button is held to change the brightness, start the ramp. Stop it if the held button no
+  // longer changes the brightness, like when another button was pressed.
+  if (ramp_direction) {
+    PWMDimmerRampStart(button_index, ramp_direction);
+  }
+  else if (!XdrvMailbox.payload && button_index == PWMDimmerRamp.button && button_hold_time[button_index] < now) {
+    PWMDimmerRampStop();
+  }
+
+  // If we need to step the brightness for a button tap, do it.
   if (bri_offset) {
-    int32_t bri;
-#ifdef USE_PWM_DIMMER_REMOTE
-    if (!active_device_is_local)
-      bri = active_remote_pwm_dimmer->bri;
-    else
-#endif  // USE_PWM_DIMMER_REMOTE
-      bri = light_state.getBri();
-    int32_t new_bri = bri + bri_offset * ((dgr_item ? 16 : Settings.light_correction ? 4 : bri / 16 + 1));
+    int32_t bri = PWMDimmerGetBri();
+    int32_t new_bri = bri + bri_offset * 16;
 
     if (bri_offset > 0) {
       if (new_bri > 255) new_bri = 255;
@@ -604,25 +728,7 @@ void PWMDimmerHandleButton(void)
 #ifdef USE_DEVICE_GROUPS
       SendDeviceGroupMessage(power_button_index, DGR_MSGTYP_UPDATE_MORE_TO_COME, DGR_ITEM_LIGHT_BRI, new_bri);
 #endif  // USE_DEVICE_GROUPS
-#ifdef USE_PWM_DIMMER_REMOTE
-      if (!active_device_is_local)
-        active_remote_pwm_dimmer->bri_power_on = active_remote_pwm_dimmer->bri = new_bri;
-      else {
-#endif  // USE_PWM_DIMMER_REMOTE
-        skip_light_fade = true;
-#ifdef USE_DEVICE_GROUPS
-        ignore_dgr_sends = true;
-#endif  // USE_DEVICE_GROUPS
-        light_state.setBri(new_bri);
-        LightAnimate();
-        skip_light_fade = false;
-#ifdef USE_DEVICE_GROUPS
-        ignore_dgr_sends = false;
-#endif  // USE_DEVICE_GROUPS
-        Settings.bri_power_on = new_bri;
-#ifdef USE_PWM_DIMMER_REMOTE
-      }
-#endif  // USE_PWM_DIMMER_REMOTE
+      PWMDimmerSetBri(new_bri);
     }
     else {
       PWMDimmerSetBrightnessLeds(0);
@@ -791,8 +897,13 @@ bool Xdrv35(uint8_t function)
         result = true;
       break;
 
+    case FUNC_LOOP:
+      PWMDimmerRampLoop();
+      break;
+
     case FUNC_PRE_INIT:
       PWMModulePreInit();
+      XdrvSubscribe(FUNC_LOOP);
       break;
   }
   return result;
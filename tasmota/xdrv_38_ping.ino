@@ -19,21 +19,62 @@
 
 #ifdef USE_PING
 
+/*********************************************************************************************\
+ * ICMP Ping
+ *
+ * Ping <host>    - Send 4 pings, stop with the first response (Ping2 to Ping10 send 2 to 10 pings)
+ *
+ * Host monitor sending a single ping to up to PING_MONITOR_HOSTS hosts at the same time every
+ * PingInterval seconds. Each host keeps the round trip times of its last PING_MONITOR_WINDOW
+ * pings. When all pings of a round are finished one tele Ping message with a PingMonitor object
+ * holding the statistics of all hosts is published, split in parts if it does not fit in a
+ * message. Hosts are kept in RAM only so set them from a rule triggered by System#Boot.
+ *
+ * PingHost1 <host> - Monitor host 1 to PING_MONITOR_HOSTS
+ * PingHost1 0      - Stop monitoring host 1
+ * PingInterval 60  - Start a round every 60 seconds, 0 to stop the monitor
+\*********************************************************************************************/
+
 #define XDRV_38                    38
 
+#ifndef PING_MONITOR_HOSTS
+#define PING_MONITOR_HOSTS         20       // Max number of monitored hosts
+#endif
+#ifndef PING_MONITOR_WINDOW
+#define PING_MONITOR_WINDOW        10       // Number of pings per host kept for the statistics
+#endif
+
+const uint16_t PING_LOST = 0xFFFF;          // Ring value of a ping without response
+
 #include "lwip/icmp.h"
 #include "lwip/inet_chksum.h"
 #include "lwip/raw.h"
 #include "lwip/timeouts.h"
 
 const char kPingCommands[] PROGMEM =  "|"    // no prefix
-  D_CMND_PING
+  D_CMND_PING "|" D_CMND_PINGHOST "|" D_CMND_PINGINTERVAL
   ;
 
 void (* const PingCommand[])(void) PROGMEM = {
-  &CmndPing,
+  &CmndPing, &CmndPingHost, &CmndPingInterval
   };
 
+struct PING_MONITOR_HOST {
+  char *host;
+  uint32_t ip;                              // Last resolved address, 0 if not resolved
+  uint16_t rtt[PING_MONITOR_WINDOW];        // mS or PING_LOST
+  uint8_t next;                             // Ring index of the next ping
+  uint8_t samples;                          // Number of valid ring entries
+  bool pending;                             // Ping of the current round not finished
+};
+
+struct {
+  PING_MONITOR_HOST *host[PING_MONITOR_HOSTS] = {};
+  uint16_t interval = 0;                    // Seconds between rounds, 0 if stopped
+  uint16_t countdown = 0;                   // Seconds to the next round
+  uint8_t pending = 0;                      // Pings of the current round not finished
+} PingMonitor;
+
 extern "C" {
   
   extern uint32 system_relative_time(uint32 time);
@@ -58,6 +99,7 @@ extern "C" {
     uint32_t    sum_time;           // cumulated time in ms for all successful responses (used to compute the average)
     bool        done;               // indicates the ping campaign is finished
     bool        fast;               // fast mode, i.e. stop pings when first successful response
+    int8_t      monitor;            // index of the monitored host, -1 if started by command
   } Ping_t;
 
   // globals
@@ -229,7 +271,7 @@ extern "C" {
   // ================================================================================
   // Start pings
   // ================================================================================
-  bool t_ping_start(uint32_t ip, uint32_t count) {
+  bool t_ping_start(uint32_t ip, uint32_t count, int32_t monitor = -1) {
     // check if pings are already ongoing for this IP
     if (t_ping_find(ip)) {
       return false;
@@ -242,6 +284,7 @@ extern "C" {
     }
     ping->min_time = UINT32_MAX;
     ping->ip = ip;
+    ping->monitor = monitor;
     ping->to_send_count = count - 1;
 
     // add to Linked List from head
@@ -254,17 +297,170 @@ extern "C" {
     // set timers for time-out and cadence
     sys_timeout(Ping_timeout_ms, t_ping_timeout, ping);
     sys_timeout(Ping_coarse, t_ping_coarse_tmr, ping);
+    return true;
+  }
+
+}
+
+/*********************************************************************************************\
+ * Host monitor
+\*********************************************************************************************/
+
+bool PingResolve(const char *host, IPAddress &ip)
+{
+#ifdef USE_DNS_CACHE
+  return DnsHostByName(host, ip);
+#else
+  return WiFi.hostByName(host, ip);
+#endif  // USE_DNS_CACHE
+}
+
+void PingMonitorAdd(uint32_t index, uint32_t rtt)
+{
+  PING_MONITOR_HOST *host = PingMonitor.host[index];
+  if (!host || !host->pending) { return; }  // Host was removed or changed while pinging
+  host->pending = false;
+  host->rtt[host->next] = rtt;
+  host->next = (host->next +1) % PING_MONITOR_WINDOW;
+  if (host->samples < PING_MONITOR_WINDOW) { host->samples++; }
+  if (PingMonitor.pending) { PingMonitor.pending--; }
+}
+
+void PingMonitorStart(void)
+{
+  if (PingMonitor.pending) { return; }      // Previous round not finished yet
+  for (uint32_t i = 0; i < PING_MONITOR_HOSTS; i++) {
+    PING_MONITOR_HOST *host = PingMonitor.host[i];
+    if (!host) { continue; }
+    host->pending = true;
+    PingMonitor.pending++;
+#ifndef USE_DNS_CACHE
+    if (!host->ip)                          // Without cache resolve once to not block every round
+#endif  // USE_DNS_CACHE
+    {
+      IPAddress ip;
+      host->ip = (PingResolve(host->host, ip)) ? (uint32_t)ip : 0;
+    }
+    if (!host->ip) {
+      PingMonitorAdd(i, PING_LOST);         // Not resolved counts as lost
+    }
+    else if (!t_ping_start(host->ip, 1, i)) {
+      host->pending = false;                // Pinged by command or another host, skip this round
+      PingMonitor.pending--;
+    }
   }
+}
 
+void PingMonitorStats(PING_MONITOR_HOST *host, uint32_t *min, uint32_t *avg, uint32_t *max, uint32_t *loss)
+{
+  uint32_t received = 0;
+  uint32_t sum = 0;
+  *min = UINT32_MAX;
+  *max = 0;
+  for (uint32_t i = 0; i < host->samples; i++) {
+    uint32_t rtt = host->rtt[i];
+    if (PING_LOST == rtt) { continue; }
+    received++;
+    sum += rtt;
+    if (rtt < *min) { *min = rtt; }
+    if (rtt > *max) { *max = rtt; }
+  }
+  if (!received) { *min = 0; }
+  *avg = (received) ? sum / received : 0;
+  *loss = (host->samples) ? ((host->samples - received) * 100) / host->samples : 0;
 }
 
+uint32_t PingMonitorLast(PING_MONITOR_HOST *host)
+{
+  return host->rtt[(host->next + PING_MONITOR_WINDOW -1) % PING_MONITOR_WINDOW];
+}
+
+void PingMonitorPublish(void)
+{
+  bool first = true;
+  for (uint32_t i = 0; i < PING_MONITOR_HOSTS; i++) {
+    PING_MONITOR_HOST *host = PingMonitor.host[i];
+    if (!host || !host->samples) { continue; }
+    if (!first && (ResponseLength() + strlen(host->host) + 80 > MESSZ)) {
+      ResponseJsonEndEnd();
+      MqttPublishPrefixTopic_P(TELE, PSTR(D_JSON_PING));
+      XdrvRulesProcess();
+      first = true;
+    }
+    if (first) {
+      Response_P(PSTR("{\"" D_JSON_PINGMONITOR "\":{"));
+    }
+    uint32_t min, avg, max, loss;
+    PingMonitorStats(host, &min, &avg, &max, &loss);
+    uint32_t last = PingMonitorLast(host);
+    ResponseAppend_P(PSTR("%s\"%s\":{\"Reachable\":%s,\"Rtt\":%d,\"Min\":%d,\"Avg\":%d,\"Max\":%d,\"Loss\":%d}"),
+      (first) ? "" : ",", host->host, (PING_LOST == last) ? "false" : "true", (PING_LOST == last) ? 0 : last, min, avg, max, loss);
+    first = false;
+  }
+  if (!first) {
+    ResponseJsonEndEnd();
+    MqttPublishPrefixTopic_P(TELE, PSTR(D_JSON_PING));
+    XdrvRulesProcess();
+  }
+}
+
+void PingMonitorEverySecond(void)
+{
+  if (!PingMonitor.interval) { return; }
+  if (PingMonitor.countdown) { PingMonitor.countdown--; }
+  if (!PingMonitor.countdown && !global_state.wifi_down) {
+    PingMonitor.countdown = PingMonitor.interval;
+    PingMonitorStart();
+    if (!PingMonitor.pending) { PingMonitorPublish(); }  // Nothing to wait for
+  }
+}
+
+#ifdef USE_PROMETHEUS
+void PingMetrics(void)
+{
+  const char *metrics[] = { PSTR("ping_reachable"), PSTR("ping_rtt_milliseconds"), PSTR("ping_loss_percent") };
+  for (uint32_t metric = 0; metric < ARRAY_SIZE(metrics); metric++) {
+    char name[24];
+    strncpy_P(name, metrics[metric], sizeof(name));
+    name[sizeof(name) -1] = '\0';
+    bool typed = false;
+    for (uint32_t i = 0; i < PING_MONITOR_HOSTS; i++) {
+      PING_MONITOR_HOST *host = PingMonitor.host[i];
+      if (!host || !host->samples) { continue; }
+      if (!typed) {
+        WSContentSend_P(PSTR("# TYPE %s gauge\n"), name);
+        typed = true;
+      }
+      uint32_t min, avg, max, loss;
+      PingMonitorStats(host, &min, &avg, &max, &loss);
+      uint32_t last = PingMonitorLast(host);
+      if (0 == metric) {
+        WSContentSend_P(PSTR("%s{host=\"%s\"} %d\n"), name, host->host, (PING_LOST == last) ? 0 : 1);
+      }
+      else if (1 == metric) {
+        WSContentSend_P(PSTR("%s{host=\"%s\",stat=\"min\"} %u\n%s{host=\"%s\",stat=\"avg\"} %u\n%s{host=\"%s\",stat=\"max\"} %u\n"),
+          name, host->host, min, name, host->host, avg, name, host->host, max);
+      }
+      else {
+        WSContentSend_P(PSTR("%s{host=\"%s\"} %u\n"), name, host->host, loss);
+      }
+    }
+  }
+}
+#endif  // USE_PROMETHEUS
+
 // Check if any ping requests is completed, and publish the results
 void PingResponsePoll(void) {
   Ping_t *ping = ping_head;
   Ping_t **prev_link = &ping_head;      // previous link pointer (used to remove en entry)
+  bool monitored = false;               // a monitor ping finished
 
   while (ping != nullptr) {
-    if (ping->done) {
+    if (ping->done && (ping->monitor >= 0)) {
+      PingMonitorAdd(ping->monitor, (ping->success_count) ? ping->min_time : PING_LOST);
+      monitored = true;
+    }
+    else if (ping->done) {
       uint32_t success = ping->success_count;
       uint32_t ip = ping->ip;
 
@@ -284,7 +480,8 @@ void PingResponsePoll(void) {
                       );
       MqttPublishPrefixTopic_P(RESULT_OR_TELE, PSTR(D_JSON_PING));
       XdrvRulesProcess();
-      
+    }
+    if (ping->done) {
       // remove from linked list
       *prev_link = ping->next;
       // don't increment prev_link
@@ -296,6 +493,9 @@ void PingResponsePoll(void) {
       ping = ping->next;
     }
   }
+  if (monitored && !PingMonitor.pending) {
+    PingMonitorPublish();               // last ping of the round
+  }
 }
 
 /*********************************************************************************************\
@@ -309,7 +509,7 @@ void CmndPing(void) {
   RemoveSpace(XdrvMailbox.data);
   if (count > 10) { count = 8; }   // max 8 seconds
 
-  if (WiFi.hostByName(XdrvMailbox.data, ip)) {
+  if (PingResolve(XdrvMailbox.data, ip)) {
     bool ok = t_ping_start(ip, count);
     if (ok) {
       ResponseCmndDone();
@@ -321,6 +521,43 @@ void CmndPing(void) {
   }
 }
 
+void CmndPingHost(void) {
+  if ((XdrvMailbox.index < 1) || (XdrvMailbox.index > PING_MONITOR_HOSTS)) { return; }
+
+  uint32_t index = XdrvMailbox.index -1;
+  PING_MONITOR_HOST *host = PingMonitor.host[index];
+  if (XdrvMailbox.data_len > 0) {
+    RemoveSpace(XdrvMailbox.data);
+    if (host) {
+      if (host->pending && PingMonitor.pending) { PingMonitor.pending--; }
+      free(host->host);
+      delete host;
+      host = nullptr;
+      PingMonitor.host[index] = nullptr;
+    }
+    if ((SC_CLEAR != Shortcut()) && strlen(XdrvMailbox.data)) {
+      host = new PING_MONITOR_HOST();
+      host->host = (char*)malloc(strlen(XdrvMailbox.data) +1);
+      if (!host->host) {
+        delete host;
+        host = nullptr;
+      } else {
+        strcpy(host->host, XdrvMailbox.data);
+        PingMonitor.host[index] = host;
+      }
+    }
+  }
+  ResponseCmndIdxChar((host) ? host->host : "");
+}
+
+void CmndPingInterval(void) {
+  if ((XdrvMailbox.payload >= 0) && (XdrvMailbox.payload <= 3600)) {
+    PingMonitor.interval = XdrvMailbox.payload;
+    PingMonitor.countdown = (PingMonitor.interval) ? 1 : 0;   // start the first round right away
+  }
+  ResponseCmndNumber(PingMonitor.interval);
+}
+
 
 /*********************************************************************************************\
  * Interface
@@ -331,9 +568,15 @@ bool Xdrv38(uint8_t function)
   bool result = false;
 
   switch (function) {
+    case FUNC_PRE_INIT:
+    XdrvSubscribe(FUNC_EVERY_250_MSECOND);
+    break;
     case FUNC_EVERY_250_MSECOND:
     PingResponsePoll();   // TODO
     break;
+    case FUNC_EVERY_SECOND:
+    PingMonitorEverySecond();
+    break;
     case FUNC_COMMAND:
     result = DecodeCommand(kPingCommands, PingCommand);
     break;
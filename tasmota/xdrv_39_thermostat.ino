@@ -78,6 +78,10 @@
 #define D_CMND_CTRDUTYCYCLEREAD "CtrDutyCycleRead"
 #define D_CMND_ENABLEOUTPUTSET "EnableOutputSet"
 
+#define THERMOSTAT_CTR_INTERVAL   60000         // Controller cycle in milliseconds of the thermostat clock
+#define THERMOSTAT_CTR_STAGGER    250           // Offset in milliseconds between the controller cycles of the outputs
+#define THERMOSTAT_TEMP_SENS_MAX  8             // Highest local temperature sensor number
+
 enum ThermostatModes { THERMOSTAT_OFF, THERMOSTAT_AUTOMATIC_OP, THERMOSTAT_MANUAL_OP, THERMOSTAT_MODES_MAX };
 #ifdef USE_PI_AUTOTUNING
 enum ControllerModes { CTR_HYBRID, CTR_PI, CTR_RAMP_UP, CTR_PI_AUTOTUNE, CTR_MODES_MAX };
@@ -135,7 +139,7 @@ typedef union {
     uint32_t use_input : 1;             // Flag stating if the input switch shall be used to switch to manual mode
     uint32_t phase_hybrid_ctr : 2;      // Phase of the hybrid controller (Ramp-up, PI or Autotune)
     uint32_t status_cycle_active : 1;   // Status showing if cycle is active (Output ON) or not (Output OFF)
-    uint32_t counter_seconds : 6;       // Second counter used to track minutes
+    uint32_t spare6 : 6;                // Free bits
     uint32_t output_relay_number : 4;   // Output relay number
     uint32_t input_switch_number : 3;   // Input switch number
     uint32_t enable_output : 1;         // Enables / disables the physical output
@@ -175,7 +179,7 @@ const char kThermostatCommands[] PROGMEM = "|" D_CMND_THERMOSTATMODESET "|" D_CM
   D_CMND_TIMEMINACTIONSET "|" D_CMND_TIMEMINTURNOFFACTIONSET "|" D_CMND_TEMPRUPDELTINSET "|" D_CMND_TEMPRUPDELTOUTSET "|" 
   D_CMND_TIMERAMPUPMAXSET "|" D_CMND_TIMERAMPUPCYCLESET "|" D_CMND_TEMPRAMPUPPIACCERRSET "|" D_CMND_TIMEPIPROPORTREAD "|" 
   D_CMND_TIMEPIINTEGRREAD "|" D_CMND_TIMESENSLOSTSET "|" D_CMND_DIAGNOSTICMODESET "|" D_CMND_CTRDUTYCYCLEREAD "|" 
-  D_CMND_ENABLEOUTPUTSET;
+  D_CMND_ENABLEOUTPUTSET "|" D_CMND_TEMPSENSNUMBERSET;
 
 void (* const ThermostatCommand[])(void) PROGMEM = {
   &CmndThermostatModeSet, &CmndClimateModeSet, &CmndTempFrostProtectSet, &CmndControllerModeSet, &CmndInputSwitchSet, 
@@ -189,7 +193,7 @@ void (* const ThermostatCommand[])(void) PROGMEM = {
 #endif // USE_PI_AUTOTUNING
   &CmndTempRupDeltOutSet, &CmndTimeRampupMaxSet, &CmndTimeRampupCycleSet, &CmndTempRampupPiAccErrSet, 
   &CmndTimePiProportRead, &CmndTimePiIntegrRead, &CmndTimeSensLostSet, &CmndDiagnosticModeSet, &CmndCtrDutyCycleRead,
-  &CmndEnableOutputSet };
+  &CmndEnableOutputSet, &CmndTempSensNumberSet };
 
 struct THERMOSTAT {
   ThermostatStateBitfield status;                                             // Bittfield including states as well as several flags
@@ -200,6 +204,10 @@ struct THERMOSTAT {
   uint32_t time_thermostat_total = 0;                                         // Time thermostat on within a specific timeframe
   uint32_t time_ctr_checkpoint = 0;                                           // Time to finalize the control cycle within the PI strategy or to switch to PI from Rampup in seconds
   uint32_t time_ctr_changepoint = 0;                                          // Time until switching off output within the controller in seconds
+  uint32_t time_ctr_next = 0;                                                 // Thermostat clock in milliseconds of the next controller cycle
+  uint16_t time_ctr_phase = 0;                                                // Milliseconds into the second the changepoint has been set
+  bool output_timer = false;                                                  // Switch at the changepoint between controller cycles
+  uint8_t temp_sens_number = THERMOSTAT_TEMP_SENS_NUMBER;                     // Local temperature sensor number
   int32_t temp_measured_gradient = 0;                                         // Temperature measured gradient from sensor in thousandths of degrees per hour
   int16_t temp_target_level = THERMOSTAT_TEMP_INIT;                           // Target level of the thermostat in tenths of degrees
   int16_t temp_target_level_ctr = THERMOSTAT_TEMP_INIT;                       // Target level set for the controller
@@ -256,8 +264,59 @@ struct THERMOSTAT {
 #endif // USE_PI_AUTOTUNING
 } Thermostat[THERMOSTAT_CONTROLLER_OUTPUTS];
 
+struct {
+  uint32_t last_millis = 0;                                                   // millis() of the latest clock update
+  uint32_t seconds = 0;                                                       // Monotonic seconds since thermostat init, not affected by millis() rollover
+  uint32_t fraction = 0;                                                      // Milliseconds into the current second
+} ThermostatClock;
+
 /*********************************************************************************************/
 
+void ThermostatClockUpdate(void)
+{
+  uint32_t now = millis();
+  ThermostatClock.fraction += now - ThermostatClock.last_millis;
+  ThermostatClock.last_millis = now;
+  if (ThermostatClock.fraction >= 1000) {
+    ThermostatClock.seconds += ThermostatClock.fraction / 1000;
+    ThermostatClock.fraction %= 1000;
+  }
+}
+
+uint32_t ThermostatMillis(void)
+{
+  // Thermostat clock in milliseconds, wraps like millis() so compare differences only
+  return ThermostatClock.seconds * 1000 + ThermostatClock.fraction;
+}
+
+bool ThermostatTimeReached(uint32_t timer)
+{
+  return ((int32_t)(ThermostatMillis() - timer) >= 0);
+}
+
+void ThermostatSetChangepoint(uint8_t ctr_output, uint32_t time)
+{
+  // Switch output in time seconds from now with millisecond resolution
+  Thermostat[ctr_output].time_ctr_changepoint = ThermostatClock.seconds + time;
+  Thermostat[ctr_output].time_ctr_phase = ThermostatClock.fraction;
+  Thermostat[ctr_output].output_timer = true;
+}
+
+void ThermostatOutputTimer(uint8_t ctr_output)
+{
+  // Re-evaluate the output at the changepoint instead of at the next controller cycle
+  if (!Thermostat[ctr_output].output_timer
+    || (Thermostat[ctr_output].time_ctr_changepoint == 0)
+    || !ThermostatTimeReached(Thermostat[ctr_output].time_ctr_changepoint * 1000 + Thermostat[ctr_output].time_ctr_phase)) {
+    return;
+  }
+  Thermostat[ctr_output].output_timer = false;
+  if ((Thermostat[ctr_output].status.thermostat_mode == THERMOSTAT_AUTOMATIC_OP)
+    && (Thermostat[ctr_output].status.command_output == IFACE_ON)) {
+    ThermostatWork(ctr_output);
+  }
+}
+
 void ThermostatInit(uint8_t ctr_output)
 {
   // Init Thermostat[ctr_output].status bitfield:
@@ -272,9 +331,10 @@ void ThermostatInit(uint8_t ctr_output)
   Thermostat[ctr_output].status.phase_hybrid_ctr = CTR_HYBRID_PI;
   Thermostat[ctr_output].status.status_cycle_active = CYCLE_OFF;
   Thermostat[ctr_output].diag.state_emergency = EMERGENCY_OFF;
-  Thermostat[ctr_output].status.counter_seconds = 0;
   Thermostat[ctr_output].status.output_relay_number = (THERMOSTAT_RELAY_NUMBER + ctr_output);
   Thermostat[ctr_output].status.input_switch_number = (THERMOSTAT_SWITCH_NUMBER + ctr_output);
+  Thermostat[ctr_output].temp_sens_number = (THERMOSTAT_TEMP_SENS_NUMBER + ctr_output);
+  Thermostat[ctr_output].time_ctr_next = ThermostatMillis() + THERMOSTAT_CTR_INTERVAL + (ctr_output * THERMOSTAT_CTR_STAGGER);
   Thermostat[ctr_output].status.use_input = INPUT_NOT_USED;
   Thermostat[ctr_output].status.enable_output = IFACE_ON;
   Thermostat[ctr_output].diag.output_inconsist_ctr = 0;
@@ -292,11 +352,13 @@ void ThermostatInit(uint8_t ctr_output)
 bool ThermostatMinuteCounter(uint8_t ctr_output) 
 {
   bool result = false;
-  Thermostat[ctr_output].status.counter_seconds++;    // increment time
-  
-  if ((Thermostat[ctr_output].status.counter_seconds % 60) == 0) {
+  // Controller cycles follow the thermostat clock instead of counting FUNC_EVERY_SECOND calls
+  if (ThermostatTimeReached(Thermostat[ctr_output].time_ctr_next)) {
     result = true; 
-    Thermostat[ctr_output].status.counter_seconds = 0;
+    Thermostat[ctr_output].time_ctr_next += THERMOSTAT_CTR_INTERVAL;
+    if (ThermostatTimeReached(Thermostat[ctr_output].time_ctr_next)) {
+      Thermostat[ctr_output].time_ctr_next = ThermostatMillis() + THERMOSTAT_CTR_INTERVAL;  // Do not catch up on missed cycles
+    }
   }
   return result;
 }
@@ -367,7 +429,7 @@ int16_t ThermostatFahrenheitToCelsius(const int32_t deg, uint8_t conv_type) {
 void ThermostatSignalPreProcessingSlow(uint8_t ctr_output)
 {
   // Update input sensor status
-  if ((uptime - Thermostat[ctr_output].timestamp_temp_measured_update) > ((uint32_t)Thermostat[ctr_output].time_sens_lost * 60)) {
+  if ((ThermostatClock.seconds - Thermostat[ctr_output].timestamp_temp_measured_update) > ((uint32_t)Thermostat[ctr_output].time_sens_lost * 60)) {
     Thermostat[ctr_output].status.sensor_alive = IFACE_OFF;
     Thermostat[ctr_output].temp_measured_gradient = 0;
     Thermostat[ctr_output].temp_measured = 0;
@@ -392,7 +454,7 @@ void ThermostatSignalProcessingFast(uint8_t ctr_output)
   Thermostat[ctr_output].status.status_input = (uint32_t)ThermostatInputStatus(Thermostat[ctr_output].status.input_switch_number);
   // Update timestamp of last input
   if (Thermostat[ctr_output].status.status_input == IFACE_ON) {
-    Thermostat[ctr_output].timestamp_input_on = uptime;
+    Thermostat[ctr_output].timestamp_input_on = ThermostatClock.seconds;
   }
   // Update real status of the output
   Thermostat[ctr_output].status.status_output = (uint32_t)ThermostatOutputStatus(Thermostat[ctr_output].status.output_relay_number);
@@ -453,7 +515,7 @@ void ThermostatHybridCtrPhase(uint8_t ctr_output)
           // If ramp-up offtime counter has been initalized    
           // AND ramp-up offtime counter value reached
           if((Thermostat[ctr_output].time_ctr_checkpoint != 0) 
-            && (uptime >= Thermostat[ctr_output].time_ctr_checkpoint)) {
+            && (ThermostatClock.seconds >= Thermostat[ctr_output].time_ctr_checkpoint)) {
             // Reset pause period
             Thermostat[ctr_output].time_ctr_checkpoint = 0;
             // Reset timers
@@ -468,13 +530,13 @@ void ThermostatHybridCtrPhase(uint8_t ctr_output)
           // AND temp target has changed
           // AND value of temp target - actual temperature bigger than threshold for heating and lower for cooling
           // then go to ramp-up
-          if (((uptime - Thermostat[ctr_output].timestamp_output_off) > (60 * (uint32_t)Thermostat[ctr_output].time_allow_rampup))
+          if (((ThermostatClock.seconds - Thermostat[ctr_output].timestamp_output_off) > (60 * (uint32_t)Thermostat[ctr_output].time_allow_rampup))
             && (Thermostat[ctr_output].temp_target_level != Thermostat[ctr_output].temp_target_level_ctr)
             && ( ( (Thermostat[ctr_output].temp_target_level - Thermostat[ctr_output].temp_measured > Thermostat[ctr_output].temp_rampup_delta_in)
                 && (flag_heating))
               || ( (Thermostat[ctr_output].temp_measured - Thermostat[ctr_output].temp_target_level > Thermostat[ctr_output].temp_rampup_delta_in)
                 && (!flag_heating)))) {
-              Thermostat[ctr_output].timestamp_rampup_start = uptime;
+              Thermostat[ctr_output].timestamp_rampup_start = ThermostatClock.seconds;
               Thermostat[ctr_output].temp_rampup_start = Thermostat[ctr_output].temp_measured;
               Thermostat[ctr_output].temp_rampup_meas_gradient = 0;
               Thermostat[ctr_output].time_rampup_deadtime = 0;
@@ -541,7 +603,7 @@ bool ThermostatStateManualToAuto(uint8_t ctr_output)
   // then go to automatic
   if ((Thermostat[ctr_output].status.status_input == IFACE_OFF) 
     &&(Thermostat[ctr_output].status.sensor_alive ==  IFACE_ON)
-    && ((uptime - Thermostat[ctr_output].timestamp_input_on) > ((uint32_t)Thermostat[ctr_output].time_manual_to_auto * 60))) {
+    && ((ThermostatClock.seconds - Thermostat[ctr_output].timestamp_input_on) > ((uint32_t)Thermostat[ctr_output].time_manual_to_auto * 60))) {
     change_state = true;
   }
   return change_state;
@@ -608,7 +670,7 @@ void ThermostatOutputRelay(uint8_t ctr_output, uint32_t command)
       ExecuteCommandPower(Thermostat[ctr_output].status.output_relay_number, POWER_OFF, SRC_THERMOSTAT);
     }
 //#endif // DEBUG_THERMOSTAT
-    Thermostat[ctr_output].timestamp_output_off = uptime;
+    Thermostat[ctr_output].timestamp_output_off = ThermostatClock.seconds;
     Thermostat[ctr_output].status.status_output = IFACE_OFF;
 #ifdef DEBUG_THERMOSTAT
     ThermostatVirtualSwitch(ctr_output);
@@ -793,15 +855,15 @@ void ThermostatCalculatePI(uint8_t ctr_output)
   }
   
   // Adjust output switch point
-  Thermostat[ctr_output].time_ctr_changepoint = uptime + (uint32_t)Thermostat[ctr_output].time_total_pi;
+  ThermostatSetChangepoint(ctr_output, (uint32_t)Thermostat[ctr_output].time_total_pi);
   // Adjust next cycle point
-  Thermostat[ctr_output].time_ctr_checkpoint = uptime + ((uint32_t)Thermostat[ctr_output].time_pi_cycle * 60);
+  Thermostat[ctr_output].time_ctr_checkpoint = ThermostatClock.seconds + ((uint32_t)Thermostat[ctr_output].time_pi_cycle * 60);
 }
 
 void ThermostatWorkAutomaticPI(uint8_t ctr_output)
 {
   bool flag_heating = (Thermostat[ctr_output].status.climate_mode == CLIMATE_HEATING);
-  if ( (uptime >= Thermostat[ctr_output].time_ctr_checkpoint) 
+  if ( (ThermostatClock.seconds >= Thermostat[ctr_output].time_ctr_checkpoint) 
     || (Thermostat[ctr_output].temp_target_level != Thermostat[ctr_output].temp_target_level_ctr)
     || (  (( (Thermostat[ctr_output].temp_measured < Thermostat[ctr_output].temp_target_level)
           && (Thermostat[ctr_output].temp_measured_gradient < 0)
@@ -815,7 +877,7 @@ void ThermostatWorkAutomaticPI(uint8_t ctr_output)
     // Reset cycle active
     Thermostat[ctr_output].status.status_cycle_active = CYCLE_OFF;
   }
-  if (uptime < Thermostat[ctr_output].time_ctr_changepoint) {
+  if (ThermostatClock.seconds < Thermostat[ctr_output].time_ctr_changepoint) {
     Thermostat[ctr_output].status.status_cycle_active = CYCLE_ON;
     Thermostat[ctr_output].status.command_output = IFACE_ON;
   }
@@ -842,7 +904,7 @@ void ThermostatWorkAutomaticRampUp(uint8_t ctr_output)
   }
 
   // Update time in ramp-up as well as delta temp
-  time_in_rampup = uptime - Thermostat[ctr_output].timestamp_rampup_start;
+  time_in_rampup = ThermostatClock.seconds - Thermostat[ctr_output].timestamp_rampup_start;
   temp_delta_rampup = Thermostat[ctr_output].temp_measured - Thermostat[ctr_output].temp_rampup_start;
   // Init command output status to true
   Thermostat[ctr_output].status.command_output = IFACE_ON;
@@ -873,14 +935,14 @@ void ThermostatWorkAutomaticRampUp(uint8_t ctr_output)
       }
       // Calculate absolute gradient since start of ramp-up (considering deadtime) in thousandths of º/hour
       Thermostat[ctr_output].temp_rampup_meas_gradient = (int32_t)((360000 * (int32_t)temp_delta_rampup) / (int32_t)time_in_rampup);
-      Thermostat[ctr_output].time_rampup_nextcycle = uptime + ((uint32_t)Thermostat[ctr_output].time_rampup_cycle * 60);
+      Thermostat[ctr_output].time_rampup_nextcycle = ThermostatClock.seconds + ((uint32_t)Thermostat[ctr_output].time_rampup_cycle * 60);
       // Set auxiliary variables
       Thermostat[ctr_output].temp_rampup_cycle = Thermostat[ctr_output].temp_measured;
-      Thermostat[ctr_output].time_ctr_changepoint = uptime + (60 * (uint32_t)Thermostat[ctr_output].time_rampup_max);
+      ThermostatSetChangepoint(ctr_output, (60 * (uint32_t)Thermostat[ctr_output].time_rampup_max));
       Thermostat[ctr_output].temp_rampup_output_off =  Thermostat[ctr_output].temp_target_level_ctr;
     }
     // Gradient calculation every time_rampup_cycle
-    else if ((Thermostat[ctr_output].time_rampup_deadtime > 0) && (uptime >= Thermostat[ctr_output].time_rampup_nextcycle)) {
+    else if ((Thermostat[ctr_output].time_rampup_deadtime > 0) && (ThermostatClock.seconds >= Thermostat[ctr_output].time_rampup_nextcycle)) {
       // Calculate temp. gradient in º/hour and set again time_rampup_nextcycle and temp_rampup_cycle
       // temp_rampup_meas_gradient = ((3600 * temp_delta_rampup) / (os.time() - time_rampup_nextcycle))
       temp_delta_rampup = Thermostat[ctr_output].temp_measured - Thermostat[ctr_output].temp_rampup_cycle;
@@ -897,12 +959,14 @@ void ThermostatWorkAutomaticRampUp(uint8_t ctr_output)
         // x = ((y-y1)/(y2-y1))*(x2-x1) + x1 - deadtime        
         aux_temp_delta =Thermostat[ctr_output].temp_target_level_ctr - Thermostat[ctr_output].temp_rampup_cycle;
         Thermostat[ctr_output].time_ctr_changepoint = (uint32_t)(uint32_t)(((uint32_t)(aux_temp_delta) * (uint32_t)(time_total_rampup)) / (uint32_t)temp_delta_rampup) + (uint32_t)Thermostat[ctr_output].time_rampup_nextcycle - (uint32_t)time_total_rampup - (uint32_t)Thermostat[ctr_output].time_rampup_deadtime;
+        Thermostat[ctr_output].time_ctr_phase = 0;
+        Thermostat[ctr_output].output_timer = true;
 
         // Calculate temperature for switching off the output
         // y = (((y2-y1)/(x2-x1))*(x-x1)) + y1
-        Thermostat[ctr_output].temp_rampup_output_off = (int16_t)(((int32_t)temp_delta_rampup * (int32_t)(Thermostat[ctr_output].time_ctr_changepoint - (uptime - (time_total_rampup)))) / (int32_t)(time_total_rampup * Thermostat[ctr_output].counter_rampup_cycles)) + Thermostat[ctr_output].temp_rampup_cycle;
+        Thermostat[ctr_output].temp_rampup_output_off = (int16_t)(((int32_t)temp_delta_rampup * (int32_t)(Thermostat[ctr_output].time_ctr_changepoint - (ThermostatClock.seconds - (time_total_rampup)))) / (int32_t)(time_total_rampup * Thermostat[ctr_output].counter_rampup_cycles)) + Thermostat[ctr_output].temp_rampup_cycle;
         // Set auxiliary variables
-        Thermostat[ctr_output].time_rampup_nextcycle = uptime + ((uint32_t)Thermostat[ctr_output].time_rampup_cycle * 60);
+        Thermostat[ctr_output].time_rampup_nextcycle = ThermostatClock.seconds + ((uint32_t)Thermostat[ctr_output].time_rampup_cycle * 60);
         Thermostat[ctr_output].temp_rampup_cycle = Thermostat[ctr_output].temp_measured;
         // Reset period counter
         Thermostat[ctr_output].counter_rampup_cycles = 1;
@@ -911,9 +975,9 @@ void ThermostatWorkAutomaticRampUp(uint8_t ctr_output)
         // Increase the period counter
         Thermostat[ctr_output].counter_rampup_cycles++;
         // Set another period
-        Thermostat[ctr_output].time_rampup_nextcycle = uptime + ((uint32_t)Thermostat[ctr_output].time_rampup_cycle * 60);
+        Thermostat[ctr_output].time_rampup_nextcycle = ThermostatClock.seconds + ((uint32_t)Thermostat[ctr_output].time_rampup_cycle * 60);
         // Reset time_ctr_changepoint and temp_rampup_output_off
-        Thermostat[ctr_output].time_ctr_changepoint = uptime + (60 * (uint32_t)Thermostat[ctr_output].time_rampup_max) - time_in_rampup;
+        ThermostatSetChangepoint(ctr_output, (60 * (uint32_t)Thermostat[ctr_output].time_rampup_max) - time_in_rampup);
         Thermostat[ctr_output].temp_rampup_output_off =  Thermostat[ctr_output].temp_target_level_ctr;
       }
       // Set time to get out of ramp-up
@@ -927,7 +991,7 @@ void ThermostatWorkAutomaticRampUp(uint8_t ctr_output)
     // or gradient is <= 0 for heating of >= 0 for cooling
     if ((Thermostat[ctr_output].time_rampup_deadtime == 0)
       || (Thermostat[ctr_output].time_ctr_checkpoint == 0)
-      || (uptime < Thermostat[ctr_output].time_ctr_changepoint)
+      || (ThermostatClock.seconds < Thermostat[ctr_output].time_ctr_changepoint)
       || (  ((Thermostat[ctr_output].temp_measured < Thermostat[ctr_output].temp_rampup_output_off)
           && (flag_heating))
         ||  ((Thermostat[ctr_output].temp_measured > Thermostat[ctr_output].temp_rampup_output_off)
@@ -951,7 +1015,7 @@ void ThermostatWorkAutomaticRampUp(uint8_t ctr_output)
       Thermostat[ctr_output].temp_pi_accum_error = Thermostat[ctr_output].temp_rampup_pi_acc_error;
     }
     // Set to now time to get out of ramp-up
-    Thermostat[ctr_output].time_ctr_checkpoint = uptime;
+    Thermostat[ctr_output].time_ctr_checkpoint = ThermostatClock.seconds;
     // Switch Off output
     Thermostat[ctr_output].status.command_output = IFACE_OFF;
   }
@@ -971,7 +1035,7 @@ void ThermostatPeakDetectorInit(uint8_t ctr_output)
   Thermostat[ctr_output].peak_ctr = 0; 
   Thermostat[ctr_output].temp_abs_max_atune = 0;
   Thermostat[ctr_output].temp_abs_min_atune = 100;
-  Thermostat[ctr_output].time_ctr_checkpoint = uptime + THERMOSTAT_TIME_MAX_AUTOTUNE;
+  Thermostat[ctr_output].time_ctr_checkpoint = ThermostatClock.seconds + THERMOSTAT_TIME_MAX_AUTOTUNE;
 }
 
 void ThermostatPeakDetector(uint8_t ctr_output)
@@ -1020,7 +1084,7 @@ void ThermostatPeakDetector(uint8_t ctr_output)
       if ( (cond_peak_2)
         && (abs(Thermostat[ctr_output].temp_measured - Thermostat[ctr_output].temp_peaks_atune[peak_num]) > Thermostat[ctr_output].temp_band_no_peak_det)) {
         // Register peak timestamp;
-        Thermostat[ctr_output].time_peak_timestamps_atune[peak_num] = (uptime / 60); 
+        Thermostat[ctr_output].time_peak_timestamps_atune[peak_num] = (ThermostatClock.seconds / 60); 
         Thermostat[ctr_output].peak_ctr++;
         peak_transition = true;
       }
@@ -1040,7 +1104,7 @@ void ThermostatPeakDetector(uint8_t ctr_output)
         && (abs(Thermostat[ctr_output].temp_measured - Thermostat[ctr_output].temp_peaks_atune[peak_num]) > Thermostat[ctr_output].temp_band_no_peak_det)) {
         // Calculate period 
         // Register peak timestamp;
-        Thermostat[ctr_output].time_peak_timestamps_atune[peak_num] = (uptime / 60); 
+        Thermostat[ctr_output].time_peak_timestamps_atune[peak_num] = (ThermostatClock.seconds / 60); 
         Thermostat[ctr_output].peak_ctr++;
         peak_transition = true;
       }
@@ -1117,17 +1181,17 @@ void ThermostatWorkAutomaticPIAutotune(uint8_t ctr_output)
   bool flag_heating = (Thermostat[ctr_output].status.climate_mode == CLIMATE_HEATING);
   // If no timeout of the PI Autotune function
   // AND no change in setpoint
-  if ((uptime < Thermostat[ctr_output].time_ctr_checkpoint)
+  if ((ThermostatClock.seconds < Thermostat[ctr_output].time_ctr_checkpoint)
     &&(Thermostat[ctr_output].temp_target_level_ctr == Thermostat[ctr_output].temp_target_level)) {
-    if (uptime >= Thermostat[ctr_output].time_ctr_checkpoint) {
+    if (ThermostatClock.seconds >= Thermostat[ctr_output].time_ctr_checkpoint) {
       Thermostat[ctr_output].temp_target_level_ctr = Thermostat[ctr_output].temp_target_level;    
       // Calculate time_ctr_changepoint
-      Thermostat[ctr_output].time_ctr_changepoint = uptime + (((uint32_t)Thermostat[ctr_output].time_pi_cycle * (uint32_t)Thermostat[ctr_output].dutycycle_step_autotune) / (uint32_t)100);
+      ThermostatSetChangepoint(ctr_output, (((uint32_t)Thermostat[ctr_output].time_pi_cycle * (uint32_t)Thermostat[ctr_output].dutycycle_step_autotune) / (uint32_t)100));
       // Reset cycle active
       Thermostat[ctr_output].status.status_cycle_active = CYCLE_OFF;
     }
     // Set Output On/Off depending on the changepoint
-    if (uptime < Thermostat[ctr_output].time_ctr_changepoint) {
+    if (ThermostatClock.seconds < Thermostat[ctr_output].time_ctr_changepoint) {
       Thermostat[ctr_output].status.status_cycle_active = CYCLE_ON;
       Thermostat[ctr_output].status.command_output = IFACE_ON;
     }
@@ -1274,8 +1338,8 @@ void ThermostatDebug(uint8_t ctr_output)
   char result_chr[FLOATSZ];
   AddLog_P2(LOG_LEVEL_DEBUG, PSTR(""));
   AddLog_P2(LOG_LEVEL_DEBUG, PSTR("------ Thermostat Start ------"));
-  dtostrfd(Thermostat[ctr_output].status.counter_seconds, 0, result_chr);
-  AddLog_P2(LOG_LEVEL_DEBUG, PSTR("Thermostat[ctr_output].status.counter_seconds: %s"), result_chr);
+  dtostrfd(Thermostat[ctr_output].time_ctr_next, 0, result_chr);
+  AddLog_P2(LOG_LEVEL_DEBUG, PSTR("Thermostat[ctr_output].time_ctr_next: %s"), result_chr);
   dtostrfd(Thermostat[ctr_output].status.thermostat_mode, 0, result_chr);
   AddLog_P2(LOG_LEVEL_DEBUG, PSTR("Thermostat[ctr_output].status.thermostat_mode: %s"), result_chr);
   dtostrfd(Thermostat[ctr_output].diag.state_emergency, 0, result_chr);
@@ -1318,7 +1382,7 @@ void ThermostatDebug(uint8_t ctr_output)
   AddLog_P2(LOG_LEVEL_DEBUG, PSTR("Thermostat[ctr_output].temp_rampup_output_off: %s"), result_chr);
   dtostrfd(Thermostat[ctr_output].time_ctr_checkpoint, 0, result_chr);
   AddLog_P2(LOG_LEVEL_DEBUG, PSTR("Thermostat[ctr_output].time_ctr_checkpoint: %s"), result_chr);
-  dtostrfd(uptime, 0, result_chr);
+  dtostrfd(ThermostatClock.seconds, 0, result_chr);
   AddLog_P2(LOG_LEVEL_DEBUG, PSTR("uptime: %s"), result_chr);
   dtostrfd(power, 0, result_chr);
   AddLog_P2(LOG_LEVEL_DEBUG, PSTR("power: %s"), result_chr);
@@ -1327,28 +1391,33 @@ void ThermostatDebug(uint8_t ctr_output)
 }
 #endif // DEBUG_THERMOSTAT
 
-void ThermostatGetLocalSensor(uint8_t ctr_output) {
-  DynamicJsonBuffer jsonBuffer;
-  JsonObject& root = jsonBuffer.parseObject((const char*)mqtt_data);
-  if (root.success()) {
-    const char* value_c = root["THERMOSTAT_SENSOR_NAME"]["Temperature"];
-    if (value_c != NULL && strlen(value_c) > 0 && (isdigit(value_c[0]) || (value_c[0] == '-' && isdigit(value_c[1])) ) ) {
-      int16_t value = (int16_t)(CharToFloat(value_c) * 10);
-      if ( (value >= -1000) 
-        && (value <= 1000)
-        && (Thermostat[ctr_output].status.sensor_type == SENSOR_LOCAL)) {
-        uint32_t timestamp = uptime;
-        // Calculate temperature gradient if temperature value has changed
-        if (value != Thermostat[ctr_output].temp_measured) {
-          int32_t temp_delta = (value - Thermostat[ctr_output].temp_measured); // in tenths of degrees
-          uint32_t time_delta = (timestamp - Thermostat[ctr_output].timestamp_temp_meas_change_update); // in seconds
-          Thermostat[ctr_output].temp_measured_gradient = (int32_t)((360000 * temp_delta) / ((int32_t)time_delta)); // thousandths of degrees per hour
-          Thermostat[ctr_output].temp_measured = value;
-          Thermostat[ctr_output].timestamp_temp_meas_change_update = timestamp;
-        }
-        Thermostat[ctr_output].timestamp_temp_measured_update = timestamp;
-        Thermostat[ctr_output].status.sensor_alive = IFACE_ON;
-      }
+void ThermostatTempMeasured(uint8_t ctr_output, int16_t value)
+{
+  // Value unit is tenths of degrees celsius
+  if ((value < -1000) || (value > 1000)) { return; }
+  uint32_t timestamp = ThermostatClock.seconds;
+  // Calculate temperature gradient if temperature value has changed
+  if (value != Thermostat[ctr_output].temp_measured) {
+    int32_t temp_delta = (value - Thermostat[ctr_output].temp_measured); // in tenths of degrees
+    uint32_t time_delta = (timestamp - Thermostat[ctr_output].timestamp_temp_meas_change_update); // in seconds
+    if (time_delta > 0) {
+      Thermostat[ctr_output].temp_measured_gradient = (int32_t)((360000 * temp_delta) / ((int32_t)time_delta)); // thousandths of degrees per hour
+    }
+    Thermostat[ctr_output].temp_measured = value;
+    Thermostat[ctr_output].timestamp_temp_meas_change_update = timestamp;
+  }
+  Thermostat[ctr_output].timestamp_temp_measured_update = timestamp;
+  Thermostat[ctr_output].status.sensor_alive = IFACE_ON;
+}
+
+void ThermostatSensorReading(uint32_t sensor, float celsius)
+{
+  // New reading of local temperature sensor number sensor, called by the sensor driver
+  int16_t value = (int16_t)(celsius * 10);
+  for (uint32_t ctr_output = 0; ctr_output < THERMOSTAT_CONTROLLER_OUTPUTS; ctr_output++) {
+    if ((Thermostat[ctr_output].status.sensor_type == SENSOR_LOCAL)
+      && (Thermostat[ctr_output].temp_sens_number == sensor)) {
+      ThermostatTempMeasured(ctr_output, value);
     }
   }
 }
@@ -1381,7 +1450,7 @@ void CmndClimateModeSet(void)
       if ((value >= CLIMATE_HEATING) && (value < CLIMATE_MODES_MAX)) {
         Thermostat[ctr_output].status.climate_mode = value;
         // Trigger a restart of the controller
-        Thermostat[ctr_output].time_ctr_checkpoint = uptime;
+        Thermostat[ctr_output].time_ctr_checkpoint = ThermostatClock.seconds;
       }
     }
     ResponseCmndNumber((int)Thermostat[ctr_output].status.climate_mode);
@@ -1424,7 +1493,7 @@ void CmndControllerModeSet(void)
       if ((value >= CTR_HYBRID) && (value < CTR_MODES_MAX)) {
         Thermostat[ctr_output].status.controller_mode = value;
         // Reset controller variables
-        Thermostat[ctr_output].timestamp_rampup_start = uptime;
+        Thermostat[ctr_output].timestamp_rampup_start = ThermostatClock.seconds;
         Thermostat[ctr_output].temp_rampup_start = Thermostat[ctr_output].temp_measured;
         Thermostat[ctr_output].temp_rampup_meas_gradient = 0;
         Thermostat[ctr_output].time_rampup_deadtime = 0;
@@ -1445,7 +1514,7 @@ void CmndInputSwitchSet(void)
       uint8_t value = (uint8_t)(XdrvMailbox.payload);
       if (ThermostatSwitchIdValid(value)) {
         Thermostat[ctr_output].status.input_switch_number = value;
-        Thermostat[ctr_output].timestamp_input_on = uptime;
+        Thermostat[ctr_output].timestamp_input_on = ThermostatClock.seconds;
       }
     }
     ResponseCmndNumber((int)Thermostat[ctr_output].status.input_switch_number);
@@ -1531,20 +1600,8 @@ void CmndTempMeasuredSet(void)
       else {
         value = (int16_t)(CharToFloat(XdrvMailbox.data) * 10);
       }
-      if ( (value >= -1000) 
-        && (value <= 1000)
-        && (Thermostat[ctr_output].status.sensor_type == SENSOR_MQTT)) {
-        uint32_t timestamp = uptime;
-        // Calculate temperature gradient if temperature value has changed
-        if (value != Thermostat[ctr_output].temp_measured) {
-          int32_t temp_delta = (value - Thermostat[ctr_output].temp_measured); // in tenths of degrees
-          uint32_t time_delta = (timestamp - Thermostat[ctr_output].timestamp_temp_meas_change_update); // in seconds
-          Thermostat[ctr_output].temp_measured_gradient = (int32_t)((360000 * temp_delta) / ((int32_t)time_delta)); // thousandths of degrees per hour
-          Thermostat[ctr_output].temp_measured = value;
-          Thermostat[ctr_output].timestamp_temp_meas_change_update = timestamp;
-        }
-        Thermostat[ctr_output].timestamp_temp_measured_update = timestamp;
-        Thermostat[ctr_output].status.sensor_alive = IFACE_ON;
+      if (Thermostat[ctr_output].status.sensor_type == SENSOR_MQTT) {
+        ThermostatTempMeasured(ctr_output, value);
       }
     }
     if (Thermostat[ctr_output].status.temp_format == TEMP_FAHRENHEIT) {
@@ -1973,6 +2030,20 @@ void CmndEnableOutputSet(void)
   }
 }
 
+void CmndTempSensNumberSet(void)
+{
+  if ((XdrvMailbox.index > 0) && (XdrvMailbox.index <= THERMOSTAT_CONTROLLER_OUTPUTS)) {
+    uint8_t ctr_output = XdrvMailbox.index - 1;
+    if (XdrvMailbox.data_len > 0) {
+      uint8_t value = (uint8_t)(XdrvMailbox.payload);
+      if ((value > 0) && (value <= THERMOSTAT_TEMP_SENS_MAX)) {
+        Thermostat[ctr_output].temp_sens_number = value;
+      }
+    }
+    ResponseCmndNumber((int)Thermostat[ctr_output].temp_sens_number);
+  }
+}
+
 /*********************************************************************************************\
  * Interface
 \*********************************************************************************************/
@@ -1984,39 +2055,33 @@ bool Xdrv39(uint8_t function)
 
   switch (function) {
     case FUNC_INIT:
+      ThermostatClock.last_millis = millis();
       for (ctr_output = 0; ctr_output < THERMOSTAT_CONTROLLER_OUTPUTS; ctr_output++) {
         ThermostatInit(ctr_output);
       }
+      XdrvSubscribe(FUNC_LOOP);
       break;
     case FUNC_LOOP:
+      ThermostatClockUpdate();
       for (ctr_output = 0; ctr_output < THERMOSTAT_CONTROLLER_OUTPUTS; ctr_output++) {
+        bool cycle = ThermostatMinuteCounter(ctr_output);
         if (Thermostat[ctr_output].status.thermostat_mode != THERMOSTAT_OFF) {
           ThermostatSignalProcessingFast(ctr_output);
           ThermostatDiagnostics(ctr_output);
-        }
-      }
-      break;
-    case FUNC_SERIAL:
-      break;
-    case FUNC_EVERY_SECOND:
-      for (ctr_output = 0; ctr_output < THERMOSTAT_CONTROLLER_OUTPUTS; ctr_output++) {
-        if ((ThermostatMinuteCounter(ctr_output))
-          && (Thermostat[ctr_output].status.thermostat_mode != THERMOSTAT_OFF)) {
-          ThermostatSignalPreProcessingSlow(ctr_output);
-          ThermostatController(ctr_output);
-          ThermostatSignalPostProcessingSlow(ctr_output);
+          if (cycle) {
+            ThermostatSignalPreProcessingSlow(ctr_output);
+            ThermostatController(ctr_output);
+            ThermostatSignalPostProcessingSlow(ctr_output);
 #ifdef DEBUG_THERMOSTAT
-          ThermostatDebug(ctr_output);
+            ThermostatDebug(ctr_output);
 #endif // DEBUG_THERMOSTAT
+          } else {
+            ThermostatOutputTimer(ctr_output);
+          }
         }
       }
       break;
-    case FUNC_SHOW_SENSOR:
-      for (ctr_output = 0; ctr_output < THERMOSTAT_CONTROLLER_OUTPUTS; ctr_output++) {
-        if (Thermostat[ctr_output].status.thermostat_mode != THERMOSTAT_OFF) {
-          ThermostatGetLocalSensor(ctr_output);
-        }
-      }
+    case FUNC_SERIAL:
       break;
     case FUNC_COMMAND:
       result = DecodeCommand(kThermostatCommands, ThermostatCommand);
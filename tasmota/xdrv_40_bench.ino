@@ -0,0 +1,225 @@
+/*
+  xdrv_40_bench.ino - standard load benchmark for Tasmota
+
+  Copyright (C) 2020  Theo Arends
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef USE_BENCH
+/*********************************************************************************************\
+ * Standard load benchmark to compare releases on identical hardware
+ *
+ * Runs a mix of workloads for a number of seconds:
+ * - commands per second executed by ExecuteCommand() as if received by MQTT
+ * - a full teleperiod every number of seconds polling all sensors
+ * - web root sensor refreshes per second as requested by /?m=1
+ * - rule events per second {"Bench":{"Count":n}} evaluated by all enabled rules
+ *
+ * A workload runs at most once per loop so an overloaded device shows a lower achieved count.
+ * The result reports loop time percentiles (with USE_LOOP_STATS over the last minute), the
+ * free heap trend and MQTT publishes per second.
+ *
+ * BenchLoad 60,10,10,2,20 - Run 60 seconds doing 10 commands/s, a teleperiod every 10 seconds,
+ *                           2 web refreshes/s and 20 rule events/s
+ * BenchLoad               - Show progress or last result
+ * BenchLoad 0             - Stop
+\*********************************************************************************************/
+
+#define XDRV_40                    40
+
+#ifndef BENCH_COMMAND
+#define BENCH_COMMAND              "State"  // Command executed by the command workload
+#endif
+
+const uint16_t BENCH_MAX_SECONDS = 3600;
+const uint8_t BENCH_MAX_RATE = 100;         // Max runs per second of a workload
+
+const char kBenchCommands[] PROGMEM = "|"  // No prefix
+  D_CMND_BENCHLOAD;
+
+void (* const BenchCommand[])(void) PROGMEM = {
+  &CmndBenchLoad };
+
+enum BenchWorkloads { BENCH_COMMANDS, BENCH_WEB, BENCH_RULES, BENCH_WORKLOADS };
+
+struct {
+  uint32_t start;                           // millis() of the start
+  uint32_t duration;                        // ms
+  uint32_t elapsed;                         // ms run so far
+  uint32_t rate[BENCH_WORKLOADS];           // Requested runs per second
+  uint32_t count[BENCH_WORKLOADS];          // Runs done
+  uint32_t tele_interval;                   // Seconds between teleperiods
+  uint32_t teleperiods;
+  uint32_t loops;
+  uint32_t publish_start;                   // Mqtt.publish_count at start
+  uint32_t publishes;
+  uint32_t web_bytes;
+  uint32_t heap_start;
+  uint32_t heap_min;
+  uint32_t heap_end;
+  bool active = false;
+} Bench;
+
+void BenchRun(uint32_t workload)
+{
+  switch (workload) {
+    case BENCH_COMMANDS: {
+      char command[] = BENCH_COMMAND;
+      ExecuteCommand(command, SRC_IGNORE);
+      break;
+    }
+#ifdef USE_WEBSERVER
+    case BENCH_WEB: {
+      String page;
+      String *capture = Web.capture;
+      Web.capture = &page;
+      SensorSnapshotInvalidate();           // Poll all sensors as a refresh after their update would
+      WebRootStatus();
+      Web.capture = capture;
+      Bench.web_bytes += page.length();
+      break;
+    }
+#endif  // USE_WEBSERVER
+#ifdef USE_RULES
+    case BENCH_RULES: {
+      char event[40];
+      snprintf_P(event, sizeof(event), PSTR("{\"Bench\":{\"Count\":%d}}"), Bench.count[BENCH_RULES]);
+      RulesProcessEvent(event);
+      break;
+    }
+#endif  // USE_RULES
+  }
+}
+
+void BenchHeap(void)
+{
+  uint32_t heap = ESP.getFreeHeap();
+  if (heap < Bench.heap_min) { Bench.heap_min = heap; }
+  Bench.heap_end = heap;
+}
+
+void BenchStop(void)
+{
+  Bench.active = false;
+  BenchHeap();
+  Bench.publishes = Mqtt.publish_count - Bench.publish_start;
+}
+
+void BenchLoop(void)
+{
+  if (!Bench.active) { return; }
+
+  Bench.loops++;
+  Bench.elapsed = millis() - Bench.start;
+  for (uint32_t i = 0; i < BENCH_WORKLOADS; i++) {
+    if (Bench.count[i] < Bench.elapsed * Bench.rate[i] / 1000) {
+      BenchRun(i);
+      Bench.count[i]++;
+    }
+  }
+  if (Bench.tele_interval && (Bench.teleperiods < Bench.elapsed / (Bench.tele_interval * 1000))) {
+    Bench.teleperiods++;
+    SensorSnapshotInvalidate();
+    MqttPublishTeleperiod();
+  }
+
+  if (Bench.elapsed >= Bench.duration) {
+    Bench.elapsed = Bench.duration;
+    BenchStop();
+    BenchShow();
+    MqttPublishPrefixTopic_P(RESULT_OR_STAT, PSTR(D_CMND_BENCHLOAD));
+  }
+}
+
+void BenchShow(void)
+{
+  uint32_t seconds = Bench.elapsed / 1000;
+  uint32_t publishes = (Bench.active) ? Mqtt.publish_count - Bench.publish_start : Bench.publishes;
+  char rate[16];
+  dtostrfd((Bench.elapsed) ? (float)publishes * 1000 / Bench.elapsed : 0, 1, rate);
+
+  Response_P(PSTR("{\"" D_CMND_BENCHLOAD "\":{\"State\":\"%s\",\"Time\":%d,\"Loops\":%d,\"Commands\":%d,\"Teleperiods\":%d,\"Web\":%d,\"WebBytes\":%d,\"Rules\":%d"),
+    (Bench.active) ? "Running" : "Done", seconds, Bench.loops,
+    Bench.count[BENCH_COMMANDS], Bench.teleperiods, Bench.count[BENCH_WEB], Bench.web_bytes, Bench.count[BENCH_RULES]);
+#ifdef USE_LOOP_STATS
+  LOOP_STATS_SUMMARY summary;
+  LoopStatsSummary(&summary);
+  ResponseAppend_P(PSTR(",\"P50\":%d,\"P99\":%d,\"Max\":%d"), summary.p50, summary.p99, summary.max);
+#endif  // USE_LOOP_STATS
+  // Heap trend in bytes per minute, negative when heap is lost
+  int32_t trend = (seconds) ? ((int32_t)Bench.heap_end - (int32_t)Bench.heap_start) * 60 / (int32_t)seconds : 0;
+  ResponseAppend_P(PSTR(",\"HeapStart\":%d,\"HeapMin\":%d,\"HeapEnd\":%d,\"HeapTrend\":%d,\"Publishes\":%d,\"PublishRate\":%s}}"),
+    Bench.heap_start, Bench.heap_min, Bench.heap_end, trend, publishes, rate);
+}
+
+void CmndBenchLoad(void)
+{
+  // BenchLoad <seconds>,<commands/s>,<teleperiod seconds>,<web refreshes/s>,<rule events/s>
+  if (XdrvMailbox.data_len > 0) {
+    char *p = XdrvMailbox.data;
+    uint32_t value[5] = { 0 };
+    for (uint32_t i = 0; i < 5; i++) {
+      value[i] = strtoul(p, &p, 10);
+      if (*p != ',') { break; }
+      p++;
+    }
+    if (Bench.active) { BenchStop(); }
+    if (value[0]) {
+      memset(&Bench, 0, sizeof(Bench));
+      Bench.duration = tmin(value[0], BENCH_MAX_SECONDS) * 1000;
+      Bench.rate[BENCH_COMMANDS] = tmin(value[1], BENCH_MAX_RATE);
+      Bench.tele_interval = value[2];
+      Bench.rate[BENCH_WEB] = tmin(value[3], BENCH_MAX_RATE);
+      Bench.rate[BENCH_RULES] = tmin(value[4], BENCH_MAX_RATE);
+      Bench.heap_start = ESP.getFreeHeap();
+      Bench.heap_min = Bench.heap_start;
+      Bench.heap_end = Bench.heap_start;
+      Bench.publish_start = Mqtt.publish_count;
+#ifdef USE_LOOP_STATS
+      LoopStatsReset();
+#endif  // USE_LOOP_STATS
+      Bench.start = millis();
+      Bench.active = true;
+    }
+  }
+  BenchShow();
+}
+
+/*********************************************************************************************\
+ * Interface
+\*********************************************************************************************/
+
+bool Xdrv40(uint8_t function)
+{
+  bool result = false;
+
+  switch (function) {
+    case FUNC_PRE_INIT:
+      XdrvSubscribe(FUNC_LOOP);
+      break;
+    case FUNC_LOOP:
+      BenchLoop();
+      break;
+    case FUNC_EVERY_SECOND:
+      if (Bench.active) { BenchHeap(); }
+      break;
+    case FUNC_COMMAND:
+      result = DecodeCommand(kBenchCommands, BenchCommand);
+      break;
+  }
+  return result;
+}
+
+#endif  // USE_BENCH
@@ -0,0 +1,165 @@
+/*
+  xdrv_41_trace.ino - event tracing ring buffer for Tasmota
+
+  Copyright (C) 2020  Theo Arends
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef USE_TRACE
+/*********************************************************************************************\
+ * Event tracing
+ *
+ * TRACE_EVENT() stores an 8 byte entry of micros(), event, phase and argument in a RAM ring of
+ * TRACE_SIZE entries. Traced are driver and sensor calls, MqttPublish, AddLog, SettingsSave,
+ * WiFi and MQTT state changes and settings and journal flash erase and write.
+ *
+ * Web page /trace downloads the ring as Chrome trace JSON for chrome://tracing or Perfetto.
+ *
+ * Trace 0 - Stop tracing
+ * Trace 1 - Trace all but FUNC_LOOP calls which fill the ring within a few loops (default)
+ * Trace 2 - Trace all including FUNC_LOOP calls
+ * Trace   - Show state and number of entries
+\*********************************************************************************************/
+
+#define XDRV_41                    41
+
+#ifndef TRACE_SIZE
+#define TRACE_SIZE                 512      // Number of ring entries of 8 bytes
+#endif
+
+const char kTraceCommands[] PROGMEM = "|"  // No prefix
+  D_CMND_TRACE;
+
+void (* const TraceCommand[])(void) PROGMEM = {
+  &CmndTrace };
+
+const char kTraceEventNames[] PROGMEM = "Driver|Sensor|MqttPublish|Log|SettingsSave|WiFi|Mqtt|FlashErase|FlashWrite";
+
+struct TRACE_ENTRY {
+  uint32_t time;                            // micros()
+  uint16_t arg;
+  uint8_t event;
+  uint8_t phase;
+};
+
+struct {
+  TRACE_ENTRY entry[TRACE_SIZE];
+  uint16_t head = 0;                        // Next entry to write
+  uint16_t count = 0;
+  uint8_t mode = 1;
+} Trace;
+
+void TraceAdd(uint32_t event, uint32_t phase, uint32_t arg)
+{
+  if (!Trace.mode) { return; }
+  if ((1 == Trace.mode) && (event <= TRACE_SENSOR) && ((arg & 0xFF) == FUNC_LOOP)) { return; }
+
+  TRACE_ENTRY *entry = &Trace.entry[Trace.head];
+  entry->time = micros();
+  entry->arg = arg;
+  entry->event = event;
+  entry->phase = phase;
+  Trace.head = (Trace.head +1) % TRACE_SIZE;
+  if (Trace.count < TRACE_SIZE) { Trace.count++; }
+}
+
+uint32_t TraceName(char *name, uint32_t size, uint32_t event, uint32_t arg)
+{
+  // Returns the argument shown with the event name
+  if (event <= TRACE_SENSOR) {
+    // Argument is index << 8 | function, named by driver or sensor id as used in Profile and LoopStats
+    uint32_t id = (TRACE_DRIVER == event) ? XdrvId(arg >> 8) : XsnsId(arg >> 8);
+    snprintf_P(name, size, PSTR("%s%d"), (TRACE_DRIVER == event) ? "Xdrv" : "Xsns", id);
+    return arg & 0xFF;
+  }
+  GetTextIndexed(name, size, event, kTraceEventNames);
+  return arg;
+}
+
+uint32_t TraceLast(uint32_t *dest, uint32_t count)
+{
+  // Copy the last count entries oldest first as two words each for the crash recorder, returns entries copied
+  if (count > Trace.count) { count = Trace.count; }
+  uint32_t first = (Trace.head + TRACE_SIZE - count) % TRACE_SIZE;
+  for (uint32_t i = 0; i < count; i++) {
+    memcpy(dest + i * 2, &Trace.entry[(first + i) % TRACE_SIZE], sizeof(TRACE_ENTRY));
+  }
+  return count;
+}
+
+#ifdef USE_WEBSERVER
+void HandleTrace(void)
+{
+  if (!HttpCheckPriviledgedAccess()) { return; }
+
+  AddLog_P(LOG_LEVEL_DEBUG, S_LOG_HTTP, PSTR("Trace"));
+
+  uint32_t mode = Trace.mode;
+  Trace.mode = 0;                           // Keep the ring unchanged while sending
+
+  Webserver->sendHeader(F("Content-Disposition"), F("attachment; filename=trace.json"));
+  WSContentBegin(200, CT_JSON);
+  WSContentSend_P(PSTR("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+  uint32_t first = (Trace.head + TRACE_SIZE - Trace.count) % TRACE_SIZE;
+  uint32_t start = Trace.entry[first].time;
+  char name[24];
+  for (uint32_t i = 0; i < Trace.count; i++) {
+    TRACE_ENTRY *entry = &Trace.entry[(first + i) % TRACE_SIZE];
+    uint32_t arg = TraceName(name, sizeof(name), entry->event, entry->arg);
+    WSContentSend_P(PSTR("%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%u,\"pid\":1,\"tid\":1,\"args\":{\"arg\":%d}}"),
+      (i) ? "," : "", name, (TRACE_BEGIN == entry->phase) ? "B" : (TRACE_END == entry->phase) ? "E" : "i\",\"s\":\"t",
+      entry->time - start, arg);
+  }
+  WSContentSend_P(PSTR("]}"));
+  WSContentEnd();
+
+  Trace.mode = mode;
+}
+#endif  // USE_WEBSERVER
+
+void CmndTrace(void)
+{
+  if ((XdrvMailbox.payload >= 0) && (XdrvMailbox.payload <= 2)) {
+    Trace.mode = XdrvMailbox.payload;
+    if (Trace.mode) {
+      Trace.head = 0;
+      Trace.count = 0;
+    }
+  }
+  Response_P(PSTR("{\"" D_CMND_TRACE "\":{\"Mode\":%d,\"Entries\":%d,\"Size\":%d}}"), Trace.mode, Trace.count, TRACE_SIZE);
+}
+
+/*********************************************************************************************\
+ * Interface
+\*********************************************************************************************/
+
+bool Xdrv41(uint8_t function)
+{
+  bool result = false;
+
+  switch (function) {
+#ifdef USE_WEBSERVER
+    case FUNC_WEB_ADD_HANDLER:
+      Webserver->on("/trace", HandleTrace);
+      break;
+#endif  // USE_WEBSERVER
+    case FUNC_COMMAND:
+      result = DecodeCommand(kTraceCommands, TraceCommand);
+      break;
+  }
+  return result;
+}
+
+#endif  // USE_TRACE
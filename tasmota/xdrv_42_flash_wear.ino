@@ -0,0 +1,259 @@
+/*
+  xdrv_42_flash_wear.ino - flash write accounting and endurance report for Tasmota
+
+  Copyright (C) 2020  Theo Arends
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef USE_FLASH_WEAR
+/*********************************************************************************************\
+ * Flash wear accounting
+ *
+ * FLASH_WEAR() counts sectors erased and bytes written per area: settings including the Quick
+ * Power Cycle flag, Zigbee device store, FLOG, energy journal and the scripter file system.
+ * File systems and ESP32 NVS level wear themselves so FLASH_WEAR_LEVELED() estimates one erase
+ * per SPI_FLASH_SEC_SIZE bytes written.
+ *
+ * Counts since the last settings save are kept in RTC memory surviving a restart and are added
+ * to the totals in Settings by the next settings save so the accounting never causes a save.
+ *
+ * Wear is the average number of erase cycles per sector of an area as a percentage of
+ * FLASH_WEAR_ENDURANCE. A warning is logged once a day when more sectors are erased since
+ * midnight (or within 24 hours of uptime without valid time) than the budget allows.
+ *
+ * FlashWear     - Show counters, wear and sectors erased today (also in Status 4)
+ * FlashWear 200 - Set the budget of sectors erased per day
+ * FlashWear 0   - Restore the default budget of FLASH_WEAR_BUDGET sectors per day
+\*********************************************************************************************/
+
+#define XDRV_42                    42
+
+#ifndef FLASH_WEAR_BUDGET
+#define FLASH_WEAR_BUDGET          100      // Sectors erased per day before warning
+#endif
+#ifndef FLASH_WEAR_ENDURANCE
+#define FLASH_WEAR_ENDURANCE       100000   // Erase cycles per sector of common SPI NOR flash
+#endif
+
+const uint32_t FLASH_WEAR_MAGIC = 0x464C5731;  // FLW1
+const uint32_t FLASH_WEAR_RTC = 88;            // RTC memory block offset just after the MQTT TLS session
+
+const char kFlashWearCommands[] PROGMEM = "|"  // No prefix
+  D_CMND_FLASHWEAR;
+
+void (* const FlashWearCommand[])(void) PROGMEM = {
+  &CmndFlashWear };
+
+const char kFlashWearAreas[] PROGMEM = "Settings|Zigbee|Flog|Energy|Script";
+
+struct FLASH_WEAR_RTC_DATA {
+  uint32_t magic;
+  uint16_t erased[WEAR_AREAS];              // Sectors erased since the last settings save
+  uint16_t kbytes[WEAR_AREAS];              // kB written since the last settings save
+};
+
+#ifdef ESP32
+RTC_NOINIT_ATTR FLASH_WEAR_RTC_DATA FlashWearRtcData;
+#endif
+
+struct {
+  FLASH_WEAR_RTC_DATA rtc;
+  uint32_t bytes[WEAR_AREAS];               // Bytes written not yet counted in kbytes
+  uint32_t leveled[WEAR_AREAS];             // Bytes written to wear leveled stores not yet counted as an erase
+  uint16_t sectors[WEAR_AREAS];             // Sectors an area rotates over, 0 if one
+  uint32_t day_start;                       // Total sectors erased at the start of the day
+  uint32_t day_uptime;                      // Uptime at the start of the day
+  uint16_t day = 0;                         // Day of year or 0 if time is not valid
+  bool warned = false;
+  bool loaded = false;
+} FlashWear;
+
+void FlashWearRtcSave(void)
+{
+#ifdef ESP8266
+  ESP.rtcUserMemoryWrite(FLASH_WEAR_RTC, (uint32_t*)&FlashWear.rtc, sizeof(FlashWear.rtc));
+#else
+  FlashWearRtcData = FlashWear.rtc;
+#endif
+}
+
+void FlashWearLoad(void)
+{
+  // Loaded on first use as settings may be saved before the drivers are initialized
+  if (FlashWear.loaded) { return; }
+  FlashWear.loaded = true;
+
+#ifdef ESP8266
+  ESP.rtcUserMemoryRead(FLASH_WEAR_RTC, (uint32_t*)&FlashWear.rtc, sizeof(FlashWear.rtc));
+#else
+  FlashWear.rtc = FlashWearRtcData;
+#endif
+  if (FlashWear.rtc.magic != FLASH_WEAR_MAGIC) {
+    memset(&FlashWear.rtc, 0, sizeof(FlashWear.rtc));
+    FlashWear.rtc.magic = FLASH_WEAR_MAGIC;
+    FlashWearRtcSave();
+  }
+  FlashWear.day_start = FlashWearErased();
+}
+
+void FlashWearAdd(uint32_t area, uint32_t sectors, uint32_t bytes)
+{
+  FlashWearLoad();
+  uint32_t erased = FlashWear.rtc.erased[area] + sectors;
+  FlashWear.rtc.erased[area] = tmin(erased, 0xFFFF);
+  FlashWear.bytes[area] += bytes;
+  uint32_t kbytes = FlashWear.rtc.kbytes[area] + FlashWear.bytes[area] / 1024;
+  FlashWear.rtc.kbytes[area] = tmin(kbytes, 0xFFFF);
+  FlashWear.bytes[area] %= 1024;
+  FlashWearRtcSave();
+}
+
+void FlashWearLeveled(uint32_t area, uint32_t bytes)
+{
+  FlashWear.leveled[area] += bytes;
+  uint32_t sectors = FlashWear.leveled[area] / SPI_FLASH_SEC_SIZE;
+  FlashWear.leveled[area] %= SPI_FLASH_SEC_SIZE;
+  FlashWearAdd(area, sectors, bytes);
+}
+
+void FlashWearRegion(uint32_t area, uint32_t sectors)
+{
+  FlashWear.sectors[area] = sectors;
+}
+
+void FlashWearFold(void)
+{
+  // Called by SettingsSave() just before writing so the counts are saved with the settings
+  FlashWearLoad();
+  for (uint32_t i = 0; i < WEAR_AREAS; i++) {
+    Settings.flash_wear_erased[i] += FlashWear.rtc.erased[i];
+    Settings.flash_wear_kbytes[i] += FlashWear.rtc.kbytes[i];
+    FlashWear.rtc.erased[i] = 0;
+    FlashWear.rtc.kbytes[i] = 0;
+  }
+  FlashWearRtcSave();
+}
+
+uint32_t FlashWearErased(void)
+{
+  uint32_t erased = 0;
+  for (uint32_t i = 0; i < WEAR_AREAS; i++) {
+    erased += Settings.flash_wear_erased[i] + FlashWear.rtc.erased[i];
+  }
+  return erased;
+}
+
+uint32_t FlashWearSectors(uint32_t area)
+{
+  uint32_t sectors = FlashWear.sectors[area];
+  if (WEAR_SETTINGS == area) {
+#ifdef ESP8266
+    sectors = (stop_flash_rotate) ? 1 : CFG_ROTATES;
+#endif  // ESP8266
+  }
+#if defined(ESP8266) && defined(USE_ENERGY_JOURNAL)
+  if (WEAR_ENERGY == area) {
+    sectors = JOURNAL_SECTORS;
+  }
+#endif  // ESP8266 && USE_ENERGY_JOURNAL
+  return (sectors) ? sectors : 1;
+}
+
+uint32_t FlashWearBudget(void)
+{
+  return (Settings.flash_wear_budget) ? Settings.flash_wear_budget : FLASH_WEAR_BUDGET;
+}
+
+void FlashWearEverySecond(void)
+{
+  FlashWearLoad();
+  uint32_t day = (RtcTime.valid) ? RtcTime.day_of_year : 0;
+  bool new_day = false;
+  if (day) {
+    new_day = (FlashWear.day && (day != FlashWear.day));  // Valid time arriving later does not start a day
+    FlashWear.day = day;
+  } else {
+    new_day = (uptime - FlashWear.day_uptime >= 86400);
+  }
+  if (new_day) {
+    FlashWear.day_start = FlashWearErased();
+    FlashWear.day_uptime = uptime;
+    FlashWear.warned = false;
+  }
+
+  uint32_t today = FlashWearErased() - FlashWear.day_start;
+  if (!FlashWear.warned && (today > FlashWearBudget())) {
+    FlashWear.warned = true;
+    AddLog_P2(LOG_LEVEL_INFO, PSTR("FLW: %d sectors erased today exceed the budget of %d"), today, FlashWearBudget());
+  }
+}
+
+void FlashWearShow(void)
+{
+  FlashWearLoad();
+  char name[10];
+  char wear[16];
+  for (uint32_t i = 0; i < WEAR_AREAS; i++) {
+    uint32_t erased = Settings.flash_wear_erased[i] + FlashWear.rtc.erased[i];
+    uint32_t sectors = FlashWearSectors(i);
+    dtostrfd((float)erased * 100 / sectors / FLASH_WEAR_ENDURANCE, 4, wear);
+    ResponseAppend_P(PSTR("\"%s\":{\"Erased\":%u,\"KBytes\":%u,\"Sectors\":%u,\"Wear\":%s},"),
+      GetTextIndexed(name, sizeof(name), i, kFlashWearAreas), erased,
+      Settings.flash_wear_kbytes[i] + FlashWear.rtc.kbytes[i], sectors, wear);
+  }
+  ResponseAppend_P(PSTR("\"Today\":%u,\"Budget\":%u"), FlashWearErased() - FlashWear.day_start, FlashWearBudget());
+}
+
+void FlashWearStatus(void)
+{
+  ResponseAppend_P(PSTR(",\"FlashWear\":{"));
+  FlashWearShow();
+  ResponseJsonEnd();
+}
+
+void CmndFlashWear(void)
+{
+  if ((XdrvMailbox.payload >= 0) && (XdrvMailbox.payload <= 0xFFFF)) {
+    Settings.flash_wear_budget = XdrvMailbox.payload;
+    FlashWear.warned = false;
+  }
+  Response_P(PSTR("{\"" D_CMND_FLASHWEAR "\":{"));
+  FlashWearShow();
+  ResponseJsonEndEnd();
+}
+
+/*********************************************************************************************\
+ * Interface
+\*********************************************************************************************/
+
+bool Xdrv42(uint8_t function)
+{
+  bool result = false;
+
+  switch (function) {
+    case FUNC_PRE_INIT:
+      XdrvSubscribe(FUNC_EVERY_SECOND);
+      break;
+    case FUNC_EVERY_SECOND:
+      FlashWearEverySecond();
+      break;
+    case FUNC_COMMAND:
+      result = DecodeCommand(kFlashWearCommands, FlashWearCommand);
+      break;
+  }
+  return result;
+}
+
+#endif  // USE_FLASH_WEAR
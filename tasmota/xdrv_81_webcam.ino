@@ -45,6 +45,14 @@
  * WcBrightness = Set picture Brightness -2 ... +2
  * WcContrast   = Set picture Contrast -2 ... +2
  *
+ * Camera frame buffers are shared by reference. The camera driver gets WC_FRAME_RING frame buffers in
+ * PSRAM and each frame taken from it is kept until the last of the stream viewers, snapshots and the
+ * motion and face detectors using it releases it, so none of them copies or grabs its own frame.
+ *
+ * The stream on port 81 is served by its own task and sent to up to WC_STREAM_CLIENTS viewers without
+ * blocking. A viewer still sending a frame keeps it and continues with the newest frame when done, so
+ * slow viewers skip frames instead of slowing down the others or the main loop.
+ *
  * Only boards with PSRAM should be used. To enable PSRAM board should be se set to esp32cam in common32 of platform_override.ini
  * board                   = esp32cam
  * To speed up cam processing cpu frequency should be better set to 240Mhz in common32 of platform_override.ini
@@ -65,6 +73,8 @@
 #include "fb_gfx.h"
 #include "fd_forward.h"
 #include "fr_forward.h"
+#include "esp_jpg_decode.h"
+#include <lwip/sockets.h>
 
 bool HttpCheckPriviledgedAccess(bool);
 extern ESP8266WebServer *Webserver;
@@ -72,7 +82,44 @@ extern ESP8266WebServer *Webserver;
 ESP8266WebServer *CamServer;
 #define BOUNDARY "e8b8c539-047d-4777-a985-fbba6edff11e"
 
-WiFiClient client;
+#ifndef WC_STREAM_CLIENTS
+#define WC_STREAM_CLIENTS 3                   // Max simultaneous stream viewers
+#endif
+#define WC_FRAME_RING (WC_STREAM_CLIENTS +2)  // Each viewer holds at most one frame, one is newest and one is filled
+#define WC_FRAME_MAX_AGE  100                 // Reuse the newest frame for motion, face detection and snapshots (mSec)
+
+enum WcStreamParts { WC_PART_IDLE, WC_PART_HEAD, WC_PART_BODY, WC_PART_TAIL };
+
+struct WC_FRAME {
+  camera_fb_t *fb;                            // Camera driver frame buffer or nullptr when slot is free
+  uint8_t *buff;                              // JPEG data in fb or converted by frame2jpg
+  uint32_t len;
+  uint32_t seq;                               // Capture sequence number
+  uint32_t time;                              // Capture time
+  uint8_t users;                              // References by viewers, snapshots and detectors
+  bool converted;
+};
+
+struct WC_VIEWER {
+  WiFiClient client;
+  uint32_t seq;                               // Last frame started
+  uint32_t sent;                              // Bytes sent of current part
+  char head[112];                             // Text of current head or tail part
+  uint8_t head_len;
+  int8_t frame;                               // Frame ring slot being sent or -1
+  uint8_t part;
+  bool active;
+};
+
+struct {
+  WC_FRAME frame[WC_FRAME_RING];
+  WC_VIEWER viewer[WC_STREAM_CLIENTS];
+  TaskHandle_t task = nullptr;
+  SemaphoreHandle_t mutex = nullptr;          // Owns camera capture, frame ring and viewers
+  uint32_t seq = 0;
+  int8_t newest = -1;                         // Frame ring slot of newest frame
+  uint8_t frames = 1;                         // Camera driver frame buffers
+} WcStream;
 
 
 // CAMERA_MODEL_AI_THINKER default template pins
@@ -98,7 +145,6 @@ struct {
   uint8_t  up;
   uint16_t width;
   uint16_t height;
-  uint8_t  stream_active;
 #ifdef USE_FACE_DETECT
   uint8_t  faces;
   uint16_t face_detect_time;
@@ -128,9 +174,17 @@ bool WcPinUsed(void) {
 }
 
 uint32_t WcSetup(int32_t fsiz) {
-  if (fsiz > 10) { fsiz = 10; }
+  // Stop viewers and keep the stream task away from the camera while it is set up
+  WcStreamStop();
+  WcStreamLock();
+  WcFrameFlush();
+  uint32_t result = WcSetupCamera(fsiz);
+  WcStreamUnlock();
+  return result;
+}
 
-  Wc.stream_active = 0;
+uint32_t WcSetupCamera(int32_t fsiz) {
+  if (fsiz > 10) { fsiz = 10; }
 
   if (fsiz < 0) {
     esp_camera_deinit();
@@ -207,7 +261,7 @@ uint32_t WcSetup(int32_t fsiz) {
   if (psram) {
     config.frame_size = FRAMESIZE_UXGA;
     config.jpeg_quality = 10;
-    config.fb_count = 2;
+    config.fb_count = WC_FRAME_RING;
     AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: PSRAM found"));
   } else {
     config.frame_size = FRAMESIZE_VGA;
@@ -222,6 +276,7 @@ uint32_t WcSetup(int32_t fsiz) {
 
 //  void *x=malloc(70000);
   void *x = 0;
+  WcStream.frames = config.fb_count;
   esp_err_t err = esp_camera_init(&config);
   if (x) { free(x); }
 
@@ -304,83 +359,316 @@ int32_t WcSetOptions(uint32_t sel, int32_t value) {
 }
 
 uint32_t WcGetWidth(void) {
-  camera_fb_t *wc_fb = esp_camera_fb_get();
-  if (!wc_fb) { return 0; }
-  Wc.width = wc_fb->width;
-  esp_camera_fb_return(wc_fb);
+  WC_FRAME *frame = WcFrameGet();
+  if (!frame) { return 0; }
+  Wc.width = frame->fb->width;
+  WcFrameRelease(frame);
   return Wc.width;
 }
 
 uint32_t WcGetHeight(void) {
-  camera_fb_t *wc_fb = esp_camera_fb_get();
-  if (!wc_fb) { return 0; }
-  Wc.height = wc_fb->height;
-  esp_camera_fb_return(wc_fb);
+  WC_FRAME *frame = WcFrameGet();
+  if (!frame) { return 0; }
+  Wc.height = frame->fb->height;
+  WcFrameRelease(frame);
   return Wc.height;
 }
 
+/*********************************************************************************************\
+ * Shared frames
+\*********************************************************************************************/
+
+// Give an unused frame back to the camera driver, caller holds the stream lock
+void WcFrameFree(uint32_t slot) {
+  WC_FRAME *frame = &WcStream.frame[slot];
+  if (!frame->fb || frame->users || (WcStream.newest == (int32_t)slot)) { return; }
+  if (frame->converted) { free(frame->buff); }
+  esp_camera_fb_return(frame->fb);
+  frame->fb = nullptr;
+  frame->buff = nullptr;
+  frame->len = 0;
+  frame->converted = false;
+}
+
+void WcFrameUnref(uint32_t slot) {
+  if (WcStream.frame[slot].users) { WcStream.frame[slot].users--; }
+  WcFrameFree(slot);
+}
+
+// Take a new frame from the camera which becomes the newest, caller holds the stream lock
+int32_t WcFrameCapture(void) {
+  int32_t slot = -1;
+  for (uint32_t i = 0; i < WcStream.frames; i++) {
+    if (!WcStream.frame[i].fb) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot < 0) {
+    // All driver buffers are taken so only an unused newest frame can be replaced
+    slot = WcStream.newest;
+    if ((slot < 0) || WcStream.frame[slot].users) { return -1; }
+    WcStream.newest = -1;
+    WcFrameFree(slot);
+  }
+
+  camera_fb_t *wc_fb = esp_camera_fb_get();
+  if (!wc_fb) {
+    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Can't get frame"));
+    return -1;
+  }
+  WC_FRAME *frame = &WcStream.frame[slot];
+  frame->fb = wc_fb;
+  frame->buff = wc_fb->buf;
+  frame->len = wc_fb->len;
+  frame->converted = false;
+  if (wc_fb->format != PIXFORMAT_JPEG) {
+    size_t _jpg_buf_len = 0;
+    uint8_t * _jpg_buf = NULL;
+    if (frame2jpg(wc_fb, 80, &_jpg_buf, &_jpg_buf_len)) {
+      frame->buff = _jpg_buf;
+      frame->len = _jpg_buf_len;
+      frame->converted = true;
+    } else {
+      AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: JPEG compression failed"));
+    }
+  }
+  frame->seq = ++WcStream.seq;
+  frame->time = millis();
+  frame->users = 0;
+
+  int32_t previous = WcStream.newest;
+  WcStream.newest = slot;
+  if (previous >= 0) { WcFrameFree(previous); }
+  return slot;
+}
+
+// Return all frames to the camera driver before it is stopped, caller holds the stream lock
+void WcFrameFlush(void) {
+  WcStream.newest = -1;
+  for (uint32_t i = 0; i < WC_FRAME_RING; i++) {
+    WcStream.frame[i].users = 0;
+    WcFrameFree(i);
+  }
+}
+
+// Reference to the newest frame, taking a new one when it is older than WC_FRAME_MAX_AGE. Release with WcFrameRelease()
+struct WC_FRAME *WcFrameGet(void) {
+  WcStreamLock();
+  int32_t slot = WcStream.newest;
+  if ((slot < 0) || (TimePassedSince(WcStream.frame[slot].time) > WC_FRAME_MAX_AGE)) {
+    int32_t fresh = WcFrameCapture();
+    slot = (fresh >= 0) ? fresh : WcStream.newest;  // All frames in use, keep the newest
+  }
+  WC_FRAME *frame = nullptr;
+  if (slot >= 0) {
+    frame = &WcStream.frame[slot];
+    frame->users++;
+  }
+  WcStreamUnlock();
+  return frame;
+}
+
+void WcFrameRelease(struct WC_FRAME *frame) {
+  if (!frame) { return; }
+  WcStreamLock();
+  WcFrameUnref(frame - WcStream.frame);
+  WcStreamUnlock();
+}
+
 /*********************************************************************************************/
 
-uint16_t motion_detect;
-uint32_t motion_ltime;
-uint32_t motion_trigger;
-uint32_t motion_brightness;
-uint8_t *last_motion_buffer;
+/*********************************************************************************************\
+ * Motion detection
+ *
+ * The newest JPEG frame is decoded at 1/8 scale, using only the DC coefficient of each 8x8 block, into
+ * a small luminance image. That image is compared to the previous one over a fixed grid of
+ * WC_MOTION_GRID_X by WC_MOTION_GRID_Y blocks and a block has motion when its average luminance
+ * difference exceeds the sensitivity. This runs on its own task on the core the loop is not using.
+ *
+ * Script wc(6 x):
+ *    x >= 0 = Set motion detection interval in mSec, 0 = off
+ *    x = -1 = Average luminance difference of the whole frame * 100 (trigger)
+ *    x = -2 = Average luminance * 100 (brightness)
+ *    x = -3 = Number of blocks with motion
+ *    x = -4 = Bitmask of blocks with motion, bit 0 is top left
+ * Script wc(8 x):
+ *    x = 1..255 = Set minimal average luminance difference of a block with motion, returns current value
+ *
+ * A change of the blocks with motion is published as {"WcMotion":{"Level":12,"Blocks":2,"Regions":"000030"}}
+\*********************************************************************************************/
+
+#define WC_MOTION_GRID_X      6               // Blocks per row
+#define WC_MOTION_GRID_Y      4               // Block rows, 24 blocks fit the float used by the script
+#define WC_MOTION_BLOCKS      (WC_MOTION_GRID_X * WC_MOTION_GRID_Y)
+#ifndef WC_MOTION_SENSITIVITY
+#define WC_MOTION_SENSITIVITY 16              // Default minimal average luminance difference of a block
+#endif
+
+struct {
+  uint8_t *gray = nullptr;                    // Luminance image being decoded
+  uint8_t *last = nullptr;                    // Previous luminance image
+  TaskHandle_t task = nullptr;
+  uint32_t size = 0;                          // Allocated luminance image size
+  uint32_t trigger = 0;
+  uint32_t brightness = 0;
+  uint32_t mask = 0;                          // Blocks with motion
+  uint32_t reported = 0;                      // Blocks with motion last published
+  uint16_t width = 0;                         // Luminance image size
+  uint16_t height = 0;
+  uint16_t interval = 0;                      // Detection interval in mSec, 0 = off
+  uint8_t sensitivity = WC_MOTION_SENSITIVITY;
+  uint8_t blocks = 0;
+  bool valid = false;                         // Previous image has the current size
+} WcMotion;
+
+struct WC_JPG_SOURCE {
+  const uint8_t *buff;
+  uint32_t len;
+};
+
+size_t WcMotionRead(void *arg, size_t index, uint8_t *buf, size_t len) {
+  WC_JPG_SOURCE *source = (WC_JPG_SOURCE*)arg;
+  if (index + len > source->len) { len = source->len - index; }
+  if (buf) { memcpy(buf, source->buff + index, len); }
+  return len;
+}
+
+bool WcMotionWrite(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data) {
+  if (!data) {
+    if (!x && !y) {
+      // Start of decode with the scaled image size
+      uint32_t size = w * h;
+      if (size > WcMotion.size) {
+        if (WcMotion.gray) { free(WcMotion.gray); }
+        if (WcMotion.last) { free(WcMotion.last); }
+        WcMotion.gray = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        WcMotion.last = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        WcMotion.size = (WcMotion.gray && WcMotion.last) ? size : 0;
+      }
+      if (!WcMotion.size) { return false; }
+      if ((w != WcMotion.width) || (h != WcMotion.height)) { WcMotion.valid = false; }
+      WcMotion.width = w;
+      WcMotion.height = h;
+    }
+    return true;
+  }
+  // RGB888 pixels of a decoded part
+  for (uint32_t row = 0; row < h; row++) {
+    uint8_t *gray = WcMotion.gray + (y + row) * WcMotion.width + x;
+    for (uint32_t col = 0; col < w; col++) {
+      *gray++ = (data[0] + data[1] + data[2]) / 3;
+      data += 3;
+    }
+  }
+  return true;
+}
 
 uint32_t WcSetMotionDetect(int32_t value) {
-  if (value >= 0) { motion_detect = value; }
-  if (-1 == value) {
-    return motion_trigger;
-  } else  {
-    return motion_brightness;
+  if (value >= 0) {
+    WcMotion.interval = value;
+    if (WcMotionBegin()) { xTaskNotifyGive(WcMotion.task); }
   }
+  switch (value) {
+    case -1: return WcMotion.trigger;
+    case -3: return WcMotion.blocks;
+    case -4: return WcMotion.mask;
+  }
+  return WcMotion.brightness;
+}
+
+uint32_t WcSetMotionSensitivity(int32_t value) {
+  if ((value > 0) && (value < 256)) { WcMotion.sensitivity = value; }
+  return WcMotion.sensitivity;
 }
 
 // optional motion detector
 void WcDetectMotion(void) {
-  camera_fb_t *wc_fb;
-  uint8_t *out_buf = 0;
+  WC_FRAME *frame = WcFrameGet();
+  if (!frame) { return; }
+  WC_JPG_SOURCE source = { frame->buff, frame->len };
+  bool decoded = (ESP_OK == esp_jpg_decode(frame->len, JPG_SCALE_8X, WcMotionRead, WcMotionWrite, &source));
+  WcFrameRelease(frame);
+  if (!decoded) { return; }
+
+  uint32_t width = WcMotion.width;
+  uint32_t height = WcMotion.height;
+  uint32_t pixels = width * height;
+  if (!pixels) { return; }
+
+  uint32_t diff[WC_MOTION_BLOCKS] = { 0 };
+  uint32_t count[WC_MOTION_BLOCKS] = { 0 };
+  uint32_t accu = 0;
+  uint32_t bright = 0;
+  uint8_t *pxi = WcMotion.gray;
+  uint8_t *pxr = WcMotion.last;
+  for (uint32_t y = 0; y < height; y++) {
+    uint32_t row = (y * WC_MOTION_GRID_Y / height) * WC_MOTION_GRID_X;
+    for (uint32_t x = 0; x < width; x++) {
+      uint32_t block = row + x * WC_MOTION_GRID_X / width;
+      uint32_t delta = abs(*pxi - *pxr);
+      diff[block] += delta;
+      count[block]++;
+      accu += delta;
+      bright += *pxi;
+      pxi++;
+      pxr++;
+    }
+  }
 
-  if ((millis()-motion_ltime) > motion_detect) {
-    motion_ltime = millis();
-    wc_fb = esp_camera_fb_get();
-    if (!wc_fb) { return; }
+  // Keep this image as reference for the next one
+  uint8_t *last = WcMotion.last;
+  WcMotion.last = WcMotion.gray;
+  WcMotion.gray = last;
+  WcMotion.brightness = bright * 100 / pixels;
+  if (!WcMotion.valid) {
+    WcMotion.valid = true;
+    return;
+  }
 
-    if (!last_motion_buffer) {
-      last_motion_buffer=(uint8_t *)heap_caps_malloc((wc_fb->width*wc_fb->height)+4, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  uint32_t mask = 0;
+  uint32_t blocks = 0;
+  for (uint32_t i = 0; i < WC_MOTION_BLOCKS; i++) {
+    if (count[i] && (diff[i] / count[i] >= WcMotion.sensitivity)) {
+      mask |= 1 << i;
+      blocks++;
     }
-    if (last_motion_buffer) {
-      if (PIXFORMAT_JPEG == wc_fb->format) {
-        out_buf = (uint8_t *)heap_caps_malloc((wc_fb->width*wc_fb->height*3)+4, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-        if (out_buf) {
-          fmt2rgb888(wc_fb->buf, wc_fb->len, wc_fb->format, out_buf);
-          uint32_t x, y;
-          uint8_t *pxi = out_buf;
-          uint8_t *pxr = last_motion_buffer;
-          // convert to bw
-          uint64_t accu = 0;
-          uint64_t bright = 0;
-          for (y = 0; y < wc_fb->height; y++) {
-            for (x = 0; x < wc_fb->width; x++) {
-              int32_t gray = (pxi[0] + pxi[1] + pxi[2]) / 3;
-              int32_t lgray = pxr[0];
-              pxr[0] = gray;
-              pxi += 3;
-              pxr++;
-              accu += abs(gray - lgray);
-              bright += gray;
-            }
-          }
-          motion_trigger = accu / ((wc_fb->height * wc_fb->width) / 100);
-          motion_brightness = bright / ((wc_fb->height * wc_fb->width) / 100);
-          free(out_buf);
-        }
-      }
+  }
+  WcMotion.trigger = accu * 100 / pixels;
+  WcMotion.blocks = blocks;
+  WcMotion.mask = mask;
+}
+
+void WcMotionTask(void *arg) {
+  while (true) {
+    uint32_t interval = WcMotion.interval;
+    if (!interval) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);  // Sleep until detection is enabled
+      continue;
     }
-    esp_camera_fb_return(wc_fb);
+    uint32_t start = millis();
+    if (Wc.up) { WcDetectMotion(); }
+    int32_t wait = interval - TimePassedSince(start);
+    vTaskDelay(pdMS_TO_TICKS((wait > 0) ? wait : 1));
   }
 }
 
+bool WcMotionBegin(void) {
+  if (WcMotion.task) { return true; }
+  // Loop runs on one core, motion detection on the other
+  return (pdPASS == xTaskCreatePinnedToCore(WcMotionTask, "wcmotion", 4096, nullptr, 1, &WcMotion.task, !xPortGetCoreID()));
+}
+
+void WcMotionShow(void) {
+  uint32_t mask = WcMotion.mask;
+  if (mask == WcMotion.reported) { return; }
+  WcMotion.reported = mask;
+  Response_P(PSTR("{\"WcMotion\":{\"Level\":%d,\"Blocks\":%d,\"Regions\":\"%06X\"}}"),
+    WcMotion.trigger, WcMotion.blocks, mask);
+  MqttPublishPrefixTopic_P(RESULT_OR_TELE, PSTR("WcMotion"));
+  XdrvRulesProcess();
+}
+
 /*********************************************************************************************/
 
 #ifdef USE_FACE_DETECT
@@ -473,13 +761,14 @@ uint32_t WcDetectFace(void) {
 
   if ((millis() - face_ltime) > Wc.face_detect_time) {
     face_ltime = millis();
-    fb = esp_camera_fb_get();
-    if (!fb) { return ESP_FAIL; }
+    WC_FRAME *frame = WcFrameGet();
+    if (!frame) { return ESP_FAIL; }
+    fb = frame->fb;
 
     image_matrix = dl_matrix3du_alloc(1, fb->width, fb->height, 3);
     if (!image_matrix) {
       AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: dl_matrix3du_alloc failed"));
-      esp_camera_fb_return(fb);
+      WcFrameRelease(frame);
       return ESP_FAIL;
     }
 
@@ -489,7 +778,7 @@ uint32_t WcDetectFace(void) {
     //out_height = fb->height;
 
     s = fmt2rgb888(fb->buf, fb->len, fb->format, out_buf);
-    esp_camera_fb_return(fb);
+    WcFrameRelease(frame);
     if (!s){
       dl_matrix3du_free(image_matrix);
       AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: to rgb888 failed"));
@@ -530,10 +819,6 @@ struct PICSTORE {
 
 struct PICSTORE picstore[MAX_PICSTORE];
 
-#ifdef COPYFRAME
-struct PICSTORE tmp_picstore;
-#endif
-
 uint32_t WcGetPicstore(int32_t num, uint8_t **buff) {
   if (num<0) { return MAX_PICSTORE; }
   *buff = picstore[num].buff;
@@ -541,11 +826,6 @@ uint32_t WcGetPicstore(int32_t num, uint8_t **buff) {
 }
 
 uint32_t WcGetFrame(int32_t bnum) {
-  size_t _jpg_buf_len = 0;
-  uint8_t * _jpg_buf = NULL;
-  camera_fb_t *wc_fb = 0;
-  bool jpeg_converted = false;
-
   if (bnum < 0) {
     if (bnum < -MAX_PICSTORE) { bnum=-1; }
     bnum = -bnum;
@@ -555,54 +835,33 @@ uint32_t WcGetFrame(int32_t bnum) {
     return 0;
   }
 
-#ifdef COPYFRAME
-  if (bnum & 0x10) {
-    bnum &= 0xf;
-    _jpg_buf = tmp_picstore.buff;
-    _jpg_buf_len = tmp_picstore.len;
-    if (!_jpg_buf_len) { return 0; }
-    goto pcopy;
-  }
-#endif
-
-  wc_fb = esp_camera_fb_get();
-  if (!wc_fb) {
+  WC_FRAME *frame = WcFrameGet();   // Shared with stream and detectors
+  if (!frame) {
     AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Can't get frame"));
     return 0;
   }
   if (!bnum) {
-    Wc.width = wc_fb->width;
-    Wc.height = wc_fb->height;
-    esp_camera_fb_return(wc_fb);
+    Wc.width = frame->fb->width;
+    Wc.height = frame->fb->height;
+    WcFrameRelease(frame);
     return 0;
   }
 
-  if (wc_fb->format != PIXFORMAT_JPEG) {
-    jpeg_converted = frame2jpg(wc_fb, 80, &_jpg_buf, &_jpg_buf_len);
-    if (!jpeg_converted){
-      //Serial.println("JPEG compression failed");
-      _jpg_buf_len = wc_fb->len;
-      _jpg_buf = wc_fb->buf;
-    }
-  } else {
-    _jpg_buf_len = wc_fb->len;
-    _jpg_buf = wc_fb->buf;
-  }
-
-pcopy:
+  // Pictures are kept until freed by the script so they get their own copy instead of holding a camera buffer
+  bnum &= 0xf;                      // Former COPYFRAME streamed frame request
   if ((bnum < 1) || (bnum > MAX_PICSTORE)) { bnum = 1; }
   bnum--;
+  uint32_t _jpg_buf_len = frame->len;
   if (picstore[bnum].buff) { free(picstore[bnum].buff); }
   picstore[bnum].buff = (uint8_t *)heap_caps_malloc(_jpg_buf_len+4, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
   if (picstore[bnum].buff) {
-    memcpy(picstore[bnum].buff, _jpg_buf, _jpg_buf_len);
+    memcpy(picstore[bnum].buff, frame->buff, _jpg_buf_len);
     picstore[bnum].len = _jpg_buf_len;
   } else {
     AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Can't allocate picstore"));
     picstore[bnum].len = 0;
   }
-  if (wc_fb) { esp_camera_fb_return(wc_fb); }
-  if (jpeg_converted) { free(_jpg_buf); }
+  WcFrameRelease(frame);
   if (!picstore[bnum].buff) { return 0; }
 
   return  _jpg_buf_len;
@@ -620,25 +879,12 @@ void HandleImage(void) {
   Webserver->sendContent(response);
 
   if (!bnum) {
-    size_t _jpg_buf_len = 0;
-    uint8_t * _jpg_buf = NULL;
-    camera_fb_t *wc_fb = 0;
-    wc_fb = esp_camera_fb_get();
-    if (!wc_fb) { return; }
-    if (wc_fb->format != PIXFORMAT_JPEG) {
-      bool jpeg_converted = frame2jpg(wc_fb, 80, &_jpg_buf, &_jpg_buf_len);
-      if (!jpeg_converted) {
-        _jpg_buf_len = wc_fb->len;
-        _jpg_buf = wc_fb->buf;
-      }
-    } else {
-      _jpg_buf_len = wc_fb->len;
-      _jpg_buf = wc_fb->buf;
-    }
-    if (_jpg_buf_len) {
-      client.write((char *)_jpg_buf, _jpg_buf_len);
+    WC_FRAME *frame = WcFrameGet();
+    if (!frame) { return; }
+    if (frame->len) {
+      client.write((char *)frame->buff, frame->len);
     }
-    if (wc_fb) { esp_camera_fb_return(wc_fb); }
+    WcFrameRelease(frame);
   } else {
     bnum--;
     if (!picstore[bnum].len) {
@@ -663,122 +909,194 @@ void HandleImageBasic(void) {
     }
   }
 
-  camera_fb_t *wc_fb;
-  wc_fb = esp_camera_fb_get();  // Acquire frame
-  if (!wc_fb) {
+  WC_FRAME *frame = WcFrameGet();  // Acquire frame
+  if (!frame) {
     AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Frame buffer could not be acquired"));
     return;
   }
 
-  size_t _jpg_buf_len = 0;
-  uint8_t * _jpg_buf = NULL;
-  if (wc_fb->format != PIXFORMAT_JPEG) {
-    bool jpeg_converted = frame2jpg(wc_fb, 80, &_jpg_buf, &_jpg_buf_len);
-    if (!jpeg_converted) {
-      _jpg_buf_len = wc_fb->len;
-      _jpg_buf = wc_fb->buf;
-    }
-  } else {
-    _jpg_buf_len = wc_fb->len;
-    _jpg_buf = wc_fb->buf;
-  }
-
-  if (_jpg_buf_len) {
+  if (frame->len) {
     Webserver->client().flush();
     WSHeaderSend();
     Webserver->sendHeader(F("Content-disposition"), F("inline; filename=snapshot.jpg"));
-    Webserver->send_P(200, "image/jpeg", (char *)_jpg_buf, _jpg_buf_len);
+    Webserver->send_P(200, "image/jpeg", (char *)frame->buff, frame->len);
     Webserver->client().stop();
   }
 
-  esp_camera_fb_return(wc_fb);  // Free frame buffer
+  WcFrameRelease(frame);  // Free frame buffer
 
   AddLog_P2(LOG_LEVEL_DEBUG_MORE, PSTR("CAM: Image sent"));
 }
 
-void HandleWebcamMjpeg(void) {
-  AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Handle camserver"));
-//  if (!Wc.stream_active) {
-// always restart stream
-    Wc.stream_active = 1;
-    client = CamServer->client();
-    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Create client"));
-//  }
+/*********************************************************************************************\
+ * Stream task
+\*********************************************************************************************/
+
+void WcStreamLock(void) {
+  if (WcStream.mutex) { xSemaphoreTake(WcStream.mutex, portMAX_DELAY); }
 }
 
-void HandleWebcamMjpegTask(void) {
-  camera_fb_t *wc_fb;
-  size_t _jpg_buf_len = 0;
-  uint8_t * _jpg_buf = NULL;
+void WcStreamUnlock(void) {
+  if (WcStream.mutex) { xSemaphoreGive(WcStream.mutex); }
+}
 
-  //WiFiClient client = CamServer->client();
-  uint32_t tlen;
-  bool jpeg_converted = false;
+void WcViewerStop(struct WC_VIEWER *viewer) {
+  if (viewer->frame >= 0) { WcFrameUnref(viewer->frame); }
+  viewer->frame = -1;
+  viewer->client.stop();
+  viewer->active = false;
+}
 
-  if (!client.connected()) {
-    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Client fail"));
-    Wc.stream_active = 0;
+void WcViewerText(struct WC_VIEWER *viewer, uint32_t part, const char *text) {
+  strlcpy(viewer->head, text, sizeof(viewer->head));
+  viewer->head_len = strlen(viewer->head);
+  viewer->part = part;
+  viewer->sent = 0;
+}
+
+// Send without blocking, returns 1 when all is sent, 0 when the socket is full and -1 on error
+int32_t WcViewerSend(struct WC_VIEWER *viewer, const uint8_t *data, uint32_t len) {
+  while (viewer->sent < len) {
+    int res = send(viewer->client.fd(), data + viewer->sent, len - viewer->sent, MSG_DONTWAIT);
+    if (res < 0) {
+      return ((EAGAIN == errno) || (EWOULDBLOCK == errno)) ? 0 : -1;
+    }
+    viewer->sent += res;
   }
-  if (1 == Wc.stream_active) {
-    client.flush();
-    client.setTimeout(3);
-    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Start stream"));
-    client.print("HTTP/1.1 200 OK\r\n"
-      "Content-Type: multipart/x-mixed-replace;boundary=" BOUNDARY "\r\n"
-      "\r\n");
-    Wc.stream_active = 2;
+  return 1;
+}
+
+// Returns true when waiting for a new frame
+bool WcViewerRun(struct WC_VIEWER *viewer) {
+  int32_t res = 1;
+  while (res > 0) {
+    switch (viewer->part) {
+      case WC_PART_IDLE:
+        if ((WcStream.newest < 0) || (WcStream.frame[WcStream.newest].seq == viewer->seq)) { return true; }
+        if (!viewer->seq && (TimePassedSince(WcStream.frame[WcStream.newest].time) > WC_FRAME_MAX_AGE)) { return true; }  // Start with a fresh frame
+        viewer->frame = WcStream.newest;
+        WcStream.frame[viewer->frame].users++;
+        viewer->seq = WcStream.frame[viewer->frame].seq;
+        viewer->head_len = snprintf_P(viewer->head, sizeof(viewer->head), PSTR("Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n"),
+          WcStream.frame[viewer->frame].len);
+        viewer->part = WC_PART_HEAD;
+        viewer->sent = 0;
+        break;
+      case WC_PART_HEAD:
+        res = WcViewerSend(viewer, (uint8_t*)viewer->head, viewer->head_len);
+        if (res > 0) {
+          viewer->part = WC_PART_BODY;
+          viewer->sent = 0;
+        }
+        break;
+      case WC_PART_BODY:
+        res = WcViewerSend(viewer, WcStream.frame[viewer->frame].buff, WcStream.frame[viewer->frame].len);
+        if (res > 0) {
+          WcFrameUnref(viewer->frame);
+          viewer->frame = -1;
+          WcViewerText(viewer, WC_PART_TAIL, "\r\n--" BOUNDARY "\r\n");
+        }
+        break;
+      case WC_PART_TAIL:
+        res = WcViewerSend(viewer, (uint8_t*)viewer->head, viewer->head_len);
+        if (res > 0) { viewer->part = WC_PART_IDLE; }
+        break;
+    }
   }
-  if (2 == Wc.stream_active) {
-    wc_fb = esp_camera_fb_get();
-    if (!wc_fb) {
-      AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Frame fail"));
-      Wc.stream_active = 0;
+  if (res < 0) {
+    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Client fail"));
+    WcViewerStop(viewer);
+  }
+  return false;
+}
+
+// Returns true while any viewer is connected
+bool WcStreamRun(void) {
+  bool viewers = false;
+  bool waiting = false;
+  for (uint32_t i = 0; i < WC_STREAM_CLIENTS; i++) {
+    WC_VIEWER *viewer = &WcStream.viewer[i];
+    if (!viewer->active) { continue; }
+    if (!viewer->client.connected()) {
+      AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Stream exit"));
+      WcViewerStop(viewer);
+      continue;
     }
+    viewers = true;
+    if (WcViewerRun(viewer)) { waiting = true; }
   }
-  if (2 == Wc.stream_active) {
-    if (wc_fb->format != PIXFORMAT_JPEG) {
-      jpeg_converted = frame2jpg(wc_fb, 80, &_jpg_buf, &_jpg_buf_len);
-      if (!jpeg_converted){
-        AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: JPEG compression failed"));
-        _jpg_buf_len = wc_fb->len;
-        _jpg_buf = wc_fb->buf;
-      }
-    } else {
-      _jpg_buf_len = wc_fb->len;
-      _jpg_buf = wc_fb->buf;
+  if (!viewers) { return false; }
+  // Only take a new frame when a viewer is done with the newest one
+  if (waiting && Wc.up && (WcFrameCapture() >= 0)) {
+    for (uint32_t i = 0; i < WC_STREAM_CLIENTS; i++) {
+      if (WcStream.viewer[i].active) { WcViewerRun(&WcStream.viewer[i]); }
     }
+  }
+  return true;
+}
 
-    client.printf("Content-Type: image/jpeg\r\n"
-      "Content-Length: %d\r\n"
-      "\r\n", static_cast<int>(_jpg_buf_len));
-    tlen = client.write(_jpg_buf, _jpg_buf_len);
-    /*
-    if (tlen!=_jpg_buf_len) {
-      esp_camera_fb_return(wc_fb);
-      Wc.stream_active=0;
-      AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Send fail"));
-    }*/
-    client.print("\r\n--" BOUNDARY "\r\n");
-
-#ifdef COPYFRAME
-    if (tmp_picstore.buff) { free(tmp_picstore.buff); }
-    tmp_picstore.buff = (uint8_t *)heap_caps_malloc(_jpg_buf_len+4, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (tmp_picstore.buff) {
-      memcpy(tmp_picstore.buff, _jpg_buf, _jpg_buf_len);
-      tmp_picstore.len = _jpg_buf_len;
+void WcStreamTask(void *arg) {
+  while (true) {
+    WcStreamLock();
+    bool viewers = WcStreamRun();
+    WcStreamUnlock();
+    if (viewers) {
+      vTaskDelay(1);                          // Let others run while sockets drain
     } else {
-      tmp_picstore.len = 0;
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);  // Sleep until a viewer connects
     }
-#endif
+  }
+}
+
+bool WcStreamBegin(void) {
+  if (WcStream.task) { return true; }
+  if (!WcStream.mutex) { return false; }
+  // Loop runs on one core, streaming on the other
+  if (pdPASS != xTaskCreatePinnedToCore(WcStreamTask, "wcstream", 4096, nullptr, 1, &WcStream.task, !xPortGetCoreID())) {
+    WcStream.task = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void WcStreamStop(void) {
+  WcStreamLock();
+  for (uint32_t i = 0; i < WC_STREAM_CLIENTS; i++) {
+    if (WcStream.viewer[i].active) { WcViewerStop(&WcStream.viewer[i]); }
+  }
+  WcStreamUnlock();
+}
+
+void HandleWebcamMjpeg(void) {
+  AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Handle camserver"));
+  if (!WcStreamBegin()) { return; }
 
-    if (jpeg_converted) { free(_jpg_buf); }
-    esp_camera_fb_return(wc_fb);
-    //AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: send frame"));
+  WcStreamLock();
+  WC_VIEWER *viewer = nullptr;
+  for (uint32_t i = 0; i < WC_STREAM_CLIENTS; i++) {
+    if (!WcStream.viewer[i].active) {
+      viewer = &WcStream.viewer[i];
+      break;
+    }
+  }
+  if (viewer) {
+    viewer->client = CamServer->client();
+    viewer->client.setNoDelay(true);
+    viewer->seq = 0;
+    viewer->frame = -1;
+    viewer->active = true;
+    WcViewerText(viewer, WC_PART_TAIL, "HTTP/1.1 200 OK\r\n"
+      "Content-Type: multipart/x-mixed-replace;boundary=" BOUNDARY "\r\n"
+      "\r\n");
+    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Start stream"));
   }
-  if (0 == Wc.stream_active) {
-    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Stream exit"));
-    client.flush();
-    client.stop();
+  WcStreamUnlock();
+
+  if (viewer) {
+    xTaskNotifyGive(WcStream.task);
+  } else {
+    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("CAM: Too many clients"));
+    CamServer->send(503, "", "");
   }
 }
 
@@ -794,7 +1112,7 @@ void HandleWebcamRoot(void) {
 uint32_t WcSetStreamserver(uint32_t flag) {
   if (global_state.wifi_down) { return 0; }
 
-  Wc.stream_active = 0;
+  WcStreamStop();
 
   if (flag) {
     if (!CamServer) {
@@ -828,9 +1146,8 @@ void WcStreamControl() {
 void WcLoop(void) {
   if (CamServer) {
     CamServer->handleClient();
-    if (Wc.stream_active) { HandleWebcamMjpegTask(); }
   }
-  if (motion_detect) { WcDetectMotion(); }
+  if (WcMotion.interval) { WcMotionShow(); }
 #ifdef USE_FACE_DETECT
   if (Wc.face_detect_time) { WcDetectFace(); }
 #endif
@@ -857,6 +1174,8 @@ void WcShowStream(void) {
 }
 
 void WcInit(void) {
+  WcStream.mutex = xSemaphoreCreateMutex();   // Frames are shared by the loop, stream and motion tasks
+
   if (!Settings.webcam_config.data) {
     Settings.webcam_config.stream = 1;
     Settings.webcam_config.resolution = 5;
@@ -978,6 +1297,7 @@ bool Xdrv81(uint8_t function) {
       break;
     case FUNC_PRE_INIT:
       WcInit();
+      XdrvSubscribe(FUNC_LOOP);
       break;
 
   }
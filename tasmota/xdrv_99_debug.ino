@@ -34,6 +34,10 @@
 
 #define XDRV_99             99
 
+#ifdef ESP32
+#include "esp_ota_ops.h"
+#endif  // ESP32
+
 #ifndef CPU_LOAD_CHECK
 #define CPU_LOAD_CHECK      1                 // Seconds between each CPU_LOAD log
 #endif
@@ -59,19 +63,25 @@
 #define D_CMND_I2CSTRETCH "I2CStretch"
 #define D_CMND_I2CCLOCK  "I2CClock"
 #define D_CMND_SERBUFF   "SerBufSize"
+#define D_CMND_PGMBENCH  "PgmBench"
+#define D_CMND_BENCH     "Bench"
+#define D_CMND_FLASHBENCH "FlashBench"
+#define D_CMND_PWMBENCH  "PwmBench"
+#define D_CMND_SERBENCH  "SerBench"
+#define D_CMND_I2CBENCH  "I2CBench"
 
 const char kDebugCommands[] PROGMEM = "|"  // No prefix
   D_CMND_CFGDUMP "|" D_CMND_CFGPEEK "|" D_CMND_CFGPOKE "|"
 #ifdef USE_WEBSERVER
   D_CMND_CFGXOR "|"
 #endif
-  D_CMND_CPUCHECK "|" D_CMND_SERBUFF "|"
+  D_CMND_CPUCHECK "|" D_CMND_SERBUFF "|" D_CMND_PGMBENCH "|" D_CMND_BENCH "|" D_CMND_FLASHBENCH "|" D_CMND_PWMBENCH "|" D_CMND_SERBENCH "|"
 #ifdef DEBUG_THEO
   D_CMND_EXCEPTION "|"
 #endif
   D_CMND_FLASHDUMP "|" D_CMND_FLASHMODE "|" D_CMND_FREEMEM"|" D_CMND_HELP "|" D_CMND_RTCDUMP "|" D_CMND_SETSENSOR "|"
 #ifdef USE_I2C
-  D_CMND_I2CWRITE "|" D_CMND_I2CREAD "|" D_CMND_I2CSTRETCH "|" D_CMND_I2CCLOCK
+  D_CMND_I2CWRITE "|" D_CMND_I2CREAD "|" D_CMND_I2CSTRETCH "|" D_CMND_I2CCLOCK "|" D_CMND_I2CBENCH
 #endif
   ;
 
@@ -80,13 +90,13 @@ void (* const DebugCommand[])(void) PROGMEM = {
 #ifdef USE_WEBSERVER
   &CmndCfgXor,
 #endif
-  &CmndCpuCheck, &CmndSerBufSize,
+  &CmndCpuCheck, &CmndSerBufSize, &CmndPgmBench, &CmndBench, &CmndFlashBench, &CmndPwmBench, &CmndSerBench,
 #ifdef DEBUG_THEO
   &CmndException,
 #endif
   &CmndFlashDump, &CmndFlashMode, &CmndFreemem, &CmndHelp, &CmndRtcDump, &CmndSetSensor,
 #ifdef USE_I2C
-  &CmndI2cWrite, &CmndI2cRead, &CmndI2cStretch, &CmndI2cClock
+  &CmndI2cWrite, &CmndI2cRead, &CmndI2cStretch, &CmndI2cClock, &CmndI2cBench
 #endif
   };
 
@@ -96,6 +106,17 @@ uint32_t CPU_last_loop_time = 0;
 uint8_t CPU_load_check = 0;
 uint8_t CPU_show_freemem = 0;
 
+#ifdef USE_I2C
+uint32_t debug_i2c_clock = 100000;           // Restored after I2cBench
+#endif  // USE_I2C
+
+struct DEBUG_STATS {
+  uint32_t min;
+  uint32_t max;
+  uint32_t total;
+  uint32_t count;
+};
+
 /*******************************************************************************************/
 
 #ifdef DEBUG_THEO
@@ -203,7 +224,7 @@ void DebugFreeMem(void)
   register uint32_t *sp asm("a1");
 
 //  AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_DEBUG "FreeRam %d, FreeStack %d, UnmodifiedStack %d (%s)"), ESP.getFreeHeap(), 4 * (sp - g_cont.stack), cont_get_free_stack(&g_cont), XdrvMailbox.data);
-  AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_DEBUG "FreeRam %d, FreeStack %d (%s)"), ESP.getFreeHeap(), 4 * (sp - g_cont.stack), XdrvMailbox.data);
+  AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_DEBUG "FreeRam %d, MaxBlock %d, FreeStack %d (%s)"), ESP.getFreeHeap(), ESP_getMaxFreeBlock(), 4 * (sp - g_cont.stack), XdrvMailbox.data);
 }
 
 #else
@@ -220,7 +241,7 @@ void DebugFreeMem(void)
 {
   register uint32_t *sp asm("a1");
 
-  AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_DEBUG "FreeRam %d, FreeStack %d (%s)"), ESP.getFreeHeap(), 4 * (sp - g_pcont->stack), XdrvMailbox.data);
+  AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_DEBUG "FreeRam %d, MaxBlock %d, FreeStack %d (%s)"), ESP.getFreeHeap(), ESP_getMaxFreeBlock(), 4 * (sp - g_pcont->stack), XdrvMailbox.data);
 }
 
 #endif  // ARDUINO_ESP8266_RELEASE_2_x_x
@@ -231,7 +252,7 @@ void DebugFreeMem(void)
 {
   register uint8_t *sp asm("a1");
 
-  AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_DEBUG "FreeRam %d, FreeStack %d (%s)"), ESP.getFreeHeap(), sp - pxTaskGetStackStart(NULL), XdrvMailbox.data);
+  AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_DEBUG "FreeRam %d, MaxBlock %d, FreeStack %d (%s)"), ESP.getFreeHeap(), ESP_getMaxFreeBlock(), sp - pxTaskGetStackStart(NULL), XdrvMailbox.data);
 }
 
 #endif  // ESP8266 - ESP32
@@ -391,6 +412,7 @@ void DebugCfgPoke(char* parms)
 
   uint8_t *nbuffer = (uint8_t *) &data;
   for (uint32_t i = 0; i < 4; i++) { buffer[address +i] = nbuffer[+i]; }
+  SettingsTextIndex();
 
   uint32_t ndata32 = (buffer[address +3] << 24) + (buffer[address +2] << 16) + (buffer[address +1] << 8) + buffer[address];
 
@@ -493,6 +515,319 @@ void CmndSerBufSize(void)
 #endif
 }
 
+int DebugCommandCodeBytewise(char* destination, size_t destination_size, const char* needle, const char* haystack)
+{
+  // GetCommandCode() reading one byte per flash access as before PgmRead()
+  int result = -1;
+  const char* read = haystack;
+  char* write = destination;
+
+  while (true) {
+    result++;
+    size_t size = destination_size -1;
+    write = destination;
+    char ch = '.';
+    while ((ch != '\0') && (ch != '|')) {
+      ch = pgm_read_byte(read++);
+      if (size && (ch != '|'))  {
+        *write++ = ch;
+        size--;
+      }
+    }
+    *write = '\0';
+    if (!strcasecmp(needle, destination)) {
+      break;
+    }
+    if (0 == ch) {
+      result = -1;
+      break;
+    }
+  }
+  return result;
+}
+
+void CmndPgmBench(void)
+{
+  // PgmBench 1000 - Time lookups of the last command in kTasmotaCommands
+  uint32_t loops = (XdrvMailbox.payload > 0) ? XdrvMailbox.payload : 1000;
+  char command[CMDSZ];
+  char needle[CMDSZ];
+  int last = 0;
+  while (GetTextIndexed(needle, sizeof(needle), last +1, kTasmotaCommands)) {
+    if (!strlen(needle)) { break; }
+    last++;
+  }
+  GetTextIndexed(needle, sizeof(needle), last, kTasmotaCommands);
+
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < loops; i++) {
+    DebugCommandCodeBytewise(command, sizeof(command), needle, kTasmotaCommands);
+    if (!(i & 0xFF)) { yield(); }
+  }
+  uint32_t bytewise = micros() - start;
+  start = micros();
+  for (uint32_t i = 0; i < loops; i++) {
+    GetCommandCode(command, sizeof(command), needle, kTasmotaCommands);
+    if (!(i & 0xFF)) { yield(); }
+  }
+  uint32_t wordwise = micros() - start;
+  Response_P(PSTR("{\"%s\":{\"Command\":\"%s\",\"Loops\":%u,\"Byte\":%u,\"Word\":%u}}"),
+    XdrvMailbox.command, needle, loops, bytewise, wordwise);
+}
+
+uint32_t DebugBenchStart(void)
+{
+  yield();                             // Start with a fresh slice of the watchdog and WiFi time
+  return micros();
+}
+
+void DebugBenchResult(const char* name, uint32_t loops, uint32_t start)
+{
+  uint32_t duration = micros() - start;
+  ResponseAppend_P(PSTR(",\"%s\":%u"), name, (uint32_t)(((uint64_t)duration * 1000) / loops));
+}
+
+void CmndBench(void)
+{
+  // Bench 1000 - Report nanoseconds per call of hot parsing and conversion routines
+  //   Command    - GetCommandCode() of the last command in kTasmotaCommands as used by DecodeCommand()
+  //   RuleEvent  - RulesEventTokenize() of a sensor event
+  //   RuleMatch  - RulesRuleMatch() of a compare rule on the tokenized event
+  //   Expression - evaluateExpression() of an expression with all operators
+  //   Compress   - Unishox compression and decompression of a rule
+  //   ZclReport  - ZCLFrame parsing of a temperature attribute report to JSON
+  //   HsToRgb, RgbToHsb, XyToRgb - LightStateClass color conversions
+  uint32_t loops = (XdrvMailbox.payload > 0) ? XdrvMailbox.payload : 1000;
+  uint32_t start;
+  Response_P(PSTR("{\"%s\":{\"Loops\":%u"), XdrvMailbox.command, loops);
+
+  char command[CMDSZ];
+  char needle[CMDSZ];
+  int last = 0;
+  while (GetTextIndexed(needle, sizeof(needle), last +1, kTasmotaCommands)) {
+    if (!strlen(needle)) { break; }
+    last++;
+  }
+  GetTextIndexed(needle, sizeof(needle), last, kTasmotaCommands);
+  start = DebugBenchStart();
+  for (uint32_t i = 0; i < loops; i++) {
+    GetCommandCode(command, sizeof(command), needle, kTasmotaCommands);
+    if (!(i & 0xFF)) { yield(); }
+  }
+  DebugBenchResult(PSTR("Command"), loops, start);
+
+#ifdef USE_RULES
+  const char event_data[] = "{\"INA219\":{\"Voltage\":4.494,\"Current\":0.020,\"Power\":0.089},\"Switch1\":\"ON\"}";
+  char data[sizeof(event_data)];
+  struct RULES_EVENT event;
+  start = DebugBenchStart();
+  for (uint32_t i = 0; i < loops; i++) {
+    memcpy(data, event_data, sizeof(data));
+    RulesEventTokenize(event, data);
+    if (!(i & 0xFF)) { yield(); }
+  }
+  DebugBenchResult(PSTR("RuleEvent"), loops, start);
+
+  String rule = F("INA219#CURRENT>0.010");
+  String event_value = Rules.event_value;
+  bool teleperiod = Rules.teleperiod;
+  Rules.teleperiod = 0;
+  start = DebugBenchStart();
+  for (uint32_t i = 0; i < loops; i++) {
+    RulesRuleMatch(0, event, rule);
+    if (!(i & 0xFF)) { yield(); }
+  }
+  DebugBenchResult(PSTR("RuleMatch"), loops, start);
+  Rules.teleperiod = teleperiod;
+  Rules.event_value = event_value;     // Restore %value% of the rule being processed, if any
+
+#ifdef USE_EXPRESSION
+  const char expression[] = "(2 + 10.5) * 3 % 7 / 2 ^ 2 - 1";
+  start = DebugBenchStart();
+  for (uint32_t i = 0; i < loops; i++) {
+    evaluateExpression(expression, sizeof(expression) -1);
+    if (!(i & 0xFF)) { yield(); }
+  }
+  DebugBenchResult(PSTR("Expression"), loops, start);
+#endif  // USE_EXPRESSION
+#endif  // USE_RULES
+
+#ifdef USE_UNISHOX_COMPRESSION
+  const char text[] = "ON Power1#State=1 DO Backlog Delay 10; Power2 ON; Publish stat/kitchen/light ON ENDON";
+  char compressed[sizeof(text) + 8];
+  char decompressed[sizeof(text) + 8];
+  start = DebugBenchStart();
+  for (uint32_t i = 0; i < loops; i++) {
+    int32_t len = compressor.unishox_compress(text, sizeof(text) -1, compressed, sizeof(compressed));
+    if (len > 0) { compressor.unishox_decompress(compressed, len, decompressed, sizeof(decompressed)); }
+    if (!(i & 0xFF)) { yield(); }
+  }
+  DebugBenchResult(PSTR("Compress"), loops, start);
+#endif  // USE_UNISHOX_COMPRESSION
+
+#ifdef USE_ZIGBEE
+  // Temperature Measurement cluster report of attribute 0x0000 as int16 of 24.00 degrees
+  const char report_hex[] = "18010A0000296009";
+  SBuffer report = SBuffer::SBufferFromHex(report_hex, sizeof(report_hex) -1);
+  start = DebugBenchStart();
+  for (uint32_t i = 0; i < loops; i++) {
+    ZCLFrame zcl = ZCLFrame::parseRawFrame(report, 0, report.len(), 0x0402, 0, 0x1234, 1, 1, 0, 255, 0, 1, 0);
+    JsonParseBuffer jsonBuffer;
+    JsonObject& json = jsonBuffer.createObject();
+    zcl.parseReportAttributes(json);
+    if (!(i & 0xFF)) { yield(); }
+  }
+  DebugBenchResult(PSTR("ZclReport"), loops, start);
+#endif  // USE_ZIGBEE
+
+#ifdef USE_LIGHT
+  uint8_t r, g, b, sat, bri;
+  uint16_t hue;
+  float x, y;
+  start = DebugBenchStart();
+  for (uint32_t i = 0; i < loops; i++) {
+    LightStateClass::HsToRgb(i % 360, 200, &r, &g, &b);
+    if (!(i & 0xFF)) { yield(); }
+  }
+  DebugBenchResult(PSTR("HsToRgb"), loops, start);
+  start = DebugBenchStart();
+  for (uint32_t i = 0; i < loops; i++) {
+    LightStateClass::RgbToHsb(i, 255 - i, 128, &hue, &sat, &bri);
+    if (!(i & 0xFF)) { yield(); }
+  }
+  DebugBenchResult(PSTR("RgbToHsb"), loops, start);
+  LightStateClass::RgbToXy(255, 128, 64, &x, &y);
+  start = DebugBenchStart();
+  for (uint32_t i = 0; i < loops; i++) {
+    LightStateClass::XyToRgb(x, y, &r, &g, &b);
+    if (!(i & 0xFF)) { yield(); }
+  }
+  DebugBenchResult(PSTR("XyToRgb"), loops, start);
+#endif  // USE_LIGHT
+
+  ResponseJsonEndEnd();
+}
+
+void DebugStatsAdd(struct DEBUG_STATS *stats, uint32_t value)
+{
+  if (!stats->count || (value < stats->min)) { stats->min = value; }
+  if (value > stats->max) { stats->max = value; }
+  stats->total += value;
+  stats->count++;
+}
+
+void DebugStatsAppend(const char* name, struct DEBUG_STATS *stats)
+{
+  // Append microseconds as "name":{"Min":..,"Avg":..,"Max":..}
+  ResponseAppend_P(PSTR(",\"%s\":{\"Min\":%u,\"Avg\":%u,\"Max\":%u}"), name,
+    stats->min, (stats->count) ? stats->total / stats->count : 0, stats->max);
+}
+
+void CmndFlashBench(void)
+{
+  // FlashBench 3 - Time read, erase and write of a free flash sector
+  //   ESP8266 uses the OTA area just above the running firmware, ESP32 the next OTA partition
+  //   Writing is bounded by flash endurance so loops is limited to 10
+  uint32_t loops = ((XdrvMailbox.payload > 0) && (XdrvMailbox.payload <= 10)) ? XdrvMailbox.payload : 3;
+  uint32_t *buffer = (uint32_t*)malloc(SPI_FLASH_SEC_SIZE);
+  if (!buffer) { return; }
+#ifdef ESP8266
+  uint32_t sector = (ESP.getSketchSize() / SPI_FLASH_SEC_SIZE) + 1;
+  uint32_t address = sector * SPI_FLASH_SEC_SIZE;
+#else  // ESP32
+  const esp_partition_t *partition = esp_ota_get_next_update_partition(nullptr);
+  if (!partition) {
+    free(buffer);
+    ResponseCmndChar_P(PSTR("No OTA partition"));
+    return;
+  }
+  uint32_t sector = partition->address / SPI_FLASH_SEC_SIZE;
+#endif  // ESP8266 - ESP32
+  DEBUG_STATS read = { 0 };
+  DEBUG_STATS erase = { 0 };
+  DEBUG_STATS write = { 0 };
+  for (uint32_t i = 0; i < loops; i++) {
+    uint32_t start = DebugBenchStart();
+#ifdef ESP8266
+    ESP.flashRead(address, buffer, SPI_FLASH_SEC_SIZE);
+#else
+    esp_partition_read(partition, 0, buffer, SPI_FLASH_SEC_SIZE);
+#endif
+    DebugStatsAdd(&read, micros() - start);
+    start = DebugBenchStart();
+#ifdef ESP8266
+    ESP.flashEraseSector(sector);
+#else
+    esp_partition_erase_range(partition, 0, SPI_FLASH_SEC_SIZE);
+#endif
+    DebugStatsAdd(&erase, micros() - start);
+    memset(buffer, i, SPI_FLASH_SEC_SIZE);
+    start = DebugBenchStart();
+#ifdef ESP8266
+    ESP.flashWrite(address, buffer, SPI_FLASH_SEC_SIZE);
+#else
+    esp_partition_write(partition, 0, buffer, SPI_FLASH_SEC_SIZE);
+#endif
+    DebugStatsAdd(&write, micros() - start);
+  }
+  free(buffer);
+  Response_P(PSTR("{\"%s\":{\"Sector\":\"0x%X\",\"Loops\":%u"), XdrvMailbox.command, sector, loops);
+  DebugStatsAppend(PSTR("Read"), &read);
+  DebugStatsAppend(PSTR("Erase"), &erase);
+  DebugStatsAppend(PSTR("Write"), &write);
+  ResponseJsonEndEnd();
+}
+
+void CmndPwmBench(void)
+{
+  // PwmBench 1000 - Time analogWrite() updates of PWM1
+  if (!PinUsed(GPIO_PWM1)) {
+    ResponseCmndChar_P(PSTR("No PWM1"));
+    return;
+  }
+  uint32_t loops = (XdrvMailbox.payload > 0) ? XdrvMailbox.payload : 1000;
+  uint32_t pin = Pin(GPIO_PWM1);
+  uint32_t value = Settings.pwm_value[0];
+#ifdef USE_LIGHT
+  if (light_type) { value = changeUIntScale(Light.last_color[0], 0, 255, 0, Settings.pwm_range); }
+#endif  // USE_LIGHT
+  if (bitRead(pwm_inverted, 0)) { value = Settings.pwm_range - value; }
+  DEBUG_STATS update = { 0 };
+  for (uint32_t i = 0; i < loops; i++) {
+    uint32_t start = micros();
+    analogWrite(pin, value ^ (i & 1));       // Toggle the lowest bit so every call changes the duty cycle
+    DebugStatsAdd(&update, micros() - start);
+    if (!(i & 0xFF)) { yield(); }
+  }
+  analogWrite(pin, value);
+#ifdef USE_LIGHT
+  if (light_type) { Light.update = true; }   // Restore the exact light output
+#endif  // USE_LIGHT
+  Response_P(PSTR("{\"%s\":{\"Loops\":%u"), XdrvMailbox.command, loops);
+  DebugStatsAppend(PSTR("Update"), &update);
+  ResponseJsonEndEnd();
+}
+
+void CmndSerBench(void)
+{
+  // SerBench   - Show software serial receive interrupt time per byte since restart or reset
+  // SerBench 0 - Reset counters
+  Response_P(PSTR("{\"%s\":{"), XdrvMailbox.command);
+  bool first = true;
+  for (uint32_t i = 0; i < TM_SERIAL_MAX_INSTANCES; i++) {
+    TasmotaSerial *serial = TasmotaSerial::getInstance(i);
+    if (!serial || serial->hardwareSerial()) { continue; }
+    if (0 == XdrvMailbox.payload) { serial->resetIsrMetric(); }
+    uint32_t bytes = serial->getRxCount();
+    // Nanoseconds per byte from CPU cycles
+    uint32_t isr = (bytes) ? (uint32_t)(((uint64_t)serial->getIsrCycles() * 1000) / ((uint64_t)bytes * ESP.getCpuFreqMHz())) : 0;
+    ResponseAppend_P(PSTR("%s\"%d\":{\"Rx\":%d,\"Bytes\":%u,\"IsrNs\":%u,\"Overflow\":%u}"), (first) ? "" : ",",
+      i +1, serial->getRxPin(), bytes, isr, serial->getOverflowCount());
+    first = false;
+  }
+  ResponseJsonEndEnd();
+}
+
 void CmndFreemem(void)
 {
   if (XdrvMailbox.data_len > 0) {
@@ -643,10 +978,58 @@ void CmndI2cStretch(void)
 void CmndI2cClock(void)
 {
   if (i2c_flg && (XdrvMailbox.payload > 0)) {
-    Wire.setClock(XdrvMailbox.payload);
+    debug_i2c_clock = XdrvMailbox.payload;
+    Wire.setClock(debug_i2c_clock);
   }
   ResponseCmndDone();
 }
+
+void CmndI2cBench(void)
+{
+  // I2cBench <address>[,<loops>[,<stretch>]]
+  //   Time an address probe and a one byte read at 100, 400 and 800 kHz while applying clock stretch limit in uS (ESP8266)
+  //   Clock stretching by the device shows as a Max well above the Avg
+  if (!i2c_flg || (XdrvMailbox.data_len == 0)) {
+    ResponseCmndChar_P(PSTR("No I2C"));
+    return;
+  }
+  char *p;
+  uint32_t address = strtol(XdrvMailbox.data, &p, 16);
+  uint32_t loops = (',' == *p) ? strtol(p +1, &p, 10) : 0;
+  if (!loops) { loops = 100; }
+#ifdef ESP8266
+  uint32_t stretch = (',' == *p) ? strtol(p +1, &p, 10) : 0;
+  if (stretch) { Wire.setClockStretchLimit(stretch); }
+#endif  // ESP8266
+
+  const uint32_t clocks[] = { 100000, 400000, 800000 };
+  Response_P(PSTR("{\"%s\":{\"Address\":\"0x%02X\",\"Loops\":%u"), XdrvMailbox.command, address, loops);
+  for (uint32_t c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++) {
+    Wire.setClock(clocks[c]);
+    DEBUG_STATS probe = { 0 };
+    DEBUG_STATS read = { 0 };
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < loops; i++) {
+      uint32_t start = micros();
+      Wire.beginTransmission(address);
+      if (Wire.endTransmission()) { errors++; }
+      DebugStatsAdd(&probe, micros() - start);
+      start = micros();
+      if (Wire.requestFrom((uint8_t)address, (uint8_t)1) != 1) { errors++; }
+      while (Wire.available()) { Wire.read(); }
+      DebugStatsAdd(&read, micros() - start);
+      if (!(i & 0x1F)) { yield(); }
+    }
+    char name[12];
+    snprintf_P(name, sizeof(name), PSTR("%ukHz"), clocks[c] / 1000);
+    ResponseAppend_P(PSTR(",\"%s\":{\"Errors\":%u"), name, errors);
+    DebugStatsAppend(PSTR("Probe"), &probe);
+    DebugStatsAppend(PSTR("Read"), &read);
+    ResponseJsonEnd();
+  }
+  Wire.setClock(debug_i2c_clock);
+  ResponseJsonEndEnd();
+}
 #endif // USE_I2C
 
 /*********************************************************************************************\
@@ -666,6 +1049,7 @@ bool Xdrv99(uint8_t function)
       break;
     case FUNC_PRE_INIT:
       CPU_last_millis = millis();
+      XdrvSubscribe(FUNC_LOOP);
       break;
     case FUNC_COMMAND:
       result = DecodeCommand(kDebugCommands, DebugCommand);
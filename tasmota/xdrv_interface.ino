@@ -18,9 +18,9 @@
 */
 
 #ifdef XFUNC_PTR_IN_ROM
-bool (* const xdrv_func_ptr[])(uint8_t) PROGMEM = {   // Driver Function Pointers
+constexpr bool (* const xdrv_func_ptr[])(uint8_t) PROGMEM = {   // Driver Function Pointers
 #else
-bool (* const xdrv_func_ptr[])(uint8_t) = {   // Driver Function Pointers
+constexpr bool (* const xdrv_func_ptr[])(uint8_t) = {   // Driver Function Pointers
 #endif
 
 #ifdef XDRV_01
@@ -421,15 +421,17 @@ bool (* const xdrv_func_ptr[])(uint8_t) = {   // Driver Function Pointers
 };
 
 const uint8_t xdrv_present = sizeof(xdrv_func_ptr) / sizeof(xdrv_func_ptr[0]);  // Number of drivers found
+uint8_t xdrv_polled[xdrv_present] = { 0 };        // Polled functions subscribed by each driver
+uint8_t xdrv_subscribe_index = 0;                 // Index of driver calling XdrvSubscribe() during init
 
 /*********************************************************************************************\
  * Xdrv available list
 \*********************************************************************************************/
 
 #ifdef XFUNC_PTR_IN_ROM
-const uint8_t kXdrvList[] PROGMEM = {
+constexpr uint8_t kXdrvList[] PROGMEM = {
 #else
-const uint8_t kXdrvList[] = {
+constexpr uint8_t kXdrvList[] = {
 #endif
 
 #ifdef XDRV_01
@@ -845,11 +847,33 @@ void XsnsDriverState(void)
   ResponseAppend_P(PSTR("\""));
 }
 
+uint32_t XdrvPresent(void)
+{
+  return xdrv_present;
+}
+
+uint32_t XdrvId(uint32_t index)
+{
+#ifdef XFUNC_PTR_IN_ROM
+  return pgm_read_byte(kXdrvList + index);
+#else
+  return kXdrvList[index];
+#endif
+}
+
+constexpr uint32_t XdrvIndexOf(uint32_t driver, uint32_t index)
+{
+  // Returns index of driver in xdrv_func_ptr[] or xdrv_present if not compiled in
+  // Used with a constant driver id in a constexpr it costs nothing at runtime
+  return (index >= sizeof(kXdrvList)) ? xdrv_present : (kXdrvList[index] == driver) ? index : XdrvIndexOf(driver, index +1);
+}
+
 /*********************************************************************************************/
 
 bool XdrvRulesProcess(void)
 {
-  return XdrvCallDriver(10, FUNC_RULES_PROCESS);
+  constexpr uint32_t rules = XdrvIndexOf(10, 0);  // Direct call to Xdrv10() if present
+  return (rules < xdrv_present) ? XdrvCallOne(rules, FUNC_RULES_PROCESS) : false;
 }
 
 #ifdef USE_DEBUG_DRIVER
@@ -857,17 +881,64 @@ void ShowFreeMem(const char *where)
 {
   char stemp[30];
   snprintf_P(stemp, sizeof(stemp), where);
+  HeapSample();
   XdrvMailbox.data = stemp;
   XdrvCall(FUNC_FREE_MEM);
 }
 #endif
 
+/*********************************************************************************************\
+ * Polled function subscription
+ *
+ * Polled functions FUNC_LOOP up to FUNC_EVERY_250_MSECOND are only passed to drivers that
+ * subscribed to them using XdrvSubscribe() while handling FUNC_PRE_INIT or FUNC_INIT
+\*********************************************************************************************/
+
+uint32_t XfuncPolledMask(uint32_t function)
+{
+  if ((function >= FUNC_LOOP) && (function <= FUNC_EVERY_250_MSECOND)) {
+    return 1 << (function - FUNC_LOOP);
+  }
+  return 0;
+}
+
+void XdrvSubscribe(uint32_t function)
+{
+  xdrv_polled[xdrv_subscribe_index] |= XfuncPolledMask(function);
+}
+
 /*********************************************************************************************\
  * Function call to single xdrv
 \*********************************************************************************************/
 
+bool XdrvCallOne(uint32_t x, uint8_t Function)
+{
+  // Every call to a driver goes through here so profiler, trace and crash recorder see it
+#if defined(USE_PROFILER) || defined(USE_LOOP_STATS)
+  uint32_t profile_start = micros();
+#endif  // USE_PROFILER || USE_LOOP_STATS
+  TRACE_EVENT(TRACE_DRIVER, TRACE_BEGIN, (x << 8) | Function);
+#ifdef ESP8266
+  uint32_t crash_call_previous = crash_call;
+  crash_call = CRASH_CALL_DRIVER | (x << 8) | Function;  // Saved by the crash recorder
+#endif  // ESP8266
+  bool result = xdrv_func_ptr[x](Function);
+#ifdef ESP8266
+  crash_call = crash_call_previous;
+#endif  // ESP8266
+  TRACE_EVENT(TRACE_DRIVER, TRACE_END, (x << 8) | Function);
+#ifdef USE_PROFILER
+  ProfileFunction(PROFILE_DRIVER, x, Function, profile_start);
+#endif  // USE_PROFILER
+#ifdef USE_LOOP_STATS
+  LoopStatsFunction(false, x, Function, profile_start);
+#endif  // USE_LOOP_STATS
+  return result;
+}
+
 bool XdrvCallDriver(uint32_t driver, uint8_t Function)
 {
+  // Use XdrvIndexOf() in a constexpr when the driver id is a constant
   for (uint32_t x = 0; x < xdrv_present; x++) {
 #ifdef XFUNC_PTR_IN_ROM
     uint32_t listed = pgm_read_byte(kXdrvList + x);
@@ -875,12 +946,20 @@ bool XdrvCallDriver(uint32_t driver, uint8_t Function)
     uint32_t listed = kXdrvList[x];
 #endif
     if (driver == listed) {
-      return xdrv_func_ptr[x](Function);
+      return XdrvCallOne(x, Function);
     }
   }
   return false;
 }
 
+bool XdrvCallIndex(uint32_t index, uint8_t Function)
+{
+  if (index < xdrv_present) {
+    return XdrvCallOne(index, Function);
+  }
+  return false;
+}
+
 /*********************************************************************************************\
  * Function call to all xdrv
 \*********************************************************************************************/
@@ -891,8 +970,14 @@ bool XdrvCall(uint8_t Function)
 
   DEBUG_TRACE_LOG(PSTR("DRV: %d"), Function);
 
+  uint32_t polled = XfuncPolledMask(Function);
+  bool subscribe = ((FUNC_PRE_INIT == Function) || (FUNC_INIT == Function));
+
   for (uint32_t x = 0; x < xdrv_present; x++) {
-    result = xdrv_func_ptr[x](Function);
+    if (polled && !(xdrv_polled[x] & polled)) { continue; }  // Skip drivers not interested in this polled function
+    if (subscribe) { xdrv_subscribe_index = x; }
+
+    result = XdrvCallOne(x, Function);
 
     if (result && ((FUNC_COMMAND == Function) ||
                    (FUNC_COMMAND_DRIVER == Function) ||
@@ -905,6 +990,7 @@ bool XdrvCall(uint8_t Function)
                    (FUNC_PIN_STATE == Function) ||
                    (FUNC_SET_DEVICE_POWER == Function)
                   )) {
+      xfunc_command_index = x;
       break;
     }
   }
@@ -90,7 +90,7 @@ void EpdInitDriver29()
     // Welcome text
     renderer->setTextFont(1);
     renderer->DrawStringAt(50, 50, "Waveshare E-Paper Display!", COLORED,0);
-    renderer->Updateframe();
+    epd->RefreshFrame();
     delay(1000);
     renderer->fillScreen(0);
 #endif
@@ -194,6 +194,9 @@ bool Xdsp05(uint8_t function)
         case FUNC_DISPLAY_MODEL:
           result = true;
           break;
+        case FUNC_DISPLAY_EVERY_50_MSECOND:
+          if (renderer) { epd->Loop(); }
+          break;
 #ifdef USE_DISPLAY_MODES1TO5
         case FUNC_DISPLAY_EVERY_SECOND:
           EpdRefresh29();
@@ -92,15 +92,14 @@ void EpdInitDriver42()
     renderer->DisplayInit(DISPLAY_INIT_MODE,Settings.display_size,Settings.display_rotate,Settings.display_font);
 
     epd42->ClearFrame();
-    renderer->Updateframe();
-    delay(3000);
+    epd42->RefreshFrame();
     renderer->setTextColor(1,0);
 
 #ifdef SHOW_SPLASH
     // Welcome text
     renderer->setTextFont(2);
     renderer->DrawStringAt(50, 140, "Waveshare E-Paper!", COLORED42,0);
-    renderer->Updateframe();
+    epd42->RefreshFrame();
     delay(350);
     renderer->fillScreen(0);
 #endif
@@ -143,6 +142,9 @@ bool Xdsp06(uint8_t function)
         case FUNC_DISPLAY_MODEL:
           result = true;
           break;
+        case FUNC_DISPLAY_EVERY_50_MSECOND:
+          if (renderer) { epd42->Loop(); }
+          break;
 
 #ifdef USE_DISPLAY_MODES1TO5
         case FUNC_DISPLAY_EVERY_SECOND:
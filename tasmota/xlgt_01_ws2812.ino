@@ -33,6 +33,8 @@
  *  6            yes     no         no          Rainbow
  *  7            yes     no         no          Fire
  *
+ * With USE_WS2812_STREAM command Stream 1..63999 receives E1.31 and Art-Net DMX universes
+ * starting at that universe into the strip, Stream 0 disables the receiver.
 \*********************************************************************************************/
 
 #define XLGT_01             1
@@ -40,10 +42,18 @@
 const uint8_t WS2812_SCHEMES = 8;      // Number of WS2812 schemes
 
 const char kWs2812Commands[] PROGMEM = "|"  // No prefix
-  D_CMND_LED "|" D_CMND_PIXELS "|" D_CMND_ROTATION "|" D_CMND_WIDTH ;
+  D_CMND_LED "|" D_CMND_PIXELS "|" D_CMND_ROTATION "|" D_CMND_WIDTH
+#ifdef USE_WS2812_STREAM
+  "|" D_CMND_STREAM
+#endif  // USE_WS2812_STREAM
+  ;
 
 void (* const Ws2812Command[])(void) PROGMEM = {
-  &CmndLed, &CmndPixels, &CmndRotation, &CmndWidth };
+  &CmndLed, &CmndPixels, &CmndRotation, &CmndWidth
+#ifdef USE_WS2812_STREAM
+  , &CmndStream
+#endif  // USE_WS2812_STREAM
+  };
 
 #include <NeoPixelBus.h>
 
@@ -61,6 +71,134 @@ void (* const Ws2812Command[])(void) PROGMEM = {
   typedef NeoRgbFeature selectedNeoFeatureType;
 #endif  // USE_WS2812_CTYPE
 
+typedef selectedNeoFeatureType::ColorObject Ws2812Color;
+
+#ifdef ESP32
+
+// See NeoEsp32RmtMethod.h for available options. Every strip uses its own RMT channel
+#if (USE_WS2812_HARDWARE == NEO_HW_WS2812X)
+  #define WS2812_RMT_METHOD(ch)  NeoEsp32Rmt ## ch ## Ws2812xMethod
+#elif (USE_WS2812_HARDWARE == NEO_HW_SK6812)
+  #define WS2812_RMT_METHOD(ch)  NeoEsp32Rmt ## ch ## Sk6812Method
+#elif (USE_WS2812_HARDWARE == NEO_HW_APA106)
+  #define WS2812_RMT_METHOD(ch)  NeoEsp32Rmt ## ch ## Apa106Method
+#else   // USE_WS2812_HARDWARE
+  #define WS2812_RMT_METHOD(ch)  NeoEsp32Rmt ## ch ## 800KbpsMethod
+#endif  // USE_WS2812_HARDWARE
+
+class Ws2812Bus {
+public:
+  virtual ~Ws2812Bus() {}
+  virtual void Begin(void) = 0;
+  virtual void Show(void) = 0;
+  virtual void ClearTo(Ws2812Color color) = 0;
+  virtual void SetPixelColor(uint16_t index, Ws2812Color color) = 0;
+  virtual Ws2812Color GetPixelColor(uint16_t index) = 0;
+  virtual void SetOutputLut(const uint8_t *lut) = 0;
+  virtual uint8_t *Pixels(void) = 0;
+  virtual void Dirty(void) = 0;
+};
+
+template <typename T_METHOD> class Ws2812RmtBus : public Ws2812Bus {
+public:
+  Ws2812RmtBus(uint16_t pixels, uint8_t pin) : _bus(pixels, pin) {}
+  void Begin(void) { _bus.Begin(); }
+  void Show(void) { _bus.Show(); }
+  void ClearTo(Ws2812Color color) { _bus.ClearTo(color); }
+  void SetPixelColor(uint16_t index, Ws2812Color color) { _bus.SetPixelColor(index, color); }
+  Ws2812Color GetPixelColor(uint16_t index) { return _bus.GetPixelColor(index); }
+  void SetOutputLut(const uint8_t *lut) { _bus.SetOutputLut(lut); }
+  uint8_t *Pixels(void) { return _bus.Pixels(); }
+  void Dirty(void) { _bus.Dirty(); }
+private:
+  NeoPixelBus<selectedNeoFeatureType, T_METHOD> _bus;
+};
+
+/*********************************************************************************************\
+ * Up to MAX_WS2812_STRIPS strips on GPIO WS2812 1..4 addressed as one logical pixel space.
+ * Pixels are split evenly over the strips, Pixels 1200 with four strips drives 300 leds on each.
+ * Show() starts an asynchronous RMT transmission per strip so all strips are sent concurrently.
+\*********************************************************************************************/
+
+class Ws2812Strips {
+public:
+  Ws2812Strips(void) : _count(0), _segment(WS2812_MAX_LEDS) {}
+
+  ~Ws2812Strips(void) {
+    for (uint32_t i = 0; i < _count; i++) { delete _bus[i]; }
+  }
+
+  bool Add(uint8_t pin) {
+    Ws2812Bus *bus = nullptr;
+    switch (_count) {
+      case 0: bus = new Ws2812RmtBus<WS2812_RMT_METHOD(0)>(WS2812_MAX_LEDS, pin); break;
+      case 1: bus = new Ws2812RmtBus<WS2812_RMT_METHOD(1)>(WS2812_MAX_LEDS, pin); break;
+      case 2: bus = new Ws2812RmtBus<WS2812_RMT_METHOD(2)>(WS2812_MAX_LEDS, pin); break;
+      case 3: bus = new Ws2812RmtBus<WS2812_RMT_METHOD(3)>(WS2812_MAX_LEDS, pin); break;
+    }
+    if (!bus) { return false; }
+    _bus[_count++] = bus;
+    return true;
+  }
+
+  uint32_t Count(void) const { return _count; }
+
+  void SetLength(uint16_t pixels) {
+    _segment = (_count) ? (pixels + _count -1) / _count : WS2812_MAX_LEDS;
+    if (!_segment) { _segment = 1; }
+  }
+
+  void Begin(void) {
+    for (uint32_t i = 0; i < _count; i++) { _bus[i]->Begin(); }
+  }
+
+  void Show(void) {
+    for (uint32_t i = 0; i < _count; i++) { _bus[i]->Show(); }
+  }
+
+  void ClearTo(Ws2812Color color) {
+    for (uint32_t i = 0; i < _count; i++) { _bus[i]->ClearTo(color); }
+  }
+
+  void SetPixelColor(uint16_t index, Ws2812Color color) {
+    uint32_t i = index / _segment;
+    if (i < _count) { _bus[i]->SetPixelColor(index % _segment, color); }
+  }
+
+  Ws2812Color GetPixelColor(uint16_t index) {
+    uint32_t i = index / _segment;
+    return (i < _count) ? _bus[i]->GetPixelColor(index % _segment) : Ws2812Color(0);
+  }
+
+  void SetOutputLut(const uint8_t *lut) {
+    for (uint32_t i = 0; i < _count; i++) { _bus[i]->SetOutputLut(lut); }
+  }
+
+  // Pixel buffer of pixel index and the number of pixels up to the end of its strip
+  uint8_t *Pixels(uint16_t index, uint16_t *count) {
+    uint32_t i = index / _segment;
+    if (i >= _count) {
+      *count = 0;
+      return nullptr;
+    }
+    *count = _segment - index % _segment;
+    return _bus[i]->Pixels() + (index % _segment) * selectedNeoFeatureType::PixelSize;
+  }
+
+  void Dirty(void) {
+    for (uint32_t i = 0; i < _count; i++) { _bus[i]->Dirty(); }
+  }
+
+private:
+  Ws2812Bus *_bus[MAX_WS2812_STRIPS];
+  uint32_t _count;
+  uint16_t _segment;                   // Logical pixels per strip
+};
+
+Ws2812Strips *strip = nullptr;
+
+#else   // ESP8266
+
 #ifdef USE_WS2812_DMA
 
 // See NeoEspDmaMethod.h for available options
@@ -89,6 +227,8 @@ void (* const Ws2812Command[])(void) PROGMEM = {
 
 NeoPixelBus<selectedNeoFeatureType, selectedNeoSpeedType> *strip = nullptr;
 
+#endif  // ESP8266 - ESP32
+
 struct WsColor {
   uint8_t red, green, blue;
 };
@@ -128,6 +268,14 @@ uint8_t kWsRepeat[5] = {
     1 };   // All
 
 struct WS2812 {
+  uint8_t *gamma_lut = nullptr;      // Gamma table applied by NeoPixelBus while sending, pixel buffer stays linear
+  WsColor *frame = nullptr;          // Scheme frame buffer, only changed pixels are copied to the strip
+  uint16_t frame_size = 0;
+  uint16_t frame_first = 0;          // Pixel range written in the current frame
+  uint16_t frame_last = 0;
+  uint16_t shown_first = 0;          // Pixel range written in the previous frame
+  uint16_t shown_last = 0;
+  bool frame_valid = false;          // Strip holds the previous frame, pixels outside shown range are black
   uint8_t show_next = 1;
   uint8_t scheme_offset = 0;
   bool suspend_update = false;
@@ -136,28 +284,115 @@ struct WS2812 {
 /********************************************************************************************/
 
 void Ws2812StripShow(void)
+{
+  if (Settings.light_correction != (Ws2812.gamma_lut != nullptr)) {
+    if (Settings.light_correction) {
+      Ws2812.gamma_lut = (uint8_t*)malloc(256);
+      if (Ws2812.gamma_lut) {
+        for (uint32_t i = 0; i < 256; i++) {
+          Ws2812.gamma_lut[i] = ledGamma(i);
+        }
+      }
+    } else {
+      free(Ws2812.gamma_lut);
+      Ws2812.gamma_lut = nullptr;
+    }
+    strip->SetOutputLut(Ws2812.gamma_lut);
+  }
+  strip->Show();
+}
+
+/*********************************************************************************************\
+ * Scheme frame buffer
+ *
+ * Schemes render a frame with Ws2812FrameSet() and blend layers on top with Ws2812FrameAdd().
+ * Ws2812FrameShow() only compares the pixel range written in this and the previous frame with
+ * the strip and updates changed pixels. An unchanged frame leaves the strip clean so Show()
+ * is skipped by NeoPixelBus.
+\*********************************************************************************************/
+
+bool Ws2812FrameBegin(void)
+{
+  if (Ws2812.frame_size != Settings.light_pixels) {
+    free(Ws2812.frame);
+    Ws2812.frame = (WsColor*)calloc(Settings.light_pixels, sizeof(WsColor));
+    Ws2812.frame_size = (Ws2812.frame) ? Settings.light_pixels : 0;
+    Ws2812.frame_valid = false;
+  }
+  else if (Ws2812.frame_last > Ws2812.frame_first) {
+    memset(&Ws2812.frame[Ws2812.frame_first], 0, (Ws2812.frame_last - Ws2812.frame_first) * sizeof(WsColor));
+  }
+  Ws2812.frame_first = Ws2812.frame_size;
+  Ws2812.frame_last = 0;
+  return (Ws2812.frame != nullptr);
+}
+
+void Ws2812FrameFree(void)
+{
+  free(Ws2812.frame);
+  Ws2812.frame = nullptr;
+  Ws2812.frame_size = 0;
+  Ws2812.frame_valid = false;
+}
+
+void Ws2812FrameMark(uint32_t index)
+{
+  if (index < Ws2812.frame_first) { Ws2812.frame_first = index; }
+  if (index >= Ws2812.frame_last) { Ws2812.frame_last = index +1; }
+}
+
+void Ws2812FrameSet(uint32_t index, struct WsColor color)
+{
+  if (index >= Ws2812.frame_size) { return; }
+  Ws2812.frame[index] = color;
+  Ws2812FrameMark(index);
+}
+
+void Ws2812FrameAdd(uint32_t index, struct WsColor color)
+{
+  if (index >= Ws2812.frame_size) { return; }
+  WsColor *pixel = &Ws2812.frame[index];
+  pixel->red = tmin(pixel->red + color.red, 255);
+  pixel->green = tmin(pixel->green + color.green, 255);
+  pixel->blue = tmin(pixel->blue + color.blue, 255);
+  Ws2812FrameMark(index);
+}
+
+void Ws2812FrameShow(void)
 {
 #if (USE_WS2812_CTYPE > NEO_3LED)
   RgbwColor c;
+  c.W = 0;
 #else
   RgbColor c;
 #endif
 
-  if (Settings.light_correction) {
-    for (uint32_t i = 0; i < Settings.light_pixels; i++) {
-      c = strip->GetPixelColor(i);
-      c.R = ledGamma(c.R);
-      c.G = ledGamma(c.G);
-      c.B = ledGamma(c.B);
-#if (USE_WS2812_CTYPE > NEO_3LED)
-      c.W = ledGamma(c.W);
-#endif
-      strip->SetPixelColor(i, c);
+  uint32_t first = Ws2812.frame_first;
+  uint32_t last = Ws2812.frame_last;
+  if (!Ws2812.frame_valid) {
+    first = 0;
+    last = Ws2812.frame_size;
+  } else if (Ws2812.shown_last > Ws2812.shown_first) {
+    first = tmin(first, Ws2812.shown_first);
+    last = tmax(last, Ws2812.shown_last);
+  }
+  for (uint32_t i = first; i < last; i++) {
+    c.R = Ws2812.frame[i].red;
+    c.G = Ws2812.frame[i].green;
+    c.B = Ws2812.frame[i].blue;
+    if (!(strip->GetPixelColor(i) == c)) {
+      strip->SetPixelColor(i, c);     // Marks strip dirty
     }
   }
-  strip->Show();
+  Ws2812.shown_first = Ws2812.frame_first;
+  Ws2812.shown_last = Ws2812.frame_last;
+  Ws2812.frame_valid = true;
+
+  Ws2812StripShow();
 }
 
+/********************************************************************************************/
+
 int mod(int a, int b)
 {
    int ret = a % b;
@@ -167,20 +402,14 @@ int mod(int a, int b)
 
 void Ws2812UpdatePixelColor(int position, struct WsColor hand_color, float offset)
 {
-#if (USE_WS2812_CTYPE > NEO_3LED)
-  RgbwColor color;
-#else
-  RgbColor color;
-#endif
-
   uint32_t mod_position = mod(position, (int)Settings.light_pixels);
 
-  color = strip->GetPixelColor(mod_position);
   float dimmer = 100 / (float)Settings.light_dimmer;
-  color.R = tmin(color.R + ((hand_color.red / dimmer) * offset), 255);
-  color.G = tmin(color.G + ((hand_color.green / dimmer) * offset), 255);
-  color.B = tmin(color.B + ((hand_color.blue / dimmer) * offset), 255);
-  strip->SetPixelColor(mod_position, color);
+  WsColor color;
+  color.red = tmin((hand_color.red / dimmer) * offset, 255);
+  color.green = tmin((hand_color.green / dimmer) * offset, 255);
+  color.blue = tmin((hand_color.blue / dimmer) * offset, 255);
+  Ws2812FrameAdd(mod_position, color);
 }
 
 void Ws2812UpdateHand(int position, uint32_t index)
@@ -208,7 +437,7 @@ void Ws2812UpdateHand(int position, uint32_t index)
 
 void Ws2812Clock(void)
 {
-  strip->ClearTo(0); // Reset strip
+  if (!Ws2812FrameBegin()) { return; }  // Reset frame
   int clksize = 60000 / (int)Settings.light_pixels;
 
   Ws2812UpdateHand((RtcTime.second * 1000) / clksize, WS_SECOND);
@@ -220,7 +449,7 @@ void Ws2812Clock(void)
     }
   }
 
-  Ws2812StripShow();
+  Ws2812FrameShow();
 }
 
 void Ws2812GradientColor(uint32_t schemenr, struct WsColor* mColor, uint32_t range, uint32_t gradRange, uint32_t i)
@@ -255,15 +484,9 @@ void Ws2812Gradient(uint32_t schemenr)
  * Display a gradient of colors for the current color scheme.
  *  Repeat is the number of repetitions of the gradient (pick a multiple of 2 for smooth looping of the gradient).
  */
-#if (USE_WS2812_CTYPE > NEO_3LED)
-  RgbwColor c;
-  c.W = 0;
-#else
-  RgbColor c;
-#endif
-
   ColorScheme scheme = kSchemes[schemenr];
   if (scheme.count < 2) { return; }
+  if (!Ws2812FrameBegin()) { return; }
 
   uint32_t repeat = kWsRepeat[Settings.light_width];  // number of scheme.count per ledcount
   uint32_t range = (uint32_t)ceil((float)Settings.light_pixels / (float)repeat);
@@ -271,7 +494,7 @@ void Ws2812Gradient(uint32_t schemenr)
   uint32_t speed = ((Settings.light_speed * 2) -1) * (STATES / 10);
   uint32_t offset = speed > 0 ? Light.strip_timer_counter / speed : 0;
 
-  WsColor oldColor, currentColor;
+  WsColor oldColor, currentColor, c;
   Ws2812GradientColor(schemenr, &oldColor, range, gradRange, offset);
   currentColor = oldColor;
   for (uint32_t i = 0; i < Settings.light_pixels; i++) {
@@ -280,20 +503,18 @@ void Ws2812Gradient(uint32_t schemenr)
     }
     if (Settings.light_speed > 0) {
       // Blend old and current color based on time for smooth movement.
-      c.R = map(Light.strip_timer_counter % speed, 0, speed, oldColor.red, currentColor.red);
-      c.G = map(Light.strip_timer_counter % speed, 0, speed, oldColor.green, currentColor.green);
-      c.B = map(Light.strip_timer_counter % speed, 0, speed, oldColor.blue, currentColor.blue);
+      c.red = map(Light.strip_timer_counter % speed, 0, speed, oldColor.red, currentColor.red);
+      c.green = map(Light.strip_timer_counter % speed, 0, speed, oldColor.green, currentColor.green);
+      c.blue = map(Light.strip_timer_counter % speed, 0, speed, oldColor.blue, currentColor.blue);
     }
     else {
       // No animation, just use the current color.
-      c.R = currentColor.red;
-      c.G = currentColor.green;
-      c.B = currentColor.blue;
+      c = currentColor;
     }
-    strip->SetPixelColor(i, c);
+    Ws2812FrameSet(i, c);
     oldColor = currentColor;
   }
-  Ws2812StripShow();
+  Ws2812FrameShow();
 }
 
 void Ws2812Bars(uint32_t schemenr)
@@ -303,14 +524,8 @@ void Ws2812Bars(uint32_t schemenr)
  * Display solid bars of color for the current color scheme.
  * Width is the width of each bar in pixels/lights.
  */
-#if (USE_WS2812_CTYPE > NEO_3LED)
-  RgbwColor c;
-  c.W = 0;
-#else
-  RgbColor c;
-#endif
-
   ColorScheme scheme = kSchemes[schemenr];
+  if (!Ws2812FrameBegin()) { return; }
 
   uint32_t maxSize = Settings.light_pixels / scheme.count;
   if (kWidth[Settings.light_width] > maxSize) { maxSize = 0; }
@@ -332,18 +547,16 @@ void Ws2812Bars(uint32_t schemenr)
   uint32_t colorIndex = offset % scheme.count;
   for (uint32_t i = 0; i < Settings.light_pixels; i++) {
     if (maxSize) { colorIndex = ((i + offset) % (scheme.count * kWidth[Settings.light_width])) / kWidth[Settings.light_width]; }
-    c.R = mcolor[colorIndex].red;
-    c.G = mcolor[colorIndex].green;
-    c.B = mcolor[colorIndex].blue;
-    strip->SetPixelColor(i, c);
+    Ws2812FrameSet(i, mcolor[colorIndex]);
   }
-  Ws2812StripShow();
+  Ws2812FrameShow();
 }
 
 void Ws2812Clear(void)
 {
   strip->ClearTo(0);
   strip->Show();
+  Ws2812.frame_valid = false;
   Ws2812.show_next = 1;
 }
 
@@ -359,6 +572,7 @@ void Ws2812SetColor(uint32_t led, uint8_t red, uint8_t green, uint8_t blue, uint
   lcolor.R = red;
   lcolor.G = green;
   lcolor.B = blue;
+  Ws2812.frame_valid = false;
   if (led) {
     strip->SetPixelColor(led -1, lcolor);  // Led 1 is strip Led 0 -> substract offset 1
   } else {
@@ -398,6 +612,259 @@ char* Ws2812GetColor(uint32_t led, char* scolor)
   return scolor;
 }
 
+#ifdef USE_WS2812_STREAM
+/*********************************************************************************************\
+ * E1.31 (sACN) and Art-Net receiver
+ *
+ * DMX data of universes Settings.ws2812_stream_universe and up is read from the UDP packet
+ * straight into the NeoPixelBus pixel buffer and reordered in place to the strip color order.
+ * A universe carries 170 RGB or 128 RGBW pixels. The strip is shown once all universes
+ * covering Pixels arrived or a universe repeats. Without packets for WS2812_STREAM_TIMEOUT
+ * mSeconds, or on an E1.31 stream terminated packet, control returns to LightAnimate().
+\*********************************************************************************************/
+
+#include <lwip/igmp.h>
+
+#define WS2812_STREAM_E131_PORT      5568
+#define WS2812_STREAM_ARTNET_PORT    6454
+#ifndef WS2812_STREAM_TIMEOUT
+#define WS2812_STREAM_TIMEOUT        2500   // mSeconds, E1.31 network data loss timeout
+#endif
+
+const uint8_t WS2812_STREAM_UNIVERSES = 16;
+const uint16_t WS2812_STREAM_UNIVERSE_PIXELS = 512 / selectedNeoFeatureType::PixelSize;
+const uint8_t WS2812_STREAM_E131_HEADER = 126;
+const uint8_t WS2812_STREAM_ARTNET_HEADER = 18;
+
+enum Ws2812StreamSources { WS2812_STREAM_E131, WS2812_STREAM_ARTNET, WS2812_STREAM_SOURCES };
+
+const char kWs2812StreamE131Id[] PROGMEM = "ASC-E1.17\0\0";
+const char kWs2812StreamArtnetId[] PROGMEM = "Art-Net";
+
+WiFiUDP Ws2812StreamUdp[WS2812_STREAM_SOURCES];
+
+struct WS2812_STREAM {
+  uint32_t packets = 0;                 // Received DMX packets within our universes
+  uint32_t dropped = 0;                 // Packets missing according to sequence numbers
+  uint32_t late = 0;                    // Out of order packets discarded
+  uint32_t frames = 0;                  // Frames shown
+  uint32_t timeout = 0;                 // millis() at which the stream is considered lost
+  uint32_t received = 0;                // Universes received in the current frame
+  uint32_t retry = 0;                   // millis() at which to retry opening the ports
+  uint8_t sequence[WS2812_STREAM_UNIVERSES];
+  uint8_t universes = 0;                // Number of universes joined
+  bool up = false;
+} Ws2812Stream;
+
+uint32_t Ws2812StreamUniverses(void)
+{
+  uint32_t universes = (Settings.light_pixels + WS2812_STREAM_UNIVERSE_PIXELS -1) / WS2812_STREAM_UNIVERSE_PIXELS;
+  return tmin(universes, WS2812_STREAM_UNIVERSES);
+}
+
+void Ws2812StreamGroup(uint32_t index, uint32_t join)
+{
+  uint32_t universe = Settings.ws2812_stream_universe + index;
+  ip4_addr_t ifaddr;
+  ip4_addr_t group;
+  ifaddr.addr = (uint32_t)WiFi.localIP();
+  group.addr = (uint32_t)IPAddress(239, 255, universe >> 8, universe & 0xFF);
+  if (join) {
+    igmp_joingroup(&ifaddr, &group);
+  } else {
+    igmp_leavegroup(&ifaddr, &group);
+  }
+}
+
+void Ws2812StreamShow(void)
+{
+  strip->Dirty();
+  Ws2812StripShow();
+  Ws2812Stream.received = 0;
+  Ws2812Stream.frames++;
+}
+
+void Ws2812StreamEnd(void)
+{
+  // Return the strip to LightAnimate() control
+  if (!Light.stream) { return; }
+  if (Ws2812Stream.received) {
+    Ws2812StreamShow();                 // Show a partial last frame
+  }
+  Light.stream = false;
+  Light.update = true;                  // Restore the light state
+  Ws2812.frame_valid = false;
+  Ws2812.show_next = 1;
+}
+
+void Ws2812StreamStop(void)
+{
+  if (Ws2812Stream.up) {
+    for (uint32_t i = 0; i < Ws2812Stream.universes; i++) {
+      Ws2812StreamGroup(i, 0);
+    }
+    for (uint32_t i = 0; i < WS2812_STREAM_SOURCES; i++) {
+      Ws2812StreamUdp[i].stop();
+    }
+    Ws2812Stream.up = false;
+  }
+  Ws2812StreamEnd();
+}
+
+void Ws2812StreamStart(void)
+{
+  if (Ws2812Stream.up || !Settings.ws2812_stream_universe || global_state.wifi_down) { return; }
+  if (!TimeReached(Ws2812Stream.retry)) { return; }
+
+  if (!Ws2812StreamUdp[WS2812_STREAM_E131].begin(WS2812_STREAM_E131_PORT) ||
+      !Ws2812StreamUdp[WS2812_STREAM_ARTNET].begin(WS2812_STREAM_ARTNET_PORT)) {
+    Ws2812StreamUdp[WS2812_STREAM_E131].stop();
+    AddLog_P2(LOG_LEVEL_ERROR, PSTR("WS2: Stream ports unavailable"));
+    Ws2812Stream.retry = millis() + 10000;
+    return;
+  }
+  Ws2812Stream.universes = Ws2812StreamUniverses();
+  for (uint32_t i = 0; i < Ws2812Stream.universes; i++) {
+    Ws2812StreamGroup(i, 1);           // E1.31 multicast 239.255.<universe>
+  }
+  memset(Ws2812Stream.sequence, 0, sizeof(Ws2812Stream.sequence));
+  Ws2812Stream.received = 0;
+  Ws2812Stream.up = true;
+  AddLog_P2(LOG_LEVEL_INFO, PSTR("WS2: Stream universe %d to %d"),
+    Settings.ws2812_stream_universe, Settings.ws2812_stream_universe + Ws2812Stream.universes -1);
+}
+
+uint8_t *Ws2812StreamPixels(uint32_t index, uint32_t *count)
+{
+#ifdef ESP32
+  uint16_t pixels;
+  uint8_t *buffer = strip->Pixels(index, &pixels);
+  *count = pixels;
+  return buffer;
+#else
+  *count = WS2812_MAX_LEDS - index;
+  return strip->Pixels() + index * selectedNeoFeatureType::PixelSize;
+#endif  // ESP32
+}
+
+bool Ws2812StreamSequence(uint32_t index, uint32_t sequence)
+{
+  // Returns false if the packet is older than the last one of this universe
+  if (sequence) {                       // Art-Net uses sequence 0 when disabled
+    int8_t diff = sequence - Ws2812Stream.sequence[index];
+    if (Ws2812Stream.sequence[index] && (diff <= 0) && (diff > -20)) {
+      Ws2812Stream.late++;
+      return false;
+    }
+    if (Ws2812Stream.sequence[index] && (diff > 1)) {
+      Ws2812Stream.dropped += diff -1;
+    }
+    Ws2812Stream.sequence[index] = sequence;
+  }
+  return true;
+}
+
+void Ws2812StreamUniverse(uint32_t source, uint32_t universe, uint32_t sequence, uint32_t length)
+{
+  uint32_t index = universe - Settings.ws2812_stream_universe;
+  if ((universe < Settings.ws2812_stream_universe) || (index >= Ws2812Stream.universes)) { return; }
+  if (!Ws2812StreamSequence(index, sequence)) { return; }
+
+  if (Ws2812Stream.received & (1 << index)) {
+    Ws2812StreamShow();                 // Sender skipped a universe, show what we have
+  }
+  if (!Light.stream) {
+    Light.stream = true;
+    Ws2812.frame_valid = false;
+  }
+  Ws2812Stream.timeout = millis() + WS2812_STREAM_TIMEOUT;
+  Ws2812Stream.packets++;
+
+  uint32_t first = index * WS2812_STREAM_UNIVERSE_PIXELS;
+  uint32_t pixels = tmin(length / selectedNeoFeatureType::PixelSize, WS2812_STREAM_UNIVERSE_PIXELS);
+  if (first + pixels > Settings.light_pixels) {
+    pixels = (first < Settings.light_pixels) ? Settings.light_pixels - first : 0;
+  }
+  while (pixels) {
+    uint32_t count;
+    uint8_t *buffer = Ws2812StreamPixels(first, &count);
+    if (!buffer || !count) { break; }
+    count = tmin(count, pixels);
+    int32_t read = Ws2812StreamUdp[source].read(buffer, count * selectedNeoFeatureType::PixelSize);
+    if (read <= 0) { break; }
+    count = read / selectedNeoFeatureType::PixelSize;
+    for (uint32_t i = 0; i < count; i++) {  // DMX RGB(W) to strip color order in place
+      uint8_t *p = &buffer[i * selectedNeoFeatureType::PixelSize];
+#if (USE_WS2812_CTYPE > NEO_3LED)
+      Ws2812Color color(p[0], p[1], p[2], p[3]);
+#else
+      Ws2812Color color(p[0], p[1], p[2]);
+#endif
+      selectedNeoFeatureType::applyPixelColor(buffer, i, color);
+    }
+    first += count;
+    pixels -= count;
+  }
+
+  Ws2812Stream.received |= 1 << index;
+  if (Ws2812Stream.received == (1UL << Ws2812Stream.universes) -1) {
+    Ws2812StreamShow();
+  }
+}
+
+void Ws2812StreamLoop(void)
+{
+  if (!Ws2812Stream.up) {
+    Ws2812StreamStart();
+    return;
+  }
+  if (global_state.wifi_down) {
+    Ws2812StreamStop();
+    return;
+  }
+
+  uint8_t header[WS2812_STREAM_E131_HEADER];
+  while (Ws2812StreamUdp[WS2812_STREAM_E131].parsePacket() >= WS2812_STREAM_E131_HEADER) {
+    if (Ws2812StreamUdp[WS2812_STREAM_E131].read(header, WS2812_STREAM_E131_HEADER) != WS2812_STREAM_E131_HEADER) { continue; }
+    if (memcmp_P(&header[4], kWs2812StreamE131Id, 12)) { continue; }
+    if ((header[21] != 0x04) || (header[43] != 0x02) || (header[117] != 0x02)) { continue; }  // Root, framing and DMP vectors
+    if (header[125]) { continue; }      // DMX start code
+    if (header[112] & 0x80) { continue; }  // Preview data
+    if (header[112] & 0x40) {           // Stream terminated
+      Ws2812Stream.timeout = millis();
+      continue;
+    }
+    uint32_t length = ((header[123] << 8) | header[124]) -1;
+    Ws2812StreamUniverse(WS2812_STREAM_E131, (header[113] << 8) | header[114], header[111], length);
+  }
+  while (Ws2812StreamUdp[WS2812_STREAM_ARTNET].parsePacket() >= WS2812_STREAM_ARTNET_HEADER) {
+    if (Ws2812StreamUdp[WS2812_STREAM_ARTNET].read(header, WS2812_STREAM_ARTNET_HEADER) != WS2812_STREAM_ARTNET_HEADER) { continue; }
+    if (memcmp_P(header, kWs2812StreamArtnetId, 8)) { continue; }
+    if ((header[8] != 0x00) || (header[9] != 0x50)) { continue; }  // OpDmx
+    uint32_t length = (header[16] << 8) | header[17];
+    Ws2812StreamUniverse(WS2812_STREAM_ARTNET, (header[15] << 8) | header[14], header[12], length);
+  }
+
+  if (Light.stream && TimeReached(Ws2812Stream.timeout)) {
+    Ws2812StreamEnd();
+    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("WS2: Stream timeout"));
+  }
+}
+
+void CmndStream(void)
+{
+  if ((XdrvMailbox.payload >= 0) && (XdrvMailbox.payload <= 63999)) {
+    Ws2812StreamStop();
+    Settings.ws2812_stream_universe = XdrvMailbox.payload;
+    Ws2812Stream.retry = 0;
+    Ws2812StreamStart();
+  }
+  Response_P(PSTR("{\"" D_CMND_STREAM "\":{\"Universe\":%d,\"Universes\":%d,\"Active\":%d,\"Packets\":%u,\"Dropped\":%u,\"Late\":%u,\"Frames\":%u}}"),
+    Settings.ws2812_stream_universe, (Ws2812Stream.up) ? Ws2812Stream.universes : 0, Light.stream,
+    Ws2812Stream.packets, Ws2812Stream.dropped, Ws2812Stream.late, Ws2812Stream.frames);
+}
+#endif  // USE_WS2812_STREAM
+
 /*********************************************************************************************\
  * Public - used by scripter only
 \*********************************************************************************************/
@@ -418,8 +885,11 @@ void Ws2812ForceUpdate (void)
 
 bool Ws2812SetChannels(void)
 {
+  if (Light.stream) { return true; }  // Strip is fed by the stream receiver
+
   uint8_t *cur_col = (uint8_t*)XdrvMailbox.data;
 
+  Ws2812FrameFree();                   // No scheme running
   Ws2812SetColor(0, cur_col[0], cur_col[1], cur_col[2], cur_col[3]);
 
   return true;
@@ -427,6 +897,8 @@ bool Ws2812SetChannels(void)
 
 void Ws2812ShowScheme(void)
 {
+  if (Light.stream) { return; }        // Strip is fed by the stream receiver
+
   uint32_t scheme = Settings.light_scheme - Ws2812.scheme_offset;
 
   switch (scheme) {
@@ -451,8 +923,22 @@ void Ws2812ModuleSelected(void)
 {
   if (PinUsed(GPIO_WS2812)) {  // RGB led
 
+#ifdef ESP32
+    strip = new Ws2812Strips();
+    for (uint32_t i = 0; i < MAX_WS2812_STRIPS; i++) {
+      if (PinUsed(GPIO_WS2812, i)) {
+        strip->Add(Pin(GPIO_WS2812, i));
+      }
+    }
+    if (Settings.light_pixels > Ws2812MaxPixels()) {
+      Settings.light_pixels = Ws2812MaxPixels();
+    }
+    strip->SetLength(Settings.light_pixels);
+    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("WS2: %d strips of %d pixels"), strip->Count(), (Settings.light_pixels + strip->Count() -1) / strip->Count());
+#else
     // For DMA, the Pin is ignored as it uses GPIO3 due to DMA hardware use.
     strip = new NeoPixelBus<selectedNeoFeatureType, selectedNeoSpeedType>(WS2812_MAX_LEDS, Pin(GPIO_WS2812));
+#endif  // ESP32
     strip->Begin();
 
     Ws2812Clear();
@@ -469,6 +955,15 @@ void Ws2812ModuleSelected(void)
   }
 }
 
+uint32_t Ws2812MaxPixels(void)
+{
+#ifdef ESP32
+  return WS2812_MAX_LEDS * strip->Count();
+#else
+  return WS2812_MAX_LEDS;
+#endif  // ESP32
+}
+
 /********************************************************************************************/
 
 void CmndLed(void)
@@ -496,9 +991,12 @@ void CmndLed(void)
 
 void CmndPixels(void)
 {
-  if ((XdrvMailbox.payload > 0) && (XdrvMailbox.payload <= WS2812_MAX_LEDS)) {
+  if ((XdrvMailbox.payload > 0) && (XdrvMailbox.payload <= Ws2812MaxPixels())) {
     Settings.light_pixels = XdrvMailbox.payload;
     Settings.light_rotation = 0;
+#ifdef ESP32
+    strip->SetLength(Settings.light_pixels);
+#endif  // ESP32
     Ws2812Clear();
     Light.update = true;
   }
@@ -545,6 +1043,11 @@ bool Xlgt01(uint8_t function)
     case FUNC_SET_SCHEME:
       Ws2812ShowScheme();
       break;
+#ifdef USE_WS2812_STREAM
+    case FUNC_LOOP:
+      Ws2812StreamLoop();
+      break;
+#endif  // USE_WS2812_STREAM
     case FUNC_COMMAND:
       result = DecodeCommand(kWs2812Commands, Ws2812Command);
       break;
@@ -29,38 +29,57 @@ struct MY92X1 {
   uint8_t pdi_pin = 0;
   uint8_t pdcki_pin = 0;
   uint8_t model = 0;
+  uint8_t duty[6];                      // Last sent duty per chip channel
+  bool duty_valid = false;
 } My92x1;
 
 extern "C" {
   void os_delay_us(unsigned int);
 }
 
+// Write the GPIO set/clear registers directly as digitalWrite() takes about a microsecond per call
+inline void LightMy92x1Pin(uint32_t pin, uint32_t state)
+{
+#ifdef ESP8266
+  if (pin < 16) {
+    if (state) { GPOS = 1 << pin; } else { GPOC = 1 << pin; }
+    return;
+  }
+#else   // ESP32
+  if (pin < 32) {
+    if (state) { GPIO.out_w1ts = 1 << pin; } else { GPIO.out_w1tc = 1 << pin; }
+    return;
+  }
+#endif  // ESP8266
+  digitalWrite(pin, (state) ? HIGH : LOW);
+}
+
 void LightDiPulse(uint8_t times)
 {
   for (uint32_t i = 0; i < times; i++) {
-    digitalWrite(My92x1.pdi_pin, HIGH);
-    digitalWrite(My92x1.pdi_pin, LOW);
+    LightMy92x1Pin(My92x1.pdi_pin, HIGH);
+    LightMy92x1Pin(My92x1.pdi_pin, LOW);
   }
 }
 
 void LightDckiPulse(uint8_t times)
 {
   for (uint32_t i = 0; i < times; i++) {
-    digitalWrite(My92x1.pdcki_pin, HIGH);
-    digitalWrite(My92x1.pdcki_pin, LOW);
+    LightMy92x1Pin(My92x1.pdcki_pin, HIGH);
+    LightMy92x1Pin(My92x1.pdcki_pin, LOW);
   }
 }
 
 void LightMy92x1Write(uint8_t data)
 {
   for (uint32_t i = 0; i < 4; i++) {     // Send 8bit Data
-    digitalWrite(My92x1.pdcki_pin, LOW);
-    digitalWrite(My92x1.pdi_pin, (data & 0x80));
-    digitalWrite(My92x1.pdcki_pin, HIGH);
+    LightMy92x1Pin(My92x1.pdcki_pin, LOW);
+    LightMy92x1Pin(My92x1.pdi_pin, (data & 0x80));
+    LightMy92x1Pin(My92x1.pdcki_pin, HIGH);
     data = data << 1;
-    digitalWrite(My92x1.pdi_pin, (data & 0x80));
-    digitalWrite(My92x1.pdcki_pin, LOW);
-    digitalWrite(My92x1.pdi_pin, LOW);
+    LightMy92x1Pin(My92x1.pdi_pin, (data & 0x80));
+    LightMy92x1Pin(My92x1.pdcki_pin, LOW);
+    LightMy92x1Pin(My92x1.pdi_pin, LOW);
     data = data << 1;
   }
 }
@@ -83,6 +102,7 @@ void LightMy92x1Init(void)
   // at 16 pulse's falling edge convert to duty mode.
   LightDiPulse(16);
   os_delay_us(12);                      // TStop > 12us.
+  My92x1.duty_valid = false;            // Duty registers have been cleared
 }
 
 void LightMy92x1Duty(uint8_t duty_r, uint8_t duty_g, uint8_t duty_b, uint8_t duty_w, uint8_t duty_c)
@@ -93,6 +113,12 @@ void LightMy92x1Duty(uint8_t duty_r, uint8_t duty_g, uint8_t duty_b, uint8_t dut
                         { duty_w, duty_c, 0, duty_g, duty_r, duty_b },        // Definition for RGBWC channels
                         { duty_r, duty_g, duty_b, duty_w, duty_w, duty_w }};  // Definition for RGBWWW channels as used in Lohas which uses up to 3 CW channels
 
+  if (My92x1.duty_valid && !memcmp(My92x1.duty, duty[My92x1.model], channels[My92x1.model])) {
+    return;                             // Chips already show these duties
+  }
+  memcpy(My92x1.duty, duty[My92x1.model], channels[My92x1.model]);
+  My92x1.duty_valid = true;
+
   os_delay_us(12);                      // TStop > 12us.
   for (uint32_t channel = 0; channel < channels[My92x1.model]; channel++) {
     LightMy92x1Write(duty[My92x1.model][channel]);  // Send 8bit Data
@@ -30,13 +30,65 @@
 
 #define D_LOG_SM16716       "SM16716: "
 
+#ifndef SM16716_SPI_FREQUENCY
+#define SM16716_SPI_FREQUENCY  4000000     // Hardware SPI clock, the chip supports up to 30MHz
+#endif
+
+#include <SPI.h>
+
 struct SM16716 {
   uint8_t pin_clk = 0;
   uint8_t pin_dat = 0;
   uint8_t pin_sel = 0;
   bool enabled = false;
+  bool spi = false;                        // Frames are clocked out by the SPI hardware
 } Sm16716;
 
+/********************************************************************************************* * Hardware SPI transfer
+ *
+ * A frame of start bit, 24 color bits and 25 bit 'do it' block is padded with trailing zero
+ * bits to 7 bytes and handed to the SPI hardware. On ESP8266 the HSPI data registers are
+ * loaded and the transfer is started without waiting for it to finish, the next frame waits
+ * for the previous one instead. Used when clk and dat are on HSPI pins (ESP8266) or any pins
+ * (ESP32) and the MISO pin claimed by SPI is not in use.
+\*********************************************************************************************/
+
+const uint8_t SM16716_SPI_FRAME = 7;
+
+bool SM16716_SpiBegin(void)
+{
+#ifdef ESP8266
+  if ((Sm16716.pin_clk != SCK) || (Sm16716.pin_dat != MOSI)) { return false; }
+#endif  // ESP8266
+  if (gpio_pin[MISO] != GPIO_NONE) { return false; }   // SPI.begin() would take over this pin
+
+#ifdef ESP8266
+  SPI.begin();
+#else   // ESP32
+  SPI.begin(Sm16716.pin_clk, MISO, Sm16716.pin_dat, -1);
+#endif  // ESP8266
+  SPI.beginTransaction(SPISettings(SM16716_SPI_FREQUENCY, MSBFIRST, SPI_MODE0));  // Kept open as the bus is not shared
+  return true;
+}
+
+void SM16716_SpiWrite(const uint8_t *frame)
+{
+#ifdef ESP8266
+  while (SPI1CMD & SPIBUSY) {}             // Previous frame still clocking out
+  const uint32_t bits = SM16716_SPI_FRAME * 8 -1;
+  SPI1U1 = (SPI1U1 & ~((SPIMMOSI << SPILMOSI) | (SPIMMISO << SPILMISO))) | (bits << SPILMOSI) | (bits << SPILMISO);
+  uint32_t data[2] = { 0, 0 };
+  memcpy(data, frame, SM16716_SPI_FRAME);
+  SPI1W0 = data[0];
+  SPI1W1 = data[1];
+  SPI1CMD |= SPIBUSY;                      // Start transfer
+#else   // ESP32
+  SPI.writeBytes(frame, SM16716_SPI_FRAME);  // 14 uSeconds at 4MHz
+#endif  // ESP8266
+}
+
+/********************************************************************************************/
+
 void SM16716_SendBit(uint8_t v)
 {
   /* NOTE:
@@ -81,6 +133,16 @@ void SM16716_Update(uint8_t duty_r, uint8_t duty_g, uint8_t duty_b)
   }
   DEBUG_DRIVER_LOG(PSTR(D_LOG_SM16716 "Update; rgb=%02x%02x%02x"), duty_r, duty_g, duty_b);
 
+  if (Sm16716.spi) {
+    uint8_t frame[SM16716_SPI_FRAME] = { 0 };
+    frame[0] = 0x80 | (duty_r >> 1);       // Start bit
+    frame[1] = (duty_r << 7) | (duty_g >> 1);
+    frame[2] = (duty_g << 7) | (duty_b >> 1);
+    frame[3] = duty_b << 7;                // Followed by the zero 'do it' block
+    SM16716_SpiWrite(frame);
+    return;
+  }
+
   // send start bit
   SM16716_SendBit(1);
   SM16716_SendByte(duty_r);
@@ -110,6 +172,11 @@ bool SM16716_ModuleSelected(void)
 
 void SM16716_Init(void)
 {
+  if (Sm16716.spi) {
+    uint8_t frame[SM16716_SPI_FRAME] = { 0 };  // 56 zero bits
+    SM16716_SpiWrite(frame);
+    return;
+  }
   for (uint32_t t_init = 0; t_init < 50; ++t_init) {
     SM16716_SendBit(0);
   }
@@ -160,6 +227,8 @@ void Sm16716ModuleSelected(void)
     pinMode(Sm16716.pin_dat, OUTPUT);
     digitalWrite(Sm16716.pin_dat, LOW);
 
+    Sm16716.spi = SM16716_SpiBegin();
+
     if (Sm16716.pin_sel < 99) {
       pinMode(Sm16716.pin_sel, OUTPUT);
       digitalWrite(Sm16716.pin_sel, LOW);
@@ -172,7 +241,7 @@ void Sm16716ModuleSelected(void)
     LightPwmOffset(LST_RGB);  // Handle any PWM pins, skipping the first 3 color values for sm16716
     light_type += LST_RGB;    // Add RGB to be controlled by sm16716
     light_flg = XLGT_03;
-    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("DBG: SM16716 Found"));
+    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("DBG: SM16716 Found%s"), (Sm16716.spi) ? " on SPI" : "");
   }
 }
 
@@ -39,6 +39,9 @@
 
 #define HLW_POWER_PROBE_TIME   10    // Number of seconds to probe for power before deciding none used (low power pulse can take up to 10 seconds)
 #define HLW_SAMPLE_COUNT       10    // Max number of samples per cycle
+#define HLW_PCNT_PULSES        16    // ESP32 power pulses counted before closing a window
+#define HLW_PCNT_WINDOW   2000000    // ESP32 max power window in microseconds
+#define HLW_PCNT_FILTER      1000    // ESP32 ignore pulses shorter than nanoseconds
 
 //#define HLW_DEBUG
 
@@ -49,6 +52,15 @@ struct HLW {
   unsigned long cf_pulse_length = 0;
   unsigned long cf_pulse_last_time = 0;
   unsigned long cf_power_pulse_length  = 0;
+  unsigned long cf_summed_pulse_length = 0;
+  unsigned long cf_pulse_counter = 0;
+#ifdef ESP32
+  unsigned long cf_window_start = 0;
+  unsigned long cf1_window_start = 0;
+  uint32_t cf_window_pulses = 0;
+  int8_t cf_unit = -1;                   // Pulse counter unit or -1 for interrupt
+  int8_t cf1_unit = -1;
+#endif  // ESP32
 
   unsigned long cf1_pulse_length = 0;
   unsigned long cf1_pulse_last_time = 0;
@@ -87,6 +99,8 @@ void HlwCfInterrupt(void)  // Service Power
   } else {
     Hlw.cf_pulse_length = us - Hlw.cf_pulse_last_time;
     Hlw.cf_pulse_last_time = us;
+    Hlw.cf_summed_pulse_length += Hlw.cf_pulse_length;
+    Hlw.cf_pulse_counter++;
     Hlw.energy_period_counter++;
   }
   Energy.data_valid[0] = 0;
@@ -113,6 +127,53 @@ void HlwCf1Interrupt(void)  // Service Voltage and Current
 
 /********************************************************************************************/
 
+#ifdef ESP32
+void HlwPcntEvery200ms(void)
+{
+  // Gate hardware counted pulses in windows of at least HLW_PCNT_PULSES or HLW_PCNT_WINDOW
+  unsigned long us = micros();
+
+  if (Hlw.cf_unit >= 0) {
+    uint32_t pulses = PcntDelta(Hlw.cf_unit);
+    if (pulses) {
+      Hlw.energy_period_counter += pulses;
+      Hlw.cf_pulse_last_time = us;
+      Energy.data_valid[0] = 0;
+      if (Hlw.load_off) {       // Restart window as pulse timing before is unknown
+        Hlw.load_off = false;
+        Hlw.cf_window_start = us;
+        Hlw.cf_window_pulses = 0;
+        pulses = 0;
+      }
+      Hlw.cf_window_pulses += pulses;
+    }
+    unsigned long window = us - Hlw.cf_window_start;
+    if ((Hlw.cf_window_pulses >= HLW_PCNT_PULSES) || (Hlw.cf_window_pulses && (window >= HLW_PCNT_WINDOW))) {
+      Hlw.cf_pulse_length = window / Hlw.cf_window_pulses;
+      Hlw.cf_summed_pulse_length = window;
+      Hlw.cf_pulse_counter = Hlw.cf_window_pulses;
+      Hlw.cf_window_start = us;
+      Hlw.cf_window_pulses = 0;
+    }
+  }
+
+  if (Hlw.cf1_unit >= 0) {
+    if (3 == Hlw.cf1_timer) {   // Allow for 300 mSec set-up time after select
+      PcntDelta(Hlw.cf1_unit);
+      Hlw.cf1_window_start = us;
+    }
+    else if (7 == Hlw.cf1_timer) {
+      uint32_t pulses = PcntDelta(Hlw.cf1_unit);
+      if (pulses) {
+        Hlw.cf1_summed_pulse_length = us - Hlw.cf1_window_start;
+        Hlw.cf1_pulse_counter = pulses;
+        Energy.data_valid[0] = 0;
+      }
+    }
+  }
+}
+#endif  // ESP32
+
 void HlwEvery200ms(void)
 {
   unsigned long cf1_pulse_length = 0;
@@ -120,11 +181,33 @@ void HlwEvery200ms(void)
   unsigned long hlw_u = 0;
   unsigned long hlw_i = 0;
 
+#ifdef ESP32
+  HlwPcntEvery200ms();
+#endif  // ESP32
+
   if (micros() - Hlw.cf_pulse_last_time > (HLW_POWER_PROBE_TIME * 1000000)) {
     Hlw.cf_pulse_length = 0;    // No load for some time
+    Hlw.cf_power_pulse_length = 0;
+    Hlw.cf_pulse_counter = 0;
     Hlw.load_off = true;
   }
-  Hlw.cf_power_pulse_length  = Hlw.cf_pulse_length;
+  // Integrate all pulses since last run instead of the last pulse only to filter pulse jitter
+  noInterrupts();
+  unsigned long summed_pulse_length = Hlw.cf_summed_pulse_length;
+  unsigned long pulse_counter = Hlw.cf_pulse_counter;
+  unsigned long pulse_last_time = Hlw.cf_pulse_last_time;
+  Hlw.cf_summed_pulse_length = 0;
+  Hlw.cf_pulse_counter = 0;
+  interrupts();
+  if (pulse_counter) {
+    Hlw.cf_power_pulse_length = summed_pulse_length / pulse_counter;
+  }
+  else if (Hlw.cf_power_pulse_length && !Hlw.load_off) {
+    unsigned long pending = micros() - pulse_last_time;
+    if (pending > Hlw.cf_power_pulse_length) {
+      Hlw.cf_power_pulse_length = pending;  // Load is dropping as the next pulse is late
+    }
+  }
 
   if (Hlw.cf_power_pulse_length  && Energy.power_on && !Hlw.load_off) {
     hlw_w = (Hlw.power_ratio * Settings.energy_power_calibration) / Hlw.cf_power_pulse_length ;  // W *10
@@ -153,17 +236,18 @@ void HlwEvery200ms(void)
       // Debugging for calculating mean and median
       char stemp[100];
       stemp[0] = '\0';
-      for (uint32_t i = 0; i < Hlw.cf1_pulse_counter; i++) {
+      uint32_t samples = tmin(Hlw.cf1_pulse_counter, HLW_SAMPLE_COUNT);  // Hardware counted pulses have no samples
+      for (uint32_t i = 0; i < samples; i++) {
         snprintf_P(stemp, sizeof(stemp), PSTR("%s %d"), stemp, Hlw.debug[i]);
       }
-      for (uint32_t i = 0; i < Hlw.cf1_pulse_counter; i++) {
-        for (uint32_t j = i + 1; j < Hlw.cf1_pulse_counter; j++) {
+      for (uint32_t i = 0; i < samples; i++) {
+        for (uint32_t j = i + 1; j < samples; j++) {
           if (Hlw.debug[i] > Hlw.debug[j]) {  // Sort ascending
             std::swap(Hlw.debug[i], Hlw.debug[j]);
           }
         }
       }
-      unsigned long median = Hlw.debug[(Hlw.cf1_pulse_counter +1) / 2];
+      unsigned long median = Hlw.debug[(samples +1) / 2];
       AddLog_P2(LOG_LEVEL_DEBUG, PSTR("NRG: power %d, ui %d, cnt %d, smpl%s, sum %d, mean %d, median %d"),
         Hlw.cf_power_pulse_length , Hlw.select_ui_flag, Hlw.cf1_pulse_counter, stemp, Hlw.cf1_summed_pulse_length, cf1_pulse_length, median);
 #endif
@@ -237,12 +321,30 @@ void HlwSnsInit(void)
     pinMode(Pin(GPIO_NRG_SEL), OUTPUT);
     digitalWrite(Pin(GPIO_NRG_SEL), Hlw.select_ui_flag);
   }
+#ifdef ESP32
+  if (PinUsed(GPIO_NRG_CF1)) {
+    Hlw.cf1_unit = PcntAttach(Pin(GPIO_NRG_CF1), HLW_PCNT_FILTER);
+  }
+  Hlw.cf_unit = PcntAttach(Pin(GPIO_HLW_CF), HLW_PCNT_FILTER);
+  Hlw.cf_window_start = micros();
+  if ((Hlw.cf_unit >= 0) && (Hlw.cf1_unit >= 0 || !PinUsed(GPIO_NRG_CF1))) { return; }
+  // Fall back to interrupts for channels without free pulse counter unit
+  if (Hlw.cf_unit < 0) {
+    pinMode(Pin(GPIO_HLW_CF), INPUT_PULLUP);
+    attachInterrupt(Pin(GPIO_HLW_CF), HlwCfInterrupt, FALLING);
+  }
+  if (PinUsed(GPIO_NRG_CF1) && (Hlw.cf1_unit < 0)) {
+    pinMode(Pin(GPIO_NRG_CF1), INPUT_PULLUP);
+    attachInterrupt(Pin(GPIO_NRG_CF1), HlwCf1Interrupt, FALLING);
+  }
+#else
   if (PinUsed(GPIO_NRG_CF1)) {
     pinMode(Pin(GPIO_NRG_CF1), INPUT_PULLUP);
     attachInterrupt(Pin(GPIO_NRG_CF1), HlwCf1Interrupt, FALLING);
   }
   pinMode(Pin(GPIO_HLW_CF), INPUT_PULLUP);
   attachInterrupt(Pin(GPIO_HLW_CF), HlwCfInterrupt, FALLING);
+#endif  // ESP32
 }
 
 void HlwDrvInit(void)
@@ -39,7 +39,8 @@
 #define CSE_PREF                    1000
 #define CSE_UREF                    100
 
-#define CSE_BUFFER_SIZE             25
+#define CSE_FRAME_SIZE              24
+#define CSE_BUFFER_SIZE             (CSE_FRAME_SIZE * 3)  // Frames are sent every 50 mSec
 
 #include <TasmotaSerial.h>
 
@@ -53,13 +54,11 @@ struct CSE {
   long cf_pulses = 0;
   long cf_pulses_last_time = CSE_PULSES_NOT_INITIALIZED;
 
-  int byte_counter = 0;
-  uint8_t *rx_buffer = nullptr;
+  ENERGY_FRAME frame = { nullptr, CSE_BUFFER_SIZE, 0, CSE_FRAME_SIZE, 0x5A, 1, 2 };  // 0x5A - Packet header 2
   uint8_t power_invalid = 0;
-  bool received = false;
 } Cse;
 
-void CseReceived(void)
+void CseReceived(uint8_t *rx_buffer)
 {
   //  0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15 16 17 18 19 20 21 22 23
   // F2 5A 02 F7 60 00 03 61 00 40 10 05 72 40 51 A6 58 63 10 1B E1 7F 4D 4E - F2 = Power cycle exceeds range - takes too long - No load
@@ -67,7 +66,8 @@ void CseReceived(void)
   // 55 5A 02 F7 60 00 03 AB 00 40 10 02 60 5D 51 A6 58 03 E9 EF 71 0B 7A 36 - 55 = Ok, 71 = Ok
   // Hd Id VCal---- Voltage- ICal---- Current- PCal---- Power--- Ad CF--- Ck
 
-  uint8_t header = Cse.rx_buffer[0];
+  Energy.data_valid[0] = 0;
+  uint8_t header = rx_buffer[0];
   if ((header & 0xFC) == 0xFC) {
     AddLog_P(LOG_LEVEL_DEBUG, PSTR("CSE: Abnormal hardware"));
     return;
@@ -77,30 +77,30 @@ void CseReceived(void)
   if (HLW_UREF_PULSE == Settings.energy_voltage_calibration) {
     long voltage_coefficient = 191200;  // uSec
     if (CSE_NOT_CALIBRATED != header) {
-      voltage_coefficient = Cse.rx_buffer[2] << 16 | Cse.rx_buffer[3] << 8 | Cse.rx_buffer[4];
+      voltage_coefficient = rx_buffer[2] << 16 | rx_buffer[3] << 8 | rx_buffer[4];
     }
     Settings.energy_voltage_calibration = voltage_coefficient / CSE_UREF;
   }
   if (HLW_IREF_PULSE == Settings.energy_current_calibration) {
     long current_coefficient = 16140;  // uSec
     if (CSE_NOT_CALIBRATED != header) {
-      current_coefficient = Cse.rx_buffer[8] << 16 | Cse.rx_buffer[9] << 8 | Cse.rx_buffer[10];
+      current_coefficient = rx_buffer[8] << 16 | rx_buffer[9] << 8 | rx_buffer[10];
     }
     Settings.energy_current_calibration = current_coefficient;
   }
   if (HLW_PREF_PULSE == Settings.energy_power_calibration) {
     long power_coefficient = 5364000;  // uSec
     if (CSE_NOT_CALIBRATED != header) {
-      power_coefficient = Cse.rx_buffer[14] << 16 | Cse.rx_buffer[15] << 8 | Cse.rx_buffer[16];
+      power_coefficient = rx_buffer[14] << 16 | rx_buffer[15] << 8 | rx_buffer[16];
     }
     Settings.energy_power_calibration = power_coefficient / CSE_PREF;
   }
 
-  uint8_t adjustement = Cse.rx_buffer[20];
-  Cse.voltage_cycle = Cse.rx_buffer[5] << 16 | Cse.rx_buffer[6] << 8 | Cse.rx_buffer[7];
-  Cse.current_cycle = Cse.rx_buffer[11] << 16 | Cse.rx_buffer[12] << 8 | Cse.rx_buffer[13];
-  Cse.power_cycle = Cse.rx_buffer[17] << 16 | Cse.rx_buffer[18] << 8 | Cse.rx_buffer[19];
-  Cse.cf_pulses = Cse.rx_buffer[21] << 8 | Cse.rx_buffer[22];
+  uint8_t adjustement = rx_buffer[20];
+  Cse.voltage_cycle = rx_buffer[5] << 16 | rx_buffer[6] << 8 | rx_buffer[7];
+  Cse.current_cycle = rx_buffer[11] << 16 | rx_buffer[12] << 8 | rx_buffer[13];
+  Cse.power_cycle = rx_buffer[17] << 16 | rx_buffer[18] << 8 | rx_buffer[19];
+  Cse.cf_pulses = rx_buffer[21] << 8 | rx_buffer[22];
 
   if (Energy.power_on) {  // Powered on
     if (adjustement & 0x40) {  // Voltage valid
@@ -142,46 +142,9 @@ void CseReceived(void)
   }
 }
 
-bool CseSerialInput(void)
+void CseSerialInput(void)
 {
-  while (CseSerial->available()) {
-    yield();
-    uint8_t serial_in_byte = CseSerial->read();
-
-    if (Cse.received) {
-      Cse.rx_buffer[Cse.byte_counter++] = serial_in_byte;
-      if (24 == Cse.byte_counter) {
-
-        AddLogBuffer(LOG_LEVEL_DEBUG_MORE, Cse.rx_buffer, 24);
-
-        uint8_t checksum = 0;
-        for (uint32_t i = 2; i < 23; i++) { checksum += Cse.rx_buffer[i]; }
-        if (checksum == Cse.rx_buffer[23]) {
-          Energy.data_valid[0] = 0;
-          CseReceived();
-          Cse.received = false;
-          return true;
-        } else {
-          AddLog_P(LOG_LEVEL_DEBUG, PSTR("CSE: " D_CHECKSUM_FAILURE));
-          do {  // Sync buffer with data (issue #1907 and #3425)
-            memmove(Cse.rx_buffer, Cse.rx_buffer +1, 24);
-            Cse.byte_counter--;
-          } while ((Cse.byte_counter > 2) && (0x5A != Cse.rx_buffer[1]));
-          if (0x5A != Cse.rx_buffer[1]) {
-            Cse.received = false;
-            Cse.byte_counter = 0;
-          }
-        }
-      }
-    } else {
-      if ((0x5A == serial_in_byte) && (1 == Cse.byte_counter)) {  // 0x5A - Packet header 2
-        Cse.received = true;
-      } else {
-        Cse.byte_counter = 0;
-      }
-      Cse.rx_buffer[Cse.byte_counter++] = serial_in_byte;
-    }
-  }
+  EnergyFrameInput(CseSerial, &Cse.frame, CseReceived);
 }
 
 /********************************************************************************************/
@@ -245,8 +208,8 @@ void CseDrvInit(void)
 {
 //  if (PinUsed(GPIO_CSE7766_RX) && PinUsed(GPIO_CSE7766_TX)) {
   if (PinUsed(GPIO_CSE7766_RX)) {
-    Cse.rx_buffer = (uint8_t*)(malloc(CSE_BUFFER_SIZE));
-    if (Cse.rx_buffer != nullptr) {
+    Cse.frame.buffer = (uint8_t*)(malloc(CSE_BUFFER_SIZE));
+    if (Cse.frame.buffer != nullptr) {
       energy_flg = XNRG_02;
     }
   }
@@ -54,13 +54,18 @@ TasmotaSerial *PzemSerial = nullptr;
 #define PZEM_POWER_ALARM (uint8_t)0xB5
 #define RESP_POWER_ALARM (uint8_t)0xA5
 
-#define PZEM_DEFAULT_READ_TIMEOUT 500
+#define PZEM_FRAME_SIZE  7
 
 /*********************************************************************************************/
 
+uint8_t pzem_buffer[PZEM_FRAME_SIZE * 2];
+
 struct PZEM {
+  ENERGY_FRAME frame = { pzem_buffer, sizeof(pzem_buffer), 0, PZEM_FRAME_SIZE, 0, 0, 0 };
   float energy = 0;
   float last_energy = 0;
+  float value = 0;
+  bool received = false;
   uint8_t send_retry = 0;
   uint8_t read_state = 0;  // Set address
   uint8_t phase = 0;
@@ -98,6 +103,7 @@ void PzemSend(uint8_t cmd)
   pzem.crc = PzemCrc(bytes);
 
   PzemSerial->flush();
+  Pzem.frame.length = 0;
   PzemSerial->write(bytes, sizeof(pzem));
 
   Pzem.address = 0;
@@ -105,10 +111,10 @@ void PzemSend(uint8_t cmd)
 
 bool PzemReceiveReady(void)
 {
-  return PzemSerial->available() >= (int)sizeof(PZEMCommand);
+  return (PzemSerial->available() + Pzem.frame.length) >= (int)sizeof(PZEMCommand);
 }
 
-bool PzemRecieve(uint8_t resp, float *data)
+void PzemReceived(uint8_t *buffer)
 {
   //  0  1  2  3  4  5  6
   // A4 00 00 00 00 00 A4 - Set address
@@ -121,50 +127,32 @@ bool PzemRecieve(uint8_t resp, float *data)
   // A3 00 08 A4 00 00 4F - Energy (2.212kWh)
   // A3 01 86 9F 00 00 C9 - Energy (99.999kWh)
 
-  uint8_t buffer[sizeof(PZEMCommand)] = { 0 };
-
-  unsigned long start = millis();
-  uint8_t len = 0;
-  while ((len < sizeof(PZEMCommand)) && (millis() - start < PZEM_DEFAULT_READ_TIMEOUT)) {
-    if (PzemSerial->available() > 0) {
-      uint8_t c = (uint8_t)PzemSerial->read();
-      if (!len && ((c & 0xF8) != 0xA0)) {  // 10100xxx
-        continue;  // fix skewed data
-      }
-      buffer[len++] = c;
-    }
-  }
-
-  AddLogBuffer(LOG_LEVEL_DEBUG_MORE, buffer, len);
-
-  if (len != sizeof(PZEMCommand)) {
-//    AddLog_P(LOG_LEVEL_DEBUG, PSTR(D_LOG_DEBUG "Pzem comms timeout"));
-    return false;
-  }
-  if (buffer[6] != PzemCrc(buffer)) {
-//    AddLog_P(LOG_LEVEL_DEBUG, PSTR(D_LOG_DEBUG "Pzem crc error"));
-    return false;
-  }
-  if (buffer[0] != resp) {
-//    AddLog_P(LOG_LEVEL_DEBUG, PSTR(D_LOG_DEBUG "Pzem bad response"));
-    return false;
-  }
-
-  switch (resp) {
+  switch (buffer[0]) {
     case RESP_VOLTAGE:
-      *data = (float)(buffer[1] << 8) + buffer[2] + (buffer[3] / 10.0);    // 65535.x V
+      Pzem.value = (float)(buffer[1] << 8) + buffer[2] + (buffer[3] / 10.0);    // 65535.x V
       break;
     case RESP_CURRENT:
-      *data = (float)(buffer[1] << 8) + buffer[2] + (buffer[3] / 100.0);   // 65535.xx A
+      Pzem.value = (float)(buffer[1] << 8) + buffer[2] + (buffer[3] / 100.0);   // 65535.xx A
       break;
     case RESP_POWER:
-      *data = (float)(buffer[1] << 8) + buffer[2];                         // 65535 W
+      Pzem.value = (float)(buffer[1] << 8) + buffer[2];                         // 65535 W
       break;
     case RESP_ENERGY:
-      *data = (float)((uint32_t)buffer[1] << 16) + ((uint16_t)buffer[2] << 8) + buffer[3];  // 16777215 Wh
+      Pzem.value = (float)((uint32_t)buffer[1] << 16) + ((uint16_t)buffer[2] << 8) + buffer[3];  // 16777215 Wh
       break;
   }
-  return true;
+  Pzem.received = true;
+}
+
+bool PzemRecieve(uint8_t resp, float *data)
+{
+  Pzem.frame.header = resp;  // Skips skewed data and other responses
+  Pzem.received = false;
+  EnergyFrameInput(PzemSerial, &Pzem.frame, PzemReceived);
+  if (Pzem.received) {
+    *data = Pzem.value;
+  }
+  return Pzem.received;
 }
 
 /*********************************************************************************************/
@@ -39,9 +39,7 @@
 #include <TasmotaModbus.h>
 TasmotaModbus *Sdm120Modbus;
 
-const uint8_t sdm120_table = 8;
-const uint8_t sdm220_table = 13;
-
+// Sorted for coalescing, the SDM220 registers are read in their own blocks
 const uint16_t sdm120_start_addresses[] {
   0x0000,   // SDM120C_VOLTAGE             [V]
   0x0006,   // SDM120C_CURRENT             [A]
@@ -50,13 +48,15 @@ const uint16_t sdm120_start_addresses[] {
   0x0018,   // SDM120C_REACTIVE_POWER      [VAR]
   0x001E,   // SDM120C_POWER_FACTOR
   0x0046,   // SDM120C_FREQUENCY           [Hz]
-  0x0156,   // SDM120C_TOTAL_ACTIVE_ENERGY [kWh]
+  0x0156    // SDM120C_TOTAL_ACTIVE_ENERGY [kWh]
+};
 
+const uint16_t sdm220_start_addresses[] {
+  0X0024,   // SDM220_PHASE_ANGLE          [Degree]
   0X0048,   // SDM220_IMPORT_ACTIVE        [kWh]
   0X004A,   // SDM220_EXPORT_ACTIVE        [kWh]
   0X004C,   // SDM220_IMPORT_REACTIVE      [kVArh]
-  0X004E,   // SDM220_EXPORT_REACTIVE      [kVArh]
-  0X0024    // SDM220_PHASE_ANGLE          [Degree]
+  0X004E    // SDM220_EXPORT_REACTIVE      [kVArh]
 };
 
 struct SDM120 {
@@ -65,112 +65,102 @@ struct SDM120 {
   float import_reactive = 0;
   float export_reactive = 0;
   float phase_angle = 0;
-  uint8_t read_state = 0;
-  uint8_t send_retry = 0;
-  uint8_t start_address_count = sdm220_table;
+  int8_t sdm220_block = -1;       // First scheduled block of SDM220 registers or -1 for SDM120
 } Sdm120;
 
 /*********************************************************************************************/
 
-void SDM120Every250ms(void)
+void SDM120Loop(void)
 {
-  bool data_ready = Sdm120Modbus->ReceiveReady();
-
-  if (data_ready) {
-    uint8_t buffer[14];  // At least 5 + (2 * 2) = 9
-
-    uint32_t error = Sdm120Modbus->ReceiveBuffer(buffer, 2);
-    AddLogBuffer(LOG_LEVEL_DEBUG_MORE, buffer, Sdm120Modbus->ReceiveCount());
-
-    if (error) {
-      AddLog_P2(LOG_LEVEL_DEBUG, PSTR("SDM: SDM120 error %d"), error);
-    } else {
-      Energy.data_valid[0] = 0;
-
-      //  0  1  2  3  4  5  6  7  8
-      // SA FC BC Fh Fl Sh Sl Cl Ch
-      // 01 04 04 43 66 33 34 1B 38 = 230.2 Volt
-      float value;
-      ((uint8_t*)&value)[3] = buffer[3];   // Get float values
-      ((uint8_t*)&value)[2] = buffer[4];
-      ((uint8_t*)&value)[1] = buffer[5];
-      ((uint8_t*)&value)[0] = buffer[6];
-
-      switch(Sdm120.read_state) {
-        case 0:
-          Energy.voltage[0] = value;          // 230.2 V
-          break;
-
-        case 1:
-          Energy.current[0]  = value;         // 1.260 A
-          break;
-
-        case 2:
-          Energy.active_power[0] = value;     // -196.3 W
-          break;
-
-        case 3:
-          Energy.apparent_power[0] = value;   // 223.4 VA
-          break;
-
-        case 4:
-          Energy.reactive_power[0] = value;   // 92.2
-          break;
-
-        case 5:
-          Energy.power_factor[0] = value;     // -0.91
-          break;
-
-        case 6:
-          Energy.frequency[0] = value;        // 50.0 Hz
-          break;
-
-        case 7:
-          Sdm120.total_active = value;     // 484.708 kWh = import_active + export_active
-          break;
-
-        case 8:
-          Sdm120.import_active = value;    // 478.492 kWh
-          break;
-
-        case 9:
-          Energy.export_active[0] = value;    // 6.216 kWh
-          break;
-
-        case 10:
-          Sdm120.import_reactive = value;  // 172.750 kVArh
-          break;
-
-        case 11:
-          Sdm120.export_reactive = value;  // 2.844 kVArh
-          break;
-
-        case 12:
-          Sdm120.phase_angle = value;      // 0.00 Deg
-          break;
+  int block = Sdm120Modbus->Poll();
+  if (block < 0) { return; }
+
+  AddLogBuffer(LOG_LEVEL_DEBUG_MORE, Sdm120Modbus->PollBuffer(), Sdm120Modbus->ReceiveCount());
+
+  uint32_t error = Sdm120Modbus->PollError();
+  if (error) {
+    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("SDM: SDM120 error %d"), error);
+    if ((Sdm120.sdm220_block >= 0) && (block >= Sdm120.sdm220_block) && (error <= 4)) {
+      // No extended registers available
+      for (uint32_t i = Sdm120.sdm220_block; Sdm120Modbus->Block(i); i++) {
+        Sdm120Modbus->DisableBlock(i);
       }
+      Sdm120.sdm220_block = -1;
+    }
+    return;
+  }
 
-      Sdm120.read_state++;
-      if (Sdm120.read_state == Sdm120.start_address_count) {
-        Sdm120.read_state = 0;
-
-        if (Sdm120.start_address_count > sdm120_table) {
-          if (!isnan(Sdm120.import_active)) {
-            Sdm120.total_active = Sdm120.import_active;
-          } else {
-            Sdm120.start_address_count = sdm120_table;  // No extended registers available
-          }
-        }
-        EnergyUpdateTotal(Sdm120.total_active, true);  // 484.708 kWh
-      }
+  Energy.data_valid[0] = 0;
+
+  float value;
+  bool total = false;
+  for (uint32_t i = 0; i < ARRAY_SIZE(sdm120_start_addresses); i++) {
+    if (!Sdm120Modbus->Get32BitRegister(sdm120_start_addresses[i], &value)) { continue; }
+
+    switch(i) {
+      case 0:
+        Energy.voltage[0] = value;          // 230.2 V
+        break;
+
+      case 1:
+        Energy.current[0]  = value;         // 1.260 A
+        break;
+
+      case 2:
+        Energy.active_power[0] = value;     // -196.3 W
+        break;
+
+      case 3:
+        Energy.apparent_power[0] = value;   // 223.4 VA
+        break;
+
+      case 4:
+        Energy.reactive_power[0] = value;   // 92.2
+        break;
+
+      case 5:
+        Energy.power_factor[0] = value;     // -0.91
+        break;
+
+      case 6:
+        Energy.frequency[0] = value;        // 50.0 Hz
+        break;
+
+      case 7:
+        Sdm120.total_active = value;     // 484.708 kWh = import_active + export_active
+        total = (Sdm120.sdm220_block < 0);
+        break;
     }
-  } // end data ready
+  }
+  for (uint32_t i = 0; i < ARRAY_SIZE(sdm220_start_addresses); i++) {
+    if (!Sdm120Modbus->Get32BitRegister(sdm220_start_addresses[i], &value)) { continue; }
+
+    switch(i) {
+      case 0:
+        Sdm120.phase_angle = value;      // 0.00 Deg
+        break;
+
+      case 1:
+        Sdm120.import_active = value;    // 478.492 kWh
+        total = true;
+        break;
+
+      case 2:
+        Energy.export_active[0] = value;    // 6.216 kWh
+        break;
+
+      case 3:
+        Sdm120.import_reactive = value;  // 172.750 kVArh
+        break;
+
+      case 4:
+        Sdm120.export_reactive = value;  // 2.844 kVArh
+        break;
+    }
+  }
 
-  if (0 == Sdm120.send_retry || data_ready) {
-    Sdm120.send_retry = 5;
-    Sdm120Modbus->Send(SDM120_ADDR, 0x04, sdm120_start_addresses[Sdm120.read_state], 2);
-  } else {
-    Sdm120.send_retry--;
+  if (total) {
+    EnergyUpdateTotal((isnan(Sdm120.import_active)) ? Sdm120.total_active : Sdm120.import_active, true);  // 484.708 kWh
   }
 }
 
@@ -180,6 +170,8 @@ void Sdm120SnsInit(void)
   uint8_t result = Sdm120Modbus->Begin(SDM120_SPEED);
   if (result) {
     if (2 == result) { ClaimSerial(); }
+    Sdm120Modbus->AddRegisters(SDM120_ADDR, 0x04, sdm120_start_addresses, ARRAY_SIZE(sdm120_start_addresses), 2);
+    Sdm120.sdm220_block = Sdm120Modbus->AddRegisters(SDM120_ADDR, 0x04, sdm220_start_addresses, ARRAY_SIZE(sdm220_start_addresses), 2);
   } else {
     energy_flg = ENERGY_NONE;
   }
@@ -241,8 +233,8 @@ bool Xnrg08(uint8_t function)
   bool result = false;
 
   switch (function) {
-    case FUNC_EVERY_250_MSECOND:
-      if (uptime > 4) { SDM120Every250ms(); }
+    case FUNC_LOOP:
+      if (uptime > 4) { SDM120Loop(); }
       break;
     case FUNC_JSON_APPEND:
       Sdm220Show(1);
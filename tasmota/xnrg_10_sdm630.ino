@@ -57,142 +57,119 @@ const uint16_t sdm630_start_addresses[] {
   0x0020,  //  +   -   -        Phase 2 power factor
   0x0022,  //  +   -   -        Phase 3 power factor
   0x0046,  //  +   +   +   Hz   Frequency of supply voltages
-  0x0160,  //  +   +   +   kWh  Phase 1 export active energy
-  0x0162,  //  +   +   +   kWh  Phase 2 export active energy
-  0x0164,  //  +   +   +   kWh  Phase 3 export active energy
+  0x0156,  //  +   +   +   kWh  Total active energy
 //  0x015A,  //  +   +   +   kWh  Phase 1 import active energy
 //  0x015C,  //  +   +   +   kWh  Phase 2 import active energy
 //  0x015E,  //  +   +   +   kWh  Phase 3 import active energy
-  0x0156   //  +   +   +   kWh  Total active energy
+  0x0160,  //  +   +   +   kWh  Phase 1 export active energy
+  0x0162,  //  +   +   +   kWh  Phase 2 export active energy
+  0x0164   //  +   +   +   kWh  Phase 3 export active energy
 };
 
-struct SDM630 {
-  uint8_t read_state = 0;
-  uint8_t send_retry = 0;
-} Sdm630;
-
 /*********************************************************************************************/
 
-void SDM630Every250ms(void)
+void SDM630Loop(void)
 {
-  bool data_ready = Sdm630Modbus->ReceiveReady();
-
-  if (data_ready) {
-    uint8_t buffer[14];  // At least 5 + (2 * 2) = 9
-
-    uint32_t error = Sdm630Modbus->ReceiveBuffer(buffer, 2);
-    AddLogBuffer(LOG_LEVEL_DEBUG_MORE, buffer, Sdm630Modbus->ReceiveCount());
-
-    if (error) {
-      AddLog_P2(LOG_LEVEL_DEBUG, PSTR("SDM: SDM630 error %d"), error);
-    } else {
-      Energy.data_valid[0] = 0;
-      Energy.data_valid[1] = 0;
-      Energy.data_valid[2] = 0;
-
-      //  0  1  2  3  4  5  6  7  8
-      // SA FC BC Fh Fl Sh Sl Cl Ch
-      // 01 04 04 43 66 33 34 1B 38 = 230.2 Volt
-      float value;
-      ((uint8_t*)&value)[3] = buffer[3];   // Get float values
-      ((uint8_t*)&value)[2] = buffer[4];
-      ((uint8_t*)&value)[1] = buffer[5];
-      ((uint8_t*)&value)[0] = buffer[6];
-
-      switch(Sdm630.read_state) {
-        case 0:
-          Energy.voltage[0] = value;
-          break;
-
-        case 1:
-          Energy.voltage[1] = value;
-          break;
-
-        case 2:
-          Energy.voltage[2] = value;
-          break;
-
-        case 3:
-          Energy.current[0] = value;
-          break;
-
-        case 4:
-          Energy.current[1] = value;
-          break;
-
-        case 5:
-          Energy.current[2] = value;
-          break;
-
-        case 6:
-          Energy.active_power[0] = value;
-          break;
-
-        case 7:
-          Energy.active_power[1] = value;
-          break;
-
-        case 8:
-          Energy.active_power[2] = value;
-          break;
-
-        case 9:
-          Energy.reactive_power[0] = value;
-          break;
-
-        case 10:
-          Energy.reactive_power[1] = value;
-          break;
-
-        case 11:
-          Energy.reactive_power[2] = value;
-          break;
-
-        case 12:
-          Energy.power_factor[0] = value;
-          break;
-
-        case 13:
-          Energy.power_factor[1] = value;
-          break;
-
-        case 14:
-          Energy.power_factor[2] = value;
-          break;
-
-        case 15:
-          Energy.frequency[0] = value;
-          break;
-
-        case 16:
-          Energy.export_active[0] = value;
-          break;
-
-        case 17:
-          Energy.export_active[1] = value;
-          break;
-
-        case 18:
-          Energy.export_active[2] = value;
-          break;
-
-        case 19:
-          EnergyUpdateTotal(value, true);
-          break;
-      }
-
-      Sdm630.read_state++;
-      if (sizeof(sdm630_start_addresses)/2 == Sdm630.read_state) {
-        Sdm630.read_state = 0;
-      }
-    }
-  } // end data ready
+  // Addresses are sorted so contiguous values are read in a few coalesced blocks
+  if (Sdm630Modbus->Poll() < 0) { return; }
 
-  if (0 == Sdm630.send_retry || data_ready) {
-    Sdm630.send_retry = 5;
-    Sdm630Modbus->Send(SDM630_ADDR, 0x04, sdm630_start_addresses[Sdm630.read_state], 2);
-  } else {
-    Sdm630.send_retry--;
+  AddLogBuffer(LOG_LEVEL_DEBUG_MORE, Sdm630Modbus->PollBuffer(), Sdm630Modbus->ReceiveCount());
+
+  uint32_t error = Sdm630Modbus->PollError();
+  if (error) {
+    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("SDM: SDM630 error %d"), error);
+    return;
+  }
+
+  Energy.data_valid[0] = 0;
+  Energy.data_valid[1] = 0;
+  Energy.data_valid[2] = 0;
+
+  float value;
+  for (uint32_t i = 0; i < ARRAY_SIZE(sdm630_start_addresses); i++) {
+    if (!Sdm630Modbus->Get32BitRegister(sdm630_start_addresses[i], &value)) { continue; }
+
+    switch(i) {
+      case 0:
+        Energy.voltage[0] = value;
+        break;
+
+      case 1:
+        Energy.voltage[1] = value;
+        break;
+
+      case 2:
+        Energy.voltage[2] = value;
+        break;
+
+      case 3:
+        Energy.current[0] = value;
+        break;
+
+      case 4:
+        Energy.current[1] = value;
+        break;
+
+      case 5:
+        Energy.current[2] = value;
+        break;
+
+      case 6:
+        Energy.active_power[0] = value;
+        break;
+
+      case 7:
+        Energy.active_power[1] = value;
+        break;
+
+      case 8:
+        Energy.active_power[2] = value;
+        break;
+
+      case 9:
+        Energy.reactive_power[0] = value;
+        break;
+
+      case 10:
+        Energy.reactive_power[1] = value;
+        break;
+
+      case 11:
+        Energy.reactive_power[2] = value;
+        break;
+
+      case 12:
+        Energy.power_factor[0] = value;
+        break;
+
+      case 13:
+        Energy.power_factor[1] = value;
+        break;
+
+      case 14:
+        Energy.power_factor[2] = value;
+        break;
+
+      case 15:
+        Energy.frequency[0] = value;
+        break;
+
+      case 16:
+        EnergyUpdateTotal(value, true);
+        break;
+
+      case 17:
+        Energy.export_active[0] = value;
+        break;
+
+      case 18:
+        Energy.export_active[1] = value;
+        break;
+
+      case 19:
+        Energy.export_active[2] = value;
+        break;
+    }
   }
 }
 
@@ -202,6 +179,7 @@ void Sdm630SnsInit(void)
   uint8_t result = Sdm630Modbus->Begin(SDM630_SPEED);
   if (result) {
     if (2 == result) { ClaimSerial(); }
+    Sdm630Modbus->AddRegisters(SDM630_ADDR, 0x04, sdm630_start_addresses, ARRAY_SIZE(sdm630_start_addresses), 2);
     Energy.phase_count = 3;
     Energy.frequency_common = true;             // Use common frequency
   } else {
@@ -225,8 +203,8 @@ bool Xnrg10(uint8_t function)
   bool result = false;
 
   switch (function) {
-    case FUNC_EVERY_250_MSECOND:
-      if (uptime > 4) { SDM630Every250ms(); }
+    case FUNC_LOOP:
+      if (uptime > 4) { SDM630Loop(); }
       break;
     case FUNC_INIT:
       Sdm630SnsInit();
@@ -50,84 +50,62 @@ const uint16_t Ddsu666_start_addresses[] {
 
 struct DDSU666 {
   float import_active = NAN;
-  uint8_t read_state = 0;
-  uint8_t send_retry = 0;
 } Ddsu666;
 
 /*********************************************************************************************/
 
-void DDSU666Every250ms(void)
+void DDSU666Loop(void)
 {
-  bool data_ready = Ddsu666Modbus->ReceiveReady();
-
-  if (data_ready) {
-    uint8_t buffer[14];  // At least 5 + (2 * 2) = 9
-
-    uint32_t error = Ddsu666Modbus->ReceiveBuffer(buffer, 2);
-    AddLogBuffer(LOG_LEVEL_DEBUG_MORE, buffer, Ddsu666Modbus->ReceiveCount());
-
-    if (error) {
-      AddLog_P2(LOG_LEVEL_DEBUG, PSTR("SDM: Ddsu666 error %d"), error);
-    } else {
-      Energy.data_valid[0] = 0;
-
-      //  0  1  2  3  4  5  6  7  8
-      // SA FC BC Fh Fl Sh Sl Cl Ch
-      // 01 04 04 43 66 33 34 1B 38 = 230.2 Volt
-      float value;
-      ((uint8_t*)&value)[3] = buffer[3];   // Get float values
-      ((uint8_t*)&value)[2] = buffer[4];
-      ((uint8_t*)&value)[1] = buffer[5];
-      ((uint8_t*)&value)[0] = buffer[6];
-
-      switch(Ddsu666.read_state) {
-        case 0:
-          Energy.voltage[0] = value;          // 230.2 V
-          break;
-
-        case 1:
-          Energy.current[0]  = value;         // 1.260 A
-          break;
-
-        case 2:
-          Energy.active_power[0] = value * 1000;     // -196.3 W
-          break;
-
-        case 3:
-          Energy.reactive_power[0] = value * 1000;   // 92.2
-          break;
-
-        case 4:
-          Energy.power_factor[0] = value;     // 0.91
-          break;
-
-        case 5:
-          Energy.frequency[0] = value;        // 50.0 Hz
-          break;
-
-        case 6:
-          Ddsu666.import_active = value;    // 478.492 kWh
-          break;
-
-        case 7:
-          Energy.export_active[0] = value;    // 6.216 kWh
-          break;
-      }
-
-      Ddsu666.read_state++;
-
-      if (Ddsu666.read_state == 8) {
-        Ddsu666.read_state = 0;
+  if (Ddsu666Modbus->Poll() < 0) { return; }
+
+  AddLogBuffer(LOG_LEVEL_DEBUG_MORE, Ddsu666Modbus->PollBuffer(), Ddsu666Modbus->ReceiveCount());
+
+  uint32_t error = Ddsu666Modbus->PollError();
+  if (error) {
+    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("SDM: Ddsu666 error %d"), error);
+    return;
+  }
+
+  Energy.data_valid[0] = 0;
+
+  float value;
+  for (uint32_t i = 0; i < ARRAY_SIZE(Ddsu666_start_addresses); i++) {
+    if (!Ddsu666Modbus->Get32BitRegister(Ddsu666_start_addresses[i], &value)) { continue; }
+
+    switch(i) {
+      case 0:
+        Energy.voltage[0] = value;          // 230.2 V
+        break;
+
+      case 1:
+        Energy.current[0]  = value;         // 1.260 A
+        break;
+
+      case 2:
+        Energy.active_power[0] = value * 1000;     // -196.3 W
+        break;
+
+      case 3:
+        Energy.reactive_power[0] = value * 1000;   // 92.2
+        break;
+
+      case 4:
+        Energy.power_factor[0] = value;     // 0.91
+        break;
+
+      case 5:
+        Energy.frequency[0] = value;        // 50.0 Hz
+        break;
+
+      case 6:
+        Ddsu666.import_active = value;    // 478.492 kWh
+        break;
+
+      case 7:
+        Energy.export_active[0] = value;    // 6.216 kWh
         EnergyUpdateTotal(Ddsu666.import_active, true);  // 484.708 kWh
-      }
+        break;
     }
-  } // end data ready
-
-  if (0 == Ddsu666.send_retry || data_ready) {
-    Ddsu666.send_retry = 5;
-    Ddsu666Modbus->Send(DDSU666_ADDR, 0x04, Ddsu666_start_addresses[Ddsu666.read_state], 2);
-  } else {
-    Ddsu666.send_retry--;
   }
 }
 
@@ -137,6 +115,7 @@ void Ddsu666SnsInit(void)
   uint8_t result = Ddsu666Modbus->Begin(DDSU666_SPEED);
   if (result) {
     if (2 == result) { ClaimSerial(); }
+    Ddsu666Modbus->AddRegisters(DDSU666_ADDR, 0x04, Ddsu666_start_addresses, ARRAY_SIZE(Ddsu666_start_addresses), 2);
   } else {
     energy_flg = ENERGY_NONE;
   }
@@ -158,8 +137,8 @@ bool Xnrg11(uint8_t function)
   bool result = false;
 
   switch (function) {
-    case FUNC_EVERY_250_MSECOND:
-      if (uptime > 4) { DDSU666Every250ms(); }
+    case FUNC_LOOP:
+      if (uptime > 4) { DDSU666Loop(); }
       break;
     case FUNC_INIT:
       Ddsu666SnsInit();
@@ -20,10 +20,20 @@
 #ifdef USE_COUNTER
 /*********************************************************************************************\
  * Counter sensors (water meters, electricity meters etc.)
+ *
+ * CounterType<x> 2 measures the pulse frequency of high rate inputs like flow meters and RPM
+ * sensors. Pulses are counted without debounce by a hardware pulse counter (ESP32) or an
+ * interrupt doing nothing but the count. Every 250 mSec the count is sampled with its micros()
+ * time and the frequency is the average over the last COUNTER_FREQ_SAMPLES samples.
 \*********************************************************************************************/
 
 #define XSNS_01             1
 
+#define COUNTER_PCNT_FILTER 12800        // ESP32 hardware pulse counter glitch filter in nSec (max 12.8 uSec)
+#ifndef COUNTER_FREQ_SAMPLES
+#define COUNTER_FREQ_SAMPLES 4           // Frequency gate window in 250 mSec samples
+#endif
+
 #define D_PRFX_COUNTER "Counter"
 #define D_CMND_COUNTERTYPE "Type"
 #define D_CMND_COUNTERDEBOUNCE "Debounce"
@@ -41,9 +51,23 @@ struct COUNTER {
   uint32_t timer_low_high[MAX_COUNTERS];  // Last low/high counter time in micro seconds
   uint8_t no_pullup = 0;         // Counter input pullup flag (1 = No pullup)
   uint8_t pin_state = 0;         // LSB0..3 Last state of counter pin; LSB7==0 IRQ is FALLING, LSB7==1 IRQ is CHANGE
+#ifdef ESP32
+  int8_t pcnt[MAX_COUNTERS] = { -1, -1, -1, -1 };  // Hardware pulse counter unit or -1 for interrupt counting
+#endif  // ESP32
   bool any_counter = false;
+  uint8_t freq_mask = 0;         // LSB0..3 Counter in frequency mode (pulse_counter_type bit 4..7)
 } Counter;
 
+struct COUNTER_FREQ {
+  uint32_t pulses[COUNTER_FREQ_SAMPLES];  // Pulses per sample
+  uint32_t time[COUNTER_FREQ_SAMPLES];    // Sample duration in micro seconds
+  uint32_t last_count;
+  uint32_t last_time;            // micros() of the last sample
+  float frequency;               // Hz
+  uint8_t index;
+  uint8_t samples;
+} CounterFreq[MAX_COUNTERS];
+
 #ifndef ARDUINO_ESP8266_RELEASE_2_3_0  // Fix core 2.5.x ISR not in IRAM Exception
 void CounterUpdate(uint8_t index) ICACHE_RAM_ATTR;
 void CounterUpdate1(void) ICACHE_RAM_ATTR;
@@ -54,6 +78,11 @@ void CounterUpdate4(void) ICACHE_RAM_ATTR;
 
 void CounterUpdate(uint8_t index)
 {
+  if (bitRead(Counter.freq_mask, index)) {
+    RtcSettings.pulse_counter[index]++;  // Frequency mode needs the count only
+    return;
+  }
+
   uint32_t time = micros();
   uint32_t debounce_time;
 
@@ -126,11 +155,31 @@ void CounterInit(void)
   typedef void (*function) () ;
   function counter_callbacks[] = { CounterUpdate1, CounterUpdate2, CounterUpdate3, CounterUpdate4 };
 
+  Counter.freq_mask = (Settings.pulse_counter_type >> MAX_COUNTERS) & ((1 << MAX_COUNTERS) -1);
   for (uint32_t i = 0; i < MAX_COUNTERS; i++) {
     if (PinUsed(GPIO_CNTR1, i)) {
       Counter.any_counter = true;
       pinMode(Pin(GPIO_CNTR1, i), bitRead(Counter.no_pullup, i) ? INPUT : INPUT_PULLUP);
-      if ((0 == Settings.pulse_counter_debounce_low) && (0 == Settings.pulse_counter_debounce_high)) {
+      memset(&CounterFreq[i], 0, sizeof(COUNTER_FREQ));
+      CounterFreq[i].last_count = RtcSettings.pulse_counter[i];
+      CounterFreq[i].last_time = micros();
+#ifdef ESP32
+      // Count pulses in hardware unless pulse time or low/high debounce needs timing of each edge
+      PcntDetach(Counter.pcnt[i]);
+      Counter.pcnt[i] = -1;
+      if (bitRead(Counter.freq_mask, i) || (!bitRead(Settings.pulse_counter_type, i) &&
+          (0 == Settings.pulse_counter_debounce_low) && (0 == Settings.pulse_counter_debounce_high))) {
+        Counter.pcnt[i] = PcntAttach(Pin(GPIO_CNTR1, i), COUNTER_PCNT_FILTER);
+        if (Counter.pcnt[i] >= 0) {
+          detachInterrupt(Pin(GPIO_CNTR1, i));
+          if (bitRead(Counter.no_pullup, i)) { gpio_pullup_dis((gpio_num_t)Pin(GPIO_CNTR1, i)); }
+          continue;
+        }
+      }
+#endif  // ESP32
+      if (bitRead(Counter.freq_mask, i)) {
+        attachInterrupt(Pin(GPIO_CNTR1, i), counter_callbacks[i], FALLING);
+      } else if ((0 == Settings.pulse_counter_debounce_low) && (0 == Settings.pulse_counter_debounce_high)) {
         Counter.pin_state = 0;
         attachInterrupt(Pin(GPIO_CNTR1, i), counter_callbacks[i], FALLING);
       } else {
@@ -141,6 +190,45 @@ void CounterInit(void)
   }
 }
 
+#ifdef ESP32
+void CounterPcntPoll(void)
+{
+  for (uint32_t i = 0; i < MAX_COUNTERS; i++) {
+    if (Counter.pcnt[i] >= 0) {
+      RtcSettings.pulse_counter[i] += PcntDebounced(Counter.pcnt[i], (bitRead(Counter.freq_mask, i)) ? 0 : Settings.pulse_counter_debounce);
+    }
+  }
+}
+#endif  // ESP32
+
+void CounterFreqSample(void)
+{
+  if (!Counter.freq_mask) { return; }
+#ifdef ESP32
+  CounterPcntPoll();                     // Include pulses up to now
+#endif  // ESP32
+  uint32_t now = micros();
+  for (uint32_t i = 0; i < MAX_COUNTERS; i++) {
+    if (!bitRead(Counter.freq_mask, i) || !PinUsed(GPIO_CNTR1, i)) { continue; }
+    COUNTER_FREQ *freq = &CounterFreq[i];
+    uint32_t count = RtcSettings.pulse_counter[i];
+    freq->pulses[freq->index] = (count >= freq->last_count) ? count - freq->last_count : count;  // Counter reset or set
+    freq->time[freq->index] = now - freq->last_time;
+    freq->last_count = count;
+    freq->last_time = now;
+    freq->index = (freq->index +1) % COUNTER_FREQ_SAMPLES;
+    if (freq->samples < COUNTER_FREQ_SAMPLES) { freq->samples++; }
+
+    uint32_t pulses = 0;
+    uint32_t time = 0;
+    for (uint32_t j = 0; j < freq->samples; j++) {
+      pulses += freq->pulses[j];
+      time += freq->time[j];
+    }
+    freq->frequency = (time) ? (float)pulses * 1000000 / time : 0;
+  }
+}
+
 void CounterEverySecond(void)
 {
   for (uint32_t i = 0; i < MAX_COUNTERS; i++) {
@@ -171,6 +259,11 @@ void CounterShow(bool json)
   for (uint32_t i = 0; i < MAX_COUNTERS; i++) {
     if (PinUsed(GPIO_CNTR1, i)) {
       char counter[33];
+      char frequency[33];
+      bool freq_mode = bitRead(Counter.freq_mask, i);
+      if (freq_mode) {
+        dtostrfd(CounterFreq[i].frequency, 3, frequency);
+      }
       if (bitRead(Settings.pulse_counter_type, i)) {
         dtostrfd((double)RtcSettings.pulse_counter[i] / 1000000, 6, counter);
       } else {
@@ -183,6 +276,9 @@ void CounterShow(bool json)
           ResponseAppend_P(PSTR(",\"COUNTER\":{"));
         }
         ResponseAppend_P(PSTR("%s\"C%d\":%s"), (header)?",":"", i +1, counter);
+        if (freq_mode) {
+          ResponseAppend_P(PSTR(",\"" D_JSON_FREQUENCY "%d\":%s,\"RPM%d\":%d"), i +1, frequency, i +1, (int)(CounterFreq[i].frequency * 60));
+        }
         header = true;
 #ifdef USE_DOMOTICZ
         if ((0 == tele_period) && (1 == dsxflg)) {
@@ -197,6 +293,9 @@ void CounterShow(bool json)
       } else {
         WSContentSend_PD(PSTR("{s}" D_COUNTER "%d{m}%s%s{e}"),
           i +1, counter, (bitRead(Settings.pulse_counter_type, i)) ? " " D_UNIT_SECOND : "");
+        if (freq_mode) {
+          WSContentSend_PD(PSTR("{s}" D_COUNTER "%d " D_FREQUENCY "{m}%s " D_UNIT_HERTZ "{e}"), i +1, frequency);
+        }
 #endif  // USE_WEBSERVER
       }
     }
@@ -229,12 +328,16 @@ void CmndCounter(void)
 void CmndCounterType(void)
 {
   if ((XdrvMailbox.index > 0) && (XdrvMailbox.index <= MAX_COUNTERS)) {
-    if ((XdrvMailbox.payload >= 0) && (XdrvMailbox.payload <= 1) && PinUsed(GPIO_CNTR1, XdrvMailbox.index -1)) {
-      bitWrite(Settings.pulse_counter_type, XdrvMailbox.index -1, XdrvMailbox.payload &1);
-      RtcSettings.pulse_counter[XdrvMailbox.index -1] = 0;
-      Settings.pulse_counter[XdrvMailbox.index -1] = 0;
+    uint32_t index = XdrvMailbox.index -1;
+    if ((XdrvMailbox.payload >= 0) && (XdrvMailbox.payload <= 2) && PinUsed(GPIO_CNTR1, index)) {
+      // 0 = pulse count, 1 = pulse time, 2 = pulse count and frequency
+      bitWrite(Settings.pulse_counter_type, index, 1 == XdrvMailbox.payload);
+      bitWrite(Settings.pulse_counter_type, MAX_COUNTERS + index, 2 == XdrvMailbox.payload);
+      RtcSettings.pulse_counter[index] = 0;
+      Settings.pulse_counter[index] = 0;
+      CounterInit();  // Pulse time needs interrupt counting, frequency mode needs light counting
     }
-    ResponseCmndIdxNumber(bitRead(Settings.pulse_counter_type, XdrvMailbox.index -1));
+    ResponseCmndIdxNumber(bitRead(Settings.pulse_counter_type, MAX_COUNTERS + index) ? 2 : bitRead(Settings.pulse_counter_type, index));
   }
 }
 
@@ -274,6 +377,14 @@ bool Xsns01(uint8_t function)
 
   if (Counter.any_counter) {
     switch (function) {
+#ifdef ESP32
+      case FUNC_EVERY_50_MSECOND:
+        CounterPcntPoll();
+        break;
+#endif  // ESP32
+      case FUNC_EVERY_250_MSECOND:
+        CounterFreqSample();
+        break;
       case FUNC_EVERY_SECOND:
         CounterEverySecond();
         break;
@@ -297,6 +408,10 @@ bool Xsns01(uint8_t function)
     switch (function) {
       case FUNC_INIT:
         CounterInit();
+#ifdef ESP32
+        XsnsSubscribe(FUNC_EVERY_50_MSECOND);
+#endif  // ESP32
+        XsnsSubscribe(FUNC_EVERY_250_MSECOND);
         break;
       case FUNC_PIN_STATE:
         result = CounterPinState();
@@ -20,10 +20,29 @@
 #ifndef USE_ADC_VCC
 /*********************************************************************************************\
  * ADC support
+ *
+ * A ticker samples the ADC in the background into a ring buffer so AdcRead() averages the
+ * latest samples without blocking. For CT power the samples of each ADC_CT_WINDOW mS, a whole
+ * number of 50 Hz and 60 Hz mains cycles, are summed to get the mean and true RMS of the wave.
 \*********************************************************************************************/
 
 #define XSNS_02                       2
 
+#include <Ticker.h>
+
+#ifndef ADC_SAMPLE_INTERVAL
+#define ADC_SAMPLE_INTERVAL           8                // mS between samples, 32 samples cover 256 mS
+#endif
+#ifndef ADC_CT_SAMPLE_INTERVAL
+#ifdef ESP8266
+#define ADC_CT_SAMPLE_INTERVAL        2                // mS between CT samples, faster disturbs WiFi
+#else
+#define ADC_CT_SAMPLE_INTERVAL        1                // mS between CT samples
+#endif
+#endif
+#define ADC_CT_WINDOW                 1000             // mS of whole 50 Hz and 60 Hz mains cycles
+#define ADC_RING_SIZE                 32               // Samples kept for AdcRead(5)
+
 #define TO_CELSIUS(x) ((x) - 273.15)
 #define TO_KELVIN(x) ((x) + 273.15)
 
@@ -65,10 +84,48 @@ struct {
   float temperature = 0;
   float current = 0;
   float energy = 0;
+  float ct_mean = 0;                        // Mean of the last complete CT window
+  float ct_rms = 0;                         // RMS around the mean of the last complete CT window
+  uint64_t window_sumsq = 0;
+  uint32_t window_sum = 0;
+  uint32_t window_count = 0;
+  uint32_t window_start = 0;
   uint32_t previous_millis = 0;
   uint16_t last_value = 0;
+  uint16_t ring[ADC_RING_SIZE];
+  uint8_t ring_index = 0;
+  uint8_t ring_count = 0;
+  bool ct_valid = false;                    // A complete CT window was measured
 } Adc;
 
+Ticker TickerAdc;
+
+void AdcSample(void)
+{
+  uint16_t analog = analogRead(A0);
+  Adc.ring[Adc.ring_index] = analog;
+  Adc.ring_index = (Adc.ring_index +1) % ADC_RING_SIZE;
+  if (Adc.ring_count < ADC_RING_SIZE) { Adc.ring_count++; }
+
+  if (ADC0_CT_POWER == my_adc0) {
+    Adc.window_sum += analog;
+    Adc.window_sumsq += analog * analog;
+    Adc.window_count++;
+    uint32_t now = millis();
+    if (now - Adc.window_start >= ADC_CT_WINDOW) {
+      float mean = (float)Adc.window_sum / Adc.window_count;
+      float variance = (float)Adc.window_sumsq / Adc.window_count - mean * mean;
+      Adc.ct_mean = mean;
+      Adc.ct_rms = (variance > 0) ? sqrtf(variance) : 0;
+      Adc.ct_valid = true;
+      Adc.window_sum = 0;
+      Adc.window_sumsq = 0;
+      Adc.window_count = 0;
+      Adc.window_start = now;
+    }
+  }
+}
+
 void AdcInit(void)
 {
   if ((Settings.adc_param_type != my_adc0) || (Settings.adc_param1 > 1000000)) {
@@ -99,6 +156,9 @@ void AdcInit(void)
       Settings.adc_param3 = ANALOG_CT_VOLTAGE;            //(int)      10
     }
   }
+
+  Adc.window_start = millis();
+  TickerAdc.attach_ms((ADC0_CT_POWER == my_adc0) ? ADC_CT_SAMPLE_INTERVAL : ADC_SAMPLE_INTERVAL, AdcSample);
 }
 
 uint16_t AdcRead(uint8_t factor)
@@ -109,10 +169,18 @@ uint16_t AdcRead(uint8_t factor)
   // factor 4 = 16 samples
   // factor 5 = 32 samples
   uint8_t samples = 1 << factor;
-  uint16_t analog = 0;
-  for (uint32_t i = 0; i < samples; i++) {
-    analog += analogRead(A0);
-    delay(1);
+  uint32_t analog = 0;
+  if (Adc.ring_count >= samples) {     // Average of the latest background samples
+    uint32_t index = Adc.ring_index;
+    for (uint32_t i = 0; i < samples; i++) {
+      index = (index + ADC_RING_SIZE -1) % ADC_RING_SIZE;
+      analog += Adc.ring[index];
+    }
+  } else {
+    for (uint32_t i = 0; i < samples; i++) {
+      analog += analogRead(A0);
+      delay(1);
+    }
   }
   analog >>= factor;
   return analog;
@@ -155,35 +223,18 @@ uint16_t AdcGetRange(void)
   return (uint16_t)adcrange;
 }
 
-void AdcGetCurrentPower(uint8_t factor)
+void AdcGetCurrentPower(void)
 {
-  // factor 1 = 2 samples
-  // factor 2 = 4 samples
-  // factor 3 = 8 samples
-  // factor 4 = 16 samples
-  // factor 5 = 32 samples
-  uint8_t samples = 1 << factor;
-  uint16_t analog = 0;
-  uint16_t analog_min = 1023;
-  uint16_t analog_max = 0;
+  // Uses the mean and RMS of the last complete window of background samples
+  if (!Adc.ct_valid) { return; }
 
   if (0 == Settings.adc_param1) {
-    for (uint32_t i = 0; i < samples; i++) {
-      analog = analogRead(A0);
-      if (analog < analog_min) {
-        analog_min = analog;
-      }
-      if (analog > analog_max) {
-        analog_max = analog;
-      }
-      delay(1);
-    }
-    Adc.current = (float)(analog_max-analog_min) * ((float)(Settings.adc_param2) / 100000);
+    // The multiplier converts a peak to peak range, which is 2 * sqrt(2) times the RMS of a sine
+    Adc.current = Adc.ct_rms * 2.828427f * ((float)(Settings.adc_param2) / 100000);
   }
   else {
-    analog = AdcRead(5);
-    if (analog > Settings.adc_param1) {
-     Adc.current = ((float)(analog) - (float)Settings.adc_param1) * ((float)(Settings.adc_param2) / 100000);
+    if (Adc.ct_mean > Settings.adc_param1) {
+     Adc.current = (Adc.ct_mean - (float)Settings.adc_param1) * ((float)(Settings.adc_param2) / 100000);
     }
     else {
       Adc.current = 0;
@@ -207,7 +258,7 @@ void AdcEverySecond(void)
     Adc.temperature = ConvertTemp(TO_CELSIUS(T));
   }
   else if (ADC0_CT_POWER == my_adc0) {
-    AdcGetCurrentPower(5);
+    AdcGetCurrentPower();
   }
 }
 
@@ -278,7 +329,7 @@ void AdcShow(bool json)
   }
 
   else if (ADC0_CT_POWER == my_adc0) {
-    AdcGetCurrentPower(5);
+    AdcGetCurrentPower();
 
     float voltage = (float)(Settings.adc_param3) / 10;
     char voltage_chr[FLOATSZ];
@@ -440,6 +491,9 @@ bool Xsns02(uint8_t function)
             break;
           case FUNC_INIT:
             AdcInit();
+#ifdef USE_RULES
+            XsnsSubscribe(FUNC_EVERY_250_MSECOND);
+#endif  // USE_RULES
             break;
           case FUNC_JSON_APPEND:
             AdcShow(1);
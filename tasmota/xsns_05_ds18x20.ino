@@ -20,12 +20,22 @@
 #ifdef USE_DS18x20
 /*********************************************************************************************\
  * DS18B20 - Temperature - Multiple sensors
+ *
+ * A broadcast convert is followed by reading one scratchpad per 50 mSec tick so the bus
+ * never blocks the loop for more than a single sensor transaction.
+ *
+ * With USE_DS18x20_RMT the single pin bus timing on ESP32 is generated by the RMT peripheral
+ * instead of busy waiting on digitalRead() and digitalWrite().
 \*********************************************************************************************/
 
 #define XSNS_05              5
 
 //#define USE_DS18x20_RECONFIGURE    // When sensor is lost keep retrying or re-configure
 
+#ifndef ESP32
+#undef USE_DS18x20_RMT             // RMT peripheral is ESP32 only
+#endif
+
 #define DS18S20_CHIPID       0x10  // +/-0.5C 9-bit
 #define DS1822_CHIPID        0x22  // +/-2C 12-bit
 #define DS18B20_CHIPID       0x28  // +/-0.5C 12-bit
@@ -38,6 +48,8 @@
 #define W1_READ_SCRATCHPAD   0xBE
 
 #define DS18X20_MAX_SENSORS  8
+#define DS18X20_CONVERT_TIME 750   // mSec for 12-bit conversion
+#define DS18X20_READ_RETRY   3
 
 const char kDs18x20Types[] PROGMEM = "DS18x20|DS18S20|DS1822|DS18B20|MAX31850";
 
@@ -59,6 +71,15 @@ uint8_t ds18x20_sensor_curr = 0;
 unsigned long w1_power_until = 0;
 #endif
 
+enum Ds18x20States { DS18X20_IDLE, DS18X20_CONVERTING, DS18X20_READING };
+
+struct {
+  uint32_t convert_time = 0;       // Conversion done
+  uint8_t state = DS18X20_IDLE;
+  uint8_t sensor = 0;              // Next sensor to read
+  uint8_t retry = 0;
+} Ds18x20Cycle;
+
 /*********************************************************************************************\
  * Embedded tuned OneWire library
 \*********************************************************************************************/
@@ -73,10 +94,146 @@ unsigned char onewire_rom_id[8] = { 0 };
 
 /*------------------------------------------------------------------------------------------*/
 
+#ifdef USE_DS18x20_RMT
+/*********************************************************************************************\
+ * ESP32 RMT 1-Wire engine
+ *
+ * TX and RX channel share the open drain pin. RX records the bus levels including those of the
+ * master so presence and read slots are decoded from the received low durations.
+\*********************************************************************************************/
+
+#include <driver/rmt.h>
+
+#define W1_RMT_TX_CHANNEL    RMT_CHANNEL_6
+#define W1_RMT_RX_CHANNEL    RMT_CHANNEL_7
+
+struct {
+  RingbufHandle_t rx_buffer = nullptr;
+  bool active = false;
+} OneWireRmt;
+
+bool OneWireRmtInit(void)
+{
+  rmt_config_t config;
+
+  // Receiver first as configuring the transmitter takes over the pin direction
+  memset(&config, 0, sizeof(config));
+  config.rmt_mode = RMT_MODE_RX;
+  config.channel = W1_RMT_RX_CHANNEL;
+  config.gpio_num = (gpio_num_t)ds18x20_pin;
+  config.clk_div = 80;             // 1 uSec ticks
+  config.mem_block_num = 1;
+  config.rx_config.filter_en = true;
+  config.rx_config.filter_ticks_thresh = 30;
+  config.rx_config.idle_threshold = 80;
+  if ((rmt_config(&config) != ESP_OK) || (rmt_driver_install(config.channel, 512, 0) != ESP_OK)) { return false; }
+  rmt_get_ringbuf_handle(config.channel, &OneWireRmt.rx_buffer);
+
+  memset(&config, 0, sizeof(config));
+  config.rmt_mode = RMT_MODE_TX;
+  config.channel = W1_RMT_TX_CHANNEL;
+  config.gpio_num = (gpio_num_t)ds18x20_pin;
+  config.clk_div = 80;
+  config.mem_block_num = 1;
+  config.tx_config.idle_level = RMT_IDLE_LEVEL_HIGH;
+  config.tx_config.idle_output_en = true;
+  if ((rmt_config(&config) != ESP_OK) || (rmt_driver_install(config.channel, 0, 0) != ESP_OK)) {
+    rmt_driver_uninstall(W1_RMT_RX_CHANNEL);
+    return false;
+  }
+
+  PIN_INPUT_ENABLE(GPIO_PIN_MUX_REG[ds18x20_pin]);
+  GPIO.pin[ds18x20_pin].pad_driver = 1;  // Open drain
+  if (Settings.flag3.ds18x20_internal_pullup) {  // SetOption74 - Enable internal pullup for single DS18x20 sensor
+    gpio_pullup_en((gpio_num_t)ds18x20_pin);
+  }
+  AddLog_P(LOG_LEVEL_DEBUG, PSTR(D_LOG_DSB "RMT"));
+  return true;
+}
+
+uint32_t OneWireRmtTransfer(rmt_item32_t *tx, uint32_t count, uint16_t idle_threshold, rmt_item32_t *rx, uint32_t rx_size)
+{
+  // Returns number of received items, up to rx_size
+  size_t size;
+  void *item;
+  while ((item = xRingbufferReceive(OneWireRmt.rx_buffer, &size, 0))) {
+    vRingbufferReturnItem(OneWireRmt.rx_buffer, item);  // Drop stale items
+  }
+
+  rmt_set_rx_idle_thresh(W1_RMT_RX_CHANNEL, idle_threshold);
+  rmt_rx_start(W1_RMT_RX_CHANNEL, true);
+  rmt_write_items(W1_RMT_TX_CHANNEL, tx, count, true);
+  rmt_item32_t *items = (rmt_item32_t*)xRingbufferReceive(OneWireRmt.rx_buffer, &size, pdMS_TO_TICKS(10));
+  rmt_rx_stop(W1_RMT_RX_CHANNEL);
+
+  uint32_t received = 0;
+  if (items) {
+    received = size / sizeof(rmt_item32_t);
+    if (received > rx_size) { received = rx_size; }
+    memcpy(rx, items, received * sizeof(rmt_item32_t));
+    vRingbufferReturnItem(OneWireRmt.rx_buffer, items);
+  }
+  return received;
+}
+
+uint8_t OneWireRmtReset(void)
+{
+  rmt_item32_t tx;
+  rmt_item32_t rx[2];
+
+  tx.level0 = 0;
+  tx.duration0 = 480;
+  tx.level1 = 1;
+  tx.duration1 = 0;
+  // Reset pulse followed by a presence pulse, the bus then stays idle for 300 uSec
+  return ((2 == OneWireRmtTransfer(&tx, 1, 300, rx, 2)) && (0 == rx[1].level0)) ? 1 : 0;
+}
+
+void OneWireRmtWrite(uint8_t v, uint32_t bits)
+{
+  rmt_item32_t tx[8];
+
+  for (uint32_t i = 0; i < bits; i++) {
+    tx[i].level0 = 0;
+    tx[i].duration0 = (v & 1) ? 6 : 60;
+    tx[i].level1 = 1;
+    tx[i].duration1 = (v & 1) ? 64 : 10;
+    v >>= 1;
+  }
+  rmt_write_items(W1_RMT_TX_CHANNEL, tx, bits, true);
+}
+
+uint8_t OneWireRmtRead(uint32_t bits)
+{
+  rmt_item32_t tx[8];
+  rmt_item32_t rx[8];
+
+  for (uint32_t i = 0; i < bits; i++) {
+    tx[i].level0 = 0;
+    tx[i].duration0 = 2;
+    tx[i].level1 = 1;
+    tx[i].duration1 = 68;
+  }
+  uint32_t received = OneWireRmtTransfer(tx, bits, 80, rx, bits);
+  uint8_t r = 0;
+  for (uint32_t i = 0; i < bits; i++) {
+    // A missing slot reads as 1 like an idle bus
+    if ((i >= received) || (rx[i].duration0 < 15)) {
+      r |= (1 << i);
+    }
+  }
+  return r;
+}
+#endif  // USE_DS18x20_RMT
+
 uint8_t OneWireReset(void)
 {
   uint8_t retries = 125;
 
+#ifdef USE_DS18x20_RMT
+  if (OneWireRmt.active) { return OneWireRmtReset(); }
+#endif  // USE_DS18x20_RMT
+
   if (!ds18x20_dual_mode) {
     pinMode(ds18x20_pin, Settings.flag3.ds18x20_internal_pullup ? INPUT_PULLUP : INPUT);  // SetOption74 - Enable internal pullup for single DS18x20 sensor
     do {
@@ -117,6 +274,12 @@ void OneWireWriteBit(uint8_t v)
   static const uint8_t delay_high[2] = { 5, 55 };
 
   v &= 1;
+#ifdef USE_DS18x20_RMT
+  if (OneWireRmt.active) {
+    OneWireRmtWrite(v, 1);
+    return;
+  }
+#endif  // USE_DS18x20_RMT
   if (!ds18x20_dual_mode) {
     digitalWrite(ds18x20_pin, LOW);
     pinMode(ds18x20_pin, OUTPUT);
@@ -132,6 +295,9 @@ void OneWireWriteBit(uint8_t v)
 
 uint8_t OneWire1ReadBit(void)
 {
+#ifdef USE_DS18x20_RMT
+  if (OneWireRmt.active) { return OneWireRmtRead(1); }
+#endif  // USE_DS18x20_RMT
   pinMode(ds18x20_pin, OUTPUT);
   digitalWrite(ds18x20_pin, LOW);
   delayMicroseconds(3);
@@ -157,6 +323,12 @@ uint8_t OneWire2ReadBit(void)
 
 void OneWireWrite(uint8_t v)
 {
+#ifdef USE_DS18x20_RMT
+  if (OneWireRmt.active) {
+    OneWireRmtWrite(v, 8);
+    return;
+  }
+#endif  // USE_DS18x20_RMT
   for (uint8_t bit_mask = 0x01; bit_mask; bit_mask <<= 1) {
     OneWireWriteBit((bit_mask & v) ? 1 : 0);
   }
@@ -166,6 +338,9 @@ uint8_t OneWireRead(void)
 {
   uint8_t r = 0;
 
+#ifdef USE_DS18x20_RMT
+  if (OneWireRmt.active) { return OneWireRmtRead(8); }
+#endif  // USE_DS18x20_RMT
   if (!ds18x20_dual_mode) {
     for (uint8_t bit_mask = 0x01; bit_mask; bit_mask <<= 1) {
       if (OneWire1ReadBit()) {
@@ -312,6 +487,12 @@ void Ds18x20Init(void)
     pinMode(ds18x20_pin_out, OUTPUT);
     pinMode(ds18x20_pin, Settings.flag3.ds18x20_internal_pullup ? INPUT_PULLUP : INPUT);  // SetOption74 - Enable internal pullup for single DS18x20 sensor
   }
+#ifdef USE_DS18x20_RMT
+  else if (!OneWireRmt.active) {
+    OneWireRmt.active = OneWireRmtInit();
+  }
+#endif  // USE_DS18x20_RMT
+  Ds18x20Cycle.state = DS18X20_IDLE;
 
   OneWireResetSearch();
 
@@ -341,6 +522,11 @@ void Ds18x20Init(void)
     }
   }
   AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_DSB D_SENSORS_FOUND " %d"), ds18x20_sensors);
+#ifdef USE_PROMETHEUS
+  for (uint32_t i = 0; i < ds18x20_sensors; i++) {
+    MetricRegister(PSTR("ds18x20_temperature"), METRIC_GAUGE | Settings.flag2.temperature_resolution, &ds18x20_sensor[ds18x20_sensor[i].index].temperature, PSTR("sensor"), i +1);
+  }
+#endif  // USE_PROMETHEUS
 }
 
 void Ds18x20Convert(void)
@@ -358,67 +544,66 @@ void Ds18x20Convert(void)
 //  delay(750);                          // 750ms should be enough for 12bit conv
 }
 
+bool Ds18x20Store(uint8_t sensor, float celsius)
+{
+  uint8_t index = ds18x20_sensor[sensor].index;
+  ds18x20_sensor[index].temperature = ConvertTemp(celsius);
+  ds18x20_sensor[index].valid = SENSOR_MAX_MISS;
+  TempSensorReading(sensor +1, celsius);
+  return true;
+}
+
 bool Ds18x20Read(uint8_t sensor)
 {
   uint8_t data[9];
   int8_t sign = 1;
 
   uint8_t index = ds18x20_sensor[sensor].index;
-  if (ds18x20_sensor[index].valid) { ds18x20_sensor[index].valid--; }
-  for (uint32_t retry = 0; retry < 3; retry++) {
-    OneWireReset();
-    OneWireSelect(ds18x20_sensor[index].address);
-    OneWireWrite(W1_READ_SCRATCHPAD);
-    for (uint32_t i = 0; i < 9; i++) {
-      data[i] = OneWireRead();
-    }
-    if (OneWireCrc8(data)) {
+  OneWireReset();
+  OneWireSelect(ds18x20_sensor[index].address);
+  OneWireWrite(W1_READ_SCRATCHPAD);
+  for (uint32_t i = 0; i < 9; i++) {
+    data[i] = OneWireRead();
+  }
+  if (OneWireCrc8(data)) {
       switch(ds18x20_sensor[index].address[0]) {
-        case DS18S20_CHIPID: {
-          if (data[1] > 0x80) {
-            data[0] = (~data[0]) +1;
-            sign = -1;                     // App-Note fix possible sign error
-          }
-          float temp9 = (float)(data[0] >> 1) * sign;
-          ds18x20_sensor[index].temperature = ConvertTemp((temp9 - 0.25) + ((16.0 - data[6]) / 16.0));
-          ds18x20_sensor[index].valid = SENSOR_MAX_MISS;
-          return true;
+      case DS18S20_CHIPID: {
+        if (data[1] > 0x80) {
+          data[0] = (~data[0]) +1;
+          sign = -1;                     // App-Note fix possible sign error
         }
-        case DS1822_CHIPID:
-        case DS18B20_CHIPID: {
-          if (data[4] != 0x7F) {
-            data[4] = 0x7F;                 // Set resolution to 12-bit
-            OneWireReset();
-            OneWireSelect(ds18x20_sensor[index].address);
-            OneWireWrite(W1_WRITE_SCRATCHPAD);
-            OneWireWrite(data[2]);          // Th Register
-            OneWireWrite(data[3]);          // Tl Register
-            OneWireWrite(data[4]);          // Configuration Register
-            OneWireSelect(ds18x20_sensor[index].address);
-            OneWireWrite(W1_WRITE_EEPROM);  // Save scratchpad to EEPROM
+        float temp9 = (float)(data[0] >> 1) * sign;
+        return Ds18x20Store(sensor, (temp9 - 0.25) + ((16.0 - data[6]) / 16.0));
+      }
+      case DS1822_CHIPID:
+      case DS18B20_CHIPID: {
+        if (data[4] != 0x7F) {
+          data[4] = 0x7F;                 // Set resolution to 12-bit
+          OneWireReset();
+          OneWireSelect(ds18x20_sensor[index].address);
+          OneWireWrite(W1_WRITE_SCRATCHPAD);
+          OneWireWrite(data[2]);          // Th Register
+          OneWireWrite(data[3]);          // Tl Register
+          OneWireWrite(data[4]);          // Configuration Register
+          OneWireSelect(ds18x20_sensor[index].address);
+          OneWireWrite(W1_WRITE_EEPROM);  // Save scratchpad to EEPROM
 #ifdef W1_PARASITE_POWER
-            w1_power_until = millis() + 10; // 10ms specified duration for EEPROM write
+          w1_power_until = millis() + 10; // 10ms specified duration for EEPROM write
 #endif
-          }
-          uint16_t temp12 = (data[1] << 8) + data[0];
-          if (temp12 > 2047) {
-            temp12 = (~temp12) +1;
-            sign = -1;
-          }
-          ds18x20_sensor[index].temperature = ConvertTemp(sign * temp12 * 0.0625);  // Divide by 16
-          ds18x20_sensor[index].valid = SENSOR_MAX_MISS;
-          return true;
         }
-        case MAX31850_CHIPID: {
-          int16_t temp14 = (data[1] << 8) + (data[0] & 0xFC);
-          ds18x20_sensor[index].temperature = ConvertTemp(temp14 * 0.0625);  // Divide by 16
-          ds18x20_sensor[index].valid = SENSOR_MAX_MISS;
-          return true;
+        uint16_t temp12 = (data[1] << 8) + data[0];
+        if (temp12 > 2047) {
+          temp12 = (~temp12) +1;
+          sign = -1;
         }
+        return Ds18x20Store(sensor, sign * temp12 * 0.0625);  // Divide by 16
+      }
+      case MAX31850_CHIPID: {
+        int16_t temp14 = (data[1] << 8) + (data[0] & 0xFC);
+        return Ds18x20Store(sensor, temp14 * 0.0625);  // Divide by 16
       }
     }
   }
-  AddLog_P(LOG_LEVEL_DEBUG, PSTR(D_LOG_DSB D_SENSOR_CRC_ERROR));
   return false;
 }
 
@@ -449,6 +634,7 @@ void Ds18x20EverySecond(void)
   if (now < w1_power_until)
     return;
 #endif
+  if (Ds18x20Cycle.state != DS18X20_IDLE) { return; }  // Previous cycle still reading
   if (uptime & 1
 #ifdef W1_PARASITE_POWER
       // if more than 1 sensor and only parasite power: convert every cycle
@@ -457,20 +643,41 @@ void Ds18x20EverySecond(void)
   ) {
     // 2mS
     Ds18x20Convert();          // Start conversion, takes up to one second
-  } else {
-    for (uint32_t i = 0; i < ds18x20_sensors; i++) {
-      // 12mS per device
-      if (!Ds18x20Read(i)) {   // Read temperature
-        Ds18x20Name(i);
-        AddLogMissed(ds18x20_types, ds18x20_sensor[ds18x20_sensor[i].index].valid);
+    Ds18x20Cycle.convert_time = millis() + DS18X20_CONVERT_TIME;
+    Ds18x20Cycle.sensor = 0;
+    Ds18x20Cycle.retry = 0;
+    Ds18x20Cycle.state = DS18X20_CONVERTING;
+  }
+}
+
+void Ds18x20Every50mSecond(void)
+{
+  if (DS18X20_IDLE == Ds18x20Cycle.state) { return; }
+  if (DS18X20_CONVERTING == Ds18x20Cycle.state) {
+    if (!TimeReached(Ds18x20Cycle.convert_time)) { return; }
+    Ds18x20Cycle.state = DS18X20_READING;
+  }
+
+  // One sensor scratchpad per tick, 12mS per device
+  uint32_t i = Ds18x20Cycle.sensor;
+  if (!Ds18x20Read(i)) {       // Read temperature
+    if (++Ds18x20Cycle.retry < DS18X20_READ_RETRY) { return; }  // Retry next tick
+    uint8_t index = ds18x20_sensor[i].index;
+    if (ds18x20_sensor[index].valid) { ds18x20_sensor[index].valid--; }
+    AddLog_P(LOG_LEVEL_DEBUG, PSTR(D_LOG_DSB D_SENSOR_CRC_ERROR));
+    Ds18x20Name(i);
+    AddLogMissed(ds18x20_types, ds18x20_sensor[index].valid);
 #ifdef USE_DS18x20_RECONFIGURE
-        if (!ds18x20_sensor[ds18x20_sensor[i].index].valid) {
-          memset(&ds18x20_sensor, 0, sizeof(ds18x20_sensor));
-          Ds18x20Init();       // Re-configure
-        }
-#endif  // USE_DS18x20_RECONFIGURE
-      }
+    if (!ds18x20_sensor[index].valid) {
+      memset(&ds18x20_sensor, 0, sizeof(ds18x20_sensor));
+      Ds18x20Init();           // Re-configure
+      return;
     }
+#endif  // USE_DS18x20_RECONFIGURE
+  }
+  Ds18x20Cycle.retry = 0;
+  if (++Ds18x20Cycle.sensor >= ds18x20_sensors) {
+    Ds18x20Cycle.state = DS18X20_IDLE;
   }
 }
 
@@ -522,6 +729,10 @@ bool Xsns05(uint8_t function)
     switch (function) {
       case FUNC_INIT:
         Ds18x20Init();
+        XsnsSubscribe(FUNC_EVERY_50_MSECOND);
+        break;
+      case FUNC_EVERY_50_MSECOND:
+        Ds18x20Every50mSecond();
         break;
       case FUNC_EVERY_SECOND:
         Ds18x20EverySecond();
@@ -25,12 +25,16 @@
  * Sensor readings may also be up to 2 seconds 'old' (its a very slow sensor)
  *
  * This version is based on ESPEasy _P005_DHT.ino 20191201
+ *
+ * With USE_DHT_IRQ the pulse train is captured by a pin change interrupt and decoded from the
+ * 50 mSec loop so interrupts stay enabled and the loop does not wait for the sensor.
 \*********************************************************************************************/
 
 #define XSNS_06          6
 
 #define DHT_MAX_SENSORS  4
 #define DHT_MAX_RETRY    8
+#define DHT_BIT_THRESHOLD  48                 // uSec high time above which a bit is 1 (26 to 28 is 0, 70 is 1)
 
 uint8_t dht_data[5];
 uint8_t dht_sensors = 0;
@@ -47,6 +51,39 @@ struct DHTSTRUCT {
   float    h = NAN;
 } Dht[DHT_MAX_SENSORS];
 
+#ifdef USE_DHT_IRQ
+enum DhtCaptureStates { DHT_CAPTURE_IDLE, DHT_CAPTURE_START, DHT_CAPTURE_RUN };
+
+struct {
+  volatile uint32_t bits;                     // Last 32 received bits, newest in bit 0
+  volatile uint32_t bits_high;                // Bits shifted out of bits
+  volatile uint32_t rise;                     // Time of last rising edge
+  volatile uint8_t count;                     // Received bits
+  uint8_t pin;
+  uint8_t sensor;
+  uint8_t state = DHT_CAPTURE_IDLE;
+} DhtCapture;
+
+#ifndef ARDUINO_ESP8266_RELEASE_2_3_0  // Fix core 2.5.x ISR not in IRAM Exception
+void DhtCaptureIsr(void) ICACHE_RAM_ATTR;
+#endif  // ARDUINO_ESP8266_RELEASE_2_3_0
+
+void DhtCaptureIsr(void)
+{
+  uint32_t now = micros();
+  if (digitalRead(DhtCapture.pin)) {
+    DhtCapture.rise = now;
+  } else if (DhtCapture.rise) {
+    // Each bit is a 50 uSec low followed by a high which length sets the bit value
+    // 32-bit halves as 64-bit shifts are library calls which may not be in IRAM
+    DhtCapture.bits_high = (DhtCapture.bits_high << 1) | (DhtCapture.bits >> 31);
+    DhtCapture.bits = (DhtCapture.bits << 1) | ((now - DhtCapture.rise) > DHT_BIT_THRESHOLD);
+    if (DhtCapture.count < 255) { DhtCapture.count++; }
+    DhtCapture.rise = 0;
+  }
+}
+#endif  // USE_DHT_IRQ
+
 bool DhtWaitState(uint32_t sensor, uint32_t level)
 {
   unsigned long timeout = micros() + 100;
@@ -145,6 +182,11 @@ bool DhtRead(uint32_t sensor)
   interrupts();
   if (i < 40) { return false; }
 
+  return DhtDecode(sensor);
+}
+
+bool DhtDecode(uint32_t sensor)
+{
   uint8_t checksum = (dht_data[0] + dht_data[1] + dht_data[2] + dht_data[3]) & 0xFF;
   if (dht_data[4] != checksum) {
     char hex_char[15];
@@ -183,6 +225,99 @@ bool DhtRead(uint32_t sensor)
   return true;
 }
 
+void DhtMissed(uint32_t sensor)
+{
+  Dht[sensor].lastresult++;
+  if (Dht[sensor].lastresult > DHT_MAX_RETRY) {  // Reset after 8 misses
+    Dht[sensor].t = NAN;
+    Dht[sensor].h = NAN;
+  }
+}
+
+#ifdef USE_DHT_IRQ
+void DhtCaptureRelease(void)
+{
+  uint32_t sensor = DhtCapture.sensor;
+
+  DhtCapture.bits = 0;
+  DhtCapture.bits_high = 0;
+  DhtCapture.rise = 0;
+  DhtCapture.count = 0;
+  DhtCapture.pin = Dht[sensor].pin;
+  if (!dht_dual_mode) {
+    pinMode(Dht[sensor].pin, INPUT_PULLUP);
+  } else {
+    digitalWrite(dht_pin_out, HIGH);
+  }
+  // Response and data bits follow within 5 mSec and are decoded on the next 50 mSec tick
+  attachInterrupt(Dht[sensor].pin, DhtCaptureIsr, CHANGE);
+  DhtCapture.state = DHT_CAPTURE_RUN;
+}
+
+void DhtCaptureStart(uint32_t sensor)
+{
+  DhtCapture.sensor = sensor;
+  if (!dht_dual_mode) {
+    pinMode(Dht[sensor].pin, OUTPUT);
+    digitalWrite(Dht[sensor].pin, LOW);
+  } else {
+    digitalWrite(dht_pin_out, LOW);
+  }
+
+  switch (Dht[sensor].type) {
+    case GPIO_DHT11:                                    // DHT11
+      DhtCapture.state = DHT_CAPTURE_START;             // minimum 18ms, released on next tick
+      return;
+    case GPIO_DHT22:                                    // DHT21, DHT22, AM2301, AM2302, AM2321
+      delay(2);   // minimum 1ms, maximum 20ms
+      break;
+    case GPIO_SI7021:                                   // iTead SI7021
+      delayMicroseconds(500);
+      break;
+  }
+  DhtCaptureRelease();
+}
+
+void DhtCaptureDone(void)
+{
+  uint32_t sensor = DhtCapture.sensor;
+
+  detachInterrupt(Dht[sensor].pin);
+  // Leading response high pulse shifted out, keep the 40 data bits
+  if (DhtCapture.count >= 40) {
+    uint32_t bits = DhtCapture.bits;
+    for (uint32_t i = 4; i > 0; i--) {
+      dht_data[i] = bits & 0xFF;
+      bits >>= 8;
+    }
+    dht_data[0] = DhtCapture.bits_high & 0xFF;
+    if (!DhtDecode(sensor)) { DhtMissed(sensor); }
+  } else {
+    AddLog_P2(LOG_LEVEL_DEBUG, PSTR(D_LOG_DHT D_TIMEOUT_WAITING_FOR " %s " D_PULSE " (%d)"), D_START_SIGNAL_LOW, DhtCapture.count);
+    DhtMissed(sensor);
+  }
+
+  sensor++;
+  if (sensor < dht_sensors) {
+    DhtCaptureStart(sensor);
+  } else {
+    DhtCapture.state = DHT_CAPTURE_IDLE;
+  }
+}
+
+void DhtEvery50mSecond(void)
+{
+  switch (DhtCapture.state) {
+    case DHT_CAPTURE_START:
+      DhtCaptureRelease();
+      break;
+    case DHT_CAPTURE_RUN:
+      DhtCaptureDone();
+      break;
+  }
+}
+#endif  // USE_DHT_IRQ
+
 /********************************************************************************************/
 
 bool DhtPinState()
@@ -228,16 +363,18 @@ void DhtInit(void)
 void DhtEverySecond(void)
 {
   if (uptime &1) {  // Every 2 seconds
+#ifdef USE_DHT_IRQ
+    if (DHT_CAPTURE_IDLE == DhtCapture.state) {
+      DhtCaptureStart(0);   // Sensors are read one after the other on 50 mSec ticks
+    }
+#else
     for (uint32_t sensor = 0; sensor < dht_sensors; sensor++) {
       // DHT11 and AM2301 25mS per sensor, SI7021 5mS per sensor
       if (!DhtRead(sensor)) {
-        Dht[sensor].lastresult++;
-        if (Dht[sensor].lastresult > DHT_MAX_RETRY) {  // Reset after 8 misses
-          Dht[sensor].t = NAN;
-          Dht[sensor].h = NAN;
-        }
+        DhtMissed(sensor);
       }
     }
+#endif  // USE_DHT_IRQ
   }
 }
 
@@ -271,6 +408,12 @@ bool Xsns06(uint8_t function)
 #endif  // USE_WEBSERVER
       case FUNC_INIT:
         DhtInit();
+#ifdef USE_DHT_IRQ
+        XsnsSubscribe(FUNC_EVERY_50_MSECOND);
+        break;
+      case FUNC_EVERY_50_MSECOND:
+        DhtEvery50mSecond();
+#endif  // USE_DHT_IRQ
         break;
       case FUNC_PIN_STATE:
         result = DhtPinState();
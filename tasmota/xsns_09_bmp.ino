@@ -44,17 +44,17 @@
 
 #define BMP_CMND_RESET       0xB6 // I2C Parameter for RESET to put BMP into reset state
 
-#define BMP_MAX_SENSORS      2
+#define BMP_MAX_SENSORS      (2 * MAX_I2C)  // Two addresses per I2C bus
 
 const char kBmpTypes[] PROGMEM = "BMP180|BMP280|BME280|BME680";
 
 typedef struct {
   uint8_t bmp_address;    // I2C bus address
+  uint8_t bmp_bus;        // I2C bus
   char bmp_name[7];       // Sensor name - "BMPXXX"
   uint8_t bmp_type;
   uint8_t bmp_model;
 #ifdef USE_BME680
-  uint8_t bme680_state;
   float bmp_gas_resistance;
 #endif  // USE_BME680
   float bmp_temperature;
@@ -349,6 +349,8 @@ void Bme280Read(uint8_t bmp_idx)
 
 #include <bme680.h>
 
+#define BME680_CONVERSION_TIME  200  // mSeconds, heater profile duration is 183 mSeconds
+
 struct bme680_dev *gas_sensor = nullptr;
 
 static void BmeDelayMs(uint32_t ms)
@@ -400,49 +402,34 @@ bool Bme680Init(uint8_t bmp_idx)
   rslt = bme680_set_sensor_settings(set_required_settings,&gas_sensor[bmp_idx]);
   if (rslt != BME680_OK) { return false; }
 
-  bmp_sensors[bmp_idx].bme680_state = 0;
-
   return true;
 }
 
+void Bme680Start(uint8_t bmp_idx)
+{
+  if (!gas_sensor) { return; }
+
+  /* Trigger the next measurement, read by Bme680Read() after BME680_CONVERSION_TIME */
+  bme680_set_sensor_mode(&gas_sensor[bmp_idx]);
+}
+
 void Bme680Read(uint8_t bmp_idx)
 {
   if (!gas_sensor) { return; }
 
-  int8_t rslt = BME680_OK;
+  struct bme680_field_data data;
+  int8_t rslt = bme680_get_sensor_data(&data, &gas_sensor[bmp_idx]);
+  if (rslt != BME680_OK) { return; }
 
-  if (BME680_CHIPID == bmp_sensors[bmp_idx].bmp_type) {
-    if (0 == bmp_sensors[bmp_idx].bme680_state) {
-      /* Trigger the next measurement if you would like to read data out continuously */
-      rslt = bme680_set_sensor_mode(&gas_sensor[bmp_idx]);
-      if (rslt != BME680_OK) { return; }
-
-      /* Get the total measurement duration so as to sleep or wait till the
-       * measurement is complete */
-//      uint16_t meas_period;
-//      bme680_get_profile_dur(&meas_period, &gas_sensor[bmp_idx]);
-//      delay(meas_period); /* Delay till the measurement is ready */  // 183 mSec - we'll wait a second
-
-      bmp_sensors[bmp_idx].bme680_state = 1;
-    } else {
-      bmp_sensors[bmp_idx].bme680_state = 0;
-
-      struct bme680_field_data data;
-      rslt = bme680_get_sensor_data(&data, &gas_sensor[bmp_idx]);
-      if (rslt != BME680_OK) { return; }
-
-      bmp_sensors[bmp_idx].bmp_temperature = data.temperature / 100.0;
-      bmp_sensors[bmp_idx].bmp_humidity = data.humidity / 1000.0;
-      bmp_sensors[bmp_idx].bmp_pressure = data.pressure / 100.0;
-      /* Avoid using measurements from an unstable heating setup */
-      if (data.status & BME680_GASM_VALID_MSK) {
-        bmp_sensors[bmp_idx].bmp_gas_resistance = data.gas_resistance / 1000.0;
-      } else {
-        bmp_sensors[bmp_idx].bmp_gas_resistance = 0;
-      }
-    }
+  bmp_sensors[bmp_idx].bmp_temperature = data.temperature / 100.0;
+  bmp_sensors[bmp_idx].bmp_humidity = data.humidity / 1000.0;
+  bmp_sensors[bmp_idx].bmp_pressure = data.pressure / 100.0;
+  /* Avoid using measurements from an unstable heating setup */
+  if (data.status & BME680_GASM_VALID_MSK) {
+    bmp_sensors[bmp_idx].bmp_gas_resistance = data.gas_resistance / 1000.0;
+  } else {
+    bmp_sensors[bmp_idx].bmp_gas_resistance = 0;
   }
-  return;
 }
 
 #endif  // USE_BME680
@@ -458,44 +445,76 @@ void BmpDetect(void)
   if (!bmp_sensors) { return; }
   memset(bmp_sensors, 0, bmp_sensor_size);  // Init defaults to 0
 
-  for (uint32_t i = 0; i < BMP_MAX_SENSORS; i++) {
-    if (I2cActive(bmp_addresses[i])) { continue; }
-    uint8_t bmp_type = I2cRead8(bmp_addresses[i], BMP_REGISTER_CHIPID);
-    if (bmp_type) {
-      bmp_sensors[bmp_count].bmp_address = bmp_addresses[i];
-      bmp_sensors[bmp_count].bmp_type = bmp_type;
-      bmp_sensors[bmp_count].bmp_model = 0;
-
-      bool success = false;
-      switch (bmp_type) {
-        case BMP180_CHIPID:
-          success = Bmp180Calibration(bmp_count);
-          break;
-        case BME280_CHIPID:
-          bmp_sensors[bmp_count].bmp_model++;  // 2
-        case BMP280_CHIPID:
-          bmp_sensors[bmp_count].bmp_model++;  // 1
-          success = Bmx280Calibrate(bmp_count);
-          break;
+  for (uint32_t bus = 0; bus < MAX_I2C; bus++) {
+    if (!I2cBusEnabled(bus)) { continue; }
+    I2cSelectBus(bus);
+    for (uint32_t i = 0; i < sizeof(bmp_addresses); i++) {
+      if (I2cActive(bmp_addresses[i])) { continue; }
+      uint8_t bmp_type = I2cRead8(bmp_addresses[i], BMP_REGISTER_CHIPID);
+      if (bmp_type) {
+        bmp_sensors[bmp_count].bmp_address = bmp_addresses[i];
+        bmp_sensors[bmp_count].bmp_bus = bus;
+        bmp_sensors[bmp_count].bmp_type = bmp_type;
+        bmp_sensors[bmp_count].bmp_model = 0;
+
+        bool success = false;
+        switch (bmp_type) {
+          case BMP180_CHIPID:
+            success = Bmp180Calibration(bmp_count);
+            break;
+          case BME280_CHIPID:
+            bmp_sensors[bmp_count].bmp_model++;  // 2
+          case BMP280_CHIPID:
+            bmp_sensors[bmp_count].bmp_model++;  // 1
+            success = Bmx280Calibrate(bmp_count);
+            break;
 #ifdef USE_BME680
-        case BME680_CHIPID:
-          bmp_sensors[bmp_count].bmp_model = 3;  // 3
-          success = Bme680Init(bmp_count);
-          break;
+          case BME680_CHIPID:
+            bmp_sensors[bmp_count].bmp_model = 3;  // 3
+            success = Bme680Init(bmp_count);
+            break;
 #endif  // USE_BME680
+        }
+        if (success) {
+          GetTextIndexed(bmp_sensors[bmp_count].bmp_name, sizeof(bmp_sensors[bmp_count].bmp_name), bmp_sensors[bmp_count].bmp_model, kBmpTypes);
+          I2cSetActiveFound(bmp_sensors[bmp_count].bmp_address, bmp_sensors[bmp_count].bmp_name);
+          bmp_count++;
+        }
       }
-      if (success) {
-        GetTextIndexed(bmp_sensors[bmp_count].bmp_name, sizeof(bmp_sensors[bmp_count].bmp_name), bmp_sensors[bmp_count].bmp_model, kBmpTypes);
-        I2cSetActiveFound(bmp_sensors[bmp_count].bmp_address, bmp_sensors[bmp_count].bmp_name);
-        bmp_count++;
-      }
     }
   }
+  I2cSelectBus(I2C_BUS_AUTO);
+}
+
+void BmpStart(void)
+{
+#ifdef USE_BME680
+  for (uint32_t bmp_idx = 0; bmp_idx < bmp_count; bmp_idx++) {
+    if (BME680_CHIPID == bmp_sensors[bmp_idx].bmp_type) {
+      I2cSelectBus(bmp_sensors[bmp_idx].bmp_bus);
+      Bme680Start(bmp_idx);
+    }
+  }
+  I2cSelectBus(I2C_BUS_AUTO);
+#endif  // USE_BME680
+}
+
+uint32_t BmpConversionTime(void)
+{
+#ifdef USE_BME680
+  for (uint32_t bmp_idx = 0; bmp_idx < bmp_count; bmp_idx++) {
+    if (BME680_CHIPID == bmp_sensors[bmp_idx].bmp_type) {
+      return BME680_CONVERSION_TIME;
+    }
+  }
+#endif  // USE_BME680
+  return 0;
 }
 
 void BmpRead(void)
 {
   for (uint32_t bmp_idx = 0; bmp_idx < bmp_count; bmp_idx++) {
+    I2cSelectBus(bmp_sensors[bmp_idx].bmp_bus);
     switch (bmp_sensors[bmp_idx].bmp_type) {
       case BMP180_CHIPID:
         Bmp180Read(bmp_idx);
@@ -511,6 +530,7 @@ void BmpRead(void)
 #endif  // USE_BME680
     }
   }
+  I2cSelectBus(I2C_BUS_AUTO);
 }
 
 void BmpShow(bool json)
@@ -525,10 +545,13 @@ void BmpShow(bool json)
       float bmp_temperature = ConvertTemp(bmp_sensors[bmp_idx].bmp_temperature);
       float bmp_pressure = ConvertPressure(bmp_sensors[bmp_idx].bmp_pressure);
 
-      char name[10];
+      char name[12];
       strlcpy(name, bmp_sensors[bmp_idx].bmp_name, sizeof(name));
       if (bmp_count > 1) {
         snprintf_P(name, sizeof(name), PSTR("%s%c%02X"), name, IndexSeparator(), bmp_sensors[bmp_idx].bmp_address);  // BMXXXX-XX
+        if (bmp_sensors[bmp_idx].bmp_bus) {
+          snprintf_P(name, sizeof(name), PSTR("%s%c%d"), name, IndexSeparator(), bmp_sensors[bmp_idx].bmp_bus +1);  // BMXXXX-XX-2
+        }
       }
 
       char temperature[33];
@@ -614,6 +637,7 @@ void BmpShow(bool json)
 void BMP_EnterSleep(void)
 {
   for (uint32_t bmp_idx = 0; bmp_idx < bmp_count; bmp_idx++) {
+    I2cSelectBus(bmp_sensors[bmp_idx].bmp_bus);
     switch (bmp_sensors[bmp_idx].bmp_type) {
       case BMP180_CHIPID:
       case BMP280_CHIPID:
@@ -624,6 +648,7 @@ void BMP_EnterSleep(void)
         break;
     }
   }
+  I2cSelectBus(I2C_BUS_AUTO);
 }
 
 #endif // USE_DEEPSLEEP
@@ -640,10 +665,16 @@ bool Xsns09(uint8_t function)
 
   if (FUNC_INIT == function) {
     BmpDetect();
+    if (bmp_count) {
+      XsnsSchedule(1000, BmpConversionTime());
+    }
   }
   else if (bmp_count) {
     switch (function) {
-      case FUNC_EVERY_SECOND:
+      case FUNC_SENSOR_START:
+        BmpStart();
+        break;
+      case FUNC_SENSOR_READ:
         BmpRead();
         break;
       case FUNC_JSON_APPEND:
@@ -38,6 +38,12 @@
  * ADS1115_REG_CONFIG_PGA_1_024V  // 4x gain   +/- 1.024V  1 bit = 0.03125mV
  * ADS1115_REG_CONFIG_PGA_0_512V  // 8x gain   +/- 0.512V  1 bit = 0.015625mV
  * ADS1115_REG_CONFIG_PGA_0_256V  // 16x gain  +/- 0.256V  1 bit = 0.0078125mV
+ *
+ * Each ADS1115 runs in continuous mode while its channels are scanned round robin in the
+ * background. The latest sample per channel is kept for the sensor output and for other
+ * drivers like SML using Ads1115Sample(). A single ADS1115 can signal each finished
+ * conversion on its ALERT/RDY pin connected to GPIO ADS1115 RDY, otherwise the next channel
+ * is started every 50 milliseconds.
 \*********************************************************************************************/
 
 #define XSNS_12                         12
@@ -48,7 +54,7 @@
 #define ADS1115_ADDRESS_ADDR_SDA        0x4A      // address pin tied to SDA pin
 #define ADS1115_ADDRESS_ADDR_SCL        0x4B      // address pin tied to SCL pin
 
-#define ADS1115_CONVERSIONDELAY         (8)       // CONVERSION DELAY (in mS)
+#define ADS1115_CHANNELS                4
 
 /*======================================================================
 POINTER REGISTER
@@ -119,44 +125,86 @@ CONFIG REGISTER
 
 struct ADS1115 {
   uint8_t count = 0;
-  uint8_t address;
   uint8_t addresses[4] = { ADS1115_ADDRESS_ADDR_GND, ADS1115_ADDRESS_ADDR_VDD, ADS1115_ADDRESS_ADDR_SDA, ADS1115_ADDRESS_ADDR_SCL };
   uint8_t found[4] = {false,false,false,false};
+  uint8_t channel[4];                         // Channel in conversion per device
+  uint8_t valid[4] = { 0 };                   // Channels with a sample per device
+  uint16_t input[4][ADS1115_CHANNELS];        // Multiplexer and gain per channel
+  int16_t value[4][ADS1115_CHANNELS];         // Latest sample per channel
+  volatile uint8_t conversions = 0;           // ALERT/RDY pulses since channel change
+  bool irq = false;
 } Ads1115;
 
-//Ads1115StartComparator(channel, ADS1115_REG_CONFIG_MODE_SINGLE);
-//Ads1115StartComparator(channel, ADS1115_REG_CONFIG_MODE_CONTIN);
-void Ads1115StartComparator(uint8_t channel, uint16_t mode)
+#ifndef ARDUINO_ESP8266_RELEASE_2_3_0  // Fix core 2.5.x ISR not in IRAM Exception
+void Ads1115ReadyIsr(void) ICACHE_RAM_ATTR;
+#endif  // ARDUINO_ESP8266_RELEASE_2_3_0
+
+void Ads1115ReadyIsr(void)
+{
+  if (Ads1115.conversions < 255) { Ads1115.conversions++; }
+}
+
+void Ads1115StartChannel(uint32_t device, uint32_t channel)
 {
-  // Start with default values
-  uint16_t config = mode |
-                    ADS1115_REG_CONFIG_CQUE_NONE    | // Comparator enabled and asserts on 1 match
+  uint16_t config = ADS1115_REG_CONFIG_MODE_CONTIN  | // Continuous conversion mode
                     ADS1115_REG_CONFIG_CLAT_NONLAT  | // Non Latching mode
-                    ADS1115_REG_CONFIG_PGA_6_144V   | // ADC Input voltage range (Gain)
                     ADS1115_REG_CONFIG_CPOL_ACTVLOW | // Alert/Rdy active low   (default val)
                     ADS1115_REG_CONFIG_CMODE_TRAD   | // Traditional comparator (default val)
-                    ADS1115_REG_CONFIG_DR_6000SPS;    // 6000 samples per second
+                    ADS1115_REG_CONFIG_DR_6000SPS   | // 860 samples per second on ADS1115
+                    Ads1115.input[device][channel];   // Input multiplexer and voltage range (Gain)
+  // Alert/Rdy pulses after each conversion or stays high
+  config |= (Ads1115.irq) ? ADS1115_REG_CONFIG_CQUE_1CONV : ADS1115_REG_CONFIG_CQUE_NONE;
+
+  Ads1115.channel[device] = channel;
+  I2cWrite16(Ads1115.addresses[device], ADS1115_REG_POINTER_CONFIG, config);
+}
+
+void Ads1115Scan(void)
+{
+  // Keep the conversion of each device and continue with its next channel
+  for (uint32_t t = 0; t < sizeof(Ads1115.addresses); t++) {
+    if (Ads1115.found[t]) {
+      uint32_t channel = Ads1115.channel[t];
+      Ads1115.value[t][channel] = (int16_t)I2cRead16(Ads1115.addresses[t], ADS1115_REG_POINTER_CONVERT);
+      Ads1115.valid[t] |= 1 << channel;
+      Ads1115StartChannel(t, (channel +1) % ADS1115_CHANNELS);
+    }
+  }
+  Ads1115.conversions = 0;
+}
+
+void Ads1115Loop(void)
+{
+  // The first conversion ready after a channel change may still use the previous input
+  if (Ads1115.conversions > 1) {
+    Ads1115Scan();
+  }
+}
 
-  // Set single-ended input channel
-  config |= (ADS1115_REG_CONFIG_MUX_SINGLE_0 + (0x1000 * channel));
+/*********************************************************************************************\
+ * Shared access for other drivers
+ *
+ * device is the index of the I2C address 0x48 to 0x4B, channel is 0 to 3
+\*********************************************************************************************/
 
-  // Write config register to the ADC
-  I2cWrite16(Ads1115.address, ADS1115_REG_POINTER_CONFIG, config);
+bool Ads1115Sample(uint32_t device, uint32_t channel, int16_t *value)
+{
+  if ((device >= sizeof(Ads1115.addresses)) || (channel >= ADS1115_CHANNELS)) { return false; }
+  if (!Ads1115.found[device] || !bitRead(Ads1115.valid[device], channel)) { return false; }
+  *value = Ads1115.value[device][channel];
+  return true;
 }
 
-int16_t Ads1115GetConversion(uint8_t channel)
+void Ads1115SetInput(uint32_t device, uint32_t channel, uint16_t input)
 {
-  Ads1115StartComparator(channel, ADS1115_REG_CONFIG_MODE_SINGLE);
-  // Wait for the conversion to complete
-  delay(ADS1115_CONVERSIONDELAY);
-  // Read the conversion results
-  I2cRead16(Ads1115.address, ADS1115_REG_POINTER_CONVERT);
-
-  Ads1115StartComparator(channel, ADS1115_REG_CONFIG_MODE_CONTIN);
-  delay(ADS1115_CONVERSIONDELAY);
-  // Read the conversion results
-  uint16_t res = I2cRead16(Ads1115.address, ADS1115_REG_POINTER_CONVERT);
-  return (int16_t)res;
+  // input is one ADS1115_REG_CONFIG_MUX_* or'ed with one ADS1115_REG_CONFIG_PGA_*
+  if ((device >= sizeof(Ads1115.addresses)) || (channel >= ADS1115_CHANNELS)) { return; }
+  Ads1115.input[device][channel] = input & (ADS1115_REG_CONFIG_MUX_MASK | ADS1115_REG_CONFIG_PGA_MASK);
+  bitClear(Ads1115.valid[device], channel);
+  if (Ads1115.found[device] && (Ads1115.channel[device] == channel)) {
+    Ads1115StartChannel(device, channel);            // Restart the conversion in progress
+    Ads1115.conversions = 0;
+  }
 }
 
 /********************************************************************************************/
@@ -165,18 +213,41 @@ void Ads1115Detect(void)
 {
   for (uint32_t i = 0; i < sizeof(Ads1115.addresses); i++) {
     if (!Ads1115.found[i]) {
-      Ads1115.address = Ads1115.addresses[i];
-      if (I2cActive(Ads1115.address)) { continue; }
+      uint8_t address = Ads1115.addresses[i];
+      if (I2cActive(address)) { continue; }
       uint16_t buffer;
-      if (I2cValidRead16(&buffer, Ads1115.address, ADS1115_REG_POINTER_CONVERT) &&
-          I2cValidRead16(&buffer, Ads1115.address, ADS1115_REG_POINTER_CONFIG)) {
-        Ads1115StartComparator(i, ADS1115_REG_CONFIG_MODE_CONTIN);
-        I2cSetActiveFound(Ads1115.address, "ADS1115");
+      if (I2cValidRead16(&buffer, address, ADS1115_REG_POINTER_CONVERT) &&
+          I2cValidRead16(&buffer, address, ADS1115_REG_POINTER_CONFIG)) {
+        I2cSetActiveFound(address, "ADS1115");
         Ads1115.found[i] = 1;
         Ads1115.count++;
       }
     }
   }
+  if (!Ads1115.count) { return; }
+
+  // ALERT/RDY is open drain and can not tell which device finished so only use it with one device
+  Ads1115.irq = (PinUsed(GPIO_ADS1115_RDY) && (1 == Ads1115.count));
+  for (uint32_t i = 0; i < sizeof(Ads1115.addresses); i++) {
+    for (uint32_t j = 0; j < ADS1115_CHANNELS; j++) {
+      Ads1115.input[i][j] = (ADS1115_REG_CONFIG_MUX_SINGLE_0 + (0x1000 * j)) | ADS1115_REG_CONFIG_PGA_6_144V;
+    }
+    if (Ads1115.found[i]) {
+      if (Ads1115.irq) {
+        // Conversion ready mode needs the high threshold MSB set and the low threshold MSB cleared
+        I2cWrite16(Ads1115.addresses[i], ADS1115_REG_POINTER_HITHRESH, 0x8000);
+        I2cWrite16(Ads1115.addresses[i], ADS1115_REG_POINTER_LOWTHRESH, 0x0000);
+      }
+      Ads1115StartChannel(i, 0);
+    }
+  }
+  if (Ads1115.irq) {
+    pinMode(Pin(GPIO_ADS1115_RDY), INPUT_PULLUP);
+    attachInterrupt(Pin(GPIO_ADS1115_RDY), Ads1115ReadyIsr, FALLING);
+    XsnsSubscribe(FUNC_LOOP);
+  } else {
+    XsnsSubscribe(FUNC_EVERY_50_MSECOND);
+  }
 }
 
 void Ads1115Show(bool json)
@@ -187,13 +258,10 @@ void Ads1115Show(bool json)
     //AddLog_P2(LOG_LEVEL_INFO, "Logging ADS1115 %02x", Ads1115.addresses[t]);
     if (Ads1115.found[t]) {
 
-      uint8_t old_address = Ads1115.address;
-      Ads1115.address = Ads1115.addresses[t];
       for (uint32_t i = 0; i < 4; i++) {
-        values[i] = Ads1115GetConversion(i);
-        //AddLog_P2(LOG_LEVEL_INFO, "Logging ADS1115 %02x (%i) = %i", address, i, values[i] );
+        values[i] = Ads1115.value[t][i];
+        //AddLog_P2(LOG_LEVEL_INFO, "Logging ADS1115 %02x (%i) = %i", Ads1115.addresses[t], i, values[i] );
       }
-      Ads1115.address = old_address;
 
       char label[15];
       if (1 == Ads1115.count) {
@@ -237,6 +305,12 @@ bool Xsns12(uint8_t function)
   }
   else if (Ads1115.count) {
     switch (function) {
+      case FUNC_LOOP:
+        Ads1115Loop();
+        break;
+      case FUNC_EVERY_50_MSECOND:
+        Ads1115Scan();
+        break;
       case FUNC_JSON_APPEND:
         Ads1115Show(1);
         break;
@@ -180,6 +180,7 @@ bool Xsns17(uint8_t function)
     switch (function) {
       case FUNC_INIT:
         SenseairInit();
+        XsnsSubscribe(FUNC_EVERY_250_MSECOND);
         break;
       case FUNC_EVERY_250_MSECOND:
         Senseair250ms();
@@ -27,12 +27,35 @@
  * Code for SR04 family of ultrasonic distance sensors
  * References:
  * - https://www.dfrobot.com/wiki/index.php/Weather-proof_Ultrasonic_Sensor_SKU_:_SEN0207
+ *
+ * In pulse mode with separate trigger and echo pins the sensors are pinged in turn every
+ * 100 mS and the echo is timed by an interrupt on the echo pin so the loop does not wait
+ * for it. The distance is the median of the last SR04_SAMPLES echoes of each sensor.
+ * ESP32 supports MAX_SR04 sensors using indexed SR04 Tri and SR04 Ech pins.
 \*********************************************************************************************/
 
 #define XSNS_22              22
 
+#ifndef SR04_SAMPLES
+#define SR04_SAMPLES         5       // Echoes per sensor used for the median
+#endif
+#define SR04_MAX_ECHO        17500   // uS of the roundtrip of 300 cm
+
 uint8_t sr04_type = 1;
-real64_t distance;
+real64_t distance[MAX_SR04];
+
+struct {
+  volatile uint32_t echo_start = 0;  // micros() of the rising echo edge
+  volatile uint32_t echo_time = 0;   // uS of the echo, 0 if none
+  uint32_t echo_pin;                 // Echo pin of the active sensor
+  uint16_t sample[MAX_SR04][SR04_SAMPLES] = { 0 };  // uS, 0 if no echo
+  uint8_t trig[MAX_SR04];
+  uint8_t echo[MAX_SR04];
+  uint8_t index[MAX_SR04] = { 0 };
+  uint8_t count = 0;                 // Sensors pinged from the 100 mS loop
+  uint8_t active = 0;
+  bool pinged = false;
+} Sr04Irq;
 
 NewPing* sonar = nullptr;
 TasmotaSerial* sonar_serial = nullptr;
@@ -61,10 +84,11 @@ uint8_t Sr04TModeDetect(void)
   if (sr04_type < 2) {
     delete sonar_serial;
     sonar_serial = nullptr;
-    if (-1 == sr04_trig_pin) {
-      sr04_trig_pin = Pin(GPIO_SR04_ECHO);  // if GPIO_SR04_TRIG is not configured use single PIN mode with GPIO_SR04_ECHO only
+    if (sr04_trig_pin != sr04_echo_pin) {
+      Sr04IrqInit();
+    } else {
+      sonar = new NewPing(sr04_trig_pin, sr04_echo_pin, 300);  // Single pin mode times the echo with NewPing
     }
-    sonar = new NewPing(sr04_trig_pin, sr04_echo_pin, 300);
   } else {
     if (sonar_serial->hardwareSerial()) {
       ClaimSerial();
@@ -75,6 +99,77 @@ uint8_t Sr04TModeDetect(void)
   return sr04_type;
 }
 
+#ifndef ARDUINO_ESP8266_RELEASE_2_3_0  // Fix core 2.5.x ISR not in IRAM Exception
+void Sr04EchoIsr(void) ICACHE_RAM_ATTR;
+#endif  // ARDUINO_ESP8266_RELEASE_2_3_0
+
+void Sr04EchoIsr(void)
+{
+  uint32_t now = micros();
+  if (digitalRead(Sr04Irq.echo_pin)) {
+    Sr04Irq.echo_start = now;
+  }
+  else if (Sr04Irq.echo_start) {
+    Sr04Irq.echo_time = now - Sr04Irq.echo_start;
+    Sr04Irq.echo_start = 0;
+  }
+}
+
+void Sr04IrqInit(void)
+{
+  for (uint32_t i = 0; i < MAX_SR04; i++) {
+    if (!PinUsed(GPIO_SR04_TRIG, i) || !PinUsed(GPIO_SR04_ECHO, i)) { break; }
+    Sr04Irq.trig[i] = Pin(GPIO_SR04_TRIG, i);
+    Sr04Irq.echo[i] = Pin(GPIO_SR04_ECHO, i);
+    pinMode(Sr04Irq.trig[i], OUTPUT);
+    digitalWrite(Sr04Irq.trig[i], LOW);
+    pinMode(Sr04Irq.echo[i], INPUT);
+    Sr04Irq.count++;
+  }
+  Sr04Irq.echo_pin = Sr04Irq.echo[0];
+  attachInterrupt(Sr04Irq.echo_pin, Sr04EchoIsr, CHANGE);
+}
+
+void Sr04IrqPing(void)
+{
+  // Store the echo of the last pinged sensor and ping the next one
+  uint32_t active = Sr04Irq.active;
+  if (Sr04Irq.pinged) {
+    uint32_t echo = Sr04Irq.echo_time;
+    Sr04Irq.sample[active][Sr04Irq.index[active]] = (echo > SR04_MAX_ECHO) ? 0 : echo;
+    Sr04Irq.index[active] = (Sr04Irq.index[active] +1) % SR04_SAMPLES;
+    detachInterrupt(Sr04Irq.echo_pin);
+    active = (active +1) % Sr04Irq.count;
+    Sr04Irq.active = active;
+    Sr04Irq.echo_pin = Sr04Irq.echo[active];
+    attachInterrupt(Sr04Irq.echo_pin, Sr04EchoIsr, CHANGE);
+  }
+  Sr04Irq.echo_start = 0;
+  Sr04Irq.echo_time = 0;
+  digitalWrite(Sr04Irq.trig[active], HIGH);
+  delayMicroseconds(10);
+  digitalWrite(Sr04Irq.trig[active], LOW);
+  Sr04Irq.pinged = true;
+}
+
+uint32_t Sr04IrqMedian(uint32_t sensor)
+{
+  // Returns uS of the median echo or 0 if there was none
+  uint16_t sorted[SR04_SAMPLES];
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < SR04_SAMPLES; i++) {
+    uint16_t echo = Sr04Irq.sample[sensor][i];
+    if (!echo) { continue; }
+    uint32_t j = count++;
+    while (j && (sorted[j -1] > echo)) {
+      sorted[j] = sorted[j -1];
+      j--;
+    }
+    sorted[j] = echo;
+  }
+  return (count) ? sorted[count / 2] : 0;
+}
+
 uint16_t Sr04TMiddleValue(uint16_t first, uint16_t second, uint16_t third)
 {
   uint16_t ret = first;
@@ -138,18 +233,24 @@ void Sr04TReading(void) {
 
   switch (sr04_type) {
       case 3:
-        distance = (real64_t)(Sr04TMiddleValue(Sr04TMode3Distance(),Sr04TMode3Distance(),Sr04TMode3Distance()))/ 10; //convert to cm
+        distance[0] = (real64_t)(Sr04TMiddleValue(Sr04TMode3Distance(),Sr04TMode3Distance(),Sr04TMode3Distance()))/ 10; //convert to cm
         break;
       case 2:
         //empty input buffer first
         while(sonar_serial->available()) sonar_serial->read();
-        distance = (real64_t)(Sr04TMiddleValue(Sr04TMode2Distance(),Sr04TMode2Distance(),Sr04TMode2Distance()))/10;
+        distance[0] = (real64_t)(Sr04TMiddleValue(Sr04TMode2Distance(),Sr04TMode2Distance(),Sr04TMode2Distance()))/10;
         break;
       case 1:
-        distance = (real64_t)(sonar->ping_median(5))/ US_ROUNDTRIP_CM;
+        if (Sr04Irq.count) {
+          for (uint32_t i = 0; i < Sr04Irq.count; i++) {
+            distance[i] = (real64_t)(Sr04IrqMedian(i))/ US_ROUNDTRIP_CM;
+          }
+        } else {
+          distance[0] = (real64_t)(sonar->ping_median(5))/ US_ROUNDTRIP_CM;
+        }
         break;
       default:
-        distance = NO_ECHO;
+        distance[0] = NO_ECHO;
   }
 
   return;
@@ -157,27 +258,35 @@ void Sr04TReading(void) {
 
 #ifdef USE_WEBSERVER
 const char HTTP_SNS_DISTANCE[] PROGMEM =
-  "{s}SR04 " D_DISTANCE "{m}%s" D_UNIT_CENTIMETER "{e}";  // {s} = <tr><th>, {m} = </th><td>, {e} = </td></tr>
+  "{s}%s " D_DISTANCE "{m}%s" D_UNIT_CENTIMETER "{e}";  // {s} = <tr><th>, {m} = </th><td>, {e} = </td></tr>
 #endif  // USE_WEBSERVER
 
 void Sr04Show(bool json)
 {
+  uint32_t count = (Sr04Irq.count > 1) ? Sr04Irq.count : 1;
+  for (uint32_t i = 0; i < count; i++) {
+    if (distance[i] != 0) {             // Check if read failed
+      char name[8];
+      if (count > 1) {
+        snprintf_P(name, sizeof(name), PSTR("SR04%c%d"), IndexSeparator(), i +1);
+      } else {
+        strcpy_P(name, PSTR("SR04"));
+      }
+      char distance_chr[33];
+      dtostrfd(distance[i], 3, distance_chr);
 
-  if (distance != 0) {                // Check if read failed
-    char distance_chr[33];
-    dtostrfd(distance, 3, distance_chr);
-
-    if(json) {
-      ResponseAppend_P(PSTR(",\"SR04\":{\"" D_JSON_DISTANCE "\":%s}"), distance_chr);
+      if(json) {
+        ResponseAppend_P(PSTR(",\"%s\":{\"" D_JSON_DISTANCE "\":%s}"), name, distance_chr);
 #ifdef USE_DOMOTICZ
-      if (0 == tele_period) {
-        DomoticzSensor(DZ_COUNT, distance_chr);  // Send distance as Domoticz Counter value
-      }
+        if ((0 == tele_period) && (0 == i)) {
+          DomoticzSensor(DZ_COUNT, distance_chr);  // Send distance as Domoticz Counter value
+        }
 #endif  // USE_DOMOTICZ
 #ifdef USE_WEBSERVER
-    } else {
-      WSContentSend_PD(HTTP_SNS_DISTANCE, distance_chr);
+      } else {
+        WSContentSend_PD(HTTP_SNS_DISTANCE, name, distance_chr);
 #endif  // USE_WEBSERVER
+      }
     }
   }
 }
@@ -194,6 +303,12 @@ bool Xsns22(uint8_t function)
     switch (function) {
       case FUNC_INIT:
         result = (PinUsed(GPIO_SR04_ECHO));
+        XsnsSubscribe(FUNC_EVERY_100_MSECOND);
+        break;
+      case FUNC_EVERY_100_MSECOND:
+        if (Sr04Irq.count) {
+          Sr04IrqPing();
+        }
         break;
       case FUNC_EVERY_SECOND:
         Sr04TReading();
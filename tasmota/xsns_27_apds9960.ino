@@ -34,6 +34,10 @@
  * Adaption for TASMOTA: Christian Baars
  *
  * I2C Address: 0x39 - standard address
+ *
+ * With the INT pin connected to GPIO APDS9960 INT the gesture interrupt starts collecting: every
+ * 50 mS the whole FIFO is read in one I2C transaction until the gesture engine exits, then the
+ * collected datasets are classified. Without it the sensor status is polled.
 \*********************************************************************************************/
 
 // #if defined(USE_SHT) || defined(USE_VEML6070) || defined(USE_TSL2561)
@@ -331,6 +335,13 @@ typedef struct color_data_type {
 gesture_data_t gesture_data;
 gesture_t gesture;
 char currentGesture[6];
+
+struct {
+  volatile bool pending = false;              // Gesture interrupt since the last FIFO read
+  bool irq = false;                           // GPIO APDS9960 INT is used
+  bool collecting = false;                    // Gesture in progress
+  uint8_t cycles = 0;                         // FIFO reads of the gesture in progress
+} Apds9960Irq;
 #endif  // USE_APDS9960_GESTURE
 
 #if defined(USE_APDS9960_COLOR) || defined(USE_APDS9960_PROXIMITY)
@@ -1379,7 +1390,7 @@ void enableGestureSensor(void) {
   I2cWrite8(APDS9960_I2C_ADDR, APDS9960_WTIME, 0xFF);
   I2cWrite8(APDS9960_I2C_ADDR, APDS9960_PPULSE, DEFAULT_GESTURE_PPULSE);
   setLEDBoost(LED_BOOST_100);  // tip from jonn26 - 100 for 300 ---- 200 from Adafruit
-  setGestureIntEnable(OFF);
+  setGestureIntEnable(Apds9960Irq.irq);
   setGestureMode(ON);
   enablePower();
   setMode(WAIT, ON);
@@ -1393,6 +1404,8 @@ void enableGestureSensor(void) {
  */
 void disableGestureSensor(void) {
   resetGestureParameters();
+  Apds9960Irq.collecting = false;
+  Apds9960Irq.cycles = 0;
   setGestureIntEnable(OFF);
   setGestureMode(OFF);
   setMode(GESTURE, OFF);
@@ -1744,36 +1757,115 @@ bool decodeGesture(void) {
   return true;
 }
 
+#ifndef ARDUINO_ESP8266_RELEASE_2_3_0  // Fix core 2.5.x ISR not in IRAM Exception
+void APDS9960_isr(void) ICACHE_RAM_ATTR;
+#endif  // ARDUINO_ESP8266_RELEASE_2_3_0
+
+void APDS9960_isr(void) {
+  Apds9960Irq.pending = true;
+}
+
+/**
+ * @brief Reads the whole gesture FIFO in one I2C transaction into gesture_data
+ *
+ * @return False on I2C error.
+ */
+bool APDS9960_readFifo(void) {
+  uint8_t fifo_level = I2cRead8(APDS9960_I2C_ADDR, APDS9960_GFLVL);
+  if (!fifo_level) { return true; }
+  if (fifo_level > 32) { fifo_level = 32; }
+
+  uint8_t fifo_data[128];
+  if (I2cReadBuffer(APDS9960_I2C_ADDR, APDS9960_GFIFO_U, fifo_data, fifo_level * 4)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < fifo_level * 4; i += 4) {
+    if (gesture_data.total_gestures >= 32) {  // Classify a full set and keep collecting
+      processGestureData();
+      gesture_data.index = 0;
+      gesture_data.total_gestures = 0;
+    }
+    gesture_data.u_data[gesture_data.index] = fifo_data[i + 0];
+    gesture_data.d_data[gesture_data.index] = fifo_data[i + 1];
+    gesture_data.l_data[gesture_data.index] = fifo_data[i + 2];
+    gesture_data.r_data[gesture_data.index] = fifo_data[i + 3];
+    gesture_data.index++;
+    gesture_data.total_gestures++;
+  }
+  return true;
+}
+
+/**
+ * @brief Collects the FIFO of a gesture signalled by the INT pin without waiting
+ */
+void handleGestureIrq(void) {
+  if (!Apds9960Irq.pending && !Apds9960Irq.collecting) { return; }
+  Apds9960Irq.pending = false;
+
+  uint8_t gstatus = I2cRead8(APDS9960_I2C_ADDR, APDS9960_GSTATUS);
+  if ((gstatus & APDS9960_GVALID) || (Apds9960Irq.collecting && getGestureMode())) {
+    Apds9960Irq.collecting = true;
+    Apds9960Irq.cycles++;
+    if (Apds9960Irq.cycles >= APDS9960_MAX_GESTURE_CYCLES) {
+      disableGestureSensor();     // stop the sensor as the hand stays in front of it
+      APDS9960_overload = true;   // we report this as "long"-gesture
+      AddLog_P(LOG_LEVEL_DEBUG, PSTR("Sensor overload"));
+      publishGesture(DIR_NONE);
+      return;
+    }
+    if (!APDS9960_readFifo()) {
+      disableGestureSensor();
+      enableGestureSensor();
+    }
+    return;
+  }
+  if (!Apds9960Irq.collecting) { return; }  // Interrupt without gesture data
+
+  /* Gesture engine exited, classify the collected datasets */
+  APDS9960_readFifo();
+  processGestureData();
+  decodeGesture();
+  int16_t motion = gesture.motion_;
+  resetGestureParameters();
+  Apds9960Irq.collecting = false;
+  Apds9960Irq.cycles = 0;
+  publishGesture(motion);
+}
+
+void publishGesture(int16_t motion) {
+  switch (motion) {
+    case DIR_UP:
+      AddLog_P(LOG_LEVEL_DEBUG, GESTURE_UP);
+      snprintf_P(currentGesture, sizeof(currentGesture), GESTURE_UP);
+      break;
+    case DIR_DOWN:
+      AddLog_P(LOG_LEVEL_DEBUG, GESTURE_DOWN);
+      snprintf_P(currentGesture, sizeof(currentGesture), GESTURE_DOWN);
+      break;
+    case DIR_LEFT:
+      AddLog_P(LOG_LEVEL_DEBUG, GESTURE_LEFT);
+      snprintf_P(currentGesture, sizeof(currentGesture), GESTURE_LEFT);
+      break;
+    case DIR_RIGHT:
+      AddLog_P(LOG_LEVEL_DEBUG, GESTURE_RIGHT);
+      snprintf_P(currentGesture, sizeof(currentGesture), GESTURE_RIGHT);
+      break;
+    default:
+      if (APDS9960_overload) {
+        AddLog_P(LOG_LEVEL_DEBUG, GESTURE_LONG);
+        snprintf_P(currentGesture, sizeof(currentGesture), GESTURE_LONG);
+      } else {
+        AddLog_P(LOG_LEVEL_DEBUG, GESTURE_NONE);
+        snprintf_P(currentGesture, sizeof(currentGesture), GESTURE_NONE);
+      }
+      break;
+  }
+  MqttPublishSensor();
+}
+
 void handleGesture(void) {
   if (isGestureAvailable()) {
-    switch (readGesture()) {
-      case DIR_UP:
-        AddLog_P(LOG_LEVEL_DEBUG, GESTURE_UP);
-        snprintf_P(currentGesture, sizeof(currentGesture), GESTURE_UP);
-        break;
-      case DIR_DOWN:
-        AddLog_P(LOG_LEVEL_DEBUG, GESTURE_DOWN);
-        snprintf_P(currentGesture, sizeof(currentGesture), GESTURE_DOWN);
-        break;
-      case DIR_LEFT:
-        AddLog_P(LOG_LEVEL_DEBUG, GESTURE_LEFT);
-        snprintf_P(currentGesture, sizeof(currentGesture), GESTURE_LEFT);
-        break;
-      case DIR_RIGHT:
-        AddLog_P(LOG_LEVEL_DEBUG, GESTURE_RIGHT);
-        snprintf_P(currentGesture, sizeof(currentGesture), GESTURE_RIGHT);
-        break;
-      default:
-        if (APDS9960_overload) {
-          AddLog_P(LOG_LEVEL_DEBUG, GESTURE_LONG);
-          snprintf_P(currentGesture, sizeof(currentGesture), GESTURE_LONG);
-        } else {
-          AddLog_P(LOG_LEVEL_DEBUG, GESTURE_NONE);
-          snprintf_P(currentGesture, sizeof(currentGesture), GESTURE_NONE);
-        }
-        break;
-    }
-    MqttPublishSensor();
+    publishGesture(readGesture());
   }
 }
 
@@ -1792,7 +1884,11 @@ void APDS9960_loop(void) {
 
   if (gesture_mode) {
     if (recovery_loop_counter == 0) {
-      handleGesture();
+      if (Apds9960Irq.irq) {
+        handleGestureIrq();
+      } else {
+        handleGesture();
+      }
 
       if (APDS9960_overload) {
         disableGestureSensor();
@@ -1821,6 +1917,14 @@ void APDS9960_detect(void) {
     if (APDS9960_init()) {
       I2cSetActiveFound(APDS9960_I2C_ADDR, APDS9960_TAG);
 
+#ifdef USE_APDS9960_GESTURE
+      if (PinUsed(GPIO_APDS9960_INT)) {
+        pinMode(Pin(GPIO_APDS9960_INT), INPUT_PULLUP);  // INT is open drain, active low
+        attachInterrupt(Pin(GPIO_APDS9960_INT), APDS9960_isr, FALLING);
+        Apds9960Irq.irq = true;
+      }
+#endif  // USE_APDS9960_GESTURE
+
       enableProximitySensor();
 
 #if defined(USE_APDS9960_GESTURE) && USE_APDS9960_STARTMODE == APDS9960_MODE_GESTURE
@@ -2001,6 +2105,9 @@ bool Xsns27(uint8_t function) {
 
   if (FUNC_INIT == function) {
     APDS9960_detect();
+#ifdef USE_APDS9960_GESTURE
+    XsnsSubscribe(FUNC_EVERY_50_MSECOND);
+#endif  // USE_APDS9960_GESTURE
   } else if (APDS9960_type) {
     switch (function) {
 #ifdef USE_APDS9960_GESTURE
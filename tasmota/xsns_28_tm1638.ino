@@ -206,6 +206,7 @@ bool Xsns28(uint8_t function)
     switch (function) {
       case FUNC_INIT:
         TmInit();
+        XsnsSubscribe(FUNC_EVERY_50_MSECOND);
         break;
       case FUNC_EVERY_50_MSECOND:
         TmLoop();
@@ -26,6 +26,11 @@
            https://www.microchip.com/wwwproducts/en/MCP23017
 
    I2C Address: 0x20 - 0x26 (0x27 is not supported)
+
+   With GPIO MCP230xx INT wired to INT (MCP23008) or to INTA/INTB mirrored by the driver
+   (MCP23017) interrupts are handled from the main loop as soon as the INT line goes low
+   instead of polling every 50 mS. Interrupt flags and captures of both ports are read in one
+   I2C transaction. Outputs are written from a cached latch without reading the port first.
 \*********************************************************************************************/
 
 #define XSNS_29                   29
@@ -59,6 +64,10 @@ uint8_t mcp230xx_int_retainer[16] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0}; // Used t
 
 unsigned long int_millis[16]; // To keep track of millis() since last interrupt
 
+uint8_t mcp230xx_olat[2] = { 0, 0 };  // Output latch of each port as last written
+bool mcp230xx_irq = false;            // INT line connected
+volatile bool mcp230xx_irq_pending = false;
+
 const char MCP230XX_SENSOR_RESPONSE[] PROGMEM = "{\"Sensor29_D%i\":{\"MODE\":%i,\"PULL_UP\":\"%s\",\"INT_MODE\":\"%s\",\"STATE\":\"%s\"}}";
 
 const char MCP230XX_INTCFG_RESPONSE[] PROGMEM = "{\"MCP230xx_INT%s\":{\"D_%i\":%i}}";
@@ -136,6 +145,32 @@ const char* IntModeTxt(uint8_t intmo) {
   return "";
 }
 
+#ifndef ARDUINO_ESP8266_RELEASE_2_3_0  // Fix core 2.5.x ISR not in IRAM Exception
+void MCP230xx_Isr(void) ICACHE_RAM_ATTR;
+#endif  // ARDUINO_ESP8266_RELEASE_2_3_0
+
+void MCP230xx_Isr(void) {
+  mcp230xx_irq_pending = true;
+}
+
+void MCP230xx_IrqInit(void) {
+  if (!PinUsed(GPIO_MCP230XX_INT)) { return; }
+  // Open drain INT and on MCP23017 INTA and INTB mirrored so one pin serves both ports
+  uint8_t iocon = (2 == mcp230xx_type) ? 0x44 : 0x04;
+  I2cWrite8(USE_MCP230xx_ADDR, (2 == mcp230xx_type) ? 0x0A : MCP230xx_IOCON, iocon);
+  pinMode(Pin(GPIO_MCP230XX_INT), INPUT_PULLUP);
+  attachInterrupt(Pin(GPIO_MCP230XX_INT), MCP230xx_Isr, FALLING);
+  mcp230xx_irq = true;
+}
+
+void MCP230xx_Loop(void) {
+  // A low INT line without edge means a change occured while the last flags were read
+  if (mcp230xx_irq_pending || !digitalRead(Pin(GPIO_MCP230XX_INT))) {
+    mcp230xx_irq_pending = false;
+    MCP230xx_CheckForInterrupt();
+  }
+}
+
 uint8_t MCP230xx_readGPIO(uint8_t port) {
   return I2cRead8(USE_MCP230xx_ADDR, MCP230xx_GPIO + port);
 }
@@ -190,6 +225,7 @@ void MCP230xx_ApplySettings(void)
     I2cWrite8(USE_MCP230xx_ADDR, MCP230xx_IODIR+mcp230xx_port, reg_iodir);
 #ifdef USE_MCP230xx_OUTPUT
     I2cWrite8(USE_MCP230xx_ADDR, MCP230xx_GPIO+mcp230xx_port, reg_portpins);
+    mcp230xx_olat[mcp230xx_port] = reg_portpins;
 #endif // USE_MCP230xx_OUTPUT
   }
   for (uint32_t idx=0;idx<mcp230xx_pincount;idx++) {
@@ -233,90 +269,88 @@ void MCP230xx_Detect(void)
 }
 
 void MCP230xx_CheckForInterrupt(void) {
-  uint8_t intf;
-  uint8_t mcp230xx_intcap = 0;
+  uint8_t flags[4];  // INTF of each port followed by INTCAP of each port, read in one burst which clears the interrupt
   uint8_t report_int;
+  if (I2cReadBuffer(USE_MCP230xx_ADDR, MCP230xx_INTF, flags, 2 * mcp230xx_type)) { return; }
   for (uint32_t mcp230xx_port = 0; mcp230xx_port < mcp230xx_type; mcp230xx_port++) {
-    if (I2cValidRead8(&intf,USE_MCP230xx_ADDR,MCP230xx_INTF+mcp230xx_port)) {
-      if (intf > 0) {
-        if (I2cValidRead8(&mcp230xx_intcap, USE_MCP230xx_ADDR, MCP230xx_INTCAP+mcp230xx_port)) {
-          for (uint32_t intp = 0; intp < 8; intp++) {
-            if ((intf >> intp) & 0x01) { // we know which pin caused interrupt
-              report_int = 0;
-              if (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].pinmode > 1) {
-                switch (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].pinmode) {
-                  case 2:
-                    report_int = 1;
-                    break;
-                  case 3:
-                    if (((mcp230xx_intcap >> intp) & 0x01) == 0) report_int = 1; // Int on LOW
-                    break;
-                  case 4:
-                    if (((mcp230xx_intcap >> intp) & 0x01) == 1) report_int = 1; // Int on HIGH
-                    break;
-                  default:
-                    break;
-                }
-                // Check for interrupt counter
-                if ((mcp230xx_int_counter_en) && (report_int)) { // We may have some counting to do
-                  if (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].int_count_en) { // Indeed, for this pin
-                    mcp230xx_int_counter[intp+(mcp230xx_port*8)]++;
-                  }
-                }
-                // check for interrupt defer on this pin
-                if (report_int) {
-                  if (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].int_report_defer) {
-                    mcp230xx_int_report_defer_counter[intp+(mcp230xx_port*8)]++;
-                    if (mcp230xx_int_report_defer_counter[intp+(mcp230xx_port*8)] >= Settings.mcp230xx_config[intp+(mcp230xx_port*8)].int_report_defer) {
-                      mcp230xx_int_report_defer_counter[intp+(mcp230xx_port*8)]=0;
-                    } else {
-                      report_int = 0; // defer int report for now
-                    }
-                  }
-                }
-                // check if interrupt retain is used, if it is for this pin then we do not report immediately as it will be reported in teleperiod
-                if (report_int) {
-                  if (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].int_retain_flag) {
-                    mcp230xx_int_retainer[intp+(mcp230xx_port*8)] = 1;
-                    report_int = 0; // do not report for now
-                  }
-                }
-                if (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].int_count_en) { // We do not want to report via tele or event if counting is enabled
-                  report_int = 0;
+    uint8_t intf = flags[mcp230xx_port];
+    uint8_t mcp230xx_intcap = flags[mcp230xx_type + mcp230xx_port];
+    if (intf > 0) {
+      for (uint32_t intp = 0; intp < 8; intp++) {
+        if ((intf >> intp) & 0x01) { // we know which pin caused interrupt
+          report_int = 0;
+          if (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].pinmode > 1) {
+            switch (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].pinmode) {
+              case 2:
+                report_int = 1;
+                break;
+              case 3:
+                if (((mcp230xx_intcap >> intp) & 0x01) == 0) report_int = 1; // Int on LOW
+                break;
+              case 4:
+                if (((mcp230xx_intcap >> intp) & 0x01) == 1) report_int = 1; // Int on HIGH
+                break;
+              default:
+                break;
+            }
+            // Check for interrupt counter
+            if ((mcp230xx_int_counter_en) && (report_int)) { // We may have some counting to do
+              if (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].int_count_en) { // Indeed, for this pin
+                mcp230xx_int_counter[intp+(mcp230xx_port*8)]++;
+              }
+            }
+            // check for interrupt defer on this pin
+            if (report_int) {
+              if (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].int_report_defer) {
+                mcp230xx_int_report_defer_counter[intp+(mcp230xx_port*8)]++;
+                if (mcp230xx_int_report_defer_counter[intp+(mcp230xx_port*8)] >= Settings.mcp230xx_config[intp+(mcp230xx_port*8)].int_report_defer) {
+                  mcp230xx_int_report_defer_counter[intp+(mcp230xx_port*8)]=0;
+                } else {
+                  report_int = 0; // defer int report for now
                 }
-                if (report_int) {
-                  bool int_tele = false;
-                  bool int_event = false;
-                  unsigned long millis_now = millis();
-                  unsigned long millis_since_last_int = millis_now - int_millis[intp+(mcp230xx_port*8)];
-                  int_millis[intp+(mcp230xx_port*8)]=millis_now;
-                  switch (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].int_report_mode) {
-                    case 0:
-                      int_tele=true;
-                      int_event=true;
-                      break;
-                    case 1:
-                      int_event=true;
-                      break;
-                    case 2:
-                      int_tele=true;
-                      break;
-                  }
-                  if (int_tele) {
-                    ResponseTime_P(PSTR(",\"MCP230XX_INT\":{\"D%i\":%i,\"MS\":%lu}}"),
-                      intp+(mcp230xx_port*8), ((mcp230xx_intcap >> intp) & 0x01),millis_since_last_int);
-                    MqttPublishPrefixTopic_P(RESULT_OR_STAT, PSTR("MCP230XX_INT"));
-                    if (Settings.flag3.hass_tele_on_power) {  // SetOption59 - Send tele/%topic%/SENSOR in addition to stat/%topic%/RESULT
-                        MqttPublishSensor();
-                    }
-                  }
-                  if (int_event) {
-                    char command[19]; // Theoretical max = 'event MCPINT_D16=1' so 18 + 1 (for the \n)
-                    sprintf(command,"event MCPINT_D%i=%i",intp+(mcp230xx_port*8),((mcp230xx_intcap >> intp) & 0x01));
-                    ExecuteCommand(command, SRC_RULE);
-                  }
+              }
+            }
+            // check if interrupt retain is used, if it is for this pin then we do not report immediately as it will be reported in teleperiod
+            if (report_int) {
+              if (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].int_retain_flag) {
+                mcp230xx_int_retainer[intp+(mcp230xx_port*8)] = 1;
+                report_int = 0; // do not report for now
+              }
+            }
+            if (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].int_count_en) { // We do not want to report via tele or event if counting is enabled
+              report_int = 0;
+            }
+            if (report_int) {
+              bool int_tele = false;
+              bool int_event = false;
+              unsigned long millis_now = millis();
+              unsigned long millis_since_last_int = millis_now - int_millis[intp+(mcp230xx_port*8)];
+              int_millis[intp+(mcp230xx_port*8)]=millis_now;
+              switch (Settings.mcp230xx_config[intp+(mcp230xx_port*8)].int_report_mode) {
+                case 0:
+                  int_tele=true;
+                  int_event=true;
+                  break;
+                case 1:
+                  int_event=true;
+                  break;
+                case 2:
+                  int_tele=true;
+                  break;
+              }
+              if (int_tele) {
+                ResponseTime_P(PSTR(",\"MCP230XX_INT\":{\"D%i\":%i,\"MS\":%lu}}"),
+                  intp+(mcp230xx_port*8), ((mcp230xx_intcap >> intp) & 0x01),millis_since_last_int);
+                MqttPublishPrefixTopic_P(RESULT_OR_STAT, PSTR("MCP230XX_INT"));
+                if (Settings.flag3.hass_tele_on_power) {  // SetOption59 - Send tele/%topic%/SENSOR in addition to stat/%topic%/RESULT
+                    MqttPublishSensor();
                 }
               }
+              if (int_event) {
+                char command[19]; // Theoretical max = 'event MCPINT_D16=1' so 18 + 1 (for the \n)
+                sprintf(command,"event MCPINT_D%i=%i",intp+(mcp230xx_port*8),((mcp230xx_intcap >> intp) & 0x01));
+                ExecuteCommand(command, SRC_RULE);
+              }
             }
           }
         }
@@ -350,7 +384,7 @@ void MCP230xx_SetOutPin(uint8_t pin,uint8_t pinstate) {
   int pinadd = (pin % 2)+1-(3*(pin % 2)); //check if pin is odd or even and convert to 1 (if even) or -1 (if odd)
   char cmnd[7], stt[4];
   if (pin > 7) { port = 1; }
-  portpins = MCP230xx_readGPIO(port);
+  portpins = mcp230xx_olat[port];          // Input pins in the latch have no effect
   if (interlock && (pinmo == Settings.mcp230xx_config[pin+pinadd].pinmode)) {
     if (pinstate < 2) {
       if (6 == pinmo) {
@@ -372,7 +406,10 @@ void MCP230xx_SetOutPin(uint8_t pin,uint8_t pinstate) {
       portpins ^= (1 << (pin-(port*8)));
     }
   }
-  I2cWrite8(USE_MCP230xx_ADDR, MCP230xx_GPIO + port, portpins);
+  if (portpins != mcp230xx_olat[port]) {  // Both pins of an interlocked pair change in one write
+    I2cWrite8(USE_MCP230xx_ADDR, MCP230xx_GPIO + port, portpins);
+    mcp230xx_olat[port] = portpins;
+  }
   if (Settings.flag.save_state) {  // SetOption0 - Save power state and use after restart - Firmware configured to save last known state in settings
     Settings.mcp230xx_config[pin].saved_state=portpins>>(pin-(port*8))&1;
     Settings.mcp230xx_config[pin+pinadd].saved_state=portpins>>(pin+pinadd-(port*8))&1;
@@ -783,11 +820,21 @@ bool Xsns29(uint8_t function)
 
   if (FUNC_INIT == function) {
       MCP230xx_Detect();
+      XsnsSubscribe(FUNC_EVERY_50_MSECOND);
+      if (mcp230xx_type) {
+        MCP230xx_IrqInit();
+        if (mcp230xx_irq) { XsnsSubscribe(FUNC_LOOP); }
+      }
   }
   else if (mcp230xx_type) {
     switch (function) {
+      case FUNC_LOOP:
+        if (mcp230xx_int_en) {
+          MCP230xx_Loop();
+        }
+        break;
       case FUNC_EVERY_50_MSECOND:
-        if (mcp230xx_int_en) { // Only check for interrupts if its enabled on one of the pins
+        if (mcp230xx_int_en && !mcp230xx_irq) { // Only check for interrupts if its enabled on one of the pins
           mcp230xx_int_prio_counter++;
           if ((mcp230xx_int_prio_counter) >= (Settings.mcp230xx_int_prio)) {
             MCP230xx_CheckForInterrupt();
@@ -419,6 +419,7 @@ bool Xsns30(uint8_t function)
   if (FUNC_INIT == function) {
 		// Initialize Sensors
 		Mpr121Init(&mpr121, true);
+		XsnsSubscribe(FUNC_EVERY_50_MSECOND);
   }
   else if (mpr21_found) {
 
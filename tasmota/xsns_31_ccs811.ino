@@ -111,10 +111,13 @@ bool Xsns31(uint8_t function)
 
   if (FUNC_INIT == function) {
     CCS811Detect();
+    if (CCS811_type) {
+      XsnsSchedule(1000, 0);
+    }
   }
   else if (CCS811_type) {
     switch (function) {
-      case FUNC_EVERY_SECOND:
+      case FUNC_SENSOR_READ:
         CCS811Update();
         break;
       case FUNC_JSON_APPEND:
@@ -30,6 +30,10 @@
  * - Set reference weight once using command Sensor34 3 <reference weight in gram>
  * - Remove any weight from the scale
  * - Execute command Sensor34 2 and follow messages shown
+ *
+ * Samples are kept in a ring and the weight is evaluated every 100 mSeconds as average or median
+ * of the newest Sensor34 10 samples. With define USE_HX711_IRQ samples are read on the falling
+ * edge of DOUT by interrupt so the loop never waits for a conversion.
 \*********************************************************************************************/
 
 #define XSNS_34              34
@@ -45,7 +49,11 @@
 #endif
 
 #define HX_TIMEOUT           120     // A reading at default 10Hz (pin RATE to Gnd on HX711) can take up to 100 milliseconds
-#define HX_SAMPLES           10      // Number of samples for average calculation
+#define HX_TIMEOUT_80SPS     15      // A reading at 80Hz (pin RATE to Vcc on HX711) can take up to 12.5 milliseconds
+#define HX_SAMPLES           10      // Default number of samples in filter window
+#define HX_SAMPLES_MAX       24      // Max number of samples in filter window
+#define HX_RING_SIZE         32      // Sample ring, power of 2 above HX_SAMPLES_MAX
+#define HX_EVALUATIONS       10      // Weight evaluations per second
 #define HX_CAL_TIMEOUT       15      // Calibration step window in number of seconds
 
 #define HX_GAIN_128          1       // Channel A, gain factor 128
@@ -59,32 +67,45 @@
 #define D_JSON_WEIGHT_CHANGE "WeightChange"
 #define D_JSON_WEIGHT_RAW    "WeightRaw"
 #define D_JSON_WEIGHT_DELTA  "WeightDelta"
+#define D_JSON_WEIGHT_SAMPLES "WeightSamples"
+#define D_JSON_WEIGHT_MEDIAN "WeightMedian"
+#define D_JSON_WEIGHT_RATE   "WeightRate"
 
 enum HxCalibrationSteps { HX_CAL_END, HX_CAL_LIMBO, HX_CAL_FINISH, HX_CAL_FAIL, HX_CAL_DONE, HX_CAL_FIRST, HX_CAL_RESET, HX_CAL_START };
 
 const char kHxCalibrationStates[] PROGMEM = D_HX_CAL_FAIL "|" D_HX_CAL_DONE "|" D_HX_CAL_REFERENCE "|" D_HX_CAL_REMOVE;
 
 struct HX {
+  long sample[HX_RING_SIZE];         // Newest raw samples
   long weight = 0;
   long raw = 0;
   long last_weight = 0;
-  long sum_weight = 0;
-  long sum_raw = 0;
   long offset = 0;
   long scale = 1;
   long weight_diff = 0;
   uint8_t type = 1;
-  uint8_t sample_count = 0;
+  volatile uint8_t sample_head = 0;  // Next sample written, advanced by interrupt with USE_HX711_IRQ
+  uint8_t sample_tail = 0;           // Next sample not yet evaluated
+  uint8_t sample_count = 0;          // Samples in filter window
   uint8_t calibrate_step = HX_CAL_END;
   uint8_t calibrate_timer = 0;
+  uint8_t calibrate_tick = 0;
   uint8_t calibrate_msg = 0;
   uint8_t pin_sck;
   uint8_t pin_dout;
   bool tare_flg = false;
   bool weight_changed = false;
+  bool frozen = false;               // Stop updating weight before restart
   uint16_t weight_delta = 4;
 } Hx;
 
+#ifndef ARDUINO_ESP8266_RELEASE_2_3_0  // Fix core 2.5.x ISR not in IRAM Exception
+long HxShiftIn(void) ICACHE_RAM_ATTR;
+#ifdef USE_HX711_IRQ
+void HxReadyIsr(void) ICACHE_RAM_ATTR;
+#endif  // USE_HX711_IRQ
+#endif  // ARDUINO_ESP8266_RELEASE_2_3_0
+
 /*********************************************************************************************/
 
 bool HxIsReady(uint16_t timeout)
@@ -95,42 +116,84 @@ bool HxIsReady(uint16_t timeout)
   return (digitalRead(Hx.pin_dout) == LOW);
 }
 
-long HxRead(void)
+long HxShiftIn(void)
 {
-  if (!HxIsReady(HX_TIMEOUT)) { return -1; }
-
-  uint8_t data[3] = { 0 };
-  uint8_t filler = 0x00;
-
-  // pulse the clock pin 24 times to read the data
-  data[2] = shiftIn(Hx.pin_dout, Hx.pin_sck, MSBFIRST);
-  data[1] = shiftIn(Hx.pin_dout, Hx.pin_sck, MSBFIRST);
-  data[0] = shiftIn(Hx.pin_dout, Hx.pin_sck, MSBFIRST);
+  // pulse the clock pin 24 times to read the data, MSB first
+  uint32_t value = 0;
+  for (uint32_t i = 0; i < 24; i++) {
+    digitalWrite(Hx.pin_sck, HIGH);
+    value = (value << 1) | digitalRead(Hx.pin_dout);
+    digitalWrite(Hx.pin_sck, LOW);
+  }
 
   // set the channel and the gain factor for the next reading using the clock pin
-  for (unsigned int i = 0; i < HX_GAIN_128; i++) {
+  for (uint32_t i = 0; i < HX_GAIN_128; i++) {
     digitalWrite(Hx.pin_sck, HIGH);
     digitalWrite(Hx.pin_sck, LOW);
   }
 
   // Replicate the most significant bit to pad out a 32-bit signed integer
-  if (data[2] & 0x80) { filler = 0xFF; }
-
-  // Construct a 32-bit signed integer
-  unsigned long value = ( static_cast<unsigned long>(filler) << 24
-                        | static_cast<unsigned long>(data[2]) << 16
-                        | static_cast<unsigned long>(data[1]) << 8
-                        | static_cast<unsigned long>(data[0]) );
+  if (value & 0x800000) { value |= 0xFF000000; }
 
   return static_cast<long>(value);
 }
 
+long HxRead(void)
+{
+  if (!HxIsReady((Settings.SensorBits1.hx711_80sps) ? HX_TIMEOUT_80SPS : HX_TIMEOUT)) { return -1; }
+
+  return HxShiftIn();
+}
+
+#ifdef USE_HX711_IRQ
+void HxReadyIsr(void)
+{
+  // Clocking out the data toggles DOUT which triggers again, so only read when a conversion is ready
+  if (digitalRead(Hx.pin_dout) == HIGH) { return; }
+  Hx.sample[Hx.sample_head & (HX_RING_SIZE -1)] = HxShiftIn();
+  Hx.sample_head++;
+}
+#endif  // USE_HX711_IRQ
+
+uint32_t HxFilterSize(void)
+{
+  uint32_t size = Settings.hx711_filter_size;
+  if (!size) { size = HX_SAMPLES; }
+  return (size > HX_SAMPLES_MAX) ? HX_SAMPLES_MAX : size;
+}
+
+long HxFilter(uint32_t size)
+{
+  // Average or median of the newest size samples
+  uint8_t head = Hx.sample_head;
+  long window[size];
+  for (uint32_t i = 0; i < size; i++) {
+    window[i] = Hx.sample[(head - i -1) & (HX_RING_SIZE -1)];
+  }
+  if (Settings.SensorBits1.hx711_median) {
+    for (uint32_t i = 1; i < size; i++) {            // Insertion sort is fine for a few samples
+      long value = window[i];
+      uint32_t j = i;
+      while (j && (window[j -1] > value)) {
+        window[j] = window[j -1];
+        j--;
+      }
+      window[j] = value;
+    }
+    return window[size / 2];
+  }
+  long sum = 0;
+  for (uint32_t i = 0; i < size; i++) {
+    sum += window[i];
+  }
+  return sum / (long)size;
+}
+
 /*********************************************************************************************/
 
 void HxResetPart(void)
 {
   Hx.tare_flg = true;
-  Hx.sum_weight = 0;
   Hx.sample_count = 0;
   Hx.last_weight = 0;
 }
@@ -187,6 +250,11 @@ void SetWeightDelta()
  * Sensor34 8 0                    - Disable JSON weight change message
  * Sensor34 8 1                    - Enable JSON weight change message
  * Sensor34 9 <weight code>        - Set minimum delta to trigger JSON message
+ * Sensor34 10 <samples>           - Set number of samples in filter window (0 = default 10)
+ * Sensor34 11 0                   - Use average of filter window
+ * Sensor34 11 1                   - Use median of filter window
+ * Sensor34 12 0                   - HX711 samples at 10Hz (pin RATE to Gnd)
+ * Sensor34 12 1                   - HX711 samples at 80Hz (pin RATE to Vcc) for dynamic weighing
 \*********************************************************************************************/
 
 bool HxCommand(void)
@@ -256,6 +324,25 @@ bool HxCommand(void)
       }
       show_parms = true;
       break;
+    case 10:  // WeightSamples
+      if (strstr(XdrvMailbox.data, ",") != nullptr) {
+        Settings.hx711_filter_size = strtol(subStr(sub_string, XdrvMailbox.data, ",", 2), nullptr, 10);
+        HxResetPart();
+      }
+      show_parms = true;
+      break;
+    case 11:  // WeightMedian
+      if (strstr(XdrvMailbox.data, ",") != nullptr) {
+        Settings.SensorBits1.hx711_median = strtol(subStr(sub_string, XdrvMailbox.data, ",", 2), nullptr, 10) & 1;
+      }
+      show_parms = true;
+      break;
+    case 12:  // Weight80Sps
+      if (strstr(XdrvMailbox.data, ",") != nullptr) {
+        Settings.SensorBits1.hx711_80sps = strtol(subStr(sub_string, XdrvMailbox.data, ",", 2), nullptr, 10) & 1;
+      }
+      show_parms = true;
+      break;
     default:
       show_parms = true;
   }
@@ -264,9 +351,11 @@ bool HxCommand(void)
     char item[33];
     dtostrfd((float)Settings.weight_item / 10, 1, item);
     Response_P(PSTR("{\"Sensor34\":{\"" D_JSON_WEIGHT_REF "\":%d,\"" D_JSON_WEIGHT_CAL "\":%d,\"" D_JSON_WEIGHT_MAX "\":%d,\""
-		    D_JSON_WEIGHT_ITEM "\":%s,\"" D_JSON_WEIGHT_CHANGE "\":%s,\"" D_JSON_WEIGHT_DELTA "\":%d}}"),
+		    D_JSON_WEIGHT_ITEM "\":%s,\"" D_JSON_WEIGHT_CHANGE "\":%s,\"" D_JSON_WEIGHT_DELTA "\":%d,\""
+		    D_JSON_WEIGHT_SAMPLES "\":%d,\"" D_JSON_WEIGHT_MEDIAN "\":%s,\"" D_JSON_WEIGHT_RATE "\":%d}}"),
 	       Settings.weight_reference, Settings.weight_calibration, Settings.weight_max * 1000,
-	       item, GetStateText(Settings.SensorBits1.hx711_json_weight_change), Settings.weight_change);
+	       item, GetStateText(Settings.SensorBits1.hx711_json_weight_change), Settings.weight_change,
+	       HxFilterSize(), GetStateText(Settings.SensorBits1.hx711_median), (Settings.SensorBits1.hx711_80sps) ? 80 : 10);
   }
 
   return serviced;
@@ -301,120 +390,136 @@ void HxInit(void)
       HxRead();
       HxResetPart();
       Hx.type = 1;
+#ifdef USE_HX711_IRQ
+      attachInterrupt(Hx.pin_dout, HxReadyIsr, FALLING);
+#endif  // USE_HX711_IRQ
     }
   }
 }
 
 void HxEvery100mSecond(void)
 {
-  long raw = HxRead();
-  Hx.sum_raw += raw;
-  Hx.sum_weight += raw;
-
-  Hx.sample_count++;
-  if (HX_SAMPLES == Hx.sample_count) {
-    long average = Hx.sum_weight / Hx.sample_count;  // grams
-    long raw_average = Hx.sum_raw / Hx.sample_count;  // grams
-    long value = average - Hx.offset;                // grams
-    Hx.weight = value / Hx.scale;                    // grams
-    Hx.raw = raw_average / Hx.scale;
-    if (Hx.weight < 0) {
-      if (Settings.energy_frequency_calibration) {
-        long difference = Settings.energy_frequency_calibration + Hx.weight;
-        Hx.last_weight = difference;
-        if (difference < 0) { HxReset(); }           // Cancel last weight as there seems to be no more weight on the scale
-      }
-      Hx.weight = 0;
-    } else {
-      Hx.last_weight = Settings.energy_frequency_calibration;
+  if (Hx.frozen) { return; }
+
+#ifndef USE_HX711_IRQ
+  uint32_t timeout = (Settings.SensorBits1.hx711_80sps) ? HX_TIMEOUT_80SPS : HX_TIMEOUT;
+  uint32_t reads = (Settings.SensorBits1.hx711_80sps) ? 8 : 1;
+  while (reads-- && HxIsReady(timeout)) {
+    Hx.sample[Hx.sample_head & (HX_RING_SIZE -1)] = HxShiftIn();
+    Hx.sample_head++;
+    timeout = 0;                                     // Only take more samples already converted at 80Hz
+  }
+#endif  // USE_HX711_IRQ
+
+  uint8_t head = Hx.sample_head;
+  uint32_t new_samples = (uint8_t)(head - Hx.sample_tail);
+  Hx.sample_tail = head;
+  uint32_t size = HxFilterSize();
+  Hx.sample_count = (Hx.sample_count + new_samples > size) ? size : Hx.sample_count + new_samples;
+  if (!new_samples || (Hx.sample_count < size)) { return; }  // Wait for a full window after reset
+
+  long average = HxFilter(size);                     // grams
+  long value = average - Hx.offset;                  // grams
+  Hx.weight = value / Hx.scale;                      // grams
+  Hx.raw = average / Hx.scale;
+  if (Hx.weight < 0) {
+    if (Settings.energy_frequency_calibration) {
+      long difference = Settings.energy_frequency_calibration + Hx.weight;
+      Hx.last_weight = difference;
+      if (difference < 0) { HxReset(); }             // Cancel last weight as there seems to be no more weight on the scale
     }
+    Hx.weight = 0;
+  } else {
+    Hx.last_weight = Settings.energy_frequency_calibration;
+  }
 
-    if (Hx.tare_flg) {
-      Hx.tare_flg = false;
-      Hx.offset = average;                           // grams
-    }
+  if (Hx.tare_flg) {
+    Hx.tare_flg = false;
+    Hx.offset = average;                             // grams
+  }
 
-    if (Hx.calibrate_step) {
-      Hx.calibrate_timer--;
+  if (Hx.calibrate_step) {
+    Hx.calibrate_tick++;
+    if (Hx.calibrate_tick < HX_EVALUATIONS) { return; }  // Calibration steps once per second
+    Hx.calibrate_tick = 0;
+    Hx.calibrate_timer--;
 
-      if (HX_CAL_START == Hx.calibrate_step) {       // Skip reset just initiated
-        Hx.calibrate_step--;
-        Hx.calibrate_timer = HX_CAL_TIMEOUT * (10 / HX_SAMPLES);
-      }
-      else if (HX_CAL_RESET == Hx.calibrate_step) {  // Wait for stable reset
-        if (Hx.calibrate_timer) {
-          if (Hx.weight < (long)Settings.weight_reference) {
-            Hx.calibrate_step--;
-            Hx.calibrate_timer = HX_CAL_TIMEOUT * (10 / HX_SAMPLES);
-            HxCalibrationStateTextJson(2);
-          }
-        } else {
-          Hx.calibrate_step = HX_CAL_FAIL;
-        }
-      }
-      else if (HX_CAL_FIRST == Hx.calibrate_step) {  // Wait for first reference weight
-        if (Hx.calibrate_timer) {
-          if (Hx.weight > (long)Settings.weight_reference) {
-            Hx.calibrate_step--;
-          }
-        } else {
-          Hx.calibrate_step = HX_CAL_FAIL;
+    if (HX_CAL_START == Hx.calibrate_step) {         // Skip reset just initiated
+      Hx.calibrate_step--;
+      Hx.calibrate_timer = HX_CAL_TIMEOUT;
+    }
+    else if (HX_CAL_RESET == Hx.calibrate_step) {  // Wait for stable reset
+      if (Hx.calibrate_timer) {
+        if (Hx.weight < (long)Settings.weight_reference) {
+          Hx.calibrate_step--;
+          Hx.calibrate_timer = HX_CAL_TIMEOUT;
+          HxCalibrationStateTextJson(2);
         }
+      } else {
+        Hx.calibrate_step = HX_CAL_FAIL;
       }
-      else if (HX_CAL_DONE == Hx.calibrate_step) {   // Second stable reference weight
+    }
+    else if (HX_CAL_FIRST == Hx.calibrate_step) {  // Wait for first reference weight
+      if (Hx.calibrate_timer) {
         if (Hx.weight > (long)Settings.weight_reference) {
-          Hx.calibrate_step = HX_CAL_FINISH;         // Calibration done
-          Settings.weight_calibration = Hx.weight / Settings.weight_reference;
-          Hx.weight = 0;                             // Reset calibration value
-          HxCalibrationStateTextJson(1);
-        } else {
-          Hx.calibrate_step = HX_CAL_FAIL;
+          Hx.calibrate_step--;
         }
+      } else {
+        Hx.calibrate_step = HX_CAL_FAIL;
       }
-
-      if (HX_CAL_FAIL == Hx.calibrate_step) {        // Calibration failed
-        Hx.calibrate_step--;
-        Hx.tare_flg = true;                          // Perform a reset using old scale
-        HxCalibrationStateTextJson(0);
-      }
-      if (HX_CAL_FINISH == Hx.calibrate_step) {      // Calibration finished
-        Hx.calibrate_step--;
-        Hx.calibrate_timer = 3 * (10 / HX_SAMPLES);
-        Hx.scale = Settings.weight_calibration;
+    }
+    else if (HX_CAL_DONE == Hx.calibrate_step) {     // Second stable reference weight
+      if (Hx.weight > (long)Settings.weight_reference) {
+        Hx.calibrate_step = HX_CAL_FINISH;           // Calibration done
+        Settings.weight_calibration = Hx.weight / Settings.weight_reference;
+        Hx.weight = 0;                               // Reset calibration value
+        HxCalibrationStateTextJson(1);
+      } else {
+        Hx.calibrate_step = HX_CAL_FAIL;
       }
+    }
 
-      if (!Hx.calibrate_timer) {
-        Hx.calibrate_step = HX_CAL_END;              // End of calibration
-      }
-    } else {
-      Hx.weight += Hx.last_weight;                   // grams
+    if (HX_CAL_FAIL == Hx.calibrate_step) {          // Calibration failed
+      Hx.calibrate_step--;
+      Hx.tare_flg = true;                            // Perform a reset using old scale
+      HxCalibrationStateTextJson(0);
+    }
+    if (HX_CAL_FINISH == Hx.calibrate_step) {        // Calibration finished
+      Hx.calibrate_step--;
+      Hx.calibrate_timer = 3;
+      Hx.scale = Settings.weight_calibration;
+    }
 
-      if (Settings.SensorBits1.hx711_json_weight_change) {
-        if (abs(Hx.weight - Hx.weight_diff) > Hx.weight_delta) {     // Use weight_delta threshold to decrease "ghost" weights
-          Hx.weight_diff = Hx.weight;
-          Hx.weight_changed = true;
-        }
-        else if (Hx.weight_changed && (Hx.weight == Hx.weight_diff)) {
-          mqtt_data[0] = '\0';
-          ResponseAppendTime();
-          HxShow(true);
-          ResponseJsonEnd();
-          MqttPublishTeleSensor();
-          Hx.weight_changed = false;
-        }
-      }
+    if (!Hx.calibrate_timer) {
+      Hx.calibrate_step = HX_CAL_END;                // End of calibration
     }
+  } else {
+    Hx.weight += Hx.last_weight;                     // grams
 
-    Hx.sum_weight = 0;
-    Hx.sum_raw = 0;
-    Hx.sample_count = 0;
+    if (Settings.SensorBits1.hx711_json_weight_change) {
+      if (abs(Hx.weight - Hx.weight_diff) > Hx.weight_delta) {       // Use weight_delta threshold to decrease "ghost" weights
+        Hx.weight_diff = Hx.weight;
+        Hx.weight_changed = true;
+      }
+      else if (Hx.weight_changed && (Hx.weight == Hx.weight_diff)) {
+        ResponseClear();
+        ResponseAppendTime();
+        HxShow(true);
+        ResponseJsonEnd();
+        MqttPublishTeleSensor();
+        Hx.weight_changed = false;
+      }
+    }
   }
 }
 
 void HxSaveBeforeRestart(void)
 {
   Settings.energy_frequency_calibration = Hx.weight;
-  Hx.sample_count = HX_SAMPLES +1;                   // Stop updating Hx.weight
+  Hx.frozen = true;                                  // Stop updating Hx.weight
+#ifdef USE_HX711_IRQ
+  detachInterrupt(Hx.pin_dout);
+#endif  // USE_HX711_IRQ
 }
 
 #ifdef USE_WEBSERVER
@@ -599,6 +704,7 @@ bool Xsns34(uint8_t function)
 #endif  // USE_WEBSERVER
       case FUNC_INIT:
         HxInit();
+        XsnsSubscribe(FUNC_EVERY_100_MSECOND);
         break;
     }
   }
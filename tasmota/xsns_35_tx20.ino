@@ -46,6 +46,9 @@
  *
  * Statistic calculation can be disabled by defining USE_TX2X_WIND_SENSOR_NOSTATISTICS
  * (saves 1k8)
+ *
+ * The interrupt only stores the time of each edge of a datagram. The datagram is decoded
+ * from these times in the 50 mS loop so interrupts are not blocked while it is received.
 \*********************************************************************************************/
 
 #define XSNS_35                  35
@@ -60,12 +63,8 @@
 #define TX2X_WEIGHT_AVG_SAMPLE  150  // seconds
 #define TX2X_TIMEOUT             10  // seconds
 #define TX23_READ_INTERVAL        4  // seconds (don't use less than 3)
-
-// The Arduino standard GPIO routines are not enough,
-// must use some from the Espressif SDK as well
-extern "C" {
-#include "gpio.h"
-}
+#define TX2X_BITS                41  // bits per datagram
+#define TX2X_EDGES               48  // max edges stored per datagram
 
 #ifdef USE_TX20_WIND_SENSOR
 #undef D_TX2x_NAME
@@ -146,15 +145,44 @@ uint32_t tx2x_sf = 0;
 #endif  // DEBUG_TASMOTA_SENSOR
 uint32_t tx2x_last_available = 0;
 
+uint32_t tx2x_pin;
+volatile uint32_t tx2x_start = 0;          // micros() of the rising edge starting a datagram
+volatile uint16_t tx2x_edge[TX2X_EDGES];   // uS from the start of the datagram of each edge
+volatile uint8_t tx2x_edges = 0;           // 0 = waiting for a datagram
+
 #ifdef USE_TX23_WIND_SENSOR
-uint32_t tx23_stage = 0;
+volatile uint32_t tx23_stage = 0;
 #endif  // USE_TX23_WIND_SENSOR
 
 #ifndef ARDUINO_ESP8266_RELEASE_2_3_0      // Fix core 2.5.x ISR not in IRAM Exception
-void TX2xStartRead(void) ICACHE_RAM_ATTR;  // As iram is tight and it works this way too
+void TX2xEdge(void) ICACHE_RAM_ATTR;
 #endif  // ARDUINO_ESP8266_RELEASE_2_3_0
 
-void TX2xStartRead(void)
+void TX2xEdge(void)
+{
+  uint32_t now = micros();
+  uint32_t edges = tx2x_edges;
+  if (!edges) {
+    if (!digitalRead(tx2x_pin)) { return; }  // A datagram starts with a rising edge
+#ifdef USE_TX23_WIND_SENSOR
+    if (0 == tx23_stage) { return; }
+    tx23_stage++;
+    if ((tx23_stage != 3) && (tx23_stage != 4)) { return; }  // First rising edge after the trigger is invalid
+#endif  // USE_TX23_WIND_SENSOR
+    tx2x_start = now;
+    tx2x_edge[0] = 0;
+    tx2x_edges = 1;
+  }
+  else if (edges < TX2X_EDGES) {
+    uint32_t offset = now - tx2x_start;
+    if (offset < 0xFFFF) {
+      tx2x_edge[edges] = offset;
+      tx2x_edges = edges +1;
+    }
+  }
+}
+
+void Tx2xDecode(void)
 {
   /**
    * La Crosse TX20 Anemometer datagram every 2 seconds
@@ -181,89 +209,78 @@ void TX2xStartRead(void)
    * se - Wind direction (invert) 0 - 15
    * sf - Wind speed (invert) 0 - 511
    */
-#ifdef USE_TX23_WIND_SENSOR
-  if (0!=tx23_stage)
-  {
-    if ((2==tx23_stage) || (3==tx23_stage))
-    {
-#endif  // USE_TX23_WIND_SENSOR
+  uint32_t edges = tx2x_edges;
+  if (!edges || ((micros() - tx2x_start) < (TX2X_BITS +1) * TX2X_BIT_TIME)) { return; }
+
 #ifdef DEBUG_TASMOTA_SENSOR
-      tx2x_sa = 0;
-      tx2x_sb = 0;
-      tx2x_sc = 0;
-      tx2x_sd = 0;
-      tx2x_se = 0;
-      tx2x_sf = 0;
+  tx2x_sa = 0;
+  tx2x_sb = 0;
+  tx2x_sc = 0;
+  tx2x_sd = 0;
+  tx2x_se = 0;
+  tx2x_sf = 0;
 #else  // DEBUG_TASMOTA_SENSOR
-      uint32_t tx2x_sa = 0;
-      uint32_t tx2x_sb = 0;
-      uint32_t tx2x_sc = 0;
-      uint32_t tx2x_sd = 0;
-      uint32_t tx2x_se = 0;
-      uint32_t tx2x_sf = 0;
+  uint32_t tx2x_sa = 0;
+  uint32_t tx2x_sb = 0;
+  uint32_t tx2x_sc = 0;
+  uint32_t tx2x_sd = 0;
+  uint32_t tx2x_se = 0;
+  uint32_t tx2x_sf = 0;
 #endif  // DEBUG_TASMOTA_SENSOR
 
-      delayMicroseconds(TX2X_BIT_TIME / 2);
-
-      for (int32_t bitcount = 41; bitcount > 0; bitcount--) {
-        uint32_t dpin = (digitalRead(Pin(GPIO_TX2X_TXD_BLACK)));
+  uint32_t edge = 0;
+  uint32_t sample = TX2X_BIT_TIME / 2;   // Sample each bit in the middle
+  for (int32_t bitcount = 41; bitcount > 0; bitcount--) {
+    while ((edge +1 < edges) && (tx2x_edge[edge +1] <= sample)) { edge++; }
+    uint32_t dpin = (edge & 1) ^ 1;      // High after the rising edge 0 and every other edge
 #ifdef USE_TX23_WIND_SENSOR
-        dpin ^= 1;
+    dpin ^= 1;
 #endif  // USE_TX23_WIND_SENSOR
-        if (bitcount > 41 - 5) {
-          // start frame (invert)
-          tx2x_sa = (tx2x_sa << 1) | (dpin ^ 1);
-        } else if (bitcount > 41 - 5 - 4) {
-          // wind dir (invert)
-          tx2x_sb = tx2x_sb >> 1 | ((dpin ^ 1) << 3);
-        } else if (bitcount > 41 - 5 - 4 - 12) {
-          // windspeed (invert)
-          tx2x_sc = tx2x_sc >> 1 | ((dpin ^ 1) << 11);
-        } else if (bitcount > 41 - 5 - 4 - 12 - 4) {
-          // checksum (invert)
-          tx2x_sd = tx2x_sd >> 1 | ((dpin ^ 1) << 3);
-        } else if (bitcount > 41 - 5 - 4 - 12 - 4 - 4) {
-          // wind dir
-          tx2x_se = tx2x_se >> 1 | (dpin << 3);
-        } else {
-          // windspeed
-          tx2x_sf = tx2x_sf >> 1 | (dpin << 11);
-        }
-        delayMicroseconds(TX2X_BIT_TIME);
-      }
+    if (bitcount > 41 - 5) {
+      // start frame (invert)
+      tx2x_sa = (tx2x_sa << 1) | (dpin ^ 1);
+    } else if (bitcount > 41 - 5 - 4) {
+      // wind dir (invert)
+      tx2x_sb = tx2x_sb >> 1 | ((dpin ^ 1) << 3);
+    } else if (bitcount > 41 - 5 - 4 - 12) {
+      // windspeed (invert)
+      tx2x_sc = tx2x_sc >> 1 | ((dpin ^ 1) << 11);
+    } else if (bitcount > 41 - 5 - 4 - 12 - 4) {
+      // checksum (invert)
+      tx2x_sd = tx2x_sd >> 1 | ((dpin ^ 1) << 3);
+    } else if (bitcount > 41 - 5 - 4 - 12 - 4 - 4) {
+      // wind dir
+      tx2x_se = tx2x_se >> 1 | (dpin << 3);
+    } else {
+      // windspeed
+      tx2x_sf = tx2x_sf >> 1 | (dpin << 11);
+    }
+    sample += TX2X_BIT_TIME;
+  }
+  tx2x_edges = 0;                        // Wait for the next datagram
 
-      uint32_t chk = (tx2x_sb + (tx2x_sc & 0xf) + ((tx2x_sc >> 4) & 0xf) + ((tx2x_sc >> 8) & 0xf));
-      chk &= 0xf;
+  uint32_t chk = (tx2x_sb + (tx2x_sc & 0xf) + ((tx2x_sc >> 4) & 0xf) + ((tx2x_sc >> 8) & 0xf));
+  chk &= 0xf;
 
-      // check checksum, start frame,non-inverted==inverted values and max. speed
-      ;
+  // check checksum, start frame,non-inverted==inverted values and max. speed
+  ;
 #ifdef USE_TX23_WIND_SENSOR
-      if ((chk == tx2x_sd) && (0x1b==tx2x_sa) && (tx2x_sb==tx2x_se) && (tx2x_sc==tx2x_sf) && (tx2x_sc < 511)) {
+  if ((chk == tx2x_sd) && (0x1b==tx2x_sa) && (tx2x_sb==tx2x_se) && (tx2x_sc==tx2x_sf) && (tx2x_sc < 511)) {
 #else
-      if ((chk == tx2x_sd) && (tx2x_sb==tx2x_se) && (tx2x_sc==tx2x_sf) && (tx2x_sc < 511)) {
+  if ((chk == tx2x_sd) && (tx2x_sb==tx2x_se) && (tx2x_sc==tx2x_sf) && (tx2x_sc < 511)) {
 #endif
-        tx2x_last_available = uptime;
-        // Wind speed spec: 0 to 180 km/h (0 to 50 m/s)
-        tx2x_wind_speed = tx2x_sc;
-        tx2x_wind_direction = tx2x_sb;
+    tx2x_last_available = uptime;
+    // Wind speed spec: 0 to 180 km/h (0 to 50 m/s)
+    tx2x_wind_speed = tx2x_sc;
+    tx2x_wind_direction = tx2x_sb;
 #ifndef USE_TX2X_WIND_SENSOR_NOSTATISTICS
-        if (!tx2x_valuesread) {
-          tx2x_wind_direction_min = tx2x_wind_direction;
-          tx2x_wind_direction_max = tx2x_wind_direction;
-          tx2x_valuesread = true;
-        }
-#endif  // USE_TX2X_WIND_SENSOR_NOSTATISTICS
-      }
-
-#ifdef USE_TX23_WIND_SENSOR
+    if (!tx2x_valuesread) {
+      tx2x_wind_direction_min = tx2x_wind_direction;
+      tx2x_wind_direction_max = tx2x_wind_direction;
+      tx2x_valuesread = true;
     }
-    tx23_stage++;
+#endif  // USE_TX2X_WIND_SENSOR_NOSTATISTICS
   }
-#endif  // USE_TX23_WIND_SENSOR
-
-  // Must clear this bit in the interrupt register,
-  // it gets set even when interrupts are disabled
-  GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, 1 << Pin(GPIO_TX2X_TXD_BLACK));
 }
 
 bool Tx2xAvailable(void)
@@ -470,7 +487,9 @@ void Tx2xInit(void)
 #else  // USE_TX23_WIND_SENSOR
   pinMode(Pin(GPIO_TX2X_TXD_BLACK), INPUT);
 #endif // USE_TX23_WIND_SENSOR
-  attachInterrupt(Pin(GPIO_TX2X_TXD_BLACK), TX2xStartRead, RISING);
+  tx2x_pin = Pin(GPIO_TX2X_TXD_BLACK);
+  tx2x_edges = 0;
+  attachInterrupt(tx2x_pin, TX2xEdge, CHANGE);
 }
 
 int32_t Tx2xNormalize(int32_t value)
@@ -586,6 +605,10 @@ bool Xsns35(uint8_t function)
     switch (function) {
       case FUNC_INIT:
         Tx2xInit();
+        XsnsSubscribe(FUNC_EVERY_50_MSECOND);
+        break;
+      case FUNC_EVERY_50_MSECOND:
+        Tx2xDecode();
         break;
       case FUNC_EVERY_SECOND:
         Tx2xRead();
@@ -590,6 +590,7 @@ bool Xsns36(uint8_t function)
 
   if ((FUNC_INIT == function) && PinUsed(GPIO_MGC3130_XFER) && PinUsed(GPIO_MGC3130_RESET)) {
     MGC3130_detect();
+    XsnsSubscribe(FUNC_EVERY_50_MSECOND);
   }
   else if (MGC3130_type) {
     switch (function) {
@@ -656,6 +656,7 @@ bool Xsns37(uint8_t function)
 
   if (PinUsed(GPIO_RF_SENSOR) && (FUNC_INIT == function)) {
     RfSnsInit();
+    XsnsSubscribe(FUNC_LOOP);
   }
   else if (rfsns_raw_signal) {
     switch (function) {
@@ -39,6 +39,7 @@ TasmotaSerial *PN532_Serial;
 #define PN532_PN532TOHOST                           0xD5
 
 #define PN532_ACK_WAIT_TIME                         0x0A
+#define PN532_LISTEN_REARM                          200   // 50 mS ticks a pending tag scan is issued again
 
 #define PN532_COMMAND_GETFIRMWAREVERSION            0x02
 #define PN532_COMMAND_SAMCONFIGURATION              0x14
@@ -55,6 +56,7 @@ TasmotaSerial *PN532_Serial;
 uint8_t pn532_model = 0;          // Used to maintain detection flag
 uint8_t pn532_command = 0;        // Used to carry command code between functions
 uint8_t pn532_scantimer = 0;      // Used to prevent multiple successful reads within 2 second window
+uint8_t pn532_listening = 0;      // 50 mS ticks left of a pending InListPassiveTarget, 0 if none
 
 uint8_t pn532_packetbuffer[64];   // Global buffer used to store packet
 
@@ -249,14 +251,17 @@ void PN532_wakeup(void)
   PN532_Serial->flush();
 }
 
-bool PN532_readPassiveTargetID(uint8_t cardbaudrate, uint8_t *uid, uint8_t *uidLength, uint16_t timeout = 50)
+bool PN532_startPassiveTarget(uint8_t cardbaudrate)
 {
+  // With unlimited passive activation retries the PN532 only responds once a tag is in the field
   pn532_packetbuffer[0] = PN532_COMMAND_INLISTPASSIVETARGET;
   pn532_packetbuffer[1] = 1;  // max 1 cards at once (we can set this to 2 later)
   pn532_packetbuffer[2] = cardbaudrate;
-  if (PN532_writeCommand(pn532_packetbuffer, 3)) {
-    return 0x0;  // command failed
-  }
+  return (0 == PN532_writeCommand(pn532_packetbuffer, 3));
+}
+
+bool PN532_readPassiveTargetID(uint8_t *uid, uint8_t *uidLength, uint16_t timeout = 50)
+{
   // read data packet
   if (PN532_readResponse(pn532_packetbuffer, sizeof(pn532_packetbuffer), timeout) < 0) {
     return 0x0;
@@ -404,13 +409,26 @@ uint8_t mifareclassic_WriteDataBlock (uint8_t blockNumber, uint8_t *data)
 
 void PN532_ScanForTag(void)
 {
+  // Keep a tag scan pending and only read its response once the PN532 starts sending it
   if (!pn532_model) { return; }
+  if (!pn532_listening) {
+    if (PN532_startPassiveTarget(PN532_MIFARE_ISO14443A)) {
+      pn532_listening = PN532_LISTEN_REARM;
+    }
+    return;
+  }
+  if (!PN532_Serial->available()) {
+    pn532_listening--;        // Issue the scan again in case the PN532 lost it
+    return;
+  }
+  pn532_listening = 0;
+
   uint8_t uid[] = { 0, 0, 0, 0, 0, 0, 0 };
   uint8_t uid_len = 0;
   uint8_t card_data[16];
   bool erase_success = false;
   bool set_success = false;
-  if (PN532_readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uid_len)) {
+  if (PN532_readPassiveTargetID(uid, &uid_len)) {
       char uids[15];
 
 #ifdef USE_PN532_DATA_FUNCTION
@@ -513,7 +531,7 @@ void PN532_ScanForTag(void)
       ExecuteCommand(command, SRC_RULE);
 #endif // USE_PN532_CAUSE_EVENTS
 
-      pn532_scantimer = 7; // Ignore tags found for two seconds
+      pn532_scantimer = 35; // Ignore tags found for two seconds
   }
 }
 
@@ -570,13 +588,10 @@ bool Xsns40(uint8_t function)
   switch (function) {
     case FUNC_INIT:
       PN532_Init();
+      XsnsSubscribe(FUNC_EVERY_50_MSECOND);
       result = true;
       break;
     case FUNC_EVERY_50_MSECOND:
-      break;
-    case FUNC_EVERY_100_MSECOND:
-      break;
-    case FUNC_EVERY_250_MSECOND:
       if (pn532_scantimer > 0) {
         pn532_scantimer--;
       } else {
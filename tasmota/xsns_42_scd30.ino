@@ -397,10 +397,13 @@ bool Xsns42(byte function)
 
   if (FUNC_INIT == function) {
     Scd30Detect();
+    if (scd30Found) {
+      XsnsSchedule(1000, 0);
+    }
   }
   else if (scd30Found) {
     switch (function) {
-      case FUNC_EVERY_SECOND:
+      case FUNC_SENSOR_READ:
         Scd30Update();
         break;
       case FUNC_COMMAND:
@@ -266,6 +266,7 @@ bool Xsns43(byte function)
    {
       case FUNC_INIT:
          hreInit();
+         XsnsSubscribe(FUNC_EVERY_50_MSECOND);
          break;
       case FUNC_EVERY_50_MSECOND:
          hreEvery50ms();
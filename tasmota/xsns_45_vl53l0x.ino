@@ -121,6 +121,7 @@ bool Xsns45(byte function)
 
   if (FUNC_INIT == function) {
     Vl53l0Detect();
+    XsnsSubscribe(FUNC_EVERY_250_MSECOND);
   }
   else if (vl53l0x_ready) {
     switch (function) {
@@ -542,6 +542,7 @@ bool Xsns48(uint8_t function)
 #endif  // USE_WEBSERVER
     case FUNC_INIT:
       ChirpDetect();         // We can call CHIRPSCAN later to re-detect
+      XsnsSubscribe(FUNC_EVERY_100_MSECOND);
       break;
   }
   return result;
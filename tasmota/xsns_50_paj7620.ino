@@ -430,6 +430,7 @@ bool Xsns50(uint8_t function)
 
   if (FUNC_INIT == function) {
     PAJ7620Detect();
+    XsnsSubscribe(FUNC_EVERY_100_MSECOND);
   }
   else if (PAJ7620_next_job) {
     switch (function) {
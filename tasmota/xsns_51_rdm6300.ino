@@ -161,6 +161,7 @@ bool Xsns51(byte function)
     switch (function) {
       case FUNC_INIT:
         RDM6300_Init();
+        XsnsSubscribe(FUNC_EVERY_100_MSECOND);
         break;
       case FUNC_EVERY_100_MSECOND:
         RDM6300_ScanForTag();
@@ -39,6 +39,8 @@
 #define IB_TIMEOUT_INTERVAL 30
 // does a passive scan every N seconds
 #define IB_UPDATE_TIME_INTERVAL 10
+// publishes a known beacon again when its rssi changes by more than N dB, 0 publishes every scan
+#define IB_RSSI_THRESHOLD 6
 
 TasmotaSerial *IBEACON_Serial = nullptr;
 
@@ -54,8 +56,11 @@ uint8_t hm17_debug=0;
 #define HM17_BSIZ 128
 char hm17_sbuffer[HM17_BSIZ];
 uint8_t hm17_sindex,hm17_result,hm17_scanning,hm17_connecting;
+uint8_t hm17_expect;      // buffer length at which the response is decoded next
 uint32_t hm17_lastms;
 char ib_mac[14];
+uint8_t ib_continuous;    // start the next scan as soon as one ends
+uint8_t ib_rssi_threshold=IB_RSSI_THRESHOLD;
 
 // should be in Settings
 #if 1
@@ -83,13 +88,19 @@ struct IBEACON {
 };
 
 #define MAX_IBEACONS 16
+// hash table slots, power of 2 and twice MAX_IBEACONS to keep probing short
+#define IB_TABLE_SIZE 32
+
+enum {IB_FREE,IB_USED,IB_DELETED};
 
 struct IBEACON_UID {
   char MAC[12];
-  char RSSI[4];
+  int16_t RSSI;
+  int16_t PUB_RSSI;
   uint8_t FLAGS;
   uint8_t TIME;
-} ibeacons[MAX_IBEACONS];
+} ibeacons[IB_TABLE_SIZE];
+uint8_t ib_count;
 
 
 void IBEACON_Init() {
@@ -116,7 +127,12 @@ void hm17_every_second(void) {
   if (!IBEACON_Serial) return;
 
   if (hm17_found) {
-    if (IB_UPDATE_TIME && (uptime%IB_UPDATE_TIME==0)) {
+    if (ib_continuous) {
+      // restart a scan lost by the module
+      if (hm17_cmd!=99 && !hm17_connecting && (!hm17_scanning || (millis()-hm17_lastms>IB_UPDATE_TIME_INTERVAL*1000))) {
+        hm17_sendcmd(HM17_DISI);
+      }
+    } else if (IB_UPDATE_TIME && (uptime%IB_UPDATE_TIME==0)) {
       if (hm17_cmd!=99) {
         if (hm17_flag&2) {
           ib_sendbeep();
@@ -127,15 +143,17 @@ void hm17_every_second(void) {
         }
       }
     }
-    for (uint32_t cnt=0;cnt<MAX_IBEACONS;cnt++) {
-      if (ibeacons[cnt].FLAGS) {
+    for (uint32_t cnt=0;cnt<IB_TABLE_SIZE;cnt++) {
+      if (ibeacons[cnt].FLAGS==IB_USED) {
         ibeacons[cnt].TIME++;
         if (ibeacons[cnt].TIME>IB_TIMEOUT_TIME) {
-          ibeacons[cnt].FLAGS=0;
-          ibeacon_mqtt(ibeacons[cnt].MAC,"0000");
+          ibeacons[cnt].FLAGS=IB_DELETED;
+          ib_count--;
+          ibeacon_mqtt(ibeacons[cnt].MAC,0);
         }
       }
     }
+    if (!ib_count) ibeacon_clear();
   } else {
     if (uptime%20==0) {
       hm17_sendcmd(HM17_TEST);
@@ -146,6 +164,7 @@ void hm17_every_second(void) {
 void hm17_sbclr(void) {
   memset(hm17_sbuffer,0,HM17_BSIZ);
   hm17_sindex=0;
+  hm17_expect=2;
   //IBEACON_Serial->flush();
 }
 
@@ -193,27 +212,57 @@ void hm17_sendcmd(uint8_t cmd) {
   }
 }
 
+void ibeacon_clear(void) {
+  for (uint32_t cnt=0;cnt<IB_TABLE_SIZE;cnt++) ibeacons[cnt].FLAGS=IB_FREE;
+  ib_count=0;
+}
+
+uint32_t ibeacon_hash(const char *mac) {
+  uint32_t hash=2166136261;
+  for (uint32_t cnt=0;cnt<12;cnt++) {
+    hash=(hash^(uint8_t)mac[cnt])*16777619;
+  }
+  return hash&(IB_TABLE_SIZE-1);
+}
+
+// returns 1 if the beacon entered or its rssi changed by more than the threshold
 uint32_t ibeacon_add(struct IBEACON *ib) {
   // keyfob starts with ffff, ibeacon has valid facid
   if (!strncmp(ib->MAC,"FFFF",4) || strncmp(ib->FACID,"00000000",8)) {
-    for (uint32_t cnt=0;cnt<MAX_IBEACONS;cnt++) {
-      if (ibeacons[cnt].FLAGS) {
-        if (!strncmp(ibeacons[cnt].MAC,ib->MAC,12)) {
+    char s_rssi[6];
+    memcpy(s_rssi,ib->RSSI,4);
+    s_rssi[4]=0;
+    int16_t rssi=atoi(s_rssi);
+    // linear probing, deleted slots are skipped on lookup and reused on insert
+    uint32_t slot=ibeacon_hash(ib->MAC);
+    int32_t free_slot=-1;
+    for (uint32_t cnt=0;cnt<IB_TABLE_SIZE;cnt++,slot=(slot+1)&(IB_TABLE_SIZE-1)) {
+      struct IBEACON_UID *entry=&ibeacons[slot];
+      if (entry->FLAGS==IB_USED) {
+        if (!strncmp(entry->MAC,ib->MAC,12)) {
           // exists
-          memcpy(ibeacons[cnt].RSSI,ib->RSSI,4);
-          ibeacons[cnt].TIME=0;
-          return 1;
+          entry->RSSI=rssi;
+          entry->TIME=0;
+          if (!ib_rssi_threshold || (abs(rssi-entry->PUB_RSSI)>ib_rssi_threshold)) {
+            entry->PUB_RSSI=rssi;
+            return 1;
+          }
+          return 0;
         }
+      } else {
+        if (free_slot<0) free_slot=slot;
+        if (entry->FLAGS==IB_FREE) break;
       }
     }
-    for (uint32_t cnt=0;cnt<MAX_IBEACONS;cnt++) {
-      if (!ibeacons[cnt].FLAGS) {
-        memcpy(ibeacons[cnt].MAC,ib->MAC,12);
-        memcpy(ibeacons[cnt].RSSI,ib->RSSI,4);
-        ibeacons[cnt].FLAGS=1;
-        ibeacons[cnt].TIME=0;
-        return 1;
-      }
+    if (free_slot>=0 && ib_count<MAX_IBEACONS) {
+      struct IBEACON_UID *entry=&ibeacons[free_slot];
+      memcpy(entry->MAC,ib->MAC,12);
+      entry->RSSI=rssi;
+      entry->PUB_RSSI=rssi;
+      entry->FLAGS=IB_USED;
+      entry->TIME=0;
+      ib_count++;
+      return 1;
     }
   }
   return 0;
@@ -221,6 +270,12 @@ uint32_t ibeacon_add(struct IBEACON *ib) {
 
 void hm17_decode(void) {
   struct IBEACON ib;
+  // all responses but the AT test start with an 8 character prefix, OK+CONN is decoded at 7
+  uint8_t prefix=(hm17_cmd==HM17_CON)?7:8;
+  if (hm17_cmd!=HM17_TEST && hm17_sindex<prefix) {
+    hm17_expect=prefix;
+    return;
+  }
   switch (hm17_cmd) {
     case HM17_TEST:
       if (!strncmp(hm17_sbuffer,"OK",2)) {
@@ -346,6 +401,13 @@ void hm17_decode(void) {
         if (hm17_debug) AddLog_P2(LOG_LEVEL_INFO, PSTR("DISCE OK"));
 #endif
         hm17_scanning=0;
+        if (ib_continuous && hm17_cmd==HM17_DISI) {
+          if (hm17_flag&2) {
+            ib_sendbeep();
+          } else {
+            hm17_sendcmd(HM17_DISI);
+          }
+        }
         break;
       }
       if (!strncmp(hm17_sbuffer,"OK+NAME:",8)) {
@@ -367,7 +429,9 @@ void hm17_decode(void) {
           goto hm17_v110;
 #endif
         } else {
-          if (hm17_sindex==20) {
+          if (hm17_sindex<20) {
+            hm17_expect=20;
+          } else {
             hm17_result=HM17_SUCESS;
 #ifdef IBEACON_DEBUG
             if (hm17_debug) {
@@ -383,7 +447,9 @@ void hm17_decode(void) {
       if (!strncmp(hm17_sbuffer,"OK+DISC:",8)) {
 hm17_v110:
         if (hm17_cmd==HM17_DISI) {
-          if (hm17_sindex==78) {
+          if (hm17_sindex<78) {
+            hm17_expect=78;
+          } else {
 #ifdef IBEACON_DEBUG
             if (hm17_debug) {
               AddLog_P2(LOG_LEVEL_INFO, PSTR("DISC: OK"));
@@ -400,7 +466,10 @@ hm17_v110:
             memcpy(ib.RSSI,&hm17_sbuffer[8+8+1+32+1+4+4+2+1+12+1],4);
 
             if (ibeacon_add(&ib)) {
-              ibeacon_mqtt(ib.MAC,ib.RSSI);
+              char s_rssi[6];
+              memcpy(s_rssi,ib.RSSI,4);
+              s_rssi[4]=0;
+              ibeacon_mqtt(ib.MAC,atoi(s_rssi));
             }
             hm17_sbclr();
             hm17_result=1;
@@ -423,13 +492,16 @@ uint32_t difftime=millis()-hm17_lastms;
 
   while (IBEACON_Serial->available()) {
     hm17_lastms=millis();
-    // shift in
-    if (hm17_sindex<HM17_BSIZ) {
+    // shift in, decode only once enough characters of the expected response arrived
+    if (hm17_sindex<HM17_BSIZ-1) {
       hm17_sbuffer[hm17_sindex]=IBEACON_Serial->read();
       hm17_sindex++;
-      hm17_decode();
+      if (hm17_sindex>=hm17_expect) {
+        hm17_expect=hm17_sindex+1;
+        hm17_decode();
+      }
     } else {
-      hm17_sindex=0;
+      hm17_sbclr();
       break;
     }
   }
@@ -449,14 +521,13 @@ const char HTTP_IBEACON[] PROGMEM =
 
 void IBEACON_Show(void) {
 char mac[14];
-char rssi[6];
+char rssi[8];
 
-  for (uint32_t cnt=0;cnt<MAX_IBEACONS;cnt++) {
-    if (ibeacons[cnt].FLAGS) {
+  for (uint32_t cnt=0;cnt<IB_TABLE_SIZE;cnt++) {
+    if (ibeacons[cnt].FLAGS==IB_USED) {
       memcpy(mac,ibeacons[cnt].MAC,12);
       mac[12]=0;
-      memcpy(rssi,ibeacons[cnt].RSSI,4);
-      rssi[4]=0;
+      snprintf_P(rssi,sizeof(rssi),PSTR("%d"),ibeacons[cnt].RSSI);
       WSContentSend_PD(HTTP_IBEACON,mac,rssi);
     }
   }
@@ -473,6 +544,8 @@ must be given only once (stored in module)
 
 uT = sets update interval in seconds (scan tags every T seonds) default=10
 tT = sets timeout interval in seconds (after T seconds if tag is not detected send rssi=0) default=30
+mM = sets continuous scan mode 0,1 (start the next scan as soon as one ends) default=0
+rR = sets rssi threshold in dB (only publish a known tag when rssi changes by more than R, 0 = every scan) default=6
 sending IBEACON_FFFF3D1B1E9D_RSSI with data 99 causes tag to beep (ID to be replaced with actual ID)
 
 *** debugging
@@ -512,8 +585,16 @@ bool xsns52_cmd(void) {
         cp++;
         if (*cp) IB_TIMEOUT_TIME=atoi(cp);
         Response_P(S_JSON_IBEACON, XSNS_52,"lintv",IB_TIMEOUT_TIME);
+      } else if (*cp=='m') {
+        cp++;
+        if (*cp) ib_continuous=atoi(cp)&1;
+        Response_P(S_JSON_IBEACON, XSNS_52,"cscan",ib_continuous);
+      } else if (*cp=='r') {
+        cp++;
+        if (*cp) ib_rssi_threshold=atoi(cp);
+        Response_P(S_JSON_IBEACON, XSNS_52,"rssith",ib_rssi_threshold);
       } else if (*cp=='c') {
-        for (uint32_t cnt=0;cnt<MAX_IBEACONS;cnt++) ibeacons[cnt].FLAGS=0;
+        ibeacon_clear();
         Response_P(S_JSON_IBEACON1, XSNS_52,"clr list","");
       }
 #ifdef IBEACON_DEBUG
@@ -560,15 +641,11 @@ void ib_sendbeep(void) {
   hm17_sendcmd(HM17_CON);
 }
 
-void ibeacon_mqtt(const char *mac,const char *rssi) {
+void ibeacon_mqtt(const char *mac,int16_t rssi) {
   char s_mac[14];
-  char s_rssi[6];
   memcpy(s_mac,mac,12);
   s_mac[12]=0;
-  memcpy(s_rssi,rssi,4);
-  s_rssi[4]=0;
-  int16_t n_rssi=atoi(s_rssi);
-  ResponseTime_P(PSTR(",\"" D_CMND_IBEACON "_%s\":{\"RSSI\":%d}}"),s_mac,n_rssi);
+  ResponseTime_P(PSTR(",\"" D_CMND_IBEACON "_%s\":{\"RSSI\":%d}}"),s_mac,rssi);
   MqttPublishTeleSensor();
 }
 
@@ -584,6 +661,7 @@ bool Xsns52(byte function)
     switch (function) {
       case FUNC_INIT:
         IBEACON_Init();
+        XsnsSubscribe(FUNC_LOOP);
         break;
       case FUNC_LOOP:
         IBEACON_loop();
@@ -36,6 +36,12 @@
 //#define DEBUG_CNT_LED1 2
 //#define DEBUG_CNT_LED1 2
 
+// combine all immediate mqtt values of one sml telegram or obis line into a single publish
+//#define SML_IMMEDIATE_COMBINE
+
+// inject recorded telegrams into the meters to measure decode time and lost bytes at a baudrate
+//#define SML_BENCH
+
 // use analog optical counter sensor with AD Converter ADS1115 (not yet functional)
 //#define ANALOG_OPTO_SENSOR
 // fototransistor with pullup at A0, A1 of ADS1115 A3 and +3.3V
@@ -51,6 +57,9 @@
 
 #define TMSBSIZ 256
 
+// esp32 hardware pulse counter glitch filter in ns (max 12.8 us)
+#define SML_PCNT_FILTER 12800
+
 // addresses a bug in meter DWS74
 //#define DWS74_BUG
 
@@ -469,6 +478,66 @@ TasmotaSerial *meter_ss[MAX_METERS];
 #define SML_BSIZ 48
 uint8_t smltbuf[MAX_METERS][SML_BSIZ];
 
+// telegram buffers of sml and obis meters, decoded once per telegram or obis line
+// instead of shifting smltbuf and decoding on every received byte
+#ifndef SML_FRAME_BSIZ
+#define SML_FRAME_BSIZ 512
+#endif
+uint8_t *meter_frame[MAX_METERS];
+uint16_t meter_fpos[MAX_METERS];
+// bitmap of first bytes of the meter descriptors, other telegram positions are skipped
+uint32_t meter_first[MAX_METERS][8];
+
+// descriptors of sml and obis meters compiled at init to binary patterns
+struct SML_DESC {
+  const char *value;      // descriptor text after @ for immediate mqtt
+  uint8_t *pattern;
+  double fac;             // scaling factor
+  uint8_t meter;
+  uint8_t vindex;         // index in meter_vars
+  uint8_t plen;           // pattern length
+  uint8_t prec;           // decimals, bit 4 immediate mqtt
+  char sval;              // 0 numeric value else string value terminated by this char
+};
+struct SML_DESC *sml_desc;
+uint16_t sml_desc_count;
+
+#ifdef SML_BENCH
+// recorded telegrams injected in place of the serial input at the byte rate of a baudrate
+struct SML_BENCH {
+  uint8_t *telegram[MAX_METERS];
+  uint16_t len[MAX_METERS];       // telegram length, 0 = meter not benched
+  uint16_t pos[MAX_METERS];       // next telegram byte
+  uint32_t baud[MAX_METERS];
+  uint32_t bytes[MAX_METERS];     // bytes due so far, injected or lost
+  uint32_t lost[MAX_METERS];      // bytes beyond the receive buffer when the loop was late
+  uint32_t telegrams[MAX_METERS];
+  uint32_t cpu[MAX_METERS];       // us in sml_shift_in()
+  uint32_t latency[MAX_METERS];   // us from last telegram byte due until decoded, total and max
+  uint32_t latency_max[MAX_METERS];
+  uint32_t start;                 // micros() of the start
+  uint32_t start_ms;
+  uint32_t duration;              // ms
+  bool active;
+} SmlBench;
+#endif  // SML_BENCH
+
+enum SmlDecodeModes { SML_DECODE_ALL, SML_DECODE_CALC };
+uint8_t sml_decode_mode;
+
+// immediate mqtt json name and decimals per var, parsed once from its meter line
+struct SML_IMMEDIATE {
+  const char *line;       // meter line text the entry was parsed from
+  uint8_t jpos;           // offset of json name in line
+  uint8_t jlen;           // json name length or 0 if not published
+  uint8_t dp;             // decimals, bit 4 immediate mqtt
+} sml_immediate[SML_MAX_VARS];
+char sml_imm_topic[TOPSZ];  // resolved tele sensor topic
+#ifdef SML_IMMEDIATE_COMBINE
+bool sml_imm_combine;       // collect values of telegram in mqtt_data
+int8_t sml_imm_meter;       // meter of open json object or -1 if none
+#endif
+
 // meter nr as string
 #define METER_ID_SIZE 24
 char meter_id[MAX_METERS][METER_ID_SIZE];
@@ -550,226 +619,20 @@ double sml_median(struct SML_MEDIAN_FILTER* mf, double in) {
 #endif
 
 #ifdef ANALOG_OPTO_SENSOR
-// sensor over ADS1115 with i2c Bus
+// sensor over ADS1115 with i2c Bus, sampled in the background by the ADS1115 driver
+#if !defined(USE_I2C) || !defined(USE_ADS1115)
+#error "ANALOG_OPTO_SENSOR needs defines USE_I2C and USE_ADS1115"
+#endif
 uint8_t ads1115_up;
 
-// ads1115 driver
-#define SAMPLE_BIT (0x8000)
-
-#define ADS1115_COMP_QUEUE_SHIFT 0
-#define ADS1115_COMP_LATCH_SHIFT 2
-#define ADS1115_COMP_POLARITY_SHIFT 3
-#define ADS1115_COMP_MODE_SHIFT 4
-#define ADS1115_DATA_RATE_SHIFT 5
-#define ADS1115_MODE_SHIFT 8
-#define ADS1115_PGA_SHIFT 9
-#define ADS1115_MUX_SHIFT 12
-
-enum ads1115_comp_queue {
-	ADS1115_COMP_QUEUE_AFTER_ONE = 0,
-	ADS1115_COMP_QUEUE_AFTER_TWO = 0x1 << ADS1115_COMP_QUEUE_SHIFT,
-	ADS1115_COMP_QUEUE_AFTER_FOUR = 0x2 << ADS1115_COMP_QUEUE_SHIFT,
-	ADS1115_COMP_QUEUE_DISABLE = 0x3 << ADS1115_COMP_QUEUE_SHIFT,
-	ADS1115_COMP_QUEUE_MASK = 0x3 << ADS1115_COMP_QUEUE_SHIFT,
-};
-
-enum ads1115_comp_latch {
-	ADS1115_COMP_LATCH_NO = 0,
-	ADS1115_COMP_LATCH_YES = 1 << ADS1115_COMP_LATCH_SHIFT,
-	ADS1115_COMP_LATCH_MASK = 1 << ADS1115_COMP_LATCH_SHIFT,
-};
-
-enum ads1115_comp_polarity {
-	ADS1115_COMP_POLARITY_ACTIVE_LOW = 0,
-	ADS1115_COMP_POLARITY_ACTIVE_HIGH = 1 << ADS1115_COMP_POLARITY_SHIFT,
-	ADS1115_COMP_POLARITY_MASK = 1 << ADS1115_COMP_POLARITY_SHIFT,
-};
-
-enum ads1115_comp_mode {
-	ADS1115_COMP_MODE_WINDOW = 0,
-	ADS1115_COMP_MODE_HYSTERESIS = 1 << ADS1115_COMP_MODE_SHIFT,
-	ADS1115_COMP_MODE_MASK = 1 << ADS1115_COMP_MODE_SHIFT,
-};
-
-enum ads1115_data_rate {
-	ADS1115_DATA_RATE_8_SPS = 0,
-	ADS1115_DATA_RATE_16_SPS = 0x1 << ADS1115_DATA_RATE_SHIFT,
-	ADS1115_DATA_RATE_32_SPS = 0x2 << ADS1115_DATA_RATE_SHIFT,
-	ADS1115_DATA_RATE_64_SPS = 0x3 << ADS1115_DATA_RATE_SHIFT,
-	ADS1115_DATA_RATE_128_SPS = 0x4 << ADS1115_DATA_RATE_SHIFT,
-	ADS1115_DATA_RATE_250_SPS = 0x5 << ADS1115_DATA_RATE_SHIFT,
-	ADS1115_DATA_RATE_475_SPS = 0x6 << ADS1115_DATA_RATE_SHIFT,
-	ADS1115_DATA_RATE_860_SPS = 0x7 << ADS1115_DATA_RATE_SHIFT,
-	ADS1115_DATA_RATE_MASK = 0x7 << ADS1115_DATA_RATE_SHIFT,
-};
-
-enum ads1115_mode {
-	ADS1115_MODE_CONTINUOUS = 0,
-	ADS1115_MODE_SINGLE_SHOT = 1 << ADS1115_MODE_SHIFT,
-	ADS1115_MODE_MASK = 1 << ADS1115_MODE_SHIFT,
-};
-
-enum ads1115_pga {
-	ADS1115_PGA_TWO_THIRDS = 0, //±6.144 V
-	ADS1115_PGA_ONE = 0x1 << ADS1115_PGA_SHIFT, //±4.096 V
-	ADS1115_PGA_TWO = 0x2 << ADS1115_PGA_SHIFT, //±2.048 V
-	ADS1115_PGA_FOUR = 0x3 << ADS1115_PGA_SHIFT, //±1.024 V
-	ADS1115_PGA_EIGHT = 0x4 << ADS1115_PGA_SHIFT, //±0.512 V
-	ADS1115_PGA_SIXTEEN = 0x5 << ADS1115_PGA_SHIFT, //±0.256 V
-	ADS1115_PGA_MASK = 0x7 << ADS1115_PGA_SHIFT,
-};
-
-
-enum ads1115_mux {
-	ADS1115_MUX_DIFF_AIN0_AIN1 = 0,
-	ADS1115_MUX_DIFF_AIN0_AIN3 = 0x1 << ADS1115_MUX_SHIFT,
-	ADS1115_MUX_DIFF_AIN1_AIN3 = 0x2 << ADS1115_MUX_SHIFT,
-	ADS1115_MUX_DIFF_AIN2_AIN3 = 0x3 << ADS1115_MUX_SHIFT,
-	ADS1115_MUX_GND_AIN0 = 0x4 << ADS1115_MUX_SHIFT,
-	ADS1115_MUX_GND_AIN1 = 0x5 << ADS1115_MUX_SHIFT,
-	ADS1115_MUX_GND_AIN2 = 0x6 << ADS1115_MUX_SHIFT,
-	ADS1115_MUX_GND_AIN3 = 0x7 << ADS1115_MUX_SHIFT,
-	ADS1115_MUX_MASK = 0x7 << ADS1115_MUX_SHIFT,
-};
-
-class ADS1115 {
-public:
-	ADS1115(uint8_t address = 0x48);
-
-	void begin();
-	uint8_t trigger_sample();
-	uint8_t reset();
-	bool is_sample_in_progress();
-	int16_t read_sample();
-	float sample_to_float(int16_t val);
-	float read_sample_float();
-
-	void set_comp_queue(enum ads1115_comp_queue val) { set_config(val, ADS1115_COMP_QUEUE_MASK); }
-	void set_comp_latching(enum ads1115_comp_latch val) { set_config(val, ADS1115_COMP_LATCH_MASK); }
-	void set_comp_polarity(enum ads1115_comp_polarity val) { set_config(val, ADS1115_COMP_POLARITY_MASK); }
-	void set_comp_mode(enum ads1115_comp_mode val) { set_config(val, ADS1115_COMP_MODE_MASK); }
-	void set_data_rate(enum ads1115_data_rate val) { set_config(val, ADS1115_DATA_RATE_MASK); }
-	void set_mode(enum ads1115_mode val) { set_config(val, ADS1115_MODE_MASK); }
-	void set_pga(enum ads1115_pga val) { set_config(val, ADS1115_PGA_MASK); m_voltage_range = val >> ADS1115_PGA_SHIFT; }
-	void set_mux(enum ads1115_mux val) { set_config(val, ADS1115_MUX_MASK); }
-
-private:
-	void set_config(uint16_t val, uint16_t mask) {
-		m_config = (m_config & ~mask) | val;
-	}
-
-	uint8_t write_register(uint8_t reg, uint16_t val);
-	uint16_t read_register(uint8_t reg);
-
-	uint8_t m_address;
-	uint16_t m_config;
-	int m_voltage_range;
-};
-
-
-enum ads1115_register {
-	ADS1115_REGISTER_CONVERSION = 0,
-	ADS1115_REGISTER_CONFIG = 1,
-	ADS1115_REGISTER_LOW_THRESH = 2,
-	ADS1115_REGISTER_HIGH_THRESH = 3,
-};
-
-#define FACTOR 32768.0
-static float ranges[] = { 6.144 / FACTOR, 4.096 / FACTOR, 2.048 / FACTOR, 1.024 / FACTOR, 0.512 / FACTOR, 0.256 / FACTOR};
-
-ADS1115::ADS1115(uint8_t address)
-{
-        m_address = address;
-        m_config = ADS1115_COMP_QUEUE_AFTER_ONE |
-                   ADS1115_COMP_LATCH_NO |
-                   ADS1115_COMP_POLARITY_ACTIVE_LOW |
-                   ADS1115_COMP_MODE_WINDOW |
-                   ADS1115_DATA_RATE_128_SPS |
-                   ADS1115_MODE_SINGLE_SHOT |
-                   ADS1115_MUX_GND_AIN0;
-        set_pga(ADS1115_PGA_ONE);
-}
-
-uint8_t ADS1115::write_register(uint8_t reg, uint16_t val)
-{
-        Wire.beginTransmission(m_address);
-        Wire.write(reg);
-        Wire.write(val>>8);
-        Wire.write(val & 0xFF);
-        return Wire.endTransmission();
-}
-
-uint16_t ADS1115::read_register(uint8_t reg)
-{
-        Wire.beginTransmission(m_address);
-        Wire.write(reg);
-        Wire.endTransmission();
-
-        uint8_t result = Wire.requestFrom((int)m_address, 2, 1);
-        if (result != 2) {
-          return 0;
-        }
-
-        uint16_t val;
-
-        val = Wire.read() << 8;
-        val |= Wire.read();
-        return val;
-}
-
-void ADS1115::begin()
-{
-        Wire.begin();
-}
-
-uint8_t ADS1115::trigger_sample()
-{
-        return write_register(ADS1115_REGISTER_CONFIG, m_config | SAMPLE_BIT);
-}
-
-uint8_t ADS1115::reset()
-{
-	Wire.beginTransmission(0);
-	Wire.write(0x6);
-	return Wire.endTransmission();
-}
-
-bool ADS1115::is_sample_in_progress()
-{
-	uint16_t val = read_register(ADS1115_REGISTER_CONFIG);
-	return (val & SAMPLE_BIT) == 0;
-}
-
-int16_t ADS1115::read_sample()
-{
-        return read_register(ADS1115_REGISTER_CONVERSION);
-}
-
-float ADS1115::sample_to_float(int16_t val)
-{
-	return val * ranges[m_voltage_range];
-}
-
-float ADS1115::read_sample_float()
-{
-	return sample_to_float(read_sample());
-}
-
-ADS1115 adc;
-
 void ADS1115_init(void) {
 
   ads1115_up=0;
   if (!i2c_flg) return;
 
-  adc.begin();
-  adc.set_data_rate(ADS1115_DATA_RATE_128_SPS);
-  adc.set_mode(ADS1115_MODE_CONTINUOUS);
-  adc.set_mux(ADS1115_MUX_DIFF_AIN0_AIN3);
-  adc.set_pga(ADS1115_PGA_TWO);
-
-  int16_t val = adc.read_sample();
-  ads1115_up=1;
+  // first ADS1115 at 0x48, channel 0 measures AIN0 against AIN3
+  Ads1115SetInput(0, 0, ADS1115_REG_CONFIG_MUX_DIFF_0_3 | ADS1115_REG_CONFIG_PGA_2_048V);
+  ads1115_up=Ads1115.found[0];
 }
 
 #endif
@@ -1174,22 +1037,124 @@ uint8_t ebus_CalculateCRC( uint8_t *Data, uint16_t DataLen ) {
 }
 
 void sml_empty_receiver(uint32_t meters) {
+  if (!meter_ss[meters]) return;
   while (meter_ss[meters]->available()) {
     meter_ss[meters]->read();
   }
 }
 
 
-void sml_shift_in(uint32_t meters,uint32_t shard) {
+// get value of a matching compiled descriptor, cp points behind the pattern
+void sml_decode_desc(struct SML_DESC *desc, uint8_t *cp) {
+  uint32_t mindex=desc->meter;
+#ifdef ED300L
+  g_mindex=mindex;
+#endif
+  if (desc->sval) {
+    if (meter_desc_p[mindex].type=='o') {
+      for (uint8_t p=0;p<METER_ID_SIZE;p++) {
+        if (*cp==desc->sval) {
+          meter_id[mindex][p]=0;
+          break;
+        }
+        meter_id[mindex][p]=*cp++;
+      }
+    } else {
+      sml_getvalue(cp,mindex);
+    }
+    return;
+  }
+
+  double dval;
+  if (meter_desc_p[mindex].type=='o') {
+    dval=CharToDouble((char*)cp);
+  } else {
+    dval=sml_getvalue(cp,mindex);
+  }
+#ifdef USE_SML_MEDIAN_FILTER
+  if (meter_desc_p[mindex].flag&16) {
+    dval=sml_median(&sml_mf[desc->vindex],dval);
+  }
+#endif
+  meter_vars[desc->vindex]=dval/desc->fac;
+  if (desc->prec&0x10) {
+    SML_Immediate_MQTT(desc->value,desc->vindex,mindex);
+  }
+}
+
+// decode all positions of a telegram buffer starting with a descriptor byte, then the calculated entries
+void sml_decode_frame(uint32_t meters, uint32_t len) {
+  uint8_t *fp=meter_frame[meters];
+#ifdef SML_IMMEDIATE_COMBINE
+  sml_imm_combine=true;
+#endif
+  for (uint32_t pos=0; pos<len; pos++) {
+    if (!(meter_first[meters][fp[pos]>>5] & (1<<(fp[pos]&31)))) continue;
+    for (uint32_t cnt=0; cnt<sml_desc_count; cnt++) {
+      struct SML_DESC *desc=&sml_desc[cnt];
+      if (desc->meter!=meters || desc->pattern[0]!=fp[pos]) continue;
+      if (!memcmp(desc->pattern,&fp[pos],desc->plen)) {
+        sml_decode_desc(desc,&fp[pos+desc->plen]);
+      }
+    }
+  }
+  sml_decode_mode=SML_DECODE_CALC;
+  SML_Decode(meters);
+  sml_decode_mode=SML_DECODE_ALL;
+#ifdef SML_IMMEDIATE_COMBINE
+  SML_Immediate_Flush();
+  sml_imm_combine=false;
+#endif
+}
+
+void sml_frame_in(uint32_t meters,uint8_t iob) {
+  uint8_t *fp=meter_frame[meters];
+  uint32_t pos=meter_fpos[meters];
+  bool complete=false;
+
+  if (meter_desc_p[meters].type=='o') {
+    iob&=0x7f;
+    fp[pos++]=iob;
+    complete=(iob=='\n');
+  } else {
+    fp[pos++]=iob;
+    // sml transport escape 1b1b1b1b followed by 01010101 at start and 1a,fill,crc,crc at end
+    if (pos>=8 && fp[pos-8]==0x1b && fp[pos-7]==0x1b && fp[pos-6]==0x1b && fp[pos-5]==0x1b) {
+      if (fp[pos-4]==0x01 && fp[pos-3]==0x01 && fp[pos-2]==0x01 && fp[pos-1]==0x01) {
+        // start of telegram, drop anything received before
+        memmove(fp,&fp[pos-8],8);
+        pos=8;
+      } else if (fp[pos-4]==0x1a) {
+        complete=true;
+      }
+    }
+  }
+
+  if (complete) {
+    memset(&fp[pos],0,SML_BSIZ);
+    sml_decode_frame(meters,pos);
+    pos=0;
+  } else if (pos>=SML_FRAME_BSIZ) {
+    // telegram too long, decode positions with a full window and keep that window
+    sml_decode_frame(meters,pos-SML_BSIZ);
+    memmove(fp,&fp[pos-SML_BSIZ],SML_BSIZ);
+    pos=SML_BSIZ;
+  }
+  meter_fpos[meters]=pos;
+}
+
+void sml_shift_in(uint32_t meters,uint8_t iob) {
   uint32_t count;
+  if (meter_frame[meters]) {
+    sml_frame_in(meters,iob);
+    return;
+  }
   if (meter_desc_p[meters].type!='e' && meter_desc_p[meters].type!='m' && meter_desc_p[meters].type!='M' && meter_desc_p[meters].type!='p') {
     // shift in
     for (count=0; count<SML_BSIZ-1; count++) {
       smltbuf[meters][count]=smltbuf[meters][count+1];
     }
   }
-  uint8_t iob=(uint8_t)meter_ss[meters]->read();
-
   if (meter_desc_p[meters].type=='o') {
     smltbuf[meters][SML_BSIZ-1]=iob&0x7f;
   } else if (meter_desc_p[meters].type=='s') {
@@ -1250,9 +1215,12 @@ uint32_t meters;
     for (meters=0; meters<meters_used; meters++) {
       if (meter_desc_p[meters].type!='c') {
         // poll for serial input
+#ifdef SML_BENCH
+        if (SmlBench.active && SmlBench.len[meters]) continue;
+#endif
         if (!meter_ss[meters]) continue;
         while (meter_ss[meters]->available()) {
-          sml_shift_in(meters,0);
+          sml_shift_in(meters,meter_ss[meters]->read());
         }
       }
     }
@@ -1289,8 +1257,8 @@ void SML_Decode(uint8_t index) {
       // calculated entry, check syntax
       mp++;
       // do math m 1+2+3
-      if (*mp=='m' && !sb_counter) {
-        // only every 256 th byte
+      if (*mp=='m' && (sml_decode_mode==SML_DECODE_CALC || (sml_decode_mode==SML_DECODE_ALL && !sb_counter))) {
+        // only every 256 th byte or once per decoded telegram
         // else it would be calculated every single serial byte
         mp++;
         while (*mp==' ') mp++;
@@ -1379,7 +1347,7 @@ void SML_Decode(uint8_t index) {
         if (mp) mp++;
         continue;
       }
-    } else {
+    } else if (sml_decode_mode!=SML_DECODE_CALC) {
       // compare value
       uint8_t found=1;
       uint32_t ebus_dval=99;
@@ -1591,41 +1559,69 @@ nextsect:
 }
 
 //"1-0:1.8.0*255(@1," D_TPWRIN ",kWh," DJ_TPWRIN ",4|"
-void SML_Immediate_MQTT(const char *mp,uint8_t index,uint8_t mindex) {
-  char tpowstr[32];
-  char jname[24];
+void SML_Immediate_Publish(void) {
+  if (!sml_imm_topic[0]) {
+    // topic, fulltopic and prefix changes restart, so resolve once
+    MqttPrefixTopic_P(sml_imm_topic,TELE,PSTR(D_RSLT_SENSOR));
+  }
+  MqttPublish(sml_imm_topic,Settings.flag.mqtt_sensor_retain);  // CMND_SENSORRETAIN
+  XdrvRulesProcess();
+}
 
-  // we must skip sf,webname,unit
-  char *cp=strchr(mp,',');
-  if (cp) {
-    cp++;
-    // wn
-    cp=strchr(cp,',');
+#ifdef SML_IMMEDIATE_COMBINE
+void SML_Immediate_Flush(void) {
+  if (sml_imm_meter<0) return;
+  ResponseJsonEndEnd();
+  SML_Immediate_Publish();
+  sml_imm_meter=-1;
+}
+#endif
+
+void SML_Immediate_MQTT(const char *mp,uint8_t index,uint8_t mindex) {
+  struct SML_IMMEDIATE *imm=&sml_immediate[index];
+  if (imm->line!=mp) {
+    // we must skip sf,webname,unit then json name and decimals follow
+    imm->line=mp;
+    imm->jlen=0;
+    const char *cp=strchr(mp,',');
+    if (cp) cp=strchr(cp+1,',');
+    if (cp) cp=strchr(cp+1,',');
     if (cp) {
       cp++;
-      // unit
-      cp=strchr(cp,',');
-      if (cp) {
-        cp++;
-        // json mqtt
-        for (uint8_t count=0;count<sizeof(jname);count++) {
-          if (*cp==',') {
-            jname[count]=0;
-            break;
-          }
-          jname[count]=*cp++;
-        }
-        cp++;
-        uint8_t dp=atoi(cp);
-        if (dp&0x10) {
-          // immediate mqtt
-          dtostrfd(meter_vars[index],dp&0xf,tpowstr);
-          ResponseTime_P(PSTR(",\"%s\":{\"%s\":%s}}"),meter_desc_p[mindex].prefix,jname,tpowstr);
-          MqttPublishTeleSensor();
-        }
+      const char *ep=strchr(cp,',');
+      if (ep && ep>cp && ep-cp<24) {
+        imm->jpos=cp-mp;
+        imm->jlen=ep-cp;
+        imm->dp=atoi(ep+1);
       }
     }
   }
+  if (!imm->jlen || !(imm->dp&0x10)) return;
+
+  // immediate mqtt
+  char tpowstr[32];
+  char jname[24];
+  memcpy(jname,imm->line+imm->jpos,imm->jlen);
+  jname[imm->jlen]=0;
+  dtostrfd(meter_vars[index],imm->dp&0xf,tpowstr);
+#ifdef SML_IMMEDIATE_COMBINE
+  if (sml_imm_combine) {
+    if (sml_imm_meter>=0 && strlen(mqtt_data)>sizeof(mqtt_data)-128) {
+      SML_Immediate_Flush();
+    }
+    if (sml_imm_meter<0) {
+      ResponseTime_P(PSTR(",\"%s\":{\"%s\":%s"),meter_desc_p[mindex].prefix,jname,tpowstr);
+    } else if (sml_imm_meter!=mindex) {
+      ResponseAppend_P(PSTR("},\"%s\":{\"%s\":%s"),meter_desc_p[mindex].prefix,jname,tpowstr);
+    } else {
+      ResponseAppend_P(PSTR(",\"%s\":%s"),jname,tpowstr);
+    }
+    sml_imm_meter=mindex;
+    return;
+  }
+#endif
+  ResponseTime_P(PSTR(",\"%s\":{\"%s\":%s}}"),meter_desc_p[mindex].prefix,jname,tpowstr);
+  SML_Immediate_Publish();
 }
 
 // web + json interface
@@ -1785,6 +1781,9 @@ struct SML_COUNTER {
   uint32_t sml_cnt_last_ts;
   uint32_t sml_counter_ltime;
   uint16_t sml_debounce;
+#ifdef ESP32
+  uint8_t sml_pcnt;                         // Hardware pulse counter unit +1 or 0 for interrupt counting
+#endif
 
 #ifdef ANALOG_OPTO_SENSOR
   int16_t ana_curr;
@@ -1917,9 +1916,23 @@ void SML_Init(void) {
   for (uint32_t cnt=0;cnt<SML_MAX_VARS;cnt++) {
     meter_vars[cnt]=0;
   }
+  memset(sml_immediate,0,sizeof(sml_immediate));
+#ifdef SML_IMMEDIATE_COMBINE
+  sml_imm_combine=false;
+  sml_imm_meter=-1;
+#endif
 
   for (uint32_t cnt=0;cnt<MAX_METERS;cnt++) {
     meter_spos[cnt]=0;
+    if (meter_frame[cnt]) {
+      free(meter_frame[cnt]);
+      meter_frame[cnt]=0;
+    }
+  }
+  if (sml_desc) {
+    free(sml_desc);
+    sml_desc=0;
+    sml_desc_count=0;
   }
 
 #ifdef USE_SCRIPT
@@ -2114,6 +2127,12 @@ init10:
   for (byte i = 0; i < MAX_COUNTERS; i++) {
       RtcSettings.pulse_counter[i]=Settings.pulse_counter[i];
       sml_counters[i].sml_cnt_last_ts=millis();
+#ifdef ESP32
+      if (sml_counters[i].sml_pcnt) {
+        PcntDetach(sml_counters[i].sml_pcnt-1);
+        sml_counters[i].sml_pcnt=0;
+      }
+#endif
   }
   uint32_t uart_index=2;
   for (uint8_t meters=0; meters<meters_used; meters++) {
@@ -2134,10 +2153,18 @@ init10:
           }
           // check for irq mode
           if (meter_desc_p[meters].params<=0) {
-            // init irq mode
-            attachInterrupt(meter_desc_p[meters].srcpin, counter_callbacks[cindex], CHANGE);
             sml_counters[cindex].sml_cnt_old_state=meters;
             sml_counters[cindex].sml_debounce=-meter_desc_p[meters].params;
+#ifdef ESP32
+            // count in hardware with glitch filter, debounce is applied when polling
+            int32_t unit=PcntAttach(meter_desc_p[meters].srcpin,SML_PCNT_FILTER);
+            if (unit>=0) {
+              sml_counters[cindex].sml_pcnt=unit+1;
+              if (!(meter_desc_p[meters].flag&1)) gpio_pullup_dis((gpio_num_t)meter_desc_p[meters].srcpin);
+            } else
+#endif
+            // init irq mode
+            attachInterrupt(meter_desc_p[meters].srcpin, counter_callbacks[cindex], CHANGE);
           }
           InjektCounterValue(meters,RtcSettings.pulse_counter[cindex]);
           cindex++;
@@ -2183,6 +2210,102 @@ init10:
     }
   }
 
+  SML_InitFrames();
+}
+
+// decimals field of a descriptor, after scaling factor, web name, unit and json name
+uint8_t SML_DescPrecision(const char *mp) {
+  for (uint8_t cnt=0; cnt<4; cnt++) {
+    mp=strchr(mp,',');
+    if (!mp) return 0;
+    mp++;
+  }
+  return atoi(mp);
+}
+
+// compile the value descriptors of one meter, without desc only count them and their pattern bytes
+uint32_t SML_CompileDesc(uint32_t meters, struct SML_DESC *desc, uint8_t *pool, uint32_t *size) {
+  const char *mp=(const char*)meter_p;
+  uint32_t count=0;
+  uint8_t vindex=0;
+  while (mp && *mp) {
+    int8_t mindex=((*mp)&7)-1;
+    if (mindex<0 || mindex>=meters_used) mindex=0;
+    mp+=2;
+    if (*mp=='=' && *(mp+1)=='h') {
+      mp=strchr(mp,'|');
+      if (mp) mp++;
+      continue;
+    }
+    const char *vp=strchr(mp,'@');
+    const char *ep=strchr(mp,'|');
+    if (mindex==meters && *mp!='=' && vp && (!ep || vp<ep)) {
+      uint32_t plen=vp-mp;
+      if (meter_desc_p[mindex].type=='s') plen/=2;
+      // same limit as the received data window
+      if (plen && plen<SML_BSIZ) {
+        if (desc) {
+          desc->pattern=pool+*size;
+          for (uint32_t cnt=0; cnt<plen; cnt++) {
+            if (meter_desc_p[mindex].type=='s') {
+              desc->pattern[cnt]=(hexnibble(mp[cnt*2])<<4) | hexnibble(mp[cnt*2+1]);
+            } else {
+              desc->pattern[cnt]=mp[cnt];
+            }
+          }
+          desc->meter=mindex;
+          desc->vindex=vindex;
+          desc->plen=plen;
+          desc->value=vp+1;
+          if (vp[1]=='#') {
+            desc->sval=vp[2];
+          } else {
+            desc->fac=CharToDouble(vp+1);
+            desc->prec=SML_DescPrecision(vp+1);
+          }
+          meter_first[mindex][desc->pattern[0]>>5]|=1<<(desc->pattern[0]&31);
+          desc++;
+        }
+        count++;
+        *size+=plen;
+      }
+    }
+    if (vindex<SML_MAX_VARS-1) vindex++;
+    mp=ep;
+    if (mp) mp++;
+  }
+  return count;
+}
+
+// allocate telegram buffers of sml and obis meters and compile their descriptors
+void SML_InitFrames(void) {
+  memset(meter_first,0,sizeof(meter_first));
+  uint32_t count=0,size=0;
+  const char *mp=(const char*)meter_p;
+  while (mp && *mp) {
+    count++;
+    mp=strchr(mp,'|');
+    if (mp) mp++;
+  }
+  for (uint32_t meters=0; meters<meters_used; meters++) {
+    meter_fpos[meters]=0;
+    if (meter_desc_p[meters].type=='s' || meter_desc_p[meters].type=='o') {
+      SML_CompileDesc(meters,0,0,&size);
+    }
+  }
+  if (!size) return;
+  // descriptors followed by their patterns in one block
+  sml_desc=(struct SML_DESC*)calloc(count*sizeof(struct SML_DESC)+size,1);
+  if (!sml_desc) return;
+  uint8_t *pool=(uint8_t*)&sml_desc[count];
+  size=0;
+
+  for (uint32_t meters=0; meters<meters_used; meters++) {
+    if (meter_desc_p[meters].type!='s' && meter_desc_p[meters].type!='o') continue;
+    meter_frame[meters]=(uint8_t*)calloc(SML_FRAME_BSIZ+SML_BSIZ,1);
+    if (!meter_frame[meters]) continue;
+    sml_desc_count+=SML_CompileDesc(meters,&sml_desc[sml_desc_count],pool,&size);
+  }
 }
 
 
@@ -2263,8 +2386,8 @@ uint32_t ctime=millis();
           if (meter_desc_p[meters].flag&2) {
             // analog mode, get next value
 #ifdef ANALOG_OPTO_SENSOR
-            if (ads1115_up) {
-              int16_t val = adc.read_sample();
+            int16_t val;
+            if (ads1115_up && Ads1115Sample(0, 0, &val)) {
               if (val>sml_counters[cindex].ana_max) sml_counters[cindex].ana_max=val;
               if (val<sml_counters[cindex].ana_min) sml_counters[cindex].ana_min=val;
               sml_counters[cindex].ana_curr=val;
@@ -2303,6 +2426,15 @@ uint32_t ctime=millis();
       } else {
         if (ctime-sml_counters[cindex].sml_cnt_last_ts>10) {
           sml_counters[cindex].sml_cnt_last_ts=ctime;
+#ifdef ESP32
+          if (sml_counters[cindex].sml_pcnt) {
+            uint32_t pulses=PcntDebounced(sml_counters[cindex].sml_pcnt-1,sml_counters[cindex].sml_debounce);
+            if (pulses) {
+              RtcSettings.pulse_counter[cindex]+=pulses;
+              InjektCounterValue(meters,RtcSettings.pulse_counter[cindex]);
+            }
+          }
+#endif
 #ifdef DEBUG_CNT_LED1
           if (cindex==0) SetDBGLed(meter_desc_p[meters].srcpin,DEBUG_CNT_LED1);
 #endif
@@ -2506,6 +2638,26 @@ bool XSNS_53_cmd(void) {
             }
           }
           ResponseTime_P(PSTR(",\"SML\":{\"CMD\":\"counter%d: %d\"}}"),index,RtcSettings.pulse_counter[index-1]);
+#ifdef SML_BENCH
+      } else if (*cp=='t') {
+        // recorded telegram
+        cp++;
+        uint8_t index=atoi(cp);
+        while (isdigit(*cp)) cp++;
+        if (index>0) SML_BenchTelegram(index-1,cp);
+        ResponseTime_P(PSTR(",\"SML\":{\"CMD\":\"telegram%d: %d\"}}"),index,(index>0 && index<=MAX_METERS)?SmlBench.len[index-1]:0);
+      } else if (*cp=='b') {
+        // benchmark
+        cp++;
+        if (*cp) {
+          SmlBench.active=false;
+          uint32_t secs=strtoul(cp,&cp,10);
+          uint32_t baud=0;
+          if (*cp==',') baud=strtoul(cp+1,0,10);
+          if (secs) SML_BenchStart(secs,baud);
+        }
+        SML_BenchShow();
+#endif  // SML_BENCH
       } else if (*cp=='r') {
         // restart
         ResponseTime_P(PSTR(",\"SML\":{\"CMD\":\"restart\"}}"));
@@ -2518,6 +2670,111 @@ bool XSNS_53_cmd(void) {
   return serviced;
 }
 
+#ifdef SML_BENCH
+// sensor53 t1 1b1b1b1b.. - append hex of a recorded telegram of meter 1, sensor53 t1 clears it
+// sensor53 b10,9600      - inject the telegrams for 10 seconds at 9600 baud or the meter baudrate
+// sensor53 b             - show results, sensor53 b0 stops
+void SML_BenchTelegram(uint32_t meter,char *cp) {
+  if (meter>=meters_used) return;
+  while (*cp==' ') cp++;
+  if (!*cp) {
+    if (SmlBench.telegram[meter]) free(SmlBench.telegram[meter]);
+    SmlBench.telegram[meter]=0;
+    SmlBench.len[meter]=0;
+    return;
+  }
+  uint32_t hlen=strlen(cp)/2;
+  uint8_t *tp=(uint8_t*)realloc(SmlBench.telegram[meter],SmlBench.len[meter]+hlen);
+  if (!tp) return;
+  SmlBench.telegram[meter]=tp;
+  char stemp[3]={0};
+  while (hlen--) {
+    stemp[0]=*cp++;
+    stemp[1]=*cp++;
+    tp[SmlBench.len[meter]++]=strtol(stemp,0,16);
+  }
+}
+
+void SML_BenchStart(uint32_t secs,uint32_t baud) {
+  for (uint32_t meters=0; meters<meters_used; meters++) {
+    SmlBench.pos[meters]=0;
+    SmlBench.bytes[meters]=0;
+    SmlBench.lost[meters]=0;
+    SmlBench.telegrams[meters]=0;
+    SmlBench.cpu[meters]=0;
+    SmlBench.latency[meters]=0;
+    SmlBench.latency_max[meters]=0;
+    SmlBench.baud[meters]=(baud) ? baud : meter_desc_p[meters].params;
+    if (!SmlBench.baud[meters]) SmlBench.baud[meters]=SML_BAUDRATE;
+    meter_spos[meters]=0;
+    if (meter_frame[meters]) meter_fpos[meters]=0;
+  }
+  SmlBench.duration=secs*1000;
+  SmlBench.start=micros();
+  SmlBench.start_ms=millis();
+  SmlBench.active=true;
+}
+
+void SML_BenchPoll(void) {
+  if (!SmlBench.active) return;
+  uint32_t now=micros();
+  uint32_t elapsed=now-SmlBench.start;
+  for (uint32_t meters=0; meters<meters_used; meters++) {
+    uint32_t tlen=SmlBench.len[meters];
+    if (!tlen) continue;
+    // 10 bits per byte at 8N1
+    uint32_t due=((uint64_t)elapsed*SmlBench.baud[meters])/10000000;
+    uint32_t pending=due-SmlBench.bytes[meters];
+    if (pending>TMSBSIZ) {
+      // a serial receive buffer would have overflown since the last loop
+      uint32_t lost=pending-TMSBSIZ;
+      SmlBench.lost[meters]+=lost;
+      SmlBench.bytes[meters]+=lost;
+      SmlBench.pos[meters]=(SmlBench.pos[meters]+lost)%tlen;
+      pending=TMSBSIZ;
+    }
+    uint8_t *tp=SmlBench.telegram[meters];
+    uint32_t start=micros();
+    while (pending--) {
+      uint32_t pos=SmlBench.pos[meters];
+      sml_shift_in(meters,tp[pos]);
+      SmlBench.bytes[meters]++;
+      if (++pos>=tlen) {
+        // telegram end, latency since its last byte should have been received
+        uint32_t end=micros();
+        uint32_t arrival=SmlBench.start+(uint32_t)(((uint64_t)SmlBench.bytes[meters]*10000000)/SmlBench.baud[meters]);
+        uint32_t latency=end-arrival;
+        if ((int32_t)latency<0) latency=0;
+        SmlBench.latency[meters]+=latency;
+        if (latency>SmlBench.latency_max[meters]) SmlBench.latency_max[meters]=latency;
+        SmlBench.telegrams[meters]++;
+        pos=0;
+      }
+      SmlBench.pos[meters]=pos;
+    }
+    SmlBench.cpu[meters]+=micros()-start;
+  }
+  if (SmlBench.duration && (millis()-SmlBench.start_ms>=SmlBench.duration)) {
+    SmlBench.active=false;
+    SML_BenchShow();
+    MqttPublishPrefixTopic_P(RESULT_OR_TELE, PSTR("SML"));
+  }
+}
+
+void SML_BenchShow(void) {
+  ResponseTime_P(PSTR(",\"SML\":{\"Bench\":{\"State\":\"%s\",\"Time\":%d"),(SmlBench.active)?"Running":"Done",
+    ((SmlBench.active)?millis():SmlBench.start_ms+SmlBench.duration)-SmlBench.start_ms);
+  for (uint32_t meters=0; meters<meters_used; meters++) {
+    if (!SmlBench.len[meters]) continue;
+    uint32_t telegrams=SmlBench.telegrams[meters];
+    ResponseAppend_P(PSTR(",\"%d\":{\"Baud\":%d,\"Bytes\":%d,\"Lost\":%d,\"Telegrams\":%d,\"Cpu\":%d,\"Latency\":%d,\"LatencyMax\":%d}"),
+      meters+1,SmlBench.baud[meters],SmlBench.bytes[meters],SmlBench.lost[meters],telegrams,
+      (telegrams)?SmlBench.cpu[meters]/telegrams:0,(telegrams)?SmlBench.latency[meters]/telegrams:0,SmlBench.latency_max[meters]);
+  }
+  ResponseAppend_P(PSTR("}}}"));
+}
+#endif  // SML_BENCH
+
 void InjektCounterValue(uint8_t meter,uint32_t counter) {
   sprintf((char*)&smltbuf[meter][0],"1-0:1.8.0*255(%d)",counter);
   SML_Decode(meter);
@@ -2541,11 +2798,18 @@ bool Xsns53(byte function) {
     switch (function) {
       case FUNC_INIT:
         SML_Init();
+        XsnsSubscribe(FUNC_LOOP);
+#ifdef USE_SCRIPT
+        XsnsSubscribe(FUNC_EVERY_100_MSECOND);
+#endif // USE_SCRIPT
         break;
       case FUNC_LOOP:
         SML_Counter_Poll();
         if (dump2log) Dump2log();
         else SML_Poll();
+#ifdef SML_BENCH
+        SML_BenchPoll();
+#endif
         break;
     //  case FUNC_EVERY_50_MSECOND:
     //    if (dump2log) Dump2log();
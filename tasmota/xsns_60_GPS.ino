@@ -103,6 +103,18 @@ The serial pins are GPS_RX and GPS_TX, no further installation steps needed. To
 + sensor60 15
   pause virtual serial port over TCP
 
++ sensor60 1001 ... 1065
+  set interval between position fixes in seconds
+
++ sensor60 2001 ... 2010
+  set position fix rate in Hz, i.e. for vehicle tracking
+
++ sensor60 3000 ... 3999
+  record a track point after moving 0 ... 999 meters or at least every fix interval, 3000 is time only
+
++ sensor60 4000 ... 4016
+  publish recorded track points to tele/TRACK in batches of 1 ... 16 points, 4000 is off
+
 ## Rules examples for SSD1306 32x128
 
 
@@ -132,6 +144,10 @@ const char kUBXTypes[] PROGMEM = "UBX";
 #define UBX_LAT_LON_THRESHOLD 1000 // filter out some noise of local drift
 
 #define UBX_SERIAL_BUFFER_SIZE 256
+#define UBX_READ_CHUNK         64              // bytes taken from the serial buffer at once
+#ifndef UBX_TRACK_SIZE
+#define UBX_TRACK_SIZE         16              // recent track points kept in RAM
+#endif
 #define UBX_TCP_PORT           1234
 #define NTP_MILLIS_OFFSET      50              // estimated latency in milliseconds
 
@@ -280,6 +296,23 @@ struct UBX_t {
     CFG_RATE cfgRate;
     } Message;
 
+  struct {
+    uint32_t fpos;
+    size_t payloadSize;
+    char checksum[2];
+    uint8_t msgType;
+  } parser;
+
+  struct {
+    entry_t point[UBX_TRACK_SIZE]; // decimated fixes, oldest is overwritten
+    uint32_t last_ms;              // millis() of newest point
+    uint16_t min_distance;         // in meters, 0 is time only
+    uint8_t head;                  // next point to write
+    uint8_t count;
+    uint8_t unsent;                // points not yet published
+    uint8_t batch;                 // points per published batch, 0 is off
+  } track;
+
   uint8_t TCPbuf[UBX_SERIAL_BUFFER_SIZE];
   size_t TCPbufSize;
 } UBX;
@@ -340,7 +373,7 @@ void UBXsendCFGLine(uint8_t _line)
 
 void UBXTriggerTele(void)
 {
-  mqtt_data[0] = '\0';
+  ResponseClear();
   if (MqttShowSensor()) {
     MqttPublishPrefixTopic_P(TELE, PSTR(D_RSLT_SENSOR), Settings.flag.mqtt_sensor_retain);
 #ifdef USE_RULES
@@ -379,108 +412,136 @@ void UBXDetect(void)
 #endif // USE_FLOG
 
   UBX.state.log_interval = 10;  // 1 second
+  UBX.parser.payloadSize = sizeof(UBX.Message);
   UBX.mode.send_UI_only = true; // send UI data ...
   UBXTriggerTele();             // ... once at after start
 }
 
-uint32_t UBXprocessGPS()
+uint32_t UBXparseByte(uint8_t c)
 {
-  static uint32_t fpos = 0;
-  static char checksum[2];
-  static uint8_t currentMsgType = MT_NONE;
-  static size_t payloadSize = sizeof(UBX.Message);
-
-  // DEBUG_SENSOR_LOG(PSTR("UBX: check for serial data"));
-  uint32_t data_bytes = 0;
-  while ( UBXSerial->available() ) {
-    data_bytes++;
-    byte c = UBXSerial->read();
-    if (UBX.mode.runningVPort){
-      UBX.TCPbuf[data_bytes-1] = c; // immediately copy byte to TCP-buf
-      UBX.TCPbufSize = data_bytes;
-    }
-    if ( fpos < 2 ) {
-      // For the first two bytes we are simply looking for a match with the UBX header bytes (0xB5,0x62)
-      if ( c == UBX.UBX_HEADER[fpos] ) {
-        fpos++;
-      } else {
-        fpos = 0; // Reset to beginning state.
-      }
+  // Assemble the payload of a known message right in UBX.Message, returns its type when complete
+  if ( UBX.parser.fpos < 2 ) {
+    // For the first two bytes we are simply looking for a match with the UBX header bytes (0xB5,0x62)
+    if ( c == UBX.UBX_HEADER[UBX.parser.fpos] ) {
+      UBX.parser.fpos++;
     } else {
-      // If we come here then fpos >= 2, which means we have found a match with the UBX_HEADER
-      // and we are now reading in the bytes that make up the payload.
-
-      // Place the incoming byte into the ubxMessage struct. The position is fpos-2 because
-      // the struct does not include the initial two-byte header (UBX_HEADER).
-      if ( (fpos-2) < payloadSize ) {
-        ((char*)(&UBX.Message))[fpos-2] = c;
-      }
-      fpos++;
-
-      if ( fpos == 4 ) {
-        // We have just received the second byte of the message type header,
-        // so now we can check to see what kind of message it is.
-        if ( UBXcompareMsgHeader(UBX.NAV_POSLLH_HEADER) ) {
-          currentMsgType = MT_NAV_POSLLH;
-          payloadSize = sizeof(UBX_t::NAV_POSLLH);
-          DEBUG_SENSOR_LOG(PSTR("UBX: got NAV_POSLLH"));
-        }
-        else if ( UBXcompareMsgHeader(UBX.NAV_STATUS_HEADER) ) {
-          currentMsgType = MT_NAV_STATUS;
-          payloadSize = sizeof(UBX_t::NAV_STATUS);
-          DEBUG_SENSOR_LOG(PSTR("UBX: got NAV_STATUS"));
-        }
-        else if ( UBXcompareMsgHeader(UBX.NAV_TIME_HEADER) ) {
-          currentMsgType = MT_NAV_TIME;
-          payloadSize = sizeof(UBX_t::NAV_TIME_UTC);
-          DEBUG_SENSOR_LOG(PSTR("UBX: got NAV_TIME_UTC"));
-        }
-        else {
-          // unknown message type, bail
-          fpos = 0;
-          continue;
-        }
-      }
-
-      if ( fpos == (payloadSize+2) ) {
-        // All payload bytes have now been received, so we can calculate the
-        // expected checksum value to compare with the next two incoming bytes.
-        UBXcalcChecksum(checksum, payloadSize);
-      }
-      else if ( fpos == (payloadSize+3) ) {
-        // First byte after the payload, ie. first byte of the checksum.
-        // Does it match the first byte of the checksum we calculated?
-        if ( c != checksum[0] ) {
-          // Checksum doesn't match, reset to beginning state and try again.
-          fpos = 0;
-        }
-      }
-      else if ( fpos == (payloadSize+4) ) {
-        // Second byte after the payload, ie. second byte of the checksum.
-        // Does it match the second byte of the checksum we calculated?
-        fpos = 0; // We will reset the state regardless of whether the checksum matches.
-        if ( c == checksum[1] ) {
-          // Checksum matches, we have a valid message.
-          return currentMsgType;
-        }
-      }
-      else if ( fpos > (payloadSize+4) ) {
-        // We have now read more bytes than both the expected payload and checksum
-        // together, so something went wrong. Reset to beginning state and try again.
-        fpos = 0;
-      }
+      UBX.parser.fpos = 0; // Reset to beginning state.
     }
+    return MT_NONE;
   }
-  // DEBUG_SENSOR_LOG(PSTR("UBX: got none or unknown Message"));
-  if (data_bytes!=0) {
-    UBX.state.non_empty_loops++;
-    DEBUG_SENSOR_LOG(PSTR("UBX: got %u bytes, non-empty-loop: %u"), data_bytes, UBX.state.non_empty_loops);
-  } else {
-    UBX.state.non_empty_loops = 0; // now a hidden GPS-device reset is unlikely
+  // If we come here then fpos >= 2, which means we have found a match with the UBX_HEADER
+  // and we are now reading in the bytes that make up the payload.
+
+  // Place the incoming byte into the ubxMessage struct. The position is fpos-2 because
+  // the struct does not include the initial two-byte header (UBX_HEADER).
+  uint32_t fpos = UBX.parser.fpos;
+  size_t payloadSize = UBX.parser.payloadSize;
+  if ( (fpos-2) < payloadSize ) {
+    ((char*)(&UBX.Message))[fpos-2] = c;
+  }
+  fpos++;
+  UBX.parser.fpos = fpos;
+
+  if ( fpos == 4 ) {
+    // We have just received the second byte of the message type header,
+    // so now we can check to see what kind of message it is.
+    if ( UBXcompareMsgHeader(UBX.NAV_POSLLH_HEADER) ) {
+      UBX.parser.msgType = MT_NAV_POSLLH;
+      UBX.parser.payloadSize = sizeof(UBX_t::NAV_POSLLH);
+      DEBUG_SENSOR_LOG(PSTR("UBX: got NAV_POSLLH"));
+    }
+    else if ( UBXcompareMsgHeader(UBX.NAV_STATUS_HEADER) ) {
+      UBX.parser.msgType = MT_NAV_STATUS;
+      UBX.parser.payloadSize = sizeof(UBX_t::NAV_STATUS);
+      DEBUG_SENSOR_LOG(PSTR("UBX: got NAV_STATUS"));
+    }
+    else if ( UBXcompareMsgHeader(UBX.NAV_TIME_HEADER) ) {
+      UBX.parser.msgType = MT_NAV_TIME;
+      UBX.parser.payloadSize = sizeof(UBX_t::NAV_TIME_UTC);
+      DEBUG_SENSOR_LOG(PSTR("UBX: got NAV_TIME_UTC"));
+    }
+    else {
+      // unknown message type, bail
+      UBX.parser.fpos = 0;
+    }
+  }
+  else if ( fpos == (payloadSize+2) ) {
+    // All payload bytes have now been received, so we can calculate the
+    // expected checksum value to compare with the next two incoming bytes.
+    UBXcalcChecksum(UBX.parser.checksum, payloadSize);
+  }
+  else if ( fpos == (payloadSize+3) ) {
+    // First byte after the payload, ie. first byte of the checksum.
+    // Does it match the first byte of the checksum we calculated?
+    if ( c != UBX.parser.checksum[0] ) {
+      // Checksum doesn't match, reset to beginning state and try again.
+      UBX.parser.fpos = 0;
+    }
+  }
+  else if ( fpos == (payloadSize+4) ) {
+    // Second byte after the payload, ie. second byte of the checksum.
+    // Does it match the second byte of the checksum we calculated?
+    UBX.parser.fpos = 0; // We will reset the state regardless of whether the checksum matches.
+    if ( c == UBX.parser.checksum[1] ) {
+      // Checksum matches, we have a valid message.
+      return UBX.parser.msgType;
+    }
+  }
+  else if ( fpos > (payloadSize+4) ) {
+    // We have now read more bytes than both the expected payload and checksum
+    // together, so something went wrong. Reset to beginning state and try again.
+    UBX.parser.fpos = 0;
   }
   return MT_NONE;
 }
 
+/********************************************************************************************\
+| * track recording
+\*********************************************************************************************/
+
+uint32_t UBXdistance(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+  // Equirectangular approximation in meters, lat/lon are in 1e-7 degrees
+  float dlat = (float)(lat2 - lat1);
+  float dlon = (float)(lon2 - lon1) * cosf((float)lat2 * 1.745329e-9f);
+  return (uint32_t)(sqrtf(dlat * dlat + dlon * dlon) * 0.0111195f);
+}
+
+bool UBXtrackAdd(void)
+{
+  // Keep a fix when the vehicle moved far enough or the log interval passed
+  if (UBX.track.count) {
+    UBX_t::entry_t *last = &UBX.track.point[(UBX.track.head + UBX_TRACK_SIZE -1) % UBX_TRACK_SIZE];
+    bool moved = UBX.track.min_distance && (UBXdistance(last->lat, last->lon, UBX.rec_buffer.values.lat, UBX.rec_buffer.values.lon) >= UBX.track.min_distance);
+    if (!moved && (TimePassedSince(UBX.track.last_ms) < UBX.state.log_interval * 100)) { return false; }
+  }
+  UBX.track.last_ms = millis();
+  UBX.rec_buffer.values.time = Rtc.local_time;
+  UBX.track.point[UBX.track.head] = UBX.rec_buffer.values;
+  UBX.track.head = (UBX.track.head +1) % UBX_TRACK_SIZE;
+  if (UBX.track.count < UBX_TRACK_SIZE) { UBX.track.count++; }
+  if (UBX.track.unsent < UBX_TRACK_SIZE) { UBX.track.unsent++; }
+  return true;
+}
+
+void UBXtrackPublish(void)
+{
+  if (!UBX.track.batch || (UBX.track.unsent < UBX.track.batch)) { return; }
+
+  Response_P(PSTR("{\"GPS\":{\"track\":["));
+  for (uint32_t i = UBX.track.unsent; i > 0; i--) {
+    UBX_t::entry_t *point = &UBX.track.point[(UBX.track.head + UBX_TRACK_SIZE - i) % UBX_TRACK_SIZE];
+    char lat[12];
+    char lon[12];
+    dtostrfd((double)point->lat/10000000.0f,7,lat);
+    dtostrfd((double)point->lon/10000000.0f,7,lon);
+    ResponseAppend_P(PSTR("%s[%s,%s,%u]"), (i < UBX.track.unsent) ? "," : "", lat, lon, point->time);
+  }
+  ResponseAppend_P(PSTR("]}}"));
+  MqttPublishPrefixTopic_P(TELE, PSTR("TRACK"));
+  UBX.track.unsent = 0;
+}
+
 /********************************************************************************************\
 | * callback functions for the download
 \*********************************************************************************************/
@@ -531,12 +592,13 @@ void UBXsendFile(void)
 
 /********************************************************************************************/
 
-void UBXSetRate(uint16_t interval)
+void UBXSetRate(uint32_t interval)
 {
+  // Interval between fixes in milliseconds
   UBX.Message.cfgRate.cls = 0x06;
   UBX.Message.cfgRate.id = 0x08;
   UBX.Message.cfgRate.len = 6;
-  uint32_t measRate = (1000*(uint32_t)interval); //seconds to milliseconds
+  uint32_t measRate = interval;
   if (measRate > 0xffff) {
     measRate = 0xffff; // max. 65535 ms interval
   }
@@ -544,14 +606,14 @@ void UBXSetRate(uint16_t interval)
   UBX.Message.cfgRate.navRate = 1;
   UBX.Message.cfgRate.timeRef = 1;
   UBXcalcChecksum(UBX.Message.cfgRate.CK, sizeof(UBX.Message.cfgRate)-sizeof(UBX.Message.cfgRate.CK));
-  DEBUG_SENSOR_LOG(PSTR("UBX: requested interval: %u seconds measRate: %u ms"), interval, UBX.Message.cfgRate.measRate);
+  DEBUG_SENSOR_LOG(PSTR("UBX: requested measRate: %u ms"), UBX.Message.cfgRate.measRate);
   UBXSerial->write(UBX.UBX_HEADER[0]);
   UBXSerial->write(UBX.UBX_HEADER[1]);
   for (uint32_t i =0; i<sizeof(UBX.Message.cfgRate); i++) {
     UBXSerial->write(((uint8_t*)(&UBX.Message.cfgRate))[i]);
     DEBUG_SENSOR_LOG(PSTR("UBX: cfgRate byte %u: %x"), i, ((uint8_t*)(&UBX.Message.cfgRate))[i]);
   }
-  UBX.state.log_interval = 10*interval;
+  UBX.state.log_interval = UBX.Message.cfgRate.measRate / 100;
 }
 
 void UBXSelectMode(uint16_t mode)
@@ -622,7 +684,17 @@ void UBXSelectMode(uint16_t mode)
       break;
     default:
       if (mode>1000 && mode <1066) {
-        UBXSetRate(mode-1000); // set interval between measurements in seconds from 1 to 65
+        UBXSetRate(1000*(mode-1000)); // set interval between measurements in seconds from 1 to 65
+      }
+      else if (mode>2000 && mode<2011) {
+        UBXSetRate(1000/(mode-2000)); // set measurement rate from 1 to 10 Hz
+      }
+      else if (mode>=3000 && mode<4000) {
+        UBX.track.min_distance = mode-3000; // meters moved before recording a track point
+      }
+      else if (mode>=4000 && mode<=4000+UBX_TRACK_SIZE) {
+        UBX.track.batch = mode-4000; // track points per published batch, 0 is off
+        UBX.track.unsent = 0;
       }
       break;
   }
@@ -735,37 +807,53 @@ void UBXLoop50msec(void)
 
 void UBXLoop(void)
 {
-  static uint16_t counter; //count up every 100 msec
-  static bool new_position;
-
-  uint32_t msgType = UBXprocessGPS();
-
-  switch(msgType){
-    case MT_NAV_POSLLH:
-      new_position = UBXHandlePOSLLH();
-      break;
-    case MT_NAV_STATUS:
-      UBXHandleSTATUS();
-      break;
-    case MT_NAV_TIME:
-      UBXHandleTIME();
-      break;
-    default:
-      UBXHandleOther();
-      break;
-  }
-
+  // Handle all messages received since the last call, at 5-10 Hz several fixes can be waiting
+  uint8_t buf[UBX_READ_CHUNK];
+  uint32_t data_bytes = 0;
+  uint32_t messages = 0;
+  size_t len;
+  while ((len = UBXSerial->read(buf, sizeof(buf)))) {
+    if (UBX.mode.runningVPort && (UBX.TCPbufSize + len <= sizeof(UBX.TCPbuf))) {
+      memcpy(UBX.TCPbuf + UBX.TCPbufSize, buf, len);
+      UBX.TCPbufSize += len;
+    }
+    data_bytes += len;
+    for (uint32_t i = 0; i < len; i++) {
+      uint32_t msgType = UBXparseByte(buf[i]);
+      if (MT_NONE == msgType) { continue; }
+      messages++;
+      switch(msgType){
+        case MT_NAV_POSLLH:
+          if (UBXHandlePOSLLH() && UBXtrackAdd()) {
 #ifdef USE_FLOG
-  if (counter>UBX.state.log_interval) {
-    if (Flog->recording && new_position) {
-      UBX.rec_buffer.values.time = Rtc.local_time;
-      Flog->addToBuffer(UBX.rec_buffer.bytes, sizeof(UBX.rec_buffer.bytes));
-      counter = 0;
+            if (Flog->recording) {
+              Flog->addToBuffer(UBX.rec_buffer.bytes, sizeof(UBX.rec_buffer.bytes));
+            }
+#endif // USE_FLOG
+            UBXtrackPublish();
+          }
+          break;
+        case MT_NAV_STATUS:
+          UBXHandleSTATUS();
+          break;
+        case MT_NAV_TIME:
+          UBXHandleTIME();
+          break;
+      }
     }
   }
-#endif // USE_FLOG
 
-  counter++;
+  if (messages) {
+    UBX.state.non_empty_loops = 0;
+  } else {
+    if (data_bytes) {
+      UBX.state.non_empty_loops++;
+      DEBUG_SENSOR_LOG(PSTR("UBX: got %u bytes, non-empty-loop: %u"), data_bytes, UBX.state.non_empty_loops);
+    } else {
+      UBX.state.non_empty_loops = 0; // now a hidden GPS-device reset is unlikely
+    }
+    UBXHandleOther();
+  }
 }
 
 /********************************************************************************************/
@@ -890,6 +978,8 @@ bool Xsns60(uint8_t function)
 
   if (FUNC_INIT == function) {
     UBXDetect();
+    XsnsSubscribe(FUNC_EVERY_50_MSECOND);
+    XsnsSubscribe(FUNC_EVERY_100_MSECOND);
   }
 
   if (UBX.mode.init) {
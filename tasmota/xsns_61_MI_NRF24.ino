@@ -57,10 +57,19 @@
 * BLE-Sniffer/Bridge for MIJIA/XIAOMI Temperatur/Humidity-Sensor, Mi Flora, LYWSD02, GCx
 *
 * Usage: Configure NRF24
+*
+* With GPIO NRF24 IRQ a received packet is read and decoded in the loop as soon as it arrives
+* after which the next channel and packet mode are selected. The radio listens up to MINRF_DWELL
+* mS per channel independent of the 50 mS tick. Hopping stays in the loop as the SPI bus can be
+* shared with other drivers and can not be used from a timer interrupt.
 \*********************************************************************************************/
 
 #define XSNS_61             61
 
+#ifndef MINRF_DWELL
+#define MINRF_DWELL         50      // Max mS listening on one channel with GPIO NRF24 IRQ
+#endif
+
 #include <vector>
 
 #define FLORA       1
@@ -113,6 +122,44 @@ const uint32_t kMINRFCGDPDU[3]  = {0x5da0d752,0xc10c16e7,0x29c497c1};
 const uint8_t kMINRFlsfrList_A[3] = {0x4b,0x17,0x23};  // Flora, LYWSD02
 const uint8_t kMINRFlsfrList_B[3] = {0x21,0x72,0x43};  // MJ_HT_V1, LYWSD03, CGx
 
+// bit reversed byte
+const uint8_t kMINRFreverse[256] PROGMEM = {
+  0x00,0x80,0x40,0xc0,0x20,0xa0,0x60,0xe0,0x10,0x90,0x50,0xd0,0x30,0xb0,0x70,0xf0,
+  0x08,0x88,0x48,0xc8,0x28,0xa8,0x68,0xe8,0x18,0x98,0x58,0xd8,0x38,0xb8,0x78,0xf8,
+  0x04,0x84,0x44,0xc4,0x24,0xa4,0x64,0xe4,0x14,0x94,0x54,0xd4,0x34,0xb4,0x74,0xf4,
+  0x0c,0x8c,0x4c,0xcc,0x2c,0xac,0x6c,0xec,0x1c,0x9c,0x5c,0xdc,0x3c,0xbc,0x7c,0xfc,
+  0x02,0x82,0x42,0xc2,0x22,0xa2,0x62,0xe2,0x12,0x92,0x52,0xd2,0x32,0xb2,0x72,0xf2,
+  0x0a,0x8a,0x4a,0xca,0x2a,0xaa,0x6a,0xea,0x1a,0x9a,0x5a,0xda,0x3a,0xba,0x7a,0xfa,
+  0x06,0x86,0x46,0xc6,0x26,0xa6,0x66,0xe6,0x16,0x96,0x56,0xd6,0x36,0xb6,0x76,0xf6,
+  0x0e,0x8e,0x4e,0xce,0x2e,0xae,0x6e,0xee,0x1e,0x9e,0x5e,0xde,0x3e,0xbe,0x7e,0xfe,
+  0x01,0x81,0x41,0xc1,0x21,0xa1,0x61,0xe1,0x11,0x91,0x51,0xd1,0x31,0xb1,0x71,0xf1,
+  0x09,0x89,0x49,0xc9,0x29,0xa9,0x69,0xe9,0x19,0x99,0x59,0xd9,0x39,0xb9,0x79,0xf9,
+  0x05,0x85,0x45,0xc5,0x25,0xa5,0x65,0xe5,0x15,0x95,0x55,0xd5,0x35,0xb5,0x75,0xf5,
+  0x0d,0x8d,0x4d,0xcd,0x2d,0xad,0x6d,0xed,0x1d,0x9d,0x5d,0xdd,0x3d,0xbd,0x7d,0xfd,
+  0x03,0x83,0x43,0xc3,0x23,0xa3,0x63,0xe3,0x13,0x93,0x53,0xd3,0x33,0xb3,0x73,0xf3,
+  0x0b,0x8b,0x4b,0xcb,0x2b,0xab,0x6b,0xeb,0x1b,0x9b,0x5b,0xdb,0x3b,0xbb,0x7b,0xfb,
+  0x07,0x87,0x47,0xc7,0x27,0xa7,0x67,0xe7,0x17,0x97,0x57,0xd7,0x37,0xb7,0x77,0xf7,
+  0x0f,0x8f,0x4f,0xcf,0x2f,0xaf,0x6f,0xef,0x1f,0x9f,0x5f,0xdf,0x3f,0xbf,0x7f,0xff };
+
+// whitening byte (low byte) and next lfsr (high byte) for each 7-bit lfsr in "wire bit order"
+const uint16_t kMINRFwhiten[128] PROGMEM = {
+  0x0000,0x62c9,0x4d92,0x2f5b,0x1324,0x71ed,0x5eb6,0x3c7f,
+  0x2648,0x4481,0x6bda,0x0913,0x356c,0x57a5,0x78fe,0x1a37,
+  0x4c90,0x2e59,0x0102,0x63cb,0x5fb4,0x3d7d,0x1226,0x70ef,
+  0x6ad8,0x0811,0x274a,0x4583,0x79fc,0x1b35,0x346e,0x56a7,
+  0x1120,0x73e9,0x5cb2,0x3e7b,0x0204,0x60cd,0x4f96,0x2d5f,
+  0x3768,0x55a1,0x7afa,0x1833,0x244c,0x4685,0x69de,0x0b17,
+  0x5db0,0x3f79,0x1022,0x72eb,0x4e94,0x2c5d,0x0306,0x61cf,
+  0x7bf8,0x1931,0x366a,0x54a3,0x68dc,0x0a15,0x254e,0x4787,
+  0x2240,0x4089,0x6fd2,0x0d1b,0x3164,0x53ad,0x7cf6,0x1e3f,
+  0x0408,0x66c1,0x499a,0x2b53,0x172c,0x75e5,0x5abe,0x3877,
+  0x6ed0,0x0c19,0x2342,0x418b,0x7df4,0x1f3d,0x3066,0x52af,
+  0x4898,0x2a51,0x050a,0x67c3,0x5bbc,0x3975,0x162e,0x74e7,
+  0x3360,0x51a9,0x7ef2,0x1c3b,0x2044,0x428d,0x6dd6,0x0f1f,
+  0x1528,0x77e1,0x58ba,0x3a73,0x060c,0x64c5,0x4b9e,0x2957,
+  0x7ff0,0x1d39,0x3262,0x50ab,0x6cd4,0x0e1d,0x2146,0x438f,
+  0x59b8,0x3b71,0x142a,0x76e3,0x4a9c,0x2855,0x070e,0x65c7 };
+
 
 #pragma pack(1)  // important!!
 struct mi_beacon_t{
@@ -169,6 +216,10 @@ struct {
   const uint8_t frequency[3] = { 2,26,80};  // real frequency (2400+x MHz)
 
   uint16_t timer;
+  uint32_t dwellEnd;          // millis() to select the next channel with GPIO NRF24 IRQ
+  volatile bool packetReady = false;
+  bool irq = false;
+  bool reinit = true;
   uint8_t currentChan=0;
   uint8_t ignore = 0; //bitfield: 2^sensor type
   uint8_t channelIgnore = 0; //bitfield: 2^channel (0=37,1=38,2=39)
@@ -240,8 +291,10 @@ static union{
  */
 bool MINRFinitBLE(uint8_t _mode)
 {
-  if (MINRF.timer%1000 == 0){ // only re-init every 20 seconds
+  if (MINRF.reinit){ // only re-init every 50 seconds
+    MINRF.reinit = false;
     NRF24radio.begin(Pin(GPIO_SPI_CS),Pin(GPIO_SPI_DC));
+    NRF24radio.maskIRQ(true,true,false); // IRQ on received packets only
     NRF24radio.setAutoAck(false);
     NRF24radio.setDataRate(RF24_1MBPS);
     NRF24radio.disableCRC();
@@ -356,19 +409,9 @@ void MINRFshowBuffer(uint8_t (&buf)[32]){ // we use this only for the 32-byte-FI
  */
 void MINRFswapbuf(uint8_t *buf, uint8_t len)
 {
-  // uint8_t* buf = (uint8_t*)&MINRF.buffer;
   while(len--) {
-    uint8_t a = *buf;
-    uint8_t v = 0;
-    if (a & 0x80) v |= 0x01;
-    if (a & 0x40) v |= 0x02;
-    if (a & 0x20) v |= 0x04;
-    if (a & 0x10) v |= 0x08;
-    if (a & 0x08) v |= 0x10;
-    if (a & 0x04) v |= 0x20;
-    if (a & 0x02) v |= 0x40;
-    if (a & 0x01) v |= 0x80;
-    *(buf++) = v;
+    *buf = pgm_read_byte(&kMINRFreverse[*buf]);
+    buf++;
   }
 }
 
@@ -381,17 +424,11 @@ void MINRFswapbuf(uint8_t *buf, uint8_t len)
  */
 void MINRFwhiten(uint8_t *buf, uint8_t len, uint8_t lfsr)
 {
+  lfsr &= 0x7f;
   while(len--) {
-    uint8_t res = 0;
-    // LFSR in "wire bit order"
-    for (uint8_t i = 1; i; i <<= 1) {
-      if (lfsr & 0x01) {
-        lfsr ^= 0x88;
-        res |= i;
-      }
-      lfsr >>= 1;
-    }
-    *(buf++) ^= res;
+    uint16_t step = pgm_read_word(&kMINRFwhiten[lfsr]);  // 8 LFSR steps at once
+    lfsr = step >> 8;
+    *(buf++) ^= (uint8_t)step;
 #ifdef DEBUG_TASMOTA_SENSOR
     MINRF.lsfrBuffer[31-len] = lfsr;
 #endif //DEBUG_TASMOTA_SENSOR
@@ -880,40 +917,45 @@ void MINRFhandleCGD1Packet(void){ // no MiBeacon
  * Main loop of the driver
 \*********************************************************************************************/
 
-void MINRF_EVERY_50_MSECOND() { // Every 50mseconds
+#ifndef ARDUINO_ESP8266_RELEASE_2_3_0  // Fix core 2.5.x ISR not in IRAM Exception
+void MINRFisr(void) ICACHE_RAM_ATTR;
+#endif  // ARDUINO_ESP8266_RELEASE_2_3_0
 
-  if(MINRF.timer>6000){ // happens every 6000/20 = 300 seconds
-    DEBUG_SENSOR_LOG(PSTR("MINRF: check for FAKE sensors"));
-    MINRFpurgeFakeSensors();
-    MINRF.timer=0;
-  }
-  MINRF.timer++;
+void MINRFisr(void) {
+  MINRF.packetReady = true;
+}
 
-  if (!MINRFreceivePacket()){
-    // DEBUG_SENSOR_LOG(PSTR("MINRF: nothing received"));
+/**
+ * @brief decode the packet in the buffer depending on the packet mode
+ *
+ */
+void MINRFhandlePacket(void){
+  switch (MINRF.packetMode) {
+    case 0:
+      if (MINRF.beacon.active){
+        MINRFhandleBeacon(&MINRFdummyEntry,6);
+      }
+      else MINRFhandleScan();
+      break;
+    case FLORA: case MJ_HT_V1: case LYWSD02: case CGG1:
+      MINRFhandleMiBeaconPacket();
+      break;
+    case LYWSD03:
+      MINRFhandleLYWSD03Packet();
+      break;
+    case CGD1:
+      MINRFhandleCGD1Packet();
+      break;
+    default:
+      break;
   }
+}
 
-  else {
-    switch (MINRF.packetMode) {
-      case 0:
-        if (MINRF.beacon.active){
-          MINRFhandleBeacon(&MINRFdummyEntry,6);
-        }
-        else MINRFhandleScan();
-        break;
-      case FLORA: case MJ_HT_V1: case LYWSD02: case CGG1:
-        MINRFhandleMiBeaconPacket();
-        break;
-      case LYWSD03:
-        MINRFhandleLYWSD03Packet();
-        break;
-      case CGD1:
-        MINRFhandleCGD1Packet();
-        break;
-      default:
-        break;
-    }
-  }
+/**
+ * @brief select the next packet mode and channel and start listening
+ *
+ */
+void MINRFnextDwell(void){
   if (MINRF.beacon.active || MINRF.activeScan) {
     MINRF.firstUsedPacketMode=0;
   }
@@ -936,7 +978,40 @@ void MINRF_EVERY_50_MSECOND() { // Every 50mseconds
       if (MINRF.packetMode==0) NRF24radio.openReadingPipe(0,MINRF.beacon.PDU[MINRF.currentChan]);
   }
 
+  MINRF.packetReady = false; // a packet of the previous channel would be decoded with the wrong lfsr
   NRF24radio.startListening();
+  MINRF.dwellEnd = millis() + MINRF_DWELL;
+}
+
+void MINRF_EVERY_50_MSECOND() { // Every 50mseconds
+
+  if(MINRF.timer>6000){ // happens every 6000/20 = 300 seconds
+    DEBUG_SENSOR_LOG(PSTR("MINRF: check for FAKE sensors"));
+    MINRFpurgeFakeSensors();
+    MINRF.timer=0;
+  }
+  MINRF.timer++;
+  if (MINRF.timer%1000 == 0) MINRF.reinit = true;
+
+  if (MINRF.irq) return; // packets and hops are handled by MINRFloop()
+
+  if (MINRFreceivePacket()){
+    MINRFhandlePacket();
+  }
+  MINRFnextDwell();
+}
+
+void MINRFloop(void) {
+  if (MINRF.packetReady) {
+    MINRF.packetReady = false;
+    if (MINRFreceivePacket()){
+      MINRFhandlePacket();
+    }
+    MINRFnextDwell();
+  }
+  else if (TimeReached(MINRF.dwellEnd)) {
+    MINRFnextDwell();
+  }
 }
 /*********************************************************************************************\
  * Commands
@@ -1165,6 +1240,17 @@ bool Xsns61(uint8_t function)
       case FUNC_INIT:
         MINRFinitBLE(1);
         AddLog_P2(LOG_LEVEL_INFO,PSTR("MINRF: started"));
+        XsnsSubscribe(FUNC_EVERY_50_MSECOND);
+        if (PinUsed(GPIO_NRF24_IRQ)) {
+          pinMode(Pin(GPIO_NRF24_IRQ), INPUT);
+          attachInterrupt(Pin(GPIO_NRF24_IRQ), MINRFisr, FALLING);
+          MINRF.irq = true;
+          MINRF.dwellEnd = millis() + MINRF_DWELL;
+          XsnsSubscribe(FUNC_LOOP);
+        }
+        break;
+      case FUNC_LOOP:
+        MINRFloop();
         break;
       case FUNC_EVERY_50_MSECOND:
         MINRF_EVERY_50_MSECOND();
@@ -34,6 +34,9 @@
 #include <vector>
 
 void MI32scanEndedCB(NimBLEScanResults results);
+uint32_t MI32MacHash(const uint8_t _mac[]);
+bool MI32KnownType(uint16_t _type);
+void MI32QueueAdv(uint8_t _addr[6], uint16_t _uuid, const std::string &_data);
 void MI32notifyCB(NimBLERemoteCharacteristic* pRemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify);
 
 
@@ -146,6 +149,41 @@ std::vector<mi_sensor_t> MIBLEsensors;
 BLEScan* MI32Scan;
 BLEScanResults MI32foundDevices;
 
+/*********************************************************************************************\
+ * advertisement pipeline
+ *
+ * The NimBLE callback drops advertisers without Xiaomi service data and remembers their MAC hash
+ * in a small drop table, so repeated advertisements of these are rejected on the address alone.
+ * Accepted service data is copied into a single producer single consumer ring and parsed in the
+ * main loop every 50 ms, so MIBLEsensors is only changed by the main task.
+\*********************************************************************************************/
+
+#ifndef MI32_ADV_QUEUE
+#define MI32_ADV_QUEUE     16          // Advertisements buffered for the main loop, power of 2
+#endif
+#ifndef MI32_MAX_SENSORS
+#define MI32_MAX_SENSORS   32
+#endif
+#define MI32_ADV_DATA      24          // Service data bytes kept, a MiBeacon uses 21
+#define MI32_HASH_SIZE     64          // MAC hash table slots, power of 2 above MI32_MAX_SENSORS
+#define MI32_DROP_SIZE     64          // Remembered MAC hashes of other advertisers, power of 2
+
+struct mi_adv_t {
+  uint8_t addr[6];
+  uint16_t uuid;
+  uint8_t len;
+  char data[MI32_ADV_DATA];
+};
+
+struct {
+  mi_adv_t adv[MI32_ADV_QUEUE];
+  volatile uint32_t head = 0;          // Only changed by the NimBLE callback
+  volatile uint32_t tail = 0;          // Only changed by the main loop
+  uint32_t dropped = 0;                // Advertisements lost on a full queue
+  uint32_t drop[MI32_DROP_SIZE];       // MAC hashes of advertisers without Xiaomi service data
+  uint8_t hash[MI32_HASH_SIZE];        // Slot +1 in MIBLEsensors by MAC hash, 0 is free
+} MI32Adv;
+
 /*********************************************************************************************\
  * constants
 \*********************************************************************************************/
@@ -230,26 +268,37 @@ class MI32SensorCallback : public NimBLEClientCallbacks {
 class MI32AdvCallbacks: public NimBLEAdvertisedDeviceCallbacks {
   void onResult(NimBLEAdvertisedDevice* advertisedDevice) {
     // AddLog_P2(LOG_LEVEL_DEBUG,PSTR("Advertised Device: %s Buffer: %u"),advertisedDevice->getAddress().toString().c_str(),advertisedDevice->getServiceData().length());
-    if (advertisedDevice->getServiceData().length() == 0) {
+    uint8_t addr[6];
+    memcpy(addr,advertisedDevice->getAddress().getNative(),6);
+    MI32_ReverseMAC(addr);
+    uint32_t _hash = MI32MacHash(addr);
+    uint32_t _drop = _hash & (MI32_DROP_SIZE -1);
+    if (MI32Adv.drop[_drop] == _hash) {  // known other advertiser
+      MI32Scan->erase(advertisedDevice->getAddress());
+      return;
+    }
+    std::string _data = advertisedDevice->getServiceData();
+    if (_data.length() == 0) {
       // AddLog_P2(LOG_LEVEL_DEBUG,PSTR("No Xiaomi Device: %s Buffer: %u"),advertisedDevice->getAddress().toString().c_str(),advertisedDevice->getServiceData().length());
       MI32Scan->erase(advertisedDevice->getAddress());
       return;
     }
     uint16_t uuid = advertisedDevice->getServiceDataUUID().getNative()->u16.value;
     // AddLog_P2(LOG_LEVEL_DEBUG,PSTR("UUID: %x"),uuid);
-    uint8_t addr[6];
-    memcpy(addr,advertisedDevice->getAddress().getNative(),6);
-    MI32_ReverseMAC(addr);
+    bool _accept = false;
     if(uuid==0xfe95) {
-      MI32ParseResponse((char*)advertisedDevice->getServiceData().data(),advertisedDevice->getServiceData().length(), addr);
+      _accept = (_data.length() > 3) && MI32KnownType((uint8_t)_data[3]*256 + (uint8_t)_data[2]);
     }
     else if(uuid==0xfdcd) {
-      MI32parseCGD1Packet((char*)advertisedDevice->getServiceData().data(),advertisedDevice->getServiceData().length(), addr);
+      _accept = true;
     }
-    else {
+    if (!_accept) {
       // AddLog_P2(LOG_LEVEL_DEBUG,PSTR("No Xiaomi Device: %s Buffer: %u"),advertisedDevice->getAddress().toString().c_str(),advertisedDevice->getServiceData().length());
+      MI32Adv.drop[_drop] = _hash;
       MI32Scan->erase(advertisedDevice->getAddress());
+      return;
     }
+    MI32QueueAdv(addr, uuid, _data);
   };
 };
 
@@ -291,6 +340,68 @@ void MI32_ReverseMAC(uint8_t _mac[]){
   memcpy(_mac,_reversedMAC, sizeof(_reversedMAC));
 }
 
+uint32_t MI32MacHash(const uint8_t _mac[]){
+  uint32_t _hash = 2166136261;  // FNV-1a
+  for (uint32_t i=0; i<6; i++){
+    _hash = (_hash ^ _mac[i]) * 16777619;
+  }
+  return _hash | 1;             // never matches an empty drop table entry
+}
+
+bool MI32KnownType(uint16_t _type){
+  for (uint32_t i=0;i<6;i++){
+    if(_type == kMI32SlaveID[i]) return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Copy an advertisement into the queue for the main loop, only call from the NimBLE callback
+ *
+ * @param _addr       BLE address of the sensor
+ * @param _uuid       UUID of the service data
+ * @param _data       Service data
+ */
+void MI32QueueAdv(uint8_t _addr[6], uint16_t _uuid, const std::string &_data){
+  uint32_t _head = MI32Adv.head;
+  if (_head - MI32Adv.tail >= MI32_ADV_QUEUE) {
+    MI32Adv.dropped++;
+    return;
+  }
+  mi_adv_t *_adv = &MI32Adv.adv[_head & (MI32_ADV_QUEUE -1)];
+  memcpy(_adv->addr, _addr, 6);
+  _adv->uuid = _uuid;
+  _adv->len = (_data.length() < MI32_ADV_DATA) ? _data.length() : MI32_ADV_DATA;
+  memset(_adv->data, 0, MI32_ADV_DATA);
+  memcpy(_adv->data, _data.data(), _adv->len);
+  __sync_synchronize();         // entry complete before the main loop can see it
+  MI32Adv.head = _head +1;
+}
+
+/**
+ * @brief Parse all queued advertisements, called every 50 ms from the main loop
+ *
+ */
+void MI32ParseAdvQueue(void){
+  static uint32_t _dropped = 0;
+
+  while (MI32Adv.tail != MI32Adv.head) {
+    __sync_synchronize();
+    mi_adv_t *_adv = &MI32Adv.adv[MI32Adv.tail & (MI32_ADV_QUEUE -1)];
+    if (_adv->uuid == 0xfe95) {
+      MI32ParseResponse(_adv->data, _adv->len, _adv->addr);
+    } else {
+      MI32parseCGD1Packet(_adv->data, _adv->len, _adv->addr);
+    }
+    __sync_synchronize();       // entry used before the callback can overwrite it
+    MI32Adv.tail++;
+  }
+  if (_dropped != MI32Adv.dropped) {
+    _dropped = MI32Adv.dropped;
+    AddLog_P2(LOG_LEVEL_DEBUG,PSTR("%s: %u advertisements dropped"),D_CMND_MI32, _dropped);
+  }
+}
+
 /*********************************************************************************************\
  * common functions
 \*********************************************************************************************/
@@ -320,7 +431,9 @@ uint32_t MIBLEgetSensorSlot(uint8_t (&_serial)[6], uint16_t _type){
   if(!_success) return 0xff;
 
   DEBUG_SENSOR_LOG(PSTR("%s: vector size %u"),D_CMND_MI32, MIBLEsensors.size());
-  for(uint32_t i=0; i<MIBLEsensors.size(); i++){
+  uint32_t _index = MI32MacHash(_serial) & (MI32_HASH_SIZE -1);
+  while (MI32Adv.hash[_index]) {   // linear probing, sensors are never removed
+    uint32_t i = MI32Adv.hash[_index] -1;
     if(memcmp(_serial,MIBLEsensors[i].serial,sizeof(_serial))==0){
       DEBUG_SENSOR_LOG(PSTR("%s: known sensor at slot: %u"),D_CMND_MI32, i);
       if(MIBLEsensors[i].showedUp < 3){ // if we got an intact packet, the sensor should show up several times
@@ -328,9 +441,9 @@ uint32_t MIBLEgetSensorSlot(uint8_t (&_serial)[6], uint16_t _type){
       }
       return i;
     }
-    DEBUG_SENSOR_LOG(PSTR("%s: i: %x %x %x %x %x %x"),D_CMND_MI32, MIBLEsensors[i].serial[5], MIBLEsensors[i].serial[4],MIBLEsensors[i].serial[3],MIBLEsensors[i].serial[2],MIBLEsensors[i].serial[1],MIBLEsensors[i].serial[0]);
-    DEBUG_SENSOR_LOG(PSTR("%s: n: %x %x %x %x %x %x"),D_CMND_MI32, _serial[5], _serial[4], _serial[3],_serial[2],_serial[1],_serial[0]);
+    _index = (_index +1) & (MI32_HASH_SIZE -1);
   }
+  if (MIBLEsensors.size() >= MI32_MAX_SENSORS) return 0xff;
   DEBUG_SENSOR_LOG(PSTR("%s: found new sensor"),D_CMND_MI32);
   mi_sensor_t _newSensor;
   memcpy(_newSensor.serial,_serial, sizeof(_serial));
@@ -352,6 +465,7 @@ uint32_t MIBLEgetSensorSlot(uint8_t (&_serial)[6], uint16_t _type){
       break;
     }
   MIBLEsensors.push_back(_newSensor);
+  MI32Adv.hash[_index] = MIBLEsensors.size();
   AddLog_P2(LOG_LEVEL_DEBUG,PSTR("%s: new %s at slot: %u"),D_CMND_MI32, kMI32SlaveType[_type-1],MIBLEsensors.size()-1);
   return MIBLEsensors.size()-1;
 };
@@ -1313,10 +1427,14 @@ bool Xsns62(uint8_t function)
   bool result = false;
   if (FUNC_INIT == function){
     MI32Init();
+    XsnsSubscribe(FUNC_EVERY_50_MSECOND);
   }
 
   if (MI32.mode.init) {
     switch (function) {
+      case FUNC_EVERY_50_MSECOND:
+        MI32ParseAdvQueue();
+        break;
       case FUNC_EVERY_SECOND:
         MI32EverySecond(false);
         break;
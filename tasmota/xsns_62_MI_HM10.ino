@@ -1261,6 +1261,8 @@ bool Xsns62(uint8_t function)
     switch (function) {
       case FUNC_INIT:
         HM10SerialInit();                                  // init and start communication
+        XsnsSubscribe(FUNC_EVERY_50_MSECOND);
+        XsnsSubscribe(FUNC_EVERY_100_MSECOND);
         break;
       case FUNC_EVERY_50_MSECOND:
         HM10SerialHandleFeedback();                        // check for device feedback very often
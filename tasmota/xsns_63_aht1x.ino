@@ -176,6 +176,7 @@ bool Xsns63(uint8_t function)
 
   if (FUNC_INIT == function) {
     AHT1XDetect();
+    XsnsSubscribe(FUNC_EVERY_100_MSECOND);
   }
   else if (aht1x_count){
     switch (function) {
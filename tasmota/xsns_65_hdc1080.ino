@@ -293,6 +293,7 @@ bool Xsns65(uint8_t function)
 
   if (FUNC_INIT == function) {
     HdcDetect();
+    XsnsSubscribe(FUNC_EVERY_50_MSECOND);
   }
   else if (hdc_device_id) {
     switch (function) {
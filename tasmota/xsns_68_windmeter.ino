@@ -21,6 +21,11 @@
 #ifdef USE_WINDMETER
 /*********************************************************************************************\
  * WindMeter sensor (speed)
+ *
+ * The speed is calculated every second from the number of pulses and the time between the last
+ * pulse of the previous and the current second so it is not limited to whole pulses per second.
+ * Without pulses the speed follows the time since the last pulse. Gust is the highest mean
+ * speed over WINDMETER_GUST_WINDOW seconds since the last teleperiod.
 \*********************************************************************************************/
 
 #define XSNS_68             68
@@ -33,6 +38,8 @@
 #define WINDMETER_DEF_COMP_FACTOR     1.18  // Compensation factor
 #define WINDMETER_DEF_TELE_PCHANGE    255   // Minimum percentage change between current and last reported speed in order to trigger a new tele message (0...100, 255 means off)
 #define WINDMETER_WEIGHT_AVG_SAMPLE   150   // No of samples to take
+#define WINDMETER_GUST_WINDOW         3     // Seconds of the rolling mean used for gusts (WMO)
+#define WINDMETER_PULSE_TIMEOUT       10    // Seconds without pulse to report no wind
 
 #ifdef USE_WEBSERVER
 #define D_WINDMETER_WIND_AVG "&empty;"
@@ -44,6 +51,7 @@ const char HTTP_SNS_WINDMETER[] PROGMEM =
    "{s}" D_WINDMETER_NAME " " D_TX20_WIND_SPEED " " D_WINDMETER_WIND_AVG "{m}%s %s{e}"
    "{s}" D_WINDMETER_NAME " " D_TX20_WIND_SPEED_MIN "{m}%s %s{e}"
    "{s}" D_WINDMETER_NAME " " D_TX20_WIND_SPEED_MAX "{m}%s %s{e}"
+   "{s}" D_WINDMETER_NAME " " D_TX20_WIND_SPEED " Gust{m}%s %s{e}"
 #endif  // USE_WINDMETER_NOSTATISTICS
 //   "{s}WindMeter " D_TX20_WIND_DIRECTION "{m}%s %s" D_WINDMETER_WIND_DEGREE "{e}"
 //#ifndef USE_WINDMETER_NOSTATISTICS
@@ -58,15 +66,21 @@ float const windmeter_pi = 3.1415926535897932384626433;  // Pi
 float const windmeter_2pi = windmeter_pi * 2;
 
 struct WINDMETER {
-  uint32_t counter_time;
-  unsigned long counter = 0;
-  //uint32_t speed_time;
+  volatile uint32_t counter_time;       // micros() of the last pulse
+  volatile unsigned long counter = 0;
+  unsigned long last_counter = 0;
+  uint32_t last_pulse_time = 0;         // micros() of the last pulse of a previous second
+  float rate = 0;                       // Pulses per second
+  bool pulse_valid = false;             // last_pulse_time is less than WINDMETER_PULSE_TIMEOUT ago
   float speed = 0;
   float last_tele_speed = 0;
 #ifndef USE_WINDMETER_NOSTATISTICS
   float speed_min = 0;
   float speed_max = 0;
   float speed_avg = 0;
+  float gust_speed[WINDMETER_GUST_WINDOW] = { 0 };
+  float speed_gust = 0;
+  uint8_t gust_index = 0;
   uint32_t samples_count = 0;
   uint32_t avg_samples_no;
 #endif  // USE_WINDMETER_NOSTATISTICS
@@ -121,15 +135,38 @@ void WindMeterInit(void)
 
 void WindMeterEverySecond(void)
 {
-  //uint32_t time = micros();
-  //uint32_t delta_time = time - WindMeter.speed_time;
-  //AddLog_P2(LOG_LEVEL_INFO, PSTR("delta_time: %d"), delta_time);
+  // Take the counter and the time of its last pulse together
+  unsigned long counter;
+  uint32_t pulse_time;
+  do {
+    counter = WindMeter.counter;
+    pulse_time = WindMeter.counter_time;
+  } while (counter != WindMeter.counter);
+
+  uint32_t pulses = counter - WindMeter.last_counter;
+  WindMeter.last_counter = counter;
+  if (pulses) {
+    uint32_t period = pulse_time - WindMeter.last_pulse_time;
+    if (!WindMeter.pulse_valid || !period) {
+      period = 1000000;                 // First pulses after calm are counted per second
+    }
+    WindMeter.rate = (float)pulses * 1000000 / period;
+    WindMeter.last_pulse_time = pulse_time;
+    WindMeter.pulse_valid = true;
+  }
+  else if (WindMeter.pulse_valid) {
+    uint32_t quiet = micros() - WindMeter.last_pulse_time;
+    if (quiet > WINDMETER_PULSE_TIMEOUT * 1000000) {
+      WindMeter.rate = 0;
+      WindMeter.pulse_valid = false;
+    } else {
+      float max_rate = (float)1000000 / quiet;  // Less than one pulse since the last one
+      if (WindMeter.rate > max_rate) { WindMeter.rate = max_rate; }
+    }
+  }
 
-  // speed = ( (pulses / pulses_per_rotation) * (2 * pi * radius) ) / delta_time
-  WindMeter.speed = ((WindMeter.counter / Settings.windmeter_pulses_x_rot) * (windmeter_2pi * ((float)Settings.windmeter_radius / 1000))) * ((float)Settings.windmeter_speed_factor / 1000);
-  //WindMeter.speed = (((WindMeter.counter / Settings.windmeter_pulses_x_rot) * (windmeter_2pi * ((float)Settings.windmeter_radius / 1000))) / ((float)delta_time / 1000000)) * ((float)Settings.windmeter_speed_factor / 1000);
-  WindMeter.counter = 0;
-  //WindMeter.speed_time = time;
+  // speed = (pulses per second / pulses_per_rotation) * (2 * pi * radius)
+  WindMeter.speed = ((WindMeter.rate / Settings.windmeter_pulses_x_rot) * (windmeter_2pi * ((float)Settings.windmeter_radius / 1000))) * ((float)Settings.windmeter_speed_factor / 1000);
 
   //char speed_string[FLOATSZ];
   //dtostrfd(WindMeter.speed, 2, speed_string);
@@ -154,6 +191,13 @@ void WindMeterEverySecond(void)
   WindMeter.speed_avg -= WindMeter.speed_avg / WindMeter.samples_count;
   WindMeter.speed_avg += float(WindMeter.speed) / WindMeter.samples_count;
 
+  WindMeter.gust_speed[WindMeter.gust_index] = WindMeter.speed;
+  WindMeter.gust_index = (WindMeter.gust_index +1) % WINDMETER_GUST_WINDOW;
+  float gust = WindMeterGust();
+  if (gust > WindMeter.speed_gust) {
+    WindMeter.speed_gust = gust;
+  }
+
   WindMeterCheckSampleCount();
   if (0==Settings.tele_period) {
     WindMeterResetStatData();
@@ -177,10 +221,22 @@ bool WindMeterShouldTriggerTele()
   }
 }
 
+#ifndef USE_WINDMETER_NOSTATISTICS
+float WindMeterGust(void)
+{
+  float sum = 0;
+  for (uint32_t i = 0; i < WINDMETER_GUST_WINDOW; i++) {
+    sum += WindMeter.gust_speed[i];
+  }
+  return sum / WINDMETER_GUST_WINDOW;
+}
+#endif  // USE_WINDMETER_NOSTATISTICS
+
 void WindMeterResetStatData(void)
 {
   WindMeter.speed_min = WindMeter.speed;
   WindMeter.speed_max = WindMeter.speed;
+  WindMeter.speed_gust = WindMeterGust();
   //WindMeter.direction_min = WindMeter.direction;
   //WindMeter.direction_max = WindMeter.direction;
 }
@@ -212,6 +268,8 @@ void WindMeterShow(bool json)
   dtostrfd(ConvertSpeed(WindMeter.speed_max), 2, speed_max_string);
   char speed_avg_string[FLOATSZ];
   dtostrfd(ConvertSpeed(WindMeter.speed_avg), 2, speed_avg_string);
+  char speed_gust_string[FLOATSZ];
+  dtostrfd(ConvertSpeed(WindMeter.speed_gust), 2, speed_gust_string);
   //char direction_avg_string[FLOATSZ];
   //dtostrfd(WindMeter.direction_avg, 1, direction_avg_string);
   //char direction_avg_cardinal_string[4];
@@ -228,11 +286,12 @@ void WindMeterShow(bool json)
     WindMeter.last_tele_speed = WindMeter.speed;
 #ifndef USE_WINDMETER_NOSTATISTICS
     //ResponseAppend_P(PSTR(",\"" D_WINDMETER_NAME "\":{\"" D_JSON_SPEED "\":{\"Act\":%s,\"Avg\":%s,\"Min\":%s,\"Max\":%s},\"Dir\":{\"Card\":\"%s\",\"Deg\":%s,\"Avg\":%s,\"AvgCard\":\"%s\",\"Min\":%s,\"Max\":%s,\"Range\":%s}}"),
-    ResponseAppend_P(PSTR(",\"" D_WINDMETER_NAME "\":{\"" D_JSON_SPEED "\":{\"Act\":%s,\"Avg\":%s,\"Min\":%s,\"Max\":%s}}"),
+    ResponseAppend_P(PSTR(",\"" D_WINDMETER_NAME "\":{\"" D_JSON_SPEED "\":{\"Act\":%s,\"Avg\":%s,\"Min\":%s,\"Max\":%s,\"Gust\":%s}}"),
       speed_string,
       speed_avg_string,
       speed_min_string,
-      speed_max_string
+      speed_max_string,
+      speed_gust_string
       //direction_cardinal_string,
       //direction_string,
       //direction_avg_string,
@@ -261,6 +320,8 @@ void WindMeterShow(bool json)
       SpeedUnit().c_str(),
       speed_max_string,
       SpeedUnit().c_str(),
+      speed_gust_string,
+      SpeedUnit().c_str(),
 #endif  // USE_WINDMETER_NOSTATISTICS
       "n/a", //wind_direction_cardinal_string,
       "n/a" //wind_direction_string
@@ -278,7 +339,7 @@ void WindMeterShow(bool json)
 
 void WindMeterTriggerTele(void)
 {
-  mqtt_data[0] = '\0';
+  ResponseClear();
   if (MqttShowSensor()) {
     MqttPublishPrefixTopic_P(TELE, PSTR(D_RSLT_SENSOR), Settings.flag.mqtt_sensor_retain);
 #ifdef USE_RULES
@@ -498,18 +498,14 @@ void sns_opentherm_flags_cmd(void)
         sns_opentherm_init_boiler_status();
     }
     bool addComma = false;
-    mqtt_data[0] = 0;
+    ResponseClear();
     for (int pos = 0; pos < OT_FLAGS_COUNT; ++pos)
     {
         int mask = 1 << pos;
         int mode = Settings.ot_flags & (uint8_t)mask;
         if (mode > 0)
         {
-            if (addComma)
-            {
-                snprintf_P(mqtt_data, sizeof(mqtt_data), PSTR("%s,"), mqtt_data);
-            }
-            snprintf_P(mqtt_data, sizeof(mqtt_data), PSTR("%s%s"), mqtt_data, sns_opentherm_flag_text(mode));
+            ResponseAppend_P(PSTR("%s%s"), (addComma) ? "," : "", sns_opentherm_flag_text(mode));
             addComma = true;
         }
     }
@@ -538,6 +534,8 @@ bool Xsns69(uint8_t function)
         {
             sns_opentherm_CheckSettings();
         }
+        XsnsSubscribe(FUNC_LOOP);
+        XsnsSubscribe(FUNC_EVERY_100_MSECOND);
     }
 
     if (!sns_ot_master)
@@ -22,12 +22,117 @@
 #ifdef USE_PROMETHEUS
 /*********************************************************************************************\
  * Prometheus support
+ *
+ * Drivers register their values once at init with MetricRegister() and keep updating them in
+ * place. A scrape streams the registered values without building the sensor JSON. Series of
+ * the same metric name differing by label must be registered one after another.
+ *
+ * MetricRegister(PSTR("voltage"), METRIC_GAUGE | METRIC_FLOAT | 1, &Energy.voltage[i], PSTR("phase"), i +1);
 \*********************************************************************************************/
 
 #define XSNS_91                    91
 
+#ifndef METRIC_MAX
+#define METRIC_MAX                 40          // Max number of registered metrics
+#endif
+
+struct METRIC {
+  const char *name;                            // PROGMEM metric name
+  const char *label;                           // PROGMEM label name or nullptr
+  const void *value;
+  uint8_t flags;                               // MetricFlags
+  uint8_t label_value;
+};
+
+struct {
+  METRIC metric[METRIC_MAX];
+  uint32_t heap;                               // Values sampled at scrape
+  uint32_t heap_block;
+  uint32_t heap_fragmentation;
+  int32_t rssi;
+  uint32_t wifi_links;
+  uint32_t mqtt_connects;
+  uint8_t count = 0;
+} Metrics;
+
+bool MetricRegister(const char *name, uint32_t flags, const void *value, const char *label, uint32_t label_value)
+{
+  if (Metrics.count >= METRIC_MAX) {
+    AddLog_P2(LOG_LEVEL_DEBUG, PSTR("PRM: No room for metric %s"), name);
+    return false;
+  }
+  METRIC *metric = &Metrics.metric[Metrics.count++];
+  metric->name = name;
+  metric->label = label;
+  metric->value = value;
+  metric->flags = flags;
+  metric->label_value = label_value;
+  return true;
+}
+
+void MetricsInit(void)
+{
+  MetricRegister(PSTR("uptime_seconds"), METRIC_COUNTER | METRIC_UINT32, &uptime, nullptr, 0);
+  MetricRegister(PSTR("loop_load_average"), METRIC_GAUGE | METRIC_UINT32, &loop_load_avg, nullptr, 0);
+  MetricRegister(PSTR("loop_sleep_milliseconds"), METRIC_GAUGE | METRIC_UINT8, &ssleep, nullptr, 0);
+  MetricRegister(PSTR("heap_free_bytes"), METRIC_GAUGE | METRIC_UINT32, &Metrics.heap, nullptr, 0);
+  MetricRegister(PSTR("heap_free_low_bytes"), METRIC_GAUGE | METRIC_UINT32, &HeapStats.free_low, nullptr, 0);
+  MetricRegister(PSTR("heap_max_block_bytes"), METRIC_GAUGE | METRIC_UINT32, &Metrics.heap_block, nullptr, 0);
+  MetricRegister(PSTR("heap_max_block_low_bytes"), METRIC_GAUGE | METRIC_UINT32, &HeapStats.block_low, nullptr, 0);
+  MetricRegister(PSTR("heap_fragmentation_percent"), METRIC_GAUGE | METRIC_UINT32, &Metrics.heap_fragmentation, nullptr, 0);
+  MetricRegister(PSTR("wifi_rssi_dbm"), METRIC_GAUGE | METRIC_INT32, &Metrics.rssi, nullptr, 0);
+  MetricRegister(PSTR("wifi_link_count"), METRIC_COUNTER | METRIC_UINT32, &Metrics.wifi_links, nullptr, 0);
+  MetricRegister(PSTR("mqtt_connect_count"), METRIC_COUNTER | METRIC_UINT32, &Metrics.mqtt_connects, nullptr, 0);
+}
+
+void MetricsShow(void)
+{
+  Metrics.heap = ESP_getFreeHeap();
+  Metrics.heap_block = ESP_getMaxFreeBlock();
+  Metrics.heap_fragmentation = HeapFragmentation();
+  Metrics.rssi = WiFi.RSSI();
+  Metrics.wifi_links = WifiLinkCount();
+  Metrics.mqtt_connects = MqttConnectCount();
+
+  char name[40];
+  char value[FLOATSZ];
+  for (uint32_t i = 0; i < Metrics.count; i++) {
+    METRIC *metric = &Metrics.metric[i];
+    strncpy_P(name, metric->name, sizeof(name));
+    name[sizeof(name) -1] = '\0';
+    if (!i || strcmp_P(name, Metrics.metric[i -1].name)) {
+      WSContentSend_P(PSTR("# TYPE %s %s\n"), name, (metric->flags & METRIC_COUNTER) ? PSTR("counter") : PSTR("gauge"));
+    }
+
+    switch (metric->flags & METRIC_FORMAT) {
+      case METRIC_FLOAT:
+        if (isnan(*(const float*)metric->value)) { continue; }  // Not measured by this driver
+        dtostrfd(*(const float*)metric->value, metric->flags & METRIC_RESOLUTION, value);
+        break;
+      case METRIC_UINT32:
+        snprintf_P(value, sizeof(value), PSTR("%u"), *(const uint32_t*)metric->value);
+        break;
+      case METRIC_INT32:
+        snprintf_P(value, sizeof(value), PSTR("%d"), *(const int32_t*)metric->value);
+        break;
+      case METRIC_UINT16:
+        snprintf_P(value, sizeof(value), PSTR("%u"), *(const uint16_t*)metric->value);
+        break;
+      default:
+        snprintf_P(value, sizeof(value), PSTR("%u"), *(const uint8_t*)metric->value);
+        break;
+    }
+    if (metric->label) {
+      WSContentSend_P(PSTR("%s{%s=\"%d\"} %s\n"), name, metric->label, metric->label_value, value);
+    } else {
+      WSContentSend_P(PSTR("%s %s\n"), name, value);
+    }
+  }
+}
+
 void HandleMetrics(void)
 {
+  WEB_STAT(WEB_STAT_METRICS);
   if (!HttpCheckPriviledgedAccess()) { return; }
 
   AddLog_P(LOG_LEVEL_DEBUG, S_LOG_HTTP, PSTR("Prometheus"));
@@ -50,32 +155,29 @@ void HandleMetrics(void)
     WSContentSend_P(PSTR("# TYPE global_pressure gauge\nglobal_pressure %s\n"), parameter);
   }
 
-#ifdef USE_ENERGY_SENSOR
-  dtostrfd(Energy.voltage[0], Settings.flag2.voltage_resolution, parameter);
-  WSContentSend_P(PSTR("# TYPE voltage gauge\nvoltage %s\n"), parameter);
-  dtostrfd(Energy.current[0], Settings.flag2.current_resolution, parameter);
-  WSContentSend_P(PSTR("# TYPE current gauge\ncurrent %s\n"), parameter);
-  dtostrfd(Energy.active_power[0], Settings.flag2.wattage_resolution, parameter);
-  WSContentSend_P(PSTR("# TYPE active_power gauge\nactive_power %s\n"), parameter);
-  dtostrfd(Energy.daily, Settings.flag2.energy_resolution, parameter);
-  WSContentSend_P(PSTR("# TYPE energy_daily gauge\nenergy_daily %s\n"), parameter);
-  dtostrfd(Energy.total, Settings.flag2.energy_resolution, parameter);
-  WSContentSend_P(PSTR("# TYPE energy_total counter\nenergy_total %s\n"), parameter);
-#endif
-
-/*
-  // Alternative method using the complete sensor JSON data
-  // For prometheus it may need to be decoded to # TYPE messages
-  mqtt_data[0] = '\0';
-  MqttShowSensor();
-  char json[strlen(mqtt_data) +1];
-  snprintf_P(json, sizeof(json), mqtt_data);
-
-  // Do your Prometheus specific processing here.
-  // Look at function DisplayAnalyzeJson() in file xdrv_13_display.ino as an example how to decode the JSON message
-
-  WSContentSend_P(json);
-*/
+  MetricsShow();
+
+#ifdef USE_PROFILER
+  ProfileMetrics();
+#endif  // USE_PROFILER
+#ifdef USE_LOOP_STATS
+  LoopStatsMetrics();
+#endif  // USE_LOOP_STATS
+#if defined(USE_RULES) && defined(USE_RULES_STATS)
+  RulesStatsMetrics();
+#endif  // USE_RULES && USE_RULES_STATS
+#ifdef USE_ZIGBEE
+  ZigbeeStatsMetrics();
+#endif  // USE_ZIGBEE
+#ifdef USE_HEAP_TAGS
+  HeapTagMetrics();
+#endif  // USE_HEAP_TAGS
+#ifdef USE_WEB_STATS
+  WebStatsMetrics();
+#endif  // USE_WEB_STATS
+#ifdef USE_PING
+  PingMetrics();
+#endif  // USE_PING
 
   WSContentEnd();
 }
@@ -89,6 +191,9 @@ bool Xsns91(uint8_t function)
   bool result = false;
 
   switch (function) {
+    case FUNC_INIT:
+      MetricsInit();
+      break;
     case FUNC_WEB_ADD_HANDLER:
       Webserver->on("/metrics", HandleMetrics);
       break;
@@ -421,6 +421,28 @@ bool (* const xsns_func_ptr[])(uint8_t) = {  // Sensor Function Pointers for sim
 };
 
 const uint8_t xsns_present = sizeof(xsns_func_ptr) / sizeof(xsns_func_ptr[0]);  // Number of External Sensors found
+uint8_t xsns_polled[xsns_present] = { 0 };        // Polled functions subscribed by each sensor
+uint8_t xsns_subscribe_index = 0;                 // Index of sensor calling XsnsSubscribe() during init
+#ifdef USE_STAGED_BOOT
+uint8_t xsns_initialized = 0;                     // Number of sensors that handled FUNC_INIT
+#endif  // USE_STAGED_BOOT
+
+#ifndef XSNS_MAX_SCHEDULED
+#define XSNS_MAX_SCHEDULED     16                 // Sensors using XsnsSchedule()
+#endif
+#ifndef XSNS_SCHEDULE_STAGGER
+#define XSNS_SCHEDULE_STAGGER  150                // mSeconds between first slots of scheduled sensors
+#endif
+
+struct XSNS_SCHEDULE {
+  unsigned long next;                             // Start of next measurement cycle
+  unsigned long read;                             // Time to read the started conversion
+  uint16_t interval;                              // mSeconds between measurement cycles
+  uint16_t conversion;                            // mSeconds between FUNC_SENSOR_START and FUNC_SENSOR_READ
+  uint8_t index;                                  // Sensor function index
+  bool converting;
+} xsns_schedule[XSNS_MAX_SCHEDULED];
+uint8_t xsns_scheduled = 0;                       // Number of used xsns_schedule entries
 
 /*********************************************************************************************\
  * Xsns available list
@@ -862,6 +884,101 @@ void XsnsSensorState(void)
   ResponseAppend_P(PSTR("\""));
 }
 
+uint32_t XsnsPresent(void)
+{
+  return xsns_present;
+}
+
+uint32_t XsnsId(uint32_t index)
+{
+#ifdef XFUNC_PTR_IN_ROM
+  return pgm_read_byte(kXsnsList + index);
+#else
+  return kXsnsList[index];
+#endif
+}
+
+/*********************************************************************************************\
+ * Polled function subscription
+ *
+ * Polled functions FUNC_LOOP up to FUNC_EVERY_250_MSECOND are only passed to sensors that
+ * subscribed to them using XsnsSubscribe() while handling FUNC_INIT
+\*********************************************************************************************/
+
+void XsnsSubscribe(uint32_t function)
+{
+  xsns_polled[xsns_subscribe_index] |= XfuncPolledMask(function);
+}
+
+/*********************************************************************************************\
+ * Scheduled sensor reads
+ *
+ * A sensor calling XsnsSchedule(interval, conversion) while handling FUNC_INIT receives
+ * FUNC_SENSOR_START followed by FUNC_SENSOR_READ conversion mSeconds later every interval
+ * mSeconds. Without conversion time only FUNC_SENSOR_READ is passed. The first cycles of the
+ * scheduled sensors are XSNS_SCHEDULE_STAGGER mSeconds apart and at most one slot is run per
+ * 50 mSecond tick so reads no longer pile up at the start of every second.
+\*********************************************************************************************/
+
+void XsnsSchedule(uint32_t interval, uint32_t conversion)
+{
+  uint32_t entry = 0;
+  while ((entry < xsns_scheduled) && (xsns_schedule[entry].index != xsns_subscribe_index)) { entry++; }
+  if (entry >= XSNS_MAX_SCHEDULED) { return; }
+  if (entry == xsns_scheduled) { xsns_scheduled++; }
+
+  XSNS_SCHEDULE *slot = &xsns_schedule[entry];
+  slot->index = xsns_subscribe_index;
+  slot->interval = interval;
+  slot->conversion = (conversion < interval) ? conversion : 0;
+  slot->converting = false;
+  slot->next = millis() + (entry * XSNS_SCHEDULE_STAGGER) % 1000;
+}
+
+void XsnsScheduleLoop(void)
+{
+  static uint8_t next_entry = 0;
+
+  for (uint32_t i = 0; i < xsns_scheduled; i++) {
+    uint32_t entry = (next_entry + i) % xsns_scheduled;
+    XSNS_SCHEDULE *slot = &xsns_schedule[entry];
+    if (!TimeReached((slot->converting) ? slot->read : slot->next)) { continue; }
+
+    next_entry = entry +1;  // Round robin so a slow sensor does not delay the others twice
+    if (slot->conversion && !slot->converting) {
+      slot->converting = true;
+      slot->read = millis() + slot->conversion;  // Conversion time is a minimum
+      XsnsCallIndex(slot->index, FUNC_SENSOR_START);
+    } else {
+      slot->converting = false;
+      SetNextTimeInterval(slot->next, slot->interval);
+      XsnsCallIndex(slot->index, FUNC_SENSOR_READ);
+      SensorSnapshotInvalidate();
+    }
+    break;
+  }
+}
+
+/*********************************************************************************************\
+ * Staged sensor init
+ *
+ * With USE_STAGED_BOOT sensors are not initialized in setup() but one per loop() after power
+ * state and wifi have been started. Until then a sensor does not receive any function.
+\*********************************************************************************************/
+
+#ifdef USE_STAGED_BOOT
+bool XsnsInitNext(void)
+{
+  // Returns false when all sensors are initialized
+  if (xsns_initialized >= xsns_present) { return false; }
+
+  xsns_subscribe_index = xsns_initialized;
+  xsns_func_ptr[xsns_initialized](FUNC_INIT);
+  xsns_initialized++;
+  return true;
+}
+#endif  // USE_STAGED_BOOT
+
 /*********************************************************************************************\
  * Function call to all xsns
 \*********************************************************************************************/
@@ -882,8 +999,51 @@ bool XsnsNextCall(uint8_t Function, uint8_t &xsns_index)
 #ifndef USE_DEBUG_DRIVER
   }
 #endif
+#ifdef USE_STAGED_BOOT
+  if (xsns_index >= xsns_initialized) { return false; }
+#endif  // USE_STAGED_BOOT
 
-  return xsns_func_ptr[xsns_index](Function);
+  return XsnsCallOne(xsns_index, Function);
+}
+
+bool XsnsCallOne(uint32_t x, uint8_t Function)
+{
+  // Every call to a sensor goes through here so profiler, trace and crash recorder see it
+#ifdef USE_DEBUG_DRIVER
+  if (!XsnsEnabled(x)) { return false; }  // Skip disabled sensor in debug mode
+#endif
+#if defined(USE_PROFILER) || defined(USE_LOOP_STATS)
+  uint32_t profile_start = micros();
+#endif  // USE_PROFILER || USE_LOOP_STATS
+  TRACE_EVENT(TRACE_SENSOR, TRACE_BEGIN, (x << 8) | Function);
+#ifdef ESP8266
+  uint32_t crash_call_previous = crash_call;
+  crash_call = CRASH_CALL_SENSOR | (x << 8) | Function;  // Saved by the crash recorder
+#endif  // ESP8266
+  bool result = xsns_func_ptr[x](Function);
+#ifdef ESP8266
+  crash_call = crash_call_previous;
+#endif  // ESP8266
+  TRACE_EVENT(TRACE_SENSOR, TRACE_END, (x << 8) | Function);
+#ifdef USE_PROFILER
+  ProfileFunction(PROFILE_SENSOR, x, Function, profile_start);
+#endif  // USE_PROFILER
+#ifdef USE_LOOP_STATS
+  LoopStatsFunction(true, x, Function, profile_start);
+#endif  // USE_LOOP_STATS
+  return result;
+}
+
+bool XsnsCallIndex(uint32_t index, uint8_t Function)
+{
+#ifdef USE_STAGED_BOOT
+  if (index < xsns_initialized) {
+#else
+  if (index < xsns_present) {
+#endif  // USE_STAGED_BOOT
+    return XsnsCallOne(index, Function);
+  }
+  return false;
 }
 
 bool XsnsCall(uint8_t Function)
@@ -896,7 +1056,16 @@ bool XsnsCall(uint8_t Function)
   uint32_t profile_start_millis = millis();
 #endif  // PROFILE_XSNS_EVERY_SECOND
 
+  uint32_t polled = XfuncPolledMask(Function);
+
+#ifdef USE_STAGED_BOOT
+  for (uint32_t x = 0; x < xsns_initialized; x++) {
+#else
   for (uint32_t x = 0; x < xsns_present; x++) {
+#endif  // USE_STAGED_BOOT
+    if (polled && !(xsns_polled[x] & polled)) { continue; }  // Skip sensors not interested in this polled function
+    if (FUNC_INIT == Function) { xsns_subscribe_index = x; }
+
 #ifdef USE_DEBUG_DRIVER
     if (XsnsEnabled(x)) {  // Skip disabled sensor in debug mode
 #endif
@@ -906,7 +1075,7 @@ bool XsnsCall(uint8_t Function)
 #ifdef PROFILE_XSNS_SENSOR_EVERY_SECOND
       uint32_t profile_start_millis = millis();
 #endif  // PROFILE_XSNS_SENSOR_EVERY_SECOND
-      result = xsns_func_ptr[x](Function);
+      result = XsnsCallOne(x, Function);
 
 #ifdef PROFILE_XSNS_SENSOR_EVERY_SECOND
       uint32_t profile_millis = millis() - profile_start_millis;
@@ -921,6 +1090,7 @@ bool XsnsCall(uint8_t Function)
                      (FUNC_PIN_STATE == Function) ||
                      (FUNC_COMMAND_SENSOR == Function)
                     )) {
+        xfunc_command_index = x;
         break;
       }
 #ifdef USE_DEBUG_DRIVER
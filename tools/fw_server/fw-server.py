@@ -33,6 +33,13 @@ Instructions:
         Firmware Upgrade -> Upgrade by web server
             http://<ip_address>:5000/sonoff-minimal.bin
 
+    Delta updates (firmware built with USE_OTA_RESUME and USE_OTA_DELTA):
+        Keep the previously deployed .bin files in the firmware directory.
+        The device adds the MD5 of its running image to the url. When
+        one of the .bin files matches, a delta to the requested file is
+        created in <fwdir>/delta/ and sent instead of the full image.
+        <file>.sha256 is created on request for the SHA-256 check.
+
 
 Usage:
     ./fw-server.py -d <net_iface>   (default: eth0)
@@ -45,11 +52,14 @@ Example:
     ./fw-server.py -i 192.168.1.10
 """
 
+import glob
+import hashlib
 import os.path
+import struct
 from optparse import OptionParser
 from sys import exit
 
-from flask import Flask, send_file
+from flask import Flask, request, send_file
 import netifaces as ni
 
 usage = "usage: fw-server {-d | -i} arg"
@@ -85,15 +95,102 @@ else:
 
 print(" * Directory: " + fwdir)
 
+DELTA_BLOCK = 16                # Minimum length of a copied match
+DELTA_COPY = 1
+DELTA_DATA = 2
+
+
+def image_variants(image):
+    """Running image as it may be in flash, the OTA updater can change the flash mode byte"""
+    yield image
+    if len(image) > 2 and image[0] == 0xE9:
+        for mode in range(4):
+            if mode != image[2]:
+                yield image[:2] + bytes([mode]) + image[3:]
+
+
+def find_image(md5):
+    """Return running image matching md5 or None"""
+    for name in glob.glob(fwdir + "*.bin"):
+        with open(name, "rb") as f:
+            image = f.read()
+        for variant in image_variants(image):
+            if hashlib.md5(variant).hexdigest() == md5:
+                return variant
+    return None
+
+
+def make_delta(old, new):
+    """Copy and data operations building new from old, see support_ota.ino"""
+    index = {}
+    for i in range(len(old) - DELTA_BLOCK + 1):
+        index.setdefault(old[i:i + DELTA_BLOCK], i)
+
+    out = bytearray(b"TDLT")
+    out += struct.pack("<I", len(old)) + hashlib.md5(old).digest()
+    out += struct.pack("<I", len(new)) + hashlib.md5(new).digest()
+
+    literal_start = 0
+    pos = 0
+    while pos < len(new):
+        offset = index.get(new[pos:pos + DELTA_BLOCK])
+        if offset is None:
+            pos += 1
+            continue
+        length = DELTA_BLOCK
+        while pos + length < len(new) and offset + length < len(old) and new[pos + length] == old[offset + length]:
+            length += 1
+        if pos > literal_start:
+            out += struct.pack("<BII", DELTA_DATA, 0, pos - literal_start) + new[literal_start:pos]
+        out += struct.pack("<BII", DELTA_COPY, offset, length)
+        pos += length
+        literal_start = pos
+    if pos > literal_start:
+        out += struct.pack("<BII", DELTA_DATA, 0, pos - literal_start) + new[literal_start:pos]
+    return bytes(out)
+
+
+def delta_file(filename, md5):
+    """Return path of cached delta from image md5 to filename or None if no smaller delta"""
+    deltadir = fwdir + "delta/"
+    path = deltadir + md5 + "-" + filename
+    if os.path.exists(path):
+        return path
+    old = find_image(md5)
+    if old is None:
+        return None
+    with open(fwdir + filename, "rb") as f:
+        new = f.read()
+    delta = make_delta(old, new)
+    if len(delta) >= len(new):
+        return None
+    os.makedirs(deltadir, exist_ok=True)
+    with open(path + ".tmp", "wb") as f:
+        f.write(delta)
+    os.replace(path + ".tmp", path)     # Same file for all range requests
+    print(" * Delta {} bytes for {} bytes {}".format(len(delta), len(new), filename))
+    return path
+
+
 app = Flask(__name__)
 
 
 @app.route('/<filename>')
 def fw(filename):
-    if os.path.exists(fwdir + str(filename)):
-        return send_file(fwdir + str(filename),
+    filename = os.path.basename(str(filename))
+    if filename.endswith(".sha256") and os.path.exists(fwdir + filename[:-7]):
+        with open(fwdir + filename[:-7], "rb") as f:
+            return hashlib.sha256(f.read()).hexdigest() + "\n"
+
+    if os.path.exists(fwdir + filename):
+        path = fwdir + filename
+        md5 = request.args.get("md5", "").lower()
+        if filename.endswith(".bin") and len(md5) == 32:
+            path = delta_file(filename, md5) or path
+        return send_file(path,
                          attachment_filename=filename,
-                         mimetype='application/octet-stream')
+                         mimetype='application/octet-stream',
+                         conditional=True)     # Support range requests
 
     return "ERROR: file not found"
 
@@ -0,0 +1,250 @@
+#!/usr/bin/env python3
+# coding=utf-8
+"""
+  mqtt-load.py - MQTT command load generator for Tasmota
+
+  Copyright (C) 2020  Theo Arends
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Requirements:
+   - Python3
+   - pip install paho-mqtt
+
+Instructions:
+    Sends commands to one or more devices at a fixed rate per device and
+    correlates the stat/<topic>/RESULT replies with the commands sent.
+    Reports round-trip latency percentiles and the number of commands
+    without a reply within the timeout per command type.
+
+    Commands (option -c, comma separated):
+        power   - Power TOGGLE, answered by {"POWER":..}
+        dimmer  - Dimmer <n>, answered by {..,"Dimmer":<n>,..}
+        backlog - Backlog Dimmer <n>;Dimmer <m>, answered by the last {"Dimmer":<m>}
+
+    Replies are matched to the oldest outstanding command of the device
+    expecting them, so the Dimmer values cycle to keep them distinct.
+    Use SetOption4 0 so replies are published as RESULT.
+
+Usage:
+    ./mqtt-load.py -b <broker> -t <topic>[,<topic>..] [-c power,dimmer,backlog]
+                   [-r <commands/s per device>] [-s <seconds>] [-w <timeout>]
+
+Example:
+    ./mqtt-load.py -b 192.168.1.10 -t tasmota1,tasmota2 -c power,dimmer -r 5 -s 60
+"""
+
+import itertools
+import math
+import threading
+import time
+import json
+from optparse import OptionParser
+from sys import exit
+
+try:
+    import paho.mqtt.client as mqtt
+except ImportError:
+    print("Please install paho-mqtt: pip install paho-mqtt")
+    exit(1)
+
+COMMANDS = ["power", "dimmer", "backlog"]
+
+
+class Pending:
+    def __init__(self, kind, key, value, sent):
+        self.kind = kind
+        self.key = key              # Reply key closing the command
+        self.value = value          # Expected value or None for any
+        self.sent = sent
+
+
+class Device:
+    def __init__(self, topic):
+        self.topic = topic
+        self.pending = []
+        self.dimmer = 0
+
+    def next_dimmer(self):
+        self.dimmer = self.dimmer % 100 + 1
+        return self.dimmer
+
+
+class Load:
+    def __init__(self, options):
+        self.options = options
+        self.lock = threading.Lock()
+        self.devices = {}
+        for topic in options.topics.split(","):
+            self.devices[topic] = Device(topic)
+        self.kinds = options.commands.split(",")
+        for kind in self.kinds:
+            if kind not in COMMANDS:
+                print("Unknown command {}, use one of {}".format(kind, ",".join(COMMANDS)))
+                exit(1)
+        self.latency = dict((kind, []) for kind in self.kinds)
+        self.sent = dict((kind, 0) for kind in self.kinds)
+        self.dropped = dict((kind, 0) for kind in self.kinds)
+        self.unmatched = 0
+
+    def full_topic(self, prefix, topic, command):
+        return self.options.fulltopic.replace("%prefix%", prefix).replace("%topic%", topic).rstrip("/") + "/" + command
+
+    def on_connect(self, client, userdata, flags, rc):
+        if rc:
+            print("Connect to broker failed ({})".format(rc))
+            return
+        for topic in self.devices:
+            client.subscribe(self.full_topic("stat", topic, "RESULT"))
+
+    def on_message(self, client, userdata, msg):
+        now = time.perf_counter()
+        parts = msg.topic.split("/")
+        device = None
+        for topic in self.devices:
+            if topic in parts:
+                device = self.devices[topic]
+                break
+        if device is None:
+            return
+        try:
+            reply = json.loads(msg.payload.decode("utf-8", "replace"))
+        except ValueError:
+            return
+        if not isinstance(reply, dict):
+            return
+        with self.lock:
+            # Dimmer replies also hold POWER so commands expecting a value match first
+            for pending in sorted(device.pending, key=lambda p: p.value is None):
+                if self.matches(pending, reply):
+                    device.pending.remove(pending)
+                    self.latency[pending.kind].append((now - pending.sent) * 1000)
+                    return
+            self.unmatched += 1
+
+    def matches(self, pending, reply):
+        for key, value in reply.items():
+            if key.upper().startswith(pending.key.upper()):
+                if pending.value is None or str(value) == str(pending.value):
+                    return True
+        return False
+
+    def send(self, client, device, kind):
+        if kind == "power":
+            command, payload, key, value = "Power", "TOGGLE", "POWER", None
+        elif kind == "dimmer":
+            value = device.next_dimmer()
+            command, payload, key = "Dimmer", str(value), "Dimmer"
+        else:
+            first = device.next_dimmer()
+            value = device.next_dimmer()
+            command, payload, key = "Backlog", "Dimmer {};Dimmer {}".format(first, value), "Dimmer"
+        with self.lock:
+            device.pending.append(Pending(kind, key, value, time.perf_counter()))
+            self.sent[kind] += 1
+        client.publish(self.full_topic("cmnd", device.topic, command), payload)
+
+    def expire(self, now, timeout):
+        with self.lock:
+            for device in self.devices.values():
+                for pending in [p for p in device.pending if now - p.sent > timeout]:
+                    device.pending.remove(pending)
+                    self.dropped[pending.kind] += 1
+
+    def run(self, client):
+        interval = 1.0 / self.options.rate
+        kinds = itertools.cycle(self.kinds)
+        start = time.perf_counter()
+        end = start + self.options.seconds
+        next_send = start
+        while time.perf_counter() < end:
+            kind = next(kinds)
+            for device in self.devices.values():
+                self.send(client, device, kind)
+            next_send += interval
+            self.expire(time.perf_counter(), self.options.timeout)
+            delay = next_send - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+        # Wait for outstanding replies, any left are dropped
+        time.sleep(self.options.timeout)
+        self.expire(time.perf_counter() + self.options.timeout, self.options.timeout)
+        return time.perf_counter() - start - self.options.timeout
+
+    def report(self, duration):
+        print("{:8} {:>7} {:>7} {:>7} {:>8} {:>8} {:>8} {:>8} {:>8}".format(
+            "Command", "Sent", "Replies", "Dropped", "Min", "P50", "P90", "P99", "Max"))
+        total = []
+        for kind in self.kinds + ["total"]:
+            if kind == "total":
+                latency = sorted(total)
+                sent = sum(self.sent.values())
+                dropped = sum(self.dropped.values())
+            else:
+                latency = sorted(self.latency[kind])
+                total.extend(latency)
+                sent = self.sent[kind]
+                dropped = self.dropped[kind]
+            if latency:
+                stats = [latency[0], percentile(latency, 50), percentile(latency, 90), percentile(latency, 99), latency[-1]]
+                stats = ["{:8.1f}".format(s) for s in stats]
+            else:
+                stats = ["{:>8}".format("-")] * 5
+            print("{:8} {:7d} {:7d} {:7d} {}".format(kind, sent, len(latency), dropped, " ".join(stats)))
+        replies = len(total)
+        print("Latency in mS, {:.1f} replies/s over {:.1f} s, {} unmatched replies".format(
+            replies / duration if duration > 0 else 0, duration, self.unmatched))
+
+
+def percentile(values, p):
+    # Nearest rank percentile of sorted values
+    index = max(0, int(math.ceil(p / 100.0 * len(values))) - 1)
+    return values[index]
+
+
+if __name__ == "__main__":
+    parser = OptionParser()
+    parser.add_option("-b", "--broker", action="store", type="string", dest="broker", default="localhost", help="MQTT broker host (default: localhost)")
+    parser.add_option("-P", "--port", action="store", type="int", dest="port", default=1883, help="MQTT broker port (default: 1883)")
+    parser.add_option("-u", "--username", action="store", type="string", dest="username", help="MQTT username")
+    parser.add_option("-p", "--password", action="store", type="string", dest="password", help="MQTT password")
+    parser.add_option("-t", "--topics", action="store", type="string", dest="topics", help="comma separated device topics")
+    parser.add_option("-f", "--fulltopic", action="store", type="string", dest="fulltopic", default="%prefix%/%topic%/", help="device FullTopic (default: %prefix%/%topic%/)")
+    parser.add_option("-c", "--commands", action="store", type="string", dest="commands", default="power", help="comma separated commands power, dimmer and backlog sent in turn (default: power)")
+    parser.add_option("-r", "--rate", action="store", type="float", dest="rate", default=1.0, help="commands per second per device (default: 1)")
+    parser.add_option("-s", "--seconds", action="store", type="float", dest="seconds", default=30.0, help="test duration in seconds (default: 30)")
+    parser.add_option("-w", "--timeout", action="store", type="float", dest="timeout", default=5.0, help="seconds to wait for a reply before counting a drop (default: 5)")
+    (options, args) = parser.parse_args()
+
+    if not options.topics:
+        parser.print_help()
+        exit(1)
+    if options.rate <= 0:
+        print("Rate must be above 0")
+        exit(1)
+
+    load = Load(options)
+    client = mqtt.Client()
+    if options.username:
+        client.username_pw_set(options.username, options.password)
+    client.on_connect = load.on_connect
+    client.on_message = load.on_message
+    client.connect(options.broker, options.port)
+    client.loop_start()
+    time.sleep(1)                           # Allow subscriptions to complete
+
+    duration = load.run(client)
+    client.loop_stop()
+    client.disconnect()
+    load.report(duration)